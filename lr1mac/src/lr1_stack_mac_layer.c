@@ -42,7 +42,6 @@
 #include "smtc_real.h"
 #include "lorawan_api.h"
 #include "smtc_bsp.h"
-#include <math.h>
 
 /*
  *-----------------------------------------------------------------------------------
@@ -60,8 +59,6 @@ static const char* name_bw[]         = { "BW007", "BW010", "BW015", "BW020", "BW
                                  "BW125", "BW200", "BW250", "BW400", "BW500", "BW800", "BW1600" };
 #endif
 
-static const uint16_t MAX_FCNT_GAP = 16384UL;
-
 /*
  *-----------------------------------------------------------------------------------
  *--- PRIVATE FUNCTIONS DECLARATION -------------------------------------------------
@@ -79,6 +76,12 @@ static void frame_header_set( lr1_stack_mac_t* lr1_mac );
  *
  */
 static valid_dev_addr_t check_dev_addr( lr1_stack_mac_t* lr1_mac, uint32_t devAddr_to_test );
+/*!
+ * \brief   Check the MType and, once joined, the DevAddr of a received frame
+ * \param [IN]  header MHDR followed by the DevAddr of the frame
+ * \param [OUT] return True if the frame may be a downlink for the device
+ */
+static bool rx_header_is_for_device( lr1_stack_mac_t* lr1_mac, const uint8_t* header );
 /*!
  *
  */
@@ -88,9 +91,10 @@ static status_lorawan_t rx_payload_size_check( lr1_stack_mac_t* lr1_mac );
  */
 static status_lorawan_t rx_mhdr_extract( lr1_stack_mac_t* lr1_mac );
 /*!
- *
+ * \brief   Size the rx window to cover the clock drift over rx_delay_ms, integer math only
+ * \remark  For FSK, sf is the data rate in kbps
  */
-static void compute_rx_window_parameters( lr1_stack_mac_t* lr1_mac, uint8_t sf, lr1mac_bandwidth_t bw,
+static void compute_rx_window_parameters( lr1_stack_mac_t* lr1_mac, ral_lora_sf_t sf, ral_lora_bw_t bw,
                                           uint32_t clock_accuracy, uint32_t rx_delay_ms, uint8_t board_delay_ms,
                                           modulation_type_t rx_modulation_type );
 /*!
@@ -98,50 +102,257 @@ static void compute_rx_window_parameters( lr1_stack_mac_t* lr1_mac, uint8_t sf,
  */
 static int rx_fhdr_extract( lr1_stack_mac_t* lr1_mac, uint16_t* fcnt_dwn_tmp, uint32_t dev_addr );
 
+/*!
+ * \brief   Rebuild the 32-bit counter of a data downlink and check its MIC
+ * \remark  The candidates are the first counter after the last one ending with the received 16 bits, then the same
+ *          16 bits in the next MSB values up to LR1MAC_FCNT_DWN_MSB_CANDIDATES: the first one authenticated by the MIC
+ *          is kept. A replayed frame only matches its own counter, it is rejected
+ * \param [IN]  lr1_mac        Stack context
+ * \param [IN]  nwk_skey_ctx   Network session key of the frame
+ * \param [IN]  dev_addr       Device or multicast group address
+ * \param [IN]  fcnt_dwn_lsb   16 counter bits of the frame header
+ * \param [IN]  size           Frame size without the MIC
+ * \param [IN]  mic_in         Received MIC
+ * \param [IN]  candidate_nb   Candidates tried, up to LR1MAC_FCNT_DWN_MSB_CANDIDATES
+ * \param [IN]  fcnt_dwn       Last counter accepted, 0xFFFFFFFF before the first downlink of the session
+ * \param [out] fcnt_dwn       Counter of the frame, only written when the MIC is valid
+ * \param [out] return         OKLORAWAN if the MIC is valid with one of the candidates
+ */
+static int fcnt_dwn_mic_check( lr1_stack_mac_t* lr1_mac, const lora_crypto_key_t* nwk_skey_ctx, uint32_t dev_addr,
+                               uint16_t fcnt_dwn_lsb, uint8_t size, uint32_t mic_in, uint8_t candidate_nb,
+                               uint32_t* fcnt_dwn );
+#if( BSP_LR1MAC_EARLY_DOWNLINK_CHECK == 1 )
+/*!
+ * \brief   Check the MIC of a data downlink without updating the stack state
+ * \remark  The frame is fully decoded later by lr1_stack_mac_rx_frame_decode
+ * \param [IN]  candidate_nb   Counter candidates tried, one under radio interrupt
+ */
+static int downlink_mic_check( lr1_stack_mac_t* lr1_mac, valid_dev_addr_t dev_addr_type, uint8_t candidate_nb );
+#endif
+/*!
+ * \brief   Multicast group a frame address was matched to by check_dev_addr, NULL for the unicast session
+ */
+static lr1_stack_mac_multicast_t* multicast_group_get( lr1_stack_mac_t* lr1_mac, valid_dev_addr_t dev_addr_type );
+/*!
+ * \brief   Check and decrypt a multicast downlink in the downlink fifo
+ * \remark  Only unconfirmed application frames are accepted, a group carries neither mac command nor ack
+ */
+static rx_packet_type_t multicast_rx_frame_decode( lr1_stack_mac_t* lr1_mac, lr1_stack_mac_multicast_t* mc_group );
+/*!
+ * \brief   Append the downlink counter of a multicast group to the nvm journal, the record holds all the groups
+ */
+static void multicast_fcnt_save( lr1_stack_mac_t* lr1_mac, const lr1_stack_mac_multicast_t* mc_group );
+/*!
+ *
+ */
+static void link_check_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
+/*!
+ *
+ */
+static void link_adr_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
+/*!
+ *
+ */
+static void duty_cycle_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
 /*!
  *
  */
-static int fcnt_dwn_accept( uint16_t fcnt_dwn_tmp, uint32_t* fcnt_lorawan );
+static void rx_param_setup_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
 /*!
  *
  */
-static void link_check_parser( lr1_stack_mac_t* lr1_mac );
+static void dev_status_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
 /*!
  *
  */
-static void link_adr_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_link_adr_req );
+static void new_channel_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
 /*!
  *
  */
-static void duty_cycle_parser( lr1_stack_mac_t* lr1_mac );
+static void rx_timing_setup_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
 /*!
  *
  */
-static void rx_param_setup_parser( lr1_stack_mac_t* lr1_mac );
+static void tx_param_setup_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
 /*!
  *
  */
-static void dev_status_parser( lr1_stack_mac_t* lr1_mac );
+static void dl_channel_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
 /*!
  *
  */
-static void new_channel_parser( lr1_stack_mac_t* lr1_mac );
+static void device_time_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
 /*!
  *
  */
-static void rx_timing_setup_parser( lr1_stack_mac_t* lr1_mac );
+static void ping_slot_info_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
 /*!
  *
  */
-static void tx_param_setup_parser( lr1_stack_mac_t* lr1_mac );
+static void ping_slot_channel_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
 /*!
  *
  */
-static void dl_channel_parser( lr1_stack_mac_t* lr1_mac );
+static void beacon_freq_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );
 /*!
  *
  */
 uint8_t lr1_stack_mac_cmd_ans_cut( uint8_t* nwk_ans, uint8_t nwk_ans_size_in, uint8_t max_allowed_size );
+/*!
+ * \brief   Enqueue the listen before talk CAD on the channel and with the modulation of the uplink
+ */
+static void lbt_cad_start( lr1_stack_mac_t* lr1_mac, const rp_radio_params_t* tx_radio_params, uint8_t hook_id );
+/*!
+ * \brief   Handle the end of the listen before talk CAD, called by the radio planner callback
+ */
+static void lbt_cad_done( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Random delay before the next join request, doubled at each retry
+ */
+static uint32_t join_backoff_s_get( uint32_t retry_join_cpt );
+/*!
+ * \brief   Radio parameters of the RX1 or RX2 window, also used for the class C continuous reception on RX2
+ */
+static void rx_radio_params_build( lr1_stack_mac_t* lr1_mac, const rx_win_type_t type,
+                                   rp_radio_params_t* radio_params );
+/*!
+ * \brief   Update the RX windows timing model with the end of a downlink received in the window type
+ */
+static void rx_drift_update( lr1_stack_mac_t* lr1_mac, const rx_win_type_t type, const uint32_t rx_done_us );
+/*!
+ * \brief   Count an uplink left without its answer, the timing model is dropped after too many in a row
+ */
+static void rx_drift_miss( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Regulator of a radio task, the DC-DC converter for the long ones only
+ */
+static ral_reg_mode_t radio_reg_mode_get( uint32_t radio_on_ms );
+/*!
+ * \brief   LNA regime of a LoRa reception, high sensitivity while the downlink margin is unknown or low
+ */
+static ral_lna_mode_t radio_lna_mode_get( lr1_stack_mac_t* lr1_mac, ral_lora_sf_t sf, ral_lora_bw_t bw );
+/*!
+ * \brief   Sensitivity estimate of a LoRa reception
+ */
+static int16_t lora_sensitivity_dbm( ral_lora_sf_t sf, ral_lora_bw_t bw );
+/*!
+ * \brief   Power of the next uplink: tx_power, lowered by the power control to hold the margin at the gateway
+ */
+static int8_t tx_power_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Update the path loss estimate of the power control with the last downlink
+ */
+static void tx_power_ctrl_update( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Free fifo entry the next downlink is decrypted in, the oldest waiting one is lost if the fifo is full
+ */
+static lr1_stack_mac_downlink_t* downlink_tail_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Make the downlink decrypted in the tail entry available to the application
+ */
+static void downlink_push( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Copy the pending mac answers in the fopts of the next uplink
+ * \param [OUT] return    false if they don't fit in the fopts field and have to be sent on port 0
+ */
+static bool tx_fopts_current_set( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Add the pending DeviceTimeReq to the fopts of the uplink being built, if they have room for it
+ */
+static void device_time_fopts_add( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Add a LinkCheckReq to the fopts of the uplink being built when the monitor period is over, after
+ *          accounting for the last request when it was not answered
+ */
+static void link_check_fopts_add( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Rate the link with the last LinkCheckAns margin, or with a request unanswered
+ * \param [IN]  is_answered   false for a request unanswered, the margin is not used then
+ */
+static void link_check_update( lr1_stack_mac_t* lr1_mac, bool is_answered );
+/*!
+ * \brief   Add the pending PingSlotInfoReq to the fopts of the uplink being built, if they have room for it
+ */
+static void ping_info_fopts_add( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Radio parameters of the beacon and ping slots, on the frequencies set by the network if any
+ */
+static void class_b_params_get( lr1_stack_mac_t* lr1_mac, uint32_t beacon_time_s,
+                                smtc_real_class_b_params_t* params );
+/*!
+ * \brief   RTC time of a network time, on the last beacon received once tracked, on the DeviceTimeAns before
+ * \param [OUT] half_window_ms  uncertainty of the RTC time, on each side
+ * \param [OUT] return          false without time reference
+ */
+static bool class_b_local_time_get( lr1_stack_mac_t* lr1_mac, uint64_t gps_time_ms, uint32_t* local_time_ms,
+                                    uint32_t* half_window_ms );
+/*!
+ * \brief   Time on air of the beacon, implicit header without CRC
+ */
+static uint32_t class_b_beacon_toa_ms( const smtc_real_class_b_params_t* params );
+/*!
+ * \brief   First ping slot of the device in the beacon period, AES of the beacon time and DevAddr with a zero key
+ */
+static uint16_t class_b_ping_offset_get( lr1_stack_mac_t* lr1_mac, uint32_t beacon_time_s );
+/*!
+ * \brief   Next ping slot of the device in a beacon period which can still be scheduled
+ * \param [OUT] return          false if the last ping slot of the period is gone
+ */
+static bool class_b_ping_slot_get( lr1_stack_mac_t* lr1_mac, uint32_t beacon_time_s, uint32_t* slot_ms,
+                                   uint32_t* half_window_ms );
+/*!
+ * \brief   Check the mac commands of nwk_payload before any of them is applied
+ * \remark  Returns the size of the leading commands which are known, complete and whose answers fit in the answer
+ *          buffers. The blocks of a LinkADR request are kept or dropped together.
+ */
+static uint8_t cmd_payload_check( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Demodulation floor of a LoRa spreading factor, in dB of SNR
+ */
+static int16_t lora_snr_floor_db( uint8_t sf );
+/*!
+ * \brief   Add a link margin sample, given as the SNR the uplinks would get at full power
+ */
+static void link_margin_sample_add( lr1_stack_mac_t* lr1_mac, int16_t snr_db );
+/*!
+ * \brief   Nvm journal key of the stack, given the key of the first stack
+ */
+static uint8_t journal_key_get( const lr1_stack_mac_t* lr1_mac, uint8_t key );
+
+/*
+ *-----------------------------------------------------------------------------------
+ *--- PRIVATE MAC COMMANDS ----------------------------------------------------------
+ */
+
+/*!
+ * Downlink mac command, indexed by its CID
+ */
+typedef struct lr1_stack_mac_cmd_s
+{
+    uint8_t req_size;    // request size, CID included
+    uint8_t ans_size;    // answer size, CID included, 0 without answer
+    bool    is_sticky;   // answer repeated in each uplink until a downlink is received
+    bool    is_grouped;  // consecutive requests are applied together, each of them answered
+    void ( *parser )( lr1_stack_mac_t* lr1_mac, uint8_t nb_req );  // apply the requests, write their answers
+} lr1_stack_mac_cmd_t;
+
+static const lr1_stack_mac_cmd_t lr1_stack_mac_cmds[NB_MAC_CMD_REQ] = {
+    [LINK_CHECK_ANS]        = { LINK_CHECK_ANS_SIZE, 0, false, false, link_check_parser },
+    [LINK_ADR_REQ]          = { LINK_ADR_REQ_SIZE, LINK_ADR_ANS_SIZE, false, true, link_adr_parser },
+    [DUTY_CYCLE_REQ]        = { DUTY_CYCLE_REQ_SIZE, DUTY_CYCLE_ANS_SIZE, false, false, duty_cycle_parser },
+    [RXPARRAM_SETUP_REQ]    = { RXPARRAM_SETUP_REQ_SIZE, RXPARRAM_SETUP_ANS_SIZE, true, false, rx_param_setup_parser },
+    [DEV_STATUS_REQ]        = { DEV_STATUS_REQ_SIZE, DEV_STATUS_ANS_SIZE, false, false, dev_status_parser },
+    [NEW_CHANNEL_REQ]       = { NEW_CHANNEL_REQ_SIZE, NEW_CHANNEL_ANS_SIZE, false, false, new_channel_parser },
+    [RXTIMING_SETUP_REQ]    = { RXTIMING_SETUP_REQ_SIZE, RXTIMING_SETUP_ANS_SIZE, true, false, rx_timing_setup_parser },
+    [TXPARAM_SETUP_REQ]     = { TXPARAM_SETUP_REQ_SIZE, TXPARAM_SETUP_ANS_SIZE, true, false, tx_param_setup_parser },
+    [DL_CHANNEL_REQ]        = { DL_CHANNEL_REQ_SIZE, DL_CHANNEL_ANS_SIZE, true, false, dl_channel_parser },
+    [DEVICE_TIME_ANS]       = { DEVICE_TIME_ANS_SIZE, 0, false, false, device_time_parser },
+    [PING_SLOT_INFO_ANS]    = { PING_SLOT_INFO_ANS_SIZE, 0, false, false, ping_slot_info_parser },
+    [PING_SLOT_CHANNEL_REQ] = { PING_SLOT_CHANNEL_REQ_SIZE, PING_SLOT_CHANNEL_ANS_SIZE, true, false,
+                                ping_slot_channel_parser },
+    [BEACON_FREQ_REQ]       = { BEACON_FREQ_REQ_SIZE, BEACON_FREQ_ANS_SIZE, false, false, beacon_freq_parser },
+};
+
 /*
  *-----------------------------------------------------------------------------------
  *--- PUBLIC FUNCTIONS DEFINITIONS --------------------------------------------------
@@ -162,6 +373,39 @@ void lr1_stack_mac_init( lr1_stack_mac_t* lr1_mac, lorawan_keys_t* lorawan_keys,
     lr1_mac->available_app_packet      = NO_LORA_RXPACKET_AVAILABLE;
     lr1_mac->tx_power_offset           = 0;
     lr1_mac->real                      = real;
+    lr1_mac->rx2_started_under_it      = false;
+    lr1_mac->process_event_pending     = false;
+    lr1_mac->lbt_enable                = 0;
+    lr1_mac->lbt_cad_cnt               = 0;
+    lr1_mac->lbt_is_channel_clear      = false;
+    lr1_mac->rx_cad_gate_enable        = 0;
+    lr1_mac->rx_drift.sample_cnt       = 0;
+    lr1_mac->rx_drift.miss_cnt         = 0;
+    lr1_mac->tx_power_ctrl.enabled     = false;
+    lr1_mac->tx_power_ctrl.is_known    = false;
+    lr1_mac->tx_slot.period_ms         = 0;
+    lr1_mac->is_join_pending           = false;
+    lr1_mac->fcnt_save_period          = LR1MAC_SESSION_FCNT_SAVE_PERIOD;
+    lr1_mac->downlink_fifo.head        = 0;
+    lr1_mac->downlink_fifo.count       = 0;
+    lr1_mac->downlink_fifo.lost        = 0;
+    lr1_mac->class_c.lr1_mac           = lr1_mac;
+    lr1_mac->class_c.enabled           = false;
+    lr1_mac->class_c.is_running        = false;
+    lr1_mac->class_c.is_rx_done        = false;
+    for( uint8_t i = 0; i < LR1MAC_MULTICAST_GROUP_NB; i++ )
+    {
+        lr1_mac->multicast[i].enabled = false;
+    }
+    memset( &lr1_mac->device_time, 0, sizeof( lr1_mac->device_time ) );
+    memset( &lr1_mac->link_check, 0, sizeof( lr1_mac->link_check ) );
+    memset( &lr1_mac->class_b, 0, sizeof( lr1_mac->class_b ) );
+    lr1_mac->class_b.lr1_mac     = lr1_mac;
+    lr1_mac->class_b.periodicity = LR1MAC_CLASS_B_PING_PERIODICITY;
+
+    // the ping offsets are ciphered with a zero key, expanded once
+    const uint8_t ping_key[16] = { 0 };
+    crypto_backend_key_set( &lr1_mac->class_b.ping_key_ctx, ping_key );
 
 #if defined( PERF_TEST_ENABLED )
     // bypass join process to allow perf testbench to trigger some modem send tx commands
@@ -171,6 +415,99 @@ void lr1_stack_mac_init( lr1_stack_mac_t* lr1_mac, lorawan_keys_t* lorawan_keys,
     lr1_stack_mac_session_init( lr1_mac );
 }
 
+void lr1_stack_mac_session_keys_expand( lr1_stack_mac_t* lr1_mac )
+{
+    lora_crypto_key_set( &lr1_mac->nwk_skey_ctx, lr1_mac->nwk_skey );
+    lora_crypto_key_set( &lr1_mac->app_skey_ctx, lr1_mac->app_skey );
+}
+
+void lr1_stack_mac_app_key_expand( lr1_stack_mac_t* lr1_mac )
+{
+    lora_crypto_key_set( &lr1_mac->app_key_ctx, lr1_mac->app_key );
+}
+
+void lr1_stack_mac_join_context_save( lr1_stack_mac_t* lr1_mac )
+{
+    join_context_t join_context;
+
+    join_context.retry_join_cpt  = lr1_mac->retry_join_cpt;
+    join_context.is_join_pending = ( lr1_mac->is_join_pending == true ) ? 1 : 0;
+    bsp_nvm_journal_write( journal_key_get( lr1_mac, BSP_NVM_JOURNAL_KEY_LORAWAN_JOIN ), ( uint8_t* ) &join_context,
+                           sizeof( join_context ) );
+}
+
+void lr1_stack_mac_join_context_load( lr1_stack_mac_t* lr1_mac )
+{
+    join_context_t join_context;
+
+    if( ( bsp_nvm_journal_read( journal_key_get( lr1_mac, BSP_NVM_JOURNAL_KEY_LORAWAN_JOIN ),
+                                ( uint8_t* ) &join_context, sizeof( join_context ) ) != sizeof( join_context ) ) ||
+        ( join_context.is_join_pending == 0 ) )
+    {
+        lr1_mac->is_join_pending = false;
+        return;
+    }
+    uint32_t current_time_s = bsp_rtc_get_time_s( );
+
+    // the time of the first join is lost with the reset: the duty cycle restarts, the back-off does not
+    lr1_mac->is_join_pending           = true;
+    lr1_mac->retry_join_cpt            = join_context.retry_join_cpt;
+    lr1_mac->first_join_timestamp      = current_time_s;
+    lr1_mac->next_time_to_join_seconds = current_time_s + join_backoff_s_get( lr1_mac->retry_join_cpt );
+    BSP_DBG_TRACE_PRINTF( " Join pending, retry %lu at %lu s\n", lr1_mac->retry_join_cpt,
+                          lr1_mac->next_time_to_join_seconds );
+}
+
+void lr1_stack_mac_fcnt_save( lr1_stack_mac_t* lr1_mac )
+{
+    mac_fcnt_context_t fcnt_context;
+
+    fcnt_context.dev_addr         = lr1_mac->dev_addr;
+    fcnt_context.fcnt_up          = lr1_mac->fcnt_up;
+    fcnt_context.fcnt_dwn         = lr1_mac->fcnt_dwn;
+    fcnt_context.fcnt_save_period = lr1_mac->fcnt_save_period;
+    bsp_nvm_journal_write( journal_key_get( lr1_mac, BSP_NVM_JOURNAL_KEY_LORAWAN_FCNT ), ( uint8_t* ) &fcnt_context,
+                           sizeof( fcnt_context ) );
+}
+
+void lr1_stack_mac_fcnt_restore( lr1_stack_mac_t* lr1_mac )
+{
+    mac_fcnt_context_t fcnt_context;
+    uint32_t           gap = LR1MAC_SESSION_FCNT_SAVE_PERIOD;
+
+    // the journal counters are newer than the session ones, unless they belong to another session
+    if( ( bsp_nvm_journal_read( journal_key_get( lr1_mac, BSP_NVM_JOURNAL_KEY_LORAWAN_FCNT ),
+                                ( uint8_t* ) &fcnt_context, sizeof( fcnt_context ) ) == sizeof( fcnt_context ) ) &&
+        ( fcnt_context.dev_addr == lr1_mac->dev_addr ) && ( fcnt_context.fcnt_up >= lr1_mac->fcnt_up ) )
+    {
+        lr1_mac->fcnt_up  = fcnt_context.fcnt_up;
+        lr1_mac->fcnt_dwn = fcnt_context.fcnt_dwn;
+        gap               = fcnt_context.fcnt_save_period;
+    }
+    // the frames sent since the last save are unknown, a brownout included: skip the save period in effect then
+    lr1_mac->fcnt_up += gap;
+    lr1_stack_mac_fcnt_save( lr1_mac );
+    BSP_DBG_TRACE_PRINTF( " FcntUp restored = %lu\n", lr1_mac->fcnt_up );
+}
+
+void lr1_stack_mac_fcnt_up_increment( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_mac->fcnt_up++;
+    if( lr1_stack_mac_session_is_kept( lr1_mac ) && ( ( lr1_mac->fcnt_up % lr1_mac->fcnt_save_period ) == 0 ) )
+    {
+        lr1_stack_mac_fcnt_save( lr1_mac );
+    }
+}
+
+bool lr1_stack_mac_session_is_kept( const lr1_stack_mac_t* lr1_mac )
+{
+#if( BSP_LR1MAC_SESSION_RESTORE == 1 )
+    return ( lr1_mac->join_status == JOINED ) || ( lr1_mac->otaa_device == ABP_DEVICE );
+#else
+    return false;
+#endif
+}
+
 void lr1_stack_mac_session_init( lr1_stack_mac_t* lr1_mac )
 {
     lr1_mac->fcnt_dwn                    = ~0;
@@ -178,10 +515,21 @@ void lr1_stack_mac_session_init( lr1_stack_mac_t* lr1_mac )
     lr1_mac->retry_join_cpt              = 0;
     lr1_mac->adr_ack_cnt                 = 0;
     lr1_mac->adr_ack_cnt_confirmed_frame = 0;
+    lr1_mac->link_margin.sample_nb       = 0;
+    lr1_mac->link_margin.sample_idx      = 0;
+    lr1_mac->link_margin.is_updated      = false;
+    lr1_mac->tx_power_ctrl.is_known      = false;
+    lr1_mac->link_check.is_pending       = false;
+    lr1_mac->link_check.period           = LR1MAC_LINK_CHECK_PERIOD_MIN;
+    lr1_mac->link_check.uplink_cnt       = 0;
+    lr1_mac->link_check.miss_cnt         = 0;
+    lr1_mac->link_check.state            = LR1MAC_LINK_STATE_UNKNOWN;
     lr1_mac->tx_fopts_current_length     = 0;
     lr1_mac->tx_fopts_length             = 0;
     lr1_mac->tx_fopts_lengthsticky       = 0;
+    lr1_mac->tx_fopts_high_water         = 0;
     lr1_mac->nwk_ans_size                = 0;
+    lr1_mac->is_nwk_ans_pending          = false;
     lr1_mac->nwk_payload_size            = 0;
     lr1_mac->nwk_payload_index           = 0;
     lr1_mac->max_eirp_dbm                = smtc_real_default_max_eirp_get( lr1_mac );
@@ -190,6 +538,14 @@ void lr1_stack_mac_session_init( lr1_stack_mac_t* lr1_mac )
     lr1_mac->max_duty_cycle_index        = 0;
     lr1_mac->tx_duty_cycle_time_off_ms   = 0;
     lr1_mac->tx_duty_cycle_timestamp_ms  = bsp_rtc_get_time_ms( );
+
+    // the ping slots of a new session wait for the network to know them, on the default channels
+    lr1_mac->class_b.is_ping_info_requested = lr1_mac->class_b.enabled;
+    lr1_mac->class_b.is_ping_info_acked     = false;
+    lr1_mac->class_b.ping_dr                = 0xFF;
+    lr1_mac->class_b.ping_freq_hz           = 0;
+    lr1_mac->class_b.beacon_freq_hz         = 0;
+    lr1_mac->class_b.ping_time_s            = 0;
 }
 
 /**************************************************************************************************/
@@ -201,25 +557,41 @@ void lr1_stack_mac_session_init( lr1_stack_mac_t* lr1_mac )
 
 void lr1_stack_mac_tx_frame_build( lr1_stack_mac_t* lr1_mac )
 {
-    lr1_mac->tx_fctrl = 0;
+    if( lr1_mac->tx_fport != PORTNWK )
+    {
+        device_time_fopts_add( lr1_mac );
+        link_check_fopts_add( lr1_mac );
+        ping_info_fopts_add( lr1_mac );
+    }
+    // the network learns the switch to the class B from the uplinks
+    const uint8_t class_b_bit = ( ( lr1_mac->class_b.state == LR1MAC_CLASS_B_STATE_TRACKING ) &&
+                                  ( lr1_mac->class_b.is_ping_info_acked == true ) )
+                                    ? 1
+                                    : 0;
+    // the application payload is already in place, the headers and the fopts of this uplink end right before it
+    lr1_mac->tx_frame_offset = LR1MAC_TX_PAYLOAD_OFFSET - FHDROFFSET - lr1_mac->tx_fopts_current_length;
+    lr1_mac->tx_fctrl        = 0;
     lr1_mac->tx_fctrl = ( lr1_mac->adr_enable << 7 ) + ( lr1_mac->adr_ack_req << 6 ) + ( lr1_mac->tx_ack_bit << 5 ) +
-                        ( lr1_mac->tx_fopts_current_length & 0x0F );
+                        ( class_b_bit << 4 ) + ( lr1_mac->tx_fopts_current_length & 0x0F );
     lr1_mac->tx_ack_bit = 0;
-    lr1_mac->rx_ack_bit = 0;
+    lr1_mac->rx_ack_bit      = 0;
+    lr1_mac->rx_fpending_bit = -1;
     mac_header_set( lr1_mac );
     frame_header_set( lr1_mac );
     lr1_mac->tx_payload_size = lr1_mac->app_payload_size + FHDROFFSET + lr1_mac->tx_fopts_current_length;
+    // fcnt_up is held by this frame until its last transmission, it has not been on air yet
+    lr1_mac->tx_fcnt_up_is_used = false;
+    // the answers are in the fopts of this uplink, or in its payload on port 0
+    lr1_mac->is_nwk_ans_pending = false;
 }
 
 void lr1_stack_mac_tx_frame_encrypt( lr1_stack_mac_t* lr1_mac )
 {
-    lora_crypto_payload_encrypt(
-        &lr1_mac->tx_payload[FHDROFFSET + lr1_mac->tx_fopts_current_length], lr1_mac->app_payload_size,
-        ( lr1_mac->tx_fport == PORTNWK ) ? lr1_mac->nwk_skey : lr1_mac->app_skey, lr1_mac->dev_addr, UP_LINK,
-        lr1_mac->fcnt_up, &lr1_mac->tx_payload[FHDROFFSET + lr1_mac->tx_fopts_current_length] );
-
-    lora_crypto_add_mic( &lr1_mac->tx_payload[0], lr1_mac->tx_payload_size, lr1_mac->nwk_skey, lr1_mac->dev_addr,
-                         UP_LINK, lr1_mac->fcnt_up );
+    lora_crypto_keyed_encrypt_and_mic(
+        &lr1_mac->crypto_ctx, &lr1_mac->tx_payload[lr1_mac->tx_frame_offset],
+        FHDROFFSET + lr1_mac->tx_fopts_current_length, lr1_mac->app_payload_size,
+        ( lr1_mac->tx_fport == PORTNWK ) ? &lr1_mac->nwk_skey_ctx : &lr1_mac->app_skey_ctx, &lr1_mac->nwk_skey_ctx,
+        lr1_mac->dev_addr, UP_LINK, lr1_mac->fcnt_up );
     lr1_mac->tx_payload_size = lr1_mac->tx_payload_size + 4;
 }
 
@@ -228,6 +600,9 @@ void lr1_stack_mac_tx_radio_start( lr1_stack_mac_t* lr1_mac )
     rp_radio_params_t radio_params = { 0 };
     rp_task_t         rp_task      = { 0 };
 
+    BSP_PERF_EVENT( BSP_PERF_EVENT_MAC_TX, 0 );
+    lr1_mac->rx2_started_under_it = false;
+
     if( lr1_mac->tx_modulation_type == LORA )
     {
         radio_params.pkt_type                 = RAL_PKT_TYPE_LORA;
@@ -240,7 +615,7 @@ void lr1_stack_mac_tx_radio_start( lr1_stack_mac_t* lr1_mac )
         radio_params.tx.lora.sf               = ( ral_lora_sf_t ) lr1_mac->tx_sf;
         radio_params.tx.lora.freq_in_hz       = lr1_mac->tx_frequency;
         radio_params.tx.lora.pld_len_in_bytes = lr1_mac->tx_payload_size;
-        radio_params.tx.lora.pwr_in_dbm       = lr1_mac->tx_power + lr1_mac->tx_power_offset;
+        radio_params.tx.lora.pwr_in_dbm       = tx_power_get( lr1_mac ) + lr1_mac->tx_power_offset;
         radio_params.tx.lora.pbl_len_in_symb  = smtc_real_preamble_get( lr1_mac, radio_params.tx.lora.sf );
     }
     else if( lr1_mac->tx_modulation_type == FSK )
@@ -276,12 +651,30 @@ void lr1_stack_mac_tx_radio_start( lr1_stack_mac_t* lr1_mac )
         bsp_mcu_handle_lr1mac_issue( );
     }
 
-    // uint32_t toa;
-    // ral_get_lora_time_on_air_in_ms( lr1_mac->rp->ral, ( &radio_params.tx.lora ), &toa );
-    // 2000; // Need time on air api with no ral dependencies dangerous in case on more than 1 hook in the rp
+    // listen before talk, except for the at time uplinks: the Tx is enqueued at the end of the CAD
+    if( ( lr1_mac->lbt_enable == 1 ) && ( lr1_mac->tx_modulation_type == LORA ) && ( lr1_mac->send_at_time == false ) &&
+        ( lr1_mac->tx_preempt == false ) && ( lr1_mac->lbt_is_channel_clear == false ) )
+    {
+        lbt_cad_start( lr1_mac, &radio_params, my_hook_id );
+        return;
+    }
+    lr1_mac->lbt_is_channel_clear = false;
+    lr1_mac->lbt_cad_cnt          = 0;
+
+    // the time on air is computed without the ral, the radio may be in use by another hook
+    uint32_t toa_ms = 0;
+    if( lr1_mac->tx_modulation_type == LORA )
+    {
+        toa_ms = lr1mac_utilities_get_lora_toa_ms( radio_params.tx.lora.pld_len_in_bytes, radio_params.tx.lora.sf,
+                                                   radio_params.tx.lora.bw, radio_params.tx.lora.cr,
+                                                   radio_params.tx.lora.pbl_len_in_symb );
+    }
+    // the FSK time on air is not computed, assume a long one
+    radio_params.reg_mode =
+        ( lr1_mac->tx_modulation_type == LORA ) ? radio_reg_mode_get( toa_ms ) : RAL_REG_MODE_DCDC;
 
     rp_task.hook_id          = my_hook_id;
-    rp_task.duration_time_ms = 2000;
+    rp_task.duration_time_ms = ( toa_ms != 0 ) ? toa_ms : 2000;
     rp_task.type             = ( lr1_mac->tx_modulation_type == LORA ) ? RP_TASK_TYPE_TX_LORA : RP_TASK_TYPE_TX_FSK;
     rp_task.start_time_ms    = lr1_mac->rtc_target_timer_ms;
 
@@ -290,19 +683,35 @@ void lr1_stack_mac_tx_radio_start( lr1_stack_mac_t* lr1_mac )
         lr1_mac->send_at_time = false;  // reinit the flag
         rp_task.state         = RP_TASK_STATE_SCHEDULE;
     }
+    else if( lr1_mac->tx_preempt == true )
+    {  // a scheduled task is served before the asap ones and aborts them, it must not start in the past
+        uint32_t start_min_ms = bsp_rtc_get_time_ms( ) + LR1MAC_TX_SCHEDULE_MARGIN_MS;
+        if( ( int32_t )( rp_task.start_time_ms - start_min_ms ) < 0 )
+        {
+            rp_task.start_time_ms = start_min_ms;
+        }
+        rp_task.state = RP_TASK_STATE_SCHEDULE;
+    }
+    else if( ( lr1_mac->tx_scheduled == true ) &&
+             ( ( int32_t )( rp_task.start_time_ms - bsp_rtc_get_time_ms( ) ) > LR1MAC_TX_SCHEDULE_MARGIN_MS ) )
+    {  // the retransmission waits in the radio planner for its date, and for the radio if it is busy then
+        rp_task.state          = RP_TASK_STATE_SCHEDULE;
+        rp_task.preempt_policy = RP_TASK_PREEMPT_DEFER;
+    }
     else
-    {
-        rp_task.state = RP_TASK_STATE_ASAP;
+    {  // an asap uplink has no time constraint: it waits for the radio instead of being aborted
+        rp_task.state          = RP_TASK_STATE_ASAP;
+        rp_task.preempt_policy = RP_TASK_PREEMPT_DEFER;
     }
 
-    if( rp_task_enqueue( lr1_mac->rp, &rp_task, lr1_mac->tx_payload, lr1_mac->tx_payload_size, &radio_params ) ==
-        RP_HOOK_STATUS_OK )
+    if( rp_task_enqueue( lr1_mac->rp, &rp_task, &lr1_mac->tx_payload[lr1_mac->tx_frame_offset],
+                         lr1_mac->tx_payload_size, &radio_params ) == RP_HOOK_STATUS_OK )
     {
         if( radio_params.pkt_type == RAL_PKT_TYPE_LORA )
         {
             BSP_DBG_TRACE_PRINTF( "  Tx  LoRa at %u ms: freq:%lu, SF%u, %s, len %u bytes %d dBm\n",
                                   rp_task.start_time_ms, lr1_mac->tx_frequency, lr1_mac->tx_sf, name_bw[lr1_mac->tx_bw],
-                                  lr1_mac->tx_payload_size, lr1_mac->tx_power + lr1_mac->tx_power_offset );
+                                  lr1_mac->tx_payload_size, tx_power_get( lr1_mac ) + lr1_mac->tx_power_offset );
         }
         else if( radio_params.pkt_type == RAL_PKT_TYPE_GFSK )
         {
@@ -330,87 +739,7 @@ void lr1_stack_mac_rx_radio_start( lr1_stack_mac_t* lr1_mac, const rx_win_type_t
 {
     rp_radio_params_t radio_params = { 0 };
 
-    if( ( ( type == RX1 ) && ( lr1_mac->rx1_modulation_type == LORA ) ) ||
-        ( ( type == RX2 ) && ( lr1_mac->rx2_modulation_type == LORA ) ) )
-    {
-        radio_params.pkt_type                 = RAL_PKT_TYPE_LORA;
-        radio_params.rx.lora.cr               = smtc_real_coding_rate_get( lr1_mac );
-        radio_params.rx.lora.sync_word        = smtc_real_sync_word_get( lr1_mac );
-        radio_params.rx.lora.crc_is_on        = false;
-        radio_params.rx.lora.invert_iq_is_on  = true;
-        radio_params.rx.lora.pld_is_fix       = false;
-        radio_params.rx.lora.pld_len_in_bytes = 255;
-        radio_params.rx.lora.symb_nb_timeout  = lr1_mac->rx_window_symb;
-#if defined( SX1280 )
-        radio_params.rx.timeout_in_ms = MAX( lr1_mac->rx_timeout_ms, BSP_MIN_RX_TIMEOUT_DELAY_MS );
-#elif defined( SX126X )
-        radio_params.rx.timeout_in_ms = 3000;
-#else
-#error "Please select radio board.."
-#endif
-
-        switch( type )
-        {
-        case RX1:
-            radio_params.rx.lora.sf         = ( ral_lora_sf_t ) lr1_mac->rx1_sf;
-            radio_params.rx.lora.bw         = ( ral_lora_bw_t ) lr1_mac->rx1_bw;
-            radio_params.rx.lora.freq_in_hz = lr1_mac->rx1_frequency;
-            break;
-
-        case RX2:
-            radio_params.rx.lora.sf         = ( ral_lora_sf_t ) lr1_mac->rx2_sf;
-            radio_params.rx.lora.bw         = ( ral_lora_bw_t ) lr1_mac->rx2_bw;
-            radio_params.rx.lora.freq_in_hz = lr1_mac->rx2_frequency;
-            break;
-
-        default:
-            BSP_DBG_TRACE_ERROR( " RX windows unknow \n" );
-            bsp_mcu_handle_lr1mac_issue( );
-            break;
-        }
-        radio_params.rx.lora.pbl_len_in_symb = smtc_real_preamble_get( lr1_mac, radio_params.rx.lora.sf );
-    }
-    else if( ( ( type == RX1 ) && ( lr1_mac->rx1_modulation_type == FSK ) ) ||
-             ( ( type == RX2 ) && ( lr1_mac->rx2_modulation_type == FSK ) ) )
-    {
-        radio_params.pkt_type                       = RAL_PKT_TYPE_GFSK;
-        radio_params.rx.gfsk.pbl_len_in_bytes       = 5;
-        radio_params.rx.gfsk.sync_word_len_in_bytes = 3;
-        radio_params.rx.gfsk.sync_word              = smtc_real_gfsk_sync_word_get( lr1_mac );
-        radio_params.rx.gfsk.pld_is_fix             = false;
-        radio_params.rx.gfsk.pld_len_in_bytes       = 255;
-        radio_params.rx.gfsk.dc_free_is_on          = true;
-        radio_params.rx.gfsk.whitening_seed         = GFSK_WHITENING_SEED;
-        radio_params.rx.gfsk.crc_type               = RAL_GFSK_CRC_2_BYTES_INV;
-        radio_params.rx.gfsk.crc_seed               = GFSK_CRC_SEED;
-        radio_params.rx.gfsk.crc_polynomial         = GFSK_CRC_POLYNOMIAL;
-        radio_params.rx.timeout_in_ms               = lr1_mac->rx_timeout_ms;
-
-        switch( type )
-        {
-        case RX1:
-            radio_params.rx.gfsk.freq_in_hz   = lr1_mac->rx1_frequency;
-            radio_params.rx.gfsk.br_in_bps    = lr1_mac->rx1_sf * 1000;
-            radio_params.rx.gfsk.bw_ssb_in_hz = lr1_mac->rx1_sf * 1000;
-            break;
-
-        case RX2:
-            radio_params.rx.gfsk.freq_in_hz   = lr1_mac->rx2_frequency;
-            radio_params.rx.gfsk.br_in_bps    = lr1_mac->rx2_sf * 1000;
-            radio_params.rx.gfsk.bw_ssb_in_hz = lr1_mac->rx2_sf * 1000;
-            break;
-
-        default:
-            BSP_DBG_TRACE_ERROR( " RX windows unknow \n" );
-            bsp_mcu_handle_lr1mac_issue( );
-            break;
-        }
-    }
-    else
-    {
-        BSP_DBG_TRACE_ERROR( " MODULATION NOT SUPPORTED\n" );
-        bsp_mcu_handle_lr1mac_issue( );
-    }
+    rx_radio_params_build( lr1_mac, type, &radio_params );
 
     uint8_t my_hook_id;
     if( rp_hook_get_id( lr1_mac->rp, lr1_mac, &my_hook_id ) != RP_HOOK_STATUS_OK )
@@ -457,6 +786,7 @@ int lr1_stack_mac_downlink_check_under_it( lr1_stack_mac_t* lr1_mac )
 
     valid_dev_addr_t is_valid_dev_addr = UNVALID_DEV_ADDR;
 
+    lr1_mac->rx_mic_is_deferred = false;
     // check Mtype
     uint8_t rx_mtype_tmp = lr1_mac->rx_payload[0] >> 5;
     if( ( rx_mtype_tmp == JOIN_REQUEST ) || ( rx_mtype_tmp == UNCONF_DATA_UP ) || ( rx_mtype_tmp == CONF_DATA_UP ) ||
@@ -477,6 +807,26 @@ int lr1_stack_mac_downlink_check_under_it( lr1_stack_mac_t* lr1_mac )
             status += ERRORLORAWAN;
             BSP_DBG_TRACE_INFO( " BAD DevAddr = %lx for RX Frame and %lx \n \n", lr1_mac->dev_addr, dev_addr_tmp );
         }
+#if( BSP_LR1MAC_EARLY_DOWNLINK_CHECK == 1 )
+        // a single CMAC under interrupt: the next MSB values of the counter are tried by
+        // lr1_stack_mac_rx_mic_deferred_check, the frame is kept for it. The multicast keys are only expanded at
+        // thread level, the MIC of a group frame is fully left to it
+        if( ( status == OKLORAWAN ) && ( multicast_group_get( lr1_mac, is_valid_dev_addr ) != NULL ) )
+        {
+            lr1_mac->rx_mic_is_deferred = true;
+        }
+        else if( ( status == OKLORAWAN ) && ( downlink_mic_check( lr1_mac, is_valid_dev_addr, 1 ) != OKLORAWAN ) )
+        {
+            if( ( lr1_mac->rx_payload_size >= MIN_LORAWAN_PAYLOAD_SIZE ) && ( LR1MAC_FCNT_DWN_MSB_CANDIDATES > 1 ) )
+            {
+                lr1_mac->rx_mic_is_deferred = true;
+            }
+            else
+            {
+                status += ERRORLORAWAN;
+            }
+        }
+#endif
         if( status != OKLORAWAN )
         {
             lr1_mac->rx_payload_size = 0;
@@ -490,13 +840,39 @@ int lr1_stack_mac_downlink_check_under_it( lr1_stack_mac_t* lr1_mac )
     return ( status );
 }
 
+int lr1_stack_mac_rx_mic_deferred_check( lr1_stack_mac_t* lr1_mac )
+{
+#if( BSP_LR1MAC_EARLY_DOWNLINK_CHECK == 1 )
+    if( lr1_mac->rx_mic_is_deferred == true )
+    {
+        const uint32_t dev_addr = lr1_mac->rx_payload[1] + ( lr1_mac->rx_payload[2] << 8 ) +
+                                  ( lr1_mac->rx_payload[3] << 16 ) + ( lr1_mac->rx_payload[4] << 24 );
+
+        lr1_mac->rx_mic_is_deferred = false;
+        if( downlink_mic_check( lr1_mac, check_dev_addr( lr1_mac, dev_addr ), LR1MAC_FCNT_DWN_MSB_CANDIDATES ) !=
+            OKLORAWAN )
+        {
+            lr1_mac->rx_payload_size = 0;
+            return ERRORLORAWAN;
+        }
+    }
+#endif
+    return OKLORAWAN;
+}
+
+bool lr1_stack_mac_rx_filter( lr1_stack_mac_t* lr1_mac, const uint8_t* header, uint8_t header_size )
+{
+    return rx_header_is_for_device( lr1_mac, header );
+}
+
 void lr1_stack_mac_rp_callback( lr1_stack_mac_t* lr1_mac )
 {
     int      status = OKLORAWAN;
     uint32_t tcurrent_ms;
+    uint32_t tcurrent_us;
     uint8_t  my_hook_id;
     rp_hook_get_id( lr1_mac->rp, lr1_mac, &my_hook_id );
-    rp_get_status( lr1_mac->rp, my_hook_id, &tcurrent_ms, &( lr1_mac->planner_status ) );
+    rp_get_status( lr1_mac->rp, my_hook_id, &tcurrent_ms, &tcurrent_us, &( lr1_mac->planner_status ) );
 
     switch( lr1_mac->planner_status )
     {
@@ -513,7 +889,7 @@ void lr1_stack_mac_rp_callback( lr1_stack_mac_t* lr1_mac )
         status = lr1_stack_mac_downlink_check_under_it( lr1_mac );
         if( status != OKLORAWAN )
         {  // Case receive a packet but it isn't a valid packet
-            tcurrent_ms = bsp_rtc_get_time_ms( );
+            tcurrent_us = ( uint32_t ) bsp_rtc_get_time_us( );
             BSP_DBG_TRACE_MSG( "Receive a packet But rejected and too late to restart\n" );
             lr1_mac->planner_status = RP_STATUS_RX_TIMEOUT;
         }
@@ -522,25 +898,53 @@ void lr1_stack_mac_rp_callback( lr1_stack_mac_t* lr1_mac )
     case RP_STATUS_RX_TIMEOUT:
         break;
 
+    case RP_STATUS_CAD_POSITIVE:
+    case RP_STATUS_CAD_NEGATIVE:
+        break;
+
     default:
         BSP_DBG_TRACE_PRINTF( "receive It RADIO error %u\n", lr1_mac->planner_status );
-        tcurrent_ms = bsp_rtc_get_time_ms( );
+        tcurrent_us = ( uint32_t ) bsp_rtc_get_time_us( );
         break;
     }
 
     switch( lr1_mac->radio_process_state )
     {
     case RADIOSTATE_TXON:
-        lr1_mac->isr_radio_timestamp = tcurrent_ms;  //@info Timestamp only on txdone it
-        lr1_mac->radio_process_state = RADIOSTATE_TXFINISHED;
+        lr1_mac->isr_radio_timestamp_us = tcurrent_us;  //@info Timestamp only on txdone it
+        lr1_mac->radio_process_state    = RADIOSTATE_TXFINISHED;
         break;
 
     case RADIOSTATE_TXFINISHED:
         lr1_mac->radio_process_state = RADIOSTATE_RX1FINISHED;
+        if( lr1_mac->planner_status == RP_STATUS_RX_PACKET )
+        {
+            rx_drift_update( lr1_mac, RX1, tcurrent_us );
+        }
+#if( BSP_LR1MAC_EARLY_DOWNLINK_CHECK == 1 )
+        // Nothing valid for us in RX1: open RX2 now instead of waiting for the next lr1mac process call
+        if( lr1_mac->planner_status != RP_STATUS_RX_PACKET )
+        {
+            lr1_mac->rx2_started_under_it = true;
+            lr1_stack_mac_rx_timer_configure( lr1_mac, RX2 );
+        }
+#endif
         break;
 
     case RADIOSTATE_RX1FINISHED:
         lr1_mac->radio_process_state = RADIOSTATE_IDLE;
+        if( lr1_mac->planner_status == RP_STATUS_RX_PACKET )
+        {
+            rx_drift_update( lr1_mac, RX2, tcurrent_us );
+        }
+        else
+        {
+            rx_drift_miss( lr1_mac );
+        }
+        break;
+
+    case RADIOSTATE_CADON:
+        lbt_cad_done( lr1_mac );
         break;
 
     default:
@@ -548,6 +952,10 @@ void lr1_stack_mac_rp_callback( lr1_stack_mac_t* lr1_mac )
         bsp_mcu_handle_lr1mac_issue( );
         break;
     }
+
+    // wake up the main loop so the new radio state is processed without waiting for the sleep to expire
+    lr1_mac->process_event_pending = true;
+    bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_RADIO );
 }
 
 int lr1_stack_mac_radio_state_get( lr1_stack_mac_t* lr1_mac )
@@ -557,7 +965,7 @@ int lr1_stack_mac_radio_state_get( lr1_stack_mac_t* lr1_mac )
 
 void lr1_stack_mac_rx_timer_configure( lr1_stack_mac_t* lr1_mac, const rx_win_type_t type )
 {
-    const uint32_t    tcurrent_ms = bsp_rtc_get_time_ms( );
+    const uint32_t    tcurrent_us = ( uint32_t ) bsp_rtc_get_time_us( );
     bool              is_type_ok  = true;
     ral_lora_sf_t     sf;
     ral_lora_bw_t     bw;
@@ -591,13 +999,16 @@ void lr1_stack_mac_rx_timer_configure( lr1_stack_mac_t* lr1_mac, const rx_win_ty
 
     if( is_type_ok == true )
     {
-        compute_rx_window_parameters( lr1_mac, ( uint8_t ) sf, ( lr1mac_bandwidth_t ) bw, BSP_CRYSTAL_ERROR, delay_ms,
-                                      BSP_BOARD_DELAY_RX_SETTING_MS, mod_type );
+        compute_rx_window_parameters( lr1_mac, sf, bw, BSP_CRYSTAL_ERROR, delay_ms, BSP_BOARD_DELAY_RX_SETTING_MS,
+                                      mod_type );
 
-        uint32_t talarm_ms = delay_ms + lr1_mac->isr_radio_timestamp - tcurrent_ms;
+        // placed from the us timestamp of the Tx done IRQ, the ms timestamps would add up to 2 ms of jitter
+        const int32_t talarm_us = ( int32_t )( ( delay_ms * 1000 ) + lr1_mac->isr_radio_timestamp_us - tcurrent_us );
+        uint32_t      talarm_ms = ( uint32_t )( talarm_us / 1000 );
         if( ( int32_t )( talarm_ms - lr1_mac->rx_offset_ms ) < 0 )
         {
-            // too late to launch a timer
+            // too late to launch a timer, the window is closed without any radio event
+            lr1_mac->process_event_pending = true;
             switch( type )
             {
             case RX1:
@@ -627,6 +1038,9 @@ rx_packet_type_t lr1_stack_mac_rx_frame_decode( lr1_stack_mac_t* lr1_mac )
     int              status         = OKLORAWAN;
     rx_packet_type_t rx_packet_type = NO_MORE_VALID_RX_PACKET;
     uint32_t         mic_in;
+    uint32_t         rx_dev_addr    = lr1_mac->rx_payload[1] + ( lr1_mac->rx_payload[2] << 8 ) +
+                                      ( lr1_mac->rx_payload[3] << 16 ) + ( lr1_mac->rx_payload[4] << 24 );
+    lr1_stack_mac_multicast_t* mc_group = multicast_group_get( lr1_mac, check_dev_addr( lr1_mac, rx_dev_addr ) );
     status += rx_payload_size_check( lr1_mac );
     status += rx_mhdr_extract( lr1_mac );
     /************************************************************************/
@@ -634,17 +1048,28 @@ rx_packet_type_t lr1_stack_mac_rx_frame_decode( lr1_stack_mac_t* lr1_mac )
     /************************************************************************/
     if( lr1_mac->rx_mtype == JOIN_ACCEPT )
     {
-        join_decrypt( &lr1_mac->rx_payload[1], lr1_mac->rx_payload_size - 1, lr1_mac->app_key,
-                      &lr1_mac->rx_payload[1] );
+        lora_crypto_keyed_join_decrypt( &lr1_mac->crypto_ctx, &lr1_mac->rx_payload[1], lr1_mac->rx_payload_size - 1,
+                                        &lr1_mac->app_key_ctx, &lr1_mac->rx_payload[1] );
         lr1_mac->rx_payload_size = lr1_mac->rx_payload_size - MICSIZE;
         memcpy( ( uint8_t* ) &mic_in, &lr1_mac->rx_payload[lr1_mac->rx_payload_size], MICSIZE );
-        status += check_join_mic( lr1_mac->rx_payload, lr1_mac->rx_payload_size, lr1_mac->app_key, mic_in );
+        status += lora_crypto_keyed_check_join_mic( &lr1_mac->crypto_ctx, lr1_mac->rx_payload,
+                                                    lr1_mac->rx_payload_size, &lr1_mac->app_key_ctx, mic_in );
         BSP_DBG_TRACE_PRINTF( " status = %d\n", status );
         if( status == OKLORAWAN )
-        {
+        {  // the session keys are derived at rx done, with the app_key schedule the accept was just checked with
+            lora_crypto_keyed_join_compute_skeys( &lr1_mac->crypto_ctx, &lr1_mac->app_key_ctx, &lr1_mac->rx_payload[1],
+                                                  lr1_mac->dev_nonce, lr1_mac->nwk_skey, lr1_mac->app_skey );
+            lr1_stack_mac_session_keys_expand( lr1_mac );
             return JOIN_ACCEPT_PACKET;
         }
     }
+    else if( mc_group != NULL )
+    {
+        if( status == OKLORAWAN )
+        {
+            rx_packet_type = multicast_rx_frame_decode( lr1_mac, mc_group );
+        }
+    }
     else
     {
         /************************************************************************/
@@ -654,18 +1079,27 @@ rx_packet_type_t lr1_stack_mac_rx_frame_decode( lr1_stack_mac_t* lr1_mac )
         status += rx_fhdr_extract( lr1_mac, &fcnt_dwn_tmp, lr1_mac->dev_addr );
         if( status == OKLORAWAN )
         {
-            status = fcnt_dwn_accept( fcnt_dwn_tmp, &lr1_mac->fcnt_dwn );
-        }
-        if( status == OKLORAWAN )
-        {
+            // the counter only moves on an authenticated frame, a forged one can't block the downlinks
             lr1_mac->rx_payload_size = lr1_mac->rx_payload_size - MICSIZE;
             memcpy( ( uint8_t* ) &mic_in, &lr1_mac->rx_payload[lr1_mac->rx_payload_size], MICSIZE );
-            status += check_mic( &lr1_mac->rx_payload[0], lr1_mac->rx_payload_size, lr1_mac->nwk_skey,
-                                 lr1_mac->dev_addr, lr1_mac->fcnt_dwn, mic_in );
+            status = fcnt_dwn_mic_check( lr1_mac, &lr1_mac->nwk_skey_ctx, lr1_mac->dev_addr, fcnt_dwn_tmp,
+                                         lr1_mac->rx_payload_size, mic_in, LR1MAC_FCNT_DWN_MSB_CANDIDATES,
+                                         &lr1_mac->fcnt_dwn );
         }
         if( status == OKLORAWAN )
         {
+            if( lr1_stack_mac_session_is_kept( lr1_mac ) )
+            {  // journaled before the frame is used: after a reset, the frames up to this one are replays
+                lr1_stack_mac_fcnt_save( lr1_mac );
+            }
             lr1_mac->adr_ack_cnt                 = 0;  // reset adr counter, receive a valid frame.
+            link_margin_sample_add( lr1_mac, lr1_mac->rx_snr );  // the gateway power doesn't depend on ours
+            if( lr1_mac->link_check.state == LR1MAC_LINK_STATE_LOST )
+            {  // the network hears the device again, the next LinkCheckAns rates the link
+                lr1_mac->link_check.miss_cnt = 0;
+                lr1_mac->link_check.state    = LR1MAC_LINK_STATE_WEAK;
+            }
+            tx_power_ctrl_update( lr1_mac );
             lr1_mac->adr_ack_cnt_confirmed_frame = 0;  // reset adr counter i, case of confirmed frame
             lr1_mac->tx_fopts_lengthsticky       = 0;  // reset the fopts of the sticky cmd receive a valide frame
                                                        // if received on RX1 or RX2
@@ -680,6 +1114,7 @@ rx_packet_type_t lr1_stack_mac_rx_frame_decode( lr1_stack_mac_t* lr1_mac )
             {
                 lr1_mac->rx_ack_bit = 1;
             }
+            lr1_mac->rx_fpending_bit = ( lr1_mac->rx_fctrl & 0x10 ) >> 4;
 
             if( lr1_mac->rx_payload_empty == 0 )  // rx payload not empty
             {
@@ -694,8 +1129,11 @@ rx_packet_type_t lr1_stack_mac_rx_frame_decode( lr1_stack_mac_t* lr1_mac )
                 {  // receive a mac management frame without fopts
                     if( lr1_mac->rx_fopts_length == 0 )
                     {
-                        payload_decrypt( &lr1_mac->rx_payload[FHDROFFSET], lr1_mac->rx_payload_size, lr1_mac->nwk_skey,
-                                         lr1_mac->dev_addr, 1, lr1_mac->fcnt_dwn, &lr1_mac->nwk_payload[0] );
+                        // decrypted in place, nwk_payload is the start of rx_payload
+                        lora_crypto_keyed_payload_decrypt( &lr1_mac->crypto_ctx, &lr1_mac->rx_payload[FHDROFFSET],
+                                                           lr1_mac->rx_payload_size, &lr1_mac->nwk_skey_ctx,
+                                                           lr1_mac->dev_addr, 1, lr1_mac->fcnt_dwn,
+                                                           &lr1_mac->nwk_payload[0] );
                         lr1_mac->nwk_payload_size = lr1_mac->rx_payload_size;
                         rx_packet_type            = NWKRXPACKET;
                     }
@@ -712,16 +1150,18 @@ rx_packet_type_t lr1_stack_mac_rx_frame_decode( lr1_stack_mac_t* lr1_mac )
                 */
                 else
                 {
-                    payload_decrypt( &lr1_mac->rx_payload[FHDROFFSET + lr1_mac->rx_fopts_length],
-                                     lr1_mac->rx_payload_size, lr1_mac->app_skey, lr1_mac->dev_addr, 1,
-                                     lr1_mac->fcnt_dwn, &lr1_mac->rx_payload[0] );
+                    // decrypted straight in the fifo entry the application will read it from
+                    lora_crypto_keyed_payload_decrypt(
+                        &lr1_mac->crypto_ctx, &lr1_mac->rx_payload[FHDROFFSET + lr1_mac->rx_fopts_length],
+                        lr1_mac->rx_payload_size, &lr1_mac->app_skey_ctx, lr1_mac->dev_addr, 1, lr1_mac->fcnt_dwn,
+                        downlink_tail_get( lr1_mac )->payload );
                     if( lr1_mac->rx_fopts_length != 0 )
                     {
                         memcpy( lr1_mac->nwk_payload, lr1_mac->rx_fopts, lr1_mac->rx_fopts_length );
                         lr1_mac->nwk_payload_size = lr1_mac->rx_fopts_length;
                         rx_packet_type            = USERRX_FOPTSPACKET;
                     }
-                    lr1_mac->available_app_packet = LORA_RX_PACKET_AVAILABLE;
+                    downlink_push( lr1_mac );
                 }
             }
             /*
@@ -755,14 +1195,14 @@ void lr1_stack_mac_update( lr1_stack_mac_t* lr1_mac )
     {
         // get current timestamp to check with duty cycle will be applied
         uint32_t current_time_s = bsp_rtc_get_time_s( );
+        uint32_t duty_cycle_s;
 
         lr1_mac->retry_join_cpt++;
 
         if( current_time_s < ( lr1_mac->first_join_timestamp + 3600 ) )
         {
             // during first hour after first join try => duty cycle of 1/100 ie 36s over 1 hour
-            lr1_mac->next_time_to_join_seconds =
-                current_time_s + ( ( smtc_real_get_join_sf5_toa_in_ms( lr1_mac ) << ( lr1_mac->tx_sf - 5 ) ) ) / 10;
+            duty_cycle_s = ( ( smtc_real_get_join_sf5_toa_in_ms( lr1_mac ) << ( lr1_mac->tx_sf - 5 ) ) ) / 10;
             // ts=cur_ts+(toa_s*100) = cur_ts + (toa_ms / 1000) * 100 = cur_ts + toa_ms/10
             // toa_ms is evaluated using the current sf and the theoretical value of a join @sf5. This method is very
             // conservative as the multiplication by 2^sf gives always an overvalued timing
@@ -770,8 +1210,7 @@ void lr1_stack_mac_update( lr1_stack_mac_t* lr1_mac )
         else if( current_time_s < ( lr1_mac->first_join_timestamp + 36000 + 3600 ) )
         {
             // during the 10 hours following first hour after first join try =>duty cycle of 1/1000 ie 36s over 10 hours
-            lr1_mac->next_time_to_join_seconds =
-                current_time_s + ( ( smtc_real_get_join_sf5_toa_in_ms( lr1_mac ) << ( lr1_mac->tx_sf - 5 ) ) );
+            duty_cycle_s = ( ( smtc_real_get_join_sf5_toa_in_ms( lr1_mac ) << ( lr1_mac->tx_sf - 5 ) ) );
             // ts=cur_ts+(toa_s*1000) = cur_ts + (toa_ms / 1000) * 1000 = cur_ts + toa_ms
             // toa_ms is evaluated using the current sf and the theoretical value of a join @sf5. This method is very
             // conservative as the multiplication by 2^sf gives always an overvalued timing
@@ -779,12 +1218,19 @@ void lr1_stack_mac_update( lr1_stack_mac_t* lr1_mac )
         else
         {
             // Following the first 11 hours after first join try => duty cycle of 1/10000 ie 8.7s over 24 hours
-            lr1_mac->next_time_to_join_seconds =
-                current_time_s + ( ( smtc_real_get_join_sf5_toa_in_ms( lr1_mac ) << ( lr1_mac->tx_sf - 5 ) ) ) * 10;
+            duty_cycle_s = ( ( smtc_real_get_join_sf5_toa_in_ms( lr1_mac ) << ( lr1_mac->tx_sf - 5 ) ) ) * 10;
             // ts=cur_ts+(toa_s*10000) = cur_ts + (toa_ms / 1000) * 10000 = cur_ts + toa_ms*10
             // toa_ms is evaluated using the current sf and the theoretical value of a join @sf5. This method is very
             // conservative as the multiplication by 2^sf gives always an overvalued timing
         }
+        // the duty cycle is the retry budget, the back-off only spreads the retries beyond it
+        lr1_mac->next_time_to_join_seconds =
+            current_time_s + MAX( duty_cycle_s, join_backoff_s_get( lr1_mac->retry_join_cpt ) );
+        if( lr1_mac->retry_join_cpt <= ( JOIN_BACKOFF_MAX_EXPONENT + 1 ) )
+        {  // the back-off grows until its max exponent, a reset resumes it from there
+            lr1_mac->is_join_pending = true;
+            lr1_stack_mac_join_context_save( lr1_mac );
+        }
     }
     else
     {
@@ -794,7 +1240,8 @@ void lr1_stack_mac_update( lr1_stack_mac_t* lr1_mac )
     if( ( lr1_mac->adr_ack_cnt >= lr1_mac->adr_ack_limit ) &&
         ( lr1_mac->adr_ack_cnt <= ( lr1_mac->adr_ack_limit + lr1_mac->adr_ack_delay ) ) )
     {
-        lr1_mac->adr_ack_req = 1;
+        lr1_mac->adr_ack_req            = 1;
+        lr1_mac->tx_power_ctrl.is_known = false;  // no downlink for a while, the path loss is not known anymore
     }
 
     if( ( lr1_mac->adr_ack_cnt < lr1_mac->adr_ack_limit ) ||
@@ -825,29 +1272,30 @@ void lr1_stack_mac_update( lr1_stack_mac_t* lr1_mac )
     }
     if( lr1_mac->nb_trans_cpt <= 1 )
     {  // could also be set to 1 if receive valid ans
-        lr1_mac->fcnt_up++;
+        lr1_stack_mac_fcnt_up_increment( lr1_mac );
         lr1_mac->nb_trans_cpt = 1;  // error case shouldn't exist
     }
     else
     {
         lr1_mac->type_of_ans_to_send = USRFRAME_TORETRANSMIT;
+        lr1_mac->tx_fcnt_up_is_used  = true;
         lr1_mac->nb_trans_cpt--;
     }
 
-    if( ( lr1_mac->tx_fopts_length + lr1_mac->tx_fopts_lengthsticky ) > 15 )
+    if( tx_fopts_current_set( lr1_mac ) == false )
     {
+        // the frame to retransmit is given up for the answers, they are built in place of its payload
+        uint8_t* nwk_ans = &lr1_mac->tx_payload[LR1MAC_TX_PAYLOAD_OFFSET];
+
+        if( lr1_mac->type_of_ans_to_send == USRFRAME_TORETRANSMIT )
+        {  // its counter went on air, the answers are encrypted with the next one
+            lr1_stack_mac_fcnt_up_increment( lr1_mac );
+        }
         lr1_mac->nwk_ans_size = lr1_mac->tx_fopts_lengthsticky + lr1_mac->tx_fopts_length;
-        memcpy( lr1_mac->nwk_ans, lr1_mac->tx_fopts_datasticky, lr1_mac->tx_fopts_lengthsticky );
-        memcpy( lr1_mac->nwk_ans + lr1_mac->tx_fopts_lengthsticky, lr1_mac->tx_fopts_data, lr1_mac->tx_fopts_length );
+        memcpy( nwk_ans, lr1_mac->tx_fopts_datasticky, lr1_mac->tx_fopts_lengthsticky );
+        memcpy( nwk_ans + lr1_mac->tx_fopts_lengthsticky, lr1_mac->tx_fopts_data, lr1_mac->tx_fopts_length );
         lr1_mac->type_of_ans_to_send = NWKFRAME_TOSEND;
     }
-    else
-    {
-        lr1_mac->tx_fopts_current_length = lr1_mac->tx_fopts_lengthsticky + lr1_mac->tx_fopts_length;
-        memcpy( lr1_mac->tx_fopts_current_data, lr1_mac->tx_fopts_datasticky, lr1_mac->tx_fopts_lengthsticky );
-        memcpy( lr1_mac->tx_fopts_current_data + lr1_mac->tx_fopts_lengthsticky, lr1_mac->tx_fopts_data,
-                lr1_mac->tx_fopts_length );
-    }
     lr1_mac->tx_fopts_length = 0;
 
     switch( lr1_mac->type_of_ans_to_send )
@@ -858,14 +1306,14 @@ void lr1_stack_mac_update( lr1_stack_mac_t* lr1_mac )
     case NWKFRAME_TOSEND: {
         status_lorawan_t status;
 
+        lr1_stack_mac_nwk_ans_dr_set( lr1_mac );
         status = smtc_real_is_valid_size( lr1_mac, lr1_mac->tx_data_rate, lr1_mac->nwk_ans_size );
         if( status != OKLORAWAN )
         {
             lr1_mac->nwk_ans_size =
-                lr1_stack_mac_cmd_ans_cut( lr1_mac->nwk_ans, lr1_mac->nwk_ans_size,
+                lr1_stack_mac_cmd_ans_cut( &lr1_mac->tx_payload[LR1MAC_TX_PAYLOAD_OFFSET], lr1_mac->nwk_ans_size,
                                            smtc_real_max_payload_size_get( lr1_mac, lr1_mac->tx_data_rate ) );
         }
-        memcpy( &lr1_mac->tx_payload[FHDROFFSET], lr1_mac->nwk_ans, lr1_mac->nwk_ans_size );
         lr1_mac->app_payload_size = lr1_mac->nwk_ans_size;
         lr1_mac->tx_fport         = PORTNWK;
         lr1_mac->tx_mtype         = UNCONF_DATA_UP;  //@note Mtype have to be confirm
@@ -879,111 +1327,569 @@ void lr1_stack_mac_update( lr1_stack_mac_t* lr1_mac )
     }
 }
 
-uint8_t lr1_stack_mac_cmd_ans_cut( uint8_t* nwk_ans, uint8_t nwk_ans_size_in, uint8_t max_allowed_size )
+lr1_stack_mac_downlink_t* lr1_stack_mac_downlink_read( lr1_stack_mac_t* lr1_mac )
 {
-    uint8_t* p_tmp = nwk_ans;
-    uint8_t* p     = nwk_ans;
+    lr1_stack_mac_downlink_fifo_t* fifo = &lr1_mac->downlink_fifo;
 
-    while( p_tmp - nwk_ans < MIN( nwk_ans_size_in, max_allowed_size ) )
+    if( fifo->count == 0 )
     {
-        p_tmp += lr1mac_cmd_mac_ans_size[nwk_ans[p_tmp - nwk_ans]];
-
-        if( ( p_tmp - nwk_ans ) <= max_allowed_size )
-        {
-            p = p_tmp;
-        }
-        else
-        {
-            break;
-        }
+        return NULL;
     }
+    lr1_stack_mac_downlink_t* downlink = &fifo->entries[fifo->head];
 
-    return p - nwk_ans;  // New payload size
+    lr1_mac->rx_snr  = downlink->snr;
+    lr1_mac->rx_rssi = downlink->rssi;
+
+    // the entry leaves the fifo but its slot is only reused once the next downlink is read
+    fifo->head = ( fifo->head + 1 ) % LR1MAC_DOWNLINK_FIFO_DEPTH;
+    fifo->count--;
+    if( fifo->count == 0 )
+    {
+        lr1_mac->available_app_packet = NO_LORA_RXPACKET_AVAILABLE;
+    }
+    return downlink;
 }
 
-status_lorawan_t lr1_stack_mac_cmd_parse( lr1_stack_mac_t* lr1_mac )
+status_lorawan_t lr1_stack_mac_downlink_pop( lr1_stack_mac_t* lr1_mac, uint8_t* fport, uint8_t* payload, uint8_t* size )
+{
+    const lr1_stack_mac_downlink_t* downlink = lr1_stack_mac_downlink_read( lr1_mac );
+
+    if( downlink == NULL )
+    {
+        return ERRORLORAWAN;
+    }
+    *fport = downlink->fport;
+    *size  = downlink->size;
+    memcpy( payload, downlink->payload, downlink->size );
+    return OKLORAWAN;
+}
+
+void lr1_stack_mac_class_c_rx_start( lr1_stack_mac_t* lr1_mac )
+{
+    rp_radio_params_t radio_params = { 0 };
+    uint8_t           my_hook_id;
+
+    if( rp_hook_get_id( lr1_mac->rp, &lr1_mac->class_c, &my_hook_id ) != RP_HOOK_STATUS_OK )
+    {
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    rx_radio_params_build( lr1_mac, RX2, &radio_params );
+    // continuous reception: no symbol timeout and no radio timeout, the planner extends the running rx task
+    radio_params.rx.timeout_in_ms = 0xFFFFFFFF;
+    radio_params.reg_mode         = RAL_REG_MODE_DCDC;
+    if( radio_params.pkt_type == RAL_PKT_TYPE_LORA )
+    {
+        radio_params.rx.lora.symb_nb_timeout = 0;
+    }
+
+    rp_task_t rp_task = {
+        .hook_id          = my_hook_id,
+        .type             = ( radio_params.pkt_type == RAL_PKT_TYPE_LORA ) ? RP_TASK_TYPE_RX_LORA : RP_TASK_TYPE_RX_FSK,
+        .state            = RP_TASK_STATE_ASAP,
+        .start_time_ms    = bsp_rtc_get_time_ms( ),
+        .duration_time_ms = 0,
+        .preempt_policy   = RP_TASK_PREEMPT_ABORT,
+    };
+
+    lr1_mac->class_c.is_running = true;
+    if( rp_task_enqueue( lr1_mac->rp, &rp_task, lr1_mac->class_c.rx_payload, 255, &radio_params ) ==
+        RP_HOOK_STATUS_OK )
+    {
+        BSP_DBG_TRACE_PRINTF( "  RXC freq:%lu\n", lr1_mac->rx2_frequency );
+    }
+    else
+    {
+        lr1_mac->class_c.is_running = false;
+        BSP_DBG_TRACE_PRINTF( "Radio planner hook %d is busy \n", my_hook_id );
+    }
+}
+
+void lr1_stack_mac_class_c_rx_stop( lr1_stack_mac_t* lr1_mac )
+{
+    uint8_t my_hook_id;
+
+    if( rp_hook_get_id( lr1_mac->rp, &lr1_mac->class_c, &my_hook_id ) == RP_HOOK_STATUS_OK )
+    {
+        rp_task_abort( lr1_mac->rp, my_hook_id );
+    }
+    lr1_mac->class_c.is_running = false;
+    lr1_mac->class_c.is_rx_done = false;
+}
+
+void lr1_stack_mac_class_c_rp_callback( lr1_stack_mac_class_c_t* class_c )
+{
+    lr1_stack_mac_t* lr1_mac = class_c->lr1_mac;
+    uint32_t         tcurrent_ms;
+    uint32_t         tcurrent_us;
+    rp_status_t      planner_status;
+    uint8_t          my_hook_id;
+
+    rp_hook_get_id( lr1_mac->rp, class_c, &my_hook_id );
+    rp_get_status( lr1_mac->rp, my_hook_id, &tcurrent_ms, &tcurrent_us, &planner_status );
+
+    // the frame is only checked when decoded: the class A exchange may own rx_payload under it
+    if( planner_status == RP_STATUS_RX_PACKET )
+    {
+        class_c->rx_snr          = lr1_mac->rp->radio_params[my_hook_id].rx.lora_pkt_status.snr_pkt_in_db;
+        class_c->rx_rssi         = lr1_mac->rp->radio_params[my_hook_id].rx.lora_pkt_status.rssi_pkt_in_dbm;
+        class_c->rx_payload_size = ( uint8_t ) lr1_mac->rp->payload_size[my_hook_id];
+        class_c->is_rx_done      = true;
+    }
+    // received, aborted by a class A window or in error, the reception is restarted by the next lr1mac process
+    class_c->is_running = false;
+
+    lr1_mac->process_event_pending = true;
+    bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_RADIO );
+}
+
+bool lr1_stack_mac_class_c_rx_filter( lr1_stack_mac_class_c_t* class_c, const uint8_t* header, uint8_t header_size )
+{
+    return rx_header_is_for_device( class_c->lr1_mac, header );
+}
+
+rx_packet_type_t lr1_stack_mac_class_c_rx_decode( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_stack_mac_class_c_t* class_c = &lr1_mac->class_c;
+
+    class_c->is_rx_done      = false;
+    lr1_mac->rx_snr          = class_c->rx_snr;
+    lr1_mac->rx_rssi         = class_c->rx_rssi;
+    lr1_mac->rx_payload_size = class_c->rx_payload_size;
+    memcpy( lr1_mac->rx_payload, class_c->rx_payload, class_c->rx_payload_size );
+
+    if( lr1_stack_mac_downlink_check_under_it( lr1_mac ) != OKLORAWAN )
+    {
+        return NO_MORE_VALID_RX_PACKET;
+    }
+    return lr1_stack_mac_rx_frame_decode( lr1_mac );
+}
+
+void lr1_stack_mac_class_c_update( lr1_stack_mac_t* lr1_mac )
+{
+    if( tx_fopts_current_set( lr1_mac ) == false )
+    {
+        BSP_DBG_TRACE_WARNING( " RXC mac answers too long for the fopts, not sent\n" );
+    }
+    lr1_mac->tx_fopts_length = 0;
+}
+
+void lr1_stack_mac_class_b_enable_set( lr1_stack_mac_t* lr1_mac, bool enable )
+{
+    lr1_stack_mac_class_b_t* class_b = &lr1_mac->class_b;
+
+    lr1_stack_mac_class_b_stop( lr1_mac );
+    class_b->enabled                = enable;
+    class_b->state                  = ( enable == true ) ? LR1MAC_CLASS_B_STATE_ACQUISITION : LR1MAC_CLASS_B_STATE_OFF;
+    class_b->miss_cnt               = 0;
+    class_b->is_ping_info_requested = enable;
+    class_b->is_ping_info_acked     = false;
+    if( ( enable == true ) && ( lr1_mac->device_time.is_synced == false ) )
+    {
+        lr1_stack_mac_device_time_req( lr1_mac );
+    }
+}
+
+status_lorawan_t lr1_stack_mac_class_b_periodicity_set( lr1_stack_mac_t* lr1_mac, uint8_t periodicity )
+{
+    lr1_stack_mac_class_b_t* class_b = &lr1_mac->class_b;
+
+    if( periodicity > 7 )
+    {
+        return ERRORLORAWAN;
+    }
+    // the ping slots wait for the network to know the new ones
+    class_b->periodicity            = periodicity;
+    class_b->ping_time_s            = 0;
+    class_b->is_ping_info_requested = class_b->enabled;
+    class_b->is_ping_info_acked     = false;
+    return OKLORAWAN;
+}
+
+lr1mac_class_b_state_t lr1_stack_mac_class_b_state_get( const lr1_stack_mac_t* lr1_mac )
+{
+    return lr1_mac->class_b.state;
+}
+
+void lr1_stack_mac_class_b_beacon_start( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_stack_mac_class_b_t*   class_b      = &lr1_mac->class_b;
+    rp_radio_params_t          radio_params = { 0 };
+    smtc_real_class_b_params_t params;
+    const uint32_t             now_ms = bsp_rtc_get_time_ms( );
+    uint64_t                   gps_time_ms;
+    uint32_t                   beacon_ms;
+    uint32_t                   half_window_ms;
+    uint8_t                    my_hook_id;
+
+    if( rp_hook_get_id( lr1_mac->rp, class_b, &my_hook_id ) != RP_HOOK_STATUS_OK )
+    {
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    // network time of now, the RTC drift since the last beacon received doesn't change the beacon period
+    if( class_b->state == LR1MAC_CLASS_B_STATE_TRACKING )
+    {
+        gps_time_ms =
+            ( ( uint64_t ) class_b->anchor_time_s * 1000 ) + ( uint32_t )( now_ms - class_b->anchor_local_ms );
+    }
+    else if( lr1_stack_mac_network_time_get( lr1_mac, &gps_time_ms ) != OKLORAWAN )
+    {
+        lr1_stack_mac_device_time_req( lr1_mac );
+        return;
+    }
+    // the next beacon whose window can still be scheduled
+    uint32_t beacon_time_s = ( uint32_t )( ( gps_time_ms / ( LR1MAC_CLASS_B_BEACON_PERIOD_S * 1000 ) ) + 1 ) *
+                             LR1MAC_CLASS_B_BEACON_PERIOD_S;
+
+    class_b_local_time_get( lr1_mac, ( uint64_t ) beacon_time_s * 1000, &beacon_ms, &half_window_ms );
+    if( ( int32_t )( beacon_ms - half_window_ms - now_ms ) < LR1MAC_CLASS_B_SCHEDULE_MARGIN_MS )
+    {
+        beacon_time_s += LR1MAC_CLASS_B_BEACON_PERIOD_S;
+        class_b_local_time_get( lr1_mac, ( uint64_t ) beacon_time_s * 1000, &beacon_ms, &half_window_ms );
+    }
+    class_b->beacon_time_s = beacon_time_s;
+    class_b_params_get( lr1_mac, beacon_time_s, &params );
+
+    const ral_lora_sf_t sf = ( ral_lora_sf_t ) params.beacon_sf;
+    const ral_lora_bw_t bw = ( ral_lora_bw_t ) params.beacon_bw;
+
+    radio_params.pkt_type                 = RAL_PKT_TYPE_LORA;
+    radio_params.rx.lora.freq_in_hz       = params.beacon_freq_hz;
+    radio_params.rx.lora.sf               = sf;
+    radio_params.rx.lora.bw               = bw;
+    radio_params.rx.lora.cr               = RAL_LORA_CR_4_5;
+    radio_params.rx.lora.pbl_len_in_symb  = LR1MAC_CLASS_B_BEACON_PREAMBLE;
+    radio_params.rx.lora.sync_word        = smtc_real_sync_word_get( lr1_mac );
+    radio_params.rx.lora.crc_is_on        = false;
+    radio_params.rx.lora.invert_iq_is_on  = false;
+    radio_params.rx.lora.pld_is_fix       = true;
+    radio_params.rx.lora.pld_len_in_bytes = params.beacon_size;
+    radio_params.rx.lora.symb_nb_timeout  = 0;
+    // the window is bounded by its timeout, the preamble has to start in it
+    radio_params.rx.timeout_in_ms =
+        ( 2 * half_window_ms ) + ( lr1mac_utilities_get_symb_time_us( LR1MAC_CLASS_B_BEACON_PREAMBLE, sf, bw ) / 1000 );
+    radio_params.reg_mode = radio_reg_mode_get( radio_params.rx.timeout_in_ms );
+    radio_params.lna_mode = radio_lna_mode_get( lr1_mac, sf, bw );
+
+    rp_task_t rp_task = {
+        .hook_id          = my_hook_id,
+        .type             = RP_TASK_TYPE_RX_LORA,
+        .state            = RP_TASK_STATE_SCHEDULE,
+        .start_time_ms    = beacon_ms - half_window_ms,
+        .duration_time_ms = radio_params.rx.timeout_in_ms + class_b_beacon_toa_ms( &params ),
+        .preempt_policy   = RP_TASK_PREEMPT_ABORT,
+    };
+
+    class_b->is_beacon_running  = true;
+    class_b->is_beacon_received = false;
+    if( rp_task_enqueue( lr1_mac->rp, &rp_task, class_b->beacon_payload, LR1MAC_CLASS_B_BEACON_MAX_SIZE,
+                         &radio_params ) == RP_HOOK_STATUS_OK )
+    {
+        BSP_DBG_TRACE_PRINTF( "  Beacon %lu at %u ms +/- %u ms: freq:%lu, SF%u, %s\n", beacon_time_s, beacon_ms,
+                              half_window_ms, params.beacon_freq_hz, sf, name_bw[bw] );
+    }
+    else
+    {
+        class_b->is_beacon_running = false;
+        BSP_DBG_TRACE_PRINTF( "Radio planner hook %d is busy \n", my_hook_id );
+    }
+}
+
+void lr1_stack_mac_class_b_stop( lr1_stack_mac_t* lr1_mac )
+{
+    uint8_t my_hook_id;
+
+    if( rp_hook_get_id( lr1_mac->rp, &lr1_mac->class_b, &my_hook_id ) == RP_HOOK_STATUS_OK )
+    {
+        rp_task_abort( lr1_mac->rp, my_hook_id );
+    }
+    lr1_mac->class_b.is_beacon_running  = false;
+    lr1_mac->class_b.is_beacon_done     = false;
+    lr1_mac->class_b.is_beacon_received = false;
+    // the ping slot is on the class C hook
+    if( lr1_mac->class_c.enabled == false )
+    {
+        lr1_stack_mac_class_c_rx_stop( lr1_mac );
+    }
+}
+
+void lr1_stack_mac_class_b_rp_callback( lr1_stack_mac_class_b_t* class_b )
+{
+    lr1_stack_mac_t* lr1_mac = class_b->lr1_mac;
+    uint32_t         tcurrent_ms;
+    uint32_t         tcurrent_us;
+    rp_status_t      planner_status;
+    uint8_t          my_hook_id;
+
+    rp_hook_get_id( lr1_mac->rp, class_b, &my_hook_id );
+    rp_get_status( lr1_mac->rp, my_hook_id, &tcurrent_ms, &tcurrent_us, &planner_status );
+
+    if( planner_status == RP_STATUS_RX_PACKET )
+    {
+        class_b->beacon_size        = ( uint8_t ) lr1_mac->rp->payload_size[my_hook_id];
+        class_b->beacon_rx_done_ms  = tcurrent_ms;
+        class_b->is_beacon_received = true;
+    }
+    // received, missed or aborted, the beacon is checked and the next window enqueued by the next lr1mac process
+    class_b->is_beacon_done    = true;
+    class_b->is_beacon_running = false;
+
+    lr1_mac->process_event_pending = true;
+    bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_RADIO );
+}
+
+void lr1_stack_mac_class_b_beacon_process( lr1_stack_mac_t* lr1_mac )
 {
-    uint8_t          cmd_identifier;
-    uint8_t          nb_link_adr_req = 0;
-    status_lorawan_t status          = OKLORAWAN;
-    lr1_mac->nwk_payload_index       = 0;
-    lr1_mac->nwk_ans_size            = 0;
-    lr1_mac->tx_fopts_length         = 0;
-    lr1_mac->tx_fopts_lengthsticky   = 0;
+    lr1_stack_mac_class_b_t*   class_b = &lr1_mac->class_b;
+    smtc_real_class_b_params_t params;
+
+    class_b->is_beacon_done = false;
+    class_b_params_get( lr1_mac, class_b->beacon_time_s, &params );
+
+    // the RFU bytes and the beacon time are covered by the first CRC, the gateway specific part is not used
+    const uint8_t* time_field = &class_b->beacon_payload[params.beacon_rfu_size];
+    const uint32_t beacon_time_s =
+        time_field[0] | ( time_field[1] << 8 ) | ( time_field[2] << 16 ) | ( ( uint32_t ) time_field[3] << 24 );
+
+    if( ( class_b->is_beacon_received == true ) && ( class_b->beacon_size == params.beacon_size ) &&
+        ( lr1mac_utilities_crc16( class_b->beacon_payload, params.beacon_rfu_size + 4 ) ==
+          ( time_field[4] | ( time_field[5] << 8 ) ) ) &&
+        ( beacon_time_s == class_b->beacon_time_s ) )
+    {
+        const uint32_t start_ms = class_b->beacon_rx_done_ms - class_b_beacon_toa_ms( &params );
+
+        if( class_b->state == LR1MAC_CLASS_B_STATE_TRACKING )
+        {
+            // drift of the RTC over the beacon periods since the last beacon received, each beacon narrows the
+            // windows until the drift is known to LR1MAC_CLASS_B_DRIFT_MIN_PPM
+            const int32_t elapsed_ms = ( int32_t )( beacon_time_s - class_b->anchor_time_s ) * 1000;
+            const int32_t error_ms   = ( int32_t )( start_ms - class_b->anchor_local_ms ) - elapsed_ms;
 
-    while( lr1_mac->nwk_payload_size > lr1_mac->nwk_payload_index )
-    {  //@note MacNwkPayloadSize and lr1_mac->nwk_payload[0] are updated in
-        // Parser's method
+            const int32_t measured_ppm = ( int32_t )( ( ( int64_t ) error_ms * 1000000 ) / elapsed_ms );
 
-        if( lr1_mac->tx_fopts_length > 200 )
+            class_b->drift_ppm       = ( class_b->drift_ppm + measured_ppm ) / 2;
+            class_b->uncertainty_ppm = MAX( class_b->uncertainty_ppm / 2, LR1MAC_CLASS_B_DRIFT_MIN_PPM );
+        }
+        else
         {
-            BSP_DBG_TRACE_WARNING( "too much cmd in the payload \n" );
-            return ( ERRORLORAWAN );
+            // first beacon: the drift measured by the DeviceTimeAns, within the worst one
+            class_b->drift_ppm =
+                ( lr1_mac->device_time.is_drift_known == true ) ? -( lr1_mac->device_time.drift_ppb / 1000 ) : 0;
+            class_b->uncertainty_ppm = LR1MAC_CLASS_B_DRIFT_MAX_PPM;
+            class_b->state           = LR1MAC_CLASS_B_STATE_TRACKING;
         }
-        cmd_identifier = lr1_mac->nwk_payload[lr1_mac->nwk_payload_index];
-        switch( cmd_identifier )
+        class_b->anchor_time_s   = beacon_time_s;
+        class_b->anchor_local_ms = start_ms;
+        class_b->miss_cnt        = 0;
+        BSP_DBG_TRACE_PRINTF( " Beacon %lu received at %u ms, drift %ld ppm +/- %u ppm\n", beacon_time_s, start_ms,
+                              class_b->drift_ppm, class_b->uncertainty_ppm );
+        return;
+    }
+
+    class_b->is_beacon_received = false;
+    if( class_b->miss_cnt < 0xFF )
+    {
+        class_b->miss_cnt++;
+    }
+    BSP_DBG_TRACE_WARNING( " Beacon %lu missed, %u in a row\n", class_b->beacon_time_s, class_b->miss_cnt );
+    if( class_b->state == LR1MAC_CLASS_B_STATE_TRACKING )
+    {
+        // the ping slots are kept on the last beacon received until the windows grow too wide
+        if( class_b->miss_cnt >= LR1MAC_CLASS_B_BEACON_LOST_NB )
         {
-        case LINK_CHECK_ANS:
+            class_b->state    = LR1MAC_CLASS_B_STATE_ACQUISITION;
+            class_b->miss_cnt = 0;
+        }
+    }
+    else if( ( LR1MAC_CLASS_B_ACQ_WINDOW_MS << MIN( class_b->miss_cnt, 8 ) ) >= LR1MAC_CLASS_B_ACQ_WINDOW_MAX_MS )
+    {
+        // the widest windows missed the beacon too, the network time may be wrong
+        lr1_stack_mac_device_time_req( lr1_mac );
+    }
+}
 
-            link_check_parser( lr1_mac );
-            break;
-        case LINK_ADR_REQ:
-
-            nb_link_adr_req = 0;
-            /* extract the number of multiple link adr req specification in
-             * LoRAWan1.0.2 */
-            while(
-                ( lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + ( nb_link_adr_req * LINK_ADR_REQ_SIZE )] ==
-                  LINK_ADR_REQ ) &&
-                ( lr1_mac->nwk_payload_index + ( nb_link_adr_req * LINK_ADR_REQ_SIZE ) < lr1_mac->nwk_payload_size ) )
-            {
-                nb_link_adr_req++;
-            }
-            link_adr_parser( lr1_mac, nb_link_adr_req );
-            break;
-        case DUTY_CYCLE_REQ:
+void lr1_stack_mac_class_b_ping_start( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_stack_mac_class_b_t*   class_b      = &lr1_mac->class_b;
+    rp_radio_params_t          radio_params = { 0 };
+    smtc_real_class_b_params_t params;
+    uint32_t                   slot_ms;
+    uint32_t                   half_window_ms;
+    uint8_t                    my_hook_id;
 
-            duty_cycle_parser( lr1_mac );  //@note send answer but do nothing
+    if( rp_hook_get_id( lr1_mac->rp, &lr1_mac->class_c, &my_hook_id ) != RP_HOOK_STATUS_OK )
+    {
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    // the beacon period of now, or the next one once its last ping slot is gone
+    uint32_t beacon_time_s =
+        class_b->anchor_time_s + ( ( ( uint32_t )( bsp_rtc_get_time_ms( ) - class_b->anchor_local_ms ) /
+                                     ( LR1MAC_CLASS_B_BEACON_PERIOD_S * 1000 ) ) *
+                                   LR1MAC_CLASS_B_BEACON_PERIOD_S );
+    if( class_b_ping_slot_get( lr1_mac, beacon_time_s, &slot_ms, &half_window_ms ) == false )
+    {
+        // the first slot of a period is always far enough
+        beacon_time_s += LR1MAC_CLASS_B_BEACON_PERIOD_S;
+        class_b_ping_slot_get( lr1_mac, beacon_time_s, &slot_ms, &half_window_ms );
+    }
+    class_b_params_get( lr1_mac, beacon_time_s, &params );
+
+    const ral_lora_sf_t sf = ( ral_lora_sf_t ) params.ping_sf;
+    const ral_lora_bw_t bw = ( ral_lora_bw_t ) params.ping_bw;
+    // the preamble of a frame has to be detected in the window
+    const uint32_t window_us =
+        ( 2000 * half_window_ms ) + lr1mac_utilities_get_symb_time_us( LR1MAC_CLASS_B_PING_MIN_SYMB, sf, bw );
+    const uint32_t window_symb = lr1mac_utilities_get_symb_nb( window_us, sf, bw );
+
+    radio_params.pkt_type                 = RAL_PKT_TYPE_LORA;
+    radio_params.rx.lora.freq_in_hz       = params.ping_freq_hz;
+    radio_params.rx.lora.sf               = sf;
+    radio_params.rx.lora.bw               = bw;
+    radio_params.rx.lora.cr               = smtc_real_coding_rate_get( lr1_mac );
+    radio_params.rx.lora.pbl_len_in_symb  = smtc_real_preamble_get( lr1_mac, params.ping_sf );
+    radio_params.rx.lora.sync_word        = smtc_real_sync_word_get( lr1_mac );
+    radio_params.rx.lora.crc_is_on        = false;
+    radio_params.rx.lora.invert_iq_is_on  = true;
+    radio_params.rx.lora.pld_is_fix       = false;
+    radio_params.rx.lora.pld_len_in_bytes = 255;
+    // a longer window is only bounded by its timeout
+    radio_params.rx.lora.symb_nb_timeout = ( window_symb <= UINT8_MAX ) ? ( uint8_t ) window_symb : 0;
+#if defined( SX1280 )
+    radio_params.rx.timeout_in_ms = MAX( ( window_us / 1000 ) + 1, BSP_MIN_RX_TIMEOUT_DELAY_MS );
+#elif defined( SX126X )
+    radio_params.rx.timeout_in_ms = 3000;
+#else
+#error "Please select radio board.."
+#endif
+    radio_params.reg_mode = radio_reg_mode_get( window_us / 1000 );
+    radio_params.lna_mode = radio_lna_mode_get( lr1_mac, sf, bw );
 
-            break;
-        case RXPARRAM_SETUP_REQ:
+    rp_task_t rp_task = {
+        .hook_id          = my_hook_id,
+        .type             = RP_TASK_TYPE_RX_LORA,
+        .state            = RP_TASK_STATE_SCHEDULE,
+        .start_time_ms    = slot_ms - half_window_ms,
+        .duration_time_ms = ( window_us / 1000 ) + 1,
+        .preempt_policy   = RP_TASK_PREEMPT_ABORT,
+    };
+
+    lr1_mac->class_c.is_running = true;
+    if( rp_task_enqueue( lr1_mac->rp, &rp_task, lr1_mac->class_c.rx_payload, 255, &radio_params ) ==
+        RP_HOOK_STATUS_OK )
+    {
+        BSP_DBG_TRACE_PRINTF( "  Ping slot at %u ms +/- %u ms: freq:%lu, SF%u, %s\n", slot_ms, half_window_ms,
+                              params.ping_freq_hz, sf, name_bw[bw] );
+    }
+    else
+    {
+        lr1_mac->class_c.is_running = false;
+        BSP_DBG_TRACE_PRINTF( "Radio planner hook %d is busy \n", my_hook_id );
+    }
+}
 
-            rx_param_setup_parser( lr1_mac );
+status_lorawan_t lr1_stack_mac_multicast_set( lr1_stack_mac_t* lr1_mac, uint8_t group_id, uint32_t mc_addr,
+                                              const uint8_t* mc_nwk_skey, const uint8_t* mc_app_skey )
+{
+    if( group_id >= LR1MAC_MULTICAST_GROUP_NB )
+    {
+        return ERRORLORAWAN;
+    }
+    lr1_stack_mac_multicast_t* mc_group = &lr1_mac->multicast[group_id];
 
-            break;
-        case DEV_STATUS_REQ:
+    // disabled first, a RXC frame checked under interrupt must not see half copied keys
+    mc_group->enabled = false;
+    if( ( mc_nwk_skey == NULL ) || ( mc_app_skey == NULL ) )
+    {
+        return OKLORAWAN;
+    }
+    mc_group->mc_addr  = mc_addr;
+    mc_group->fcnt_dwn = 0xFFFFFFFF;
+    memcpy( mc_group->nwk_skey, mc_nwk_skey, 16 );
+    memcpy( mc_group->app_skey, mc_app_skey, 16 );
 
-            dev_status_parser( lr1_mac );  //@note  Done but margin have no sense
-                                           // tb implemented
-            break;
-        case NEW_CHANNEL_REQ:
+    // key check: the group key on a block no frame uses, the MIC and keystream blocks start with 0x49 and 0x01
+    uint8_t block[16];
 
-            new_channel_parser( lr1_mac );
+    memset( block, 0xFF, sizeof( block ) );
+    lora_crypto_key_set( &lr1_mac->multicast_key_ctx, mc_nwk_skey );
+    crypto_backend_block_encrypt( &lr1_mac->multicast_key_ctx.backend_key, block, block );
+    memcpy( &mc_group->key_check, block, sizeof( mc_group->key_check ) );
 
-            break;
-        case RXTIMING_SETUP_REQ:
+    // the group is set again after each reset: the frames up to the last one journaled for its session are replays
+    mac_multicast_context_t mc_context;
 
-            rx_timing_setup_parser( lr1_mac );
+    if( ( bsp_nvm_journal_read( BSP_NVM_JOURNAL_KEY_LORAWAN_MULTICAST + lr1_mac->stack_id, ( uint8_t* ) &mc_context,
+                                sizeof( mc_context ) ) == sizeof( mc_context ) ) &&
+        ( mc_context.mc_addr[group_id] == mc_addr ) && ( mc_context.key_check[group_id] == mc_group->key_check ) )
+    {
+        mc_group->fcnt_dwn = mc_context.fcnt_dwn[group_id];
+        BSP_DBG_TRACE_PRINTF( " Multicast group %u FcntDwn restored = %lu\n", group_id, mc_group->fcnt_dwn );
+    }
+    mc_group->enabled = true;
+    return OKLORAWAN;
+}
 
-            break;
-        case TXPARAM_SETUP_REQ:
+uint8_t lr1_stack_mac_cmd_ans_cut( uint8_t* nwk_ans, uint8_t nwk_ans_size_in, uint8_t max_allowed_size )
+{
+    uint8_t* p_tmp = nwk_ans;
+    uint8_t* p     = nwk_ans;
 
-            tx_param_setup_parser( lr1_mac );
+    while( p_tmp - nwk_ans < MIN( nwk_ans_size_in, max_allowed_size ) )
+    {
+        p_tmp += lr1_stack_mac_cmds[nwk_ans[p_tmp - nwk_ans]].ans_size;
 
+        if( ( p_tmp - nwk_ans ) <= max_allowed_size )
+        {
+            p = p_tmp;
+        }
+        else
+        {
             break;
-        case DL_CHANNEL_REQ:
+        }
+    }
 
-            dl_channel_parser( lr1_mac );
+    return p - nwk_ans;  // New payload size
+}
 
-            break;
-        default:
-            lr1_mac->nwk_payload_size = 0;
-            BSP_DBG_TRACE_MSG( " Illegal state in mac layer\n " );
+status_lorawan_t lr1_stack_mac_cmd_parse( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_mac->nwk_payload_index     = 0;
+    lr1_mac->nwk_ans_size          = 0;
+    lr1_mac->tx_fopts_length       = 0;
+    lr1_mac->tx_fopts_lengthsticky = 0;
 
-            break;
+    // all the commands are checked first, a command is then either applied and answered or dropped
+    const uint8_t valid_size = cmd_payload_check( lr1_mac );
+
+    while( lr1_mac->nwk_payload_index < valid_size )
+    {
+        const uint8_t              cid    = lr1_mac->nwk_payload[lr1_mac->nwk_payload_index];
+        const lr1_stack_mac_cmd_t* cmd    = &lr1_stack_mac_cmds[cid];
+        uint8_t                    nb_req = 1;
+
+        while( ( cmd->is_grouped == true ) &&
+               ( ( lr1_mac->nwk_payload_index + ( nb_req * cmd->req_size ) ) < valid_size ) &&
+               ( lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + ( nb_req * cmd->req_size )] == cid ) )
+        {
+            nb_req++;
+        }
+        cmd->parser( lr1_mac, nb_req );
+        if( cmd->is_sticky == true )
+        {
+            lr1_mac->tx_fopts_lengthsticky += nb_req * cmd->ans_size;
+        }
+        else
+        {
+            lr1_mac->tx_fopts_length += nb_req * cmd->ans_size;
         }
+        lr1_mac->nwk_payload_index += nb_req * cmd->req_size;
     }
-    return ( status );
+    if( ( lr1_mac->tx_fopts_length + lr1_mac->tx_fopts_lengthsticky ) > lr1_mac->tx_fopts_high_water )
+    {
+        lr1_mac->tx_fopts_high_water = lr1_mac->tx_fopts_length + lr1_mac->tx_fopts_lengthsticky;
+        BSP_DBG_TRACE_PRINTF( " nwk answers high water mark = %d / %d bytes\n", lr1_mac->tx_fopts_high_water,
+                              2 * LR1MAC_NWK_ANS_MAX_SIZE );
+    }
+    return ( valid_size == lr1_mac->nwk_payload_size ) ? OKLORAWAN : ERRORLORAWAN;
 }
 void lr1_stack_mac_join_request_build( lr1_stack_mac_t* lr1_mac )
 {
@@ -991,9 +1897,10 @@ void lr1_stack_mac_join_request_build( lr1_stack_mac_t* lr1_mac )
     BSP_DBG_TRACE_ARRAY( "appEUI", lr1_mac->app_eui, 8 );
     BSP_DBG_TRACE_ARRAY( "appKey", lr1_mac->app_key, 16 );
     lr1_mac->dev_nonce += 1;
-    lr1_mac->tx_mtype     = JOIN_REQUEST;
-    lr1_mac->nb_trans_cpt = 1;
-    lr1_mac->nb_trans     = 1;
+    lr1_mac->tx_mtype        = JOIN_REQUEST;
+    lr1_mac->nb_trans_cpt    = 1;
+    lr1_mac->nb_trans        = 1;
+    lr1_mac->tx_frame_offset = 0;
     mac_header_set( lr1_mac );
 //    for( int i = 0; i < 8; i++ )
 //    {
@@ -1009,15 +1916,18 @@ void lr1_stack_mac_join_request_build( lr1_stack_mac_t* lr1_mac )
 //    join_compute_mic( &lr1_mac->tx_payload[0], lr1_mac->tx_payload_size, lr1_mac->app_key, &mic );
 //    memcpy( &lr1_mac->tx_payload[lr1_mac->tx_payload_size], ( uint8_t* ) &mic, 4 );
 //    lr1_mac->tx_payload_size = lr1_mac->tx_payload_size + 4;
-    smtc_real_memory_save( lr1_mac );  // to save devnonce
+    if( lr1_mac->dev_nonce == ( uint16_t )( lr1_mac->dev_nonce_reserved + 1 ) )
+    {  // the reserved DevNonces are used up: reserve the next block, a reset resumes after it
+        lr1_mac->dev_nonce_reserved = lr1_mac->dev_nonce + LR1MAC_DEV_NONCE_RESERVE - 1;
+        smtc_real_memory_save( lr1_mac );  // to save devnonce
+    }
 }
 
 void lr1_stack_mac_join_accept( lr1_stack_mac_t* lr1_mac )
 {
-    uint8_t app_nonce[6];
-    int     i;
-    memcpy( app_nonce, &lr1_mac->rx_payload[1], 6 );
-    join_compute_skeys( lr1_mac->app_key, app_nonce, lr1_mac->dev_nonce, lr1_mac->nwk_skey, lr1_mac->app_skey );
+    int i;
+
+    // the session keys are already derived and expanded by lr1_stack_mac_rx_frame_decode
     if( lr1_mac->rx_payload_size > 13 )
     {  // cflist are presents
         for( i = 0; i < 16; i++ )
@@ -1065,69 +1975,230 @@ uint8_t lr1_stack_mac_max_dr_get( lr1_stack_mac_t* lr1_mac )
 {
     return smtc_real_max_dr_channel_get( lr1_mac );
 }
-void lr1_stack_rx1_join_delay_set( lr1_stack_mac_t* lr1_mac )
-{
-    lr1_mac->rx1_delay_s = smtc_real_rx1_join_delay_get( lr1_mac );
-}
-void lr1_stack_rx2_join_dr_set( lr1_stack_mac_t* lr1_mac )
-{
-    lr1_mac->rx2_data_rate = smtc_real_rx2_join_dr_get( lr1_mac );
-}
 
-int32_t lr1_stack_network_next_free_duty_cycle_ms_get( lr1_stack_mac_t* lr1_mac )
+void lr1_stack_mac_link_margin_adr( lr1_stack_mac_t* lr1_mac )
 {
-    int32_t  time_off_left = 0;
-    uint32_t delta_t       = 0;
+    lr1_stack_mac_link_margin_t* link = &lr1_mac->link_margin;
 
-    if( lr1_mac->tx_duty_cycle_time_off_ms > 0 )
+    if( ( link->is_updated == false ) || ( link->sample_nb < LR1MAC_LINK_MARGIN_MIN_SAMPLES ) )
     {
-        uint32_t rtc_now = bsp_rtc_get_time_ms( );
-        if( rtc_now >= lr1_mac->tx_duty_cycle_timestamp_ms )
-        {
-            delta_t = rtc_now - lr1_mac->tx_duty_cycle_timestamp_ms;
-        }
-        else
-        {
-            delta_t = 0xFFFFFFFFUL - lr1_mac->tx_duty_cycle_timestamp_ms;
-            delta_t += rtc_now;
-        }
-
-        if( delta_t > lr1_mac->tx_duty_cycle_time_off_ms )
-        {
-            time_off_left = 0;
-        }
-        else
-        {
-            time_off_left = lr1_mac->tx_duty_cycle_time_off_ms - delta_t;
-        }
+        return;
     }
-    return time_off_left;
-}
+    link->is_updated = false;
 
-/*
- *-----------------------------------------------------------------------------------
- * --- PRIVATE FUNCTIONS DEFINITIONS ------------------------------------------------
- */
+    int16_t snr_sum = 0;
+    for( uint8_t i = 0; i < link->sample_nb; i++ )
+    {
+        snr_sum += link->snr_db[i];
+    }
 
-static void mac_header_set( lr1_stack_mac_t* lr1_mac )
-{
-    lr1_mac->tx_payload[0] = ( ( lr1_mac->tx_mtype & 0x7 ) << 5 ) + ( lr1_mac->tx_major_bits & 0x3 );
-}
+    // margin above the target at the datarate and power of the last uplink
+    uint8_t dr        = lr1_mac->tx_data_rate;
+    uint8_t power_idx = MAX( lr1_mac->max_eirp_dbm - lr1_mac->tx_power, 0 ) / 2;
+    int16_t margin_db = ( snr_sum / link->sample_nb ) - lora_snr_floor_db( lr1_mac->tx_sf ) - ( 2 * power_idx ) -
+                        LR1MAC_LINK_MARGIN_TARGET_DB;
+    int16_t steps;
 
-static void frame_header_set( lr1_stack_mac_t* lr1_mac )
+    if( margin_db >= 0 )
+    {
+        steps = ( margin_db - LR1MAC_LINK_MARGIN_HYSTERESIS_DB ) / LR1MAC_LINK_MARGIN_STEP_DB;
+    }
+    else
+    {
+        steps = -( ( LR1MAC_LINK_MARGIN_STEP_DB - 1 - margin_db ) / LR1MAC_LINK_MARGIN_STEP_DB );
+    }
+
+    // the margin goes to a faster datarate first, it saves more energy per byte than a lower power
+    while( ( steps > 0 ) && ( dr < smtc_real_max_dr_channel_get( lr1_mac ) ) )
+    {
+        dr++;
+        steps--;
+    }
+    while( ( steps > 0 ) && ( smtc_real_is_valid_tx_power( lr1_mac, power_idx + 1 ) == OKLORAWAN ) )
+    {
+        power_idx++;
+        steps--;
+    }
+    // a short margin is first made up with the power
+    while( ( steps < 0 ) && ( power_idx > 0 ) )
+    {
+        power_idx--;
+        steps++;
+    }
+    while( ( steps < 0 ) && ( dr > smtc_real_min_dr_channel_get( lr1_mac ) ) )
+    {
+        dr--;
+        steps++;
+    }
+    lr1_mac->tx_data_rate_adr = dr;
+    smtc_real_power_set( lr1_mac, power_idx );
+    BSP_DBG_TRACE_PRINTF( "link margin %d dB, dr %d, tx power %d dBm\n", margin_db, dr, lr1_mac->tx_power );
+}
+status_lorawan_t lr1_stack_mac_link_margin_get( const lr1_stack_mac_t* lr1_mac, int16_t* margin_db )
+{
+    const lr1_stack_mac_link_margin_t* link    = &lr1_mac->link_margin;
+    int16_t                            snr_sum = 0;
+
+    if( link->sample_nb < LR1MAC_LINK_MARGIN_MIN_SAMPLES )
+    {
+        return ERRORLORAWAN;
+    }
+    for( uint8_t i = 0; i < link->sample_nb; i++ )
+    {
+        snr_sum += link->snr_db[i];
+    }
+    *margin_db = ( snr_sum / link->sample_nb ) - lora_snr_floor_db( lr1_mac->tx_sf ) -
+                 ( lr1_mac->max_eirp_dbm - lr1_mac->tx_power );
+    return OKLORAWAN;
+}
+void lr1_stack_mac_nwk_ans_dr_set( lr1_stack_mac_t* lr1_mac )
+{
+    int16_t margin_db;
+
+    // the margin is the one of the strategy datarate, set by the last lr1_stack_mac_update
+    if( lr1_stack_mac_link_margin_get( lr1_mac, &margin_db ) != OKLORAWAN )
+    {
+        return;
+    }
+    int16_t steps = ( margin_db - LR1MAC_LINK_MARGIN_TARGET_DB ) / LR1MAC_LINK_MARGIN_STEP_DB;
+    if( steps <= 0 )
+    {
+        return;
+    }
+    steps = MIN( steps, UINT8_MAX - lr1_mac->tx_data_rate );
+    smtc_real_fastest_dr_get( lr1_mac, lr1_mac->tx_data_rate + steps );
+    BSP_DBG_TRACE_PRINTF( "mac answers, link margin %d dB, dr %d\n", margin_db, lr1_mac->tx_data_rate );
+}
+void lr1_stack_mac_device_time_req( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_mac->device_time.is_requested = true;
+}
+void lr1_stack_mac_link_check_enable_set( lr1_stack_mac_t* lr1_mac, uint8_t enable )
+{
+    lr1_stack_mac_link_check_t* check = &lr1_mac->link_check;
+
+    check->enabled    = ( enable != 0 ) ? true : false;
+    check->is_pending = false;
+    check->period     = LR1MAC_LINK_CHECK_PERIOD_MIN;
+    check->uplink_cnt = 0;
+    check->miss_cnt   = 0;
+    check->state      = LR1MAC_LINK_STATE_UNKNOWN;
+}
+lr1mac_link_state_t lr1_stack_mac_link_state_get( const lr1_stack_mac_t* lr1_mac, uint8_t* miss_cnt )
+{
+    *miss_cnt = lr1_mac->link_check.miss_cnt;
+    return lr1_mac->link_check.state;
+}
+status_lorawan_t lr1_stack_mac_network_time_get( lr1_stack_mac_t* lr1_mac, uint64_t* gps_time_ms )
+{
+    const lr1_stack_mac_device_time_t* time = &lr1_mac->device_time;
+
+    if( time->is_synced == false )
+    {
+        return ERRORLORAWAN;
+    }
+    const int64_t elapsed_ms = ( int64_t )( bsp_rtc_get_time_ms64( ) - time->local_time_ms );
+
+    *gps_time_ms = time->gps_time_ms + elapsed_ms + ( ( elapsed_ms * time->drift_ppb ) / 1000000000 );
+    return OKLORAWAN;
+}
+bool lr1_stack_mac_tx_slot_get( lr1_stack_mac_t* lr1_mac, uint32_t target_time_ms, uint32_t* slot_time_ms )
+{
+    const lr1_stack_mac_tx_slot_t* slot = &lr1_mac->tx_slot;
+    uint64_t                       gps_time_ms;
+
+    if( slot->period_ms == 0 )
+    {
+        return false;
+    }
+    if( lr1_stack_mac_network_time_get( lr1_mac, &gps_time_ms ) != OKLORAWAN )
+    {
+        lr1_stack_mac_device_time_req( lr1_mac );
+        return false;
+    }
+    const uint32_t now_ms = bsp_rtc_get_time_ms( );
+    // the radio planner needs the scheduled task ahead of its start
+    const int32_t  wait_ms     = MAX( ( int32_t )( target_time_ms - now_ms ), LR1MAC_TX_SCHEDULE_MARGIN_MS );
+    const uint64_t earliest_ms = gps_time_ms + wait_ms;
+    const uint32_t offset_ms   = ( lr1_mac->dev_addr % ( slot->period_ms / slot->slot_ms ) ) * slot->slot_ms;
+    uint64_t       start_ms    = ( ( earliest_ms / slot->period_ms ) * slot->period_ms ) + offset_ms;
+
+    if( start_ms < earliest_ms )
+    {
+        start_ms += slot->period_ms;
+    }
+    // the slot is less than a frame period away, the drift of the RTC is negligible over it
+    *slot_time_ms = now_ms + ( uint32_t )( start_ms - gps_time_ms );
+    BSP_DBG_TRACE_PRINTF( " Uplink slot in %lu ms\n", *slot_time_ms - now_ms );
+    return true;
+}
+void lr1_stack_rx1_join_delay_set( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_mac->rx1_delay_s = smtc_real_rx1_join_delay_get( lr1_mac );
+}
+void lr1_stack_rx2_join_dr_set( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_mac->rx2_data_rate = smtc_real_rx2_join_dr_get( lr1_mac );
+}
+
+int32_t lr1_stack_network_next_free_duty_cycle_ms_get( lr1_stack_mac_t* lr1_mac )
 {
-    lr1_mac->tx_payload[1] = ( uint8_t )( ( lr1_mac->dev_addr & 0x000000FF ) );
-    lr1_mac->tx_payload[2] = ( uint8_t )( ( lr1_mac->dev_addr & 0x0000FF00 ) >> 8 );
-    lr1_mac->tx_payload[3] = ( uint8_t )( ( lr1_mac->dev_addr & 0x00FF0000 ) >> 16 );
-    lr1_mac->tx_payload[4] = ( uint8_t )( ( lr1_mac->dev_addr & 0xFF000000 ) >> 24 );
-    lr1_mac->tx_payload[5] = lr1_mac->tx_fctrl;
-    lr1_mac->tx_payload[6] = ( uint8_t )( ( lr1_mac->fcnt_up & 0x000000FF ) );
-    lr1_mac->tx_payload[7] = ( uint8_t )( ( lr1_mac->fcnt_up & 0x0000FF00 ) >> 8 );
+    int32_t  time_off_left = 0;
+    uint32_t delta_t       = 0;
+
+    if( lr1_mac->tx_duty_cycle_time_off_ms > 0 )
+    {
+        uint32_t rtc_now = bsp_rtc_get_time_ms( );
+        if( rtc_now >= lr1_mac->tx_duty_cycle_timestamp_ms )
+        {
+            delta_t = rtc_now - lr1_mac->tx_duty_cycle_timestamp_ms;
+        }
+        else
+        {
+            delta_t = 0xFFFFFFFFUL - lr1_mac->tx_duty_cycle_timestamp_ms;
+            delta_t += rtc_now;
+        }
+
+        if( delta_t > lr1_mac->tx_duty_cycle_time_off_ms )
+        {
+            time_off_left = 0;
+        }
+        else
+        {
+            time_off_left = lr1_mac->tx_duty_cycle_time_off_ms - delta_t;
+        }
+    }
+    return time_off_left;
+}
+
+/*
+ *-----------------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITIONS ------------------------------------------------
+ */
+
+static void mac_header_set( lr1_stack_mac_t* lr1_mac )
+{
+    uint8_t* frame = &lr1_mac->tx_payload[lr1_mac->tx_frame_offset];
+
+    frame[0] = ( ( lr1_mac->tx_mtype & 0x7 ) << 5 ) + ( lr1_mac->tx_major_bits & 0x3 );
+}
+
+static void frame_header_set( lr1_stack_mac_t* lr1_mac )
+{
+    uint8_t* frame = &lr1_mac->tx_payload[lr1_mac->tx_frame_offset];
+
+    frame[1] = ( uint8_t )( ( lr1_mac->dev_addr & 0x000000FF ) );
+    frame[2] = ( uint8_t )( ( lr1_mac->dev_addr & 0x0000FF00 ) >> 8 );
+    frame[3] = ( uint8_t )( ( lr1_mac->dev_addr & 0x00FF0000 ) >> 16 );
+    frame[4] = ( uint8_t )( ( lr1_mac->dev_addr & 0xFF000000 ) >> 24 );
+    frame[5] = lr1_mac->tx_fctrl;
+    frame[6] = ( uint8_t )( ( lr1_mac->fcnt_up & 0x000000FF ) );
+    frame[7] = ( uint8_t )( ( lr1_mac->fcnt_up & 0x0000FF00 ) >> 8 );
     for( int i = 0; i < lr1_mac->tx_fopts_current_length; i++ )
     {
-        lr1_mac->tx_payload[8 + i] = lr1_mac->tx_fopts_current_data[i];
+        frame[8 + i] = lr1_mac->tx_fopts_current_data[i];
     }
-    lr1_mac->tx_payload[8 + lr1_mac->tx_fopts_current_length] = lr1_mac->tx_fport;
+    frame[8 + lr1_mac->tx_fopts_current_length] = lr1_mac->tx_fport;
 }
 
 static valid_dev_addr_t check_dev_addr( lr1_stack_mac_t* lr1_mac, uint32_t devAddr_to_test )
@@ -1137,64 +2208,143 @@ static valid_dev_addr_t check_dev_addr( lr1_stack_mac_t* lr1_mac, uint32_t devAd
     {
         status = VALID_DEV_ADDR_UNICAST;
     }
+    else
+    {
+        for( uint8_t i = 0; i < LR1MAC_MULTICAST_GROUP_NB; i++ )
+        {
+            if( ( lr1_mac->multicast[i].enabled == true ) && ( devAddr_to_test == lr1_mac->multicast[i].mc_addr ) )
+            {
+                status = ( valid_dev_addr_t )( VALID_DEV_ADDR_MULTI_CAST_G0 + i );
+                break;
+            }
+        }
+    }
     return status;
 }
 
-static void compute_rx_window_parameters( lr1_stack_mac_t* lr1_mac, uint8_t sf, lr1mac_bandwidth_t bw,
+static bool rx_header_is_for_device( lr1_stack_mac_t* lr1_mac, const uint8_t* header )
+{
+    uint8_t rx_mtype_tmp = header[0] >> 5;
+
+    if( ( rx_mtype_tmp == JOIN_REQUEST ) || ( rx_mtype_tmp == UNCONF_DATA_UP ) || ( rx_mtype_tmp == CONF_DATA_UP ) ||
+        ( rx_mtype_tmp == REJOIN_REQUEST ) )
+    {
+        return false;
+    }
+    if( lr1_mac->join_status != JOINED )
+    {
+        return true;
+    }
+    uint32_t dev_addr_tmp = header[1] + ( header[2] << 8 ) + ( header[3] << 16 ) + ( ( uint32_t ) header[4] << 24 );
+    return ( check_dev_addr( lr1_mac, dev_addr_tmp ) != UNVALID_DEV_ADDR );
+}
+
+static lr1_stack_mac_multicast_t* multicast_group_get( lr1_stack_mac_t* lr1_mac, valid_dev_addr_t dev_addr_type )
+{
+    if( ( dev_addr_type < VALID_DEV_ADDR_MULTI_CAST_G0 ) || ( dev_addr_type == UNVALID_DEV_ADDR ) )
+    {
+        return NULL;
+    }
+    return &lr1_mac->multicast[dev_addr_type - VALID_DEV_ADDR_MULTI_CAST_G0];
+}
+
+static rx_packet_type_t multicast_rx_frame_decode( lr1_stack_mac_t* lr1_mac, lr1_stack_mac_multicast_t* mc_group )
+{
+    uint16_t fcnt_dwn_tmp = 0;
+    uint32_t fcnt_dwn     = mc_group->fcnt_dwn;
+    uint32_t mic_in;
+
+    if( ( rx_fhdr_extract( lr1_mac, &fcnt_dwn_tmp, mc_group->mc_addr ) != OKLORAWAN ) ||
+        ( lr1_mac->rx_mtype != UNCONF_DATA_DOWN ) || ( lr1_mac->rx_fopts_length != 0 ) ||
+        ( lr1_mac->rx_payload_empty != 0 ) || ( lr1_mac->rx_fport == 0 ) )
+    {
+        BSP_DBG_TRACE_WARNING( " Receive a not valid multicast frame\n" );
+        return NO_MORE_VALID_RX_PACKET;
+    }
+    lr1_mac->rx_payload_size = lr1_mac->rx_payload_size - MICSIZE;
+    memcpy( ( uint8_t* ) &mic_in, &lr1_mac->rx_payload[lr1_mac->rx_payload_size], MICSIZE );
+    // the group frames are rare: one schedule for all the groups, expanded with the key each step needs
+    lora_crypto_key_set( &lr1_mac->multicast_key_ctx, mc_group->nwk_skey );
+    if( fcnt_dwn_mic_check( lr1_mac, &lr1_mac->multicast_key_ctx, mc_group->mc_addr, fcnt_dwn_tmp,
+                            lr1_mac->rx_payload_size, mic_in, LR1MAC_FCNT_DWN_MSB_CANDIDATES, &fcnt_dwn ) != OKLORAWAN )
+    {
+        return NO_MORE_VALID_RX_PACKET;
+    }
+    // the group counter only moves on an authenticated frame, a forged one can't block the group. It is journaled
+    // before the frame is used, as the unicast one
+    mc_group->fcnt_dwn = fcnt_dwn;
+    multicast_fcnt_save( lr1_mac, mc_group );
+
+    lr1_mac->rx_payload_size = lr1_mac->rx_payload_size - FHDROFFSET;
+    lora_crypto_key_set( &lr1_mac->multicast_key_ctx, mc_group->app_skey );
+    lora_crypto_keyed_payload_decrypt( &lr1_mac->crypto_ctx, &lr1_mac->rx_payload[FHDROFFSET],
+                                       lr1_mac->rx_payload_size, &lr1_mac->multicast_key_ctx, mc_group->mc_addr, 1,
+                                       fcnt_dwn, downlink_tail_get( lr1_mac )->payload );
+    downlink_push( lr1_mac );
+    return NO_MORE_VALID_RX_PACKET;
+}
+
+static void multicast_fcnt_save( lr1_stack_mac_t* lr1_mac, const lr1_stack_mac_multicast_t* mc_group )
+{
+    const uint8_t           key      = BSP_NVM_JOURNAL_KEY_LORAWAN_MULTICAST + lr1_mac->stack_id;
+    const uint8_t           group_id = mc_group - lr1_mac->multicast;
+    mac_multicast_context_t mc_context;
+
+    // the other groups keep their last record, they may not be set again yet after a reset
+    if( bsp_nvm_journal_read( key, ( uint8_t* ) &mc_context, sizeof( mc_context ) ) != sizeof( mc_context ) )
+    {
+        memset( &mc_context, 0, sizeof( mc_context ) );
+    }
+    mc_context.mc_addr[group_id]   = mc_group->mc_addr;
+    mc_context.key_check[group_id] = mc_group->key_check;
+    mc_context.fcnt_dwn[group_id]  = mc_group->fcnt_dwn;
+    bsp_nvm_journal_write( key, ( uint8_t* ) &mc_context, sizeof( mc_context ) );
+}
+
+static void compute_rx_window_parameters( lr1_stack_mac_t* lr1_mac, ral_lora_sf_t sf, ral_lora_bw_t bw,
                                           uint32_t clock_accuracy, uint32_t rx_delay_ms, uint8_t board_delay_ms,
                                           modulation_type_t rx_modulation_type )
 {
     // ClockAccuracy is set in Define.h, it is board dependent. It must be equal
     // to error in per thousand
 
-    int      bw_temp = 125;
-    uint32_t rx_error_ms =
-        ( clock_accuracy * rx_delay_ms ) /
-        1000;  // for example with an clockaccuracy = 30 (3%)  and a rx windows set to 5s => rxerror = 150 ms
-    double   tsymbol        = 0.0;
-    uint8_t  min_rx_symbols = 6;
-    uint16_t rx_window_symb;
+    // for example with an clockaccuracy = 30 (3%)  and a rx windows set to 5s => rxerror = 150 ms
+    uint32_t      rx_error_us    = clock_accuracy * rx_delay_ms;
+    int32_t       center_us      = 0;
+    const uint8_t min_rx_symbols = 6;
+    uint16_t      rx_window_symb;
+    uint32_t      window_us;
+    uint32_t      pbl_4_symb_us;
+
+    // once measured, the window is centered on the downlinks timing and only covers its spread
+    if( lr1_mac->rx_drift.sample_cnt >= LR1MAC_RX_DRIFT_MIN_SAMPLES )
+    {
+        rx_error_us = MIN( rx_error_us, ( 2 * lr1_mac->rx_drift.spread_us ) + LR1MAC_RX_DRIFT_MARGIN_US );
+        center_us   = lr1_mac->rx_drift.error_us;
+    }
 
     if( rx_modulation_type == LORA )
     {
-        // Use lr1mac_utilities_get_symb_time_us
-        switch( bw )
-        {
-        case BW125:
-            bw_temp = 125;
-            break;
-        case BW250:
-            bw_temp = 250;
-            break;
-        case BW500:
-            bw_temp = 500;
-            break;
-        case BW800:
-            bw_temp = 800;
-            break;
-        case BW1600:
-            bw_temp = 1600;
-            break;
-        default:
-            bw_temp = 125;
-            break;
-        }
-        tsymbol        = ( double ) ( 1 << sf ) / ( double ) bw_temp;
-        rx_window_symb = ( uint16_t )(
-            MAX( ( 2 * min_rx_symbols - 8 ) + ( ( 2 * rx_error_ms * bw_temp ) >> sf ) + 1, min_rx_symbols ) );
+        rx_window_symb = ( uint16_t ) MAX(
+            ( 2 * min_rx_symbols - 8 ) + lr1mac_utilities_get_symb_nb( 2 * rx_error_us, sf, bw ) + 1, min_rx_symbols );
+        window_us     = lr1mac_utilities_get_symb_time_us( rx_window_symb, sf, bw );
+        pbl_4_symb_us = lr1mac_utilities_get_symb_time_us( 4, sf, bw );
     }
     else
-    {                                              // FSK
-        tsymbol        = ( 8.0 / ( double ) sf );  // 1 symbol equals 1 byte
-        rx_window_symb = ( uint16_t )( MAX( ( 2 * min_rx_symbols - 8 ) + ( ( 2 * rx_error_ms * sf ) >> 3 ) + 1,
+    {  // FSK: 1 symbol equals 1 byte
+        rx_window_symb = ( uint16_t )( MAX( ( 2 * min_rx_symbols - 8 ) + ( ( 2 * rx_error_us * sf ) / 8000 ) + 1,
                                             min_rx_symbols ) );  // Computed number of symbols
+        window_us      = ( ( uint32_t ) rx_window_symb * 8000 ) / sf;
+        pbl_4_symb_us  = ( 4 * 8000 ) / sf;
     }
 
-    lr1_mac->rx_offset_ms =
-        ( int32_t )( ( ceil( ( 4.0 * tsymbol ) - ( ( rx_window_symb * tsymbol ) / 2.0 ) - board_delay_ms ) ) * ( -1 ) );
+    // the window is centered on the 4th preamble symbol: rx_offset_ms = floor( window / 2 - 4 symbols + board delay )
+    const int32_t offset_us =
+        ( int32_t )( window_us / 2 ) - ( int32_t ) pbl_4_symb_us + ( board_delay_ms * 1000 ) - center_us;
 
+    lr1_mac->rx_offset_ms   = ( offset_us >= 0 ) ? ( offset_us / 1000 ) : -( ( 999 - offset_us ) / 1000 );
     lr1_mac->rx_window_symb = rx_window_symb;
-    lr1_mac->rx_timeout_ms  = ceil( rx_window_symb * tsymbol );
+    lr1_mac->rx_timeout_ms  = ( window_us + 999 ) / 1000;
 }
 
 static status_lorawan_t rx_payload_size_check( lr1_stack_mac_t* lr1_mac )
@@ -1258,45 +2408,139 @@ static int rx_fhdr_extract( lr1_stack_mac_t* lr1_mac, uint16_t* fcnt_dwn_tmp, ui
     return ( status );
 }
 
-static int fcnt_dwn_accept( uint16_t fcnt_dwn_tmp, uint32_t* fcnt_lorawan )
+static int fcnt_dwn_mic_check( lr1_stack_mac_t* lr1_mac, const lora_crypto_key_t* nwk_skey_ctx, uint32_t dev_addr,
+                               uint16_t fcnt_dwn_lsb, uint8_t size, uint32_t mic_in, uint8_t candidate_nb,
+                               uint32_t* fcnt_dwn )
 {
-    int      status       = OKLORAWAN;
-    uint16_t fcnt_dwn_lsb = ( *fcnt_lorawan & 0x0000FFFF );
-    uint32_t fcnt_dwn_msb = ( *fcnt_lorawan & 0xFFFF0000 );
-    if( ( fcnt_dwn_tmp > fcnt_dwn_lsb ) || ( *fcnt_lorawan == 0xFFFFFFFF ) )
+    // 64-bit candidates: the counter doesn't wrap, the session must be renewed before
+    uint64_t candidate = ( *fcnt_dwn & 0xFFFF0000 ) | fcnt_dwn_lsb;
+
+    if( *fcnt_dwn == 0xFFFFFFFF )  // first downlink of the session, its counter may be 0
     {
-        if( *fcnt_lorawan == 0xFFFFFFFF )  // manage the case of the first downlink with fcnt down = 0
-        {
-            *fcnt_lorawan = fcnt_dwn_tmp;
-        }
-        else
+        candidate = fcnt_dwn_lsb;
+    }
+    else if( candidate <= *fcnt_dwn )
+    {
+        candidate += ( 1UL << 16 );
+    }
+    for( uint8_t i = 0; ( i < candidate_nb ) && ( candidate < 0xFFFFFFFF ); i++ )
+    {
+        if( lora_crypto_keyed_check_mic( &lr1_mac->crypto_ctx, &lr1_mac->rx_payload[0], size, nwk_skey_ctx, dev_addr,
+                                         ( uint32_t ) candidate, mic_in ) == 0 )
         {
-            *fcnt_lorawan = fcnt_dwn_msb + fcnt_dwn_tmp;
+            if( i > 0 )
+            {
+                BSP_DBG_TRACE_WARNING( " FcntDwn rebuilt %u MSB steps ahead: %lu\n", i, ( uint32_t ) candidate );
+            }
+            *fcnt_dwn = ( uint32_t ) candidate;
+            return OKLORAWAN;
         }
+        candidate += ( 1UL << 16 );
     }
-    else if( ( fcnt_dwn_lsb - fcnt_dwn_tmp ) > MAX_FCNT_GAP )
+    BSP_DBG_TRACE_INFO( " BAD MIC for RX Frame, fcntDwnReceive = %u fcntLoraStack = %lu\n", fcnt_dwn_lsb, *fcnt_dwn );
+    return ERRORLORAWAN;
+}
+
+#if( BSP_LR1MAC_EARLY_DOWNLINK_CHECK == 1 )
+static int downlink_mic_check( lr1_stack_mac_t* lr1_mac, valid_dev_addr_t dev_addr_type, uint8_t candidate_nb )
+{
+    const lr1_stack_mac_multicast_t* mc_group = multicast_group_get( lr1_mac, dev_addr_type );
+    const lora_crypto_key_t*         nwk_skey_ctx   = &lr1_mac->nwk_skey_ctx;
+    uint32_t                         dev_addr       = ( mc_group != NULL ) ? mc_group->mc_addr : lr1_mac->dev_addr;
+    uint32_t                         fcnt_dwn_tmp32 = ( mc_group != NULL ) ? mc_group->fcnt_dwn : lr1_mac->fcnt_dwn;
+    uint32_t                         mic_in;
+    uint8_t                          size;
+
+    if( lr1_mac->rx_payload_size < MIN_LORAWAN_PAYLOAD_SIZE )
     {
-        *fcnt_lorawan = fcnt_dwn_msb + ( 1UL << 16 ) + fcnt_dwn_tmp;
+        return ERRORLORAWAN;
     }
-    else
-    {
-        status = ERRORLORAWAN;
-        BSP_DBG_TRACE_PRINTF(
-            " ERROR FcntDwn is not acceptable fcntDwnReceive = %u "
-            "fcntLoraStack = %lu\n",
-            fcnt_dwn_tmp, ( *fcnt_lorawan ) );
+    if( mc_group != NULL )
+    {  // thread level only, see lr1_stack_mac_downlink_check_under_it
+        lora_crypto_key_set( &lr1_mac->multicast_key_ctx, mc_group->nwk_skey );
+        nwk_skey_ctx = &lr1_mac->multicast_key_ctx;
     }
-    return ( status );
+    size = lr1_mac->rx_payload_size - MICSIZE;
+    memcpy( ( uint8_t* ) &mic_in, &lr1_mac->rx_payload[size], MICSIZE );
+    // the stack crypto context is free here: no uplink is built while a receive window is open. The rebuilt counter
+    // is a copy, the stack state is updated by the full decode
+    return fcnt_dwn_mic_check( lr1_mac, nwk_skey_ctx, dev_addr,
+                               lr1_mac->rx_payload[6] + ( lr1_mac->rx_payload[7] << 8 ), size, mic_in, candidate_nb,
+                               &fcnt_dwn_tmp32 );
 }
+#endif
 
 /************************************************************************************************/
 /*                    Private NWK MANAGEMENTS Methods */
 /************************************************************************************************/
-static void link_check_parser( lr1_stack_mac_t* lr1_mac )
+static uint8_t cmd_payload_check( lr1_stack_mac_t* lr1_mac )
+{
+    uint8_t index       = 0;
+    uint8_t group_index = 0;  // first block of the current grouped request
+    uint8_t prev_cid    = 0;
+    uint8_t ans_size    = 0;
+    uint8_t sticky_size = 0;
+
+    while( index < lr1_mac->nwk_payload_size )
+    {
+        const uint8_t cid = lr1_mac->nwk_payload[index];
+
+        if( ( cid >= NB_MAC_CMD_REQ ) || ( lr1_stack_mac_cmds[cid].parser == NULL ) )
+        {
+            BSP_DBG_TRACE_WARNING( "unknown mac command 0x%02x, dropped with the next ones\n", cid );
+            return index;
+        }
+
+        const lr1_stack_mac_cmd_t* cmd  = &lr1_stack_mac_cmds[cid];
+        uint8_t*                   size = ( cmd->is_sticky == true ) ? &sticky_size : &ans_size;
+
+        if( cid != prev_cid )
+        {
+            group_index = index;
+        }
+        if( ( ( index + cmd->req_size ) > lr1_mac->nwk_payload_size ) ||
+            ( ( *size + cmd->ans_size ) > LR1MAC_NWK_ANS_MAX_SIZE ) )
+        {
+            BSP_DBG_TRACE_WARNING( "mac command 0x%02x truncated or answers full, dropped with the next ones\n", cid );
+            return ( cmd->is_grouped == true ) ? group_index : index;
+        }
+        *size += cmd->ans_size;
+        index += cmd->req_size;
+        prev_cid = cid;
+    }
+    return index;
+}
+
+static int16_t lora_snr_floor_db( uint8_t sf )
+{
+    return -( ( ( ( int16_t ) sf - 4 ) * 5 ) / 2 );
+}
+
+static void link_margin_sample_add( lr1_stack_mac_t* lr1_mac, int16_t snr_db )
+{
+    lr1_stack_mac_link_margin_t* link = &lr1_mac->link_margin;
+
+    link->snr_db[link->sample_idx] = ( int8_t ) MIN( MAX( snr_db, INT8_MIN ), INT8_MAX );
+    link->sample_idx               = ( link->sample_idx + 1 ) % LR1MAC_LINK_MARGIN_WINDOW;
+    link->sample_nb                = MIN( link->sample_nb + 1, LR1MAC_LINK_MARGIN_WINDOW );
+    link->is_updated               = true;
+}
+
+static void link_check_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
 {
     BSP_DBG_TRACE_PRINTF( " Margin = %d , GwCnt = %d \n", lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1],
                           lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 2] );
-    lr1_mac->nwk_payload_index += LINK_CHECK_ANS_SIZE;
+    // the margin of the last uplink, brought back to full power
+    link_margin_sample_add( lr1_mac, lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1] +
+                                         lora_snr_floor_db( lr1_mac->tx_sf ) +
+                                         ( lr1_mac->max_eirp_dbm - tx_power_get( lr1_mac ) ) );
+    lr1_mac->link_check.margin_db  = lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1];
+    lr1_mac->link_check.gw_cnt     = lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 2];
+    lr1_mac->link_check.is_pending = false;
+    if( lr1_mac->link_check.enabled == true )
+    {
+        link_check_update( lr1_mac, true );
+    }
 }
 /**********************************************************************************************************************/
 /*                                               Private NWK MANAGEMENTS :
@@ -1323,9 +2567,9 @@ static void link_check_parser( lr1_stack_mac_t* lr1_mac )
  * channel )                                */
 /**********************************************************************************************************************/
 
-static void link_adr_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_link_adr_req )
+static void link_adr_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
 {
-    for( uint8_t i = 0; i < nb_link_adr_req; i++ )
+    for( uint8_t i = 0; i < nb_req; i++ )
     {
         BSP_DBG_TRACE_PRINTF( "%u - Cmd link_adr_parser = %02x %02x %02x %02x \n", i,
                               lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + ( i * LINK_ADR_REQ_SIZE ) + 1],
@@ -1342,7 +2586,9 @@ static void link_adr_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_link_adr_req )
     uint8_t          tx_power_tmp;
     uint8_t          nb_trans_tmp;
 
-    for( uint8_t i = 0; i < nb_link_adr_req; i++ )
+    // the blocks of the requests are applied on top of the current channel mask
+    smtc_real_channel_mask_init( lr1_mac );
+    for( uint8_t i = 0; i < nb_req; i++ )
     {
         channel_mask_temp = lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + ( i * LINK_ADR_REQ_SIZE ) + 2] +
                             ( lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + ( i * LINK_ADR_REQ_SIZE ) + 3] << 8 );
@@ -1366,7 +2612,7 @@ static void link_adr_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_link_adr_req )
     /* At This point global temporary channel mask is built and validated */
     /* Valid the last DataRate */
     dr_tmp =
-        ( ( lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + ( ( nb_link_adr_req - 1 ) * LINK_ADR_REQ_SIZE ) + 1] &
+        ( ( lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + ( ( nb_req - 1 ) * LINK_ADR_REQ_SIZE ) + 1] &
             0xF0 ) >>
           4 );
     status = smtc_real_is_acceptable_dr( lr1_mac, dr_tmp );
@@ -1378,7 +2624,7 @@ static void link_adr_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_link_adr_req )
 
     /* Valid the last TxPower  And Prepare Ans */
     tx_power_tmp =
-        ( lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + ( ( nb_link_adr_req - 1 ) * LINK_ADR_REQ_SIZE ) + 1] &
+        ( lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + ( ( nb_req - 1 ) * LINK_ADR_REQ_SIZE ) + 1] &
           0x0F );
     status = smtc_real_is_valid_tx_power( lr1_mac, tx_power_tmp );
     if( status == ERRORLORAWAN )
@@ -1388,7 +2634,7 @@ static void link_adr_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_link_adr_req )
     }
 
     nb_trans_tmp =
-        ( lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + ( ( nb_link_adr_req - 1 ) * LINK_ADR_REQ_SIZE ) + 4] &
+        ( lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + ( ( nb_req - 1 ) * LINK_ADR_REQ_SIZE ) + 4] &
           0x0F );
 
     /* Update the mac parameters if case of no error */
@@ -1405,13 +2651,11 @@ static void link_adr_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_link_adr_req )
     }
 
     /* Prepare repeated Ans*/
-    for( uint8_t i = 0; i < nb_link_adr_req; i++ )
+    for( uint8_t i = 0; i < nb_req; i++ )
     {
         lr1_mac->tx_fopts_data[lr1_mac->tx_fopts_length + ( i * LINK_ADR_ANS_SIZE )]     = LINK_ADR_ANS;  // copy Cid
         lr1_mac->tx_fopts_data[lr1_mac->tx_fopts_length + ( i * LINK_ADR_ANS_SIZE ) + 1] = status_ans;
     }
-    lr1_mac->nwk_payload_index += ( nb_link_adr_req * LINK_ADR_REQ_SIZE );
-    lr1_mac->tx_fopts_length += ( nb_link_adr_req * LINK_ADR_ANS_SIZE );
 }
 
 /**********************************************************************************************************************/
@@ -1419,7 +2663,7 @@ static void link_adr_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_link_adr_req )
  * rx_param_setup_parser                       */
 /**********************************************************************************************************************/
 
-static void rx_param_setup_parser( lr1_stack_mac_t* lr1_mac )
+static void rx_param_setup_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
 {
     BSP_DBG_TRACE_PRINTF(
         " Cmd rx_param_setup_parser = %x %x %x %x \n", lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1],
@@ -1478,8 +2722,6 @@ static void rx_param_setup_parser( lr1_stack_mac_t* lr1_mac )
 
     lr1_mac->tx_fopts_datasticky[lr1_mac->tx_fopts_lengthsticky]     = RXPARRAM_SETUP_ANS;
     lr1_mac->tx_fopts_datasticky[lr1_mac->tx_fopts_lengthsticky + 1] = status_ans;
-    lr1_mac->tx_fopts_lengthsticky += RXPARRAM_SETUP_ANS_SIZE;
-    lr1_mac->nwk_payload_index += RXPARRAM_SETUP_REQ_SIZE;
 }
 
 /**********************************************************************************************************************/
@@ -1487,22 +2729,20 @@ static void rx_param_setup_parser( lr1_stack_mac_t* lr1_mac )
  * duty_cycle_parser                          */
 /**********************************************************************************************************************/
 
-static void duty_cycle_parser( lr1_stack_mac_t* lr1_mac )
+static void duty_cycle_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
 {
     BSP_DBG_TRACE_PRINTF( "Cmd duty_cycle_parser %x \n", lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1] );
     lr1_mac->max_duty_cycle_index = ( lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1] & 0x0F );
 
     /* Prepare Ans*/
     lr1_mac->tx_fopts_data[lr1_mac->tx_fopts_length] = DUTY_CYCLE_ANS;  // copy Cid
-    lr1_mac->tx_fopts_length += DUTY_CYCLE_ANS_SIZE;
-    lr1_mac->nwk_payload_index += DUTY_CYCLE_REQ_SIZE;
 }
 /**********************************************************************************************************************/
 /*                                                 Private NWK MANAGEMENTS :
  * dev_status_parser                          */
 /**********************************************************************************************************************/
 
-static void dev_status_parser( lr1_stack_mac_t* lr1_mac )
+static void dev_status_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
 {
     uint8_t my_hook_id;
     rp_hook_get_id( lr1_mac->rp, lr1_mac, &my_hook_id );
@@ -1511,14 +2751,12 @@ static void dev_status_parser( lr1_stack_mac_t* lr1_mac )
     lr1_mac->tx_fopts_data[lr1_mac->tx_fopts_length + 1] = bsp_mcu_get_battery_level( );
     lr1_mac->tx_fopts_data[lr1_mac->tx_fopts_length + 2] =
         ( lr1_mac->rp->radio_params[my_hook_id].rx.lora_pkt_status.snr_pkt_in_db ) & 0x3F;
-    lr1_mac->tx_fopts_length += DEV_STATUS_ANS_SIZE;
-    lr1_mac->nwk_payload_index += DEV_STATUS_REQ_SIZE;
 }
 /**********************************************************************************************************************/
 /*                                                 Private NWK MANAGEMENTS :
  * new_channel_parser                         */
 /**********************************************************************************************************************/
-static void new_channel_parser( lr1_stack_mac_t* lr1_mac )
+static void new_channel_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
 {
     BSP_DBG_TRACE_PRINTF(
         " Cmd new_channel_parser = %x %x %x %x %x \n", lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1],
@@ -1590,15 +2828,13 @@ static void new_channel_parser( lr1_stack_mac_t* lr1_mac )
     /* Prepare Ans*/
     lr1_mac->tx_fopts_data[lr1_mac->tx_fopts_length]     = NEW_CHANNEL_ANS;  // copy Cid
     lr1_mac->tx_fopts_data[lr1_mac->tx_fopts_length + 1] = status_ans;
-    lr1_mac->tx_fopts_length += NEW_CHANNEL_ANS_SIZE;
-    lr1_mac->nwk_payload_index += NEW_CHANNEL_REQ_SIZE;
 }
 /*********************************************************************************************************************/
 /*                                                 Private NWK MANAGEMENTS :
  * rx_timing_setup_parser                     */
 /*********************************************************************************************************************/
 
-static void rx_timing_setup_parser( lr1_stack_mac_t* lr1_mac )
+static void rx_timing_setup_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
 {
     BSP_DBG_TRACE_PRINTF( "Cmd rx_timing_setup_parser = %x \n", lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1] );
     lr1_mac->rx1_delay_s = ( lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1] & 0xF );
@@ -1609,8 +2845,6 @@ static void rx_timing_setup_parser( lr1_stack_mac_t* lr1_mac )
 
     /* Prepare Ans*/
     lr1_mac->tx_fopts_datasticky[lr1_mac->tx_fopts_lengthsticky] = RXTIMING_SETUP_ANS;
-    lr1_mac->tx_fopts_lengthsticky += RXTIMING_SETUP_ANS_SIZE;
-    lr1_mac->nwk_payload_index += RXTIMING_SETUP_REQ_SIZE;
 }
 
 /*********************************************************************************************************************/
@@ -1618,7 +2852,7 @@ static void rx_timing_setup_parser( lr1_stack_mac_t* lr1_mac )
  * tx_param_setup_parser                  */
 /*********************************************************************************************************************/
 
-static void tx_param_setup_parser( lr1_stack_mac_t* lr1_mac )
+static void tx_param_setup_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
 {
     BSP_DBG_TRACE_PRINTF( "Cmd tx_param_setup_parser = %x \n", lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1] );
 
@@ -1631,8 +2865,6 @@ static void tx_param_setup_parser( lr1_stack_mac_t* lr1_mac )
 
     /* Prepare Ans*/
     lr1_mac->tx_fopts_datasticky[lr1_mac->tx_fopts_lengthsticky] = TXPARAM_SETUP_ANS;  // copy Cid
-    lr1_mac->tx_fopts_lengthsticky += TXPARAM_SETUP_ANS_SIZE;
-    lr1_mac->nwk_payload_index += TXPARAM_SETUP_REQ_SIZE;
 }
 
 /*********************************************************************************************************************/
@@ -1640,7 +2872,7 @@ static void tx_param_setup_parser( lr1_stack_mac_t* lr1_mac )
  * dl_channel_parser                        */
 /*********************************************************************************************************************/
 
-static void dl_channel_parser( lr1_stack_mac_t* lr1_mac )
+static void dl_channel_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
 {
     BSP_DBG_TRACE_PRINTF(
         "Cmd dl_channel_parser = %x %x %x %x  \n", lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1],
@@ -1676,6 +2908,717 @@ static void dl_channel_parser( lr1_stack_mac_t* lr1_mac )
     /* Prepare Ans*/
     lr1_mac->tx_fopts_datasticky[lr1_mac->tx_fopts_lengthsticky]     = DL_CHANNEL_ANS;
     lr1_mac->tx_fopts_datasticky[lr1_mac->tx_fopts_lengthsticky + 1] = status_ans;
-    lr1_mac->tx_fopts_lengthsticky += DL_CHANNEL_ANS_SIZE;
-    lr1_mac->nwk_payload_index += DL_CHANNEL_REQ_SIZE;
+}
+
+static void device_time_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
+{
+    lr1_stack_mac_device_time_t* time = &lr1_mac->device_time;
+    const uint8_t*               ans  = &lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1];
+    const uint32_t               gps_time_s =
+        ans[0] | ( ( uint32_t ) ans[1] << 8 ) | ( ( uint32_t ) ans[2] << 16 ) | ( ( uint32_t ) ans[3] << 24 );
+    // the fractional second is in 1/256 s
+    const uint64_t gps_time_ms = ( ( uint64_t ) gps_time_s * 1000 ) + ( ( ( ( uint32_t ) ans[4] * 1000 ) + 128 ) >> 8 );
+    // the answer gives the time at the end of the uplink: the Tx done timestamp taken under the radio interrupt, so
+    // neither the time on air nor the latency of the stack process count
+    const uint64_t now_us        = bsp_rtc_get_time_us( );
+    const uint64_t local_time_ms =
+        ( now_us - ( uint32_t )( ( uint32_t ) now_us - lr1_mac->isr_radio_timestamp_us ) + 500 ) / 1000;
+
+    if( time->is_synced == true )
+    {
+        const int64_t elapsed_ms = ( int64_t )( local_time_ms - time->local_time_ms );
+        const int64_t error_ms   = ( int64_t )( gps_time_ms - time->gps_time_ms ) - elapsed_ms;
+
+        if( elapsed_ms < ( ( int64_t ) LR1MAC_DEVICE_TIME_DRIFT_MIN_S * 1000 ) )
+        {
+            // too close to the last answer for the resolution of the fractional second
+        }
+        else if( llabs( error_ms ) > ( ( elapsed_ms * LR1MAC_DEVICE_TIME_DRIFT_MAX_PPB ) / 1000000000 ) )
+        {
+            BSP_DBG_TRACE_WARNING( "DeviceTimeAns %ld s away from the local clock, drift not updated\n",
+                                   ( int32_t )( error_ms / 1000 ) );
+        }
+        else
+        {
+            const int32_t drift_ppb = ( int32_t )( ( error_ms * 1000000000 ) / elapsed_ms );
+
+            // averaged with the previous measure, the fractional second of the answers is only 4 ms accurate
+            time->drift_ppb = ( time->is_drift_known == true ) ? ( ( time->drift_ppb + drift_ppb ) / 2 ) : drift_ppb;
+            time->is_drift_known = true;
+        }
+    }
+    time->gps_time_ms   = gps_time_ms;
+    time->local_time_ms = local_time_ms;
+    time->is_synced     = true;
+    time->is_requested  = false;
+    BSP_DBG_TRACE_PRINTF( " DeviceTimeAns gps time = %lu.%03u s, drift = %ld ppb\n", gps_time_s,
+                          ( uint16_t )( gps_time_ms % 1000 ), time->drift_ppb );
+}
+
+static void ping_slot_info_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
+{
+    BSP_DBG_TRACE_PRINTF( " PingSlotInfoAns, a ping slot every %u s\n", 1 << lr1_mac->class_b.periodicity );
+    lr1_mac->class_b.is_ping_info_requested = false;
+    lr1_mac->class_b.is_ping_info_acked     = true;
+}
+
+static void ping_slot_channel_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
+{
+    uint8_t* req = &lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1];
+    BSP_DBG_TRACE_PRINTF( "Cmd ping_slot_channel_parser = %x %x %x %x\n", req[0], req[1], req[2], req[3] );
+    smtc_real_class_b_params_t params;
+    uint8_t                    status_ans = 0x3;  // initialised for ans answer ok
+    const uint32_t             freq_hz    = smtc_real_decode_freq_from_buf( lr1_mac, req );
+    const uint8_t              dr         = req[3] & 0x0F;
+
+    // a null frequency brings back the default one of the region
+    if( ( freq_hz != 0 ) && ( smtc_real_is_valid_rx_frequency( lr1_mac, freq_hz ) == ERRORLORAWAN ) )
+    {
+        status_ans &= 0x2;
+        BSP_DBG_TRACE_MSG( "INVALID FREQUENCY\n" );
+    }
+    if( smtc_real_class_b_params_get( lr1_mac, 0, dr, &params ) == ERRORLORAWAN )
+    {
+        status_ans &= 0x1;
+        BSP_DBG_TRACE_MSG( "INVALID DATARATE\n" );
+    }
+    if( status_ans == 0x3 )
+    {
+        lr1_mac->class_b.ping_freq_hz = freq_hz;
+        lr1_mac->class_b.ping_dr      = dr;
+    }
+
+    lr1_mac->tx_fopts_datasticky[lr1_mac->tx_fopts_lengthsticky]     = PING_SLOT_CHANNEL_ANS;
+    lr1_mac->tx_fopts_datasticky[lr1_mac->tx_fopts_lengthsticky + 1] = status_ans;
+}
+
+static void beacon_freq_parser( lr1_stack_mac_t* lr1_mac, uint8_t nb_req )
+{
+    uint8_t* req = &lr1_mac->nwk_payload[lr1_mac->nwk_payload_index + 1];
+    BSP_DBG_TRACE_PRINTF( "Cmd beacon_freq_parser = %x %x %x\n", req[0], req[1], req[2] );
+    uint8_t        status_ans = 0x1;  // initialised for ans answer ok
+    const uint32_t freq_hz    = smtc_real_decode_freq_from_buf( lr1_mac, req );
+
+    // a null frequency brings back the default one of the region
+    if( ( freq_hz != 0 ) && ( smtc_real_is_valid_rx_frequency( lr1_mac, freq_hz ) == ERRORLORAWAN ) )
+    {
+        status_ans = 0;
+        BSP_DBG_TRACE_MSG( "INVALID FREQUENCY\n" );
+    }
+    else
+    {
+        lr1_mac->class_b.beacon_freq_hz = freq_hz;
+    }
+
+    lr1_mac->tx_fopts_data[lr1_mac->tx_fopts_length]     = BEACON_FREQ_ANS;
+    lr1_mac->tx_fopts_data[lr1_mac->tx_fopts_length + 1] = status_ans;
+}
+
+static void device_time_fopts_add( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_stack_mac_device_time_t* time = &lr1_mac->device_time;
+
+    if( ( time->is_synced == true ) &&
+        ( ( bsp_rtc_get_time_ms64( ) - time->local_time_ms ) >= ( ( uint64_t ) LR1MAC_DEVICE_TIME_RESYNC_S * 1000 ) ) )
+    {
+        time->is_requested = true;
+    }
+    if( ( time->is_requested == true ) && ( time->is_in_fopts == false ) &&
+        ( lr1_mac->tx_fopts_current_length < LR1MAC_FOPTS_MAX_SIZE ) )
+    {
+        lr1_mac->tx_fopts_current_data[lr1_mac->tx_fopts_current_length] = DEVICE_TIME_REQ;
+        lr1_mac->tx_fopts_current_length += DEVICE_TIME_REQ_SIZE;
+        time->is_in_fopts = true;
+    }
+}
+
+static void link_check_fopts_add( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_stack_mac_link_check_t* check = &lr1_mac->link_check;
+
+    if( ( check->enabled == false ) || ( check->is_in_fopts == true ) )
+    {
+        return;
+    }
+    if( check->is_pending == true )
+    {
+        check->is_pending = false;
+        link_check_update( lr1_mac, false );
+    }
+    check->uplink_cnt++;
+    if( ( check->uplink_cnt >= check->period ) && ( lr1_mac->tx_fopts_current_length < LR1MAC_FOPTS_MAX_SIZE ) )
+    {
+        // no payload in a LinkCheckReq
+        lr1_mac->tx_fopts_current_data[lr1_mac->tx_fopts_current_length] = LINK_CHECK_REQ;
+        lr1_mac->tx_fopts_current_length += 1;
+        check->is_in_fopts = true;
+        check->is_pending  = true;
+        check->uplink_cnt  = 0;
+    }
+}
+
+static void link_check_update( lr1_stack_mac_t* lr1_mac, bool is_answered )
+{
+    lr1_stack_mac_link_check_t* check = &lr1_mac->link_check;
+
+    if( ( is_answered == true ) && ( check->margin_db >= LR1MAC_LINK_CHECK_WEAK_MARGIN_DB ) )
+    {
+        // a good link is checked less and less often
+        check->miss_cnt = 0;
+        check->state    = LR1MAC_LINK_STATE_GOOD;
+        check->period   = MIN( check->period * 2, LR1MAC_LINK_CHECK_PERIOD_MAX );
+        return;
+    }
+
+    check->period = LR1MAC_LINK_CHECK_PERIOD_MIN;
+    if( is_answered == true )
+    {
+        check->miss_cnt = 0;
+    }
+    else if( check->miss_cnt < 0xFF )
+    {
+        check->miss_cnt++;
+    }
+    if( check->miss_cnt >= LR1MAC_LINK_CHECK_LOST_MISSES )
+    {
+        check->state = LR1MAC_LINK_STATE_LOST;
+    }
+    else
+    {
+        // the next uplinks are sent at a more robust datarate, and at full power
+        check->state = LR1MAC_LINK_STATE_WEAK;
+        smtc_real_dr_decrement( lr1_mac );
+    }
+    BSP_DBG_TRACE_WARNING( "Link check: state %u, margin %u dB, %u gw, %u requests unanswered\n", check->state,
+                           check->margin_db, check->gw_cnt, check->miss_cnt );
+}
+
+static void ping_info_fopts_add( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_stack_mac_class_b_t* class_b = &lr1_mac->class_b;
+
+    if( ( class_b->is_ping_info_requested == true ) && ( class_b->is_ping_info_in_fopts == false ) &&
+        ( ( lr1_mac->tx_fopts_current_length + PING_SLOT_INFO_REQ_SIZE ) <= LR1MAC_FOPTS_MAX_SIZE ) )
+    {
+        lr1_mac->tx_fopts_current_data[lr1_mac->tx_fopts_current_length]     = PING_SLOT_INFO_REQ;
+        lr1_mac->tx_fopts_current_data[lr1_mac->tx_fopts_current_length + 1] = class_b->periodicity;
+        lr1_mac->tx_fopts_current_length += PING_SLOT_INFO_REQ_SIZE;
+        class_b->is_ping_info_in_fopts = true;
+    }
+}
+
+static void class_b_params_get( lr1_stack_mac_t* lr1_mac, uint32_t beacon_time_s, smtc_real_class_b_params_t* params )
+{
+    const lr1_stack_mac_class_b_t* class_b = &lr1_mac->class_b;
+
+    // the datarate set by the network was checked by the PingSlotChannelReq
+    smtc_real_class_b_params_get( lr1_mac, beacon_time_s, class_b->ping_dr, params );
+    if( class_b->beacon_freq_hz != 0 )
+    {
+        params->beacon_freq_hz = class_b->beacon_freq_hz;
+    }
+    if( class_b->ping_freq_hz != 0 )
+    {
+        params->ping_freq_hz = class_b->ping_freq_hz;
+    }
+}
+
+static bool class_b_local_time_get( lr1_stack_mac_t* lr1_mac, uint64_t gps_time_ms, uint32_t* local_time_ms,
+                                    uint32_t* half_window_ms )
+{
+    const lr1_stack_mac_class_b_t* class_b = &lr1_mac->class_b;
+    uint64_t                       now_gps_ms;
+
+    if( class_b->state == LR1MAC_CLASS_B_STATE_TRACKING )
+    {
+        const int64_t elapsed_ms = ( int64_t )( gps_time_ms - ( ( uint64_t ) class_b->anchor_time_s * 1000 ) );
+
+        *local_time_ms =
+            class_b->anchor_local_ms + ( uint32_t )( elapsed_ms + ( ( elapsed_ms * class_b->drift_ppm ) / 1000000 ) );
+        *half_window_ms =
+            LR1MAC_CLASS_B_WINDOW_MIN_MS + ( uint32_t )( ( llabs( elapsed_ms ) * class_b->uncertainty_ppm ) / 1000000 );
+        return true;
+    }
+    if( lr1_stack_mac_network_time_get( lr1_mac, &now_gps_ms ) != OKLORAWAN )
+    {
+        return false;
+    }
+    // the DeviceTimeAns is a few ms accurate, the RTC drifts from it until the next one
+    const uint64_t sync_elapsed_ms = bsp_rtc_get_time_ms64( ) - lr1_mac->device_time.local_time_ms;
+
+    *local_time_ms  = bsp_rtc_get_time_ms( ) + ( uint32_t )( int64_t )( gps_time_ms - now_gps_ms );
+    *half_window_ms = ( ( class_b->miss_cnt < 8 ) ? MIN( LR1MAC_CLASS_B_ACQ_WINDOW_MS << class_b->miss_cnt,
+                                                         LR1MAC_CLASS_B_ACQ_WINDOW_MAX_MS )
+                                                  : LR1MAC_CLASS_B_ACQ_WINDOW_MAX_MS ) +
+                      ( uint32_t )( ( sync_elapsed_ms * LR1MAC_CLASS_B_DRIFT_MAX_PPM ) / 1000000 );
+    return true;
+}
+
+static uint32_t class_b_beacon_toa_ms( const smtc_real_class_b_params_t* params )
+{
+    const uint8_t sf = params->beacon_sf;
+    // low datarate optimization for the symbols of 16 ms and more, SF11 and SF12 on 125 kHz
+    const uint8_t row_bits = 4 * ( sf - ( ( ( params->beacon_bw == BW125 ) && ( sf >= 11 ) ) ? 2 : 0 ) );
+    // implicit header and no CRC
+    const int16_t  pld_bits = ( 8 * params->beacon_size ) - ( 4 * sf ) + 8;
+    const uint16_t rows     = ( pld_bits > 0 ) ? ( ( pld_bits + row_bits - 1 ) / row_bits ) : 0;
+    // in quarters of symbol: the preamble, 4.25 symbols of sync word and start of frame, 8 symbols then 5 per row
+    const uint16_t quarters = ( 4 * LR1MAC_CLASS_B_BEACON_PREAMBLE ) + 17 + 32 + ( 20 * rows );
+
+    return ( lr1mac_utilities_get_symb_time_us( quarters, ( ral_lora_sf_t ) sf, ( ral_lora_bw_t ) params->beacon_bw ) +
+             2000 ) /
+           4000;
+}
+
+static uint16_t class_b_ping_offset_get( lr1_stack_mac_t* lr1_mac, uint32_t beacon_time_s )
+{
+    uint8_t block[16] = { 0 };
+    uint8_t rand[16];
+
+    block[0] = ( uint8_t ) beacon_time_s;
+    block[1] = ( uint8_t )( beacon_time_s >> 8 );
+    block[2] = ( uint8_t )( beacon_time_s >> 16 );
+    block[3] = ( uint8_t )( beacon_time_s >> 24 );
+    block[4] = ( uint8_t ) lr1_mac->dev_addr;
+    block[5] = ( uint8_t )( lr1_mac->dev_addr >> 8 );
+    block[6] = ( uint8_t )( lr1_mac->dev_addr >> 16 );
+    block[7] = ( uint8_t )( lr1_mac->dev_addr >> 24 );
+    crypto_backend_block_encrypt( &lr1_mac->class_b.ping_key_ctx, block, rand );
+    // modulo the ping period, a power of 2
+    return ( rand[0] + ( rand[1] << 8 ) ) & ( ( 1 << ( 5 + lr1_mac->class_b.periodicity ) ) - 1 );
+}
+
+static bool class_b_ping_slot_get( lr1_stack_mac_t* lr1_mac, uint32_t beacon_time_s, uint32_t* slot_ms,
+                                   uint32_t* half_window_ms )
+{
+    lr1_stack_mac_class_b_t* class_b     = &lr1_mac->class_b;
+    const uint16_t           ping_period = 1 << ( 5 + class_b->periodicity );  // in slots
+    const uint32_t           now_ms      = bsp_rtc_get_time_ms( );
+
+    if( class_b->ping_time_s != beacon_time_s )
+    {
+        class_b->ping_offset = class_b_ping_offset_get( lr1_mac, beacon_time_s );
+        class_b->ping_time_s = beacon_time_s;
+    }
+    // the last slot ends before the beacon guard, a ping slot never overlaps a beacon window while tracked
+    for( uint16_t slot = class_b->ping_offset; slot < LR1MAC_CLASS_B_PING_SLOT_NB; slot += ping_period )
+    {
+        const uint64_t slot_gps_ms = ( ( uint64_t ) beacon_time_s * 1000 ) + LR1MAC_CLASS_B_BEACON_RESERVED_MS +
+                                     ( ( uint32_t ) slot * LR1MAC_CLASS_B_PING_SLOT_MS );
+
+        class_b_local_time_get( lr1_mac, slot_gps_ms, slot_ms, half_window_ms );
+        if( ( int32_t )( *slot_ms - *half_window_ms - now_ms ) >= LR1MAC_CLASS_B_SCHEDULE_MARGIN_MS )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void lbt_cad_start( lr1_stack_mac_t* lr1_mac, const rp_radio_params_t* tx_radio_params, uint8_t hook_id )
+{
+    rp_radio_params_t radio_params = { 0 };
+
+    radio_params.pkt_type = RAL_PKT_TYPE_LORA;
+    radio_params.rx.lora  = tx_radio_params->tx.lora;
+
+    const uint32_t cad_duration_us =
+        lr1mac_utilities_get_symb_time_us( LBT_CAD_DURATION_SYMB, radio_params.rx.lora.sf, radio_params.rx.lora.bw );
+    radio_params.reg_mode = radio_reg_mode_get( cad_duration_us / 1000 );
+    radio_params.lna_mode = radio_lna_mode_get( lr1_mac, radio_params.rx.lora.sf, radio_params.rx.lora.bw );
+
+    // the first CAD is done as soon as possible, the next ones after their backoff
+    const bool is_backoff = ( lr1_mac->lbt_cad_cnt > 0 ) &&
+                            ( ( int32_t )( lr1_mac->rtc_target_timer_ms - bsp_rtc_get_time_ms( ) ) > 0 );
+
+    rp_task_t rp_task = {
+        .hook_id          = hook_id,
+        .type             = RP_TASK_TYPE_CAD,
+        .state            = ( is_backoff == true ) ? RP_TASK_STATE_SCHEDULE : RP_TASK_STATE_ASAP,
+        .start_time_ms    = lr1_mac->rtc_target_timer_ms,
+        .duration_time_ms = ( cad_duration_us / 1000 ) + 1,
+    };
+
+    if( rp_task_enqueue( lr1_mac->rp, &rp_task, &lr1_mac->tx_payload[lr1_mac->tx_frame_offset],
+                         lr1_mac->tx_payload_size, &radio_params ) == RP_HOOK_STATUS_OK )
+    {
+        BSP_DBG_TRACE_PRINTF( "  CAD LoRa at %u ms: freq:%lu, SF%u, %s\n", rp_task.start_time_ms,
+                              radio_params.rx.lora.freq_in_hz, radio_params.rx.lora.sf,
+                              name_bw[radio_params.rx.lora.bw] );
+        lr1_mac->radio_process_state = RADIOSTATE_CADON;
+    }
+    else
+    {
+        BSP_DBG_TRACE_PRINTF( "Radio planner hook %d is busy \n", hook_id );
+    }
+}
+
+static void lbt_cad_done( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_mac->radio_process_state = RADIOSTATE_IDLE;
+
+    switch( lr1_mac->planner_status )
+    {
+    case RP_STATUS_CAD_NEGATIVE:
+        lr1_mac->lbt_is_channel_clear = true;
+        break;
+
+    case RP_STATUS_CAD_POSITIVE:
+        smtc_real_channel_stats_update( lr1_mac, SMTC_REAL_CHANNEL_EVENT_CAD_BUSY );
+        lr1_mac->lbt_cad_cnt++;
+        if( lr1_mac->lbt_cad_cnt >= LBT_MAX_CAD_ATTEMPTS )
+        {
+            // WW2G4 does not require LBT: too many busy CADs must not hold the uplink forever
+            BSP_DBG_TRACE_WARNING( "LBT: channel still busy after %u CAD, send anyway\n", lr1_mac->lbt_cad_cnt );
+            lr1_mac->lbt_is_channel_clear = true;
+            break;
+        }
+        // another channel after a random backoff, the frame is unchanged: the channel is not part of the MIC
+        if( ( ( lr1_mac->tx_mtype == JOIN_REQUEST ) ? smtc_real_join_next_channel_get( lr1_mac )
+                                                    : smtc_real_next_channel_get( lr1_mac ) ) != OKLORAWAN )
+        {
+            BSP_DBG_TRACE_WARNING( "LBT: no other channel, keep freq:%lu\n", lr1_mac->tx_frequency );
+        }
+        lr1_mac->rtc_target_timer_ms =
+            bsp_rtc_get_time_ms( ) + bsp_rng_get_random_in_range( LBT_BACKOFF_MIN_MS, LBT_BACKOFF_MAX_MS );
+        BSP_DBG_TRACE_PRINTF( "LBT: channel busy, CAD %u in %lu ms\n", lr1_mac->lbt_cad_cnt + 1,
+                              lr1_mac->rtc_target_timer_ms - bsp_rtc_get_time_ms( ) );
+        break;
+
+    default:
+        // CAD aborted by a higher priority hook: lr1mac_core_process starts it again on the radio idle state
+        return;
+    }
+    lr1_stack_mac_tx_radio_start( lr1_mac );
+}
+
+static uint32_t join_backoff_s_get( uint32_t retry_join_cpt )
+{
+    if( retry_join_cpt == 0 )
+    {  // first join request: only spread the devices started together
+        return bsp_rng_get_random_in_range( 0, JOIN_BACKOFF_BASE_S );
+    }
+    uint32_t backoff_s = JOIN_BACKOFF_BASE_S << MIN( retry_join_cpt - 1, JOIN_BACKOFF_MAX_EXPONENT );
+
+    return ( backoff_s >> 1 ) + bsp_rng_get_random_in_range( 0, backoff_s >> 1 );
+}
+
+/*!
+ * \brief   Check that a CAD at the start of the RX window catches the downlink preamble
+ * \remark  The window is centered on the 4th preamble symbol, its start is only known to the ms. The preamble must
+ *          already be on air at the CAD start for the latest downlink, and must still last the CAD plus
+ *          RX_CAD_GATE_LOCK_SYMB symbols after it for the earliest one. It holds for the narrow windows at the slow
+ *          data rates, where the CAD saves the most.
+ */
+static bool rx_cad_gate_is_safe( const lr1_stack_mac_t* lr1_mac, const ral_params_lora_t* lora )
+{
+    const uint32_t symb_us = lr1mac_utilities_get_symb_time_us( 1, lora->sf, lora->bw );
+    const int32_t  window_us =
+        ( int32_t ) lr1mac_utilities_get_symb_time_us( lr1_mac->rx_window_symb, lora->sf, lora->bw );
+    // time error covered by the window, plus the rounding of its start to the ms
+    const int32_t error_us = ( ( window_us - ( int32_t )( 5 * symb_us ) ) / 2 ) + 1000;
+    // window start after the expected preamble start
+    const int32_t start_us = ( int32_t )( 4 * symb_us ) - ( window_us / 2 );
+
+    return ( start_us >= error_us ) &&
+           ( ( start_us + error_us + ( int32_t )( ( RX_CAD_GATE_SYMB + RX_CAD_GATE_LOCK_SYMB ) * symb_us ) ) <=
+             ( int32_t )( lora->pbl_len_in_symb * symb_us ) );
+}
+
+static void rx_radio_params_build( lr1_stack_mac_t* lr1_mac, const rx_win_type_t type, rp_radio_params_t* radio_params )
+{
+    if( ( ( type == RX1 ) && ( lr1_mac->rx1_modulation_type == LORA ) ) ||
+        ( ( type == RX2 ) && ( lr1_mac->rx2_modulation_type == LORA ) ) )
+    {
+        radio_params->pkt_type                 = RAL_PKT_TYPE_LORA;
+        radio_params->rx.lora.cr               = smtc_real_coding_rate_get( lr1_mac );
+        radio_params->rx.lora.sync_word        = smtc_real_sync_word_get( lr1_mac );
+        radio_params->rx.lora.crc_is_on        = false;
+        radio_params->rx.lora.invert_iq_is_on  = true;
+        radio_params->rx.lora.pld_is_fix       = false;
+        radio_params->rx.lora.pld_len_in_bytes = 255;
+        // a longer window is only bounded by its timeout
+        radio_params->rx.lora.symb_nb_timeout =
+            ( lr1_mac->rx_window_symb <= UINT8_MAX ) ? ( uint8_t ) lr1_mac->rx_window_symb : 0;
+#if defined( SX1280 )
+        radio_params->rx.timeout_in_ms = MAX( lr1_mac->rx_timeout_ms, BSP_MIN_RX_TIMEOUT_DELAY_MS );
+#elif defined( SX126X )
+        radio_params->rx.timeout_in_ms = 3000;
+#else
+#error "Please select radio board.."
+#endif
+
+        switch( type )
+        {
+        case RX1:
+            radio_params->rx.lora.sf         = ( ral_lora_sf_t ) lr1_mac->rx1_sf;
+            radio_params->rx.lora.bw         = ( ral_lora_bw_t ) lr1_mac->rx1_bw;
+            radio_params->rx.lora.freq_in_hz = lr1_mac->rx1_frequency;
+            break;
+
+        case RX2:
+            radio_params->rx.lora.sf         = ( ral_lora_sf_t ) lr1_mac->rx2_sf;
+            radio_params->rx.lora.bw         = ( ral_lora_bw_t ) lr1_mac->rx2_bw;
+            radio_params->rx.lora.freq_in_hz = lr1_mac->rx2_frequency;
+            break;
+
+        default:
+            BSP_DBG_TRACE_ERROR( " RX windows unknow \n" );
+            bsp_mcu_handle_lr1mac_issue( );
+            break;
+        }
+        radio_params->rx.lora.pbl_len_in_symb = smtc_real_preamble_get( lr1_mac, radio_params->rx.lora.sf );
+
+        // without a preamble the window is closed after rx_window_symb, most windows end there
+        const uint32_t window_us = lr1mac_utilities_get_symb_time_us(
+            lr1_mac->rx_window_symb, radio_params->rx.lora.sf, radio_params->rx.lora.bw );
+        radio_params->reg_mode = radio_reg_mode_get( window_us / 1000 );
+        radio_params->lna_mode = radio_lna_mode_get( lr1_mac, radio_params->rx.lora.sf, radio_params->rx.lora.bw );
+        radio_params->rx.cad_gate_is_on =
+            ( lr1_mac->rx_cad_gate_enable == 1 ) && rx_cad_gate_is_safe( lr1_mac, &radio_params->rx.lora );
+    }
+    else if( ( ( type == RX1 ) && ( lr1_mac->rx1_modulation_type == FSK ) ) ||
+             ( ( type == RX2 ) && ( lr1_mac->rx2_modulation_type == FSK ) ) )
+    {
+        radio_params->pkt_type                       = RAL_PKT_TYPE_GFSK;
+        radio_params->rx.gfsk.pbl_len_in_bytes       = 5;
+        radio_params->rx.gfsk.sync_word_len_in_bytes = 3;
+        radio_params->rx.gfsk.sync_word              = smtc_real_gfsk_sync_word_get( lr1_mac );
+        radio_params->rx.gfsk.pld_is_fix             = false;
+        radio_params->rx.gfsk.pld_len_in_bytes       = 255;
+        radio_params->rx.gfsk.dc_free_is_on          = true;
+        radio_params->rx.gfsk.whitening_seed         = GFSK_WHITENING_SEED;
+        radio_params->rx.gfsk.crc_type               = RAL_GFSK_CRC_2_BYTES_INV;
+        radio_params->rx.gfsk.crc_seed               = GFSK_CRC_SEED;
+        radio_params->rx.gfsk.crc_polynomial         = GFSK_CRC_POLYNOMIAL;
+        radio_params->rx.timeout_in_ms               = lr1_mac->rx_timeout_ms;
+        radio_params->reg_mode                       = radio_reg_mode_get( lr1_mac->rx_timeout_ms );
+
+        switch( type )
+        {
+        case RX1:
+            radio_params->rx.gfsk.freq_in_hz   = lr1_mac->rx1_frequency;
+            radio_params->rx.gfsk.br_in_bps    = lr1_mac->rx1_sf * 1000;
+            radio_params->rx.gfsk.bw_ssb_in_hz = lr1_mac->rx1_sf * 1000;
+            break;
+
+        case RX2:
+            radio_params->rx.gfsk.freq_in_hz   = lr1_mac->rx2_frequency;
+            radio_params->rx.gfsk.br_in_bps    = lr1_mac->rx2_sf * 1000;
+            radio_params->rx.gfsk.bw_ssb_in_hz = lr1_mac->rx2_sf * 1000;
+            break;
+
+        default:
+            BSP_DBG_TRACE_ERROR( " RX windows unknow \n" );
+            bsp_mcu_handle_lr1mac_issue( );
+            break;
+        }
+    }
+    else
+    {
+        BSP_DBG_TRACE_ERROR( " MODULATION NOT SUPPORTED\n" );
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+}
+
+static void rx_drift_update( lr1_stack_mac_t* lr1_mac, const rx_win_type_t type, const uint32_t rx_done_us )
+{
+    lr1_stack_mac_rx_drift_t* drift  = &lr1_mac->rx_drift;
+    const bool                is_rx1 = ( type == RX1 );
+
+    drift->miss_cnt = 0;
+    if( ( is_rx1 ? lr1_mac->rx1_modulation_type : lr1_mac->rx2_modulation_type ) != LORA )
+    {
+        return;
+    }
+
+    // the network sends at the end of the tx plus the rx delay: the downlink ends one time on air later. Downlinks
+    // have no CRC, 2 bytes less compensate the CRC bits counted by the time on air
+    const ral_lora_sf_t sf       = ( ral_lora_sf_t )( is_rx1 ? lr1_mac->rx1_sf : lr1_mac->rx2_sf );
+    const ral_lora_bw_t bw       = ( ral_lora_bw_t )( is_rx1 ? lr1_mac->rx1_bw : lr1_mac->rx2_bw );
+    const uint32_t      delay_ms = ( lr1_mac->rx1_delay_s * 1000 ) + ( is_rx1 ? 0 : 1000 );
+    const uint32_t      toa_us   = lr1mac_utilities_get_lora_toa_us(
+        ( lr1_mac->rx_payload_size >= 2 ) ? lr1_mac->rx_payload_size - 2 : 0, sf, bw,
+        smtc_real_coding_rate_get( lr1_mac ), smtc_real_preamble_get( lr1_mac, sf ) );
+    if( toa_us == 0 )
+    {
+        return;
+    }
+    const int32_t error_us =
+        ( int32_t )( rx_done_us - ( lr1_mac->isr_radio_timestamp_us + ( delay_ms * 1000 ) + toa_us ) );
+
+    if( drift->sample_cnt == 0 )
+    {
+        drift->error_us  = error_us;
+        drift->spread_us = 0;
+    }
+    else
+    {
+        // exponential averages, 1/4 weight for the new sample
+        const int32_t diff_us      = error_us - drift->error_us;
+        const int32_t deviation_us = ( diff_us >= 0 ) ? diff_us : -diff_us;
+
+        drift->error_us += diff_us / 4;
+        drift->spread_us = ( uint32_t )( ( int32_t ) drift->spread_us +
+                                         ( ( deviation_us - ( int32_t ) drift->spread_us ) / 4 ) );
+    }
+    if( drift->sample_cnt < LR1MAC_RX_DRIFT_MIN_SAMPLES )
+    {
+        drift->sample_cnt++;
+    }
+    BSP_DBG_TRACE_PRINTF( "  RX timing error %ld us, model %ld us +/- %lu us\n", error_us, drift->error_us,
+                          drift->spread_us );
+}
+
+static void rx_drift_miss( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_stack_mac_rx_drift_t* drift = &lr1_mac->rx_drift;
+
+    // the unconfirmed uplinks don't expect a downlink, their empty windows tell nothing about the timing
+    if( ( lr1_mac->tx_mtype != JOIN_REQUEST ) && ( lr1_mac->tx_mtype != CONF_DATA_UP ) )
+    {
+        return;
+    }
+    drift->miss_cnt++;
+    if( drift->miss_cnt >= LR1MAC_RX_DRIFT_MAX_MISSES )
+    {
+        if( drift->sample_cnt > 0 )
+        {  // back to the windows sized for the worst case clock error until new downlinks are measured
+            BSP_DBG_TRACE_WARNING( "RX timing model dropped after %u missed answers\n", drift->miss_cnt );
+            drift->sample_cnt = 0;
+        }
+        drift->miss_cnt = 0;
+    }
+}
+
+static ral_reg_mode_t radio_reg_mode_get( uint32_t radio_on_ms )
+{
+    return ( radio_on_ms >= LR1MAC_DCDC_MIN_RADIO_ON_MS ) ? RAL_REG_MODE_DCDC : RAL_REG_MODE_LDO;
+}
+
+static int16_t lora_sensitivity_dbm( ral_lora_sf_t sf, ral_lora_bw_t bw )
+{
+    // thermal noise, 10.log10( bw ), 6 dB noise figure and the demodulation SNR of the sf
+    int16_t bw_db;
+    switch( bw )
+    {
+    case RAL_LORA_BW_125_KHZ:
+        bw_db = 51;
+        break;
+    case RAL_LORA_BW_200_KHZ:
+        bw_db = 53;
+        break;
+    case RAL_LORA_BW_250_KHZ:
+        bw_db = 54;
+        break;
+    case RAL_LORA_BW_400_KHZ:
+        bw_db = 56;
+        break;
+    case RAL_LORA_BW_500_KHZ:
+        bw_db = 57;
+        break;
+    case RAL_LORA_BW_1600_KHZ:
+        bw_db = 62;
+        break;
+    default:  // RAL_LORA_BW_800_KHZ
+        bw_db = 59;
+        break;
+    }
+    return -174 + bw_db + 6 + lora_snr_floor_db( sf );
+}
+
+static ral_lna_mode_t radio_lna_mode_get( lr1_stack_mac_t* lr1_mac, ral_lora_sf_t sf, ral_lora_bw_t bw )
+{
+    // no downlink yet, or none for a while: the last rssi doesn't tell the current link margin
+    if( ( lr1_mac->join_status != JOINED ) || ( lr1_mac->adr_ack_cnt >= lr1_mac->adr_ack_limit ) )
+    {
+        return RAL_LNA_MODE_HIGH_SENSITIVITY;
+    }
+
+    return ( ( lr1_mac->rx_rssi - lora_sensitivity_dbm( sf, bw ) ) < LR1MAC_LNA_MIN_MARGIN_DB )
+               ? RAL_LNA_MODE_HIGH_SENSITIVITY
+               : RAL_LNA_MODE_LOW_POWER;
+}
+
+static int8_t tx_power_get( lr1_stack_mac_t* lr1_mac )
+{
+    const lr1_stack_mac_tx_power_ctrl_t* ctrl = &lr1_mac->tx_power_ctrl;
+
+    if( ( ctrl->enabled == false ) || ( ctrl->is_known == false ) || ( lr1_mac->tx_modulation_type != LORA ) )
+    {
+        return lr1_mac->tx_power;
+    }
+    // the gateway receives the uplink at tx power - path loss, kept above its sensitivity
+    const int16_t sensitivity_dbm =
+        lora_sensitivity_dbm( ( ral_lora_sf_t ) lr1_mac->tx_sf, ( ral_lora_bw_t ) lr1_mac->tx_bw );
+    const int16_t needed_dbm = sensitivity_dbm + LR1MAC_TX_POWER_CTRL_MARGIN_DB + ctrl->path_loss_db;
+
+    return ( int8_t ) MAX( MIN( needed_dbm, lr1_mac->tx_power ), LR1MAC_TX_POWER_CTRL_MIN_DBM );
+}
+
+static void tx_power_ctrl_update( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_stack_mac_tx_power_ctrl_t* ctrl         = &lr1_mac->tx_power_ctrl;
+    const int16_t                  path_loss_db = ctrl->gw_eirp_dbm - lr1_mac->rx_rssi;
+
+    // a worse path loss is taken at once, a better one is averaged over a few downlinks
+    if( ( ctrl->is_known == false ) || ( path_loss_db > ctrl->path_loss_db ) )
+    {
+        ctrl->path_loss_db = path_loss_db;
+    }
+    else
+    {
+        ctrl->path_loss_db = ( ( 3 * ctrl->path_loss_db ) + path_loss_db ) / 4;
+    }
+    ctrl->is_known = true;
+}
+
+static lr1_stack_mac_downlink_t* downlink_tail_get( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_stack_mac_downlink_fifo_t* fifo = &lr1_mac->downlink_fifo;
+
+    // one slot is kept for the last downlink read, its reader may still use it
+    if( fifo->count == ( LR1MAC_DOWNLINK_FIFO_DEPTH - 1 ) )
+    {  // the application didn't read them fast enough, keep the newest ones
+        BSP_DBG_TRACE_WARNING( " Downlink fifo full, oldest downlink lost\n" );
+        fifo->head = ( fifo->head + 1 ) % LR1MAC_DOWNLINK_FIFO_DEPTH;
+        fifo->count--;
+        fifo->lost++;
+    }
+    return &fifo->entries[( fifo->head + fifo->count ) % LR1MAC_DOWNLINK_FIFO_DEPTH];
+}
+
+static void downlink_push( lr1_stack_mac_t* lr1_mac )
+{
+    lr1_stack_mac_downlink_fifo_t* fifo     = &lr1_mac->downlink_fifo;
+    lr1_stack_mac_downlink_t*      downlink = downlink_tail_get( lr1_mac );
+
+    downlink->fport = lr1_mac->rx_fport;
+    downlink->size  = lr1_mac->rx_payload_size;
+    downlink->snr   = lr1_mac->rx_snr;
+    downlink->rssi  = lr1_mac->rx_rssi;
+    fifo->count++;
+
+    lr1_mac->available_app_packet = LORA_RX_PACKET_AVAILABLE;
+}
+
+static bool tx_fopts_current_set( lr1_stack_mac_t* lr1_mac )
+{
+    if( ( lr1_mac->tx_fopts_length + lr1_mac->tx_fopts_lengthsticky ) > 15 )
+    {
+        return false;
+    }
+    lr1_mac->tx_fopts_current_length = lr1_mac->tx_fopts_lengthsticky + lr1_mac->tx_fopts_length;
+    lr1_mac->device_time.is_in_fopts = false;
+    lr1_mac->link_check.is_in_fopts  = false;
+    lr1_mac->class_b.is_ping_info_in_fopts = false;
+    memcpy( lr1_mac->tx_fopts_current_data, lr1_mac->tx_fopts_datasticky, lr1_mac->tx_fopts_lengthsticky );
+    memcpy( lr1_mac->tx_fopts_current_data + lr1_mac->tx_fopts_lengthsticky, lr1_mac->tx_fopts_data,
+            lr1_mac->tx_fopts_length );
+    return true;
+}
+
+static uint8_t journal_key_get( const lr1_stack_mac_t* lr1_mac, uint8_t key )
+{
+    return key + ( lr1_mac->stack_id * BSP_NVM_JOURNAL_KEY_LORAWAN_STRIDE );
 }
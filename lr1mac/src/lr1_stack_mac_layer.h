@@ -41,14 +41,164 @@ extern "C" {
 #include "lr1mac_defs.h"
 #include "radio_planner.h"
 #include "smtc_real_defs.h"
+#include "crypto.h"
 
 /*
  *-----------------------------------------------------------------------------------
  * --- PUBLIC TYPES -----------------------------------------------------------------
  */
+typedef struct lr1_stack_mac_downlink_s
+{
+    uint8_t fport;
+    uint8_t size;
+    int16_t snr;
+    int16_t rssi;
+    uint8_t payload[LR1MAC_DOWNLINK_MAX_SIZE];
+} lr1_stack_mac_downlink_t;
+
+typedef struct lr1_stack_mac_downlink_fifo_s
+{
+    lr1_stack_mac_downlink_t entries[LR1MAC_DOWNLINK_FIFO_DEPTH];
+    uint8_t                  head;  // oldest downlink, next one read by the application
+    uint8_t                  count;
+    uint32_t                 lost;  // downlinks overwritten before being read
+} lr1_stack_mac_downlink_fifo_t;
+
+/*!
+ * Timing error of the downlinks against their expected end, the RX windows are centered on it
+ */
+typedef struct lr1_stack_mac_rx_drift_s
+{
+    int32_t  error_us;    // mean error, positive when the downlinks end later than expected
+    uint32_t spread_us;   // mean deviation around error_us
+    uint8_t  sample_cnt;  // downlinks measured, saturated at LR1MAC_RX_DRIFT_MIN_SAMPLES
+    uint8_t  miss_cnt;    // uplinks in a row without their answer (join accept, ack)
+} lr1_stack_mac_rx_drift_t;
+
+/*!
+ * Link margin samples of the LINK_MARGIN_ADR_MODE
+ */
+typedef struct lr1_stack_mac_link_margin_s
+{
+    int8_t  snr_db[LR1MAC_LINK_MARGIN_WINDOW];  // SNR the uplinks would get at full power
+    uint8_t sample_nb;
+    uint8_t sample_idx;  // next sample slot
+    bool    is_updated;  // sample added since the last choice of datarate and power
+} lr1_stack_mac_link_margin_t;
+
+/*!
+ * Uplink power control from the path loss of the downlinks
+ */
+typedef struct lr1_stack_mac_tx_power_ctrl_s
+{
+    bool    enabled;
+    bool    is_known;      // path loss measured since the last downlink gap
+    int8_t  gw_eirp_dbm;   // gateway downlink EIRP, the path loss is measured against it
+    int16_t path_loss_db;  // worst recent path loss, raised at once and lowered slowly
+} lr1_stack_mac_tx_power_ctrl_t;
+
+/*!
+ * Network time from the DeviceTimeAns, against the radio timestamps
+ */
+typedef struct lr1_stack_mac_device_time_s
+{
+    bool     is_requested;    // DeviceTimeReq added to the uplinks until it is answered
+    bool     is_in_fopts;     // DeviceTimeReq already in tx_fopts_current_data
+    bool     is_synced;
+    bool     is_drift_known;
+    uint64_t gps_time_ms;     // network time at the end of the uplink answered, since the GPS epoch
+    uint64_t local_time_ms;   // RTC time of the same instant, from the Tx done timestamp
+    int32_t  drift_ppb;       // network time elapsed per RTC time elapsed, less one, in parts per billion
+} lr1_stack_mac_device_time_t;
+
+/*!
+ * Link check monitor, LinkCheckReq piggybacked on the application uplinks at an adaptive rate
+ */
+typedef struct lr1_stack_mac_link_check_s
+{
+    bool                enabled;
+    bool                is_in_fopts;  // LinkCheckReq already in tx_fopts_current_data
+    bool                is_pending;   // LinkCheckReq sent, not answered yet
+    uint8_t             period;       // application uplinks between two requests
+    uint8_t             uplink_cnt;   // application uplinks since the last request
+    uint8_t             miss_cnt;     // requests in a row without their answer
+    uint8_t             margin_db;    // of the last LinkCheckAns
+    uint8_t             gw_cnt;       // of the last LinkCheckAns
+    lr1mac_link_state_t state;
+} lr1_stack_mac_link_check_t;
+
+/*!
+ * Slotted uplinks: the frame period is split in slots, a device sends in the slot of its DevAddr
+ */
+typedef struct lr1_stack_mac_tx_slot_s
+{
+    uint32_t period_ms;  // frame period on the network time, 0 when the uplinks are not slotted
+    uint16_t slot_ms;    // the frame period holds period_ms / slot_ms slots
+} lr1_stack_mac_tx_slot_t;
+
+/*!
+ * Multicast group session, its keys are expanded in the multicast_key_ctx schedule of the stack for each frame
+ */
+typedef struct lr1_stack_mac_multicast_s
+{
+    bool     enabled;
+    uint32_t mc_addr;
+    uint32_t fcnt_dwn;   // 0xFFFFFFFF until the first downlink of the group
+    uint32_t key_check;  // tells the group sessions on the same address apart in the journal
+    uint8_t  nwk_skey[16];
+    uint8_t  app_skey[16];
+} lr1_stack_mac_multicast_t;
+
+struct lr1_stack_mac_s;
+
+typedef struct lr1_stack_mac_class_c_s
+{
+    struct lr1_stack_mac_s* lr1_mac;  // back pointer, the class C planner hook is registered with this context
+    bool                    enabled;
+    volatile bool           is_running;  // the continuous RX task is in the radio planner
+    volatile bool           is_rx_done;  // a frame was received in RXC and wasn't decoded yet
+    uint8_t                 rx_payload_size;
+    int16_t                 rx_snr;
+    int16_t                 rx_rssi;
+    uint8_t                 rx_payload[255];  // own buffer, a RXC frame can't be overwritten by the RX1/RX2 windows
+} lr1_stack_mac_class_c_t;
+
+/*!
+ * Class B beacon tracking on its own planner hook, the ping slots are received on the class C hook
+ */
+typedef struct lr1_stack_mac_class_b_s
+{
+    struct lr1_stack_mac_s* lr1_mac;  // back pointer, the class B planner hook is registered with this context
+    bool                    enabled;
+    lr1mac_class_b_state_t  state;
+    volatile bool           is_beacon_running;   // the beacon window is in the radio planner
+    volatile bool           is_beacon_done;      // the beacon window is over and wasn't processed yet
+    volatile bool           is_beacon_received;  // a beacon was received in the window, not checked yet
+    uint32_t                beacon_rx_done_ms;   // RTC time of the end of the beacon received
+    uint8_t                 beacon_size;
+    uint8_t                 beacon_payload[LR1MAC_CLASS_B_BEACON_MAX_SIZE];
+    uint32_t                beacon_time_s;     // GPS time of the beacon of the current window
+    uint32_t                anchor_time_s;     // GPS time of the last beacon received
+    uint32_t                anchor_local_ms;   // RTC time of its start
+    int32_t                 drift_ppm;         // RTC time elapsed per network time elapsed, less one
+    uint16_t                uncertainty_ppm;   // window widening per time elapsed since the anchor
+    uint8_t                 miss_cnt;          // beacons missed in a row
+    uint8_t                 periodicity;       // a ping slot every 2^periodicity s
+    bool                    is_ping_info_requested;  // PingSlotInfoReq added to the uplinks until it is answered
+    bool                    is_ping_info_in_fopts;   // PingSlotInfoReq already in tx_fopts_current_data
+    bool                    is_ping_info_acked;      // the network knows the periodicity, the ping slots are open
+    uint8_t                 ping_dr;           // from the PingSlotChannelReq, 0xFF for the region default
+    uint32_t                ping_freq_hz;      // from the PingSlotChannelReq, 0 for the region default
+    uint32_t                beacon_freq_hz;    // from the BeaconFreqReq, 0 for the region default
+    uint32_t                ping_time_s;       // beacon period ping_offset was computed for, 0 for none
+    uint16_t                ping_offset;       // first ping slot of the beacon period
+    crypto_backend_key_t    ping_key_ctx;      // zero key schedule of the ping offset
+} lr1_stack_mac_class_b_t;
+
 typedef struct lr1_stack_mac_s
 {
-    smtc_real_t* real;  // Region Abstraction Layer
+    smtc_real_t* real;      // Region Abstraction Layer
+    uint8_t      stack_id;  // instance of lr1mac_core, selects the nvm slot and journal keys
     uint16_t     nb_of_reset;
     /* LoraWan Context */
     /* Only 16 ch mask => ChMaskCntl not used */
@@ -93,11 +243,16 @@ typedef struct lr1_stack_mac_s
     /*   Other Data To store                    */
     /********************************************/
     uint32_t fcnt_up;
+    uint16_t fcnt_save_period;  // fcnt_up is journaled every fcnt_save_period uplinks
     uint32_t fcnt_dwn;
     uint32_t dev_addr;
     uint8_t  nwk_skey[16];
     uint8_t  app_skey[16];
     uint8_t  app_key[16];
+    lora_crypto_key_t app_key_ctx;   // app_key schedule, expanded each time app_key changes
+    lora_crypto_key_t nwk_skey_ctx;  // nwk_skey schedule, expanded once per session
+    lora_crypto_key_t app_skey_ctx;  // app_skey schedule, expanded once per session
+    lora_crypto_ctx_t crypto_ctx;    // stack own crypto working state, not shared with other modules
     uint8_t  dev_eui[8];
     uint8_t  app_eui[8];
     bool     otaa_device;
@@ -114,10 +269,12 @@ typedef struct lr1_stack_mac_s
     uint8_t app_payload_size;
     uint8_t tx_payload_size;
     uint8_t tx_payload[255];
+    uint8_t tx_frame_offset;  // start of the frame in tx_payload, its headers end at LR1MAC_TX_PAYLOAD_OFFSET
     uint8_t tx_fopts_length;
-    uint8_t tx_fopts_data[15];
+    uint8_t tx_fopts_data[LR1MAC_NWK_ANS_MAX_SIZE];
     uint8_t tx_fopts_lengthsticky;
-    uint8_t tx_fopts_datasticky[240];
+    uint8_t tx_fopts_datasticky[LR1MAC_NWK_ANS_MAX_SIZE];
+    uint8_t tx_fopts_high_water;  // highest tx_fopts_length + tx_fopts_lengthsticky of the session
     uint8_t tx_fopts_current_length;
     uint8_t tx_fopts_current_data[15];
     // LoRaWan Mac Data for downlin
@@ -126,12 +283,24 @@ typedef struct lr1_stack_mac_s
     uint8_t               rx_major;
     uint8_t               rx_fctrl;
     uint8_t               rx_ack_bit;
+    int8_t                rx_fpending_bit;  // -1 if no valid downlink answered the last uplink
     uint8_t               rx_fopts_length;
     uint8_t               rx_fopts[16];
-    uint8_t               rx_payload_size;  //@note Have to by replace by a fifo objet to manage class c
-    uint8_t               rx_payload[255];  //@note Have to by replace by a fifo objet to manage class c
-    uint8_t               rx_payload_empty;
-    user_rx_packet_type_t available_app_packet;
+    uint8_t               rx_payload_size;
+    // The nwk commands are decoded over the frame they come from, once it has been checked and decrypted,
+    // they are parsed before the next RX window can write into rx_payload
+    union
+    {
+        uint8_t rx_payload[255];
+        uint8_t nwk_payload[255];
+    };
+    uint8_t                       rx_payload_empty;
+    user_rx_packet_type_t         available_app_packet;  // set while downlink_fifo holds a downlink
+    lr1_stack_mac_downlink_fifo_t downlink_fifo;
+    lr1_stack_mac_class_c_t       class_c;
+    lr1_stack_mac_class_b_t       class_b;
+    lr1_stack_mac_multicast_t     multicast[LR1MAC_MULTICAST_GROUP_NB];
+    lora_crypto_key_t             multicast_key_ctx;  // key of the group frame decoded, only expanded at thread level
 
     // LoRaWan Mac Data for duty-cycle
     uint32_t tx_duty_cycle_time_off_ms;
@@ -139,14 +308,13 @@ typedef struct lr1_stack_mac_s
 
     // LoRaWan Mac Data for join
     uint16_t dev_nonce;
+    uint16_t dev_nonce_reserved;  // last DevNonce reserved in nvm, the one stored in the context
     uint8_t  cf_list[16];
 
-    // LoRaWan Mac Data for nwk Ans
-    uint8_t nwk_payload[255];  //@note resize this buffer
+    // LoRaWan Mac Data for nwk Ans, the answers too long for the fopts are built in tx_payload
     uint8_t nwk_payload_size;
-
-    uint8_t nwk_ans[255];  //@note reuse user payload data or at least reduce size or use opt byte
     uint8_t nwk_ans_size;
+    bool    is_nwk_ans_pending;  // the answers to the last downlink are in the fopts of no uplink yet
 
     // LoraWan Config
     int           adr_ack_cnt;
@@ -157,11 +325,13 @@ typedef struct lr1_stack_mac_s
     uint8_t       adr_enable;
     dr_strategy_t adr_mode_select;
     uint32_t      adr_custom;
+    bool          is_dr_low_power;  // the long range distribution is replaced by the low power one
 
     // Join Duty cycle management
     uint32_t next_time_to_join_seconds;
     uint32_t retry_join_cpt;
     uint32_t first_join_timestamp;
+    bool     is_join_pending;  // a join was started and not accepted yet, resumed after a reset
 
     uint8_t            tx_sf;
     modulation_type_t  tx_modulation_type;
@@ -185,7 +355,7 @@ typedef struct lr1_stack_mac_s
     rp_status_t          planner_status;
     int16_t              rx_snr;
     int16_t              rx_rssi;
-    uint32_t             isr_radio_timestamp;
+    uint32_t             isr_radio_timestamp_us;  // Tx done IRQ, see rp_bsp_timestamp_us_get
     int32_t              rx_offset_ms;
     uint32_t             timestamp_failsafe;
     uint32_t             dev_addr_isr;
@@ -194,6 +364,23 @@ typedef struct lr1_stack_mac_s
     lr1mac_states_t      lr1_process;
     uint32_t             rtc_target_timer_ms;
     uint8_t              send_at_time;
+    bool                 tx_preempt;             // the uplink takes the radio from the asap tasks of the other hooks
+    bool                 tx_scheduled;           // the frame waits in the radio planner for its date, built and ready
+    bool                 tx_fcnt_up_is_used;     // the frame built is a retransmission, its fcnt_up went on air
+    bool                 rx2_started_under_it;   // RX2 already scheduled from the radio planner callback
+    bool                 rx_mic_is_deferred;     // the MIC of the frame received failed its first counter candidate
+    volatile bool        process_event_pending;  // radio state changed, lr1mac_core_process has to run
+    uint8_t              lbt_enable;             // a CAD on the Tx channel is done before each uplink
+    uint8_t              lbt_cad_cnt;            // positive CADs for the current uplink
+    bool                 lbt_is_channel_clear;   // the CAD of the current uplink is done, the Tx can start
+    uint8_t              rx_cad_gate_enable;     // the RX windows start with a CAD when the preamble allows it
+
+    lr1_stack_mac_rx_drift_t      rx_drift;       // RX windows timing, learned from the downlinks
+    lr1_stack_mac_link_margin_t   link_margin;    // link margins of the downlinks and LinkCheckAns
+    lr1_stack_mac_tx_power_ctrl_t tx_power_ctrl;  // uplink power lowered to the path loss
+    lr1_stack_mac_device_time_t   device_time;    // network time of the DeviceTimeAns
+    lr1_stack_mac_link_check_t    link_check;     // connectivity from the LinkCheckAns
+    lr1_stack_mac_tx_slot_t       tx_slot;        // slot of the uplinks on the network time
 } lr1_stack_mac_t;
 
 /*
@@ -214,6 +401,58 @@ void lr1_stack_mac_init( lr1_stack_mac_t* lr1_mac, lorawan_keys_t* lorawan_keys,
  * \param [OUT] return
  */
 void lr1_stack_mac_session_init( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Expand the nwk_skey and app_skey AES schedules used for frame encryption and MIC
+ * \remark  Must be called each time nwk_skey or app_skey is updated
+ * \param [IN]  lr1_mac
+ * \param [OUT] return
+ */
+void lr1_stack_mac_session_keys_expand( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Expand the app_key AES schedule used for the join accept decryption, its MIC and the session keys
+ * \remark  Must be called each time app_key is updated, the join attempts then share the same schedule
+ * \param [IN]  lr1_mac
+ * \param [OUT] return
+ */
+void lr1_stack_mac_app_key_expand( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Store the join retry counter and the pending join flag in nvm
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_join_context_save( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Restore the join retry counter and the pending join flag from nvm
+ * \remark  A pending join resumes after the back-off of its retry counter, counted from now
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_join_context_load( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Append the session frame counters to the nvm journal
+ * \remark  Called every fcnt_save_period uplinks and on each downlink accepted, the rest of the session is stored on
+ *          change only
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_fcnt_save( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Restore the frame counters of the restored session from the nvm journal
+ * \remark  fcnt_up skips the save period of the record, the uplinks sent after the last save were not stored
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_fcnt_restore( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Move to the next uplink counter, journaled once per save period
+ * \remark  The frame built holds fcnt_up from its encryption to its last transmission, it is only moved on then, or
+ *          when the frame is dropped after one of its transmissions
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_fcnt_up_increment( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Tell if the session must be kept in nvm
+ * \remark  The OTAA sessions once joined and the ABP sessions, unless BSP_LR1MAC_SESSION_RESTORE is disabled
+ * \param [IN]  lr1_mac
+ * \param [OUT] return    true if the session, its counters included, is stored on change
+ */
+bool lr1_stack_mac_session_is_kept( const lr1_stack_mac_t* lr1_mac );
 /*!
  * \brief
  * \remark
@@ -251,6 +490,12 @@ void lr1_stack_mac_rx_radio_start( lr1_stack_mac_t* lr1_mac, const rx_win_type_t
  * \param [OUT] return
  */
 int lr1_stack_mac_downlink_check_under_it( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Try the other counter candidates of a downlink only checked against the first one under radio interrupt
+ * \remark  Called before the frame of RX1 is kept in place of RX2: a frame they don't authenticate is dropped
+ * \param [OUT] return    OKLORAWAN if the frame is authenticated or was not deferred
+ */
+int lr1_stack_mac_rx_mic_deferred_check( lr1_stack_mac_t* lr1_mac );
 /*!
  * \brief
  * \remark
@@ -258,6 +503,15 @@ int lr1_stack_mac_downlink_check_under_it( lr1_stack_mac_t* lr1_mac );
  * \param [OUT] return
  */
 void lr1_stack_mac_rp_callback( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Radio planner reception filter of the class A hook, keeps the downlinks addressed to the device
+ * \remark  Called under the radio irq with the LR1MAC_RX_HEADER_SIZE first bytes of the frame
+ * \param [IN]  lr1_mac
+ * \param [IN]  header      MHDR and DevAddr of the frame
+ * \param [IN]  header_size
+ * \param [OUT] return      False to drop the frame
+ */
+bool lr1_stack_mac_rx_filter( lr1_stack_mac_t* lr1_mac, const uint8_t* header, uint8_t header_size );
 /*!
  * \brief
  * \remark
@@ -286,6 +540,123 @@ rx_packet_type_t lr1_stack_mac_rx_frame_decode( lr1_stack_mac_t* lr1_mac );
  * \param [OUT] return
  */
 void lr1_stack_mac_update( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Take the oldest downlink out of the downlink fifo, without copy
+ * \remark  rx_snr and rx_rssi are set to the ones of the downlink read. The entry stays valid until the next
+ *          downlink is read: LR1MAC_DOWNLINK_FIFO_DEPTH - 1 downlinks wait in the fifo besides it
+ * \param [IN]  lr1_mac
+ * \param [OUT] return    the downlink read, NULL if the fifo is empty
+ */
+lr1_stack_mac_downlink_t* lr1_stack_mac_downlink_read( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Copy the oldest downlink of the downlink fifo, as lr1_stack_mac_downlink_read
+ * \param [IN]  lr1_mac
+ * \param [OUT] fport, payload, size
+ * \param [OUT] return    ERRORLORAWAN if the fifo is empty
+ */
+status_lorawan_t lr1_stack_mac_downlink_pop( lr1_stack_mac_t* lr1_mac, uint8_t* fport, uint8_t* payload,
+                                             uint8_t* size );
+/*!
+ * \brief   Enqueue the class C continuous reception on the RX2 parameters
+ * \remark  Low priority ASAP task on the class C hook, preempted by any class A window or uplink
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_class_c_rx_start( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Remove the class C continuous reception from the radio planner
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_class_c_rx_stop( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Radio planner callback of the class C hook
+ * \param [IN]  class_c
+ */
+void lr1_stack_mac_class_c_rp_callback( lr1_stack_mac_class_c_t* class_c );
+/*!
+ * \brief   Radio planner reception filter of the class C hook, see \ref lr1_stack_mac_rx_filter
+ * \param [IN]  class_c
+ * \param [IN]  header      MHDR and DevAddr of the frame
+ * \param [IN]  header_size
+ * \param [OUT] return      False to drop the frame
+ */
+bool lr1_stack_mac_class_c_rx_filter( lr1_stack_mac_class_c_t* class_c, const uint8_t* header, uint8_t header_size );
+/*!
+ * \brief   Decode the frame received in RXC
+ * \remark  Must be called while no class A exchange is in progress, rx_payload is reused
+ * \param [IN]  lr1_mac
+ * \param [OUT] return    the rx packet type, as lr1_stack_mac_rx_frame_decode
+ */
+rx_packet_type_t lr1_stack_mac_class_c_rx_decode( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Make the mac answers of a RXC downlink ride on the next uplink
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_class_c_update( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Enable the class B, the beacons are searched as soon as the network time is known
+ * \remark  A DeviceTimeReq is requested without the network time and a PingSlotInfoReq is added to the next
+ *          uplinks. Disabling it removes the beacon window and the ping slot from the radio planner.
+ * \param [IN]  lr1_mac
+ * \param [IN]  enable        true to track the beacons and open the ping slots
+ */
+void lr1_stack_mac_class_b_enable_set( lr1_stack_mac_t* lr1_mac, bool enable );
+/*!
+ * \brief   Set the ping slot periodicity, sent to the network again with a PingSlotInfoReq
+ * \param [IN]  lr1_mac
+ * \param [IN]  periodicity   a ping slot every 2^periodicity s, 0 to 7
+ * \param [OUT] return        ERRORLORAWAN if the periodicity is out of range
+ */
+status_lorawan_t lr1_stack_mac_class_b_periodicity_set( lr1_stack_mac_t* lr1_mac, uint8_t periodicity );
+/*!
+ * \brief   Get the beacon tracking state of the class B
+ * \param [IN]  lr1_mac
+ * \param [OUT] return        LR1MAC_CLASS_B_STATE_OFF while the class B is disabled
+ */
+lr1mac_class_b_state_t lr1_stack_mac_class_b_state_get( const lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Enqueue the window of the next beacon on the class B hook
+ * \remark  Scheduled on the network time while the beacon is searched, on the last beacon received once it is
+ *          tracked. The window is widened by the uncertainty of the time reference.
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_class_b_beacon_start( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Remove the beacon window and the ping slot from the radio planner
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_class_b_stop( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Radio planner callback of the class B hook
+ * \param [IN]  class_b
+ */
+void lr1_stack_mac_class_b_rp_callback( lr1_stack_mac_class_b_t* class_b );
+/*!
+ * \brief   Check the beacon of the window over and update the time reference of the beacon tracking
+ * \remark  Each beacon received measures the drift of the RTC and narrows the next windows, the tracking is lost
+ *          after LR1MAC_CLASS_B_BEACON_LOST_NB beacons missed in a row
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_class_b_beacon_process( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Enqueue the next ping slot of the device on the class C hook
+ * \remark  Only while the beacon is tracked and the PingSlotInfoReq answered, the frames received are decoded as
+ *          the RXC ones
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_class_b_ping_start( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Set or clear a multicast group, its downlinks are received in the class C windows
+ * \remark  The group keys are kept raw, they are expanded for each frame of the group. The group downlink counter
+ *          is taken back from the nvm journal for the same address and keys, a new group session restarts it
+ * \param [IN]  lr1_mac
+ * \param [IN]  group_id      Group index, lower than LR1MAC_MULTICAST_GROUP_NB
+ * \param [IN]  mc_addr       Group address, NULL keys clear the group
+ * \param [IN]  mc_nwk_skey   16 bytes McNwkSKey
+ * \param [IN]  mc_app_skey   16 bytes McAppSKey
+ * \param [OUT] return        ERRORLORAWAN if the group index is out of range
+ */
+status_lorawan_t lr1_stack_mac_multicast_set( lr1_stack_mac_t* lr1_mac, uint8_t group_id, uint32_t mc_addr,
+                                              const uint8_t* mc_nwk_skey, const uint8_t* mc_app_skey );
 /*!
  * \brief
  * \remark
@@ -323,6 +694,71 @@ uint8_t lr1_stack_mac_min_dr_get( lr1_stack_mac_t* lr1_mac );
  * \param [OUT] return
  */
 uint8_t lr1_stack_mac_max_dr_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Choose the datarate and power of the next uplinks from the link margins, for LINK_MARGIN_ADR_MODE
+ * \remark  Called by the regions in place of the network ADR: sets tx_data_rate_adr and tx_power. The choice is
+ *          only made again on new margins, the ADR backoff applies while no downlink is received.
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_link_margin_adr( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Get the link margin of the uplinks
+ * \remark  Mean SNR of the link margin samples less the demodulation floor at the datarate and power of the last
+ *          uplink. The samples are taken whatever the ADR mode.
+ * \param [IN]  lr1_mac
+ * \param [OUT] margin_db     margin above the demodulation floor
+ * \param [OUT] return        ERRORLORAWAN until LR1MAC_LINK_MARGIN_MIN_SAMPLES samples are taken
+ */
+status_lorawan_t lr1_stack_mac_link_margin_get( const lr1_stack_mac_t* lr1_mac, int16_t* margin_db );
+/*!
+ * \brief   Set the datarate of a frame only carrying mac answers
+ * \remark  The fastest datarate of the strategy the link margin allows, a datarate step is worth
+ *          LR1MAC_LINK_MARGIN_STEP_DB above LR1MAC_LINK_MARGIN_TARGET_DB. The datarate of the strategy is kept while
+ *          the margin is not known.
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_nwk_ans_dr_set( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Request the network time with a DeviceTimeReq in the fopts of the next uplinks
+ * \remark  Requested again until a DeviceTimeAns is received, the uplinks sent on port 0 don't carry it
+ * \param [IN]  lr1_mac
+ */
+void lr1_stack_mac_device_time_req( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Enable the link check monitor
+ * \remark  A LinkCheckReq is added to the fopts of an application uplink every link_check.period uplinks. A low
+ *          margin or a request unanswered lowers the datarate, see lr1mac_link_state_t.
+ * \param [IN]  lr1_mac
+ * \param [IN]  enable        1 to enable the monitor, 0 by default
+ */
+void lr1_stack_mac_link_check_enable_set( lr1_stack_mac_t* lr1_mac, uint8_t enable );
+/*!
+ * \brief   Get the link state rated by the link check monitor
+ * \param [IN]  lr1_mac
+ * \param [OUT] miss_cnt      number of LinkCheckReq unanswered in a row
+ * \param [OUT] return        LR1MAC_LINK_STATE_UNKNOWN while the monitor is disabled or has no answer yet
+ */
+lr1mac_link_state_t lr1_stack_mac_link_state_get( const lr1_stack_mac_t* lr1_mac, uint8_t* miss_cnt );
+/*!
+ * \brief   Get the network time at the current RTC time
+ * \remark  The time of the last DeviceTimeAns, refers to the Tx done timestamp of the uplink it answers. The RTC
+ *          time elapsed since is corrected by the drift measured between the answers.
+ * \param [IN]  lr1_mac
+ * \param [OUT] gps_time_ms     time since the GPS epoch in milliseconds
+ * \param [OUT] return          ERRORLORAWAN until a DeviceTimeAns is received
+ */
+status_lorawan_t lr1_stack_mac_network_time_get( lr1_stack_mac_t* lr1_mac, uint64_t* gps_time_ms );
+/*!
+ * \brief   Get the start of the next uplink slot of the device
+ * \remark  The slot of the device in the frame period is its DevAddr modulo the number of slots. The frame periods
+ *          start at the multiples of period_ms since the GPS epoch. Without the network time, a DeviceTimeReq is
+ *          requested and the uplinks stay unslotted until it is answered.
+ * \param [IN]  lr1_mac
+ * \param [IN]  target_time_ms  RTC time the uplink can start from
+ * \param [OUT] slot_time_ms    RTC time of the start of the slot
+ * \param [OUT] return          false when the uplinks are not slotted
+ */
+bool lr1_stack_mac_tx_slot_get( lr1_stack_mac_t* lr1_mac, uint32_t target_time_ms, uint32_t* slot_time_ms );
 /*!
  * \brief
  * \remark
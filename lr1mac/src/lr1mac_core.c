@@ -49,23 +49,67 @@
         BSP_DBG_TRACE_MSG( "\n  *************************************\n" );     \
     } while( 0 );
 
+#define LR1MAC_FAILSAFE_TIMEOUT_S 120
+
+// Stack parameters of a region left by lr1mac_core_set_region, its channel plan stays in the region module
+typedef struct region_params_s
+{
+    bool     is_valid;
+    uint32_t rx2_frequency;
+    int8_t   tx_power;
+    uint8_t  max_eirp_dbm;
+    uint8_t  rx1_dr_offset;
+    uint8_t  rx2_data_rate;
+    uint8_t  rx1_delay_s;
+    uint8_t  tx_data_rate_adr;
+} region_params_t;
+
+// One LoRaWAN stack sharing the radio planner, the API calls act on the stack selected by lr1mac_core_stack_select
+typedef struct lr1mac_core_stack_s
+{
+    lr1_stack_mac_t  lr1_mac;
+    lr1mac_states_t  state;
+    uint8_t          stack_id4rp;
+    uint8_t          class_c_id4rp;  // lower priority than the class A hook
+    rx_packet_type_t valid_rx_packet;
+    receive_win_t    receive_window_type;
+    bool             is_context_dirty;
+    region_params_t  region_params[sizeof( smtc_real_region_list )];  // indexed as smtc_real_region_list
+} lr1mac_core_stack_t;
+
+#if( LR1MAC_NB_STACK * BSP_LORAWAN_STACK_NVM_SIZE > BSP_MODEM_CONTEXT_ADDR_OFFSET )
+#error "The nvm slots of the LoRaWAN stacks overlap the modem context"
+#endif
+#if( BSP_NVM_JOURNAL_KEY_LORAWAN_JOIN + ( LR1MAC_NB_STACK - 1 ) * BSP_NVM_JOURNAL_KEY_LORAWAN_STRIDE >= \
+     BSP_NVM_JOURNAL_KEY_MODEM_FILE_UPLOAD )
+#error "Not enough nvm journal keys for the LoRaWAN stacks"
+#endif
+#if( BSP_NVM_JOURNAL_KEY_LORAWAN_MULTICAST + LR1MAC_NB_STACK - 1 > BSP_NVM_JOURNAL_KEY_MAX )
+#error "Not enough nvm journal keys for the multicast counters of the LoRaWAN stacks"
+#endif
+
 /*
  *-----------------------------------------------------------------------------------
  *--- PRIVATE VARIABLES -------------------------------------------------------------
  */
-static lr1mac_states_t  lr1mac_state        = LWPSTATE_IDLE;
-static lr1_stack_mac_t  lr1_mac_obj         = { 0 };
-static uint8_t          stack_id4rp         = 0;
-static rx_packet_type_t valid_rx_packet     = NO_MORE_VALID_RX_PACKET;
-static receive_win_t    receive_window_type = RECEIVE_NONE;
+static lr1mac_core_stack_t  stacks[LR1MAC_NB_STACK];
+static lr1mac_core_stack_t* stack       = &stacks[0];          // selected by lr1mac_core_stack_select
+static lr1_stack_mac_t*     lr1_mac_obj = &stacks[0].lr1_mac;  // lr1_mac of the selected stack
 
 /*
  *-----------------------------------------------------------------------------------
  *--- PRIVATE FUNCTIONS DECLARATION -------------------------------------------------
  */
-static uint32_t    failsafe_timstamp_get( void );
-static rp_status_t rp_status_get( void );
-static void        copy_user_payload( const uint8_t* data_in, const uint8_t size_in );
+static uint32_t         failsafe_timstamp_get( void );
+static rp_status_t      rp_status_get( void );
+static void             copy_user_payload( const uint8_t* data_in, const uint8_t size_in );
+static lr1mac_states_t  payload_send( uint8_t fport, const uint8_t* data_in, const uint8_t size_in,
+                                      uint8_t packet_type, uint32_t target_time_ms );
+static void             class_c_process( void );
+static void             class_b_process( void );
+static region_params_t* region_params_get( smtc_real_region_types_t region_type );
+static void             dr_distribution_apply( void );
+static void             tx_scheduled_invalidate( void );
 
 /*
  *-----------------------------------------------------------------------------------
@@ -74,35 +118,78 @@ static void        copy_user_payload( const uint8_t* data_in, const uint8_t size
 
 void lr1mac_core_init( radio_planner_t* rp, lorawan_keys_t* lorawan_keys, smtc_real_t* smtc_region )
 {
-    lr1_stack_mac_init( &lr1_mac_obj, lorawan_keys, smtc_region );
+    const uint8_t stack_id = ( uint8_t )( stack - stacks );
+
+    lr1_stack_mac_init( lr1_mac_obj, lorawan_keys, smtc_region );
+    lr1_mac_obj->stack_id = stack_id;
+    // the first stack keeps the historical hooks, the next ones come after the modem services
+    stack->stack_id4rp   = ( stack_id == 0 ) ? 0 : LR1MAC_EXTRA_STACK_HOOK_ID + ( 2 * ( stack_id - 1 ) );
+    stack->class_c_id4rp = stack->stack_id4rp + 1;
 
     status_lorawan_t status = lr1mac_core_context_load( );
 
     if( status == OKLORAWAN )
     {
         // Check if the region stored in flash is still valid
-        status = lr1mac_core_is_supported_region( lr1_mac_obj.real->region_type );
+        status = lr1mac_core_is_supported_region( lr1_mac_obj->real->region_type );
     }
 
     if( status == ERRORLORAWAN )
     {
-        memcpy( lr1_mac_obj.app_skey, lorawan_keys->LoRaMacAppSKey, 16 );
-        memcpy( lr1_mac_obj.nwk_skey, lorawan_keys->LoRaMacNwkSKey, 16 );
-        memcpy( lr1_mac_obj.app_key, lorawan_keys->LoRaMacAppKey, 16 );
-        memcpy( lr1_mac_obj.dev_eui, lorawan_keys->DevEui, 8 );
-        memcpy( lr1_mac_obj.app_eui, lorawan_keys->AppEui, 8 );
-        lr1_mac_obj.dev_nonce         = 0;
-        lr1_mac_obj.adr_custom        = BSP_USER_DR_DISTRIBUTION_PARAMETERS;  // (dr0 only)
-        lr1_mac_obj.nb_of_reset       = 0;
-        lr1_mac_obj.real->region_type = ( smtc_real_region_types_t ) smtc_real_region_list[0];
+        memcpy( lr1_mac_obj->app_skey, lorawan_keys->LoRaMacAppSKey, 16 );
+        memcpy( lr1_mac_obj->nwk_skey, lorawan_keys->LoRaMacNwkSKey, 16 );
+        memcpy( lr1_mac_obj->app_key, lorawan_keys->LoRaMacAppKey, 16 );
+        lr1_stack_mac_app_key_expand( lr1_mac_obj );
+        memcpy( lr1_mac_obj->dev_eui, lorawan_keys->DevEui, 8 );
+        memcpy( lr1_mac_obj->app_eui, lorawan_keys->AppEui, 8 );
+        lr1_mac_obj->dev_nonce          = 0;
+        lr1_mac_obj->dev_nonce_reserved = 0;
+        lr1_mac_obj->adr_custom        = BSP_USER_DR_DISTRIBUTION_PARAMETERS;  // (dr0 only)
+        lr1_mac_obj->nb_of_reset       = 0;
+        lr1_mac_obj->real->region_type = ( smtc_real_region_types_t ) smtc_real_region_list[0];
         lr1mac_core_context_save( );
     }
-    smtc_real_init( &lr1_mac_obj );
-    BSP_DBG_TRACE_PRINTF( " Region = %s\n", smtc_real_region_list_str[lr1_mac_obj.real->region_type] );
-
-    lr1_mac_obj.rp = rp;
+    smtc_real_init( lr1_mac_obj );
+    BSP_DBG_TRACE_PRINTF( " Region = %s\n", smtc_real_region_list_str[lr1_mac_obj->real->region_type] );
 
-    rp_hook_init( lr1_mac_obj.rp, stack_id4rp, ( void ( * )( void* ) )( lr1_stack_mac_rp_callback ), &( lr1_mac_obj ) );
+    // A session stored before the reset spares the join: the device sends its next uplink right away
+    status = ERRORLORAWAN;
+#if( BSP_LR1MAC_SESSION_RESTORE == 1 )
+    if( lr1mac_core_is_otaa_device( ) == OTAA_DEVICE )
+    {
+        status = smtc_real_session_load( lr1_mac_obj );
+    }
+#endif
+    if( status == OKLORAWAN )
+    {
+        lr1_stack_mac_fcnt_restore( lr1_mac_obj );
+        lr1_mac_obj->join_status = JOINED;
+    }
+    else if( lr1mac_core_is_otaa_device( ) == OTAA_DEVICE )
+    {
+        lr1_stack_mac_join_context_load( lr1_mac_obj );
+    }
+    lr1_stack_mac_session_keys_expand( lr1_mac_obj );
+
+    lr1_mac_obj->rp = rp;
+
+    rp_hook_init( lr1_mac_obj->rp, stack->stack_id4rp, ( void ( * )( void* ) )( lr1_stack_mac_rp_callback ),
+                  lr1_mac_obj );
+    rp_hook_init( lr1_mac_obj->rp, stack->class_c_id4rp, ( void ( * )( void* ) )( lr1_stack_mac_class_c_rp_callback ),
+                  &( lr1_mac_obj->class_c ) );
+    // frames for other devices are dropped on their header, before the radio planner reads their payload
+    rp_hook_set_rx_filter( lr1_mac_obj->rp, stack->stack_id4rp, ( rp_rx_filter_t )( lr1_stack_mac_rx_filter ),
+                           LR1MAC_RX_HEADER_SIZE );
+    rp_hook_set_rx_filter( lr1_mac_obj->rp, stack->class_c_id4rp,
+                           ( rp_rx_filter_t )( lr1_stack_mac_class_c_rx_filter ), LR1MAC_RX_HEADER_SIZE );
+    if( stack_id == 0 )
+    {  // class B on the first stack only, its beacon windows are never pushed back by the other tasks
+        rp_hook_init( lr1_mac_obj->rp, LR1MAC_CLASS_B_HOOK_ID,
+                      ( void ( * )( void* ) )( lr1_stack_mac_class_b_rp_callback ), &( lr1_mac_obj->class_b ) );
+        rp_hook_set_arbitration(
+            lr1_mac_obj->rp, LR1MAC_CLASS_B_HOOK_ID,
+            &( rp_hook_arbitration_t ){ .airtime_share_percent = 100, .max_aging = 0, .is_protected = true } );
+    }
 }
 
 /***********************************************************************************************/
@@ -112,53 +199,50 @@ void lr1mac_core_init( radio_planner_t* rp, lorawan_keys_t* lorawan_keys, smtc_r
 lr1mac_states_t lr1mac_core_process( user_rx_packet_type_t* available_rx_packet )
 {
     uint8_t myhook_id;
-    rp_hook_get_id( lr1_mac_obj.rp, ( void* ) ( &( lr1_mac_obj ) ), &myhook_id );
+    rp_hook_get_id( lr1_mac_obj->rp, ( void* ) ( lr1_mac_obj ), &myhook_id );
     *available_rx_packet = NO_LORA_RXPACKET_AVAILABLE;
-#ifndef TEST_BYPASS_JOIN_DUTY_CYCLE
-//    if( ( lr1_mac_joined_status_get( ) == NOT_JOINED ) &&
-//        ( ( int32_t )( lr1_mac_obj.next_time_to_join_seconds - bsp_rtc_get_time_s( ) ) > 0 ) )
-//    {
-//        BSP_DBG_TRACE_PRINTF( "TOO SOON TO JOIN time is  %lu time target is : %lu \n", bsp_rtc_get_time_s( ),
-//                              lr1_mac_obj.next_time_to_join_seconds );
-//        lr1mac_state = LWPSTATE_IDLE;
-//    }
-#endif  // TEST_BYPASS_JOIN_DUTY_CYCLE
+    // every pending event is handled by this call, a new one will be posted by the next radio state change
+    lr1_mac_obj->process_event_pending = false;
 
-    if( ( lr1mac_state != LWPSTATE_IDLE ) && ( ( bsp_rtc_get_time_s( ) - failsafe_timstamp_get( ) ) > 120 ) )
+    if( ( stack->state != LWPSTATE_IDLE ) &&
+        ( ( int32_t )( bsp_rtc_get_time_s( ) - failsafe_timstamp_get( ) ) > LR1MAC_FAILSAFE_TIMEOUT_S ) )
     {
-        lr1mac_state = LWPSTATE_ERROR;
+        stack->state = LWPSTATE_ERROR;
         BSP_DBG_TRACE_ERROR( "FAILSAFE EVENT OCCUR \n" );
         bsp_mcu_handle_lr1mac_issue( );
     }
-    switch( lr1mac_state )
+    switch( stack->state )
     {
         /************************************************************************************/
         /*                                    STATE IDLE                                    */
         /************************************************************************************/
     case LWPSTATE_IDLE:
+        class_c_process( );
+        class_b_process( );
+        *available_rx_packet = lr1_mac_obj->available_app_packet;
         break;
 
         /************************************************************************************/
         /*                                    STATE TX                                      */
         /************************************************************************************/
     case LWPSTATE_SEND:
-        switch( lr1_stack_mac_radio_state_get( &lr1_mac_obj ) )
+        switch( lr1_stack_mac_radio_state_get( lr1_mac_obj ) )
         {
         case RADIOSTATE_IDLE:
-            receive_window_type = RECEIVE_NONE;
+            stack->receive_window_type = RECEIVE_NONE;
             DBG_PRINT_WITH_LINE( "Send Payload  HOOK ID = %d", myhook_id );
-            lr1_stack_mac_tx_radio_start( &lr1_mac_obj );
+            lr1_stack_mac_tx_radio_start( lr1_mac_obj );
             break;
 
         case RADIOSTATE_TXFINISHED:
-            lr1mac_state = LWPSTATE_RX1;
-            lr1_stack_mac_rx_timer_configure( &lr1_mac_obj, RX1 );
-            lr1_mac_obj.tx_duty_cycle_timestamp_ms = bsp_rtc_get_time_ms( );
-            lr1_mac_obj.tx_duty_cycle_time_off_ms =
-                ( lr1_mac_obj.rp->stats.tx_last_toa_ms[myhook_id] << lr1_mac_obj.max_duty_cycle_index ) -
-                lr1_mac_obj.rp->stats.tx_last_toa_ms[myhook_id];
-            smtc_real_duty_cycle_sum( &lr1_mac_obj, lr1_mac_obj.tx_frequency,
-                                      lr1_mac_obj.rp->stats.tx_last_toa_ms[myhook_id] );
+            stack->state = LWPSTATE_RX1;
+            lr1_stack_mac_rx_timer_configure( lr1_mac_obj, RX1 );
+            lr1_mac_obj->tx_duty_cycle_timestamp_ms = bsp_rtc_get_time_ms( );
+            lr1_mac_obj->tx_duty_cycle_time_off_ms =
+                ( lr1_mac_obj->rp->stats.tx_last_toa_ms[myhook_id] << lr1_mac_obj->max_duty_cycle_index ) -
+                lr1_mac_obj->rp->stats.tx_last_toa_ms[myhook_id];
+            smtc_real_duty_cycle_sum( lr1_mac_obj, lr1_mac_obj->tx_frequency,
+                                      lr1_mac_obj->rp->stats.tx_last_toa_ms[myhook_id] );
             break;
 
         default:
@@ -170,39 +254,51 @@ lr1mac_states_t lr1mac_core_process( user_rx_packet_type_t* available_rx_packet
         /*                                   STATE RX1                                      */
         /************************************************************************************/
     case LWPSTATE_RX1:
-        if( lr1_stack_mac_radio_state_get( &lr1_mac_obj ) == RADIOSTATE_RX1FINISHED )
+    {
+        // radio state is read before the flag: the flag can only be set together with a state change under it
+        int radio_state = lr1_stack_mac_radio_state_get( lr1_mac_obj );
+        if( lr1_mac_obj->rx2_started_under_it == true )
         {
-            if( rp_status_get( ) == RP_STATUS_RX_PACKET )
+            lr1_mac_obj->rx2_started_under_it = false;
+            stack->state                      = LWPSTATE_RX2;
+            DBG_PRINT_WITH_LINE( "RX1 without valid downlink, RX2 started under it for Hook Id = %d", myhook_id );
+        }
+        else if( radio_state == RADIOSTATE_RX1FINISHED )
+        {
+            // the counter candidates not tried under it are tried here, in time to open RX2 if they all fail
+            if( ( rp_status_get( ) == RP_STATUS_RX_PACKET ) &&
+                ( lr1_stack_mac_rx_mic_deferred_check( lr1_mac_obj ) == OKLORAWAN ) )
             {
-                receive_window_type = RECEIVE_ON_RX1;
-                lr1mac_state        = LWPSTATE_PROCESS_DOWNLINK;
+                stack->receive_window_type = RECEIVE_ON_RX1;
+                stack->state               = LWPSTATE_PROCESS_DOWNLINK;
                 DBG_PRINT_WITH_LINE( "Receive a downlink RX1 for Hook Id = %d", myhook_id );
             }
             else
             {
-                lr1mac_state = LWPSTATE_RX2;
+                stack->state = LWPSTATE_RX2;
                 DBG_PRINT_WITH_LINE( "RX1 Timeout for Hook Id = %d", myhook_id );
-                lr1_stack_mac_rx_timer_configure( &lr1_mac_obj, RX2 );
+                lr1_stack_mac_rx_timer_configure( lr1_mac_obj, RX2 );
             }
         }
         break;
+    }
 
         /************************************************************************************/
         /*                                   STATE RX2                                      */
         /************************************************************************************/
     case LWPSTATE_RX2:
-        if( lr1_stack_mac_radio_state_get( &lr1_mac_obj ) == RADIOSTATE_IDLE )
+        if( lr1_stack_mac_radio_state_get( lr1_mac_obj ) == RADIOSTATE_IDLE )
         {
             if( rp_status_get( ) == RP_STATUS_RX_PACKET )
             {
-                receive_window_type = RECEIVE_ON_RX2;
-                lr1mac_state        = LWPSTATE_PROCESS_DOWNLINK;
+                stack->receive_window_type = RECEIVE_ON_RX2;
+                stack->state               = LWPSTATE_PROCESS_DOWNLINK;
                 DBG_PRINT_WITH_LINE( "Receive a downlink RX2 for Hook Id = %d", myhook_id );
             }
             else
             {
                 DBG_PRINT_WITH_LINE( "RX2 Timeout for Hook Id = %d", myhook_id );
-                lr1mac_state = LWPSTATE_UPDATE_MAC;
+                stack->state = LWPSTATE_UPDATE_MAC;
             }
         }
         break;
@@ -221,44 +317,91 @@ lr1mac_states_t lr1mac_core_process( user_rx_packet_type_t* available_rx_packet
         // return NOvalid_rx_packet or  USERRX_FOPTSPACKET or NWKRXPACKET or JOIN_ACCEPT_PACKET.
         DBG_PRINT_WITH_LINE( "Process Downlink for Hook Id = %d", myhook_id );
 
-        valid_rx_packet = lr1_stack_mac_rx_frame_decode( &lr1_mac_obj );
-        lr1mac_state    = LWPSTATE_UPDATE_MAC;
+        stack->valid_rx_packet = lr1_stack_mac_rx_frame_decode( lr1_mac_obj );
+        stack->state           = LWPSTATE_UPDATE_MAC;
         break;
 
         /************************************************************************************/
         /*                              STATE UPDATE MAC                                    */
         /************************************************************************************/
     case LWPSTATE_UPDATE_MAC:
-        lr1_mac_obj.radio_process_state = RADIOSTATE_IDLE;
+        lr1_mac_obj->radio_process_state = RADIOSTATE_IDLE;
         DBG_PRINT_WITH_LINE( "Update Mac for Hook Id = %d", myhook_id );
 
-        if( valid_rx_packet == JOIN_ACCEPT_PACKET )
+        // only the uplinks expecting an answer rate their channel, a RX1 downlink comes on the uplink channel
+        if( ( lr1_mac_obj->tx_mtype == CONF_DATA_UP ) || ( lr1_mac_obj->tx_mtype == JOIN_REQUEST ) )
+        {
+            smtc_real_channel_stats_update(
+                lr1_mac_obj, ( ( lr1_mac_obj->rx_ack_bit == 1 ) || ( stack->valid_rx_packet == JOIN_ACCEPT_PACKET ) )
+                                  ? SMTC_REAL_CHANNEL_EVENT_UPLINK_ACKED
+                                  : SMTC_REAL_CHANNEL_EVENT_UPLINK_NOT_ACKED );
+        }
+        if( ( stack->receive_window_type == RECEIVE_ON_RX1 ) && ( stack->valid_rx_packet != NO_MORE_VALID_RX_PACKET ) )
+        {
+            smtc_real_channel_stats_update( lr1_mac_obj, SMTC_REAL_CHANNEL_EVENT_RX1_DOWNLINK );
+        }
+
+        if( stack->valid_rx_packet == JOIN_ACCEPT_PACKET )
         {
             BSP_DBG_TRACE_MSG( " update join procedure \n" );
-            lr1_stack_mac_join_accept( &lr1_mac_obj );
+            lr1_stack_mac_join_accept( lr1_mac_obj );
 
             //@note because datarate Distribution has been changed during join
-            smtc_real_dr_distribution_set( &lr1_mac_obj, lr1_mac_obj.adr_mode_select );
+            dr_distribution_apply( );
+            if( lr1_stack_mac_session_is_kept( lr1_mac_obj ) )
+            {
+                smtc_real_session_save( lr1_mac_obj );
+                lr1_stack_mac_fcnt_save( lr1_mac_obj );
+            }
+            lr1_mac_obj->is_join_pending = false;
+            lr1_stack_mac_join_context_save( lr1_mac_obj );
         }
-        if( ( valid_rx_packet == NWKRXPACKET ) || ( valid_rx_packet == USERRX_FOPTSPACKET ) )
+        if( ( stack->valid_rx_packet == NWKRXPACKET ) || ( stack->valid_rx_packet == USERRX_FOPTSPACKET ) )
         {
-            lr1_stack_mac_cmd_parse( &lr1_mac_obj );
+            lr1_stack_mac_cmd_parse( lr1_mac_obj );
+            if( lr1_stack_mac_session_is_kept( lr1_mac_obj ) )
+            {  // the mac commands may have changed the channel plan or the rx parameters
+                smtc_real_session_save( lr1_mac_obj );
+            }
+            // only the answers of this downlink are pending, the sticky ones of a previous uplink are not sent alone
+            lr1_mac_obj->is_nwk_ans_pending =
+                ( lr1_mac_obj->tx_fopts_length + lr1_mac_obj->tx_fopts_lengthsticky ) > 0;
         }
-        lr1_stack_mac_update( &lr1_mac_obj );
-        *available_rx_packet = lr1_mac_obj.available_app_packet;
+        lr1_stack_mac_update( lr1_mac_obj );
+        *available_rx_packet = lr1_mac_obj->available_app_packet;
 
-        if( ( lr1_mac_obj.type_of_ans_to_send == NWKFRAME_TOSEND ) ||
-            ( lr1_mac_obj.type_of_ans_to_send == USRFRAME_TORETRANSMIT ) )
+        if( ( lr1_mac_obj->type_of_ans_to_send == NWKFRAME_TOSEND ) ||
+            ( lr1_mac_obj->type_of_ans_to_send == USRFRAME_TORETRANSMIT ) )
         {  // @note ack send during the next tx|| ( packet.IsFrameToSend == USERACK_TOSEND ) ) {
-            lr1_mac_obj.type_of_ans_to_send = NOFRAME_TOSEND;
-            lr1_mac_obj.rtc_target_timer_ms = ( bsp_rtc_get_time_s( ) + bsp_rng_get_random_in_range( 1, 3 ) ) * 1000;
-            lr1mac_state                    = LWPSTATE_TX_WAIT;
+            if( lr1_mac_obj->type_of_ans_to_send == NWKFRAME_TOSEND )
+            {  // the network waits for the answers to go on with its reconfiguration
+                lr1_mac_obj->rtc_target_timer_ms =
+                    bsp_rtc_get_time_ms( ) +
+                    bsp_rng_get_random_in_range( LR1MAC_NWK_ANS_DELAY_MIN_MS, LR1MAC_NWK_ANS_DELAY_MAX_MS );
+            }
+            else
+            {
+                lr1_mac_obj->rtc_target_timer_ms =
+                    ( bsp_rtc_get_time_s( ) + bsp_rng_get_random_in_range( 1, 3 ) ) * 1000;
+            }
+            lr1_mac_obj->type_of_ans_to_send = NOFRAME_TOSEND;
+            if( lr1_mac_obj->lbt_enable == 0 )
+            {  // the frame is ready: the radio planner sends it at its date, nothing to process until its Tx done
+                lr1_mac_obj->tx_scheduled = true;
+                stack->receive_window_type           = RECEIVE_NONE;
+                stack->state                         = LWPSTATE_SEND;
+                lr1_stack_mac_tx_radio_start( lr1_mac_obj );
+            }
+            else
+            {  // the CAD has to be done right before the Tx
+                stack->state = LWPSTATE_TX_WAIT;
+            }
         }
         else
         {
-            lr1mac_state = LWPSTATE_IDLE;
+            stack->state = LWPSTATE_IDLE;
         }
-        valid_rx_packet = NO_MORE_VALID_RX_PACKET;
+        stack->valid_rx_packet = NO_MORE_VALID_RX_PACKET;
         break;
 
         /************************************************************************************/
@@ -266,9 +409,9 @@ lr1mac_states_t lr1mac_core_process( user_rx_packet_type_t* available_rx_packet
         /************************************************************************************/
     case LWPSTATE_TX_WAIT:
         BSP_DBG_TRACE_MSG( "." );
-        if( bsp_rtc_get_time_ms( ) > lr1_mac_obj.rtc_target_timer_ms )
+        if( bsp_rtc_get_time_ms( ) > lr1_mac_obj->rtc_target_timer_ms )
         {
-            lr1mac_state = LWPSTATE_SEND;  //@note the frame have already been prepare in Update Mac Layer
+            stack->state = LWPSTATE_SEND;  //@note the frame have already been prepare in Update Mac Layer
         }
         break;
 
@@ -278,20 +421,58 @@ lr1mac_states_t lr1mac_core_process( user_rx_packet_type_t* available_rx_packet
         break;
     }
 
-    return ( lr1mac_state );
+    return ( stack->state );
 }
 
 /***********************************************************************************************/
 /*    End Of LoraWanProcess Method                                                             */
 /***********************************************************************************************/
 
+uint32_t lr1mac_core_next_process_delay_ms_get( void )
+{
+    switch( stack->state )
+    {
+    case LWPSTATE_IDLE:
+    case LWPSTATE_ERROR:
+    case LWPSTATE_INVALID:
+        return 0;
+
+    case LWPSTATE_PROCESS_DOWNLINK:
+    case LWPSTATE_UPDATE_MAC:
+        // no external event to wait for
+        return 0;
+
+    case LWPSTATE_TX_WAIT:
+    {
+        int32_t delay_ms = ( int32_t )( lr1_mac_obj->rtc_target_timer_ms - bsp_rtc_get_time_ms( ) ) + 1;
+        return ( delay_ms > 0 ) ? ( uint32_t ) delay_ms : 0;
+    }
+
+    default:
+    {
+        // waiting for the radio planner callback, which posts an event: only the failsafe has to be kept alive
+        if( ( stack->state == LWPSTATE_SEND ) && ( lr1_stack_mac_radio_state_get( lr1_mac_obj ) == RADIOSTATE_IDLE ) )
+        {
+            return 0;
+        }
+        if( lr1_mac_obj->process_event_pending == true )
+        {
+            return 0;
+        }
+        int32_t failsafe_s =
+            ( int32_t )( failsafe_timstamp_get( ) + LR1MAC_FAILSAFE_TIMEOUT_S + 1 - bsp_rtc_get_time_s( ) );
+        return ( failsafe_s > 0 ) ? ( uint32_t ) failsafe_s * 1000 : 0;
+    }
+    }
+}
+
 /**************************************************/
 /*            LoraWan  Join  Method               */
 /**************************************************/
 
 lr1mac_states_t lr1mac_core_join( uint32_t target_time_ms )
 {
-    if( lr1mac_state != LWPSTATE_IDLE )
+    if( stack->state != LWPSTATE_IDLE )
     {
         BSP_DBG_TRACE_ERROR( "LP STATE NOT EQUAL TO IDLE \n" );
         return ( LWPSTATE_ERROR );
@@ -301,33 +482,50 @@ lr1mac_states_t lr1mac_core_join( uint32_t target_time_ms )
         BSP_DBG_TRACE_ERROR( "ABP DEVICE CAN'T PROCCED A JOIN REQUEST \n" );
         return ( LWPSTATE_ERROR );
     }
-    uint32_t current_timestamp      = bsp_rtc_get_time_s( );
-    lr1_mac_obj.timestamp_failsafe  = current_timestamp;
-    lr1_mac_obj.rtc_target_timer_ms = target_time_ms;
-    lr1_mac_obj.join_status         = NOT_JOINED;
-    smtc_real_init( &lr1_mac_obj );
-    lr1_mac_obj.rx2_data_rate = smtc_real_rx2_join_dr_get( &lr1_mac_obj );
-    smtc_real_dr_distribution_set( &lr1_mac_obj, JOIN_DR_DISTRIBUTION );
-    smtc_real_next_dr_get( &lr1_mac_obj );
-    smtc_real_duty_cycle_update( &lr1_mac_obj );
-    if( smtc_real_join_next_channel_get( &lr1_mac_obj ) != OKLORAWAN )
+    uint32_t current_timestamp       = bsp_rtc_get_time_s( );
+    lr1_mac_obj->timestamp_failsafe  = current_timestamp;
+    lr1_mac_obj->rtc_target_timer_ms = target_time_ms;
+    lr1_mac_obj->tx_preempt          = false;
+    lr1_mac_obj->tx_scheduled        = false;
+    lr1_mac_obj->join_status         = NOT_JOINED;
+    smtc_real_init( lr1_mac_obj );
+    lr1_mac_obj->rx2_data_rate = smtc_real_rx2_join_dr_get( lr1_mac_obj );
+    smtc_real_dr_distribution_set( lr1_mac_obj, JOIN_DR_DISTRIBUTION );
+    smtc_real_next_dr_get( lr1_mac_obj );
+    smtc_real_duty_cycle_update( lr1_mac_obj );
+    if( smtc_real_join_next_channel_get( lr1_mac_obj ) != OKLORAWAN )
     {
         return ( LWPSTATE_ERROR );
     }
 
-    lr1_stack_mac_join_request_build( &lr1_mac_obj );
-    lr1_stack_rx1_join_delay_set( &lr1_mac_obj );
-    lr1_stack_rx2_join_dr_set( &lr1_mac_obj );
+    lr1_stack_mac_join_request_build( lr1_mac_obj );
+    lr1_stack_rx1_join_delay_set( lr1_mac_obj );
+    lr1_stack_rx2_join_dr_set( lr1_mac_obj );
 
     // check if it first join try
-    if( lr1_mac_obj.retry_join_cpt == 0 )
+    if( lr1_mac_obj->retry_join_cpt == 0 )
     {
         // take the timestamp reference for join duty cycle management
-        lr1_mac_obj.first_join_timestamp = current_timestamp;
+        lr1_mac_obj->first_join_timestamp = current_timestamp;
+    }
+    if( lr1_mac_obj->is_join_pending == false )
+    {
+        lr1_mac_obj->is_join_pending = true;
+        lr1_stack_mac_join_context_save( lr1_mac_obj );
     }
 
-    lr1mac_state = LWPSTATE_SEND;
-    return ( lr1mac_state );
+    stack->state = LWPSTATE_SEND;
+#ifndef TEST_BYPASS_JOIN_DUTY_CYCLE
+    if( ( int32_t )( lr1_mac_obj->next_time_to_join_seconds - current_timestamp ) > 0 )
+    {  // too soon for the join duty cycle and back-off: wait for the retry time, the failsafe starts from there
+        BSP_DBG_TRACE_PRINTF( "TOO SOON TO JOIN time is  %lu time target is : %lu \n", current_timestamp,
+                              lr1_mac_obj->next_time_to_join_seconds );
+        lr1_mac_obj->timestamp_failsafe  = lr1_mac_obj->next_time_to_join_seconds;
+        lr1_mac_obj->rtc_target_timer_ms = lr1_mac_obj->next_time_to_join_seconds * 1000;
+        stack->state                     = LWPSTATE_TX_WAIT;
+    }
+#endif  // TEST_BYPASS_JOIN_DUTY_CYCLE
+    return ( stack->state );
 }
 
 /**************************************************/
@@ -336,7 +534,7 @@ lr1mac_states_t lr1mac_core_join( uint32_t target_time_ms )
 join_status_t lr1_mac_joined_status_get( void )
 {
     join_status_t status = NOT_JOINED;
-    status               = lr1_mac_obj.join_status;
+    status               = lr1_mac_obj->join_status;
     return ( status );
 }
 /**************************************************/
@@ -345,8 +543,10 @@ join_status_t lr1_mac_joined_status_get( void )
 
 void lr1mac_core_join_status_clear( void )
 {
-    lr1_mac_obj.join_status = NOT_JOINED;
-    smtc_real_join_snapshot_channel_mask_init( &lr1_mac_obj );
+    tx_scheduled_invalidate( );
+    lr1_mac_obj->join_status = NOT_JOINED;
+    smtc_real_join_snapshot_channel_mask_init( lr1_mac_obj );
+    smtc_real_session_erase( lr1_mac_obj );
 }
 
 /**************************************************/
@@ -355,7 +555,7 @@ void lr1mac_core_join_status_clear( void )
 
 void lr1mac_core_new_join( void )
 {
-    lr1_mac_obj.join_status = NOT_JOINED;
+    lr1_mac_obj->join_status = NOT_JOINED;
 }
 /**************************************************/
 /*         LoraWan  SendPayload  Method           */
@@ -365,70 +565,120 @@ lr1mac_states_t lr1mac_core_payload_send_at_time( uint8_t fport, const uint8_t*
                                                   uint8_t packet_type, uint32_t target_time_ms )
 {
     lr1mac_states_t status;
-    status = lr1mac_core_payload_send( fport, data_in, size_in, packet_type, target_time_ms );
+    status = payload_send( fport, data_in, size_in, packet_type, target_time_ms );
     if( status == LWPSTATE_SEND )
     {
-        lr1_mac_obj.send_at_time = true;
-        lr1_mac_obj.nb_trans_cpt = 1;  // Overwrite nb_trans_cpt, when downlink is At Time, repetitions are out dated
+        lr1_mac_obj->send_at_time = true;
+        lr1_mac_obj->nb_trans_cpt = 1;  // Overwrite nb_trans_cpt, when downlink is At Time, repetitions are out dated
+        if( ( int32_t )( target_time_ms - bsp_rtc_get_time_ms( ) ) > LR1MAC_TX_SCHEDULE_MARGIN_MS )
+        {  // the frame is ready: it waits in the radio planner, the Tx starts at its date whatever the process calls
+            lr1_mac_obj->tx_scheduled  = true;
+            stack->receive_window_type = RECEIVE_NONE;
+            lr1_stack_mac_tx_radio_start( lr1_mac_obj );
+        }
     }
     return status;
 }
 
-lr1mac_states_t lr1mac_core_payload_send( uint8_t fport, const uint8_t* data_in, const uint8_t size_in,
-                                          uint8_t packet_type, uint32_t target_time_ms )
+lr1mac_states_t lr1mac_core_payload_send_preempt( uint8_t fport, const uint8_t* data_in, const uint8_t size_in,
+                                                  uint8_t packet_type, uint32_t target_time_ms )
 {
-    status_lorawan_t status;
-    status = smtc_real_is_valid_size( &lr1_mac_obj, lr1_mac_obj.tx_data_rate, size_in );
-    if( status == ERRORLORAWAN )
+    lr1mac_states_t status;
+    status = payload_send( fport, data_in, size_in, packet_type, target_time_ms );
+    if( status == LWPSTATE_SEND )
     {
-        BSP_DBG_TRACE_ERROR( "PAYLOAD SIZE TOO HIGH \n" );
-        return ( LWPSTATE_INVALID );
+        lr1_mac_obj->tx_preempt = true;
     }
-//    if( lr1mac_core_is_otaa_device( ) == OTAA_DEVICE )
-//    {
-//        if( lr1_mac_obj.join_status == NOT_JOINED )
-//        {
-//            BSP_DBG_TRACE_ERROR( "OTAA DEVICE NOT JOINED YET\n" );
-//            return ( LWPSTATE_INVALID );
-//        }
-//    }
-    if( lr1mac_state != LWPSTATE_IDLE )
-    {
-        BSP_DBG_TRACE_ERROR( "LP STATE NOT EQUAL TO IDLE \n" );
-        return ( LWPSTATE_ERROR );
+    return status;
+}
+
+lr1mac_states_t lr1mac_core_tx_wait_abort( void )
+{
+    const lr1mac_states_t state = stack->state;
+
+    if( stack->state == LWPSTATE_TX_WAIT )
+    {  // the frame is already built, nothing is on air: the mac answers not acknowledged yet are sent again
+        BSP_DBG_TRACE_WARNING( "Uplink waiting for its date dropped\n" );
+        stack->state = LWPSTATE_IDLE;
     }
-    // Decrement duty cycle before check the available DTC
-    smtc_real_duty_cycle_update( &lr1_mac_obj );
-    if( smtc_real_next_channel_get( &lr1_mac_obj ) != OKLORAWAN )
-    {
-        BSP_DBG_TRACE_WARNING( "NO CHANNEL AVAILABLE\n" );
-        return ( LWPSTATE_DUTY_CYCLE_FULL );
+    else if( ( stack->state == LWPSTATE_SEND ) && ( lr1_mac_obj->tx_scheduled == true ) &&
+             ( lr1_mac_obj->radio_process_state == RADIOSTATE_TXON ) &&
+             ( ( int32_t )( lr1_mac_obj->rtc_target_timer_ms - bsp_rtc_get_time_ms( ) ) >
+               LR1MAC_TX_SCHEDULE_MARGIN_MS ) )
+    {  // the retransmission or the uplink sent at time still waits for its date in the radio planner
+        uint8_t my_hook_id;
+        rp_hook_get_id( lr1_mac_obj->rp, ( void* ) ( lr1_mac_obj ), &my_hook_id );
+        rp_task_abort( lr1_mac_obj->rp, my_hook_id );
+        BSP_DBG_TRACE_WARNING( "Uplink waiting for its date in the radio planner dropped\n" );
+        lr1_mac_obj->radio_process_state = RADIOSTATE_IDLE;
+        stack->state                     = LWPSTATE_IDLE;
+    }
+    if( ( stack->state != state ) && ( lr1_mac_obj->tx_fcnt_up_is_used == true ) )
+    {  // a retransmission: its counter went on air and is skipped. The counter of a first transmission is released,
+        // the next frame is encrypted with it as this one was never sent.
+        lr1_stack_mac_fcnt_up_increment( lr1_mac_obj );
     }
+    return stack->state;
+}
 
-    if( lr1mac_core_next_free_duty_cycle_ms_get( ) > 0 )
+bool lr1mac_core_nwk_ans_pending_get( void )
+{
+    return ( stack->state == LWPSTATE_IDLE ) && ( lr1_mac_obj->is_nwk_ans_pending == true ) &&
+           ( lr1_mac_obj->tx_fopts_current_length > 0 );
+}
+
+lr1mac_states_t lr1mac_core_nwk_ans_send( uint32_t target_time_ms )
+{
+    uint8_t                  answers[LR1MAC_FOPTS_MAX_SIZE];
+    const uint8_t            answers_length = lr1_mac_obj->tx_fopts_current_length;
+    const uint8_t            data_rate      = lr1_mac_obj->tx_data_rate;
+    const uint8_t            sf             = lr1_mac_obj->tx_sf;
+    const lr1mac_bandwidth_t bw             = lr1_mac_obj->tx_bw;
+    const modulation_type_t  modulation     = lr1_mac_obj->tx_modulation_type;
+    lr1mac_states_t          status;
+
+    if( lr1mac_core_nwk_ans_pending_get( ) == false )
     {
-        BSP_DBG_TRACE_WARNING( "Duty Cycle is full\n" );
-        return ( LWPSTATE_DUTY_CYCLE_FULL );
+        return LWPSTATE_INVALID;
     }
 
-    lr1_mac_obj.timestamp_failsafe  = bsp_rtc_get_time_s( );
-    lr1_mac_obj.rtc_target_timer_ms = target_time_ms;
-    copy_user_payload( data_in, size_in );
-    lr1_mac_obj.app_payload_size = size_in;
-    lr1_mac_obj.tx_fport         = fport;
-    lr1_mac_obj.tx_mtype         = packet_type;
-    lr1_stack_mac_tx_frame_build( &lr1_mac_obj );
-    //lr1_stack_mac_tx_frame_encrypt( &lr1_mac_obj );
-    if( packet_type == CONF_DATA_UP )
-    {
-        lr1_mac_obj.nb_trans_cpt = MAX_CONFUP_MSG;
+    // a port 0 frame has no fopts: the answers are moved to its payload
+    memcpy( answers, lr1_mac_obj->tx_fopts_current_data, answers_length );
+    lr1_mac_obj->tx_fopts_current_length = 0;
+    lr1_stack_mac_nwk_ans_dr_set( lr1_mac_obj );
+    status = payload_send( PORTNWK, answers, answers_length, UNCONF_DATA_UP, target_time_ms );
+    if( status != LWPSTATE_SEND )
+    {  // the answers stay for the fopts of the next uplink, sent with the datarate of the strategy
+        lr1_mac_obj->tx_fopts_current_length = answers_length;
+        lr1_mac_obj->tx_data_rate            = data_rate;
+        lr1_mac_obj->tx_sf                   = sf;
+        lr1_mac_obj->tx_bw                   = bw;
+        lr1_mac_obj->tx_modulation_type      = modulation;
     }
-    else
-    {
-        lr1_mac_obj.nb_trans_cpt = lr1_mac_obj.nb_trans;
+    return status;
+}
+
+uint8_t* lr1mac_core_tx_payload_buffer_get( void )
+{
+    return &lr1_mac_obj->tx_payload[LR1MAC_TX_PAYLOAD_OFFSET];
+}
+
+lr1mac_states_t lr1mac_core_payload_send( uint8_t fport, const uint8_t* data_in, const uint8_t size_in,
+                                          uint8_t packet_type, uint32_t target_time_ms )
+{
+    lr1mac_states_t status;
+    uint32_t        slot_time_ms;
+
+    status = payload_send( fport, data_in, size_in, packet_type, target_time_ms );
+    if( ( status == LWPSTATE_SEND ) && ( lr1_stack_mac_tx_slot_get( lr1_mac_obj, target_time_ms, &slot_time_ms ) ) )
+    {  // the first transmission is sent at the start of the slot, without LBT. The slot can be up to a frame period
+        // away, the failsafe starts from there.
+        lr1_mac_obj->timestamp_failsafe =
+            bsp_rtc_get_time_s( ) + ( ( slot_time_ms - bsp_rtc_get_time_ms( ) ) / 1000 );
+        lr1_mac_obj->rtc_target_timer_ms = slot_time_ms;
+        lr1_mac_obj->send_at_time        = true;
     }
-    lr1mac_state = LWPSTATE_SEND;
-    return ( lr1mac_state );
+    return status;
 }
 
 /**************************************************/
@@ -438,29 +688,58 @@ status_lorawan_t lr1mac_core_payload_receive( uint8_t* user_rx_port, uint8_t* us
                                               uint8_t* user_rx_payloadSize )
 {
     status_lorawan_t status = OKLORAWAN;
-    if( lr1_mac_obj.available_app_packet == NO_LORA_RXPACKET_AVAILABLE )
+    if( lr1_mac_obj->available_app_packet == NO_LORA_RXPACKET_AVAILABLE )
     {
         status = ERRORLORAWAN;
     }
     else
     {
-        *user_rx_payloadSize = lr1_mac_obj.rx_payload_size;
-        *user_rx_port        = lr1_mac_obj.rx_fport;
-        memcpy( user_rx_payload, lr1_mac_obj.rx_payload, lr1_mac_obj.rx_payload_size );
-        lr1_mac_obj.available_app_packet = NO_LORA_RXPACKET_AVAILABLE;
+        status = lr1_stack_mac_downlink_pop( lr1_mac_obj, user_rx_port, user_rx_payload, user_rx_payloadSize );
     }
     return ( status );
 }
 
+status_lorawan_t lr1mac_core_downlink_get( uint8_t* port, uint8_t** payload, uint8_t* size )
+{
+    lr1_stack_mac_downlink_t* downlink = lr1_stack_mac_downlink_read( lr1_mac_obj );
+
+    if( downlink == NULL )
+    {
+        return ERRORLORAWAN;
+    }
+    *port    = downlink->fport;
+    *payload = downlink->payload;
+    *size    = downlink->size;
+    return OKLORAWAN;
+}
+
 /**************************************************/
 /*       LoraWan  AdrModeSelect  Method           */
 /**************************************************/
 
 void lr1mac_core_dr_strategy_set( dr_strategy_t adr_mode_select )
 {
-    lr1_mac_obj.adr_mode_select = adr_mode_select;
-    smtc_real_dr_distribution_set( &lr1_mac_obj, adr_mode_select );
-    smtc_real_next_dr_get( &lr1_mac_obj );
+    tx_scheduled_invalidate( );
+    lr1_mac_obj->adr_mode_select = adr_mode_select;
+    dr_distribution_apply( );
+    smtc_real_next_dr_get( lr1_mac_obj );
+}
+
+void lr1mac_core_dr_low_power_set( bool is_low_power )
+{
+    if( lr1_mac_obj->is_dr_low_power == is_low_power )
+    {
+        return;
+    }
+    lr1_mac_obj->is_dr_low_power = is_low_power;
+    // the other strategies are left alone: the network or the link margins drive them, the join has its own
+    if( ( lr1_mac_obj->adr_mode_select == MOBILE_LONGRANGE_DR_DISTRIBUTION ) &&
+        ( lr1_mac_obj->join_status == JOINED ) )
+    {
+        tx_scheduled_invalidate( );
+        dr_distribution_apply( );
+        smtc_real_next_dr_get( lr1_mac_obj );
+    }
 }
 /**************************************************/
 /*       LoraWan  AdrModeSelect  Get Method       */
@@ -468,7 +747,7 @@ void lr1mac_core_dr_strategy_set( dr_strategy_t adr_mode_select )
 
 dr_strategy_t lr1mac_core_dr_strategy_get( void )
 {
-    return ( lr1_mac_obj.adr_mode_select );
+    return ( lr1_mac_obj->adr_mode_select );
 }
 /*************************************************************/
 /*       LoraWan  Set DataRate Custom for custom adr profile */
@@ -476,7 +755,8 @@ dr_strategy_t lr1mac_core_dr_strategy_get( void )
 
 void lr1mac_core_dr_custom_set( uint32_t DataRateCustom )
 {
-    lr1_mac_obj.adr_custom = DataRateCustom;
+    tx_scheduled_invalidate( );
+    lr1_mac_obj->adr_custom = DataRateCustom;
 }
 /**************************************************/
 /*         LoraWan  GetDevAddr  Method            */
@@ -484,7 +764,7 @@ void lr1mac_core_dr_custom_set( uint32_t DataRateCustom )
 
 uint32_t lr1mac_core_devaddr_get( void )
 {
-    return ( lr1_mac_obj.dev_addr );
+    return ( lr1_mac_obj->dev_addr );
 }
 
 /**************************************************/
@@ -493,7 +773,7 @@ uint32_t lr1mac_core_devaddr_get( void )
 
 void lr1mac_core_deveui_get( uint8_t* DevEui )
 {
-    memcpy( DevEui, lr1_mac_obj.dev_eui, 8 );
+    memcpy( DevEui, lr1_mac_obj->dev_eui, 8 );
 }
 
 /**************************************************/
@@ -502,7 +782,7 @@ void lr1mac_core_deveui_get( uint8_t* DevEui )
 
 void lr1mac_core_deveui_set( uint8_t* DevEui )
 {
-    memcpy( lr1_mac_obj.dev_eui, DevEui, 8 );
+    memcpy( lr1_mac_obj->dev_eui, DevEui, 8 );
 }
 
 /**************************************************/
@@ -511,7 +791,8 @@ void lr1mac_core_deveui_set( uint8_t* DevEui )
 
 void lr1mac_core_app_key_set( uint8_t* AppKey )
 {
-    memcpy( lr1_mac_obj.app_key, AppKey, 16 );
+    memcpy( lr1_mac_obj->app_key, AppKey, 16 );
+    lr1_stack_mac_app_key_expand( lr1_mac_obj );
 }
 
 /**************************************************/
@@ -520,7 +801,7 @@ void lr1mac_core_app_key_set( uint8_t* AppKey )
 
 void lr1mac_core_appeui_key_get( uint8_t* AppEui )
 {
-    memcpy( AppEui, lr1_mac_obj.app_eui, 8 );
+    memcpy( AppEui, lr1_mac_obj->app_eui, 8 );
 }
 
 /**************************************************/
@@ -529,7 +810,7 @@ void lr1mac_core_appeui_key_get( uint8_t* AppEui )
 
 void lr1mac_core_appeui_key_set( uint8_t* AppEui )
 {
-    memcpy( lr1_mac_obj.app_eui, AppEui, 8 );
+    memcpy( lr1_mac_obj->app_eui, AppEui, 8 );
 }
 
 /**************************************************/
@@ -538,7 +819,7 @@ void lr1mac_core_appeui_key_set( uint8_t* AppEui )
 
 uint8_t lr1mac_core_next_power_get( void )
 {
-    return ( lr1_mac_obj.tx_power );
+    return ( lr1_mac_obj->tx_power );
 }
 
 /**************************************************/
@@ -547,7 +828,7 @@ uint8_t lr1mac_core_next_power_get( void )
 
 lr1mac_states_t lr1mac_core_state_get( void )
 {
-    return ( lr1mac_state );
+    return ( stack->state );
 }
 
 /**************************************************/
@@ -555,8 +836,22 @@ lr1mac_states_t lr1mac_core_state_get( void )
 /**************************************************/
 
 void lr1mac_core_context_save( void )
+{  // written back by lr1mac_core_context_flush
+    stack->is_context_dirty = true;
+}
+
+void lr1mac_core_context_flush( void )
 {
-    smtc_real_memory_save( &lr1_mac_obj );
+    if( stack->is_context_dirty == true )
+    {
+        stack->is_context_dirty = false;
+        smtc_real_memory_save( lr1_mac_obj );
+    }
+}
+
+bool lr1mac_core_context_is_dirty( void )
+{
+    return stack->is_context_dirty;
 }
 /**************************************************/
 /*    LoraWan  storeContext  Method               */
@@ -564,15 +859,29 @@ void lr1mac_core_context_save( void )
 
 void lr1mac_core_keys_set( lorawan_keys_t LoRaWanKeys )
 {
-    memcpy( lr1_mac_obj.app_skey, LoRaWanKeys.LoRaMacAppSKey, 16 );
-    memcpy( lr1_mac_obj.nwk_skey, LoRaWanKeys.LoRaMacNwkSKey, 16 );
-    memcpy( lr1_mac_obj.app_key, LoRaWanKeys.LoRaMacAppKey, 16 );
-    memcpy( lr1_mac_obj.dev_eui, LoRaWanKeys.DevEui, 8 );
-    memcpy( lr1_mac_obj.app_eui, LoRaWanKeys.AppEui, 8 );
-    lr1_mac_obj.otaa_device = LoRaWanKeys.otaaDevice;
-    lr1_mac_obj.dev_addr    = LoRaWanKeys.LoRaDevAddr;
-
-    smtc_real_memory_save( &lr1_mac_obj );
+    memcpy( lr1_mac_obj->app_skey, LoRaWanKeys.LoRaMacAppSKey, 16 );
+    memcpy( lr1_mac_obj->nwk_skey, LoRaWanKeys.LoRaMacNwkSKey, 16 );
+    memcpy( lr1_mac_obj->app_key, LoRaWanKeys.LoRaMacAppKey, 16 );
+    memcpy( lr1_mac_obj->dev_eui, LoRaWanKeys.DevEui, 8 );
+    memcpy( lr1_mac_obj->app_eui, LoRaWanKeys.AppEui, 8 );
+    lr1_mac_obj->otaa_device = LoRaWanKeys.otaaDevice;
+    lr1_mac_obj->dev_addr    = LoRaWanKeys.LoRaDevAddr;
+    lr1_stack_mac_session_keys_expand( lr1_mac_obj );
+    lr1_stack_mac_app_key_expand( lr1_mac_obj );
+
+    smtc_real_memory_save( lr1_mac_obj );
+    if( ( lr1_mac_obj->otaa_device == OTAA_DEVICE ) || ( lr1_stack_mac_session_is_kept( lr1_mac_obj ) == false ) )
+    {
+        smtc_real_session_erase( lr1_mac_obj );  // the stored session belongs to the previous keys
+    }
+    else if( smtc_real_session_load( lr1_mac_obj ) == OKLORAWAN )
+    {  // the ABP keys set again after a reset: the session of the same DevAddr and keys resumes with its counters
+        lr1_stack_mac_fcnt_restore( lr1_mac_obj );
+    }
+    else
+    {  // a new ABP session, stored over the previous one
+        smtc_real_session_save( lr1_mac_obj );
+    }
 }
 /**************************************************/
 /*   LoraWan  lr1mac_core_next_max_payload_length_get  Method     */
@@ -580,8 +889,8 @@ void lr1mac_core_keys_set( lorawan_keys_t LoRaWanKeys )
 
 uint32_t lr1mac_core_next_max_payload_length_get( void )
 {
-    return ( smtc_real_max_payload_size_get( &lr1_mac_obj, lr1_mac_obj.tx_data_rate ) -
-             lr1_mac_obj.tx_fopts_current_length - 8 );
+    return ( smtc_real_max_payload_size_get( lr1_mac_obj, lr1_mac_obj->tx_data_rate ) -
+             lr1_mac_obj->tx_fopts_current_length - 8 );
 }
 
 /**************************************************/
@@ -590,105 +899,242 @@ uint32_t lr1mac_core_next_max_payload_length_get( void )
 
 uint8_t lr1mac_core_next_dr_get( void )
 {  // note return datareate in case of adr
-    return ( lr1_mac_obj.tx_data_rate );
+    return ( lr1_mac_obj->tx_data_rate );
 }
 
 uint32_t lr1mac_core_next_frequency_get( void )
 {  // note return datareate in case of adr
-    return ( lr1_mac_obj.tx_frequency );
+    return ( lr1_mac_obj->tx_frequency );
 }
 
 void lr1mac_core_factory_reset( void )
 {
-    smtc_real_bad_crc_memory_set( &lr1_mac_obj );
+    smtc_real_bad_crc_memory_set( lr1_mac_obj );
+    smtc_real_session_erase( lr1_mac_obj );
+    lr1mac_core_join_pending_clear( );
 }
 
 type_otaa_abp_t lr1mac_core_is_otaa_device( void )
 {
-    return ( type_otaa_abp_t ) lr1_mac_obj.otaa_device;
+    return ( type_otaa_abp_t ) lr1_mac_obj->otaa_device;
 }
 
 void lr1mac_core_otaa_set( type_otaa_abp_t deviceType )
 {
-    lr1_mac_obj.otaa_device = deviceType;
+    lr1_mac_obj->otaa_device = deviceType;
 }
 radio_planner_t* lr1mac_core_rp_get( void )
 {
-    return lr1_mac_obj.rp;
+    return lr1_mac_obj->rp;
 }
 int8_t lr1mac_core_tx_power_offset_get( void )
 {
-    return lr1_mac_obj.tx_power_offset;
+    return lr1_mac_obj->tx_power_offset;
 }
 void lr1mac_core_tx_power_offset_set( int8_t power_off )
 {
-    lr1_mac_obj.tx_power_offset = power_off;
+    lr1_mac_obj->tx_power_offset = power_off;
 }
 
 uint16_t lr1mac_core_nb_reset_get( void )
 {
-    return lr1_mac_obj.nb_of_reset;
+    return lr1_mac_obj->nb_of_reset;
 }
 
 uint16_t lr1mac_core_devnonce_get( void )
 {
-    return lr1_mac_obj.dev_nonce;
+    return lr1_mac_obj->dev_nonce;
 }
 
 int16_t lr1mac_core_last_snr_get( void )
 {
-    return lr1_mac_obj.rx_snr;
+    return lr1_mac_obj->rx_snr;
 }
 
 int16_t lr1mac_core_last_rssi_get( void )
 {
-    return lr1_mac_obj.rx_rssi;
+    return lr1_mac_obj->rx_rssi;
 }
 
 uint8_t lr1mac_core_min_dr_get( void )
 {
-    uint8_t tmp = lr1_stack_mac_min_dr_get( &lr1_mac_obj );
+    uint8_t tmp = lr1_stack_mac_min_dr_get( lr1_mac_obj );
     BSP_DBG_TRACE_PRINTF( "Min DataRate = %d\n", tmp );
     return ( tmp );
 }
 uint8_t lr1mac_core_max_dr_get( void )
 {
-    uint8_t tmp = lr1_stack_mac_max_dr_get( &lr1_mac_obj );
+    uint8_t tmp = lr1_stack_mac_max_dr_get( lr1_mac_obj );
     BSP_DBG_TRACE_PRINTF( "Max DataRate = %d\n", tmp );
     return ( tmp );
 }
 
 void lr1mac_core_apps_key_get( uint8_t* key )
 {
-    memcpy( key, lr1_mac_obj.app_skey, 16 );
+    memcpy( key, lr1_mac_obj->app_skey, 16 );
 }
 
 status_lorawan_t lr1mac_core_context_load( void )
 {
-    return smtc_real_memory_load( &lr1_mac_obj );
+    status_lorawan_t status = smtc_real_memory_load( lr1_mac_obj );
+
+    lr1_stack_mac_app_key_expand( lr1_mac_obj );  // the join attempts use the app_key schedule of the stored key
+    return status;
 }
 receive_win_t lr1mac_core_rx_window_get( void )
 {
-    return ( receive_window_type );
+    return ( stack->receive_window_type );
 }
 uint32_t lr1mac_core_fcnt_up_get( void )
 {
-    return ( lr1_mac_obj.fcnt_up );
+    return ( lr1_mac_obj->fcnt_up );
 }
 uint32_t lr1mac_core_next_join_time_second_get( void )
 {
-    return ( lr1_mac_obj.next_time_to_join_seconds );
+    return ( lr1_mac_obj->next_time_to_join_seconds );
+}
+bool lr1mac_core_join_pending_get( void )
+{
+    return ( lr1_mac_obj->is_join_pending );
+}
+void lr1mac_core_join_pending_clear( void )
+{
+    if( lr1_mac_obj->is_join_pending == true )
+    {
+        lr1_mac_obj->is_join_pending = false;
+        lr1_mac_obj->retry_join_cpt  = 0;
+        lr1_stack_mac_join_context_save( lr1_mac_obj );
+    }
 }
 int32_t lr1mac_core_next_free_duty_cycle_ms_get( void )
 {
-    int32_t nwk_dtc    = lr1_stack_network_next_free_duty_cycle_ms_get( &lr1_mac_obj );
-    int32_t region_dtc = smtc_real_next_free_duty_cycle_ms_get( &lr1_mac_obj );
+    int32_t nwk_dtc    = lr1_stack_network_next_free_duty_cycle_ms_get( lr1_mac_obj );
+    int32_t region_dtc = smtc_real_next_free_duty_cycle_ms_get( lr1_mac_obj );
 
     return ( MAX( nwk_dtc, region_dtc ) );
 }
 void lr1mac_core_duty_cycle_enable_set( uint8_t enable )
 {
-    smtc_real_duty_cycle_enable_set( &lr1_mac_obj, enable );
+    smtc_real_duty_cycle_enable_set( lr1_mac_obj, enable );
+}
+void lr1mac_core_weighted_channel_selection_enable_set( uint8_t enable )
+{
+    smtc_real_weighted_channel_selection_enable_set( lr1_mac_obj, enable );
+}
+uint8_t lr1mac_core_channel_scan_plan_get( uint32_t* freq_in_hz, uint8_t freq_max )
+{
+    return smtc_real_channel_scan_plan_get( lr1_mac_obj, freq_in_hz, freq_max );
+}
+void lr1mac_core_channel_occupancy_update( uint32_t freq_in_hz, uint8_t busy_ratio )
+{
+    smtc_real_channel_occupancy_update( lr1_mac_obj, freq_in_hz, busy_ratio );
+}
+void lr1mac_core_lbt_enable_set( uint8_t enable )
+{
+    lr1_mac_obj->lbt_enable = ( enable != 0 ) ? 1 : 0;
+}
+uint8_t lr1mac_core_lbt_enable_get( void )
+{
+    return lr1_mac_obj->lbt_enable;
+}
+void lr1mac_core_rx_cad_gate_enable_set( uint8_t enable )
+{
+    lr1_mac_obj->rx_cad_gate_enable = ( enable != 0 ) ? 1 : 0;
+}
+void lr1mac_core_tx_power_ctrl_set( uint8_t enable, int8_t gw_eirp_dbm )
+{
+    if( gw_eirp_dbm != lr1_mac_obj->tx_power_ctrl.gw_eirp_dbm )
+    {
+        lr1_mac_obj->tx_power_ctrl.is_known = false;
+    }
+    lr1_mac_obj->tx_power_ctrl.enabled     = ( enable != 0 ) ? true : false;
+    lr1_mac_obj->tx_power_ctrl.gw_eirp_dbm = gw_eirp_dbm;
+}
+status_lorawan_t lr1mac_core_link_margin_get( int16_t* margin_db )
+{
+    return lr1_stack_mac_link_margin_get( lr1_mac_obj, margin_db );
+}
+void lr1mac_core_device_time_req( void )
+{
+    lr1_stack_mac_device_time_req( lr1_mac_obj );
+}
+void lr1mac_core_link_check_enable_set( uint8_t enable )
+{
+    lr1_stack_mac_link_check_enable_set( lr1_mac_obj, enable );
+}
+lr1mac_link_state_t lr1mac_core_link_state_get( uint8_t* miss_cnt )
+{
+    return lr1_stack_mac_link_state_get( lr1_mac_obj, miss_cnt );
+}
+status_lorawan_t lr1mac_core_network_time_get( uint64_t* gps_time_ms )
+{
+    return lr1_stack_mac_network_time_get( lr1_mac_obj, gps_time_ms );
+}
+status_lorawan_t lr1mac_core_tx_slot_set( uint32_t period_ms, uint16_t slot_ms )
+{
+    if( ( period_ms != 0 ) && ( ( slot_ms == 0 ) || ( slot_ms > period_ms ) ) )
+    {
+        return ERRORLORAWAN;
+    }
+    lr1_mac_obj->tx_slot.period_ms = period_ms;
+    lr1_mac_obj->tx_slot.slot_ms   = slot_ms;
+    return OKLORAWAN;
+}
+void lr1mac_core_tx_slot_get( uint32_t* period_ms, uint16_t* slot_ms )
+{
+    *period_ms = lr1_mac_obj->tx_slot.period_ms;
+    *slot_ms   = lr1_mac_obj->tx_slot.slot_ms;
+}
+status_lorawan_t lr1mac_core_fcnt_save_period_set( uint16_t period )
+{
+    if( period == 0 )
+    {
+        return ERRORLORAWAN;
+    }
+    lr1_mac_obj->fcnt_save_period = period;
+    if( lr1_stack_mac_session_is_kept( lr1_mac_obj ) )
+    {  // a restore must skip the new period from now on
+        lr1_stack_mac_fcnt_save( lr1_mac_obj );
+    }
+    return OKLORAWAN;
+}
+
+void lr1mac_core_class_c_enable_set( bool enable )
+{
+    lr1_mac_obj->class_c.enabled = enable;
+    if( enable == false )
+    {
+        lr1_stack_mac_class_c_rx_stop( lr1_mac_obj );
+    }
+    else
+    {  // the reception starts from the next lr1mac process call
+        lr1_mac_obj->process_event_pending = true;
+    }
+}
+
+void lr1mac_core_class_b_enable_set( bool enable )
+{
+    lr1_stack_mac_class_b_enable_set( lr1_mac_obj, enable );
+    if( enable == true )
+    {  // the beacon acquisition starts from the next lr1mac process call
+        lr1_mac_obj->process_event_pending = true;
+    }
+}
+
+status_lorawan_t lr1mac_core_class_b_periodicity_set( uint8_t periodicity )
+{
+    return lr1_stack_mac_class_b_periodicity_set( lr1_mac_obj, periodicity );
+}
+
+lr1mac_class_b_state_t lr1mac_core_class_b_state_get( void )
+{
+    return lr1_stack_mac_class_b_state_get( lr1_mac_obj );
+}
+
+status_lorawan_t lr1mac_core_multicast_set( uint8_t group_id, uint32_t mc_addr, const uint8_t* mc_nwk_skey,
+                                            const uint8_t* mc_app_skey )
+{
+    return lr1_stack_mac_multicast_set( lr1_mac_obj, group_id, mc_addr, mc_nwk_skey, mc_app_skey );
 }
 
 uint32_t r1mac_core_version_get( void )
@@ -704,12 +1150,38 @@ uint32_t r1mac_core_version_get( void )
  */
 uint8_t lr1mac_core_rx_ack_bit_get( void )
 {
-    return ( lr1_mac_obj.rx_ack_bit );
+    return ( lr1_mac_obj->rx_ack_bit );
+}
+
+int8_t lr1mac_core_rx_fpending_bit_get( void )
+{
+    return ( lr1_mac_obj->rx_fpending_bit );
+}
+
+void lr1mac_core_next_dr_fastest_set( void )
+{
+    smtc_real_fastest_dr_get( lr1_mac_obj, UINT8_MAX );
 }
 
 lr1_stack_mac_t* lr1mac_core_stack_mac_get( void )
 {
-    return &lr1_mac_obj;
+    return lr1_mac_obj;
+}
+
+status_lorawan_t lr1mac_core_stack_select( uint8_t stack_id )
+{
+    if( stack_id >= LR1MAC_NB_STACK )
+    {
+        return ERRORLORAWAN;
+    }
+    stack       = &stacks[stack_id];
+    lr1_mac_obj = &stack->lr1_mac;
+    return OKLORAWAN;
+}
+
+uint8_t lr1mac_core_stack_selected_get( void )
+{
+    return ( uint8_t )( stack - stacks );
 }
 
 status_lorawan_t lr1mac_core_is_supported_region( smtc_real_region_types_t region_type )
@@ -732,20 +1204,92 @@ status_lorawan_t lr1mac_core_is_supported_region( smtc_real_region_types_t regio
     return OKLORAWAN;
 }
 
+uint32_t lr1mac_core_get_ram_size( void )
+{
+    return sizeof( *lr1_mac_obj );
+}
+
 smtc_real_region_types_t lr1mac_core_get_region( void )
 {
-    return lr1_mac_obj.real->region_type;
+    return lr1_mac_obj->real->region_type;
 }
 
 status_lorawan_t lr1mac_core_set_region( smtc_real_region_types_t region_type )
 {
-    if( lr1mac_core_is_supported_region( region_type ) == OKLORAWAN )
+    region_params_t* params;
+
+    if( lr1mac_core_is_supported_region( region_type ) != OKLORAWAN )
+    {
+        return ERRORLORAWAN;
+    }
+    if( region_type == lr1_mac_obj->real->region_type )
     {
-        lr1_mac_obj.real->region_type = region_type;
-        lr1mac_core_context_save( );
         return OKLORAWAN;
     }
-    return ERRORLORAWAN;
+    for( uint8_t i = 0; i < LR1MAC_NB_STACK; i++ )
+    {  // a region module holds a single channel plan
+        if( ( &stacks[i] != stack ) && ( stacks[i].lr1_mac.real != NULL ) &&
+            ( stacks[i].lr1_mac.real->region_type == region_type ) )
+        {
+            BSP_DBG_TRACE_ERROR( "Region 0x%02x used by stack %u\n", region_type, i );
+            return ERRORLORAWAN;
+        }
+    }
+    if( stack->state != LWPSTATE_IDLE )
+    {
+        BSP_DBG_TRACE_ERROR( "LP STATE NOT EQUAL TO IDLE \n" );
+        return ERRORLORAWAN;
+    }
+
+    // the session keys and counters are kept, only the regional parameters are swapped
+    params                   = region_params_get( lr1_mac_obj->real->region_type );
+    params->is_valid         = true;
+    params->rx2_frequency    = lr1_mac_obj->rx2_frequency;
+    params->tx_power         = lr1_mac_obj->tx_power;
+    params->max_eirp_dbm     = lr1_mac_obj->max_eirp_dbm;
+    params->rx1_dr_offset    = lr1_mac_obj->rx1_dr_offset;
+    params->rx2_data_rate    = lr1_mac_obj->rx2_data_rate;
+    params->rx1_delay_s      = lr1_mac_obj->rx1_delay_s;
+    params->tx_data_rate_adr = lr1_mac_obj->tx_data_rate_adr;
+
+    lr1_mac_obj->real->region_type = region_type;
+    params                         = region_params_get( region_type );
+    if( params->is_valid == true )
+    {  // the region channel plan was left as is, a switch back is instant
+        lr1_mac_obj->rx2_frequency    = params->rx2_frequency;
+        lr1_mac_obj->tx_power         = params->tx_power;
+        lr1_mac_obj->max_eirp_dbm     = params->max_eirp_dbm;
+        lr1_mac_obj->rx1_dr_offset    = params->rx1_dr_offset;
+        lr1_mac_obj->rx2_data_rate    = params->rx2_data_rate;
+        lr1_mac_obj->rx1_delay_s      = params->rx1_delay_s;
+        lr1_mac_obj->tx_data_rate_adr = params->tx_data_rate_adr;
+    }
+    else
+    {  // first use of the region since the boot
+        uint32_t adr_custom = lr1_mac_obj->adr_custom;
+
+        smtc_real_init( lr1_mac_obj );
+        lr1_mac_obj->max_eirp_dbm = smtc_real_default_max_eirp_get( lr1_mac_obj );
+        lr1_mac_obj->adr_custom   = adr_custom;
+    }
+    dr_distribution_apply( );
+    if( lr1_stack_mac_session_is_kept( lr1_mac_obj ) )
+    {
+        smtc_real_session_save( lr1_mac_obj );
+    }
+    if( lr1_mac_obj->class_c.enabled == true )
+    {  // restarted on the RX2 parameters of the new region by the next lr1mac process call
+        lr1_stack_mac_class_c_rx_stop( lr1_mac_obj );
+        lr1_mac_obj->process_event_pending = true;
+    }
+    if( lr1_mac_obj->class_b.enabled == true )
+    {  // the beacon is searched again on the frequencies of the new region
+        lr1_stack_mac_class_b_enable_set( lr1_mac_obj, true );
+        lr1_mac_obj->process_event_pending = true;
+    }
+    BSP_DBG_TRACE_PRINTF( " Region = %s\n", smtc_real_region_list_str[region_type] );
+    lr1mac_core_context_save( );
+    return OKLORAWAN;
 }
 
 /*
@@ -753,18 +1297,163 @@ status_lorawan_t lr1mac_core_set_region( smtc_real_region_types_t region_type )
  * --- PRIVATE FUNCTIONS DEFINITIONS ------------------------------------------------
  */
 
+static lr1mac_states_t payload_send( uint8_t fport, const uint8_t* data_in, const uint8_t size_in,
+                                     uint8_t packet_type, uint32_t target_time_ms )
+{
+    status_lorawan_t status;
+    status = smtc_real_is_valid_size( lr1_mac_obj, lr1_mac_obj->tx_data_rate, size_in );
+    if( status == ERRORLORAWAN )
+    {
+        BSP_DBG_TRACE_ERROR( "PAYLOAD SIZE TOO HIGH \n" );
+        return ( LWPSTATE_INVALID );
+    }
+//    if( lr1mac_core_is_otaa_device( ) == OTAA_DEVICE )
+//    {
+//        if( lr1_mac_obj->join_status == NOT_JOINED )
+//        {
+//            BSP_DBG_TRACE_ERROR( "OTAA DEVICE NOT JOINED YET\n" );
+//            return ( LWPSTATE_INVALID );
+//        }
+//    }
+    if( stack->state != LWPSTATE_IDLE )
+    {
+        BSP_DBG_TRACE_ERROR( "LP STATE NOT EQUAL TO IDLE \n" );
+        return ( LWPSTATE_ERROR );
+    }
+    // Decrement duty cycle before check the available DTC
+    smtc_real_duty_cycle_update( lr1_mac_obj );
+    if( smtc_real_next_channel_get( lr1_mac_obj ) != OKLORAWAN )
+    {
+        BSP_DBG_TRACE_WARNING( "NO CHANNEL AVAILABLE\n" );
+        return ( LWPSTATE_DUTY_CYCLE_FULL );
+    }
+
+    if( lr1mac_core_next_free_duty_cycle_ms_get( ) > 0 )
+    {
+        BSP_DBG_TRACE_WARNING( "Duty Cycle is full\n" );
+        return ( LWPSTATE_DUTY_CYCLE_FULL );
+    }
+
+    lr1_mac_obj->timestamp_failsafe  = bsp_rtc_get_time_s( );
+    lr1_mac_obj->rtc_target_timer_ms = target_time_ms;
+    lr1_mac_obj->tx_preempt          = false;
+    lr1_mac_obj->tx_scheduled        = false;
+    copy_user_payload( data_in, size_in );
+    lr1_mac_obj->app_payload_size = size_in;
+    lr1_mac_obj->tx_fport         = fport;
+    lr1_mac_obj->tx_mtype         = packet_type;
+    // the frame is complete from here, encrypted and signed with the fcnt_up it holds until its last transmission
+    lr1_stack_mac_tx_frame_build( lr1_mac_obj );
+    lr1_stack_mac_tx_frame_encrypt( lr1_mac_obj );
+    if( packet_type == CONF_DATA_UP )
+    {
+        lr1_mac_obj->nb_trans_cpt = MAX_CONFUP_MSG;
+    }
+    else
+    {
+        lr1_mac_obj->nb_trans_cpt = lr1_mac_obj->nb_trans;
+    }
+    stack->state = LWPSTATE_SEND;
+    return ( stack->state );
+}
+
 static void copy_user_payload( const uint8_t* data_in, const uint8_t size_in )
 {
-    //memcpy( &lr1_mac_obj.tx_payload[FHDROFFSET + lr1_mac_obj.tx_fopts_current_length], data_in, size_in );
-	memcpy( &lr1_mac_obj.tx_payload[0], data_in, size_in );
+    uint8_t* tx_payload = lr1mac_core_tx_payload_buffer_get( );
+
+    // nothing to copy if the payload was written in place
+    if( data_in != tx_payload )
+    {
+        memmove( tx_payload, data_in, size_in );
+    }
 }
 
 static uint32_t failsafe_timstamp_get( void )
 {
-    return lr1_mac_obj.timestamp_failsafe;
+    return lr1_mac_obj->timestamp_failsafe;
 }
 
 static rp_status_t rp_status_get( void )
 {
-    return lr1_mac_obj.planner_status;
+    return lr1_mac_obj->planner_status;
+}
+
+static void class_c_process( void )
+{
+    lr1_stack_mac_class_c_t* class_c = &lr1_mac_obj->class_c;
+
+    if( class_c->is_rx_done == true )
+    {
+        DBG_PRINT_WITH_LINE( "Receive a downlink RXC for Hook Id = %d", stack->class_c_id4rp );
+        rx_packet_type_t rx_packet_type = lr1_stack_mac_class_c_rx_decode( lr1_mac_obj );
+
+        if( ( rx_packet_type == NWKRXPACKET ) || ( rx_packet_type == USERRX_FOPTSPACKET ) )
+        {
+            lr1_stack_mac_cmd_parse( lr1_mac_obj );
+            lr1_stack_mac_class_c_update( lr1_mac_obj );
+            // the mac commands may have changed the channel plan or the rx parameters
+            smtc_real_session_save( lr1_mac_obj );
+        }
+    }
+    // restarted with the current RX2 parameters, they may have been changed by the last downlink
+    if( ( class_c->enabled == true ) && ( lr1_mac_obj->join_status == JOINED ) && ( class_c->is_running == false ) &&
+        ( class_c->is_rx_done == false ) )
+    {
+        lr1_stack_mac_class_c_rx_start( lr1_mac_obj );
+    }
+}
+
+static void class_b_process( void )
+{
+    lr1_stack_mac_class_b_t* class_b = &lr1_mac_obj->class_b;
+
+    if( class_b->is_beacon_done == true )
+    {
+        lr1_stack_mac_class_b_beacon_process( lr1_mac_obj );
+    }
+    if( ( class_b->enabled == false ) || ( lr1_mac_obj->join_status != JOINED ) )
+    {
+        return;
+    }
+    if( class_b->is_beacon_running == false )
+    {
+        lr1_stack_mac_class_b_beacon_start( lr1_mac_obj );
+    }
+    // the ping slots share the class C hook, the continuous reception already covers them
+    if( ( class_b->state == LR1MAC_CLASS_B_STATE_TRACKING ) && ( class_b->is_ping_info_acked == true ) &&
+        ( lr1_mac_obj->class_c.enabled == false ) && ( lr1_mac_obj->class_c.is_running == false ) &&
+        ( lr1_mac_obj->class_c.is_rx_done == false ) )
+    {
+        lr1_stack_mac_class_b_ping_start( lr1_mac_obj );
+    }
+}
+
+static void dr_distribution_apply( void )
+{
+    dr_strategy_t distribution = lr1_mac_obj->adr_mode_select;
+
+    if( ( lr1_mac_obj->is_dr_low_power == true ) && ( distribution == MOBILE_LONGRANGE_DR_DISTRIBUTION ) )
+    {
+        distribution = MOBILE_LOWPER_DR_DISTRIBUTION;
+    }
+    smtc_real_dr_distribution_set( lr1_mac_obj, distribution );
+}
+
+static void tx_scheduled_invalidate( void )
+{
+    if( ( stack->state == LWPSTATE_SEND ) && ( lr1_mac_obj->tx_scheduled == true ) )
+    {  // built with the former settings: dropped rather than sent on a stale channel or data rate
+        lr1mac_core_tx_wait_abort( );
+    }
+}
+
+static region_params_t* region_params_get( smtc_real_region_types_t region_type )
+{
+    uint8_t i = 0;
+
+    while( ( i < ( SMTC_REAL_REGION_LIST_LENGTH - 1 ) ) && ( smtc_real_region_list[i] != region_type ) )
+    {
+        i++;
+    }
+    return &stack->region_params[i];
 }
@@ -53,6 +53,9 @@
  *            DevEui, AppEUI, APPKey mandatory for OTAA devices
  *            OTAA or ABP Flag.
  *         In future implementation A Radio objet will be also a parameter of this class.
+ *         Up to LR1MAC_NB_STACK stacks share the radio planner, each with its own keys, region, hooks and nvm slot.
+ *         The functions below act on the stack selected by lr1mac_core_stack_select, the first one by default: a
+ *         stack is initialized and processed while selected.
  */
 
 void lr1mac_core_init( radio_planner_t* rp, lorawan_keys_t* lorawan_keys, smtc_real_t* smtc_region );
@@ -82,6 +85,14 @@ void lr1mac_core_init( radio_planner_t* rp, lorawan_keys_t* lorawan_keys, smtc_r
      */
 status_lorawan_t lr1mac_core_payload_receive( uint8_t* UserRxFport, uint8_t* UserRxPayload,
                                               uint8_t* UserRxPayloadSize );
+/*!
+ * \brief  Receive Applicative Downlink without copy
+ * \remark The payload points to the stack downlink buffer, it is valid until the next downlink is received by
+ *         lr1mac_core_downlink_get or lr1mac_core_payload_receive
+ * \param [OUT] port, payload, size
+ * \param [OUT] status_lorawan_t   Return an error if No Packet available.
+ */
+status_lorawan_t lr1mac_core_downlink_get( uint8_t* port, uint8_t** payload, uint8_t* size );
 
 /*!
  * \brief to Send a Join request
@@ -117,6 +128,7 @@ void lr1mac_core_join_status_clear( void );
  *            STATIC_ADR_MODE                  for static Devices with ADR managed by the Network
  *            MOBILE_LONGRANGE_DR_DISTRIBUTION for Mobile Devices with strong Long range requirement
  *            MOBILE_LOWPER_DR_DISTRIBUTION    for Mobile Devices with strong Low power requirement
+ *            LINK_MARGIN_ADR_MODE             for Devices on a network with a weak ADR, chosen from the link margins
  *            JOIN_DR_DISTRIBUTION             Dedicated for Join requests
  *
  * \param [IN]  dr_strategy_t              DataRate Mode (describe above)
@@ -126,6 +138,15 @@ void          lr1mac_core_dr_strategy_set( dr_strategy_t adrModeSelect );
 dr_strategy_t lr1mac_core_dr_strategy_get( void );
 void          lr1mac_core_dr_custom_set( uint32_t DataRateCustom );
 
+/*!
+ * \brief   Replaces the long range datarate distribution by the low power one, to spare a low battery
+ * \remark  The strategy selected by the user is kept, and reported by lr1mac_core_dr_strategy_get. Only
+ *          MOBILE_LONGRANGE_DR_DISTRIBUTION is affected, from the next uplink of a joined device.
+ *
+ * \param [IN]  is_low_power               true to use MOBILE_LOWPER_DR_DISTRIBUTION in its place
+ */
+void lr1mac_core_dr_low_power_set( bool is_low_power );
+
 /*!
  * \brief   Runs the MAC layer state machine.
  *          Must be called periodically by the application. Not timing critical. Can be interrupted.
@@ -151,10 +172,23 @@ uint8_t lr1mac_core_radio_state_get( void );
 status_lorawan_t lr1mac_core_context_load( void );
 /*!
  * \brief   Save The LoraWAN context  in the flash
+ * \remark  The context is only marked as changed, it is written by lr1mac_core_context_flush
  * \param [IN]  none
  * \param [OUT] none
  */
 void lr1mac_core_context_save( void );
+/*!
+ * \brief   Write the LoraWAN context in the flash if it has changed since the last write
+ * \param [IN]  none
+ * \param [OUT] none
+ */
+void lr1mac_core_context_flush( void );
+/*!
+ * \brief   Tell if the LoraWAN context has changed since the last write
+ * \param [IN]  none
+ * \param [OUT] bool true if a write is pending
+ */
+bool lr1mac_core_context_is_dirty( void );
 /*!
  * \brief   Get the snr of the last user receive packet
  * \param [IN]  none
@@ -301,6 +335,13 @@ uint8_t lr1mac_core_min_dr_get( void );
  * \param [OUT] return
  */
 lr1mac_states_t lr1mac_core_state_get( void );
+/*!
+ * \brief   returns the time before lr1mac_core_process has to be called again
+ * \remark  radio events wake up the main loop on their own, the returned delay only covers the timers
+ * \param [IN]  none
+ * \param [OUT] return delay in ms, 0 if the process has to be called immediately
+ */
+uint32_t lr1mac_core_next_process_delay_ms_get( void );
 /*!
  * \brief
  * \remark
@@ -336,6 +377,13 @@ void lr1mac_core_apps_key_get( uint8_t* key );
  * \param [OUT] return
  */
 join_status_t lr1_mac_joined_status_get( void );
+/*!
+ * \brief   Buffer the application payload of the next uplink can be written in, to be sent without copy
+ * \remark  Only valid while the stack is idle, up to LR1MAC_TX_PAYLOAD_MAX_SIZE bytes. The headers of the frame are
+ *          built in front of it by lr1mac_core_payload_send, called with this buffer as dataIn
+ * \param [OUT] return
+ */
+uint8_t* lr1mac_core_tx_payload_buffer_get( void );
 /*!
  * \brief
  * \remark
@@ -345,13 +393,47 @@ join_status_t lr1_mac_joined_status_get( void );
 lr1mac_states_t lr1mac_core_payload_send( uint8_t fPort, const uint8_t* dataIn, const uint8_t sizeIn,
                                           uint8_t PacketType, uint32_t target_time_ms );
 /*!
- * \brief
- * \remark
- * \param [IN]  none
- * \param [OUT] return
+ * \brief   Send an uplink at a given time
+ * \remark  The frame is built now. Unless its date is too close, it is given to the radio planner right away and
+ *          waits there, so the Tx starts at its date. A change of the data rate settings or of the session before
+ *          then drops it, see lr1mac_core_tx_wait_abort.
+ * \param [IN]  same as lr1mac_core_payload_send
+ * \param [OUT] return lr1mac_states_t, LWPSTATE_SEND if the uplink is started
  */
 lr1mac_states_t lr1mac_core_payload_send_at_time( uint8_t fport, const uint8_t* data_in, const uint8_t size_in,
                                                   uint8_t packet_type, uint32_t target_time_ms );
+/*!
+ * \brief   Send an uplink ahead of the traffic in progress
+ * \remark  The transmissions of the uplink are scheduled radio planner tasks: they abort the asap tasks of the other
+ *          hooks and skip the LBT.
+ * \param [IN]  same as lr1mac_core_payload_send
+ * \param [OUT] return lr1mac_states_t, LWPSTATE_SEND if the uplink is started
+ */
+lr1mac_states_t lr1mac_core_payload_send_preempt( uint8_t fport, const uint8_t* data_in, const uint8_t size_in,
+                                                  uint8_t packet_type, uint32_t target_time_ms );
+/*!
+ * \brief   Drop the retransmission, the mac answer or the uplink sent at time waiting for its date
+ * \remark  Only an uplink not on air yet is dropped: the LWPSTATE_TX_WAIT state, or a retransmission or an uplink
+ *          sent at time waiting for its date in the radio planner
+ * \param [IN]  none
+ * \param [OUT] return lr1mac_states_t, the state of the stack
+ */
+lr1mac_states_t lr1mac_core_tx_wait_abort( void );
+/*!
+ * \brief   Tell whether the mac answers to the last downlink wait for an uplink
+ * \remark  Only the answers short enough for the fopts wait, the longer ones are sent at once in a port 0 frame
+ * \param [IN]  none
+ * \param [OUT] return true if the stack is idle and the answers are in the fopts of no uplink yet
+ */
+bool lr1mac_core_nwk_ans_pending_get( void );
+/*!
+ * \brief   Send the pending mac answers alone in a port 0 frame
+ * \remark  For the devices without an uplink due soon. The frame is sent at the fastest datarate the link margin
+ *          allows, see lr1_stack_mac_nwk_ans_dr_set. The answers are kept for the next uplink if it is not started.
+ * \param [IN]  target_time_ms  date of the frame
+ * \param [OUT] return lr1mac_states_t, LWPSTATE_SEND if the frame is started
+ */
+lr1mac_states_t lr1mac_core_nwk_ans_send( uint32_t target_time_ms );
 /*!
  * \brief
  * \remark
@@ -397,6 +479,19 @@ uint32_t lr1mac_core_fcnt_up_get( void );
  * \param [OUT] return
  */
 uint32_t lr1mac_core_next_join_time_second_get( void );
+/*!
+ * \brief   Return true when a join was started and not accepted yet, also after a reset
+ * \remark  The join retries are spaced by the join duty cycle and an exponential random back-off
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+bool lr1mac_core_join_pending_get( void );
+/*!
+ * \brief   Forget the pending join and its retry counter, the next join starts without back-off
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void lr1mac_core_join_pending_clear( void );
 /*!
  * \brief
  * \remark
@@ -411,6 +506,147 @@ int32_t lr1mac_core_next_free_duty_cycle_ms_get( void );
  * \param [OUT] return
  */
 void lr1mac_core_duty_cycle_enable_set( uint8_t enable );
+/*!
+ * \brief   Select the uplink channels at random weighted by their link statistics instead of uniformly
+ * \remark  The statistics are the confirmed uplinks and join requests success, the RX1 downlinks SNR and the
+ *          positive CADs of each channel
+ * \param [IN]  enable    1 to weight the selection, 0 for the uniform selection by default
+ */
+void lr1mac_core_weighted_channel_selection_enable_set( uint8_t enable );
+/*!
+ * \brief   Get the tx frequencies of the enabled channels, to be scanned for their occupancy
+ * \param [OUT] freq_in_hz   Frequencies of the enabled channels
+ * \param [IN]  freq_max     Size of freq_in_hz
+ * \param [OUT] return       Number of frequencies written, 0 when the region has no channel occupancy
+ */
+uint8_t lr1mac_core_channel_scan_plan_get( uint32_t* freq_in_hz, uint8_t freq_max );
+/*!
+ * \brief   Add a channel scan result to the channel occupancy, weighing the weighted channel selection
+ * \param [IN]  freq_in_hz   Frequency scanned
+ * \param [IN]  busy_ratio   Share of the samples above the busy threshold, 255 for all of them
+ */
+void lr1mac_core_channel_occupancy_update( uint32_t freq_in_hz, uint8_t busy_ratio );
+/*!
+ * \brief   Listen before talk: do a CAD on the Tx channel before each LoRa uplink
+ * \remark  On a positive CAD, the uplink moves to another channel after a random backoff, up to
+ *          LBT_MAX_CAD_ATTEMPTS times before it is sent anyway. The uplinks sent at time are not delayed by a CAD.
+ * \param [IN]  enable    1 to enable the listen before talk, 0 by default
+ */
+void lr1mac_core_lbt_enable_set( uint8_t enable );
+/*!
+ * \brief   Listen before talk setting, see lr1mac_core_lbt_enable_set
+ * \param [OUT] return    1 if the listen before talk is enabled
+ */
+uint8_t lr1mac_core_lbt_enable_get( void );
+/*!
+ * \brief   CAD gated RX windows: start the LoRa RX windows with a CAD, the reception only follows a positive CAD
+ * \remark  Only used when the window is narrow enough for the CAD to fall in the downlink preamble, the other
+ *          windows are opened as usual
+ * \param [IN]  enable    1 to enable the CAD gate, 0 by default
+ */
+void lr1mac_core_rx_cad_gate_enable_set( uint8_t enable );
+/*!
+ * \brief   Uplink power control: lower the uplink power to hold the margin at the gateway
+ * \remark  The path loss is the gateway EIRP less the RSSI of the downlinks. The power is only lowered below the one
+ *          set by the region or the network ADR, so the network keeps the upper hand. It goes back to that power
+ *          after adr_ack_limit uplinks without downlink.
+ * \param [IN]  enable        1 to enable the power control, 0 by default
+ * \param [IN]  gw_eirp_dbm   EIRP of the gateway downlinks
+ */
+void lr1mac_core_tx_power_ctrl_set( uint8_t enable, int8_t gw_eirp_dbm );
+/*!
+ * \brief   Get the link margin of the uplinks, estimated from the SNR of the downlinks and the LinkCheckAns margins
+ * \param [OUT] margin_db     margin above the demodulation floor at the datarate and power of the last uplink
+ * \param [OUT] return        ERRORLORAWAN while too few downlinks were received
+ */
+status_lorawan_t lr1mac_core_link_margin_get( int16_t* margin_db );
+/*!
+ * \brief   Request the network time: a DeviceTimeReq is added to the fopts of the next application uplinks
+ * \remark  Once answered, the request is renewed by the stack every LR1MAC_DEVICE_TIME_RESYNC_S
+ */
+void lr1mac_core_device_time_req( void );
+/*!
+ * \brief   Enable the link check monitor: a LinkCheckReq is piggybacked on the application uplinks
+ * \remark  Checked every uplink at first, then up to every LR1MAC_LINK_CHECK_PERIOD_MAX uplinks while the link is good
+ * \param [IN]  enable        1 to enable the monitor, 0 by default
+ */
+void lr1mac_core_link_check_enable_set( uint8_t enable );
+/*!
+ * \brief   Get the link state rated by the link check monitor
+ * \param [OUT] miss_cnt      number of LinkCheckReq unanswered in a row
+ * \param [OUT] return        link state
+ */
+lr1mac_link_state_t lr1mac_core_link_state_get( uint8_t* miss_cnt );
+/*!
+ * \brief   Get the network time
+ * \remark  Millisecond accurate right after the DeviceTimeAns, the RTC drift measured between the answers is then
+ *          compensated
+ * \param [OUT] gps_time_ms   time since the GPS epoch in milliseconds
+ * \param [OUT] return        ERRORLORAWAN until a DeviceTimeAns is received
+ */
+status_lorawan_t lr1mac_core_network_time_get( uint64_t* gps_time_ms );
+/*!
+ * \brief   Slotted uplinks: send the uplinks in the slot of the device on the network time
+ * \remark  The uplinks sent by lr1mac_core_payload_send start at the next slot of the device, without LBT: the
+ *          devices of consecutive DevAddr don't overlap. The slot must hold the longest uplink and the error of the
+ *          network time. The retransmissions are not slotted, the at time and preempt uplinks keep their time.
+ * \param [IN]  period_ms   frame period, 0 to send the uplinks as soon as possible again
+ * \param [IN]  slot_ms     slot length, up to period_ms
+ * \param [OUT] return      ERRORLORAWAN if the slot doesn't fit in the period
+ */
+status_lorawan_t lr1mac_core_tx_slot_set( uint32_t period_ms, uint16_t slot_ms );
+/*!
+ * \brief   Get the slotted uplinks configuration
+ * \param [OUT] period_ms   frame period, 0 when the uplinks are not slotted
+ * \param [OUT] slot_ms     slot length
+ */
+void lr1mac_core_tx_slot_get( uint32_t* period_ms, uint16_t* slot_ms );
+/*!
+ * \brief   Set the number of uplinks between two frame counter saves in nvm
+ * \remark  After a reset, fcnt_up resumes at the saved value plus this period: a longer period spares the nvm,
+ *          a shorter one wastes fewer counters
+ * \param [IN]  period    Uplinks between two saves, LR1MAC_SESSION_FCNT_SAVE_PERIOD by default
+ * \param [OUT] return    ERRORLORAWAN if period is 0
+ */
+status_lorawan_t lr1mac_core_fcnt_save_period_set( uint16_t period );
+/*!
+ * \brief   Enable the class C continuous reception on the RX2 parameters
+ * \remark  The reception runs while the stack is idle and joined, the class A uplinks and windows preempt it.
+ *          lr1mac_core_process has to be called in idle state to decode the RXC downlinks and restart the reception
+ * \param [IN]  enable    true for class C, false for class A (default)
+ */
+void lr1mac_core_class_c_enable_set( bool enable );
+/*!
+ * \brief   Enable the class B beacon tracking and ping slots, on the first stack only
+ * \remark  A DeviceTimeReq is sent first if the network time is unknown, the beacon windows then open every beacon
+ *          period and the ping slots once the network has acknowledged the PingSlotInfoReq.
+ *          lr1mac_core_process has to be called in idle state to check the beacons and decode the ping slots downlinks
+ * \param [IN]  enable    true for class B, false for class A (default)
+ */
+void lr1mac_core_class_b_enable_set( bool enable );
+/*!
+ * \brief   Set the ping slot periodicity, a ping slot every 2^periodicity seconds
+ * \remark  The new periodicity is sent to the network with a PingSlotInfoReq piggybacked on the next uplink
+ * \param [IN]  periodicity    0 to 7
+ * \param [OUT] return         ERRORLORAWAN if the periodicity is out of range
+ */
+status_lorawan_t lr1mac_core_class_b_periodicity_set( uint8_t periodicity );
+/*!
+ * \brief   Get the class B state
+ * \param [OUT] return    off, searching the beacon or tracking it
+ */
+lr1mac_class_b_state_t lr1mac_core_class_b_state_get( void );
+/*!
+ * \brief   Set or clear a multicast group
+ * \remark  The group downlinks are received in the class C windows and read as the unicast ones
+ * \param [IN]  group_id      Group index, lower than LR1MAC_MULTICAST_GROUP_NB
+ * \param [IN]  mc_addr       Group address
+ * \param [IN]  mc_nwk_skey   16 bytes McNwkSKey, NULL to clear the group
+ * \param [IN]  mc_app_skey   16 bytes McAppSKey, NULL to clear the group
+ * \param [OUT] return        ERRORLORAWAN if the group index is out of range
+ */
+status_lorawan_t lr1mac_core_multicast_set( uint8_t group_id, uint32_t mc_addr, const uint8_t* mc_nwk_skey,
+                                            const uint8_t* mc_app_skey );
 /*!
  * \brief
  * \remark
@@ -427,6 +663,23 @@ uint32_t lr1mac_core_version_get( void );
  */
 uint8_t lr1mac_core_rx_ack_bit_get( void );
 
+/*!
+ * \brief   Get the FPending bit of the downlink answering the last uplink
+ * \remark  The network has more downlinks queued for the device when it is set
+ * \param [IN]  none
+ * \param [OUT] return FPending bit, -1 if no valid downlink answered the last uplink
+ */
+int8_t lr1mac_core_rx_fpending_bit_get( void );
+
+/*!
+ * \brief   Send the next uplink at the fastest datarate of the current datarate strategy
+ * \remark  Meant for the small frames, e.g. the empty ones only opening receive windows. The strategy is applied
+ *          again from the uplink after.
+ * \param [IN]  none
+ * \param [OUT] none
+ */
+void lr1mac_core_next_dr_fastest_set( void );
+
 /*!
  * \brief
  * \remark
@@ -435,6 +688,21 @@ uint8_t lr1mac_core_rx_ack_bit_get( void );
  */
 lr1_stack_mac_t* lr1mac_core_stack_mac_get( void );
 
+/*!
+ * \brief   Select the stack the lr1mac_core functions act on
+ * \remark  The modem drives the first stack, a caller selecting another one must select the first one back
+ *          before returning to the modem. Two stacks can't use the same region
+ * \param [IN]  stack_id    0 to LR1MAC_NB_STACK - 1
+ * \param [OUT] return      ERRORLORAWAN if the stack doesn't exist
+ */
+status_lorawan_t lr1mac_core_stack_select( uint8_t stack_id );
+
+/*!
+ * \brief   Get the stack the lr1mac_core functions act on
+ * \param [OUT] return      stack id
+ */
+uint8_t lr1mac_core_stack_selected_get( void );
+
 /*!
  * \brief
  * \remark
@@ -452,10 +720,19 @@ status_lorawan_t lr1mac_core_is_supported_region( smtc_real_region_types_t regio
 smtc_real_region_types_t lr1mac_core_get_region( void );
 
 /*!
- * \brief
+ * \brief   Switch to another compiled-in region without a reinit of the session
+ * \remark  The stack parameters of the region left are kept in RAM with its channel plan, a switch back restores
+ *          them. A region used for the first time since the boot is initialized
+ * \param [IN]  region_type
+ * \param [OUT] return      ERRORLORAWAN if the region is not supported or a frame is being sent or received
+ */
+status_lorawan_t lr1mac_core_set_region( smtc_real_region_types_t region_type );
+
+/*!
+ * \brief   Get the RAM taken by the LoRaWAN stack object
  * \remark
  * \param [IN]  none
- * \param [OUT] return
+ * \param [OUT] return size in bytes
  */
-status_lorawan_t lr1mac_core_set_region( smtc_real_region_types_t region_type );
+uint32_t lr1mac_core_get_ram_size( void );
 #endif
@@ -67,6 +67,14 @@ extern "C" {
 #define TXPARAM_SETUP_ANS_SIZE          (1)
 #define DL_CHANNEL_REQ_SIZE             (5)
 #define DL_CHANNEL_ANS_SIZE             (2)
+#define DEVICE_TIME_REQ_SIZE            (1)
+#define DEVICE_TIME_ANS_SIZE            (6)
+#define PING_SLOT_INFO_REQ_SIZE         (2)
+#define PING_SLOT_INFO_ANS_SIZE         (1)
+#define PING_SLOT_CHANNEL_REQ_SIZE      (5)
+#define PING_SLOT_CHANNEL_ANS_SIZE      (2)
+#define BEACON_FREQ_REQ_SIZE            (4)
+#define BEACON_FREQ_ANS_SIZE            (2)
 #define MAX_RETRY_JOIN_DUTY_CYCLE_100   (10)
 #define MAX_RETRY_JOIN_DUTY_CYCLE_1000  (10 + MAX_RETRY_JOIN_DUTY_CYCLE_100)
 #define MIN_LORAWAN_PAYLOAD_SIZE        (12)
@@ -76,6 +84,11 @@ extern "C" {
 #define MAX_TX_PAYLOAD_SIZE             (255)
 #define FHDROFFSET                      (9)  // MHDR+FHDR offset if OPT = 0 + fport
 #define MICSIZE                         (4)
+#define LR1MAC_RX_HEADER_SIZE           (5)  // MHDR + DevAddr, checked before the rest of a downlink is read
+#define LR1MAC_FOPTS_MAX_SIZE           (15)
+// The application payload of an uplink is written at this offset of tx_payload, the headers are built in front of it
+#define LR1MAC_TX_PAYLOAD_OFFSET        (FHDROFFSET + LR1MAC_FOPTS_MAX_SIZE)
+#define LR1MAC_TX_PAYLOAD_MAX_SIZE      (MAX_TX_PAYLOAD_SIZE - LR1MAC_TX_PAYLOAD_OFFSET - MICSIZE)
 #define LR1MAC_PROTOCOL_VERSION         (0x00010300)
 #define GFSK_WHITENING_SEED             (0x01FF)
 #define GFSK_CRC_SEED                   (0x1D0F)
@@ -84,6 +97,139 @@ extern "C" {
 // if there were no rx packet before the last NO_RX_PACKET_CNT tx packets the lr1mac goes in panic
 #define NO_RX_PACKET_CNT                (2400)
 
+// Listen before talk: positive CADs before the uplink is sent anyway, each followed by a random backoff
+#define LBT_MAX_CAD_ATTEMPTS            (3)
+#define LBT_BACKOFF_MIN_MS              (10)
+#define LBT_BACKOFF_MAX_MS              (100)
+#define LBT_CAD_DURATION_SYMB           (2)  // one CAD symbol and its processing
+
+// CAD gated RX windows: CAD duration, and preamble symbols the reception needs after a positive CAD
+#define RX_CAD_GATE_SYMB                (2)
+#define RX_CAD_GATE_LOCK_SYMB           (4)
+
+// A scheduled uplink starts at least this margin ahead: the radio planner aborts the tasks in the past
+#define LR1MAC_TX_SCHEDULE_MARGIN_MS    (20)
+
+// A mac answer frame is scheduled this long after the downlink, a retransmission waits 1 to 3 s
+#define LR1MAC_NWK_ANS_DELAY_MIN_MS     (100)
+#define LR1MAC_NWK_ANS_DELAY_MAX_MS     (500)
+
+// Radio power modes: the DC-DC start-up only pays off from LR1MAC_DCDC_MIN_RADIO_ON_MS of radio activity. The high
+// sensitivity LNA is used when the last downlink was received less than LR1MAC_LNA_MIN_MARGIN_DB above sensitivity
+#define LR1MAC_DCDC_MIN_RADIO_ON_MS     (10)
+#define LR1MAC_LNA_MIN_MARGIN_DB        (10)
+
+// LINK_MARGIN_ADR_MODE: the mean SNR of the last LR1MAC_LINK_MARGIN_WINDOW link margin samples is kept
+// LR1MAC_LINK_MARGIN_TARGET_DB above the demodulation floor of the uplinks. A datarate or power step is worth
+// LR1MAC_LINK_MARGIN_STEP_DB, a faster datarate or a lower power needs LR1MAC_LINK_MARGIN_HYSTERESIS_DB more
+#define LR1MAC_LINK_MARGIN_WINDOW       (8)
+#define LR1MAC_LINK_MARGIN_MIN_SAMPLES  (3)
+#ifndef LR1MAC_LINK_MARGIN_TARGET_DB
+#define LR1MAC_LINK_MARGIN_TARGET_DB    (10)
+#endif
+#define LR1MAC_LINK_MARGIN_STEP_DB      (3)
+#define LR1MAC_LINK_MARGIN_HYSTERESIS_DB (2)
+
+// Uplink power control: the uplinks reach the gateway LR1MAC_TX_POWER_CTRL_MARGIN_DB above its sensitivity, estimated
+// from the path loss of the downlinks. The power is never lowered below LR1MAC_TX_POWER_CTRL_MIN_DBM
+#ifndef LR1MAC_TX_POWER_CTRL_MARGIN_DB
+#define LR1MAC_TX_POWER_CTRL_MARGIN_DB  (10)
+#endif
+#define LR1MAC_TX_POWER_CTRL_MIN_DBM    (-18)
+
+// RX window timing model learned from the downlinks: used from LR1MAC_RX_DRIFT_MIN_SAMPLES downlinks, dropped
+// after LR1MAC_RX_DRIFT_MAX_MISSES uplinks in a row without their answer
+#define LR1MAC_RX_DRIFT_MIN_SAMPLES     (4)
+#define LR1MAC_RX_DRIFT_MAX_MISSES      (2)
+#define LR1MAC_RX_DRIFT_MARGIN_US       (1000)  // resolution of the timestamps
+
+// Network time: once synchronized by a DeviceTimeAns, a new DeviceTimeReq is sent every LR1MAC_DEVICE_TIME_RESYNC_S.
+// The local clock drift is measured between two answers LR1MAC_DEVICE_TIME_DRIFT_MIN_S apart at least, a drift over
+// LR1MAC_DEVICE_TIME_DRIFT_MAX_PPB is taken for a wrong answer and not used
+#ifndef LR1MAC_DEVICE_TIME_RESYNC_S
+#define LR1MAC_DEVICE_TIME_RESYNC_S     (86400)
+#endif
+#define LR1MAC_DEVICE_TIME_DRIFT_MIN_S  (3600)
+#define LR1MAC_DEVICE_TIME_DRIFT_MAX_PPB (500000)
+
+// Link check monitor: a LinkCheckReq rides on an application uplink every period uplinks. The period doubles from
+// LR1MAC_LINK_CHECK_PERIOD_MIN up to LR1MAC_LINK_CHECK_PERIOD_MAX while the answers give
+// LR1MAC_LINK_CHECK_WEAK_MARGIN_DB or more, it drops back to the min on a lower margin or a request unanswered. The
+// link is lost after LR1MAC_LINK_CHECK_LOST_MISSES requests in a row unanswered
+#define LR1MAC_LINK_CHECK_PERIOD_MIN (1)
+#define LR1MAC_LINK_CHECK_PERIOD_MAX (32)
+#define LR1MAC_LINK_CHECK_WEAK_MARGIN_DB (5)
+#define LR1MAC_LINK_CHECK_LOST_MISSES (3)
+// Class B: a beacon every LR1MAC_CLASS_B_BEACON_PERIOD_S of GPS time. The first LR1MAC_CLASS_B_BEACON_RESERVED_MS of
+// the period are reserved to the beacon, the rest holds 4096 ping slots of LR1MAC_CLASS_B_PING_SLOT_MS
+#define LR1MAC_CLASS_B_BEACON_PERIOD_S    (128)
+#define LR1MAC_CLASS_B_BEACON_RESERVED_MS (2120)
+#define LR1MAC_CLASS_B_PING_SLOT_MS       (30)
+#define LR1MAC_CLASS_B_PING_SLOT_NB       (4096)
+#define LR1MAC_CLASS_B_BEACON_MAX_SIZE    (23)
+#define LR1MAC_CLASS_B_BEACON_PREAMBLE    (10)    // symbols
+// The first beacon is searched on the network time in a window LR1MAC_CLASS_B_ACQ_WINDOW_MS wide on each side,
+// doubled at each beacon missed up to LR1MAC_CLASS_B_ACQ_WINDOW_MAX_MS. The next windows are widened by the clock
+// drift over the time since the last beacon received: LR1MAC_CLASS_B_DRIFT_MAX_PPM at first, halved at each beacon
+// received down to LR1MAC_CLASS_B_DRIFT_MIN_PPM as the drift is learned. After LR1MAC_CLASS_B_BEACON_LOST_NB
+// beacons missed, 2 hours, the ping slots stop and the beacon is searched again
+#define LR1MAC_CLASS_B_ACQ_WINDOW_MS      (50)
+#define LR1MAC_CLASS_B_ACQ_WINDOW_MAX_MS  (8000)
+#define LR1MAC_CLASS_B_WINDOW_MIN_MS      (3)
+#define LR1MAC_CLASS_B_DRIFT_MAX_PPM      (100)
+#define LR1MAC_CLASS_B_DRIFT_MIN_PPM      (5)
+#define LR1MAC_CLASS_B_BEACON_LOST_NB     (56)
+#define LR1MAC_CLASS_B_PING_MIN_SYMB      (6)     // symbols of a ping slot window without widening
+#define LR1MAC_CLASS_B_SCHEDULE_MARGIN_MS (20)    // a window starting sooner is skipped
+#ifndef LR1MAC_CLASS_B_PING_PERIODICITY
+#define LR1MAC_CLASS_B_PING_PERIODICITY   (4)     // ping slot every 2^periodicity s, 0 to 7
+#endif
+// LoRaWAN stacks sharing the radio planner, each one on its own region. The first stack uses the hooks 0 and 1, the
+// next ones two hooks each from LR1MAC_EXTRA_STACK_HOOK_ID, after the ranging and BLE beacon hooks
+#ifndef LR1MAC_NB_STACK
+#define LR1MAC_NB_STACK                 (1)
+#endif
+#define LR1MAC_EXTRA_STACK_HOOK_ID      (4)
+// The class B beacons of the first stack take the next hook, the ping slots are received on the class C hook
+#define LR1MAC_CLASS_B_HOOK_ID          ( LR1MAC_EXTRA_STACK_HOOK_ID + ( 2 * ( LR1MAC_NB_STACK - 1 ) ) )
+// Downlink counter rebuilt from its 16 transmitted bits: the LR1MAC_FCNT_DWN_MSB_CANDIDATES MSB values following the
+// last counter are tried against the MIC, enough to follow 3 x 65536 downlinks missed while offline
+#ifndef LR1MAC_FCNT_DWN_MSB_CANDIDATES
+#define LR1MAC_FCNT_DWN_MSB_CANDIDATES  (4)
+#endif
+
+// DevNonces reserved in nvm at once: a join request only writes the nvm once every LR1MAC_DEV_NONCE_RESERVE
+#define LR1MAC_DEV_NONCE_RESERVE        (16)
+// The frame counters are journaled every fcnt_save_period uplinks, the restored fcnt_up skips it. Default period:
+#define LR1MAC_SESSION_FCNT_SAVE_PERIOD (32)
+
+// Downlinks kept until the application reads them, class C downlinks may come faster than they are read. The last
+// downlink read keeps its entry until the next read
+#ifndef LR1MAC_DOWNLINK_FIFO_DEPTH
+#define LR1MAC_DOWNLINK_FIFO_DEPTH      (3)
+#endif
+#if( LR1MAC_DOWNLINK_FIFO_DEPTH < 2 )
+#error "LR1MAC_DOWNLINK_FIFO_DEPTH must keep a free entry besides the last downlink read"
+#endif
+#define LR1MAC_DOWNLINK_MAX_SIZE        (255 - FHDROFFSET - MICSIZE)
+
+// Multicast groups a downlink can be addressed to besides the unicast DevAddr, one per valid_dev_addr_t group
+#define LR1MAC_MULTICAST_GROUP_NB       (4)
+
+// Room for the answers to the nwk commands of one downlink, and separately for the sticky ones. Both are sent
+// together, in the fopts or on port 0 from the payload area of tx_payload
+#ifndef LR1MAC_NWK_ANS_MAX_SIZE
+#define LR1MAC_NWK_ANS_MAX_SIZE         (64)
+#endif
+#if( ( 2 * LR1MAC_NWK_ANS_MAX_SIZE ) > LR1MAC_TX_PAYLOAD_MAX_SIZE )
+#error "LR1MAC_NWK_ANS_MAX_SIZE answers don't fit in the payload area of tx_payload"
+#endif
+
+// Join retries back-off: JOIN_BACKOFF_BASE_S doubled at each retry up to JOIN_BACKOFF_MAX_EXPONENT times, half of it
+// drawn at random so that the devices powered up together spread their joins
+#define JOIN_BACKOFF_BASE_S             (16)
+#define JOIN_BACKOFF_MAX_EXPONENT       (7)
+
 // Frame direction definition for up/down link communications
 #define UP_LINK     0
 #define DOWN_LINK   1
@@ -122,6 +268,7 @@ typedef enum lr1mac_radio_state_e
     RADIOSTATE_TXON,
     RADIOSTATE_TXFINISHED,
     RADIOSTATE_RX1FINISHED,
+    RADIOSTATE_CADON,  // listen before talk CAD, the Tx is enqueued at its end
 } lr1mac_radio_state_t;
 
 /********************************************************************************/
@@ -162,6 +309,10 @@ enum
     RXTIMING_SETUP_REQ,
     TXPARAM_SETUP_REQ,
     DL_CHANNEL_REQ,
+    DEVICE_TIME_REQ = 0x0D,
+    PING_SLOT_INFO_REQ = 0x10,
+    PING_SLOT_CHANNEL_REQ,
+    BEACON_FREQ_REQ = 0x13,
     NB_MAC_CMD_REQ
 };
 
@@ -176,17 +327,13 @@ enum
     RXTIMING_SETUP_ANS,
     TXPARAM_SETUP_ANS,
     DL_CHANNEL_ANS,
+    DEVICE_TIME_ANS = 0x0D,
+    PING_SLOT_INFO_ANS = 0x10,
+    PING_SLOT_CHANNEL_ANS,
+    BEACON_FREQ_ANS = 0x13,
     NB_MAC_CMD_ANS
 };
 
-static const uint8_t lr1mac_cmd_mac_ans_size[NB_MAC_CMD_ANS] = {
-    [LINK_CHECK_ANS] = LINK_CHECK_ANS_SIZE,         [LINK_ADR_ANS] = LINK_ADR_ANS_SIZE,
-    [DUTY_CYCLE_ANS] = DUTY_CYCLE_ANS_SIZE,         [RXPARRAM_SETUP_ANS] = RXPARRAM_SETUP_ANS_SIZE,
-    [DEV_STATUS_ANS] = DEV_STATUS_ANS_SIZE,         [NEW_CHANNEL_ANS] = NEW_CHANNEL_ANS_SIZE,
-    [RXTIMING_SETUP_ANS] = RXTIMING_SETUP_ANS_SIZE, [TXPARAM_SETUP_ANS] = TXPARAM_SETUP_ANS_SIZE,
-    [DL_CHANNEL_ANS] = DL_CHANNEL_ANS_SIZE,
-};
-
 typedef enum lr1mac_bandwidth_e
 {
     BW125  = RAL_LORA_BW_125_KHZ,
@@ -216,10 +363,28 @@ typedef enum dr_strategy_e
     MOBILE_LONGRANGE_DR_DISTRIBUTION,
     MOBILE_LOWPER_DR_DISTRIBUTION,
     USER_DR_DISTRIBUTION,
+    LINK_MARGIN_ADR_MODE,  // datarate and power chosen by the device from the downlink link margins
     UNKNOWN_DR,
     JOIN_DR_DISTRIBUTION,
 } dr_strategy_t;
 
+// Connectivity seen by the link check monitor
+typedef enum lr1mac_link_state_e
+{
+    LR1MAC_LINK_STATE_UNKNOWN,  // monitor disabled or no answer since the join
+    LR1MAC_LINK_STATE_GOOD,
+    LR1MAC_LINK_STATE_WEAK,  // low margin or a request unanswered, the datarate is lowered
+    LR1MAC_LINK_STATE_LOST,  // LR1MAC_LINK_CHECK_LOST_MISSES requests in a row unanswered
+} lr1mac_link_state_t;
+
+// Beacon tracking of the class B
+typedef enum lr1mac_class_b_state_e
+{
+    LR1MAC_CLASS_B_STATE_OFF,
+    LR1MAC_CLASS_B_STATE_ACQUISITION,  // searching the beacon on the network time, no ping slot
+    LR1MAC_CLASS_B_STATE_TRACKING,     // beacon locked, the ping slots are opened once PingSlotInfoAns is received
+} lr1mac_class_b_state_t;
+
 typedef enum status_lorawan_e
 {
     ERRORLORAWAN = -1,
@@ -299,6 +464,8 @@ typedef enum valid_dev_addr_e
     VALID_DEV_ADDR_UNICAST,
     VALID_DEV_ADDR_MULTI_CAST_G0,
     VALID_DEV_ADDR_MULTI_CAST_G1,
+    VALID_DEV_ADDR_MULTI_CAST_G2,
+    VALID_DEV_ADDR_MULTI_CAST_G3,
     UNVALID_DEV_ADDR,
 } valid_dev_addr_t;
 
@@ -343,11 +510,53 @@ typedef struct mac_context_s
     uint32_t crc;  // !! crc MUST be the last field of the structure !!
 } mac_context_t;
 
+// Stored in the nvm journal, which checks the records crc
+typedef struct join_context_s
+{
+    uint32_t retry_join_cpt;
+    uint32_t is_join_pending;
+} join_context_t;
+
+typedef struct mac_fcnt_context_s
+{
+    uint32_t dev_addr;  // session of the counters
+    uint32_t fcnt_up;
+    uint32_t fcnt_dwn;
+    uint32_t fcnt_save_period;  // gap to skip at the restore, the period may change after the save
+} mac_fcnt_context_t;
+
+typedef struct mac_multicast_context_s
+{
+    uint32_t mc_addr[LR1MAC_MULTICAST_GROUP_NB];    // session of the counter, with the key check
+    uint32_t key_check[LR1MAC_MULTICAST_GROUP_NB];  // see lr1_stack_mac_multicast_t
+    uint32_t fcnt_dwn[LR1MAC_MULTICAST_GROUP_NB];
+} mac_multicast_context_t;
+
+typedef struct mac_session_s
+{
+    uint32_t dev_addr;
+    uint8_t  nwk_skey[16];
+    uint8_t  app_skey[16];
+    uint32_t fcnt_up;
+    uint32_t fcnt_dwn;
+    uint32_t rx2_frequency;
+    uint8_t  rx2_data_rate;
+    uint8_t  rx1_dr_offset;
+    uint8_t  rx1_delay_s;
+    uint8_t  tx_data_rate_adr;
+    int8_t   tx_power;
+    uint8_t  max_eirp_dbm;
+    uint8_t  nb_trans;
+    uint8_t  region_type;
+    uint8_t  otaa_device;  // an ABP session is only resumed with the same DevAddr and keys
+} mac_session_t;
+
 typedef enum receive_win_s
 {
     RECEIVE_NONE,
     RECEIVE_ON_RX1,
     RECEIVE_ON_RX2,
+    RECEIVE_ON_RXC,
 } receive_win_t;
 
 typedef enum cf_list_type
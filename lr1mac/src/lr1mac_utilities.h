@@ -73,7 +73,8 @@ extern "C" {
 /*!
  * \brief Copy size elements of src array to dst array
  *
- * \remark STM32 Standard memcpy function only works on pointers that are aligned
+ * \remark STM32 Standard memcpy function only works on pointers that are aligned. Copies word by word when dst and
+ *         src have the same alignment
  *
  * \param [OUT] dst   Destination array
  * \param [IN]  src   Source array
@@ -84,7 +85,8 @@ void memcpy1( uint8_t* dst, const uint8_t* src, uint16_t size );
 /*!
  * \brief Set size elements of dst array with value
  *
- * \remark STM32 Standard memset function only works on pointers that are aligned
+ * \remark STM32 Standard memset function only works on pointers that are aligned. Sets word by word past the first
+ *         word boundary
  *
  * \param [OUT] dst   Destination array
  * \param [IN]  value Default value
@@ -92,18 +94,113 @@ void memcpy1( uint8_t* dst, const uint8_t* src, uint16_t size );
  */
 void memset1( uint8_t* dst, uint8_t value, uint16_t size );
 
+/*!
+ * \brief XOR size elements of src1 and src2 arrays into dst array
+ *
+ * \remark Works word by word when the three arrays have the same alignment. dst may be src1 or src2
+ *
+ * \param [OUT] dst   Destination array
+ * \param [IN]  src1  1st source array
+ * \param [IN]  src2  2nd source array
+ * \param [IN]  size  Number of bytes to be XORed
+ */
+void memxor1( uint8_t* dst, const uint8_t* src1, const uint8_t* src2, uint16_t size );
+
+/*!
+ * \brief Reflected CRC-32 (polynomial 0xEDB88320), shared by the lr1mac and the modem contexts
+ *
+ * \remark Computed by the MCU CRC peripheral when SMTC_HW_CRC is defined, by a slice-by-4 table otherwise
+ *
+ * \param [IN] seed  Initial value of the CRC register
+ * \param [IN] buf   Data to go through the CRC
+ * \param [IN] len   Number of bytes in buf
+ *
+ * \retval CRC register after the last byte, without final xor
+ */
+uint32_t lr1mac_utilities_crc32( uint32_t seed, const uint8_t* buf, uint32_t len );
+
 /*!
  * \brief Crc32 implementation for flash corruption
  *
  */
 uint32_t lr1mac_utilities_crc( uint8_t* buf, int len );
 
+/*!
+ * \brief CRC-16 CCITT (polynomial 0x1021, initial value 0) of the class B beacon fields
+ *
+ * \param [IN] buf  Data to go through the CRC
+ * \param [IN] len  Number of bytes in buf
+ *
+ * \retval CRC, sent little endian after the fields it covers
+ */
+uint16_t lr1mac_utilities_crc16( const uint8_t* buf, uint8_t len );
+
 /*!
  * \brief Compute symbol time in µs
  *
  */
 uint32_t lr1mac_utilities_get_symb_time_us( const uint16_t nb_symb, const ral_lora_sf_t sf, const ral_lora_bw_t bw );
 
+/*!
+ * \brief Number of whole LoRa symbols in a duration, the inverse of \ref lr1mac_utilities_get_symb_time_us
+ *
+ */
+uint32_t lr1mac_utilities_get_symb_nb( const uint32_t duration_us, const ral_lora_sf_t sf, const ral_lora_bw_t bw );
+
+/*!
+ * \brief Compute the time on air in ms of a LoRaWAN frame (explicit header, CRC on) sent by the SX1280
+ *
+ * \remark Same result as the radio driver, without going through the ral: the radio may be used by another hook.
+ *
+ * \param [IN] pld_len_in_bytes  Frame length
+ * \param [IN] sf                Spreading factor
+ * \param [IN] bw                Bandwidth, SX1280 bandwidths only
+ * \param [IN] cr                Coding rate
+ * \param [IN] pbl_len_in_symb   Preamble length in symbols
+ * \retval Time on air in ms, 0 if the modulation parameters are not supported
+ */
+uint32_t lr1mac_utilities_get_lora_toa_ms( const uint8_t pld_len_in_bytes, const ral_lora_sf_t sf,
+                                           const ral_lora_bw_t bw, const ral_lora_cr_t cr,
+                                           const uint16_t pbl_len_in_symb );
+
+/*!
+ * \brief Same as \ref lr1mac_utilities_get_lora_toa_ms in us, to compare with the radio IRQ us timestamps
+ *
+ * \param [IN] pld_len_in_bytes  Frame length
+ * \param [IN] sf                Spreading factor
+ * \param [IN] bw                Bandwidth, SX1280 bandwidths only
+ * \param [IN] cr                Coding rate
+ * \param [IN] pbl_len_in_symb   Preamble length in symbols
+ * \retval Time on air in us, 0 if the modulation parameters are not supported
+ */
+uint32_t lr1mac_utilities_get_lora_toa_us( const uint8_t pld_len_in_bytes, const ral_lora_sf_t sf,
+                                           const ral_lora_bw_t bw, const ral_lora_cr_t cr,
+                                           const uint16_t pbl_len_in_symb );
+
+/*!
+ * \brief Number of 32-bit words of a channel bitmask holding nb_channel channels, 3 words for the 72 channels regions
+ */
+#define LR1MAC_UTILITIES_CHANNEL_MASK_WORDS( nb_channel ) ( ( ( nb_channel ) + 31 ) / 32 )
+
+/*!
+ * \brief Count the channels set in a channel bitmask, bit i of word i / 32 standing for channel i
+ *
+ * \param [IN] mask      Channel bitmask
+ * \param [IN] nb_words  Number of words of the bitmask
+ * \retval Number of set bits
+ */
+uint8_t lr1mac_utilities_channel_mask_count( const uint32_t* mask, const uint8_t nb_words );
+
+/*!
+ * \brief Get the index of the rank-th channel set in a channel bitmask
+ *
+ * \param [IN] mask      Channel bitmask
+ * \param [IN] nb_words  Number of words of the bitmask
+ * \param [IN] rank      Rank of the channel among the set bits, from 0
+ * \retval Channel index, 0xFF if the bitmask holds rank or less channels
+ */
+uint8_t lr1mac_utilities_channel_mask_select( const uint32_t* mask, const uint8_t nb_words, uint8_t rank );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,1117 @@
+/*!
+ * \file      region_eu_868.c
+ *
+ * \brief     region_eu_868 abstraction layer implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>  // memcpy
+#include "region_eu_868.h"
+#include "smtc_real.h"
+#include "lr1_stack_mac_layer.h"
+#include "lr1mac_utilities.h"
+#include "smtc_bsp.h"
+#include "ral_defs.h"
+
+static uint32_t tx_frequency_channel[NUMBER_OF_CHANNEL_EU_868];
+static uint32_t rx1_frequency_channel[NUMBER_OF_CHANNEL_EU_868];
+static uint8_t  min_dr_channel[NUMBER_OF_CHANNEL_EU_868];
+static uint8_t  max_dr_channel[NUMBER_OF_CHANNEL_EU_868];
+static uint8_t  channel_index_enabled[NUMBER_OF_CHANNEL_EU_868];  // Contain the index of the activated channel only
+static uint8_t  dr_distribution_init[8] = { 0 };
+static uint8_t  dr_distribution[8]      = { 0 };
+static uint32_t unwrapped_channel_mask  = 0xFFFF;
+static uint8_t  gfsk_sync_word[3]       = { 0xC1, 0x94, 0xC1 };
+
+#define CHANNEL_MASK_WORDS_EU_868 LR1MAC_UTILITIES_CHANNEL_MASK_WORDS( NUMBER_OF_CHANNEL_EU_868 )
+
+// Channels eligible at each datarate, rebuilt at the next channel selection once the channel plan changed
+static uint32_t dr_channel_mask[MAX_DR_EU_868 + 1][CHANNEL_MASK_WORDS_EU_868];
+static bool     is_dr_channel_mask_valid = false;
+
+/*
+ * Sub-bands of ETSI EN 300 220, each one with its own duty cycle. The channels of a band are kept as a mask, with the
+ * dr masks, so that the channel selection only ands the masks of the free bands instead of scanning the channels.
+ */
+typedef struct duty_cycle_band_eu_868_s
+{
+    uint32_t freq_min;  // Hz, included
+    uint32_t freq_max;  // Hz, excluded
+    uint16_t divisor;   // inverse of the duty cycle
+} duty_cycle_band_eu_868_t;
+
+static const duty_cycle_band_eu_868_t duty_cycle_band[NUMBER_OF_DUTY_CYCLE_BAND_EU_868] = {
+    { 863000000, 865000000, 1000 }, { 865000000, 868000000, 100 }, { 868000000, 868600000, 100 },
+    { 868700000, 869200000, 1000 }, { 869400000, 869650000, 10 },  { 869700000, 870000000, 100 },
+};
+
+static uint32_t band_channel_mask[NUMBER_OF_DUTY_CYCLE_BAND_EU_868][CHANNEL_MASK_WORDS_EU_868];
+static uint32_t band_free_channel_mask[CHANNEL_MASK_WORDS_EU_868];  // channels of the bands free to transmit
+static uint8_t  band_busy             = 0;  // one bit per band without room for its next uplink
+static bool     is_duty_cycle_enabled = true;
+
+/*
+ * The duty cycle of a band is the time on air over the last hour. The hour is split in slots, the uplinks are summed
+ * in the slot they end in and a slot leaves the window one hour after its end, so that the window overestimates the
+ * time on air by one slot at most. An uplink adds to the current slot and each slot change drops the oldest one: the
+ * updates do not depend on the number of uplinks, and the time a band gets room again is read from the slots.
+ */
+#define DUTY_CYCLE_SLOT_NB_EU_868 ( 12 )
+#define DUTY_CYCLE_SLOT_MS_EU_868 ( SMTC_REAL_DUTY_CYCLE_THRESHOLD_MS_BY_HOUR / DUTY_CYCLE_SLOT_NB_EU_868 )
+
+static uint32_t band_slot_toa_ms[NUMBER_OF_DUTY_CYCLE_BAND_EU_868][DUTY_CYCLE_SLOT_NB_EU_868 + 1];
+static uint32_t band_window_toa_ms[NUMBER_OF_DUTY_CYCLE_BAND_EU_868];  // sum of the slots of the band
+static uint32_t band_last_toa_ms[NUMBER_OF_DUTY_CYCLE_BAND_EU_868];    // expected time on air of the next uplink
+static uint8_t  slot_current          = 0;
+static uint32_t slot_current_start_ms = 0;
+
+// Saved in the nvm journal at each uplink, the window of each band in seconds
+typedef struct duty_cycle_context_eu_868_s
+{
+    uint16_t window_toa_s[NUMBER_OF_DUTY_CYCLE_BAND_EU_868];
+} duty_cycle_context_eu_868_t;
+
+static mac_context_t mac_context;
+
+// Private region_eu_868 utilities declaration
+//
+/*!
+ *
+ */
+static void     tx_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr );
+static void     rx1_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr );
+static void     rx2_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr );
+static void     dr_channel_mask_update( void );
+static void     band_free_channel_mask_update( void );
+static uint8_t  duty_cycle_band_get( uint32_t freq_hz );
+static uint32_t duty_cycle_band_budget_ms_get( uint8_t band );
+static void     duty_cycle_window_slide( void );
+static int32_t  duty_cycle_band_free_ms_get( uint8_t band );
+static void     duty_cycle_save( void );
+static void     duty_cycle_restore( void );
+
+/*!
+ *
+ */
+
+void region_eu_868_init( lr1_stack_mac_t* lr1_mac )
+{
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_EU_868; i++ )
+    {
+        tx_frequency_channel[i]  = 0;
+        rx1_frequency_channel[i] = 0;
+        channel_index_enabled[i] = CHANNEL_DISABLED;
+        min_dr_channel[i]        = 0;
+        max_dr_channel[i]        = 5;
+    }
+    // enable the 3 defaults channels
+    channel_index_enabled[0] = CHANNEL_ENABLED;
+    channel_index_enabled[1] = CHANNEL_ENABLED;
+    channel_index_enabled[2] = CHANNEL_ENABLED;
+    is_dr_channel_mask_valid = false;
+
+    tx_frequency_channel[0]  = 868100000;
+    tx_frequency_channel[1]  = 868300000;
+    tx_frequency_channel[2]  = 868500000;
+    rx1_frequency_channel[0] = 868100000;
+    rx1_frequency_channel[1] = 868300000;
+    rx1_frequency_channel[2] = 868500000;
+
+    lr1_mac->rx2_frequency    = RX2_FREQ_EU_868;
+    lr1_mac->tx_power         = TX_POWER_EU_868;
+    lr1_mac->rx1_dr_offset    = 0;
+    lr1_mac->rx2_data_rate    = RX2DR_INIT_EU_868;
+    lr1_mac->rx1_delay_s      = RECEIVE_DELAY1_EU_868;
+    lr1_mac->tx_data_rate_adr = 0;
+    lr1_mac->adr_custom       = BSP_USER_DR_DISTRIBUTION_PARAMETERS;
+    memset( dr_distribution_init, 1, 8 );
+}
+
+status_lorawan_t region_eu_868_is_valid_rx1_dr_offset( uint8_t rx1_dr_offset )
+{
+    status_lorawan_t status = OKLORAWAN;
+    if( rx1_dr_offset > 5 )
+    {
+        status = ERRORLORAWAN;
+        BSP_DBG_TRACE_MSG( "RECEIVE AN INVALID RX1 DR OFFSET \n" );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_eu_868_is_valid_dr( uint8_t dr )
+{
+    status_lorawan_t status;
+    status = ( dr > MAX_DR_EU_868 ) ? ERRORLORAWAN : OKLORAWAN;
+    if( status == ERRORLORAWAN )
+    {
+        BSP_DBG_TRACE_WARNING( " Invalid data rate\n" );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_eu_868_is_acceptable_dr( uint8_t dr )
+{
+    status_lorawan_t status = ERRORLORAWAN;
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_EU_868; i++ )
+    {
+        if( ( ( unwrapped_channel_mask >> i ) & 0x1 ) == 1 )
+        {
+            if( ( dr >= min_dr_channel[i] ) && ( dr <= max_dr_channel[i] ) )
+            {
+                return ( OKLORAWAN );
+            }
+        }
+    }
+    BSP_DBG_TRACE_WARNING( " Not acceptable data rate\n" );
+    return ( status );
+}
+
+status_lorawan_t region_eu_868_is_valid_tx_frequency( uint32_t frequency )
+{
+    status_lorawan_t status = OKLORAWAN;
+    if( frequency == 0 )
+    {
+        return ( status );
+    }
+    if( ( frequency > FREQMAX_EU_868 ) || ( frequency < FREQMIN_EU_868 ) )
+    {
+        status = ERRORLORAWAN;
+        BSP_DBG_TRACE_WARNING( "RECEIVE AN INVALID FREQUENCY = %lu\n", frequency );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_eu_868_is_valid_rx_frequency( uint32_t frequency )
+{
+    status_lorawan_t status = OKLORAWAN;
+    if( ( frequency > FREQMAX_EU_868 ) || ( frequency < FREQMIN_EU_868 ) )
+    {
+        status = ERRORLORAWAN;
+        BSP_DBG_TRACE_WARNING( "RECEIVE AN INVALID Rx FREQUENCY = %lu\n", frequency );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_eu_868_is_valid_tx_power( uint8_t power )
+{
+    status_lorawan_t status = OKLORAWAN;
+    if( ( power > 7 ) )
+    {
+        status = ERRORLORAWAN;
+        BSP_DBG_TRACE_WARNING( "RECEIVE AN INVALID Power Cmd = %d\n", power );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_eu_868_is_valid_channel_index( uint8_t channel_index )
+{
+    status_lorawan_t status = OKLORAWAN;
+    if( ( channel_index < 3 ) || ( channel_index > 15 ) )
+    {
+        status = ERRORLORAWAN;
+        BSP_DBG_TRACE_WARNING( "RECEIVE AN INVALID Channel Index Cmd = %d\n", channel_index );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_eu_868_is_valid_size( lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t size )
+{
+    status_lorawan_t status;
+    uint8_t          N[8] = { 51, 51, 51, 115, 222, 222, 222, 222 };
+    status                = ( ( size + lr1_mac->tx_fopts_current_length ) > N[dr] ) ? ERRORLORAWAN : OKLORAWAN;
+    if( status == ERRORLORAWAN )
+    {
+        BSP_DBG_TRACE_WARNING( " Invalid size \n" );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_eu_868_memory_load( lr1_stack_mac_t* lr1_mac )
+{
+    duty_cycle_restore( );
+    bsp_nvm_context_restore( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &( mac_context ),
+                             sizeof( mac_context ) );
+
+    if( lr1mac_utilities_crc( ( uint8_t* ) &mac_context, sizeof( mac_context ) - 4 ) == mac_context.crc )
+    {
+        memcpy( lr1_mac->app_eui, mac_context.appeui, 8 );
+        memcpy( lr1_mac->dev_eui, mac_context.deveui, 8 );
+        memcpy( lr1_mac->app_key, mac_context.appkey, 16 );
+        lr1_mac->dev_nonce   = mac_context.devnonce;
+        lr1_mac->adr_custom  = mac_context.adr_custom;
+        lr1_mac->nb_of_reset = mac_context.nb_reset + 1;  // @todo move increment in mcu_reset api and remove all nvic
+        lr1_mac->real->region_type = ( smtc_real_region_types_t ) mac_context.region_type;
+        lr1_mac->dev_nonce_reserved = mac_context.devnonce;
+        region_eu_868_memory_save( lr1_mac );  // to save new number of reset
+        BSP_DBG_TRACE_PRINTF( " DevNonce = 0x%x ", lr1_mac->dev_nonce );
+        BSP_DBG_TRACE_PRINTF( ", NbOfReset = %d \n", lr1_mac->nb_of_reset );
+        BSP_DBG_TRACE_PRINTF( " Region = %d\n", lr1_mac->real->region_type );
+        return OKLORAWAN;
+    }
+    else  // start with "in rescue eeprom mode"
+    {
+        bsp_nvm_context_restore( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ) + sizeof( mac_context ) + 4,
+                                 ( uint8_t* ) &( mac_context ), sizeof( mac_context ) );
+
+        if( lr1mac_utilities_crc( ( uint8_t* ) &mac_context, sizeof( mac_context ) - 4 ) == mac_context.crc )
+        {
+            memcpy( lr1_mac->app_eui, mac_context.appeui, 8 );
+            memcpy( lr1_mac->dev_eui, mac_context.deveui, 8 );
+            memcpy( lr1_mac->app_key, mac_context.appkey, 16 );
+            lr1_mac->dev_nonce   = mac_context.devnonce;
+            lr1_mac->adr_custom  = mac_context.adr_custom;
+            lr1_mac->nb_of_reset = mac_context.nb_reset;  // @todo move increment in mcu_reset api and remove all nvic
+            lr1_mac->real->region_type = ( smtc_real_region_types_t ) mac_context.region_type;
+            lr1_mac->dev_nonce_reserved = mac_context.devnonce;
+            region_eu_868_memory_save( lr1_mac );  // to save new number of reset
+            BSP_DBG_TRACE_PRINTF( "\n start on rescue eeprom , DevNonce = 0x%x ", lr1_mac->dev_nonce );
+            BSP_DBG_TRACE_PRINTF( "\n start on rescue eeprom , NbOfReset = %d ", lr1_mac->nb_of_reset );
+            BSP_DBG_TRACE_PRINTF( "\n start on rescue eeprom , Region = %d\n", lr1_mac->real->region_type );
+            return OKLORAWAN;
+        }
+        else
+        {  // == factory reset
+            return ERRORLORAWAN;
+        }
+    }
+}
+void region_eu_868_bad_crc_memory_set( lr1_stack_mac_t* lr1_mac )
+{
+    mac_context.devnonce    = lr1_mac->dev_nonce_reserved;
+    mac_context.adr_custom  = lr1_mac->adr_custom;
+    mac_context.nb_reset    = lr1_mac->nb_of_reset;
+    mac_context.region_type = lr1_mac->real->region_type;
+    memcpy( mac_context.appeui, lr1_mac->app_eui, 8 );
+    memcpy( mac_context.deveui, lr1_mac->dev_eui, 8 );
+    memcpy( mac_context.appkey, lr1_mac->app_key, 16 );
+    mac_context.crc = lr1mac_utilities_crc( ( uint8_t* ) &mac_context, sizeof( mac_context ) - 4 ) + 1;
+    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &( mac_context ),
+                           sizeof( mac_context ) );
+
+    bsp_mcu_wait_us( 10000 );
+
+    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ) + sizeof( mac_context ) + 4,
+                           ( uint8_t* ) &( mac_context ), sizeof( mac_context ) );
+    bsp_mcu_wait_us( 10000 );
+}
+void region_eu_868_memory_save( lr1_stack_mac_t* lr1_mac )
+{
+    mac_context.devnonce    = lr1_mac->dev_nonce_reserved;
+    mac_context.adr_custom  = lr1_mac->adr_custom;
+    mac_context.nb_reset    = lr1_mac->nb_of_reset;
+    mac_context.region_type = lr1_mac->real->region_type;
+    memcpy( mac_context.appeui, lr1_mac->app_eui, 8 );
+    memcpy( mac_context.deveui, lr1_mac->dev_eui, 8 );
+    memcpy( mac_context.appkey, lr1_mac->app_key, 16 );
+    mac_context.crc = lr1mac_utilities_crc( ( uint8_t* ) &mac_context, sizeof( mac_context ) - 4 );
+    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &( mac_context ),
+                           sizeof( mac_context ) );
+
+    bsp_mcu_wait_us( 10000 );
+
+    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ) + sizeof( mac_context ) + 4,
+                           ( uint8_t* ) &( mac_context ), sizeof( mac_context ) );
+    bsp_mcu_wait_us( 10000 );
+}
+
+void region_eu_868_dr_distribution_set( lr1_stack_mac_t* lr1_mac, uint8_t adr_mode )
+{
+    memset( dr_distribution_init, 0, 8 );
+    switch( adr_mode )
+    {
+    case MOBILE_LONGRANGE_DR_DISTRIBUTION:  // in this example 4/7 dr0 2/7 dr1 and 1/7 dr2
+        dr_distribution_init[2] = 1;
+        dr_distribution_init[1] = 2;
+        dr_distribution_init[0] = 4;
+        lr1_mac->nb_trans       = 1;
+        break;
+    case MOBILE_LOWPER_DR_DISTRIBUTION:  // in this example 5/10 dr5 4/10 dr4 and 1/10 dr0
+        dr_distribution_init[5] = 5;
+        dr_distribution_init[4] = 4;
+        dr_distribution_init[0] = 1;
+        lr1_mac->nb_trans       = 1;
+        break;
+    case JOIN_DR_DISTRIBUTION:  // in this example 1/3 dr5 1/3 dr4 and 1/3 dr0
+        dr_distribution_init[5] = 1;
+        dr_distribution_init[4] = 1;
+        dr_distribution_init[0] = 1;
+        lr1_mac->nb_trans       = 1;
+        break;
+    case USER_DR_DISTRIBUTION:
+        dr_distribution_init[7] = ( ( lr1_mac->adr_custom ) & ( 0x0000000F ) );
+        dr_distribution_init[6] = ( ( lr1_mac->adr_custom ) & ( 0x000000F0 ) ) >> 4;
+        dr_distribution_init[5] = ( ( lr1_mac->adr_custom ) & ( 0x00000F00 ) ) >> 8;
+        dr_distribution_init[4] = ( ( lr1_mac->adr_custom ) & ( 0x0000F000 ) ) >> 12;
+        dr_distribution_init[3] = ( ( lr1_mac->adr_custom ) & ( 0x000F0000 ) ) >> 16;
+        dr_distribution_init[2] = ( ( lr1_mac->adr_custom ) & ( 0x00F00000 ) ) >> 20;
+        dr_distribution_init[1] = ( ( lr1_mac->adr_custom ) & ( 0x0F000000 ) ) >> 24;
+        dr_distribution_init[0] = ( ( lr1_mac->adr_custom ) & ( 0xF0000000 ) ) >> 28;
+        lr1_mac->nb_trans       = BSP_USER_NUMBER_OF_RETRANSMISSION;
+        break;
+    default:
+        dr_distribution_init[0] = 1;
+        lr1_mac->nb_trans       = 1;
+        break;
+    }
+    memcpy( dr_distribution, dr_distribution_init, 8 );
+}
+status_lorawan_t region_eu_868_join_next_channel_get( lr1_stack_mac_t* lr1_mac )
+{
+    return region_eu_868_next_channel_get( lr1_mac );
+}
+
+status_lorawan_t region_eu_868_next_channel_get( lr1_stack_mac_t* lr1_mac )
+{
+    if( lr1_mac->tx_data_rate_adr > MAX_DR_EU_868 )
+    {
+        BSP_DBG_TRACE_WARNING( "NO CHANNELS AVAILABLE \n" );
+        return ERRORLORAWAN;
+    }
+    if( is_dr_channel_mask_valid == false )
+    {
+        dr_channel_mask_update( );
+    }
+    // the channels of the datarate in the bands with room for an uplink in their duty cycle
+    uint32_t channel_mask[CHANNEL_MASK_WORDS_EU_868];
+    for( uint8_t i = 0; i < CHANNEL_MASK_WORDS_EU_868; i++ )
+    {
+        channel_mask[i] = dr_channel_mask[lr1_mac->tx_data_rate_adr][i] & band_free_channel_mask[i];
+    }
+    uint8_t active_channel_nb = lr1mac_utilities_channel_mask_count( channel_mask, CHANNEL_MASK_WORDS_EU_868 );
+    if( active_channel_nb == 0 )
+    {
+        BSP_DBG_TRACE_WARNING( "NO CHANNELS AVAILABLE \n" );
+        return ERRORLORAWAN;
+    }
+    uint8_t temp        = ( bsp_rng_get_random_in_range( 0, ( active_channel_nb - 1 ) ) ) % active_channel_nb;
+    uint8_t channel_idx = lr1mac_utilities_channel_mask_select( channel_mask, CHANNEL_MASK_WORDS_EU_868, temp );
+    if( channel_idx >= NUMBER_OF_CHANNEL_EU_868 )
+    {
+        BSP_DBG_TRACE_PRINTF( "INVALID CHANNEL  active channel = %d and random channel = %d \n", active_channel_nb,
+                              temp );
+        return ERRORLORAWAN;
+    }
+    else
+    {
+        lr1_mac->tx_frequency  = tx_frequency_channel[channel_idx];
+        lr1_mac->rx1_frequency = rx1_frequency_channel[channel_idx];
+    }
+    return OKLORAWAN;
+}
+
+void region_eu_868_next_dr_get( lr1_stack_mac_t* lr1_mac )
+{
+    if( lr1_mac->adr_mode_select == STATIC_ADR_MODE )
+    {
+        lr1_mac->tx_data_rate = lr1_mac->tx_data_rate_adr;
+        lr1_mac->adr_enable   = 1;
+    }
+    else if( lr1_mac->adr_mode_select == LINK_MARGIN_ADR_MODE )
+    {
+        lr1_stack_mac_link_margin_adr( lr1_mac );
+        lr1_mac->tx_data_rate = lr1_mac->tx_data_rate_adr;
+        lr1_mac->adr_enable   = 0;
+    }
+    else
+    {
+        // an empty profile keeps the current datarate
+        smtc_real_dr_distribution_draw( dr_distribution, dr_distribution_init, MAX_DR_EU_868 + 1,
+                                        &lr1_mac->tx_data_rate );
+        lr1_mac->adr_enable = 0;
+    }
+    lr1_mac->tx_data_rate = ( lr1_mac->tx_data_rate > MAX_DR_EU_868 ) ? MAX_DR_EU_868 : lr1_mac->tx_data_rate;
+    tx_dr_to_sf_bw( lr1_mac, lr1_mac->tx_data_rate );
+}
+
+void region_eu_868_fastest_dr_get( lr1_stack_mac_t* lr1_mac, uint8_t dr_max )
+{
+    if( ( lr1_mac->adr_mode_select == STATIC_ADR_MODE ) || ( lr1_mac->adr_mode_select == LINK_MARGIN_ADR_MODE ) )
+    {
+        return;
+    }
+    for( int8_t dr = MIN( MAX_DR_EU_868, dr_max ); dr >= 0; dr-- )
+    {
+        if( dr_distribution_init[dr] > 0 )
+        {
+            lr1_mac->tx_data_rate = MIN( ( uint8_t ) dr, region_eu_868_max_dr_channel_get( ) );
+            break;
+        }
+    }
+    tx_dr_to_sf_bw( lr1_mac, lr1_mac->tx_data_rate );
+}
+
+uint8_t region_eu_868_max_payload_size_get( uint8_t dr )
+{
+    uint8_t M[8] = { 59, 59, 59, 123, 230, 230, 230, 230 };
+    return ( M[dr] );
+}
+
+uint32_t region_eu_868_decode_freq_from_buf( uint8_t freq_buf[3] )
+{
+    uint32_t freq = ( freq_buf[0] ) + ( freq_buf[1] << 8 ) + ( freq_buf[2] << 16 );
+    freq *= FREQUENCY_FACTOR_EU_868;
+    return freq;
+}
+
+void region_eu_868_cflist_get( lr1_stack_mac_t* lr1_mac )
+{
+    if( lr1_mac->cf_list[15] == CF_LIST_FREQ )
+    {
+        for( uint8_t i = 0; i < 5; i++ )
+        {
+            tx_frequency_channel[3 + i]  = region_eu_868_decode_freq_from_buf( &lr1_mac->cf_list[0 + ( 3 * i )] );
+            rx1_frequency_channel[3 + i] = tx_frequency_channel[3 + i];
+
+            if( region_eu_868_is_valid_tx_frequency( tx_frequency_channel[3 + i] ) == OKLORAWAN &&
+                tx_frequency_channel[3 + i] != 0 )
+            {
+                min_dr_channel[3 + i]        = 0;
+                max_dr_channel[3 + i]        = 5;
+                channel_index_enabled[3 + i] = CHANNEL_ENABLED;
+                BSP_DBG_TRACE_PRINTF( " MacTxFrequency [%d] = %lu \n", i, tx_frequency_channel[3 + i] );
+                BSP_DBG_TRACE_PRINTF( " MacMinDataRateChannel [%d] = %u \n", i, min_dr_channel[3 + i] );
+                BSP_DBG_TRACE_PRINTF( " MacMaxDataRateChannel [%d] = %u \n", i, max_dr_channel[3 + i] );
+                BSP_DBG_TRACE_PRINTF( " MacChannelIndexEnabled [%d] = %u \n", i, channel_index_enabled[3 + i] );
+            }
+            else
+            {
+                tx_frequency_channel[3 + i]  = 0;
+                rx1_frequency_channel[3 + i] = 0;
+                channel_index_enabled[3 + i] = CHANNEL_DISABLED;
+
+                BSP_DBG_TRACE_WARNING( "INVALID TX FREQUENCY IN CFLIST OR CFLIST EMPTY \n" );
+            }
+        }
+        is_dr_channel_mask_valid = false;
+    }
+    else
+    {
+        BSP_DBG_TRACE_WARNING( "INVALID CFLIST, MUST CONTAINS FREQ \n" );
+    }
+}
+
+void region_eu_868_rx_config_set( lr1_stack_mac_t* lr1_mac, rx_win_type_t type )
+{
+    if( type == RX1 )
+    {
+        rx1_dr_to_sf_bw( lr1_mac, ( lr1_mac->tx_data_rate > lr1_mac->rx1_dr_offset )
+                                      ? lr1_mac->tx_data_rate - lr1_mac->rx1_dr_offset
+                                      : 0 );
+    }
+    else if( type == RX2 )
+    {
+        rx2_dr_to_sf_bw( lr1_mac, lr1_mac->rx2_data_rate );
+    }
+    else
+    {
+        BSP_DBG_TRACE_WARNING( "INVALID RX TYPE \n" );
+    }
+}
+void region_eu_868_power_set( lr1_stack_mac_t* lr1_mac, uint8_t power_cmd )
+{
+    if( power_cmd > 7 )
+    {
+        lr1_mac->tx_power = lr1_mac->max_eirp_dbm;  // Set by TxParamSetupReq
+        BSP_DBG_TRACE_WARNING( "INVALID TX_POWER_EU_868 \n" );
+    }
+    else
+    {
+        lr1_mac->tx_power = lr1_mac->max_eirp_dbm - ( 2 * power_cmd );
+    }
+}
+void region_eu_868_channel_mask_set( lr1_stack_mac_t* lr1_mac )
+{
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_EU_868; i++ )
+    {
+        channel_index_enabled[i] = ( unwrapped_channel_mask >> i ) & 0x1;
+        BSP_DBG_TRACE_PRINTF( " %d ", channel_index_enabled[i] );
+    }
+    is_dr_channel_mask_valid = false;
+    BSP_DBG_TRACE_MSG( " \n" );
+}
+void region_eu_868_channel_mask_init( void )
+{
+    unwrapped_channel_mask = 0xFFFF;
+}
+
+void region_eu_868_join_snapshot_channel_mask_init( void )
+{
+    // Not useful for EU_868
+    return;
+}
+
+status_channel_t region_eu_868_channel_mask_build( uint8_t channel_mask_cntl, uint16_t channel_mask )
+{
+    status_channel_t status = OKCHANNEL;
+    switch( channel_mask_cntl )
+    {
+    case 0:
+        unwrapped_channel_mask = 0xFFFF;
+        unwrapped_channel_mask = unwrapped_channel_mask & channel_mask;
+        BSP_DBG_TRACE_PRINTF( "UnwrappedChannelMask = 0x%lx, ChMask = 0x%x\n", unwrapped_channel_mask, channel_mask );
+        for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_EU_868; i++ )
+        {
+            if( ( ( ( unwrapped_channel_mask >> i ) & 0x1 ) == 1 ) && ( tx_frequency_channel[i] == 0 ) )
+            {
+                status = ERROR_CHANNEL_MASK;  // this status is used only for the last multiple link adr req
+            }
+        }
+        break;
+    case 6:
+        unwrapped_channel_mask = 0;
+        for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_EU_868; i++ )
+        {
+            if( tx_frequency_channel[i] > 0 )
+            {
+                unwrapped_channel_mask = unwrapped_channel_mask ^ ( 1 << i );
+            }
+        }
+        break;
+    default:
+        status = ERROR_CHANNEL_CNTL;
+        break;
+    }
+    if( unwrapped_channel_mask == 0 )
+    {
+        status = ERROR_CHANNEL_MASK;
+    }
+    return ( status );
+}
+
+void region_eu_868_dr_decrement( lr1_stack_mac_t* lr1_mac )
+{
+    uint8_t valid_temp = 0;
+    if( lr1_mac->tx_power < TX_POWER_EU_868 )
+    {
+        lr1_mac->tx_power = TX_POWER_EU_868;
+    }
+    while( ( lr1_mac->tx_data_rate_adr > 0 ) && ( valid_temp == 0 ) )
+    {
+        lr1_mac->tx_data_rate_adr--;
+        for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_EU_868; i++ )
+        {
+            if( channel_index_enabled[i] == CHANNEL_ENABLED )
+            {
+                if( ( lr1_mac->tx_data_rate_adr <= max_dr_channel[i] ) &&
+                    ( lr1_mac->tx_data_rate_adr >= min_dr_channel[i] ) )
+                {
+                    valid_temp++;
+                }
+            }
+        }
+    }
+    // if adr DR = 0 enable the default channel
+    if( valid_temp > 0 )
+    {
+        return;  // decrement at least one channel
+    }
+    // reach this step only if tx_dr = 0 and valid temp = 0 => enable default channel
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_EU_868; i++ )
+    {
+        if( tx_frequency_channel[i] != 0 && channel_index_enabled[i] == CHANNEL_DISABLED )
+        {
+            channel_index_enabled[i] = CHANNEL_ENABLED;
+            min_dr_channel[i]        = 0;
+            max_dr_channel[i]        = 5;
+        }
+    }
+    is_dr_channel_mask_valid = false;
+}
+uint8_t region_eu_868_adr_ack_delay_get( void )
+{
+    return ( ADR_ACK_DELAY_EU_868 );
+}
+uint8_t region_eu_868_adr_ack_limit_get( void )
+{
+    return ( ADR_ACK_LIMIT_EU_868 );
+}
+uint8_t region_eu_868_sync_word_get( void )
+{
+    return ( SYNC_WORD_EU_868 );
+}
+status_lorawan_t region_eu_868_class_b_params_get( uint8_t ping_dr, smtc_real_class_b_params_t* params )
+{
+    if( ping_dr == 0xFF )
+    {
+        ping_dr = BEACON_DR_EU_868;
+    }
+    if( ping_dr > 6 )
+    {
+        return ERRORLORAWAN;
+    }
+    params->beacon_freq_hz  = BEACON_FREQ_EU_868;
+    params->beacon_sf       = 12 - BEACON_DR_EU_868;
+    params->beacon_bw       = BW125;
+    params->beacon_rfu_size = 2;
+    params->beacon_size     = 17;
+    params->ping_freq_hz    = BEACON_FREQ_EU_868;
+    params->ping_sf         = ( ping_dr < 6 ) ? ( 12 - ping_dr ) : 7;
+    params->ping_bw         = ( ping_dr < 6 ) ? BW125 : BW250;
+    return OKLORAWAN;
+}
+uint8_t* region_eu_868_gfsk_sync_word_get( void )
+{
+    return ( gfsk_sync_word );
+}
+
+void region_eu_868_tx_frequency_channel_set( uint32_t tx_freq, uint8_t index )
+{
+    if( index >= NUMBER_OF_CHANNEL_EU_868 )
+    {
+        BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    else
+    {
+        tx_frequency_channel[index] = tx_freq;
+        is_dr_channel_mask_valid    = false;
+    }
+}
+
+void region_eu_868_rx1_frequency_channel_set( uint32_t rx_freq, uint8_t index )
+{
+    if( index >= NUMBER_OF_CHANNEL_EU_868 )
+    {
+        BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    else
+    {
+        rx1_frequency_channel[index] = rx_freq;
+    }
+}
+void region_eu_868_min_dr_channel_set( uint8_t dr, uint8_t index )
+{
+    if( index >= NUMBER_OF_CHANNEL_EU_868 )
+    {
+        BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    else
+    {
+        min_dr_channel[index]    = dr;
+        is_dr_channel_mask_valid = false;
+    }
+}
+void region_eu_868_max_dr_channel_set( uint8_t dr, uint8_t index )
+{
+    if( index >= NUMBER_OF_CHANNEL_EU_868 )
+    {
+        BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    else
+    {
+        max_dr_channel[index]    = dr;
+        is_dr_channel_mask_valid = false;
+    }
+}
+void region_eu_868_channel_enabled_set( uint8_t enable, uint8_t index )
+{
+    if( index >= NUMBER_OF_CHANNEL_EU_868 )
+    {
+        BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    else
+    {
+        channel_index_enabled[index] = enable;
+        is_dr_channel_mask_valid     = false;
+    }
+}
+
+uint32_t region_eu_868_tx_frequency_channel_get( uint8_t index )
+{
+    if( index >= NUMBER_OF_CHANNEL_EU_868 )
+    {
+        BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    return ( tx_frequency_channel[index] );
+}
+uint32_t region_eu_868_rx1_frequency_channel_get( uint8_t index )
+{
+    if( index >= NUMBER_OF_CHANNEL_EU_868 )
+    {
+        BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    return ( rx1_frequency_channel[index] );
+}
+uint8_t region_eu_868_min_dr_channel_get( void )
+{
+    uint8_t min = MAX_DR_EU_868;  // start with the max dr and search a dr inferior
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_EU_868; i++ )
+    {
+        if( ( min_dr_channel[i] < min ) && ( channel_index_enabled[i] == CHANNEL_ENABLED ) )
+        {
+            min = min_dr_channel[i];
+        }
+    }
+    return ( min );
+}
+uint8_t region_eu_868_max_dr_channel_get( void )
+{
+    uint8_t max = MIN_DR_EU_868;  // start with the min dr and search a dr superior
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_EU_868; i++ )
+    {
+        if( ( max_dr_channel[i] > max ) && ( channel_index_enabled[i] == CHANNEL_ENABLED ) )
+        {
+            max = max_dr_channel[i];
+        }
+    }
+    return ( max );
+}
+uint8_t region_eu_868_channel_enabled_get( uint8_t index )
+{
+    if( index >= NUMBER_OF_CHANNEL_EU_868 )
+    {
+        BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    return ( channel_index_enabled[index] );
+}
+
+void region_eu_868_duty_cycle_enable_set( uint8_t enable )
+{
+    is_duty_cycle_enabled = ( enable != 0 ) ? true : false;
+    band_free_channel_mask_update( );
+}
+
+void region_eu_868_duty_cycle_sum( uint32_t freq_hz, uint32_t toa_ms )
+{
+    uint8_t band = duty_cycle_band_get( freq_hz );
+    if( band >= NUMBER_OF_DUTY_CYCLE_BAND_EU_868 )
+    {
+        return;
+    }
+    duty_cycle_window_slide( );
+    band_slot_toa_ms[band][slot_current] += toa_ms;
+    band_window_toa_ms[band] += toa_ms;
+    band_last_toa_ms[band] = toa_ms;
+    duty_cycle_save( );
+    region_eu_868_duty_cycle_update( );
+}
+
+void region_eu_868_duty_cycle_update( void )
+{
+    uint8_t band_busy_prev = band_busy;
+
+    duty_cycle_window_slide( );
+    band_busy = 0;
+    for( uint8_t band = 0; band < NUMBER_OF_DUTY_CYCLE_BAND_EU_868; band++ )
+    {
+        if( ( band_window_toa_ms[band] + band_last_toa_ms[band] ) > duty_cycle_band_budget_ms_get( band ) )
+        {
+            band_busy |= ( 1 << band );
+        }
+    }
+    if( band_busy != band_busy_prev )
+    {
+        band_free_channel_mask_update( );
+    }
+}
+
+status_lorawan_t region_eu_868_duty_cycle_is_toa_accepted( uint32_t freq_hz, uint32_t toa_ms )
+{
+    uint8_t band = duty_cycle_band_get( freq_hz );
+    if( band >= NUMBER_OF_DUTY_CYCLE_BAND_EU_868 )
+    {
+        return ERRORLORAWAN;
+    }
+    if( ( is_duty_cycle_enabled == true ) &&
+        ( toa_ms > duty_cycle_band_budget_ms_get( band ) ) )
+    {
+        BSP_DBG_TRACE_WARNING( "TOA %lu ms OVER THE HOURLY DUTY CYCLE OF THE BAND\n", toa_ms );
+        return ERRORLORAWAN;
+    }
+    return OKLORAWAN;
+}
+
+status_lorawan_t region_eu_868_duty_cycle_is_channel_free( uint32_t freq_hz )
+{
+    uint8_t band = duty_cycle_band_get( freq_hz );
+    if( band >= NUMBER_OF_DUTY_CYCLE_BAND_EU_868 )
+    {
+        return ERRORLORAWAN;
+    }
+    region_eu_868_duty_cycle_update( );
+    return ( ( is_duty_cycle_enabled == false ) || ( ( ( band_busy >> band ) & 0x1 ) == 0 ) ) ? OKLORAWAN
+                                                                                            : ERRORLORAWAN;
+}
+
+int32_t region_eu_868_next_free_duty_cycle_ms_get( void )
+{
+    if( is_duty_cycle_enabled == false )
+    {
+        return 0;
+    }
+    if( is_dr_channel_mask_valid == false )
+    {
+        dr_channel_mask_update( );
+    }
+    region_eu_868_duty_cycle_update( );
+
+    int32_t next_ms = -1;
+    for( uint8_t band = 0; band < NUMBER_OF_DUTY_CYCLE_BAND_EU_868; band++ )
+    {
+        // only the bands holding an enabled channel matter
+        uint32_t channel_mask[CHANNEL_MASK_WORDS_EU_868] = { 0 };
+        for( uint8_t dr = 0; dr <= MAX_DR_EU_868; dr++ )
+        {
+            for( uint8_t i = 0; i < CHANNEL_MASK_WORDS_EU_868; i++ )
+            {
+                channel_mask[i] |= band_channel_mask[band][i] & dr_channel_mask[dr][i];
+            }
+        }
+        if( lr1mac_utilities_channel_mask_count( channel_mask, CHANNEL_MASK_WORDS_EU_868 ) == 0 )
+        {
+            continue;
+        }
+        int32_t band_ms = ( ( ( band_busy >> band ) & 0x1 ) != 0 ) ? duty_cycle_band_free_ms_get( band ) : 0;
+        if( ( next_ms < 0 ) || ( band_ms < next_ms ) )
+        {
+            next_ms = band_ms;
+        }
+    }
+    return ( next_ms > 0 ) ? next_ms : 0;
+}
+
+/*************************************************************************/
+/*                      Private region utilities implementation          */
+/*************************************************************************/
+static void tx_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr )
+{
+    lr1_mac->tx_modulation_type = LORA;
+    if( dr < 6 )
+    {
+        lr1_mac->tx_sf = 12 - dr;
+        lr1_mac->tx_bw = BW125;
+    }
+    else if( dr == 6 )
+    {
+        lr1_mac->tx_sf = 7;
+        lr1_mac->tx_bw = BW250;
+    }
+    else if( dr == 7 )
+    {
+        lr1_mac->tx_modulation_type = FSK;
+        lr1_mac->tx_sf              = 50;  // kbps
+    }
+    else
+    {
+        lr1_mac->tx_sf = 12;
+        lr1_mac->tx_bw = BW125;
+        BSP_DBG_TRACE_WARNING( " Invalid Datarate \n" );
+    }
+}
+static void rx1_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr )
+{
+    lr1_mac->rx1_modulation_type = LORA;
+    if( dr < 6 )
+    {
+        lr1_mac->rx1_sf = 12 - dr;
+        lr1_mac->rx1_bw = BW125;
+    }
+    else if( dr == 6 )
+    {
+        lr1_mac->rx1_sf = 7;
+        lr1_mac->rx1_bw = BW250;
+    }
+    else if( dr == 7 )
+    {
+        lr1_mac->rx1_modulation_type = FSK;
+        lr1_mac->rx1_sf              = 50;  // kbps
+    }
+    else
+    {
+        lr1_mac->rx1_sf = 12;
+        lr1_mac->rx1_bw = BW125;
+        BSP_DBG_TRACE_WARNING( " Invalid Datarate \n" );
+    }
+}
+static void rx2_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr )
+{
+    lr1_mac->rx2_modulation_type = LORA;
+    if( dr < 6 )
+    {
+        lr1_mac->rx2_sf = 12 - dr;
+        lr1_mac->rx2_bw = BW125;
+    }
+    else if( dr == 6 )
+    {
+        lr1_mac->rx2_sf = 7;
+        lr1_mac->rx2_bw = BW250;
+    }
+    else if( dr == 7 )
+    {
+        lr1_mac->rx2_modulation_type = FSK;
+        lr1_mac->rx2_sf              = 50;  // kbps
+    }
+    else
+    {
+        lr1_mac->rx2_sf = 12;
+        lr1_mac->rx2_bw = BW125;
+        BSP_DBG_TRACE_WARNING( " Invalid Datarate \n" );
+    }
+}
+static void dr_channel_mask_update( void )
+{
+    memset( dr_channel_mask, 0, sizeof( dr_channel_mask ) );
+    memset( band_channel_mask, 0, sizeof( band_channel_mask ) );
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_EU_868; i++ )
+    {
+        uint8_t band = duty_cycle_band_get( tx_frequency_channel[i] );
+        if( band < NUMBER_OF_DUTY_CYCLE_BAND_EU_868 )
+        {
+            band_channel_mask[band][i / 32] |= ( 1UL << ( i % 32 ) );
+        }
+        // a channel out of the bands cannot be used
+        if( ( channel_index_enabled[i] != CHANNEL_ENABLED ) || ( band >= NUMBER_OF_DUTY_CYCLE_BAND_EU_868 ) )
+        {
+            continue;
+        }
+        for( uint8_t dr = min_dr_channel[i]; ( dr <= max_dr_channel[i] ) && ( dr <= MAX_DR_EU_868 ); dr++ )
+        {
+            dr_channel_mask[dr][i / 32] |= ( 1UL << ( i % 32 ) );
+        }
+    }
+    is_dr_channel_mask_valid = true;
+    band_free_channel_mask_update( );
+}
+
+static void band_free_channel_mask_update( void )
+{
+    memset( band_free_channel_mask, 0, sizeof( band_free_channel_mask ) );
+    for( uint8_t band = 0; band < NUMBER_OF_DUTY_CYCLE_BAND_EU_868; band++ )
+    {
+        if( ( is_duty_cycle_enabled == false ) || ( ( ( band_busy >> band ) & 0x1 ) == 0 ) )
+        {
+            for( uint8_t i = 0; i < CHANNEL_MASK_WORDS_EU_868; i++ )
+            {
+                band_free_channel_mask[i] |= band_channel_mask[band][i];
+            }
+        }
+    }
+}
+
+static uint8_t duty_cycle_band_get( uint32_t freq_hz )
+{
+    for( uint8_t band = 0; band < NUMBER_OF_DUTY_CYCLE_BAND_EU_868; band++ )
+    {
+        if( ( freq_hz >= duty_cycle_band[band].freq_min ) && ( freq_hz < duty_cycle_band[band].freq_max ) )
+        {
+            return band;
+        }
+    }
+    return NUMBER_OF_DUTY_CYCLE_BAND_EU_868;
+}
+
+static uint32_t duty_cycle_band_budget_ms_get( uint8_t band )
+{
+    return ( SMTC_REAL_DUTY_CYCLE_THRESHOLD_MS_BY_HOUR / duty_cycle_band[band].divisor );
+}
+
+static void duty_cycle_window_slide( void )
+{
+    uint32_t now = bsp_rtc_get_time_ms( );
+
+    if( ( now - slot_current_start_ms ) >= ( ( DUTY_CYCLE_SLOT_NB_EU_868 + 1 ) * DUTY_CYCLE_SLOT_MS_EU_868 ) )
+    {
+        // all the slots are out of the window
+        memset( band_slot_toa_ms, 0, sizeof( band_slot_toa_ms ) );
+        memset( band_window_toa_ms, 0, sizeof( band_window_toa_ms ) );
+        slot_current_start_ms = now;
+        return;
+    }
+    while( ( now - slot_current_start_ms ) >= DUTY_CYCLE_SLOT_MS_EU_868 )
+    {
+        // the next slot is the oldest one, it leaves the window
+        slot_current = ( slot_current + 1 ) % ( DUTY_CYCLE_SLOT_NB_EU_868 + 1 );
+        slot_current_start_ms += DUTY_CYCLE_SLOT_MS_EU_868;
+        for( uint8_t band = 0; band < NUMBER_OF_DUTY_CYCLE_BAND_EU_868; band++ )
+        {
+            band_window_toa_ms[band] -= band_slot_toa_ms[band][slot_current];
+            band_slot_toa_ms[band][slot_current] = 0;
+        }
+    }
+}
+
+static int32_t duty_cycle_band_free_ms_get( uint8_t band )
+{
+    uint32_t budget = duty_cycle_band_budget_ms_get( band );
+    uint32_t toa_ms = band_window_toa_ms[band] + band_last_toa_ms[band];
+    uint32_t now    = bsp_rtc_get_time_ms( );
+
+    // the slots leave the window from the oldest one, one per slot duration
+    for( uint8_t i = 1; i <= DUTY_CYCLE_SLOT_NB_EU_868; i++ )
+    {
+        if( toa_ms <= budget )
+        {
+            break;
+        }
+        toa_ms -= band_slot_toa_ms[band][( slot_current + i ) % ( DUTY_CYCLE_SLOT_NB_EU_868 + 1 )];
+        if( toa_ms <= budget )
+        {
+            return ( int32_t )( slot_current_start_ms + ( i * DUTY_CYCLE_SLOT_MS_EU_868 ) - now );
+        }
+    }
+    // the current slot goes last, an uplink over the budget is refused before
+    return ( toa_ms <= budget ) ? 0
+                                : ( int32_t )( slot_current_start_ms +
+                                               ( ( DUTY_CYCLE_SLOT_NB_EU_868 + 1 ) * DUTY_CYCLE_SLOT_MS_EU_868 ) - now );
+}
+
+static void duty_cycle_save( void )
+{
+    duty_cycle_context_eu_868_t context;
+
+    for( uint8_t band = 0; band < NUMBER_OF_DUTY_CYCLE_BAND_EU_868; band++ )
+    {
+        context.window_toa_s[band] = ( band_window_toa_ms[band] + 999 ) / 1000;
+    }
+    bsp_nvm_journal_write( BSP_NVM_JOURNAL_KEY_LORAWAN_DUTY_CYCLE, ( uint8_t* ) &context, sizeof( context ) );
+}
+
+static void duty_cycle_restore( void )
+{
+    duty_cycle_context_eu_868_t context;
+
+    if( bsp_nvm_journal_read( BSP_NVM_JOURNAL_KEY_LORAWAN_DUTY_CYCLE, ( uint8_t* ) &context, sizeof( context ) ) !=
+        sizeof( context ) )
+    {
+        return;
+    }
+    // the time of the uplinks is lost with the reset: they are all taken as just sent
+    duty_cycle_window_slide( );
+    for( uint8_t band = 0; band < NUMBER_OF_DUTY_CYCLE_BAND_EU_868; band++ )
+    {
+        band_slot_toa_ms[band][slot_current] += context.window_toa_s[band] * 1000;
+        band_window_toa_ms[band] += context.window_toa_s[band] * 1000;
+    }
+    region_eu_868_duty_cycle_update( );
+}
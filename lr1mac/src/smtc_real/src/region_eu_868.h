@@ -0,0 +1,402 @@
+/*!
+ * \file      region_eu_868.h
+ *
+ * \brief     region_eu_868 abstraction layer definition
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __REGION_EU_868_H__
+#define __REGION_EU_868_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "smtc_real_defs.h"
+#include "lr1mac_defs.h"
+#include "lr1_stack_mac_layer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// clang-format off
+
+#define NUMBER_OF_CHANNEL_EU_868        (16)
+#define NUMBER_OF_DUTY_CYCLE_BAND_EU_868 (6)
+#define JOIN_ACCEPT_DELAY1_EU_868       (5)             // define in seconds
+#define JOIN_ACCEPT_DELAY2_EU_868       (6)             // define in seconds
+#define RECEIVE_DELAY1_EU_868           (1)             // define in seconds
+#define TX_POWER_EU_868                 (16)            // define in dbm
+#define ADR_ACK_LIMIT_EU_868            (64)
+#define ADR_ACK_DELAY_EU_868            (32)
+#define ACK_TIMEOUT_EU_868              (2)             // +/- 1 s (random delay between 1 and 3 seconds)
+#define FREQMIN_EU_868                  (863000000)     // Hz
+#define FREQMAX_EU_868                  (870000000)     // Hz
+#define RX2_FREQ_EU_868                 (869525000)     // Hz
+#define FREQUENCY_FACTOR_EU_868         (100)           // MHz/100 when coded over 24 bits
+#define RX2DR_INIT_EU_868               (0)
+#define SYNC_WORD_EU_868                (0x34)
+#define MIN_DR_EU_868                   (0)
+#define MAX_DR_EU_868                   (7)
+#define BEACON_FREQ_EU_868              (869525000)     // Hz, class B beacon and ping slots
+#define BEACON_DR_EU_868                (3)
+#define TIMEONAIR_JOIN_SF5_MS_868       (12)            // 1.48 s at SF12 is 12 ms scaled to SF5
+
+// clang-format on
+
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_init( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_dr_distribution_set( lr1_stack_mac_t* lr1_mac, uint8_t adrMode );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_eu_868_memory_load( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_bad_crc_memory_set( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_next_dr_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Set the next datarate to the fastest one of the distribution, capped by the enabled channels
+ * \remark  The datarate given by the ADR is kept in static ADR mode
+ * \param [IN]  lr1_mac                   - stack
+ * \param [IN]  dr_max                    - fastest datarate allowed
+ * \param [OUT] none
+ */
+void region_eu_868_fastest_dr_get( lr1_stack_mac_t* lr1_mac, uint8_t dr_max );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_memory_save( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_eu_868_max_payload_size_get( uint8_t dr );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint32_t region_eu_868_decode_freq_from_buf( uint8_t freq_buf[3] );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_cflist_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_eu_868_next_channel_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_eu_868_join_next_channel_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_rx_config_set( lr1_stack_mac_t* lr1_mac, rx_win_type_t type );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_power_set( lr1_stack_mac_t* lr1_mac, uint8_t power_cmd );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_channel_mask_set( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_channel_mask_init( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_join_snapshot_channel_mask_init( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_channel_t region_eu_868_channel_mask_build( uint8_t ChMaskCntl, uint16_t ChMask );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_dr_decrement( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_eu_868_adr_ack_delay_get( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_eu_868_adr_ack_limit_get( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_eu_868_sync_word_get( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_eu_868_is_valid_rx1_dr_offset( uint8_t rx1_dr_offset );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_eu_868_is_valid_dr( uint8_t dr );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_eu_868_is_acceptable_dr( uint8_t dr );  // for link adr cmd
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_eu_868_is_valid_tx_frequency( uint32_t frequency );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_eu_868_is_valid_rx_frequency( uint32_t frequency );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_eu_868_is_valid_tx_power( uint8_t power );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_eu_868_is_valid_channel_index( uint8_t channel_index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_eu_868_is_valid_size( lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t size );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_tx_frequency_channel_set( uint32_t tx_freq, uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_rx1_frequency_channel_set( uint32_t rx_freq, uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_min_dr_channel_set( uint8_t dr, uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_max_dr_channel_set( uint8_t dr, uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_eu_868_channel_enabled_set( uint8_t enable, uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint32_t region_eu_868_tx_frequency_channel_get( uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint32_t region_eu_868_rx1_frequency_channel_get( uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_eu_868_min_dr_channel_get( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_eu_868_max_dr_channel_get( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_eu_868_channel_enabled_get( uint8_t index );
+/*!
+ * \brief   Return the GFSK sync word of the DR7 uplinks and downlinks
+ * \param [OUT] return    3 bytes sync word
+ */
+uint8_t* region_eu_868_gfsk_sync_word_get( void );
+/*!
+ * \brief   Class B beacon and ping slots on the same frequency and DR3 by default
+ * \param [IN]  ping_dr   Datarate of the ping slots, 0xFF for DR3
+ * \param [OUT] params
+ * \param [OUT] return    ERRORLORAWAN if ping_dr is not a LoRa datarate
+ */
+status_lorawan_t region_eu_868_class_b_params_get( uint8_t ping_dr, smtc_real_class_b_params_t* params );
+/*!
+ * \brief   Enable or disable the duty cycle of the sub-bands, enabled at startup
+ * \param [IN]  enable    1 to enforce the duty cycle
+ */
+void region_eu_868_duty_cycle_enable_set( uint8_t enable );
+/*!
+ * \brief   Account an uplink in the duty cycle of its sub-band, the time on air of the last hour is saved in nvm
+ * \param [IN]  freq_hz   Uplink frequency
+ * \param [IN]  toa_ms    Uplink time on air
+ */
+void region_eu_868_duty_cycle_sum( uint32_t freq_hz, uint32_t toa_ms );
+/*!
+ * \brief   Refresh the sub-bands free to transmit, to be called before a channel selection
+ */
+void region_eu_868_duty_cycle_update( void );
+/*!
+ * \brief   Check if an uplink can ever fit in the duty cycle of its sub-band
+ * \param [IN]  freq_hz   Uplink frequency
+ * \param [IN]  toa_ms    Uplink time on air
+ * \param [OUT] return    OKLORAWAN if the time on air is below the hourly budget of the sub-band
+ */
+status_lorawan_t region_eu_868_duty_cycle_is_toa_accepted( uint32_t freq_hz, uint32_t toa_ms );
+/*!
+ * \brief   Check if the sub-band of a frequency is free to transmit
+ * \param [IN]  freq_hz   Uplink frequency
+ * \param [OUT] return    OKLORAWAN if the sub-band is free
+ */
+status_lorawan_t region_eu_868_duty_cycle_is_channel_free( uint32_t freq_hz );
+/*!
+ * \brief   Return the time until the first sub-band with an enabled channel is free to transmit
+ * \param [OUT] return    Time in ms, 0 if an enabled channel can be used now
+ */
+int32_t region_eu_868_next_free_duty_cycle_ms_get( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __REGION_EU_868_H__
@@ -0,0 +1,724 @@
+/*!
+ * \file      region_us_915.c
+ *
+ * \brief     region_us_915 abstraction layer implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>  // memcpy
+#include "region_us_915.h"
+#include "smtc_real.h"
+#include "lr1_stack_mac_layer.h"
+#include "lr1mac_utilities.h"
+#include "smtc_bsp.h"
+#include "ral_defs.h"
+
+#define CHANNEL_MASK_WORDS_US_915 LR1MAC_UTILITIES_CHANNEL_MASK_WORDS( NUMBER_OF_CHANNEL_US_915 )
+#define CHANNEL_MASK_BLOCKS_US_915 ( 5 )  // blocks of 16 channels addressed by the LinkADRReq ChMaskCntl
+
+/*
+ * The 72 channels are fixed by the region: their frequencies are computed from the index and the enabled channels are
+ * kept as a bitmask, so that the channel plan takes a few words and a channel selection counts bits instead of
+ * scanning the channels.
+ */
+static uint32_t channel_index_enabled[CHANNEL_MASK_WORDS_US_915];
+static uint16_t unwrapped_channel_mask[CHANNEL_MASK_BLOCKS_US_915];
+static uint8_t  dr_distribution_init[8] = { 0 };
+static uint8_t  dr_distribution[8]      = { 0 };
+static uint8_t  join_sub_band           = 0;  // sub-band of 8 channels of the next join request
+
+static mac_context_t mac_context;
+
+// Private region_us_915 utilities declaration
+//
+/*!
+ *
+ */
+static void     tx_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr );
+static void     rx_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr, rx_win_type_t type );
+static uint32_t tx_frequency_get( uint8_t index );
+static uint32_t rx1_frequency_get( uint8_t index );
+
+/*!
+ *
+ */
+
+void region_us_915_init( lr1_stack_mac_t* lr1_mac )
+{
+    // all the channels are enabled until the network restricts them
+    memset( channel_index_enabled, 0, sizeof( channel_index_enabled ) );
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_US_915; i++ )
+    {
+        channel_index_enabled[i / 32] |= ( 1UL << ( i % 32 ) );
+    }
+
+    lr1_mac->rx2_frequency    = RX2_FREQ_US_915;
+    lr1_mac->tx_power         = TX_POWER_US_915;
+    lr1_mac->rx1_dr_offset    = 0;
+    lr1_mac->rx2_data_rate    = RX2DR_INIT_US_915;
+    lr1_mac->rx1_delay_s      = RECEIVE_DELAY1_US_915;
+    lr1_mac->tx_data_rate_adr = 0;
+    lr1_mac->adr_custom       = BSP_USER_DR_DISTRIBUTION_PARAMETERS;
+    memset( dr_distribution_init, 1, 8 );
+}
+
+status_lorawan_t region_us_915_is_valid_rx1_dr_offset( uint8_t rx1_dr_offset )
+{
+    status_lorawan_t status = OKLORAWAN;
+    if( rx1_dr_offset > 3 )
+    {
+        status = ERRORLORAWAN;
+        BSP_DBG_TRACE_MSG( "RECEIVE AN INVALID RX1 DR OFFSET \n" );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_us_915_is_valid_dr( uint8_t dr )
+{
+    status_lorawan_t status;
+    // DR0 to DR4 uplink, DR8 to DR13 downlink
+    status = ( ( dr <= MAX_DR_US_915 ) || ( ( dr >= 8 ) && ( dr <= 13 ) ) ) ? OKLORAWAN : ERRORLORAWAN;
+    if( status == ERRORLORAWAN )
+    {
+        BSP_DBG_TRACE_WARNING( " Invalid data rate\n" );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_us_915_is_acceptable_dr( uint8_t dr )
+{
+    status_lorawan_t status = ERRORLORAWAN;
+    if( dr < MAX_DR_US_915 )
+    {
+        // 125 kHz channels
+        for( uint8_t i = 0; i < 4; i++ )
+        {
+            if( unwrapped_channel_mask[i] != 0 )
+            {
+                return ( OKLORAWAN );
+            }
+        }
+    }
+    else if( dr == MAX_DR_US_915 )
+    {
+        // 500 kHz channels
+        if( ( unwrapped_channel_mask[4] & 0xFF ) != 0 )
+        {
+            return ( OKLORAWAN );
+        }
+    }
+    BSP_DBG_TRACE_WARNING( " Not acceptable data rate\n" );
+    return ( status );
+}
+
+status_lorawan_t region_us_915_is_valid_tx_frequency( uint32_t frequency )
+{
+    status_lorawan_t status = OKLORAWAN;
+    if( ( frequency > FREQMAX_US_915 ) || ( frequency < FREQMIN_US_915 ) )
+    {
+        status = ERRORLORAWAN;
+        BSP_DBG_TRACE_WARNING( "RECEIVE AN INVALID FREQUENCY = %lu\n", frequency );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_us_915_is_valid_rx_frequency( uint32_t frequency )
+{
+    status_lorawan_t status = OKLORAWAN;
+    if( ( frequency > FREQMAX_US_915 ) || ( frequency < FREQMIN_US_915 ) )
+    {
+        status = ERRORLORAWAN;
+        BSP_DBG_TRACE_WARNING( "RECEIVE AN INVALID Rx FREQUENCY = %lu\n", frequency );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_us_915_is_valid_tx_power( uint8_t power )
+{
+    status_lorawan_t status = OKLORAWAN;
+    if( ( power > 14 ) )
+    {
+        status = ERRORLORAWAN;
+        BSP_DBG_TRACE_WARNING( "RECEIVE AN INVALID Power Cmd = %d\n", power );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_us_915_is_valid_channel_index( uint8_t channel_index )
+{
+    // No NewChannelReq in US_915, the channels are fixed
+    BSP_DBG_TRACE_WARNING( "RECEIVE AN INVALID Channel Index Cmd = %d\n", channel_index );
+    return ( ERRORLORAWAN );
+}
+
+status_lorawan_t region_us_915_is_valid_size( lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t size )
+{
+    status_lorawan_t status;
+    uint8_t          N[14] = { 11, 53, 125, 242, 242, 0, 0, 0, 53, 129, 242, 242, 242, 242 };
+    status = ( ( dr > 13 ) || ( ( size + lr1_mac->tx_fopts_current_length ) > N[dr] ) ) ? ERRORLORAWAN : OKLORAWAN;
+    if( status == ERRORLORAWAN )
+    {
+        BSP_DBG_TRACE_WARNING( " Invalid size \n" );
+    }
+    return ( status );
+}
+
+status_lorawan_t region_us_915_memory_load( lr1_stack_mac_t* lr1_mac )
+{
+    bsp_nvm_context_restore( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &( mac_context ),
+                             sizeof( mac_context ) );
+
+    if( lr1mac_utilities_crc( ( uint8_t* ) &mac_context, sizeof( mac_context ) - 4 ) == mac_context.crc )
+    {
+        memcpy( lr1_mac->app_eui, mac_context.appeui, 8 );
+        memcpy( lr1_mac->dev_eui, mac_context.deveui, 8 );
+        memcpy( lr1_mac->app_key, mac_context.appkey, 16 );
+        lr1_mac->dev_nonce   = mac_context.devnonce;
+        lr1_mac->adr_custom  = mac_context.adr_custom;
+        lr1_mac->nb_of_reset = mac_context.nb_reset + 1;  // @todo move increment in mcu_reset api and remove all nvic
+        lr1_mac->real->region_type = ( smtc_real_region_types_t ) mac_context.region_type;
+        lr1_mac->dev_nonce_reserved = mac_context.devnonce;
+        region_us_915_memory_save( lr1_mac );  // to save new number of reset
+        BSP_DBG_TRACE_PRINTF( " DevNonce = 0x%x ", lr1_mac->dev_nonce );
+        BSP_DBG_TRACE_PRINTF( ", NbOfReset = %d \n", lr1_mac->nb_of_reset );
+        BSP_DBG_TRACE_PRINTF( " Region = %d\n", lr1_mac->real->region_type );
+        return OKLORAWAN;
+    }
+    else  // start with "in rescue eeprom mode"
+    {
+        bsp_nvm_context_restore( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ) + sizeof( mac_context ) + 4,
+                                 ( uint8_t* ) &( mac_context ), sizeof( mac_context ) );
+
+        if( lr1mac_utilities_crc( ( uint8_t* ) &mac_context, sizeof( mac_context ) - 4 ) == mac_context.crc )
+        {
+            memcpy( lr1_mac->app_eui, mac_context.appeui, 8 );
+            memcpy( lr1_mac->dev_eui, mac_context.deveui, 8 );
+            memcpy( lr1_mac->app_key, mac_context.appkey, 16 );
+            lr1_mac->dev_nonce   = mac_context.devnonce;
+            lr1_mac->adr_custom  = mac_context.adr_custom;
+            lr1_mac->nb_of_reset = mac_context.nb_reset;  // @todo move increment in mcu_reset api and remove all nvic
+            lr1_mac->real->region_type = ( smtc_real_region_types_t ) mac_context.region_type;
+            lr1_mac->dev_nonce_reserved = mac_context.devnonce;
+            region_us_915_memory_save( lr1_mac );  // to save new number of reset
+            BSP_DBG_TRACE_PRINTF( "\n start on rescue eeprom , DevNonce = 0x%x ", lr1_mac->dev_nonce );
+            BSP_DBG_TRACE_PRINTF( "\n start on rescue eeprom , NbOfReset = %d ", lr1_mac->nb_of_reset );
+            BSP_DBG_TRACE_PRINTF( "\n start on rescue eeprom , Region = %d\n", lr1_mac->real->region_type );
+            return OKLORAWAN;
+        }
+        else
+        {  // == factory reset
+            return ERRORLORAWAN;
+        }
+    }
+}
+void region_us_915_bad_crc_memory_set( lr1_stack_mac_t* lr1_mac )
+{
+    mac_context.devnonce    = lr1_mac->dev_nonce_reserved;
+    mac_context.adr_custom  = lr1_mac->adr_custom;
+    mac_context.nb_reset    = lr1_mac->nb_of_reset;
+    mac_context.region_type = lr1_mac->real->region_type;
+    memcpy( mac_context.appeui, lr1_mac->app_eui, 8 );
+    memcpy( mac_context.deveui, lr1_mac->dev_eui, 8 );
+    memcpy( mac_context.appkey, lr1_mac->app_key, 16 );
+    mac_context.crc = lr1mac_utilities_crc( ( uint8_t* ) &mac_context, sizeof( mac_context ) - 4 ) + 1;
+    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &( mac_context ),
+                           sizeof( mac_context ) );
+
+    bsp_mcu_wait_us( 10000 );
+
+    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ) + sizeof( mac_context ) + 4,
+                           ( uint8_t* ) &( mac_context ), sizeof( mac_context ) );
+    bsp_mcu_wait_us( 10000 );
+}
+void region_us_915_memory_save( lr1_stack_mac_t* lr1_mac )
+{
+    mac_context.devnonce    = lr1_mac->dev_nonce_reserved;
+    mac_context.adr_custom  = lr1_mac->adr_custom;
+    mac_context.nb_reset    = lr1_mac->nb_of_reset;
+    mac_context.region_type = lr1_mac->real->region_type;
+    memcpy( mac_context.appeui, lr1_mac->app_eui, 8 );
+    memcpy( mac_context.deveui, lr1_mac->dev_eui, 8 );
+    memcpy( mac_context.appkey, lr1_mac->app_key, 16 );
+    mac_context.crc = lr1mac_utilities_crc( ( uint8_t* ) &mac_context, sizeof( mac_context ) - 4 );
+    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &( mac_context ),
+                           sizeof( mac_context ) );
+
+    bsp_mcu_wait_us( 10000 );
+
+    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ) + sizeof( mac_context ) + 4,
+                           ( uint8_t* ) &( mac_context ), sizeof( mac_context ) );
+    bsp_mcu_wait_us( 10000 );
+}
+
+void region_us_915_dr_distribution_set( lr1_stack_mac_t* lr1_mac, uint8_t adr_mode )
+{
+    memset( dr_distribution_init, 0, 8 );
+    switch( adr_mode )
+    {
+    case MOBILE_LONGRANGE_DR_DISTRIBUTION:  // in this example 4/7 dr0 2/7 dr1 and 1/7 dr2
+        dr_distribution_init[2] = 1;
+        dr_distribution_init[1] = 2;
+        dr_distribution_init[0] = 4;
+        lr1_mac->nb_trans       = 1;
+        break;
+    case MOBILE_LOWPER_DR_DISTRIBUTION:  // in this example 5/10 dr3 4/10 dr2 and 1/10 dr0
+        dr_distribution_init[3] = 5;
+        dr_distribution_init[2] = 4;
+        dr_distribution_init[0] = 1;
+        lr1_mac->nb_trans       = 1;
+        break;
+    case JOIN_DR_DISTRIBUTION:  // 1/2 dr0 on a 125 kHz channel and 1/2 dr4 on a 500 kHz channel
+        dr_distribution_init[4] = 1;
+        dr_distribution_init[0] = 1;
+        lr1_mac->nb_trans       = 1;
+        break;
+    case USER_DR_DISTRIBUTION:
+        dr_distribution_init[4] = ( ( lr1_mac->adr_custom ) & ( 0x0000F000 ) ) >> 12;
+        dr_distribution_init[3] = ( ( lr1_mac->adr_custom ) & ( 0x000F0000 ) ) >> 16;
+        dr_distribution_init[2] = ( ( lr1_mac->adr_custom ) & ( 0x00F00000 ) ) >> 20;
+        dr_distribution_init[1] = ( ( lr1_mac->adr_custom ) & ( 0x0F000000 ) ) >> 24;
+        dr_distribution_init[0] = ( ( lr1_mac->adr_custom ) & ( 0xF0000000 ) ) >> 28;
+        lr1_mac->nb_trans       = BSP_USER_NUMBER_OF_RETRANSMISSION;
+        break;
+    default:
+        dr_distribution_init[0] = 1;
+        lr1_mac->nb_trans       = 1;
+        break;
+    }
+    memcpy( dr_distribution, dr_distribution_init, 8 );
+}
+
+status_lorawan_t region_us_915_join_next_channel_get( lr1_stack_mac_t* lr1_mac )
+{
+    uint8_t channel_idx;
+    // the join requests go through the 8 sub-bands in turn, so that a gateway listening to one of them is found
+    if( lr1_mac->tx_data_rate == MAX_DR_US_915 )
+    {
+        channel_idx = NUMBER_OF_CHANNEL_125_US_915 + join_sub_band;
+    }
+    else
+    {
+        channel_idx = ( join_sub_band * 8 ) + bsp_rng_get_random_in_range( 0, 7 );
+    }
+    join_sub_band          = ( join_sub_band + 1 ) % 8;
+    lr1_mac->tx_frequency  = tx_frequency_get( channel_idx );
+    lr1_mac->rx1_frequency = rx1_frequency_get( channel_idx );
+    return OKLORAWAN;
+}
+
+status_lorawan_t region_us_915_next_channel_get( lr1_stack_mac_t* lr1_mac )
+{
+    if( lr1_mac->tx_data_rate > MAX_DR_US_915 )
+    {
+        BSP_DBG_TRACE_WARNING( "NO CHANNELS AVAILABLE \n" );
+        return ERRORLORAWAN;
+    }
+    // DR0 to DR3 on the 125 kHz channels, DR4 on the 500 kHz channels
+    uint32_t channel_mask[CHANNEL_MASK_WORDS_US_915] = { 0 };
+    if( lr1_mac->tx_data_rate < MAX_DR_US_915 )
+    {
+        channel_mask[0] = channel_index_enabled[0];
+        channel_mask[1] = channel_index_enabled[1];
+    }
+    else
+    {
+        channel_mask[2] = channel_index_enabled[2] & 0xFF;
+    }
+    uint8_t active_channel_nb = lr1mac_utilities_channel_mask_count( channel_mask, CHANNEL_MASK_WORDS_US_915 );
+    if( active_channel_nb == 0 )
+    {
+        BSP_DBG_TRACE_WARNING( "NO CHANNELS AVAILABLE \n" );
+        return ERRORLORAWAN;
+    }
+    uint8_t temp        = ( bsp_rng_get_random_in_range( 0, ( active_channel_nb - 1 ) ) ) % active_channel_nb;
+    uint8_t channel_idx = lr1mac_utilities_channel_mask_select( channel_mask, CHANNEL_MASK_WORDS_US_915, temp );
+    if( channel_idx >= NUMBER_OF_CHANNEL_US_915 )
+    {
+        BSP_DBG_TRACE_PRINTF( "INVALID CHANNEL  active channel = %d and random channel = %d \n", active_channel_nb,
+                              temp );
+        return ERRORLORAWAN;
+    }
+    else
+    {
+        lr1_mac->tx_frequency  = tx_frequency_get( channel_idx );
+        lr1_mac->rx1_frequency = rx1_frequency_get( channel_idx );
+    }
+    return OKLORAWAN;
+}
+
+void region_us_915_next_dr_get( lr1_stack_mac_t* lr1_mac )
+{
+    if( lr1_mac->adr_mode_select == STATIC_ADR_MODE )
+    {
+        lr1_mac->tx_data_rate = lr1_mac->tx_data_rate_adr;
+        lr1_mac->adr_enable   = 1;
+    }
+    else if( lr1_mac->adr_mode_select == LINK_MARGIN_ADR_MODE )
+    {
+        lr1_stack_mac_link_margin_adr( lr1_mac );
+        lr1_mac->tx_data_rate = lr1_mac->tx_data_rate_adr;
+        lr1_mac->adr_enable   = 0;
+    }
+    else
+    {
+        // an empty profile keeps the current datarate
+        smtc_real_dr_distribution_draw( dr_distribution, dr_distribution_init, MAX_DR_US_915 + 1,
+                                        &lr1_mac->tx_data_rate );
+        lr1_mac->adr_enable = 0;
+    }
+    lr1_mac->tx_data_rate = ( lr1_mac->tx_data_rate > MAX_DR_US_915 ) ? MAX_DR_US_915 : lr1_mac->tx_data_rate;
+    tx_dr_to_sf_bw( lr1_mac, lr1_mac->tx_data_rate );
+}
+
+void region_us_915_fastest_dr_get( lr1_stack_mac_t* lr1_mac, uint8_t dr_max )
+{
+    if( ( lr1_mac->adr_mode_select == STATIC_ADR_MODE ) || ( lr1_mac->adr_mode_select == LINK_MARGIN_ADR_MODE ) )
+    {
+        return;
+    }
+    for( int8_t dr = MIN( MAX_DR_US_915, dr_max ); dr >= 0; dr-- )
+    {
+        if( dr_distribution_init[dr] > 0 )
+        {
+            lr1_mac->tx_data_rate = MIN( ( uint8_t ) dr, region_us_915_max_dr_channel_get( ) );
+            break;
+        }
+    }
+    tx_dr_to_sf_bw( lr1_mac, lr1_mac->tx_data_rate );
+}
+
+uint8_t region_us_915_max_payload_size_get( uint8_t dr )
+{
+    uint8_t M[14] = { 19, 61, 133, 250, 250, 0, 0, 0, 61, 137, 250, 250, 250, 250 };
+    return ( ( dr > 13 ) ? 0 : M[dr] );
+}
+
+uint32_t region_us_915_decode_freq_from_buf( uint8_t freq_buf[3] )
+{
+    uint32_t freq = ( freq_buf[0] ) + ( freq_buf[1] << 8 ) + ( freq_buf[2] << 16 );
+    freq *= FREQUENCY_FACTOR_US_915;
+    return freq;
+}
+
+void region_us_915_cflist_get( lr1_stack_mac_t* lr1_mac )
+{
+    if( lr1_mac->cf_list[15] == CF_LIST_CH_MASK )
+    {
+        // 5 channel masks of 16 bits, from channel 0 up to channel 71
+        for( uint8_t i = 0; i < CHANNEL_MASK_BLOCKS_US_915; i++ )
+        {
+            unwrapped_channel_mask[i] = lr1_mac->cf_list[2 * i] | ( lr1_mac->cf_list[( 2 * i ) + 1] << 8 );
+        }
+        unwrapped_channel_mask[4] &= 0xFF;
+        region_us_915_channel_mask_set( lr1_mac );
+    }
+    else
+    {
+        BSP_DBG_TRACE_WARNING( "INVALID CFLIST, MUST CONTAINS CH MASK \n" );
+    }
+}
+
+void region_us_915_rx_config_set( lr1_stack_mac_t* lr1_mac, rx_win_type_t type )
+{
+    if( type == RX1 )
+    {
+        // DR0 to DR3 map on DR10 to DR13, DR4 on DR13, then the offset is applied down to DR8
+        int8_t rx1_dr = ( ( lr1_mac->tx_data_rate == MAX_DR_US_915 ) ? 13 : ( 10 + lr1_mac->tx_data_rate ) ) -
+                        lr1_mac->rx1_dr_offset;
+        rx_dr_to_sf_bw( lr1_mac, ( rx1_dr < 8 ) ? 8 : ( ( rx1_dr > 13 ) ? 13 : rx1_dr ), RX1 );
+    }
+    else if( type == RX2 )
+    {
+        rx_dr_to_sf_bw( lr1_mac, lr1_mac->rx2_data_rate, RX2 );
+    }
+    else
+    {
+        BSP_DBG_TRACE_WARNING( "INVALID RX TYPE \n" );
+    }
+}
+void region_us_915_power_set( lr1_stack_mac_t* lr1_mac, uint8_t power_cmd )
+{
+    if( power_cmd > 14 )
+    {
+        lr1_mac->tx_power = lr1_mac->max_eirp_dbm;  // Set by TxParamSetupReq
+        BSP_DBG_TRACE_WARNING( "INVALID TX_POWER_US_915 \n" );
+    }
+    else
+    {
+        lr1_mac->tx_power = lr1_mac->max_eirp_dbm - ( 2 * power_cmd );
+    }
+}
+void region_us_915_channel_mask_set( lr1_stack_mac_t* lr1_mac )
+{
+    channel_index_enabled[0] = unwrapped_channel_mask[0] | ( ( uint32_t ) unwrapped_channel_mask[1] << 16 );
+    channel_index_enabled[1] = unwrapped_channel_mask[2] | ( ( uint32_t ) unwrapped_channel_mask[3] << 16 );
+    channel_index_enabled[2] = unwrapped_channel_mask[4] & 0xFF;
+    BSP_DBG_TRACE_PRINTF( " 0x%lx 0x%lx 0x%lx \n", channel_index_enabled[0], channel_index_enabled[1],
+                          channel_index_enabled[2] );
+}
+void region_us_915_channel_mask_init( void )
+{
+    // the blocks of a LinkADRReq apply to the current channel plan
+    unwrapped_channel_mask[0] = channel_index_enabled[0] & 0xFFFF;
+    unwrapped_channel_mask[1] = channel_index_enabled[0] >> 16;
+    unwrapped_channel_mask[2] = channel_index_enabled[1] & 0xFFFF;
+    unwrapped_channel_mask[3] = channel_index_enabled[1] >> 16;
+    unwrapped_channel_mask[4] = channel_index_enabled[2] & 0xFF;
+}
+
+void region_us_915_join_snapshot_channel_mask_init( void )
+{
+    // without CFList keep the sub-band of the accepted join request, the previous one in the rotation
+    uint8_t sub_band = ( join_sub_band + 7 ) % 8;
+    memset( unwrapped_channel_mask, 0, sizeof( unwrapped_channel_mask ) );
+    unwrapped_channel_mask[sub_band / 2] = 0xFF << ( 8 * ( sub_band % 2 ) );
+    unwrapped_channel_mask[4]            = 1 << sub_band;
+    region_us_915_channel_mask_set( NULL );
+}
+
+status_channel_t region_us_915_channel_mask_build( uint8_t channel_mask_cntl, uint16_t channel_mask )
+{
+    status_channel_t status = OKCHANNEL;
+    switch( channel_mask_cntl )
+    {
+    case 0:
+    case 1:
+    case 2:
+    case 3:
+        unwrapped_channel_mask[channel_mask_cntl] = channel_mask;
+        break;
+    case 4:
+        unwrapped_channel_mask[4] = channel_mask & 0xFF;
+        break;
+    case 6:
+        memset( unwrapped_channel_mask, 0xFF, 4 * sizeof( uint16_t ) );
+        unwrapped_channel_mask[4] = channel_mask & 0xFF;
+        break;
+    case 7:
+        memset( unwrapped_channel_mask, 0, 4 * sizeof( uint16_t ) );
+        unwrapped_channel_mask[4] = channel_mask & 0xFF;
+        break;
+    default:
+        status = ERROR_CHANNEL_CNTL;
+        break;
+    }
+    BSP_DBG_TRACE_PRINTF( "ChMaskCntl = %d, ChMask = 0x%x\n", channel_mask_cntl, channel_mask );
+    if( ( unwrapped_channel_mask[0] | unwrapped_channel_mask[1] | unwrapped_channel_mask[2] |
+          unwrapped_channel_mask[3] | unwrapped_channel_mask[4] ) == 0 )
+    {
+        status = ERROR_CHANNEL_MASK;
+    }
+    return ( status );
+}
+
+void region_us_915_dr_decrement( lr1_stack_mac_t* lr1_mac )
+{
+    if( lr1_mac->tx_power < TX_POWER_US_915 )
+    {
+        lr1_mac->tx_power = TX_POWER_US_915;
+    }
+    if( lr1_mac->tx_data_rate_adr > 0 )
+    {
+        lr1_mac->tx_data_rate_adr--;
+    }
+    // if the datarate has no enabled channel enable all the channels
+    if( ( ( lr1_mac->tx_data_rate_adr < MAX_DR_US_915 ) &&
+          ( ( channel_index_enabled[0] | channel_index_enabled[1] ) == 0 ) ) ||
+        ( ( lr1_mac->tx_data_rate_adr == MAX_DR_US_915 ) && ( channel_index_enabled[2] == 0 ) ) )
+    {
+        channel_index_enabled[0] = 0xFFFFFFFF;
+        channel_index_enabled[1] = 0xFFFFFFFF;
+        channel_index_enabled[2] = 0xFF;
+    }
+}
+uint8_t region_us_915_adr_ack_delay_get( void )
+{
+    return ( ADR_ACK_DELAY_US_915 );
+}
+uint8_t region_us_915_adr_ack_limit_get( void )
+{
+    return ( ADR_ACK_LIMIT_US_915 );
+}
+uint8_t region_us_915_sync_word_get( void )
+{
+    return ( SYNC_WORD_US_915 );
+}
+
+status_lorawan_t region_us_915_class_b_params_get( const lr1_stack_mac_t* lr1_mac, uint32_t beacon_time_s,
+                                                   uint8_t ping_dr, smtc_real_class_b_params_t* params )
+{
+    const uint32_t beacon_period = beacon_time_s / LR1MAC_CLASS_B_BEACON_PERIOD_S;
+
+    if( ping_dr == 0xFF )
+    {
+        ping_dr = BEACON_DR_US_915;
+    }
+    if( ( ping_dr < 8 ) || ( ping_dr > 13 ) )
+    {
+        return ERRORLORAWAN;
+    }
+    params->beacon_freq_hz  = rx1_frequency_get( beacon_period % 8 );
+    params->beacon_sf       = 20 - BEACON_DR_US_915;
+    params->beacon_bw       = BW500;
+    params->beacon_rfu_size = 5;
+    params->beacon_size     = 23;
+    params->ping_freq_hz    = rx1_frequency_get( ( beacon_period + lr1_mac->dev_addr ) % 8 );
+    params->ping_sf         = 20 - ping_dr;
+    params->ping_bw         = BW500;
+    return OKLORAWAN;
+}
+
+void region_us_915_tx_frequency_channel_set( uint32_t tx_freq, uint8_t index )
+{
+    BSP_DBG_TRACE_WARNING( " Channel frequency is fixed in US_915\n" );
+}
+
+void region_us_915_rx1_frequency_channel_set( uint32_t rx_freq, uint8_t index )
+{
+    BSP_DBG_TRACE_WARNING( " Channel frequency is fixed in US_915\n" );
+}
+void region_us_915_min_dr_channel_set( uint8_t dr, uint8_t index )
+{
+    BSP_DBG_TRACE_WARNING( " Channel datarate is fixed in US_915\n" );
+}
+void region_us_915_max_dr_channel_set( uint8_t dr, uint8_t index )
+{
+    BSP_DBG_TRACE_WARNING( " Channel datarate is fixed in US_915\n" );
+}
+void region_us_915_channel_enabled_set( uint8_t enable, uint8_t index )
+{
+    if( index >= NUMBER_OF_CHANNEL_US_915 )
+    {
+        BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    else if( enable == CHANNEL_ENABLED )
+    {
+        channel_index_enabled[index / 32] |= ( 1UL << ( index % 32 ) );
+    }
+    else
+    {
+        channel_index_enabled[index / 32] &= ~( 1UL << ( index % 32 ) );
+    }
+}
+
+uint32_t region_us_915_tx_frequency_channel_get( uint8_t index )
+{
+    if( index >= NUMBER_OF_CHANNEL_US_915 )
+    {
+        BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    return ( tx_frequency_get( index ) );
+}
+uint32_t region_us_915_rx1_frequency_channel_get( uint8_t index )
+{
+    if( index >= NUMBER_OF_CHANNEL_US_915 )
+    {
+        BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
+        bsp_mcu_handle_lr1mac_issue( );
+    }
+    return ( rx1_frequency_get( index ) );
+}
+uint8_t region_us_915_min_dr_channel_get( void )
+{
+    return ( ( ( channel_index_enabled[0] | channel_index_enabled[1] ) != 0 ) ? MIN_DR_US_915 : MAX_DR_US_915 );
+}
+uint8_t region_us_915_max_dr_channel_get( void )
+{
+    return ( ( channel_index_enabled[2] != 0 ) ? MAX_DR_US_915 : ( MAX_DR_US_915 - 1 ) );
+}
+uint8_t region_us_915_channel_enabled_get( uint8_t index )
+{
+    if( index >= NUMBER_OF_CHANNEL_US_915 )
+    {
+        BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
+        bsp_mcu_handle_lr1mac_issue( );
+        return ( CHANNEL_DISABLED );
+    }
+    return ( ( ( channel_index_enabled[index / 32] >> ( index % 32 ) ) & 0x1 ) ? CHANNEL_ENABLED : CHANNEL_DISABLED );
+}
+
+/*************************************************************************/
+/*                      Private region utilities implementation          */
+/*************************************************************************/
+static void tx_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr )
+{
+    lr1_mac->tx_modulation_type = LORA;
+    if( dr < MAX_DR_US_915 )
+    {
+        lr1_mac->tx_sf = 10 - dr;
+        lr1_mac->tx_bw = BW125;
+    }
+    else if( dr == MAX_DR_US_915 )
+    {
+        lr1_mac->tx_sf = 8;
+        lr1_mac->tx_bw = BW500;
+    }
+    else
+    {
+        lr1_mac->tx_sf = 10;
+        lr1_mac->tx_bw = BW125;
+        BSP_DBG_TRACE_WARNING( " Invalid Datarate \n" );
+    }
+}
+static void rx_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr, rx_win_type_t type )
+{
+    uint8_t sf = 12;
+    if( ( dr >= 8 ) && ( dr <= 13 ) )
+    {
+        sf = 20 - dr;  // DR8 to DR13: SF12 to SF7 on 500 kHz
+    }
+    else
+    {
+        BSP_DBG_TRACE_WARNING( " Invalid Datarate \n" );
+    }
+    if( type == RX1 )
+    {
+        lr1_mac->rx1_modulation_type = LORA;
+        lr1_mac->rx1_sf              = sf;
+        lr1_mac->rx1_bw              = BW500;
+    }
+    else
+    {
+        lr1_mac->rx2_modulation_type = LORA;
+        lr1_mac->rx2_sf              = sf;
+        lr1_mac->rx2_bw              = BW500;
+    }
+}
+static uint32_t tx_frequency_get( uint8_t index )
+{
+    if( index < NUMBER_OF_CHANNEL_125_US_915 )
+    {
+        return ( 902300000 + ( index * 200000 ) );
+    }
+    return ( 903000000 + ( ( index - NUMBER_OF_CHANNEL_125_US_915 ) * 1600000 ) );
+}
+static uint32_t rx1_frequency_get( uint8_t index )
+{
+    return ( 923300000 + ( ( index % 8 ) * 600000 ) );
+}
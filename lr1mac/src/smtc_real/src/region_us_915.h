@@ -0,0 +1,367 @@
+/*!
+ * \file      region_us_915.h
+ *
+ * \brief     region_us_915 abstraction layer definition
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __REGION_US_915_H__
+#define __REGION_US_915_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "smtc_real_defs.h"
+#include "lr1mac_defs.h"
+#include "lr1_stack_mac_layer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// clang-format off
+
+#define NUMBER_OF_CHANNEL_US_915        (72)            // 64 channels of 125 kHz then 8 of 500 kHz
+#define NUMBER_OF_CHANNEL_125_US_915    (64)
+#define JOIN_ACCEPT_DELAY1_US_915       (5)             // define in seconds
+#define JOIN_ACCEPT_DELAY2_US_915       (6)             // define in seconds
+#define RECEIVE_DELAY1_US_915           (1)             // define in seconds
+#define TX_POWER_US_915                 (30)            // define in dbm
+#define ADR_ACK_LIMIT_US_915            (64)
+#define ADR_ACK_DELAY_US_915            (32)
+#define ACK_TIMEOUT_US_915              (2)             // +/- 1 s (random delay between 1 and 3 seconds)
+#define FREQMIN_US_915                  (902000000)     // Hz
+#define FREQMAX_US_915                  (928000000)     // Hz
+#define RX2_FREQ_US_915                 (923300000)     // Hz
+#define FREQUENCY_FACTOR_US_915         (100)           // MHz/100 when coded over 24 bits
+#define RX2DR_INIT_US_915               (8)
+#define SYNC_WORD_US_915                (0x34)
+#define MIN_DR_US_915                   (0)
+#define MAX_DR_US_915                   (4)             // uplink, the downlinks use DR8 to DR13
+#define BEACON_DR_US_915                (8)             // class B beacon and ping slots
+#define TIMEONAIR_JOIN_SF5_MS_915       (12)            // 371 ms at SF10 is 12 ms scaled to SF5
+
+// clang-format on
+
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_init( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_dr_distribution_set( lr1_stack_mac_t* lr1_mac, uint8_t adrMode );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_us_915_memory_load( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_bad_crc_memory_set( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_next_dr_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Set the next datarate to the fastest one of the distribution, capped by the enabled channels
+ * \remark  The datarate given by the ADR is kept in static ADR mode
+ * \param [IN]  lr1_mac                   - stack
+ * \param [IN]  dr_max                    - fastest datarate allowed
+ * \param [OUT] none
+ */
+void region_us_915_fastest_dr_get( lr1_stack_mac_t* lr1_mac, uint8_t dr_max );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_memory_save( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_us_915_max_payload_size_get( uint8_t dr );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint32_t region_us_915_decode_freq_from_buf( uint8_t freq_buf[3] );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_cflist_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_us_915_next_channel_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_us_915_join_next_channel_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_rx_config_set( lr1_stack_mac_t* lr1_mac, rx_win_type_t type );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_power_set( lr1_stack_mac_t* lr1_mac, uint8_t power_cmd );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_channel_mask_set( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_channel_mask_init( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_join_snapshot_channel_mask_init( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_channel_t region_us_915_channel_mask_build( uint8_t ChMaskCntl, uint16_t ChMask );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_dr_decrement( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_us_915_adr_ack_delay_get( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_us_915_adr_ack_limit_get( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_us_915_sync_word_get( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_us_915_is_valid_rx1_dr_offset( uint8_t rx1_dr_offset );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_us_915_is_valid_dr( uint8_t dr );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_us_915_is_acceptable_dr( uint8_t dr );  // for link adr cmd
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_us_915_is_valid_tx_frequency( uint32_t frequency );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_us_915_is_valid_rx_frequency( uint32_t frequency );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_us_915_is_valid_tx_power( uint8_t power );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_us_915_is_valid_channel_index( uint8_t channel_index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+status_lorawan_t region_us_915_is_valid_size( lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t size );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_tx_frequency_channel_set( uint32_t tx_freq, uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_rx1_frequency_channel_set( uint32_t rx_freq, uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_min_dr_channel_set( uint8_t dr, uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_max_dr_channel_set( uint8_t dr, uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+void region_us_915_channel_enabled_set( uint8_t enable, uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint32_t region_us_915_tx_frequency_channel_get( uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint32_t region_us_915_rx1_frequency_channel_get( uint8_t index );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_us_915_min_dr_channel_get( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_us_915_max_dr_channel_get( void );
+/*!
+ * \brief
+ * \remark
+ * \param [IN]  none
+ * \param [OUT] return
+ */
+uint8_t region_us_915_channel_enabled_get( uint8_t index );
+/*!
+ * \brief   Class B beacon and ping slots at DR8 by default, hopping over the 8 downlink channels
+ * \remark  The beacon channel is the beacon period modulo 8, the ping slot channel adds the DevAddr
+ * \param [IN]  lr1_mac         LoRaWAN stack
+ * \param [IN]  beacon_time_s   GPS time of the beacon
+ * \param [IN]  ping_dr         Datarate of the ping slots, 0xFF for DR8
+ * \param [OUT] params
+ * \param [OUT] return          ERRORLORAWAN if ping_dr is not a downlink datarate
+ */
+status_lorawan_t region_us_915_class_b_params_get( const lr1_stack_mac_t* lr1_mac, uint32_t beacon_time_s,
+                                                   uint8_t ping_dr, smtc_real_class_b_params_t* params );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __REGION_US_915_H__
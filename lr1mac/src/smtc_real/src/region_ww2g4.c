@@ -29,29 +29,70 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <string.h>  // memcpy
+#include <string.h>  // memcpy, memcmp
 #include "region_ww2g4.h"
+#include "smtc_real.h"
 #include "lr1_stack_mac_layer.h"
 #include "lr1mac_utilities.h"
 #include "smtc_bsp.h"
 #include "ral_defs.h"
 
-static uint32_t tx_frequency_channel[NUMBER_OF_CHANNEL_WW2G4];
-static uint32_t rx1_frequency_channel[NUMBER_OF_CHANNEL_WW2G4];
-static uint8_t  min_dr_channel[NUMBER_OF_CHANNEL_WW2G4];
-static uint8_t  max_dr_channel[NUMBER_OF_CHANNEL_WW2G4];
-static uint8_t  channel_index_enabled[NUMBER_OF_CHANNEL_WW2G4];  // Contain the index of the activated channel only
-static uint8_t  dr_distribution_init[8] = { 0 };
-static uint8_t  dr_distribution[8]      = { 0 };
-static uint32_t unwrapped_channel_mask  = 0xFFFF;
+#define NUMBER_OF_DEFAULT_CHANNEL_WW2G4 ( 3 )
+
+#define CHANNEL_FREQ_WW2G4( freq ) ( ( freq ) / FREQUENCY_FACTOR_WW2G4 )
+#define CHANNEL_HZ_WW2G4( freq ) ( ( uint32_t )( freq ) * FREQUENCY_FACTOR_WW2G4 )
+
+// Channel plan after a join, in flash. The channels above the default ones are not defined.
+static const region_ww2g4_channel_t default_channel_plan[NUMBER_OF_DEFAULT_CHANNEL_WW2G4] = {
+#if defined( PERF_TEST_ENABLED )
+    { CHANNEL_FREQ_WW2G4( 2479000000 ), 0, 7, CHANNEL_FREQ_WW2G4( 2479000000 ), 0 },
+    { CHANNEL_FREQ_WW2G4( 2479000000 ), 0, 7, CHANNEL_FREQ_WW2G4( 2479000000 ), 1 },
+    { CHANNEL_FREQ_WW2G4( 2479000000 ), 0, 7, CHANNEL_FREQ_WW2G4( 2479000000 ), 2 },
+#else
+    { CHANNEL_FREQ_WW2G4( 2403000000 ), 0, 7, CHANNEL_FREQ_WW2G4( 2403000000 ), 0 },
+    { CHANNEL_FREQ_WW2G4( 2425000000 ), 0, 7, CHANNEL_FREQ_WW2G4( 2425000000 ), 1 },
+    { CHANNEL_FREQ_WW2G4( 2479000000 ), 0, 7, CHANNEL_FREQ_WW2G4( 2479000000 ), 2 },
+#endif
+};
+static const region_ww2g4_channel_t undefined_channel = { 0, 0, 5, 0, 0 };
+
+// Datarate distributions of the fixed profiles, the user one is decoded from adr_custom
+static const uint8_t dr_distribution_all[MAX_DR_WW2G4 + 1]       = { 1, 1, 1, 1, 1, 1, 1, 1 };
+static const uint8_t dr_distribution_longrange[MAX_DR_WW2G4 + 1] = { 4, 2, 1, 0, 0, 0, 0, 0 };
+static const uint8_t dr_distribution_lowper[MAX_DR_WW2G4 + 1]    = { 0, 0, 0, 1, 0, 0, 0, 0 };
+static const uint8_t dr_distribution_slowest[MAX_DR_WW2G4 + 1]   = { 1, 0, 0, 0, 0, 0, 0, 0 };
+
+// State of a region instance, held by the smtc_real_t of the stack
+#define REGION_WW2G4_CONTEXT( lr1_mac ) ( ( region_ww2g4_context_t* ) ( lr1_mac )->real->context )
+
+// Counters are halved past this number of rated uplinks, so that the weights follow the interference
+#define CHANNEL_STATS_WINDOW_WW2G4 ( 32 )
+#define CHANNEL_WEIGHT_MAX_WW2G4   ( 64 )
+
+typedef struct session_context_ww2g4_s
+{
+    mac_session_t session;
+    uint32_t      tx_frequency_channel[NUMBER_OF_CHANNEL_WW2G4];
+    uint32_t      rx1_frequency_channel[NUMBER_OF_CHANNEL_WW2G4];
+    uint32_t      unwrapped_channel_mask;
+    uint8_t       min_dr_channel[NUMBER_OF_CHANNEL_WW2G4];
+    uint8_t       max_dr_channel[NUMBER_OF_CHANNEL_WW2G4];
+    uint8_t       channel_index_enabled[NUMBER_OF_CHANNEL_WW2G4];
+    uint32_t      crc;  // !! crc MUST be the last field of the structure !!
+} session_context_ww2g4_t;
 
 // Private region_ww2g4 utilities declaration
 //
 /*!
  *
  */
-static void tx_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr );
-static void rx2_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr );
+static void    tx_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr );
+static void    rx2_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr );
+static void    dr_channel_mask_update( region_ww2g4_context_t* ctx );
+static void    channel_get( const region_ww2g4_context_t* ctx, uint8_t index, region_ww2g4_channel_t* channel );
+static void    channel_set( region_ww2g4_context_t* ctx, uint8_t index, const region_ww2g4_channel_t* channel );
+static uint8_t channel_weight_get( const region_ww2g4_context_t* ctx, uint8_t channel_idx );
+static uint8_t channel_weighted_select( const region_ww2g4_context_t* ctx, const uint32_t* channel_mask );
 
 static mac_context_t mac_context;
 
@@ -61,36 +102,13 @@ static mac_context_t mac_context;
 
 void region_ww2g4_init( lr1_stack_mac_t* lr1_mac )
 {
-    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
-    {
-        tx_frequency_channel[i]  = 0;
-        rx1_frequency_channel[i] = 0;
-        channel_index_enabled[i] = CHANNEL_DISABLED;
-        min_dr_channel[i]        = 0;
-        max_dr_channel[i]        = 5;
-    }
-    // enable the 3 defaults channels
-    channel_index_enabled[0] = CHANNEL_ENABLED;
-    channel_index_enabled[1] = CHANNEL_ENABLED;
-    channel_index_enabled[2] = CHANNEL_ENABLED;
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
 
-    memset( min_dr_channel, 0, 3 );
-    memset( max_dr_channel, 7, 3 );
-#if defined( PERF_TEST_ENABLED )
-    tx_frequency_channel[0]  = 2479000000;
-    tx_frequency_channel[1]  = 2479000000;
-    tx_frequency_channel[2]  = 2479000000;
-    rx1_frequency_channel[0] = 2479000000;
-    rx1_frequency_channel[1] = 2479000000;
-    rx1_frequency_channel[2] = 2479000000;
-#else
-    tx_frequency_channel[0]  = 2403000000;
-    tx_frequency_channel[1]  = 2425000000;
-    tx_frequency_channel[2]  = 2479000000;
-    rx1_frequency_channel[0] = 2403000000;
-    rx1_frequency_channel[1] = 2425000000;
-    rx1_frequency_channel[2] = 2479000000;
-#endif
+    // back to the default channel plan, enable the 3 defaults channels
+    ctx->channel_overlay_nb = 0;
+    memset( ctx->channel_index_enabled, CHANNEL_DISABLED, NUMBER_OF_CHANNEL_WW2G4 );
+    memset( ctx->channel_index_enabled, CHANNEL_ENABLED, NUMBER_OF_DEFAULT_CHANNEL_WW2G4 );
+    ctx->is_dr_channel_mask_valid = false;
 
     lr1_mac->rx2_frequency    = RX2_FREQ_WW2G4;
     lr1_mac->tx_power         = TX_POWER_WW2G4;
@@ -99,7 +117,7 @@ void region_ww2g4_init( lr1_stack_mac_t* lr1_mac )
     lr1_mac->rx1_delay_s      = RECEIVE_DELAY1_WW2G4;
     lr1_mac->tx_data_rate_adr = 0;
     lr1_mac->adr_custom       = BSP_USER_DR_DISTRIBUTION_PARAMETERS;
-    memset( dr_distribution_init, 1, 8 );
+    ctx->dr_distribution_init = dr_distribution_all;
 }
 
 status_lorawan_t region_ww2g4_is_valid_rx1_dr_offset( uint8_t rx1_dr_offset )
@@ -124,14 +142,18 @@ status_lorawan_t region_ww2g4_is_valid_dr( uint8_t dr )
     return ( status );
 }
 
-status_lorawan_t region_ww2g4_is_acceptable_dr( uint8_t dr )
+status_lorawan_t region_ww2g4_is_acceptable_dr( const lr1_stack_mac_t* lr1_mac, uint8_t dr )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     status_lorawan_t status = ERRORLORAWAN;
     for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
     {
-        if( ( ( unwrapped_channel_mask >> i ) & 0x1 ) == 1 )
+        if( ( ( ctx->unwrapped_channel_mask >> i ) & 0x1 ) == 1 )
         {
-            if( ( dr >= min_dr_channel[i] ) && ( dr <= max_dr_channel[i] ) )
+            region_ww2g4_channel_t channel;
+            channel_get( ctx, i, &channel );
+            if( ( dr >= channel.min_dr ) && ( dr <= channel.max_dr ) )
             {
                 return ( OKLORAWAN );
             }
@@ -203,7 +225,8 @@ status_lorawan_t region_ww2g4_is_valid_size( lr1_stack_mac_t* lr1_mac, uint8_t d
 
 status_lorawan_t region_ww2g4_memory_load( lr1_stack_mac_t* lr1_mac )
 {
-    bsp_nvm_context_restore( BSP_LORAWAN_CONTEXT_ADDR_OFFSET, ( uint8_t* ) &( mac_context ), sizeof( mac_context ) );
+    bsp_nvm_context_restore( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &( mac_context ),
+                             sizeof( mac_context ) );
 
     if( lr1mac_utilities_crc( ( uint8_t* ) &mac_context, sizeof( mac_context ) - 4 ) == mac_context.crc )
     {
@@ -214,6 +237,7 @@ status_lorawan_t region_ww2g4_memory_load( lr1_stack_mac_t* lr1_mac )
         lr1_mac->adr_custom  = mac_context.adr_custom;
         lr1_mac->nb_of_reset = mac_context.nb_reset + 1;  // @todo move increment in mcu_reset api and remove all nvic
         lr1_mac->real->region_type = ( smtc_real_region_types_t ) mac_context.region_type;
+        lr1_mac->dev_nonce_reserved = mac_context.devnonce;
         region_ww2g4_memory_save( lr1_mac );  // to save new number of reset
         BSP_DBG_TRACE_PRINTF( " DevNonce = 0x%x ", lr1_mac->dev_nonce );
         BSP_DBG_TRACE_PRINTF( ", NbOfReset = %d \n", lr1_mac->nb_of_reset );
@@ -222,7 +246,7 @@ status_lorawan_t region_ww2g4_memory_load( lr1_stack_mac_t* lr1_mac )
     }
     else  // start with "in rescue eeprom mode"
     {
-        bsp_nvm_context_restore( BSP_LORAWAN_CONTEXT_ADDR_OFFSET + sizeof( mac_context ) + 4,
+        bsp_nvm_context_restore( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ) + sizeof( mac_context ) + 4,
                                  ( uint8_t* ) &( mac_context ), sizeof( mac_context ) );
 
         if( lr1mac_utilities_crc( ( uint8_t* ) &mac_context, sizeof( mac_context ) - 4 ) == mac_context.crc )
@@ -234,6 +258,7 @@ status_lorawan_t region_ww2g4_memory_load( lr1_stack_mac_t* lr1_mac )
             lr1_mac->adr_custom  = mac_context.adr_custom;
             lr1_mac->nb_of_reset = mac_context.nb_reset;  // @todo move increment in mcu_reset api and remove all nvic
             lr1_mac->real->region_type = ( smtc_real_region_types_t ) mac_context.region_type;
+            lr1_mac->dev_nonce_reserved = mac_context.devnonce;
             region_ww2g4_memory_save( lr1_mac );  // to save new number of reset
             BSP_DBG_TRACE_PRINTF( "\n start on rescue eeprom , DevNonce = 0x%x ", lr1_mac->dev_nonce );
             BSP_DBG_TRACE_PRINTF( "\n start on rescue eeprom , NbOfReset = %d ", lr1_mac->nb_of_reset );
@@ -248,7 +273,7 @@ status_lorawan_t region_ww2g4_memory_load( lr1_stack_mac_t* lr1_mac )
 }
 void region_ww2g4_bad_crc_memory_set( lr1_stack_mac_t* lr1_mac )
 {
-    mac_context.devnonce    = lr1_mac->dev_nonce;
+    mac_context.devnonce    = lr1_mac->dev_nonce_reserved;
     mac_context.adr_custom  = lr1_mac->adr_custom;
     mac_context.nb_reset    = lr1_mac->nb_of_reset;
     mac_context.region_type = lr1_mac->real->region_type;
@@ -256,17 +281,18 @@ void region_ww2g4_bad_crc_memory_set( lr1_stack_mac_t* lr1_mac )
     memcpy( mac_context.deveui, lr1_mac->dev_eui, 8 );
     memcpy( mac_context.appkey, lr1_mac->app_key, 16 );
     mac_context.crc = lr1mac_utilities_crc( ( uint8_t* ) &mac_context, sizeof( mac_context ) - 4 ) + 1;
-    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR_OFFSET, ( uint8_t* ) &( mac_context ), sizeof( mac_context ) );
+    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &( mac_context ),
+                           sizeof( mac_context ) );
 
     bsp_mcu_wait_us( 10000 );
 
-    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR_OFFSET + sizeof( mac_context ) + 4, ( uint8_t* ) &( mac_context ),
-                           sizeof( mac_context ) );
+    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ) + sizeof( mac_context ) + 4,
+                           ( uint8_t* ) &( mac_context ), sizeof( mac_context ) );
     bsp_mcu_wait_us( 10000 );
 }
 void region_ww2g4_memory_save( lr1_stack_mac_t* lr1_mac )
 {
-    mac_context.devnonce    = lr1_mac->dev_nonce;
+    mac_context.devnonce    = lr1_mac->dev_nonce_reserved;
     mac_context.adr_custom  = lr1_mac->adr_custom;
     mac_context.nb_reset    = lr1_mac->nb_of_reset;
     mac_context.region_type = lr1_mac->real->region_type;
@@ -274,76 +300,157 @@ void region_ww2g4_memory_save( lr1_stack_mac_t* lr1_mac )
     memcpy( mac_context.deveui, lr1_mac->dev_eui, 8 );
     memcpy( mac_context.appkey, lr1_mac->app_key, 16 );
     mac_context.crc = lr1mac_utilities_crc( ( uint8_t* ) &mac_context, sizeof( mac_context ) - 4 );
-    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR_OFFSET, ( uint8_t* ) &( mac_context ), sizeof( mac_context ) );
+    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &( mac_context ),
+                           sizeof( mac_context ) );
 
     bsp_mcu_wait_us( 10000 );
 
-    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR_OFFSET + sizeof( mac_context ) + 4, ( uint8_t* ) &( mac_context ),
-                           sizeof( mac_context ) );
+    bsp_nvm_context_store( BSP_LORAWAN_CONTEXT_ADDR( lr1_mac->stack_id ) + sizeof( mac_context ) + 4,
+                           ( uint8_t* ) &( mac_context ), sizeof( mac_context ) );
     bsp_mcu_wait_us( 10000 );
 }
+void region_ww2g4_session_save( lr1_stack_mac_t* lr1_mac )
+{
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
+    session_context_ww2g4_t session_context;
+
+    memset( &session_context, 0, sizeof( session_context ) );  // padding included, it is under the crc
+    session_context.session.dev_addr         = lr1_mac->dev_addr;
+    session_context.session.fcnt_up          = lr1_mac->fcnt_up;
+    session_context.session.fcnt_dwn         = lr1_mac->fcnt_dwn;
+    session_context.session.rx2_frequency    = lr1_mac->rx2_frequency;
+    session_context.session.rx2_data_rate    = lr1_mac->rx2_data_rate;
+    session_context.session.rx1_dr_offset    = lr1_mac->rx1_dr_offset;
+    session_context.session.rx1_delay_s      = lr1_mac->rx1_delay_s;
+    session_context.session.tx_data_rate_adr = lr1_mac->tx_data_rate_adr;
+    session_context.session.tx_power         = lr1_mac->tx_power;
+    session_context.session.max_eirp_dbm     = lr1_mac->max_eirp_dbm;
+    session_context.session.nb_trans         = lr1_mac->nb_trans;
+    session_context.session.region_type      = lr1_mac->real->region_type;
+    session_context.session.otaa_device      = lr1_mac->otaa_device;
+    session_context.unwrapped_channel_mask   = ctx->unwrapped_channel_mask;
+    memcpy( session_context.session.nwk_skey, lr1_mac->nwk_skey, 16 );
+    memcpy( session_context.session.app_skey, lr1_mac->app_skey, 16 );
+    // the saved session keeps the whole channel plan, it stays readable by the former firmwares
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
+    {
+        region_ww2g4_channel_t channel;
+        channel_get( ctx, i, &channel );
+        session_context.tx_frequency_channel[i]  = CHANNEL_HZ_WW2G4( channel.tx_frequency );
+        session_context.rx1_frequency_channel[i] = CHANNEL_HZ_WW2G4( channel.rx1_frequency );
+        session_context.min_dr_channel[i]        = channel.min_dr;
+        session_context.max_dr_channel[i]        = channel.max_dr;
+    }
+    memcpy( session_context.channel_index_enabled, ctx->channel_index_enabled, sizeof( ctx->channel_index_enabled ) );
+    session_context.crc = lr1mac_utilities_crc( ( uint8_t* ) &session_context, sizeof( session_context ) - 4 );
+    bsp_nvm_context_store( BSP_LORAWAN_SESSION_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &session_context,
+                           sizeof( session_context ) );
+}
+
+status_lorawan_t region_ww2g4_session_load( lr1_stack_mac_t* lr1_mac )
+{
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
+    session_context_ww2g4_t session_context;
+
+    bsp_nvm_context_restore( BSP_LORAWAN_SESSION_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &session_context,
+                             sizeof( session_context ) );
+    if( ( lr1mac_utilities_crc( ( uint8_t* ) &session_context, sizeof( session_context ) - 4 ) !=
+          session_context.crc ) ||
+        ( session_context.session.region_type != lr1_mac->real->region_type ) ||
+        ( session_context.session.otaa_device != lr1_mac->otaa_device ) )
+    {
+        return ERRORLORAWAN;
+    }
+    if( ( lr1_mac->otaa_device == ABP_DEVICE ) &&
+        ( ( session_context.session.dev_addr != lr1_mac->dev_addr ) ||
+          ( memcmp( session_context.session.nwk_skey, lr1_mac->nwk_skey, 16 ) != 0 ) ||
+          ( memcmp( session_context.session.app_skey, lr1_mac->app_skey, 16 ) != 0 ) ) )
+    {  // the ABP session is given by the keys, only its state is restored
+        return ERRORLORAWAN;
+    }
+
+    lr1_mac->dev_addr         = session_context.session.dev_addr;
+    lr1_mac->fcnt_up          = session_context.session.fcnt_up;
+    lr1_mac->fcnt_dwn         = session_context.session.fcnt_dwn;
+    lr1_mac->rx2_frequency    = session_context.session.rx2_frequency;
+    lr1_mac->rx2_data_rate    = session_context.session.rx2_data_rate;
+    lr1_mac->rx1_dr_offset    = session_context.session.rx1_dr_offset;
+    lr1_mac->rx1_delay_s      = session_context.session.rx1_delay_s;
+    lr1_mac->tx_data_rate_adr = session_context.session.tx_data_rate_adr;
+    lr1_mac->tx_power         = session_context.session.tx_power;
+    lr1_mac->max_eirp_dbm     = session_context.session.max_eirp_dbm;
+    lr1_mac->nb_trans         = session_context.session.nb_trans;
+    memcpy( lr1_mac->nwk_skey, session_context.session.nwk_skey, 16 );
+    memcpy( lr1_mac->app_skey, session_context.session.app_skey, 16 );
+    ctx->unwrapped_channel_mask = session_context.unwrapped_channel_mask;
+    ctx->channel_overlay_nb     = 0;
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
+    {
+        const region_ww2g4_channel_t channel = {
+            .tx_frequency  = CHANNEL_FREQ_WW2G4( session_context.tx_frequency_channel[i] ),
+            .min_dr        = session_context.min_dr_channel[i],
+            .max_dr        = session_context.max_dr_channel[i],
+            .rx1_frequency = CHANNEL_FREQ_WW2G4( session_context.rx1_frequency_channel[i] ),
+        };
+        channel_set( ctx, i, &channel );
+    }
+    memcpy( ctx->channel_index_enabled, session_context.channel_index_enabled, sizeof( ctx->channel_index_enabled ) );
+    ctx->is_dr_channel_mask_valid = false;
+
+    BSP_DBG_TRACE_PRINTF( " Session restored, DevAddr = %lx\n", lr1_mac->dev_addr );
+    return OKLORAWAN;
+}
+
+void region_ww2g4_session_erase( const lr1_stack_mac_t* lr1_mac )
+{
+    session_context_ww2g4_t session_context;
+
+    bsp_nvm_context_restore( BSP_LORAWAN_SESSION_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &session_context,
+                             sizeof( session_context ) );
+    if( lr1mac_utilities_crc( ( uint8_t* ) &session_context, sizeof( session_context ) - 4 ) != session_context.crc )
+    {  // already invalid, called at each boot without session: spare the nvm
+        return;
+    }
+    memset( &session_context, 0, sizeof( session_context ) );
+    session_context.crc = lr1mac_utilities_crc( ( uint8_t* ) &session_context, sizeof( session_context ) - 4 ) + 1;
+    bsp_nvm_context_store( BSP_LORAWAN_SESSION_ADDR( lr1_mac->stack_id ), ( uint8_t* ) &session_context,
+                           sizeof( session_context ) );
+}
+
 void region_ww2g4_dr_distribution_set( lr1_stack_mac_t* lr1_mac, uint8_t adr_mode )
 {
-    memset( dr_distribution_init, 0, 8 );
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     switch( adr_mode )
     {
     case MOBILE_LONGRANGE_DR_DISTRIBUTION:  // in this example 4/7 dr0 2/7 dr1 and 1/7 dr2
-        dr_distribution_init[7] = 0;
-        dr_distribution_init[6] = 0;
-        dr_distribution_init[5] = 0;
-        dr_distribution_init[4] = 0;
-        dr_distribution_init[3] = 0;
-        dr_distribution_init[2] = 1;
-        dr_distribution_init[1] = 2;
-        dr_distribution_init[0] = 4;
-        lr1_mac->nb_trans       = 1;
+        ctx->dr_distribution_init = dr_distribution_longrange;
+        lr1_mac->nb_trans    = 1;
         break;
-    case MOBILE_LOWPER_DR_DISTRIBUTION:  // in this example 5/10 dr5 4/10 dr4 and 1/10 dr0
-        dr_distribution_init[7] = 0;
-        dr_distribution_init[6] = 0;
-        dr_distribution_init[5] = 0;
-        dr_distribution_init[4] = 0;
-        dr_distribution_init[3] = 1;
-        dr_distribution_init[2] = 0;
-        dr_distribution_init[1] = 0;
-        dr_distribution_init[0] = 0;
-        lr1_mac->nb_trans       = 1;
+    case MOBILE_LOWPER_DR_DISTRIBUTION:  // in this example dr3 only
+        ctx->dr_distribution_init = dr_distribution_lowper;
+        lr1_mac->nb_trans    = 1;
         break;
-    case JOIN_DR_DISTRIBUTION:  // in this example 1/3 dr5 1/3 dr4 and 1/3 dr0
-        dr_distribution_init[7] = 0;
-        dr_distribution_init[6] = 0;
-        dr_distribution_init[5] = 0;
-        dr_distribution_init[4] = 0;
-        dr_distribution_init[3] = 0;
-        dr_distribution_init[2] = 0;
-        dr_distribution_init[1] = 0;
-        dr_distribution_init[0] = 1;
-        lr1_mac->nb_trans       = 1;
+    case JOIN_DR_DISTRIBUTION:  // in this example dr0 only
+        ctx->dr_distribution_init = dr_distribution_slowest;
+        lr1_mac->nb_trans    = 1;
         break;
-    case USER_DR_DISTRIBUTION:  // in this example 1/3 dr5 1/3 dr4 and 1/3 dr0
-        dr_distribution_init[7] = ( ( lr1_mac->adr_custom ) & ( 0x0000000F ) );
-        dr_distribution_init[6] = ( ( lr1_mac->adr_custom ) & ( 0x000000F0 ) ) >> 4;
-        dr_distribution_init[5] = ( ( lr1_mac->adr_custom ) & ( 0x00000F00 ) ) >> 8;
-        dr_distribution_init[4] = ( ( lr1_mac->adr_custom ) & ( 0x0000F000 ) ) >> 12;
-        dr_distribution_init[3] = ( ( lr1_mac->adr_custom ) & ( 0x000F0000 ) ) >> 16;
-        dr_distribution_init[2] = ( ( lr1_mac->adr_custom ) & ( 0x00F00000 ) ) >> 20;
-        dr_distribution_init[1] = ( ( lr1_mac->adr_custom ) & ( 0x0F000000 ) ) >> 24;
-        dr_distribution_init[0] = ( ( lr1_mac->adr_custom ) & ( 0xF0000000 ) ) >> 28;
-        lr1_mac->nb_trans       = BSP_USER_NUMBER_OF_RETRANSMISSION;
+    case USER_DR_DISTRIBUTION:  // one nibble per datarate, dr0 in the most significant one
+        for( uint8_t dr = 0; dr <= MAX_DR_WW2G4; dr++ )
+        {
+            ctx->dr_distribution_user[dr] = ( lr1_mac->adr_custom >> ( 28 - ( 4 * dr ) ) ) & 0x0F;
+        }
+        ctx->dr_distribution_init = ctx->dr_distribution_user;
+        lr1_mac->nb_trans    = BSP_USER_NUMBER_OF_RETRANSMISSION;
         break;
     default:
-        dr_distribution_init[0] = 1;
-        dr_distribution_init[1] = 0;
-        dr_distribution_init[2] = 0;
-        dr_distribution_init[3] = 0;
-        dr_distribution_init[4] = 0;
-        dr_distribution_init[5] = 0;
-        dr_distribution_init[6] = 0;
-        dr_distribution_init[7] = 0;
-        lr1_mac->nb_trans       = 1;
+        ctx->dr_distribution_init = dr_distribution_slowest;
+        lr1_mac->nb_trans    = 1;
         break;
     }
-    memcpy( dr_distribution, dr_distribution_init, 8 );
+    memcpy( ctx->dr_distribution, ctx->dr_distribution_init, 8 );
 }
 status_lorawan_t region_ww2g4_join_next_channel_get( lr1_stack_mac_t* lr1_mac )
 {
@@ -352,25 +459,35 @@ status_lorawan_t region_ww2g4_join_next_channel_get( lr1_stack_mac_t* lr1_mac )
 
 status_lorawan_t region_ww2g4_next_channel_get( lr1_stack_mac_t* lr1_mac )
 {
-    uint8_t active_channel_nb = 0;
-    uint8_t active_channel_index[NUMBER_OF_CHANNEL_WW2G4];
-    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
+    if( lr1_mac->tx_data_rate_adr > MAX_DR_WW2G4 )
     {
-        if( ( channel_index_enabled[i] == CHANNEL_ENABLED ) && ( min_dr_channel[i] <= lr1_mac->tx_data_rate_adr ) &&
-            ( max_dr_channel[i] >= lr1_mac->tx_data_rate_adr ) )
-        {
-            active_channel_index[active_channel_nb] = i;
-            active_channel_nb++;
-        }
+        BSP_DBG_TRACE_WARNING( "NO CHANNELS AVAILABLE \n" );
+        return ERRORLORAWAN;
     }
+    if( ctx->is_dr_channel_mask_valid == false )
+    {
+        dr_channel_mask_update( ctx );
+    }
+    const uint32_t* channel_mask      = ctx->dr_channel_mask[lr1_mac->tx_data_rate_adr];
+    uint8_t         active_channel_nb = lr1mac_utilities_channel_mask_count( channel_mask, CHANNEL_MASK_WORDS_WW2G4 );
     if( active_channel_nb == 0 )
     {
         BSP_DBG_TRACE_WARNING( "NO CHANNELS AVAILABLE \n" );
         return ERRORLORAWAN;
     }
-    uint8_t temp        = ( bsp_rng_get_random_in_range( 0, ( active_channel_nb - 1 ) ) ) % active_channel_nb;
-    uint8_t channel_idx = 0;
-    channel_idx         = active_channel_index[temp];
+    uint8_t temp = 0;
+    uint8_t channel_idx;
+    if( ctx->is_weighted_channel_selection == true )
+    {
+        channel_idx = channel_weighted_select( ctx, channel_mask );
+    }
+    else
+    {
+        temp        = ( bsp_rng_get_random_in_range( 0, ( active_channel_nb - 1 ) ) ) % active_channel_nb;
+        channel_idx = lr1mac_utilities_channel_mask_select( channel_mask, CHANNEL_MASK_WORDS_WW2G4, temp );
+    }
     if( channel_idx >= NUMBER_OF_CHANNEL_WW2G4 )
     {
         BSP_DBG_TRACE_PRINTF( "INVALID CHANNEL  active channel = %d and random channel = %d \n", active_channel_nb,
@@ -379,44 +496,60 @@ status_lorawan_t region_ww2g4_next_channel_get( lr1_stack_mac_t* lr1_mac )
     }
     else
     {
-        lr1_mac->tx_frequency  = tx_frequency_channel[channel_idx];
-        lr1_mac->rx1_frequency = rx1_frequency_channel[channel_idx];
+        region_ww2g4_channel_t channel;
+        channel_get( ctx, channel_idx, &channel );
+        lr1_mac->tx_frequency  = CHANNEL_HZ_WW2G4( channel.tx_frequency );
+        lr1_mac->rx1_frequency = CHANNEL_HZ_WW2G4( channel.rx1_frequency );
+        ctx->last_channel_idx  = channel_idx;
     }
     return OKLORAWAN;
 }
 
 void region_ww2g4_next_dr_get( lr1_stack_mac_t* lr1_mac )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     if( lr1_mac->adr_mode_select == STATIC_ADR_MODE )
     {
         lr1_mac->tx_data_rate = lr1_mac->tx_data_rate_adr;
         lr1_mac->adr_enable   = 1;
     }
+    else if( lr1_mac->adr_mode_select == LINK_MARGIN_ADR_MODE )
+    {
+        lr1_stack_mac_link_margin_adr( lr1_mac );
+        lr1_mac->tx_data_rate = lr1_mac->tx_data_rate_adr;
+        lr1_mac->adr_enable   = 0;
+    }
     else
     {
-        uint8_t distri_sum = 0;
-        for( uint8_t i = 0; i < 8; i++ )
-        {
-            distri_sum += dr_distribution[i];
-        }
-        if( distri_sum == 0 )
-        {
-            memcpy( dr_distribution, dr_distribution_init, 8 );
-        }
-        uint8_t new_dr;
-        do
-        {
-            new_dr = ( bsp_rng_get_random_in_range( MIN_DR_WW2G4, MAX_DR_WW2G4 ) % ( MAX_DR_WW2G4 + 1 ) );
-        } while( dr_distribution[new_dr] == 0 );
-
-        lr1_mac->tx_data_rate = new_dr;
-        dr_distribution[new_dr]--;
+        // an empty profile keeps the current datarate
+        smtc_real_dr_distribution_draw( ctx->dr_distribution, ctx->dr_distribution_init, MAX_DR_WW2G4 + 1,
+                                        &lr1_mac->tx_data_rate );
         lr1_mac->adr_enable = 0;
     }
     lr1_mac->tx_data_rate = ( lr1_mac->tx_data_rate > MAX_DR_WW2G4 ) ? MAX_DR_WW2G4 : lr1_mac->tx_data_rate;
     tx_dr_to_sf_bw( lr1_mac, lr1_mac->tx_data_rate );
 }
 
+void region_ww2g4_fastest_dr_get( lr1_stack_mac_t* lr1_mac, uint8_t dr_max )
+{
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
+    if( ( lr1_mac->adr_mode_select == STATIC_ADR_MODE ) || ( lr1_mac->adr_mode_select == LINK_MARGIN_ADR_MODE ) )
+    {
+        return;
+    }
+    for( int8_t dr = MIN( MAX_DR_WW2G4, dr_max ); dr >= 0; dr-- )
+    {
+        if( ctx->dr_distribution_init[dr] > 0 )
+        {
+            lr1_mac->tx_data_rate = MIN( ( uint8_t ) dr, region_ww2g4_max_dr_channel_get( lr1_mac ) );
+            break;
+        }
+    }
+    tx_dr_to_sf_bw( lr1_mac, lr1_mac->tx_data_rate );
+}
+
 uint8_t region_ww2g4_max_payload_size_get( uint8_t dr )
 {
     uint8_t M[8] = { 59, 123, 228, 228, 228, 228, 228, 228 };
@@ -432,33 +565,36 @@ uint32_t region_ww2g4_decode_freq_from_buf( uint8_t freq_buf[3] )
 
 void region_ww2g4_cflist_get( lr1_stack_mac_t* lr1_mac )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     if( lr1_mac->cf_list[15] == CF_LIST_FREQ )
     {
         for( uint8_t i = 0; i < 5; i++ )
         {
-            tx_frequency_channel[3 + i]  = region_ww2g4_decode_freq_from_buf( &lr1_mac->cf_list[0 + ( 3 * i )] );
-            rx1_frequency_channel[3 + i] = tx_frequency_channel[3 + i];
+            const uint32_t         frequency = region_ww2g4_decode_freq_from_buf( &lr1_mac->cf_list[0 + ( 3 * i )] );
+            region_ww2g4_channel_t channel   = undefined_channel;
 
-            if( region_ww2g4_is_valid_tx_frequency( tx_frequency_channel[3 + i] ) == OKLORAWAN &&
-                tx_frequency_channel[3 + i] != 0 )
+            if( region_ww2g4_is_valid_tx_frequency( frequency ) == OKLORAWAN && frequency != 0 )
             {
-                min_dr_channel[3 + i]        = 0;
-                max_dr_channel[3 + i]        = 5;
-                channel_index_enabled[3 + i] = CHANNEL_ENABLED;
-                BSP_DBG_TRACE_PRINTF( " MacTxFrequency [%d] = %lu \n", i, tx_frequency_channel[3 + i] );
-                BSP_DBG_TRACE_PRINTF( " MacMinDataRateChannel [%d] = %u \n", i, min_dr_channel[3 + i] );
-                BSP_DBG_TRACE_PRINTF( " MacMaxDataRateChannel [%d] = %u \n", i, max_dr_channel[3 + i] );
-                BSP_DBG_TRACE_PRINTF( " MacChannelIndexEnabled [%d] = %u \n", i, channel_index_enabled[3 + i] );
+                channel.tx_frequency         = CHANNEL_FREQ_WW2G4( frequency );
+                channel.rx1_frequency        = channel.tx_frequency;
+                channel.min_dr               = 0;
+                channel.max_dr               = 5;
+                ctx->channel_index_enabled[3 + i] = CHANNEL_ENABLED;
+                BSP_DBG_TRACE_PRINTF( " MacTxFrequency [%d] = %lu \n", i, frequency );
+                BSP_DBG_TRACE_PRINTF( " MacMinDataRateChannel [%d] = %u \n", i, channel.min_dr );
+                BSP_DBG_TRACE_PRINTF( " MacMaxDataRateChannel [%d] = %u \n", i, channel.max_dr );
+                BSP_DBG_TRACE_PRINTF( " MacChannelIndexEnabled [%d] = %u \n", i, ctx->channel_index_enabled[3 + i] );
             }
             else
             {
-                tx_frequency_channel[3 + i]  = 0;
-                rx1_frequency_channel[3 + i] = 0;
-                channel_index_enabled[3 + i] = CHANNEL_DISABLED;
+                ctx->channel_index_enabled[3 + i] = CHANNEL_DISABLED;
 
                 BSP_DBG_TRACE_WARNING( "INVALID TX FREQUENCY IN CFLIST OR CFLIST EMPTY \n" );
             }
+            channel_set( ctx, 3 + i, &channel );
         }
+        ctx->is_dr_channel_mask_valid = false;
     }
     else
     {
@@ -497,16 +633,21 @@ void region_ww2g4_power_set( lr1_stack_mac_t* lr1_mac, uint8_t power_cmd )
 }
 void region_ww2g4_channel_mask_set( lr1_stack_mac_t* lr1_mac )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
     {
-        channel_index_enabled[i] = ( unwrapped_channel_mask >> i ) & 0x1;
-        BSP_DBG_TRACE_PRINTF( " %d ", channel_index_enabled[i] );
+        ctx->channel_index_enabled[i] = ( ctx->unwrapped_channel_mask >> i ) & 0x1;
+        BSP_DBG_TRACE_PRINTF( " %d ", ctx->channel_index_enabled[i] );
     }
+    ctx->is_dr_channel_mask_valid = false;
     BSP_DBG_TRACE_MSG( " \n" );
 }
-void region_ww2g4_channel_mask_init( void )
+void region_ww2g4_channel_mask_init( const lr1_stack_mac_t* lr1_mac )
 {
-    unwrapped_channel_mask = 0xFFFF;
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
+    ctx->unwrapped_channel_mask = 0xFFFF;
 }
 
 void region_ww2g4_join_snapshot_channel_mask_init( void )
@@ -515,30 +656,35 @@ void region_ww2g4_join_snapshot_channel_mask_init( void )
     return;
 }
 
-status_channel_t region_ww2g4_channel_mask_build( uint8_t channel_mask_cntl, uint16_t channel_mask )
+status_channel_t region_ww2g4_channel_mask_build( const lr1_stack_mac_t* lr1_mac, uint8_t channel_mask_cntl,
+                                                  uint16_t channel_mask )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     status_channel_t status = OKCHANNEL;
     switch( channel_mask_cntl )
     {
     case 0:
-        unwrapped_channel_mask = 0xFFFF;
-        unwrapped_channel_mask = unwrapped_channel_mask & channel_mask;
-        BSP_DBG_TRACE_PRINTF( "UnwrappedChannelMask = 0x%lx, ChMask = 0x%x\n", unwrapped_channel_mask, channel_mask );
+        ctx->unwrapped_channel_mask = 0xFFFF;
+        ctx->unwrapped_channel_mask = ctx->unwrapped_channel_mask & channel_mask;
+        BSP_DBG_TRACE_PRINTF( "UnwrappedChannelMask = 0x%lx, ChMask = 0x%x\n", ctx->unwrapped_channel_mask,
+                              channel_mask );
         for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
         {
-            if( ( ( ( unwrapped_channel_mask >> i ) & 0x1 ) == 1 ) && ( tx_frequency_channel[i] == 0 ) )
+            if( ( ( ( ctx->unwrapped_channel_mask >> i ) & 0x1 ) == 1 ) &&
+                ( region_ww2g4_tx_frequency_channel_get( lr1_mac, i ) == 0 ) )
             {
                 status = ERROR_CHANNEL_MASK;  // this status is used only for the last multiple link adr req
             }
         }
         break;
     case 6:
-        unwrapped_channel_mask = 0;
+        ctx->unwrapped_channel_mask = 0;
         for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
         {
-            if( tx_frequency_channel[i] > 0 )
+            if( region_ww2g4_tx_frequency_channel_get( lr1_mac, i ) > 0 )
             {
-                unwrapped_channel_mask = unwrapped_channel_mask ^ ( 1 << i );
+                ctx->unwrapped_channel_mask = ctx->unwrapped_channel_mask ^ ( 1 << i );
             }
         }
         break;
@@ -546,7 +692,7 @@ status_channel_t region_ww2g4_channel_mask_build( uint8_t channel_mask_cntl, uin
         status = ERROR_CHANNEL_CNTL;
         break;
     }
-    if( unwrapped_channel_mask == 0 )
+    if( ctx->unwrapped_channel_mask == 0 )
     {
         status = ERROR_CHANNEL_MASK;
     }
@@ -555,6 +701,8 @@ status_channel_t region_ww2g4_channel_mask_build( uint8_t channel_mask_cntl, uin
 
 void region_ww2g4_dr_decrement( lr1_stack_mac_t* lr1_mac )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     uint8_t valid_temp = 0;
     if( lr1_mac->tx_power < TX_POWER_WW2G4 )
     {
@@ -565,10 +713,12 @@ void region_ww2g4_dr_decrement( lr1_stack_mac_t* lr1_mac )
         lr1_mac->tx_data_rate_adr--;
         for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
         {
-            if( channel_index_enabled[i] == CHANNEL_ENABLED )
+            if( ctx->channel_index_enabled[i] == CHANNEL_ENABLED )
             {
-                if( ( lr1_mac->tx_data_rate_adr <= max_dr_channel[i] ) &&
-                    ( lr1_mac->tx_data_rate_adr >= min_dr_channel[i] ) )
+                region_ww2g4_channel_t channel;
+                channel_get( ctx, i, &channel );
+                if( ( lr1_mac->tx_data_rate_adr <= channel.max_dr ) &&
+                    ( lr1_mac->tx_data_rate_adr >= channel.min_dr ) )
                 {
                     valid_temp++;
                 }
@@ -583,13 +733,17 @@ void region_ww2g4_dr_decrement( lr1_stack_mac_t* lr1_mac )
     // reach this step only if tx_dr = 0 and valid temp = 0 => enable default channel
     for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
     {
-        if( tx_frequency_channel[i] != 0 && channel_index_enabled[i] == CHANNEL_DISABLED )
+        region_ww2g4_channel_t channel;
+        channel_get( ctx, i, &channel );
+        if( channel.tx_frequency != 0 && ctx->channel_index_enabled[i] == CHANNEL_DISABLED )
         {
-            channel_index_enabled[i] = CHANNEL_ENABLED;
-            min_dr_channel[i]        = 0;
-            max_dr_channel[i]        = 5;
+            ctx->channel_index_enabled[i] = CHANNEL_ENABLED;
+            channel.min_dr           = 0;
+            channel.max_dr           = 5;
+            channel_set( ctx, i, &channel );
         }
     }
+    ctx->is_dr_channel_mask_valid = false;
 }
 uint8_t region_ww2g4_adr_ack_delay_get( void )
 {
@@ -604,8 +758,31 @@ uint8_t region_ww2g4_sync_word_get( void )
     return ( SYNC_WORD_WW2G4 );
 }
 
-void region_ww2g4_tx_frequency_channel_set( uint32_t tx_freq, uint8_t index )
+status_lorawan_t region_ww2g4_class_b_params_get( uint8_t ping_dr, smtc_real_class_b_params_t* params )
 {
+    if( ping_dr == 0xFF )
+    {
+        ping_dr = BEACON_DR_WW2G4;
+    }
+    if( ping_dr > MAX_DR_WW2G4 )
+    {
+        return ERRORLORAWAN;
+    }
+    params->beacon_freq_hz  = BEACON_FREQ_WW2G4;
+    params->beacon_sf       = 12 - BEACON_DR_WW2G4;
+    params->beacon_bw       = BW800;
+    params->beacon_rfu_size = 2;
+    params->beacon_size     = 17;
+    params->ping_freq_hz    = BEACON_FREQ_WW2G4;
+    params->ping_sf         = 12 - ping_dr;
+    params->ping_bw         = BW800;
+    return OKLORAWAN;
+}
+
+void region_ww2g4_tx_frequency_channel_set( const lr1_stack_mac_t* lr1_mac, uint32_t tx_freq, uint8_t index )
+{
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     // the freq is multiply by 2 because the region 2.4 given freqency coded over 24 bits and divide by 200
     if( index >= NUMBER_OF_CHANNEL_WW2G4 )
     {
@@ -614,12 +791,18 @@ void region_ww2g4_tx_frequency_channel_set( uint32_t tx_freq, uint8_t index )
     }
     else
     {
-        tx_frequency_channel[index] = tx_freq;
+        region_ww2g4_channel_t channel;
+        channel_get( ctx, index, &channel );
+        channel.tx_frequency = CHANNEL_FREQ_WW2G4( tx_freq );
+        channel_set( ctx, index, &channel );
+        ctx->is_dr_channel_mask_valid = false;
     }
 }
 
-void region_ww2g4_rx1_frequency_channel_set( uint32_t rx_freq, uint8_t index )
+void region_ww2g4_rx1_frequency_channel_set( const lr1_stack_mac_t* lr1_mac, uint32_t rx_freq, uint8_t index )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     if( index >= NUMBER_OF_CHANNEL_WW2G4 )
     {
         BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
@@ -627,11 +810,16 @@ void region_ww2g4_rx1_frequency_channel_set( uint32_t rx_freq, uint8_t index )
     }
     else
     {
-        rx1_frequency_channel[index] = rx_freq;
+        region_ww2g4_channel_t channel;
+        channel_get( ctx, index, &channel );
+        channel.rx1_frequency = CHANNEL_FREQ_WW2G4( rx_freq );
+        channel_set( ctx, index, &channel );
     }
 }
-void region_ww2g4_min_dr_channel_set( uint8_t dr, uint8_t index )
+void region_ww2g4_min_dr_channel_set( const lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t index )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     if( index >= NUMBER_OF_CHANNEL_WW2G4 )
     {
         BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
@@ -639,11 +827,17 @@ void region_ww2g4_min_dr_channel_set( uint8_t dr, uint8_t index )
     }
     else
     {
-        min_dr_channel[index] = dr;
+        region_ww2g4_channel_t channel;
+        channel_get( ctx, index, &channel );
+        channel.min_dr = dr;
+        channel_set( ctx, index, &channel );
+        ctx->is_dr_channel_mask_valid = false;
     }
 }
-void region_ww2g4_max_dr_channel_set( uint8_t dr, uint8_t index )
+void region_ww2g4_max_dr_channel_set( const lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t index )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     if( index >= NUMBER_OF_CHANNEL_WW2G4 )
     {
         BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
@@ -651,11 +845,17 @@ void region_ww2g4_max_dr_channel_set( uint8_t dr, uint8_t index )
     }
     else
     {
-        max_dr_channel[index] = dr;
+        region_ww2g4_channel_t channel;
+        channel_get( ctx, index, &channel );
+        channel.max_dr = dr;
+        channel_set( ctx, index, &channel );
+        ctx->is_dr_channel_mask_valid = false;
     }
 }
-void region_ww2g4_channel_enabled_set( uint8_t enable, uint8_t index )
+void region_ww2g4_channel_enabled_set( const lr1_stack_mac_t* lr1_mac, uint8_t enable, uint8_t index )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     if( index >= NUMBER_OF_CHANNEL_WW2G4 )
     {
         BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
@@ -663,58 +863,170 @@ void region_ww2g4_channel_enabled_set( uint8_t enable, uint8_t index )
     }
     else
     {
-        channel_index_enabled[index] = enable;
+        ctx->channel_index_enabled[index] = enable;
+        ctx->is_dr_channel_mask_valid = false;
     }
 }
 
-uint32_t region_ww2g4_tx_frequency_channel_get( uint8_t index )
+uint32_t region_ww2g4_tx_frequency_channel_get( const lr1_stack_mac_t* lr1_mac, uint8_t index )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     if( index >= NUMBER_OF_CHANNEL_WW2G4 )
     {
         BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
         bsp_mcu_handle_lr1mac_issue( );
     }
-    return ( tx_frequency_channel[index] );
+    region_ww2g4_channel_t channel;
+    channel_get( ctx, index, &channel );
+    return ( CHANNEL_HZ_WW2G4( channel.tx_frequency ) );
 }
-uint32_t region_ww2g4_rx1_frequency_channel_get( uint8_t index )
+uint32_t region_ww2g4_rx1_frequency_channel_get( const lr1_stack_mac_t* lr1_mac, uint8_t index )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     if( index >= NUMBER_OF_CHANNEL_WW2G4 )
     {
         BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
         bsp_mcu_handle_lr1mac_issue( );
     }
-    return ( rx1_frequency_channel[index] );
+    region_ww2g4_channel_t channel;
+    channel_get( ctx, index, &channel );
+    return ( CHANNEL_HZ_WW2G4( channel.rx1_frequency ) );
 }
-uint8_t region_ww2g4_min_dr_channel_get( void )
+uint8_t region_ww2g4_min_dr_channel_get( const lr1_stack_mac_t* lr1_mac )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     uint8_t min = MAX_DR_WW2G4;  // start with the max dr and search a dr inferior
     for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
     {
-        if( ( min_dr_channel[i] < min ) && ( channel_index_enabled[i] == CHANNEL_ENABLED ) )
+        region_ww2g4_channel_t channel;
+        channel_get( ctx, i, &channel );
+        if( ( channel.min_dr < min ) && ( ctx->channel_index_enabled[i] == CHANNEL_ENABLED ) )
         {
-            min = min_dr_channel[i];
+            min = channel.min_dr;
         }
     }
     return ( min );
 }
-uint8_t region_ww2g4_max_dr_channel_get( void )
+uint8_t region_ww2g4_max_dr_channel_get( const lr1_stack_mac_t* lr1_mac )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     uint8_t max = MIN_DR_WW2G4;  // start with the min dr and search a dr superior
     for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
-        if( ( max_dr_channel[i] > max ) && ( channel_index_enabled[i] == CHANNEL_ENABLED ) )
+    {
+        region_ww2g4_channel_t channel;
+        channel_get( ctx, i, &channel );
+        if( ( channel.max_dr > max ) && ( ctx->channel_index_enabled[i] == CHANNEL_ENABLED ) )
         {
-            max = max_dr_channel[i];
+            max = channel.max_dr;
         }
+    }
     return ( max );
 }
-uint8_t region_ww2g4_channel_enabled_get( uint8_t index )
+uint8_t region_ww2g4_channel_enabled_get( const lr1_stack_mac_t* lr1_mac, uint8_t index )
 {
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
     if( index >= NUMBER_OF_CHANNEL_WW2G4 )
     {
         BSP_DBG_TRACE_ERROR( " exceed Channel number available : overflow" );
         bsp_mcu_handle_lr1mac_issue( );
     }
-    return ( channel_index_enabled[index] );
+    return ( ctx->channel_index_enabled[index] );
+}
+
+void region_ww2g4_channel_stats_update( const lr1_stack_mac_t* lr1_mac, smtc_real_channel_event_t event )
+{
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
+    if( ctx->last_channel_idx >= NUMBER_OF_CHANNEL_WW2G4 )
+    {
+        return;
+    }
+    region_ww2g4_channel_stats_t* stats = &ctx->channel_stats[ctx->last_channel_idx];
+
+    switch( event )
+    {
+    case SMTC_REAL_CHANNEL_EVENT_UPLINK_ACKED:
+        stats->uplink_acked_cnt++;
+        stats->uplink_cnt++;
+        break;
+    case SMTC_REAL_CHANNEL_EVENT_UPLINK_NOT_ACKED:
+        stats->uplink_cnt++;
+        break;
+    case SMTC_REAL_CHANNEL_EVENT_RX1_DOWNLINK:
+        // the first downlink seeds the average, then 1/4 of each new one
+        stats->rx1_snr_avg = ( stats->rx1_downlink_cnt == 0 )
+                                 ? lr1_mac->rx_snr
+                                 : ( stats->rx1_snr_avg + ( ( lr1_mac->rx_snr - stats->rx1_snr_avg ) / 4 ) );
+        if( stats->rx1_downlink_cnt < 0xFF )
+        {
+            stats->rx1_downlink_cnt++;
+        }
+        break;
+    case SMTC_REAL_CHANNEL_EVENT_CAD_BUSY:
+        stats->cad_busy_cnt++;
+        break;
+    default:
+        break;
+    }
+    if( ( stats->uplink_cnt + stats->cad_busy_cnt ) >= CHANNEL_STATS_WINDOW_WW2G4 )
+    {
+        stats->uplink_cnt >>= 1;
+        stats->uplink_acked_cnt >>= 1;
+        stats->cad_busy_cnt >>= 1;
+    }
+    BSP_DBG_TRACE_PRINTF( "Channel %u stats: ul %u, acked %u, cad busy %u, rx1 snr %d, weight %u\n",
+                          ctx->last_channel_idx, stats->uplink_cnt, stats->uplink_acked_cnt, stats->cad_busy_cnt,
+                          stats->rx1_snr_avg, channel_weight_get( ctx, ctx->last_channel_idx ) );
+}
+
+void region_ww2g4_weighted_channel_selection_enable_set( const lr1_stack_mac_t* lr1_mac, uint8_t enable )
+{
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
+    ctx->is_weighted_channel_selection = ( enable != 0 ) ? true : false;
+}
+
+uint8_t region_ww2g4_channel_scan_plan_get( const lr1_stack_mac_t* lr1_mac, uint32_t* freq_in_hz, uint8_t freq_max )
+{
+    const region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+    uint8_t                       nb  = 0;
+
+    for( uint8_t i = 0; ( i < NUMBER_OF_CHANNEL_WW2G4 ) && ( nb < freq_max ); i++ )
+    {
+        if( ctx->channel_index_enabled[i] == CHANNEL_ENABLED )
+        {
+            region_ww2g4_channel_t channel;
+            channel_get( ctx, i, &channel );
+            freq_in_hz[nb++] = CHANNEL_HZ_WW2G4( channel.tx_frequency );
+        }
+    }
+    return nb;
+}
+
+void region_ww2g4_channel_occupancy_update( const lr1_stack_mac_t* lr1_mac, uint32_t freq_in_hz, uint8_t busy_ratio )
+{
+    region_ww2g4_context_t* ctx = REGION_WW2G4_CONTEXT( lr1_mac );
+
+    if( ctx->is_dr_channel_mask_valid == false )
+    {
+        // the statistics follow the channel frequencies once the channel plan changed
+        dr_channel_mask_update( ctx );
+    }
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
+    {
+        region_ww2g4_channel_stats_t* stats = &ctx->channel_stats[i];
+
+        if( stats->frequency == freq_in_hz )
+        {
+            // 1/4 of each new scan, the interference of a Wi-Fi network lasts longer than a scan period
+            stats->occupancy = ( uint8_t )( stats->occupancy + ( ( ( int16_t ) busy_ratio - stats->occupancy ) / 4 ) );
+        }
+    }
 }
 
 /*************************************************************************/
@@ -750,6 +1062,118 @@ void rx2_dr_to_sf_bw( lr1_stack_mac_t* lr1_mac, uint8_t dr )
         BSP_DBG_TRACE_WARNING( " Invalid Datarate \n" );
     }
 }
+static void dr_channel_mask_update( region_ww2g4_context_t* ctx )
+{
+    memset( ctx->dr_channel_mask, 0, sizeof( ctx->dr_channel_mask ) );
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
+    {
+        if( ctx->channel_index_enabled[i] != CHANNEL_ENABLED )
+        {
+            continue;
+        }
+        region_ww2g4_channel_t channel;
+        channel_get( ctx, i, &channel );
+        for( uint8_t dr = channel.min_dr; ( dr <= channel.max_dr ) && ( dr <= MAX_DR_WW2G4 ); dr++ )
+        {
+            ctx->dr_channel_mask[dr][i / 32] |= ( 1UL << ( i % 32 ) );
+        }
+    }
+    // the statistics of a channel moved to another frequency are meaningless
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
+    {
+        region_ww2g4_channel_t channel;
+        channel_get( ctx, i, &channel );
+        const uint32_t frequency = CHANNEL_HZ_WW2G4( channel.tx_frequency );
+        if( ctx->channel_stats[i].frequency != frequency )
+        {
+            memset( &ctx->channel_stats[i], 0, sizeof( region_ww2g4_channel_stats_t ) );
+            ctx->channel_stats[i].frequency = frequency;
+        }
+    }
+    ctx->is_dr_channel_mask_valid = true;
+}
+
+static void channel_get( const region_ww2g4_context_t* ctx, uint8_t index, region_ww2g4_channel_t* channel )
+{
+    for( uint8_t i = 0; i < ctx->channel_overlay_nb; i++ )
+    {
+        if( ctx->channel_overlay[i].index == index )
+        {
+            *channel = ctx->channel_overlay[i];
+            return;
+        }
+    }
+    *channel = ( index < NUMBER_OF_DEFAULT_CHANNEL_WW2G4 ) ? default_channel_plan[index] : undefined_channel;
+}
+
+static void channel_set( region_ww2g4_context_t* ctx, uint8_t index, const region_ww2g4_channel_t* channel )
+{
+    const region_ww2g4_channel_t* def =
+        ( index < NUMBER_OF_DEFAULT_CHANNEL_WW2G4 ) ? &default_channel_plan[index] : &undefined_channel;
+    const bool is_default = ( channel->tx_frequency == def->tx_frequency ) &&
+                            ( channel->rx1_frequency == def->rx1_frequency ) && ( channel->min_dr == def->min_dr ) &&
+                            ( channel->max_dr == def->max_dr );
+    uint8_t i = 0;
+
+    while( ( i < ctx->channel_overlay_nb ) && ( ctx->channel_overlay[i].index != index ) )
+    {
+        i++;
+    }
+    if( is_default == true )
+    {
+        if( i < ctx->channel_overlay_nb )
+        {
+            // the last entry takes the place of the removed one
+            ctx->channel_overlay_nb--;
+            ctx->channel_overlay[i] = ctx->channel_overlay[ctx->channel_overlay_nb];
+        }
+        return;
+    }
+    if( i == ctx->channel_overlay_nb )
+    {
+        ctx->channel_overlay_nb++;
+    }
+    ctx->channel_overlay[i]       = *channel;
+    ctx->channel_overlay[i].index = index;
+}
+
+static uint8_t channel_weight_get( const region_ww2g4_context_t* ctx, uint8_t channel_idx )
+{
+    const region_ww2g4_channel_stats_t* stats = &ctx->channel_stats[channel_idx];
+
+    // success ratio of the rated uplinks, a positive CAD counting as a failure, a new channel gets the max weight
+    const uint16_t weight = ( ( CHANNEL_WEIGHT_MAX_WW2G4 - 1 ) * ( stats->uplink_acked_cnt + 1 ) ) /
+                            ( stats->uplink_cnt + stats->cad_busy_cnt + 1 );
+
+    // then scaled by the free share of the channel measured by the scans
+    return ( uint8_t )( 1 + ( ( weight * ( 255 - stats->occupancy ) ) / 255 ) );
+}
+
+static uint8_t channel_weighted_select( const region_ww2g4_context_t* ctx, const uint32_t* channel_mask )
+{
+    uint8_t  channel_weight[NUMBER_OF_CHANNEL_WW2G4] = { 0 };
+    uint16_t weight_sum                              = 0;
+
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
+    {
+        if( ( ( channel_mask[i / 32] >> ( i % 32 ) ) & 0x1 ) != 0 )
+        {
+            channel_weight[i] = channel_weight_get( ctx, i );
+            weight_sum += channel_weight[i];
+        }
+    }
+
+    uint16_t draw = bsp_rng_get_random_in_range( 0, weight_sum - 1 ) % weight_sum;
+    for( uint8_t i = 0; i < NUMBER_OF_CHANNEL_WW2G4; i++ )
+    {
+        if( draw < channel_weight[i] )
+        {
+            return i;
+        }
+        draw -= channel_weight[i];
+    }
+    return 0xFF;
+}
 /*deprecated
 uint8_t channel_enabled_find(uint8_t index)
 {
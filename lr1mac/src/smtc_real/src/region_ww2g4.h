@@ -38,6 +38,7 @@
 #include "smtc_real_defs.h"
 #include "lr1mac_defs.h"
 #include "lr1_stack_mac_layer.h"
+#include "lr1mac_utilities.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -61,10 +62,73 @@ extern "C" {
 #define SYNC_WORD_WW2G4             (0x21)
 #define MIN_DR_WW2G4                (0)
 #define MAX_DR_WW2G4                (7)
+#define BEACON_FREQ_WW2G4           (2424000000)    // Hz, class B beacon and ping slots
+#define BEACON_DR_WW2G4             (0)
 #define TIMEONAIR_JOIN_SF5_MS_WW2G4 (5)             // 4.026ms
 
 // clang-format on
 
+#define CHANNEL_MASK_WORDS_WW2G4 LR1MAC_UTILITIES_CHANNEL_MASK_WORDS( NUMBER_OF_CHANNEL_WW2G4 )
+
+/*!
+ * A channel of the plan, the frequencies are kept in FREQUENCY_FACTOR_WW2G4 steps like in the MAC commands
+ */
+typedef struct region_ww2g4_channel_s
+{
+    uint32_t tx_frequency : 24;  // 0 when the channel is not defined
+    uint32_t min_dr : 4;
+    uint32_t max_dr : 4;
+    uint32_t rx1_frequency : 24;
+    uint32_t index : 8;  // overlay entries only: index of the channel the entry replaces
+} region_ww2g4_channel_t;
+
+/*!
+ * Link statistics of a channel, rating it for the weighted channel selection
+ */
+typedef struct region_ww2g4_channel_stats_s
+{
+    uint32_t frequency;         // tx frequency the statistics are collected on, reset when it changes
+    uint8_t  uplink_cnt;        // confirmed uplinks and join requests
+    uint8_t  uplink_acked_cnt;  // ... acked or accepted
+    uint8_t  cad_busy_cnt;      // positive CAD before an uplink
+    uint8_t  rx1_downlink_cnt;
+    int16_t  rx1_snr_avg;  // exponential average of the RX1 downlinks SNR
+    uint8_t  occupancy;    // exponential average of the busy ratio measured by the channel scans, 255 always busy
+} region_ww2g4_channel_stats_t;
+
+/*!
+ * State of a WW2G4 region instance, referenced by the context of its smtc_real_t
+ *
+ * \remark Set up by \ref REGION_WW2G4_CONTEXT_INIT, the channel plan is then initialized by \ref region_ww2g4_init
+ */
+typedef struct region_ww2g4_context_s
+{
+    // Channels changed by the network (CFList, NewChannelReq, DlChannelReq, datarate decrement), the entries back to
+    // their default value are removed. Any channel can be changed in this region, the overlay is sized for all.
+    region_ww2g4_channel_t channel_overlay[NUMBER_OF_CHANNEL_WW2G4];
+    uint8_t                channel_overlay_nb;
+    uint8_t                channel_index_enabled[NUMBER_OF_CHANNEL_WW2G4];  // the activated channels
+    uint8_t                dr_distribution_user[MAX_DR_WW2G4 + 1];          // decoded from adr_custom
+    const uint8_t*         dr_distribution_init;
+    uint8_t                dr_distribution[MAX_DR_WW2G4 + 1];
+    uint32_t               unwrapped_channel_mask;
+    // Channels eligible at each datarate, rebuilt at the next channel selection once the channel plan changed
+    uint32_t dr_channel_mask[MAX_DR_WW2G4 + 1][CHANNEL_MASK_WORDS_WW2G4];
+    bool     is_dr_channel_mask_valid;
+    // Not reset by region_ww2g4_init: a join restarts the region, the interference is still there
+    region_ww2g4_channel_stats_t channel_stats[NUMBER_OF_CHANNEL_WW2G4];
+    uint8_t                      last_channel_idx;  // channel of the last uplink
+    bool                         is_weighted_channel_selection;
+} region_ww2g4_context_t;
+
+/*!
+ * Static initializer of a \ref region_ww2g4_context_t
+ */
+#define REGION_WW2G4_CONTEXT_INIT                                                      \
+    {                                                                                  \
+        .unwrapped_channel_mask = 0xFFFF, .last_channel_idx = NUMBER_OF_CHANNEL_WW2G4, \
+    }
+
 /*!
  * \brief
  * \remark
@@ -100,6 +164,14 @@ void region_ww2g4_bad_crc_memory_set( lr1_stack_mac_t* lr1_mac );
  * \param [OUT] return
  */
 void region_ww2g4_next_dr_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Set the next datarate to the fastest one of the distribution, capped by the enabled channels
+ * \remark  The datarate given by the ADR is kept in static ADR mode
+ * \param [IN]  lr1_mac                   - stack
+ * \param [IN]  dr_max                    - fastest datarate allowed
+ * \param [OUT] none
+ */
+void region_ww2g4_fastest_dr_get( lr1_stack_mac_t* lr1_mac, uint8_t dr_max );
 /*!
  * \brief
  * \remark
@@ -107,6 +179,21 @@ void region_ww2g4_next_dr_get( lr1_stack_mac_t* lr1_mac );
  * \param [OUT] return
  */
 void region_ww2g4_memory_save( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Store the session: keys, counters, rx parameters and channel plan, under a single crc
+ * \param [IN]  lr1_mac   LoRaWAN stack
+ */
+void region_ww2g4_session_save( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Restore the stored session, to be called after region_ww2g4_init
+ * \param [IN]  lr1_mac   LoRaWAN stack
+ * \param [OUT] return    OKLORAWAN if a valid session of the current region was restored
+ */
+status_lorawan_t region_ww2g4_session_load( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Invalidate the stored session, the next boot joins again
+ */
+void region_ww2g4_session_erase( const lr1_stack_mac_t* lr1_mac );
 /*!
  * \brief
  * \remark
@@ -169,7 +256,7 @@ void region_ww2g4_channel_mask_set( lr1_stack_mac_t* lr1_mac );
  * \param [IN]  none
  * \param [OUT] return
  */
-void region_ww2g4_channel_mask_init( void );
+void region_ww2g4_channel_mask_init( const lr1_stack_mac_t* lr1_mac );
 /*!
  * \brief
  * \remark
@@ -183,7 +270,7 @@ void region_ww2g4_join_snapshot_channel_mask_init( void );
  * \param [IN]  none
  * \param [OUT] return
  */
-status_channel_t region_ww2g4_channel_mask_build( uint8_t ChMaskCntl, uint16_t ChMask );
+status_channel_t region_ww2g4_channel_mask_build( const lr1_stack_mac_t* lr1_mac, uint8_t ChMaskCntl, uint16_t ChMask );
 /*!
  * \brief
  * \remark
@@ -232,7 +319,7 @@ status_lorawan_t region_ww2g4_is_valid_dr( uint8_t dr );
  * \param [IN]  none
  * \param [OUT] return
  */
-status_lorawan_t region_ww2g4_is_acceptable_dr( uint8_t dr );  // for link adr cmd
+status_lorawan_t region_ww2g4_is_acceptable_dr( const lr1_stack_mac_t* lr1_mac, uint8_t dr );  // for link adr cmd
 /*!
  * \brief
  * \remark
@@ -274,70 +361,107 @@ status_lorawan_t region_ww2g4_is_valid_size( lr1_stack_mac_t* lr1_mac, uint8_t d
  * \param [IN]  none
  * \param [OUT] return
  */
-void region_ww2g4_tx_frequency_channel_set( uint32_t tx_freq, uint8_t index );
+void region_ww2g4_tx_frequency_channel_set( const lr1_stack_mac_t* lr1_mac, uint32_t tx_freq, uint8_t index );
 /*!
  * \brief
  * \remark
  * \param [IN]  none
  * \param [OUT] return
  */
-void region_ww2g4_rx1_frequency_channel_set( uint32_t rx_freq, uint8_t index );
+void region_ww2g4_rx1_frequency_channel_set( const lr1_stack_mac_t* lr1_mac, uint32_t rx_freq, uint8_t index );
 /*!
  * \brief
  * \remark
  * \param [IN]  none
  * \param [OUT] return
  */
-void region_ww2g4_min_dr_channel_set( uint8_t dr, uint8_t index );
+void region_ww2g4_min_dr_channel_set( const lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t index );
 /*!
  * \brief
  * \remark
  * \param [IN]  none
  * \param [OUT] return
  */
-void region_ww2g4_max_dr_channel_set( uint8_t dr, uint8_t index );
+void region_ww2g4_max_dr_channel_set( const lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t index );
 /*!
  * \brief
  * \remark
  * \param [IN]  none
  * \param [OUT] return
  */
-void region_ww2g4_channel_enabled_set( uint8_t enable, uint8_t index );
+void region_ww2g4_channel_enabled_set( const lr1_stack_mac_t* lr1_mac, uint8_t enable, uint8_t index );
 /*!
  * \brief
  * \remark
  * \param [IN]  none
  * \param [OUT] return
  */
-uint32_t region_ww2g4_tx_frequency_channel_get( uint8_t index );
+uint32_t region_ww2g4_tx_frequency_channel_get( const lr1_stack_mac_t* lr1_mac, uint8_t index );
 /*!
  * \brief
  * \remark
  * \param [IN]  none
  * \param [OUT] return
  */
-uint32_t region_ww2g4_rx1_frequency_channel_get( uint8_t index );
+uint32_t region_ww2g4_rx1_frequency_channel_get( const lr1_stack_mac_t* lr1_mac, uint8_t index );
 /*!
  * \brief
  * \remark
  * \param [IN]  none
  * \param [OUT] return
  */
-uint8_t region_ww2g4_min_dr_channel_get( void );
+uint8_t region_ww2g4_min_dr_channel_get( const lr1_stack_mac_t* lr1_mac );
 /*!
  * \brief
  * \remark
  * \param [IN]  none
  * \param [OUT] return
  */
-uint8_t region_ww2g4_max_dr_channel_get( void );
+uint8_t region_ww2g4_max_dr_channel_get( const lr1_stack_mac_t* lr1_mac );
 /*!
  * \brief
  * \remark
  * \param [IN]  none
  * \param [OUT] return
  */
-uint8_t region_ww2g4_channel_enabled_get( uint8_t index );
+uint8_t region_ww2g4_channel_enabled_get( const lr1_stack_mac_t* lr1_mac, uint8_t index );
+/*!
+ * \brief   Rate the channel of the last uplink with a link event
+ * \remark  The SNR of a RX1 downlink is read in lr1_mac
+ * \param [IN]  lr1_mac   LoRaWAN stack
+ * \param [IN]  event     Link event
+ */
+void region_ww2g4_channel_stats_update( const lr1_stack_mac_t* lr1_mac, smtc_real_channel_event_t event );
+/*!
+ * \brief   Select the uplink channels at random weighted by their statistics instead of uniformly
+ * \param [IN]  lr1_mac   LoRaWAN stack
+ * \param [IN]  enable    1 to weight the selection, 0 for the uniform selection by default
+ */
+void region_ww2g4_weighted_channel_selection_enable_set( const lr1_stack_mac_t* lr1_mac, uint8_t enable );
+/*!
+ * \brief   Get the tx frequencies of the enabled channels, to be scanned for their occupancy
+ * \param [IN]  lr1_mac      LoRaWAN stack
+ * \param [OUT] freq_in_hz   Frequencies of the enabled channels
+ * \param [IN]  freq_max     Size of freq_in_hz
+ * \param [OUT] return       Number of frequencies written
+ */
+uint8_t region_ww2g4_channel_scan_plan_get( const lr1_stack_mac_t* lr1_mac, uint32_t* freq_in_hz, uint8_t freq_max );
+/*!
+ * \brief   Add a channel scan result to the occupancy of the channels on its frequency
+ * \remark  The occupancy lowers the weight of a channel in the weighted channel selection, also used by the LBT to
+ *          pick another channel after a busy CAD
+ * \param [IN]  lr1_mac      LoRaWAN stack
+ * \param [IN]  freq_in_hz   Frequency scanned
+ * \param [IN]  busy_ratio   Share of the samples above the busy threshold, 255 for all of them
+ */
+void region_ww2g4_channel_occupancy_update( const lr1_stack_mac_t* lr1_mac, uint32_t freq_in_hz, uint8_t busy_ratio );
+/*!
+ * \brief   Class B beacon and ping slots on the same frequency, next to RX2, and DR0 by default
+ * \param [IN]  ping_dr   Datarate of the ping slots, 0xFF for DR0
+ * \param [OUT] params
+ * \param [OUT] return    ERRORLORAWAN if ping_dr is not a datarate of the region
+ */
+status_lorawan_t region_ww2g4_class_b_params_get( uint8_t ping_dr, smtc_real_class_b_params_t* params );
 
 #ifdef __cplusplus
 }
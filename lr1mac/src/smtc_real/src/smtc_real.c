@@ -30,6 +30,7 @@
  */
 
 #include "smtc_real.h"
+#include "smtc_bsp.h"
 
 #if defined( REGION_WW2G4 )
 #include "region_ww2g4.h"
@@ -44,9 +45,26 @@
 #error "Unknown region selected..."
 #endif
 
+/*
+ * With a single region compiled in, lr1mac_core_set_region only accepts this region: the region is known at compile
+ * time, every switch below folds into a direct (tail) call of the region function and the error paths are removed.
+ * With several regions, the switch is a jump table on the region type.
+ */
+#if( defined( REGION_WW2G4 ) + defined( REGION_EU_868 ) + defined( REGION_US_915 ) ) == 1
+#if defined( REGION_WW2G4 )
+#define SMTC_REAL_REGION_TYPE( lr1_mac ) SMTC_REAL_REGION_WW2G4
+#elif defined( REGION_EU_868 )
+#define SMTC_REAL_REGION_TYPE( lr1_mac ) SMTC_REAL_REGION_EU_868
+#else
+#define SMTC_REAL_REGION_TYPE( lr1_mac ) SMTC_REAL_REGION_US_915
+#endif
+#else
+#define SMTC_REAL_REGION_TYPE( lr1_mac ) ( ( lr1_mac )->real->region_type )
+#endif
+
 void smtc_real_init( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -75,7 +93,7 @@ void smtc_real_init( lr1_stack_mac_t* lr1_mac )
 
 void smtc_real_dr_distribution_set( lr1_stack_mac_t* lr1_mac, uint8_t adrMode )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -104,7 +122,7 @@ void smtc_real_dr_distribution_set( lr1_stack_mac_t* lr1_mac, uint8_t adrMode )
 
 status_lorawan_t smtc_real_memory_load( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -134,7 +152,7 @@ status_lorawan_t smtc_real_memory_load( lr1_stack_mac_t* lr1_mac )
 
 void smtc_real_bad_crc_memory_set( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -161,9 +179,37 @@ void smtc_real_bad_crc_memory_set( lr1_stack_mac_t* lr1_mac )
     }
 }
 
+void smtc_real_fastest_dr_get( lr1_stack_mac_t* lr1_mac, uint8_t dr_max )
+{
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
+    {
+#if defined( REGION_WW2G4 )
+    case SMTC_REAL_REGION_WW2G4: {
+        region_ww2g4_fastest_dr_get( lr1_mac, dr_max );
+        break;
+    }
+#endif
+#if defined( REGION_EU_868 )
+    case SMTC_REAL_REGION_EU_868: {
+        region_eu_868_fastest_dr_get( lr1_mac, dr_max );
+        break;
+    }
+#endif
+#if defined( REGION_US_915 )
+    case SMTC_REAL_REGION_US_915: {
+        region_us_915_fastest_dr_get( lr1_mac, dr_max );
+        break;
+    }
+#endif
+    default:
+        // the strategy datarate is kept
+        break;
+    }
+}
+
 void smtc_real_next_dr_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -190,9 +236,46 @@ void smtc_real_next_dr_get( lr1_stack_mac_t* lr1_mac )
     }
 }
 
+bool smtc_real_dr_distribution_draw( uint8_t* distribution, const uint8_t* distribution_init, uint8_t nb_dr,
+                                     uint8_t* dr )
+{
+    uint16_t distri_sum = 0;
+
+    for( uint8_t i = 0; i < nb_dr; i++ )
+    {
+        distri_sum += distribution[i];
+    }
+    if( distri_sum == 0 )
+    {
+        for( uint8_t i = 0; i < nb_dr; i++ )
+        {
+            distribution[i] = distribution_init[i];
+            distri_sum += distribution[i];
+        }
+        if( distri_sum == 0 )
+        {
+            return false;
+        }
+    }
+
+    // each uplink left is equally likely: find the datarate holding the drawn one in the running sum of the counts
+    uint16_t draw = bsp_rng_get_random_in_range( 0, distri_sum - 1 );
+    for( uint8_t i = 0; i < nb_dr; i++ )
+    {
+        if( draw < distribution[i] )
+        {
+            distribution[i]--;
+            *dr = i;
+            return true;
+        }
+        draw -= distribution[i];
+    }
+    return false;
+}
+
 void smtc_real_memory_save( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -221,7 +304,7 @@ void smtc_real_memory_save( lr1_stack_mac_t* lr1_mac )
 
 uint8_t smtc_real_max_payload_size_get( lr1_stack_mac_t* lr1_mac, uint8_t dr )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -248,7 +331,7 @@ uint8_t smtc_real_max_payload_size_get( lr1_stack_mac_t* lr1_mac, uint8_t dr )
 
 uint32_t smtc_real_decode_freq_from_buf( lr1_stack_mac_t* lr1_mac, uint8_t freq_buf[3] )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -275,7 +358,7 @@ uint32_t smtc_real_decode_freq_from_buf( lr1_stack_mac_t* lr1_mac, uint8_t freq_
 
 void smtc_real_cflist_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -304,7 +387,7 @@ void smtc_real_cflist_get( lr1_stack_mac_t* lr1_mac )
 
 status_lorawan_t smtc_real_next_channel_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -331,7 +414,7 @@ status_lorawan_t smtc_real_next_channel_get( lr1_stack_mac_t* lr1_mac )
 
 status_lorawan_t smtc_real_join_next_channel_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -358,7 +441,7 @@ status_lorawan_t smtc_real_join_next_channel_get( lr1_stack_mac_t* lr1_mac )
 
 void smtc_real_rx_config_set( lr1_stack_mac_t* lr1_mac, rx_win_type_t type )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -387,7 +470,7 @@ void smtc_real_rx_config_set( lr1_stack_mac_t* lr1_mac, rx_win_type_t type )
 
 void smtc_real_power_set( lr1_stack_mac_t* lr1_mac, uint8_t power_cmd )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -415,7 +498,7 @@ void smtc_real_power_set( lr1_stack_mac_t* lr1_mac, uint8_t power_cmd )
 }
 uint8_t smtc_real_default_max_eirp_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -442,7 +525,7 @@ uint8_t smtc_real_default_max_eirp_get( lr1_stack_mac_t* lr1_mac )
 
 void smtc_real_channel_mask_set( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -458,7 +541,7 @@ void smtc_real_channel_mask_set( lr1_stack_mac_t* lr1_mac )
 #endif
 #if defined( REGION_US_915 )
     case SMTC_REAL_REGION_US_915: {
-        region_us915_channel_mask_set( lr1_mac );
+        region_us_915_channel_mask_set( lr1_mac );
         break;
     }
 #endif
@@ -471,11 +554,11 @@ void smtc_real_channel_mask_set( lr1_stack_mac_t* lr1_mac )
 
 void smtc_real_channel_mask_init( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        region_ww2g4_channel_mask_init( );
+        region_ww2g4_channel_mask_init( lr1_mac );
         break;
     }
 #endif
@@ -500,7 +583,7 @@ void smtc_real_channel_mask_init( lr1_stack_mac_t* lr1_mac )
 
 void smtc_real_join_snapshot_channel_mask_init( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -529,11 +612,11 @@ void smtc_real_join_snapshot_channel_mask_init( lr1_stack_mac_t* lr1_mac )
 
 status_channel_t smtc_real_channel_mask_build( lr1_stack_mac_t* lr1_mac, uint8_t ChMaskCntl, uint16_t ChMask )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        return region_ww2g4_channel_mask_build( ChMaskCntl, ChMask );
+        return region_ww2g4_channel_mask_build( lr1_mac, ChMaskCntl, ChMask );
     }
 #endif
 #if defined( REGION_EU_868 )
@@ -556,7 +639,7 @@ status_channel_t smtc_real_channel_mask_build( lr1_stack_mac_t* lr1_mac, uint8_t
 
 void smtc_real_dr_decrement( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -585,7 +668,7 @@ void smtc_real_dr_decrement( lr1_stack_mac_t* lr1_mac )
 
 uint8_t smtc_real_adr_ack_delay_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -612,7 +695,7 @@ uint8_t smtc_real_adr_ack_delay_get( lr1_stack_mac_t* lr1_mac )
 
 uint8_t smtc_real_adr_ack_limit_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -639,7 +722,7 @@ uint8_t smtc_real_adr_ack_limit_get( lr1_stack_mac_t* lr1_mac )
 
 uint8_t smtc_real_sync_word_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -666,7 +749,7 @@ uint8_t smtc_real_sync_word_get( lr1_stack_mac_t* lr1_mac )
 
 uint8_t* smtc_real_gfsk_sync_word_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_EU_868 )
     case SMTC_REAL_REGION_EU_868: {
@@ -683,7 +766,7 @@ uint8_t* smtc_real_gfsk_sync_word_get( lr1_stack_mac_t* lr1_mac )
 
 status_lorawan_t smtc_real_is_valid_rx1_dr_offset( lr1_stack_mac_t* lr1_mac, uint8_t rx1_dr_offset )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -710,7 +793,7 @@ status_lorawan_t smtc_real_is_valid_rx1_dr_offset( lr1_stack_mac_t* lr1_mac, uin
 
 status_lorawan_t smtc_real_is_valid_dr( lr1_stack_mac_t* lr1_mac, uint8_t dr )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -737,11 +820,11 @@ status_lorawan_t smtc_real_is_valid_dr( lr1_stack_mac_t* lr1_mac, uint8_t dr )
 
 status_lorawan_t smtc_real_is_acceptable_dr( lr1_stack_mac_t* lr1_mac, uint8_t dr )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        return region_ww2g4_is_acceptable_dr( dr );
+        return region_ww2g4_is_acceptable_dr( lr1_mac, dr );
     }
 #endif
 #if defined( REGION_EU_868 )
@@ -764,7 +847,7 @@ status_lorawan_t smtc_real_is_acceptable_dr( lr1_stack_mac_t* lr1_mac, uint8_t d
 
 status_lorawan_t smtc_real_is_valid_tx_frequency( lr1_stack_mac_t* lr1_mac, uint32_t frequency )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -791,7 +874,7 @@ status_lorawan_t smtc_real_is_valid_tx_frequency( lr1_stack_mac_t* lr1_mac, uint
 
 status_lorawan_t smtc_real_is_valid_rx_frequency( lr1_stack_mac_t* lr1_mac, uint32_t frequency )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -818,7 +901,7 @@ status_lorawan_t smtc_real_is_valid_rx_frequency( lr1_stack_mac_t* lr1_mac, uint
 
 status_lorawan_t smtc_real_is_valid_tx_power( lr1_stack_mac_t* lr1_mac, uint8_t power )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -845,7 +928,7 @@ status_lorawan_t smtc_real_is_valid_tx_power( lr1_stack_mac_t* lr1_mac, uint8_t
 
 status_lorawan_t smtc_real_is_valid_channel_index( lr1_stack_mac_t* lr1_mac, uint8_t channel_index )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -872,7 +955,7 @@ status_lorawan_t smtc_real_is_valid_channel_index( lr1_stack_mac_t* lr1_mac, uin
 
 status_lorawan_t smtc_real_is_valid_size( lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t size )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -899,11 +982,11 @@ status_lorawan_t smtc_real_is_valid_size( lr1_stack_mac_t* lr1_mac, uint8_t dr,
 
 void smtc_real_tx_frequency_channel_set( lr1_stack_mac_t* lr1_mac, uint32_t tx_freq, uint8_t index )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        region_ww2g4_tx_frequency_channel_set( tx_freq, index );
+        region_ww2g4_tx_frequency_channel_set( lr1_mac, tx_freq, index );
         break;
     }
 #endif
@@ -928,11 +1011,11 @@ void smtc_real_tx_frequency_channel_set( lr1_stack_mac_t* lr1_mac, uint32_t tx_f
 
 void smtc_real_rx1_frequency_channel_set( lr1_stack_mac_t* lr1_mac, uint32_t rx_freq, uint8_t index )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        region_ww2g4_rx1_frequency_channel_set( rx_freq, index );
+        region_ww2g4_rx1_frequency_channel_set( lr1_mac, rx_freq, index );
         break;
     }
 #endif
@@ -957,11 +1040,11 @@ void smtc_real_rx1_frequency_channel_set( lr1_stack_mac_t* lr1_mac, uint32_t rx_
 
 void smtc_real_min_dr_channel_set( lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t index )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        region_ww2g4_min_dr_channel_set( dr, index );
+        region_ww2g4_min_dr_channel_set( lr1_mac, dr, index );
         break;
     }
 #endif
@@ -986,11 +1069,11 @@ void smtc_real_min_dr_channel_set( lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t
 
 void smtc_real_max_dr_channel_set( lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t index )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        region_ww2g4_max_dr_channel_set( dr, index );
+        region_ww2g4_max_dr_channel_set( lr1_mac, dr, index );
         break;
     }
 #endif
@@ -1015,11 +1098,11 @@ void smtc_real_max_dr_channel_set( lr1_stack_mac_t* lr1_mac, uint8_t dr, uint8_t
 
 void smtc_real_channel_enabled_set( lr1_stack_mac_t* lr1_mac, uint8_t enable, uint8_t index )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        region_ww2g4_channel_enabled_set( enable, index );
+        region_ww2g4_channel_enabled_set( lr1_mac, enable, index );
         break;
     }
 #endif
@@ -1044,11 +1127,11 @@ void smtc_real_channel_enabled_set( lr1_stack_mac_t* lr1_mac, uint8_t enable, ui
 
 uint32_t smtc_real_tx_frequency_channel_get( lr1_stack_mac_t* lr1_mac, uint8_t index )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        return region_ww2g4_tx_frequency_channel_get( index );
+        return region_ww2g4_tx_frequency_channel_get( lr1_mac, index );
     }
 #endif
 #if defined( REGION_EU_868 )
@@ -1071,11 +1154,11 @@ uint32_t smtc_real_tx_frequency_channel_get( lr1_stack_mac_t* lr1_mac, uint8_t i
 
 uint32_t smtc_real_rx1_frequency_channel_get( lr1_stack_mac_t* lr1_mac, uint8_t index )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        return region_ww2g4_rx1_frequency_channel_get( index );
+        return region_ww2g4_rx1_frequency_channel_get( lr1_mac, index );
     }
 #endif
 #if defined( REGION_EU_868 )
@@ -1098,11 +1181,11 @@ uint32_t smtc_real_rx1_frequency_channel_get( lr1_stack_mac_t* lr1_mac, uint8_t
 
 uint8_t smtc_real_min_dr_channel_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        return region_ww2g4_min_dr_channel_get( );
+        return region_ww2g4_min_dr_channel_get( lr1_mac );
     }
 #endif
 #if defined( REGION_EU_868 )
@@ -1125,11 +1208,11 @@ uint8_t smtc_real_min_dr_channel_get( lr1_stack_mac_t* lr1_mac )
 
 uint8_t smtc_real_max_dr_channel_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        return region_ww2g4_max_dr_channel_get( );
+        return region_ww2g4_max_dr_channel_get( lr1_mac );
     }
 #endif
 #if defined( REGION_EU_868 )
@@ -1152,11 +1235,11 @@ uint8_t smtc_real_max_dr_channel_get( lr1_stack_mac_t* lr1_mac )
 
 uint8_t smtc_real_channel_enabled_get( lr1_stack_mac_t* lr1_mac, uint8_t index )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
-        return region_ww2g4_channel_enabled_get( index );
+        return region_ww2g4_channel_enabled_get( lr1_mac, index );
     }
 #endif
 #if defined( REGION_EU_868 )
@@ -1179,7 +1262,7 @@ uint8_t smtc_real_channel_enabled_get( lr1_stack_mac_t* lr1_mac, uint8_t index )
 
 uint8_t smtc_real_rx1_join_delay_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -1206,7 +1289,7 @@ uint8_t smtc_real_rx1_join_delay_get( lr1_stack_mac_t* lr1_mac )
 
 uint8_t smtc_real_rx2_join_dr_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -1233,7 +1316,7 @@ uint8_t smtc_real_rx2_join_dr_get( lr1_stack_mac_t* lr1_mac )
 
 uint8_t smtc_real_frequency_factor_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -1259,7 +1342,7 @@ uint8_t smtc_real_frequency_factor_get( lr1_stack_mac_t* lr1_mac )
 }
 enum ral_lora_cr_e smtc_real_coding_rate_get( lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -1286,7 +1369,7 @@ enum ral_lora_cr_e smtc_real_coding_rate_get( lr1_stack_mac_t* lr1_mac )
 
 uint32_t smtc_real_get_join_sf5_toa_in_ms( const lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -1313,7 +1396,7 @@ uint32_t smtc_real_get_join_sf5_toa_in_ms( const lr1_stack_mac_t* lr1_mac )
 
 void smtc_real_duty_cycle_enable_set( const lr1_stack_mac_t* lr1_mac, uint8_t enable )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -1342,7 +1425,7 @@ void smtc_real_duty_cycle_enable_set( const lr1_stack_mac_t* lr1_mac, uint8_t en
 
 void smtc_real_duty_cycle_sum( const lr1_stack_mac_t* lr1_mac, uint32_t freq_hz, uint32_t toa_ms )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -1371,7 +1454,7 @@ void smtc_real_duty_cycle_sum( const lr1_stack_mac_t* lr1_mac, uint32_t freq_hz,
 
 void smtc_real_duty_cycle_update( const lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -1401,7 +1484,7 @@ void smtc_real_duty_cycle_update( const lr1_stack_mac_t* lr1_mac )
 status_lorawan_t smtc_real_duty_cycle_is_toa_accepted( const lr1_stack_mac_t* lr1_mac, uint32_t freq_hz,
                                                        uint32_t toa_ms )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -1430,7 +1513,7 @@ status_lorawan_t smtc_real_duty_cycle_is_toa_accepted( const lr1_stack_mac_t* lr
 
 status_lorawan_t smtc_real_duty_cycle_is_channel_free( const lr1_stack_mac_t* lr1_mac, uint32_t freq_hz )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -1459,7 +1542,7 @@ status_lorawan_t smtc_real_duty_cycle_is_channel_free( const lr1_stack_mac_t* lr
 
 int32_t smtc_real_next_free_duty_cycle_ms_get( const lr1_stack_mac_t* lr1_mac )
 {
-    switch( lr1_mac->real->region_type )
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4: {
@@ -1488,7 +1571,7 @@ int32_t smtc_real_next_free_duty_cycle_ms_get( const lr1_stack_mac_t* lr1_mac )
 
 
 uint8_t  smtc_real_preamble_get( const lr1_stack_mac_t* lr1_mac, uint8_t sf ){
-     switch( lr1_mac->real->region_type )
+     switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
     {
 #if defined( REGION_WW2G4 )
     case SMTC_REAL_REGION_WW2G4:
@@ -1525,3 +1608,234 @@ uint8_t  smtc_real_preamble_get( const lr1_stack_mac_t* lr1_mac, uint8_t sf ){
     }
     return 0;  // never reach => avoid warning
 }
+
+void smtc_real_channel_stats_update( const lr1_stack_mac_t* lr1_mac, smtc_real_channel_event_t event )
+{
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
+    {
+#if defined( REGION_WW2G4 )
+    case SMTC_REAL_REGION_WW2G4: {
+        region_ww2g4_channel_stats_update( lr1_mac, event );
+        break;
+    }
+#endif
+#if defined( REGION_EU_868 )
+    case SMTC_REAL_REGION_EU_868: {
+        // No channel statistics in EU_868
+        break;
+    }
+#endif
+#if defined( REGION_US_915 )
+    case SMTC_REAL_REGION_US_915: {
+        // No channel statistics in US_915
+        break;
+    }
+#endif
+    default:
+        BSP_DBG_TRACE_ERROR( "%s unsupported\n", __func__ );
+        bsp_mcu_handle_lr1mac_issue( );
+        break;
+    }
+}
+
+void smtc_real_weighted_channel_selection_enable_set( const lr1_stack_mac_t* lr1_mac, uint8_t enable )
+{
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
+    {
+#if defined( REGION_WW2G4 )
+    case SMTC_REAL_REGION_WW2G4: {
+        region_ww2g4_weighted_channel_selection_enable_set( lr1_mac, enable );
+        break;
+    }
+#endif
+#if defined( REGION_EU_868 )
+    case SMTC_REAL_REGION_EU_868: {
+        // No weighted channel selection in EU_868
+        break;
+    }
+#endif
+#if defined( REGION_US_915 )
+    case SMTC_REAL_REGION_US_915: {
+        // No weighted channel selection in US_915
+        break;
+    }
+#endif
+    default:
+        BSP_DBG_TRACE_ERROR( "%s unsupported\n", __func__ );
+        bsp_mcu_handle_lr1mac_issue( );
+        break;
+    }
+}
+
+uint8_t smtc_real_channel_scan_plan_get( const lr1_stack_mac_t* lr1_mac, uint32_t* freq_in_hz, uint8_t freq_max )
+{
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
+    {
+#if defined( REGION_WW2G4 )
+    case SMTC_REAL_REGION_WW2G4: {
+        return region_ww2g4_channel_scan_plan_get( lr1_mac, freq_in_hz, freq_max );
+    }
+#endif
+#if defined( REGION_EU_868 )
+    case SMTC_REAL_REGION_EU_868: {
+        // No channel occupancy in EU_868
+        return 0;
+    }
+#endif
+#if defined( REGION_US_915 )
+    case SMTC_REAL_REGION_US_915: {
+        // No channel occupancy in US_915
+        return 0;
+    }
+#endif
+    default:
+        BSP_DBG_TRACE_ERROR( "%s unsupported\n", __func__ );
+        bsp_mcu_handle_lr1mac_issue( );
+        break;
+    }
+    return 0;  // never reach => avoid warning
+}
+
+void smtc_real_channel_occupancy_update( const lr1_stack_mac_t* lr1_mac, uint32_t freq_in_hz, uint8_t busy_ratio )
+{
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
+    {
+#if defined( REGION_WW2G4 )
+    case SMTC_REAL_REGION_WW2G4: {
+        region_ww2g4_channel_occupancy_update( lr1_mac, freq_in_hz, busy_ratio );
+        break;
+    }
+#endif
+#if defined( REGION_EU_868 )
+    case SMTC_REAL_REGION_EU_868: {
+        // No channel occupancy in EU_868
+        break;
+    }
+#endif
+#if defined( REGION_US_915 )
+    case SMTC_REAL_REGION_US_915: {
+        // No channel occupancy in US_915
+        break;
+    }
+#endif
+    default:
+        BSP_DBG_TRACE_ERROR( "%s unsupported\n", __func__ );
+        bsp_mcu_handle_lr1mac_issue( );
+        break;
+    }
+}
+
+void smtc_real_session_save( lr1_stack_mac_t* lr1_mac )
+{
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
+    {
+#if defined( REGION_WW2G4 )
+    case SMTC_REAL_REGION_WW2G4: {
+        region_ww2g4_session_save( lr1_mac );
+        break;
+    }
+#endif
+#if defined( REGION_EU_868 )
+    case SMTC_REAL_REGION_EU_868: {
+        // No session persistence in EU_868
+        break;
+    }
+#endif
+#if defined( REGION_US_915 )
+    case SMTC_REAL_REGION_US_915: {
+        // No session persistence in US_915
+        break;
+    }
+#endif
+    default:
+        BSP_DBG_TRACE_ERROR( "%s unsupported\n", __func__ );
+        bsp_mcu_handle_lr1mac_issue( );
+        break;
+    }
+}
+
+status_lorawan_t smtc_real_session_load( lr1_stack_mac_t* lr1_mac )
+{
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
+    {
+#if defined( REGION_WW2G4 )
+    case SMTC_REAL_REGION_WW2G4: {
+        return region_ww2g4_session_load( lr1_mac );
+    }
+#endif
+#if defined( REGION_EU_868 )
+    case SMTC_REAL_REGION_EU_868: {
+        // No session persistence in EU_868
+        return ERRORLORAWAN;
+    }
+#endif
+#if defined( REGION_US_915 )
+    case SMTC_REAL_REGION_US_915: {
+        // No session persistence in US_915
+        return ERRORLORAWAN;
+    }
+#endif
+    default:
+        BSP_DBG_TRACE_ERROR( "%s unsupported\n", __func__ );
+        bsp_mcu_handle_lr1mac_issue( );
+        return ( ERRORLORAWAN );  // never reach just for warning
+        break;
+    }
+}
+
+status_lorawan_t smtc_real_class_b_params_get( const lr1_stack_mac_t* lr1_mac, uint32_t beacon_time_s, uint8_t ping_dr,
+                                               smtc_real_class_b_params_t* params )
+{
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
+    {
+#if defined( REGION_WW2G4 )
+    case SMTC_REAL_REGION_WW2G4: {
+        return region_ww2g4_class_b_params_get( ping_dr, params );
+    }
+#endif
+#if defined( REGION_EU_868 )
+    case SMTC_REAL_REGION_EU_868: {
+        return region_eu_868_class_b_params_get( ping_dr, params );
+    }
+#endif
+#if defined( REGION_US_915 )
+    case SMTC_REAL_REGION_US_915: {
+        return region_us_915_class_b_params_get( lr1_mac, beacon_time_s, ping_dr, params );
+    }
+#endif
+    default:
+        BSP_DBG_TRACE_ERROR( "%s unsupported\n", __func__ );
+        bsp_mcu_handle_lr1mac_issue( );
+        break;
+    }
+    return ERRORLORAWAN;  // never reach => avoid warning
+}
+
+void smtc_real_session_erase( const lr1_stack_mac_t* lr1_mac )
+{
+    switch( SMTC_REAL_REGION_TYPE( lr1_mac ) )
+    {
+#if defined( REGION_WW2G4 )
+    case SMTC_REAL_REGION_WW2G4: {
+        region_ww2g4_session_erase( lr1_mac );
+        break;
+    }
+#endif
+#if defined( REGION_EU_868 )
+    case SMTC_REAL_REGION_EU_868: {
+        // No session persistence in EU_868
+        break;
+    }
+#endif
+#if defined( REGION_US_915 )
+    case SMTC_REAL_REGION_US_915: {
+        // No session persistence in US_915
+        break;
+    }
+#endif
+    default:
+        BSP_DBG_TRACE_ERROR( "%s unsupported\n", __func__ );
+        bsp_mcu_handle_lr1mac_issue( );
+        break;
+    }
+}
@@ -82,6 +82,27 @@ void smtc_real_bad_crc_memory_set( lr1_stack_mac_t* lr1_mac );
  * \param [OUT] return
  */
 void smtc_real_next_dr_get( lr1_stack_mac_t* lr1_mac );
+/*!
+ * \brief   Set the next datarate to the fastest one of the datarate strategy
+ * \remark  The datarate given by the ADR is kept in static ADR mode, it is the fastest one known to reach the network
+ * \param [IN]  lr1_mac                   - stack
+ * \param [IN]  dr_max                    - fastest datarate allowed, UINT8_MAX for the fastest of the strategy
+ * \param [OUT] none
+ */
+void smtc_real_fastest_dr_get( lr1_stack_mac_t* lr1_mac, uint8_t dr_max );
+
+/*!
+ * \brief   Draw the datarate of the next uplink from a custom ADR distribution, shared by the regions
+ * \remark  One random number and one pass over the remaining counts, the drawn datarate count is decremented.
+ *          The distribution is reloaded from distribution_init once used up
+ * \param [IN/OUT] distribution       Uplinks left to send on each datarate
+ * \param [IN]     distribution_init  Uplinks on each datarate of the ADR profile
+ * \param [IN]     nb_dr              Number of datarates of the region
+ * \param [OUT]    dr                 Datarate drawn
+ * \param [OUT] return false if the ADR profile has no uplink on any datarate, dr is left unchanged
+ */
+bool smtc_real_dr_distribution_draw( uint8_t* distribution, const uint8_t* distribution_init, uint8_t nb_dr,
+                                     uint8_t* dr );
 /*!
  * \brief
  * \remark
@@ -437,6 +458,74 @@ int32_t smtc_real_next_free_duty_cycle_ms_get( const lr1_stack_mac_t* lr1_mac );
  */
 uint8_t  smtc_real_preamble_get( const lr1_stack_mac_t* lr1_mac, uint8_t sf );
 
+/*!
+ * \brief   Rate the channel of the last uplink with a link event
+ * \remark  Only the WW2G4 region collects channel statistics
+ * \param [IN]  lr1_mac   LoRaWAN stack
+ * \param [IN]  event     Link event
+ */
+void smtc_real_channel_stats_update( const lr1_stack_mac_t* lr1_mac, smtc_real_channel_event_t event );
+
+/*!
+ * \brief   Select the uplink channels at random weighted by their statistics instead of uniformly
+ * \remark  Only supported by the WW2G4 region, to avoid the 2.4GHz channels kept busy by Wi-Fi
+ * \param [IN]  lr1_mac   LoRaWAN stack
+ * \param [IN]  enable    1 to weight the selection, 0 for the uniform selection by default
+ */
+void smtc_real_weighted_channel_selection_enable_set( const lr1_stack_mac_t* lr1_mac, uint8_t enable );
+
+/*!
+ * \brief   Get the tx frequencies of the enabled channels, to be scanned for their occupancy
+ * \remark  Only supported by the WW2G4 region, none in the other regions
+ * \param [IN]  lr1_mac      LoRaWAN stack
+ * \param [OUT] freq_in_hz   Frequencies of the enabled channels
+ * \param [IN]  freq_max     Size of freq_in_hz
+ * \param [OUT] return       Number of frequencies written
+ */
+uint8_t smtc_real_channel_scan_plan_get( const lr1_stack_mac_t* lr1_mac, uint32_t* freq_in_hz, uint8_t freq_max );
+
+/*!
+ * \brief   Add a channel scan result to the occupancy of the channels on its frequency
+ * \remark  Only supported by the WW2G4 region, the occupancy weighs its weighted channel selection
+ * \param [IN]  lr1_mac      LoRaWAN stack
+ * \param [IN]  freq_in_hz   Frequency scanned
+ * \param [IN]  busy_ratio   Share of the samples above the busy threshold, 255 for all of them
+ */
+void smtc_real_channel_occupancy_update( const lr1_stack_mac_t* lr1_mac, uint32_t freq_in_hz, uint8_t busy_ratio );
+
+/*!
+ * \brief   Store the current session in nvm, restored at the next boot instead of joining again
+ * \remark  Only supported by the WW2G4 region
+ * \param [IN]  lr1_mac   LoRaWAN stack
+ */
+void smtc_real_session_save( lr1_stack_mac_t* lr1_mac );
+
+/*!
+ * \brief   Restore the session stored in nvm
+ * \remark  Must be called after smtc_real_init, the restored channel plan overrides the default one
+ * \param [IN]  lr1_mac   LoRaWAN stack
+ * \param [OUT] return    OKLORAWAN if a valid session was restored, ERRORLORAWAN otherwise
+ */
+status_lorawan_t smtc_real_session_load( lr1_stack_mac_t* lr1_mac );
+
+/*!
+ * \brief   Invalidate the session stored in nvm
+ * \param [IN]  lr1_mac   LoRaWAN stack
+ */
+void smtc_real_session_erase( const lr1_stack_mac_t* lr1_mac );
+
+/*!
+ * \brief   Get the radio parameters of the class B beacon and ping slots
+ * \remark  The US_915 beacons and ping slots hop over the 8 downlink channels with the beacon time
+ * \param [IN]  lr1_mac         LoRaWAN stack
+ * \param [IN]  beacon_time_s   GPS time of the beacon, or of the beacon period of the ping slot
+ * \param [IN]  ping_dr         Datarate of the ping slots from the PingSlotChannelReq, 0xFF for the region default
+ * \param [OUT] params          Beacon and ping slot parameters, on the region default frequencies
+ * \param [OUT] return          ERRORLORAWAN if ping_dr is not a valid LoRa downlink datarate of the region
+ */
+status_lorawan_t smtc_real_class_b_params_get( const lr1_stack_mac_t* lr1_mac, uint32_t beacon_time_s, uint8_t ping_dr,
+                                               smtc_real_class_b_params_t* params );
+
 
 #ifdef __cplusplus
 }
@@ -112,6 +112,32 @@ typedef enum smtc_real_status_e
     SMTC_REAL_STATUS_ERROR,
 } smtc_real_status_t;
 
+/**
+ * Link events rating the channel of the last uplink
+ */
+typedef enum smtc_real_channel_event_e
+{
+    SMTC_REAL_CHANNEL_EVENT_UPLINK_ACKED = 0,  //!< Confirmed uplink acked or join request accepted
+    SMTC_REAL_CHANNEL_EVENT_UPLINK_NOT_ACKED,  //!< Confirmed uplink or join request without answer
+    SMTC_REAL_CHANNEL_EVENT_RX1_DOWNLINK,      //!< Valid downlink received in RX1, on the uplink channel
+    SMTC_REAL_CHANNEL_EVENT_CAD_BUSY,          //!< Positive CAD on the channel before the uplink
+} smtc_real_channel_event_t;
+
+/**
+ * Radio parameters of the class B beacon and ping slots
+ */
+typedef struct smtc_real_class_b_params_s
+{
+    uint32_t beacon_freq_hz;
+    uint8_t  beacon_sf;
+    uint8_t  beacon_bw;        //!< lr1mac_bandwidth_t
+    uint8_t  beacon_rfu_size;  //!< bytes of RFU before the beacon time, the first CRC covers both
+    uint8_t  beacon_size;      //!< implicit header, the beacon has a fixed size
+    uint32_t ping_freq_hz;
+    uint8_t  ping_sf;
+    uint8_t  ping_bw;  //!< lr1mac_bandwidth_t
+} smtc_real_class_b_params_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,16 +32,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include "radio_planner.h"
+#include "smtc_bsp_perf.h"
+#include "smtc_bsp_mcu.h"
+#include "radio_planner_trace.h"
 
 //
 // Private planner variable declaration
 //
 
-#if defined( PERF_TEST_ENABLED )
-static uint32_t tx_done_count    = 0;
-static uint32_t rx_done_count    = 0;
-static uint32_t rx_timeout_count = 0;
-#endif
 //
 // Private planner utilities declaration
 //
@@ -67,15 +65,77 @@ static void rp_task_arbiter( radio_planner_t* rp, const char* caller_func_name )
 static void rp_irq_get_status( radio_planner_t* rp, const uint8_t hook_id );
 
 /*!
- *
+ * Install a task as the current task of its hook and rank it
+ */
+static void rp_task_set( radio_planner_t* rp, const rp_task_t* task, uint8_t* payload, uint16_t payload_size,
+                         const rp_radio_params_t* radio_params );
+
+/*!
+ * Drop the tasks chained behind the current task of a hook
+ */
+static void rp_task_queue_flush( radio_planner_t* rp, const uint8_t hook_id );
+
+/*!
+ * Install the next chained task of a hook at the end of its previous task, returns true if there was one to run
+ */
+static bool rp_task_queue_pop( radio_planner_t* rp, const uint8_t hook_id, const uint32_t now );
+
+/*!
+ * Move a hook to its place in the rankings after a change of its task priority
+ */
+static void rp_task_update_ranking( radio_planner_t* rp, const uint8_t hook_id );
+
+/*!
+ * Set the priority of the current task of a hook from its state, then apply the arbitration settings of the hook
+ */
+static void rp_task_set_priority( radio_planner_t* rp, const uint8_t hook_id );
+
+/*!
+ * Priority of the current task of a hook once aged and penalized when the hook is over its airtime share
+ */
+static uint8_t rp_task_get_priority( const radio_planner_t* rp, const uint8_t hook_id, const uint32_t now );
+
+/*!
+ * Roll the airtime window and rank the tasks again, the airtime used and the ages change between two arbitrations
+ */
+static void rp_task_update_priorities( radio_planner_t* rp, const uint32_t now );
+
+/*!
+ * Radio time used by a hook in the current airtime window, including its running task [ms]
  */
-static void rp_task_compute_ranking( radio_planner_t* rp );
+static uint32_t rp_hook_get_airtime_ms( const radio_planner_t* rp, const uint8_t hook_id, const uint32_t now );
+
+/*!
+ * Abort, defer or reschedule a task that collides with a higher priority task, according to its preempt policy
+ */
+static void rp_task_preempt( radio_planner_t* rp, const uint8_t hook_id, const uint32_t now );
+
+/*!
+ * Returns the first start time from start where the task fits between the other pending tasks
+ */
+static uint32_t rp_task_find_next_gap( const radio_planner_t* rp, const uint8_t hook_id, uint32_t start,
+                                       const uint32_t duration_ms );
 
 /*!
  *
  */
 static void rp_task_launch_current( radio_planner_t* rp );
 
+/*!
+ *
+ */
+static void rp_task_trigger_current( radio_planner_t* rp );
+
+/*!
+ * Time needed ahead of the start time of a task to wake up, switch the TCXO on and configure the radio [ms]
+ */
+static uint32_t rp_task_get_lead_time( const radio_planner_t* rp, const uint8_t hook_id );
+
+/*!
+ *
+ */
+static void rp_task_set_next_alarm( radio_planner_t* rp );
+
 /*!
  *
  */
@@ -90,22 +150,23 @@ static rp_next_state_status_t rp_task_get_next( radio_planner_t* rp, uint32_t* d
 /*!
  *
  */
-static uint8_t rp_task_find_highest_priority( const radio_planner_t* rp, uint8_t* vector, uint8_t length );
+rp_hook_status_t rp_get_pkt_payload( radio_planner_t* rp, const rp_task_t* task,
+                                     const ral_rx_buffer_status_t* rx_buffer_status );
 
 /*!
  *
  */
-rp_hook_status_t rp_get_pkt_payload( radio_planner_t* rp, const rp_task_t* task );
+static void rp_set_alarm( radio_planner_t* rp, const uint32_t alarm_in_ms );
 
 /*!
  *
  */
-static void rp_set_alarm( radio_planner_t* rp, const uint32_t alarm_in_ms );
+static void rp_timer_irq( radio_planner_t* rp );
 
 /*!
  *
  */
-static void rp_timer_irq( radio_planner_t* rp );
+static void rp_launch_timer_irq( radio_planner_t* rp );
 
 /*!
  *
@@ -116,10 +177,35 @@ static void rp_radio_irq( radio_planner_t* rp );
  *
  */
 static void rp_task_call_aborted( radio_planner_t* rp );
+
+/*!
+ * End of the CAD of a CAD gated Rx task: on a preamble the reception starts, an empty window ends as a Rx timeout
+ *
+ * \remark Neither the SX1280 nor the SX126x RAL support the CAD to Rx exit mode, the reception is started here
+ *
+ * \retval true when the reception has started and the task goes on
+ */
+static bool rp_task_cad_gate_is_open( radio_planner_t* rp, const uint8_t hook_id );
+
+/*!
+ * Sweeps the channels of a RP_TASK_TYPE_RSSI_SCAN task, the radio stays in Rx and only its frequency is changed
+ */
+static void rp_rssi_scan_sweep( radio_planner_t* rp, const uint8_t hook_id );
+
+/*!
+ * Put the radio in sleep, with its configuration retained when a task is due soon
+ */
+static void rp_radio_set_sleep( radio_planner_t* rp );
+
+/*!
+ * Bottom half of the radio planner interrupts, runs the pending work by urgency
+ */
+static void rp_irq_bottom_half( radio_planner_t* rp );
 /*!
  *
  */
-static void rp_consumption_statistics_updated( radio_planner_t* rp, const uint8_t hook_id, const uint32_t time );
+static void rp_consumption_statistics_updated( radio_planner_t* rp, const uint8_t hook_id, const uint32_t time,
+                                               const uint32_t time_us );
 // Radio planner callbacks
 //
 
@@ -132,6 +218,16 @@ static void rp_consumption_statistics_updated( radio_planner_t* rp, const uint8_
  */
 static void rp_timer_irq_callback( void* obj );
 
+/*!
+ *
+ */
+static void rp_launch_timer_irq_callback( void* obj );
+
+/*!
+ *
+ */
+static void rp_irq_bottom_half_callback( void* obj );
+
 /*!
  *
  */
@@ -163,9 +259,25 @@ void rp_init( radio_planner_t* rp, ral_t* ral )
         rp->tasks[i].start_time_ms      = 0;
         rp->tasks[i].start_time_init_ms = 0;
         rp->tasks[i].duration_time_ms   = 0;
+        rp->tasks[i].preempt_policy     = RP_TASK_PREEMPT_ABORT;
         rp->hooks[i]                    = NULL;
         rp->irq_timestamp_ms[i]         = 0;
+        rp->irq_timestamp_us[i]         = 0;
         rp->status[i]                   = RP_STATUS_TASK_ABORTED;
+        rp->rankings[i]                 = i;
+        rp->arbitration[i]              = ( rp_hook_arbitration_t ){ .airtime_share_percent = 100,
+                                                        .max_aging             = 0,
+                                                        .is_protected          = false };
+        rp->base_priority[i]            = 0;
+        rp->age[i]                      = 0;
+        rp->airtime_base_ms[i]          = 0;
+        rp->rx_filter[i]                = NULL;
+        rp->rx_filter_size[i]           = 0;
+    }
+    for( int32_t i = 0; i < RP_TASK_TYPE_NONE; i++ )
+    {
+        // the lead time starts at the former fixed margin until the first setup of the type is measured
+        rp->setup_time[i] = ( RP_MARGIN_DELAY - RP_LAUNCH_WAKEUP_DELAY - 1 ) << RP_SETUP_TIME_SHIFT;
     }
     rp_task_free( rp, &rp->priority_task );
     rp_stats_init( &rp->stats );
@@ -176,9 +288,23 @@ void rp_init( radio_planner_t* rp, ral_t* ral )
     rp->timer_state             = RP_TIMER_STATE_IDLE;
     rp->semaphore_radio         = 0;
     rp->semaphore_abort_radio   = 0;
+    rp->launch_pending          = 0;
+    rp->radio_irq_pending       = 0;
+    rp->launch_irq_pending      = 0;
+    rp->timer_irq_pending       = 0;
+    rp->radio_irq_timestamp_ms  = 0;
+    rp->radio_irq_timestamp_us  = 0;
     rp->timer_value             = 0;
     rp->timer_hook_id           = 0;
     rp->next_state_status       = RP_STATUS_NO_MORE_TASK_SCHEDULE;
+    rp->queue_nb                = 0;
+    rp->airtime_window_start_ms = 0;
+    rp->arbitration_is_on       = false;
+    rp->is_suspended            = false;
+    rp->suspend_time_ms         = 0;
+#if defined( PERF_TEST_ENABLED )
+    rp_trace_init( );
+#endif
 }
 
 rp_hook_status_t rp_hook_init( radio_planner_t* rp, const uint8_t id, void ( *callback )( void* context ), void* hook )
@@ -192,6 +318,41 @@ rp_hook_status_t rp_hook_init( radio_planner_t* rp, const uint8_t id, void ( *ca
     return RP_HOOK_STATUS_OK;
 }
 
+rp_hook_status_t rp_hook_set_arbitration( radio_planner_t* rp, const uint8_t id,
+                                          const rp_hook_arbitration_t* arbitration )
+{
+    if( ( id >= RP_NB_HOOKS ) || ( arbitration->airtime_share_percent > 100 ) )
+    {
+        return RP_HOOK_STATUS_ID_ERROR;
+    }
+    rp_bsp_critical_section_begin( );
+    rp->arbitration[id]   = *arbitration;
+    rp->arbitration_is_on = false;
+    for( int32_t i = 0; i < RP_NB_HOOKS; i++ )
+    {
+        if( ( rp->arbitration[i].airtime_share_percent < 100 ) || ( rp->arbitration[i].max_aging > 0 ) )
+        {
+            rp->arbitration_is_on = true;
+        }
+    }
+    rp_bsp_critical_section_end( );
+    return RP_HOOK_STATUS_OK;
+}
+
+rp_hook_status_t rp_hook_set_rx_filter( radio_planner_t* rp, const uint8_t id, rp_rx_filter_t filter,
+                                        const uint8_t header_size )
+{
+    if( id >= RP_NB_HOOKS )
+    {
+        return RP_HOOK_STATUS_ID_ERROR;
+    }
+    rp_bsp_critical_section_begin( );
+    rp->rx_filter[id]      = filter;
+    rp->rx_filter_size[id] = header_size;
+    rp_bsp_critical_section_end( );
+    return RP_HOOK_STATUS_OK;
+}
+
 rp_hook_status_t rp_hook_get_id( const radio_planner_t* rp, const void* hook, uint8_t* id )
 {
     for( int32_t i = 0; i < RP_NB_HOOKS; i++ )
@@ -222,15 +383,8 @@ rp_hook_status_t rp_task_enqueue( radio_planner_t* rp, const rp_task_t* task, ui
         rp_bsp_critical_section_end( );
         return RP_TASK_STATUS_ALREADY_RUNNING;
     }
-
-    rp->tasks[hook_id]                    = *task;
-    rp->radio_params[hook_id]             = *radio_params;
-    rp->payload[hook_id]                  = payload;
-    rp->payload_size[hook_id]             = payload_size;
-    rp->tasks[hook_id].priority           = ( rp->tasks[hook_id].state * RP_NB_HOOKS ) + hook_id;
-    rp->tasks[hook_id].start_time_init_ms = rp->tasks[hook_id].start_time_ms;
-    BSP_DBG_TRACE_PRINTF_RP( "RP: Task #%u enqueue with #%u priority\n", hook_id, rp->tasks[hook_id].priority );
-    rp_task_compute_ranking( rp );
+    rp_task_queue_flush( rp, hook_id );
+    rp_task_set( rp, task, payload, payload_size, radio_params );
     if( rp->semaphore_radio == 0 )
     {
         rp_task_arbiter( rp, __func__ );
@@ -239,6 +393,64 @@ rp_hook_status_t rp_task_enqueue( radio_planner_t* rp, const rp_task_t* task, ui
     return RP_HOOK_STATUS_OK;
 }
 
+rp_hook_status_t rp_task_chain( radio_planner_t* rp, const rp_task_t* task, uint8_t* payload, uint16_t payload_size,
+                                const rp_radio_params_t* radio_params, const uint16_t run_if_status_mask )
+{
+    uint8_t hook_id = task->hook_id;
+
+    if( hook_id >= RP_NB_HOOKS )
+    {
+        return RP_HOOK_STATUS_ID_ERROR;
+    }
+
+    rp_bsp_critical_section_begin( );
+    if( rp->tasks[hook_id].state == RP_TASK_STATE_FINISHED )
+    {  // nothing to wait for, the chain starts now
+        rp_bsp_critical_section_end( );
+        return rp_task_enqueue( rp, task, payload, payload_size, radio_params );
+    }
+    if( rp->queue_nb >= RP_TASK_QUEUE_SIZE )
+    {
+        rp_bsp_critical_section_end( );
+        return RP_TASK_STATUS_QUEUE_FULL;
+    }
+
+    rp_task_queue_entry_t* entry = &rp->queue[rp->queue_nb++];
+
+    entry->task               = *task;
+    entry->radio_params       = *radio_params;
+    entry->payload            = payload;
+    entry->payload_size       = payload_size;
+    entry->run_if_status_mask = run_if_status_mask;
+    BSP_DBG_TRACE_PRINTF_RP( "RP: Task #%u chained, %u in queue\n", hook_id, rp->queue_nb );
+    rp_bsp_critical_section_end( );
+    return RP_HOOK_STATUS_OK;
+}
+
+uint32_t rp_get_next_free_window( const radio_planner_t* rp, const uint32_t min_duration_ms, uint32_t* start_ms )
+{
+    uint32_t free_ms = UINT32_MAX;
+
+    rp_bsp_critical_section_begin( );
+    // RP_NB_HOOKS matches no hook: every scheduled, pending or running task takes its slot
+    const uint32_t start = rp_task_find_next_gap( rp, RP_NB_HOOKS, rp_bsp_timestamp_get( ) + RP_MARGIN_DELAY + 1,
+                                                  min_duration_ms );
+    for( int32_t i = 0; i < RP_NB_HOOKS; i++ )
+    {
+        const rp_task_t* other = &rp->tasks[i];
+
+        if( ( other->state <= RP_TASK_STATE_RUNNING ) && ( ( int32_t )( other->start_time_ms - start ) >= 0 ) &&
+            ( ( other->start_time_ms - start - RP_MARGIN_DELAY ) < free_ms ) )
+        {
+            free_ms = other->start_time_ms - start - RP_MARGIN_DELAY;
+        }
+    }
+    rp_bsp_critical_section_end( );
+
+    *start_ms = start;
+    return free_ms;
+}
+
 rp_hook_status_t rp_task_abort( radio_planner_t* rp, const uint8_t hook_id )
 {
     rp_bsp_critical_section_begin( );
@@ -247,16 +459,18 @@ rp_hook_status_t rp_task_abort( radio_planner_t* rp, const uint8_t hook_id )
         rp_bsp_critical_section_end( );
         return RP_HOOK_STATUS_ID_ERROR;
     }
+    RP_TRACE( RP_TRACE_EVENT_ABORT, hook_id, rp_bsp_timestamp_get( ), 0, 0, 0 );
     if( rp->tasks[hook_id].state == RP_TASK_STATE_RUNNING )
     {
-        ral_set_sleep( rp->ral );
+        rp_radio_set_sleep( rp );
 
         // Shut Down the TCXO
         ral_set_tcxo_off( rp->ral );
 
-        rp_consumption_statistics_updated( rp, hook_id, rp_bsp_timestamp_get( ) );
+        rp_consumption_statistics_updated( rp, hook_id, rp_bsp_timestamp_get( ), rp_bsp_timestamp_us_get( ) );
     }
     rp_task_free( rp, &( rp->tasks[hook_id] ) );
+    rp_task_queue_flush( rp, hook_id );
     rp->status[hook_id] = RP_STATUS_TASK_ABORTED;
 
     if( rp->semaphore_radio == 0 )
@@ -267,9 +481,70 @@ rp_hook_status_t rp_task_abort( radio_planner_t* rp, const uint8_t hook_id )
     return RP_HOOK_STATUS_OK;
 }
 
-void rp_get_status( const radio_planner_t* rp, const uint8_t id, uint32_t* irq_timestamp_ms, rp_status_t* status )
+void rp_suspend( radio_planner_t* rp )
+{
+    rp_bsp_critical_section_begin( );
+    if( rp->is_suspended == true )
+    {
+        rp_bsp_critical_section_end( );
+        return;
+    }
+    rp->is_suspended    = true;
+    rp->suspend_time_ms = rp_bsp_timestamp_get( );
+    // without any armed timer the LPTIM is stopped by the bsp
+    rp_bsp_timer_stop( rp );
+    rp->timer_state    = RP_TIMER_STATE_IDLE;
+    rp->launch_pending = 0;
+    if( rp->tasks[rp->radio_task_id].state == RP_TASK_STATE_RUNNING )
+    {
+        ral_clear_irq_status( rp->ral, RAL_IRQ_ALL );
+        // The IRQ of the aborted task can still be pending or waiting for its bottom half
+        rp->semaphore_abort_radio = ( ( rp_bsp_irq_get_pending( ) == 1 ) || ( rp->radio_irq_pending == 1 ) ) ? 1 : 0;
+        rp_consumption_statistics_updated( rp, rp->radio_task_id, rp_bsp_timestamp_get( ),
+                                           rp_bsp_timestamp_us_get( ) );
+        rp->tasks[rp->radio_task_id].state = RP_TASK_STATE_ABORTED;
+    }
+    ral_set_sleep_with_cfg( rp->ral, RAL_SLEEP_CFG_COLD_START );
+    ral_set_tcxo_off( rp->ral );
+    rp_bsp_critical_section_end( );
+}
+
+void rp_resume( radio_planner_t* rp )
+{
+    rp_bsp_critical_section_begin( );
+    if( rp->is_suspended == false )
+    {
+        rp_bsp_critical_section_end( );
+        return;
+    }
+    const uint32_t suspend_ms = rp_bsp_timestamp_get( ) - rp->suspend_time_ms;
+
+    // the tasks keep their gaps and their order, none of them is found in the past
+    for( int32_t i = 0; i < RP_NB_HOOKS; i++ )
+    {
+        if( rp->tasks[i].state < RP_TASK_STATE_RUNNING )
+        {
+            rp->tasks[i].start_time_ms += suspend_ms;
+            rp->tasks[i].start_time_init_ms += suspend_ms;
+        }
+        // the aborts of the suspend are not lost arbitrations
+        rp->age[i] = 0;
+    }
+    // the chained tasks of the queue are relative to the end of their previous task: they follow it as they are
+    rp->airtime_window_start_ms += suspend_ms;
+    rp->is_suspended = false;
+    if( rp->semaphore_radio == 0 )
+    {
+        rp_task_arbiter( rp, __func__ );
+    }
+    rp_bsp_critical_section_end( );
+}
+
+void rp_get_status( const radio_planner_t* rp, const uint8_t id, uint32_t* irq_timestamp_ms, uint32_t* irq_timestamp_us,
+                    rp_status_t* status )
 {
     *irq_timestamp_ms = rp->irq_timestamp_ms[id];
+    *irq_timestamp_us = rp->irq_timestamp_us[id];
     *status           = rp->status[id];
 }
 
@@ -278,10 +553,107 @@ rp_stats_t rp_get_stats( const radio_planner_t* rp )
     return rp->stats;
 }
 
+void rp_set_lora_wake_up_preamble( ral_params_lora_t* params, const uint32_t rx_time_in_ms,
+                                   const uint32_t sleep_time_in_ms )
+{
+    const uint32_t bw_in_hz = ral_get_lora_bw_in_hz( params->bw );
+
+    if( bw_in_hz == 0 )
+    {
+        return;
+    }
+
+    // symbols = period / ( 2^sf / bw )
+    const uint64_t period_in_ms    = ( uint64_t ) sleep_time_in_ms + ( 2 * ( uint64_t ) rx_time_in_ms );
+    uint64_t       pbl_len_in_symb = ( period_in_ms * bw_in_hz ) / ( ( uint64_t ) 1000 << params->sf );
+
+    pbl_len_in_symb += 1 + RP_WAKE_UP_PREAMBLE_MARGIN_SYMB;
+
+    // the packet parameters hold 65535 symbols, more than 20 minutes at SF12
+    if( pbl_len_in_symb > 0xFFFF )
+    {
+        pbl_len_in_symb = 0xFFFF;
+    }
+    if( pbl_len_in_symb > params->pbl_len_in_symb )
+    {
+        params->pbl_len_in_symb = ( uint16_t ) pbl_len_in_symb;
+    }
+}
+
 //
 // Private planner utilities implementation
 //
 
+static void rp_task_set( radio_planner_t* rp, const rp_task_t* task, uint8_t* payload, uint16_t payload_size,
+                         const rp_radio_params_t* radio_params )
+{
+    uint8_t hook_id = task->hook_id;
+
+    RP_TRACE( RP_TRACE_EVENT_ENQUEUE, hook_id, rp_bsp_timestamp_get( ), task->start_time_ms, task->duration_time_ms,
+              RP_TRACE_TASK_PACK( task->type, task->state, task->preempt_policy ) );
+
+    rp->tasks[hook_id]                    = *task;
+    rp->radio_params[hook_id]             = *radio_params;
+    rp->payload[hook_id]                  = payload;
+    rp->payload_size[hook_id]             = payload_size;
+    rp->tasks[hook_id].start_time_init_ms = rp->tasks[hook_id].start_time_ms;
+    rp_task_set_priority( rp, hook_id );
+    BSP_DBG_TRACE_PRINTF_RP( "RP: Task #%u enqueue with #%u priority\n", hook_id, rp->tasks[hook_id].priority );
+    rp_task_update_ranking( rp, hook_id );
+}
+
+static void rp_task_queue_flush( radio_planner_t* rp, const uint8_t hook_id )
+{
+    uint8_t kept_nb = 0;
+
+    // compact the queue, the tasks of the other hooks keep their order
+    for( uint8_t i = 0; i < rp->queue_nb; i++ )
+    {
+        if( rp->queue[i].task.hook_id != hook_id )
+        {
+            if( kept_nb != i )
+            {
+                rp->queue[kept_nb] = rp->queue[i];
+            }
+            kept_nb++;
+        }
+    }
+    rp->queue_nb = kept_nb;
+}
+
+static bool rp_task_queue_pop( radio_planner_t* rp, const uint8_t hook_id, const uint32_t now )
+{
+    uint8_t i = 0;
+
+    while( ( i < rp->queue_nb ) && ( rp->queue[i].task.hook_id != hook_id ) )
+    {
+        i++;
+    }
+    if( i == rp->queue_nb )
+    {
+        return false;
+    }
+    if( ( rp->queue[i].run_if_status_mask & RP_CHAIN_IF( rp->status[hook_id] ) ) == 0 )
+    {
+        BSP_DBG_TRACE_PRINTF_RP( "RP: Chain of hook #%u ends on status %u\n", hook_id, rp->status[hook_id] );
+        rp_task_queue_flush( rp, hook_id );
+        return false;
+    }
+
+    rp_task_queue_entry_t entry = rp->queue[i];
+
+    for( ; ( i + 1 ) < rp->queue_nb; i++ )
+    {
+        rp->queue[i] = rp->queue[i + 1];
+    }
+    rp->queue_nb--;
+
+    // the start time of a chained task is relative to the end of the previous one
+    entry.task.start_time_ms += now;
+    rp_task_set( rp, &entry.task, entry.payload, entry.payload_size, &entry.radio_params );
+    return true;
+}
+
 static void rp_task_free( const radio_planner_t* rp, rp_task_t* task )
 {
     task->hook_id            = 0;
@@ -290,6 +662,7 @@ static void rp_task_free( const radio_planner_t* rp, rp_task_t* task )
     task->duration_time_ms   = 0;
     task->type               = RP_TASK_TYPE_NONE;
     task->state              = RP_TASK_STATE_FINISHED;
+    task->preempt_policy     = RP_TASK_PREEMPT_ABORT;
 }
 
 static void rp_task_update_time( radio_planner_t* rp, uint32_t now )
@@ -310,16 +683,21 @@ static void rp_task_update_time( radio_planner_t* rp, uint32_t now )
                 // Schedule the task @ now + RP_TASK_RE_SCHEDULE_OFFSET_TIME
                 // seconds
                 rp->tasks[i].start_time_ms = now + RP_TASK_RE_SCHEDULE_OFFSET_TIME;
-                rp->tasks[i].priority      = ( rp->tasks[i].state * RP_NB_HOOKS ) + i;
+                rp_task_set_priority( rp, i );
                 BSP_DBG_TRACE_PRINTF_RP( "RP: WARNING - SWITCH TASK FROM ASAP TO SCHEDULE \n" );
-                rp_task_compute_ranking( rp );
+                rp_task_update_ranking( rp, i );
             }
         }
     }
 
     if( ( rp->tasks[rp->radio_task_id].state == RP_TASK_STATE_RUNNING ) &&
         ( ( rp->tasks[rp->radio_task_id].type == RP_TASK_TYPE_RX_LORA ) ||
-          ( rp->tasks[rp->radio_task_id].type == RP_TASK_TYPE_RX_FSK ) ) )
+          ( rp->tasks[rp->radio_task_id].type == RP_TASK_TYPE_RX_FSK ) ||
+          ( rp->tasks[rp->radio_task_id].type == RP_TASK_TYPE_RX_FLRC ) ||
+          ( rp->tasks[rp->radio_task_id].type == RP_TASK_TYPE_RX_LORA_DUTY_CYCLE ) ||
+          ( rp->tasks[rp->radio_task_id].type == RP_TASK_TYPE_RSSI_SCAN ) ||
+          ( ( rp->tasks[rp->radio_task_id].type == RP_TASK_TYPE_RANGING ) &&
+            ( rp->radio_params[rp->radio_task_id].ranging.params.role == RAL_RANGING_ROLE_SLAVE ) ) ) )
     {
         rp->tasks[rp->radio_task_id].duration_time_ms =
             now + RP_MARGIN_DELAY + 2 - rp->tasks[rp->radio_task_id].start_time_ms;
@@ -329,11 +707,16 @@ static void rp_task_update_time( radio_planner_t* rp, uint32_t now )
 
 static void rp_task_arbiter( radio_planner_t* rp, const char* caller_func_name )
 {
+    if( rp->is_suspended == true )
+    {  // nothing is launched nor called back until rp_resume
+        return;
+    }
     uint32_t now = rp_bsp_timestamp_get( );
 
     // Update time for ASAP task to now. But, also extended duration in case of
     // running task is a RX task
     rp_task_update_time( rp, now );
+    rp_task_update_priorities( rp, now );
 
     // Select the high priority task
     if( rp_task_select_next( rp, now ) == RP_SOMETHING_TO_DO )
@@ -346,7 +729,7 @@ static void rp_task_arbiter( radio_planner_t* rp, const char* caller_func_name )
             caller_func_name, rp->priority_task.hook_id, rp->timer_hook_id, delay, now );
 
         // Case where the high priority task is in the future
-        if( delay > RP_MARGIN_DELAY )
+        if( delay > ( int32_t ) rp_task_get_lead_time( rp, rp->priority_task.hook_id ) )
         {  // The high priority task is in the future
             BSP_DBG_TRACE_PRINTF_RP( " RP: High priority task is in the future\n" );
         }
@@ -368,6 +751,8 @@ static void rp_task_arbiter( radio_planner_t* rp, const char* caller_func_name )
             {  // Radio is already running
                 if( rp->tasks[rp->radio_task_id].hook_id != rp->priority_task.hook_id )
                 {  // priority task not equal to radio task => abort radio task
+                    uint8_t preempted_task_id = rp->radio_task_id;
+
                     rp->tasks[rp->radio_task_id].state = RP_TASK_STATE_ABORTED;
                     BSP_DBG_TRACE_PRINTF_RP( "RP: Abort running task with hook #%u\n", rp->radio_task_id );
                     ral_clear_irq_status( rp->ral, RAL_IRQ_ALL );
@@ -376,12 +761,17 @@ static void rp_task_arbiter( radio_planner_t* rp, const char* caller_func_name )
                     // Shut Down the TCXO
                     ral_set_tcxo_off( rp->ral );
 
-                    rp->semaphore_abort_radio = rp_bsp_irq_get_pending( );
+                    // The IRQ of the aborted task can still be pending or waiting for its bottom half
+                    rp->semaphore_abort_radio =
+                        ( ( rp_bsp_irq_get_pending( ) == 1 ) || ( rp->radio_irq_pending == 1 ) ) ? 1 : 0;
 
-                    rp_consumption_statistics_updated( rp, rp->radio_task_id, rp_bsp_timestamp_get( ) );
+                    rp_consumption_statistics_updated( rp, rp->radio_task_id, rp_bsp_timestamp_get( ),
+                                                       rp_bsp_timestamp_us_get( ) );
 
                     rp->radio_task_id                  = rp->priority_task.hook_id;
                     rp->tasks[rp->radio_task_id].state = RP_TASK_STATE_RUNNING;
+                    // the running priority task is known here to find the next gap of the preempted one
+                    rp_task_preempt( rp, preempted_task_id, now );
                     rp_task_launch_current( rp );
                 }  // else case already managed during enqueue task
             }
@@ -395,11 +785,12 @@ static void rp_task_arbiter( radio_planner_t* rp, const char* caller_func_name )
         // Timer has expired on a not priority task => Have to abort this task
         int32_t tmp = ( int32_t )( rp->tasks[rp->timer_hook_id].start_time_ms - now );
 
-        if( ( tmp > 0 ) && ( tmp < RP_MARGIN_DELAY ) && ( rp->next_state_status == RP_STATUS_HAVE_TO_SET_TIMER ) &&
+        if( ( tmp > 0 ) && ( tmp < ( int32_t ) rp_task_get_lead_time( rp, rp->timer_hook_id ) ) &&
+            ( rp->next_state_status == RP_STATUS_HAVE_TO_SET_TIMER ) &&
             ( rp->timer_hook_id != rp->priority_task.hook_id ) )
         {
-            BSP_DBG_TRACE_PRINTF_RP( " RP: Aborted task with hook #%u - not a priority task\n ", rp->timer_hook_id );
-            rp->tasks[rp->timer_hook_id].state = RP_TASK_STATE_ABORTED;
+            BSP_DBG_TRACE_PRINTF_RP( " RP: Preempted task with hook #%u - not a priority task\n ", rp->timer_hook_id );
+            rp_task_preempt( rp, rp->timer_hook_id, now );
         }
 
         // Execute the garbage collection if the radio isn't running
@@ -409,19 +800,7 @@ static void rp_task_arbiter( radio_planner_t* rp, const char* caller_func_name )
         }
 
         // Set the Timer to the next Task
-        rp->next_state_status = rp_task_get_next( rp, &rp->timer_value, &rp->timer_hook_id, rp_bsp_timestamp_get( ) );
-
-        if( rp->next_state_status == RP_STATUS_HAVE_TO_SET_TIMER )
-        {
-            if( rp->timer_value > RP_MARGIN_DELAY )
-            {
-                rp_set_alarm( rp, rp->timer_value - RP_MARGIN_DELAY );
-            }
-            else
-            {
-                rp_set_alarm( rp, 1 );
-            }
-        }
+        rp_task_set_next_alarm( rp );
     }
     else
     {  // No more tasks in the radio planner
@@ -432,47 +811,58 @@ static void rp_task_arbiter( radio_planner_t* rp, const char* caller_func_name )
 
 static void rp_irq_get_status( radio_planner_t* rp, const uint8_t hook_id )
 {
-    ral_irq_t radio_irq = 0;
+    ral_irq_t              radio_irq        = 0;
+    ral_rx_buffer_status_t rx_buffer_status = { 0 };
 
 #if defined( SX126X )
     // TODO remove when ral sx126 is ready
     ral_get_irq_status( rp->ral, &radio_irq );
+    ral_clear_irq_status( rp->ral, RAL_IRQ_ALL );
 #else
-    ral_process_irq( rp->ral, &radio_irq );
+    // Status, clear and packet location in a single radio wake-up
+    ral_process_and_clear_irq( rp->ral, &radio_irq, &rx_buffer_status );
 #endif
 
     BSP_DBG_TRACE_PRINTF_RP( " RP: IRQ source - 0x%04X\n", radio_irq );
-    ral_clear_irq_status( rp->ral, RAL_IRQ_ALL );
+    RP_TRACE( RP_TRACE_EVENT_RADIO_IRQ, hook_id, rp->radio_irq_timestamp_ms, 0, 0, radio_irq );
     // Do not modify the order of the next if / else if process
-    if( ( radio_irq & RAL_IRQ_TX_DONE ) == RAL_IRQ_TX_DONE )
+    if( rp->tasks[hook_id].type == RP_TASK_TYPE_RSSI_SCAN )
+    {
+        // the samples were taken at trigger time, the Rx timeout only ends the task
+        rp->status[hook_id] = RP_STATUS_RSSI_SCAN_DONE;
+    }
+    else if( ( radio_irq & RAL_IRQ_RANGING_DONE ) == RAL_IRQ_RANGING_DONE )
+    {
+        rp->status[hook_id] = RP_STATUS_RANGING_DONE;
+        if( rp->radio_params[hook_id].ranging.params.role == RAL_RANGING_ROLE_MASTER )
+        {
+            ral_get_ranging_result( rp->ral, &rp->radio_params[hook_id].ranging.params,
+                                    &rp->radio_params[hook_id].ranging.distance_in_cm );
+        }
+    }
+    else if( ( ( radio_irq & RAL_IRQ_RANGING_TIMEOUT ) == RAL_IRQ_RANGING_TIMEOUT ) ||
+             ( ( rp->tasks[hook_id].type == RP_TASK_TYPE_RANGING ) &&
+               ( ( radio_irq & RAL_IRQ_RX_TIMEOUT ) == RAL_IRQ_RX_TIMEOUT ) ) )
+    {
+        rp->status[hook_id] = RP_STATUS_RANGING_TIMEOUT;
+    }
+    else if( ( radio_irq & RAL_IRQ_TX_DONE ) == RAL_IRQ_TX_DONE )
     {
         rp->status[hook_id] = RP_STATUS_TX_DONE;
-#if defined( PERF_TEST_ENABLED )
-        tx_done_count++;
-        BSP_PERF_TEST_TRACE_PRINTF( "RADIO IRQ: TX DONE\n" );
-        BSP_PERF_TEST_TRACE_PRINTF( "tx_done_count:%lu\n", tx_done_count );
-#endif
+        BSP_PERF_EVENT( BSP_PERF_EVENT_TX_DONE, hook_id );
     }
     else if( ( ( radio_irq & RAL_IRQ_RX_TIMEOUT ) == RAL_IRQ_RX_TIMEOUT ) ||
              ( ( radio_irq & RAL_IRQ_RX_HDR_ERROR ) == RAL_IRQ_RX_HDR_ERROR ) ||
              ( ( radio_irq & RAL_IRQ_RX_CRC_ERROR ) == RAL_IRQ_RX_CRC_ERROR ) )
     {
         rp->status[hook_id] = RP_STATUS_RX_TIMEOUT;
-#if defined( PERF_TEST_ENABLED )
-        rx_timeout_count++;
-        BSP_PERF_TEST_TRACE_PRINTF( "RADIO IRQ: RX_TIMEOUT or HDR_ERROR or CRC_ERROR\n" );
-        BSP_PERF_TEST_TRACE_PRINTF( "rx_timeout_count:%lu\n", rx_timeout_count );
-#endif
+        BSP_PERF_EVENT( BSP_PERF_EVENT_RX_TIMEOUT, hook_id );
     }
     else if( ( radio_irq & RAL_IRQ_RX_DONE ) == RAL_IRQ_RX_DONE )
     {
         rp->status[hook_id] = RP_STATUS_RX_PACKET;
-        rp_get_pkt_payload( rp, &rp->tasks[hook_id] );
-#if defined( PERF_TEST_ENABLED )
-        rx_done_count++;
-        BSP_PERF_TEST_TRACE_PRINTF( "RADIO IRQ: RX_DONE\n" );
-        BSP_PERF_TEST_TRACE_PRINTF( "rx_done_count:%lu\n", rx_done_count );
-#endif
+        rp_get_pkt_payload( rp, &rp->tasks[hook_id], &rx_buffer_status );
+        BSP_PERF_EVENT( BSP_PERF_EVENT_RX_DONE, hook_id );
     }
 
     else if( ( radio_irq & RAL_IRQ_CAD_OK ) == RAL_IRQ_CAD_OK )
@@ -490,83 +880,258 @@ static void rp_irq_get_status( radio_planner_t* rp, const uint8_t hook_id )
     }
 }
 
-static void rp_task_compute_ranking( radio_planner_t* rp )
+static void rp_task_update_ranking( radio_planner_t* rp, const uint8_t hook_id )
 {
-    uint8_t rank;
-    uint8_t ranks_temp[RP_NB_HOOKS];
+    uint8_t priority = rp->tasks[hook_id].priority;
+    uint8_t index    = 0;
 
+    // The other hooks stay sorted by priority: remove the hook then insert it back at its place, in a single pass
     for( int32_t i = 0; i < RP_NB_HOOKS; i++ )
     {
-        ranks_temp[i] = rp->tasks[i].priority;
+        if( rp->rankings[i] != hook_id )
+        {
+            rp->rankings[index++] = rp->rankings[i];
+        }
     }
-    for( int32_t i = 0; i < RP_NB_HOOKS; i++ )
+    index = RP_NB_HOOKS - 1;
+    while( ( index > 0 ) && ( rp->tasks[rp->rankings[index - 1]].priority > priority ) )
     {
-        rank             = rp_task_find_highest_priority( rp, &( ranks_temp[0] ), RP_NB_HOOKS );
-        ranks_temp[rank] = 0xFF;
-        rp->rankings[i]  = rank;
+        rp->rankings[index] = rp->rankings[index - 1];
+        index--;
     }
+    rp->rankings[index] = hook_id;
 }
 
-static void rp_task_launch_current( radio_planner_t* rp )
+static void rp_task_set_priority( radio_planner_t* rp, const uint8_t hook_id )
 {
-    uint8_t id = rp->radio_task_id;
-    BSP_DBG_TRACE_PRINTF_RP( " RP: Launch task #%u and start radio state %u, type %u\n", id, rp->tasks[id].state,
-                             rp->tasks[id].type );
+    if( ( rp->arbitration[hook_id].is_protected == true ) && ( rp->tasks[hook_id].state == RP_TASK_STATE_SCHEDULE ) )
+    {
+        rp->base_priority[hook_id] = hook_id;
+    }
+    else
+    {
+        rp->base_priority[hook_id] = ( ( rp->tasks[hook_id].state + 1 ) * RP_NB_HOOKS ) + hook_id;
+    }
+    rp->tasks[hook_id].priority = rp_task_get_priority( rp, hook_id, rp_bsp_timestamp_get( ) );
+}
 
-    rp_task_print( rp, &rp->tasks[id] );
+static uint8_t rp_task_get_priority( const radio_planner_t* rp, const uint8_t hook_id, const uint32_t now )
+{
+    const rp_hook_arbitration_t* arbitration = &rp->arbitration[hook_id];
+    uint8_t                      priority    = rp->base_priority[hook_id];
 
-    // Turn on the TCXO
-    ral_set_tcxo_on( rp->ral );
+    if( rp->arbitration_is_on == false )
+    {
+        return priority;
+    }
+
+    // an aged task climbs the ranks of its state, up to the first one
+    uint8_t rank  = priority % RP_NB_HOOKS;
+    uint8_t aging = ( rp->age[hook_id] < arbitration->max_aging ) ? rp->age[hook_id] : arbitration->max_aging;
+    priority -= ( aging < rank ) ? aging : rank;
+
+    // over its share, the hook ranks after the asap tasks of the hooks within theirs
+    if( ( ( uint64_t ) rp_hook_get_airtime_ms( rp, hook_id, now ) * 100 ) >
+        ( ( uint64_t ) arbitration->airtime_share_percent * RP_AIRTIME_WINDOW_MS ) )
+    {
+        priority += 2 * RP_NB_HOOKS;
+    }
+    return priority;
+}
+
+static void rp_task_update_priorities( radio_planner_t* rp, const uint32_t now )
+{
+    if( rp->arbitration_is_on == false )
+    {
+        return;
+    }
+
+    if( ( int32_t )( now - rp->airtime_window_start_ms ) >= RP_AIRTIME_WINDOW_MS )
+    {
+        rp->airtime_window_start_ms = now;
+        for( int32_t i = 0; i < RP_NB_HOOKS; i++ )
+        {
+            rp->airtime_base_ms[i] = rp->stats.tx_consumption_ms[i] + rp->stats.rx_consumption_ms[i];
+        }
+    }
+
+    // the running task is ranked too, a starved task can then preempt it
+    for( int32_t i = 0; i < RP_NB_HOOKS; i++ )
+    {
+        if( rp->tasks[i].state > RP_TASK_STATE_RUNNING )
+        {
+            continue;
+        }
+        uint8_t priority = rp_task_get_priority( rp, i, now );
+        if( priority != rp->tasks[i].priority )
+        {
+            rp->tasks[i].priority = priority;
+            rp_task_update_ranking( rp, i );
+        }
+    }
+}
+
+static uint32_t rp_hook_get_airtime_ms( const radio_planner_t* rp, const uint8_t hook_id, const uint32_t now )
+{
+    uint32_t airtime_ms =
+        rp->stats.tx_consumption_ms[hook_id] + rp->stats.rx_consumption_ms[hook_id] - rp->airtime_base_ms[hook_id];
+
+    // the statistics only account a task at its end
+    if( ( rp->radio_task_id == hook_id ) && ( rp->tasks[hook_id].state == RP_TASK_STATE_RUNNING ) )
+    {
+        uint32_t since_ms = ( rp->stats.tx_timestamp != 0 ) ? rp->stats.tx_timestamp : rp->stats.rx_timestamp;
+
+        if( since_ms != 0 )
+        {
+            if( ( int32_t )( since_ms - rp->airtime_window_start_ms ) < 0 )
+            {
+                since_ms = rp->airtime_window_start_ms;
+            }
+            airtime_ms += now - since_ms;
+        }
+    }
+    return airtime_ms;
+}
+
+static void rp_task_preempt( radio_planner_t* rp, const uint8_t hook_id, const uint32_t now )
+{
+    rp_task_t* task = &rp->tasks[hook_id];
+
+    if( ( task->preempt_policy == RP_TASK_PREEMPT_ABORT ) ||
+        ( ( int32_t )( now - task->start_time_init_ms ) > RP_TASK_ASAP_TO_SCHEDULE_TRIG_TIME ) )
+    {
+        task->state = RP_TASK_STATE_ABORTED;
+        return;
+    }
+
+    if( task->preempt_policy == RP_TASK_PREEMPT_DEFER )
+    {
+        task->state         = RP_TASK_STATE_ASAP;
+        task->start_time_ms = now;
+    }
+    else
+    {
+        task->state         = RP_TASK_STATE_SCHEDULE;
+        task->start_time_ms = rp_task_find_next_gap( rp, hook_id, now + RP_MARGIN_DELAY + 1, task->duration_time_ms );
+    }
+    if( rp->age[hook_id] < 0xFF )
+    {
+        rp->age[hook_id]++;
+    }
+    rp_task_set_priority( rp, hook_id );
+    rp_task_update_ranking( rp, hook_id );
+    rp->stats.task_hook_postponed_nb[hook_id]++;
+    BSP_DBG_TRACE_PRINTF_RP( " RP: Task #%u postponed, state %u at %lu ms\n", hook_id, task->state,
+                             task->start_time_ms );
+}
+
+static uint32_t rp_task_find_next_gap( const radio_planner_t* rp, const uint8_t hook_id, uint32_t start,
+                                       const uint32_t duration_ms )
+{
+    const uint32_t duration       = duration_ms + RP_MARGIN_DELAY;
+    bool           is_overlapping = true;
+
+    // Each pass moves start after a colliding task: the tasks are all passed after RP_NB_HOOKS passes at most
+    for( int32_t pass = 0; ( pass < RP_NB_HOOKS ) && ( is_overlapping == true ); pass++ )
+    {
+        is_overlapping = false;
+        for( int32_t i = 0; i < RP_NB_HOOKS; i++ )
+        {
+            const rp_task_t* other = &rp->tasks[i];
+
+            if( ( i == hook_id ) || ( other->state > RP_TASK_STATE_RUNNING ) )
+            {
+                continue;
+            }
+            uint32_t end = other->start_time_ms + other->duration_time_ms + RP_MARGIN_DELAY;
+            if( ( ( int32_t )( other->start_time_ms - ( start + duration ) ) < 0 ) &&
+                ( ( int32_t )( end - start ) > 0 ) )
+            {
+                start          = end;
+                is_overlapping = true;
+            }
+        }
+    }
+    return start;
+}
+
+static void rp_task_launch_current( radio_planner_t* rp )
+{
+    uint8_t id = rp->radio_task_id;
+    BSP_DBG_TRACE_PRINTF_RP( " RP: Launch task #%u and start radio state %u, type %u\n", id, rp->tasks[id].state,
+                             rp->tasks[id].type );
+
+    rp_task_print( rp, &rp->tasks[id] );
+    if( ( rp->tasks[id].type == RP_TASK_TYPE_TX_LORA ) || ( rp->tasks[id].type == RP_TASK_TYPE_TX_FSK ) ||
+        ( rp->tasks[id].type == RP_TASK_TYPE_TX_FLRC ) || ( rp->tasks[id].type == RP_TASK_TYPE_TX_BLE ) )
+    {
+        BSP_PERF_EVENT( BSP_PERF_EVENT_TX_LAUNCH, id );
+    }
+
+    // Turn on the TCXO, it settles while the radio is configured and until the start time
+    ral_set_tcxo_on( rp->ral );
+    const uint32_t setup_start_ms = rp_bsp_timestamp_get( );
+
+    // Power modes chosen by the task owner, the RAL only sends the ones that changed (no-op on radios without them)
+    ral_set_reg_mode( rp->ral, rp->radio_params[id].reg_mode );
+    if( ( rp->tasks[id].type == RP_TASK_TYPE_RX_LORA ) || ( rp->tasks[id].type == RP_TASK_TYPE_RX_FSK ) ||
+        ( rp->tasks[id].type == RP_TASK_TYPE_RX_FLRC ) || ( rp->tasks[id].type == RP_TASK_TYPE_RX_LORA_DUTY_CYCLE ) ||
+        ( rp->tasks[id].type == RP_TASK_TYPE_CAD ) || ( rp->tasks[id].type == RP_TASK_TYPE_RANGING ) ||
+        ( rp->tasks[id].type == RP_TASK_TYPE_RSSI_SCAN ) )
+    {
+        ral_set_lna_mode( rp->ral, rp->radio_params[id].lna_mode );
+    }
 
+    // Stage 1: configure the radio, the trigger command is sent at start time by rp_task_trigger_current
     switch( rp->tasks[id].type )
     {
     case RP_TASK_TYPE_TX_LORA:
+#if !defined( SX1280 )
+        // the SX1280 keeps its configuration in sleep with retention, only changed settings are sent by the RAL
         ral_init( rp->ral );
+#endif
         ral_setup_tx_lora( rp->ral, &rp->radio_params[id].tx.lora );
         ral_set_pkt_payload( rp->ral, rp->payload[id], rp->payload_size[id] );
-        // Wait the exact time
-        while( ( int32_t )( rp->tasks[id].start_time_ms - rp_bsp_timestamp_get( ) ) > 0 )
-        {
-            // Do nothing
-        }
-        ral_set_tx( rp->ral );
-        rp_stats_set_tx_timestamp( &rp->stats, rp_bsp_timestamp_get( ) );
         break;
     case RP_TASK_TYPE_RX_LORA:
+    case RP_TASK_TYPE_RX_LORA_DUTY_CYCLE:
 #if defined( SX126X )
         ral_init( rp->ral );
 #endif
         ral_setup_rx_lora( rp->ral, &rp->radio_params[id].rx.lora );
-        // Wait the exact time
-        while( ( int32_t )( rp->tasks[id].start_time_ms - rp_bsp_timestamp_get( ) ) > 0 )
+        if( ( rp->tasks[id].type == RP_TASK_TYPE_RX_LORA ) && ( rp->radio_params[id].rx.cad_gate_is_on == true ) )
         {
+            ral_lora_cad_params_t cad_params = {
+                .cad_symb_nb          = RAL_LORA_CAD_01_SYMB,
+                .cad_det_peak_in_symb = 0,  // not used
+                .cad_det_min_in_symb  = 0,  // not used
+                .cad_exit_mode        = RAL_LORA_CAD_RX,
+                .cad_timeout_in_ms    = rp->radio_params[id].rx.timeout_in_ms,
+            };
+            ral_setup_cad( rp->ral, &cad_params );
         }
-        ral_set_rx( rp->ral, rp->radio_params[id].rx.timeout_in_ms );
-
-        rp_stats_set_rx_timestamp( &rp->stats, rp_bsp_timestamp_get( ) );
         break;
     case RP_TASK_TYPE_TX_FSK:
+#if !defined( SX1280 )
         ral_init( rp->ral );
+#endif
         ral_setup_tx_gfsk( rp->ral, &rp->radio_params[id].tx.gfsk );
         ral_set_pkt_payload( rp->ral, rp->payload[id], rp->payload_size[id] );
-        // Wait the exact time
-        while( ( int32_t )( rp->tasks[id].start_time_ms - rp_bsp_timestamp_get( ) ) > 0 )
-        {
-        }
-        ral_set_tx( rp->ral );
-
-        rp_stats_set_tx_timestamp( &rp->stats, rp_bsp_timestamp_get( ) );
         break;
     case RP_TASK_TYPE_RX_FSK:
+    case RP_TASK_TYPE_RSSI_SCAN:
+#if !defined( SX1280 )
         ral_init( rp->ral );
+#endif
         ral_setup_rx_gfsk( rp->ral, &rp->radio_params[id].rx.gfsk );
-        // Wait the exact time
-        while( ( int32_t )( rp->tasks[id].start_time_ms - rp_bsp_timestamp_get( ) ) > 0 )
-        {
-        }
-        ral_set_rx( rp->ral, rp->radio_params[id].rx.timeout_in_ms );
-
-        rp_stats_set_rx_timestamp( &rp->stats, rp_bsp_timestamp_get( ) );
+        break;
+    case RP_TASK_TYPE_TX_FLRC:
+        // the FLRC setup invalidates the RAL shadow registers, the next LoRa task is fully configured again
+        ral_setup_tx_flrc( rp->ral, &rp->radio_params[id].tx.flrc );
+        ral_set_pkt_payload( rp->ral, rp->payload[id], rp->payload_size[id] );
+        break;
+    case RP_TASK_TYPE_RX_FLRC:
+        ral_setup_rx_flrc( rp->ral, &rp->radio_params[id].rx.flrc );
         break;
     case RP_TASK_TYPE_CAD: {
         ral_lora_cad_params_t cad_params = {
@@ -578,20 +1143,157 @@ static void rp_task_launch_current( radio_planner_t* rp )
         };
         ral_setup_rx_lora( rp->ral, &rp->radio_params[id].rx.lora );
         ral_setup_cad( rp->ral, &cad_params );
-        while( ( int32_t )( rp->tasks[id].start_time_ms - rp_bsp_timestamp_get( ) ) > 0 )
-        {
-        }
-        ral_set_cad( rp->ral );
         break;
     }
+    case RP_TASK_TYPE_RANGING:
+        ral_setup_ranging( rp->ral, &rp->radio_params[id].ranging.params );
+        break;
+    case RP_TASK_TYPE_TX_BLE:
+        // the BLE settings stay in the shadow registers, a beacon only sends the channel and its PDU
+        ral_setup_tx_ble( rp->ral, &rp->radio_params[id].tx.ble );
+        ral_set_pkt_payload( rp->ral, rp->payload[id], rp->payload_size[id] );
+        break;
     default:
         BSP_DBG_TRACE_PRINTF_RP( " RP: ERROR - Task type unknown\n" );
         // Shut Down the TCXO
         ral_set_tcxo_off( rp->ral );
+        return;
+    }
+
+    // Keep the setup time of the type up to date, the next tasks of this type are launched that long in advance
+    const uint16_t setup_time = ( uint16_t )( rp_bsp_timestamp_get( ) - setup_start_ms ) << RP_SETUP_TIME_SHIFT;
+    if( setup_time >= rp->setup_time[rp->tasks[id].type] )
+    {
+        rp->setup_time[rp->tasks[id].type] = setup_time;
+    }
+    else
+    {
+        rp->setup_time[rp->tasks[id].type] -=
+            ( rp->setup_time[rp->tasks[id].type] - setup_time ) >> RP_SETUP_TIME_SHIFT;
+    }
+
+    // Stage 2: let the MCU sleep until the start time when the remaining delay is worth it
+    int32_t delay = ( int32_t )( rp->tasks[id].start_time_ms - rp_bsp_timestamp_get( ) );
+    if( delay > RP_LAUNCH_SLEEP_MIN_DELAY )
+    {
+        rp->launch_pending = 1;
+        rp_bsp_timer_stop( rp );
+        rp_bsp_timer_start( rp, ( uint32_t ) delay, rp_launch_timer_irq_callback );
+    }
+    else
+    {
+        rp->launch_pending = 0;
+        rp_task_trigger_current( rp );
+    }
+}
+
+static void rp_task_trigger_current( radio_planner_t* rp )
+{
+    uint8_t id = rp->radio_task_id;
+
+    // Wait the exact time, the timer can expire up to one tick in advance
+    while( ( int32_t )( rp->tasks[id].start_time_ms - rp_bsp_timestamp_get( ) ) > 0 )
+    {
+    }
+    RP_TRACE( RP_TRACE_EVENT_LAUNCH, id, rp_bsp_timestamp_get( ), rp->tasks[id].start_time_ms, 0,
+              rp->tasks[id].type );
+
+    switch( rp->tasks[id].type )
+    {
+    case RP_TASK_TYPE_TX_LORA:
+    case RP_TASK_TYPE_TX_FSK:
+    case RP_TASK_TYPE_TX_FLRC:
+    case RP_TASK_TYPE_TX_BLE:
+        ral_set_tx( rp->ral );
+        rp_stats_set_tx_timestamp( &rp->stats, rp_bsp_timestamp_get( ), rp_bsp_timestamp_us_get( ) );
+        BSP_PERF_EVENT( BSP_PERF_EVENT_TX_START, id );
+        break;
+    case RP_TASK_TYPE_RX_LORA:
+    case RP_TASK_TYPE_RX_FSK:
+    case RP_TASK_TYPE_RX_FLRC:
+        if( ( rp->tasks[id].type == RP_TASK_TYPE_RX_LORA ) && ( rp->radio_params[id].rx.cad_gate_is_on == true ) )
+        {
+            ral_set_cad( rp->ral );
+        }
+        else
+        {
+            ral_set_rx( rp->ral, rp->radio_params[id].rx.timeout_in_ms );
+        }
+        rp_stats_set_rx_timestamp( &rp->stats, rp_bsp_timestamp_get( ) );
+        BSP_PERF_EVENT( BSP_PERF_EVENT_RX_OPEN, id );
+        break;
+    case RP_TASK_TYPE_RX_LORA_DUTY_CYCLE:
+        // the MCU can sleep until the radio IRQ, the running task is preempted by the scheduled ones
+        ral_set_rx_duty_cycle( rp->ral, rp->radio_params[id].rx.duty_cycle_rx_time_in_ms,
+                               rp->radio_params[id].rx.duty_cycle_sleep_time_in_ms );
+        rp_stats_set_rx_timestamp( &rp->stats, rp_bsp_timestamp_get( ) );
+        break;
+    case RP_TASK_TYPE_CAD:
+        ral_set_cad( rp->ral );
+        rp_stats_set_rx_timestamp( &rp->stats, rp_bsp_timestamp_get( ) );
+        break;
+    case RP_TASK_TYPE_RANGING:
+        ral_set_ranging( rp->ral, rp->radio_params[id].ranging.params.role,
+                         rp->radio_params[id].ranging.timeout_in_ms );
+        // the master mostly transmits its request, the slave mostly listens
+        if( rp->radio_params[id].ranging.params.role == RAL_RANGING_ROLE_MASTER )
+        {
+            rp_stats_set_tx_timestamp( &rp->stats, rp_bsp_timestamp_get( ), rp_bsp_timestamp_us_get( ) );
+        }
+        else
+        {
+            rp_stats_set_rx_timestamp( &rp->stats, rp_bsp_timestamp_get( ) );
+        }
+        break;
+    case RP_TASK_TYPE_RSSI_SCAN:
+        rp_stats_set_rx_timestamp( &rp->stats, rp_bsp_timestamp_get( ) );
+        rp_rssi_scan_sweep( rp, id );
+        // a short reception ends the task through the usual Rx timeout IRQ
+        ral_set_rx( rp->ral, 1 );
+        break;
+    default:
         break;
     }
 }
 
+static uint32_t rp_task_get_lead_time( const radio_planner_t* rp, const uint8_t hook_id )
+{
+    const rp_task_types_t type = rp->tasks[hook_id].type;
+    // the setup time is rounded up, the timestamps only count whole milliseconds
+    uint32_t lead_time_ms = RP_LAUNCH_WAKEUP_DELAY + 1;
+
+    if( type < RP_TASK_TYPE_NONE )
+    {
+        lead_time_ms += rp->setup_time[type] >> RP_SETUP_TIME_SHIFT;
+    }
+    // a TCXO driven by the radio is started by the radio itself, its startup time is part of the radio timings
+    if( rp->ral->tcxo_cfg.tcxo_ctrl_mode == RAL_TCXO_CTRL_HOST_EXT )
+    {
+        lead_time_ms += rp->ral->tcxo_cfg.tcxo_startup_time_ms;
+    }
+    return lead_time_ms;
+}
+
+static void rp_task_set_next_alarm( radio_planner_t* rp )
+{
+    rp->next_state_status = rp_task_get_next( rp, &rp->timer_value, &rp->timer_hook_id, rp_bsp_timestamp_get( ) );
+
+    // The timer is owned by the pending launch, the alarm is set again once the radio is triggered
+    if( ( rp->next_state_status == RP_STATUS_HAVE_TO_SET_TIMER ) && ( rp->launch_pending == 0 ) )
+    {
+        const uint32_t lead_time_ms = rp_task_get_lead_time( rp, rp->timer_hook_id );
+
+        if( rp->timer_value > lead_time_ms )
+        {
+            rp_set_alarm( rp, rp->timer_value - lead_time_ms );
+        }
+        else
+        {
+            rp_set_alarm( rp, 1 );
+        }
+    }
+}
+
 static uint8_t rp_task_select_next( radio_planner_t* rp, const uint32_t now )
 {
     uint8_t  hook_to_exe_tmp      = 0xFF;
@@ -690,30 +1392,51 @@ static rp_next_state_status_t rp_task_get_next( radio_planner_t* rp, uint32_t* d
     return RP_STATUS_HAVE_TO_SET_TIMER;
 }
 
-static uint8_t rp_task_find_highest_priority( const radio_planner_t* rp, uint8_t* vector, uint8_t length )
+rp_hook_status_t rp_get_pkt_payload( radio_planner_t* rp, const rp_task_t* task,
+                                     const ral_rx_buffer_status_t* rx_buffer_status )
 {
-    uint8_t priority_high = 0xFF;
-    uint8_t index         = 0;
+    rp_hook_status_t status      = RP_HOOK_STATUS_OK;
+    uint8_t          id          = task->hook_id;
+    uint8_t          header_size = rp->rx_filter_size[id];
+    bool             is_dropped  = false;
+
+#if defined( SX126X )
+    ral_get_pkt_payload( rp->ral, rp->payload[id], rp->payload_size[id], &rp->payload_size[id] );
+    if( ( rp->rx_filter[id] != NULL ) && ( rp->payload_size[id] >= header_size ) )
+    {
+        is_dropped = !rp->rx_filter[id]( rp->hooks[id], rp->payload[id], header_size );
+    }
+#else
+    uint16_t pld_len = rx_buffer_status->pld_len_in_bytes;
 
-    for( int32_t i = 0; i < length; i++ )
+    if( ( rp->rx_filter[id] != NULL ) && ( pld_len >= header_size ) && ( pld_len <= rp->payload_size[id] ) )
     {
-        if( vector[i] <= priority_high )
+        // the header alone decides, the payload of a frame for another device stays in the radio
+        ral_read_pkt_payload_part( rp->ral, rx_buffer_status, 0, rp->payload[id], header_size );
+        is_dropped = !rp->rx_filter[id]( rp->hooks[id], rp->payload[id], header_size );
+        if( is_dropped == false )
         {
-            priority_high = vector[i];
-            index         = i;
+            ral_read_pkt_payload_part( rp->ral, rx_buffer_status, header_size, &rp->payload[id][header_size],
+                                       pld_len - header_size );
+            rp->payload_size[id] = pld_len;
         }
     }
-    return index;
-}
-
-rp_hook_status_t rp_get_pkt_payload( radio_planner_t* rp, const rp_task_t* task )
-{
-    rp_hook_status_t status = RP_HOOK_STATUS_OK;
-    uint8_t          id     = task->hook_id;
+    else
+    {
+        ral_read_pkt_payload( rp->ral, rx_buffer_status, rp->payload[id], rp->payload_size[id],
+                              &rp->payload_size[id] );
+    }
+#endif
 
-    ral_get_pkt_payload( rp->ral, rp->payload[id], rp->payload_size[id], &rp->payload_size[id] );
+    if( is_dropped == true )
+    {
+        BSP_DBG_TRACE_PRINTF_RP( " RP: frame dropped by the filter of hook %u\n", id );
+        rp->payload_size[id] = 0;
+        rp->status[id]       = RP_STATUS_RX_TIMEOUT;
+        return status;
+    }
 
-    if( task->type == RP_TASK_TYPE_RX_LORA )
+    if( ( task->type == RP_TASK_TYPE_RX_LORA ) || ( task->type == RP_TASK_TYPE_RX_LORA_DUTY_CYCLE ) )
     {
         rp->radio_params[id].pkt_type = RAL_PKT_TYPE_LORA;
         status                        = RP_HOOK_STATUS_OK;
@@ -727,6 +1450,13 @@ rp_hook_status_t rp_get_pkt_payload( radio_planner_t* rp, const rp_task_t* task
 
         ral_get_gfsk_pkt_status( rp->ral, &rp->radio_params[id].rx.gfsk_pkt_status );
     }
+    else if( task->type == RP_TASK_TYPE_RX_FLRC )
+    {
+        rp->radio_params[id].pkt_type = RAL_PKT_TYPE_FLRC;
+        status                        = RP_HOOK_STATUS_OK;
+
+        ral_get_flrc_pkt_status( rp->ral, &rp->radio_params[id].rx.flrc_pkt_status );
+    }
     else
     {
         status = RP_HOOK_STATUS_ID_ERROR;
@@ -737,45 +1467,77 @@ rp_hook_status_t rp_get_pkt_payload( radio_planner_t* rp, const rp_task_t* task
 
 static void rp_set_alarm( radio_planner_t* rp, const uint32_t alarm_in_ms )
 {
-    rp_bsp_timer_stop( );
-    // test could be managed inside the bsp
-    rp_bsp_timer_start( rp, ( alarm_in_ms > 0xFFFF ) ? 0xFFFF : alarm_in_ms, rp_timer_irq_callback );
+    rp_bsp_timer_stop( rp );
+    // the bsp timer chains its timeouts: a task far in the future does not wake up the arbiter before its time
+    rp_bsp_timer_start( rp, alarm_in_ms, rp_timer_irq_callback );
 }
 
 static void rp_timer_irq( radio_planner_t* rp )
 {
+    RP_TRACE( RP_TRACE_EVENT_TIMER_IRQ, rp->timer_task_id, rp_bsp_timestamp_get( ), 0, 0, 0 );
     rp->timer_state = RP_TIMER_STATE_IDLE;
     rp_task_arbiter( rp, __func__ );
 }
 
-static void rp_radio_irq( radio_planner_t* rp )
+static void rp_launch_timer_irq( radio_planner_t* rp )
+{
+    if( rp->launch_pending == 0 )
+    {
+        return;
+    }
+    rp->launch_pending = 0;
+    RP_TRACE( RP_TRACE_EVENT_TIMER_IRQ, rp->radio_task_id, rp_bsp_timestamp_get( ), 1, 0, 0 );
+
+    // The task can have been aborted while the MCU was sleeping
+    if( rp->tasks[rp->radio_task_id].state == RP_TASK_STATE_RUNNING )
+    {
+        rp_task_trigger_current( rp );
+    }
+    rp_task_set_next_alarm( rp );
+}
+
+BSP_RAMFUNC static void rp_radio_irq( radio_planner_t* rp )
 {
     if( rp->semaphore_abort_radio == 1 )
     {
         rp->semaphore_abort_radio = 0;
         BSP_DBG_TRACE_PRINTF_RP( " RP: INFO - semaphore_abort_radio clear\n" );
+        // no flags: the replay only has to raise the IRQ line of the aborted task
+        RP_TRACE( RP_TRACE_EVENT_RADIO_IRQ, rp->radio_task_id, rp->radio_irq_timestamp_ms, 0, 0, 0 );
     }
     else
     {
         rp->semaphore_radio = 1;
 
-        uint32_t now = rp_bsp_timestamp_get( );
+        uint32_t now = rp->radio_irq_timestamp_ms;
 
         rp->irq_timestamp_ms[rp->radio_task_id] = now;
+        rp->irq_timestamp_us[rp->radio_task_id] = rp->radio_irq_timestamp_us;
         BSP_DBG_TRACE_PRINTF_RP( " RP: INFO - Radio IRQ received for hook #%u\n", rp->radio_task_id );
 
         rp_irq_get_status( rp, rp->radio_task_id );
 
-        rp_consumption_statistics_updated( rp, rp->radio_task_id, now );
+        if( rp_task_cad_gate_is_open( rp, rp->radio_task_id ) == true )
+        {  // the reception goes on within the same task, the TCXO stays on
+            rp->semaphore_radio = 0;
+            return;
+        }
+
+        rp_consumption_statistics_updated( rp, rp->radio_task_id, now, rp->radio_irq_timestamp_us );
+        rp->age[rp->radio_task_id] = 0;
 
         // Have to call rp_task_free before rp_hook_callback because the callback can enqueued a task and so call the
         // arbiter
         rp_task_free( rp, &rp->tasks[rp->radio_task_id] );
-        ral_set_sleep( rp->ral );
+        // the next task of a chain is in place before the callback and is launched by the arbiter below
+        rp_task_queue_pop( rp, rp->radio_task_id, now );
         rp_hook_callback( rp, rp->radio_task_id );
 
         rp_task_call_aborted( rp );
 
+        // After the callbacks, the sleep mode depends on the tasks they have enqueued (i.e. RX windows after a TX)
+        rp_radio_set_sleep( rp );
+
         rp->semaphore_radio = 0;
 
         rp_task_arbiter( rp, __func__ );
@@ -785,6 +1547,56 @@ static void rp_radio_irq( radio_planner_t* rp )
     ral_set_tcxo_off( rp->ral );
 }
 
+static bool rp_task_cad_gate_is_open( radio_planner_t* rp, const uint8_t hook_id )
+{
+    if( ( rp->tasks[hook_id].type != RP_TASK_TYPE_RX_LORA ) ||
+        ( rp->radio_params[hook_id].rx.cad_gate_is_on == false ) )
+    {
+        return false;
+    }
+    rp->radio_params[hook_id].rx.cad_gate_is_on = false;
+    if( rp->status[hook_id] == RP_STATUS_CAD_NEGATIVE )
+    {
+        rp->status[hook_id] = RP_STATUS_RX_TIMEOUT;
+        return false;
+    }
+    if( rp->status[hook_id] != RP_STATUS_CAD_POSITIVE )
+    {
+        return false;
+    }
+    // the Rx interrupts replace the CAD ones, the rest of the configuration is kept
+    ral_setup_rx_lora( rp->ral, &rp->radio_params[hook_id].rx.lora );
+    ral_set_rx( rp->ral, rp->radio_params[hook_id].rx.timeout_in_ms );
+    BSP_PERF_EVENT( BSP_PERF_EVENT_RX_OPEN, hook_id );
+    return true;
+}
+
+static void rp_rssi_scan_sweep( radio_planner_t* rp, const uint8_t hook_id )
+{
+    const rp_radio_params_t* params = &rp->radio_params[hook_id];
+
+    ral_set_rx( rp->ral, 0xFFFFFFFF );
+    for( uint8_t i = 0; i < params->rssi_scan.freq_nb; i++ )
+    {
+        uint8_t busy_nb = 0;
+
+        ral_set_rf_freq( rp->ral, params->rssi_scan.freq_in_hz[i] );
+        bsp_mcu_wait_us( RP_RSSI_SCAN_SETTLE_US );
+        for( uint8_t j = 0; j < params->rssi_scan.sample_nb; j++ )
+        {
+            int16_t rssi = 0;
+
+            if( ( ral_get_rssi( rp->ral, &rssi ) == RAL_STATUS_OK ) &&
+                ( rssi >= params->rssi_scan.busy_threshold_in_dbm ) )
+            {
+                busy_nb++;
+            }
+        }
+        params->rssi_scan.busy_nb[i] = busy_nb;
+    }
+    ral_set_standby( rp->ral );
+}
+
 static void rp_task_call_aborted( radio_planner_t* rp )
 {
     for( int32_t i = 0; i < RP_NB_HOOKS; i++ )
@@ -793,30 +1605,108 @@ static void rp_task_call_aborted( radio_planner_t* rp )
         {
             BSP_DBG_TRACE_PRINTF_RP( " RP: INFO - Aborted hook #%ld callback\n", i );
             rp->stats.task_hook_aborted_nb[i]++;
+            if( rp->age[i] < 0xFF )
+            {
+                rp->age[i]++;
+            }
             rp_task_free( rp, &rp->tasks[i] );
+            rp_task_queue_flush( rp, i );
             rp->status[i] = RP_STATUS_TASK_ABORTED;
+            RP_TRACE( RP_TRACE_EVENT_ABORTED, i, rp_bsp_timestamp_get( ), 0, 0, 0 );
             rp_hook_callback( rp, i );
         }
     }
 }
 
+static void rp_radio_set_sleep( radio_planner_t* rp )
+{
+    uint32_t        now = rp_bsp_timestamp_get( );
+    ral_sleep_cfg_t cfg = RAL_SLEEP_CFG_COLD_START;
+
+    for( int32_t i = 0; i < RP_NB_HOOKS; i++ )
+    {
+        if( ( rp->tasks[i].state == RP_TASK_STATE_ASAP ) ||
+            ( ( rp->tasks[i].state == RP_TASK_STATE_SCHEDULE ) &&
+              ( ( int32_t )( rp->tasks[i].start_time_ms - now ) < RP_WARM_SLEEP_MAX_GAP_MS ) ) )
+        {
+            cfg = RAL_SLEEP_CFG_WARM_START;
+            break;
+        }
+    }
+
+    ral_set_sleep_with_cfg( rp->ral, cfg );
+}
+
+static void rp_irq_bottom_half( radio_planner_t* rp )
+{
+    // The launch starts an on-air task at its exact time, the radio IRQ holds the radio result and the timer only
+    // runs the arbiter. Each flag is cleared before its work so that a new IRQ is served by the next loop.
+    while( 1 )
+    {
+        if( rp->launch_irq_pending == 1 )
+        {
+            rp->launch_irq_pending = 0;
+            rp_launch_timer_irq( rp );
+        }
+        else if( rp->radio_irq_pending == 1 )
+        {
+            rp->radio_irq_pending = 0;
+            rp_radio_irq( rp );
+        }
+        else if( rp->timer_irq_pending == 1 )
+        {
+            rp->timer_irq_pending = 0;
+            rp_timer_irq( rp );
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
 //
 // Radio planner callbacks
 //
 
 void rp_radio_irq_callback( void* obj )
 {
-    rp_radio_irq( ( radio_planner_t* ) obj );
+    radio_planner_t* rp = ( radio_planner_t* ) obj;
+
+    // the us timestamp first: it times the DIO edge for the Rx windows and the time on air
+    rp->radio_irq_timestamp_us = rp_bsp_timestamp_us_get( );
+    rp->radio_irq_timestamp_ms = rp_bsp_timestamp_get( );
+    rp->radio_irq_pending      = 1;
+    BSP_PERF_EVENT( BSP_PERF_EVENT_RADIO_IRQ, rp->radio_task_id );
+    rp_bsp_deferred_irq_trigger( rp, rp_irq_bottom_half_callback );
 }
 
 static void rp_timer_irq_callback( void* obj )
 {
-    rp_timer_irq( ( radio_planner_t* ) obj );
+    radio_planner_t* rp = ( radio_planner_t* ) obj;
+
+    rp->timer_irq_pending = 1;
+    rp_bsp_deferred_irq_trigger( rp, rp_irq_bottom_half_callback );
+}
+
+static void rp_launch_timer_irq_callback( void* obj )
+{
+    radio_planner_t* rp = ( radio_planner_t* ) obj;
+
+    rp->launch_irq_pending = 1;
+    rp_bsp_deferred_irq_trigger( rp, rp_irq_bottom_half_callback );
+}
+
+static void rp_irq_bottom_half_callback( void* obj )
+{
+    rp_irq_bottom_half( ( radio_planner_t* ) obj );
 }
 
 static void rp_hook_callback( radio_planner_t* rp, uint8_t id )
 {
+    RP_TRACE_CALLBACK_BEGIN( );
     rp->hook_callbacks[id]( rp->hooks[id] );
+    RP_TRACE_CALLBACK_END( );
 }
 
 //
@@ -846,6 +1736,24 @@ static void rp_task_print( const radio_planner_t* rp, const rp_task_t* task )
     case RP_TASK_TYPE_CAD:
         BSP_DBG_TRACE_PRINTF_RP( " TASK_CAD " );
         break;
+    case RP_TASK_TYPE_RX_FLRC:
+        BSP_DBG_TRACE_PRINTF_RP( " TASK_RX_FLRC " );
+        break;
+    case RP_TASK_TYPE_TX_FLRC:
+        BSP_DBG_TRACE_PRINTF_RP( " TASK_TX_FLRC " );
+        break;
+    case RP_TASK_TYPE_RX_LORA_DUTY_CYCLE:
+        BSP_DBG_TRACE_PRINTF_RP( " TASK_RX_LORA_DUTY_CYCLE " );
+        break;
+    case RP_TASK_TYPE_RANGING:
+        BSP_DBG_TRACE_PRINTF_RP( " TASK_RANGING " );
+        break;
+    case RP_TASK_TYPE_TX_BLE:
+        BSP_DBG_TRACE_PRINTF_RP( " TASK_TX_BLE " );
+        break;
+    case RP_TASK_TYPE_RSSI_SCAN:
+        BSP_DBG_TRACE_PRINTF_RP( " TASK_RSSI_SCAN " );
+        break;
     case RP_TASK_TYPE_NONE:
         BSP_DBG_TRACE_PRINTF_RP( " TASK_EMPTY " );
         break;
@@ -856,18 +1764,66 @@ static void rp_task_print( const radio_planner_t* rp, const rp_task_t* task )
     BSP_DBG_TRACE_PRINTF_RP( " - start time @%lu - priority #%u\n", task->start_time_ms, task->priority );
 }
 
-static void rp_consumption_statistics_updated( radio_planner_t* rp, const uint8_t hook_id, const uint32_t time )
+static void rp_consumption_statistics_updated( radio_planner_t* rp, const uint8_t hook_id, const uint32_t time,
+                                               const uint32_t time_us )
 {
     uint32_t micro_ampere = 0;
 
-    if( rp->tasks[hook_id].type == RP_TASK_TYPE_RX_LORA )
+    switch( rp->tasks[hook_id].type )
     {
+    case RP_TASK_TYPE_RX_LORA:
+    case RP_TASK_TYPE_CAD:
+        ral_get_lora_rx_consumption_in_ua( rp->ral, &rp->radio_params[hook_id].rx.lora, &micro_ampere );
+        break;
+    case RP_TASK_TYPE_RX_LORA_DUTY_CYCLE:
+    {  // the radio only draws the Rx current during its Rx windows
+        uint32_t period_ms = rp->radio_params[hook_id].rx.duty_cycle_rx_time_in_ms +
+                             rp->radio_params[hook_id].rx.duty_cycle_sleep_time_in_ms;
+
         ral_get_lora_rx_consumption_in_ua( rp->ral, &rp->radio_params[hook_id].rx.lora, &micro_ampere );
+        if( period_ms > 0 )
+        {
+            micro_ampere = ( uint32_t )( ( ( uint64_t ) micro_ampere *
+                                           rp->radio_params[hook_id].rx.duty_cycle_rx_time_in_ms ) /
+                                         period_ms );
+        }
+        break;
     }
-    else if( rp->tasks[hook_id].type == RP_TASK_TYPE_TX_LORA )
-    {
+    case RP_TASK_TYPE_RX_FSK:
+    case RP_TASK_TYPE_RSSI_SCAN:
+        ral_get_gfsk_rx_consumption_in_ua( rp->ral, &rp->radio_params[hook_id].rx.gfsk, &micro_ampere );
+        break;
+    case RP_TASK_TYPE_RX_FLRC:
+        ral_get_flrc_rx_consumption_in_ua( rp->ral, &rp->radio_params[hook_id].rx.flrc, &micro_ampere );
+        break;
+    case RP_TASK_TYPE_TX_LORA:
         ral_get_lora_tx_consumption_in_ua( rp->ral, &rp->radio_params[hook_id].tx.lora, &micro_ampere );
+        break;
+    case RP_TASK_TYPE_TX_FSK:
+        ral_get_gfsk_tx_consumption_in_ua( rp->ral, &rp->radio_params[hook_id].tx.gfsk, &micro_ampere );
+        break;
+    case RP_TASK_TYPE_TX_FLRC:
+        ral_get_flrc_tx_consumption_in_ua( rp->ral, &rp->radio_params[hook_id].tx.flrc, &micro_ampere );
+        break;
+    case RP_TASK_TYPE_TX_BLE: {
+        // the PA current only depends on the output power
+        const ral_params_gfsk_t gfsk = { .pwr_in_dbm = rp->radio_params[hook_id].tx.ble.pwr_in_dbm };
+        ral_get_gfsk_tx_consumption_in_ua( rp->ral, &gfsk, &micro_ampere );
+        break;
+    }
+    case RP_TASK_TYPE_RANGING:
+        if( rp->radio_params[hook_id].ranging.params.role == RAL_RANGING_ROLE_MASTER )
+        {
+            ral_get_lora_tx_consumption_in_ua( rp->ral, &rp->radio_params[hook_id].ranging.params.lora, &micro_ampere );
+        }
+        else
+        {
+            ral_get_lora_rx_consumption_in_ua( rp->ral, &rp->radio_params[hook_id].ranging.params.lora, &micro_ampere );
+        }
+        break;
+    default:
+        break;
     }
 
-    rp_stats_update( &rp->stats, time, hook_id, micro_ampere );
+    rp_stats_update( &rp->stats, time, time_us, hook_id, micro_ampere );
 }
@@ -78,6 +78,7 @@ typedef struct radio_planner_s
     void*             hooks[RP_NB_HOOKS];
     rp_status_t       status[RP_NB_HOOKS];
     uint32_t          irq_timestamp_ms[RP_NB_HOOKS];
+    uint32_t          irq_timestamp_us[RP_NB_HOOKS];  // same IRQ, see \ref rp_bsp_timestamp_us_get
     rp_stats_t        stats;
     uint8_t           hook_to_execute;
     uint32_t          hook_to_execute_time_ms;
@@ -86,11 +87,30 @@ typedef struct radio_planner_s
     uint8_t           timer_task_id;
     uint8_t           semaphore_radio;
     uint8_t           semaphore_abort_radio;
+    uint8_t           launch_pending;
+    uint16_t          setup_time[RP_TASK_TYPE_NONE];  // radio setup time per task type [1/16 ms]
+    volatile uint8_t  radio_irq_pending;
+    volatile uint8_t  launch_irq_pending;
+    volatile uint8_t  timer_irq_pending;
+    uint32_t          radio_irq_timestamp_ms;
+    uint32_t          radio_irq_timestamp_us;
     uint32_t          timer_value;
     uint8_t           timer_hook_id;
     void ( *hook_callbacks[RP_NB_HOOKS] )( void* );
     rp_next_state_status_t next_state_status;
     ral_t*                 ral;
+    rp_task_queue_entry_t  queue[RP_TASK_QUEUE_SIZE];  // chained tasks of all hooks, in submission order
+    uint8_t                queue_nb;
+    rp_hook_arbitration_t  arbitration[RP_NB_HOOKS];
+    uint8_t                base_priority[RP_NB_HOOKS];    // priority of the task before aging and airtime share
+    uint8_t                age[RP_NB_HOOKS];              // tasks aborted or postponed since the last completed one
+    uint32_t               airtime_base_ms[RP_NB_HOOKS];  // radio time of the hook at the start of the window
+    uint32_t               airtime_window_start_ms;
+    bool                   arbitration_is_on;
+    rp_rx_filter_t         rx_filter[RP_NB_HOOKS];
+    uint8_t                rx_filter_size[RP_NB_HOOKS];  // bytes of the frame given to the filter
+    bool                   is_suspended;                 // radio powered down, the tasks wait for rp_resume
+    uint32_t               suspend_time_ms;
 } radio_planner_t;
 
 /*
@@ -99,7 +119,7 @@ typedef struct radio_planner_s
  */
 
 /*!
- *
+ * Radio IRQ top half: timestamps the IRQ and defers its processing to \ref rp_bsp_deferred_irq_trigger
  */
 void rp_radio_irq_callback( void* obj );
 
@@ -113,6 +133,41 @@ void rp_init( radio_planner_t* rp, ral_t* ral );
  */
 rp_hook_status_t rp_hook_init( radio_planner_t* rp, const uint8_t id, void ( *callback )( void* context ), void* hook );
 
+/*!
+ * Set the share of the radio time and the priority aging of a hook
+ *
+ * \remark A hook over its airtime share in the current RP_AIRTIME_WINDOW_MS window ranks after the hooks within
+ *         theirs, so a hook scheduling tasks continuously no longer starves the others. Each task of the hook
+ *         aborted or postponed by the arbiter raises the next ones by one rank, up to max_aging, until a task of
+ *         the hook completes. The scheduled tasks of a protected hook rank before the scheduled tasks of all the
+ *         other hooks, for the windows set on a network time which can't be moved. All hooks start with no limit,
+ *         no aging and no protection, i.e. the static priorities.
+ *
+ * \param [in/out] rp          Radio planner data structure
+ * \param [in]     id          Hook id
+ * \param [in]     arbitration Arbitration settings of the hook
+ * \retval status              Function execution status
+ */
+rp_hook_status_t rp_hook_set_arbitration( radio_planner_t* rp, const uint8_t id,
+                                          const rp_hook_arbitration_t* arbitration );
+
+/*!
+ * Set the filter deciding on the first bytes of a received frame whether the rest is worth reading
+ *
+ * \remark Called under the radio irq with the first header_size bytes of each frame received by a task of the hook.
+ *         A frame dropped by the filter is not read further and ends the task with RP_STATUS_RX_TIMEOUT, so a
+ *         frame for another device costs a few bytes of radio buffer read instead of its whole payload. Frames
+ *         shorter than header_size are read entirely. A NULL filter, the default, keeps every frame.
+ *
+ * \param [in/out] rp          Radio planner data structure
+ * \param [in]     id          Hook id
+ * \param [in]     filter      Filter of the hook, NULL for none
+ * \param [in]     header_size Number of bytes given to the filter
+ * \retval status              Function execution status
+ */
+rp_hook_status_t rp_hook_set_rx_filter( radio_planner_t* rp, const uint8_t id, rp_rx_filter_t filter,
+                                        const uint8_t header_size );
+
 /*!
  *
  */
@@ -129,25 +184,101 @@ rp_hook_status_t rp_hook_get_id( const radio_planner_t* rp, const void* hook, ui
  *                                  Rx: Maximum payload to be received
  * \param [in]     radio_params Holds the radio parameters to be used while
  *                                  handling the task.
+ * \remark The tasks chained behind the current task of the hook are dropped
+ *
  * \retval status               Function execution status
  */
 rp_hook_status_t rp_task_enqueue( radio_planner_t* rp, const rp_task_t* task, uint8_t* payload, uint16_t payload_size,
                                   const rp_radio_params_t* radio_params );
 
+/*!
+ * Chain a task behind the current task of its hook
+ *
+ * The planner installs the next task of the chain from the radio IRQ of the previous one, before the hook callback,
+ * so a chain such as CAD, Tx, Rx1, Rx2 runs back to back. The first task is enqueued as with \ref rp_task_enqueue
+ * when the hook is idle. The next ones start start_time_ms after the end of the previous task when scheduled, as
+ * soon as possible otherwise. The callback is called at the end of each task of the chain.
+ *
+ * \param [in/out] rp                 Radio planner data structure
+ * \param [in]     task               Radio planner task to be handled
+ * \param [in]     payload            Pointer to the buffer holding the data to be Tx/Rx
+ * \param [in]     payload_size       Buffer size
+ * \param [in]     radio_params       Holds the radio parameters to be used while handling the task
+ * \param [in]     run_if_status_mask RP_CHAIN_IF of the statuses of the previous task that let this one run, the
+ *                                    rest of the chain is dropped otherwise
+ * \retval status                     RP_TASK_STATUS_QUEUE_FULL when RP_TASK_QUEUE_SIZE tasks are already chained
+ */
+rp_hook_status_t rp_task_chain( radio_planner_t* rp, const rp_task_t* task, uint8_t* payload, uint16_t payload_size,
+                                const rp_radio_params_t* radio_params, const uint16_t run_if_status_mask );
+
+/*!
+ * Next window where the radio is free for at least min_duration_ms, from the tasks known to the planner
+ *
+ * \remark The tasks not enqueued yet, such as the ones chained behind a hook, are not accounted for. A task
+ *         enqueued in the window starts on time unless a task of a higher priority hook is enqueued over it.
+ *
+ * \param [in]  rp              Radio planner data structure
+ * \param [in]  min_duration_ms Radio time needed, in ms
+ * \param [out] start_ms        Start of the window, \ref rp_bsp_timestamp_get time base
+ * \retval free_ms              Length of the window, UINT32_MAX when no task follows it
+ */
+uint32_t rp_get_next_free_window( const radio_planner_t* rp, const uint32_t min_duration_ms, uint32_t* start_ms );
+
 /*!
  *
  */
 rp_hook_status_t rp_task_abort( radio_planner_t* rp, const uint8_t hook_id );
 
+/*!
+ * Powers the radio down until \ref rp_resume: cold sleep with the TCXO off and no timer armed
+ *
+ * \remark The running task is aborted, its hook is called back on the resume. The other tasks, and the ones
+ *         enqueued meanwhile, are kept but not launched.
+ *
+ * \param [in] rp The radio planner
+ */
+void rp_suspend( radio_planner_t* rp );
+
+/*!
+ * Ends a \ref rp_suspend, the pending tasks are moved by the suspend duration then arbitrated again
+ *
+ * \remark Only the tasks of the hooks, at absolute dates, are moved. The chained tasks are relative to the end of
+ *         their previous task and follow it. The radio configuration lost in cold sleep is sent again by the first
+ *         task
+ *
+ * \param [in] rp The radio planner
+ */
+void rp_resume( radio_planner_t* rp );
+
 /*!
  *
  */
 rp_stats_t rp_get_stats( const radio_planner_t* rp );
 
 /*!
+ * Status of the last task of a hook and the time of its radio IRQ, taken in the top half at the DIO edge
+ *
+ * \param [in] rp                The radio planner
+ * \param [in] id                Hook id
+ * \param [out] irq_timestamp_ms IRQ time in ms, \ref rp_bsp_timestamp_get time base
+ * \param [out] irq_timestamp_us IRQ time in us, \ref rp_bsp_timestamp_us_get time base, for sub-ms timings
+ * \param [out] status           Status of the task
+ */
+void rp_get_status( const radio_planner_t* rp, const uint8_t id, uint32_t* irq_timestamp_ms, uint32_t* irq_timestamp_us,
+                    rp_status_t* status );
+
+/*!
+ * Lengthen the preamble of a LoRa Tx to wake up a receiver in Rx duty cycle (RP_TASK_TYPE_RX_LORA_DUTY_CYCLE)
+ *
+ * \remark The preamble spans the receiver sleep time and two of its Rx windows, so that one window always falls
+ *         on it whatever the phase of the receiver. To be called before computing the time on air of the task.
  *
+ * \param [in/out] params           LoRa Tx parameters, the preamble is never shortened
+ * \param [in]     rx_time_in_ms    Rx window of the receiver
+ * \param [in]     sleep_time_in_ms Sleep time of the receiver between its Rx windows
  */
-void rp_get_status( const radio_planner_t* rp, const uint8_t id, uint32_t* irq_timestamp_ms, rp_status_t* status );
+void rp_set_lora_wake_up_preamble( ral_params_lora_t* params, const uint32_t rx_time_in_ms,
+                                   const uint32_t sleep_time_in_ms );
 
 #ifdef __cplusplus
 }
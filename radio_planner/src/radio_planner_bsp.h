@@ -80,12 +80,14 @@ void rp_bsp_critical_section_begin( void );
 void rp_bsp_critical_section_end( void );
 
 /*!
+ * Stops the timer of a radio planner
  *
+ * \remark Each radio planner has its own timer, the implementation can share one hardware timer between them
  */
-void rp_bsp_timer_stop( void );
+void rp_bsp_timer_stop( void* rp );
 
 /*!
- *
+ * Starts the timer of a radio planner, callback( rp ) is executed from an interrupt after alarm_in_ms
  */
 void rp_bsp_timer_start( void* rp, uint32_t alarm_in_ms, void ( *callback )( void* context ) );
 
@@ -94,11 +96,24 @@ void rp_bsp_timer_start( void* rp, uint32_t alarm_in_ms, void ( *callback )( voi
  */
 uint32_t rp_bsp_timestamp_get( void );
 
+/*!
+ * Same time base as \ref rp_bsp_timestamp_get in microseconds, wraps every 71 minutes: only for time differences
+ */
+uint32_t rp_bsp_timestamp_us_get( void );
+
 /*!
  *
  */
 uint8_t rp_bsp_irq_get_pending( void );
 
+/*!
+ * Requests callback( rp ) to be executed from a low priority software interrupt
+ *
+ * \remark Runs the bottom half of the radio planner interrupts, it must not preempt the
+ *         \ref rp_bsp_critical_section_begin sections. The requests of several radio planners must all be executed.
+ */
+void rp_bsp_deferred_irq_trigger( void* rp, void ( *callback )( void* context ) );
+
 #ifdef __cplusplus
 }
 #endif
@@ -65,7 +65,8 @@ extern "C" {
  */
 typedef struct rp_stats_s
 {
-    uint32_t tx_last_toa_ms[RP_NB_HOOKS];
+    uint32_t tx_last_toa_ms[RP_NB_HOOKS];  // rounded up from tx_last_toa_us
+    uint32_t tx_last_toa_us[RP_NB_HOOKS];  // from the Tx start to the Tx done IRQ
     uint32_t tx_consumption_ms[RP_NB_HOOKS];
     uint32_t rx_consumption_ms[RP_NB_HOOKS];
     uint32_t tx_consumption_ma[RP_NB_HOOKS];
@@ -75,8 +76,10 @@ typedef struct rp_stats_s
     uint32_t tx_total_consumption_ma;
     uint32_t rx_total_consumption_ma;
     uint32_t tx_timestamp;
+    uint32_t tx_timestamp_us;
     uint32_t rx_timestamp;
     uint32_t task_hook_aborted_nb[RP_NB_HOOKS];
+    uint32_t task_hook_postponed_nb[RP_NB_HOOKS];
     uint32_t rp_error;
 } rp_stats_t;
 
@@ -92,18 +95,21 @@ static inline void rp_stats_init( rp_stats_t* rp_stats )
 {
     for( int32_t i = 0; i < RP_NB_HOOKS; i++ )
     {
-        rp_stats->tx_last_toa_ms[i]       = 0;
-        rp_stats->tx_consumption_ms[i]    = 0;
-        rp_stats->rx_consumption_ms[i]    = 0;
-        rp_stats->tx_consumption_ma[i]    = 0;
-        rp_stats->rx_consumption_ma[i]    = 0;
-        rp_stats->task_hook_aborted_nb[i] = 0;
+        rp_stats->tx_last_toa_ms[i]         = 0;
+        rp_stats->tx_last_toa_us[i]         = 0;
+        rp_stats->tx_consumption_ms[i]      = 0;
+        rp_stats->rx_consumption_ms[i]      = 0;
+        rp_stats->tx_consumption_ma[i]      = 0;
+        rp_stats->rx_consumption_ma[i]      = 0;
+        rp_stats->task_hook_aborted_nb[i]   = 0;
+        rp_stats->task_hook_postponed_nb[i] = 0;
     }
     rp_stats->tx_total_consumption_ms = 0;
     rp_stats->rx_total_consumption_ms = 0;
     rp_stats->tx_total_consumption_ma = 0;
     rp_stats->rx_total_consumption_ma = 0;
     rp_stats->tx_timestamp            = 0;
+    rp_stats->tx_timestamp_us         = 0;
     rp_stats->rx_timestamp            = 0;
     rp_stats->rp_error                = 0;
 }
@@ -111,9 +117,10 @@ static inline void rp_stats_init( rp_stats_t* rp_stats )
 /*!
  *
  */
-static inline void rp_stats_set_tx_timestamp( rp_stats_t* rp_stats, uint32_t timestamp )
+static inline void rp_stats_set_tx_timestamp( rp_stats_t* rp_stats, uint32_t timestamp, uint32_t timestamp_us )
 {
-    rp_stats->tx_timestamp = timestamp;
+    rp_stats->tx_timestamp    = timestamp;
+    rp_stats->tx_timestamp_us = timestamp_us;
 }
 
 /*!
@@ -127,15 +134,18 @@ static inline void rp_stats_set_rx_timestamp( rp_stats_t* rp_stats, uint32_t tim
 /*!
  *
  */
-static inline void rp_stats_update( rp_stats_t* rp_stats, uint32_t timestamp, uint8_t hook_id, uint32_t micro_ampere )
+static inline void rp_stats_update( rp_stats_t* rp_stats, uint32_t timestamp, uint32_t timestamp_us, uint8_t hook_id,
+                                    uint32_t micro_ampere )
 {
     uint32_t computed_time        = 0;
     uint32_t computed_consumption = 0;
     if( rp_stats->tx_timestamp != 0 )
     {
         // wrapping is impossible with this time base
-        computed_time                     = timestamp - rp_stats->tx_timestamp;
-        rp_stats->tx_last_toa_ms[hook_id] = computed_time;
+        computed_time = timestamp - rp_stats->tx_timestamp;
+        // the time on air is measured in us: the ms timestamps truncate both ends
+        rp_stats->tx_last_toa_us[hook_id] = timestamp_us - rp_stats->tx_timestamp_us;
+        rp_stats->tx_last_toa_ms[hook_id] = ( rp_stats->tx_last_toa_us[hook_id] + 999 ) / 1000;
         rp_stats->tx_consumption_ms[hook_id] += computed_time;
         rp_stats->tx_total_consumption_ms += computed_time;
 
@@ -184,6 +194,8 @@ static inline void rp_stats_print( rp_stats_t* rp_stats )
     {
         BSP_DBG_TRACE_PRINTF_RP( "Number of aborted tasks for hook #%ld = %lu \n", i,
                                  rp_stats->task_hook_aborted_nb[i] );
+        BSP_DBG_TRACE_PRINTF_RP( "Number of postponed tasks for hook #%ld = %lu \n", i,
+                                 rp_stats->task_hook_postponed_nb[i] );
     }
     BSP_DBG_TRACE_PRINTF_RP( "RP: number of errors is %lu\n\n\n", rp_stats->rp_error );
 }
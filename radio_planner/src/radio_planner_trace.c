@@ -0,0 +1,192 @@
+/*!
+ * \file      radio_planner_trace.c
+ *
+ * \brief     Radio planner arbitration trace, recorded on the target and replayed on the host
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "radio_planner_trace.h"
+#include "smtc_bsp_mcu.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static rp_trace_record_t rp_trace_records[RP_TRACE_RECORD_NB];
+static uint16_t          rp_trace_records_lost = 0;
+// free running indexes, the buffer is empty when they are equal
+static uint32_t rp_trace_write_index = 0;
+static uint32_t rp_trace_read_index  = 0;
+// depth of the hook callbacks in progress, they can enqueue or abort tasks
+static uint8_t rp_trace_callback_depth = 0;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * Writes a 32 bits value in big endian and returns the next write position
+ */
+static uint8_t* rp_trace_put_u32( uint8_t* p, uint32_t value );
+
+/*!
+ * Reads a 32 bits big endian value
+ */
+static uint32_t rp_trace_get_u32( const uint8_t* p );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void rp_trace_init( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    rp_trace_records_lost   = 0;
+    rp_trace_write_index    = 0;
+    rp_trace_read_index     = 0;
+    rp_trace_callback_depth = 0;
+    CRITICAL_SECTION_END( );
+}
+
+void rp_trace_record( rp_trace_event_t event, uint8_t hook_id, uint32_t timestamp_ms, uint32_t arg_1,
+                      uint32_t arg_2, uint16_t arg_3 )
+{
+    CRITICAL_SECTION_BEGIN( );
+    if( ( rp_trace_write_index - rp_trace_read_index ) < RP_TRACE_RECORD_NB )
+    {
+        rp_trace_record_t* record = &rp_trace_records[rp_trace_write_index & ( RP_TRACE_RECORD_NB - 1 )];
+
+        record->timestamp_ms = timestamp_ms;
+        record->arg_1        = arg_1;
+        record->arg_2        = arg_2;
+        record->arg_3        = arg_3;
+        record->event        = event;
+        record->hook_id      = hook_id;
+        record->flags        = ( rp_trace_callback_depth > 0 ) ? RP_TRACE_FLAG_IN_CALLBACK : 0;
+        rp_trace_write_index++;
+    }
+    else if( rp_trace_records_lost < UINT16_MAX )
+    {
+        rp_trace_records_lost++;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+void rp_trace_callback_nesting( bool is_entering )
+{
+    if( is_entering == true )
+    {
+        rp_trace_callback_depth++;
+    }
+    else if( rp_trace_callback_depth > 0 )
+    {
+        rp_trace_callback_depth--;
+    }
+}
+
+uint8_t rp_trace_dump( uint8_t* buffer, uint8_t max_length )
+{
+    uint8_t* p = buffer;
+
+    if( max_length < RP_TRACE_DUMP_HEADER_SIZE )
+    {
+        return 0;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    uint32_t nb_records = rp_trace_write_index - rp_trace_read_index;
+    if( nb_records > ( uint32_t )( ( max_length - RP_TRACE_DUMP_HEADER_SIZE ) / RP_TRACE_RECORD_SIZE ) )
+    {
+        nb_records = ( max_length - RP_TRACE_DUMP_HEADER_SIZE ) / RP_TRACE_RECORD_SIZE;
+    }
+
+    *p++                  = rp_trace_records_lost >> 8;
+    *p++                  = rp_trace_records_lost & 0xFF;
+    rp_trace_records_lost = 0;
+
+    *p++ = ( uint8_t ) nb_records;
+    for( uint32_t i = 0; i < nb_records; i++ )
+    {
+        const rp_trace_record_t* record = &rp_trace_records[rp_trace_read_index & ( RP_TRACE_RECORD_NB - 1 )];
+
+        *p++ = record->event;
+        *p++ = record->hook_id;
+        *p++ = record->flags;
+        p    = rp_trace_put_u32( p, record->timestamp_ms );
+        p    = rp_trace_put_u32( p, record->arg_1 );
+        p    = rp_trace_put_u32( p, record->arg_2 );
+        *p++ = record->arg_3 >> 8;
+        *p++ = record->arg_3 & 0xFF;
+        rp_trace_read_index++;
+    }
+    CRITICAL_SECTION_END( );
+
+    return p - buffer;
+}
+
+void rp_trace_record_parse( const uint8_t* buffer, rp_trace_record_t* record )
+{
+    record->event        = buffer[0];
+    record->hook_id      = buffer[1];
+    record->flags        = buffer[2];
+    record->timestamp_ms = rp_trace_get_u32( &buffer[3] );
+    record->arg_1        = rp_trace_get_u32( &buffer[7] );
+    record->arg_2        = rp_trace_get_u32( &buffer[11] );
+    record->arg_3        = ( uint16_t )( ( buffer[15] << 8 ) | buffer[16] );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint8_t* rp_trace_put_u32( uint8_t* p, uint32_t value )
+{
+    *p++ = value >> 24;
+    *p++ = ( value >> 16 ) & 0xFF;
+    *p++ = ( value >> 8 ) & 0xFF;
+    *p++ = value & 0xFF;
+    return p;
+}
+
+static uint32_t rp_trace_get_u32( const uint8_t* p )
+{
+    return ( ( uint32_t ) p[0] << 24 ) | ( ( uint32_t ) p[1] << 16 ) | ( ( uint32_t ) p[2] << 8 ) | p[3];
+}
+
+/* --- EOF ------------------------------------------------------------------ */
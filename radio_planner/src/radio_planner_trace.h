@@ -0,0 +1,195 @@
+/*!
+ * \file      radio_planner_trace.h
+ *
+ * \brief     Radio planner arbitration trace, recorded on the target and replayed on the host
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __RADIO_PLANNER_TRACE_H__
+#define __RADIO_PLANNER_TRACE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Records a planner event, compiled out of the builds without the perf test features
+ */
+#if defined( PERF_TEST_ENABLED )
+#define RP_TRACE( event, hook_id, timestamp_ms, arg_1, arg_2, arg_3 ) \
+    rp_trace_record( event, hook_id, timestamp_ms, arg_1, arg_2, arg_3 )
+#define RP_TRACE_CALLBACK_BEGIN( ) rp_trace_callback_nesting( true )
+#define RP_TRACE_CALLBACK_END( ) rp_trace_callback_nesting( false )
+#else
+#define RP_TRACE( event, hook_id, timestamp_ms, arg_1, arg_2, arg_3 )
+#define RP_TRACE_CALLBACK_BEGIN( )
+#define RP_TRACE_CALLBACK_END( )
+#endif
+
+/*!
+ * Packs the enqueued task fields in the arg_3 of a \ref RP_TRACE_EVENT_ENQUEUE record
+ */
+#define RP_TRACE_TASK_PACK( type, state, policy ) \
+    ( uint16_t )( ( ( type ) &0x0F ) | ( ( ( state ) &0x0F ) << 4 ) | ( ( ( policy ) &0x0F ) << 8 ) )
+#define RP_TRACE_TASK_TYPE( arg_3 ) ( ( arg_3 ) &0x0F )
+#define RP_TRACE_TASK_STATE( arg_3 ) ( ( ( arg_3 ) >> 4 ) & 0x0F )
+#define RP_TRACE_TASK_POLICY( arg_3 ) ( ( ( arg_3 ) >> 8 ) & 0x0F )
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * Number of records kept until the host dumps them, must be a power of 2
+ */
+#define RP_TRACE_RECORD_NB 32
+
+/*!
+ * Size of a serialized record, see \ref rp_trace_dump
+ */
+#define RP_TRACE_RECORD_SIZE 17
+
+/*!
+ * Size of the header of a dump, see \ref rp_trace_dump
+ */
+#define RP_TRACE_DUMP_HEADER_SIZE 3
+
+/*!
+ * Record flag: the event happened in a hook callback, i.e. the owner reacted to the end of one of its tasks
+ */
+#define RP_TRACE_FLAG_IN_CALLBACK 0x01
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Planner events, the values are part of the host dump format
+ *
+ * The inputs of the planner (enqueue, abort, radio IRQ) are enough to replay it, the outputs (timer IRQ, launch,
+ * aborted task) are what the replay is compared to.
+ */
+typedef enum rp_trace_event_e
+{
+    RP_TRACE_EVENT_ENQUEUE    = 0x00,  // arg_1: start time, arg_2: duration, arg_3: RP_TRACE_TASK_PACK
+    RP_TRACE_EVENT_ABORT      = 0x01,  // task aborted by its owner
+    RP_TRACE_EVENT_RADIO_IRQ  = 0x02,  // hook of the running task, timestamp of the top half, arg_3: RAL IRQ flags
+    RP_TRACE_EVENT_TIMER_IRQ  = 0x03,  // hook of the timer, arg_1: 0 for the arbiter alarm, 1 for the launch timer
+    RP_TRACE_EVENT_LAUNCH     = 0x04,  // radio triggered, arg_1: scheduled start time, arg_3: task type
+    RP_TRACE_EVENT_ABORTED    = 0x05,  // owner called back with RP_STATUS_TASK_ABORTED
+    RP_TRACE_EVENT_NB
+} rp_trace_event_t;
+
+/*!
+ * Planner event record
+ */
+typedef struct rp_trace_record_s
+{
+    uint32_t timestamp_ms;
+    uint32_t arg_1;
+    uint32_t arg_2;
+    uint16_t arg_3;
+    uint8_t  event;
+    uint8_t  hook_id;
+    uint8_t  flags;
+} rp_trace_record_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Clears the records
+ */
+void rp_trace_init( void );
+
+/*!
+ * Records a planner event
+ *
+ * \remark Interrupt safe and print free, as \ref bsp_perf_event. The event is lost when the buffer is full.
+ *
+ * \param [IN] event        Event identifier
+ * \param [IN] hook_id      Hook of the task
+ * \param [IN] timestamp_ms Planner time of the event
+ * \param [IN] arg_1        First event argument
+ * \param [IN] arg_2        Second event argument
+ * \param [IN] arg_3        Third event argument
+ */
+void rp_trace_record( rp_trace_event_t event, uint8_t hook_id, uint32_t timestamp_ms, uint32_t arg_1,
+                      uint32_t arg_2, uint16_t arg_3 );
+
+/*!
+ * Marks the records of the hook callbacks with \ref RP_TRACE_FLAG_IN_CALLBACK
+ *
+ * \param [IN] is_entering true when a hook callback starts, false when it returns
+ */
+void rp_trace_callback_nesting( bool is_entering );
+
+/*!
+ * Moves the oldest records to buffer
+ *
+ * \remark Big endian format: records lost since the previous dump (2 bytes), number of records in this dump
+ *         (1 byte), then each record: event (1 byte), hook (1 byte), flags (1 byte), timestamp (4 bytes), arg_1
+ *         (4 bytes), arg_2 (4 bytes), arg_3 (2 bytes). Records that do not fit in max_length stay in the buffer.
+ *
+ * \param [OUT] buffer     Dump destination
+ * \param [IN]  max_length Size of buffer
+ *
+ * \retval Number of bytes written to buffer, 0 if max_length is too small
+ */
+uint8_t rp_trace_dump( uint8_t* buffer, uint8_t max_length );
+
+/*!
+ * Reads one record of a dump, for the host tools
+ *
+ * \param [IN]  buffer Serialized record, \ref RP_TRACE_RECORD_SIZE bytes
+ * \param [OUT] record Decoded record
+ */
+void rp_trace_record_parse( const uint8_t* buffer, rp_trace_record_t* record );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __RADIO_PLANNER_TRACE_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -61,9 +61,31 @@ extern "C" {
 // clang-format off
 
 /*
- * Maximum number of objects that can be attached to the scheduler
+ * Maximum number of objects that can be attached to the scheduler, can be set at build time
  */
-#define RP_NB_HOOKS                                 8
+#ifndef RP_NB_HOOKS
+#define RP_NB_HOOKS                                 9
+#endif
+
+// the task priority ( ( state + 1 ) * RP_NB_HOOKS ) + hook_id, hook_id alone for the scheduled tasks of a protected
+// hook, plus 2 * RP_NB_HOOKS for a hook over its airtime share, is stored on 8 bits, 0xFF excluded
+#if( RP_NB_HOOKS > 50 )
+#error "RP_NB_HOOKS too large, the task priority no longer fits in uint8_t"
+#endif
+
+/*
+ * Window over which the airtime shares of the hooks are accounted, can be set at build time
+ */
+#ifndef RP_AIRTIME_WINDOW_MS
+#define RP_AIRTIME_WINDOW_MS                        60000
+#endif
+
+/*
+ * Number of tasks waiting behind the current task of their hook, shared by all hooks, can be set at build time
+ */
+#ifndef RP_TASK_QUEUE_SIZE
+#define RP_TASK_QUEUE_SIZE                          3
+#endif
 
 /*!
  *
@@ -82,6 +104,45 @@ extern "C" {
  */
 #define RP_MARGIN_DELAY                             8
 
+/*!
+ *
+ * below this delay the radio is triggered by a busy wait, above it the MCU sleeps until the start time
+ */
+#define RP_LAUNCH_SLEEP_MIN_DELAY                   2
+
+/*!
+ *
+ * latency of the planner timer IRQ: MCU wake up and timer configuration, the radio setup time is measured per task
+ * type and the TCXO startup time is added on top of it to get the launch lead time of a task
+ */
+#define RP_LAUNCH_WAKEUP_DELAY                      2
+
+/*!
+ *
+ * the setup times are kept in 1/16 ms, a longer setup is taken at once and a shorter one lowers the estimate by
+ * 1/16th of the difference
+ */
+#define RP_SETUP_TIME_SHIFT                         4
+
+/*!
+ *
+ * below this gap until the next task the radio sleeps with its configuration retained, above it the lower sleep
+ * current of a cold start outweighs the reconfiguration
+ */
+#define RP_WARM_SLEEP_MAX_GAP_MS                    10000
+
+
+/*!
+ *
+ * symbols added to a wake-up preamble on top of the receiver period, for the receiver to detect it in its Rx window
+ */
+#define RP_WAKE_UP_PREAMBLE_MARGIN_SYMB             8
+
+/*!
+ *
+ * settling time of the receiver after a frequency change, before the RSSI samples of a RP_TASK_TYPE_RSSI_SCAN task
+ */
+#define RP_RSSI_SCAN_SETTLE_US                      40
 
 /*!
  *
@@ -111,6 +172,8 @@ extern "C" {
 typedef struct rp_radio_params_s
 {
     ral_pkt_type_t pkt_type;
+    ral_reg_mode_t reg_mode;  // Power regulator used by the task
+    ral_lna_mode_t lna_mode;  // LNA regime, Rx and CAD tasks only
     struct
     {
         union
@@ -120,6 +183,7 @@ typedef struct rp_radio_params_s
             ral_params_flrc_t   flrc;
             ral_params_lora_e_t lora_e;
             ral_params_bpsk_t   bpsk;
+            ral_params_ble_t    ble;
         };
     } tx;
     struct
@@ -131,6 +195,11 @@ typedef struct rp_radio_params_s
             ral_params_flrc_t flrc;
         };
         uint32_t timeout_in_ms;
+        // RP_TASK_TYPE_RX_LORA_DUTY_CYCLE only: the radio alternates Rx and sleep on its own timer
+        uint32_t duty_cycle_rx_time_in_ms;
+        uint32_t duty_cycle_sleep_time_in_ms;
+        // RP_TASK_TYPE_RX_LORA only: a CAD first, the reception only starts when it detects a preamble
+        bool cad_gate_is_on;
         union
         {
             ral_rx_pkt_status_gfsk_t gfsk_pkt_status;
@@ -138,6 +207,21 @@ typedef struct rp_radio_params_s
             ral_rx_pkt_status_flrc_t flrc_pkt_status;
         };
     } rx;
+    struct
+    {
+        ral_params_ranging_t params;
+        uint32_t             timeout_in_ms;   // master: time given to the answer, slave: listening time, 0 for ever
+        int32_t              distance_in_cm;  // master only, set with RP_STATUS_RANGING_DONE
+    } ranging;
+    struct
+    {
+        // the receiver is set up with rx.gfsk, then only its frequency is changed from a channel to the next
+        const uint32_t* freq_in_hz;
+        uint8_t         freq_nb;
+        uint8_t         sample_nb;  // RSSI samples per channel
+        int16_t         busy_threshold_in_dbm;
+        uint8_t*        busy_nb;  // per channel, samples above the threshold, set with RP_STATUS_RSSI_SCAN_DONE
+    } rssi_scan;
 } rp_radio_params_t;
 
 /*!
@@ -150,6 +234,12 @@ typedef enum rp_task_types_e
     RP_TASK_TYPE_TX_LORA,
     RP_TASK_TYPE_TX_FSK,
     RP_TASK_TYPE_CAD,
+    RP_TASK_TYPE_RX_FLRC,
+    RP_TASK_TYPE_TX_FLRC,
+    RP_TASK_TYPE_RX_LORA_DUTY_CYCLE,
+    RP_TASK_TYPE_RANGING,
+    RP_TASK_TYPE_TX_BLE,
+    RP_TASK_TYPE_RSSI_SCAN,
     RP_TASK_TYPE_NONE,
 } rp_task_types_t;
 
@@ -165,6 +255,16 @@ typedef enum rp_task_states_e
     RP_TASK_STATE_FINISHED,
 } rp_task_states_t;
 
+/*!
+ *
+ */
+typedef enum rp_task_preempt_policies_e
+{
+    RP_TASK_PREEMPT_ABORT,       // the task is aborted, the owner is called back with RP_STATUS_TASK_ABORTED
+    RP_TASK_PREEMPT_DEFER,       // the task waits for the radio as an asap task
+    RP_TASK_PREEMPT_RESCHEDULE,  // the task is scheduled in the next gap long enough between the known tasks
+} rp_task_preempt_policies_t;
+
 /*!
  *
  */
@@ -176,7 +276,10 @@ typedef enum rp_status_e
     RP_STATUS_TX_DONE,
     RP_STATUS_RX_PACKET,
     RP_STATUS_RX_TIMEOUT,
-    RP_STATUS_TASK_ABORTED
+    RP_STATUS_TASK_ABORTED,
+    RP_STATUS_RANGING_DONE,     // master: the slave answered, slave: the answer was sent
+    RP_STATUS_RANGING_TIMEOUT,  // master: no answer, slave: request for another address or end of listening
+    RP_STATUS_RSSI_SCAN_DONE,
 } rp_status_t;
 
 typedef enum rp_next_state_status_e
@@ -200,8 +303,43 @@ typedef struct rp_task_s
     // schedule task after long period
     uint32_t start_time_init_ms;
     uint32_t duration_time_ms;
+    // what to do when a higher priority task collides, a task is never postponed more than
+    // RP_TASK_ASAP_TO_SCHEDULE_TRIG_TIME ms after its initial start time
+    rp_task_preempt_policies_t preempt_policy;
 } rp_task_t;
 
+/*!
+ * Arbitration settings of a hook, see \ref rp_hook_set_arbitration
+ */
+typedef struct rp_hook_arbitration_s
+{
+    uint8_t airtime_share_percent;  // radio time of the hook at its own priority per window, 100 for no limit
+    uint8_t max_aging;              // ranks its tasks can climb after being aborted or postponed, 0 for no aging
+    bool    is_protected;           // its scheduled tasks rank before the tasks of all the other hooks
+} rp_hook_arbitration_t;
+
+/*!
+ * Reception filter of a hook, see \ref rp_hook_set_rx_filter
+ *
+ * \param [in] hook        Context of the hook
+ * \param [in] header      First bytes of the received frame
+ * \param [in] header_size Number of bytes in header
+ * \retval bool            False to drop the frame
+ */
+typedef bool ( *rp_rx_filter_t )( void* hook, const uint8_t* header, uint8_t header_size );
+
+/*!
+ * Task waiting for the end of the previous task of its hook
+ */
+typedef struct rp_task_queue_entry_s
+{
+    rp_task_t         task;
+    rp_radio_params_t radio_params;
+    uint8_t*          payload;
+    uint16_t          payload_size;
+    uint16_t          run_if_status_mask;  // RP_CHAIN_IF of the previous task statuses
+} rp_task_queue_entry_t;
+
 /*!
  *
  */
@@ -210,8 +348,15 @@ typedef enum rp_hook_status_e
     RP_HOOK_STATUS_OK,
     RP_HOOK_STATUS_ID_ERROR,
     RP_TASK_STATUS_ALREADY_RUNNING,
+    RP_TASK_STATUS_QUEUE_FULL,
 } rp_hook_status_t;
 
+/*!
+ * Statuses of the previous task of a chain that let the next one run, see \ref rp_task_chain
+ */
+#define RP_CHAIN_IF( status ) ( ( uint16_t )( 1 << ( status ) ) )
+#define RP_CHAIN_ALWAYS 0xFFFF
+
 /*!
  *
  */
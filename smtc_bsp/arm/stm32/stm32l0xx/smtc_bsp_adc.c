@@ -39,6 +39,8 @@
 
 #include "stm32l0xx_hal.h"
 #include "smtc_bsp_mcu.h"
+#include "smtc_bsp_adc.h"
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE MACROS-----------------------------------------------------------
@@ -59,6 +61,9 @@ typedef struct bsp_adc_s
     ADC_TypeDef*           interface;
     ADC_HandleTypeDef      handle;
     ADC_ChannelConfTypeDef channel;
+    uint16_t*              values;
+    volatile uint8_t       index;
+    bsp_adc_irq_t          irq;
 } bsp_adc_t;
 
 /*
@@ -94,55 +99,73 @@ void bsp_adc_init( const uint32_t id )
 
     bsp_adc[local_id].handle.Instance = bsp_adc[local_id].interface;
 
-    bsp_adc[local_id].handle.Init.ClockPrescaler        = ADC_CLOCKPRESCALER_PCLK_DIV4;
-    bsp_adc[local_id].handle.Init.Resolution            = ADC_RESOLUTION12b;
-    bsp_adc[local_id].handle.Init.DataAlign             = ADC_DATAALIGN_RIGHT;
-    bsp_adc[local_id].handle.Init.ExternalTrigConvEdge  = ADC_EXTERNALTRIGCONVEDGE_NONE;
-    bsp_adc[local_id].handle.Init.ExternalTrigConv      = ADC_SOFTWARE_START;
-    bsp_adc[local_id].handle.Init.EOCSelection          = EOC_SINGLE_CONV;
-    bsp_adc[local_id].handle.Init.SamplingTime          = ADC_SAMPLETIME_160CYCLES_5;
-    bsp_adc[local_id].handle.Init.Overrun               = ADC_OVR_DATA_PRESERVED;
-    bsp_adc[local_id].handle.Init.LowPowerAutoWait      = ENABLE;
-    bsp_adc[local_id].handle.Init.ScanConvMode          = DISABLE;
-    bsp_adc[local_id].handle.Init.ContinuousConvMode    = DISABLE;
-    bsp_adc[local_id].handle.Init.DiscontinuousConvMode = DISABLE;
-    bsp_adc[local_id].handle.Init.LowPowerAutoPowerOff  = DISABLE;
-    bsp_adc[local_id].handle.Init.LowPowerFrequencyMode = DISABLE;
-    bsp_adc[local_id].handle.Init.OversamplingMode      = DISABLE;
-    bsp_adc[local_id].handle.Init.DMAContinuousRequests = DISABLE;
-
-    bsp_adc[local_id].channel.Channel = ADC_CHANNEL_TEMPSENSOR;
-    bsp_adc[local_id].channel.Rank    = 1;
+    // The temperature sensor needs 10us of sampling time, 160.5 cycles of the ADC clock are above at any system clock
+    bsp_adc[local_id].handle.Init.ClockPrescaler           = ADC_CLOCKPRESCALER_PCLK_DIV4;
+    bsp_adc[local_id].handle.Init.Resolution               = ADC_RESOLUTION12b;
+    bsp_adc[local_id].handle.Init.DataAlign                = ADC_DATAALIGN_RIGHT;
+    bsp_adc[local_id].handle.Init.ExternalTrigConvEdge     = ADC_EXTERNALTRIGCONVEDGE_NONE;
+    bsp_adc[local_id].handle.Init.ExternalTrigConv         = ADC_SOFTWARE_START;
+    bsp_adc[local_id].handle.Init.EOCSelection             = ADC_EOC_SINGLE_CONV;
+    bsp_adc[local_id].handle.Init.SamplingTime             = ADC_SAMPLETIME_160CYCLES_5;
+    bsp_adc[local_id].handle.Init.Overrun                  = ADC_OVR_DATA_PRESERVED;
+    bsp_adc[local_id].handle.Init.LowPowerAutoWait         = DISABLE;
+    bsp_adc[local_id].handle.Init.ScanConvMode             = ADC_SCAN_DIRECTION_FORWARD;
+    bsp_adc[local_id].handle.Init.ContinuousConvMode       = DISABLE;
+    bsp_adc[local_id].handle.Init.DiscontinuousConvMode    = DISABLE;
+    bsp_adc[local_id].handle.Init.LowPowerAutoPowerOff     = ENABLE;
+    bsp_adc[local_id].handle.Init.LowPowerFrequencyMode    = DISABLE;
+    bsp_adc[local_id].handle.Init.OversamplingMode         = ENABLE;
+    bsp_adc[local_id].handle.Init.Oversample.Ratio         = ADC_OVERSAMPLING_RATIO_16;
+    bsp_adc[local_id].handle.Init.Oversample.RightBitShift = ADC_RIGHTBITSHIFT_4;
+    bsp_adc[local_id].handle.Init.Oversample.TriggeredMode = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
+    bsp_adc[local_id].handle.Init.DMAContinuousRequests    = DISABLE;
 
     if( HAL_ADC_Init( &bsp_adc[local_id].handle ) != HAL_OK )
     {
         bsp_mcu_panic( );
     }
 
-    if( HAL_ADC_ConfigChannel( &bsp_adc[local_id].handle, &bsp_adc[local_id].channel ) != HAL_OK )
+    if( HAL_ADCEx_Calibration_Start( &bsp_adc[local_id].handle, ADC_SINGLE_ENDED ) != HAL_OK )
     {
         bsp_mcu_panic( );
     }
 
-    if( HAL_ADC_Start( &bsp_adc[local_id].handle ) != HAL_OK )
+    // The forward scan converts the selected channels by increasing number: VREFINT (17) then the sensor (18)
+    bsp_adc[local_id].channel.Rank    = ADC_RANK_CHANNEL_NUMBER;
+    bsp_adc[local_id].channel.Channel = ADC_CHANNEL_VREFINT;
+    if( HAL_ADC_ConfigChannel( &bsp_adc[local_id].handle, &bsp_adc[local_id].channel ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+    bsp_adc[local_id].channel.Channel = ADC_CHANNEL_TEMPSENSOR;
+    if( HAL_ADC_ConfigChannel( &bsp_adc[local_id].handle, &bsp_adc[local_id].channel ) != HAL_OK )
     {
         bsp_mcu_panic( );
     }
+
+    HAL_NVIC_SetPriority( ADC1_COMP_IRQn, 3, 0 );
+    HAL_NVIC_EnableIRQ( ADC1_COMP_IRQn );
 }
 
-uint32_t bsp_adc_get_value( const uint32_t id, const uint32_t timeout_ms )
+bool bsp_adc_start_scan( const uint32_t id, uint16_t* values, const bsp_adc_irq_t* irq )
 {
     assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( bsp_adc ) ) );
     uint32_t local_id = id - 1;
 
-    // Wait for end of conversion
-    if( HAL_ADC_PollForConversion( &bsp_adc[local_id].handle, timeout_ms ) != HAL_OK )
+    if( ( HAL_ADC_GetState( &bsp_adc[local_id].handle ) & HAL_ADC_STATE_REG_BUSY ) != 0 )
     {
-        bsp_mcu_panic( );
+        return false;
     }
 
-    // Read ADC Value
-    return HAL_ADC_GetValue( &bsp_adc[local_id].handle );
+    bsp_adc[local_id].values = values;
+    bsp_adc[local_id].index  = 0;
+    bsp_adc[local_id].irq    = *irq;
+
+    if( HAL_ADC_Start_IT( &bsp_adc[local_id].handle ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+    return true;
 }
 
 void bsp_adc_deinit( const uint32_t id )
@@ -150,6 +173,7 @@ void bsp_adc_deinit( const uint32_t id )
     assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( bsp_adc ) ) );
     uint32_t local_id = id - 1;
 
+    HAL_NVIC_DisableIRQ( ADC1_COMP_IRQn );
     HAL_ADC_DeInit( &bsp_adc[local_id].handle );
 }
 
@@ -176,3 +200,23 @@ void HAL_ADC_MspDeInit( ADC_HandleTypeDef* adc_handle )
         bsp_mcu_panic( );
     }
 }
+
+void HAL_ADC_ConvCpltCallback( ADC_HandleTypeDef* adc_handle )
+{
+    bsp_adc_t* adc = &bsp_adc[0];
+
+    // Called at each end of conversion, the last one of the scan also ends the sequence
+    if( adc->index < BSP_ADC_SCAN_LENGTH )
+    {
+        adc->values[adc->index++] = ( uint16_t ) HAL_ADC_GetValue( adc_handle );
+    }
+    if( ( __HAL_ADC_GET_FLAG( adc_handle, ADC_FLAG_EOS ) != RESET ) && ( adc->irq.callback != NULL ) )
+    {
+        adc->irq.callback( adc->irq.context );
+    }
+}
+
+void ADC1_COMP_IRQHandler( void )
+{
+    HAL_ADC_IRQHandler( &bsp_adc[0].handle );
+}
@@ -0,0 +1,133 @@
+/*!
+ * \file      smtc_bsp_aes.c
+ *
+ * \brief     Board specific package AES API implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "stm32l0xx_hal.h"
+#include "smtc_bsp_aes.h"
+#include "smtc_bsp_mcu.h"
+
+#if !defined( AES )
+#error "SMTC_CRYPTO_HW_AES requires an STM32L0 part with the AES peripheral (STM32L0x1/L0x2/L0x3 AES products)"
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define BSP_AES_TIMEOUT_MS 10
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static CRYP_HandleTypeDef hcryp;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * Loads a new key and initial vector, the peripheral must be disabled
+ * for the key to be written so it is disabled first
+ */
+static void bsp_aes_setup( const uint8_t key[16], const uint8_t iv[16] );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void bsp_aes_ecb_encrypt( const uint8_t key[16], const uint32_t in[4], uint32_t out[4] )
+{
+    bsp_aes_setup( key, NULL );
+    if( HAL_CRYP_AESECB_Encrypt( &hcryp, ( uint8_t* ) in, 16, ( uint8_t* ) out, BSP_AES_TIMEOUT_MS ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+}
+
+void bsp_aes_ctr_encrypt( const uint8_t key[16], const uint8_t iv[16], uint32_t* buffer, uint16_t nb_blocks )
+{
+    bsp_aes_setup( key, iv );
+    // polled: the caller may hold a critical section, no interrupt is needed to complete
+    if( HAL_CRYP_AESCTR_Encrypt( &hcryp, ( uint8_t* ) buffer, nb_blocks * 16, ( uint8_t* ) buffer,
+                                 BSP_AES_TIMEOUT_MS ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+}
+
+void HAL_CRYP_MspInit( CRYP_HandleTypeDef* hcryp_handle )
+{
+    __HAL_RCC_AES_CLK_ENABLE( );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void bsp_aes_setup( const uint8_t key[16], const uint8_t iv[16] )
+{
+    hcryp.Instance        = AES;
+    hcryp.Init.DataType   = CRYP_DATATYPE_8B;
+    hcryp.Init.pKey       = ( uint8_t* ) key;
+    hcryp.Init.pInitVect  = ( uint8_t* ) iv;
+
+    // Back to the key/IV loading phase, HAL_CRYP_Init only runs the MSP init the first time
+    __HAL_CRYP_DISABLE( &hcryp );
+    if( HAL_CRYP_Init( &hcryp ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
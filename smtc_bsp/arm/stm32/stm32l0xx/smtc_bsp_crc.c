@@ -0,0 +1,181 @@
+/*!
+ * \file      smtc_bsp_crc.c
+ *
+ * \brief     Board specific package CRC API implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "stm32l0xx_hal.h"
+#include "smtc_bsp_crc.h"
+#include "smtc_bsp_mcu.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define BSP_CRC_TIMEOUT_MS 10
+
+/*!
+ * Below this number of words the CPU feeds the peripheral faster than the DMA can be set up
+ */
+#define BSP_CRC_DMA_MIN_WORDS 32
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static DMA_HandleTypeDef hdma_crc;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * Feeds nb_words 32 bits aligned words to the peripheral by memory to memory DMA, the data register is the
+ * destination. Polled, the channel interrupts stay disabled
+ */
+static void bsp_crc_dma_feed( const uint32_t* words, uint32_t nb_words );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+uint32_t bsp_crc32_compute( uint32_t seed, const uint8_t* buf, uint32_t len )
+{
+    uint32_t crc;
+
+    __HAL_RCC_CRC_CLK_ENABLE( );
+
+    // Default 0x04C11DB7 polynomial, the reflected CRC is obtained by reversing the input and the output bits. The
+    // register works on the non reflected CRC: the seed is reversed too
+    CRC->POL  = 0x04C11DB7;
+    CRC->INIT = __RBIT( seed );
+    CRC->CR   = CRC_CR_REV_OUT | CRC_CR_REV_IN_0 | CRC_CR_RESET;
+
+    // Bytes up to the first word boundary, each byte reversed on its own
+    while( ( len > 0 ) && ( ( ( uint32_t ) buf & 3 ) != 0 ) )
+    {
+        *( __IO uint8_t* ) &CRC->DR = *buf++;
+        len--;
+    }
+
+    // Words reversed as a whole: the first byte in memory is the first one processed
+    if( len >= 4 )
+    {
+        const uint32_t* words    = ( const uint32_t* ) buf;
+        uint32_t        nb_words = len >> 2;
+
+        CRC->CR = CRC_CR_REV_OUT | CRC_CR_REV_IN;
+        if( nb_words >= BSP_CRC_DMA_MIN_WORDS )
+        {
+            bsp_crc_dma_feed( words, nb_words );
+        }
+        else
+        {
+            for( uint32_t i = 0; i < nb_words; i++ )
+            {
+                CRC->DR = words[i];
+            }
+        }
+        buf += nb_words << 2;
+        len &= 3;
+        CRC->CR = CRC_CR_REV_OUT | CRC_CR_REV_IN_0;
+    }
+
+    while( len-- > 0 )
+    {
+        *( __IO uint8_t* ) &CRC->DR = *buf++;
+    }
+
+    crc = CRC->DR;
+    __HAL_RCC_CRC_CLK_DISABLE( );
+    return crc;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void bsp_crc_dma_feed( const uint32_t* words, uint32_t nb_words )
+{
+    __HAL_RCC_DMA1_CLK_ENABLE( );
+
+    // Memory to memory: the peripheral address of the channel is the source
+    hdma_crc.Instance                 = DMA1_Channel6;
+    hdma_crc.Init.Request             = DMA_REQUEST_0;
+    hdma_crc.Init.Direction           = DMA_MEMORY_TO_MEMORY;
+    hdma_crc.Init.PeriphInc           = DMA_PINC_ENABLE;
+    hdma_crc.Init.MemInc              = DMA_MINC_DISABLE;
+    hdma_crc.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
+    hdma_crc.Init.MemDataAlignment    = DMA_MDATAALIGN_WORD;
+    hdma_crc.Init.Mode                = DMA_NORMAL;
+    hdma_crc.Init.Priority            = DMA_PRIORITY_LOW;
+    if( HAL_DMA_Init( &hdma_crc ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+
+    // A DMA transfer is limited to 0xFFFF items
+    while( nb_words > 0 )
+    {
+        uint16_t chunk = ( nb_words > 0xFFFF ) ? 0xFFFF : nb_words;
+
+        if( ( HAL_DMA_Start( &hdma_crc, ( uint32_t ) words, ( uint32_t ) &CRC->DR, chunk ) != HAL_OK ) ||
+            ( HAL_DMA_PollForTransfer( &hdma_crc, HAL_DMA_FULL_TRANSFER, BSP_CRC_TIMEOUT_MS ) != HAL_OK ) )
+        {
+            bsp_mcu_panic( );
+        }
+        words += chunk;
+        nb_words -= chunk;
+    }
+    HAL_DMA_DeInit( &hdma_crc );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
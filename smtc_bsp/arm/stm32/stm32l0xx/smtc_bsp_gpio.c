@@ -36,16 +36,22 @@
 
 #include <stdint.h>   // C99 types
 #include <stdbool.h>  // bool type
+#include <string.h>   // memset
 
 #include "stm32l0xx_hal.h"
 #include "smtc_bsp_mcu.h"
 #include "smtc_bsp_gpio.h"
+#include "smtc_bsp_options.h"
+#include "smtc_bsp_perf.h"
 
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE MACROS-----------------------------------------------------------
  */
 
+// GPIOA to GPIOH, indexed by the high nibble of the pin name
+#define BSP_GPIO_PORT_NB 8
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE CONSTANTS -------------------------------------------------------
@@ -68,6 +74,20 @@ typedef struct bsp_gpio_s
     uint32_t             alternate;
 } bsp_gpio_t;
 
+/*!
+ * STOP mode pin states of a port, as register masks, and the run configuration they replace
+ */
+typedef struct bsp_gpio_sleep_port_s
+{
+    uint32_t mask;   // two bits per pin listed in the sleep table
+    uint32_t moder;  // MODER and PUPDR of the listed pins in STOP mode
+    uint32_t pupdr;
+    uint32_t bsrr;  // levels of the pins driven in STOP mode
+    uint32_t saved_moder;
+    uint32_t saved_pupdr;
+    uint32_t saved_odr;
+} bsp_gpio_sleep_port_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
@@ -78,6 +98,11 @@ typedef struct bsp_gpio_s
  */
 static bsp_gpio_irq_t const* gpio_irq[16];
 
+/*!
+ * STOP mode pin states of each port
+ */
+static bsp_gpio_sleep_port_t gpio_sleep[BSP_GPIO_PORT_NB];
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
@@ -98,6 +123,32 @@ static bsp_gpio_irq_t const* gpio_irq[16];
  */
 static void bsp_gpio_init( const bsp_gpio_t* gpio, const uint32_t value, const bsp_gpio_irq_t* irq );
 
+/*!
+ * Get the EXTI interrupt line shared by a pin
+ *
+ * \param [in]  pin        MCU pin name
+ * \param [out] group_mask Mask of the EXTI lines sharing the same interrupt. May be NULL
+ *
+ * \retval irqn            EXTI interrupt number
+ */
+static IRQn_Type bsp_gpio_get_exti_irqn( const bsp_gpio_pin_names_t pin, uint32_t* group_mask );
+
+/*!
+ * Get the NVIC priority of an EXTI interrupt, see BSP_EXTIx_IRQ_PRIORITY
+ *
+ * \param [in] irqn EXTI interrupt number
+ *
+ * \retval priority NVIC priority [0:3]
+ */
+static uint32_t bsp_gpio_get_exti_priority( const IRQn_Type irqn );
+
+/*!
+ * Call the attached callbacks of the pending EXTI lines sharing an interrupt, lowest line first
+ *
+ * \param [in] group_mask Mask of the EXTI lines sharing the interrupt
+ */
+static void bsp_gpio_exti_dispatch( const uint32_t group_mask );
+
 //
 // MCU output pin Handling
 //
@@ -195,6 +246,80 @@ bool bsp_gpio_is_pending_irq( void )
                ? true
                : false;
 }
+
+//
+// MCU pin states in STOP mode
+//
+
+void bsp_gpio_sleep_init( const bsp_gpio_sleep_pin_t* table, const uint8_t nb )
+{
+    // MODER: 00 input, 01 output, 11 analog. PUPDR: 00 none, 01 pull-up, 10 pull-down
+    const uint32_t moders[] = { 0x3, 0x1, 0x1, 0x0, 0x0 };
+    const uint32_t pupdrs[] = { 0x0, 0x0, 0x0, 0x1, 0x2 };
+
+    memset( gpio_sleep, 0, sizeof( gpio_sleep ) );
+    for( uint8_t i = 0; i < nb; i++ )
+    {
+        if( table[i].pin == NC )
+        {
+            continue;
+        }
+        const uint32_t port  = ( table[i].pin & 0xF0 ) >> 4;
+        const uint32_t shift = ( table[i].pin & 0x0F ) * 2;
+
+        gpio_sleep[port].mask |= 0x3UL << shift;
+        gpio_sleep[port].moder |= moders[table[i].state] << shift;
+        gpio_sleep[port].pupdr |= pupdrs[table[i].state] << shift;
+        if( table[i].state == BSP_GPIO_SLEEP_OUTPUT_LOW )
+        {
+            gpio_sleep[port].bsrr |= 1UL << ( ( table[i].pin & 0x0F ) + 16 );
+        }
+        else if( table[i].state == BSP_GPIO_SLEEP_OUTPUT_HIGH )
+        {
+            gpio_sleep[port].bsrr |= 1UL << ( table[i].pin & 0x0F );
+        }
+    }
+}
+
+void bsp_gpio_sleep_enter( void )
+{
+    for( uint32_t port = 0; port < BSP_GPIO_PORT_NB; port++ )
+    {
+        bsp_gpio_sleep_port_t* sleep     = &gpio_sleep[port];
+        GPIO_TypeDef*          gpio_port = ( GPIO_TypeDef* ) ( IOPPERIPH_BASE + ( port << 10 ) );
+
+        if( sleep->mask != 0 )
+        {
+            sleep->saved_moder = gpio_port->MODER;
+            sleep->saved_pupdr = gpio_port->PUPDR;
+            sleep->saved_odr   = gpio_port->ODR;
+
+            // The output level first, a pin must not glitch when it becomes an output
+            gpio_port->BSRR  = sleep->bsrr;
+            gpio_port->PUPDR = ( sleep->saved_pupdr & ~sleep->mask ) | sleep->pupdr;
+            gpio_port->MODER = ( sleep->saved_moder & ~sleep->mask ) | sleep->moder;
+        }
+    }
+}
+
+void bsp_gpio_sleep_exit( void )
+{
+    for( uint32_t port = 0; port < BSP_GPIO_PORT_NB; port++ )
+    {
+        bsp_gpio_sleep_port_t* sleep     = &gpio_sleep[port];
+        GPIO_TypeDef*          gpio_port = ( GPIO_TypeDef* ) ( IOPPERIPH_BASE + ( port << 10 ) );
+
+        if( sleep->mask != 0 )
+        {
+            // Only the listed pins are given back, their run output level before their run mode
+            const uint32_t driven = ( sleep->bsrr | ( sleep->bsrr >> 16 ) ) & 0xFFFF;
+
+            gpio_port->BSRR  = ( sleep->saved_odr & driven ) | ( ( ~sleep->saved_odr & driven ) << 16 );
+            gpio_port->MODER = ( gpio_port->MODER & ~sleep->mask ) | ( sleep->saved_moder & sleep->mask );
+            gpio_port->PUPDR = ( gpio_port->PUPDR & ~sleep->mask ) | ( sleep->saved_pupdr & sleep->mask );
+        }
+    }
+}
 //
 // MCU pin control private functions
 //
@@ -216,76 +341,128 @@ static void bsp_gpio_init( const bsp_gpio_t* gpio, const uint32_t value, const b
     if( ( gpio->mode == GPIO_MODE_IT_RISING ) || ( gpio->mode == GPIO_MODE_IT_FALLING ) ||
         ( gpio->mode == GPIO_MODE_IT_RISING_FALLING ) )
     {
+        IRQn_Type irqn = bsp_gpio_get_exti_irqn( gpio->pin, NULL );
+
         bsp_gpio_irq_attach( irq );
-        switch( gpio->pin & 0x0F )
+        HAL_NVIC_SetPriority( irqn, bsp_gpio_get_exti_priority( irqn ), 0 );
+        HAL_NVIC_EnableIRQ( irqn );
+    }
+    else if( ( gpio_irq[gpio->pin & 0x0F] != NULL ) && ( gpio_irq[gpio->pin & 0x0F]->pin == gpio->pin ) )
+    {
+        // The pin no longer triggers an IRQ: HAL_GPIO_Init leaves the EXTI line untouched, so release it here
+        // and drop any edge latched meanwhile, it must not be reported by bsp_gpio_is_pending_irq
+        uint32_t  group_mask;
+        IRQn_Type irqn = bsp_gpio_get_exti_irqn( gpio->pin, &group_mask );
+
+        EXTI->IMR &= ~gpio_local.Pin;
+        EXTI->RTSR &= ~gpio_local.Pin;
+        EXTI->FTSR &= ~gpio_local.Pin;
+        __HAL_GPIO_EXTI_CLEAR_IT( gpio_local.Pin );
+        gpio_irq[gpio->pin & 0x0F] = NULL;
+
+        if( ( EXTI->PR & group_mask ) == 0 )
         {
-        case 0:
-        case 1:
-            HAL_NVIC_SetPriority( EXTI0_1_IRQn, 0, 0 );
-            HAL_NVIC_EnableIRQ( EXTI0_1_IRQn );
-            break;
-        case 2:
-        case 3:
-            HAL_NVIC_SetPriority( EXTI2_3_IRQn, 0, 0 );
-            HAL_NVIC_EnableIRQ( EXTI2_3_IRQn );
-            break;
-        default:
-            HAL_NVIC_SetPriority( EXTI4_15_IRQn, 0, 0 );
-            HAL_NVIC_EnableIRQ( EXTI4_15_IRQn );
-            break;
+            HAL_NVIC_ClearPendingIRQ( irqn );
         }
     }
 }
 
-//
-// MCU interrupt handlers
-//
-
-void EXTI0_1_IRQHandler( void )
+static IRQn_Type bsp_gpio_get_exti_irqn( const bsp_gpio_pin_names_t pin, uint32_t* group_mask )
 {
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_0 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_1 );
-}
+    uint32_t  mask;
+    IRQn_Type irqn;
 
-void EXTI2_3_IRQHandler( void )
-{
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_2 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_3 );
+    switch( pin & 0x0F )
+    {
+    case 0:
+    case 1:
+        mask = 0x0003;
+        irqn = EXTI0_1_IRQn;
+        break;
+    case 2:
+    case 3:
+        mask = 0x000C;
+        irqn = EXTI2_3_IRQn;
+        break;
+    default:
+        mask = 0xFFF0;
+        irqn = EXTI4_15_IRQn;
+        break;
+    }
+
+    if( group_mask != NULL )
+    {
+        *group_mask = mask;
+    }
+
+    return irqn;
 }
 
-void EXTI4_15_IRQHandler( void )
+static uint32_t bsp_gpio_get_exti_priority( const IRQn_Type irqn )
 {
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_4 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_5 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_6 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_7 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_8 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_9 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_10 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_11 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_12 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_13 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_14 );
-    HAL_GPIO_EXTI_IRQHandler( GPIO_PIN_15 );
+    switch( irqn )
+    {
+    case EXTI0_1_IRQn:
+        return BSP_EXTI0_1_IRQ_PRIORITY;
+    case EXTI2_3_IRQn:
+        return BSP_EXTI2_3_IRQ_PRIORITY;
+    default:
+        return BSP_EXTI4_15_IRQ_PRIORITY;
+    }
 }
 
-void HAL_GPIO_EXTI_Callback( uint16_t gpio_pin )
+static void bsp_gpio_exti_dispatch( const uint32_t group_mask )
 {
-    uint8_t callback_index = 0;
+    uint32_t pending = EXTI->PR & group_mask;
+#if defined( PERF_TEST_ENABLED )
+    // the whole handler of the radio DIO line group is watched, the other lines of the group included
+    const bool is_radio_group = ( group_mask & ( 1UL << ( RADIO_DIOX & 0x0F ) ) ) != 0;
+
+    if( is_radio_group == true )
+    {
+        BSP_PERF_IRQ_ENTER( BSP_PERF_IRQ_RADIO_DIO );
+    }
+#endif
 
-    if( gpio_pin > 0 )
+    // Acknowledged at once before the callbacks, an edge occurring meanwhile raises the interrupt again
+    EXTI->PR = pending;
+
+    for( uint32_t line = 0; pending != 0; line++ )
     {
-        while( gpio_pin != 0x01 )
+        if( ( pending & ( 1UL << line ) ) != 0 )
         {
-            gpio_pin = gpio_pin >> 1;
-            callback_index++;
+            pending &= ~( 1UL << line );
+            if( ( gpio_irq[line] != NULL ) && ( gpio_irq[line]->callback != NULL ) )
+            {
+                gpio_irq[line]->callback( gpio_irq[line]->context );
+            }
         }
     }
-
-    if( ( gpio_irq[callback_index] != NULL ) && ( gpio_irq[callback_index]->callback != NULL ) )
+#if defined( PERF_TEST_ENABLED )
+    if( is_radio_group == true )
     {
-        gpio_irq[callback_index]->callback( gpio_irq[callback_index]->context );
+        BSP_PERF_IRQ_EXIT( BSP_PERF_IRQ_RADIO_DIO );
     }
+#endif
+}
+
+//
+// MCU interrupt handlers
+//
+
+void EXTI0_1_IRQHandler( void )
+{
+    bsp_gpio_exti_dispatch( 0x0003 );
+}
+
+void EXTI2_3_IRQHandler( void )
+{
+    bsp_gpio_exti_dispatch( 0x000C );
+}
+
+void EXTI4_15_IRQHandler( void )
+{
+    bsp_gpio_exti_dispatch( 0xFFF0 );
 }
 
 /*
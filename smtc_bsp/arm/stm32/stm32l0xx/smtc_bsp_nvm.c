@@ -39,17 +39,27 @@
 
 #include "stm32l0xx_hal.h"
 #include "smtc_bsp_nvm.h"
+#include "smtc_bsp_options.h"
 
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE MACROS-----------------------------------------------------------
  */
 
+#define JOURNAL_WORD_ROUND( size ) ( ( ( size ) + 3 ) & ~3UL )
+
+#define STAGING_HALF_PAGE_WORDS ( FLASH_PAGE_SIZE / 8 )
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+// Journal bank: a generation word and its complement, then the records up to a null word. A record is a header
+// word, key | size << 8 | crc16 << 16, followed by its data padded to a word
+#define JOURNAL_BANK_HEADER_SIZE   8
+#define JOURNAL_RECORD_HEADER_SIZE 4
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -60,11 +70,47 @@
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
+static bool     journal_is_init = false;
+static uint32_t journal_bank;        // offset of the active bank
+static uint32_t journal_generation;  // generation of the active bank, the highest valid one
+static uint32_t journal_end;         // offset in the active bank of the null word ending the records
+static uint16_t journal_index[BSP_NVM_JOURNAL_KEY_MAX + 1];  // offset in the bank of the last record of a key or 0
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+/*!
+ * \brief Program a data eeprom word, only if its value changes
+ */
+static void journal_word_store( uint32_t addr, uint32_t value );
+
+/*!
+ * \brief Read a data eeprom word
+ */
+static uint32_t journal_word_read( uint32_t addr );
+
+/*!
+ * \brief CRC-16/CCITT over the record key, size and data
+ */
+static uint16_t journal_crc16( uint8_t key, const uint8_t* data, uint8_t size );
+
+/*!
+ * \brief Find the active bank and index its records, format the first bank if no bank is valid
+ */
+static void journal_init( void );
+
+/*!
+ * \brief Index the records of a bank, stop at the null word or at the first corrupted record
+ */
+static void journal_scan( uint32_t bank );
+
+/*!
+ * \brief Copy the last record of each key to the other bank, which becomes the active one
+ */
+static void journal_compact( void );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -83,21 +129,343 @@ int32_t bsp_nvm_context_restore( const uint32_t addr, uint8_t* buffer, const uin
 int32_t bsp_nvm_context_store( uint32_t const addr, const uint8_t* buffer, uint32_t const size )
 {
     HAL_StatusTypeDef res = HAL_OK;
+    uint32_t          i   = 0;
 
+    // a byte or a word take the same programming time: program words when aligned, and only what changes
     HAL_FLASHEx_DATAEEPROM_Unlock( );
-    for( uint32_t i = 0; i < ( size ); i++ )
+    while( ( i < size ) && ( res == HAL_OK ) )
+    {
+        uint32_t eeprom_addr = DATA_EEPROM_BASE + addr + i;
+
+        if( ( ( eeprom_addr & 3 ) == 0 ) && ( ( size - i ) >= 4 ) )
+        {
+            uint32_t word;
+            memcpy( &word, &buffer[i], sizeof( word ) );
+            if( *( ( uint32_t* ) eeprom_addr ) != word )
+            {
+                res = HAL_FLASHEx_DATAEEPROM_Program( FLASH_TYPEPROGRAMDATA_WORD, eeprom_addr, word );
+            }
+            i += 4;
+        }
+        else
+        {
+            if( *( ( uint8_t* ) eeprom_addr ) != buffer[i] )
+            {
+                res = HAL_FLASHEx_DATAEEPROM_Program( FLASH_TYPEPROGRAMDATA_BYTE, eeprom_addr, buffer[i] );
+            }
+            i++;
+        }
+    }
+    HAL_FLASHEx_DATAEEPROM_Lock( );
+
+    return ( ( res == HAL_OK ) ? 0 : -1 );
+}
+
+int32_t bsp_nvm_journal_read( const uint8_t key, uint8_t* buffer, const uint8_t size )
+{
+    if( ( key == 0 ) || ( key > BSP_NVM_JOURNAL_KEY_MAX ) )
     {
-        *( ( uint8_t* ) ( DATA_EEPROM_BASE + addr ) + i ) = *( ( uint8_t* ) ( buffer ) + i );
+        return -1;
     }
+    journal_init( );
+    if( journal_index[key] == 0 )
+    {
+        return -1;
+    }
+
+    uint32_t record      = journal_bank + journal_index[key];
+    uint8_t  record_size = ( journal_word_read( record ) >> 8 ) & 0xFF;
+    uint8_t  read_size   = ( record_size < size ) ? record_size : size;
+
+    memcpy( buffer, ( uint8_t* ) ( DATA_EEPROM_BASE + record + JOURNAL_RECORD_HEADER_SIZE ), read_size );
+    return read_size;
+}
+
+int32_t bsp_nvm_journal_write( const uint8_t key, const uint8_t* buffer, const uint8_t size )
+{
+    if( ( key == 0 ) || ( key > BSP_NVM_JOURNAL_KEY_MAX ) || ( size == 0 ) )
+    {
+        return -1;
+    }
+    journal_init( );
+
+    if( journal_index[key] != 0 )
+    {  // unchanged value: nothing to append
+        uint32_t record = journal_bank + journal_index[key];
+
+        if( ( ( ( journal_word_read( record ) >> 8 ) & 0xFF ) == size ) &&
+            ( memcmp( ( uint8_t* ) ( DATA_EEPROM_BASE + record + JOURNAL_RECORD_HEADER_SIZE ), buffer, size ) == 0 ) )
+        {
+            return 0;
+        }
+    }
+
+    uint32_t record_size = JOURNAL_RECORD_HEADER_SIZE + JOURNAL_WORD_ROUND( size );
+
+    // the record and the null word after it must fit in the bank
+    if( ( journal_end + record_size + 4 ) > BSP_NVM_JOURNAL_BANK_SIZE )
+    {
+        journal_compact( );
+        if( ( journal_end + record_size + 4 ) > BSP_NVM_JOURNAL_BANK_SIZE )
+        {
+            return -1;
+        }
+    }
+
+    // null word first and header last: a record interrupted by a reset is dropped by the next scan
+    uint32_t record = journal_bank + journal_end;
+    uint32_t word;
 
+    HAL_FLASHEx_DATAEEPROM_Unlock( );
+    journal_word_store( record + record_size, 0 );
+    for( uint32_t i = 0; i < size; i += 4 )
+    {
+        word = 0;
+        memcpy( &word, &buffer[i], ( ( size - i ) < 4 ) ? ( size - i ) : 4 );
+        journal_word_store( record + JOURNAL_RECORD_HEADER_SIZE + i, word );
+    }
+    journal_word_store( record,
+                        key | ( ( uint32_t ) size << 8 ) | ( ( uint32_t ) journal_crc16( key, buffer, size ) << 16 ) );
     HAL_FLASHEx_DATAEEPROM_Lock( );
 
-    return ( res );
+    journal_index[key] = journal_end;
+    journal_end += record_size;
+    return size;
 }
 
+#if defined( BSP_NVM_STAGING_ENABLED )
+int32_t bsp_nvm_staging_read( const uint32_t offset, uint8_t* buffer, const uint32_t size )
+{
+    if( ( offset + size ) > BSP_NVM_STAGING_SIZE )
+    {
+        return -1;
+    }
+    memcpy( buffer, ( uint8_t* ) ( BSP_NVM_STAGING_ADDR + offset ), size );
+    return 0;
+}
+
+int32_t bsp_nvm_staging_write( const uint32_t offset, const uint8_t* buffer, const uint32_t size )
+{
+    HAL_StatusTypeDef res  = HAL_OK;
+    uint32_t          done = 0;
+    uint32_t          page[FLASH_PAGE_SIZE / 4];
+
+    if( ( offset + size ) > BSP_NVM_STAGING_SIZE )
+    {
+        return -1;
+    }
+
+    // a programmed word can't be changed without erasing its page: each page is merged in RAM, erased only if one
+    // of its programmed words changes, then only the words differing from the flash are programmed. An erased half
+    // page is programmed at once, in the time of a single word: the interrupts are only masked while its 16 words
+    // are written, the code keeps running from the other bank until the programming ends
+    HAL_FLASH_Unlock( );
+    while( ( done < size ) && ( res == HAL_OK ) )
+    {
+        uint32_t        addr       = BSP_NVM_STAGING_ADDR + offset + done;
+        uint32_t        page_addr  = addr & ~( FLASH_PAGE_SIZE - 1 );
+        uint32_t        start      = addr - page_addr;
+        uint32_t        length     = FLASH_PAGE_SIZE - start;
+        const uint32_t* flash      = ( const uint32_t* ) page_addr;
+        bool            need_erase = false;
+
+        if( length > ( size - done ) )
+        {
+            length = size - done;
+        }
+        memcpy( page, flash, FLASH_PAGE_SIZE );
+        memcpy( ( uint8_t* ) page + start, &buffer[done], length );
+        for( uint32_t i = 0; i < ( FLASH_PAGE_SIZE / 4 ); i++ )
+        {
+            if( ( page[i] != flash[i] ) && ( flash[i] != 0 ) )
+            {
+                need_erase = true;
+            }
+        }
+        if( need_erase == true )
+        {
+            FLASH_EraseInitTypeDef erase;
+            uint32_t               page_error;
+
+            erase.TypeErase   = FLASH_TYPEERASE_PAGES;
+            erase.PageAddress = page_addr;
+            erase.NbPages     = 1;
+            res               = HAL_FLASHEx_Erase( &erase, &page_error );
+        }
+        for( uint32_t half = 0; ( half < ( FLASH_PAGE_SIZE / 4 ) ) && ( res == HAL_OK );
+             half += STAGING_HALF_PAGE_WORDS )
+        {
+            bool     is_erased  = true;
+            uint32_t changed_nb = 0;
+
+            for( uint32_t i = half; i < ( half + STAGING_HALF_PAGE_WORDS ); i++ )
+            {
+                is_erased = ( flash[i] == 0 ) ? is_erased : false;
+                changed_nb += ( page[i] != flash[i] ) ? 1 : 0;
+            }
+            if( ( is_erased == true ) && ( changed_nb > 1 ) )
+            {
+                res = HAL_FLASHEx_HalfPageProgram( page_addr + ( half * 4 ), &page[half] );
+                continue;
+            }
+            for( uint32_t i = half; ( i < ( half + STAGING_HALF_PAGE_WORDS ) ) && ( res == HAL_OK ); i++ )
+            {
+                if( page[i] != flash[i] )
+                {
+                    res = HAL_FLASH_Program( FLASH_TYPEPROGRAM_WORD, page_addr + ( i * 4 ), page[i] );
+                }
+            }
+        }
+        done += length;
+    }
+    HAL_FLASH_Lock( );
+
+    return ( ( res == HAL_OK ) ? 0 : -1 );
+}
+#else
+// no staging area: the firmware may use the whole program flash
+int32_t bsp_nvm_staging_read( const uint32_t offset, uint8_t* buffer, const uint32_t size )
+{
+    return -1;
+}
+
+int32_t bsp_nvm_staging_write( const uint32_t offset, const uint8_t* buffer, const uint32_t size )
+{
+    return -1;
+}
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static void journal_word_store( uint32_t addr, uint32_t value )
+{
+    if( journal_word_read( addr ) != value )
+    {
+        HAL_FLASHEx_DATAEEPROM_Program( FLASH_TYPEPROGRAMDATA_WORD, DATA_EEPROM_BASE + addr, value );
+    }
+}
+
+static uint32_t journal_word_read( uint32_t addr )
+{
+    return *( ( uint32_t* ) ( DATA_EEPROM_BASE + addr ) );
+}
+
+static uint16_t journal_crc16( uint8_t key, const uint8_t* data, uint8_t size )
+{
+    uint16_t crc = 0xFFFF;
+
+    for( int16_t i = -2; i < size; i++ )
+    {
+        crc ^= ( uint16_t )( ( i == -2 ) ? key : ( ( i == -1 ) ? size : data[i] ) ) << 8;
+        for( uint8_t j = 0; j < 8; j++ )
+        {
+            crc = ( crc & 0x8000 ) ? ( crc << 1 ) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static void journal_init( void )
+{
+    if( journal_is_init == true )
+    {
+        return;
+    }
+    journal_is_init = true;
+
+    bool     is_bank_valid[2];
+    uint32_t generation[2];
+
+    for( uint8_t i = 0; i < 2; i++ )
+    {
+        uint32_t bank = BSP_NVM_JOURNAL_ADDR_OFFSET + i * BSP_NVM_JOURNAL_BANK_SIZE;
+
+        generation[i]    = journal_word_read( bank );
+        is_bank_valid[i] = ( journal_word_read( bank + 4 ) == ~generation[i] );
+    }
+
+    if( ( is_bank_valid[0] == false ) && ( is_bank_valid[1] == false ) )
+    {  // blank or corrupted journal: format the first bank
+        journal_bank = BSP_NVM_JOURNAL_ADDR_OFFSET;
+        HAL_FLASHEx_DATAEEPROM_Unlock( );
+        journal_word_store( journal_bank + JOURNAL_BANK_HEADER_SIZE, 0 );
+        journal_word_store( journal_bank, 1 );
+        journal_word_store( journal_bank + 4, ~( uint32_t ) 1 );
+        HAL_FLASHEx_DATAEEPROM_Lock( );
+        journal_generation = 1;
+    }
+    else
+    {  // both are valid when the compaction was interrupted before the old bank is dropped: take the newest
+        uint8_t i = ( ( is_bank_valid[0] == false ) ||
+                      ( ( is_bank_valid[1] == true ) && ( ( int32_t )( generation[1] - generation[0] ) > 0 ) ) )
+                        ? 1
+                        : 0;
+
+        journal_bank       = BSP_NVM_JOURNAL_ADDR_OFFSET + i * BSP_NVM_JOURNAL_BANK_SIZE;
+        journal_generation = generation[i];
+    }
+    journal_scan( journal_bank );
+}
+
+static void journal_scan( uint32_t bank )
+{
+    memset( journal_index, 0, sizeof( journal_index ) );
+    journal_end = JOURNAL_BANK_HEADER_SIZE;
+
+    while( ( journal_end + JOURNAL_RECORD_HEADER_SIZE ) <= BSP_NVM_JOURNAL_BANK_SIZE )
+    {
+        uint32_t header = journal_word_read( bank + journal_end );
+        uint8_t  key    = header & 0xFF;
+        uint8_t  size   = ( header >> 8 ) & 0xFF;
+
+        if( ( header == 0 ) || ( key == 0 ) || ( key > BSP_NVM_JOURNAL_KEY_MAX ) ||
+            ( ( journal_end + JOURNAL_RECORD_HEADER_SIZE + JOURNAL_WORD_ROUND( size ) ) > BSP_NVM_JOURNAL_BANK_SIZE ) ||
+            ( journal_crc16( key, ( uint8_t* ) ( DATA_EEPROM_BASE + bank + journal_end + JOURNAL_RECORD_HEADER_SIZE ),
+                             size ) != ( header >> 16 ) ) )
+        {
+            break;
+        }
+        journal_index[key] = journal_end;
+        journal_end += JOURNAL_RECORD_HEADER_SIZE + JOURNAL_WORD_ROUND( size );
+    }
+}
+
+static void journal_compact( void )
+{
+    uint32_t new_bank = ( journal_bank == BSP_NVM_JOURNAL_ADDR_OFFSET )
+                            ? ( BSP_NVM_JOURNAL_ADDR_OFFSET + BSP_NVM_JOURNAL_BANK_SIZE )
+                            : BSP_NVM_JOURNAL_ADDR_OFFSET;
+    uint32_t new_end  = JOURNAL_BANK_HEADER_SIZE;
+
+    HAL_FLASHEx_DATAEEPROM_Unlock( );
+    for( uint8_t key = 1; key <= BSP_NVM_JOURNAL_KEY_MAX; key++ )
+    {
+        if( journal_index[key] == 0 )
+        {
+            continue;
+        }
+        uint32_t record      = journal_bank + journal_index[key];
+        uint32_t record_size =
+            JOURNAL_RECORD_HEADER_SIZE + JOURNAL_WORD_ROUND( ( journal_word_read( record ) >> 8 ) & 0xFF );
+
+        for( uint32_t i = 0; i < record_size; i += 4 )
+        {
+            journal_word_store( new_bank + new_end + i, journal_word_read( record + i ) );
+        }
+        new_end += record_size;
+    }
+    journal_word_store( new_bank + new_end, 0 );
+    // the new bank is valid once its header is written, the old one is dropped by its lower generation
+    journal_generation++;
+    journal_word_store( new_bank + 4, ~journal_generation );
+    journal_word_store( new_bank, journal_generation );
+    HAL_FLASHEx_DATAEEPROM_Lock( );
+
+    journal_bank = new_bank;
+    journal_scan( journal_bank );
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,479 @@
+/*!
+ * \file      smtc_bsp_perf.c
+ *
+ * \brief     Board specific package performance test event registry implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memset
+
+#include "smtc_bsp_perf.h"
+#include "smtc_bsp_mcu.h"
+#include "smtc_bsp_rtc.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * Size of the dump part before the records: counters, lost records and number of records
+ */
+#define BSP_PERF_DUMP_HEADER_SIZE ( 1 + ( 4 * BSP_PERF_EVENT_NB ) + 2 + 1 )
+
+/*!
+ * Size of a record in the dump
+ */
+#define BSP_PERF_DUMP_RECORD_SIZE 6
+
+/*!
+ * Size of the latency histograms dump
+ */
+#define BSP_PERF_LATENCY_DUMP_SIZE ( 2 + ( 2 * BSP_PERF_LATENCY_STAGE_NB * BSP_PERF_LATENCY_BUCKET_NB ) )
+
+/*!
+ * Size of the interrupt monitor dump
+ */
+#define BSP_PERF_IRQ_DUMP_SIZE ( 2 + ( BSP_PERF_IRQ_SOURCE_NB * ( 8 + ( 2 * BSP_PERF_LATENCY_BUCKET_NB ) ) ) + 8 )
+
+/*!
+ * Position of each event in the uplink chain, BSP_PERF_CHAIN_NONE for the events out of the chain
+ */
+#define BSP_PERF_CHAIN_NONE 0xFF
+static const uint8_t bsp_perf_chain_position[BSP_PERF_EVENT_NB] = {
+    [BSP_PERF_EVENT_HOST_CMD]    = 0,
+    [BSP_PERF_EVENT_TX_ENQUEUED] = 1,
+    [BSP_PERF_EVENT_SEND_LAUNCH] = 2,
+    [BSP_PERF_EVENT_MAC_TX]      = 3,
+    [BSP_PERF_EVENT_TX_LAUNCH]   = 4,
+    [BSP_PERF_EVENT_TX_START]    = 5,
+    [BSP_PERF_EVENT_RADIO_IRQ]   = 6,
+    [BSP_PERF_EVENT_TX_DONE]     = 7,
+    [BSP_PERF_EVENT_TX_EVENT]    = 8,
+    [BSP_PERF_EVENT_RX_OPEN]     = BSP_PERF_CHAIN_NONE,
+    [BSP_PERF_EVENT_RX_DONE]     = BSP_PERF_CHAIN_NONE,
+    [BSP_PERF_EVENT_RX_TIMEOUT]  = BSP_PERF_CHAIN_NONE,
+    [BSP_PERF_EVENT_BOOT]        = BSP_PERF_CHAIN_NONE,
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef struct bsp_perf_record_s
+{
+    uint32_t ticks;
+    uint8_t  event;
+    uint8_t  arg;
+} bsp_perf_record_t;
+
+typedef struct bsp_perf_irq_stats_s
+{
+    uint32_t start_cycles;    // entry of the running handler
+    uint32_t start_clock_hz;  // core clock at the entry, the cycles of another clock do not compare
+    uint32_t blocked_us;      // longest section or handler the pending interrupt waited for
+    uint32_t latency_max_us;
+    uint32_t duration_max_us;
+    uint16_t latency_histogram[BSP_PERF_LATENCY_BUCKET_NB];
+} bsp_perf_irq_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uint32_t          bsp_perf_counters[BSP_PERF_EVENT_NB];
+static bsp_perf_record_t bsp_perf_records[BSP_PERF_RECORD_NB];
+static uint16_t          bsp_perf_records_lost = 0;
+// free running indexes, the buffer is empty when they are equal
+static uint32_t bsp_perf_write_index = 0;
+static uint32_t bsp_perf_read_index  = 0;
+
+static uint16_t bsp_perf_latency_histograms[BSP_PERF_LATENCY_STAGE_NB][BSP_PERF_LATENCY_BUCKET_NB];
+// last host command, an uplink chain starts when it enqueues a transmission
+static uint32_t bsp_perf_host_cmd_ticks = 0;
+// last event of the uplink chain in progress
+static uint8_t  bsp_perf_chain_last_position = BSP_PERF_CHAIN_NONE;
+static uint32_t bsp_perf_chain_last_ticks    = 0;
+
+static bsp_perf_irq_stats_t bsp_perf_irq_stats[BSP_PERF_IRQ_SOURCE_NB];
+// outermost critical section in progress
+static uint32_t bsp_perf_critical_start_cycles   = 0;
+static uint32_t bsp_perf_critical_start_clock_hz = 0;
+static uint32_t bsp_perf_critical_caller         = 0;
+// longest critical section since the last dump
+static uint32_t bsp_perf_critical_max_us     = 0;
+static uint32_t bsp_perf_critical_max_caller = 0;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * Writes a 32 bits value in big endian and returns the next write position
+ */
+static uint8_t* bsp_perf_put_u32( uint8_t* p, uint32_t value );
+
+/*!
+ * Follows the uplink chain and adds the latency from the previous event to the histogram of the stage
+ */
+static void bsp_perf_latency_update( bsp_perf_event_t event, uint32_t ticks );
+
+/*!
+ * Gets the histogram bucket of a latency
+ */
+static uint8_t bsp_perf_get_bucket( uint32_t latency );
+
+/*!
+ * Gets the time elapsed since a cycle count, false if the core clock changed meanwhile
+ */
+static bool bsp_perf_get_elapsed_us( uint32_t start_cycles, uint32_t start_clock_hz, uint32_t* elapsed_us );
+
+/*!
+ * Charges a section or a handler that just ended to the watched interrupts which waited for it
+ */
+static void bsp_perf_irq_blocked( uint32_t duration_us );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void bsp_perf_init( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    for( uint8_t i = 0; i < BSP_PERF_EVENT_NB; i++ )
+    {
+        bsp_perf_counters[i] = 0;
+    }
+    bsp_perf_records_lost = 0;
+    bsp_perf_write_index  = 0;
+    bsp_perf_read_index   = 0;
+    memset( bsp_perf_latency_histograms, 0, sizeof( bsp_perf_latency_histograms ) );
+    bsp_perf_chain_last_position = BSP_PERF_CHAIN_NONE;
+    memset( bsp_perf_irq_stats, 0, sizeof( bsp_perf_irq_stats ) );
+    bsp_perf_critical_max_us     = 0;
+    bsp_perf_critical_max_caller = 0;
+    CRITICAL_SECTION_END( );
+}
+
+void bsp_perf_event( bsp_perf_event_t event, uint8_t arg )
+{
+    CRITICAL_SECTION_BEGIN( );
+    const uint32_t ticks = ( uint32_t ) bsp_rtc_get_ticks( );
+
+    bsp_perf_counters[event]++;
+    bsp_perf_latency_update( event, ticks );
+    if( ( bsp_perf_write_index - bsp_perf_read_index ) < BSP_PERF_RECORD_NB )
+    {
+        bsp_perf_record_t* record = &bsp_perf_records[bsp_perf_write_index & ( BSP_PERF_RECORD_NB - 1 )];
+
+        record->ticks = ticks;
+        record->event = event;
+        record->arg   = arg;
+        bsp_perf_write_index++;
+    }
+    else if( bsp_perf_records_lost < UINT16_MAX )
+    {
+        bsp_perf_records_lost++;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+uint8_t bsp_perf_dump( uint8_t* buffer, uint8_t max_length )
+{
+    uint8_t* p = buffer;
+
+    if( max_length < BSP_PERF_DUMP_HEADER_SIZE )
+    {
+        return 0;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    uint32_t nb_records = bsp_perf_write_index - bsp_perf_read_index;
+    if( nb_records > ( uint32_t ) ( ( max_length - BSP_PERF_DUMP_HEADER_SIZE ) / BSP_PERF_DUMP_RECORD_SIZE ) )
+    {
+        nb_records = ( max_length - BSP_PERF_DUMP_HEADER_SIZE ) / BSP_PERF_DUMP_RECORD_SIZE;
+    }
+
+    *p++ = BSP_PERF_EVENT_NB;
+    for( uint8_t i = 0; i < BSP_PERF_EVENT_NB; i++ )
+    {
+        p = bsp_perf_put_u32( p, bsp_perf_counters[i] );
+    }
+    *p++                  = bsp_perf_records_lost >> 8;
+    *p++                  = bsp_perf_records_lost & 0xFF;
+    bsp_perf_records_lost = 0;
+
+    *p++ = ( uint8_t ) nb_records;
+    for( uint32_t i = 0; i < nb_records; i++ )
+    {
+        const bsp_perf_record_t* record = &bsp_perf_records[bsp_perf_read_index & ( BSP_PERF_RECORD_NB - 1 )];
+
+        *p++ = record->event;
+        *p++ = record->arg;
+        p    = bsp_perf_put_u32( p, record->ticks );
+        bsp_perf_read_index++;
+    }
+    CRITICAL_SECTION_END( );
+
+    return p - buffer;
+}
+
+uint8_t bsp_perf_latency_dump( uint8_t* buffer, uint8_t max_length )
+{
+    uint8_t* p = buffer;
+
+    if( max_length < BSP_PERF_LATENCY_DUMP_SIZE )
+    {
+        return 0;
+    }
+
+    *p++ = BSP_PERF_LATENCY_STAGE_NB;
+    *p++ = BSP_PERF_LATENCY_BUCKET_NB;
+    CRITICAL_SECTION_BEGIN( );
+    for( uint8_t stage = 0; stage < BSP_PERF_LATENCY_STAGE_NB; stage++ )
+    {
+        for( uint8_t bucket = 0; bucket < BSP_PERF_LATENCY_BUCKET_NB; bucket++ )
+        {
+            *p++ = bsp_perf_latency_histograms[stage][bucket] >> 8;
+            *p++ = bsp_perf_latency_histograms[stage][bucket] & 0xFF;
+        }
+    }
+    memset( bsp_perf_latency_histograms, 0, sizeof( bsp_perf_latency_histograms ) );
+    CRITICAL_SECTION_END( );
+
+    return p - buffer;
+}
+
+void bsp_perf_irq_enter( bsp_perf_irq_source_t source )
+{
+    bsp_perf_irq_stats_t* stats = &bsp_perf_irq_stats[source];
+
+    CRITICAL_SECTION_BEGIN( );
+    const uint8_t bucket = bsp_perf_get_bucket( stats->blocked_us );
+
+    if( stats->blocked_us > stats->latency_max_us )
+    {
+        stats->latency_max_us = stats->blocked_us;
+    }
+    if( stats->latency_histogram[bucket] < UINT16_MAX )
+    {
+        stats->latency_histogram[bucket]++;
+    }
+    stats->blocked_us     = 0;
+    stats->start_clock_hz = bsp_mcu_get_core_clock_hz( );
+    stats->start_cycles   = bsp_mcu_get_cycle_count( );
+    CRITICAL_SECTION_END( );
+}
+
+void bsp_perf_irq_exit( bsp_perf_irq_source_t source )
+{
+    bsp_perf_irq_stats_t* stats = &bsp_perf_irq_stats[source];
+    uint32_t              duration_us;
+
+    CRITICAL_SECTION_BEGIN( );
+    if( bsp_perf_get_elapsed_us( stats->start_cycles, stats->start_clock_hz, &duration_us ) == true )
+    {
+        if( duration_us > stats->duration_max_us )
+        {
+            stats->duration_max_us = duration_us;
+        }
+        // the interrupts of the same or a lower priority could not preempt the handler
+        bsp_perf_irq_blocked( duration_us );
+    }
+    CRITICAL_SECTION_END( );
+}
+
+void bsp_perf_critical_begin( uint32_t caller )
+{
+    bsp_perf_critical_caller         = caller;
+    bsp_perf_critical_start_clock_hz = bsp_mcu_get_core_clock_hz( );
+    bsp_perf_critical_start_cycles   = bsp_mcu_get_cycle_count( );
+}
+
+void bsp_perf_critical_end( void )
+{
+    uint32_t duration_us;
+
+    if( bsp_perf_get_elapsed_us( bsp_perf_critical_start_cycles, bsp_perf_critical_start_clock_hz, &duration_us ) ==
+        true )
+    {
+        if( duration_us > bsp_perf_critical_max_us )
+        {
+            bsp_perf_critical_max_us     = duration_us;
+            bsp_perf_critical_max_caller = bsp_perf_critical_caller;
+        }
+        bsp_perf_irq_blocked( duration_us );
+    }
+}
+
+uint8_t bsp_perf_irq_dump( uint8_t* buffer, uint8_t max_length )
+{
+    uint8_t* p = buffer;
+
+    if( max_length < BSP_PERF_IRQ_DUMP_SIZE )
+    {
+        return 0;
+    }
+
+    *p++ = BSP_PERF_IRQ_SOURCE_NB;
+    *p++ = BSP_PERF_LATENCY_BUCKET_NB;
+    CRITICAL_SECTION_BEGIN( );
+    for( uint8_t source = 0; source < BSP_PERF_IRQ_SOURCE_NB; source++ )
+    {
+        bsp_perf_irq_stats_t* stats = &bsp_perf_irq_stats[source];
+
+        p = bsp_perf_put_u32( p, stats->latency_max_us );
+        p = bsp_perf_put_u32( p, stats->duration_max_us );
+        for( uint8_t bucket = 0; bucket < BSP_PERF_LATENCY_BUCKET_NB; bucket++ )
+        {
+            *p++ = stats->latency_histogram[bucket] >> 8;
+            *p++ = stats->latency_histogram[bucket] & 0xFF;
+        }
+        // a handler may be running, its entry and the latency it is waiting with are kept
+        stats->latency_max_us  = 0;
+        stats->duration_max_us = 0;
+        memset( stats->latency_histogram, 0, sizeof( stats->latency_histogram ) );
+    }
+    p                            = bsp_perf_put_u32( p, bsp_perf_critical_max_us );
+    p                            = bsp_perf_put_u32( p, bsp_perf_critical_max_caller );
+    bsp_perf_critical_max_us     = 0;
+    bsp_perf_critical_max_caller = 0;
+    CRITICAL_SECTION_END( );
+
+    return p - buffer;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void bsp_perf_latency_update( bsp_perf_event_t event, uint32_t ticks )
+{
+    const uint8_t position = bsp_perf_chain_position[event];
+    uint32_t      latency;
+
+    if( position == BSP_PERF_CHAIN_NONE )
+    {
+        return;
+    }
+    if( position == 0 )
+    {
+        // the host keeps sending commands (i.e. event polling) while an uplink is in progress
+        bsp_perf_host_cmd_ticks = ticks;
+        return;
+    }
+
+    if( position == 1 )
+    {
+        // a new uplink restarts the chain, whatever happened to the previous one
+        latency = ticks - bsp_perf_host_cmd_ticks;
+    }
+    else if( bsp_perf_chain_last_position == ( position - 1 ) )
+    {
+        latency = ticks - bsp_perf_chain_last_ticks;
+    }
+    else
+    {
+        // out of the chain, i.e. network initiated uplink or radio task of another hook
+        return;
+    }
+
+    const uint8_t bucket = bsp_perf_get_bucket( latency );
+    if( bsp_perf_latency_histograms[position - 1][bucket] < UINT16_MAX )
+    {
+        bsp_perf_latency_histograms[position - 1][bucket]++;
+    }
+
+    bsp_perf_chain_last_position = ( position < BSP_PERF_LATENCY_STAGE_NB ) ? position : BSP_PERF_CHAIN_NONE;
+    bsp_perf_chain_last_ticks    = ticks;
+}
+
+static uint8_t bsp_perf_get_bucket( uint32_t latency )
+{
+    uint8_t bucket = 0;
+
+    while( ( latency != 0 ) && ( bucket < ( BSP_PERF_LATENCY_BUCKET_NB - 1 ) ) )
+    {
+        latency >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static bool bsp_perf_get_elapsed_us( uint32_t start_cycles, uint32_t start_clock_hz, uint32_t* elapsed_us )
+{
+    const uint32_t clock_hz = bsp_mcu_get_core_clock_hz( );
+
+    // a clock boost or a stop mode wake up reloads SysTick, the cycles are then counted at another rate
+    if( ( clock_hz != start_clock_hz ) || ( clock_hz == 0 ) )
+    {
+        return false;
+    }
+    *elapsed_us = ( uint32_t ) ( ( ( uint64_t ) ( bsp_mcu_get_cycle_count( ) - start_cycles ) * 1000000 ) / clock_hz );
+    return true;
+}
+
+static void bsp_perf_irq_blocked( uint32_t duration_us )
+{
+    const uint32_t pending = bsp_perf_irq_get_pending( );
+
+    for( uint8_t source = 0; source < BSP_PERF_IRQ_SOURCE_NB; source++ )
+    {
+        if( ( ( pending & ( 1UL << source ) ) != 0 ) && ( duration_us > bsp_perf_irq_stats[source].blocked_us ) )
+        {
+            bsp_perf_irq_stats[source].blocked_us = duration_us;
+        }
+    }
+}
+
+static uint8_t* bsp_perf_put_u32( uint8_t* p, uint32_t value )
+{
+    *p++ = ( value >> 24 ) & 0xFF;
+    *p++ = ( value >> 16 ) & 0xFF;
+    *p++ = ( value >> 8 ) & 0xFF;
+    *p++ = value & 0xFF;
+    return p;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
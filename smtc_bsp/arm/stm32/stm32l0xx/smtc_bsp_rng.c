@@ -40,6 +40,8 @@
 #include "stm32l0xx_hal.h"
 #include "smtc_bsp_rng.h"
 #include "smtc_bsp_mcu.h"
+#include "smtc_bsp_uart.h"
+#include "smtc_bsp_options.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -51,6 +53,11 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+/*!
+ * Random words kept ahead, the refill starts once half of them are used
+ */
+#define BSP_RNG_POOL_SIZE 8
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -63,11 +70,26 @@
 
 static RNG_HandleTypeDef rng_handle;
 
+static volatile uint32_t rng_pool[BSP_RNG_POOL_SIZE];
+static volatile uint8_t  rng_pool_count   = 0;
+static volatile bool     rng_pool_filling = false;  // the peripheral is clocked while true
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+/*!
+ * Clocks the peripheral and asks for the next word under interrupt, if the pool isn't already being filled.
+ * Must be called in a critical section
+ */
+static void bsp_rng_pool_fill_start( void );
+
+/*!
+ * Returns a random number in [0, range - 1] without modulo bias, a range of 0 meaning 2^32
+ */
+static uint32_t bsp_rng_get_random_below( const uint32_t range );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -77,19 +99,26 @@ uint32_t bsp_rng_get_random( void )
 {
     uint32_t rand_nb = 0;
 
-    // Init and enable RNG
-    rng_handle.Instance = RNG;
-
-    if( HAL_RNG_Init( &rng_handle ) != HAL_OK )
+    CRITICAL_SECTION_BEGIN( );
+    if( rng_pool_count > 0 )
     {
-        bsp_mcu_panic( );
+        rand_nb = rng_pool[--rng_pool_count];
+        if( rng_pool_count <= ( BSP_RNG_POOL_SIZE / 2 ) )
+        {
+            bsp_rng_pool_fill_start( );
+        }
     }
-
-    // Wait for data ready interrupt: 42+4 RNG clock cycles
-    rand_nb = ( uint32_t ) HAL_RNG_GetRandomNumber( &rng_handle );
-
-    // Disable RNG
-    HAL_RNG_DeInit( &rng_handle );
+    else
+    {
+        // Pool used up by a burst of draws: wait for the next word, 42+4 RNG clock cycles. A pending data ready
+        // interrupt finds the flag already cleared and waits for the following word
+        bsp_rng_pool_fill_start( );
+        while( __HAL_RNG_GET_FLAG( &rng_handle, RNG_FLAG_DRDY ) == RESET )
+        {
+        }
+        rand_nb = rng_handle.Instance->DR;
+    }
+    CRITICAL_SECTION_END( );
 
     return rand_nb;
 }
@@ -98,11 +127,11 @@ uint32_t bsp_rng_get_random_in_range( const uint32_t val_1, const uint32_t val_2
 {
     if( val_1 <= val_2 )
     {
-        return ( uint32_t )( ( bsp_rng_get_random( ) % ( val_2 - val_1 + 1 ) ) + val_1 );
+        return bsp_rng_get_random_below( val_2 - val_1 + 1 ) + val_1;
     }
     else
     {
-        return ( uint32_t )( ( bsp_rng_get_random( ) % ( val_1 - val_2 + 1 ) ) + val_2 );
+        return bsp_rng_get_random_below( val_1 - val_2 + 1 ) + val_2;
     }
 }
 
@@ -126,15 +155,66 @@ void HAL_RNG_MspInit( RNG_HandleTypeDef* hrng )
 {
     // RNG Peripheral clock enable
     __RNG_CLK_ENABLE( );
+
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_OFF )
+    // Background refill, the shared line is free: LPUART1 isn't used
+    HAL_NVIC_SetPriority( RNG_LPUART1_IRQn, 3, 0 );
+    HAL_NVIC_EnableIRQ( RNG_LPUART1_IRQn );
+#endif
 }
 
 void HAL_RNG_MspDeInit( RNG_HandleTypeDef* hrng )
 {
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_OFF )
+    HAL_NVIC_DisableIRQ( RNG_LPUART1_IRQn );
+#endif
+
     // Enable RNG reset state
     __RNG_FORCE_RESET( );
 
     // Release RNG from reset state
     __RNG_RELEASE_RESET( );
+
+    __RNG_CLK_DISABLE( );
+}
+
+void HAL_RNG_ReadyDataCallback( RNG_HandleTypeDef* hrng, uint32_t random32bit )
+{
+    // A draw from a higher priority interrupt must not take the word being stored
+    CRITICAL_SECTION_BEGIN( );
+    if( rng_pool_count < BSP_RNG_POOL_SIZE )
+    {
+        rng_pool[rng_pool_count++] = random32bit;
+    }
+    if( rng_pool_count < BSP_RNG_POOL_SIZE )
+    {
+        HAL_RNG_GenerateRandomNumber_IT( hrng );
+    }
+    else
+    {
+        HAL_RNG_DeInit( hrng );
+        rng_pool_filling = false;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+void HAL_RNG_ErrorCallback( RNG_HandleTypeDef* hrng )
+{
+    // Seed or clock error: restarted from reset by the next refill
+    HAL_RNG_DeInit( hrng );
+    rng_pool_filling = false;
+}
+
+void RNG_LPUART1_IRQHandler( void )
+{
+    if( rng_pool_filling == true )
+    {
+        HAL_RNG_IRQHandler( &rng_handle );
+    }
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+    // The line is enabled by the host UART, at its priority
+    bsp_uart1_lpuart_irq_handler( );
+#endif
 }
 
 /*
@@ -142,4 +222,41 @@ void HAL_RNG_MspDeInit( RNG_HandleTypeDef* hrng )
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static void bsp_rng_pool_fill_start( void )
+{
+    if( rng_pool_filling == false )
+    {
+        rng_handle.Instance = RNG;
+        if( ( HAL_RNG_Init( &rng_handle ) != HAL_OK ) || ( HAL_RNG_GenerateRandomNumber_IT( &rng_handle ) != HAL_OK ) )
+        {
+            bsp_mcu_panic( );
+        }
+        rng_pool_filling = true;
+    }
+}
+
+static uint32_t bsp_rng_get_random_below( const uint32_t range )
+{
+    uint64_t product;
+    uint32_t threshold;
+
+    if( range == 0 )
+    {
+        return bsp_rng_get_random( );
+    }
+
+    // Multiply-shift: the high word is in range, the draws whose low word falls in the 2^32 % range values
+    // that would favour some high words are rejected
+    product = ( uint64_t ) bsp_rng_get_random( ) * range;
+    if( ( uint32_t ) product < range )
+    {
+        threshold = ( 0 - range ) % range;
+        while( ( uint32_t ) product < threshold )
+        {
+            product = ( uint64_t ) bsp_rng_get_random( ) * range;
+        }
+    }
+    return ( uint32_t )( product >> 32 );
+}
+
 /* --- EOF ------------------------------------------------------------------ */
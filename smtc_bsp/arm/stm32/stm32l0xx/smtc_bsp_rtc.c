@@ -102,6 +102,12 @@ typedef struct bsp_rtc_s
      * Value is kept as a Reference to calculate alarm
      */
     rtc_context_t context;
+    /*!
+     * Raw date register of the last \ref bsp_rtc_get_ticks call and the
+     * matching number of seconds at 00:00:00 of that date
+     */
+    uint32_t ticks_date;
+    uint32_t ticks_day_base_s;
 } bsp_rtc_t;
 
 static bsp_rtc_t bsp_rtc;
@@ -164,6 +170,16 @@ static uint32_t bsp_rtc_get_calendar_time( uint16_t* milliseconds );
  */
 static uint64_t rtc_get_timestamp_in_ticks( RTC_DateTypeDef* date, RTC_TimeTypeDef* time );
 
+/*!
+ * Get the number of days elapsed since 01/01/2000
+ *
+ * \param [IN] year  Year in binary format (0 to 99)
+ * \param [IN] month Month in binary format (1 to 12)
+ * \param [IN] date  Day of the month in binary format (1 to 31)
+ * \retval days      Number of days elapsed since 01/01/2000
+ */
+static uint32_t rtc_get_days( const uint32_t year, const uint32_t month, const uint32_t date );
+
 void bsp_rtc_init( void )
 {
     RTC_TimeTypeDef time;
@@ -207,10 +223,50 @@ void bsp_rtc_init( void )
     bsp_rtc_set_time_ref_in_ticks( );
 }
 
+uint64_t bsp_rtc_get_ticks( void )
+{
+    uint32_t ssr;
+    uint32_t tr;
+    uint32_t dr;
+    uint32_t seconds;
+
+    CRITICAL_SECTION_BEGIN( );
+
+    // Shadow registers are bypassed: read until the sub-second counter is
+    // stable so that TR and DR belong to the same second
+    do
+    {
+        ssr = RTC->SSR;
+        tr  = RTC->TR;
+        dr  = RTC->DR;
+    } while( ssr != RTC->SSR );
+
+    // The date only changes at midnight, the days conversion is done once a day
+    if( dr != bsp_rtc.ticks_date )
+    {
+        bsp_rtc.ticks_date = dr;
+        bsp_rtc.ticks_day_base_s =
+            rtc_get_days( __LL_RTC_CONVERT_BCD2BIN( ( dr & ( RTC_DR_YT | RTC_DR_YU ) ) >> RTC_DR_YU_Pos ),
+                          __LL_RTC_CONVERT_BCD2BIN( ( dr & ( RTC_DR_MT | RTC_DR_MU ) ) >> RTC_DR_MU_Pos ),
+                          __LL_RTC_CONVERT_BCD2BIN( ( dr & ( RTC_DR_DT | RTC_DR_DU ) ) >> RTC_DR_DU_Pos ) ) *
+            SECONDS_IN_1DAY;
+    }
+
+    seconds = bsp_rtc.ticks_day_base_s +
+              ( ( uint32_t ) __LL_RTC_CONVERT_BCD2BIN( ( tr & ( RTC_TR_HT | RTC_TR_HU ) ) >> RTC_TR_HU_Pos ) *
+                SECONDS_IN_1HOUR ) +
+              ( ( uint32_t ) __LL_RTC_CONVERT_BCD2BIN( ( tr & ( RTC_TR_MNT | RTC_TR_MNU ) ) >> RTC_TR_MNU_Pos ) *
+                SECONDS_IN_1MINUTE ) +
+              __LL_RTC_CONVERT_BCD2BIN( ( tr & ( RTC_TR_ST | RTC_TR_SU ) ) >> RTC_TR_SU_Pos );
+
+    CRITICAL_SECTION_END( );
+
+    return ( ( ( uint64_t ) seconds ) << N_PREDIV_S ) + ( PREDIV_S - ( ssr & RTC_SSR_SS ) );
+}
+
 uint32_t bsp_rtc_get_time_s( void )
 {
-    uint16_t milliseconds = 0;
-    return bsp_rtc_get_calendar_time( &milliseconds );
+    return ( uint32_t )( bsp_rtc_get_ticks( ) >> N_PREDIV_S );
 }
 
 uint32_t bsp_rtc_get_time_ms( void )
@@ -223,18 +279,30 @@ uint32_t bsp_rtc_get_time_ms( void )
     return seconds * 1000 + milliseconds;
 }
 
-void bsp_rtc_delay_in_ms( const uint32_t milliseconds )
+uint64_t bsp_rtc_get_time_ms64( void )
 {
-    RTC_TimeTypeDef time;
-    RTC_DateTypeDef date;
+    uint32_t seconds      = 0;
+    uint16_t milliseconds = 0;
+
+    seconds = bsp_rtc_get_calendar_time( &milliseconds );
+
+    return ( ( uint64_t ) seconds * 1000 ) + milliseconds;
+}
+
+uint64_t bsp_rtc_get_time_us( void )
+{
+    return ( bsp_rtc_get_ticks( ) * USEC_NUMBER ) >> N_PREDIV_S;
+}
 
+void bsp_rtc_delay_in_ms( const uint32_t milliseconds )
+{
     uint64_t delay_in_ticks     = 0;
-    uint64_t ref_delay_in_ticks = rtc_get_timestamp_in_ticks( &date, &time );
+    uint64_t ref_delay_in_ticks = bsp_rtc_get_ticks( );
 
     delay_in_ticks = bsp_rtc_ms_2_tick( milliseconds );
 
     // Wait delay ms
-    while( ( ( rtc_get_timestamp_in_ticks( &date, &time ) - ref_delay_in_ticks ) ) < delay_in_ticks )
+    while( ( ( bsp_rtc_get_ticks( ) - ref_delay_in_ticks ) ) < delay_in_ticks )
     {
         __NOP( );
     }
@@ -255,6 +323,19 @@ void bsp_rtc_wakeup_timer_set_ms( const int32_t milliseconds )
     HAL_RTCEx_SetWakeUpTimer_IT( &bsp_rtc.handle, delay_ms_2_tick, RTC_WAKEUPCLOCK_RTCCLK_DIV16 );
 }
 
+bool bsp_rtc_wakeup_timer_clear_event( void )
+{
+    if( __HAL_RTC_WAKEUPTIMER_GET_FLAG( &bsp_rtc.handle, RTC_FLAG_WUTF ) == RESET )
+    {
+        return false;
+    }
+
+    __HAL_RTC_WAKEUPTIMER_CLEAR_FLAG( &bsp_rtc.handle, RTC_FLAG_WUTF );
+    __HAL_RTC_WAKEUPTIMER_EXTI_CLEAR_FLAG( );
+    HAL_NVIC_ClearPendingIRQ( RTC_IRQn );
+    return true;
+}
+
 static uint32_t bsp_rtc_set_time_ref_in_ticks( void )
 {
     bsp_rtc.context.time_ref_in_ticks =
@@ -295,11 +376,9 @@ static uint32_t bsp_rtc_s_2_wakeup_timer_tick( const uint32_t seconds )
 
 static uint32_t bsp_rtc_get_calendar_time( uint16_t* milliseconds )
 {
-    RTC_TimeTypeDef time;
-    RTC_DateTypeDef date;
-    uint32_t        ticks;
+    uint32_t ticks;
 
-    uint64_t timestamp_in_ticks = rtc_get_timestamp_in_ticks( &date, &time );
+    uint64_t timestamp_in_ticks = bsp_rtc_get_ticks( );
 
     uint32_t seconds = ( uint32_t )( timestamp_in_ticks >> N_PREDIV_S );
 
@@ -313,7 +392,6 @@ static uint32_t bsp_rtc_get_calendar_time( uint16_t* milliseconds )
 static uint64_t rtc_get_timestamp_in_ticks( RTC_DateTypeDef* date, RTC_TimeTypeDef* time )
 {
     uint64_t timestamp_in_ticks = 0;
-    uint32_t correction;
     uint32_t seconds;
 
     // Make sure it is correct due to asynchronous nature of RTC
@@ -327,14 +405,7 @@ static uint64_t rtc_get_timestamp_in_ticks( RTC_DateTypeDef* date, RTC_TimeTypeD
     } while( ssr != RTC->SSR );
 
     // Calculate amount of elapsed days since 01/01/2000
-    seconds = DIVC( ( DAYS_IN_YEAR * 3 + DAYS_IN_LEAP_YEAR ) * date->Year, 4 );
-
-    correction = ( ( date->Year % 4 ) == 0 ) ? DAYS_IN_MONTH_CORRECTION_LEAP : DAYS_IN_MONTH_CORRECTION_NORM;
-
-    seconds +=
-        ( DIVC( ( date->Month - 1 ) * ( 30 + 31 ), 2 ) - ( ( ( correction >> ( ( date->Month - 1 ) * 2 ) ) & 0x03 ) ) );
-
-    seconds += ( date->Date - 1 );
+    seconds = rtc_get_days( date->Year, date->Month, date->Date );
 
     // Convert from days to seconds
     seconds *= SECONDS_IN_1DAY;
@@ -347,6 +418,22 @@ static uint64_t rtc_get_timestamp_in_ticks( RTC_DateTypeDef* date, RTC_TimeTypeD
     return timestamp_in_ticks;
 }
 
+static uint32_t rtc_get_days( const uint32_t year, const uint32_t month, const uint32_t date )
+{
+    uint32_t correction;
+    uint32_t days;
+
+    days = DIVC( ( DAYS_IN_YEAR * 3 + DAYS_IN_LEAP_YEAR ) * year, 4 );
+
+    correction = ( ( year % 4 ) == 0 ) ? DAYS_IN_MONTH_CORRECTION_LEAP : DAYS_IN_MONTH_CORRECTION_NORM;
+
+    days += ( DIVC( ( month - 1 ) * ( 30 + 31 ), 2 ) - ( ( ( correction >> ( ( month - 1 ) * 2 ) ) & 0x03 ) ) );
+
+    days += ( date - 1 );
+
+    return days;
+}
+
 void RTC_IRQHandler( void )
 {
     HAL_RTCEx_WakeUpTimerIRQHandler( &bsp_rtc.handle );
@@ -36,23 +36,44 @@
 
 #include <stdint.h>   // C99 types
 #include <stdbool.h>  // bool type
+#include <string.h>   // memset
 
 #include "stm32l0xx_hal.h"
 #include "stm32l0xx_ll_spi.h"
 #include "smtc_bsp_gpio_pin_names.h"
 #include "smtc_bsp_spi.h"
 #include "smtc_bsp_mcu.h"
+#include "smtc_bsp_options.h"
 
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE MACROS-----------------------------------------------------------
  */
 
+// DMA1 channels 2 and 3 carry SPI1 RX and TX
+#define BSP_SPI1_DMA_ENABLED
+
+// DMA1 channels 4 and 5 carry SPI2 RX and TX when it is the host link, they are the USART1 ones: the user UART is
+// off then. With the low power UART, channel 4 would be the printf UART TX one.
+#if( BSP_USE_HOST_SPI == BSP_FEATURE_ON )
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+#error "The host SPI and the low power UART both need DMA1 channel 4"
+#endif
+#define BSP_SPI2_DMA_ENABLED
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+// GPIO MODER field values
+#define BSP_SPI_GPIO_MODER_AF 0x02
+#define BSP_SPI_GPIO_MODER_ANALOG 0x03
+
+// The SPI clock is the APB clock divided by 2^( BR + 1 ), BR in [0:7]
+#define BSP_SPI_BR_MAX 7
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -68,6 +89,7 @@ typedef struct bsp_spi_s
         bsp_gpio_pin_names_t miso;
         bsp_gpio_pin_names_t sclk;
     } pins;
+    bsp_spi_irq_t dma_irq;
 } bsp_spi_t;
 
 /*
@@ -103,11 +125,36 @@ static bsp_spi_t bsp_spi[] = {
         },
 };
 
+#if defined( BSP_SPI1_DMA_ENABLED )
+static DMA_HandleTypeDef hdma_spi1_rx;
+static DMA_HandleTypeDef hdma_spi1_tx;
+#endif
+#if defined( BSP_SPI2_DMA_ENABLED )
+static DMA_HandleTypeDef hdma_spi2_rx;
+static DMA_HandleTypeDef hdma_spi2_tx;
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+/*!
+ * Configures the SPI peripheral handle and its pins, the peripheral is left disabled
+ */
+static void bsp_spi_handle_init( const uint32_t local_id, const uint32_t mode, const bsp_gpio_pin_names_t mosi,
+                                 const bsp_gpio_pin_names_t miso, const bsp_gpio_pin_names_t sclk );
+
+/*!
+ * Calls the completion callback of the DMA transfer done on the given SPI handle
+ */
+static void bsp_spi_dma_cplt( SPI_HandleTypeDef* spi_handle );
+
+/*!
+ * Sets the MODER field of the SPI pins, the other GPIO settings are left untouched
+ */
+static void bsp_spi_pins_set_mode( const uint32_t local_id, const uint32_t mode );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -119,28 +166,18 @@ void bsp_spi_init( const uint32_t id, const bsp_gpio_pin_names_t mosi, const bsp
     assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( bsp_spi ) ) );
     uint32_t local_id = id - 1;
 
-    bsp_spi[local_id].handle.Instance               = bsp_spi[local_id].interface;
-    bsp_spi[local_id].handle.Init.Mode              = SPI_MODE_MASTER;
-    bsp_spi[local_id].handle.Init.Direction         = SPI_DIRECTION_2LINES;
-    bsp_spi[local_id].handle.Init.DataSize          = SPI_DATASIZE_8BIT;
-    bsp_spi[local_id].handle.Init.CLKPolarity       = SPI_POLARITY_LOW;
-    bsp_spi[local_id].handle.Init.CLKPhase          = SPI_PHASE_1EDGE;
-    bsp_spi[local_id].handle.Init.NSS               = SPI_NSS_SOFT;
-    bsp_spi[local_id].handle.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_8;
-    bsp_spi[local_id].handle.Init.FirstBit          = SPI_FIRSTBIT_MSB;
-    bsp_spi[local_id].handle.Init.TIMode            = SPI_TIMODE_DISABLE;
-    bsp_spi[local_id].handle.Init.CRCCalculation    = SPI_CRCCALCULATION_DISABLE;
-    bsp_spi[local_id].handle.Init.CRCPolynomial     = 7;
+    bsp_spi_handle_init( local_id, SPI_MODE_MASTER, mosi, miso, sclk );
+    __HAL_SPI_ENABLE( &bsp_spi[local_id].handle );
+}
 
-    bsp_spi[local_id].pins.mosi = mosi;
-    bsp_spi[local_id].pins.miso = miso;
-    bsp_spi[local_id].pins.sclk = sclk;
+void bsp_spi_slave_init( const uint32_t id, const bsp_gpio_pin_names_t mosi, const bsp_gpio_pin_names_t miso,
+                         const bsp_gpio_pin_names_t sclk )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( bsp_spi ) ) );
+    uint32_t local_id = id - 1;
 
-    if( HAL_SPI_Init( &bsp_spi[local_id].handle ) != HAL_OK )
-    {
-        bsp_mcu_panic( );
-    }
-    __HAL_SPI_ENABLE( &bsp_spi[local_id].handle );
+    // Enabled when a transfer is armed, the master clocks are ignored meanwhile
+    bsp_spi_handle_init( local_id, SPI_MODE_SLAVE, mosi, miso, sclk );
 }
 
 void bsp_spi_deinit( const uint32_t id )
@@ -151,7 +188,70 @@ void bsp_spi_deinit( const uint32_t id )
     HAL_SPI_DeInit( &bsp_spi[local_id].handle );
 }
 
-uint16_t bsp_spi_in_out( const uint32_t id, const uint16_t out_data )
+void bsp_spi_suspend( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( bsp_spi ) ) );
+    uint32_t local_id = id - 1;
+
+    // Floating pins would draw current in stop mode
+    bsp_spi_pins_set_mode( local_id, BSP_SPI_GPIO_MODER_ANALOG );
+
+    if( local_id == 0 )
+    {
+        __HAL_RCC_SPI1_CLK_DISABLE( );
+    }
+    else
+    {
+        __HAL_RCC_SPI2_CLK_DISABLE( );
+    }
+}
+
+void bsp_spi_resume( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( bsp_spi ) ) );
+    uint32_t local_id = id - 1;
+
+    // The configuration and the DMA channels are kept, the clock only has to be given back
+    if( local_id == 0 )
+    {
+        __HAL_RCC_SPI1_CLK_ENABLE( );
+    }
+    else
+    {
+        __HAL_RCC_SPI2_CLK_ENABLE( );
+    }
+
+    bsp_spi_pins_set_mode( local_id, BSP_SPI_GPIO_MODER_AF );
+}
+
+void bsp_spi_set_clock( const uint32_t id, const uint32_t max_clock_hz )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( bsp_spi ) ) );
+    uint32_t local_id = id - 1;
+    uint32_t apb_clock_hz;
+    uint32_t br = 0;
+
+    // The prescaler must hold on the high clock, the low clock only slows the SPI down
+    bsp_mcu_clock_boost_request( );
+    apb_clock_hz = ( local_id == 0 ) ? HAL_RCC_GetPCLK2Freq( ) : HAL_RCC_GetPCLK1Freq( );
+    bsp_mcu_clock_boost_release( );
+
+    while( ( ( apb_clock_hz >> ( br + 1 ) ) > max_clock_hz ) && ( br < BSP_SPI_BR_MAX ) )
+    {
+        br++;
+    }
+
+    // BR can only be changed while the SPI is disabled, after the last byte is shifted out
+    while( LL_SPI_IsActiveFlag_BSY( bsp_spi[local_id].interface ) != 0 )
+    {
+    };
+    __HAL_SPI_DISABLE( &bsp_spi[local_id].handle );
+    bsp_spi[local_id].handle.Init.BaudRatePrescaler = br << SPI_CR1_BR_Pos;
+    LL_SPI_SetBaudRatePrescaler( bsp_spi[local_id].interface, br << SPI_CR1_BR_Pos );
+    __HAL_SPI_ENABLE( &bsp_spi[local_id].handle );
+}
+
+BSP_RAMFUNC uint16_t bsp_spi_in_out( const uint32_t id, const uint16_t out_data )
 {
     assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( bsp_spi ) ) );
     uint32_t local_id = id - 1;
@@ -167,6 +267,177 @@ uint16_t bsp_spi_in_out( const uint32_t id, const uint16_t out_data )
     return LL_SPI_ReceiveData8( bsp_spi[local_id].interface );
 }
 
+BSP_RAMFUNC void bsp_spi_transfer( const uint32_t id, const uint8_t* out_data, uint8_t* in_data, const uint16_t size )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( bsp_spi ) ) );
+    uint32_t     local_id = id - 1;
+    SPI_TypeDef* spi      = bsp_spi[local_id].interface;
+    uint8_t      in;
+
+    if( size == 0 )
+    {
+        return;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    while( LL_SPI_IsActiveFlag_TXE( spi ) == 0 )
+    {
+    };
+    LL_SPI_TransmitData8( spi, ( out_data != NULL ) ? out_data[0] : 0 );
+
+    for( uint16_t i = 1; i <= size; i++ )
+    {
+        // The next byte is queued as soon as the previous one moves to the shift register
+        if( i < size )
+        {
+            while( LL_SPI_IsActiveFlag_TXE( spi ) == 0 )
+            {
+            };
+            LL_SPI_TransmitData8( spi, ( out_data != NULL ) ? out_data[i] : 0 );
+        }
+
+        while( LL_SPI_IsActiveFlag_RXNE( spi ) == 0 )
+        {
+        };
+        in = LL_SPI_ReceiveData8( spi );
+        if( in_data != NULL )
+        {
+            in_data[i - 1] = in;
+        }
+    }
+    CRITICAL_SECTION_END( );
+}
+
+void bsp_spi_transfer_dma( const uint32_t id, const uint8_t* out_data, uint8_t* in_data, const uint16_t size,
+                           const bsp_spi_irq_t* irq )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( bsp_spi ) ) );
+    uint32_t          local_id = id - 1;
+    HAL_StatusTypeDef status   = HAL_OK;
+
+    if( bsp_spi[local_id].handle.hdmatx == NULL )
+    {
+        // No DMA channel for this interface: polled, the callback runs synchronously in the caller context
+        bsp_spi_transfer( id, out_data, in_data, size );
+        if( irq->callback != NULL )
+        {
+            irq->callback( irq->context );
+        }
+        return;
+    }
+
+    bsp_spi[local_id].dma_irq = *irq;
+    if( ( out_data == NULL ) && ( in_data != NULL ) )
+    {  // a full duplex receive sends the receive buffer: zeros, the radio reads them as NOPs
+        memset( in_data, 0, size );
+    }
+
+    if( in_data == NULL )
+    {
+        status = HAL_SPI_Transmit_DMA( &bsp_spi[local_id].handle, ( uint8_t* ) out_data, size );
+    }
+    else if( out_data == NULL )
+    {
+        status = HAL_SPI_Receive_DMA( &bsp_spi[local_id].handle, in_data, size );
+    }
+    else
+    {
+        status = HAL_SPI_TransmitReceive_DMA( &bsp_spi[local_id].handle, ( uint8_t* ) out_data, in_data, size );
+    }
+    if( status != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+}
+
+void bsp_spi_slave_dma_start( const uint32_t id, const uint8_t* out_data, uint8_t* in_data, const uint16_t size )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( bsp_spi ) ) );
+    uint32_t           local_id = id - 1;
+    SPI_HandleTypeDef* handle   = &bsp_spi[local_id].handle;
+
+    if( ( handle->hdmatx == NULL ) || ( size == 0 ) )
+    {
+        // The master clock cannot be followed by polling
+        bsp_mcu_panic( );
+    }
+
+    // Started without interrupts: the end of the transfer is given by the caller, not by the byte count
+    if( in_data != NULL )
+    {
+        handle->RxXferSize = size;
+        HAL_DMA_Start( handle->hdmarx, ( uint32_t ) &handle->Instance->DR, ( uint32_t ) in_data, size );
+        SET_BIT( handle->Instance->CR2, SPI_CR2_RXDMAEN );
+    }
+    if( out_data != NULL )
+    {
+        HAL_DMA_Start( handle->hdmatx, ( uint32_t ) out_data, ( uint32_t ) &handle->Instance->DR, size );
+        SET_BIT( handle->Instance->CR2, SPI_CR2_TXDMAEN );
+    }
+    __HAL_SPI_ENABLE( handle );
+}
+
+uint16_t bsp_spi_slave_dma_stop( const uint32_t id )
+{
+    assert_param( ( id > 0 ) && ( ( id - 1 ) < sizeof( bsp_spi ) ) );
+    uint32_t           local_id = id - 1;
+    SPI_HandleTypeDef* handle   = &bsp_spi[local_id].handle;
+    uint16_t           received = 0;
+
+    if( READ_BIT( handle->Instance->CR2, SPI_CR2_RXDMAEN ) != 0 )
+    {
+        received = handle->RxXferSize - __HAL_DMA_GET_COUNTER( handle->hdmarx );
+    }
+
+    // HAL_SPI_Abort would wait for the master to clock out the byte already loaded in the data register
+    HAL_DMA_Abort( handle->hdmarx );
+    HAL_DMA_Abort( handle->hdmatx );
+
+    // The reset empties the data register, the next transfer starts with its own first byte
+    if( local_id == 0 )
+    {
+        __HAL_RCC_SPI1_FORCE_RESET( );
+        __HAL_RCC_SPI1_RELEASE_RESET( );
+    }
+    else
+    {
+        __HAL_RCC_SPI2_FORCE_RESET( );
+        __HAL_RCC_SPI2_RELEASE_RESET( );
+    }
+    if( HAL_SPI_Init( handle ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+
+    return received;
+}
+
+void HAL_SPI_TxCpltCallback( SPI_HandleTypeDef* spi_handle )
+{
+    bsp_spi_dma_cplt( spi_handle );
+}
+
+void HAL_SPI_RxCpltCallback( SPI_HandleTypeDef* spi_handle )
+{
+    bsp_spi_dma_cplt( spi_handle );
+}
+
+void HAL_SPI_TxRxCpltCallback( SPI_HandleTypeDef* spi_handle )
+{
+    bsp_spi_dma_cplt( spi_handle );
+}
+
+void HAL_SPI_ErrorCallback( SPI_HandleTypeDef* spi_handle )
+{
+    bsp_mcu_panic( );
+}
+
+void DMA1_Channel2_3_IRQHandler( void )
+{
+    HAL_DMA_IRQHandler( &hdma_spi1_rx );
+    HAL_DMA_IRQHandler( &hdma_spi1_tx );
+}
+
 void HAL_SPI_MspInit( SPI_HandleTypeDef* spiHandle )
 {
     if( spiHandle->Instance == bsp_spi[0].interface )
@@ -183,6 +454,44 @@ void HAL_SPI_MspInit( SPI_HandleTypeDef* spiHandle )
         HAL_GPIO_Init( gpio_port, &gpio );
 
         __HAL_RCC_SPI1_CLK_ENABLE( );
+
+#if defined( BSP_SPI1_DMA_ENABLED )
+        __HAL_RCC_DMA1_CLK_ENABLE( );
+
+        hdma_spi1_rx.Instance                 = DMA1_Channel2;
+        hdma_spi1_rx.Init.Request             = DMA_REQUEST_1;
+        hdma_spi1_rx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+        hdma_spi1_rx.Init.PeriphInc           = DMA_PINC_DISABLE;
+        hdma_spi1_rx.Init.MemInc              = DMA_MINC_ENABLE;
+        hdma_spi1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_spi1_rx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+        hdma_spi1_rx.Init.Mode                = DMA_NORMAL;
+        hdma_spi1_rx.Init.Priority            = DMA_PRIORITY_HIGH;
+        if( HAL_DMA_Init( &hdma_spi1_rx ) != HAL_OK )
+        {
+            bsp_mcu_panic( );
+        }
+        __HAL_LINKDMA( spiHandle, hdmarx, hdma_spi1_rx );
+
+        hdma_spi1_tx.Instance                 = DMA1_Channel3;
+        hdma_spi1_tx.Init.Request             = DMA_REQUEST_1;
+        hdma_spi1_tx.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+        hdma_spi1_tx.Init.PeriphInc           = DMA_PINC_DISABLE;
+        hdma_spi1_tx.Init.MemInc              = DMA_MINC_ENABLE;
+        hdma_spi1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_spi1_tx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+        hdma_spi1_tx.Init.Mode                = DMA_NORMAL;
+        hdma_spi1_tx.Init.Priority            = DMA_PRIORITY_HIGH;
+        if( HAL_DMA_Init( &hdma_spi1_tx ) != HAL_OK )
+        {
+            bsp_mcu_panic( );
+        }
+        __HAL_LINKDMA( spiHandle, hdmatx, hdma_spi1_tx );
+
+        // Highest priority: transfers are waited for from the radio IRQ handlers
+        HAL_NVIC_SetPriority( DMA1_Channel2_3_IRQn, 0, 0 );
+        HAL_NVIC_EnableIRQ( DMA1_Channel2_3_IRQn );
+#endif
     }
     else if( spiHandle->Instance == bsp_spi[1].interface )
     {
@@ -198,6 +507,40 @@ void HAL_SPI_MspInit( SPI_HandleTypeDef* spiHandle )
         HAL_GPIO_Init( gpio_port, &gpio );
 
         __HAL_RCC_SPI2_CLK_ENABLE( );
+
+#if defined( BSP_SPI2_DMA_ENABLED )
+        __HAL_RCC_DMA1_CLK_ENABLE( );
+
+        hdma_spi2_rx.Instance                 = DMA1_Channel4;
+        hdma_spi2_rx.Init.Request             = DMA_REQUEST_2;
+        hdma_spi2_rx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+        hdma_spi2_rx.Init.PeriphInc           = DMA_PINC_DISABLE;
+        hdma_spi2_rx.Init.MemInc              = DMA_MINC_ENABLE;
+        hdma_spi2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_spi2_rx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+        hdma_spi2_rx.Init.Mode                = DMA_NORMAL;
+        hdma_spi2_rx.Init.Priority            = DMA_PRIORITY_MEDIUM;
+        if( HAL_DMA_Init( &hdma_spi2_rx ) != HAL_OK )
+        {
+            bsp_mcu_panic( );
+        }
+        __HAL_LINKDMA( spiHandle, hdmarx, hdma_spi2_rx );
+
+        hdma_spi2_tx.Instance                 = DMA1_Channel5;
+        hdma_spi2_tx.Init.Request             = DMA_REQUEST_2;
+        hdma_spi2_tx.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+        hdma_spi2_tx.Init.PeriphInc           = DMA_PINC_DISABLE;
+        hdma_spi2_tx.Init.MemInc              = DMA_MINC_ENABLE;
+        hdma_spi2_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_spi2_tx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+        hdma_spi2_tx.Init.Mode                = DMA_NORMAL;
+        hdma_spi2_tx.Init.Priority            = DMA_PRIORITY_MEDIUM;
+        if( HAL_DMA_Init( &hdma_spi2_tx ) != HAL_OK )
+        {
+            bsp_mcu_panic( );
+        }
+        __HAL_LINKDMA( spiHandle, hdmatx, hdma_spi2_tx );
+#endif
     }
     else
     {
@@ -211,11 +554,19 @@ void HAL_SPI_MspDeInit( SPI_HandleTypeDef* spiHandle )
     if( spiHandle->Instance == bsp_spi[0].interface )
     {
         __HAL_RCC_SPI1_CLK_DISABLE( );
+#if defined( BSP_SPI1_DMA_ENABLED )
+        HAL_DMA_DeInit( &hdma_spi1_rx );
+        HAL_DMA_DeInit( &hdma_spi1_tx );
+#endif
     }
     else if( spiHandle->Instance == bsp_spi[1].interface )
     {
         local_id = 1;
         __HAL_RCC_SPI2_CLK_DISABLE( );
+#if defined( BSP_SPI2_DMA_ENABLED )
+        HAL_DMA_DeInit( &hdma_spi2_rx );
+        HAL_DMA_DeInit( &hdma_spi2_tx );
+#endif
     }
     else
     {
@@ -226,3 +577,64 @@ void HAL_SPI_MspDeInit( SPI_HandleTypeDef* spiHandle )
                      ( 1 << ( bsp_spi[local_id].pins.mosi & 0x0F ) ) | ( 1 << ( bsp_spi[local_id].pins.miso & 0x0F ) ) |
                          ( 1 << ( bsp_spi[local_id].pins.sclk & 0x0F ) ) );
 }
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void bsp_spi_handle_init( const uint32_t local_id, const uint32_t mode, const bsp_gpio_pin_names_t mosi,
+                                 const bsp_gpio_pin_names_t miso, const bsp_gpio_pin_names_t sclk )
+{
+    bsp_spi[local_id].handle.Instance               = bsp_spi[local_id].interface;
+    bsp_spi[local_id].handle.Init.Mode              = mode;
+    bsp_spi[local_id].handle.Init.Direction         = SPI_DIRECTION_2LINES;
+    bsp_spi[local_id].handle.Init.DataSize          = SPI_DATASIZE_8BIT;
+    bsp_spi[local_id].handle.Init.CLKPolarity       = SPI_POLARITY_LOW;
+    bsp_spi[local_id].handle.Init.CLKPhase          = SPI_PHASE_1EDGE;
+    bsp_spi[local_id].handle.Init.NSS               = SPI_NSS_SOFT;
+    bsp_spi[local_id].handle.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_8;
+    bsp_spi[local_id].handle.Init.FirstBit          = SPI_FIRSTBIT_MSB;
+    bsp_spi[local_id].handle.Init.TIMode            = SPI_TIMODE_DISABLE;
+    bsp_spi[local_id].handle.Init.CRCCalculation    = SPI_CRCCALCULATION_DISABLE;
+    bsp_spi[local_id].handle.Init.CRCPolynomial     = 7;
+
+    bsp_spi[local_id].pins.mosi = mosi;
+    bsp_spi[local_id].pins.miso = miso;
+    bsp_spi[local_id].pins.sclk = sclk;
+
+    if( HAL_SPI_Init( &bsp_spi[local_id].handle ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+}
+
+static void bsp_spi_dma_cplt( SPI_HandleTypeDef* spi_handle )
+{
+    for( uint32_t i = 0; i < ( sizeof( bsp_spi ) / sizeof( bsp_spi[0] ) ); i++ )
+    {
+        if( ( spi_handle == &bsp_spi[i].handle ) && ( bsp_spi[i].dma_irq.callback != NULL ) )
+        {
+            bsp_spi[i].dma_irq.callback( bsp_spi[i].dma_irq.context );
+        }
+    }
+}
+
+static void bsp_spi_pins_set_mode( const uint32_t local_id, const uint32_t mode )
+{
+    GPIO_TypeDef*  gpio_port   = ( GPIO_TypeDef* ) ( IOPPERIPH_BASE + ( ( bsp_spi[local_id].pins.mosi & 0xF0 ) << 6 ) );
+    const uint32_t positions[] = { ( bsp_spi[local_id].pins.mosi & 0x0F ) * 2,
+                                   ( bsp_spi[local_id].pins.miso & 0x0F ) * 2,
+                                   ( bsp_spi[local_id].pins.sclk & 0x0F ) * 2 };
+    uint32_t       mask        = 0;
+    uint32_t       value       = 0;
+
+    for( uint32_t i = 0; i < ( sizeof( positions ) / sizeof( positions[0] ) ); i++ )
+    {
+        mask |= 0x03UL << positions[i];
+        value |= mode << positions[i];
+    }
+    MODIFY_REG( gpio_port->MODER, mask, value );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -40,6 +40,8 @@
 #include "stm32l0xx_hal.h"
 #include "smtc_bsp_mcu.h"
 #include "smtc_bsp_tmr.h"
+#include "smtc_bsp_options.h"
+#include "smtc_bsp_perf.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -51,6 +53,9 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+// Longest LPTIM timeout, about 32 s at LSE_VALUE / LPTIM_PRESCALER_DIV16
+#define BSP_TMR_MAX_TICKS 0xFFFF
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -65,11 +70,19 @@ static LPTIM_HandleTypeDef lptim_handle;
 
 static bsp_tmr_irq_t lptim_tmr_irq = { .context = NULL, .callback = NULL };
 
+// Ticks left after the running timeout, longer delays are chained by BSP_TMR_MAX_TICKS timeouts
+static uint32_t lptim_remaining_ticks = 0;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+/*!
+ * Starts the next LPTIM timeout of the chain
+ */
+static void bsp_tmr_start_next( void );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -89,29 +102,21 @@ void bsp_tmr_init( void )
     {
         bsp_mcu_panic( );
     }
-    lptim_tmr_irq = ( bsp_tmr_irq_t ){ .context = NULL, .callback = NULL };
+    lptim_tmr_irq         = ( bsp_tmr_irq_t ){ .context = NULL, .callback = NULL };
+    lptim_remaining_ticks = 0;
 }
 
 void bsp_tmr_start( const uint32_t milliseconds, const bsp_tmr_irq_t* tmr_irq )
 {
-    uint32_t delay_ms_2_tick = 0;
-
     // Remark LSE_VALUE / LPTIM_PRESCALER_DIV16
-    delay_ms_2_tick = ( uint32_t )( ( ( uint64_t ) milliseconds * ( LSE_VALUE >> 4 ) ) / 1000 );
-
-    // check if delay_ms_2_tick is not greater than 0xFFFF and clamp it if it is the case
-    if( delay_ms_2_tick > 0xFFFF )
-    {
-        delay_ms_2_tick = 0xFFFF;
-    }
-
-    // Auto reload period is set to max value 0xFFFF
-    HAL_LPTIM_TimeOut_Start_IT( &lptim_handle, 0xFFFF, delay_ms_2_tick );
-    lptim_tmr_irq = *tmr_irq;
+    lptim_remaining_ticks = ( uint32_t )( ( ( uint64_t ) milliseconds * ( LSE_VALUE >> 4 ) ) / 1000 );
+    lptim_tmr_irq         = *tmr_irq;
+    bsp_tmr_start_next( );
 }
 
 void bsp_tmr_stop( void )
 {
+    lptim_remaining_ticks = 0;
     HAL_LPTIM_TimeOut_Stop_IT( &lptim_handle );
 }
 
@@ -132,13 +137,19 @@ void bsp_tmr_irq_disable( void )
 
 void LPTIM1_IRQHandler( void )
 {
+    BSP_PERF_IRQ_ENTER( BSP_PERF_IRQ_LPTIM );
     HAL_LPTIM_IRQHandler( &lptim_handle );
     HAL_LPTIM_TimeOut_Stop( &lptim_handle );
 
-    if( lptim_tmr_irq.callback != NULL )
+    if( lptim_remaining_ticks > 0 )
+    {  // intermediate timeout of a long delay, the MCU goes back to sleep
+        bsp_tmr_start_next( );
+    }
+    else if( lptim_tmr_irq.callback != NULL )
     {
         lptim_tmr_irq.callback( lptim_tmr_irq.context );
     }
+    BSP_PERF_IRQ_EXIT( BSP_PERF_IRQ_LPTIM );
 }
 
 void HAL_LPTIM_MspInit( LPTIM_HandleTypeDef* lptimhandle )
@@ -146,7 +157,8 @@ void HAL_LPTIM_MspInit( LPTIM_HandleTypeDef* lptimhandle )
     if( lptimhandle->Instance == LPTIM1 )
     {
         __HAL_RCC_LPTIM1_CLK_ENABLE( );
-        HAL_NVIC_SetPriority( LPTIM1_IRQn, 0, 0 );
+        // Below priority 0: the radio planner timer handler can load the radio buffer through SPI DMA
+        HAL_NVIC_SetPriority( LPTIM1_IRQn, BSP_LPTIM_IRQ_PRIORITY, 0 );
         HAL_NVIC_EnableIRQ( LPTIM1_IRQn );
     }
 }
@@ -165,4 +177,14 @@ void HAL_LPTIM_MspDeInit( LPTIM_HandleTypeDef* lptimhandle )
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static void bsp_tmr_start_next( void )
+{
+    uint32_t ticks = ( lptim_remaining_ticks > BSP_TMR_MAX_TICKS ) ? BSP_TMR_MAX_TICKS : lptim_remaining_ticks;
+
+    lptim_remaining_ticks -= ticks;
+
+    // Auto reload period is set to max value 0xFFFF
+    HAL_LPTIM_TimeOut_Start_IT( &lptim_handle, 0xFFFF, ticks );
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -42,6 +42,7 @@
 #include "smtc_bsp_mcu.h"
 #include "smtc_bsp_uart.h"
 #include "smtc_bsp_options.h"
+#include "smtc_bsp_perf.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -53,6 +54,46 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+// Above this baud rate oversampling by 8 keeps the baud rate error low with a 32MHz clock
+#define BSP_UART_OVERSAMPLING_8_MIN_BAUDRATE 115200
+
+// GPIO MODER field values
+#define BSP_UART_GPIO_MODER_AF 0x02
+#define BSP_UART_GPIO_MODER_ANALOG 0x03
+
+// GPIOA pins of each UART
+#define BSP_UART1_PINS ( ( 1 << ( HW_MODEM_RX_LINE & 0x0F ) ) | ( 1 << ( HW_MODEM_TX_LINE & 0x0F ) ) )
+#define BSP_UART2_PINS ( ( 1 << ( DEBUG_UART_TX & 0x0F ) ) | ( 1 << ( DEBUG_UART_RX & 0x0F ) ) )
+
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+// UART1 is LPUART1 on GPIOC, its DMA requests are only on channels 6 and 7: the UART2 TX moves to channel 4
+#define BSP_UART1_INSTANCE LPUART1
+#define BSP_UART1_GPIO_PORT GPIOC
+#define BSP_UART1_GPIO_AF GPIO_AF0_LPUART1
+#define BSP_UART1_GPIO_PINS \
+    ( ( 1 << ( HW_MODEM_LPUART_RX_LINE & 0x0F ) ) | ( 1 << ( HW_MODEM_LPUART_TX_LINE & 0x0F ) ) )
+#define BSP_UART1_DMA_REQUEST DMA_REQUEST_5
+#define BSP_UART1_DMA_RX_CHANNEL DMA1_Channel6
+#define BSP_UART1_DMA_TX_CHANNEL DMA1_Channel7
+#define BSP_UART2_DMA_TX_CHANNEL DMA1_Channel4
+#define BSP_UART1_IRQn RNG_LPUART1_IRQn
+// LPUART1 has no oversampling setting, its baud rate generator divides HSI16 by 256ths
+#define BSP_UART1_OVERSAMPLING( baudrate ) UART_OVERSAMPLING_16
+#else
+// DMA1 channels 2 and 3 are used by the radio SPI
+#define BSP_UART1_INSTANCE USART1
+#define BSP_UART1_GPIO_PORT GPIOA
+#define BSP_UART1_GPIO_AF GPIO_AF4_USART1
+#define BSP_UART1_GPIO_PINS BSP_UART1_PINS
+#define BSP_UART1_DMA_REQUEST DMA_REQUEST_3
+#define BSP_UART1_DMA_RX_CHANNEL DMA1_Channel5
+#define BSP_UART1_DMA_TX_CHANNEL DMA1_Channel4
+#define BSP_UART2_DMA_TX_CHANNEL DMA1_Channel7
+#define BSP_UART1_IRQn USART1_IRQn
+#define BSP_UART1_OVERSAMPLING( baudrate ) \
+    ( ( ( baudrate ) > BSP_UART_OVERSAMPLING_8_MIN_BAUDRATE ) ? UART_OVERSAMPLING_8 : UART_OVERSAMPLING_16 )
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -64,6 +105,26 @@
  */
 
 static DMA_HandleTypeDef hdma_usart1_rx;
+static DMA_HandleTypeDef hdma_usart1_tx;
+static DMA_HandleTypeDef hdma_usart2_tx;
+
+// Completion callback of the ongoing UART1 DMA transmission
+static bsp_uart_irq_t uart1_tx_irq = { .context = NULL, .callback = NULL };
+
+// Completion callback of the ongoing UART2 DMA transmission
+static bsp_uart_irq_t uart2_tx_irq = { .context = NULL, .callback = NULL };
+
+// Event callback of the UART1 circular DMA reception
+static bsp_uart_irq_t uart1_rx_irq = { .context = NULL, .callback = NULL };
+
+// Size of the UART1 circular DMA reception ring, 0 when the reception is not circular
+static uint16_t uart1_rx_ring_size = 0;
+
+// UART1 baud rate, kept across re-initializations
+static uint32_t uart1_baudrate = 115200;
+
+// UART2 left suspended since the last stop mode, it is resumed by the next transmission
+static bool uart2_suspended = false;
 
 static UART_HandleTypeDef huart2;
 static UART_HandleTypeDef huart1;
@@ -73,6 +134,28 @@ static UART_HandleTypeDef huart1;
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+/*!
+ * Sets the MODER field of the given GPIOA pins, the other GPIO settings are left untouched
+ */
+static void bsp_uart_pins_set_mode( const uint32_t pins, const uint32_t mode );
+
+/*!
+ * Gives UART2 its clock and pins back if it has been suspended
+ */
+static void bsp_uart2_resume( void );
+
+/*!
+ * Serves the UART1 interrupt, the idle line detection being handled here
+ */
+static void bsp_uart1_irq_handler( void );
+
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+/*!
+ * Makes LPUART1 wake the MCU up from stop mode on a start bit, to be done after each HAL_UART_Init
+ */
+static void bsp_uart1_wakeup_config( void );
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -81,32 +164,70 @@ static UART_HandleTypeDef huart1;
 void bsp_uart1_init( void )
 {
     __HAL_RCC_DMA1_CLK_ENABLE( );
-    HAL_NVIC_SetPriority( DMA1_Channel2_3_IRQn, 0, 0 );
-    HAL_NVIC_EnableIRQ( DMA1_Channel2_3_IRQn );
-
-    huart1.Instance                    = USART1;
-    huart1.Init.BaudRate               = 115200;
+    HAL_NVIC_SetPriority( DMA1_Channel4_5_6_7_IRQn, 0, 0 );
+    HAL_NVIC_EnableIRQ( DMA1_Channel4_5_6_7_IRQn );
+    // The end of a DMA transmission is reported by the USART transmission complete interrupt
+    HAL_NVIC_SetPriority( BSP_UART1_IRQn, 0, 0 );
+    HAL_NVIC_EnableIRQ( BSP_UART1_IRQn );
+
+    huart1.Instance                    = BSP_UART1_INSTANCE;
+    huart1.Init.BaudRate               = uart1_baudrate;
     huart1.Init.WordLength             = UART_WORDLENGTH_8B;
     huart1.Init.StopBits               = UART_STOPBITS_1;
     huart1.Init.Parity                 = UART_PARITY_NONE;
     huart1.Init.Mode                   = UART_MODE_TX_RX;
     huart1.Init.HwFlowCtl              = UART_HWCONTROL_NONE;
-    huart1.Init.OverSampling           = UART_OVERSAMPLING_16;
+    huart1.Init.OverSampling           = BSP_UART1_OVERSAMPLING( uart1_baudrate );
     huart1.Init.OneBitSampling         = UART_ONE_BIT_SAMPLE_DISABLE;
     huart1.AdvancedInit.AdvFeatureInit = UART_ADVFEATURE_NO_INIT;
     if( HAL_UART_Init( &huart1 ) != HAL_OK )
     {
         bsp_mcu_panic( );
     }
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+    bsp_uart1_wakeup_config( );
+#endif
 }
 
 void bsp_uart1_deinit( void )
 {
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+    // The interrupt line is shared with the RNG, only the LPUART1 sources are disabled by the HAL
+#else
+    HAL_NVIC_DisableIRQ( USART1_IRQn );
+#endif
     HAL_UART_DeInit( &huart1 );
+    uart1_rx_ring_size = 0;
+}
+
+void bsp_uart1_set_baudrate( const uint32_t baudrate )
+{
+    uart1_baudrate = baudrate;
+
+    // The peripheral is only re-configured, a full de-init would also stop the DMA1 clock shared with the SPI
+    __HAL_UART_DISABLE_IT( &huart1, UART_IT_IDLE );
+    HAL_UART_Abort( &huart1 );
+    uart1_rx_ring_size = 0;
+
+    huart1.Init.BaudRate = uart1_baudrate;
+    huart1.Init.OverSampling = BSP_UART1_OVERSAMPLING( uart1_baudrate );
+    if( HAL_UART_Init( &huart1 ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+    bsp_uart1_wakeup_config( );
+#endif
 }
 
 void bsp_uart2_init( void )
 {
+    __HAL_RCC_DMA1_CLK_ENABLE( );
+    HAL_NVIC_SetPriority( DMA1_Channel4_5_6_7_IRQn, 0, 0 );
+    HAL_NVIC_EnableIRQ( DMA1_Channel4_5_6_7_IRQn );
+    HAL_NVIC_SetPriority( USART2_IRQn, 0, 0 );
+    HAL_NVIC_EnableIRQ( USART2_IRQn );
+
     huart2.Instance                    = USART2;
     huart2.Init.BaudRate               = 115200;
     huart2.Init.WordLength             = UART_WORDLENGTH_8B;
@@ -126,18 +247,92 @@ void bsp_uart2_init( void )
 
 void bsp_uart2_deinit( void )
 {
+    HAL_NVIC_DisableIRQ( USART2_IRQn );
     HAL_UART_DeInit( &huart2 );
+    uart2_suspended = false;
+}
+
+void bsp_uart1_suspend( void )
+{
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+    // LPUART1 keeps listening on HSI16, the DMA is stopped in stop mode and must not be requested meanwhile: the
+    // first received byte waits in the receive register for the wake-up
+    CLEAR_BIT( huart1.Instance->CR3, USART_CR3_DMAR );
+    HAL_UARTEx_EnableStopMode( &huart1 );
+#else
+    // Floating pins would draw current in stop mode
+    bsp_uart_pins_set_mode( BSP_UART1_PINS, BSP_UART_GPIO_MODER_ANALOG );
+    __HAL_RCC_USART1_CLK_DISABLE( );
+#endif
+}
+
+void bsp_uart1_resume( void )
+{
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+    HAL_UARTEx_DisableStopMode( &huart1 );
+    if( uart1_rx_ring_size != 0 )
+    {
+        SET_BIT( huart1.Instance->CR3, USART_CR3_DMAR );
+    }
+#else
+    // The configuration and the DMA channels are kept, the circular reception goes on where it stopped
+    __HAL_RCC_USART1_CLK_ENABLE( );
+    bsp_uart_pins_set_mode( BSP_UART1_PINS, BSP_UART_GPIO_MODER_AF );
+#endif
+}
+
+void bsp_uart2_suspend( void )
+{
+    bsp_uart_pins_set_mode( BSP_UART2_PINS, BSP_UART_GPIO_MODER_ANALOG );
+    __HAL_RCC_USART2_CLK_DISABLE( );
+    uart2_suspended = true;
 }
 
 void bsp_uart1_dma_start_rx( uint8_t* buff, uint16_t size )
 {
-    HAL_UART_DMAStop( &huart1 );
+    // Only abort the reception, a response may still be on its way out
+    bsp_uart1_dma_stop_rx( );
+    hdma_usart1_rx.Instance->CCR &= ~DMA_CCR_CIRC;
+    hdma_usart1_rx.Init.Mode = DMA_NORMAL;
     HAL_UART_Receive_DMA( &huart1, buff, size );
 }
 
 void bsp_uart1_dma_stop_rx( void )
 {
-    HAL_UART_DMAStop( &huart1 );
+    __HAL_UART_DISABLE_IT( &huart1, UART_IT_IDLE );
+    HAL_UART_AbortReceive( &huart1 );
+    uart1_rx_ring_size = 0;
+}
+
+void bsp_uart1_dma_start_rx_circular( uint8_t* buff, uint16_t size, const bsp_uart_irq_t* irq )
+{
+    bsp_uart1_dma_stop_rx( );
+
+    uart1_rx_irq       = *irq;
+    uart1_rx_ring_size = size;
+
+    // The channel keeps its configuration between transfers, only the circular bit has to be changed
+    hdma_usart1_rx.Instance->CCR |= DMA_CCR_CIRC;
+    hdma_usart1_rx.Init.Mode = DMA_CIRCULAR;
+    if( HAL_UART_Receive_DMA( &huart1, buff, size ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+
+    __HAL_UART_CLEAR_IT( &huart1, UART_CLEAR_IDLEF );
+    __HAL_UART_ENABLE_IT( &huart1, UART_IT_IDLE );
+}
+
+uint16_t bsp_uart1_dma_get_rx_index( void )
+{
+    const uint16_t remaining = __HAL_DMA_GET_COUNTER( &hdma_usart1_rx );
+
+    return ( remaining == 0 ) ? 0 : ( uart1_rx_ring_size - remaining );
+}
+
+bool bsp_uart1_dma_is_rx_circular_running( void )
+{
+    return ( uart1_rx_ring_size != 0 ) ? true : false;
 }
 
 void bsp_uart1_tx( uint8_t* buff, uint8_t len )
@@ -145,27 +340,54 @@ void bsp_uart1_tx( uint8_t* buff, uint8_t len )
     HAL_UART_Transmit( &huart1, ( uint8_t* ) buff, len, 0xffffff );
 }
 
+void bsp_uart1_dma_tx( uint8_t* buff, uint16_t len, const bsp_uart_irq_t* irq )
+{
+    uart1_tx_irq = *irq;
+
+    if( HAL_UART_Transmit_DMA( &huart1, buff, len ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+}
+
 void bsp_uart2_tx( uint8_t* buff, uint8_t len )
 {
+    bsp_uart2_resume( );
     HAL_UART_Transmit( &huart2, ( uint8_t* ) buff, len, 0xffffff );
 }
 
+void bsp_uart2_dma_tx( uint8_t* buff, uint16_t len, const bsp_uart_irq_t* irq )
+{
+    uart2_tx_irq = *irq;
+
+    bsp_uart2_resume( );
+    if( HAL_UART_Transmit_DMA( &huart2, buff, len ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+}
+
 void HAL_UART_MspInit( UART_HandleTypeDef* huart )
 {
     GPIO_InitTypeDef GPIO_InitStruct;
-    if( huart->Instance == USART1 )
+    if( huart->Instance == BSP_UART1_INSTANCE )
     {
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+        __HAL_RCC_LPUART1_CLK_ENABLE( );
+        __HAL_RCC_GPIOC_CLK_ENABLE( );
+#else
         __HAL_RCC_USART1_CLK_ENABLE( );
+#endif
 
-        GPIO_InitStruct.Alternate = GPIO_AF4_USART1;
-        GPIO_InitStruct.Pin       = ( 1 << ( HW_MODEM_RX_LINE & 0x0F ) ) | ( 1 << ( HW_MODEM_TX_LINE & 0x0F ) );
+        GPIO_InitStruct.Alternate = BSP_UART1_GPIO_AF;
+        GPIO_InitStruct.Pin       = BSP_UART1_GPIO_PINS;
         GPIO_InitStruct.Mode      = GPIO_MODE_AF_PP;
         GPIO_InitStruct.Pull      = GPIO_NOPULL;
         GPIO_InitStruct.Speed     = GPIO_SPEED_FREQ_VERY_HIGH;
-        HAL_GPIO_Init( GPIOA, &GPIO_InitStruct );
+        HAL_GPIO_Init( BSP_UART1_GPIO_PORT, &GPIO_InitStruct );
 
-        hdma_usart1_rx.Instance                 = DMA1_Channel3;
-        hdma_usart1_rx.Init.Request             = DMA_REQUEST_3;
+        hdma_usart1_rx.Instance                 = BSP_UART1_DMA_RX_CHANNEL;
+        hdma_usart1_rx.Init.Request             = BSP_UART1_DMA_REQUEST;
         hdma_usart1_rx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
         hdma_usart1_rx.Init.PeriphInc           = DMA_PINC_DISABLE;
         hdma_usart1_rx.Init.MemInc              = DMA_MINC_ENABLE;
@@ -179,6 +401,22 @@ void HAL_UART_MspInit( UART_HandleTypeDef* huart )
             bsp_mcu_panic( );
         }
         __HAL_LINKDMA( huart, hdmarx, hdma_usart1_rx );
+
+        hdma_usart1_tx.Instance                 = BSP_UART1_DMA_TX_CHANNEL;
+        hdma_usart1_tx.Init.Request             = BSP_UART1_DMA_REQUEST;
+        hdma_usart1_tx.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+        hdma_usart1_tx.Init.PeriphInc           = DMA_PINC_DISABLE;
+        hdma_usart1_tx.Init.MemInc              = DMA_MINC_ENABLE;
+        hdma_usart1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_usart1_tx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+        hdma_usart1_tx.Init.Mode                = DMA_NORMAL;
+        hdma_usart1_tx.Init.Priority            = DMA_PRIORITY_LOW;
+
+        if( HAL_DMA_Init( &hdma_usart1_tx ) != HAL_OK )
+        {
+            bsp_mcu_panic( );
+        }
+        __HAL_LINKDMA( huart, hdmatx, hdma_usart1_tx );
     }
     else if( huart->Instance == USART2 )
     {
@@ -192,6 +430,22 @@ void HAL_UART_MspInit( UART_HandleTypeDef* huart )
 
         __HAL_RCC_GPIOA_CLK_ENABLE( );
         HAL_GPIO_Init( GPIOA, &GPIO_InitStruct );
+
+        hdma_usart2_tx.Instance                 = BSP_UART2_DMA_TX_CHANNEL;
+        hdma_usart2_tx.Init.Request             = DMA_REQUEST_4;
+        hdma_usart2_tx.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+        hdma_usart2_tx.Init.PeriphInc           = DMA_PINC_DISABLE;
+        hdma_usart2_tx.Init.MemInc              = DMA_MINC_ENABLE;
+        hdma_usart2_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+        hdma_usart2_tx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+        hdma_usart2_tx.Init.Mode                = DMA_NORMAL;
+        hdma_usart2_tx.Init.Priority            = DMA_PRIORITY_LOW;
+
+        if( HAL_DMA_Init( &hdma_usart2_tx ) != HAL_OK )
+        {
+            bsp_mcu_panic( );
+        }
+        __HAL_LINKDMA( huart, hdmatx, hdma_usart2_tx );
     }
     else
     {
@@ -201,13 +455,17 @@ void HAL_UART_MspInit( UART_HandleTypeDef* huart )
 
 void HAL_UART_MspDeInit( UART_HandleTypeDef* huart )
 {
-    if( huart->Instance == USART1 )
+    if( huart->Instance == BSP_UART1_INSTANCE )
     {
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+        __HAL_RCC_LPUART1_CLK_DISABLE( );
+#else
         __HAL_RCC_USART1_CLK_DISABLE( );
-        HAL_GPIO_DeInit( GPIOA, ( 1 << ( HW_MODEM_TX_LINE & 0x0F ) ) );
-        HAL_GPIO_DeInit( GPIOA, ( 1 << ( HW_MODEM_RX_LINE & 0x0F ) ) );
+#endif
+        HAL_GPIO_DeInit( BSP_UART1_GPIO_PORT, BSP_UART1_GPIO_PINS );
 
         HAL_DMA_DeInit( &hdma_usart1_rx );
+        HAL_DMA_DeInit( &hdma_usart1_tx );
 
         __HAL_RCC_DMA1_CLK_DISABLE( );
     }
@@ -216,17 +474,135 @@ void HAL_UART_MspDeInit( UART_HandleTypeDef* huart )
         __HAL_RCC_USART2_CLK_DISABLE( );
         HAL_GPIO_DeInit( GPIOA, ( 1 << ( DEBUG_UART_TX & 0x0F ) ) );
         HAL_GPIO_DeInit( GPIOA, ( 1 << ( DEBUG_UART_RX & 0x0F ) ) );
+
+        HAL_DMA_DeInit( &hdma_usart2_tx );
+    }
+}
+
+void HAL_UART_TxCpltCallback( UART_HandleTypeDef* huart )
+{
+    if( ( huart->Instance == BSP_UART1_INSTANCE ) && ( uart1_tx_irq.callback != NULL ) )
+    {
+        uart1_tx_irq.callback( uart1_tx_irq.context );
+    }
+    else if( ( huart->Instance == USART2 ) && ( uart2_tx_irq.callback != NULL ) )
+    {
+        uart2_tx_irq.callback( uart2_tx_irq.context );
     }
 }
 
-void DMA1_Channel2_3_IRQHandler( void )
+void HAL_UART_RxHalfCpltCallback( UART_HandleTypeDef* huart )
 {
+    if( ( huart->Instance == BSP_UART1_INSTANCE ) && ( uart1_rx_ring_size != 0 ) && ( uart1_rx_irq.callback != NULL ) )
+    {
+        uart1_rx_irq.callback( uart1_rx_irq.context );
+    }
+}
+
+void HAL_UART_RxCpltCallback( UART_HandleTypeDef* huart )
+{
+    if( ( huart->Instance == BSP_UART1_INSTANCE ) && ( uart1_rx_ring_size != 0 ) && ( uart1_rx_irq.callback != NULL ) )
+    {
+        uart1_rx_irq.callback( uart1_rx_irq.context );
+    }
+}
+
+void DMA1_Channel4_5_6_7_IRQHandler( void )
+{
+    BSP_PERF_IRQ_ENTER( BSP_PERF_IRQ_UART_DMA );
+#if( BSP_USE_USER_UART == BSP_FEATURE_ON )
+    // Without the user UART, channels 4 and 5 may carry the host SPI which does not use their interrupts
+    HAL_DMA_IRQHandler( huart1.hdmatx );
     HAL_DMA_IRQHandler( huart1.hdmarx );
+#endif
+    HAL_DMA_IRQHandler( huart2.hdmatx );
+    BSP_PERF_IRQ_EXIT( BSP_PERF_IRQ_UART_DMA );
+}
+
+void USART2_IRQHandler( void )
+{
+    HAL_UART_IRQHandler( &huart2 );
+}
+
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+void HAL_UARTEx_WakeupCallback( UART_HandleTypeDef* huart )
+{
+    // A start bit woke the MCU up, the frame is coming: the receiver is told so it can keep the MCU awake
+    if( ( huart->Instance == BSP_UART1_INSTANCE ) && ( uart1_rx_ring_size != 0 ) && ( uart1_rx_irq.callback != NULL ) )
+    {
+        uart1_rx_irq.callback( uart1_rx_irq.context );
+    }
 }
 
+void bsp_uart1_lpuart_irq_handler( void )
+{
+    bsp_uart1_irq_handler( );
+}
+#else
+void USART1_IRQHandler( void )
+{
+    bsp_uart1_irq_handler( );
+}
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static void bsp_uart1_irq_handler( void )
+{
+    // The HAL does not handle the idle line detection, which ends a burst of received bytes
+    if( ( __HAL_UART_GET_FLAG( &huart1, UART_FLAG_IDLE ) != RESET ) &&
+        ( __HAL_UART_GET_IT_SOURCE( &huart1, UART_IT_IDLE ) != RESET ) )
+    {
+        __HAL_UART_CLEAR_IT( &huart1, UART_CLEAR_IDLEF );
+        if( uart1_rx_irq.callback != NULL )
+        {
+            uart1_rx_irq.callback( uart1_rx_irq.context );
+        }
+    }
+
+    HAL_UART_IRQHandler( &huart1 );
+}
+
+static void bsp_uart_pins_set_mode( const uint32_t pins, const uint32_t mode )
+{
+    uint32_t mask  = 0;
+    uint32_t value = 0;
+
+    for( uint32_t pos = 0; pos < 16; pos++ )
+    {
+        if( ( pins & ( 1UL << pos ) ) != 0 )
+        {
+            mask |= 0x03UL << ( pos * 2 );
+            value |= mode << ( pos * 2 );
+        }
+    }
+    MODIFY_REG( GPIOA->MODER, mask, value );
+}
+
+static void bsp_uart2_resume( void )
+{
+    if( uart2_suspended == true )
+    {
+        __HAL_RCC_USART2_CLK_ENABLE( );
+        bsp_uart_pins_set_mode( BSP_UART2_PINS, BSP_UART_GPIO_MODER_AF );
+        uart2_suspended = false;
+    }
+}
+
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+static void bsp_uart1_wakeup_config( void )
+{
+    const UART_WakeUpTypeDef wakeup = { .WakeUpEvent = UART_WAKEUP_ON_STARTBIT };
+
+    if( HAL_UARTEx_StopModeWakeUpSourceConfig( &huart1, wakeup ) != HAL_OK )
+    {
+        bsp_mcu_panic( );
+    }
+    __HAL_UART_ENABLE_IT( &huart1, UART_IT_WUF );
+}
+#endif
+
 /* --- EOF ------------------------------------------------------------------ */
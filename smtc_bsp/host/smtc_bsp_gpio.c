@@ -0,0 +1,170 @@
+/*!
+ * \file      smtc_bsp_gpio.c
+ *
+ * \brief     Host simulation GPIO BSP: only the radio interrupt line is modelled.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "smtc_bsp.h"
+#include "smtc_bsp_sim.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static bsp_gpio_irq_t gpio_radio_irq = { .pin = RADIO_DIOX, .context = NULL, .callback = NULL };
+static bool           gpio_radio_irq_is_attached = false;
+static bool           gpio_radio_dio_value       = false;
+// edge scheduled by the simulated radio, pending once its time is reached until its handler runs
+static bool     gpio_radio_edge_is_set  = false;
+static uint64_t gpio_radio_edge_time_us = 0;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * Rising edge of the radio interrupt line
+ */
+static void bsp_gpio_radio_irq_handler( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void bsp_sim_radio_irq_set( uint32_t delay_us )
+{
+    gpio_radio_edge_is_set  = true;
+    gpio_radio_edge_time_us = bsp_sim_get_time_us( ) + delay_us;
+    bsp_sim_event_set( BSP_SIM_EVENT_RADIO_DIO, gpio_radio_edge_time_us, bsp_gpio_radio_irq_handler );
+}
+
+void bsp_sim_radio_irq_clear( void )
+{
+    bsp_sim_event_clear( BSP_SIM_EVENT_RADIO_DIO );
+    gpio_radio_edge_is_set = false;
+    gpio_radio_dio_value   = false;
+}
+
+void bsp_gpio_init_out( const bsp_gpio_pin_names_t pin, const uint32_t value )
+{
+}
+
+void bsp_gpio_init_in( const bsp_gpio_pin_names_t pin, const gpio_pull_mode_t pull_mode, const gpio_irq_mode_t irq_mode,
+                       bsp_gpio_irq_t* irq )
+{
+    if( ( irq != NULL ) && ( irq->callback != NULL ) )
+    {
+        bsp_gpio_irq_attach( irq );
+    }
+}
+
+void bsp_gpio_irq_attach( const bsp_gpio_irq_t* irq )
+{
+    if( ( irq != NULL ) && ( irq->pin == RADIO_DIOX ) )
+    {
+        gpio_radio_irq             = *irq;
+        gpio_radio_irq_is_attached = true;
+    }
+}
+
+void bsp_gpio_irq_deatach( const bsp_gpio_irq_t* irq )
+{
+    if( ( irq != NULL ) && ( irq->pin == RADIO_DIOX ) )
+    {
+        gpio_radio_irq_is_attached = false;
+    }
+}
+
+void bsp_gpio_irq_enable( void )
+{
+    bsp_sim_event_enable( BSP_SIM_EVENT_RADIO_DIO, true );
+}
+
+void bsp_gpio_irq_disable( void )
+{
+    bsp_sim_event_enable( BSP_SIM_EVENT_RADIO_DIO, false );
+}
+
+void bsp_gpio_set_value( const bsp_gpio_pin_names_t pin, const uint32_t value )
+{
+}
+
+void bsp_gpio_toggle( const bsp_gpio_pin_names_t pin )
+{
+}
+
+uint32_t bsp_gpio_get_value( const bsp_gpio_pin_names_t pin )
+{
+    return ( ( pin == RADIO_DIOX ) && ( gpio_radio_dio_value == true ) ) ? 1 : 0;
+}
+
+bool bsp_gpio_is_pending_irq( void )
+{
+    return ( ( gpio_radio_edge_is_set == true ) && ( gpio_radio_edge_time_us <= bsp_sim_get_time_us( ) ) ) ? true
+                                                                                                         : false;
+}
+
+void bsp_gpio_sleep_init( const bsp_gpio_sleep_pin_t* table, const uint8_t nb )
+{
+}
+
+void bsp_gpio_sleep_enter( void )
+{
+}
+
+void bsp_gpio_sleep_exit( void )
+{
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void bsp_gpio_radio_irq_handler( void )
+{
+    gpio_radio_edge_is_set = false;
+    gpio_radio_dio_value   = true;
+    if( ( gpio_radio_irq_is_attached == true ) && ( gpio_radio_irq.callback != NULL ) )
+    {
+        gpio_radio_irq.callback( gpio_radio_irq.context );
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,546 @@
+/*!
+ * \file      smtc_bsp_mcu.c
+ *
+ * \brief     Host simulation MCU BSP: virtual time and interrupts.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>   // exit
+#include <unistd.h>   // execv
+
+#include "smtc_bsp.h"
+#include "smtc_bsp_sim.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * Core clock of the simulated MCU, as on the target
+ */
+#define BSP_SIM_CORE_CLOCK_HZ 32000000
+
+/*!
+ * Environment variable giving the state kept across a reset to the re-executed simulator
+ */
+#define BSP_SIM_RESUME_ENV "BSP_SIM_RESUME"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+// Low Power options
+typedef enum low_power_mode_e
+{
+    LOW_POWER_ENABLE,
+    LOW_POWER_DISABLE,
+    LOW_POWER_DISABLE_ONCE
+} low_power_mode_t;
+
+typedef struct bsp_sim_event_state_s
+{
+    bool     is_set;
+    bool     is_enabled;
+    uint64_t time_us;
+    void ( *handler )( void );
+} bsp_sim_event_state_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static bsp_sim_config_t      bsp_sim_config   = { .seed = 1, .nvm_file = NULL, .trace_on = false, .argv = NULL };
+static uint64_t              bsp_sim_time_us  = 0;
+static uint32_t              bsp_sim_reset_nb = 0;
+static char                  bsp_sim_nvm_tmp_file[64];
+static bsp_sim_event_state_t bsp_sim_events[BSP_SIM_EVENT_NB];
+
+// the interrupts only run during the sleeps and the waits of the main context, with the interrupts enabled
+static bool bsp_sim_irq_disabled = false;
+static bool bsp_sim_in_irq       = false;
+
+static low_power_mode_t bsp_lp_current_mode = LOW_POWER_ENABLE;
+static uint8_t          bsp_wakeup_sources  = 0;
+
+/*!
+ * Software interrupt (PendSV) callback, locked by the peripheral IRQ sections
+ */
+static void ( *bsp_soft_irq_callback )( void* context ) = NULL;
+static void* bsp_soft_irq_context                       = NULL;
+static bool  bsp_soft_irq_locked                        = false;
+static bool  bsp_soft_irq_pending                       = false;
+
+/*!
+ * Time spent sleeping since the start
+ */
+static uint64_t bsp_stop_time_us = 0;
+
+/*!
+ * Wake-ups since the start of the run, lost on a reset as the other RAM counters
+ */
+static uint32_t bsp_wakeup_nb = 0;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * Runs the pending software interrupt, unless a peripheral IRQ section holds it
+ */
+static void bsp_sim_soft_irq_run( void );
+
+/*!
+ * Moves the virtual time to the next interrupt due before time_us and runs its handler
+ *
+ * \retval true if an interrupt ran, false if the virtual time reached time_us
+ */
+static bool bsp_sim_run_next_event( uint64_t time_us );
+
+/*!
+ * Removes the NVM file private to the simulator at the end of the run
+ */
+static void bsp_sim_nvm_tmp_file_remove( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void bsp_sim_init( const bsp_sim_config_t* config )
+{
+    const char*        resume    = getenv( BSP_SIM_RESUME_ENV );
+    unsigned long long time_us   = 0;
+    unsigned long long stop_us   = 0;
+    bool               is_resume = false;
+
+    bsp_sim_config   = *config;
+    bsp_sim_time_us  = 0;
+    bsp_stop_time_us = 0;
+    bsp_sim_reset_nb = 0;
+    if( ( resume != NULL ) && ( sscanf( resume, "%llu,%llu,%u", &time_us, &stop_us, &bsp_sim_reset_nb ) == 3 ) )
+    {
+        bsp_sim_time_us  = time_us;
+        bsp_stop_time_us = stop_us;
+        is_resume        = true;
+    }
+    unsetenv( BSP_SIM_RESUME_ENV );
+
+    // without a NVM file the NVM still survives the resets of the run, in a file of the process
+    if( ( bsp_sim_config.nvm_file == NULL ) && ( bsp_sim_config.argv != NULL ) )
+    {
+        snprintf( bsp_sim_nvm_tmp_file, sizeof( bsp_sim_nvm_tmp_file ), "/tmp/bsp_sim_%d.nvm", ( int ) getpid( ) );
+        bsp_sim_config.nvm_file = bsp_sim_nvm_tmp_file;
+        if( is_resume == false )
+        {
+            remove( bsp_sim_nvm_tmp_file );
+        }
+        atexit( bsp_sim_nvm_tmp_file_remove );
+    }
+    for( uint8_t i = 0; i < BSP_SIM_EVENT_NB; i++ )
+    {
+        bsp_sim_events[i] = ( bsp_sim_event_state_t ){ .is_set = false, .is_enabled = true };
+    }
+}
+
+const bsp_sim_config_t* bsp_sim_get_config( void )
+{
+    return &bsp_sim_config;
+}
+
+uint32_t bsp_sim_get_reset_nb( void )
+{
+    return bsp_sim_reset_nb;
+}
+
+uint64_t bsp_sim_get_time_us( void )
+{
+    return bsp_sim_time_us;
+}
+
+void bsp_sim_event_set( bsp_sim_event_t event, uint64_t time_us, void ( *handler )( void ) )
+{
+    bsp_sim_events[event].is_set  = true;
+    bsp_sim_events[event].time_us = ( time_us > bsp_sim_time_us ) ? time_us : bsp_sim_time_us;
+    bsp_sim_events[event].handler = handler;
+}
+
+void bsp_sim_event_clear( bsp_sim_event_t event )
+{
+    bsp_sim_events[event].is_set = false;
+}
+
+void bsp_sim_event_enable( bsp_sim_event_t event, bool enable )
+{
+    bsp_sim_events[event].is_enabled = enable;
+}
+
+void bsp_mcu_critical_section_begin( uint32_t* mask )
+{
+    *mask                = ( bsp_sim_irq_disabled == true ) ? 1 : 0;
+    bsp_sim_irq_disabled = true;
+}
+
+void bsp_mcu_critical_section_end( uint32_t* mask )
+{
+    bsp_sim_irq_disabled = ( *mask != 0 ) ? true : false;
+}
+
+void bsp_mcu_disable_periph_irq( void )
+{
+    bsp_soft_irq_locked = true;
+    bsp_gpio_irq_disable( );
+    bsp_tmr_irq_disable( );
+}
+
+void bsp_mcu_enable_periph_irq( void )
+{
+    bsp_gpio_irq_enable( );
+    bsp_tmr_irq_enable( );
+    bsp_soft_irq_locked = false;
+
+    // A software interrupt raised inside the section has been postponed
+    if( bsp_sim_in_irq == false )
+    {
+        bsp_sim_soft_irq_run( );
+    }
+}
+
+void bsp_mcu_init( void )
+{
+    bsp_tmr_init( );
+    bsp_rtc_init( );
+    bsp_watchdog_init( );
+}
+
+void bsp_disable_irq( void )
+{
+    bsp_sim_irq_disabled = true;
+}
+
+void bsp_enable_irq( void )
+{
+    bsp_sim_irq_disabled = false;
+}
+
+void bsp_mcu_reset( void )
+{
+    char resume[64];
+
+    BSP_DBG_TRACE_WARNING( "%s at %llu ms\n", __func__, ( unsigned long long ) ( bsp_sim_time_us / 1000 ) );
+    if( bsp_sim_config.argv != NULL )
+    {
+        // the RAM is lost, the NVM file and the virtual time are kept
+        snprintf( resume, sizeof( resume ), "%llu,%llu,%u", ( unsigned long long ) bsp_sim_time_us,
+                  ( unsigned long long ) bsp_stop_time_us, bsp_sim_reset_nb + 1 );
+        setenv( BSP_SIM_RESUME_ENV, resume, 1 );
+        fflush( stdout );
+        execv( "/proc/self/exe", bsp_sim_config.argv );
+    }
+    // the reset of a simulated device ends its run, the NVM file keeps its state for the next one
+    exit( EXIT_FAILURE );
+}
+
+bool bsp_mcu_is_reset_after_brownout( void )
+{
+    // a new process is a power on, a re-execution a reset
+    return ( bsp_sim_reset_nb == 0 ) ? true : false;
+}
+
+void bsp_mcu_panic( void )
+{
+    fprintf( stderr, "PANIC at %llu ms\n", ( unsigned long long ) ( bsp_sim_time_us / 1000 ) );
+    abort( );
+}
+
+void bsp_mcu_handle_lr1mac_issue( void )
+{
+    fprintf( stderr, "LR1MAC PANIC at %llu ms\n", ( unsigned long long ) ( bsp_sim_time_us / 1000 ) );
+    abort( );
+}
+
+void bsp_mcu_modem_need_reset( void )
+{
+    bsp_mcu_reset( );
+}
+
+void bsp_mcu_init_radio( const void* context )
+{
+}
+
+void bsp_mcu_set_sleep_for_s( const int32_t seconds )
+{
+    bsp_mcu_set_sleep_for_ms( seconds * 1000 );
+}
+
+void bsp_mcu_set_sleep_for_ms( const int32_t milliseconds )
+{
+    if( milliseconds <= 0 )
+    {
+        return;
+    }
+    if( bsp_lp_current_mode == LOW_POWER_DISABLE_ONCE )
+    {
+        bsp_lp_current_mode = LOW_POWER_ENABLE;
+        return;
+    }
+    if( bsp_lp_current_mode != LOW_POWER_ENABLE )
+    {
+        return;
+    }
+
+    // as the STOP mode on the target, any interrupt wakes the MCU up
+    uint64_t start_us = bsp_sim_time_us;
+    bsp_sim_run_next_event( bsp_sim_time_us + ( ( uint64_t ) milliseconds * 1000 ) );
+    bsp_stop_time_us += bsp_sim_time_us - start_us;
+    bsp_wakeup_nb++;
+}
+
+void bsp_mcu_wait_us( const int32_t microseconds )
+{
+    uint64_t end_us = bsp_sim_time_us + ( uint64_t )( ( microseconds > 0 ) ? microseconds : 0 );
+
+    if( ( bsp_sim_in_irq == true ) || ( bsp_sim_irq_disabled == true ) )
+    {
+        bsp_sim_time_us = end_us;
+        return;
+    }
+    while( bsp_sim_run_next_event( end_us ) == true )
+    {
+    }
+}
+
+uint8_t bsp_mcu_get_battery_level( void )
+{
+    return ( bsp_sim_config.battery_level != 0 ) ? bsp_sim_config.battery_level : 254;
+}
+
+void bsp_trace_print( const char* fmt, ... )
+{
+    if( bsp_sim_config.trace_on == true )
+    {
+        va_list argp;
+        va_start( argp, fmt );
+        vprintf( fmt, argp );
+        va_end( argp );
+    }
+}
+
+void bsp_trace_log( const char* fmt, uint8_t nb_args, const uint32_t* args )
+{
+    // the deferred records are decoded offline on the target, the host prints the format and the raw arguments
+    if( bsp_sim_config.trace_on == true )
+    {
+        printf( "%s", fmt );
+        for( uint8_t i = 0; i < nb_args; i++ )
+        {
+            printf( " 0x%08x", args[i] );
+        }
+        printf( "\n" );
+    }
+}
+
+bool bsp_trace_flush( void )
+{
+    return false;
+}
+
+void bsp_mcu_disable_low_power_wait( void )
+{
+    bsp_lp_current_mode = LOW_POWER_DISABLE;
+}
+
+void bsp_mcu_enable_low_power_wait( void )
+{
+    bsp_lp_current_mode = LOW_POWER_ENABLE;
+}
+
+void bsp_mcu_disable_once_low_power_wait( void )
+{
+    bsp_lp_current_mode = LOW_POWER_DISABLE_ONCE;
+}
+
+void bsp_mcu_wakeup_request( const uint8_t sources )
+{
+    bsp_wakeup_sources |= sources;
+    bsp_mcu_disable_once_low_power_wait( );
+}
+
+uint8_t bsp_mcu_wakeup_sources_get( void )
+{
+    uint8_t sources    = bsp_wakeup_sources;
+    bsp_wakeup_sources = 0;
+    return sources;
+}
+
+void bsp_mcu_wait_for_event( void )
+{
+    // the next interrupt, whatever its enable state, within the longest sleep of the modem
+    if( ( bsp_sim_in_irq == false ) && ( bsp_sim_irq_disabled == false ) )
+    {
+        bsp_sim_run_next_event( bsp_sim_time_us + ( ( uint64_t ) BSP_WATCHDOG_RELOAD_PERIOD_SECONDS * 1000000 ) );
+    }
+}
+
+void bsp_mcu_soft_irq_set( void ( *callback )( void* context ), void* context )
+{
+    bsp_soft_irq_callback = callback;
+    bsp_soft_irq_context  = context;
+    bsp_soft_irq_pending  = true;
+
+    // lowest priority: it runs once the running interrupt handler returns
+    if( bsp_sim_in_irq == false )
+    {
+        bsp_sim_soft_irq_run( );
+    }
+}
+
+void bsp_mcu_clock_boost_request( void )
+{
+    // the simulated MCU has a single clock
+}
+
+void bsp_mcu_clock_boost_release( void )
+{
+}
+
+void bsp_mcu_get_power_stats( bsp_mcu_power_stats_t* stats )
+{
+    stats->stop_time_ms = ( uint32_t )( bsp_stop_time_us / 1000 );
+    stats->run_time_ms  = ( uint32_t )( ( bsp_sim_time_us - bsp_stop_time_us ) / 1000 );
+    stats->wakeup_nb    = bsp_wakeup_nb;
+}
+
+void bsp_mcu_get_stack_stats( bsp_mcu_stack_stats_t* stats )
+{
+    // the host stack is not painted
+    stats->size     = 0;
+    stats->used_max = 0;
+}
+
+uint32_t bsp_mcu_get_cycle_count( void )
+{
+    return ( uint32_t )( bsp_sim_time_us * ( BSP_SIM_CORE_CLOCK_HZ / 1000000 ) );
+}
+
+uint32_t bsp_mcu_get_core_clock_hz( void )
+{
+    return BSP_SIM_CORE_CLOCK_HZ;
+}
+
+uint32_t bsp_perf_irq_get_pending( void )
+{
+    // the simulated interrupts run as soon as they are raised
+    return 0;
+}
+
+bool bsp_mcu_sensors_refresh( void )
+{
+    return true;
+}
+
+int32_t bsp_mcu_get_mcu_temperature( void )
+{
+    return 25;
+}
+
+uint8_t bsp_mcu_get_mcu_voltage( void )
+{
+    return 0x98;  // 3 V as on the target
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void bsp_sim_soft_irq_run( void )
+{
+    if( ( bsp_soft_irq_pending == true ) && ( bsp_soft_irq_locked == false ) && ( bsp_soft_irq_callback != NULL ) )
+    {
+        bsp_soft_irq_pending = false;
+        bsp_sim_in_irq       = true;
+        bsp_soft_irq_callback( bsp_soft_irq_context );
+        bsp_sim_in_irq = false;
+    }
+}
+
+static bool bsp_sim_run_next_event( uint64_t time_us )
+{
+    int8_t next = -1;
+
+    for( uint8_t i = 0; i < BSP_SIM_EVENT_NB; i++ )
+    {
+        if( ( bsp_sim_events[i].is_set == true ) && ( bsp_sim_events[i].is_enabled == true ) &&
+            ( bsp_sim_events[i].time_us <= time_us ) &&
+            ( ( next < 0 ) || ( bsp_sim_events[i].time_us < bsp_sim_events[next].time_us ) ) )
+        {
+            next = i;
+        }
+    }
+    if( next < 0 )
+    {
+        bsp_sim_time_us = ( time_us > bsp_sim_time_us ) ? time_us : bsp_sim_time_us;
+        return false;
+    }
+
+    // an interrupt held while disabled runs late
+    if( bsp_sim_events[next].time_us > bsp_sim_time_us )
+    {
+        bsp_sim_time_us = bsp_sim_events[next].time_us;
+    }
+    bsp_sim_events[next].is_set = false;
+    bsp_sim_in_irq              = true;
+    bsp_sim_events[next].handler( );
+    bsp_sim_in_irq = false;
+    bsp_sim_soft_irq_run( );
+    return true;
+}
+
+static void bsp_sim_nvm_tmp_file_remove( void )
+{
+    remove( bsp_sim_nvm_tmp_file );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,211 @@
+/*!
+ * \file      smtc_bsp_nvm.c
+ *
+ * \brief     Host simulation NVM BSP: the data EEPROM is kept in RAM and optionally in a file.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdio.h>
+#include <string.h>
+
+#include "smtc_bsp.h"
+#include "smtc_bsp_sim.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+// Journal: one slot per key in the journal area, a valid marker, the size, then the last value of the key
+#define JOURNAL_SLOT_SIZE 64
+#define JOURNAL_SLOT_VALID 0xA5
+#define JOURNAL_SLOT_HEADER_SIZE 2
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uint8_t nvm_image[BSP_SIM_NVM_SIZE];
+static bool    nvm_is_loaded = false;
+static uint8_t staging_image[BSP_NVM_STAGING_SIZE];  // not kept between runs
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Load the NVM file on the first access, an absent file is an erased NVM
+ */
+static void nvm_load( void );
+
+/*!
+ * \brief Write the NVM image back to its file
+ */
+static void nvm_save( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+int32_t bsp_nvm_context_restore( const uint32_t addr, uint8_t* buffer, const uint32_t size )
+{
+    if( ( addr + size ) > BSP_SIM_NVM_SIZE )
+    {
+        return -1;
+    }
+    nvm_load( );
+    memcpy( buffer, &nvm_image[addr], size );
+    return 0;
+}
+
+int32_t bsp_nvm_context_store( const uint32_t addr, const uint8_t* buffer, const uint32_t size )
+{
+    if( ( addr + size ) > BSP_SIM_NVM_SIZE )
+    {
+        return -1;
+    }
+    nvm_load( );
+    memcpy( &nvm_image[addr], buffer, size );
+    nvm_save( );
+    return 0;
+}
+
+int32_t bsp_nvm_journal_read( const uint8_t key, uint8_t* buffer, const uint8_t size )
+{
+    if( ( key == 0 ) || ( key > BSP_NVM_JOURNAL_KEY_MAX ) )
+    {
+        return -1;
+    }
+    nvm_load( );
+
+    const uint8_t* slot = &nvm_image[BSP_NVM_JOURNAL_ADDR_OFFSET + ( ( key - 1 ) * JOURNAL_SLOT_SIZE )];
+    if( slot[0] != JOURNAL_SLOT_VALID )
+    {
+        return -1;
+    }
+    uint8_t length = ( slot[1] < size ) ? slot[1] : size;
+    memcpy( buffer, &slot[JOURNAL_SLOT_HEADER_SIZE], length );
+    return length;
+}
+
+int32_t bsp_nvm_journal_write( const uint8_t key, const uint8_t* buffer, const uint8_t size )
+{
+    if( ( key == 0 ) || ( key > BSP_NVM_JOURNAL_KEY_MAX ) ||
+        ( size > ( JOURNAL_SLOT_SIZE - JOURNAL_SLOT_HEADER_SIZE ) ) )
+    {
+        return -1;
+    }
+    nvm_load( );
+
+    uint8_t* slot = &nvm_image[BSP_NVM_JOURNAL_ADDR_OFFSET + ( ( key - 1 ) * JOURNAL_SLOT_SIZE )];
+    if( ( slot[0] != JOURNAL_SLOT_VALID ) || ( slot[1] != size ) ||
+        ( memcmp( &slot[JOURNAL_SLOT_HEADER_SIZE], buffer, size ) != 0 ) )
+    {
+        slot[0] = JOURNAL_SLOT_VALID;
+        slot[1] = size;
+        memcpy( &slot[JOURNAL_SLOT_HEADER_SIZE], buffer, size );
+        nvm_save( );
+    }
+    return size;
+}
+
+int32_t bsp_nvm_staging_read( const uint32_t offset, uint8_t* buffer, const uint32_t size )
+{
+    if( ( offset + size ) > BSP_NVM_STAGING_SIZE )
+    {
+        return -1;
+    }
+    memcpy( buffer, &staging_image[offset], size );
+    return 0;
+}
+
+int32_t bsp_nvm_staging_write( const uint32_t offset, const uint8_t* buffer, const uint32_t size )
+{
+    if( ( offset + size ) > BSP_NVM_STAGING_SIZE )
+    {
+        return -1;
+    }
+    memcpy( &staging_image[offset], buffer, size );
+    return 0;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void nvm_load( void )
+{
+    const char* file_name = bsp_sim_get_config( )->nvm_file;
+
+    if( nvm_is_loaded == true )
+    {
+        return;
+    }
+    nvm_is_loaded = true;
+    memset( nvm_image, 0, sizeof( nvm_image ) );
+    if( file_name != NULL )
+    {
+        FILE* file = fopen( file_name, "rb" );
+        if( file != NULL )
+        {
+            if( fread( nvm_image, 1, sizeof( nvm_image ), file ) != sizeof( nvm_image ) )
+            {
+                memset( nvm_image, 0, sizeof( nvm_image ) );
+            }
+            fclose( file );
+        }
+    }
+}
+
+static void nvm_save( void )
+{
+    const char* file_name = bsp_sim_get_config( )->nvm_file;
+
+    if( file_name != NULL )
+    {
+        FILE* file = fopen( file_name, "wb" );
+        if( file == NULL )
+        {
+            bsp_mcu_panic( );
+        }
+        fwrite( nvm_image, 1, sizeof( nvm_image ), file );
+        fclose( file );
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
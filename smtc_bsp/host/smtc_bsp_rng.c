@@ -0,0 +1,132 @@
+/*!
+ * \file      smtc_bsp_rng.c
+ *
+ * \brief     Host simulation random number generator BSP, reproducible from the device seed.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "smtc_bsp.h"
+#include "smtc_bsp_sim.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uint32_t rng_state   = 0;
+static bool     rng_is_init = false;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * Returns a uniform random number in [0, range), the whole 32 bits when range is 0
+ */
+static uint32_t bsp_rng_get_random_below( const uint32_t range );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+uint32_t bsp_rng_get_random( void )
+{
+    if( rng_is_init == false )
+    {
+        // xorshift32 has no zero state
+        rng_is_init = true;
+        rng_state   = ( bsp_sim_get_config( )->seed * 0x9E3779B9 ) | 1;
+    }
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+uint32_t bsp_rng_get_random_in_range( const uint32_t val_1, const uint32_t val_2 )
+{
+    if( val_1 <= val_2 )
+    {
+        return bsp_rng_get_random_below( val_2 - val_1 + 1 ) + val_1;
+    }
+    else
+    {
+        return bsp_rng_get_random_below( val_1 - val_2 + 1 ) + val_2;
+    }
+}
+
+int32_t bsp_rng_get_signed_random_in_range( const int32_t val_1, const int32_t val_2 )
+{
+    if( val_1 <= val_2 )
+    {
+        return ( int32_t )( val_1 + bsp_rng_get_random_in_range( 0, val_2 - val_1 ) );
+    }
+    else
+    {
+        return ( int32_t )( val_2 + bsp_rng_get_random_in_range( 0, val_1 - val_2 ) );
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint32_t bsp_rng_get_random_below( const uint32_t range )
+{
+    uint64_t product;
+    uint32_t threshold;
+
+    if( range == 0 )
+    {
+        return bsp_rng_get_random( );
+    }
+
+    // Multiply-shift with rejection, as on the target
+    product = ( uint64_t ) bsp_rng_get_random( ) * range;
+    if( ( uint32_t ) product < range )
+    {
+        threshold = ( 0 - range ) % range;
+        while( ( uint32_t ) product < threshold )
+        {
+            product = ( uint64_t ) bsp_rng_get_random( ) * range;
+        }
+    }
+    return ( uint32_t )( product >> 32 );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
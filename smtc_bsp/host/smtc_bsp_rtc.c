@@ -0,0 +1,96 @@
+/*!
+ * \file      smtc_bsp_rtc.c
+ *
+ * \brief     Host simulation RTC BSP: the RTC counts the virtual time.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "smtc_bsp.h"
+#include "smtc_bsp_sim.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void bsp_rtc_init( void )
+{
+}
+
+uint64_t bsp_rtc_get_ticks( void )
+{
+    return ( bsp_sim_get_time_us( ) * 1024 ) / 1000000;
+}
+
+uint32_t bsp_rtc_get_time_s( void )
+{
+    return ( uint32_t )( bsp_sim_get_time_us( ) / 1000000 );
+}
+
+uint32_t bsp_rtc_get_time_ms( void )
+{
+    return ( uint32_t ) bsp_rtc_get_time_ms64( );
+}
+
+uint64_t bsp_rtc_get_time_ms64( void )
+{
+    return bsp_sim_get_time_us( ) / 1000;
+}
+
+uint64_t bsp_rtc_get_time_us( void )
+{
+    return bsp_sim_get_time_us( );
+}
+
+void bsp_rtc_delay_in_ms( const uint32_t milliseconds )
+{
+    bsp_mcu_wait_us( milliseconds * 1000 );
+}
+
+void bsp_rtc_wakeup_timer_set_s( const int32_t seconds )
+{
+    // the sleeps of the simulated MCU end by themselves
+}
+
+void bsp_rtc_wakeup_timer_set_ms( const int32_t milliseconds )
+{
+}
+
+bool bsp_rtc_wakeup_timer_clear_event( void )
+{
+    return false;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
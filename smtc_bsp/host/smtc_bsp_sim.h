@@ -0,0 +1,172 @@
+/*!
+ * \file      smtc_bsp_sim.h
+ *
+ * \brief     Host simulation BSP control API definition.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __SMTC_BSP_SIM_H__
+#define __SMTC_BSP_SIM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * Size of the simulated data EEPROM, as on the STM32L073
+ */
+#define BSP_SIM_NVM_SIZE 6144
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Simulation settings of the device
+ */
+typedef struct bsp_sim_config_s
+{
+    uint32_t     seed;           // random generator seed, one per simulated device
+    const char*  nvm_file;       // file keeping the NVM between runs, NULL to start from an erased NVM every run
+    bool         trace_on;       // print the modem debug traces on stdout
+    char* const* argv;           // command line re-executed on a MCU reset, NULL to end the run on a reset
+    uint8_t      battery_level;  // returned by bsp_mcu_get_battery_level, 0 for the default full battery
+} bsp_sim_config_t;
+
+/*!
+ * Interrupt sources of the simulated MCU
+ */
+typedef enum bsp_sim_event_e
+{
+    BSP_SIM_EVENT_TMR,        // low power timer alarm
+    BSP_SIM_EVENT_RADIO_DIO,  // radio interrupt line
+    BSP_SIM_EVENT_NB
+} bsp_sim_event_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Sets up the simulation, to be called before bsp_mcu_init
+ *
+ * \param [IN] config Simulation settings
+ */
+void bsp_sim_init( const bsp_sim_config_t* config );
+
+/*!
+ * Gets the simulation settings
+ *
+ * \retval Settings given to \ref bsp_sim_init
+ */
+const bsp_sim_config_t* bsp_sim_get_config( void );
+
+/*!
+ * Gets the number of MCU resets since the start of the simulation
+ *
+ * \remark A reset re-executes the simulator from its command line: the RAM is lost, the NVM and the virtual time
+ *         are kept, as on the target
+ *
+ * \retval Number of resets
+ */
+uint32_t bsp_sim_get_reset_nb( void );
+
+/*!
+ * Gets the virtual time
+ *
+ * \remark The virtual time only moves forward when the MCU sleeps or waits, the code runs in zero time
+ *
+ * \retval Microseconds since the start of the simulation
+ */
+uint64_t bsp_sim_get_time_us( void );
+
+/*!
+ * Schedules an interrupt of the simulated MCU
+ *
+ * \remark The handler runs when the virtual time reaches time_us, during a sleep or a wait with the interrupts
+ *         enabled. A new request of the same source replaces the previous one.
+ *
+ * \param [IN] event   Interrupt source
+ * \param [IN] time_us Virtual time of the interrupt
+ * \param [IN] handler Interrupt handler
+ */
+void bsp_sim_event_set( bsp_sim_event_t event, uint64_t time_us, void ( *handler )( void ) );
+
+/*!
+ * Cancels a scheduled interrupt of the simulated MCU
+ *
+ * \param [IN] event Interrupt source
+ */
+void bsp_sim_event_clear( bsp_sim_event_t event );
+
+/*!
+ * Enables or disables an interrupt source, as its NVIC line on the target
+ *
+ * \remark A disabled interrupt stays scheduled and runs once enabled again
+ *
+ * \param [IN] event  Interrupt source
+ * \param [IN] enable true to enable the interrupt
+ */
+void bsp_sim_event_enable( bsp_sim_event_t event, bool enable );
+
+/*!
+ * Raises the radio interrupt line after a delay, as the radio would at the end of an operation
+ *
+ * \param [IN] delay_us Delay from now in microseconds
+ */
+void bsp_sim_radio_irq_set( uint32_t delay_us );
+
+/*!
+ * Cancels the pending radio interrupt and releases the line
+ */
+void bsp_sim_radio_irq_clear( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_BSP_SIM_H__
+
+/* --- EOF ------------------------------------------------------------------ */
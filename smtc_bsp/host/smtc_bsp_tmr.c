@@ -0,0 +1,113 @@
+/*!
+ * \file      smtc_bsp_tmr.c
+ *
+ * \brief     Host simulation low power timer BSP.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "smtc_bsp.h"
+#include "smtc_bsp_sim.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static bsp_tmr_irq_t lptim_tmr_irq = { .context = NULL, .callback = NULL };
+static uint64_t      lptim_start_us = 0;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * Timer interrupt handler
+ */
+static void bsp_tmr_irq_handler( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void bsp_tmr_init( void )
+{
+    lptim_tmr_irq = ( bsp_tmr_irq_t ){ .context = NULL, .callback = NULL };
+    bsp_sim_event_clear( BSP_SIM_EVENT_TMR );
+}
+
+void bsp_tmr_start( const uint32_t milliseconds, const bsp_tmr_irq_t* tmr_irq )
+{
+    lptim_tmr_irq  = *tmr_irq;
+    lptim_start_us = bsp_sim_get_time_us( );
+    bsp_sim_event_set( BSP_SIM_EVENT_TMR, lptim_start_us + ( ( uint64_t ) milliseconds * 1000 ),
+                       bsp_tmr_irq_handler );
+}
+
+void bsp_tmr_stop( void )
+{
+    bsp_sim_event_clear( BSP_SIM_EVENT_TMR );
+}
+
+uint32_t bsp_tmr_get_time_ms( void )
+{
+    return ( uint32_t )( ( bsp_sim_get_time_us( ) - lptim_start_us ) / 1000 );
+}
+
+void bsp_tmr_irq_enable( void )
+{
+    bsp_sim_event_enable( BSP_SIM_EVENT_TMR, true );
+}
+
+void bsp_tmr_irq_disable( void )
+{
+    bsp_sim_event_enable( BSP_SIM_EVENT_TMR, false );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void bsp_tmr_irq_handler( void )
+{
+    if( lptim_tmr_irq.callback != NULL )
+    {
+        lptim_tmr_irq.callback( lptim_tmr_irq.context );
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
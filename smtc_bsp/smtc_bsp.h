@@ -49,6 +49,7 @@ extern "C" {
 #include "smtc_bsp_adc.h"
 #include "smtc_bsp_spi.h"
 #include "smtc_bsp_uart.h"
+#include "smtc_bsp_perf.h"
 
 #ifdef __cplusplus
 }
@@ -52,18 +52,36 @@ extern "C" {
  * --- PUBLIC CONSTANTS --------------------------------------------------------
  */
 
+/*!
+ * Results of a scan of the internal channels, in conversion order
+ */
+#define BSP_ADC_SCAN_VREFINT 0
+#define BSP_ADC_SCAN_TEMPERATURE 1
+#define BSP_ADC_SCAN_LENGTH 2
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC TYPES ------------------------------------------------------------
  */
 
+/*!
+ * ADC scan completion data context
+ */
+typedef struct bsp_adc_irq_s
+{
+    void* context;
+    void ( *callback )( void* context );
+} bsp_adc_irq_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
  */
 
 /*!
- *  Initializes the MCU ADC peripheral
+ *  Initializes the MCU ADC peripheral to scan its internal channels
+ *
+ * \remark The ADC powers itself off between the scans
  *
  * \param [IN] id   ADC interface id [1:N]
  */
@@ -77,14 +95,19 @@ void bsp_adc_init( const uint32_t id );
 void bsp_adc_deinit( const uint32_t id );
 
 /*!
- * Sends out_data and receives in_data
+ * Start a scan of the internal channels, VREFINT then the temperature sensor, and return right away
  *
- * \param [IN] id       ADC interface id [1:N]
- * \param [IN] out_data adc conversion timeout in ms
-
- * \retval  RAW adc value, 0 if fail
+ * \remark Each channel is oversampled 16 times by the ADC. The callback is called from interrupt once values holds
+ *         the BSP_ADC_SCAN_LENGTH raw 12 bits results
+ *
+ * \param [IN]  id     ADC interface id [1:N]
+ * \param [OUT] values Raw results, indexed by BSP_ADC_SCAN_VREFINT and BSP_ADC_SCAN_TEMPERATURE
+ * \param [IN]  irq    Scan completion callback
+ *
+ * \retval started [true: the scan is started
+ *                  false: a scan is already ongoing]
  */
-uint32_t bsp_adc_get_value( const uint32_t id, const uint32_t timeout_ms );
+bool bsp_adc_start_scan( const uint32_t id, uint16_t* values, const bsp_adc_irq_t* irq );
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,95 @@
+/*!
+ * \file      smtc_bsp_aes.h
+ *
+ * \brief     Board specific package AES API definition.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __SMTC_BSP_AES_H__
+#define __SMTC_BSP_AES_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "smtc_bsp_types.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Encrypts one 16 bytes block with the AES-128 hardware peripheral (ECB mode)
+ *
+ * \remark The peripheral is not reentrant: the calls of this API are serialized by the caller
+ *
+ * \param [IN]  key   16 bytes AES key
+ * \param [IN]  in    Plain block, 32 bits aligned
+ * \param [OUT] out   Cipher block, 32 bits aligned
+ */
+void bsp_aes_ecb_encrypt( const uint8_t key[16], const uint32_t in[4], uint32_t out[4] );
+
+/*!
+ * Encrypts nb_blocks blocks in place with the AES-128 hardware peripheral (CTR mode)
+ *
+ * \remark The blocks are polled, the function returns once the last block is written back.
+ *         The peripheral increments the 32 bits counter held in the last word of iv
+ *
+ * \param [IN]     key        16 bytes AES key
+ * \param [IN]     iv         Initial counter block
+ * \param [IN/OUT] buffer     Data to encrypt, 32 bits aligned
+ * \param [IN]     nb_blocks  Number of 16 bytes blocks in buffer
+ */
+void bsp_aes_ctr_encrypt( const uint8_t key[16], const uint8_t iv[16], uint32_t* buffer, uint16_t nb_blocks );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_BSP_AES_H__
@@ -76,7 +76,70 @@ extern "C" {
     #define BSP_DBG_TRACE_COLOR_DEFAULT ""
 #endif
 
-#if ( BSP_DBG_TRACE ) && !defined (PERF_TEST_ENABLED)
+#if ( BSP_DBG_TRACE ) && !defined( PERF_TEST_ENABLED ) && ( BSP_DBG_TRACE_DEFERRED == BSP_FEATURE_ON ) && \
+    !( UNIT_TEST_DBG )
+
+    // Number of arguments after the format string, up to 10
+    #define BSP_DBG_TRACE_NARGS_( _0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, N, ... ) N
+    #define BSP_DBG_TRACE_NARGS( ... )                                         \
+        BSP_DBG_TRACE_NARGS_( 0, ##__VA_ARGS__, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 )
+
+    // Each argument converted to 32 bits, the pointers keep their address
+    #define BSP_DBG_TRACE_ARG( a )           , ( uint32_t )( uintptr_t )( a )
+    #define BSP_DBG_TRACE_ARGS_0( )
+    #define BSP_DBG_TRACE_ARGS_1( a )        BSP_DBG_TRACE_ARG( a )
+    #define BSP_DBG_TRACE_ARGS_2( a, ... )   BSP_DBG_TRACE_ARG( a ) BSP_DBG_TRACE_ARGS_1( __VA_ARGS__ )
+    #define BSP_DBG_TRACE_ARGS_3( a, ... )   BSP_DBG_TRACE_ARG( a ) BSP_DBG_TRACE_ARGS_2( __VA_ARGS__ )
+    #define BSP_DBG_TRACE_ARGS_4( a, ... )   BSP_DBG_TRACE_ARG( a ) BSP_DBG_TRACE_ARGS_3( __VA_ARGS__ )
+    #define BSP_DBG_TRACE_ARGS_5( a, ... )   BSP_DBG_TRACE_ARG( a ) BSP_DBG_TRACE_ARGS_4( __VA_ARGS__ )
+    #define BSP_DBG_TRACE_ARGS_6( a, ... )   BSP_DBG_TRACE_ARG( a ) BSP_DBG_TRACE_ARGS_5( __VA_ARGS__ )
+    #define BSP_DBG_TRACE_ARGS_7( a, ... )   BSP_DBG_TRACE_ARG( a ) BSP_DBG_TRACE_ARGS_6( __VA_ARGS__ )
+    #define BSP_DBG_TRACE_ARGS_8( a, ... )   BSP_DBG_TRACE_ARG( a ) BSP_DBG_TRACE_ARGS_7( __VA_ARGS__ )
+    #define BSP_DBG_TRACE_ARGS_9( a, ... )   BSP_DBG_TRACE_ARG( a ) BSP_DBG_TRACE_ARGS_8( __VA_ARGS__ )
+    #define BSP_DBG_TRACE_ARGS_10( a, ... )  BSP_DBG_TRACE_ARG( a ) BSP_DBG_TRACE_ARGS_9( __VA_ARGS__ )
+    #define BSP_DBG_TRACE_ARGS_N_( n, ... )  BSP_DBG_TRACE_ARGS_##n( __VA_ARGS__ )
+    #define BSP_DBG_TRACE_ARGS_N( n, ... )   BSP_DBG_TRACE_ARGS_N_( n, __VA_ARGS__ )
+
+    // The format string is only kept in the ELF file, the record holds its offset in the .trace_fmt section
+    #define BSP_DBG_TRACE_LOG( fmt, ... )                                                                      \
+    do                                                                                                         \
+    {                                                                                                          \
+        static const char bsp_dbg_trace_fmt[] __attribute__( ( section( ".trace_fmt" ) ) ) = fmt;              \
+        const uint32_t    bsp_dbg_trace_args[] = {                                                             \
+            0 BSP_DBG_TRACE_ARGS_N( BSP_DBG_TRACE_NARGS( __VA_ARGS__ ), ##__VA_ARGS__ ) };                     \
+        bsp_trace_log( bsp_dbg_trace_fmt, BSP_DBG_TRACE_NARGS( __VA_ARGS__ ), &bsp_dbg_trace_args[1] );        \
+    } while( 0 )
+
+    #define BSP_DBG_TRACE_PRINTF( ... )  BSP_DBG_TRACE_LOG( __VA_ARGS__ )
+
+    // One record per trace, the host adds the colors from the level prefix
+    #define BSP_DBG_TRACE_MSG( msg )                    BSP_DBG_TRACE_LOG( msg )
+    #define BSP_DBG_TRACE_MSG_COLOR( msg, color )       BSP_DBG_TRACE_LOG( msg )
+    #define BSP_DBG_TRACE_INFO( ... )                   BSP_DBG_TRACE_LOG( "INFO : " __VA_ARGS__ )
+    #define BSP_DBG_TRACE_WARNING( ... )                BSP_DBG_TRACE_LOG( "WARN : " __VA_ARGS__ )
+    #define BSP_DBG_TRACE_ERROR( ... )                  BSP_DBG_TRACE_LOG( "ERROR: " __VA_ARGS__ )
+
+    #define BSP_DBG_TRACE_ARRAY( msg, array, len )                             \
+    do                                                                         \
+    {                                                                          \
+        BSP_DBG_TRACE_LOG( "%s - (%lu bytes):\n", msg, ( uint32_t )len );      \
+        for( uint32_t i = 0; i < ( uint32_t )len; i++ )                        \
+        {                                                                      \
+            BSP_DBG_TRACE_LOG( " %02X", array[i] );                            \
+        }                                                                      \
+        BSP_DBG_TRACE_LOG( "\n" );                                             \
+    } while ( 0 );
+
+    #define BSP_DBG_TRACE_PACKARRAY( msg, array, len )   \
+    do                                                   \
+    {                                                    \
+        for( uint32_t i = 0; i < ( uint32_t ) len; i++ ) \
+        {                                                \
+            BSP_DBG_TRACE_LOG( "%02X", array[i] );       \
+        }                                                \
+    } while( 0 );
+
+#elif ( BSP_DBG_TRACE ) && !defined (PERF_TEST_ENABLED)
 
     #if ( UNIT_TEST_DBG )
         #define BSP_DBG_TRACE_PRINTF( ... )  printf (  __VA_ARGS__ )
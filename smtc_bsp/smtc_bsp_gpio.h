@@ -90,6 +90,27 @@ typedef enum gpio_irq_mode_e
     BSP_GPIO_IRQ_MODE_RISING_FALLING = 3,
 } gpio_irq_mode_t;
 
+/*!
+ * GPIO states in STOP mode
+ */
+typedef enum gpio_sleep_state_e
+{
+    BSP_GPIO_SLEEP_ANALOG      = 0,  //!< analog, no input buffer nor pull: the lowest leakage
+    BSP_GPIO_SLEEP_OUTPUT_LOW  = 1,
+    BSP_GPIO_SLEEP_OUTPUT_HIGH = 2,
+    BSP_GPIO_SLEEP_PULL_UP     = 3,  //!< input with pull-up
+    BSP_GPIO_SLEEP_PULL_DOWN   = 4,  //!< input with pull-down
+} gpio_sleep_state_t;
+
+/*!
+ * State of a pin in STOP mode, see BSP_GPIO_SLEEP_TABLE
+ */
+typedef struct bsp_gpio_sleep_pin_s
+{
+    bsp_gpio_pin_names_t pin;
+    gpio_sleep_state_t   state;
+} bsp_gpio_sleep_pin_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -118,6 +139,8 @@ void bsp_gpio_init_out( const bsp_gpio_pin_names_t pin, const uint32_t value );
  * \param [in/out] irq       Pointer to IRQ data context.
  *                              NULL when BSP_GPIO_IRQ_MODE_OFF
  *                              pin parameter is initialized
+ *
+ * \remark Re-initializing with BSP_GPIO_IRQ_MODE_OFF a pin which had an IRQ attached releases its IRQ line
  */
 void bsp_gpio_init_in( const bsp_gpio_pin_names_t pin, const gpio_pull_mode_t pull_mode, const gpio_irq_mode_t irq_mode,
                        bsp_gpio_irq_t* irq );
@@ -178,6 +201,29 @@ uint32_t bsp_gpio_get_value( const bsp_gpio_pin_names_t pin );
  */
 bool bsp_gpio_is_pending_irq( void );
 
+/*!
+ * Sets the pin states applied in STOP mode
+ *
+ * \param [in] table Pin states, NC entries are ignored
+ * \param [in] nb    Number of entries in table
+ *
+ * \remark The table is turned into register masks once here, the pins it lists keep their run configuration
+ *         until bsp_gpio_sleep_enter
+ */
+void bsp_gpio_sleep_init( const bsp_gpio_sleep_pin_t* table, const uint8_t nb );
+
+/*!
+ * Applies the STOP mode pin states, the run configuration of these pins is saved
+ *
+ * \remark A few register writes per port, to be called with the interrupts disabled right before STOP
+ */
+void bsp_gpio_sleep_enter( void );
+
+/*!
+ * Restores the run configuration of the pins changed by bsp_gpio_sleep_enter
+ */
+void bsp_gpio_sleep_exit( void );
+
 #ifdef __cplusplus
 }
 #endif
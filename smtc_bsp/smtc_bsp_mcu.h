@@ -60,6 +60,19 @@ extern "C" {
  */
 #define CRITICAL_SECTION_END( ) bsp_mcu_critical_section_end( &mask )
 
+/*!
+ * Places a hot function in SRAM, copied from flash with the initialized data at startup
+ *
+ * \remark Running from SRAM avoids the flash wait states, the calls between flash and SRAM go
+ *         through the long branch veneers added by the linker. Enabled by the RAMFUNC build option,
+ *         the function stays in flash otherwise.
+ */
+#if defined( BSP_RAMFUNC_ENABLED )
+#define BSP_RAMFUNC __attribute__( ( section( ".ramfunc" ), noinline ) )
+#else
+#define BSP_RAMFUNC
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC CONSTANTS --------------------------------------------------------
@@ -70,6 +83,35 @@ extern "C" {
  * --- PUBLIC TYPES ------------------------------------------------------------
  */
 
+/*!
+ * Sources of the main loop wake-up requests, see \ref bsp_mcu_wakeup_request
+ */
+typedef enum bsp_mcu_wakeup_source_e
+{
+    BSP_MCU_WAKEUP_RADIO = 0x01,  // radio event, to be processed by the modem engine
+    BSP_MCU_WAKEUP_HOST  = 0x02,  // host interface activity, a command may have to be read
+    BSP_MCU_WAKEUP_APP   = 0x04,  // application event, to be processed by the modem engine
+} bsp_mcu_wakeup_source_t;
+
+/*!
+ * Time spent by the MCU in each power state since the start, both wrap after 49 days
+ */
+typedef struct bsp_mcu_power_stats_s
+{
+    uint32_t run_time_ms;   // core running or waiting, the UART and ADC activity happen in this state
+    uint32_t stop_time_ms;  // STOP mode, only the RTC and the wake-up sources are running
+    uint32_t wakeup_nb;     // exits from STOP mode, each one pays the clock and regulator restart
+} bsp_mcu_power_stats_t;
+
+/*!
+ * Stack usage measured on the stack painted at startup
+ */
+typedef struct bsp_mcu_stack_stats_s
+{
+    uint32_t size;      // RAM left to the stack between the heap reservation and the top of RAM [byte]
+    uint32_t used_max;  // deepest stack use since the start [byte]
+} bsp_mcu_stack_stats_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -119,6 +161,11 @@ void bsp_enable_irq( void );
  */
 void bsp_mcu_reset( void );
 
+/*!
+ * Returns true when the last reset was caused by a power on, a power down or a brownout
+ */
+bool bsp_mcu_is_reset_after_brownout( void );
+
 /*!
  * To be called in case of panic @mcu side
  */
@@ -159,6 +206,9 @@ void bsp_mcu_set_sleep_for_ms( const int32_t milliseconds );
 /*!
  * Waits for delay microseconds
  *
+ * \remark Counted by a hardware timer, independent of the system clock. Waits longer than about 100 us let the core
+ *         sleep until the end of the delay
+ *
  * \param [in] delay Delay to wait in microseconds
  */
 void bsp_mcu_wait_us( const int32_t microseconds );
@@ -166,7 +216,10 @@ void bsp_mcu_wait_us( const int32_t microseconds );
 /*!
  * Return the battery level
  *
- * \return battery level for lorawan stack
+ * \remark Does not wait for a measurement: the last one is used, a new one is started when it is older than the
+ *         sensors validity (see \ref bsp_mcu_sensors_refresh)
+ *
+ * \return battery level for lorawan stack [0: external power source, 1: empty to 254: full, 255: not able to measure]
  */
 uint8_t bsp_mcu_get_battery_level( void );
 
@@ -177,6 +230,29 @@ uint8_t bsp_mcu_get_battery_level( void );
  */
 void bsp_trace_print( const char* fmt, ... );
 
+/*!
+ * Logs a debug trace without formatting it, the record is sent later by \ref bsp_trace_flush
+ *
+ * \remark Interrupt safe, called by BSP_DBG_TRACE_PRINTF when BSP_DBG_TRACE_DEFERRED is on. Record format, little
+ *         endian: 0xA5, number of arguments (1 byte), format string offset in the ELF .trace_fmt section (4 bytes),
+ *         RTC ticks of 1/1024 s (4 bytes), then each argument (4 bytes). The string arguments are logged as their
+ *         address: only the constant strings can be resolved from the ELF. A record with the offset 0xFFFFFFFF
+ *         and one argument reports the number of records lost because the buffer was full.
+ *
+ * \param [IN] fmt     Format string, placed in the .trace_fmt section
+ * \param [IN] nb_args Number of arguments
+ * \param [IN] args    Arguments converted to 32 bits
+ */
+void bsp_trace_log( const char* fmt, uint8_t nb_args, const uint32_t* args );
+
+/*!
+ * Starts sending the deferred trace records
+ *
+ * \retval pending [true: records are being sent, the UART must stay clocked
+ *                  false: all the records have been sent]
+ */
+bool bsp_trace_flush( void );
+
 /*!
  * Suspend low power process and avoid looping on it
  */
@@ -192,13 +268,112 @@ void bsp_mcu_enable_low_power_wait( void );
  */
 void bsp_mcu_disable_once_low_power_wait( void );
 
+/*!
+ * Leaves the low power wait once and records the reason
+ *
+ * \remark Same as \ref bsp_mcu_disable_once_low_power_wait, the main loop reads the recorded sources with
+ *         \ref bsp_mcu_wakeup_sources_get to only run the processing they concern. Interrupt safe.
+ *
+ * \param [IN] sources Mask of \ref bsp_mcu_wakeup_source_t
+ */
+void bsp_mcu_wakeup_request( const uint8_t sources );
+
+/*!
+ * Gets and clears the sources of the wake-up requests made since the previous call
+ *
+ * \retval sources Mask of \ref bsp_mcu_wakeup_source_t
+ */
+uint8_t bsp_mcu_wakeup_sources_get( void );
+
+/*!
+ * Stop the core clock until an event or an interrupt gets pending
+ *
+ * \remark Unlike the low power wait, this returns on interrupts that cannot preempt the current context, so it
+ *         can be used from an interrupt handler. The caller is responsible for re-checking its wake-up condition.
+ */
+void bsp_mcu_wait_for_event( void );
+
+/*!
+ * Requests the execution of a callback from the lowest priority software interrupt
+ *
+ * \remark The callback runs once the interrupt handlers of higher priority have returned, but never inside a
+ *         \ref bsp_mcu_disable_periph_irq section: it is then postponed to \ref bsp_mcu_enable_periph_irq.
+ *         A single callback is registered, the last request wins.
+ *
+ * \param [IN] callback Function to execute
+ * \param [IN] context  Argument given to the callback
+ */
+void bsp_mcu_soft_irq_set( void ( *callback )( void* context ), void* context );
+
+/*!
+ * Requests the high performance clock for a compute heavy or time critical section
+ *
+ * \remark Requests are counted and can be nested, also from interrupt handlers. Switching the clock back down costs
+ *         as much as switching it up, so it is only done once the MCU goes to sleep with no request left.
+ *         Without BSP_MCU_CLOCK_SCALING the MCU always runs on the high performance clock.
+ */
+void bsp_mcu_clock_boost_request( void );
+
+/*!
+ * Ends a section started by \ref bsp_mcu_clock_boost_request
+ */
+void bsp_mcu_clock_boost_release( void );
+
+/*!
+ * Gets the time spent by the MCU in each power state
+ *
+ * \param [OUT] stats Run and STOP mode times and wake-ups since the start
+ */
+void bsp_mcu_get_power_stats( bsp_mcu_power_stats_t* stats );
+
+/*!
+ * Gets the stack high-water mark
+ *
+ * \remark The free stack is filled with a pattern by \ref bsp_mcu_init, the mark is the deepest word overwritten
+ *         since then. The RAM is scanned from the bottom of the stack at each call.
+ *
+ * \param [OUT] stats Stack size and deepest use
+ */
+void bsp_mcu_get_stack_stats( bsp_mcu_stack_stats_t* stats );
+
+/*!
+ * Gets a free running count of core clock cycles
+ *
+ * \remark Built on SysTick and the HAL millisecond tick, so it only counts while the core runs and the interrupts
+ *         are enabled. It wraps around after 2^32 cycles, the difference of two counts is valid below that.
+ *
+ * \retval Number of core clock cycles since the start
+ */
+uint32_t bsp_mcu_get_cycle_count( void );
+
+/*!
+ * Gets the core clock frequency
+ *
+ * \retval Frequency of the cycles counted by \ref bsp_mcu_get_cycle_count in Hz
+ */
+uint32_t bsp_mcu_get_core_clock_hz( void );
+
+/*!
+ * Start a background measurement of the MCU temperature and voltage if the cached one is getting old
+ *
+ * \remark Called ahead of the readings which must not wait, the device management uplinks
+ *
+ * \retval fresh [true: the cached values can be read right away
+ *                false: a measurement is ongoing, it ends within a few milliseconds]
+ */
+bool bsp_mcu_sensors_refresh( void );
+
 /*!
  * Return MCU temperature in celsius
+ *
+ * \remark The cached value is returned, a new measurement is waited for when it is getting old
  */
 int32_t bsp_mcu_get_mcu_temperature( void );
 
 /*!
  * Return mcu voltage (can be needed for dm uplink payload)
+ *
+ * \remark In 1/50 V. The cached value is returned, a new measurement is waited for when it is getting old
  */
 uint8_t bsp_mcu_get_mcu_voltage( void );
 
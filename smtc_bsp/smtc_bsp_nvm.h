@@ -89,6 +89,55 @@ int32_t bsp_nvm_context_restore( const uint32_t addr, uint8_t* buffer, const uin
  */
 int32_t bsp_nvm_context_store( const uint32_t addr, const uint8_t* buffer, const uint32_t size );
 
+/*!
+ * Reads the last value of a key from the nvm journal
+ *
+ *  \remark The journal is an append-only log of small records over two banks
+ *          of BSP_NVM_JOURNAL_BANK_SIZE bytes from BSP_NVM_JOURNAL_ADDR_OFFSET
+ *
+ *  \param key    Record key, from 1 to BSP_NVM_JOURNAL_KEY_MAX
+ *  \param buffer Buffer pointer to write to
+ *  \param size   Buffer size in bytes
+ *  \retval       Number of bytes read, negative error code if the key has no valid record
+ */
+int32_t bsp_nvm_journal_read( const uint8_t key, uint8_t* buffer, const uint8_t size );
+
+/*!
+ * Appends a new value of a key to the nvm journal
+ *
+ *  \remark Nothing is written when the value is unchanged. The last record of
+ *          each key is copied to the other bank when the active one is full
+ *
+ *  \param key    Record key, from 1 to BSP_NVM_JOURNAL_KEY_MAX
+ *  \param buffer Buffer pointer to write from
+ *  \param size   Buffer size to be written in bytes
+ *  \retval       Number of bytes written, negative error code on failure
+ */
+int32_t bsp_nvm_journal_write( const uint8_t key, const uint8_t* buffer, const uint8_t size );
+
+/*!
+ * Reads from the staging area receiving a firmware image
+ *  \remark The staging area is BSP_NVM_STAGING_SIZE bytes of program flash
+ *          from BSP_NVM_STAGING_ADDR, kept out of the firmware by the linker,
+ *          none when BSP_NVM_STAGING_ENABLED is not defined
+ *  \param offset Offset in the staging area to begin reading from
+ *  \param buffer Buffer pointer to write to
+ *  \param size   Buffer size to read in bytes
+ *  \retval       0 on success, negative error code on failure
+ */
+int32_t bsp_nvm_staging_read( const uint32_t offset, uint8_t* buffer, const uint32_t size );
+
+/*!
+ * Writes to the staging area receiving a firmware image
+ *  \remark Any offset can be rewritten, the flash pages whose programmed
+ *          words change are erased and programmed again
+ *  \param offset Offset in the staging area to begin writing to
+ *  \param buffer Buffer pointer to write from
+ *  \param size   Buffer size to be written in bytes
+ *  \retval       0 on success, negative error code on failure
+ */
+int32_t bsp_nvm_staging_write( const uint32_t offset, const uint8_t* buffer, const uint32_t size );
+
 #ifdef __cplusplus
 }
 #endif
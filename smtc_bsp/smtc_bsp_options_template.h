@@ -44,24 +44,59 @@ extern "C" {
 #define BSP_DBG_TRACE                               BSP_FEATURE_ON
 #define BSP_DBG_TRACE_COLOR                         BSP_FEATURE_ON
 #define BSP_DBG_TRACE_RP                            BSP_FEATURE_OFF
+
+// BSP_FEATURE_ON to log the format string address and the raw arguments, drained by DMA when the MCU is idle and
+// decoded on the host with the ELF file (see bsp_trace_log)
+#define BSP_DBG_TRACE_DEFERRED                      BSP_FEATURE_OFF
+#define BSP_DBG_TRACE_DEFERRED_BUFFER_SIZE          1024
 #define BSP_DBG_TRACE_STORAGE                       BSP_FEATURE_OFF
 
 // BSP_FEATURE_ON to activate sleep mode
 // BSP_FEATURE_OFF to replace by wait functions (easier in debug mode)
 #define BSP_LOW_POWER_MODE                          BSP_FEATURE_OFF
 
+// BSP_FEATURE_ON to run on a low clock when awake, the high one being only started for the sections requesting it
+// (see bsp_mcu_clock_boost_request)
+#define BSP_MCU_CLOCK_SCALING                       BSP_FEATURE_OFF
+
+// Supply voltage of an empty and of a full battery, mapped to the LoRaWAN battery level [1: empty, 254: full]. The
+// MCU is supplied straight from the battery: the level follows VDD, measured by the ADC sensors scan
+#define BSP_BATTERY_EMPTY_MV                        2200
+#define BSP_BATTERY_FULL_MV                         3000
+
 // BSP_FEATURE_ON to enable debug probe, not disallocating corresponding pins
 #define BSP_HW_DEBUG_PROBE                          BSP_FEATURE_ON
 
+// Pin states in STOP mode, { pin, gpio_sleep_state_t } entries applied on STOP entry and restored on wake up. Keep
+// the wake-up lines, the radio NSS and the lines used by the radio while it receives out of the table
+#define BSP_GPIO_SLEEP_TABLE                        { NC, BSP_GPIO_SLEEP_ANALOG }
+
 #define BSP_USE_DBG_PINS                            BSP_FEATURE_ON
 
 #define BSP_USE_USER_UART                           BSP_FEATURE_OFF
 #define BSP_USER_UART_ID                            1
 
+// BSP_FEATURE_ON for the host to talk to the modem as a SPI master, in place of the user UART
+#define BSP_USE_HOST_SPI                            BSP_FEATURE_OFF
+#define BSP_HOST_SPI_ID                             2
+
+// BSP_FEATURE_ON for the user UART to be the low power UART, which wakes the MCU up from stop mode on a start bit
+#define BSP_USER_UART_LPUART                        BSP_FEATURE_OFF
+
 #define BSP_USE_PRINTF_UART                         BSP_FEATURE_ON
 #define BSP_PRINTF_UART_ID                          2
 
 #define BSP_RADIO_SPI_ID                            1
+// Highest radio SPI clock, the prescaler is chosen for the fastest system clock (SX1280: 18 MHz)
+#define BSP_RADIO_SPI_MAX_CLOCK_HZ                  18000000
+
+// NVIC priorities [0: highest, 3: lowest] of the interrupt sources. The radio DIO, BUSY and timer handlers wait for
+// the SPI DMA completion interrupt running at priority 0, they must not be above 1. EXTI lines 4 to 15 share one
+// interrupt: its lines are served in ascending order, the radio DIO (line 4) before the host COMMAND pin (line 5)
+#define BSP_EXTI0_1_IRQ_PRIORITY                    3
+#define BSP_EXTI2_3_IRQ_PRIORITY                    1
+#define BSP_EXTI4_15_IRQ_PRIORITY                   1
+#define BSP_LPTIM_IRQ_PRIORITY                      2
 
 /*!
  * Watchdog counter reload value
@@ -70,6 +105,14 @@ extern "C" {
  */
 #define BSP_WATCHDOG_RELOAD_PERIOD_SECONDS          20
 
+// BSP_FEATURE_ON to reload the watchdog and go back to stop mode straight from the RTC wakeup during long sleeps,
+// without restarting the clocks and the peripherals at every reload period
+#define BSP_WATCHDOG_RELOAD_IN_STOP                 BSP_FEATURE_ON
+
+// BSP_FEATURE_ON to shorten the time to the first uplink after a reset: no version banner, the ADC is started on
+// the first sensor reading and the radio reset ends as soon as the radio is ready
+#define BSP_FAST_BOOT                               BSP_FEATURE_OFF
+
 // clang-format on
 
 #ifdef __cplusplus
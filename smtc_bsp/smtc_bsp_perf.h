@@ -0,0 +1,267 @@
+/*!
+ * \file      smtc_bsp_perf.h
+ *
+ * \brief     Board specific package performance test event registry API definition.
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __SMTC_BSP_PERF_H__
+#define __SMTC_BSP_PERF_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Records an event in the perf test registry, compiled out of the other builds
+ */
+#if defined( PERF_TEST_ENABLED )
+#define BSP_PERF_EVENT( event, arg ) bsp_perf_event( event, arg )
+#else
+#define BSP_PERF_EVENT( event, arg )
+#endif
+
+/*!
+ * Interrupt monitor hooks of the handlers and of the critical section, compiled out of the other builds
+ */
+#if defined( PERF_TEST_ENABLED )
+#define BSP_PERF_IRQ_ENTER( source ) bsp_perf_irq_enter( source )
+#define BSP_PERF_IRQ_EXIT( source ) bsp_perf_irq_exit( source )
+#define BSP_PERF_CRITICAL_BEGIN( caller ) bsp_perf_critical_begin( caller )
+#define BSP_PERF_CRITICAL_END( ) bsp_perf_critical_end( )
+#else
+#define BSP_PERF_IRQ_ENTER( source )
+#define BSP_PERF_IRQ_EXIT( source )
+#define BSP_PERF_CRITICAL_BEGIN( caller )
+#define BSP_PERF_CRITICAL_END( )
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*!
+ * Number of records kept until the host dumps them, must be a power of 2
+ */
+#define BSP_PERF_RECORD_NB 64
+
+/*!
+ * Number of buckets of the latency histograms: bucket 0 counts the 0 tick latencies, bucket n the latencies from
+ * 2^(n-1) to 2^n - 1 ticks, the last one everything above
+ */
+#define BSP_PERF_LATENCY_BUCKET_NB 12
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Perf test events, the values are part of the host dump format
+ */
+typedef enum bsp_perf_event_e
+{
+    BSP_PERF_EVENT_HOST_CMD    = 0x00,  // arg: host command code
+    BSP_PERF_EVENT_TX_ENQUEUED = 0x01,  // arg: application port
+    BSP_PERF_EVENT_TX_START    = 0x02,  // arg: radio planner hook
+    BSP_PERF_EVENT_TX_DONE     = 0x03,  // arg: radio planner hook
+    BSP_PERF_EVENT_RX_OPEN     = 0x04,  // arg: radio planner hook
+    BSP_PERF_EVENT_RX_DONE     = 0x05,  // arg: radio planner hook
+    BSP_PERF_EVENT_RX_TIMEOUT  = 0x06,  // arg: radio planner hook, timeout, header or crc error
+    BSP_PERF_EVENT_SEND_LAUNCH = 0x07,  // arg: application port, the supervisor gives the uplink to the stack
+    BSP_PERF_EVENT_MAC_TX      = 0x08,  // arg: 0, the stack enqueues the radio task
+    BSP_PERF_EVENT_TX_LAUNCH   = 0x09,  // arg: radio planner hook, the radio is configured
+    BSP_PERF_EVENT_RADIO_IRQ   = 0x0A,  // arg: radio planner hook, top half of the radio irq
+    BSP_PERF_EVENT_TX_EVENT    = 0x0B,  // arg: 0, the host TXDONE event is raised
+    BSP_PERF_EVENT_BOOT        = 0x0C,  // arg: boot stage reached, see bsp_perf_boot_stage_t
+    BSP_PERF_EVENT_NB
+} bsp_perf_event_t;
+
+/*!
+ * Boot stages recorded by BSP_PERF_EVENT_BOOT, the first uplink is then timed by its TX_START record
+ */
+typedef enum bsp_perf_boot_stage_e
+{
+    BSP_PERF_BOOT_MCU_INIT     = 0x00,  // clocks, peripherals and RTC are up
+    BSP_PERF_BOOT_MODEM_INIT   = 0x01,  // radio reset, stack contexts loaded
+    BSP_PERF_BOOT_FIRST_ENGINE = 0x02,  // first run of the modem engine done
+} bsp_perf_boot_stage_t;
+
+/*!
+ * Stages of an uplink requested by the host, each one is measured between two consecutive events of the chain
+ * HOST_CMD, TX_ENQUEUED, SEND_LAUNCH, MAC_TX, TX_LAUNCH, TX_START, RADIO_IRQ, TX_DONE and TX_EVENT
+ */
+typedef enum bsp_perf_latency_stage_e
+{
+    BSP_PERF_LATENCY_HOST_TO_ENQUEUE = 0x00,  // host command parsing and checks
+    BSP_PERF_LATENCY_ENQUEUE_TO_SEND = 0x01,  // supervisor scheduling
+    BSP_PERF_LATENCY_SEND_TO_MAC     = 0x02,  // frame build and encryption
+    BSP_PERF_LATENCY_MAC_TO_LAUNCH   = 0x03,  // radio planner arbitration and start delay
+    BSP_PERF_LATENCY_LAUNCH_TO_TX    = 0x04,  // radio configuration
+    BSP_PERF_LATENCY_TX_TO_IRQ       = 0x05,  // time on air
+    BSP_PERF_LATENCY_IRQ_TO_DONE     = 0x06,  // irq bottom half
+    BSP_PERF_LATENCY_DONE_TO_EVENT   = 0x07,  // receive windows and event signalling
+    BSP_PERF_LATENCY_STAGE_NB
+} bsp_perf_latency_stage_t;
+
+/*!
+ * Interrupt sources watched by the interrupt monitor, the values are part of the host dump format
+ */
+typedef enum bsp_perf_irq_source_e
+{
+    BSP_PERF_IRQ_RADIO_DIO = 0x00,  // EXTI line group of the radio DIO
+    BSP_PERF_IRQ_LPTIM     = 0x01,  // LPTIM timeout of the BSP timer
+    BSP_PERF_IRQ_UART_DMA  = 0x02,  // DMA channels of the UARTs
+    BSP_PERF_IRQ_SOURCE_NB
+} bsp_perf_irq_source_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Clears the counters and the records
+ */
+void bsp_perf_init( void );
+
+/*!
+ * Counts an event and records it with its RTC timestamp
+ *
+ * \remark Interrupt safe and print free so that it can be called from the radio irq without changing its timing.
+ *         The event is only counted when the record buffer is full. The latency histograms are updated when the
+ *         event follows the previous one of the uplink chain.
+ *
+ * \param [IN] event Event identifier
+ * \param [IN] arg   Event argument
+ */
+void bsp_perf_event( bsp_perf_event_t event, uint8_t arg );
+
+/*!
+ * Serializes the counters and moves the oldest records to buffer
+ *
+ * \remark Big endian format:
+ *         - number of counters (1 byte), then each event counter (4 bytes)
+ *         - records lost since the previous dump because the buffer was full (2 bytes)
+ *         - number of records in this dump (1 byte), then each record: event (1 byte), arg (1 byte) and
+ *           timestamp in RTC ticks of 1/1024 s (4 bytes)
+ *         Records that do not fit in max_length stay in the buffer for the next dump.
+ *
+ * \param [OUT] buffer     Dump destination
+ * \param [IN]  max_length Size of buffer
+ *
+ * \retval Number of bytes written to buffer
+ */
+uint8_t bsp_perf_dump( uint8_t* buffer, uint8_t max_length );
+
+/*!
+ * Serializes and clears the latency histograms
+ *
+ * \remark Big endian format: number of stages (1 byte), number of buckets (1 byte), then for each stage the count of
+ *         each bucket (2 bytes, saturated). The latencies are in RTC ticks of 1/1024 s.
+ *
+ * \param [OUT] buffer     Dump destination
+ * \param [IN]  max_length Size of buffer
+ *
+ * \retval Number of bytes written to buffer, 0 if max_length is too small
+ */
+uint8_t bsp_perf_latency_dump( uint8_t* buffer, uint8_t max_length );
+
+/*!
+ * Marks the entry of a watched interrupt handler
+ *
+ * \remark The entry latency is the longest critical section or handler the interrupt stayed pending through, an
+ *         upper bound of the time it waited for the CPU. The wake up from stop mode is not part of it.
+ *
+ * \param [IN] source Interrupt source, first statement of its handler
+ */
+void bsp_perf_irq_enter( bsp_perf_irq_source_t source );
+
+/*!
+ * Marks the exit of a watched interrupt handler
+ *
+ * \remark The duration includes the handlers of a higher priority that preempted it.
+ *
+ * \param [IN] source Interrupt source, last statement of its handler
+ */
+void bsp_perf_irq_exit( bsp_perf_irq_source_t source );
+
+/*!
+ * Marks the start of the outermost critical section
+ *
+ * \remark Called with the interrupts disabled, the nested sections are part of the outermost one.
+ *
+ * \param [IN] caller Code address of the section, reported with the longest one
+ */
+void bsp_perf_critical_begin( uint32_t caller );
+
+/*!
+ * Marks the end of the outermost critical section, called before the interrupts are enabled again
+ */
+void bsp_perf_critical_end( void );
+
+/*!
+ * Gets the watched interrupts waiting for the CPU, provided by the MCU specific part of the BSP
+ *
+ * \retval Bit mask of the pending sources, bit n for the source n of \ref bsp_perf_irq_source_t
+ */
+uint32_t bsp_perf_irq_get_pending( void );
+
+/*!
+ * Serializes and clears the interrupt monitor
+ *
+ * \remark Big endian format, the times are in microseconds:
+ *         - number of sources (1 byte), number of buckets (1 byte)
+ *         - for each source: longest entry latency (4 bytes), longest handler duration (4 bytes), then the count of
+ *           each bucket of the entry latency histogram (2 bytes, saturated), same buckets as the uplink latencies
+ *         - longest critical section (4 bytes) and the code address of its CRITICAL_SECTION_BEGIN (4 bytes)
+ *         A duration over which the core clock changed is not measured.
+ *
+ * \param [OUT] buffer     Dump destination
+ * \param [IN]  max_length Size of buffer
+ *
+ * \retval Number of bytes written to buffer, 0 if max_length is too small
+ */
+uint8_t bsp_perf_irq_dump( uint8_t* buffer, uint8_t max_length );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __SMTC_BSP_PERF_H__
@@ -67,6 +67,9 @@ extern "C" {
 /*!
  * Returns an hardware generated random number.
  *
+ * \remark Taken from a small pool the peripheral refills under interrupt, the peripheral is only clocked while
+ *         refilling. Once the pool is used up the call waits for the next number
+ *
  * \retval random Generated radom number
  */
 uint32_t bsp_rng_get_random( void );
@@ -77,6 +80,8 @@ uint32_t bsp_rng_get_random( void );
  * \param [IN] val_1 first range unsigned value
  * \param [IN] val_2 second range unsigned value
  *
+ * \remark Uniform over the range, draws that would bias it are rejected
+ *
  * \retval random Generated random unsigned number between smallest value and biggest
  * value between val_1 and val_2
  */
@@ -42,6 +42,17 @@ extern "C" {
  */
 void bsp_rtc_init( void );
 
+/*!
+ * Returns the current RTC time in ticks of 1/1024 s
+ *
+ * \remark Monotonic timestamp read straight from the RTC registers, the
+ *         calendar conversion is only done when the date changes. All the
+ *         other time getters are derived from it.
+ *
+ * retval rtc_ticks Current RTC time in ticks, doesn't wrap
+ */
+uint64_t bsp_rtc_get_ticks( void );
+
 /*!
  * Returns the current RTC time in seconds
  *
@@ -64,6 +75,25 @@ uint32_t bsp_rtc_get_time_s( void );
  */
 uint32_t bsp_rtc_get_time_ms( void );
 
+/*!
+ * Returns the current RTC time in milliseconds on 64 bits
+ *
+ * \remark Used for the modem task deadlines, its low 32 bits are the bsp_rtc_get_time_ms value
+ *
+ * retval rtc_time_ms Current RTC time in milliseconds, doesn't wrap
+ */
+uint64_t bsp_rtc_get_time_ms64( void );
+
+/*!
+ * Returns the current RTC time in microseconds
+ *
+ * \remark Used to timestamp the radio IRQs: its resolution is the RTC tick, not
+ *         truncated to the millisecond as the other getters are
+ *
+ * retval rtc_time_us Current RTC time in microseconds, doesn't wrap
+ */
+uint64_t bsp_rtc_get_time_us( void );
+
 /*!
  * Waits delay milliseconds by polling RTC
  *
@@ -87,6 +117,16 @@ void bsp_rtc_wakeup_timer_set_s( const int32_t seconds );
  */
 void bsp_rtc_wakeup_timer_set_ms( const int32_t milliseconds );
 
+/*!
+ * Clears the wakeup timer event, the RTC interrupt is not serviced
+ *
+ * \remark Used when leaving stop mode with the interrupts disabled, to go back to sleep at once
+ *
+ * \retval elapsed [true: the wakeup timer has elapsed
+ *                  false: the wakeup timer is still running]
+ */
+bool bsp_rtc_wakeup_timer_clear_event( void );
+
 #ifdef __cplusplus
 }
 #endif
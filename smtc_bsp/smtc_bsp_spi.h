@@ -57,6 +57,15 @@ extern "C" {
  * --- PUBLIC TYPES ------------------------------------------------------------
  */
 
+/*!
+ * SPI DMA transfer completion data context
+ */
+typedef struct bsp_spi_irq_s
+{
+    void* context;
+    void ( *callback )( void* context );
+} bsp_spi_irq_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -80,6 +89,34 @@ void bsp_spi_init( const uint32_t id, const bsp_gpio_pin_names_t mosi, const bsp
  */
 void bsp_spi_deinit( const uint32_t id );
 
+/*!
+ * Gates the SPI peripheral clock and puts its pins in analog mode before entering stop mode
+ *
+ * \remark The peripheral registers are kept, \ref bsp_spi_resume makes it usable again without a new
+ *         initialization
+ *
+ * \param [IN] id   SPI interface id [1:N]
+ */
+void bsp_spi_suspend( const uint32_t id );
+
+/*!
+ * Ungates the SPI peripheral clock and gives its pins back to the peripheral after a \ref bsp_spi_suspend
+ *
+ * \param [IN] id   SPI interface id [1:N]
+ */
+void bsp_spi_resume( const uint32_t id );
+
+/*!
+ * Sets the fastest SPI clock not above the given frequency
+ *
+ * \remark The prescaler is computed for the high performance system clock, the SPI clock only gets slower when the
+ *         MCU runs on its low clock
+ *
+ * \param [IN] id           SPI interface id [1:N]
+ * \param [IN] max_clock_hz Highest SPI clock supported by the device
+ */
+void bsp_spi_set_clock( const uint32_t id, const uint32_t max_clock_hz );
+
 /*!
  * Sends out_data and receives in_data
  *
@@ -90,6 +127,71 @@ void bsp_spi_deinit( const uint32_t id );
  */
 uint16_t bsp_spi_in_out( const uint32_t id, const uint16_t out_data );
 
+/*!
+ * Sends and receives a burst of bytes by polling, the next byte is written while the previous one is shifted
+ *
+ * \remark Interrupts are masked during the transfer, a late read would overrun the receive buffer. Long transfers
+ *         should use \ref bsp_spi_transfer_dma.
+ *
+ * \param [IN] id       SPI interface id [1:N]
+ * \param [IN] out_data Buffer to be sent, if NULL zeros are sent
+ * \param [IN] in_data  Buffer receiving the read bytes, if NULL the read bytes are dropped
+ * \param [IN] size     Number of bytes to be transferred
+ */
+void bsp_spi_transfer( const uint32_t id, const uint8_t* out_data, uint8_t* in_data, const uint16_t size );
+
+/*!
+ * Starts a DMA transfer, the callback is called from the DMA interrupt once the transfer is done
+ *
+ * \remark When no DMA channel is available for the interface the transfer is done by polling, interrupts masked as
+ *         \ref bsp_spi_transfer. The callback is then synchronous: it is called before returning, in the context of
+ *         the caller, an interrupt included. The callers must be ready for both cases, i.e. arm their completion
+ *         state before the call.
+ *
+ * \param [IN] id       SPI interface id [1:N]
+ * \param [IN] out_data Buffer to be sent, if NULL zeros are sent
+ * \param [IN] in_data  Buffer receiving the read bytes, if NULL the read bytes are dropped
+ * \param [IN] size     Number of bytes to be transferred
+ * \param [IN] irq      Transfer completion callback
+ */
+void bsp_spi_transfer_dma( const uint32_t id, const uint8_t* out_data, uint8_t* in_data, const uint16_t size,
+                           const bsp_spi_irq_t* irq );
+
+/*!
+ * Initializes the MCU SPI peripheral as a slave clocked by an external master
+ *
+ * \remark The slave select pin is not used, the transfers are framed by the caller with
+ *         \ref bsp_spi_slave_dma_start and \ref bsp_spi_slave_dma_stop
+ *
+ * \param [IN] id   SPI interface id [1:N]
+ * \param [IN] mosi SPI MOSI pin name to be used
+ * \param [IN] miso SPI MISO pin name to be used
+ * \param [IN] sclk SPI SCLK pin name to be used
+ */
+void bsp_spi_slave_init( const uint32_t id, const bsp_gpio_pin_names_t mosi, const bsp_gpio_pin_names_t miso,
+                         const bsp_gpio_pin_names_t sclk );
+
+/*!
+ * Arms a DMA transfer clocked by the master, the bytes move without the CPU until \ref bsp_spi_slave_dma_stop
+ *
+ * \remark The MCU must not enter stop mode while a transfer is armed
+ *
+ * \param [IN] id       SPI interface id [1:N]
+ * \param [IN] out_data Buffer to be sent, if NULL zeros are sent
+ * \param [IN] in_data  Buffer receiving the read bytes, if NULL the read bytes are dropped
+ * \param [IN] size     Highest number of bytes to be transferred, the bytes clocked beyond are dropped
+ */
+void bsp_spi_slave_dma_start( const uint32_t id, const uint8_t* out_data, uint8_t* in_data, const uint16_t size );
+
+/*!
+ * Stops the armed DMA transfer, the byte loaded for the next master clock is dropped
+ *
+ * \param [IN] id       SPI interface id [1:N]
+ *
+ * \retval received     Number of bytes written in in_data
+ */
+uint16_t bsp_spi_slave_dma_stop( const uint32_t id );
+
 #ifdef __cplusplus
 }
 #endif
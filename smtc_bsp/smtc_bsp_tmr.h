@@ -67,6 +67,20 @@ typedef struct bsp_tmr_irq_s
     void ( *callback )( void* context );
 } bsp_tmr_irq_t;
 
+/*!
+ * Software timer, the software timers share the hardware timer through \ref bsp_soft_tmr_start
+ *
+ * \remark The callback and the context are set by the owner, the other fields belong to the service
+ */
+typedef struct bsp_soft_tmr_s
+{
+    struct bsp_soft_tmr_s* next;         // next armed timer by deadline
+    uint32_t               deadline_ms;  // RTC time of the expiry
+    bool                   is_armed;
+    void*                  context;
+    void ( *callback )( void* context );
+} bsp_soft_tmr_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -80,6 +94,8 @@ void bsp_tmr_init( void );
 /*!
  * Starts the provided timer objet for the given time
  *
+ * \remark Delays longer than the hardware timer range are chained, the callback is called once at the end
+ *
  * \param [in] milliseconds Number of milliseconds
  * \param [in] tmr_irq      Timer IRQ handling data ontext
  */
@@ -99,6 +115,38 @@ void bsp_tmr_stop( void );
  */
 uint32_t bsp_tmr_get_time_ms( void );
 
+/*!
+ * Starts a software timer, a timer already armed is moved to its new deadline
+ *
+ * \remark The armed timers are kept sorted by deadline and the hardware timer is programmed on the first one, the
+ *         delays are counted on the RTC time. The callbacks run from the timer interrupt, in deadline order.
+ *
+ * \param [in] tmr          Software timer, its callback must be set
+ * \param [in] milliseconds Delay before the callback [ms]
+ */
+void bsp_soft_tmr_start( bsp_soft_tmr_t* tmr, const uint32_t milliseconds );
+
+/*!
+ * Stops a software timer, nothing is done if it is not armed
+ *
+ * \param [in] tmr Software timer
+ */
+void bsp_soft_tmr_stop( bsp_soft_tmr_t* tmr );
+
+/*!
+ * Returns true while a software timer waits for its deadline
+ *
+ * \param [in] tmr Software timer
+ */
+bool bsp_soft_tmr_is_armed( const bsp_soft_tmr_t* tmr );
+
+/*!
+ * Returns the delay before the nearest software timer deadline
+ *
+ * \retval delay_ms Delay before the first callback [ms], 0 if it is due and UINT32_MAX if no timer is armed
+ */
+uint32_t bsp_soft_tmr_get_next_ms( void );
+
 /*!
  * Enables timer interrupts (HW timer only)
  */
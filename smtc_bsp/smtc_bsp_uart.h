@@ -58,6 +58,15 @@ extern "C" {
  * --- PUBLIC TYPES ------------------------------------------------------------
  */
 
+/*!
+ * UART DMA transmission completion data context
+ */
+typedef struct bsp_uart_irq_s
+{
+    void* context;
+    void ( *callback )( void* context );
+} bsp_uart_irq_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -66,15 +75,104 @@ extern "C" {
 void bsp_uart1_init( void );
 void bsp_uart2_init( void );
 
+/*!
+ * Change UART1 baud rate
+ *
+ * \remark The UART is re-initialized: any ongoing transfer is aborted and the reception has to be started again
+ *
+ * \param [IN] baudrate New baud rate, kept until the next change
+ */
+void bsp_uart1_set_baudrate( const uint32_t baudrate );
+
 void bsp_uart1_deinit( void );
 void bsp_uart2_deinit( void );
 
+/*!
+ * Gate UART1 clock and put its pins in analog mode before entering stop mode
+ *
+ * \remark The peripheral and DMA registers are kept, \ref bsp_uart1_resume makes the UART usable again without a
+ *         new initialization
+ */
+void bsp_uart1_suspend( void );
+
+/*!
+ * Give UART1 its clock and pins back after a \ref bsp_uart1_suspend
+ */
+void bsp_uart1_resume( void );
+
+/*!
+ * Gate UART2 clock and put its pins in analog mode before entering stop mode
+ *
+ * \remark UART2 is only used for traces: it is resumed by the next \ref bsp_uart2_tx or \ref bsp_uart2_dma_tx
+ */
+void bsp_uart2_suspend( void );
+
 void bsp_uart1_dma_start_rx( uint8_t* buff, uint16_t size );
 void bsp_uart1_dma_stop_rx( void );
 
+/*!
+ * Start a never ending DMA reception on UART1, the buffer being used as a ring
+ *
+ * \remark The callback is called from interrupt when the RX line gets idle and each time half of the ring has
+ *         been filled. The reception is stopped by \ref bsp_uart1_dma_stop_rx
+ *
+ * \param [IN] buff Ring buffer
+ * \param [IN] size Ring buffer size
+ * \param [IN] irq  Reception event callback
+ */
+void bsp_uart1_dma_start_rx_circular( uint8_t* buff, uint16_t size, const bsp_uart_irq_t* irq );
+
+/*!
+ * Get the position in the ring where the DMA will write the next received byte
+ *
+ * \retval index Write index [0:size-1]
+ */
+uint16_t bsp_uart1_dma_get_rx_index( void );
+
+/*!
+ * Indicates if the UART1 circular DMA reception is running
+ *
+ * \remark The reception is stopped by \ref bsp_uart1_deinit and \ref bsp_uart1_set_baudrate, it goes on across
+ *         stop mode
+ *
+ * \retval running [true: the ring is being filled
+ *                  false: the reception has to be started again]
+ */
+bool bsp_uart1_dma_is_rx_circular_running( void );
+
 void bsp_uart1_tx( uint8_t* buff, uint8_t len );
+
+/*!
+ * Start a DMA transmission on UART1 and return right away
+ *
+ * \remark buff must stay untouched until the completion callback is called, once the last byte has left the UART
+ *
+ * \param [IN] buff Buffer to be sent
+ * \param [IN] len  Number of bytes to be sent
+ * \param [IN] irq  Transmission completion callback
+ */
+void bsp_uart1_dma_tx( uint8_t* buff, uint16_t len, const bsp_uart_irq_t* irq );
 void bsp_uart2_tx( uint8_t* buff, uint8_t len );
 
+/*!
+ * Start a DMA transmission on UART2 and return right away
+ *
+ * \remark buff must stay untouched until the completion callback is called, once the last byte has left the UART.
+ *         The MCU must not enter stop mode before, the UART is suspended there.
+ *
+ * \param [IN] buff Buffer to be sent
+ * \param [IN] len  Number of bytes to be sent
+ * \param [IN] irq  Transmission completion callback
+ */
+void bsp_uart2_dma_tx( uint8_t* buff, uint16_t len, const bsp_uart_irq_t* irq );
+
+/*!
+ * Serve the UART1 interrupt when UART1 is the low power UART (see BSP_USER_UART_LPUART)
+ *
+ * \remark The low power UART shares its interrupt line with the RNG, whose handler calls this function
+ */
+void bsp_uart1_lpuart_irq_handler( void );
+
 #ifdef __cplusplus
 }
 #endif
@@ -55,6 +55,13 @@
 #  define USE_TABLES
 #endif
 
+/* define AES_T_TABLES (make AES_TTABLE=1) to merge the byte substitution and the
+   mix columns in four 1 KB tables of 32-bit words: several times faster per block
+   than the byte tables, for 4 KB more flash */
+#if defined( AES_T_TABLES ) && !defined( USE_TABLES )
+#  error "AES_T_TABLES needs USE_TABLES"
+#endif
+
 /*  On Intel Core 2 duo VERSION_1 is faster */
 
 /* alternative versions (test for performance on your system) */
@@ -63,6 +70,7 @@
 #endif
 
 #include "aes.h"
+#include "smtc_bsp_mcu.h"
 
 //#if defined( HAVE_UINT_32T )
 //  typedef unsigned long uint32_t;
@@ -197,8 +205,21 @@ static const uint8_t sbox[256]  =  sb_data(f1);
 static const uint8_t isbox[256] = isb_data(f1);
 #endif
 
+#if defined( AES_T_TABLES )
+/* column of the mix columns output for one substituted input byte, as a little endian word */
+#define t0_w(x) ((uint32_t)f2(x) | ((uint32_t)(x) << 8) | ((uint32_t)(x) << 16) | ((uint32_t)f3(x) << 24))
+#define t1_w(x) ((uint32_t)f3(x) | ((uint32_t)f2(x) << 8) | ((uint32_t)(x) << 16) | ((uint32_t)(x) << 24))
+#define t2_w(x) ((uint32_t)(x) | ((uint32_t)f3(x) << 8) | ((uint32_t)f2(x) << 16) | ((uint32_t)(x) << 24))
+#define t3_w(x) ((uint32_t)(x) | ((uint32_t)(x) << 8) | ((uint32_t)f3(x) << 16) | ((uint32_t)f2(x) << 24))
+
+static const uint32_t t_table0[256] = sb_data(t0_w);
+static const uint32_t t_table1[256] = sb_data(t1_w);
+static const uint32_t t_table2[256] = sb_data(t2_w);
+static const uint32_t t_table3[256] = sb_data(t3_w);
+#else
 static const uint8_t gfm2_sbox[256] = sb_data(f2);
 static const uint8_t gfm3_sbox[256] = sb_data(f3);
+#endif
 
 #if defined( AES_DEC_PREKEYED )
 static const uint8_t gfmul_9[256] = mm_data(f9);
@@ -408,7 +429,7 @@ static void add_round_key( uint8_t d[N_BLOCK], const uint8_t k[N_BLOCK] )
     xor_block(d, k);
 }
 
-static void shift_sub_rows( uint8_t st[N_BLOCK] )
+BSP_RAMFUNC static void shift_sub_rows( uint8_t st[N_BLOCK] )
 {   uint8_t tt;
 
     st[ 0] = s_box(st[ 0]); st[ 4] = s_box(st[ 4]);
@@ -445,13 +466,28 @@ static void inv_shift_sub_rows( uint8_t st[N_BLOCK] )
 #endif
 
 #if defined( VERSION_1 )
-  static void mix_sub_columns( uint8_t dt[N_BLOCK] )
+  BSP_RAMFUNC static void mix_sub_columns( uint8_t dt[N_BLOCK] )
   { uint8_t st[N_BLOCK];
     block_copy(st, dt);
 #else
-  static void mix_sub_columns( uint8_t dt[N_BLOCK], uint8_t st[N_BLOCK] )
+  BSP_RAMFUNC static void mix_sub_columns( uint8_t dt[N_BLOCK], uint8_t st[N_BLOCK] )
   {
 #endif
+#if defined( AES_T_TABLES )
+    uint8_t  cc;
+    uint32_t w;
+
+    /* the shift rows picks the bytes of the column on the diagonal */
+    for( cc = 0; cc < N_BLOCK; cc += 4 )
+    {
+        w = t_table0[st[cc]] ^ t_table1[st[(cc + 5) & 15]] ^
+            t_table2[st[(cc + 10) & 15]] ^ t_table3[st[(cc + 15) & 15]];
+        dt[cc + 0] = (uint8_t)w;
+        dt[cc + 1] = (uint8_t)(w >> 8);
+        dt[cc + 2] = (uint8_t)(w >> 16);
+        dt[cc + 3] = (uint8_t)(w >> 24);
+    }
+#else
     dt[ 0] = gfm2_sb(st[0]) ^ gfm3_sb(st[5]) ^ s_box(st[10]) ^ s_box(st[15]);
     dt[ 1] = s_box(st[0]) ^ gfm2_sb(st[5]) ^ gfm3_sb(st[10]) ^ s_box(st[15]);
     dt[ 2] = s_box(st[0]) ^ s_box(st[5]) ^ gfm2_sb(st[10]) ^ gfm3_sb(st[15]);
@@ -471,6 +507,7 @@ static void inv_shift_sub_rows( uint8_t st[N_BLOCK] )
     dt[13] = s_box(st[12]) ^ gfm2_sb(st[1]) ^ gfm3_sb(st[6]) ^ s_box(st[11]);
     dt[14] = s_box(st[12]) ^ s_box(st[1]) ^ gfm2_sb(st[6]) ^ gfm3_sb(st[11]);
     dt[15] = gfm3_sb(st[12]) ^ s_box(st[1]) ^ s_box(st[6]) ^ gfm2_sb(st[11]);
+#endif
   }
 
 #if defined( AES_DEC_PREKEYED )
@@ -565,7 +602,7 @@ return_type aes_set_key( const uint8_t key[], length_type keylen, aes_context ct
 
 /*  Encrypt a single block of 16 bytes */
 
-return_type aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK], const aes_context ctx[1] )
+BSP_RAMFUNC return_type aes_encrypt( const uint8_t in[N_BLOCK], uint8_t  out[N_BLOCK], const aes_context ctx[1] )
 {
     if( ctx->rnd )
     {
@@ -34,10 +34,11 @@ DEALINGS WITH THE SOFTWARE
 *****************************************************************************/
 //#include <sys/param.h>
 //#include <sys/systm.h>
+#include <stddef.h>
 #include <stdint.h>
-#include "aes.h"
 #include "cmac.h"
 #include "lr1mac_utilities.h"
+#include "smtc_bsp_mcu.h"
 
 #define LSHIFT(v, r) do {                                       \
   int32_t i;                                                  \
@@ -46,29 +47,47 @@ DEALINGS WITH THE SOFTWARE
             (r)[15] = (v)[15] << 1;                                 \
     } while (0)
 
-#define XOR(v, r) do {                                          \
-            int32_t i;                                                  \
-            for (i = 0; i < 16; i++)     \
-        {   \
-                    (r)[i] = (r)[i] ^ (v)[i]; \
-        }                          \
-    } while (0) \
+#define XOR(v, r) memxor1((r), (r), (v), 16)
 
 
 void AES_CMAC_Init(AES_CMAC_CTX *ctx)
 {
             memset1(ctx->X, 0, sizeof ctx->X);
             ctx->M_n = 0;
-        memset1(ctx->rijndael.ksch, '\0', 240);
+            ctx->ksch = NULL;
+            ctx->subkeys = NULL;
 }
 
-void AES_CMAC_SetKey(AES_CMAC_CTX *ctx, const uint8_t key[AES_CMAC_KEY_LENGTH])
+void AES_CMAC_SetKeySchedule(AES_CMAC_CTX *ctx, const crypto_backend_key_t *ksch)
 {
-           //rijndael_set_key_enc_only(&ctx->rijndael, key, 128);
-       aes_set_key( key, AES_CMAC_KEY_LENGTH, &ctx->rijndael);
+       /* the key is prepared by the caller (crypto_backend_key_set) and must outlive the CMAC computation */
+       ctx->ksch = ksch;
 }
 
-void AES_CMAC_Update(AES_CMAC_CTX *ctx, const uint8_t *data, uint32_t len)
+void AES_CMAC_SubkeysDerive(const crypto_backend_key_t *ksch, AES_CMAC_SUBKEYS *subkeys)
+{
+            /* generate subkey K1 */
+            memset1(subkeys->K1, '\0', 16);
+            crypto_backend_block_encrypt( ksch, subkeys->K1, subkeys->K1);
+            if (subkeys->K1[0] & 0x80) {
+                    LSHIFT(subkeys->K1, subkeys->K1);
+                    subkeys->K1[15] ^= 0x87;
+            } else
+                    LSHIFT(subkeys->K1, subkeys->K1);
+
+            /* generate subkey K2 */
+            LSHIFT(subkeys->K1, subkeys->K2);
+            if (subkeys->K1[0] & 0x80)
+                    subkeys->K2[15] ^= 0x87;
+}
+
+void AES_CMAC_SetSubkeys(AES_CMAC_CTX *ctx, const AES_CMAC_SUBKEYS *subkeys)
+{
+       /* derived once per key by AES_CMAC_SubkeysDerive, spares AES_CMAC_Final one block encryption */
+       ctx->subkeys = subkeys;
+}
+
+BSP_RAMFUNC void AES_CMAC_Update(AES_CMAC_CTX *ctx, const uint8_t *data, uint32_t len)
 {
             uint32_t mlen;
         uint8_t in[16];
@@ -81,7 +100,7 @@ void AES_CMAC_Update(AES_CMAC_CTX *ctx, const uint8_t *data, uint32_t len)
                             return;
                    XOR(ctx->M_last, ctx->X);
                     //rijndael_encrypt(&ctx->rijndael, ctx->X, ctx->X);
-            aes_encrypt( ctx->X, ctx->X, &ctx->rijndael);
+            crypto_backend_block_encrypt( ctx->ksch, ctx->X, ctx->X);
                     data += mlen;
                     len -= mlen;
             }
@@ -91,7 +110,7 @@ void AES_CMAC_Update(AES_CMAC_CTX *ctx, const uint8_t *data, uint32_t len)
                     //rijndael_encrypt(&ctx->rijndael, ctx->X, ctx->X);
 
                     memcpy1(in, &ctx->X[0], 16); //Bestela ez du ondo iten
-            aes_encrypt( in, in, &ctx->rijndael);
+            crypto_backend_block_encrypt( ctx->ksch, in, in);
                     memcpy1(&ctx->X[0], in, 16);
 
                     data += 16;
@@ -104,40 +123,26 @@ void AES_CMAC_Update(AES_CMAC_CTX *ctx, const uint8_t *data, uint32_t len)
 
 void AES_CMAC_Final(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX *ctx)
 {
-            uint8_t K[16];
+            AES_CMAC_SUBKEYS subkeys;
+            const AES_CMAC_SUBKEYS *K = ctx->subkeys;
         uint8_t in[16];
-            /* generate subkey K1 */
-            memset1(K, '\0', 16);
-
-            //rijndael_encrypt(&ctx->rijndael, K, K);
-
-            aes_encrypt( K, K, &ctx->rijndael);
-
-            if (K[0] & 0x80) {
-                    LSHIFT(K, K);
-                   K[15] ^= 0x87;
-            } else
-                    LSHIFT(K, K);
 
+            if (K == NULL) {
+                    AES_CMAC_SubkeysDerive(ctx->ksch, &subkeys);
+                    K = &subkeys;
+            }
 
             if (ctx->M_n == 16) {
                     /* last block was a complete block */
-                    XOR(K, ctx->M_last);
+                    XOR(K->K1, ctx->M_last);
 
            } else {
-                   /* generate subkey K2 */
-                  if (K[0] & 0x80) {
-                          LSHIFT(K, K);
-                          K[15] ^= 0x87;
-                  } else
-                           LSHIFT(K, K);
-
                    /* padding(M_last) */
                    ctx->M_last[ctx->M_n] = 0x80;
                    while (++ctx->M_n < 16)
                          ctx->M_last[ctx->M_n] = 0;
 
-                  XOR(K, ctx->M_last);
+                  XOR(K->K2, ctx->M_last);
 
 
            }
@@ -146,7 +151,8 @@ void AES_CMAC_Final(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX *ctx)
            //rijndael_encrypt(&ctx->rijndael, ctx->X, digest);
 
        memcpy1(in, &ctx->X[0], 16); //Bestela ez du ondo iten
-       aes_encrypt(in, digest, &ctx->rijndael);
-           memset1(K, 0, sizeof K);
+       crypto_backend_block_encrypt( ctx->ksch, in, digest);
+           if (K == &subkeys)
+                   memset1((uint8_t *)&subkeys, 0, sizeof subkeys);
 
 }
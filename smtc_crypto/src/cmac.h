@@ -36,23 +36,32 @@ DEALINGS WITH THE SOFTWARE
 #ifndef _CMAC_H_
 #define _CMAC_H_
 
-#include "aes.h" 
+#include "crypto_backend.h"
   
 #define AES_CMAC_KEY_LENGTH     16
 #define AES_CMAC_DIGEST_LENGTH  16
  
+/* subkeys K1 (complete last block) and K2 (padded last block) of a key, see AES_CMAC_SubkeysDerive */
+typedef struct _AES_CMAC_SUBKEYS {
+            uint8_t            K1[16];
+            uint8_t            K2[16];
+    } AES_CMAC_SUBKEYS;
+
 typedef struct _AES_CMAC_CTX {
-            aes_context    rijndael;
-            uint8_t        X[16];
-            uint8_t        M_last[16];
-            uint32_t       M_n;
+            const crypto_backend_key_t* ksch;    /* caller owned prepared key */
+            const AES_CMAC_SUBKEYS* subkeys;     /* caller owned subkeys of ksch, NULL: derived by AES_CMAC_Final */
+            uint8_t            X[16];
+            uint8_t            M_last[16];
+            uint32_t           M_n;
     } AES_CMAC_CTX;
    
 //#include <sys/cdefs.h>
     
 //__BEGIN_DECLS
 void     AES_CMAC_Init(AES_CMAC_CTX * ctx);
-void     AES_CMAC_SetKey(AES_CMAC_CTX * ctx, const uint8_t key[AES_CMAC_KEY_LENGTH]);
+void     AES_CMAC_SetKeySchedule(AES_CMAC_CTX * ctx, const crypto_backend_key_t * ksch);
+void     AES_CMAC_SubkeysDerive(const crypto_backend_key_t * ksch, AES_CMAC_SUBKEYS * subkeys);
+void     AES_CMAC_SetSubkeys(AES_CMAC_CTX * ctx, const AES_CMAC_SUBKEYS * subkeys);
 void     AES_CMAC_Update(AES_CMAC_CTX * ctx, const uint8_t * data, uint32_t len);
           //          __attribute__((__bounded__(__string__,2,3)));
 void     AES_CMAC_Final(uint8_t digest[AES_CMAC_DIGEST_LENGTH], AES_CMAC_CTX  * ctx);
@@ -34,7 +34,7 @@
 #include <string.h>
 #include "lr1mac_utilities.h"
 #include "lr1mac_defs.h"
-#include "aes.h"
+#include "crypto_backend.h"
 #include "cmac.h"
 #include "crypto.h"
 #define FileId 5
@@ -44,206 +44,297 @@
 #define LORAMAC_MIC_BLOCK_B0_SIZE 16
 
 /*!
- * MIC field computation initial data
+ * First byte of the MIC B0 block and of the encryption A block
  */
-static uint8_t MicBlockB0[] = {0x49, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                               0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+#define LORAMAC_MIC_BLOCK_B0_TAG 0x49
+#define LORAMAC_ENC_BLOCK_A_TAG 0x01
 
 /*!
- * Contains the computed MIC field.
- *
- * \remark Only the 4 first bytes are used
+ * \brief Builds a MIC B0 or encryption A block: tag, direction, address and frame counter
  */
-static uint8_t Mic[16];
+static void block_frame_info_set(uint8_t *block, uint8_t tag, uint32_t address, uint8_t dir, uint32_t sequenceCounter)
+{
+    memset1(block, 0, 16);
+    block[0] = tag;
 
-/*!
- * Encryption aBlock and sBlock
- */
-static uint8_t aBlock[] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                           0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-static uint8_t sBlock[] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-                           0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    block[5] = dir;
 
-/*!
- * AES computation context variable
- */
-static aes_context AesContext;
+    block[6] = (address)&0xFF;
+    block[7] = (address >> 8) & 0xFF;
+    block[8] = (address >> 16) & 0xFF;
+    block[9] = (address >> 24) & 0xFF;
+
+    block[10] = (sequenceCounter)&0xFF;
+    block[11] = (sequenceCounter >> 8) & 0xFF;
+    block[12] = (sequenceCounter >> 16) & 0xFF;
+    block[13] = (sequenceCounter >> 24) & 0xFF;
+}
 
 /*!
- * CMAC computation context variable
+ * \brief Returns the 4 first bytes of the CMAC digest as the LoRaWAN MIC
  */
-static AES_CMAC_CTX AesCmacCtx[1];
+static uint32_t cmac_final_mic(lora_crypto_ctx_t *ctx)
+{
+    uint8_t mic[16];
+
+    AES_CMAC_Final(mic, &ctx->cmac_ctx);
+
+    return (uint32_t)((uint32_t)mic[3] << 24 | (uint32_t)mic[2] << 16 | (uint32_t)mic[1] << 8 | (uint32_t)mic[0]);
+}
 
 /*!
  * \brief Computes the LoRaMAC frame MIC field
  *
+ * \param [IN]  ctx             Caller owned crypto context
  * \param [IN]  buffer          Data buffer
  * \param [IN]  size            Data buffer size
- * \param [IN]  key             AES key to be used
+ * \param [IN]  ksch            AES key to be used
+ * \param [IN]  subkeys         CMAC subkeys of ksch, NULL to derive them here
  * \param [IN]  address         Frame address
  * \param [IN]  dir             Frame direction [0: uplink, 1: downlink]
  * \param [IN]  sequenceCounter Frame sequence counter
  * \param [OUT] mic Computed MIC field
  */
-
-void compute_mic(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint32_t *mic)
+static void compute_mic_with_ksch(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const crypto_backend_key_t *ksch, const AES_CMAC_SUBKEYS *subkeys, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint32_t *mic)
 {
+    block_frame_info_set(ctx->mic_block_b0, LORAMAC_MIC_BLOCK_B0_TAG, address, dir, sequenceCounter);
+    ctx->mic_block_b0[15] = size & 0xFF;
 
-    MicBlockB0[5] = dir;
+    AES_CMAC_Init(&ctx->cmac_ctx);
 
-    MicBlockB0[6] = (address)&0xFF;
-    MicBlockB0[7] = (address >> 8) & 0xFF;
-    MicBlockB0[8] = (address >> 16) & 0xFF;
-    MicBlockB0[9] = (address >> 24) & 0xFF;
+    AES_CMAC_SetKeySchedule(&ctx->cmac_ctx, ksch);
 
-    MicBlockB0[10] = (sequenceCounter)&0xFF;
-    MicBlockB0[11] = (sequenceCounter >> 8) & 0xFF;
-    MicBlockB0[12] = (sequenceCounter >> 16) & 0xFF;
-    MicBlockB0[13] = (sequenceCounter >> 24) & 0xFF;
+    AES_CMAC_SetSubkeys(&ctx->cmac_ctx, subkeys);
 
-    MicBlockB0[15] = size & 0xFF;
+    AES_CMAC_Update(&ctx->cmac_ctx, ctx->mic_block_b0, LORAMAC_MIC_BLOCK_B0_SIZE);
 
-    AES_CMAC_Init(AesCmacCtx);
+    AES_CMAC_Update(&ctx->cmac_ctx, buffer, size & 0xFF);
 
-    AES_CMAC_SetKey(AesCmacCtx, key);
+    *mic = cmac_final_mic(ctx);
+}
 
-    AES_CMAC_Update(AesCmacCtx, MicBlockB0, LORAMAC_MIC_BLOCK_B0_SIZE);
+/*!
+ * \brief Computes the LoRaMAC Join frame MIC field, see compute_mic_with_ksch
+ */
+static void join_compute_mic_with_ksch(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const crypto_backend_key_t *ksch, const AES_CMAC_SUBKEYS *subkeys, uint32_t *mic)
+{
+    AES_CMAC_Init(&ctx->cmac_ctx);
+
+    AES_CMAC_SetKeySchedule(&ctx->cmac_ctx, ksch);
 
-    AES_CMAC_Update(AesCmacCtx, buffer, size & 0xFF);
+    AES_CMAC_SetSubkeys(&ctx->cmac_ctx, subkeys);
 
-    AES_CMAC_Final(Mic, AesCmacCtx);
+    AES_CMAC_Update(&ctx->cmac_ctx, buffer, size & 0xFF);
 
-    *mic = (uint32_t)((uint32_t)Mic[3] << 24 | (uint32_t)Mic[2] << 16 | (uint32_t)Mic[1] << 8 | (uint32_t)Mic[0]);
+    *mic = cmac_final_mic(ctx);
 }
 
-void lora_crypto_payload_encrypt(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer)
+static void join_decrypt_with_ksch(const uint8_t *buffer, uint16_t size, const crypto_backend_key_t *ksch, uint8_t *decBuffer)
 {
+    crypto_backend_block_encrypt(ksch, buffer, decBuffer);
+    // Check if optional CFList is included
+    if (size >= 16)
+    {
+        crypto_backend_block_encrypt(ksch, buffer + 16, decBuffer + 16);
+    }
+}
 
-    uint16_t i;
-    uint8_t bufferIndex = 0;
-    uint16_t ctr = 1;
+static void join_compute_skeys_with_ksch(const crypto_backend_key_t *ksch, const uint8_t *appNonce, uint16_t devNonce, uint8_t *nwkSKey, uint8_t *appSKey)
+{
+    uint8_t nonce[16];
+    uint8_t *pDevNonce = (uint8_t *)&devNonce;
 
-    memset1(AesContext.ksch, '\0', 240);
-    aes_set_key(key, 16, &AesContext);
+    memset1(nonce, 0, sizeof(nonce));
+    nonce[0] = 0x01;
+    memcpy1(nonce + 1, appNonce, 6);
+    memcpy1(nonce + 7, pDevNonce, 2);
+    crypto_backend_block_encrypt(ksch, nonce, nwkSKey);
 
-    aBlock[5] = dir;
+    memset1(nonce, 0, sizeof(nonce));
+    nonce[0] = 0x02;
+    memcpy1(nonce + 1, appNonce, 6);
+    memcpy1(nonce + 7, pDevNonce, 2);
+    crypto_backend_block_encrypt(ksch, nonce, appSKey);
+}
 
-    aBlock[6] = (address)&0xFF;
-    aBlock[7] = (address >> 8) & 0xFF;
-    aBlock[8] = (address >> 16) & 0xFF;
-    aBlock[9] = (address >> 24) & 0xFF;
+static void payload_encrypt_with_ksch(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const crypto_backend_key_t *ksch, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer)
+{
+    block_frame_info_set(ctx->a_block, LORAMAC_ENC_BLOCK_A_TAG, address, dir, sequenceCounter);
+    ctx->a_block[15] = 1;
 
-    aBlock[10] = (sequenceCounter)&0xFF;
-    aBlock[11] = (sequenceCounter >> 8) & 0xFF;
-    aBlock[12] = (sequenceCounter >> 16) & 0xFF;
-    aBlock[13] = (sequenceCounter >> 24) & 0xFF;
+    crypto_backend_ctr_encrypt(ksch, ctx->a_block, buffer, size, encBuffer);
+}
 
-    while (size >= 16)
-    {
-        aBlock[15] = ((ctr)&0xFF);
-        ctr++;
-        aes_encrypt(aBlock, sBlock, &AesContext);
-        for (i = 0; i < 16; i++)
-        {
-            encBuffer[bufferIndex + i] = buffer[bufferIndex + i] ^ sBlock[i];
-        }
-        size -= 16;
-        bufferIndex += 16;
-    }
+void lora_crypto_key_set(lora_crypto_key_t *key_ctx, const uint8_t *key)
+{
+    crypto_backend_key_set(&key_ctx->backend_key, key);
+    AES_CMAC_SubkeysDerive(&key_ctx->backend_key, &key_ctx->cmac_subkeys);
+}
 
-    if (size > 0)
-    {
-        aBlock[15] = ((ctr)&0xFF);
-        aes_encrypt(aBlock, sBlock, &AesContext);
-        for (i = 0; i < size; i++)
-        {
-            encBuffer[bufferIndex + i] = buffer[bufferIndex + i] ^ sBlock[i];
-        }
-    }
+void compute_mic(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint32_t *mic)
+{
+    crypto_backend_key_set(&ctx->key_ctx.backend_key, key);
+    compute_mic_with_ksch(ctx, buffer, size, &ctx->key_ctx.backend_key, NULL, address, dir, sequenceCounter, mic);
 }
 
-void payload_decrypt(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *decBuffer)
+void lora_crypto_payload_encrypt(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer)
 {
+    crypto_backend_key_set(&ctx->key_ctx.backend_key, key);
+    payload_encrypt_with_ksch(ctx, buffer, size, &ctx->key_ctx.backend_key, address, dir, sequenceCounter, encBuffer);
+}
 
-    lora_crypto_payload_encrypt(buffer, size, key, address, dir, sequenceCounter, decBuffer);
+void lora_crypto_keyed_payload_encrypt(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer)
+{
+    payload_encrypt_with_ksch(ctx, buffer, size, &key_ctx->backend_key, address, dir, sequenceCounter, encBuffer);
 }
 
-void join_compute_mic(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t *mic)
+void lora_crypto_keyed_payload_encrypt_slice(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t first_block, uint8_t *encBuffer)
 {
+    block_frame_info_set(ctx->a_block, LORAMAC_ENC_BLOCK_A_TAG, address, dir, sequenceCounter);
+    ctx->a_block[15] = first_block;
 
-    AES_CMAC_Init(AesCmacCtx);
+    crypto_backend_ctr_encrypt(&key_ctx->backend_key, ctx->a_block, buffer, size, encBuffer);
+}
 
-    AES_CMAC_SetKey(AesCmacCtx, key);
+void lora_crypto_keyed_payload_decrypt(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *decBuffer)
+{
+    payload_encrypt_with_ksch(ctx, buffer, size, &key_ctx->backend_key, address, dir, sequenceCounter, decBuffer);
+}
 
-    AES_CMAC_Update(AesCmacCtx, buffer, size & 0xFF);
+void lora_crypto_keyed_encrypt_and_mic(lora_crypto_ctx_t *ctx, uint8_t *buffer, uint16_t header_size, uint16_t payload_size, const lora_crypto_key_t *enc_key_ctx, const lora_crypto_key_t *mic_key_ctx, uint32_t address, uint8_t dir, uint32_t sequenceCounter)
+{
+    uint32_t sBlock[4]; /* word aligned for memxor1 */
+    uint8_t *payload = &buffer[header_size];
+    uint16_t size = header_size + payload_size;
+    uint16_t len;
+    uint32_t mic;
 
-    AES_CMAC_Final(Mic, AesCmacCtx);
+    block_frame_info_set(ctx->mic_block_b0, LORAMAC_MIC_BLOCK_B0_TAG, address, dir, sequenceCounter);
+    ctx->mic_block_b0[15] = size & 0xFF;
 
-    *mic = (uint32_t)((uint32_t)Mic[3] << 24 | (uint32_t)Mic[2] << 16 | (uint32_t)Mic[1] << 8 | (uint32_t)Mic[0]);
-}
+    block_frame_info_set(ctx->a_block, LORAMAC_ENC_BLOCK_A_TAG, address, dir, sequenceCounter);
+    ctx->a_block[15] = 1;
 
-void join_decrypt(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint8_t *decBuffer)
-{
+    AES_CMAC_Init(&ctx->cmac_ctx);
+    AES_CMAC_SetKeySchedule(&ctx->cmac_ctx, &mic_key_ctx->backend_key);
+    AES_CMAC_SetSubkeys(&ctx->cmac_ctx, &mic_key_ctx->cmac_subkeys);
+    AES_CMAC_Update(&ctx->cmac_ctx, ctx->mic_block_b0, LORAMAC_MIC_BLOCK_B0_SIZE);
+    AES_CMAC_Update(&ctx->cmac_ctx, buffer, header_size);
 
-    memset1(AesContext.ksch, '\0', 240);
-    aes_set_key(key, 16, &AesContext);
-    aes_encrypt(buffer, decBuffer, &AesContext);
-    // Check if optional CFList is included
-    if (size >= 16)
+    // Encrypt the payload in place and feed each ciphertext block to the CMAC while it is still hot
+    while (payload_size > 0)
     {
-        aes_encrypt(buffer + 16, decBuffer + 16, &AesContext);
+        crypto_backend_block_encrypt(&enc_key_ctx->backend_key, ctx->a_block, (uint8_t *)sBlock);
+        len = (payload_size >= 16) ? 16 : payload_size;
+        memxor1(payload, payload, (const uint8_t *)sBlock, len);
+        AES_CMAC_Update(&ctx->cmac_ctx, payload, len);
+        ctx->a_block[15]++;
+        payload += len;
+        payload_size -= len;
     }
+
+    mic = cmac_final_mic(ctx);
+    memcpy(&buffer[size], (uint8_t *)&mic, 4);
 }
 
-void join_compute_skeys(const uint8_t *key, const uint8_t *appNonce, uint16_t devNonce, uint8_t *nwkSKey, uint8_t *appSKey)
+void payload_decrypt(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *decBuffer)
 {
 
-    uint8_t nonce[16];
-    uint8_t *pDevNonce = (uint8_t *)&devNonce;
+    lora_crypto_payload_encrypt(ctx, buffer, size, key, address, dir, sequenceCounter, decBuffer);
+}
 
-    memset1(AesContext.ksch, '\0', 240);
-    aes_set_key(key, 16, &AesContext);
+void join_compute_mic(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t *mic)
+{
+    crypto_backend_key_set(&ctx->key_ctx.backend_key, key);
+    join_compute_mic_with_ksch(ctx, buffer, size, &ctx->key_ctx.backend_key, NULL, mic);
+}
 
-    memset1(nonce, 0, sizeof(nonce));
-    nonce[0] = 0x01;
-    memcpy1(nonce + 1, appNonce, 6);
-    memcpy1(nonce + 7, pDevNonce, 2);
-    aes_encrypt(nonce, nwkSKey, &AesContext);
+void join_decrypt(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const uint8_t *key, uint8_t *decBuffer)
+{
 
-    memset1(nonce, 0, sizeof(nonce));
-    nonce[0] = 0x02;
-    memcpy1(nonce + 1, appNonce, 6);
-    memcpy1(nonce + 7, pDevNonce, 2);
-    aes_encrypt(nonce, appSKey, &AesContext);
+    crypto_backend_key_set(&ctx->key_ctx.backend_key, key);
+    join_decrypt_with_ksch(buffer, size, &ctx->key_ctx.backend_key, decBuffer);
+}
+
+void join_compute_skeys(lora_crypto_ctx_t *ctx, const uint8_t *key, const uint8_t *appNonce, uint16_t devNonce, uint8_t *nwkSKey, uint8_t *appSKey)
+{
+
+    crypto_backend_key_set(&ctx->key_ctx.backend_key, key);
+    join_compute_skeys_with_ksch(&ctx->key_ctx.backend_key, appNonce, devNonce, nwkSKey, appSKey);
+}
+
+void lora_crypto_add_mic(lora_crypto_ctx_t *ctx, uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter)
+{
+
+    uint32_t mic;
+    compute_mic(ctx, buffer, size, key, address, dir, sequenceCounter, &mic);
+    memcpy(&buffer[size], (uint8_t *)&mic, 4);
 }
 
-void lora_crypto_add_mic(uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter)
+int check_mic(lora_crypto_ctx_t *ctx, uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint32_t sequenceCounter, uint32_t micIn)
+{
+    uint32_t mic;
+    int status = -1;
+    compute_mic(ctx, buffer, size, key, address, 1, sequenceCounter, &mic);
+    if (mic == micIn)
+    {
+        status = 0;
+    }
+    return (status);
+}
+
+void lora_crypto_keyed_add_mic(lora_crypto_ctx_t *ctx, uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint32_t address, uint8_t dir, uint32_t sequenceCounter)
 {
 
     uint32_t mic;
-    compute_mic(buffer, size, key, address, dir, sequenceCounter, &mic);
+    compute_mic_with_ksch(ctx, buffer, size, &key_ctx->backend_key, &key_ctx->cmac_subkeys, address, dir, sequenceCounter, &mic);
     memcpy(&buffer[size], (uint8_t *)&mic, 4);
 }
 
-int check_mic(uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint32_t sequenceCounter, uint32_t micIn)
+int lora_crypto_keyed_check_mic(lora_crypto_ctx_t *ctx, uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint32_t address, uint32_t sequenceCounter, uint32_t micIn)
 {
     uint32_t mic;
     int status = -1;
-    compute_mic(buffer, size, key, address, 1, sequenceCounter, &mic);
+    compute_mic_with_ksch(ctx, buffer, size, &key_ctx->backend_key, &key_ctx->cmac_subkeys, address, 1, sequenceCounter, &mic);
     if (mic == micIn)
     {
         status = 0;
     }
     return (status);
 }
-int check_join_mic(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t micIn)
+
+int check_join_mic(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t micIn)
 {
     uint32_t mic;
     int status = -1;
-    join_compute_mic(buffer, size, key, &mic);
+    join_compute_mic(ctx, buffer, size, key, &mic);
     if (mic == micIn)
     {
         status = 0;
     }
     return (status);
 }
+
+void lora_crypto_keyed_join_decrypt(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint8_t *decBuffer)
+{
+    (void)ctx;
+    join_decrypt_with_ksch(buffer, size, &key_ctx->backend_key, decBuffer);
+}
+
+int lora_crypto_keyed_check_join_mic(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint32_t micIn)
+{
+    uint32_t mic;
+    int status = -1;
+    join_compute_mic_with_ksch(ctx, buffer, size, &key_ctx->backend_key, &key_ctx->cmac_subkeys, &mic);
+    if (mic == micIn)
+    {
+        status = 0;
+    }
+    return (status);
+}
+
+void lora_crypto_keyed_join_compute_skeys(lora_crypto_ctx_t *ctx, const lora_crypto_key_t *key_ctx, const uint8_t *appNonce, uint16_t devNonce, uint8_t *nwkSKey, uint8_t *appSKey)
+{
+    (void)ctx;
+    join_compute_skeys_with_ksch(&key_ctx->backend_key, appNonce, devNonce, nwkSKey, appSKey);
+}
@@ -32,14 +32,55 @@
 #ifndef __LORAMAC_CRYPTO_H__
 #define __LORAMAC_CRYPTO_H__
 
+#include <stdint.h>
+#include "crypto_backend.h"
+#include "cmac.h"
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
 
+   /*!
+    * \typedef lora_crypto_key_t
+    * \brief   AES-128 key prepared once for the crypto backend (expanded schedule
+    *          with the software AES) and its CMAC subkeys, so that the frame
+    *          encryption and MIC computation skip the key expansion and the
+    *          subkey block encryption
+    */
+   typedef struct lora_crypto_key_s
+   {
+      crypto_backend_key_t backend_key;
+      AES_CMAC_SUBKEYS     cmac_subkeys;
+   } lora_crypto_key_t;
+
+   /*!
+    * \typedef lora_crypto_ctx_t
+    * \brief   Caller owned working state of the crypto functions. Functions running on
+    *          distinct contexts can preempt each other (e.g. a downlink MIC check under
+    *          radio interrupt while the main loop encrypts a file upload)
+    */
+   typedef struct lora_crypto_ctx_s
+   {
+      AES_CMAC_CTX      cmac_ctx;      //!< CMAC running state
+      lora_crypto_key_t key_ctx;       //!< key prepared by the functions taking a raw key
+      uint8_t           mic_block_b0[16];
+      uint8_t           a_block[16];
+   } lora_crypto_ctx_t;
+
+   /*!
+    * \brief   Expand an AES-128 key into a reusable key schedule and derive its CMAC subkeys
+    * \remark  To be called once each time the key changes (join accept, ABP keys set, ...)
+    * \param [IN]  key_ctx  key schedule to fill
+    * \param [IN]  key      16 bytes AES key
+    * \param [OUT] return
+    */
+   void lora_crypto_key_set(lora_crypto_key_t *key_ctx, const uint8_t *key);
+
    /*!
  * Computes the LoRaMAC frame MIC field
  *
+ * \param [IN]  ctx             - Caller owned crypto context
  * \param [IN]  buffer          - Data buffer
  * \param [IN]  size            - Data buffer size
  * \param [IN]  key             - AES key to be used
@@ -48,11 +89,12 @@ extern "C"
  * \param [IN]  sequenceCounter - Frame sequence counter
  * \param [OUT] mic             - Computed MIC field
  */
-   void compute_mic(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint32_t *mic);
+   void compute_mic(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint32_t *mic);
 
    /*!
  * Computes the LoRaMAC payload encryption
  *
+ * \param [IN]  ctx             - Caller owned crypto context
  * \param [IN]  buffer          - Data buffer
  * \param [IN]  size            - Data buffer size
  * \param [IN]  key             - AES key to be used
@@ -61,11 +103,12 @@ extern "C"
  * \param [IN]  sequenceCounter - Frame sequence counter
  * \param [OUT] encBuffer       - Encrypted buffer
  */
-   void lora_crypto_payload_encrypt(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer);
+   void lora_crypto_payload_encrypt(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer);
 
    /*!
  * Computes the LoRaMAC payload decryption
  *
+ * \param [IN]  ctx             - Caller owned crypto context
  * \param [IN]  buffer          - Data buffer
  * \param [IN]  size            - Data buffer size
  * \param [IN]  key             - AES key to be used
@@ -74,38 +117,41 @@ extern "C"
  * \param [IN]  sequenceCounter - Frame sequence counter
  * \param [OUT] decBuffer       - Decrypted buffer
  */
-   void payload_decrypt(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *decBuffer);
+   void payload_decrypt(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *decBuffer);
 
    /*!
  * Computes the LoRaMAC Join Request frame MIC field
  *
+ * \param [IN]  ctx             - Caller owned crypto context
  * \param [IN]  buffer          - Data buffer
  * \param [IN]  size            - Data buffer size
  * \param [IN]  key             - AES key to be used
  * \param [OUT] mic             - Computed MIC field
  */
-   void join_compute_mic(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t *mic);
+   void join_compute_mic(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t *mic);
 
    /*!
  * Computes the LoRaMAC join frame decryption
  *
+ * \param [IN]  ctx             - Caller owned crypto context
  * \param [IN]  buffer          - Data buffer
  * \param [IN]  size            - Data buffer size
  * \param [IN]  key             - AES key to be used
  * \param [OUT] decBuffer       - Decrypted buffer
  */
-   void join_decrypt(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint8_t *decBuffer);
+   void join_decrypt(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const uint8_t *key, uint8_t *decBuffer);
 
    /*!
  * Computes the LoRaMAC join frame decryption
  *
+ * \param [IN]  ctx             - Caller owned crypto context
  * \param [IN]  key             - AES key to be used
  * \param [IN]  appNonce        - Application nonce
  * \param [IN]  devNonce        - Device nonce
  * \param [OUT] nwkSKey         - Network session key
  * \param [OUT] appSKey         - Application session key
  */
-   void join_compute_skeys(const uint8_t *key, const uint8_t *appNonce, uint16_t devNonce, uint8_t *nwkSKey, uint8_t *appSKey);
+   void join_compute_skeys(lora_crypto_ctx_t *ctx, const uint8_t *key, const uint8_t *appNonce, uint16_t devNonce, uint8_t *nwkSKey, uint8_t *appSKey);
 
    /*!
     * \brief
@@ -113,21 +159,92 @@ extern "C"
     * \param [IN]  none
     * \param [OUT] return
 */
-   void lora_crypto_add_mic(uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter);
+   void lora_crypto_add_mic(lora_crypto_ctx_t *ctx, uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint8_t dir, uint32_t sequenceCounter);
    /*!
     * \brief
     * \remark
     * \param [IN]  none
     * \param [OUT] return
 */
-   int check_mic(uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint32_t sequenceCounter, uint32_t micIn);
+   int check_mic(lora_crypto_ctx_t *ctx, uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t address, uint32_t sequenceCounter, uint32_t micIn);
    /*!
     * \brief
     * \remark
     * \param [IN]  none
     * \param [OUT] return
 */
-   int check_join_mic(const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t micIn);
+   int check_join_mic(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const uint8_t *key, uint32_t micIn);
+
+   /*!
+    * \brief   Same as lora_crypto_payload_encrypt with a pre-expanded key schedule
+    * \remark
+    * \param [IN]  key_ctx  key schedule set by lora_crypto_key_set
+    * \param [OUT] return
+    */
+   void lora_crypto_keyed_payload_encrypt(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *encBuffer);
+   /*!
+    * \brief   Encrypt a slice of a payload, so that a long buffer can be encrypted piece by piece
+    * \remark  Same result as the bytes [16 * (first_block - 1), 16 * (first_block - 1) + size) of
+    *          lora_crypto_keyed_payload_encrypt on the whole buffer
+    * \param [IN]  key_ctx      key schedule set by lora_crypto_key_set
+    * \param [IN]  first_block  counter of the first block of the slice, 1 for the start of the payload
+    * \param [OUT] return
+    */
+   void lora_crypto_keyed_payload_encrypt_slice(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t first_block, uint8_t *encBuffer);
+   /*!
+    * \brief   Same as payload_decrypt with a pre-expanded key schedule
+    * \remark
+    * \param [IN]  key_ctx  key schedule set by lora_crypto_key_set
+    * \param [OUT] return
+    */
+   void lora_crypto_keyed_payload_decrypt(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint32_t address, uint8_t dir, uint32_t sequenceCounter, uint8_t *decBuffer);
+   /*!
+    * \brief   Encrypt a frame payload in place and append the frame MIC in a single pass over the buffer
+    * \remark  Same result as lora_crypto_keyed_payload_encrypt on the payload followed by
+    *          lora_crypto_keyed_add_mic on the whole frame; buffer must hold 4 more bytes for the MIC
+    * \param [IN]  buffer        frame: clear header followed by the payload to encrypt
+    * \param [IN]  header_size   size of the header (MHDR + FHDR + FPort), not encrypted
+    * \param [IN]  payload_size  size of the payload to encrypt
+    * \param [IN]  enc_key_ctx   payload encryption key schedule
+    * \param [IN]  mic_key_ctx   MIC key schedule
+    * \param [OUT] return
+    */
+   void lora_crypto_keyed_encrypt_and_mic(lora_crypto_ctx_t *ctx, uint8_t *buffer, uint16_t header_size, uint16_t payload_size, const lora_crypto_key_t *enc_key_ctx, const lora_crypto_key_t *mic_key_ctx, uint32_t address, uint8_t dir, uint32_t sequenceCounter);
+   /*!
+    * \brief   Same as lora_crypto_add_mic with a pre-expanded key schedule
+    * \remark
+    * \param [IN]  key_ctx  key schedule set by lora_crypto_key_set
+    * \param [OUT] return
+    */
+   void lora_crypto_keyed_add_mic(lora_crypto_ctx_t *ctx, uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint32_t address, uint8_t dir, uint32_t sequenceCounter);
+   /*!
+    * \brief   Same as check_mic with a pre-expanded key schedule
+    * \remark
+    * \param [IN]  key_ctx  key schedule set by lora_crypto_key_set
+    * \param [OUT] return  0 if the MIC matches
+    */
+   int lora_crypto_keyed_check_mic(lora_crypto_ctx_t *ctx, uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint32_t address, uint32_t sequenceCounter, uint32_t micIn);
+   /*!
+    * \brief   Same as join_decrypt with a pre-expanded key schedule
+    * \remark
+    * \param [IN]  key_ctx  key schedule set by lora_crypto_key_set
+    * \param [OUT] return
+    */
+   void lora_crypto_keyed_join_decrypt(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint8_t *decBuffer);
+   /*!
+    * \brief   Same as check_join_mic with a pre-expanded key schedule
+    * \remark
+    * \param [IN]  key_ctx  key schedule set by lora_crypto_key_set
+    * \param [OUT] return  0 if the MIC matches
+    */
+   int lora_crypto_keyed_check_join_mic(lora_crypto_ctx_t *ctx, const uint8_t *buffer, uint16_t size, const lora_crypto_key_t *key_ctx, uint32_t micIn);
+   /*!
+    * \brief   Same as join_compute_skeys with a pre-expanded key schedule
+    * \remark
+    * \param [IN]  key_ctx  key schedule set by lora_crypto_key_set
+    * \param [OUT] return
+    */
+   void lora_crypto_keyed_join_compute_skeys(lora_crypto_ctx_t *ctx, const lora_crypto_key_t *key_ctx, const uint8_t *appNonce, uint16_t devNonce, uint8_t *nwkSKey, uint8_t *appSKey);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,146 @@
+/*!
+ * \file      crypto_backend.c
+ *
+ * \brief     AES block cipher backends (software or MCU peripheral)
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "crypto_backend.h"
+#include "lr1mac_utilities.h"
+#include "smtc_bsp_mcu.h"
+
+#if defined( SMTC_CRYPTO_HW_AES )
+#include "smtc_bsp_aes.h"
+
+/*!
+ * Number of blocks going through the aligned buffer at once, in one critical section
+ */
+#define CRYPTO_BACKEND_CHUNK_BLOCKS 16
+
+/*!
+ * The peripheral needs word aligned buffers, LoRaWAN payloads are not.
+ * Shared by all the callers like the peripheral: only used in a critical section
+ */
+static uint32_t aligned_buffer[CRYPTO_BACKEND_CHUNK_BLOCKS * 4];
+
+void crypto_backend_key_set(crypto_backend_key_t *key_ctx, const uint8_t key[16])
+{
+    memcpy(key_ctx->key, key, 16);
+}
+
+void crypto_backend_block_encrypt(const crypto_backend_key_t *key_ctx, const uint8_t in[16], uint8_t out[16])
+{
+    uint32_t block[4];
+
+    memcpy(block, in, 16);
+    bsp_mcu_clock_boost_request();
+    CRITICAL_SECTION_BEGIN();
+    bsp_aes_ecb_encrypt(key_ctx->key, block, block);
+    CRITICAL_SECTION_END();
+    bsp_mcu_clock_boost_release();
+    memcpy(out, block, 16);
+}
+
+void crypto_backend_ctr_encrypt(const crypto_backend_key_t *key_ctx, const uint8_t a_block[16], const uint8_t *in, uint16_t size, uint8_t *out)
+{
+    uint8_t iv[16];
+    uint16_t nb_blocks;
+    uint16_t chunk_size;
+
+    memcpy(iv, a_block, 16);
+
+    bsp_mcu_clock_boost_request();
+    while (size > 0)
+    {
+        // The peripheral counter is 32 bits wide: stop each chunk before the last byte wraps
+        // so that the carry never reaches a_block[14]
+        nb_blocks = 256 - iv[15];
+        if (nb_blocks > CRYPTO_BACKEND_CHUNK_BLOCKS)
+        {
+            nb_blocks = CRYPTO_BACKEND_CHUNK_BLOCKS;
+        }
+        chunk_size = nb_blocks * 16;
+        if (chunk_size > size)
+        {
+            chunk_size = size;
+            nb_blocks = (size + 15) >> 4;
+        }
+
+        // a MIC computed under interrupt meanwhile would reload the peripheral and the buffer
+        CRITICAL_SECTION_BEGIN();
+        memcpy(aligned_buffer, in, chunk_size);
+        bsp_aes_ctr_encrypt(key_ctx->key, iv, aligned_buffer, nb_blocks);
+        memcpy(out, aligned_buffer, chunk_size);
+        CRITICAL_SECTION_END();
+
+        iv[15] = (uint8_t)(iv[15] + nb_blocks);
+        in += chunk_size;
+        out += chunk_size;
+        size -= chunk_size;
+    }
+    bsp_mcu_clock_boost_release();
+}
+
+#else
+
+void crypto_backend_key_set(crypto_backend_key_t *key_ctx, const uint8_t key[16])
+{
+    aes_set_key(key, 16, key_ctx);
+}
+
+void crypto_backend_block_encrypt(const crypto_backend_key_t *key_ctx, const uint8_t in[16], uint8_t out[16])
+{
+    bsp_mcu_clock_boost_request();
+    aes_encrypt(in, out, key_ctx);
+    bsp_mcu_clock_boost_release();
+}
+
+void crypto_backend_ctr_encrypt(const crypto_backend_key_t *key_ctx, const uint8_t a_block[16], const uint8_t *in, uint16_t size, uint8_t *out)
+{
+    uint8_t ctr_block[16];
+    uint32_t s_block[4]; /* word aligned for memxor1 */
+    uint16_t len;
+
+    memcpy(ctr_block, a_block, 16);
+
+    bsp_mcu_clock_boost_request();
+    while (size > 0)
+    {
+        aes_encrypt(ctr_block, (uint8_t *)s_block, key_ctx);
+        len = (size >= 16) ? 16 : size;
+        memxor1(out, in, (const uint8_t *)s_block, len);
+        ctr_block[15]++;
+        in += len;
+        out += len;
+        size -= len;
+    }
+    bsp_mcu_clock_boost_release();
+}
+
+#endif
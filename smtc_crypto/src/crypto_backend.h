@@ -0,0 +1,97 @@
+/*!
+ * \file      crypto_backend.h
+ *
+ * \brief     AES block cipher backend selection (software or MCU peripheral)
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __CRYPTO_BACKEND_H__
+#define __CRYPTO_BACKEND_H__
+
+#include <stdint.h>
+
+#if !defined( SMTC_CRYPTO_HW_AES )
+#include "aes.h"
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+   /*!
+    * \typedef crypto_backend_key_t
+    * \brief   Key material as needed by the selected backend:
+    *          - software AES: expanded key schedule
+    *          - hardware AES (SMTC_CRYPTO_HW_AES): raw key, loaded in the peripheral for each operation
+    */
+#if defined( SMTC_CRYPTO_HW_AES )
+   typedef struct crypto_backend_key_s
+   {
+      uint8_t key[16];
+   } crypto_backend_key_t;
+#else
+   typedef aes_context crypto_backend_key_t;
+#endif
+
+   /*!
+    * \brief   Prepare an AES-128 key for the selected backend
+    * \remark
+    * \param [IN]  key_ctx  backend key to fill
+    * \param [IN]  key      16 bytes AES key
+    * \param [OUT] return
+    */
+   void crypto_backend_key_set(crypto_backend_key_t *key_ctx, const uint8_t key[16]);
+
+   /*!
+    * \brief   Encrypt one 16 bytes block (ECB)
+    * \remark  in and out may overlap. May be called from any context, interrupts included: the software AES only
+    *          works on the caller data, the AES peripheral is used in a critical section
+    * \param [IN]  key_ctx  backend key set by crypto_backend_key_set
+    * \param [IN]  in       plain block
+    * \param [OUT] out      cipher block
+    */
+   void crypto_backend_block_encrypt(const crypto_backend_key_t *key_ctx, const uint8_t in[16], uint8_t out[16]);
+
+   /*!
+    * \brief   LoRaWAN CTR encryption of size bytes
+    * \remark  As in LoRaWAN, only the last byte of a_block is used as counter and wraps around after 0xFF.
+    *          in and out may be the same buffer. May be called from any context, interrupts included: the AES
+    *          peripheral and its aligned buffer are used in a critical section of up to 16 blocks
+    * \param [IN]  key_ctx  backend key set by crypto_backend_key_set
+    * \param [IN]  a_block  initial counter block, a_block[15] holds the first counter value
+    * \param [IN]  in       plain data
+    * \param [IN]  size     data size in bytes
+    * \param [OUT] out      cipher data
+    */
+   void crypto_backend_ctr_encrypt(const crypto_backend_key_t *key_ctx, const uint8_t a_block[16], const uint8_t *in, uint16_t size, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CRYPTO_BACKEND_H__
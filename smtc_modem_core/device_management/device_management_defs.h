@@ -68,7 +68,7 @@ typedef enum dm_cmd
     DM_REJOIN      = 0x05,  //!< rejoin network
     DM_MUTE        = 0x06,  //!< permanently disable/enable modem
     DM_SET_DM_INFO = 0x07,  //!< set list of default info fields
-    DM_STREAM      = 0x08,  //!< set data stream parameters
+    DM_STREAM      = 0x08,  //!< stream feedback: acknowledged offset and received units
     DM_ALC_SYNC    = 0x09,  //!< application layer clock sync data
     DM_CMD_MAX              //!< number of elements
 } e_dm_cmd_t;
@@ -136,7 +136,9 @@ typedef enum e_tx_done_state
 {
     MODEM_TX_FAILED           = 0,  //!< The frame was not sent
     MODEM_TX_SUCCESS          = 1,  //!< The frame was but not acknowledge
-    MODEM_TX_SUCCESS_WITH_ACK = 2   //!< The frame was and acknowledge
+    MODEM_TX_SUCCESS_WITH_ACK = 2,  //!< The frame was and acknowledge
+    MODEM_TX_STORED           = 3,  //!< The frame was kept in the outbox, it is sent once the network is back
+    MODEM_TX_DROPPED          = 4   //!< The frame was dropped, it waited longer than the max delay of its QoS class
 } e_tx_done_state_t;
 
 /*!
@@ -178,6 +180,7 @@ typedef enum e_ModemClass
 {
     MODEM_CLASS_A = 0x00,  //!< Modem class A
     MODEM_CLASS_C = 0x01,  //!< Modem class C
+    MODEM_CLASS_B = 0x02,  //!< Modem class B
 } modem_class_t;
 
 /*!
@@ -283,6 +286,10 @@ typedef enum e_dm_info
     e_inf_streampar = 0x15,  //!< data stream parameters
     e_inf_appstatus = 0x16,  //!< application-specific status
     e_inf_alcsync   = 0x17,  //!< application layer clock sync data
+    e_inf_rpstats   = 0x18,  //!< radio planner statistics since the previous report (airtime [ms], contention)
+    e_inf_appdata   = 0x19,  //!< application uplink carried by a periodic report (port, payload)
+    e_inf_ramusage  = 0x1A,  //!< static RAM per subsystem, stack and pool high-water marks [byte]
+    e_inf_txslot    = 0x1B,  //!< slotted uplinks (frame period [s], slot length [ms]), disabled with a zero period
     e_inf_max                //!< number of elements
 } e_dm_info_t;
 
@@ -296,7 +303,10 @@ static const uint8_t dm_info_field_sz[e_inf_max] = {
     [e_inf_rstcount] = 2,  [e_inf_deveui] = 8,    [e_inf_rfu_1] = 2,    [e_inf_session] = 2, [e_inf_chipeui] = 8,
     [e_inf_stream]    = 0,  // (variable-length, not sent periodically)
     [e_inf_streampar] = 2, [e_inf_appstatus] = 8,
-    [e_inf_alcsync] = 0  // (variable-length, not sent periodically)
+    [e_inf_alcsync] = 0,  // (variable-length, not sent periodically)
+    [e_inf_rpstats] = 13,
+    [e_inf_appdata]  = 0,  // (variable-length, sent as last field)
+    [e_inf_ramusage] = 20, [e_inf_txslot] = 4
 };
 
 /*!
@@ -329,7 +339,7 @@ typedef struct s_modem_stream
 typedef struct s_modem_dwn
 {
     uint8_t  port;       //!< LoRaWAN FPort
-    uint8_t  data[255];  //!< data received
+    uint8_t* data;       //!< data received, points to the lorawan stack downlink buffer
     uint8_t  length;     //!< data length in byte(s)
     int16_t  rssi;       //!< RSSI is a signed value in dBm + 64
     int16_t  snr;        //!< SNR is a signed value in 0.25 dB steps
@@ -352,20 +362,62 @@ typedef struct s_dm_retrieve_pending_dl
  */
 typedef enum modem_rsp_event
 {
-    RSP_RESET      = 0x00,  //!< Modem has been reset
-    RSP_ALARM      = 0x01,  //!< Alarm timer expired
-    RSP_JOINED     = 0x02,  //!< Network successfully joined
-    RSP_TXDONE     = 0x03,  //!< Frame transmitted
-    RSP_DOWNDATA   = 0x04,  //!< Downlink data received
-    RSP_FILEDONE   = 0x05,  //!< Fileupload completed
-    RSP_SETCONF    = 0x06,  //!< Config has been changed by DM
-    RSP_MUTE       = 0x07,  //!< Modem has been muted or un-muted by DM
-    RSP_STREAMDONE = 0x08,  //!< Stream upload completed (stream data buffer depleted)
-    RSP_LINKSTATUS = 0x09,  //!< Network connectivity status changed
-    RSP_JOINFAIL   = 0x0A,  //!< Attempt to join network failed
-    RSP_NUMBER,             //!< number of elements
+    RSP_RESET        = 0x00,  //!< Modem has been reset
+    RSP_ALARM        = 0x01,  //!< Alarm timer expired
+    RSP_JOINED       = 0x02,  //!< Network successfully joined
+    RSP_TXDONE       = 0x03,  //!< Frame transmitted
+    RSP_DOWNDATA     = 0x04,  //!< Downlink data received
+    RSP_FILEDONE     = 0x05,  //!< Fileupload completed
+    RSP_SETCONF      = 0x06,  //!< Config has been changed by DM
+    RSP_MUTE         = 0x07,  //!< Modem has been muted or un-muted by DM
+    RSP_STREAMDONE   = 0x08,  //!< Stream upload completed (stream data buffer depleted)
+    RSP_LINKSTATUS   = 0x09,  //!< Network connectivity status changed
+    RSP_JOINFAIL     = 0x0A,  //!< Attempt to join network failed
+    RSP_RANGINGDONE  = 0x0B,  //!< Ranging batch or listening ended
+    RSP_FRAGDONE     = 0x0C,  //!< Fragmented file complete in the staging area
+    RSP_RAWRADIODONE = 0x0D,  //!< Raw radio task ended
+    RSP_NUMBER,               //!< number of elements
 } modem_rsp_event_t;
 
+/*!
+ * \typedef modem_event_t
+ * \brief   Event with its decoded payload, given to the handlers set with modem_set_event_handler
+ */
+typedef struct modem_event
+{
+    modem_rsp_event_t type;
+    uint8_t           count;  //!< events lost before this one because the event queue was full
+    union
+    {
+        struct
+        {
+            int8_t         rssi;    //!< RSSI in dBm + 64
+            int8_t         snr;     //!< SNR in 0.25 dB steps
+            uint8_t        flags;   //!< reserved
+            uint8_t        port;    //!< LoRaWAN FPort
+            const uint8_t* data;    //!< only valid during the handler call
+            uint8_t        length;  //!< data length in byte(s)
+        } downdata;                 //!< RSP_DOWNDATA
+        struct
+        {
+            uint8_t        status;  //!< raw_radio_status_t
+            int8_t         rssi;    //!< RSSI in dBm + 64, RAW_RADIO_STATUS_RX_DONE only
+            int8_t         snr;     //!< SNR in dB, LoRa only
+            const uint8_t* data;    //!< only valid during the handler call
+            uint8_t        length;  //!< data length in byte(s)
+        } rawradio;                 //!< RSP_RAWRADIODONE
+        uint16_t reset_count;       //!< RSP_RESET
+        uint8_t  status;            //!< RSP_TXDONE, RSP_FILEDONE, RSP_SETCONF and RSP_RANGINGDONE
+        bool     is_muted;          //!< RSP_MUTE
+    };
+} modem_event_t;
+
+/*!
+ * \typedef modem_event_handler_t
+ * \brief   Handler of one event type
+ */
+typedef void ( *modem_event_handler_t )( const modem_event_t* event );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC CONSTANTS --------------------------------------------------------
@@ -376,7 +428,7 @@ static const uint8_t dm_cmd_len[DM_CMD_MAX][2] = {  // CMD              = {min,
     [DM_FILE_DONE] = { 1, 1 },  [DM_GET_INFO] = { 1, 255 },
     [DM_SET_CONF] = { 2, 255 }, [DM_REJOIN] = { 2, 2 },
     [DM_MUTE] = { 1, 1 },       [DM_SET_DM_INFO] = { 1, e_inf_max },
-    [DM_STREAM] = { 1, 255 },   [DM_ALC_SYNC] = { 1, 255 }
+    [DM_STREAM] = { 2, 255 },   [DM_ALC_SYNC] = { 1, 255 }
 };
 
 /*
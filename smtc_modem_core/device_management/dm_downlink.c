@@ -42,6 +42,8 @@
 #include "device_management_defs.h"
 #include "modem_context.h"
 #include "lorawan_api.h"
+#include "file_upload.h"
+#include "stream.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -77,6 +79,17 @@ static const char* dm_cmd_str[DM_CMD_MAX] = {
  */
 static e_dm_cmd_length_valid dm_check_cmd_size( e_dm_cmd_t cmd, uint8_t length );
 
+/*!
+ * \brief   Length of a DM cmd in a downlink
+ *
+ * \remark  A cmd of fixed length is followed by the next cmd of the downlink, any other one takes the remaining bytes
+ *
+ * \param [in]  cmd                         Dm code of the cmd
+ * \param [in]  remaining                   Bytes left in the downlink after the dm code
+ * \param [out] uint8_t                     Return the length of the cmd data
+ */
+static uint8_t dm_cmd_length_get( e_dm_cmd_t cmd, uint8_t remaining );
+
 /*!
  * \brief   DM Reset
  *
@@ -94,17 +107,15 @@ static e_dm_error_t dm_reset( e_dm_reset_code_t reset_code, uint16_t reset_sessi
 e_dm_error_t dm_downlink( uint8_t* data, uint8_t length )
 {
     s_dm_cmd_input_t dm_input;
+    e_dm_error_t     ret = DM_OK;
     if( length <= DM_DOWNLINK_HEADER_LENGTH )
     {
         BSP_DBG_TRACE_ERROR( "DM Downlink must contain at least 4 bytes\n" );
         return DM_ERROR;
     }
 
-    dm_input.up_count     = data[0];
-    dm_input.up_delay     = data[1];
-    dm_input.request_code = ( e_dm_cmd_t ) data[2];
-    dm_input.buffer       = &data[3];
-    dm_input.buffer_len   = length - DM_DOWNLINK_HEADER_LENGTH;
+    dm_input.up_count = data[0];
+    dm_input.up_delay = data[1];
 
     set_dm_retrieve_pending_dl( dm_input.up_count, dm_input.up_delay );
 
@@ -113,7 +124,33 @@ e_dm_error_t dm_downlink( uint8_t* data, uint8_t length )
         modem_supervisor_add_task_retrieve_dl( dm_input.up_delay );
     }
 
-    return dm_parse_cmd( &dm_input );
+    // all the cmds of the downlink are checked before the first one is run
+    for( uint8_t index = DM_DOWNLINK_HEADER_LENGTH - 1; index < length; )
+    {
+        uint8_t cmd_len = dm_cmd_length_get( ( e_dm_cmd_t ) data[index], length - index - 1 );
+        if( dm_check_cmd_size( ( e_dm_cmd_t ) data[index], cmd_len ) != DM_CMD_LENGTH_VALID )
+        {
+            return DM_ERROR;
+        }
+        index += 1 + cmd_len;
+    }
+
+    // the settings changed by the cmds are written once, after the last one
+    modem_store_context_hold( );
+    for( uint8_t index = DM_DOWNLINK_HEADER_LENGTH - 1; index < length; )
+    {
+        dm_input.request_code = ( e_dm_cmd_t ) data[index];
+        dm_input.buffer       = &data[index + 1];
+        dm_input.buffer_len   = dm_cmd_length_get( dm_input.request_code, length - index - 1 );
+        if( dm_parse_cmd( &dm_input ) != DM_OK )
+        {
+            ret = DM_ERROR;
+        }
+        index += 1 + dm_input.buffer_len;
+    }
+    modem_store_context_release( );
+
+    return ret;
 }
 
 e_dm_error_t dm_parse_cmd( s_dm_cmd_input_t* cmd_input )
@@ -142,28 +179,40 @@ e_dm_error_t dm_parse_cmd( s_dm_cmd_input_t* cmd_input )
     case DM_FUOTA:
         // Not supported yet
         break;
-    case DM_FILE_DONE:
+    case DM_FILE_DONE: {
+        uint8_t sid = ( cmd_input->buffer[0] >> 4 ) & 0x03;
         BSP_DBG_TRACE_WARNING( "DM_FILE_DONE donwlink\n" );
-        if( modem_get_upload_state( ) != MODEM_UPLOAD_START )
+        if( modem_get_upload_state( sid ) != MODEM_UPLOAD_START )
         {
             BSP_DBG_TRACE_ERROR( "No FileUpload ongoing\n" );
             break;
         }
 
-        if( modem_get_dm_upload_sctr( ) == ( cmd_input->buffer[0] & 0xf ) )  // Be careful : Session ID is not checked
+        if( ( file_upload_get_session_counter( sid ) & 0xf ) == ( cmd_input->buffer[0] & 0xf ) )
         {
-            set_modem_status_file_upload( false );  // to terminate the file upload
-            increment_asynchronous_msgnumber( RSP_FILEDONE, 0x01 );
-            modem_set_upload_state( MODEM_UPLOAD_NOT_INIT );
-            modem_supervisor_remove_task( FILE_UPLOAD_TASK );
+            increment_asynchronous_msgnumber( RSP_FILEDONE, 0x01 | ( sid << 4 ) );
+            file_upload_end( sid );
+            modem_set_upload_state( sid, MODEM_UPLOAD_NOT_INIT );
+            // the task goes on while other sessions are started, it skips this one now
+            bool is_upload_started = false;
+            for( uint8_t i = 0; i < FILE_UPLOAD_MAX_SESSIONS; i++ )
+            {
+                is_upload_started |= ( modem_get_upload_state( i ) == MODEM_UPLOAD_START );
+            }
+            if( is_upload_started == false )
+            {
+                set_modem_status_file_upload( false );  // to terminate the file upload
+                modem_supervisor_remove_task( FILE_UPLOAD_TASK );
+            }
         }
         else
         {
             BSP_DBG_TRACE_ERROR( "DM_FILE_DONE bad session_counter %d compare to %d\n", cmd_input->buffer[0],
-                                 modem_get_dm_upload_sctr( ) );
+                                 file_upload_get_session_counter( sid ) );
         }
 
         break;
+    }
     case DM_GET_INFO:
         if( set_dm_info( cmd_input->buffer, cmd_input->buffer_len, DM_INFO_NOW ) != SET_OK )
         {
@@ -210,7 +259,20 @@ e_dm_error_t dm_parse_cmd( s_dm_cmd_input_t* cmd_input )
 
         break;
     case DM_STREAM:
-        // Not supported yet
+        if( ( modem_get_stream_state( ) == MODEM_STREAM_NOT_INIT ) ||
+            ( stream_feedback( cmd_input->buffer, cmd_input->buffer_len ) == false ) )
+        {
+            BSP_DBG_TRACE_WARNING( "DM_STREAM feedback discarded\n" );
+            break;
+        }
+        // the bytes reported lost restart a stream that already ended
+        if( ( stream_is_pending( ) == true ) && ( modem_get_stream_state( ) == MODEM_STREAM_INIT ) &&
+            ( get_join_state( ) == MODEM_JOINED ) )
+        {
+            modem_set_stream_state( MODEM_STREAM_DATA_PENDING );
+            set_modem_status_streaming( true );
+            modem_supervisor_add_task_stream( );
+        }
         break;
     case DM_ALC_SYNC:
         // Not supported yet
@@ -250,6 +312,15 @@ static e_dm_cmd_length_valid dm_check_cmd_size( e_dm_cmd_t cmd, uint8_t length )
     return DM_CMD_LENGTH_VALID;
 }
 
+static uint8_t dm_cmd_length_get( e_dm_cmd_t cmd, uint8_t remaining )
+{
+    if( ( cmd < DM_CMD_MAX ) && ( dm_cmd_len[cmd][0] == dm_cmd_len[cmd][1] ) && ( dm_cmd_len[cmd][0] <= remaining ) )
+    {
+        return dm_cmd_len[cmd][0];
+    }
+    return remaining;
+}
+
 static e_dm_error_t dm_reset( e_dm_reset_code_t reset_code, uint16_t reset_session )
 {
     e_dm_error_t ret = DM_OK;
@@ -263,6 +334,7 @@ static e_dm_error_t dm_reset( e_dm_reset_code_t reset_code, uint16_t reset_sessi
         case DM_RESET_BOTH:
             modem_store_context( );
             lorawan_api_context_save( );
+            modem_store_context_flush( );
             bsp_mcu_reset( );
             break;
         default:
@@ -65,6 +65,10 @@ extern "C" {
 /*!
  * \brief   Handle DM Downlink
  *
+ * \remark  The header is followed by one or more cmds. A cmd of fixed length can be followed by another cmd, any
+ *          other cmd ends the downlink. The cmds are run in order once all their lengths are checked, and the
+ *          settings they change are written to nvm once.
+ *
  * \param [in]  data *                      Payload received
  * \param [in]  length                      Payload length
  * \retval      e_dm_error_t                Return ok or not in case of failure
@@ -42,8 +42,20 @@
 #include "device_management_defs.h"
 #include "lorawan_api.h"
 #include "modem_utilities.h"  // for crc
+#include "lr1mac_utilities.h"
 #include "modem_api.h"
 
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+// port, interval, upload sctr, dm info bitfield, muted days and host baudrate: the journal record of the config
+#define MODEM_CONFIG_SIZE 9
+
+// the changed contexts are written once no other change came for this delay, a burst of settings is written once
+#define MODEM_CONTEXT_FLUSH_DELAY_MS 1000
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
@@ -52,12 +64,13 @@
 static uint8_t                modem_status         = 0;
 static uint8_t                modem_dm_interval    = DEFAULT_DM_REPORTING_INTERVAL;
 static uint8_t                modem_dm_port        = DEFAULT_DM_PORT;
+static uint8_t                modem_host_baudrate  = DEFAULT_HOST_BAUDRATE_INDEX;
 static uint8_t                modem_appstatus[8]   = { 0 };
 static modem_class_t          modem_dm_class       = MODEM_CLASS_A;
 static e_modem_suspend_t      is_modem_suspend     = MODEM_NOT_SUSPEND;
 static uint32_t               modem_start_time     = 0;
 static uint8_t                modem_dm_upload_sctr = 0;
-static e_modem_upload_state_t modem_upload_state   = MODEM_UPLOAD_NOT_INIT;
+static e_modem_upload_state_t modem_upload_state[FILE_UPLOAD_MAX_SESSIONS];  // MODEM_UPLOAD_NOT_INIT
 static s_modem_stream_t       modem_stream_state   = {  //
     .port       = DEFAULT_DM_PORT,              //
     .state      = MODEM_STREAM_NOT_INIT,        //
@@ -69,19 +82,72 @@ static uint32_t dm_info_bitfield_now            = 0;
 static uint8_t  tag_number                      = 0;
 static uint8_t  tag_number_now                  = 0;
 static uint8_t  number_of_muted_day             = 0;
-static s_dm_retrieve_pending_dl_t dm_pending_dl = { .up_count = 0, .up_delay = 0 };
-static uint32_t                   user_alarm    = 0;
 
-static uint8_t asynchronous_msgnumber = 0;
+/*!
+ * DM delta reporting: a periodic report only carries the fields that moved beyond their threshold since they were
+ * last sent, one report every dm_delta_keyframe_period is a full one. Disabled when the period is 0.
+ * The values last sent are kept as is up to 4 bytes, as their crc above
+ */
+static uint8_t  dm_delta_keyframe_period      = 0;
+static uint8_t  dm_delta_report_count         = 0;
+static bool     is_dm_delta_keyframe          = true;
+static uint32_t dm_delta_last_sent[e_inf_max] = { 0 };
+static uint16_t dm_delta_threshold[e_inf_max] = {
+    [e_inf_charge] = 1,    // mAh
+    [e_inf_voltage] = 5,   // 1/50 V
+    [e_inf_temp] = 3,      // deg Celsius
+    [e_inf_signal] = 6,    // dB of rssi
+    [e_inf_uptime] = 24,   // h
+    [e_inf_rxtime] = 24,   // h
+};
+static s_dm_retrieve_pending_dl_t dm_pending_dl             = { .up_count = 0, .up_delay = 0 };
+static uint32_t                   user_alarm                = 0;
+static uint8_t                    modem_task_jitter_percent = 0;
+static uint32_t                   modem_task_jitter_state   = 0;  // pseudo random sequence, seeded with the DevEUI
+
+/*!
+ * Asynchronous events, queued in time order: the records are kept in a ring of MODEM_EVENT_FIFO_NB slots and their
+ * payloads are appended in the same order to a MODEM_EVENT_FIFO_DATA_SIZE bytes ring, so both drain together
+ */
+static s_modem_event_t modem_event_fifo[MODEM_EVENT_FIFO_NB];
+static uint8_t         modem_event_fifo_data[MODEM_EVENT_FIFO_DATA_SIZE];
+static uint8_t         modem_event_fifo_first    = 0;
+static uint8_t         modem_event_fifo_nb       = 0;
+static uint16_t        modem_event_data_first    = 0;
+static uint16_t        modem_event_data_used     = 0;
+static uint8_t         modem_event_dropped_count = 0;
 
-static uint8_t modem_event_count[RSP_NUMBER];
-static uint8_t modem_event_status[RSP_NUMBER];
-static uint8_t asynch_msg[RSP_NUMBER];
+static modem_event_handler_t modem_event_handlers[RSP_NUMBER] = { NULL };
 
 static s_modem_dwn_t modem_dwn_pkt;
-static bool          is_modem_reset_requested = false;
-static bool          is_modem_charge_loaded   = false;
-static uint32_t      modem_charge_offset      = 0;
+static bool          is_modem_reset_requested   = false;
+static bool          is_modem_tx_coalescing     = false;
+static struct
+{
+    uint8_t     f_port;  // 0 for a free entry, port 0 never carries application uplinks
+    modem_qos_t qos;
+} modem_port_qos[MODEM_QOS_PORT_NB];
+static bool          is_modem_store_and_forward = false;
+static bool          is_modem_dm_piggyback      = false;
+static bool          is_modem_charge_loaded     = false;
+static bool          is_modem_context_dirty     = false;
+static bool          is_modem_context_pending   = false;  // modem or LoRaWAN context waiting for its write
+static bool          is_modem_context_held      = false;
+static uint32_t      modem_context_change_ms    = 0;
+static uint32_t      modem_charge_offset        = 0;
+
+/*!
+ * MCU charge accounting: power state times at the last reset and update, charge accumulated since the last reset in
+ * uA.ms
+ */
+static bsp_mcu_power_stats_t modem_mcu_power_stats_reset = { 0 };
+static bsp_mcu_power_stats_t modem_mcu_power_stats_last  = { 0 };
+static uint64_t              modem_mcu_charge_ua_ms      = 0;
+
+/*!
+ * Radio planner statistics at the previous read of each reader
+ */
+static modem_rp_stats_t modem_rp_stats_last[MODEM_RP_STATS_READER_NB];
 
 /*
  * -----------------------------------------------------------------------------
@@ -106,7 +172,7 @@ static e_set_error_t convert_requested_dm_info_bytes_to_bitfield( uint8_t* reque
         // Ignore DM status with variable length and forbiden fields
         if( ( requested_info_list[i] == e_inf_crashlog ) || ( requested_info_list[i] == e_inf_upload ) ||
             ( requested_info_list[i] == e_inf_stream ) || ( requested_info_list[i] == e_inf_alcsync ) ||
-            ( requested_info_list[i] == e_inf_rfu_0 ) || ( requested_info_list[i] == e_inf_rfu_1 ) ||
+            ( requested_info_list[i] == e_inf_appdata ) || ( requested_info_list[i] == e_inf_rfu_0 ) || ( requested_info_list[i] == e_inf_rfu_1 ) ||
             ( requested_info_list[i] >= e_inf_max ) )
         {
             ret = SET_ERROR;
@@ -149,137 +215,360 @@ static e_dm_cmd_length_valid check_dm_status_max_size( uint32_t info_requested,
     return DM_CMD_LENGTH_VALID;
 }
 
-/*
- * -----------------------------------------------------------------------------
- * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+/*!
+ * \brief   Value of a DM info field compared by the delta reporting
+ *
+ * \param [in]  tag                         DM info code
+ * \param [in]  field                       Field as sent in the DM report
+ * \param [out] uint32_t                    Field value, its crc for fields above 4 bytes
  */
-
-void modem_event_init( void )
+static uint32_t dm_delta_value_get( e_dm_info_t tag, uint8_t* field )
 {
-    for( int i = 0; i < RSP_NUMBER; i++ )
+    uint32_t value = 0;
+
+    switch( tag )
     {
-        set_modem_event_count( ( modem_rsp_event_t ) i, 0 );
-        set_modem_event_status( ( modem_rsp_event_t ) i, 0 );
+    case e_inf_temp:
+        return ( uint32_t )( int8_t ) field[0];
+    case e_inf_signal:  // the snr only follows the rssi
+        return field[0];
+    default:
+        break;
     }
-}
 
-uint8_t get_modem_event_count( modem_rsp_event_t event_type )
-{
-    if( event_type >= RSP_NUMBER )
+    if( dm_info_field_sz[tag] > sizeof( value ) )
     {
-        bsp_mcu_panic( );
+        return crc( field, dm_info_field_sz[tag] );
     }
-
-    return ( modem_event_count[event_type] );
-}
-
-void set_modem_event_count( modem_rsp_event_t event_type, uint8_t value )
-{
-    if( event_type < RSP_NUMBER )
+    for( uint8_t i = dm_info_field_sz[tag]; i > 0; i-- )
     {
-        modem_event_count[event_type] = value;
+        value = ( value << 8 ) | field[i - 1];
     }
+    return value;
 }
 
-void increment_modem_event_count( modem_rsp_event_t event_type )
+/*!
+ * \brief   Check if a DM info field can be left out of a periodic report
+ *
+ * \param [in]  tag                         DM info code
+ * \param [in]  field                       Field as sent in the DM report
+ * \param [out] bool                        Return true if the field did not move beyond its threshold
+ */
+static bool dm_delta_is_unchanged( e_dm_info_t tag, uint8_t* field )
 {
-    if( event_type < RSP_NUMBER )
+    if( ( dm_delta_keyframe_period == 0 ) || ( is_dm_delta_keyframe == true ) )
     {
-        if( modem_event_count[event_type] < 255 )
+        return false;
+    }
+    if( tag == e_inf_rpstats )
+    {  // counted since the previous report: the counts would be lost if they were left out
+        for( uint8_t i = 0; i < dm_info_field_sz[tag]; i++ )
         {
-            modem_event_count[event_type]++;
+            if( field[i] != 0 )
+            {
+                return false;
+            }
         }
+        return true;
     }
-}
 
-uint8_t get_modem_event_status( modem_rsp_event_t event_type )
-{
-    if( event_type >= RSP_NUMBER )
+    int32_t delta = ( int32_t )( dm_delta_value_get( tag, field ) - dm_delta_last_sent[tag] );
+    if( dm_delta_threshold[tag] == 0 )
     {
-        bsp_mcu_panic( );
+        return ( delta == 0 );
     }
-    return ( modem_event_status[event_type] );
+    return ( ( ( delta < 0 ) ? -delta : delta ) < dm_delta_threshold[tag] );
 }
 
-void set_modem_event_status( modem_rsp_event_t event_type, uint8_t status )
+/*!
+ * \brief   Append one byte to the payload ring of the event fifo, the caller has checked the room left
+ *
+ * \param [in]  byte                        Payload byte
+ */
+static void modem_event_data_push( uint8_t byte )
 {
-    if( event_type < RSP_NUMBER )
-    {
-        modem_event_status[event_type] = status;
-    }
+    modem_event_fifo_data[( modem_event_data_first + modem_event_data_used ) % MODEM_EVENT_FIFO_DATA_SIZE] = byte;
+    modem_event_data_used++;
 }
 
-void decrement_asynchronous_msgnumber( void )
+/*!
+ * \brief   Date of a periodic task, spread around its nominal delay
+ * \remark  The offset is drawn within +/- half the jitter percent of the delay from a sequence seeded with the DevEUI:
+ *          devices reset together do not send in lockstep and the mean period is kept.
+ *
+ * \param [in]  next_execute                Nominal delay [s]
+ * \param [out] uint64_t                    Date of the task [ms]
+ */
+static uint64_t modem_task_time_to_execute_ms( uint32_t next_execute )
 {
-    if( asynchronous_msgnumber > 0 )
-    {
-        asynchronous_msgnumber--;
-    }
-    else
+    uint64_t delay_ms = ( uint64_t ) next_execute * 1000;
+    uint32_t span_ms  = ( uint32_t ) MIN( delay_ms * modem_task_jitter_percent / 100, 0xFFFFFFFE );
+
+    if( span_ms > 0 )
     {
-        asynchronous_msgnumber = 0;
+        if( modem_task_jitter_state == 0 )
+        {
+            uint8_t deveui[8];
+            lorawan_api_deveui_get( deveui );
+            modem_task_jitter_state = crc( deveui, 8 ) | 1;  // a xorshift state never comes back from zero
+        }
+        modem_task_jitter_state ^= modem_task_jitter_state << 13;
+        modem_task_jitter_state ^= modem_task_jitter_state >> 17;
+        modem_task_jitter_state ^= modem_task_jitter_state << 5;
+        delay_ms = delay_ms - ( span_ms / 2 ) + ( modem_task_jitter_state % ( span_ms + 1 ) );
     }
+    return bsp_rtc_get_time_ms64( ) + delay_ms;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void modem_event_init( void )
+{
+    modem_event_fifo_first    = 0;
+    modem_event_fifo_nb       = 0;
+    modem_event_data_first    = 0;
+    modem_event_data_used     = 0;
+    modem_event_dropped_count = 0;
 }
 
 uint8_t get_asynchronous_msgnumber( void )
 {
-    return ( asynchronous_msgnumber );
+    return ( modem_event_fifo_nb );
 }
 
 void increment_asynchronous_msgnumber( modem_rsp_event_t event_type, uint8_t status )
 {
-    // Next condition should never append because only one asynch msg by type of message
-    if( asynchronous_msgnumber > RSP_NUMBER )
+    const s_modem_dwn_t* dwnframe    = get_modem_downlink_frame( );
+    uint8_t              data_length = 0;
+
+    if( event_type >= RSP_NUMBER )
     {
-        BSP_DBG_TRACE_ERROR( " Modem reach the max number of asynch message" );
         return;
     }
-    uint8_t tmp;
-    tmp = get_modem_event_count( event_type );
-    if( tmp == 0 )
+
+    if( event_type == RSP_DOWNDATA )
+    {
+        data_length = 4 + MIN( dwnframe->length, MODEM_EVENT_DATA_MAX_SIZE - 4 );
+    }
+    else if( event_type == RSP_RESET )
+    {
+        data_length = 2;
+    }
+    else if( event_type == RSP_RAWRADIODONE )
+    {
+        data_length = ( status == RAW_RADIO_STATUS_RX_DONE )
+                          ? 3 + MIN( raw_radio_rx_frame_get( )->length, MODEM_EVENT_DATA_MAX_SIZE - 3 )
+                          : 3;
+    }
+    else if( ( event_type == RSP_TXDONE ) || ( event_type == RSP_FILEDONE ) || ( event_type == RSP_SETCONF ) ||
+             ( event_type == RSP_MUTE ) || ( event_type == RSP_RANGINGDONE ) || ( event_type == RSP_LINKSTATUS ) )
+    {
+        data_length = 1;
+    }
+
+    // an event without payload identical to the newest queued one is merged in it, the order is kept
+    if( ( data_length == 0 ) && ( modem_event_fifo_nb > 0 ) && ( modem_event_handlers[event_type] == NULL ) )
+    {
+        s_modem_event_t* last =
+            &modem_event_fifo[( modem_event_fifo_first + modem_event_fifo_nb - 1 ) % MODEM_EVENT_FIFO_NB];
+        if( ( last->type == event_type ) && ( last->data_length == 0 ) )
+        {
+            last->count = MIN( last->count + 1, 255 );
+            return;
+        }
+    }
+
+    if( ( modem_event_fifo_nb >= MODEM_EVENT_FIFO_NB ) ||
+        ( ( modem_event_data_used + data_length ) > MODEM_EVENT_FIFO_DATA_SIZE ) )
     {
-        asynchronous_msgnumber++;
+        // the queued events are kept, the loss is reported in the count of the next popped event
+        modem_event_dropped_count = MIN( modem_event_dropped_count + 1, 255 );
+        BSP_DBG_TRACE_ERROR( "event fifo full, event 0x%02x dropped\n", event_type );
+        return;
     }
 
-    increment_modem_event_count( event_type );
-    set_modem_event_status( event_type, status );
+    s_modem_event_t* event = &modem_event_fifo[( modem_event_fifo_first + modem_event_fifo_nb ) % MODEM_EVENT_FIFO_NB];
+    event->type            = event_type;
+    event->count           = 0;
+    event->data_length     = data_length;
+    modem_event_fifo_nb++;
+
+    if( event_type == RSP_DOWNDATA )
+    {
+        // the frame is copied now: the stack downlink buffer is reused by the next reception
+        modem_event_data_push( dwnframe->rssi );
+        modem_event_data_push( dwnframe->snr );
+        // TODO UL_ACK() | lorawan_api_GetRxWindow()
+        modem_event_data_push( 0 );
+        modem_event_data_push( dwnframe->port );
+        for( uint8_t i = 0; i < ( data_length - 4 ); i++ )
+        {
+            modem_event_data_push( dwnframe->data[i] );
+        }
+    }
+    else if( event_type == RSP_RESET )
+    {
+        modem_event_data_push( lorawan_api_nb_reset_get( ) & 0xFF );
+        modem_event_data_push( lorawan_api_nb_reset_get( ) >> 8 );
+    }
+    else if( event_type == RSP_MUTE )
+    {
+        modem_event_data_push( ( get_modem_muted( ) == MODEM_NOT_MUTE ) ? false : true );
+    }
+    else if( event_type == RSP_RAWRADIODONE )
+    {
+        // the frame is copied now: the next reception reuses the buffer
+        const raw_radio_rx_frame_t* frame = raw_radio_rx_frame_get( );
+        modem_event_data_push( status );
+        modem_event_data_push( ( uint8_t )( frame->rssi_in_dbm + 64 ) );
+        modem_event_data_push( ( uint8_t ) frame->snr_in_db );
+        for( uint8_t i = 0; i < ( data_length - 3 ); i++ )
+        {
+            modem_event_data_push( frame->payload[i] );
+        }
+    }
+    else if( data_length > 0 )
+    {
+        modem_event_data_push( status );
+    }
 
     switch( event_type )
     {
     case RSP_JOINED:
-        BSP_DBG_TRACE_INFO( "increment event RSP_JOINED\n" );
+        BSP_DBG_TRACE_INFO( "push event RSP_JOINED\n" );
         break;
     case RSP_ALARM:
-        BSP_DBG_TRACE_INFO( "increment event RSP_ALARM\n" );
+        BSP_DBG_TRACE_INFO( "push event RSP_ALARM\n" );
         break;
     case RSP_DOWNDATA:
-        BSP_DBG_TRACE_INFO( "increment event RSP_DOWNDATA\n" );
+        BSP_DBG_TRACE_INFO( "push event RSP_DOWNDATA\n" );
         break;
     case RSP_TXDONE:
-        BSP_DBG_TRACE_INFO( "event count tx done = %d\n", get_modem_event_count( RSP_TXDONE ) );
+        BSP_DBG_TRACE_INFO( "push event RSP_TXDONE, status %d\n", status );
+        BSP_PERF_EVENT( BSP_PERF_EVENT_TX_EVENT, 0 );
         break;
     case RSP_FILEDONE:
-        BSP_DBG_TRACE_INFO( "increment event RSP_FILEDONE\n" );
+        BSP_DBG_TRACE_INFO( "push event RSP_FILEDONE\n" );
         break;
     case RSP_STREAMDONE:
-        BSP_DBG_TRACE_INFO( "increment event RSP_STREAMDONE\n" );
+        BSP_DBG_TRACE_INFO( "push event RSP_STREAMDONE\n" );
         break;
     case RSP_SETCONF:
-        BSP_DBG_TRACE_INFO( "increment event RSP_SETCONF\n" );
+        BSP_DBG_TRACE_INFO( "push event RSP_SETCONF\n" );
         break;
     case RSP_MUTE:
-        BSP_DBG_TRACE_INFO( "increment event RSP_MUTE\n" );
+        BSP_DBG_TRACE_INFO( "push event RSP_MUTE\n" );
+        break;
+    case RSP_RANGINGDONE:
+        BSP_DBG_TRACE_INFO( "push event RSP_RANGINGDONE, status %d\n", status );
+        break;
+    case RSP_FRAGDONE:
+        BSP_DBG_TRACE_INFO( "push event RSP_FRAGDONE\n" );
+        break;
+    case RSP_RAWRADIODONE:
+        BSP_DBG_TRACE_INFO( "push event RSP_RAWRADIODONE, status %d\n", status );
         break;
     default:
 
         break;
     }
-    asynch_msg[asynchronous_msgnumber] = event_type;
 }
 
-modem_rsp_event_t get_last_msg_event( void )
+uint8_t get_modem_event_data_length( void )
 {
-    return ( modem_rsp_event_t ) asynch_msg[asynchronous_msgnumber];
+    if( modem_event_fifo_nb == 0 )
+    {
+        return 0;
+    }
+    return ( modem_event_fifo[modem_event_fifo_first].data_length );
+}
+
+bool modem_event_pop( modem_rsp_event_t* type, uint8_t* count, uint8_t* data, uint8_t* data_length )
+{
+    if( modem_event_fifo_nb == 0 )
+    {
+        return false;
+    }
+
+    const s_modem_event_t* event = &modem_event_fifo[modem_event_fifo_first];
+    *type                        = event->type;
+    *count                       = MIN( event->count + modem_event_dropped_count, 255 );
+    *data_length                 = event->data_length;
+    for( uint16_t i = 0; i < event->data_length; i++ )
+    {
+        data[i] = modem_event_fifo_data[( modem_event_data_first + i ) % MODEM_EVENT_FIFO_DATA_SIZE];
+    }
+
+    modem_event_data_first = ( modem_event_data_first + event->data_length ) % MODEM_EVENT_FIFO_DATA_SIZE;
+    modem_event_data_used -= event->data_length;
+    modem_event_fifo_first    = ( modem_event_fifo_first + 1 ) % MODEM_EVENT_FIFO_NB;
+    modem_event_dropped_count = 0;
+    modem_event_fifo_nb--;
+    return true;
+}
+
+void set_modem_event_handler( modem_rsp_event_t event_type, modem_event_handler_t handler )
+{
+    if( event_type < RSP_NUMBER )
+    {
+        modem_event_handlers[event_type] = handler;
+    }
+}
+
+void modem_event_dispatch( bool is_unhandled_dropped )
+{
+    uint8_t       data[MODEM_EVENT_DATA_MAX_SIZE];
+    uint8_t       data_length;
+    modem_event_t event;
+
+    while( modem_event_fifo_nb > 0 )
+    {
+        modem_event_handler_t handler = modem_event_handlers[modem_event_fifo[modem_event_fifo_first].type];
+
+        if( ( handler == NULL ) && ( is_unhandled_dropped == false ) )
+        {
+            break;
+        }
+        modem_event_pop( &event.type, &event.count, data, &data_length );
+        if( handler == NULL )
+        {
+            continue;
+        }
+
+        // the payload is decoded as it was pushed by increment_asynchronous_msgnumber
+        switch( event.type )
+        {
+        case RSP_DOWNDATA:
+            event.downdata.rssi   = ( int8_t ) data[0];
+            event.downdata.snr    = ( int8_t ) data[1];
+            event.downdata.flags  = data[2];
+            event.downdata.port   = data[3];
+            event.downdata.data   = &data[4];
+            event.downdata.length = data_length - 4;
+            break;
+        case RSP_RESET:
+            event.reset_count = data[0] | ( ( uint16_t ) data[1] << 8 );
+            break;
+        case RSP_MUTE:
+            event.is_muted = ( data[0] != 0 ) ? true : false;
+            break;
+        case RSP_RAWRADIODONE:
+            event.rawradio.status = data[0];
+            event.rawradio.rssi   = ( int8_t ) data[1];
+            event.rawradio.snr    = ( int8_t ) data[2];
+            event.rawradio.data   = &data[3];
+            event.rawradio.length = data_length - 3;
+            break;
+        default:
+            event.status = ( data_length > 0 ) ? data[0] : 0;
+            break;
+        }
+        // the handler may raise new events, they are dispatched by this loop as well
+        handler( &event );
+    }
 }
 
 uint32_t get_modem_uptime_s( void )
@@ -339,7 +628,8 @@ uint32_t get_modem_dm_interval_second( void )
 
 e_set_error_t set_modem_class( modem_class_t LoRaWAN_class )
 {
-    if( LoRaWAN_class != MODEM_CLASS_A )
+    if( ( LoRaWAN_class != MODEM_CLASS_A ) && ( LoRaWAN_class != MODEM_CLASS_C ) &&
+        ( LoRaWAN_class != MODEM_CLASS_B ) )
     {
         BSP_DBG_TRACE_ERROR( "modem class invalid" );
         return ( SET_ERROR );
@@ -347,6 +637,10 @@ e_set_error_t set_modem_class( modem_class_t LoRaWAN_class )
     else
     {
         modem_dm_class = LoRaWAN_class;
+        // the class B ping slots and the class C reception share the same hook, one is stopped before the other
+        lorawan_api_class_b_enable_set( false );
+        lorawan_api_class_c_enable_set( LoRaWAN_class == MODEM_CLASS_C );
+        lorawan_api_class_b_enable_set( LoRaWAN_class == MODEM_CLASS_B );
         return ( SET_OK );
     }
 }
@@ -379,10 +673,24 @@ uint8_t get_modem_dm_port( void )
     return ( modem_dm_port );
 }
 
+void set_modem_host_baudrate( uint8_t baudrate_index )
+{
+    if( modem_host_baudrate != baudrate_index )
+    {
+        modem_host_baudrate = baudrate_index;
+        modem_store_context( );
+    }
+}
+
+uint8_t get_modem_host_baudrate( void )
+{
+    return ( modem_host_baudrate );
+}
+
 dr_strategy_t get_modem_adr( void )
 {
     uint8_t user_dr = ( uint8_t )( lorawan_api_dr_strategy_get( ) );
-    if( user_dr > USER_DR_DISTRIBUTION )
+    if( user_dr >= UNKNOWN_DR )
     {
         BSP_DBG_TRACE_ERROR( "unknown default case : get_modem_adr \n" );
         bsp_mcu_panic( );
@@ -442,11 +750,12 @@ void modem_supervisor_add_task_join( void )
     task_join.id       = JOIN_TASK;
     task_join.priority = TASK_HIGH_PRIORITY;
 #ifdef TEST_BYPASS_JOIN_DUTY_CYCLE
-    task_join.time_to_execute_s = bsp_rng_get_random_in_range( 0, 5 );
+    task_join.time_to_execute_ms = bsp_rng_get_random_in_range( 0, 5000 );
 #else
-    task_join.time_to_execute_s = lorawan_api_next_join_time_second_get( ) + bsp_rng_get_random_in_range( 0, 5 );
+    task_join.time_to_execute_ms =
+        ( ( uint64_t ) lorawan_api_next_join_time_second_get( ) * 1000 ) + bsp_rng_get_random_in_range( 0, 5000 );
 #endif
-    BSP_DBG_TRACE_PRINTF( " Start a New join at %ld seconds \n", task_join.time_to_execute_s );
+    BSP_DBG_TRACE_PRINTF( " Start a New join at %lu ms \n", ( uint32_t ) task_join.time_to_execute_ms );
     set_modem_status_joining( true );
     modem_supervisor_add_task( &task_join );
 }
@@ -454,10 +763,10 @@ void modem_supervisor_add_task_join( void )
 void modem_supervisor_add_task_dm_status( uint32_t next_execute )
 {
     smodem_task task_dm;
-    task_dm.id                = DM_TASK;
-    task_dm.priority          = TASK_LOW_PRIORITY;
-    task_dm.PacketType        = UNCONF_DATA_UP;
-    task_dm.time_to_execute_s = bsp_rtc_get_time_s( ) + next_execute;
+    task_dm.id                 = DM_TASK;
+    task_dm.priority           = TASK_LOW_PRIORITY;
+    task_dm.PacketType         = UNCONF_DATA_UP;
+    task_dm.time_to_execute_ms = modem_task_time_to_execute_ms( next_execute );
     if( get_join_state( ) == MODEM_JOINED )
     {
         modem_supervisor_add_task( &task_dm );
@@ -467,21 +776,22 @@ void modem_supervisor_add_task_dm_status( uint32_t next_execute )
 void modem_supervisor_add_task_dm_status_now( void )
 {
     smodem_task task_dm;
-    task_dm.id         = DM_TASK_NOW;
-    task_dm.priority   = TASK_LOW_PRIORITY;
-    task_dm.PacketType = UNCONF_DATA_UP;
-    task_dm.time_to_execute_s =
-        bsp_rtc_get_time_s( ) + bsp_rng_get_random_in_range( DM_STATUS_NOW_MIN_TIME, DM_STATUS_NOW_MAX_TIME );
+    task_dm.id                 = DM_TASK_NOW;
+    task_dm.priority           = TASK_LOW_PRIORITY;
+    task_dm.PacketType         = UNCONF_DATA_UP;
+    task_dm.time_to_execute_ms =
+        bsp_rtc_get_time_ms64( ) +
+        bsp_rng_get_random_in_range( DM_STATUS_NOW_MIN_TIME * 1000, DM_STATUS_NOW_MAX_TIME * 1000 );
     modem_supervisor_add_task( &task_dm );
 }
 
 void modem_supervisor_add_task_alc_sync_time_req( uint32_t next_execute )
 {
     smodem_task task_dm;
-    task_dm.id                = ALC_SYNC_TIME_REQ_TASK;
-    task_dm.priority          = TASK_HIGH_PRIORITY;
-    task_dm.PacketType        = UNCONF_DATA_UP;
-    task_dm.time_to_execute_s = bsp_rtc_get_time_s( ) + next_execute;
+    task_dm.id                 = ALC_SYNC_TIME_REQ_TASK;
+    task_dm.priority           = TASK_HIGH_PRIORITY;
+    task_dm.PacketType         = UNCONF_DATA_UP;
+    task_dm.time_to_execute_ms = modem_task_time_to_execute_ms( next_execute );
     if( get_join_state( ) == MODEM_JOINED )
     {
         modem_supervisor_add_task( &task_dm );
@@ -491,10 +801,10 @@ void modem_supervisor_add_task_alc_sync_time_req( uint32_t next_execute )
 void modem_supervisor_add_task_alc_sync_ans( uint32_t next_execute )
 {
     smodem_task task_dm;
-    task_dm.id                = ALC_SYNC_ANS_TASK;
-    task_dm.priority          = TASK_HIGH_PRIORITY;
-    task_dm.PacketType        = UNCONF_DATA_UP;
-    task_dm.time_to_execute_s = bsp_rtc_get_time_s( ) + next_execute;
+    task_dm.id                 = ALC_SYNC_ANS_TASK;
+    task_dm.priority           = TASK_HIGH_PRIORITY;
+    task_dm.PacketType         = UNCONF_DATA_UP;
+    task_dm.time_to_execute_ms = bsp_rtc_get_time_ms64( ) + ( ( uint64_t ) next_execute * 1000 );
     if( get_join_state( ) == MODEM_JOINED )
     {
         modem_supervisor_add_task( &task_dm );
@@ -504,9 +814,9 @@ void modem_supervisor_add_task_alc_sync_ans( uint32_t next_execute )
 void modem_supervisor_add_task_modem_mute( void )
 {
     smodem_task task_dm;
-    task_dm.id                = MUTE_TASK;
-    task_dm.priority          = TASK_MEDIUM_HIGH_PRIORITY;
-    task_dm.time_to_execute_s = bsp_rtc_get_time_s( ) + 86400;  // Every 24h
+    task_dm.id                 = MUTE_TASK;
+    task_dm.priority           = TASK_MEDIUM_HIGH_PRIORITY;
+    task_dm.time_to_execute_ms = modem_task_time_to_execute_ms( 86400 );  // Every 24h
     modem_supervisor_add_task( &task_dm );
 }
 
@@ -514,11 +824,11 @@ void modem_supervisor_add_task_retrieve_dl( uint32_t next_execute )
 {
     BSP_DBG_TRACE_WARNING( "modem_supervisor_add_task_retrieve_dl\n" );
     smodem_task task_dm;
-    task_dm.id                = RETRIEVE_DL_TASK;
-    task_dm.priority          = TASK_LOW_PRIORITY;
-    task_dm.PacketType        = UNCONF_DATA_UP;
-    task_dm.sizeIn            = 0;
-    task_dm.time_to_execute_s = bsp_rtc_get_time_s( ) + next_execute;
+    task_dm.id                 = RETRIEVE_DL_TASK;
+    task_dm.priority           = TASK_LOW_PRIORITY;
+    task_dm.PacketType         = UNCONF_DATA_UP;
+    task_dm.sizeIn             = 0;
+    task_dm.time_to_execute_ms = modem_task_time_to_execute_ms( next_execute );
     if( get_join_state( ) == MODEM_JOINED )
     {
         modem_supervisor_add_task( &task_dm );
@@ -531,10 +841,12 @@ void modem_supervisor_add_task_stream( void )
     // so this is safe even when it is going to be invalidated.
     smodem_task stream_task;
 
-    stream_task.id                = STREAM_TASK;
-    stream_task.time_to_execute_s = bsp_rtc_get_time_s( ) + 1;  // TODO define when to launch the task
-    stream_task.priority          = TASK_HIGH_PRIORITY;
-    stream_task.fPort             = modem_get_stream_port( );
+    stream_task.id                 = STREAM_TASK;
+    // the scheduler holds it until the duty cycle allows, until the airtime budget allows and while the battery is low
+    stream_task.time_to_execute_ms =
+        bsp_rtc_get_time_ms64( ) + modem_supervisor_airtime_wait_ms( ) + modem_supervisor_battery_hold_ms( );
+    stream_task.priority           = TASK_LOW_PRIORITY;
+    stream_task.fPort              = modem_get_stream_port( );
     // stream_task.dataIn        not used in task
     // stream_task.sizeIn        not used in task
     // stream_task.PacketType    not used in task
@@ -636,13 +948,38 @@ void reset_modem_charge( void )
 {
     radio_planner_t* rp = modem_get_radio_planner( );
     rp_stats_init( &rp->stats );
+
+    bsp_mcu_get_power_stats( &modem_mcu_power_stats_last );
+    modem_mcu_power_stats_reset = modem_mcu_power_stats_last;
+    modem_mcu_charge_ua_ms      = 0;
+
+    // the planner counters restarted from zero, so do the read baselines
+    memset( modem_rp_stats_last, 0, sizeof( modem_rp_stats_last ) );
+}
+
+void update_modem_charge( void )
+{
+    bsp_mcu_power_stats_t power_stats;
+    bsp_mcu_get_power_stats( &power_stats );
+
+    // unsigned differences stay correct across one wrap of the BSP counters
+    const uint32_t run_ms  = power_stats.run_time_ms - modem_mcu_power_stats_last.run_time_ms;
+    const uint32_t stop_ms = power_stats.stop_time_ms - modem_mcu_power_stats_last.stop_time_ms;
+
+    modem_mcu_charge_ua_ms += ( uint64_t ) run_ms * BSP_MCU_RUN_CURRENT_UA;
+    modem_mcu_charge_ua_ms += ( uint64_t ) stop_ms * BSP_MCU_STOP_CURRENT_UA;
+    modem_mcu_power_stats_last = power_stats;
 }
 
 uint32_t get_modem_charge_ma_s( void )
 {
     radio_planner_t* rp                = modem_get_radio_planner( );
     uint32_t         total_consumption = rp->stats.tx_total_consumption_ma + rp->stats.rx_total_consumption_ma;
-    return ( ( total_consumption / 1000 ) + modem_charge_offset );
+
+    update_modem_charge( );
+    // the radio planner accumulates in mA.ms, the MCU in uA.ms
+    const uint32_t mcu_charge_ma_s = ( uint32_t ) ( modem_mcu_charge_ua_ms / 1000000 );
+    return ( ( total_consumption / 1000 ) + mcu_charge_ma_s + modem_charge_offset );
 }
 
 uint32_t get_modem_charge_ma_h( void )
@@ -650,6 +987,49 @@ uint32_t get_modem_charge_ma_h( void )
     return get_modem_charge_ma_s( ) / 3600;
 }
 
+uint64_t get_modem_charge_ua_ms( void )
+{
+    radio_planner_t* rp = modem_get_radio_planner( );
+
+    update_modem_charge( );
+    return ( ( uint64_t ) ( rp->stats.tx_total_consumption_ma + rp->stats.rx_total_consumption_ma ) * 1000 ) +
+           modem_mcu_charge_ua_ms;
+}
+
+void get_modem_mcu_power_stats( bsp_mcu_power_stats_t* stats )
+{
+    bsp_mcu_get_power_stats( stats );
+    stats->run_time_ms -= modem_mcu_power_stats_reset.run_time_ms;
+    stats->stop_time_ms -= modem_mcu_power_stats_reset.stop_time_ms;
+    stats->wakeup_nb -= modem_mcu_power_stats_reset.wakeup_nb;
+}
+
+void get_modem_rp_stats( modem_rp_stats_reader_t reader, modem_rp_stats_t* stats )
+{
+    radio_planner_t*  rp   = modem_get_radio_planner( );
+    modem_rp_stats_t* last = &modem_rp_stats_last[reader];
+    modem_rp_stats_t  now;
+
+    // the counters may be incremented by the radio irq: sample them once, then compute the deltas
+    CRITICAL_SECTION_BEGIN( );
+    memcpy( now.tx_ms, rp->stats.tx_consumption_ms, sizeof( now.tx_ms ) );
+    memcpy( now.rx_ms, rp->stats.rx_consumption_ms, sizeof( now.rx_ms ) );
+    memcpy( now.aborted_nb, rp->stats.task_hook_aborted_nb, sizeof( now.aborted_nb ) );
+    memcpy( now.postponed_nb, rp->stats.task_hook_postponed_nb, sizeof( now.postponed_nb ) );
+    now.rp_error = rp->stats.rp_error;
+    CRITICAL_SECTION_END( );
+
+    for( uint8_t i = 0; i < RP_NB_HOOKS; i++ )
+    {
+        stats->tx_ms[i]        = now.tx_ms[i] - last->tx_ms[i];
+        stats->rx_ms[i]        = now.rx_ms[i] - last->rx_ms[i];
+        stats->aborted_nb[i]   = now.aborted_nb[i] - last->aborted_nb[i];
+        stats->postponed_nb[i] = now.postponed_nb[i] - last->postponed_nb[i];
+    }
+    stats->rp_error = now.rp_error - last->rp_error;
+    *last           = now;
+}
+
 uint8_t get_modem_voltage( void )
 {
     return ( uint8_t ) bsp_mcu_get_mcu_voltage( );
@@ -702,6 +1082,14 @@ e_dm_error_t dm_set_conf( e_dm_info_t tag, uint8_t* data, uint8_t length )
         case e_inf_region:
             set_modem_region( data[0] );
             break;
+        case e_inf_txslot:
+            if( lorawan_api_tx_slot_set( ( uint32_t )( data[0] | ( data[1] << 8 ) ) * 1000,
+                                         data[2] | ( data[3] << 8 ) ) != OKLORAWAN )
+            {
+                tag = e_inf_max;
+                ret = DM_ERROR;
+            }
+            break;
         default:
             tag = e_inf_max;
             ret = DM_ERROR;
@@ -806,6 +1194,7 @@ e_set_error_t set_dm_info( uint8_t* requested_info_list, uint8_t len, e_dm_info_
                 dm_info_bitfield_periodic = info_req;
                 tag_number                = 0;  // Reset tag_number used by dm_status_payload to start
                                                 // a report from beginning
+                dm_delta_report_count = 0;      // the new fields start with a full report
                 modem_store_context( );
             }
         }
@@ -847,6 +1236,14 @@ bool dm_status_payload( uint8_t* dm_uplink_message, uint8_t* dm_uplink_message_l
     {
         *tag = 0;
     }
+    if( ( flag == DM_INFO_PERIODIC ) && ( *tag == 0 ) )
+    {  // a new periodic report starts
+        is_dm_delta_keyframe = ( dm_delta_report_count == 0 );
+        if( dm_delta_keyframe_period > 0 )
+        {
+            dm_delta_report_count = ( dm_delta_report_count + 1 ) % dm_delta_keyframe_period;
+        }
+    }
     // BSP_DBG_TRACE_PRINTF("info_requested = %d \n",info_requested);
     while( ( *tag ) < e_inf_max )
     {
@@ -883,9 +1280,7 @@ bool dm_status_payload( uint8_t* dm_uplink_message, uint8_t* dm_uplink_message_l
             }
             break;
             case e_inf_rxtime: {
-                s_modem_dwn_t dwnframe = { 0 };
-                get_modem_downlink_frame( &dwnframe );
-                uint32_t time  = ( bsp_rtc_get_time_s( ) - dwnframe.timestamp ) / 3600;
+                uint32_t time  = ( bsp_rtc_get_time_s( ) - get_modem_downlink_frame( )->timestamp ) / 3600;
                 *p_tmp         = time & 0xFF;
                 *( p_tmp + 1 ) = time >> 8;
             }
@@ -934,16 +1329,83 @@ bool dm_status_payload( uint8_t* dm_uplink_message, uint8_t* dm_uplink_message_l
             case e_inf_appstatus:
                 get_modem_appstatus( p_tmp );
                 break;
+            case e_inf_rpstats: {
+                // totals over all the hooks: tx [ms], rx [ms], aborted tasks, postponed tasks, planner errors
+                modem_rp_stats_t rp_stats;
+                uint32_t         tx_ms        = 0;
+                uint32_t         rx_ms        = 0;
+                uint32_t         aborted_nb   = 0;
+                uint32_t         postponed_nb = 0;
+                get_modem_rp_stats( MODEM_RP_STATS_READER_DM, &rp_stats );
+                for( uint8_t i = 0; i < RP_NB_HOOKS; i++ )
+                {
+                    tx_ms += rp_stats.tx_ms[i];
+                    rx_ms += rp_stats.rx_ms[i];
+                    aborted_nb += rp_stats.aborted_nb[i];
+                    postponed_nb += rp_stats.postponed_nb[i];
+                }
+                aborted_nb      = MIN( aborted_nb, 0xFFFF );
+                postponed_nb    = MIN( postponed_nb, 0xFFFF );
+                *p_tmp          = tx_ms & 0xFF;
+                *( p_tmp + 1 )  = ( tx_ms >> 8 ) & 0xFF;
+                *( p_tmp + 2 )  = ( tx_ms >> 16 ) & 0xFF;
+                *( p_tmp + 3 )  = ( tx_ms >> 24 ) & 0xFF;
+                *( p_tmp + 4 )  = rx_ms & 0xFF;
+                *( p_tmp + 5 )  = ( rx_ms >> 8 ) & 0xFF;
+                *( p_tmp + 6 )  = ( rx_ms >> 16 ) & 0xFF;
+                *( p_tmp + 7 )  = ( rx_ms >> 24 ) & 0xFF;
+                *( p_tmp + 8 )  = aborted_nb & 0xFF;
+                *( p_tmp + 9 )  = aborted_nb >> 8;
+                *( p_tmp + 10 ) = postponed_nb & 0xFF;
+                *( p_tmp + 11 ) = postponed_nb >> 8;
+                *( p_tmp + 12 ) = MIN( rp_stats.rp_error, 0xFF );
+                break;
+            }
+            case e_inf_ramusage: {
+                // modem_ram_usage_t fields in order, 16-bit saturated
+                modem_ram_usage_t ram_usage;
+                modem_get_ram_usage( &ram_usage );
+                const uint32_t* field = ( const uint32_t* ) &ram_usage;
+                for( uint8_t i = 0; i < ( sizeof( ram_usage ) / sizeof( uint32_t ) ); i++ )
+                {
+                    const uint16_t value = MIN( field[i], 0xFFFF );
+                    *( p_tmp + ( 2 * i ) )     = value & 0xFF;
+                    *( p_tmp + ( 2 * i ) + 1 ) = value >> 8;
+                }
+                break;
+            }
+            case e_inf_txslot: {
+                uint32_t period_ms;
+                uint16_t slot_ms;
+                lorawan_api_tx_slot_get( &period_ms, &slot_ms );
+                *p_tmp         = ( period_ms / 1000 ) & 0xFF;
+                *( p_tmp + 1 ) = ( period_ms / 1000 ) >> 8;
+                *( p_tmp + 2 ) = slot_ms & 0xFF;
+                *( p_tmp + 3 ) = slot_ms >> 8;
+                break;
+            }
             default:
                 BSP_DBG_TRACE_ERROR( "Construct DM payload report, unknown code 0x%02x\n", *tag );
                 break;
             }
 
+            if( ( flag == DM_INFO_PERIODIC ) && ( dm_delta_is_unchanged( ( e_dm_info_t ) *tag, p_tmp ) == true ) )
+            {
+                p_tmp--;  // the id code is removed, the server keeps the value last sent
+                ( *tag )++;
+                continue;
+            }
+
+            uint8_t* field = p_tmp;
             p_tmp += dm_info_field_sz[*tag];
             // Check if last message can be enqueued
             if( ( p_tmp - dm_uplink_message ) <= max_size )
             {
                 p = p_tmp;
+                if( flag == DM_INFO_PERIODIC )
+                {
+                    dm_delta_last_sent[*tag] = dm_delta_value_get( ( e_dm_info_t ) *tag, field );
+                }
             }
             else
             {
@@ -959,6 +1421,38 @@ bool dm_status_payload( uint8_t* dm_uplink_message, uint8_t* dm_uplink_message_l
     return pending;
 }
 
+uint8_t dm_status_payload_max_length( void )
+{
+    uint8_t length = 0;
+    for( uint8_t i = 0; i < e_inf_max; i++ )
+    {
+        if( ( dm_info_bitfield_periodic & ( 1 << i ) ) )
+        {
+            length += 1 + dm_info_field_sz[i];
+        }
+    }
+    return length;
+}
+
+void set_dm_delta_keyframe_period( uint8_t period )
+{
+    dm_delta_keyframe_period = period;
+    dm_delta_report_count    = 0;
+}
+
+e_set_error_t set_dm_delta_threshold( e_dm_info_t tag, uint16_t threshold )
+{
+    // thresholds apply to the numeric fields, the other ones are sent on any change
+    if( ( tag >= e_inf_max ) || ( tag == e_inf_rpstats ) || ( dm_info_field_sz[tag] == 0 ) ||
+        ( dm_info_field_sz[tag] > sizeof( uint32_t ) ) )
+    {
+        BSP_DBG_TRACE_ERROR( "invalid DM delta threshold code (0x%02x)\n", tag );
+        return SET_ERROR;
+    }
+    dm_delta_threshold[tag] = threshold;
+    return SET_OK;
+}
+
 e_set_error_t set_modem_suspend( e_modem_suspend_t suspend )
 {
     if( suspend > 1 )
@@ -990,7 +1484,7 @@ e_set_error_t set_modem_adr_profile( dr_strategy_t user_dr, uint8_t* adr_custom_
                     2) user_dr = custom but length not equal to 16
                     3) user_dr not custom but length not equal to 0*/
     if( ( user_dr >= UNKNOWN_DR ) || ( ( user_dr == USER_DR_DISTRIBUTION ) && ( adr_custom_length != 16 ) ) ||
-        ( ( user_dr < USER_DR_DISTRIBUTION ) && ( adr_custom_length != 0 ) ) )
+        ( ( user_dr != USER_DR_DISTRIBUTION ) && ( adr_custom_length != 0 ) ) )
     {
         BSP_DBG_TRACE_ERROR( "user_dr = %d and length = %d \n ", user_dr, adr_custom_length );
         BSP_DBG_TRACE_ERROR( "CMD_SETADRPROFILE with not valid profile\n" );
@@ -1050,7 +1544,7 @@ e_set_error_t set_modem_adr_profile( dr_strategy_t user_dr, uint8_t* adr_custom_
 
 void set_modem_downlink_frame( void )
 {
-    lorawan_api_payload_receive( &( modem_dwn_pkt.port ), modem_dwn_pkt.data, &( modem_dwn_pkt.length ) );
+    lorawan_api_downlink_get( &( modem_dwn_pkt.port ), &( modem_dwn_pkt.data ), &( modem_dwn_pkt.length ) );
     modem_dwn_pkt.timestamp = bsp_rtc_get_time_s( );
     modem_dwn_pkt.snr       = lorawan_api_last_snr_get( ) >> 2;
     modem_dwn_pkt.rssi      = lorawan_api_last_rssi_get( ) + 64;
@@ -1058,14 +1552,9 @@ void set_modem_downlink_frame( void )
     BSP_DBG_TRACE_PRINTF( "ModemDwnPort = %d , ", modem_dwn_pkt.port );
     BSP_DBG_TRACE_PRINTF( "ModemDwnSNR = %d , ModemDwnRssi = %d \n ", modem_dwn_pkt.snr, modem_dwn_pkt.rssi );
 }
-void get_modem_downlink_frame( s_modem_dwn_t* modem_dwn_in )
+const s_modem_dwn_t* get_modem_downlink_frame( void )
 {
-    modem_dwn_in->timestamp = modem_dwn_pkt.timestamp;
-    modem_dwn_in->snr       = modem_dwn_pkt.snr;
-    modem_dwn_in->rssi      = modem_dwn_pkt.rssi;
-    modem_dwn_in->port      = modem_dwn_pkt.port;
-    modem_dwn_in->length    = modem_dwn_pkt.length;
-    memcpy( modem_dwn_in->data, modem_dwn_pkt.data, modem_dwn_pkt.length );
+    return &modem_dwn_pkt;
 }
 
 void set_dm_retrieve_pending_dl( uint8_t up_count, uint8_t up_delay )
@@ -1081,36 +1570,115 @@ void get_dm_retrieve_pending_dl( s_dm_retrieve_pending_dl_t* pending_dl )
 }
 
 void modem_store_context( void )
+{  // written back by modem_store_context_process once the changes have settled
+    is_modem_context_dirty   = true;
+    is_modem_context_pending = true;
+    modem_context_change_ms  = bsp_rtc_get_time_ms( );
+}
+
+void modem_store_context_flush( void )
 {
-    uint8_t modem_context[BSP_MODEM_CONTEXT_SIZE] = { 0 };
-    modem_context[0]                              = modem_dm_port;
-    modem_context[1]                              = modem_dm_interval;
-    modem_context[2]                              = modem_dm_upload_sctr;
-    memcpy( &modem_context[3], ( uint8_t* ) ( &dm_info_bitfield_periodic ), sizeof( dm_info_bitfield_periodic ) );
-    modem_context[7] = number_of_muted_day;
+    if( is_modem_context_dirty == true )
+    {
+        // the configuration and the charge are separate journal records: only the changed one is appended
+        uint8_t modem_config[MODEM_CONFIG_SIZE];
+        modem_config[0] = modem_dm_port;
+        modem_config[1] = modem_dm_interval;
+        modem_config[2] = modem_dm_upload_sctr;
+        memcpy( &modem_config[3], ( uint8_t* ) ( &dm_info_bitfield_periodic ), sizeof( dm_info_bitfield_periodic ) );
+        modem_config[7] = number_of_muted_day;
+        modem_config[8] = modem_host_baudrate;
 
-    uint32_t modem_charge = get_modem_charge_ma_s( );
-    memcpy( &modem_context[8], ( uint8_t* ) &modem_charge, sizeof( modem_charge ) );
+        uint32_t modem_charge = get_modem_charge_ma_s( );
 
-    uint32_t crctmp = crc( modem_context, BSP_MODEM_CONTEXT_SIZE - sizeof( crctmp ) );
-    memcpy( &modem_context[BSP_MODEM_CONTEXT_SIZE - sizeof( crctmp )], ( uint8_t* ) &crctmp, sizeof( crctmp ) );
-    BSP_DBG_TRACE_PRINTF(
-        "Store a New Modem Config :\n Port = %d \n Interval = %d\n Upload_sctr = %d\n DM bitfield = 0x%lx\n Nb muted "
-        "day = %u\n Charge = %u\n",
-        modem_dm_port, modem_dm_interval, modem_dm_upload_sctr, dm_info_bitfield_periodic, number_of_muted_day,
-        modem_charge );
-    bsp_nvm_context_store( BSP_MODEM_CONTEXT_ADDR_OFFSET, modem_context, BSP_MODEM_CONTEXT_SIZE );
+        BSP_DBG_TRACE_PRINTF(
+            "Store a New Modem Config :\n Port = %d \n Interval = %d\n Upload_sctr = %d\n DM bitfield = 0x%lx\n Nb "
+            "muted day = %u\n Charge = %u\n Host baud rate = %u\n",
+            modem_dm_port, modem_dm_interval, modem_dm_upload_sctr, dm_info_bitfield_periodic, number_of_muted_day,
+            modem_charge, modem_host_baudrate );
+        // each record is written atomically by the journal, the context stays dirty until both records are written
+        if( ( bsp_nvm_journal_write( BSP_NVM_JOURNAL_KEY_MODEM_CONFIG, modem_config, MODEM_CONFIG_SIZE ) >= 0 ) &&
+            ( bsp_nvm_journal_write( BSP_NVM_JOURNAL_KEY_MODEM_CHARGE, ( uint8_t* ) &modem_charge,
+                                     sizeof( modem_charge ) ) >= 0 ) )
+        {
+            is_modem_context_dirty = false;
+        }
+    }
+    lorawan_api_context_flush( );
+    is_modem_context_pending = is_modem_context_dirty;
+}
+
+uint32_t modem_store_context_process( void )
+{
+    if( ( is_modem_context_pending == false ) && ( lorawan_api_context_is_dirty( ) == true ) )
+    {  // the LoRaWAN context changes settle with the modem ones
+        is_modem_context_pending = true;
+        modem_context_change_ms  = bsp_rtc_get_time_ms( );
+    }
+    if( ( is_modem_context_pending == false ) || ( is_modem_context_held == true ) )
+    {
+        return MODEM_MAX_TIME_MS;
+    }
+
+    uint32_t elapsed_ms = bsp_rtc_get_time_ms( ) - modem_context_change_ms;
+    if( elapsed_ms < MODEM_CONTEXT_FLUSH_DELAY_MS )
+    {
+        return MODEM_CONTEXT_FLUSH_DELAY_MS - elapsed_ms;
+    }
+
+    modem_store_context_flush( );
+    if( is_modem_context_pending == true )
+    {  // nvm write failed, retried later
+        modem_context_change_ms = bsp_rtc_get_time_ms( );
+        return MODEM_CONTEXT_FLUSH_DELAY_MS;
+    }
+    return MODEM_MAX_TIME_MS;
+}
+
+void modem_store_context_hold( void )
+{
+    is_modem_context_held = true;
+}
 
-    modem_load_context( );
+void modem_store_context_release( void )
+{
+    is_modem_context_held = false;
+    modem_store_context_flush( );
 }
 
 /*!
  * \brief    load modem context in non volatile memory
- * \remark
+ * \remark   The context is read from the nvm journal, or from the legacy context block before its first store
  * \retval void
  */
 void modem_load_context( void )
 {
+    uint8_t modem_config[MODEM_CONFIG_SIZE];
+
+    if( bsp_nvm_journal_read( BSP_NVM_JOURNAL_KEY_MODEM_CONFIG, modem_config, MODEM_CONFIG_SIZE ) == MODEM_CONFIG_SIZE )
+    {
+        modem_dm_port        = modem_config[0];
+        modem_dm_interval    = modem_config[1];
+        modem_dm_upload_sctr = modem_config[2];
+        memcpy( ( uint8_t* ) ( &dm_info_bitfield_periodic ), &modem_config[3], sizeof( dm_info_bitfield_periodic ) );
+        number_of_muted_day = modem_config[7];
+        modem_host_baudrate = modem_config[8];
+
+        if( is_modem_charge_loaded == false )
+        {
+            bsp_nvm_journal_read( BSP_NVM_JOURNAL_KEY_MODEM_CHARGE, ( uint8_t* ) &modem_charge_offset,
+                                  sizeof( modem_charge_offset ) );
+            is_modem_charge_loaded = true;
+        }
+
+        BSP_DBG_TRACE_PRINTF(
+            "Modem Load Config :\n Port = %d \n Interval = %d\n Upload_sctr = %d\n DM bitfield = 0x%lx\n Nb muted "
+            "day = %u\n Charge = %u\n",
+            modem_dm_port, modem_dm_interval, modem_dm_upload_sctr, dm_info_bitfield_periodic, number_of_muted_day,
+            modem_charge_offset );
+        return;
+    }
+
     uint8_t modem_context[BSP_MODEM_CONTEXT_SIZE] = { 0 };
 
     bsp_nvm_context_restore( BSP_MODEM_CONTEXT_ADDR_OFFSET, modem_context, BSP_MODEM_CONTEXT_SIZE );
@@ -1125,6 +1693,7 @@ void modem_load_context( void )
         modem_dm_upload_sctr = modem_context[2];
         memcpy( ( uint8_t* ) ( &dm_info_bitfield_periodic ), &modem_context[3], sizeof( dm_info_bitfield_periodic ) );
         number_of_muted_day = modem_context[7];
+        modem_host_baudrate = modem_context[12];
 
         if( is_modem_charge_loaded == false )
         {
@@ -1132,11 +1701,8 @@ void modem_load_context( void )
             is_modem_charge_loaded = true;
         }
 
-        BSP_DBG_TRACE_PRINTF(
-            "Modem Load Config :\n Port = %d \n Interval = %d\n Upload_sctr = %d\n DM bitfield = 0x%lx\n Nb muted "
-            "day = %u\n Charge = %u\n",
-            modem_dm_port, modem_dm_interval, modem_dm_upload_sctr, dm_info_bitfield_periodic, number_of_muted_day,
-            modem_charge_offset );
+        BSP_DBG_TRACE_PRINTF( "Modem Load legacy Config => moved to the journal\n" );
+        modem_store_context( );
     }
     else
     {
@@ -1150,24 +1716,21 @@ void modem_load_context( void )
 
 void modem_context_factory_reset( void )
 {
-    uint8_t modem_context[BSP_MODEM_CONTEXT_SIZE];
-    modem_context[0] = DEFAULT_DM_PORT;
-    modem_context[1] = DEFAULT_DM_REPORTING_INTERVAL;
+    uint8_t modem_config[MODEM_CONFIG_SIZE];
+    modem_config[0] = DEFAULT_DM_PORT;
+    modem_config[1] = DEFAULT_DM_REPORTING_INTERVAL;
     // upload_sctr is not reinit in the factory reset to copy sub-ghz modem behaviour
+    modem_config[2]           = modem_dm_upload_sctr;
     dm_info_bitfield_periodic = DEFAULT_DM_REPORTING_FIELDS;
-    memcpy( &modem_context[3], ( uint8_t* ) &dm_info_bitfield_periodic, sizeof( dm_info_bitfield_periodic ) );
-    modem_context[7] = DEFAULT_DM_MUTE_DAY;
+    memcpy( &modem_config[3], ( uint8_t* ) &dm_info_bitfield_periodic, sizeof( dm_info_bitfield_periodic ) );
+    modem_config[7] = DEFAULT_DM_MUTE_DAY;
+    modem_config[8] = DEFAULT_HOST_BAUDRATE_INDEX;
+    BSP_DBG_TRACE_ARRAY( "factory reset config", modem_config, MODEM_CONFIG_SIZE );
 
     uint32_t modem_charge = 0;
-    memcpy( &modem_context[8], ( uint8_t* ) &modem_charge, sizeof( modem_charge ) );
-    BSP_DBG_TRACE_ARRAY( "factory reset buf1", modem_context, BSP_MODEM_CONTEXT_SIZE );
 
-    uint32_t crctmp = crc( modem_context, BSP_MODEM_CONTEXT_SIZE - sizeof( crctmp ) );
-    memcpy( &modem_context[BSP_MODEM_CONTEXT_SIZE - sizeof( crctmp )], ( uint8_t* ) &crctmp, sizeof( crctmp ) );
-
-    BSP_DBG_TRACE_ARRAY( "factory reset buf2", modem_context, BSP_MODEM_CONTEXT_SIZE );
-
-    bsp_nvm_context_store( BSP_MODEM_CONTEXT_ADDR_OFFSET, modem_context, BSP_MODEM_CONTEXT_SIZE );
+    bsp_nvm_journal_write( BSP_NVM_JOURNAL_KEY_MODEM_CONFIG, modem_config, MODEM_CONFIG_SIZE );
+    bsp_nvm_journal_write( BSP_NVM_JOURNAL_KEY_MODEM_CHARGE, ( uint8_t* ) &modem_charge, sizeof( modem_charge ) );
 
     is_modem_reset_requested = true;
     BSP_DBG_TRACE_INFO( "modem_context_factory_reset done\n" );
@@ -1184,14 +1747,21 @@ uint8_t modem_get_dm_upload_sctr( void )
     return ( modem_dm_upload_sctr & 0xf );
 }
 
-e_modem_upload_state_t modem_get_upload_state( void )
+e_modem_upload_state_t modem_get_upload_state( uint8_t sid )
 {
-    return ( modem_upload_state );
+    if( sid >= FILE_UPLOAD_MAX_SESSIONS )
+    {
+        return MODEM_UPLOAD_NOT_INIT;
+    }
+    return ( modem_upload_state[sid] );
 }
 
-void modem_set_upload_state( e_modem_upload_state_t upload_state )
+void modem_set_upload_state( uint8_t sid, e_modem_upload_state_t upload_state )
 {
-    modem_upload_state = upload_state;
+    if( sid < FILE_UPLOAD_MAX_SESSIONS )
+    {
+        modem_upload_state[sid] = upload_state;
+    }
 }
 
 e_modem_stream_state_t modem_get_stream_state( void )
@@ -1229,6 +1799,7 @@ void modem_set_dm_info_bitfield_periodic( uint32_t value )
     if( dm_info_bitfield_periodic != value )
     {
         dm_info_bitfield_periodic = value;
+        dm_delta_report_count     = 0;
         modem_store_context( );
     }
 }
@@ -1255,4 +1826,95 @@ void set_modem_reset_requested( bool reset_req )
     is_modem_reset_requested = reset_req;
 }
 
+bool get_modem_tx_coalescing( void )
+{
+    return is_modem_tx_coalescing;
+}
+void set_modem_tx_coalescing( bool enable )
+{
+    is_modem_tx_coalescing = enable;
+}
+
+void get_modem_port_qos( uint8_t f_port, modem_qos_t* qos )
+{
+    const modem_qos_t qos_default = { .priority              = TASK_HIGH_PRIORITY,
+                                      .tx_mode               = MODEM_QOS_TX_AS_REQUESTED,
+                                      .max_delay_s           = 0,
+                                      .is_coalesced          = true,
+                                      .is_dropped_when_stale = false };
+
+    *qos = qos_default;
+    for( uint8_t i = 0; i < MODEM_QOS_PORT_NB; i++ )
+    {
+        if( ( modem_port_qos[i].f_port == f_port ) && ( f_port != 0 ) )
+        {
+            *qos = modem_port_qos[i].qos;
+            break;
+        }
+    }
+}
+bool set_modem_port_qos( uint8_t f_port, const modem_qos_t* qos )
+{
+    int8_t free_index = -1;
+
+    for( uint8_t i = 0; i < MODEM_QOS_PORT_NB; i++ )
+    {
+        if( modem_port_qos[i].f_port == f_port )
+        {  // the class of the port is replaced or removed
+            modem_port_qos[i].f_port = 0;
+            free_index               = i;
+            break;
+        }
+        if( ( modem_port_qos[i].f_port == 0 ) && ( free_index < 0 ) )
+        {
+            free_index = i;
+        }
+    }
+    if( qos == NULL )
+    {
+        return true;
+    }
+    if( free_index < 0 )
+    {
+        return false;
+    }
+    modem_port_qos[free_index].f_port = f_port;
+    modem_port_qos[free_index].qos    = *qos;
+    return true;
+}
+
+bool get_modem_store_and_forward( void )
+{
+    return is_modem_store_and_forward;
+}
+void set_modem_store_and_forward( bool enable )
+{
+    is_modem_store_and_forward = enable;
+}
+
+uint8_t get_modem_task_jitter( void )
+{
+    return modem_task_jitter_percent;
+}
+e_set_error_t set_modem_task_jitter( uint8_t percent )
+{
+    if( percent > 100 )
+    {
+        BSP_DBG_TRACE_ERROR( "Invalid task jitter %d%%\n", percent );
+        return SET_ERROR;
+    }
+    modem_task_jitter_percent = percent;
+    modem_task_jitter_state   = 0;  // seeded again with the current DevEUI
+    return SET_OK;
+}
+
+bool get_modem_dm_piggyback( void )
+{
+    return is_modem_dm_piggyback;
+}
+void set_modem_dm_piggyback( bool enable )
+{
+    is_modem_dm_piggyback = enable;
+}
+
 /* --- EOF ------------------------------------------------------------------ */
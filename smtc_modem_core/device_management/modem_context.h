@@ -55,87 +55,139 @@ extern "C" {
 #define DEFAULT_DM_REPORTING_INTERVAL 0x81  // 1h
 #define DEFAULT_DM_REPORTING_FIELDS 0x7B    // status, charge, temp, signal, uptime, rxtime
 #define DEFAULT_DM_MUTE_DAY 0
-#define UPLOAD_SID 0
+#define DEFAULT_HOST_BAUDRATE_INDEX 0  // 115200 bauds
+#define UPLOAD_SID 0  // file upload session used by the host commands
 
 #define DM_STATUS_NOW_MIN_TIME 2
 #define DM_STATUS_NOW_MAX_TIME 5
 
+#define MODEM_EVENT_FIFO_NB 16  // queued events, identical consecutive events without payload share one
+#define MODEM_EVENT_FIFO_DATA_SIZE 512  // bytes shared by the payloads of the queued events
+#define MODEM_EVENT_DATA_MAX_SIZE 255  // payload of one event, sized for the host event buffer
+
+#define MODEM_QOS_PORT_NB 8  // ports with their own application uplink QoS class, the other ones have the default
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC TYPES ------------------------------------------------------------
  */
 
-/*
- * -----------------------------------------------------------------------------
- * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+/*!
+ * \typedef s_modem_event_t
+ * \brief   Queued asynchronous event, its payload is stored in the payload ring of the event fifo
  */
+typedef struct s_modem_event
+{
+    modem_rsp_event_t type;         //!< event type
+    uint8_t           count;        //!< number of identical events merged in this one
+    uint8_t           data_length;  //!< payload length in byte(s)
+} s_modem_event_t;
 
 /*!
- * \brief  Init events data
- * \retval void
+ * \typedef modem_rp_stats_reader_t
+ * \brief   Readers of the radio planner statistics, each one has its own reset-on-read baseline
  */
-void modem_event_init( void );
+typedef enum modem_rp_stats_reader_e
+{
+    MODEM_RP_STATS_READER_HOST = 0,
+    MODEM_RP_STATS_READER_DM,
+    MODEM_RP_STATS_READER_SUPERVISOR,  // airtime charged to the tasks by the supervisor
+    MODEM_RP_STATS_READER_NB
+} modem_rp_stats_reader_t;
 
 /*!
- * \brief  for each type of asynchronous message have to manage a counter in case of overrun
- * \param   [in]  event_type                - type of asynchronous message
- * \retval int8_t                    - Return the number of asynchronous event for this type
- *                                            of event since the last get event cmd
+ * \typedef modem_rp_stats_t
+ * \brief   Radio planner statistics accumulated since the previous read of the same reader
  */
-uint8_t get_modem_event_count( modem_rsp_event_t event_type );
+typedef struct modem_rp_stats_s
+{
+    uint32_t tx_ms[RP_NB_HOOKS];
+    uint32_t rx_ms[RP_NB_HOOKS];
+    uint32_t aborted_nb[RP_NB_HOOKS];
+    uint32_t postponed_nb[RP_NB_HOOKS];
+    uint32_t rp_error;
+} modem_rp_stats_t;
 
 /*!
- * \brief set a value in the counter of a type of asynchronous event
- * \param   [in]  event_type                - type of asynchronous message
- * \param   [in]  value                     - value's type of asynchronous message
- * \retval void
+ * \typedef modem_qos_tx_mode_t
+ * \brief   Packet type of the application uplinks of a QoS class
  */
-void set_modem_event_count( modem_rsp_event_t event_type, uint8_t value );
+typedef enum modem_qos_tx_mode_e
+{
+    MODEM_QOS_TX_AS_REQUESTED = 0,  //!< the type given with the uplink
+    MODEM_QOS_TX_UNCONFIRMED  = 1,
+    MODEM_QOS_TX_CONFIRMED    = 2,
+} modem_qos_tx_mode_t;
 
 /*!
- * \brief increment the counter of a type of asynchronous event
- * \param   [in]  event_type                - type of asynchronous message
- * \retval void
+ * \typedef modem_qos_t
+ * \brief   QoS class of the application uplinks of a port
  */
-void increment_modem_event_count( modem_rsp_event_t event_type );
+typedef struct modem_qos_s
+{
+    eTask_priority      priority;               //!< TASK_HIGH_PRIORITY to TASK_LOW_PRIORITY, against the modem tasks
+    modem_qos_tx_mode_t tx_mode;                //!< packet type
+    uint16_t            max_delay_s;            //!< max queueing delay, 0 for none
+    bool                is_coalesced;           //!< may be packed with the next uplinks when coalescing is enabled
+    bool                is_dropped_when_stale;  //!< past max_delay_s: dropped, else sent before the modem tasks
+} modem_qos_t;
 
-/*!
- * \brief  for each type of asynchronous message have to manage a status
- * \remark
- * \param   [in]  event_type                - type of asynchronous message
- * \retval int8_t                    - return the last status of asynchronous event for this type
- *                                            of event since the last get event cmd
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
  */
-uint8_t get_modem_event_status( modem_rsp_event_t event_type );
 
 /*!
- * \brief set a value in the status of a type of asynchronous event
- * \remark
- * \param   [in]  event_type                    - type of asynchronous message
- * \param   [in]  status                        - status of asynchronous message
+ * \brief  Init events data
  * \retval void
  */
-void set_modem_event_status( modem_rsp_event_t event_type, uint8_t status );
+void modem_event_init( void );
 
 /*!
- * \brief decrement the asynchronous message number
+ * \brief push an asynchronous event in the event fifo
+ * \remark  the payload of the event is copied: the downlink frame set by set_modem_downlink_frame() for RSP_DOWNDATA,
+ *          the status for RSP_TXDONE, RSP_FILEDONE and RSP_SETCONF, the reset counter for RSP_RESET, the mute
+ *          state for RSP_MUTE, the link state for RSP_LINKSTATUS, the status and the frame received for
+ *          RSP_RAWRADIODONE. The event is dropped if the fifo is full
+ * \param   [in] event_type                     - type of asynchronous message
+ * \param   [in] status                         - status of asynchronous message
  * \retval void
  */
-void decrement_asynchronous_msgnumber( void );
+void increment_asynchronous_msgnumber( modem_rsp_event_t event_type, uint8_t status );
 
 /*!
- * \brief increment the asynchronous message number
+ * \brief get the payload length of the oldest asynchronous event of the event fifo
+ * \retval uint8_t                              - Return the payload length in byte(s), 0 if the fifo is empty
+ */
+uint8_t get_modem_event_data_length( void );
+
+/*!
+ * \brief pop the oldest asynchronous event of the event fifo
+ * \param   [out] type                          - type of asynchronous message
+ * \param   [out] count                         - number of events merged in this one or dropped before it
+ * \param   [out] data                          - payload of the event, MODEM_EVENT_DATA_MAX_SIZE bytes at most
+ * \param   [out] data_length                   - payload length in byte(s)
+ * \retval bool                                 - Return false if the fifo is empty
+ */
+bool modem_event_pop( modem_rsp_event_t* type, uint8_t* count, uint8_t* data, uint8_t* data_length );
+
+/*!
+ * \brief set the handler of an event type
+ * \remark  the events of this type are no longer merged, each one is given to the handler by modem_event_dispatch
  * \param   [in] event_type                     - type of asynchronous message
- * \param   [in] status                         - status of asynchronous message
+ * \param   [in] handler                        - handler of the event type, NULL to queue them for modem_get_event
  * \retval void
  */
-void increment_asynchronous_msgnumber( modem_rsp_event_t event_type, uint8_t status );
+void set_modem_event_handler( modem_rsp_event_t event_type, modem_event_handler_t handler );
 
 /*!
- * \brief get the last message event
- * \retval modem_rsp_event_t             - Return the last modem_rsp_event_t
+ * \brief give the oldest events of the event fifo to their handler
+ * \remark  the order is kept: the dispatch stops at the first event without handler, which is left for
+ *          modem_get_event, unless it is dropped
+ * \param   [in] is_unhandled_dropped           - drop the events without handler, nobody reads them
+ * \retval void
  */
-modem_rsp_event_t get_last_msg_event( void );
+void modem_event_dispatch( bool is_unhandled_dropped );
 
 /*!
  * \brief get asynchronous message number
@@ -211,6 +263,21 @@ e_set_error_t set_modem_dm_port( uint8_t port );
  */
 uint8_t get_modem_dm_port( void );
 
+/*!
+ * \brief   Set host link baud rate
+ * \remark  This command saves the index of the host uart baud rate, the table being owned by the hw modem.
+ *
+ * \param   [in]    baudrate_index              - Host baud rate index
+ */
+void set_modem_host_baudrate( uint8_t baudrate_index );
+
+/*!
+ * \brief   Get host link baud rate
+ *
+ * \retval [out]    return                      - Host baud rate index
+ */
+uint8_t get_modem_host_baudrate( void );
+
 /*!
  * \brief   Set ADR profile
  * \remark  This command sets the ADR profile and parameters.
@@ -263,6 +330,16 @@ void get_modem_appstatus( uint8_t* app_status );
  */
 void reset_modem_charge( void );
 
+/*!
+ * \brief   Account the MCU charge since the last call
+ * \remark  The MCU run and STOP times are weighted by their supply current, the UART and ADC activity is part of
+ *          the run time. Must be called at least once every 49 days so that the BSP time counters do not wrap
+ *          between two updates.
+ *
+ * \retval void
+ */
+void update_modem_charge( void );
+
 /*!
  * \brief   Get the modem charge mAs
  * \remark  This command returns the total charge counter of the modem in mAs.
@@ -279,6 +356,33 @@ uint32_t get_modem_charge_ma_s( void );
  */
 uint32_t get_modem_charge_ma_h( void );
 
+/*!
+ * \brief   Get the modem charge since the last reset in uA.ms
+ * \remark  Same accounting as get_modem_charge_ma_s, at the resolution of the counters and without the charge
+ *          restored from the NVM
+ *
+ * \retval   uint64_t                    - Return accumulated charge
+ */
+uint64_t get_modem_charge_ua_ms( void );
+
+/*!
+ * \brief   Get the MCU power state times and wake-ups since the last charge reset
+ *
+ * \param   [out] stats*                 - MCU activity
+ * \retval   void
+ */
+void get_modem_mcu_power_stats( bsp_mcu_power_stats_t* stats );
+
+/*!
+ * \brief   Get the radio planner statistics since the previous read
+ * \remark  The statistics are reset on read for this reader only, the charge counter is not affected.
+ *
+ * \param   [in]    reader                  - Reader of the statistics
+ * \param   [out]   stats*                  - Airtime and contention counters since the previous read
+ * \retval  void
+ */
+void get_modem_rp_stats( modem_rp_stats_reader_t reader, modem_rp_stats_t* stats );
+
 /*!
  * \brief   Get the modem voltage
  * \remark  This command returns the modem voltage
@@ -431,11 +535,12 @@ void set_modem_downlink_frame( void );
 
 /*!
  * \brief   Get the Downlink frame in modem context
- * \remark  This function must be called after set_modem_downlink_frame()
+ * \remark  This function must be called after set_modem_downlink_frame(). The frame data are not copied, they stay
+ *          valid until the next set_modem_downlink_frame()
  *
- * \param   [in]    modem_dwn*                  - s_modem_dwn_t
+ * \retval  const s_modem_dwn_t*
  */
-void get_modem_downlink_frame( s_modem_dwn_t* modem_dwn );
+const s_modem_dwn_t* get_modem_downlink_frame( void );
 
 /*!
  * \brief   Set DM retrieve pending downlink frame
@@ -527,6 +632,24 @@ uint8_t get_dm_info_tag_list( uint8_t* dm, e_dm_info_rate_t flag );
  */
 e_set_error_t set_dm_info( uint8_t* requested_info_list, uint8_t len, e_dm_info_rate_t flag );
 
+/*!
+ * \brief   Set the DM delta reporting
+ * \remark  In delta mode, one periodic report every period is a full one
+ *
+ * \param   [in]  period                      - Reports between two full reports, 0 disables the delta mode
+ * \retval void
+ */
+void set_dm_delta_keyframe_period( uint8_t period );
+
+/*!
+ * \brief   Set the change of a numeric DM info field from which it is sent in delta mode
+ *
+ * \param   [in]  tag                         - DM info code of a numeric field
+ * \param   [in]  threshold                   - Change in the unit of the field, 0 to send it on any change
+ * \retval e_set_error_t                      - Return SET_ERROR if the field is not numeric
+ */
+e_set_error_t set_dm_delta_threshold( e_dm_info_t tag, uint16_t threshold );
+
 /*!
  * \brief   DM status messages
  *
@@ -538,10 +661,19 @@ e_set_error_t set_dm_info( uint8_t* requested_info_list, uint8_t len, e_dm_info_
  *                                                                  GetInfo command,
  *                                                              Else: set bitfield for saved context with SetDmInfo
  * \retval bool                               - Return true if there are pending message(s) else false
+ * \remark  In delta mode, the periodic fields that did not move beyond their threshold since they were last sent are
+ *          left out, except in the full reports
  */
 bool dm_status_payload( uint8_t* dm_uplink_message, uint8_t* dm_uplink_message_len, uint8_t max_size,
                         e_dm_info_rate_t flag );
 
+/*!
+ * \brief   Get the length of a full periodic DM report
+ *
+ * \retval uint8_t                            - Length of the report with every periodic field
+ */
+uint8_t dm_status_payload_max_length( void );
+
 /*!
  * \brief   DM ALC Sync uplink payload
  *
@@ -601,7 +733,7 @@ void modem_supervisor_add_task_retrieve_dl( uint32_t next_execute );
 
 /*!
  * \brief    add a stream task in scheduler
- * \remark
+ * \remark   The task runs at low priority so that user uplinks and dm reports are not delayed by a long stream
  */
 void modem_supervisor_add_task_stream( void );
 
@@ -637,11 +769,39 @@ void set_modem_start_time_s( uint32_t time );
 
 /*!
  * \brief       Save modem context in non volatile memory
- * \remark
+ * \remark      The context is only marked as changed, it is written back by modem_store_context_process() or
+ *              modem_store_context_flush()
  * \retval   void
  */
 void modem_store_context( void );
 
+/*!
+ * \brief       Write the changed modem and LoRaWAN contexts in non volatile memory now
+ * \remark      Must be called before a reset, the changes not written yet would be lost
+ * \retval   void
+ */
+void modem_store_context_flush( void );
+
+/*!
+ * \brief       Write the changed modem and LoRaWAN contexts once no change came for MODEM_CONTEXT_FLUSH_DELAY_MS
+ * \remark      Called by the modem engine when the LoRaWAN stack is idle, before the mcu goes to sleep
+ * \retval   uint32_t                      - Return the delay in ms before the next write is due
+ */
+uint32_t modem_store_context_process( void );
+
+/*!
+ * \brief       Hold the writes of the modem and LoRaWAN contexts until modem_store_context_release()
+ * \remark      Used to apply several settings with a single write of each context
+ * \retval   void
+ */
+void modem_store_context_hold( void );
+
+/*!
+ * \brief       Release the writes of the modem and LoRaWAN contexts, the changed ones are written now
+ * \retval   void
+ */
+void modem_store_context_release( void );
+
 /*!
  * \brief    load modem context in non volatile memory
  * \remark
@@ -663,17 +823,19 @@ void modem_context_factory_reset( void );
 void modem_set_dm_upload_sctr( uint8_t session_counter );
 
 /*!
- * \brief    get the upload state
+ * \brief    get the upload state of a file upload session
+ * \param   [in]  sid                     - file upload session id
  * \retval e_modem_upload_state_t
  */
-e_modem_upload_state_t modem_get_upload_state( void );
+e_modem_upload_state_t modem_get_upload_state( uint8_t sid );
 
 /*!
- * \brief    set the upload state
+ * \brief    set the upload state of a file upload session
+ * \param   [in]  sid                     - file upload session id
  * \param   [in]  upload_state
  * \retval void
  */
-void modem_set_upload_state( e_modem_upload_state_t upload_state );
+void modem_set_upload_state( uint8_t sid, e_modem_upload_state_t upload_state );
 
 /*!
  * \brief    get the stream state
@@ -762,6 +924,78 @@ bool get_modem_reset_requested( void );
  */
 void set_modem_reset_requested( bool reset_req );
 
+/*!
+ * \brief   Get if the queued application uplinks are packed in a single frame
+ * \retval bool          - true if the coalescing is enabled
+ */
+bool get_modem_tx_coalescing( void );
+
+/*!
+ * \brief   Set if the queued application uplinks are packed in a single frame
+ * \param   [in]  enable        - true to enable the coalescing
+ * \retval  void
+ */
+void set_modem_tx_coalescing( bool enable );
+
+/*!
+ * \brief   Get the QoS class of the application uplinks of a port
+ * \remark  A port without its own class has the default one: TASK_HIGH_PRIORITY, packet type as requested, no
+ *          max delay, coalesced
+ * \param   [in]  f_port        - application port
+ * \param   [out] qos*          - QoS class
+ * \retval  void
+ */
+void get_modem_port_qos( uint8_t f_port, modem_qos_t* qos );
+
+/*!
+ * \brief   Set the QoS class of the application uplinks of a port
+ * \param   [in]  f_port        - application port
+ * \param   [in]  qos*          - QoS class, NULL to give the port the default class back
+ * \retval  bool                - false if MODEM_QOS_PORT_NB ports already have their own class
+ */
+bool set_modem_port_qos( uint8_t f_port, const modem_qos_t* qos );
+
+/*!
+ * \brief   Get if the application uplinks are kept in the outbox during the network outages
+ * \retval bool          - true if the store-and-forward is enabled
+ */
+bool get_modem_store_and_forward( void );
+
+/*!
+ * \brief   Set if the application uplinks are kept in the outbox during the network outages
+ * \param   [in]  enable        - true to enable the store-and-forward
+ * \retval  void
+ */
+void set_modem_store_and_forward( bool enable );
+
+/*!
+ * \brief   Get the jitter of the periodic tasks
+ * \retval uint8_t       - jitter in percent of the task period, 0 if the periodic tasks are not spread
+ */
+uint8_t get_modem_task_jitter( void );
+
+/*!
+ * \brief   Set the jitter of the periodic tasks
+ * \remark  The periodic DM reports, the downlink retrievals, the clock sync requests and the mute checks are spread
+ *          within +/- half the jitter around their nominal date, with a sequence seeded with the DevEUI.
+ * \param   [in]  percent       - jitter in percent of the task period, 0 to 100
+ * \retval  e_set_error_t       - SET_ERROR if the jitter is above 100 percent
+ */
+e_set_error_t set_modem_task_jitter( uint8_t percent );
+
+/*!
+ * \brief   Get if the application uplinks are carried by the periodic DM reports due soon
+ * \retval bool          - true if the DM piggybacking is enabled
+ */
+bool get_modem_dm_piggyback( void );
+
+/*!
+ * \brief   Set if the application uplinks are carried by the periodic DM reports due soon
+ * \param   [in]  enable        - true to enable the DM piggybacking
+ * \retval  void
+ */
+void set_modem_dm_piggyback( bool enable );
+
 #ifdef __cplusplus
 }
 #endif
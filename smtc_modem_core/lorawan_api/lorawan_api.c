@@ -40,6 +40,9 @@
 #include "lorawan_api.h"
 #include "lr1mac_core.h"
 #include "smtc_bsp.h"
+#if defined( REGION_WW2G4 )
+#include "region_ww2g4.h"
+#endif
 
 /*
  * -----------------------------------------------------------------------------
@@ -61,9 +64,13 @@
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
+#if defined REGION_WW2G4
+static region_ww2g4_context_t region_context = REGION_WW2G4_CONTEXT_INIT;
+#endif
+
 static smtc_real_t smtc_region = {
-    .context = NULL,
 #if defined REGION_WW2G4
+    .context     = &region_context,
     .region_type = SMTC_REAL_REGION_WW2G4,
 #elif defined REGION_EU_868
     .region_type = SMTC_REAL_REGION_EU_868,
@@ -122,6 +129,16 @@ status_lorawan_t lorawan_api_set_region( smtc_real_region_types_t region_type )
     return lr1mac_core_set_region( region_type );
 }
 
+status_lorawan_t lorawan_api_is_supported_region( smtc_real_region_types_t region_type )
+{
+    return lr1mac_core_is_supported_region( region_type );
+}
+
+uint8_t* lorawan_api_tx_payload_buffer_get( void )
+{
+    return lr1mac_core_tx_payload_buffer_get( );
+}
+
 lr1mac_states_t lorawan_api_payload_send( uint8_t fPort, const uint8_t* dataIn, const uint8_t sizeIn,
                                           uint8_t PacketType, uint32_t TargetTimeMS )
 {
@@ -134,11 +151,37 @@ lr1mac_states_t lorawan_api_payload_send_at_time( uint8_t fPort, const uint8_t*
     return lr1mac_core_payload_send_at_time( fPort, dataIn, sizeIn, PacketType, TargetTimeMS );
 }
 
+lr1mac_states_t lorawan_api_payload_send_preempt( uint8_t fPort, const uint8_t* dataIn, const uint8_t sizeIn,
+                                                  uint8_t PacketType, uint32_t TargetTimeMS )
+{
+    return lr1mac_core_payload_send_preempt( fPort, dataIn, sizeIn, PacketType, TargetTimeMS );
+}
+
+lr1mac_states_t lorawan_api_tx_wait_abort( void )
+{
+    return lr1mac_core_tx_wait_abort( );
+}
+
+bool lorawan_api_nwk_ans_pending_get( void )
+{
+    return lr1mac_core_nwk_ans_pending_get( );
+}
+
+lr1mac_states_t lorawan_api_nwk_ans_send( uint32_t TargetTimeMs )
+{
+    return lr1mac_core_nwk_ans_send( TargetTimeMs );
+}
+
 status_lorawan_t lorawan_api_payload_receive( uint8_t* UserRxFport, uint8_t* UserRxPayload, uint8_t* UserRxPayloadSize )
 {
     return lr1mac_core_payload_receive( UserRxFport, UserRxPayload, UserRxPayloadSize );
 }
 
+status_lorawan_t lorawan_api_downlink_get( uint8_t* port, uint8_t** payload, uint8_t* size )
+{
+    return lr1mac_core_downlink_get( port, payload, size );
+}
+
 lr1mac_states_t lorawan_api_join( uint32_t target_time_ms )
 {
     return lr1mac_core_join( target_time_ms );
@@ -164,6 +207,11 @@ dr_strategy_t lorawan_api_dr_strategy_get( void )
     return lr1mac_core_dr_strategy_get( );
 }
 
+void lorawan_api_dr_low_power_set( bool is_low_power )
+{
+    lr1mac_core_dr_low_power_set( is_low_power );
+}
+
 void lorawan_api_dr_custom_set( uint32_t DataRateCustom )
 {
     lr1mac_core_dr_custom_set( DataRateCustom );
@@ -184,6 +232,16 @@ void lorawan_api_context_save( void )
     lr1mac_core_context_save( );
 }
 
+void lorawan_api_context_flush( void )
+{
+    lr1mac_core_context_flush( );
+}
+
+bool lorawan_api_context_is_dirty( void )
+{
+    return lr1mac_core_context_is_dirty( );
+}
+
 int16_t lorawan_api_last_snr_get( void )
 {
     return lr1mac_core_last_snr_get( );
@@ -284,6 +342,11 @@ lr1mac_states_t lorawan_api_state_get( void )
     return lr1mac_core_state_get( );
 }
 
+uint32_t lorawan_api_next_process_delay_ms_get( void )
+{
+    return lr1mac_core_next_process_delay_ms_get( );
+}
+
 uint16_t lorawan_api_nb_reset_get( void )
 {
     return lr1mac_core_nb_reset_get( );
@@ -311,6 +374,16 @@ uint32_t lorawan_api_next_join_time_second_get( void )
     return lr1mac_core_next_join_time_second_get( );
 }
 
+bool lorawan_api_join_pending_get( void )
+{
+    return lr1mac_core_join_pending_get( );
+}
+
+void lorawan_api_join_pending_clear( void )
+{
+    lr1mac_core_join_pending_clear( );
+}
+
 int32_t lorawan_api_next_free_duty_cycle_ms_get( void )
 {
     return lr1mac_core_next_free_duty_cycle_ms_get( );
@@ -321,6 +394,107 @@ void lorawan_api_duty_cycle_enable_set( uint8_t enable )
     lr1mac_core_duty_cycle_enable_set( enable );
 }
 
+void lorawan_api_weighted_channel_selection_enable_set( uint8_t enable )
+{
+    lr1mac_core_weighted_channel_selection_enable_set( enable );
+}
+
+uint8_t lorawan_api_channel_scan_plan_get( uint32_t* freq_in_hz, uint8_t freq_max )
+{
+    return lr1mac_core_channel_scan_plan_get( freq_in_hz, freq_max );
+}
+
+void lorawan_api_channel_occupancy_update( uint32_t freq_in_hz, uint8_t busy_ratio )
+{
+    lr1mac_core_channel_occupancy_update( freq_in_hz, busy_ratio );
+}
+
+void lorawan_api_lbt_enable_set( uint8_t enable )
+{
+    lr1mac_core_lbt_enable_set( enable );
+}
+
+uint8_t lorawan_api_lbt_enable_get( void )
+{
+    return lr1mac_core_lbt_enable_get( );
+}
+
+void lorawan_api_rx_cad_gate_enable_set( uint8_t enable )
+{
+    lr1mac_core_rx_cad_gate_enable_set( enable );
+}
+
+void lorawan_api_tx_power_ctrl_set( uint8_t enable, int8_t gw_eirp_dbm )
+{
+    lr1mac_core_tx_power_ctrl_set( enable, gw_eirp_dbm );
+}
+
+status_lorawan_t lorawan_api_link_margin_get( int16_t* margin_db )
+{
+    return lr1mac_core_link_margin_get( margin_db );
+}
+
+void lorawan_api_device_time_req( void )
+{
+    lr1mac_core_device_time_req( );
+}
+
+void lorawan_api_link_check_enable_set( uint8_t enable )
+{
+    lr1mac_core_link_check_enable_set( enable );
+}
+
+lr1mac_link_state_t lorawan_api_link_state_get( uint8_t* miss_cnt )
+{
+    return lr1mac_core_link_state_get( miss_cnt );
+}
+
+status_lorawan_t lorawan_api_network_time_get( uint64_t* gps_time_ms )
+{
+    return lr1mac_core_network_time_get( gps_time_ms );
+}
+
+status_lorawan_t lorawan_api_tx_slot_set( uint32_t period_ms, uint16_t slot_ms )
+{
+    return lr1mac_core_tx_slot_set( period_ms, slot_ms );
+}
+
+void lorawan_api_tx_slot_get( uint32_t* period_ms, uint16_t* slot_ms )
+{
+    lr1mac_core_tx_slot_get( period_ms, slot_ms );
+}
+
+status_lorawan_t lorawan_api_fcnt_save_period_set( uint16_t period )
+{
+    return lr1mac_core_fcnt_save_period_set( period );
+}
+
+void lorawan_api_class_c_enable_set( bool enable )
+{
+    lr1mac_core_class_c_enable_set( enable );
+}
+
+void lorawan_api_class_b_enable_set( bool enable )
+{
+    lr1mac_core_class_b_enable_set( enable );
+}
+
+status_lorawan_t lorawan_api_class_b_periodicity_set( uint8_t periodicity )
+{
+    return lr1mac_core_class_b_periodicity_set( periodicity );
+}
+
+lr1mac_class_b_state_t lorawan_api_class_b_state_get( void )
+{
+    return lr1mac_core_class_b_state_get( );
+}
+
+status_lorawan_t lorawan_api_multicast_set( uint8_t group_id, uint32_t mc_addr, const uint8_t* mc_nwk_skey,
+                                            const uint8_t* mc_app_skey )
+{
+    return lr1mac_core_multicast_set( group_id, mc_addr, mc_nwk_skey, mc_app_skey );
+}
+
 uint32_t lorawan_api_fcnt_up_get( void )
 {
     return lr1mac_core_fcnt_up_get( );
@@ -348,6 +522,16 @@ uint8_t lorawan_api_rx_ack_bit_get( void )
     return lr1mac_core_rx_ack_bit_get( );
 }
 
+int8_t lorawan_api_rx_fpending_bit_get( void )
+{
+    return lr1mac_core_rx_fpending_bit_get( );
+}
+
+void lorawan_api_next_dr_fastest_set( void )
+{
+    lr1mac_core_next_dr_fastest_set( );
+}
+
 bool lorawan_api_certification_is_enabled( void )
 {
     return is_lorawan_certification_enabled;
@@ -457,6 +641,11 @@ uint8_t lorawan_api_certification( bool new_cmd, uint8_t fport_in, uint8_t* user
 
     return ( user_rx_payload[0] );
 }
+
+uint32_t lorawan_api_get_ram_size( void )
+{
+    return lr1mac_core_get_ram_size( ) + sizeof( smtc_region ) + sizeof( LoraWanKeys );
+}
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
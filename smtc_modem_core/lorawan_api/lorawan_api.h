@@ -81,10 +81,24 @@ smtc_real_region_types_t lorawan_api_get_region( void );
 
 /*!
  * \brief Set the LoRaWAN regional parameters
+ * \remark The session is kept, the channel plan of a region left earlier is restored
  * \param [in] smtc_real_region_types_t Region
  */
 status_lorawan_t lorawan_api_set_region( smtc_real_region_types_t region_type );
 
+/*!
+ * \brief Check the region is compiled in
+ * \param [in] smtc_real_region_types_t Region
+ */
+status_lorawan_t lorawan_api_is_supported_region( smtc_real_region_types_t region_type );
+
+/*!
+ * \brief   Buffer the application payload of the next uplink can be written in, to be sent without copy
+ * \remark  Only valid while the stack is idle, up to LR1MAC_TX_PAYLOAD_MAX_SIZE bytes, give it as dataIn to
+ *          lorawan_api_payload_send
+ * \param [out] return
+ */
+uint8_t* lorawan_api_tx_payload_buffer_get( void );
 /*!
  * \brief Sends an uplink when it's possible
  * \param [in] uint8_t           fPort          Uplink Fport
@@ -116,6 +130,30 @@ lr1mac_states_t lorawan_api_payload_send( uint8_t fPort, const uint8_t* dataIn,
  */
 lr1mac_states_t lorawan_api_payload_send_at_time( uint8_t fPort, const uint8_t* dataIn, const uint8_t sizeIn,
                                                   uint8_t PacketType, uint32_t TargetTimeMs );
+/*!
+ * \brief Sends an uplink ahead of the traffic in progress
+ * \remark The transmissions of the uplink take the radio from the asap tasks of the other radio planner hooks
+ * \param [in]  same as lorawan_api_payload_send
+ * \param [out] lr1mac_states_t         LWPSTATE_SEND if the uplink is started
+ */
+lr1mac_states_t lorawan_api_payload_send_preempt( uint8_t fPort, const uint8_t* dataIn, const uint8_t sizeIn,
+                                                  uint8_t PacketType, uint32_t TargetTimeMs );
+/*!
+ * \brief Drop the retransmission, the mac answer or the uplink sent at time waiting for its date
+ * \param [out] lr1mac_states_t         Current state of the LoraWan stack, LWPSTATE_IDLE if it was waiting
+ */
+lr1mac_states_t lorawan_api_tx_wait_abort( void );
+/*!
+ * \brief Tell whether the mac answers to the last downlink wait for an uplink to carry them in its fopts
+ * \param [out] bool                    true if the answers are pending
+ */
+bool lorawan_api_nwk_ans_pending_get( void );
+/*!
+ * \brief Send the pending mac answers alone in a port 0 frame, at the fastest datarate the link margin allows
+ * \param [in]  TargetTimeMs            date of the frame
+ * \param [out] lr1mac_states_t         LWPSTATE_SEND if the frame is started
+ */
+lr1mac_states_t lorawan_api_nwk_ans_send( uint32_t TargetTimeMs );
 /*!
  * \brief  Receive Applicative Downlink
  * \param [in] uint8_t*          UserRxFport            Downlinklink Fport
@@ -127,6 +165,13 @@ lr1mac_states_t lorawan_api_payload_send_at_time( uint8_t fPort, const uint8_t*
  */
 status_lorawan_t lorawan_api_payload_receive( uint8_t* UserRxFport, uint8_t* UserRxPayload,
                                               uint8_t* UserRxPayloadSize );
+/*!
+ * \brief  Receive Applicative Downlink without copy
+ * \remark The payload stays valid until the next downlink is received
+ * \param [out] port, payload, size
+ * \param [out] eStatusLoRaWan   Return an error if No Packet available.
+ */
+status_lorawan_t lorawan_api_downlink_get( uint8_t* port, uint8_t** payload, uint8_t* size );
 
 /*!
  * \brief to Send a Join request
@@ -171,6 +216,12 @@ void          lorawan_api_dr_strategy_set( dr_strategy_t adrModeSelect );
 dr_strategy_t lorawan_api_dr_strategy_get( void );
 void          lorawan_api_dr_custom_set( uint32_t DataRateCustom );
 
+/*!
+ * \brief   Replaces the long range datarate distribution by the low power one, see lr1mac_core_dr_low_power_set
+ * \param [in]  is_low_power                    true to use MOBILE_LOWPER_DR_DISTRIBUTION in its place
+ */
+void lorawan_api_dr_low_power_set( bool is_low_power );
+
 /*!
  * \brief   Runs the MAC layer state machine.
  *          Must be called periodically by the application. Not timing critical. Can be interrupted.
@@ -196,10 +247,23 @@ uint8_t lorawan_api_GetRadioState( void );
 void lorawan_api_context_load( void );
 /*!
  * \brief   Save The LoraWAN context in the flash
+ * \remark  The context is only marked as changed, it is written by lorawan_api_context_flush
  * \param [in]  none
  * \param [out] none
  */
 void lorawan_api_context_save( void );
+/*!
+ * \brief   Write the LoraWAN context in the flash if it has changed since the last write
+ * \param [in]  none
+ * \param [out] none
+ */
+void lorawan_api_context_flush( void );
+/*!
+ * \brief   Tell if the LoraWAN context has changed since the last write
+ * \param [in]  none
+ * \param [out] bool true if a write is pending
+ */
+bool lorawan_api_context_is_dirty( void );
 /*!
  * \brief   Get the snr of the last user receive packet
  * \param [in]  none
@@ -346,6 +410,13 @@ uint8_t lorawan_api_min_dr_get( void );
  * \param [out] return the next transmission power
  */
 lr1mac_states_t lorawan_api_state_get( void );
+/*!
+ * \brief   returns the time before lorawan_api_process has to be called again
+ * \remark  radio events of the MAC layer wake up the main loop, only the MAC timers are accounted here
+ * \param [in]  none
+ * \param [out] return delay in ms, 0 if lorawan_api_process has to be called immediately
+ */
+uint32_t lorawan_api_next_process_delay_ms_get( void );
 /*!
  * \brief   returns the current AppsKey.
  * \remark
@@ -381,6 +452,20 @@ receive_win_t lorawan_api_rx_window_get( void );
  * \param [out] return
  */
 uint32_t lorawan_api_next_join_time_second_get( void );
+/*!
+ * \brief   returns true when a join was started and not accepted yet, also after a reset
+ * \remark
+ * \param [in]  none
+ * \param [out] return
+ */
+bool lorawan_api_join_pending_get( void );
+/*!
+ * \brief   forget the pending join and its retry counter
+ * \remark
+ * \param [in]  none
+ * \param [out] return
+ */
+void lorawan_api_join_pending_clear( void );
 /*!
  * \brief   when > 0, returns the min time to perform a new uplink request
  * \remark
@@ -395,6 +480,150 @@ int32_t lorawan_api_next_free_duty_cycle_ms_get( void );
  * \param [out] return
  */
 void lorawan_api_duty_cycle_enable_set( uint8_t enable );
+/*!
+ * \brief   Select the uplink channels at random weighted by their link statistics instead of uniformly
+ * \remark
+ * \param [in]  enable    1 to weight the selection, 0 for the uniform selection by default
+ * \param [out] return
+ */
+void lorawan_api_weighted_channel_selection_enable_set( uint8_t enable );
+/*!
+ * \brief   Get the tx frequencies of the enabled channels, to be scanned for their occupancy
+ * \remark  Only the WW2G4 region has a channel occupancy
+ * \param [out] freq_in_hz   Frequencies of the enabled channels
+ * \param [in]  freq_max     Size of freq_in_hz
+ * \param [out] return       Number of frequencies written
+ */
+uint8_t lorawan_api_channel_scan_plan_get( uint32_t* freq_in_hz, uint8_t freq_max );
+/*!
+ * \brief   Add a channel scan result to the channel occupancy, weighing the weighted channel selection
+ * \remark
+ * \param [in]  freq_in_hz   Frequency scanned
+ * \param [in]  busy_ratio   Share of the samples above the busy threshold, 255 for all of them
+ * \param [out] return
+ */
+void lorawan_api_channel_occupancy_update( uint32_t freq_in_hz, uint8_t busy_ratio );
+/*!
+ * \brief   Listen before talk: do a CAD on the Tx channel before each LoRa uplink
+ * \remark
+ * \param [in]  enable    1 to enable the listen before talk, 0 by default
+ * \param [out] return
+ */
+void lorawan_api_lbt_enable_set( uint8_t enable );
+/*!
+ * \brief   Listen before talk setting
+ * \remark
+ * \param [out] return    1 if the listen before talk is enabled
+ */
+uint8_t lorawan_api_lbt_enable_get( void );
+/*!
+ * \brief   CAD gated RX windows: start the LoRa RX windows with a CAD
+ * \remark
+ * \param [in]  enable    1 to enable the CAD gate, 0 by default
+ * \param [out] return
+ */
+void lorawan_api_rx_cad_gate_enable_set( uint8_t enable );
+/*!
+ * \brief   Uplink power control: lower the uplink power to hold the margin at the gateway
+ * \remark  The path loss is measured on the downlinks
+ * \param [in]  enable        1 to enable the power control, 0 by default
+ * \param [in]  gw_eirp_dbm   EIRP of the gateway downlinks
+ * \param [out] return
+ */
+void lorawan_api_tx_power_ctrl_set( uint8_t enable, int8_t gw_eirp_dbm );
+/*!
+ * \brief   Get the link margin of the uplinks
+ * \remark  Estimated from the SNR of the downlinks and the LinkCheckAns margins
+ * \param [out] margin_db     margin above the demodulation floor at the datarate and power of the last uplink
+ * \param [out] return        ERRORLORAWAN while too few downlinks were received
+ */
+status_lorawan_t lorawan_api_link_margin_get( int16_t* margin_db );
+/*!
+ * \brief   Request the network time with a DeviceTimeReq in the next uplinks
+ * \remark
+ * \param [out] return
+ */
+void lorawan_api_device_time_req( void );
+/*!
+ * \brief   Enable the link check monitor, a LinkCheckReq piggybacked on the application uplinks
+ * \remark  The datarate is lowered when the margin is low or a request is unanswered
+ * \param [in]  enable        1 to enable the monitor
+ */
+void lorawan_api_link_check_enable_set( uint8_t enable );
+/*!
+ * \brief   Get the link state rated by the link check monitor
+ * \param [out] miss_cnt      number of LinkCheckReq unanswered in a row
+ * \param [out] return        link state
+ */
+lr1mac_link_state_t lorawan_api_link_state_get( uint8_t* miss_cnt );
+/*!
+ * \brief   Get the network time
+ * \remark  Based on the last DeviceTimeAns, corrected by the RTC drift
+ * \param [out] gps_time_ms   time since the GPS epoch in milliseconds
+ * \param [out] return        ERRORLORAWAN until a DeviceTimeAns is received
+ */
+status_lorawan_t lorawan_api_network_time_get( uint64_t* gps_time_ms );
+/*!
+ * \brief   Slotted uplinks: send the uplinks in the slot of the device on the network time
+ * \remark  The slot of the device is its DevAddr modulo the number of slots of the frame period
+ * \param [in]  period_ms   frame period, 0 to disable the slots
+ * \param [in]  slot_ms     slot length
+ * \param [out] return      ERRORLORAWAN if the slot doesn't fit in the period
+ */
+status_lorawan_t lorawan_api_tx_slot_set( uint32_t period_ms, uint16_t slot_ms );
+/*!
+ * \brief   Get the slotted uplinks configuration
+ * \remark
+ * \param [out] period_ms   frame period, 0 when the uplinks are not slotted
+ * \param [out] slot_ms     slot length
+ */
+void lorawan_api_tx_slot_get( uint32_t* period_ms, uint16_t* slot_ms );
+/*!
+ * \brief   Set the number of uplinks between two frame counter saves in nvm
+ * \remark
+ * \param [in]  period    Uplinks between two saves, not 0
+ * \param [out] return
+ */
+status_lorawan_t lorawan_api_fcnt_save_period_set( uint16_t period );
+/*!
+ * \brief   Enable or disable the class C continuous reception
+ * \remark  lorawan_api_process has to be called in idle state while class C is enabled
+ * \param [in]  enable    true for class C, false for class A
+ * \param [out] return
+ */
+void lorawan_api_class_c_enable_set( bool enable );
+/*!
+ * \brief   Enable or disable the class B beacon tracking and ping slots
+ * \remark  lorawan_api_process has to be called in idle state while class B is enabled
+ * \param [in]  enable    true for class B, false for class A
+ * \param [out] return
+ */
+void lorawan_api_class_b_enable_set( bool enable );
+/*!
+ * \brief   Set the class B ping slot periodicity
+ * \remark  A ping slot every 2^periodicity seconds
+ * \param [in]  periodicity    0 to 7
+ * \param [out] return         ERRORLORAWAN if the periodicity is out of range
+ */
+status_lorawan_t lorawan_api_class_b_periodicity_set( uint8_t periodicity );
+/*!
+ * \brief   Get the class B state
+ * \remark
+ * \param [in]  none
+ * \param [out] return         off, searching the beacon or tracking it
+ */
+lr1mac_class_b_state_t lorawan_api_class_b_state_get( void );
+/*!
+ * \brief   Set or clear a multicast group received in the class C windows
+ * \remark
+ * \param [in]  group_id      Group index, lower than LR1MAC_MULTICAST_GROUP_NB
+ * \param [in]  mc_addr       Group address
+ * \param [in]  mc_nwk_skey   16 bytes McNwkSKey, NULL to clear the group
+ * \param [in]  mc_app_skey   16 bytes McAppSKey, NULL to clear the group
+ * \param [out] return
+ */
+status_lorawan_t lorawan_api_multicast_set( uint8_t group_id, uint32_t mc_addr, const uint8_t* mc_nwk_skey,
+                                            const uint8_t* mc_app_skey );
 /*!
  * \brief   return the last uplink frame counter
  * \remark
@@ -431,6 +660,22 @@ uint8_t lorawan_api_rp_hook_id_get( void );
  */
 uint8_t lorawan_api_rx_ack_bit_get( void );
 
+/*!
+ * \brief   Get the FPending bit of the downlink answering the last uplink
+ * \remark  The network has more downlinks queued for the device when it is set
+ * \param [in]  none
+ * \param [out] return FPending bit, -1 if no valid downlink answered the last uplink
+ */
+int8_t lorawan_api_rx_fpending_bit_get( void );
+
+/*!
+ * \brief   Send the next uplink at the fastest datarate of the current datarate strategy
+ * \remark  The strategy is applied again from the uplink after
+ * \param [in]  none
+ * \param [out] none
+ */
+void lorawan_api_next_dr_fastest_set( void );
+
 /*!
  * \brief   Get the status of the LoRaWAN certification
  * \remark
@@ -449,6 +694,14 @@ uint8_t lorawan_api_certification( bool new_cmd, uint8_t fport_in, uint8_t* user
                                    uint8_t* user_rx_payload, uint8_t* user_rx_payload_size, uint8_t* user_payload,
                                    uint8_t* user_payload_size );
 
+/*!
+ * \brief   Get the RAM taken by the LoRaWAN stack, its region and its keys
+ * \remark
+ * \param [in]  none
+ * \param [out] return size in bytes
+ */
+uint32_t lorawan_api_get_ram_size( void );
+
 #ifdef __cplusplus
 }
 #endif
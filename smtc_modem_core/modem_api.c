@@ -42,7 +42,18 @@
 #include "modem_context.h"
 #include "lorawan_api.h"
 #include "file_upload.h"
+#include "stream.h"
+#include "outbox.h"
+#include "record_codec.h"
+#include "ranging.h"
+#include "ble_beacon.h"
+#include "raw_radio.h"
+#include "relay.h"
+#include "frag_decoder.h"
+#include "fw_update.h"
 #include "modem_utilities.h"
+#include "modem_pool.h"
+#include "lr1mac_utilities.h"
 #include "crypto.h"
 
 /*
@@ -55,6 +66,9 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+// file upload encryption slice, hashed right after being encrypted (multiple of the AES and SHA256 block sizes)
+#define UPLOAD_ENCRYPT_SLICE_SIZE 64
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -64,12 +78,34 @@
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
-static uint8_t modem_buffer[255];
+// one pool block per application uplink waiting in the supervisor queue, NULL once given to the stack
+static uint8_t* modem_send_blocks[BSP_MODEM_SEND_QUEUE_SIZE];
+
+static uint32_t* upload_pdata[FILE_UPLOAD_MAX_SESSIONS];
 
-static uint32_t* upload_pdata;
+static uint32_t     upload_size[FILE_UPLOAD_MAX_SESSIONS];
+static uint32_t     upload_avgdelay[FILE_UPLOAD_MAX_SESSIONS];
+static sha256_ctx_t upload_hash_ctx[FILE_UPLOAD_MAX_SESSIONS];
+static uint32_t     upload_hashed_size[FILE_UPLOAD_MAX_SESSIONS];
 
-static uint32_t upload_size;
-static uint32_t upload_avgdelay;
+// file upload read through an application reader, encrypted on the fly when requested
+typedef struct upload_source_s
+{
+    uint8_t            sid;
+    file_upload_read_t read;
+    void*              context;
+    bool               is_encrypted;
+    uint32_t           sequence_counter;  // hash of the clear file used as encryption counter
+    uint8_t            key[16];           // AppSKey when the upload was started
+    int32_t            keystream_block;   // block index held in keystream, -1 if none
+    uint8_t            keystream[16];
+} upload_source_t;
+static upload_source_t upload_source[FILE_UPLOAD_MAX_SESSIONS];
+// key schedule shared by the sources, expanded again when another session is read
+static lora_crypto_key_t upload_source_key_ctx;
+static uint8_t           upload_source_key_sid = 0xFF;
+// file upload and stream encryption run in the main loop, apart from the stack crypto context
+static lora_crypto_ctx_t app_crypto_ctx;
 
 static radio_planner_t modem_radio_planner;
 
@@ -99,6 +135,23 @@ static bsp_gpio_irq_t radio_dio_x = {
     .callback = rp_radio_irq_callback,
 };
 
+#if defined( MODEM_DUAL_RADIO )
+// sub-GHz radio next to the 2.4 GHz one, each radio has its own planner so their tasks never block each other
+static radio_planner_t modem_radio_planner_subghz;
+
+static ral_t modem_radio_subghz = { .context    = NULL,
+                                    .radio_type = RAL_RADIO_SX126X,
+                                    .tcxo_cfg   = {
+                                        .tcxo_ctrl_mode = RAL_TCXO_NONE,
+                                    } };
+
+static bsp_gpio_irq_t radio_subghz_dio_x = {
+    .pin      = RADIO_SUBGHZ_DIOX,
+    .context  = &modem_radio_planner_subghz,
+    .callback = rp_radio_irq_callback,
+};
+#endif  // MODEM_DUAL_RADIO
+
 #ifdef LORAWAN_BYPASS_ENABLED
 static bool stream_bypass_enabled = false;
 #endif  // LORAWAN_BYPASS_ENABLED
@@ -107,6 +160,33 @@ static bool stream_bypass_enabled = false;
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+/*!
+ * \brief   Check that the upload can be started with the given file size
+ * \param  [in]     sid                     - file upload session id
+ * \param  [in]     payload_length          - file size
+ * \retval  modem_return_code_t
+ */
+static modem_return_code_t upload_check_start( uint8_t sid, uint16_t payload_length );
+
+/*!
+ * \brief   Launch the file upload task once the file hashes are set
+ * \param  [in]     sid                     - file upload session id
+ * \retval  modem_return_code_t
+ */
+static modem_return_code_t upload_schedule( uint8_t sid );
+
+/*!
+ * \brief   File upload reader given to the file upload service when the file is read through an application reader
+ * \remark  Applies the upload encryption keystream when the upload is encrypted, the last keystream block is
+ *          kept since consecutive chunks share it
+ */
+static void upload_source_read( void* context, uint32_t offset, uint8_t* buffer, uint32_t length );
+
+/*!
+ * \brief   Give back to the pool the blocks of the application uplinks already given to the stack
+ */
+static void modem_send_blocks_release( void );
+
 bool modem_port_reserved( uint8_t f_port )
 {
     return ( f_port >= 224 );
@@ -137,6 +217,13 @@ modem_return_code_t modem_send_tx( uint8_t f_port, e_tx_mode_t msg_type, uint8_t
 {
     modem_return_code_t return_code = RC_OK;
     smodem_task         task_send;
+    uint8_t             send_slot = 0;
+
+    modem_send_blocks_release( );
+    while( ( send_slot < BSP_MODEM_SEND_QUEUE_SIZE ) && ( modem_send_blocks[send_slot] != NULL ) )
+    {
+        send_slot++;
+    }
 
     if( get_modem_muted( ) != MODEM_NOT_MUTE )
     {
@@ -165,8 +252,22 @@ modem_return_code_t modem_send_tx( uint8_t f_port, e_tx_mode_t msg_type, uint8_t
         return_code = RC_FAIL;
         BSP_DBG_TRACE_ERROR( "%s mode must be TX_UNCONFIRMED or TX_CONFIRMED \n", __func__ );
     }
+    else if( send_slot >= BSP_MODEM_SEND_QUEUE_SIZE )
+    {
+        return_code = RC_BUSY;
+        BSP_DBG_TRACE_ERROR( "%s %d uplinks already queued\n", __func__, BSP_MODEM_SEND_QUEUE_SIZE );
+    }
+    else if( ( modem_send_blocks[send_slot] = modem_pool_alloc( ) ) == NULL )
+    {
+        return_code = RC_BUSY;
+        BSP_DBG_TRACE_ERROR( "%s modem pool exhausted\n", __func__ );
+    }
     else
     {
+        uint8_t*    send_buffer = modem_send_blocks[send_slot];
+        modem_qos_t qos;
+
+        get_modem_port_qos( f_port, &qos );
         if( emergency == TX_EMERGENCY_ON )
         {
             task_send.priority = TASK_VERY_HIGH_PRIORITY;
@@ -174,27 +275,35 @@ modem_return_code_t modem_send_tx( uint8_t f_port, e_tx_mode_t msg_type, uint8_t
         }
         else
         {
-            task_send.priority = TASK_HIGH_PRIORITY;
+            task_send.priority = qos.priority;
+        }
+        if( qos.tx_mode != MODEM_QOS_TX_AS_REQUESTED )
+        {
+            msg_type = ( qos.tx_mode == MODEM_QOS_TX_CONFIRMED ) ? TX_CONFIRMED : TX_UNCONFIRMED;
         }
 
-        memcpy( modem_buffer, payload, payload_length );
+        memcpy( send_buffer, payload, payload_length );
 
-        task_send.id                = SEND_TASK;
-        task_send.fPort             = f_port;
-        task_send.PacketType        = msg_type;
-        task_send.dataIn            = modem_buffer;
-        task_send.sizeIn            = payload_length;
-        task_send.time_to_execute_s = bsp_rtc_get_time_s( );
+        task_send.id                 = SEND_TASK;
+        task_send.fPort              = f_port;
+        task_send.PacketType         = msg_type;
+        task_send.dataIn             = send_buffer;
+        task_send.sizeIn             = payload_length;
+        task_send.time_to_execute_ms = bsp_rtc_get_time_ms64( );
 
         BSP_DBG_TRACE_INFO( "add task user tx payload with payload size = %d \n ", payload_length );
         if( modem_supervisor_add_task( &task_send ) != TASK_VALID )
         {
             return_code = RC_FAIL;
+            modem_pool_free( send_buffer );
+            modem_send_blocks[send_slot] = NULL;
+        }
+        else
+        {
+            BSP_PERF_EVENT( BSP_PERF_EVENT_TX_ENQUEUED, f_port );
         }
     }
 
-    //@todo indicate that can't accept a new task because task already enqueued     //   SetModemBusy ();
-
     return return_code;
 }
 
@@ -205,6 +314,9 @@ modem_return_code_t modem_send_tx( uint8_t f_port, e_tx_mode_t msg_type, uint8_t
 
 void modem_init( void ( *callback )( void ) )
 {
+    // the services take their buffers from the pool
+    modem_pool_init( );
+
     // init radio and put it in sleep mode
     ral_init( &modem_radio );
     ral_set_sleep( &modem_radio );
@@ -213,95 +325,85 @@ void modem_init( void ( *callback )( void ) )
     rp_init( &modem_radio_planner, &modem_radio );
     bsp_gpio_irq_attach( &radio_dio_x );
 
+#if defined( MODEM_DUAL_RADIO )
+    ral_init( &modem_radio_subghz );
+    ral_set_sleep( &modem_radio_subghz );
+    rp_init( &modem_radio_planner_subghz, &modem_radio_subghz );
+    bsp_gpio_irq_attach( &radio_subghz_dio_x );
+#endif  // MODEM_DUAL_RADIO
+
     // init modem supervisor
     modem_supervisor_init( callback, &modem_radio_planner );
+
+    // init ranging service, BLE beacon and raw radio tasks on their own radio planner hooks
+    ranging_init( &modem_radio_planner );
+    ble_beacon_init( &modem_radio_planner );
+    raw_radio_init( &modem_radio_planner );
+    relay_init( &modem_radio_planner );
+    channel_scan_init( &modem_radio_planner );
+    frag_decoder_init( );
+    fw_update_init( );
 }
 
 uint32_t modem_run_engine( void )
 {
-    return modem_supervisor_engine( );
+    uint32_t sleep_time_ms = modem_supervisor_engine( );
+
+    // a block is free again as soon as its uplink has been given to the stack
+    modem_send_blocks_release( );
+    return sleep_time_ms;
 }
 
 modem_return_code_t modem_get_event( modem_rsp_event_t* type, uint8_t* count, uint8_t* event_data,
                                      uint8_t* event_data_length, uint8_t* asynchronous_msgnumber )
 {
     modem_return_code_t return_code = RC_OK;
-    modem_rsp_event_t   msg_event   = get_last_msg_event( );
-    *event_data_length              = 0;
 
     *asynchronous_msgnumber = get_asynchronous_msgnumber( );
-    if( *asynchronous_msgnumber > RSP_NUMBER )
+    if( modem_event_pop( type, count, event_data, event_data_length ) == false )
     {
-        BSP_DBG_TRACE_ERROR( "build_get_event_cmd_response, asynchronous_msgnumber overlap" );
-        *asynchronous_msgnumber = 0;
-        *type                   = RSP_NUMBER;
-        return_code             = RC_FAIL;
+        *type              = RSP_NUMBER;
+        *count             = 0;
+        *event_data_length = 0;
     }
-    else if( *asynchronous_msgnumber > 0 )
+
+    return return_code;
+}
+
+modem_return_code_t modem_set_event_handler( modem_rsp_event_t type, modem_event_handler_t handler )
+{
+    if( type >= RSP_NUMBER )
     {
-        *type = msg_event;
+        return RC_INVALID;
+    }
+    set_modem_event_handler( type, handler );
+    return RC_OK;
+}
 
-        // event_data[1] store the counter of overrun event so in case of just one event this counter is set to 0
-        // => -1
-        *count = get_modem_event_count( msg_event ) - 1;
-        // insert the count field in case of overrun
-        switch( msg_event )
-        {
-        case RSP_JOINED:
-            *event_data_length = 0;
-            break;
-        case RSP_RESET:  // count in case of overrun should never append because reset !!!!
-            *event_data_length = 2;
-            event_data[0]      = ( lorawan_api_nb_reset_get( ) ) & 0xFF;
-            event_data[1]      = ( lorawan_api_nb_reset_get( ) ) >> 8;
-            break;
-        case RSP_ALARM:
-            *event_data_length = 0;
-            break;
-        case RSP_DOWNDATA: {
-            s_modem_dwn_t dwnframe;
-            get_modem_downlink_frame( &dwnframe );
-            *event_data_length = 4 + dwnframe.length;
-            event_data[0]      = dwnframe.rssi;
-            event_data[1]      = dwnframe.snr;
-            // TODO UL_ACK() | lorawan_api_GetRxWindow()
-            event_data[2] = 0;  // ;
-            event_data[3] = dwnframe.port;
-            memcpy( &event_data[4], dwnframe.data, dwnframe.length );
-            break;
-        }
-        case RSP_FILEDONE:
-            *event_data_length = 1;
-            event_data[0]      = get_modem_event_status( msg_event );
-            break;
-        case RSP_TXDONE:
-            *event_data_length = 1;
-            event_data[0]      = get_modem_event_status( msg_event );
-            break;
-        case RSP_SETCONF:
-            *event_data_length = 1;
-            event_data[0]      = get_modem_event_status( msg_event );
-            break;
-        case RSP_MUTE:
-            *event_data_length = 1;
-            event_data[0]      = ( get_modem_muted( ) == MODEM_NOT_MUTE ) ? false : true;
-            break;
-        case RSP_LINKSTATUS:
-            // @ TODO
-            break;
-        default:
-            // already manage by the first test in the function
-            break;
-        }
-        // Reset the status after get the value
-        set_modem_event_count( msg_event, 0 );
-        decrement_asynchronous_msgnumber( );
+modem_return_code_t modem_get_events( uint8_t* buffer, uint8_t max_length, uint8_t* length,
+                                      uint8_t* asynchronous_msgnumber )
+{
+    modem_return_code_t return_code = RC_OK;
+    modem_rsp_event_t   type;
+    uint8_t             data_length;
+
+    if( max_length < 1 )
+    {
+        *length = 0;
+        return RC_BAD_SIZE;
     }
-    else
+
+    // each event is packed as type, count, data length and data, the ones that do not fit are left queued
+    *length = 1;
+    while( ( get_asynchronous_msgnumber( ) > 0 ) && ( ( *length + 3 + get_modem_event_data_length( ) ) <= max_length ) )
     {
-        *asynchronous_msgnumber = 0;
-        *type                   = RSP_NUMBER;
+        modem_event_pop( &type, &buffer[*length + 1], &buffer[*length + 3], &data_length );
+        buffer[*length]     = type;
+        buffer[*length + 2] = data_length;
+        *length += 3 + data_length;
     }
+    *asynchronous_msgnumber = get_asynchronous_msgnumber( );
+    buffer[0]               = *asynchronous_msgnumber;
 
     return return_code;
 }
@@ -345,6 +447,118 @@ modem_return_code_t modem_get_charge( uint32_t* charge )
     return return_code;
 }
 
+modem_return_code_t modem_get_rp_stats( uint8_t* buffer, uint8_t* length )
+{
+    modem_return_code_t return_code = RC_OK;
+    modem_rp_stats_t    rp_stats;
+    uint8_t*            p = buffer;
+
+    get_modem_rp_stats( MODEM_RP_STATS_READER_HOST, &rp_stats );
+    for( uint8_t i = 0; i < RP_NB_HOOKS; i++ )
+    {
+        const uint16_t aborted_nb   = MIN( rp_stats.aborted_nb[i], 0xFFFF );
+        const uint16_t postponed_nb = MIN( rp_stats.postponed_nb[i], 0xFFFF );
+
+        *p++ = ( rp_stats.tx_ms[i] >> 24 ) & 0xFF;
+        *p++ = ( rp_stats.tx_ms[i] >> 16 ) & 0xFF;
+        *p++ = ( rp_stats.tx_ms[i] >> 8 ) & 0xFF;
+        *p++ = rp_stats.tx_ms[i] & 0xFF;
+        *p++ = ( rp_stats.rx_ms[i] >> 24 ) & 0xFF;
+        *p++ = ( rp_stats.rx_ms[i] >> 16 ) & 0xFF;
+        *p++ = ( rp_stats.rx_ms[i] >> 8 ) & 0xFF;
+        *p++ = rp_stats.rx_ms[i] & 0xFF;
+        *p++ = aborted_nb >> 8;
+        *p++ = aborted_nb & 0xFF;
+        *p++ = postponed_nb >> 8;
+        *p++ = postponed_nb & 0xFF;
+    }
+    const uint16_t rp_error = MIN( rp_stats.rp_error, 0xFFFF );
+    *p++                    = rp_error >> 8;
+    *p++                    = rp_error & 0xFF;
+
+    *length = p - buffer;
+    return return_code;
+}
+
+void modem_get_ram_usage( modem_ram_usage_t* usage )
+{
+    bsp_mcu_stack_stats_t stack_stats;
+
+    usage->lorawan       = lorawan_api_get_ram_size( );
+    usage->radio_planner = sizeof( modem_radio_planner );
+#if defined( MODEM_DUAL_RADIO )
+    usage->radio_planner += sizeof( modem_radio_planner_subghz );
+#endif  // MODEM_DUAL_RADIO
+    usage->send_queue    = sizeof( modem_send_blocks );
+    usage->crypto        = sizeof( app_crypto_ctx ) + sizeof( upload_source_key_ctx ) + sizeof( upload_hash_ctx );
+    usage->file_upload   = file_upload_get_ram_size( ) + sizeof( upload_pdata ) + sizeof( upload_size ) +
+                         sizeof( upload_avgdelay ) + sizeof( upload_hashed_size ) + sizeof( upload_source );
+    usage->stream = stream_get_ram_size( );
+
+    bsp_mcu_get_stack_stats( &stack_stats );
+    usage->stack_size     = stack_stats.size;
+    usage->stack_used_max = stack_stats.used_max;
+
+    modem_pool_stats_t pool_stats;
+
+    modem_pool_get_stats( &pool_stats );
+    usage->pool          = modem_pool_get_ram_size( );
+    usage->pool_used_max = pool_stats.used_max * MODEM_POOL_BLOCK_SIZE;
+}
+
+modem_return_code_t modem_get_ram_usage_report( uint8_t* buffer, uint8_t* length )
+{
+    modem_return_code_t return_code = RC_OK;
+    modem_ram_usage_t   usage;
+    uint8_t*            p = buffer;
+
+    modem_get_ram_usage( &usage );
+    const uint32_t* field = ( const uint32_t* ) &usage;
+    for( uint8_t i = 0; i < ( sizeof( usage ) / sizeof( uint32_t ) ); i++ )
+    {
+        const uint16_t value = MIN( field[i], 0xFFFF );
+
+        *p++ = value >> 8;
+        *p++ = value & 0xFF;
+    }
+
+    *length = p - buffer;
+    return return_code;
+}
+
+void modem_get_energy( modem_energy_t* energy )
+{
+    bsp_mcu_power_stats_t power_stats;
+
+    get_modem_mcu_power_stats( &power_stats );
+    energy->mcu_run_ms  = power_stats.run_time_ms;
+    energy->mcu_stop_ms = power_stats.stop_time_ms;
+    energy->wakeup_nb   = power_stats.wakeup_nb;
+    energy->radio_tx_ms = modem_radio_planner.stats.tx_total_consumption_ms;
+    energy->radio_rx_ms = modem_radio_planner.stats.rx_total_consumption_ms;
+    energy->charge_uah  = ( uint32_t ) ( get_modem_charge_ua_ms( ) / 3600000 );
+}
+
+modem_return_code_t modem_get_energy_report( uint8_t* buffer, uint8_t* length )
+{
+    modem_return_code_t return_code = RC_OK;
+    modem_energy_t      energy;
+    uint8_t*            p = buffer;
+
+    modem_get_energy( &energy );
+    const uint32_t* field = ( const uint32_t* ) &energy;
+    for( uint8_t i = 0; i < ( sizeof( energy ) / sizeof( uint32_t ) ); i++ )
+    {
+        *p++ = ( field[i] >> 24 ) & 0xFF;
+        *p++ = ( field[i] >> 16 ) & 0xFF;
+        *p++ = ( field[i] >> 8 ) & 0xFF;
+        *p++ = field[i] & 0xFF;
+    }
+
+    *length = p - buffer;
+    return return_code;
+}
+
 modem_return_code_t modem_get_tx_power_offset( int8_t* tx_pwr_offset )
 {
     modem_return_code_t return_code = RC_OK;
@@ -361,6 +575,34 @@ modem_return_code_t modem_set_tx_power_offset( int8_t tx_pwr_offset )
     return return_code;
 }
 
+modem_return_code_t modem_get_time( uint32_t* gps_time_s, uint16_t* gps_fraction_ms )
+{
+    uint64_t gps_time_ms = 0;
+
+    *gps_time_s      = 0;
+    *gps_fraction_ms = 0;
+    if( lorawan_api_network_time_get( &gps_time_ms ) == OKLORAWAN )
+    {
+        *gps_time_s      = ( uint32_t )( gps_time_ms / 1000 );
+        *gps_fraction_ms = ( uint16_t )( gps_time_ms % 1000 );
+        if( *gps_time_s == 0 )
+        {
+            *gps_time_s = 1;
+        }
+    }
+    return RC_OK;
+}
+
+modem_return_code_t modem_request_time_sync( void )
+{
+    if( get_join_state( ) != MODEM_JOINED )
+    {
+        return RC_FAIL;
+    }
+    lorawan_api_device_time_req( );
+    return RC_OK;
+}
+
 modem_return_code_t modem_get_status( uint8_t* status )
 {
     modem_return_code_t return_code = RC_OK;
@@ -454,6 +696,63 @@ modem_return_code_t modem_set_class( modem_class_t class )
     return return_code;
 }
 
+modem_return_code_t modem_set_class_b_periodicity( uint8_t periodicity )
+{
+    if( lorawan_api_class_b_periodicity_set( periodicity ) != OKLORAWAN )
+    {
+        BSP_DBG_TRACE_ERROR( "%s call with periodicity not valid\n", __func__ );
+        return RC_INVALID;
+    }
+    return RC_OK;
+}
+
+modem_return_code_t modem_get_class_b_state( lr1mac_class_b_state_t* state )
+{
+    *state = lorawan_api_class_b_state_get( );
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_multicast( uint8_t group_id, uint32_t mc_addr, const uint8_t* mc_nwk_skey,
+                                         const uint8_t* mc_app_skey )
+{
+    if( lorawan_api_multicast_set( group_id, mc_addr, mc_nwk_skey, mc_app_skey ) != OKLORAWAN )
+    {
+        BSP_DBG_TRACE_ERROR( "%s call with group not valid\n", __func__ );
+        return RC_INVALID;
+    }
+    return RC_OK;
+}
+
+modem_return_code_t modem_fw_update_block( uint16_t index, const uint8_t* data, uint8_t size, uint32_t block_crc,
+                                           uint16_t* next_block )
+{
+    modem_return_code_t return_code = RC_OK;
+
+    switch( fw_update_block( index, data, size, block_crc ) )
+    {
+    case FW_UPDATE_STATUS_OK:
+        break;
+    case FW_UPDATE_STATUS_NOT_STARTED:
+        return_code = RC_NOT_INIT;
+        break;
+    case FW_UPDATE_STATUS_BAD_CRC:
+        return_code = RC_BAD_CRC;
+        break;
+    case FW_UPDATE_STATUS_FLASH_ERROR:
+        return_code = RC_FAIL;
+        break;
+    case FW_UPDATE_STATUS_BAD_HASH:
+        return_code = RC_BAD_SIG;
+        break;
+    default:
+        BSP_DBG_TRACE_ERROR( "%s call with block %d not expected\n", __func__, index );
+        return_code = RC_INVALID;
+        break;
+    }
+    *next_block = fw_update_next_block_get( );
+    return return_code;
+}
+
 modem_return_code_t modem_get_region( uint8_t* region )
 {
     modem_return_code_t return_code = RC_OK;
@@ -464,17 +763,21 @@ modem_return_code_t modem_get_region( uint8_t* region )
 modem_return_code_t modem_set_region( uint8_t region )
 {
     modem_return_code_t return_code = RC_OK;
-    if( get_join_state( ) != MODEM_NOT_JOINED )
+    if( get_join_state( ) == MODEM_JOIN_ONGOING )
     {
-        BSP_DBG_TRACE_ERROR( "%s call but the device is already join\n", __func__ );
+        BSP_DBG_TRACE_ERROR( "%s call but the device is joining\n", __func__ );
         return RC_BUSY;
     }
-
-    if( set_modem_region( region ) == SET_ERROR )
+    if( lorawan_api_is_supported_region( ( smtc_real_region_types_t ) region ) != OKLORAWAN )
     {
         BSP_DBG_TRACE_ERROR( "%s call with region not valid\n", __func__ );
         return RC_INVALID;
     }
+    if( set_modem_region( region ) == SET_ERROR )
+    {  // a frame is being sent or received
+        BSP_DBG_TRACE_ERROR( "%s call but the stack is busy\n", __func__ );
+        return RC_BUSY;
+    }
 
     lorawan_api_dr_strategy_set( STATIC_ADR_MODE );
     return return_code;
@@ -501,13 +804,13 @@ modem_return_code_t modem_set_adr_profile( dr_strategy_t adr_profile, uint8_t ad
     modem_return_code_t return_code = RC_OK;
     e_set_error_t       status;
 
-    if( adr_profile < USER_DR_DISTRIBUTION )
+    if( adr_profile == USER_DR_DISTRIBUTION )
     {
-        status = set_modem_adr_profile( adr_profile, adr_custom_data, 0 );
+        status = set_modem_adr_profile( adr_profile, adr_custom_data, 16 );
     }
-    else if( adr_profile == USER_DR_DISTRIBUTION )
+    else if( adr_profile < UNKNOWN_DR )
     {
-        status = set_modem_adr_profile( adr_profile, adr_custom_data, 16 );
+        status = set_modem_adr_profile( adr_profile, adr_custom_data, 0 );
     }
     else
     {
@@ -541,6 +844,20 @@ modem_return_code_t modem_set_dm_port( uint8_t dm_port )
     return return_code;
 }
 
+modem_return_code_t modem_get_host_baudrate( uint8_t* baudrate_index )
+{
+    modem_return_code_t return_code = RC_OK;
+    *baudrate_index                 = get_modem_host_baudrate( );
+    return return_code;
+}
+
+modem_return_code_t modem_set_host_baudrate( uint8_t baudrate_index )
+{
+    modem_return_code_t return_code = RC_OK;
+    set_modem_host_baudrate( baudrate_index );
+    return return_code;
+}
+
 modem_return_code_t modem_get_dm_info_interval( uint8_t* interval )
 {
     modem_return_code_t return_code = RC_OK;
@@ -642,6 +959,7 @@ modem_return_code_t modem_leave_network( void )
     modem_return_code_t return_code = RC_OK;
     set_modem_status_modem_joined( false );
     lorawan_api_join_status_clear( );
+    lorawan_api_join_pending_clear( );
     set_modem_status_joining( false );
     return return_code;
 }
@@ -688,119 +1006,612 @@ modem_return_code_t modem_emergency_tx( uint8_t f_port, e_tx_mode_t msg_type, ui
     return return_code;
 }
 
-modem_return_code_t modem_upload_init( uint8_t f_port, file_upload_encrypt_mode_t encryption_mode, uint16_t size,
-                                       uint16_t average_delay )
+modem_return_code_t modem_set_tx_coalescing( bool enable )
+{
+    set_modem_tx_coalescing( enable );
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_port_qos( uint8_t f_port, const modem_qos_t* qos )
+{
+    if( ( f_port == 0 ) || ( f_port >= 224 ) || ( f_port == get_modem_dm_port( ) ) )
+    {
+        BSP_DBG_TRACE_ERROR( "%s port %d is forbidden \n", __func__, f_port );
+        return RC_INVALID;
+    }
+    if( ( qos != NULL ) && ( ( qos->priority < TASK_HIGH_PRIORITY ) || ( qos->priority > TASK_LOW_PRIORITY ) ||
+                             ( qos->tx_mode > MODEM_QOS_TX_CONFIRMED ) ||
+                             ( ( qos->is_dropped_when_stale == true ) && ( qos->max_delay_s == 0 ) ) ) )
+    {
+        return RC_INVALID;
+    }
+    if( set_modem_port_qos( f_port, qos ) == false )
+    {
+        BSP_DBG_TRACE_ERROR( "%s %d ports already have a QoS class\n", __func__, MODEM_QOS_PORT_NB );
+        return RC_BUSY;
+    }
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_store_and_forward( bool enable )
+{
+    set_modem_store_and_forward( enable );
+    return RC_OK;
+}
+
+modem_return_code_t modem_get_outbox_count( uint16_t* count )
+{
+    if( count == NULL )
+    {
+        return RC_INVALID;
+    }
+    *count = outbox_get_record_count( );
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_dm_piggyback( bool enable )
+{
+    set_modem_dm_piggyback( enable );
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_task_jitter( uint8_t percent )
+{
+    if( set_modem_task_jitter( percent ) != SET_OK )
+    {
+        return RC_INVALID;
+    }
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_airtime_budget( uint32_t budget_ms_per_hour )
+{
+    if( budget_ms_per_hour > MODEM_AIRTIME_BUDGET_MAX_MS )
+    {
+        return RC_INVALID;
+    }
+    modem_supervisor_airtime_budget_set( budget_ms_per_hour );
+    return RC_OK;
+}
+
+modem_return_code_t modem_get_airtime( uint32_t* airtime_ms )
+{
+    if( airtime_ms == NULL )
+    {
+        return RC_INVALID;
+    }
+    modem_supervisor_airtime_get( airtime_ms );
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_weighted_channel_selection( bool enable )
+{
+    lorawan_api_weighted_channel_selection_enable_set( ( enable == true ) ? 1 : 0 );
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_lbt( bool enable )
+{
+    lorawan_api_lbt_enable_set( ( enable == true ) ? 1 : 0 );
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_link_monitor( bool enable )
+{
+    lorawan_api_link_check_enable_set( ( enable == true ) ? 1 : 0 );
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_rx_cad_gate( bool enable )
+{
+    lorawan_api_rx_cad_gate_enable_set( ( enable == true ) ? 1 : 0 );
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_tx_power_ctrl( bool enable, int8_t gw_eirp_dbm )
+{
+    lorawan_api_tx_power_ctrl_set( ( enable == true ) ? 1 : 0, gw_eirp_dbm );
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_tx_slot( uint16_t period_s, uint16_t slot_ms )
+{
+    return ( lorawan_api_tx_slot_set( ( uint32_t ) period_s * 1000, slot_ms ) == OKLORAWAN ) ? RC_OK : RC_INVALID;
+}
+
+modem_return_code_t modem_set_fcnt_save_period( uint16_t period )
+{
+    return ( lorawan_api_fcnt_save_period_set( period ) == OKLORAWAN ) ? RC_OK : RC_INVALID;
+}
+
+modem_return_code_t modem_set_dm_delta( uint8_t keyframe_period )
+{
+    set_dm_delta_keyframe_period( keyframe_period );
+    return RC_OK;
+}
+
+modem_return_code_t modem_set_dm_delta_threshold( e_dm_info_t tag, uint16_t threshold )
+{
+    return ( set_dm_delta_threshold( tag, threshold ) == SET_OK ) ? RC_OK : RC_INVALID;
+}
+
+modem_return_code_t modem_set_context_store_hold( bool hold )
+{
+    if( hold == true )
+    {
+        modem_store_context_hold( );
+    }
+    else
+    {
+        modem_store_context_release( );
+    }
+    return RC_OK;
+}
+
+modem_return_code_t modem_upload_init( uint8_t sid, uint8_t f_port, file_upload_encrypt_mode_t encryption_mode,
+                                       uint16_t size, uint16_t average_delay )
 {
     modem_return_code_t return_code = RC_OK;
 
-    if( ( f_port == 0 ) || ( f_port >= 224 ) || ( encryption_mode > FILE_UPLOAD_ENCRYPTED ) )
+    if( ( sid >= FILE_UPLOAD_MAX_SESSIONS ) || ( f_port == 0 ) || ( f_port >= 224 ) ||
+        ( ( encryption_mode & ~( FILE_UPLOAD_ENCRYPTED | FILE_UPLOAD_CODEC_LZ ) ) != 0 ) )
     {
         return_code = RC_INVALID;
     }
+    else if( size == 0 )
+    {
+        // the other sessions go on, the supervisor skips the session which is not started anymore
+        BSP_DBG_TRACE_WARNING( "FileUpload Cancel!\n" );
+        file_upload_end( sid );
+        modem_set_upload_state( sid, MODEM_UPLOAD_NOT_INIT );
+    }
+    else if( modem_get_upload_state( sid ) != MODEM_UPLOAD_NOT_INIT )
+    {
+        return_code = RC_BUSY;
+        BSP_DBG_TRACE_ERROR( "File Upload still in going\n" );
+    }
     else
     {
-        // upload_clear(UPLOAD_SID);
-        set_modem_status_file_upload( false );
-        upload_size = size;
+        upload_size[sid]     = size;
+        upload_avgdelay[sid] = average_delay;
+        int8_t session_counter =
+            file_upload_create( sid, &upload_pdata[sid], size, average_delay, f_port, encryption_mode );
 
-        if( upload_size == 0 )
-        {
-            BSP_DBG_TRACE_WARNING( "FileUpload Cancel!\n" );
-            modem_set_upload_state( MODEM_UPLOAD_NOT_INIT );
-        }
-        else if( modem_get_upload_state( ) != MODEM_UPLOAD_NOT_INIT )
+        if( session_counter < 0 )
         {
-            return_code = RC_BUSY;
-            BSP_DBG_TRACE_ERROR( "File Upload still in going\n" );
+            return_code = RC_FAIL;
         }
         else
         {
-            upload_avgdelay = average_delay;
-            int8_t session_counter =
-                file_upload_create( UPLOAD_SID, &upload_pdata, upload_size, upload_avgdelay, f_port, encryption_mode );
-
-            if( session_counter < 0 )
-            {
-                return_code = RC_FAIL;
-            }
-            else
-            {
-                modem_set_upload_state( MODEM_UPLOAD_INIT );
-            }
+            sha256_init( &upload_hash_ctx[sid] );
+            upload_hashed_size[sid] = 0;
+            modem_set_upload_state( sid, MODEM_UPLOAD_INIT );
         }
     }
 
     return return_code;
 }
 
-modem_return_code_t modem_upload_start( uint8_t* payload, uint16_t payload_length )
+modem_return_code_t modem_upload_start( uint8_t sid, uint8_t* payload, uint16_t payload_length )
 {
     modem_return_code_t return_code = RC_OK;
-    if( payload == NULL )
+    if( sid >= FILE_UPLOAD_MAX_SESSIONS )
+    {
+        return_code = RC_INVALID;
+    }
+    else if( payload == NULL )
     {
         return_code = RC_NOT_INIT;
         BSP_DBG_TRACE_ERROR( "Upload file data, null\n" );
     }
     else
     {
-        upload_pdata = ( uint32_t* ) payload;
-        file_upload_attach_payload_buffer( ( uint8_t* ) upload_pdata );
+        return_code = upload_check_start( sid, payload_length );
+    }
+    if( return_code == RC_OK )
+    {
+        uint32_t size = upload_size[sid];
+
+        upload_pdata[sid] = ( uint32_t* ) payload;
+        file_upload_attach_payload_buffer( sid, ( uint8_t* ) upload_pdata[sid] );
+        modem_set_upload_state( sid, MODEM_UPLOAD_DATA );
 
-        modem_set_upload_state( MODEM_UPLOAD_DATA );
-        if( modem_get_upload_state( ) == MODEM_UPLOAD_START )
+        if( file_upload_is_compressed( sid ) == true )
         {
-            return_code = RC_BUSY;
-            BSP_DBG_TRACE_ERROR( "FileUpload in progress..\n" );
+            // compressed before being hashed and encrypted, the receiver decompresses the file it rebuilt
+            int32_t compressed_size = lz_compress_in_place( payload, size );
+            file_upload_set_compressed_size( sid, compressed_size );
+            if( compressed_size >= 0 )
+            {
+                BSP_DBG_TRACE_PRINTF( "FileUpload compressed %lu -> %ld\n", size, compressed_size );
+                size                    = compressed_size;
+                upload_hashed_size[sid] = 0;  // the hash of the raw file doesn't match anymore
+            }
+        }
+
+        uint32_t hash[8];
+        if( upload_hashed_size[sid] == size )
+        {
+            // data already hashed while received by modem_upload_hash_data
+            sha256_final( &upload_hash_ctx[sid], hash );
         }
-        else if( modem_get_upload_state( ) != MODEM_UPLOAD_DATA )
+        else
         {
-            return_code = RC_NOT_INIT;
-            BSP_DBG_TRACE_ERROR( "RC_NOT_INIT in FileUpload bad state\n" );
+            sha256( hash, ( unsigned char* ) upload_pdata[sid], size );
         }
+        file_upload_set_hash( sid, hash[0], hash[1] );
 
-        else if( payload_length != upload_size )
+        if( file_upload_get_encryption_mode( sid ) == FILE_UPLOAD_ENCRYPTED )
         {
-            return_code = RC_BAD_SIZE;
-            BSP_DBG_TRACE_ERROR( "RC_BAD_SIZE in FileUpload upload_current_size = %u and upload_size %u \n",
-                                 payload_length, upload_size );
+            uint32_t          temp_hash = hash[1];
+            uint8_t*          data      = ( uint8_t* ) upload_pdata[sid];
+            lora_crypto_key_t key_ctx;
+
+            // encrypt and compute hash over encrypted data in a single pass
+            lora_crypto_key_set( &key_ctx, lorawan_api_apps_key_get( ) );
+            sha256_init( &upload_hash_ctx[sid] );
+            for( uint32_t offset = 0; offset < size; offset += UPLOAD_ENCRYPT_SLICE_SIZE )
+            {
+                uint16_t slice_size =
+                    ( ( size - offset ) < UPLOAD_ENCRYPT_SLICE_SIZE ) ? ( size - offset ) : UPLOAD_ENCRYPT_SLICE_SIZE;
+                lora_crypto_keyed_payload_encrypt_slice( &app_crypto_ctx, &data[offset], slice_size, &key_ctx, size,
+                                                         FILE_UPLOAD_DIRECTION, hash[0], 1 + ( offset >> 4 ),
+                                                         &data[offset] );
+                sha256_update( &upload_hash_ctx[sid], &data[offset], slice_size );
+            }
+            sha256_final( &upload_hash_ctx[sid], hash );
+            file_upload_set_hash( sid, hash[0], temp_hash );
         }
+        file_upload_resume( sid );
+        return_code = upload_schedule( sid );
+    }
+    return return_code;
+}
 
-        else
+modem_return_code_t modem_upload_start_from_reader( uint8_t sid, file_upload_read_t read, void* context,
+                                                    uint16_t payload_length )
+{
+    modem_return_code_t return_code = RC_OK;
+    if( sid >= FILE_UPLOAD_MAX_SESSIONS )
+    {
+        return_code = RC_INVALID;
+    }
+    else if( read == NULL )
+    {
+        return_code = RC_NOT_INIT;
+        BSP_DBG_TRACE_ERROR( "Upload file reader, null\n" );
+    }
+    else
+    {
+        return_code = upload_check_start( sid, payload_length );
+    }
+    if( return_code == RC_OK )
+    {
+        upload_source_t* source = &upload_source[sid];
+        uint32_t         size   = upload_size[sid];
+        uint8_t          slice[UPLOAD_ENCRYPT_SLICE_SIZE];
+        uint32_t         hash[8];
+
+        source->sid             = sid;
+        source->read            = read;
+        source->context         = context;
+        source->is_encrypted    = false;
+        source->keystream_block = -1;
+        file_upload_attach_payload_reader( sid, upload_source_read, source );
+        modem_set_upload_state( sid, MODEM_UPLOAD_DATA );
+        file_upload_set_compressed_size( sid, -1 );  // the file is not in RAM to be compressed, it is sent as it is
+
+        // the file is left untouched in its memory: hash it, and hash its encrypted version, slice by slice
+        sha256_init( &upload_hash_ctx[sid] );
+        for( uint32_t offset = 0; offset < size; offset += UPLOAD_ENCRYPT_SLICE_SIZE )
         {
-            uint32_t hash[8];
-            sha256( hash, ( unsigned char* ) upload_pdata, upload_size );
-            file_upload_set_hash( hash[0], hash[1] );
+            uint16_t slice_size =
+                ( ( size - offset ) < UPLOAD_ENCRYPT_SLICE_SIZE ) ? ( size - offset ) : UPLOAD_ENCRYPT_SLICE_SIZE;
+            upload_source_read( source, offset, slice, slice_size );
+            sha256_update( &upload_hash_ctx[sid], slice, slice_size );
+        }
+        sha256_final( &upload_hash_ctx[sid], hash );
+        file_upload_set_hash( sid, hash[0], hash[1] );
+
+        if( file_upload_get_encryption_mode( sid ) == FILE_UPLOAD_ENCRYPTED )
+        {
+            uint32_t temp_hash = hash[1];
 
-            if( file_upload_get_encryption_mode( ) == FILE_UPLOAD_ENCRYPTED )
+            memcpy( source->key, lorawan_api_apps_key_get( ), sizeof( source->key ) );
+            if( upload_source_key_sid == sid )
             {
-                uint32_t temp_hash = hash[1];
-                lora_crypto_payload_encrypt( ( uint8_t* ) upload_pdata, upload_size, lorawan_api_apps_key_get( ),
-                                             upload_size, FILE_UPLOAD_DIRECTION, hash[0], ( uint8_t* ) upload_pdata );
-                // compute hash over encrypted data
-                sha256( hash, ( unsigned char* ) upload_pdata, upload_size );
-                file_upload_set_hash( hash[0], temp_hash );
+                upload_source_key_sid = 0xFF;  // the key may have changed since the last upload of this session
             }
-            // start streaming of chunks
-
-            smodem_task upload_task;
-            upload_task.id                = FILE_UPLOAD_TASK;
-            upload_task.priority          = TASK_HIGH_PRIORITY;
-            upload_task.time_to_execute_s = bsp_rtc_get_time_s( ) + 2;
-            if( modem_supervisor_add_task( &upload_task ) != TASK_VALID )
+            source->sequence_counter = hash[0];
+            source->is_encrypted     = true;
+            sha256_init( &upload_hash_ctx[sid] );
+            for( uint32_t offset = 0; offset < size; offset += UPLOAD_ENCRYPT_SLICE_SIZE )
             {
-                return_code = RC_FAIL;
+                uint16_t slice_size =
+                    ( ( size - offset ) < UPLOAD_ENCRYPT_SLICE_SIZE ) ? ( size - offset ) : UPLOAD_ENCRYPT_SLICE_SIZE;
+                upload_source_read( source, offset, slice, slice_size );
+                sha256_update( &upload_hash_ctx[sid], slice, slice_size );
             }
-            else
+            sha256_final( &upload_hash_ctx[sid], hash );
+            file_upload_set_hash( sid, hash[0], temp_hash );
+        }
+        file_upload_resume( sid );
+        return_code = upload_schedule( sid );
+    }
+    return return_code;
+}
+
+void modem_upload_hash_data( uint8_t sid, const uint8_t* payload, uint16_t payload_length )
+{
+    if( sid < FILE_UPLOAD_MAX_SESSIONS )
+    {
+        sha256_update( &upload_hash_ctx[sid], payload, payload_length );
+        upload_hashed_size[sid] += payload_length;
+    }
+}
+
+uint16_t modem_upload_avgdelay_get( uint8_t sid )
+{
+    return ( sid < FILE_UPLOAD_MAX_SESSIONS ) ? upload_avgdelay[sid] : 0;
+}
+
+modem_return_code_t modem_stream_init( uint8_t f_port, bool encryption )
+{
+    modem_return_code_t return_code = RC_OK;
+
+    if( f_port >= 224 )
+    {
+        return_code = RC_INVALID;
+    }
+    else if( modem_get_stream_state( ) == MODEM_STREAM_DATA_PENDING )
+    {
+        return_code = RC_BUSY;
+        BSP_DBG_TRACE_ERROR( "Stream still in going\n" );
+    }
+    else
+    {
+        stream_init( );
+        modem_set_stream_port( f_port );
+        modem_set_stream_encryption( encryption );
+        modem_set_stream_state( MODEM_STREAM_INIT );
+    }
+    return return_code;
+}
+
+modem_return_code_t modem_stream_add_data( uint8_t f_port, const uint8_t* data, uint8_t len )
+{
+    modem_return_code_t return_code = RC_OK;
+    uint8_t             record[255];
+
+    if( modem_get_stream_state( ) == MODEM_STREAM_NOT_INIT )
+    {
+        return_code = RC_NOT_INIT;
+        BSP_DBG_TRACE_ERROR( "Stream not init\n" );
+    }
+    else if( ( f_port != modem_get_stream_port( ) ) || ( len == 0 ) )
+    {
+        return_code = RC_INVALID;
+    }
+    else
+    {
+        memcpy( record, data, len );
+        if( modem_get_stream_encryption( ) == true )
+        {
+            lora_crypto_payload_encrypt( &app_crypto_ctx, record, len, lorawan_api_apps_key_get( ), f_port,
+                                         STREAM_DIRECTION, stream_get_record_count( ), record );
+        }
+        if( stream_add_record( record, len ) == false )
+        {
+            return_code = RC_BUSY;
+            BSP_DBG_TRACE_WARNING( "Stream fifo full\n" );
+        }
+        else if( modem_get_stream_state( ) == MODEM_STREAM_INIT )
+        {
+            modem_set_stream_state( MODEM_STREAM_DATA_PENDING );
+            set_modem_status_streaming( true );
+            if( get_join_state( ) == MODEM_JOINED )
             {
-                modem_set_upload_state( MODEM_UPLOAD_START );
+                modem_supervisor_add_task_stream( );
             }
         }
     }
     return return_code;
 }
-uint16_t modem_upload_avgdelay_get( void )
+
+modem_return_code_t modem_stream_status( uint8_t f_port, uint16_t* pending, uint16_t* free_space )
 {
-    return upload_avgdelay;
+    modem_return_code_t return_code = RC_OK;
+
+    if( modem_get_stream_state( ) == MODEM_STREAM_NOT_INIT )
+    {
+        return_code = RC_NOT_INIT;
+    }
+    else if( f_port != modem_get_stream_port( ) )
+    {
+        return_code = RC_INVALID;
+    }
+    else
+    {
+        stream_status( pending, free_space );
+    }
+    return return_code;
+}
+
+modem_return_code_t modem_record_init( uint8_t nb_fields, uint8_t absolute_mask )
+{
+    modem_return_code_t return_code = RC_OK;
+
+    if( record_codec_get_record_count( ) > 0 )
+    {
+        return_code = RC_BUSY;
+        BSP_DBG_TRACE_ERROR( "Sensor records still queued\n" );
+    }
+    else if( record_codec_init( nb_fields, absolute_mask ) == false )
+    {
+        return_code = RC_INVALID;
+    }
+    return return_code;
+}
+
+modem_return_code_t modem_record_add( const int32_t* values )
+{
+    modem_return_code_t return_code = RC_OK;
+
+    if( record_codec_get_nb_fields( ) == 0 )
+    {
+        return_code = RC_NOT_INIT;
+    }
+    else if( values == NULL )
+    {
+        return_code = RC_INVALID;
+    }
+    else if( record_codec_add_record( values ) == false )
+    {
+        return_code = RC_BUSY;
+        BSP_DBG_TRACE_WARNING( "Sensor record queue full\n" );
+    }
+    return return_code;
+}
+
+modem_return_code_t modem_record_send( uint8_t f_port, e_tx_mode_t msg_type )
+{
+    modem_return_code_t return_code = RC_OK;
+    smodem_task         record_task;
+
+    if( record_codec_get_record_count( ) == 0 )
+    {
+        return_code = RC_NOT_INIT;
+    }
+    else if( ( get_modem_muted( ) != MODEM_NOT_MUTE ) || ( get_modem_suspend( ) == MODEM_SUSPEND ) )
+    {
+        return_code = RC_FAIL;
+    }
+    else if( ( f_port == 0 ) || ( f_port >= 224 ) || ( f_port == get_modem_dm_port( ) ) ||
+             ( ( msg_type != TX_UNCONFIRMED ) && ( msg_type != TX_CONFIRMED ) ) )
+    {
+        return_code = RC_INVALID;
+    }
+    else
+    {
+        record_task.id                 = RECORD_TASK;
+        record_task.priority           = TASK_HIGH_PRIORITY;
+        record_task.fPort              = f_port;
+        record_task.PacketType         = msg_type;
+        record_task.time_to_execute_ms = bsp_rtc_get_time_ms64( );
+        if( modem_supervisor_add_task( &record_task ) != TASK_VALID )
+        {
+            return_code = RC_FAIL;
+        }
+    }
+    return return_code;
+}
+
+modem_return_code_t modem_ranging_start( ral_ranging_role_t role, const ral_params_lora_t* lora, uint32_t address,
+                                         uint16_t count )
+{
+    bool is_started;
+
+    if( ranging_is_running( ) == true )
+    {
+        return RC_BUSY;
+    }
+    if( role == RAL_RANGING_ROLE_MASTER )
+    {
+        is_started = ( count <= UINT8_MAX ) && ranging_start_master( lora, address, ( uint8_t ) count );
+    }
+    else
+    {
+        is_started = ranging_start_slave( lora, address, count );
+    }
+    return ( is_started == true ) ? RC_OK : RC_INVALID;
+}
+
+modem_return_code_t modem_ranging_stop( void )
+{
+    return ( ranging_stop( ) == true ) ? RC_OK : RC_FAIL;
+}
+
+modem_return_code_t modem_ranging_get_result( uint32_t address, ranging_result_t* result )
+{
+    return ( ranging_peer_result_get( address, result ) == true ) ? RC_OK : RC_INVALID;
+}
+
+modem_return_code_t modem_ble_beacon_start( const uint8_t* address, const uint8_t* adv_data, uint8_t adv_data_len,
+                                            uint16_t interval_ms, int8_t pwr_in_dbm )
+{
+    if( ble_beacon_is_running( ) == true )
+    {
+        return RC_BUSY;
+    }
+    return ( ble_beacon_start( address, adv_data, adv_data_len, interval_ms, pwr_in_dbm ) == true ) ? RC_OK
+                                                                                                     : RC_INVALID;
+}
+
+modem_return_code_t modem_ble_beacon_stop( void )
+{
+    return ( ble_beacon_stop( ) == true ) ? RC_OK : RC_FAIL;
+}
+
+modem_return_code_t modem_raw_radio_tx( const raw_radio_params_t* params, uint32_t delay_ms, const uint8_t* payload,
+                                        uint8_t length )
+{
+    if( raw_radio_is_busy( ) == true )
+    {
+        return RC_BUSY;
+    }
+    return ( raw_radio_tx( params, delay_ms, payload, length ) == true ) ? RC_OK : RC_INVALID;
+}
+
+modem_return_code_t modem_raw_radio_rx( const raw_radio_params_t* params, uint32_t delay_ms, uint32_t timeout_ms )
+{
+    if( raw_radio_is_busy( ) == true )
+    {
+        return RC_BUSY;
+    }
+    return ( raw_radio_rx( params, delay_ms, timeout_ms ) == true ) ? RC_OK : RC_INVALID;
+}
+
+modem_return_code_t modem_raw_radio_abort( void )
+{
+    return ( raw_radio_abort( ) == true ) ? RC_OK : RC_FAIL;
+}
+
+modem_return_code_t modem_get_radio_free_window( uint32_t min_duration_ms, uint32_t* delay_ms, uint32_t* free_ms )
+{
+    uint32_t start_ms;
+
+    *free_ms      = rp_get_next_free_window( &modem_radio_planner, min_duration_ms, &start_ms );
+    int32_t delay = ( int32_t )( start_ms - bsp_rtc_get_time_ms( ) );
+    *delay_ms     = ( delay > 0 ) ? ( uint32_t ) delay : 0;
+    return RC_OK;
+}
+
+modem_return_code_t modem_relay_start( const relay_params_t* params )
+{
+    if( relay_is_running( ) == true )
+    {
+        return RC_BUSY;
+    }
+    return ( relay_start( params ) == true ) ? RC_OK : RC_INVALID;
+}
+
+modem_return_code_t modem_relay_stop( void )
+{
+    return ( relay_stop( ) == true ) ? RC_OK : RC_FAIL;
+}
+
+modem_return_code_t modem_channel_scan_start( const channel_scan_params_t* params )
+{
+    if( channel_scan_is_running( ) == true )
+    {
+        return RC_BUSY;
+    }
+    return ( channel_scan_start( params ) == true ) ? RC_OK : RC_INVALID;
+}
+
+modem_return_code_t modem_channel_scan_stop( void )
+{
+    return ( channel_scan_stop( ) == true ) ? RC_OK : RC_FAIL;
 }
 
 radio_planner_t* modem_get_radio_planner( void )
@@ -808,9 +1619,101 @@ radio_planner_t* modem_get_radio_planner( void )
     return &modem_radio_planner;
 }
 
+#if defined( MODEM_DUAL_RADIO )
+radio_planner_t* modem_get_radio_planner_subghz( void )
+{
+    return &modem_radio_planner_subghz;
+}
+#endif  // MODEM_DUAL_RADIO
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static modem_return_code_t upload_check_start( uint8_t sid, uint16_t payload_length )
+{
+    modem_return_code_t return_code = RC_OK;
+
+    if( modem_get_upload_state( sid ) == MODEM_UPLOAD_START )
+    {
+        return_code = RC_BUSY;
+        BSP_DBG_TRACE_ERROR( "FileUpload in progress..\n" );
+    }
+    else if( modem_get_upload_state( sid ) == MODEM_UPLOAD_NOT_INIT )
+    {
+        return_code = RC_NOT_INIT;
+        BSP_DBG_TRACE_ERROR( "RC_NOT_INIT in FileUpload bad state\n" );
+    }
+    else if( payload_length != upload_size[sid] )
+    {
+        return_code = RC_BAD_SIZE;
+        BSP_DBG_TRACE_ERROR( "RC_BAD_SIZE in FileUpload upload_current_size = %u and upload_size %u \n",
+                             payload_length, upload_size[sid] );
+    }
+    return return_code;
+}
+
+static modem_return_code_t upload_schedule( uint8_t sid )
+{
+    modem_return_code_t return_code = RC_OK;
+    smodem_task         upload_task;
+
+    // start streaming of chunks, the task serves all the started sessions
+    upload_task.id                 = FILE_UPLOAD_TASK;
+    upload_task.priority           = TASK_HIGH_PRIORITY;
+    upload_task.time_to_execute_ms = bsp_rtc_get_time_ms64( ) + 2000;
+    if( modem_supervisor_add_task( &upload_task ) != TASK_VALID )
+    {
+        return_code = RC_FAIL;
+    }
+    else
+    {
+        modem_set_upload_state( sid, MODEM_UPLOAD_START );
+    }
+    return return_code;
+}
+
+static void modem_send_blocks_release( void )
+{
+    for( uint8_t i = 0; i < BSP_MODEM_SEND_QUEUE_SIZE; i++ )
+    {
+        if( ( modem_send_blocks[i] != NULL ) && ( modem_supervisor_is_data_queued( modem_send_blocks[i] ) == false ) )
+        {
+            modem_pool_free( modem_send_blocks[i] );
+            modem_send_blocks[i] = NULL;
+        }
+    }
+}
+
+static void upload_source_read( void* context, uint32_t offset, uint8_t* buffer, uint32_t length )
+{
+    static const uint8_t zero_block[16] = { 0 };
+    upload_source_t*     source         = ( upload_source_t* ) context;
+
+    source->read( source->context, offset, buffer, length );
+    if( source->is_encrypted == false )
+    {
+        return;
+    }
+    if( upload_source_key_sid != source->sid )
+    {
+        lora_crypto_key_set( &upload_source_key_ctx, source->key );
+        upload_source_key_sid = source->sid;
+    }
+    for( uint32_t i = 0; i < length; i++ )
+    {
+        int32_t block = ( int32_t )( ( offset + i ) >> 4 );
+        if( block != source->keystream_block )
+        {
+            // same counter block as the in place encryption of the whole file
+            lora_crypto_keyed_payload_encrypt_slice( &app_crypto_ctx, zero_block, 16, &upload_source_key_ctx,
+                                                     upload_size[source->sid], FILE_UPLOAD_DIRECTION,
+                                                     source->sequence_counter, 1 + block, source->keystream );
+            source->keystream_block = block;
+        }
+        buffer[i] ^= source->keystream[( offset + i ) & 0x0F];
+    }
+}
+
 /* --- EOF ------------------------------------------------------------------ */
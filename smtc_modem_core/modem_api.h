@@ -47,6 +47,11 @@ extern "C" {
 #include "modem_context.h"
 #include "lr1mac_defs.h"
 #include "file_upload.h"
+#include "ranging.h"
+#include "ble_beacon.h"
+#include "raw_radio.h"
+#include "relay.h"
+#include "channel_scan.h"
 
 /*
  * -----------------------------------------------------------------------------
@@ -109,6 +114,38 @@ typedef enum e_emergency_tx
     TX_EMERGENCY_ON  = 0x01   //!< Emergency Tx
 } e_emergency_tx_t;
 
+/*!
+ * \typedef modem_ram_usage_t
+ * \brief   Static RAM of the modem subsystems, stack and pool high-water marks, in bytes
+ */
+typedef struct modem_ram_usage_s
+{
+    uint32_t lorawan;         //!< LoRaWAN stack, region and keys
+    uint32_t radio_planner;   //!< radio planner and its tasks
+    uint32_t send_queue;      //!< application uplinks waiting to be sent
+    uint32_t crypto;          //!< application and file upload crypto contexts
+    uint32_t file_upload;     //!< file upload sessions
+    uint32_t stream;          //!< data stream fifo and fragment history
+    uint32_t stack_size;      //!< RAM left to the stack
+    uint32_t stack_used_max;  //!< stack high-water mark since the start
+    uint32_t pool;            //!< block pool shared by the send queue, stream history and test mode
+    uint32_t pool_used_max;   //!< pool high-water mark since the start
+} modem_ram_usage_t;
+
+/*!
+ * \typedef modem_energy_t
+ * \brief   Activity of the modem and its estimated charge since the last charge reset
+ */
+typedef struct modem_energy_s
+{
+    uint32_t mcu_run_ms;    //!< MCU running or waiting
+    uint32_t mcu_stop_ms;   //!< MCU in STOP mode
+    uint32_t wakeup_nb;     //!< MCU exits from STOP mode
+    uint32_t radio_tx_ms;   //!< radio transmitting
+    uint32_t radio_rx_ms;   //!< radio receiving
+    uint32_t charge_uah;    //!< MCU and radio charge from the BSP currents and the radio consumption model [uAh]
+} modem_energy_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -134,15 +171,15 @@ uint32_t modem_run_engine( void );
 
 /*!
  * \brief    Get the modem event
- * \remark   This command can be used to retrieve pending events from the modem.
- *           return error in the following cases :
- *              1) number of asynch message > number of type of asynch msg (should be impossible)
+ * \remark   This command can be used to retrieve pending events from the modem, the oldest first.
+ *           Each downlink has its own event, the host polls until asynchronous_msgnumber is 0.
  *
- * \param  [out]    type*                   - Return the event type
- * \param  [out]    count*                  - Return number of missed events of this type in case of overrun.
+ * \param  [out]    type*                   - Return the event type, RSP_NUMBER if no event is pending
+ * \param  [out]    count*                  - Return number of identical events merged in this one or of events lost
+ *                                            before it because the event queue was full
  * \param  [out]    event_data*             - Return event specific data
  * \param  [out]    event_data_length*      - Return event specific data length
- * \param  [out]    asynchronous_msgnumber* - Return number of pending event(s)
+ * \param  [out]    asynchronous_msgnumber* - Return number of pending event(s), including the returned one
  *
  * \retval  modem_return_code_t
  */
@@ -150,6 +187,34 @@ uint32_t modem_run_engine( void );
 modem_return_code_t modem_get_event( modem_rsp_event_t* type, uint8_t* count, uint8_t* event_data,
                                      uint8_t* event_data_length, uint8_t* asynchronous_msgnumber );
 
+/*!
+ * \brief    Set the handler of an event type
+ * \remark   The handler is called by modem_run_engine with the decoded payload of each event of its type, the
+ *           events of a type with a handler are not merged. The events are handled in order: an event without
+ *           handler is left for modem_get_event and the modem_init callback, or dropped when there is no callback.
+ *
+ * \param  [in]     type                    - Event type
+ * \param  [in]     handler                 - Handler of the event type, NULL to read them with modem_get_event
+ *
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_event_handler( modem_rsp_event_t type, modem_event_handler_t handler );
+
+/*!
+ * \brief    Get as many pending modem events as fit in a buffer
+ * \remark   The buffer starts with the number of events left pending, followed by the events, the oldest first,
+ *           each one packed as type, count, event data length and event data (see modem_get_event).
+ *
+ * \param  [out]    buffer*                 - Return the packed events
+ * \param  [in]     max_length              - Size of the buffer in byte(s)
+ * \param  [out]    length*                 - Return the length of the packed events
+ * \param  [out]    asynchronous_msgnumber* - Return number of event(s) left pending
+ *
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_get_events( uint8_t* buffer, uint8_t max_length, uint8_t* length,
+                                      uint8_t* asynchronous_msgnumber );
+
 /*!
  * \brief   Get the modem versions
  * \remark  This command returns the version of the bootloader and the version of the installed firmware
@@ -191,6 +256,57 @@ modem_return_code_t modem_factory_reset( void );
  */
 modem_return_code_t modem_get_charge( uint32_t* charge );
 
+/*!
+ * \brief   Get the radio planner statistics
+ * \remark  For each hook: tx time [ms], rx time [ms] (32-bit), aborted and postponed tasks (16-bit, saturated),
+ *          then the planner error count (16-bit), all big endian. The statistics are reset on read.
+ *
+ * \param  [out]    buffer*                 - Binary snapshot
+ * \param  [out]    length*                 - Snapshot length
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_get_rp_stats( uint8_t* buffer, uint8_t* length );
+
+/*!
+ * \brief   Get the static RAM of the modem subsystems and the stack use
+ * \remark  The sizes are fixed at build time, only the stack and pool high-water marks move. The stack is scanned
+ *          from its bottom: avoid calling it from time critical code.
+ *
+ * \param  [out]    usage*                  - RAM per subsystem
+ * \retval  void
+ */
+void modem_get_ram_usage( modem_ram_usage_t* usage );
+
+/*!
+ * \brief   Get the RAM usage report
+ * \remark  The modem_ram_usage_t fields in order, each one on 16 bits saturated, big endian
+ *
+ * \param  [out]    buffer*                 - Binary report
+ * \param  [out]    length*                 - Report length
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_get_ram_usage_report( uint8_t* buffer, uint8_t* length );
+
+/*!
+ * \brief   Get the modem activity and charge since the last charge reset
+ * \remark  Reset the charge, run a transaction and read it to get the cost of the transaction. The charge is not
+ *          rounded to the mAh as the one of modem_get_charge, and excludes the charge restored from the NVM.
+ *
+ * \param  [out]    energy*                 - Activity and charge
+ * \retval          void
+ */
+void modem_get_energy( modem_energy_t* energy );
+
+/*!
+ * \brief   Get the modem activity and charge report
+ * \remark  The modem_energy_t fields in order, each one on 32 bits, big endian
+ *
+ * \param  [out]    buffer*                 - Binary report
+ * \param  [out]    length*                 - Report length
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_get_energy_report( uint8_t* buffer, uint8_t* length );
+
 /*!
  * \brief   Reset the modem charge
  * \remark  This command resets the accumulated charge counter to zero.
@@ -225,9 +341,19 @@ modem_return_code_t modem_set_tx_power_offset( int8_t tx_pwr_offset );
  *          In case of time wrapping, the time could be really equal to zero so the value is incremented of 1 to avoid 0
  *
  * \param  [out]    gps_time_s*             - Return GPS time in seconds
+ * \param  [out]    gps_fraction_ms*        - Return the milliseconds of the GPS time
  * \retval  modem_return_code_t
  */
-modem_return_code_t modem_get_time( uint32_t* gps_time_s );
+modem_return_code_t modem_get_time( uint32_t* gps_time_s, uint16_t* gps_fraction_ms );
+
+/*!
+ * \brief   Synchronize the GPS wall time on the network time
+ * \remark  A LoRaWAN DeviceTimeReq is sent with the next uplinks until it is answered. The modem then renews the
+ *          synchronization once a day, the drift of the local clock is compensated between them.
+ *
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_request_time_sync( void );
 
 /*!
  * \brief   Get the modem status
@@ -311,6 +437,56 @@ modem_return_code_t modem_get_class( modem_class_t* class );
  */
 modem_return_code_t modem_set_class( modem_class_t class );
 
+/*!
+ * \brief   Set the class B ping slot periodicity
+ * \remark  A ping slot every 2^periodicity seconds, the network learns it from the next uplink.
+ *
+ * \param  [in]     periodicity             - from 0 to 7
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_class_b_periodicity( uint8_t periodicity );
+
+/*!
+ * \brief   Get the class B state
+ * \remark  The ping slots are only opened while the beacon is tracked.
+ *
+ * \param  [out]    state                   - off, searching the beacon or tracking it
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_get_class_b_state( lr1mac_class_b_state_t* state );
+
+/*!
+ * \brief   Set or clear a multicast group
+ * \remark  The group downlinks are received while the device is in class C, they are read as the unicast ones.
+ *          Setting a group again restarts its downlink counter.
+ *
+ * \param  [in]     group_id                - Group index, from 0 to 3
+ * \param  [in]     mc_addr                 - Group address
+ * \param  [in]     mc_nwk_skey             - 16 bytes McNwkSKey, NULL to clear the group
+ * \param  [in]     mc_app_skey             - 16 bytes McAppSKey, NULL to clear the group
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_multicast( uint8_t group_id, uint32_t mc_addr, const uint8_t* mc_nwk_skey,
+                                         const uint8_t* mc_app_skey );
+
+/*!
+ * \brief   Handle a block of a firmware update sent by the host
+ * \remark  The image is written in the staging area, block by block in order. The control block starts the update
+ *          with the image size, then ends it with the image SHA-256 checked over the staging area. Without staging
+ *          area (built without FW_STAGING=1) the control block starting the update is refused.
+ *
+ * \param  [in]     index                   - Block index, FW_UPDATE_BLOCK_CONTROL for a control block
+ * \param  [in]     data*                   - Block data
+ * \param  [in]     size                    - Block size
+ * \param  [in]     block_crc               - CRC-32 of the block data
+ * \param  [out]    next_block*             - Return the index of the next block expected
+ * \retval  modem_return_code_t             - RC_BAD_CRC to send the block again, RC_NOT_INIT without update,
+ *                                            RC_INVALID if the block is not the expected one, RC_FAIL if the
+ *                                            flash programming failed, RC_BAD_SIG if the image hash is wrong
+ */
+modem_return_code_t modem_fw_update_block( uint16_t index, const uint8_t* data, uint8_t size, uint32_t block_crc,
+                                           uint16_t* next_block );
+
 /*!
  * \brief   Get the region
  * \remark  This command returns the regulatory region.
@@ -322,7 +498,8 @@ modem_return_code_t modem_get_region( uint8_t* region );
 
 /*!
  * \brief   Set the region
- * \remark  This command sets the regulatory region
+ * \remark  This command sets the regulatory region. A joined device keeps its session: the session keys and counters
+ *          are kept, the channel plan of a region left earlier is restored as the network set it.
  *
  * \param  [in]     region                  - region
  * \retval  modem_return_code_t
@@ -376,6 +553,24 @@ modem_return_code_t modem_get_dm_port( uint8_t* dm_port );
  */
 modem_return_code_t modem_set_dm_port( uint8_t dm_port );
 
+/*!
+ * \brief   Get host baud rate
+ * \remark  This command gets the saved index of the host link baud rate.
+ *
+ * \param  [out]    baudrate_index*         - Return the host baud rate index
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_get_host_baudrate( uint8_t* baudrate_index );
+
+/*!
+ * \brief   Set host baud rate
+ * \remark  This command saves the index of the host link baud rate, restored at next start.
+ *
+ * \param  [in]     baudrate_index          - Host baud rate index
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_host_baudrate( uint8_t baudrate_index );
+
 /*!
  * \brief   Get DM info interval
  * \remark  This command returns the device management reporting interval.
@@ -467,6 +662,8 @@ modem_return_code_t modem_leave_network( void );
  * \brief   Suspend the modem communication
  * \remark  This command temporarily suspends or resumes the modem’s radio operations.
  *          Operations are suspended with parameter value 0x01 and resumed with parameter value 0x00.
+ *          The radio is powered down once the LoRaWAN exchange in progress is over, with no timer left running. On
+ *          resume the pending tasks are delayed by the suspend duration.
  *
  * \param  [in]     suspend
  * \retval  modem_return_code_t
@@ -517,38 +714,494 @@ modem_return_code_t modem_request_tx( uint8_t f_port, e_tx_mode_t msg_type, uint
 modem_return_code_t modem_emergency_tx( uint8_t f_port, e_tx_mode_t msg_type, uint8_t* payload,
                                         uint8_t payload_length );
 
+/*!
+ * \brief   Enable the coalescing of the application uplinks
+ * \remark  When enabled, the uplinks queued by modem_request_tx on a same port, with a same type, are concatenated
+ *          in a single frame as long as it fits in the next max payload. The application server has to split the
+ *          frame: the records must be self delimited. A RSP_TXDONE event is still raised for each uplink.
+ *
+ * \param  [in]     enable                  - true to enable the coalescing, disabled by default
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_tx_coalescing( bool enable );
+
+/*!
+ * \brief   Set the QoS class of the application uplinks of a port
+ * \remark  The priority places the uplinks of the port against each other and against the DM reports, the file
+ *          upload and the stream, the emergency uplinks keep the highest one. An uplink queued longer than
+ *          max_delay_s is dropped with a MODEM_TX_DROPPED RSP_TXDONE event if is_dropped_when_stale, else it takes
+ *          TASK_HIGH_PRIORITY. Uplinks of a class not coalesced are sent alone even when the coalescing is enabled.
+ *          The classes are kept in RAM, up to MODEM_QOS_PORT_NB ports, the other ports have the default class.
+ *
+ * \param  [in]     f_port                  - application port
+ * \param  [in]     qos*                    - QoS class, NULL to give the port the default class back
+ * \retval  modem_return_code_t             - RC_INVALID for a forbidden port or class, RC_BUSY if
+ *                                            MODEM_QOS_PORT_NB ports already have their own class
+ */
+modem_return_code_t modem_set_port_qos( uint8_t f_port, const modem_qos_t* qos );
+
+/*!
+ * \brief   Enable the store-and-forward of the application uplinks
+ * \remark  When enabled, the uplinks which can't be sent, and the confirmed uplinks which are not acknowledged, are
+ *          kept in a ring in NVM with their port, and the following uplinks queue behind them: their RSP_TXDONE event
+ *          reports MODEM_TX_STORED. The modem probes the network with a confirmed uplink carrying the oldest records,
+ *          after 1 min then doubling up to 1 h, and sends the records in order at the fastest data rate once
+ *          acknowledged. The unconfirmed uplinks sent without error are not kept: the application uses confirmed
+ *          uplinks to detect the outages. The emergency uplinks are never kept. The oldest records are dropped when
+ *          the ring is full. The ring survives a reset, the application server has to tolerate duplicates.
+ *
+ * \param  [in]     enable                  - true to enable the store-and-forward, disabled by default
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_store_and_forward( bool enable );
+
+/*!
+ * \brief   Get the number of application uplinks kept in the outbox
+ *
+ * \param  [out]    count*                  - Number of uplinks waiting for the network
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_get_outbox_count( uint16_t* count );
+
+/*!
+ * \brief   Enable the piggybacking of the application uplinks on the periodic DM reports
+ * \remark  When enabled, an application uplink sent while the periodic DM report is due within a quarter of the
+ *          reporting interval is carried by the DM report, as a last e_inf_appdata field holding its port and
+ *          payload, and the frame goes on the DM port: one uplink instead of two. The DM server has to forward the
+ *          payload to the application. The RSP_TXDONE event is raised as for any uplink.
+ *
+ * \param  [in]     enable                  - true to enable the piggybacking, disabled by default
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_dm_piggyback( bool enable );
+
+/*!
+ * \brief   Spread the periodic tasks of the modem around their nominal date
+ * \remark  The periodic DM reports, the downlink retrievals, the clock sync requests and the mute checks are delayed
+ *          or advanced by up to half the jitter, drawn from a sequence seeded with the DevEUI: a fleet reset at once
+ *          (e.g. after a power cut) does not keep sending in lockstep. The mean period is kept.
+ *
+ * \param  [in]     percent                 - jitter in percent of the task period, 0 (default) to 100
+ * \retval  modem_return_code_t             - RC_INVALID if the jitter is above 100 percent
+ */
+modem_return_code_t modem_set_task_jitter( uint8_t percent );
+
+/*!
+ * \brief   Set the airtime budget of the modem
+ * \remark  The budget accrues continuously, up to one hour of budget, and the measured airtime of every uplink is
+ *          charged to it. The application and DM uplinks are never held by the budget. The file upload and stream
+ *          uplinks are sent as fast as the budget allows while leaving a quarter of the hourly budget to the
+ *          others: the average delay of the file upload sessions is then not used. The regional duty cycle still
+ *          applies on top.
+ *
+ * \param  [in]     budget_ms_per_hour      - airtime allowed per hour in ms, 0 (default) to disable the pacing
+ * \retval  modem_return_code_t             - RC_INVALID if the budget is above MODEM_AIRTIME_BUDGET_MAX_MS
+ */
+modem_return_code_t modem_set_airtime_budget( uint32_t budget_ms_per_hour );
+
+/*!
+ * \brief   Get the airtime of the uplinks since the start
+ * \remark  Each transmission is charged to the task it is part of: the retransmissions and the mac answers
+ *          included. The join requests, downlink retrievals and clock syncs are charged to MODEM_AIRTIME_DM.
+ *
+ * \param  [out]    airtime_ms*             - MODEM_AIRTIME_CLASS_NB airtimes in ms, indexed by modem_airtime_class_t
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_get_airtime( uint32_t* airtime_ms );
+
+/*!
+ * \brief   Enable the interference aware selection of the uplink channels
+ * \remark  When enabled, the channels are drawn at random with a weight given by the success of the confirmed
+ *          uplinks and join requests sent on them and by the positive CADs: the channels hit by Wi-Fi in the 2.4GHz
+ *          band are avoided. Only supported by the WW2G4 region.
+ *
+ * \param  [in]     enable                  - true to enable the weighted selection, disabled by default
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_weighted_channel_selection( bool enable );
+
+/*!
+ * \brief   Enable the listen before talk
+ * \remark  When enabled, a CAD is done on the channel of each LoRa uplink just before it is sent. When the channel is
+ *          busy, the uplink moves to another channel after a random backoff. After 3 busy CADs it is sent anyway.
+ *          The positive CADs feed the weighted channel selection.
+ *
+ * \param  [in]     enable                  - true to enable the listen before talk, disabled by default
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_lbt( bool enable );
+
+/*!
+ * \brief   Enable the link monitor
+ * \remark  When enabled, a LinkCheckReq is piggybacked on the application uplinks, on each uplink at first and up to
+ *          every 32 uplinks while the margin is good. A low margin or an unanswered request lowers the datarate, 3
+ *          unanswered requests in a row mark the link lost: the uplinks are then kept in the outbox when the store and
+ *          forward is enabled. An OTAA device rejoins after 8 unanswered requests. Each change of the link state is
+ *          notified with the RSP_LINKSTATUS event.
+ *
+ * \param  [in]     enable                  - true to enable the link monitor, disabled by default
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_link_monitor( bool enable );
+
+/*!
+ * \brief   Enable the CAD gated RX windows
+ * \remark  When enabled, a LoRa RX window starts with a CAD, the reception only follows when the CAD detects a
+ *          preamble: an empty window costs a CAD instead of the reception of its symbols. Only the windows narrow
+ *          enough for the CAD to fall in the downlink preamble are gated, in practice at the slowest data rates once
+ *          the downlinks timing is learned. The other windows are opened as usual.
+ *
+ * \param  [in]     enable                  - true to enable the CAD gate, disabled by default
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_rx_cad_gate( bool enable );
+
+/*!
+ * \brief   Enable the uplink power control
+ * \remark  When enabled, the path loss is measured on the downlinks against the gateway EIRP, and the uplinks are
+ *          sent with the lowest power reaching the gateway 10 dB above its sensitivity. The power is never raised
+ *          above the one set by the network ADR, and the control is suspended after ADR_ACK_LIMIT uplinks without
+ *          downlink.
+ *
+ * \param  [in]     enable                  - true to enable the power control, disabled by default
+ * \param  [in]     gw_eirp_dbm             - EIRP of the gateway downlinks
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_tx_power_ctrl( bool enable, int8_t gw_eirp_dbm );
+
+/*!
+ * \brief   Send the uplinks in time slots
+ * \remark  Once the network time is known, the uplinks start in the slot of the device: its DevAddr modulo the
+ *          number of slots of the frame period. The periodic DM reports are slotted too, the emergency uplinks are
+ *          not. The network time is requested with the next uplink if it is not known. Also set by the network
+ *          with the DM info field e_inf_txslot.
+ *
+ * \param  [in]     period_s                - frame period in seconds, 0 to disable the slots
+ * \param  [in]     slot_ms                 - slot length in milliseconds, it must hold the longest uplink
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_tx_slot( uint16_t period_s, uint16_t slot_ms );
+
+/*!
+ * \brief   Set the number of uplinks between two frame counter saves in nvm
+ * \remark  The frame counter is not stored at each uplink: after a reset or a brownout the modem resumes at the last
+ *          stored value plus this period, so that the network server never sees a counter twice
+ *
+ * \param  [in]     period                  - uplinks between two saves, 32 by default
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_fcnt_save_period( uint16_t period );
+
+/*!
+ * \brief   Set the DM delta reporting
+ * \remark  In delta mode, a periodic DM report only carries the fields that moved beyond their threshold since they
+ *          were last sent. One report every keyframe_period is a full one, and a report with no field is not sent.
+ *
+ * \param  [in]     keyframe_period         - Reports between two full reports, 0 disables the delta mode (default)
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_dm_delta( uint8_t keyframe_period );
+
+/*!
+ * \brief   Set the DM delta reporting threshold of a numeric field
+ *
+ * \param  [in]     tag                     - DM info code of a numeric field (charge, voltage, temp, signal, uptime...)
+ * \param  [in]     threshold               - Change in the unit of the field from which it is sent, 0 for any change
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_dm_delta_threshold( e_dm_info_t tag, uint16_t threshold );
+
+/*!
+ * \brief   Hold the saves of the modem and LoRaWAN contexts in nvm
+ * \remark  Used to apply several settings in a row: the contexts changed while held are written once, when the hold
+ *          is removed
+ *
+ * \param  [in]     hold                    - true to hold the saves, false to write the held ones
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_set_context_store_hold( bool hold );
+
 /*!
  * \brief   Create the upload_init
- * \remark  This command prepares a fragmented file upload.
+ * \remark  This command prepares a fragmented file upload. Up to FILE_UPLOAD_MAX_SESSIONS sessions can be
+ *          uploaded at the same time, their uplinks are interleaved by priority: session 0 is the most urgent.
+ *          A size of 0 cancels the session.
  *
+ * \param  [in]     sid                     - file upload session id, also its priority
  * \param  [in]     f_port                  - Frame port
  * \param  [in]     encryption_mode         - 0x00: no encrypted,
  *                                            0x01: encrypted using a 128-bit AES key derived from the AppSKey
+ *                                            | 0x02: compressed with LZSS before being encrypted, see
+ *                                            lz_compress_in_place. The bit is cleared from the header when the
+ *                                            file doesn't shrink
  * \param  [in]     size
  * \param  [in]     average_delay
  * \retval  modem_return_code_t
  */
-modem_return_code_t modem_upload_init( uint8_t f_port, file_upload_encrypt_mode_t encryption_mode, uint16_t size,
-                                       uint16_t average_delay );
+modem_return_code_t modem_upload_init( uint8_t sid, uint8_t f_port, file_upload_encrypt_mode_t encryption_mode,
+                                       uint16_t size, uint16_t average_delay );
+
+/*!
+ * \brief   Hash a file chunk as soon as it is received
+ * \remark  Chunks must be given in order between modem_upload_init and modem_upload_start, then the hash of
+ *          the file is already known at start. If some chunks were not hashed, modem_upload_start hashes the
+ *          whole file itself.
+ *
+ * \param  [in]     sid                     - file upload session id
+ * \param  [in]     payload*                - data fragment
+ * \param  [in]     payload_length          - data fragment size
+ * \retval  None
+ */
+void modem_upload_hash_data( uint8_t sid, const uint8_t* payload, uint16_t payload_length );
 
 /*!
  * \brief   Create the upload_start
  * \remark  After all data bytes indicated to UploadInit have been provided
- *          this command can be issued to actually start the transmission stream
+ *          this command can be issued to actually start the transmission stream.
+ *          An upload interrupted by a reset is resumed when the same file is given again to the same session, with
+ *          the same port and encryption, before another file is started on it.
+ *          A file to be compressed is compressed in place in payload.
  *
+ * \param  [in]     sid                     - file upload session id
  * \param  [in]     payload*                - data fragment
  * \param  [in]     payload_length          - data fragment size
  * \retval  modem_return_code_t
  */
-modem_return_code_t modem_upload_start( uint8_t* payload, uint16_t payload_length );
+modem_return_code_t modem_upload_start( uint8_t sid, uint8_t* payload, uint16_t payload_length );
 
 /*!
- * \brief  return the average delay set during the last file init
+ * \brief   Start the upload of a file read through an application reader
+ * \remark  Same as modem_upload_start, but the file is never copied nor encrypted in place: the chunks are read
+ *          on demand while generating each uplink, and encrypted on the fly when requested. The file can then
+ *          stay in flash or in an external memory, and must not change until the upload is done. The file is
+ *          not compressed.
+ *
+ * \param  [in]     sid                     - file upload session id
+ * \param  [in]     read                    - file reader
+ * \param  [in]     context*                - file reader context
+ * \param  [in]     payload_length          - file size
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_upload_start_from_reader( uint8_t sid, file_upload_read_t read, void* context,
+                                                    uint16_t payload_length );
+
+/*!
+ * \brief  return the average delay set during the last file init of a session
  * \remark
  *
+ * \param  [in]     sid                     - file upload session id
  * \retval  uint16_t
  */
-uint16_t modem_upload_avgdelay_get( void );
+uint16_t modem_upload_avgdelay_get( uint8_t sid );
+
+/*!
+ * \brief   Initialize the data stream
+ * \remark  This command prepares the transmission of a continuous stream of records.
+ *          The stream is sent on the DM port when f_port is 0.
+ *
+ * \param  [in]     f_port                  - Frame port
+ * \param  [in]     encryption              - records encrypted using the AppSKey before being streamed
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_stream_init( uint8_t f_port, bool encryption );
+
+/*!
+ * \brief   Add a record to the data stream
+ * \remark  The modem schedules the uplinks by itself until the stream buffer is depleted, then the RSP_STREAMDONE
+ *          event is raised. RC_BUSY is returned when the stream buffer cannot hold the record.
+ *
+ * \param  [in]     f_port                  - Frame port, same as the one given to modem_stream_init
+ * \param  [in]     data*                   - record data
+ * \param  [in]     len                     - record length
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_stream_add_data( uint8_t f_port, const uint8_t* data, uint8_t len );
+
+/*!
+ * \brief   Get the data stream buffer status
+ * \remark
+ *
+ * \param  [in]     f_port                  - Frame port, same as the one given to modem_stream_init
+ * \param  [out]    pending*                - number of bytes waiting to be sent
+ * \param  [out]    free_space*             - number of free bytes in the stream buffer
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_stream_status( uint8_t f_port, uint16_t* pending, uint16_t* free_space );
+
+/*!
+ * \brief   Set the schema of the sensor records
+ * \remark  Each record is a time series sample of nb_fields signed 32-bit values. The records are coded as the
+ *          zig-zag varint of their difference with the previous record of the frame, the first record of a frame
+ *          carries the values. The fields set in absolute_mask are always coded as their value. The queued
+ *          records are flushed.
+ *
+ * \param  [in]     nb_fields               - Number of fields of a record, 1 to 8
+ * \param  [in]     absolute_mask           - bit n set: field n coded as its value, 0 to code all the deltas
+ * \retval  modem_return_code_t             - RC_INVALID if the number of fields is invalid, RC_BUSY while records
+ *                                            are queued
+ */
+modem_return_code_t modem_record_init( uint8_t nb_fields, uint8_t absolute_mask );
+
+/*!
+ * \brief   Queue a sensor record
+ * \remark  Up to 16 records are queued until modem_record_send
+ *
+ * \param  [in]     values*                 - the nb_fields values of the record
+ * \retval  modem_return_code_t             - RC_NOT_INIT without schema, RC_BUSY if the queue is full
+ */
+modem_return_code_t modem_record_add( const int32_t* values );
+
+/*!
+ * \brief   Send the queued sensor records
+ * \remark  The records are encoded when the uplink is sent, as many as fit in its max payload. The frames follow
+ *          until the queue is empty, a RSP_TXDONE event is raised for each frame. Frame format: number of records
+ *          (1 byte) then the fields in order, each one a zig-zag varint: 7 bits per byte, least significant
+ *          group first, bit 7 set when a byte follows.
+ *
+ * \param  [in]     f_port                  - Frame port
+ * \param  [in]     msg_type                - Confirmed / Unconfirmed
+ * \retval  modem_return_code_t             - RC_NOT_INIT if no record is queued
+ */
+modem_return_code_t modem_record_send( uint8_t f_port, e_tx_mode_t msg_type );
+
+/*!
+ * \brief   Start a ranging batch as master, or answer the ranging requests as slave
+ * \remark  The exchanges are scheduled by the radio planner below the LoRaWAN tasks. The RSP_RANGINGDONE event
+ *          is raised with a ranging_status_t once the master batch is filtered or the slave listening ends.
+ *          Supported by the SX1280 only.
+ *
+ * \param  [in]     role                    - RAL_RANGING_ROLE_MASTER or RAL_RANGING_ROLE_SLAVE
+ * \param  [in]     lora*                   - LoRa modulation: frequency, SF5 to SF10, 400 to 1600 kHz, output power
+ * \param  [in]     address                 - master: slave address, slave: own address
+ * \param  [in]     count                   - master: exchanges of the batch, slave: listening time in seconds,
+ *                                            0 until modem_ranging_stop
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_ranging_start( ral_ranging_role_t role, const ral_params_lora_t* lora, uint32_t address,
+                                         uint16_t count );
+
+/*!
+ * \brief   Stop the ranging batch or the ranging listening
+ * \remark  The RSP_RANGINGDONE event is raised with RANGING_STATUS_STOPPED
+ *
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_ranging_stop( void );
+
+/*!
+ * \brief   Get the filtered ranging result of a peer
+ *
+ * \param  [in]     address                 - peer address
+ * \param  [out]    result*                 - distances of the last batch and running average
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_ranging_get_result( uint32_t address, ranging_result_t* result );
+
+/*!
+ * \brief   Start advertising as a non-connectable BLE beacon
+ * \remark  The advertisements are sent on the channels 37, 38 and 39 in the gaps left by the LoRa tasks, so that
+ *          the phones can locate the device. Supported by the SX1280 only.
+ *
+ * \param  [in]     address*                - static random device address (6 bytes), most significant byte first
+ * \param  [in]     adv_data*               - advertising data
+ * \param  [in]     adv_data_len            - advertising data length, up to BLE_BEACON_ADV_DATA_MAX
+ * \param  [in]     interval_ms             - advertising interval, BLE_BEACON_INTERVAL_MIN_MS to
+ *                                            BLE_BEACON_INTERVAL_MAX_MS
+ * \param  [in]     pwr_in_dbm              - output power
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_ble_beacon_start( const uint8_t* address, const uint8_t* adv_data, uint8_t adv_data_len,
+                                            uint16_t interval_ms, int8_t pwr_in_dbm );
+
+/*!
+ * \brief   Stop the BLE beacon
+ *
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_ble_beacon_stop( void );
+
+/*!
+ * \brief   Send a raw LoRa, GFSK or FLRC frame, outside of LoRaWAN
+ * \remark  The task has the lowest radio planner priority: it runs in the gaps between the LoRaWAN windows and is
+ *          moved to the next gap when one of them collides. The RSP_RAWRADIODONE event is raised with a
+ *          raw_radio_status_t once it ends. One raw task at a time.
+ *
+ * \param  [in]     params*                 - modulation, the framing is the raw_radio one
+ * \param  [in]     delay_ms                - delay before the transmission, 0 as soon as possible
+ * \param  [in]     payload*                - frame
+ * \param  [in]     length                  - frame length, 1 to RAW_RADIO_PAYLOAD_MAX
+ * \retval  modem_return_code_t             - RC_BUSY if a raw task runs or its event is not raised yet
+ */
+modem_return_code_t modem_raw_radio_tx( const raw_radio_params_t* params, uint32_t delay_ms, const uint8_t* payload,
+                                        uint8_t length );
+
+/*!
+ * \brief   Listen for a raw LoRa, GFSK or FLRC frame, outside of LoRaWAN
+ * \remark  Scheduled as modem_raw_radio_tx. The RSP_RAWRADIODONE event carries the frame received, with its RSSI
+ *          and SNR.
+ *
+ * \param  [in]     params*                 - modulation, the framing is the raw_radio one
+ * \param  [in]     delay_ms                - delay before the reception, 0 as soon as possible
+ * \param  [in]     timeout_ms              - listening time
+ * \retval  modem_return_code_t             - RC_BUSY if a raw task runs or its event is not raised yet
+ */
+modem_return_code_t modem_raw_radio_rx( const raw_radio_params_t* params, uint32_t delay_ms, uint32_t timeout_ms );
+
+/*!
+ * \brief   Abort the raw task
+ * \remark  The RSP_RAWRADIODONE event is raised with RAW_RADIO_STATUS_ABORTED
+ *
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_raw_radio_abort( void );
+
+/*!
+ * \brief   Next window where the radio is free, from the tasks scheduled in the radio planner
+ * \remark  The window is an estimate: a LoRaWAN task enqueued later may take it. A raw task started in it with
+ *          delay_ms runs on time unless one does.
+ *
+ * \param  [in]     min_duration_ms         - radio time needed
+ * \param  [out]    delay_ms*               - delay from now to the start of the window
+ * \param  [out]    free_ms*                - length of the window, UINT32_MAX when no task follows it
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_get_radio_free_window( uint32_t min_duration_ms, uint32_t* delay_ms, uint32_t* free_ms );
+
+/*!
+ * \brief   Start relaying the end-devices out of reach of a gateway
+ * \remark  The relay channel is sniffed in the gaps left by the LoRaWAN tasks. The data uplinks received are
+ *          forwarded unconfirmed on RELAY_PORT, after their SNR and RSSI. The downlinks received on RELAY_PORT are
+ *          sent to their end-device RELAY_DOWNLINK_DELAY_MS after its next uplink.
+ *
+ * \param  [in]     params*                 - relay channel and sniff period
+ * \retval  modem_return_code_t             - RC_BUSY if the relay runs
+ */
+modem_return_code_t modem_relay_start( const relay_params_t* params );
+
+/*!
+ * \brief   Stop the relay, the frames not forwarded yet are dropped
+ *
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_relay_stop( void );
+
+/*!
+ * \brief   Start the periodic RSSI scans of the enabled channels, rating their occupancy
+ * \remark  The scans run in the gaps left by all the other radio tasks. The occupancy weighs the weighted channel
+ *          selection, see lorawan_api_weighted_channel_selection_enable_set. Only the WW2G4 region has one.
+ *
+ * \param  [in]     params*                 - scan period, samples per channel and busy threshold
+ * \retval  modem_return_code_t             - RC_BUSY if the scans run, RC_INVALID for invalid parameters or a
+ *                                            region without channel occupancy
+ */
+modem_return_code_t modem_channel_scan_start( const channel_scan_params_t* params );
+
+/*!
+ * \brief   Stop the periodic channel scans, the channel occupancy is kept
+ *
+ * \retval  modem_return_code_t
+ */
+modem_return_code_t modem_channel_scan_stop( void );
 
 /*!
  * \brief  return the pointer on radio_planner
@@ -558,6 +1211,17 @@ uint16_t modem_upload_avgdelay_get( void );
  */
 radio_planner_t* modem_get_radio_planner( void );
 
+#if defined( MODEM_DUAL_RADIO )
+/*!
+ * \brief  return the pointer on the radio_planner of the sub-GHz radio
+ * \remark The sub-GHz SX126x has its own planner, its tasks are scheduled apart from the 2.4 GHz ones. The
+ *         LoRaWAN stack and the modem services stay on \ref modem_get_radio_planner.
+ *
+ * \retval  radio_planner_t *
+ */
+radio_planner_t* modem_get_radio_planner_subghz( void );
+#endif  // MODEM_DUAL_RADIO
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,233 @@
+/*!
+ * \file      modem_rtos.c
+ *
+ * \brief     Modem RTOS integration implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stddef.h>   // NULL
+
+#include "modem_rtos.h"
+#include "modem_rtos_port.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef struct modem_rtos_request_tx_args_s
+{
+    uint8_t             f_port;
+    e_tx_mode_t         msg_type;
+    uint8_t*            payload;
+    uint8_t             payload_length;
+    modem_return_code_t return_code;
+} modem_rtos_request_tx_args_t;
+
+typedef struct modem_rtos_get_event_args_s
+{
+    modem_rsp_event_t*  type;
+    uint8_t*            count;
+    uint8_t*            event_data;
+    uint8_t*            event_data_length;
+    uint8_t*            asynchronous_msgnumber;
+    modem_return_code_t return_code;
+} modem_rtos_get_event_args_t;
+
+typedef struct modem_rtos_u32_args_s
+{
+    uint32_t            value;
+    modem_return_code_t return_code;
+} modem_rtos_u32_args_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+// call of the application thread holding the lock, NULL once executed
+static modem_rtos_function_t volatile modem_rtos_mailbox_function = NULL;
+static void* volatile modem_rtos_mailbox_context                  = NULL;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Executes the call posted by an application thread, if any, and releases the thread
+ */
+static void modem_rtos_mailbox_run( void );
+
+static void modem_rtos_request_tx_call( void* context );
+static void modem_rtos_get_event_call( void* context );
+static void modem_rtos_join_call( void* context );
+static void modem_rtos_set_alarm_timer_s_call( void* context );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void modem_rtos_thread( void ( *callback )( void ) )
+{
+    modem_init( callback );
+
+    while( 1 )
+    {
+        modem_rtos_mailbox_run( );
+
+        // the engine goes through the work requested by the call, the wait is cut short by the next call or event
+        modem_rtos_port_wait( modem_run_engine( ) );
+    }
+}
+
+void modem_rtos_wakeup( void )
+{
+    modem_rtos_port_notify( );
+}
+
+void modem_rtos_call( modem_rtos_function_t function, void* context )
+{
+    if( modem_rtos_port_is_modem_thread( ) == true )
+    {
+        function( context );
+        return;
+    }
+
+    modem_rtos_port_lock( );
+    modem_rtos_mailbox_context  = context;
+    modem_rtos_mailbox_function = function;
+    modem_rtos_port_notify( );
+    modem_rtos_port_call_wait( );
+    modem_rtos_port_unlock( );
+}
+
+modem_return_code_t modem_rtos_request_tx( uint8_t f_port, e_tx_mode_t msg_type, uint8_t* payload,
+                                           uint8_t payload_length )
+{
+    modem_rtos_request_tx_args_t args = {
+        .f_port = f_port, .msg_type = msg_type, .payload = payload, .payload_length = payload_length
+    };
+
+    modem_rtos_call( modem_rtos_request_tx_call, &args );
+    return args.return_code;
+}
+
+modem_return_code_t modem_rtos_get_event( modem_rsp_event_t* type, uint8_t* count, uint8_t* event_data,
+                                          uint8_t* event_data_length, uint8_t* asynchronous_msgnumber )
+{
+    modem_rtos_get_event_args_t args = { .type                   = type,
+                                         .count                  = count,
+                                         .event_data             = event_data,
+                                         .event_data_length      = event_data_length,
+                                         .asynchronous_msgnumber = asynchronous_msgnumber };
+
+    modem_rtos_call( modem_rtos_get_event_call, &args );
+    return args.return_code;
+}
+
+modem_return_code_t modem_rtos_join( void )
+{
+    modem_rtos_u32_args_t args = { .value = 0 };
+
+    modem_rtos_call( modem_rtos_join_call, &args );
+    return args.return_code;
+}
+
+modem_return_code_t modem_rtos_set_alarm_timer_s( uint32_t alarm )
+{
+    modem_rtos_u32_args_t args = { .value = alarm };
+
+    modem_rtos_call( modem_rtos_set_alarm_timer_s_call, &args );
+    return args.return_code;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void modem_rtos_mailbox_run( void )
+{
+    modem_rtos_function_t function = modem_rtos_mailbox_function;
+
+    if( function != NULL )
+    {
+        modem_rtos_mailbox_function = NULL;
+        function( modem_rtos_mailbox_context );
+        modem_rtos_port_call_done( );
+    }
+}
+
+static void modem_rtos_request_tx_call( void* context )
+{
+    modem_rtos_request_tx_args_t* args = ( modem_rtos_request_tx_args_t* ) context;
+
+    args->return_code = modem_request_tx( args->f_port, args->msg_type, args->payload, args->payload_length );
+}
+
+static void modem_rtos_get_event_call( void* context )
+{
+    modem_rtos_get_event_args_t* args = ( modem_rtos_get_event_args_t* ) context;
+
+    args->return_code = modem_get_event( args->type, args->count, args->event_data, args->event_data_length,
+                                         args->asynchronous_msgnumber );
+}
+
+static void modem_rtos_join_call( void* context )
+{
+    modem_rtos_u32_args_t* args = ( modem_rtos_u32_args_t* ) context;
+
+    args->return_code = modem_join( );
+}
+
+static void modem_rtos_set_alarm_timer_s_call( void* context )
+{
+    modem_rtos_u32_args_t* args = ( modem_rtos_u32_args_t* ) context;
+
+    args->return_code = modem_set_alarm_timer_s( args->value );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
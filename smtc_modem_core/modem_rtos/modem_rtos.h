@@ -0,0 +1,130 @@
+/*!
+ * \file      modem_rtos.h
+ *
+ * \brief     Modem RTOS integration, a modem thread owning the stack and thread safe API calls
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __MODEM_RTOS_H__
+#define __MODEM_RTOS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "modem_api.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Function executed by the modem thread on behalf of an application thread
+ */
+typedef void ( *modem_rtos_function_t )( void* context );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief   Body of the modem thread, it never returns
+ * \remark  Replaces the superloop of main: the modem is initialized, then the thread runs the calls of the
+ *          application threads and the modem engine, and blocks in \ref modem_rtos_port_wait instead of
+ *          bsp_mcu_set_sleep_for_ms. The event callback is executed by the modem thread.
+ *
+ * \param  [in]     callback*               - Callback that will be called if an event is available
+ */
+void modem_rtos_thread( void ( *callback )( void ) );
+
+/*!
+ * \brief   Wakes the modem thread up to run its engine
+ * \remark  Interrupt safe. The BSP of an RTOS build calls it from bsp_mcu_wakeup_request and
+ *          bsp_mcu_disable_once_low_power_wait, the radio events are then processed without waiting for the timeout.
+ */
+void modem_rtos_wakeup( void );
+
+/*!
+ * \brief   Executes a function in the modem thread and waits for its end
+ * \remark  Any modem API function can be called this way from the application threads. The calls are serialized by
+ *          \ref modem_rtos_port_lock, the highest priority thread waiting is served first. Called from the modem
+ *          thread, the function is executed at once.
+ *
+ * \param  [in]     function                - Function to execute
+ * \param  [in]     context*                - Argument given to the function, the arguments and results of the call
+ */
+void modem_rtos_call( modem_rtos_function_t function, void* context );
+
+/*!
+ * \brief   Thread safe \ref modem_request_tx
+ */
+modem_return_code_t modem_rtos_request_tx( uint8_t f_port, e_tx_mode_t msg_type, uint8_t* payload,
+                                           uint8_t payload_length );
+
+/*!
+ * \brief   Thread safe \ref modem_get_event
+ */
+modem_return_code_t modem_rtos_get_event( modem_rsp_event_t* type, uint8_t* count, uint8_t* event_data,
+                                          uint8_t* event_data_length, uint8_t* asynchronous_msgnumber );
+
+/*!
+ * \brief   Thread safe \ref modem_join
+ */
+modem_return_code_t modem_rtos_join( void );
+
+/*!
+ * \brief   Thread safe \ref modem_set_alarm_timer_s
+ */
+modem_return_code_t modem_rtos_set_alarm_timer_s( uint32_t alarm );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __MODEM_RTOS_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,124 @@
+/*!
+ * \file      modem_rtos_port.h
+ *
+ * \brief     Modem RTOS integration, functions to be implemented for the RTOS
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __MODEM_RTOS_PORT_H__
+#define __MODEM_RTOS_PORT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*
+ * ============================================================================
+ * API definitions to be implemented by the user for the specifc RTOS.
+ * ============================================================================
+ */
+
+/*!
+ * Takes the lock serializing the calls of the application threads
+ *
+ * \remark Must be a mutex with priority inheritance: the thread holding it waits for the modem thread, which must
+ *         not be preempted by the threads of medium priority meanwhile
+ */
+void modem_rtos_port_lock( void );
+
+/*!
+ * Releases the lock taken by \ref modem_rtos_port_lock
+ */
+void modem_rtos_port_unlock( void );
+
+/*!
+ * Wakes the modem thread up from \ref modem_rtos_port_wait
+ *
+ * \remark Called from the application threads and from the interrupts. A notification given while the modem thread
+ *         is not waiting must make its next wait return at once (FreeRTOS task notification, Zephyr semaphore).
+ */
+void modem_rtos_port_notify( void );
+
+/*!
+ * Blocks the modem thread until \ref modem_rtos_port_notify or the end of the timeout
+ *
+ * \remark The RTOS idle task puts the MCU in low power meanwhile, with its tickless idle for the long timeouts
+ *
+ * \param [in] timeout_ms Longest wait [ms]
+ */
+void modem_rtos_port_wait( uint32_t timeout_ms );
+
+/*!
+ * Blocks the calling application thread until \ref modem_rtos_port_call_done
+ */
+void modem_rtos_port_call_wait( void );
+
+/*!
+ * Releases the application thread blocked in \ref modem_rtos_port_call_wait, called from the modem thread
+ */
+void modem_rtos_port_call_done( void );
+
+/*!
+ * Returns true when called from the modem thread
+ */
+bool modem_rtos_port_is_modem_thread( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __MODEM_RTOS_PORT_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,247 @@
+/*!
+ * \file      ble_beacon.c
+ *
+ * \brief     BLE advertising beacon implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memcpy
+
+#include "smtc_bsp.h"
+#include "ble_beacon.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define BLE_BEACON_ACCESS_ADDRESS 0x8E89BED6  // advertising channels access address
+#define BLE_BEACON_CRC_INIT 0x555555          // advertising channels CRC initial value
+#define BLE_BEACON_PDU_ADV_NONCONN_IND 0x02   // non-connectable undirected advertising
+#define BLE_BEACON_PDU_TXADD_RANDOM 0x40      // the advertiser address is a random one
+#define BLE_BEACON_PDU_HEADER_SIZE 2
+#define BLE_BEACON_ADDRESS_SIZE 6
+#define BLE_BEACON_CHANNEL_NB 3
+#define BLE_BEACON_ADV_DELAY_MAX_MS 10  // random delay added to each advertising interval
+#define BLE_BEACON_TX_DURATION_MS 1     // 47 bytes at most at 1 Mb/s
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef struct ble_beacon_channel_s
+{
+    uint8_t  index;
+    uint32_t freq_in_hz;
+} ble_beacon_channel_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static const ble_beacon_channel_t ble_beacon_channels[BLE_BEACON_CHANNEL_NB] = {
+    { .index = 37, .freq_in_hz = 2402000000 },
+    { .index = 38, .freq_in_hz = 2426000000 },
+    { .index = 39, .freq_in_hz = 2480000000 },
+};
+
+static struct
+{
+    radio_planner_t* rp;
+    bool             is_running;
+    uint8_t          pdu[BLE_BEACON_PDU_HEADER_SIZE + BLE_BEACON_ADDRESS_SIZE + BLE_BEACON_ADV_DATA_MAX];
+    uint8_t          pdu_len;
+    uint16_t         interval_ms;
+    int8_t           pwr_in_dbm;
+    uint8_t          channel;         // channel of the advertisement in progress in ble_beacon_channels
+    uint32_t         event_start_ms;  // date of the first advertisement of the current event
+    uint32_t         sent_nb;
+    uint32_t         skipped_nb;
+} ble_beacon;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+/*!
+ * \brief   Enqueue the advertisement of the current channel
+ * \remark  The first one of an event is scheduled and moved to a free gap if needed, the next ones follow it as
+ *          soon as the radio is free, the three of them are close enough to be seen as one event
+ */
+static void ble_beacon_enqueue( uint32_t start_ms )
+{
+    const ble_beacon_channel_t* channel = &ble_beacon_channels[ble_beacon.channel];
+
+    rp_radio_params_t radio_params     = { 0 };
+    radio_params.pkt_type              = RAL_PKT_TYPE_BLE;
+    radio_params.tx.ble.freq_in_hz     = channel->freq_in_hz;
+    radio_params.tx.ble.pwr_in_dbm     = ble_beacon.pwr_in_dbm;
+    radio_params.tx.ble.channel_index  = channel->index;
+    radio_params.tx.ble.access_address = BLE_BEACON_ACCESS_ADDRESS;
+    radio_params.tx.ble.crc_init       = BLE_BEACON_CRC_INIT;
+
+    rp_task_t rp_task;
+    rp_task.hook_id          = BLE_BEACON_HOOK_ID;
+    rp_task.type             = RP_TASK_TYPE_TX_BLE;
+    rp_task.start_time_ms    = start_ms;
+    rp_task.duration_time_ms = BLE_BEACON_TX_DURATION_MS;
+    if( ble_beacon.channel == 0 )
+    {
+        rp_task.state          = RP_TASK_STATE_SCHEDULE;
+        rp_task.preempt_policy = RP_TASK_PREEMPT_RESCHEDULE;
+    }
+    else
+    {
+        rp_task.state          = RP_TASK_STATE_ASAP;
+        rp_task.preempt_policy = RP_TASK_PREEMPT_ABORT;
+    }
+
+    if( rp_task_enqueue( ble_beacon.rp, &rp_task, ble_beacon.pdu, ble_beacon.pdu_len, &radio_params ) !=
+        RP_HOOK_STATUS_OK )
+    {
+        BSP_DBG_TRACE_ERROR( "ble beacon task not enqueued\n" );
+    }
+}
+
+static void ble_beacon_callback( void* context )
+{
+    if( ble_beacon.is_running == false )
+    {
+        return;
+    }
+
+    const uint32_t now_ms = bsp_rtc_get_time_ms( );
+    if( ble_beacon.rp->status[BLE_BEACON_HOOK_ID] == RP_STATUS_TX_DONE )
+    {
+        if( ble_beacon.channel == 0 )
+        {
+            // the event starts when its first advertisement is actually sent
+            ble_beacon.event_start_ms = now_ms;
+        }
+        ble_beacon.sent_nb++;
+    }
+    else
+    {
+        ble_beacon.skipped_nb++;
+    }
+
+    ble_beacon.channel++;
+    if( ble_beacon.channel < BLE_BEACON_CHANNEL_NB )
+    {
+        ble_beacon_enqueue( now_ms );
+        return;
+    }
+
+    ble_beacon.channel = 0;
+    uint32_t start_ms  = ble_beacon.event_start_ms + ble_beacon.interval_ms +
+                        bsp_rng_get_random_in_range( 0, BLE_BEACON_ADV_DELAY_MAX_MS );
+    if( ( int32_t )( start_ms - ( now_ms + RP_MARGIN_DELAY + 2 ) ) < 0 )
+    {
+        start_ms = now_ms + RP_MARGIN_DELAY + 2;
+    }
+    ble_beacon.event_start_ms = start_ms;
+    ble_beacon_enqueue( start_ms );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void ble_beacon_init( radio_planner_t* rp )
+{
+    memset( &ble_beacon, 0, sizeof( ble_beacon ) );
+    ble_beacon.rp = rp;
+    rp_hook_init( rp, BLE_BEACON_HOOK_ID, ble_beacon_callback, &ble_beacon );
+}
+
+bool ble_beacon_start( const uint8_t address[6], const uint8_t* adv_data, uint8_t adv_data_len, uint16_t interval_ms,
+                       int8_t pwr_in_dbm )
+{
+    // a static random address has its two most significant bits set
+    if( ( ble_beacon.is_running == true ) || ( adv_data_len > BLE_BEACON_ADV_DATA_MAX ) ||
+        ( interval_ms < BLE_BEACON_INTERVAL_MIN_MS ) || ( interval_ms > BLE_BEACON_INTERVAL_MAX_MS ) ||
+        ( ( address[0] & 0xC0 ) != 0xC0 ) )
+    {
+        return false;
+    }
+
+    // the PDU fields are sent least significant byte first
+    ble_beacon.pdu[0] = BLE_BEACON_PDU_ADV_NONCONN_IND | BLE_BEACON_PDU_TXADD_RANDOM;
+    ble_beacon.pdu[1] = BLE_BEACON_ADDRESS_SIZE + adv_data_len;
+    for( uint8_t i = 0; i < BLE_BEACON_ADDRESS_SIZE; i++ )
+    {
+        ble_beacon.pdu[BLE_BEACON_PDU_HEADER_SIZE + i] = address[BLE_BEACON_ADDRESS_SIZE - 1 - i];
+    }
+    memcpy( &ble_beacon.pdu[BLE_BEACON_PDU_HEADER_SIZE + BLE_BEACON_ADDRESS_SIZE], adv_data, adv_data_len );
+    ble_beacon.pdu_len = BLE_BEACON_PDU_HEADER_SIZE + BLE_BEACON_ADDRESS_SIZE + adv_data_len;
+
+    ble_beacon.interval_ms    = interval_ms;
+    ble_beacon.pwr_in_dbm     = pwr_in_dbm;
+    ble_beacon.channel        = 0;
+    ble_beacon.sent_nb        = 0;
+    ble_beacon.skipped_nb     = 0;
+    ble_beacon.event_start_ms = bsp_rtc_get_time_ms( ) + RP_MARGIN_DELAY + 2;
+    ble_beacon.is_running     = true;
+    ble_beacon_enqueue( ble_beacon.event_start_ms );
+    return true;
+}
+
+bool ble_beacon_stop( void )
+{
+    if( ble_beacon.is_running == false )
+    {
+        return false;
+    }
+    ble_beacon.is_running = false;
+    rp_task_abort( ble_beacon.rp, BLE_BEACON_HOOK_ID );
+    BSP_DBG_TRACE_PRINTF( "ble beacon: %u advertisements sent, %u skipped\n", ble_beacon.sent_nb,
+                          ble_beacon.skipped_nb );
+    return true;
+}
+
+bool ble_beacon_is_running( void )
+{
+    return ble_beacon.is_running;
+}
+
+void ble_beacon_get_stats( uint32_t* sent_nb, uint32_t* skipped_nb )
+{
+    *sent_nb    = ble_beacon.sent_nb;
+    *skipped_nb = ble_beacon.skipped_nb;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
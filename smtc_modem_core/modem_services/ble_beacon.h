@@ -0,0 +1,128 @@
+/*!
+ * \file      ble_beacon.h
+ *
+ * \brief     BLE advertising beacon sent by the SX1280 between the LoRa tasks
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __BLE_BEACON_H__
+#define __BLE_BEACON_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "radio_planner.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Radio planner hook of the advertisements, the lowest priority one in use
+ */
+#define BLE_BEACON_HOOK_ID 3
+
+/*!
+ * Advertising data size limit of a legacy advertisement
+ */
+#define BLE_BEACON_ADV_DATA_MAX 31
+
+/*!
+ * Advertising interval range of a non-connectable advertiser
+ */
+#define BLE_BEACON_INTERVAL_MIN_MS 100
+#define BLE_BEACON_INTERVAL_MAX_MS 10240
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief   Attach the beacon to the radio planner
+ *
+ * \param  [in]     rp*                     - radio planner
+ * \retval          void
+ */
+void ble_beacon_init( radio_planner_t* rp );
+
+/*!
+ * \brief   Start advertising as a non-connectable BLE device
+ * \remark  Each advertising event is sent on the channels 37, 38 and 39. The PDU is built once here, the radio adds
+ *          the access address, the CRC and the whitening of each channel. The advertisements have the lowest
+ *          priority: they are moved to the next gap between the LoRa tasks, or skipped when preempted.
+ *
+ * \param  [in]     address*                - static random device address, most significant byte first
+ * \param  [in]     adv_data*               - advertising data, AD structures
+ * \param  [in]     adv_data_len            - advertising data length, up to BLE_BEACON_ADV_DATA_MAX
+ * \param  [in]     interval_ms             - advertising interval, a random delay of up to 10 ms is added
+ * \param  [in]     pwr_in_dbm              - output power
+ * \retval          bool                    - false if the beacon is running or the parameters are invalid
+ */
+bool ble_beacon_start( const uint8_t address[6], const uint8_t* adv_data, uint8_t adv_data_len, uint16_t interval_ms,
+                       int8_t pwr_in_dbm );
+
+/*!
+ * \brief   Stop advertising
+ *
+ * \retval          bool                    - false if the beacon was not running
+ */
+bool ble_beacon_stop( void );
+
+/*!
+ * \brief   Check if the beacon is advertising
+ *
+ * \retval          bool
+ */
+bool ble_beacon_is_running( void );
+
+/*!
+ * \brief   Get the advertisements sent and skipped since the start
+ *
+ * \param  [out]    sent_nb*                - advertisements sent
+ * \param  [out]    skipped_nb*             - advertisements aborted by the higher priority tasks
+ * \retval          void
+ */
+void ble_beacon_get_stats( uint32_t* sent_nb, uint32_t* skipped_nb );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __BLE_BEACON_H__
+
+/* --- EOF ------------------------------------------------------------------ */
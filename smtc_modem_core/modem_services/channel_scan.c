@@ -0,0 +1,246 @@
+/*!
+ * \file      channel_scan.c
+ *
+ * \brief     Background RSSI scan of the channel plan, rating the occupancy of the channels
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memset
+
+#include "smtc_bsp.h"
+#include "lr1mac_defs.h"
+#include "lorawan_api.h"
+#include "channel_scan.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define CHANNEL_SCAN_SAMPLE_US 20  // RSSI read over SPI, used to size the task
+#define CHANNEL_SCAN_BR_IN_BPS 1000000
+#define CHANNEL_SCAN_BW_SSB_IN_HZ 600000  // the receiver spans a 812 kHz LoRa channel
+
+// the extra LoRaWAN stacks take two hooks each from LR1MAC_EXTRA_STACK_HOOK_ID, class B the next one
+#if( LR1MAC_CLASS_B_HOOK_ID >= CHANNEL_SCAN_HOOK_ID )
+#error "No radio planner hook left for the channel scan, raise RP_NB_HOOKS"
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static const uint8_t channel_scan_sync_word[] = { 0xC1, 0x94, 0xC1 };  // not used, the receiver is never synced
+
+static struct
+{
+    radio_planner_t*      rp;
+    bool                  is_running;
+    channel_scan_params_t params;
+    uint32_t              scan_start_ms;  // date of the last scan enqueued, the next one follows a period later
+    uint32_t              freq_in_hz[CHANNEL_SCAN_FREQ_MAX];
+    uint8_t               freq_nb;
+    // written by the radio planner task and callback while is_done is false, read by the supervisor once it is true
+    uint8_t               busy_nb[CHANNEL_SCAN_FREQ_MAX];
+    rp_status_t           status;
+    volatile bool         is_done;
+    uint32_t              scan_nb;
+    uint32_t              aborted_nb;
+} channel_scan;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void channel_scan_callback( void* context )
+{
+    if( channel_scan.is_running == false )
+    {
+        return;
+    }
+    channel_scan.status  = channel_scan.rp->status[CHANNEL_SCAN_HOOK_ID];
+    channel_scan.is_done = true;
+    bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_RADIO );
+}
+
+/*!
+ * \brief   Enqueue a scan of the enabled channels, the channel plan is read again as the network may change it
+ *
+ * \param  [in]     start_ms                - scan date, the next free window when it is already past
+ * \param  [in]     is_retry                - true to start in the next free window instead
+ * \retval          bool                    - false if no channel is enabled or the task is not enqueued
+ */
+static bool channel_scan_enqueue( uint32_t start_ms, bool is_retry )
+{
+    channel_scan.freq_nb = lorawan_api_channel_scan_plan_get( channel_scan.freq_in_hz, CHANNEL_SCAN_FREQ_MAX );
+    if( channel_scan.freq_nb == 0 )
+    {
+        return false;
+    }
+
+    const uint32_t sweep_us =
+        ( uint32_t ) channel_scan.freq_nb *
+        ( RP_RSSI_SCAN_SETTLE_US + ( ( uint32_t ) channel_scan.params.sample_nb * CHANNEL_SCAN_SAMPLE_US ) );
+    rp_radio_params_t radio_params = { 0 };
+    rp_task_t         rp_task      = { 0 };
+
+    radio_params.pkt_type = RAL_PKT_TYPE_GFSK;
+    radio_params.rx.gfsk  = ( ral_params_gfsk_t ){
+        .freq_in_hz             = channel_scan.freq_in_hz[0],
+        .br_in_bps              = CHANNEL_SCAN_BR_IN_BPS,
+        .pbl_len_in_bytes       = 4,
+        .sync_word_len_in_bytes = sizeof( channel_scan_sync_word ),
+        .sync_word              = channel_scan_sync_word,
+        .pld_is_fix             = false,
+        .pld_len_in_bytes       = 255,
+        .crc_type               = RAL_GFSK_CRC_OFF,
+        .pulse_shape            = RAL_GFSK_MOD_SHAPE_BT_05,
+        .bw_ssb_in_hz           = CHANNEL_SCAN_BW_SSB_IN_HZ,
+    };
+    radio_params.rssi_scan.freq_in_hz            = channel_scan.freq_in_hz;
+    radio_params.rssi_scan.freq_nb               = channel_scan.freq_nb;
+    radio_params.rssi_scan.sample_nb             = channel_scan.params.sample_nb;
+    radio_params.rssi_scan.busy_threshold_in_dbm = channel_scan.params.busy_threshold_in_dbm;
+    radio_params.rssi_scan.busy_nb               = channel_scan.busy_nb;
+
+    // the sweep, then the short reception ending the task
+    rp_task.duration_time_ms = ( ( sweep_us + 999 ) / 1000 ) + 1;
+    const uint32_t now_ms    = bsp_rtc_get_time_ms( );
+    if( ( is_retry == true ) || ( ( int32_t )( start_ms - ( now_ms + RP_MARGIN_DELAY + 2 ) ) < 0 ) )
+    {
+        rp_get_next_free_window( channel_scan.rp, rp_task.duration_time_ms, &start_ms );
+    }
+    rp_task.hook_id            = CHANNEL_SCAN_HOOK_ID;
+    rp_task.type               = RP_TASK_TYPE_RSSI_SCAN;
+    rp_task.state              = RP_TASK_STATE_SCHEDULE;
+    rp_task.start_time_ms      = start_ms;
+    rp_task.preempt_policy     = RP_TASK_PREEMPT_ABORT;
+    channel_scan.scan_start_ms = start_ms;
+    if( rp_task_enqueue( channel_scan.rp, &rp_task, NULL, 0, &radio_params ) != RP_HOOK_STATUS_OK )
+    {
+        BSP_DBG_TRACE_ERROR( "channel scan not enqueued\n" );
+        return false;
+    }
+    return true;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void channel_scan_init( radio_planner_t* rp )
+{
+    memset( &channel_scan, 0, sizeof( channel_scan ) );
+    channel_scan.rp = rp;
+    rp_hook_init( rp, CHANNEL_SCAN_HOOK_ID, channel_scan_callback, &channel_scan );
+}
+
+bool channel_scan_start( const channel_scan_params_t* params )
+{
+    if( ( channel_scan.is_running == true ) || ( params->period_s < CHANNEL_SCAN_PERIOD_MIN_S ) ||
+        ( params->period_s > CHANNEL_SCAN_PERIOD_MAX_S ) || ( params->sample_nb < CHANNEL_SCAN_SAMPLE_MIN ) )
+    {
+        return false;
+    }
+
+    channel_scan.params     = *params;
+    channel_scan.is_done    = false;
+    channel_scan.scan_nb    = 0;
+    channel_scan.aborted_nb = 0;
+    if( channel_scan_enqueue( 0, true ) == false )
+    {
+        return false;
+    }
+    channel_scan.is_running = true;
+    return true;
+}
+
+bool channel_scan_stop( void )
+{
+    if( channel_scan.is_running == false )
+    {
+        return false;
+    }
+    channel_scan.is_running = false;
+    rp_task_abort( channel_scan.rp, CHANNEL_SCAN_HOOK_ID );
+    channel_scan.is_done = false;
+    BSP_DBG_TRACE_PRINTF( "channel scan: %u scans, %u aborted\n", channel_scan.scan_nb, channel_scan.aborted_nb );
+    return true;
+}
+
+bool channel_scan_is_running( void )
+{
+    return channel_scan.is_running;
+}
+
+bool channel_scan_is_done( void )
+{
+    return channel_scan.is_done;
+}
+
+void channel_scan_process( void )
+{
+    if( channel_scan.is_done == false )
+    {
+        return;
+    }
+
+    const bool is_retry = ( channel_scan.status != RP_STATUS_RSSI_SCAN_DONE );
+    if( is_retry == false )
+    {
+        channel_scan.scan_nb++;
+        for( uint8_t i = 0; i < channel_scan.freq_nb; i++ )
+        {
+            const uint8_t busy_ratio =
+                ( uint8_t )( ( ( uint16_t ) channel_scan.busy_nb[i] * 255 ) / channel_scan.params.sample_nb );
+            lorawan_api_channel_occupancy_update( channel_scan.freq_in_hz[i], busy_ratio );
+        }
+    }
+    else
+    {
+        channel_scan.aborted_nb++;
+    }
+    channel_scan.is_done = false;
+
+    // an aborted scan takes the next free window, a completed one is done again a period later
+    if( channel_scan_enqueue( channel_scan.scan_start_ms + ( channel_scan.params.period_s * 1000 ), is_retry ) ==
+        false )
+    {
+        channel_scan.is_running = false;
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
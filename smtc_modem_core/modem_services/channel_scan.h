@@ -0,0 +1,151 @@
+/*!
+ * \file      channel_scan.h
+ *
+ * \brief     Background RSSI scan of the channel plan, rating the occupancy of the channels
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __CHANNEL_SCAN_H__
+#define __CHANNEL_SCAN_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "radio_planner.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Radio planner hook of the channel scan, the last one: the scan only runs in the gaps left by all the other hooks
+ */
+#define CHANNEL_SCAN_HOOK_ID ( RP_NB_HOOKS - 1 )
+
+/*!
+ * Channels scanned at most, the ones of the WW2G4 channel plan
+ */
+#define CHANNEL_SCAN_FREQ_MAX 8
+
+/*!
+ * Scan period range
+ */
+#define CHANNEL_SCAN_PERIOD_MIN_S 1
+#define CHANNEL_SCAN_PERIOD_MAX_S 86400
+
+/*!
+ * RSSI samples per channel range
+ */
+#define CHANNEL_SCAN_SAMPLE_MIN 1
+#define CHANNEL_SCAN_SAMPLE_MAX 255
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Channel scan settings
+ */
+typedef struct channel_scan_params_s
+{
+    uint32_t period_s;               //!< time between two scans, CHANNEL_SCAN_PERIOD_MIN_S to CHANNEL_SCAN_PERIOD_MAX_S
+    uint8_t  sample_nb;              //!< RSSI samples per channel
+    int16_t  busy_threshold_in_dbm;  //!< a sample at or above it counts the channel busy
+} channel_scan_params_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief   Attach the channel scan to the radio planner
+ *
+ * \param  [in]     rp*                     - radio planner
+ * \retval          void
+ */
+void channel_scan_init( radio_planner_t* rp );
+
+/*!
+ * \brief   Start the periodic scans of the enabled channels
+ * \remark  Each scan keeps the radio in Rx and only changes its frequency from a channel to the next, taking
+ *          sample_nb RSSI samples on each. The busy ratios feed the channel occupancy of the LoRaWAN region, which
+ *          weighs the weighted channel selection and the channel picked again by the LBT after a busy CAD.
+ *
+ * \param  [in]     params*                 - scan settings
+ * \retval          bool                    - false if the scan runs, the parameters are invalid or the region has
+ *                                            no channel occupancy
+ */
+bool channel_scan_start( const channel_scan_params_t* params );
+
+/*!
+ * \brief   Stop the periodic scans, the channel occupancy is kept
+ *
+ * \retval          bool                    - false if the scan was not running
+ */
+bool channel_scan_stop( void );
+
+/*!
+ * \brief   Check if the periodic scans run
+ *
+ * \retval          bool
+ */
+bool channel_scan_is_running( void );
+
+/*!
+ * \brief   Check if a scan completed, its results are waiting for channel_scan_process
+ *
+ * \retval          bool
+ */
+bool channel_scan_is_done( void );
+
+/*!
+ * \brief   Give the results of the last scan to the LoRaWAN region and plan the next one
+ * \remark  Called by the modem supervisor once channel_scan_is_done, out of the radio planner callback
+ *
+ * \retval          void
+ */
+void channel_scan_process( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __CHANNEL_SCAN_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -35,6 +35,7 @@
  */
 #include <stdint.h>   // C99 types
 #include <stdbool.h>  // bool type
+#include <string.h>   // memcpy, memcmp
 
 #include "smtc_bsp.h"
 #include "file_upload.h"
@@ -48,27 +49,45 @@
 enum
 {
     BUFSZ       = ( ( 2 * 4096 ) + FILE_UPLOAD_HEADER_SIZE ),  // buffer size + header
-    NSESS       = 1,                                           // number of concurrent sessions
+    NSESS       = FILE_UPLOAD_MAX_SESSIONS,                    // number of concurrent sessions
     CHUNK_NW    = 2,                                           // number of words per chunk
-    MAXOVERHEAD = 2,                                           // max factor of chunks to send
+    MINOVERHEAD = 11,                                          // min factor of chunks to send, in tenths
+    DEFOVERHEAD = 20,                                          // factor of chunks to send on an unknown link
+    MAXOVERHEAD = 30,                                          // max factor of chunks to send, in tenths
 };
 
+/*!
+ * Progress of a session saved in the nvm journal
+ */
+typedef struct file_upload_progress_s
+{
+    uint32_t header[3];        // port, encryption and size then hash of the file, all 0 when nothing is saved
+    uint16_t cntx;             // chunk transmission count
+    uint8_t  fntx;             // frame transmission count
+    uint8_t  session_counter;  // session counter
+} file_upload_progress_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 static struct
 {
-    uint32_t  active;  // active session
-    uint32_t  header[3];
-    uint32_t* wordbuf;                 // data buffer
-    uint16_t  cct[NSESS];              // chunk count
-    uint8_t   session_counter[NSESS];  // session counter
-    uint16_t  cntx[NSESS];             // chunk transmission count
-    uint8_t   fntx[NSESS];             // frame transmission count
-    uint16_t  average_delay[NSESS];    // average frame transmission rate/delay
+    uint32_t           active;  // active session
+    uint32_t           header[NSESS][3];
+    uint32_t*          wordbuf[NSESS];          // data buffer
+    uint32_t           size[NSESS];             // file size
+    file_upload_read_t read[NSESS];             // data reader, NULL when the data buffer is used
+    void*              read_context[NSESS];     // data reader context
+    uint16_t           cct[NSESS];              // chunk count
+    uint8_t            session_counter[NSESS];  // session counter
+    uint16_t           cntx[NSESS];             // chunk transmission count
+    uint8_t            fntx[NSESS];             // frame transmission count
+    uint16_t           average_delay[NSESS];    // average frame transmission rate/delay
+    int16_t            link_margin_db;          // margin of the uplinks above the demodulation floor
+    uint8_t            resumable;               // sessions with their progress saved, one bit per session
 
-} state;
+} state = { .link_margin_db = FILE_UPLOAD_LINK_MARGIN_UNKNOWN };
 
 /*
  * -----------------------------------------------------------------------------
@@ -90,12 +109,46 @@ static uint32_t checkbits( uint32_t cid, uint32_t cct, uint32_t i )
     return phash( cid * ncw + i );
 }
 
-static void function_xor( uint32_t* dst, uint32_t* src, int32_t nw )
+// chunks to send per chunk of the file, in tenths: the decoder needs a bit more than the chunk count, each dB of
+// margin lost on the link brings more frames lost
+static uint32_t overhead_get( void )
+{
+    int32_t overhead = DEFOVERHEAD;
+
+    if( state.link_margin_db != FILE_UPLOAD_LINK_MARGIN_UNKNOWN )
+    {
+        overhead = DEFOVERHEAD - state.link_margin_db;
+    }
+    if( overhead < MINOVERHEAD )
+    {
+        overhead = MINOVERHEAD;
+    }
+    else if( overhead > MAXOVERHEAD )
+    {
+        overhead = MAXOVERHEAD;
+    }
+    return overhead;
+}
+
+// save the progress of a session, the saved progress of the other sessions is kept: they may not be resumed yet
+static void progress_save( uint32_t sid )
 {
-    while( nw-- > 0 )
+    file_upload_progress_t progress[NSESS];
+
+    if( bsp_nvm_journal_read( BSP_NVM_JOURNAL_KEY_MODEM_FILE_UPLOAD, ( uint8_t* ) progress, sizeof( progress ) ) !=
+        sizeof( progress ) )
+    {
+        memset( progress, 0, sizeof( progress ) );
+    }
+    memset( &progress[sid], 0, sizeof( progress[sid] ) );
+    if( ( state.resumable & ( 1 << sid ) ) != 0 )
     {
-        *dst++ ^= *src++;
+        memcpy( progress[sid].header, state.header[sid], sizeof( progress[sid].header ) );
+        progress[sid].cntx            = state.cntx[sid];
+        progress[sid].fntx            = state.fntx[sid];
+        progress[sid].session_counter = state.session_counter[sid];
     }
+    bsp_nvm_journal_write( BSP_NVM_JOURNAL_KEY_MODEM_FILE_UPLOAD, ( uint8_t* ) progress, sizeof( progress ) );
 }
 
 static int32_t next_session_counter( uint32_t sid )
@@ -106,43 +159,107 @@ static int32_t next_session_counter( uint32_t sid )
     return next;
 }
 
-static void gen_chunk( uint32_t* dst, uint32_t* src, uint32_t cct, uint32_t cid )
+// index of the lowest set bit of x (x != 0)
+static inline uint32_t lowest_bit_index( uint32_t x )
 {
-    memset( dst, 0, CHUNK_NW * 4 );
-    uint32_t bits = 0;  // initialized to make compiler happy
-    for( uint32_t i = 0; i < cct; i++ )
+#if defined( __ARM_FEATURE_CLZ ) && ( __ARM_ARCH >= 7 )
+    // RBIT + CLZ on ARMv7-M and above
+    return ( uint32_t ) __builtin_ctz( x );
+#else
+    // Cortex-M0+ has no CLZ: isolate the bit and use a De Bruijn sequence
+    static const uint8_t debruijn_index[32] = { 0,  1,  28, 2,  29, 14, 24, 3,  30, 22, 20, 15, 25, 17, 4,  8,
+                                                31, 27, 13, 23, 21, 19, 16, 7,  26, 12, 18, 6,  11, 5,  10, 9 };
+    return debruijn_index[( uint32_t )( ( x & ( ~x + 1 ) ) * 0x077CB531U ) >> 27];
+#endif
+}
+
+// xor one chunk in the accumulator, CHUNK_NW = 2 words so that both words are fetched by a single LDM
+static inline void xor_chunk( uint32_t acc[CHUNK_NW], const uint32_t* chunk )
+{
+    uint32_t w0 = chunk[0];
+    uint32_t w1 = chunk[1];
+    acc[0] ^= w0;
+    acc[1] ^= w1;
+}
+
+// read nw words of the file through the data reader, the words past the end of the file are read as 0
+static void read_words( uint32_t sid, uint32_t word, uint32_t* dst, uint32_t nw )
+{
+    uint32_t offset = word * 4;
+    uint32_t length = nw * 4;
+
+    memset( dst, 0, length );
+    if( offset < state.size[sid] )
     {
-        if( ( i & 31 ) == 0 )
+        if( length > ( state.size[sid] - offset ) )
         {
-            bits = checkbits( cid, cct, i >> 5 );
+            length = state.size[sid] - offset;
         }
-        if( bits == 0 )
+        state.read[sid]( state.read_context[sid], offset, ( uint8_t* ) dst, length );
+    }
+}
+
+// chunk i of the file is xored in the output chunk when bit i of the checkbits is set, this code is the one expected
+// by the decoder so only its evaluation can be made cheaper: each checkword is traversed from one set bit to the
+// next, and the header chunks are handled once out of the loop
+static void gen_chunk( uint32_t* dst, uint32_t sid, uint32_t cid )
+{
+    const uint32_t* src           = state.wordbuf[sid];
+    uint32_t        cct           = state.cct[sid];
+    uint32_t        acc[CHUNK_NW] = { 0 };
+    uint32_t        ncw           = ( cct + 31 ) >> 5;
+
+    for( uint32_t w = 0; w < ncw; w++ )
+    {
+        uint32_t bits = checkbits( cid, cct, w );
+        uint32_t rem  = cct - ( w << 5 );
+        if( rem < 32 )
         {
-            continue;
+            bits &= ( 1UL << rem ) - 1;  // drop the chunks past the end of the file
         }
-        if( bits & 1 )
+        if( w == 0 )
         {
-            if( i == 0 )
+            // chunk 0: header words 0 and 1, chunk 1: header word 2 and first file word
+            if( bits & 1 )
+            {
+                xor_chunk( acc, &state.header[sid][0] );
+            }
+            if( bits & 2 )
             {
-                uint32_t tmp[2];
-                tmp[0] = state.header[0];
-                tmp[1] = state.header[1];
-                function_xor( dst, tmp, CHUNK_NW );
+                uint32_t first_word = 0;
+                if( state.read[sid] == NULL )
+                {
+                    first_word = src[0];
+                }
+                else
+                {
+                    read_words( sid, 0, &first_word, 1 );
+                }
+                acc[0] ^= state.header[sid][2];
+                acc[1] ^= first_word;
             }
-            else if( i == 1 )
+            bits &= ~3UL;
+        }
+        // chunk i >= 2 starts at word ( CHUNK_NW * i ) - 3 of the file
+        uint32_t first = ( w << 5 ) * CHUNK_NW;
+        while( bits != 0 )
+        {
+            uint32_t i = lowest_bit_index( bits );
+            if( state.read[sid] == NULL )
             {
-                uint32_t tmp[2];
-                tmp[0] = state.header[2];
-                tmp[1] = *( src );
-                function_xor( dst, tmp, CHUNK_NW );
+                xor_chunk( acc, &src[first + ( CHUNK_NW * i ) - 3] );
             }
             else
             {
-                function_xor( dst, src + ( CHUNK_NW * i ) - 3, CHUNK_NW );
+                uint32_t tmp[CHUNK_NW];
+                read_words( sid, first + ( CHUNK_NW * i ) - 3, tmp, CHUNK_NW );
+                xor_chunk( acc, tmp );
             }
+            bits &= bits - 1;
         }
-        bits >>= 1;
     }
+    dst[0] = acc[0];
+    dst[1] = acc[1];
 }
 
 /*
@@ -159,34 +276,42 @@ int32_t file_upload_gen_uplink( unsigned char* buf, int32_t bufsz, uint32_t sid,
     // discriminator (16bit little endian): 2bit session id, 4bit session counter, 10bit chunk count-1
     uint32_t d = ( ( sid & 0x03 ) << 14 ) | ( ( state.session_counter[sid] & 0x0F ) << 10 ) |
                  ( ( state.cct[sid] - 1 ) & 0x03FF );
-    int32_t n     = 0;
-    buf[n++]      = e_inf_upload;
-    buf[n++]      = d;
-    buf[n++]      = d >> 8;
-    uint32_t  cid = phash( fcnt );
-    uint32_t* src = &state.wordbuf[0];
+    int32_t  n   = 0;
+    buf[n++]     = e_inf_upload;
+    buf[n++]     = d;
+    buf[n++]     = d >> 8;
+    uint32_t cid = phash( fcnt );
 
+    // each chunk goes through the whole file
+    bsp_mcu_clock_boost_request( );
     while( bufsz >= ( CHUNK_NW * 4 ) )
     {
         uint32_t tmp[CHUNK_NW];
-        gen_chunk( tmp, src, state.cct[sid], cid++ );
+        gen_chunk( tmp, sid, cid++ );
         memcpy( buf + n, tmp, CHUNK_NW * 4 );
         n += ( CHUNK_NW * 4 );
         bufsz -= ( CHUNK_NW * 4 );
     }
+    bsp_mcu_clock_boost_release( );
     state.cntx[sid] += ( n - 3 ) / ( CHUNK_NW * 4 );  // update number of chunks sent
     if( state.fntx[sid] < 255 )
     {
         state.fntx[sid] += 1;  // update number of frames sent
     }
-    if( ( state.fntx[sid] < 3 ) || ( state.cntx[sid] < ( 2 * state.cct[sid] ) ) )
+    bool is_done = ( state.fntx[sid] >= 3 ) && ( ( state.cntx[sid] * 10UL ) >= ( overhead_get( ) * state.cct[sid] ) );
+    if( ( state.resumable & ( 1 << sid ) ) != 0 )
     {
-        return n;
-    }
-    else
-    {
-        return 0;
+        if( is_done == true )
+        {
+            state.resumable &= ~( 1 << sid );
+            progress_save( sid );
+        }
+        else if( ( state.fntx[sid] % FILE_UPLOAD_PROGRESS_SAVE_PERIOD ) == 0 )
+        {
+            progress_save( sid );  // a reset loses the frames sent since, they are sent again
+        }
     }
+    return ( is_done == false ) ? n : 0;
 }
 
 int32_t file_upload_create( uint32_t sid, uint32_t** pdata, uint32_t sz, uint16_t average_delay, uint8_t port,
@@ -194,6 +319,11 @@ int32_t file_upload_create( uint32_t sid, uint32_t** pdata, uint32_t sz, uint16_
 {
     uint16_t sz_tmp = sz + FILE_UPLOAD_HEADER_SIZE;
     uint32_t cct    = ( sz_tmp + ( ( 4 * CHUNK_NW ) - 1 ) ) / ( 4 * CHUNK_NW );
+    if( sid >= NSESS )
+    {
+        BSP_DBG_TRACE_ERROR( "FileUpload bad session id %lu\n", sid );
+        return -1;
+    }
     if( BUFSZ < sz_tmp )
     {
         BSP_DBG_TRACE_ERROR( "FileUpload is too large (%d < %lu )\n", BUFSZ - 12, sz_tmp );
@@ -201,13 +331,16 @@ int32_t file_upload_create( uint32_t sid, uint32_t** pdata, uint32_t sz, uint16_
     }
 
     state.cct[sid]             = cct;
+    state.size[sid]            = sz;
     state.average_delay[sid]   = average_delay;
     state.session_counter[sid] = next_session_counter( sid );
     BSP_DBG_TRACE_WARNING( "upload session_counter %d\n", state.session_counter[sid] );
     state.cntx[sid] = 0;
     state.fntx[sid] = 0;
+    state.resumable &= ~( 1 << sid );  // until file_upload_resume, the saved progress may be another file's
 
-    state.header[0] = ( port ) + ( encryption << 8 ) + ( ( sz & 0xFF ) << 16 ) + ( ( ( sz & 0xFF00 ) >> 8 ) << 24 );
+    state.header[sid][0] =
+        ( port ) + ( encryption << 8 ) + ( ( sz & 0xFF ) << 16 ) + ( ( ( sz & 0xFF00 ) >> 8 ) << 24 );
 
     return state.session_counter[sid];
 }
@@ -216,17 +349,78 @@ uint8_t file_upload_get_session_counter( uint32_t sid )
 {
     return ( state.session_counter[sid] );
 }
-void file_upload_set_hash( uint32_t hash0, uint32_t hash1 )
+void file_upload_set_hash( uint32_t sid, uint32_t hash0, uint32_t hash1 )
+{
+    state.header[sid][1] = hash0;
+    state.header[sid][2] = hash1;
+}
+file_upload_encrypt_mode_t file_upload_get_encryption_mode( uint32_t sid )
+{
+    return ( file_upload_encrypt_mode_t )( ( state.header[sid][0] & ( FILE_UPLOAD_ENCRYPTED << 8 ) ) >> 8 );
+}
+bool file_upload_is_compressed( uint32_t sid )
+{
+    return ( state.header[sid][0] & ( FILE_UPLOAD_CODEC_LZ << 8 ) ) != 0;
+}
+void file_upload_set_compressed_size( uint32_t sid, int32_t sz )
+{
+    if( sz < 0 )
+    {
+        state.header[sid][0] &= ~( FILE_UPLOAD_CODEC_LZ << 8 );
+    }
+    else
+    {
+        state.size[sid]      = sz;
+        state.cct[sid]       = ( sz + FILE_UPLOAD_HEADER_SIZE + ( ( 4 * CHUNK_NW ) - 1 ) ) / ( 4 * CHUNK_NW );
+        state.header[sid][0] = ( state.header[sid][0] & 0x0000FFFF ) + ( ( sz & 0xFF ) << 16 ) +
+                               ( ( ( sz & 0xFF00 ) >> 8 ) << 24 );
+    }
+}
+void file_upload_attach_payload_buffer( uint32_t sid, uint8_t* file )
+{
+    state.wordbuf[sid] = ( uint32_t* ) file;
+    state.read[sid]    = NULL;
+}
+void file_upload_attach_payload_reader( uint32_t sid, file_upload_read_t read, void* context )
 {
-    state.header[1] = hash0;
-    state.header[2] = hash1;
+    state.wordbuf[sid]      = NULL;
+    state.read[sid]         = read;
+    state.read_context[sid] = context;
+}
+bool file_upload_resume( uint32_t sid )
+{
+    file_upload_progress_t progress[NSESS];
+    bool                   is_resumed = false;
+
+    if( ( bsp_nvm_journal_read( BSP_NVM_JOURNAL_KEY_MODEM_FILE_UPLOAD, ( uint8_t* ) progress, sizeof( progress ) ) ==
+          sizeof( progress ) ) &&
+        ( memcmp( progress[sid].header, state.header[sid], sizeof( progress[sid].header ) ) == 0 ) )
+    {
+        state.cntx[sid]            = progress[sid].cntx;
+        state.fntx[sid]            = progress[sid].fntx;
+        state.session_counter[sid] = progress[sid].session_counter;
+        is_resumed                 = true;
+        BSP_DBG_TRACE_WARNING( "upload resumed, session_counter %d, %d chunks sent\n", state.session_counter[sid],
+                               state.cntx[sid] );
+    }
+    state.resumable |= 1 << sid;
+    progress_save( sid );
+    return is_resumed;
+}
+void file_upload_end( uint32_t sid )
+{
+    if( ( state.resumable & ( 1 << sid ) ) != 0 )
+    {
+        state.resumable &= ~( 1 << sid );
+        progress_save( sid );
+    }
 }
-file_upload_encrypt_mode_t file_upload_get_encryption_mode( void )
+void file_upload_link_margin_set( int16_t margin_db )
 {
-    return ( file_upload_encrypt_mode_t )( ( state.header[0] & 0x0000FF00 ) >> 8 );
+    state.link_margin_db = margin_db;
 }
-void file_upload_attach_payload_buffer( uint8_t* file )
+uint32_t file_upload_get_ram_size( void )
 {
-    state.wordbuf = ( uint32_t* ) file;
+    return sizeof( state );
 }
 /* --- EOF ------------------------------------------------------------------ */
@@ -41,7 +41,8 @@ extern "C" {
  * --- DEPENDENCIES ------------------------------------------------------------
  */
 
-#include <stdint.h>  // C99 types
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
 
 /*
  * -----------------------------------------------------------------------------
@@ -51,6 +52,10 @@ extern "C" {
 #define MODE_0 0
 #define FILE_UPLOAD_HEADER_SIZE 12
 #define FILE_UPLOAD_DIRECTION 0x40
+#define FILE_UPLOAD_MAX_SESSIONS 4  // limited by the 2bit session id of the uplink discriminator
+#define FILE_UPLOAD_LINK_MARGIN_UNKNOWN INT16_MIN
+#define FILE_UPLOAD_PROGRESS_SAVE_PERIOD 4  // frames between two saves of the session progress in the nvm journal
+#define FILE_UPLOAD_CODEC_LZ 0x02  // encryption mode bit: the file is compressed, see lz_compress_in_place
 
 /*
  * -----------------------------------------------------------------------------
@@ -66,6 +71,13 @@ typedef enum file_upload_encrypt_mode
     FILE_UPLOAD_NOT_ENCRYPTED = 0x00,  //!< File Upload not encrypted
     FILE_UPLOAD_ENCRYPTED     = 0x01   //!< File Upload encrypted
 } file_upload_encrypt_mode_t;
+
+/*!
+ * \typedef file_upload_read_t
+ * \brief   File Upload data reader, copies length bytes of the file starting at offset in buffer
+ */
+typedef void ( *file_upload_read_t )( void* context, uint32_t offset, uint8_t* buffer, uint32_t length );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -80,7 +92,7 @@ typedef enum file_upload_encrypt_mode
  * \param  [in]     sz                      - size of data
  * \param  [in]     average_delay           - delay between each uplink frame
  * \param  [in]     port                    - applicative where the data will be forwarded
- * \param  [in]     encryption              - file upload encrypted or not
+ * \param  [in]     encryption              - file upload encrypted or not, FILE_UPLOAD_CODEC_LZ to compress it
  * \retval          int32_t                 - unique session ID counter, -1 in case of error
  */
 int32_t file_upload_create( uint32_t sid, uint32_t** pdata, uint32_t sz, uint16_t average_delay, uint8_t port,
@@ -110,27 +122,100 @@ uint8_t file_upload_get_session_counter( uint32_t sid );
  * \brief   set hash key in header byte 1
  * \remark
  *
+ * \param  [in]     sid                      - session ID
  * \param  [in]     hash0                    - fileupload hash 0
  * \param  [in]     hash1                    - fileupload hash 1
  * \retval          void
  */
-void file_upload_set_hash( uint32_t hash0, uint32_t hash1 );
+void file_upload_set_hash( uint32_t sid, uint32_t hash0, uint32_t hash1 );
 /*!
  * \brief   return the encrypted mode
  * \remark
  *
+ * \param  [in]     sid                     - session ID
  * \retval          file_upload_encrypt_mode_t
  */
-file_upload_encrypt_mode_t file_upload_get_encryption_mode( void );
+file_upload_encrypt_mode_t file_upload_get_encryption_mode( uint32_t sid );
+
+/*!
+ * \brief   return true when the file is to be compressed
+ * \remark  Requested with FILE_UPLOAD_CODEC_LZ in the encryption mode of file_upload_create
+ *
+ * \param  [in]     sid                     - session ID
+ * \retval          bool
+ */
+bool file_upload_is_compressed( uint32_t sid );
+
+/*!
+ * \brief   set the size of the file once compressed
+ * \remark  To be called before the hash is set. A negative size leaves the file uncompressed: the FILE_UPLOAD_CODEC_LZ
+ *          bit is cleared from the header, the receiver takes the file as it is.
+ *
+ * \param  [in]     sid                     - session ID
+ * \param  [in]     sz                      - compressed size, negative when not compressed
+ * \retval          void
+ */
+void file_upload_set_compressed_size( uint32_t sid, int32_t sz );
 
 /*!
  * \brief   return file_upload_attach_payload_buffer
  * \remark
  *
+ * \param  [in]     sid                     - session ID
  * \param  [in]     file*
  * \retval          revoidturn
  */
-void file_upload_attach_payload_buffer( uint8_t* file );
+void file_upload_attach_payload_buffer( uint32_t sid, uint8_t* file );
+
+/*!
+ * \brief   read the file through a reader instead of a RAM buffer
+ * \remark  The chunks are read on demand while generating each uplink, so the file can stay in flash or in an
+ *          external memory. The reader is called from the modem main loop.
+ *
+ * \param  [in]     sid                     - session ID
+ * \param  [in]     read                    - data reader
+ * \param  [in]     context*                - data reader context
+ * \retval          void
+ */
+void file_upload_attach_payload_reader( uint32_t sid, file_upload_read_t read, void* context );
+
+/*!
+ * \brief   resume the session interrupted by a reset when it uploads the same file
+ * \remark  To be called once the hash is set. The header of the file (port, encryption, size and hash) is compared
+ *          with the progress saved in the nvm journal: on a match the session counter and the chunk and frame counts
+ *          are restored, the new chunks add up with the ones received before the reset. The session progress is saved
+ *          every FILE_UPLOAD_PROGRESS_SAVE_PERIOD frames from then on, until its end.
+ *
+ * \param  [in]     sid                     - session ID
+ * \retval          bool                    - true if the session was resumed
+ */
+bool file_upload_resume( uint32_t sid );
+
+/*!
+ * \brief   end a session before all its chunks are sent, on a cancel or a DM_FILE_DONE downlink
+ * \remark  Its saved progress is dropped, it won't be resumed
+ *
+ * \param  [in]     sid                     - session ID
+ * \retval          void
+ */
+void file_upload_end( uint32_t sid );
+
+/*!
+ * \brief   set the link margin of the uplinks, it chooses the number of chunks sent for each chunk of the file
+ * \remark  From 1.1 chunks per chunk on a good link to 3 on a link below the demodulation floor, 2 while the margin
+ *          is FILE_UPLOAD_LINK_MARGIN_UNKNOWN. A DM_FILE_DONE downlink ends the session before.
+ *
+ * \param  [in]     margin_db               - margin above the demodulation floor of the uplinks
+ * \retval          void
+ */
+void file_upload_link_margin_set( int16_t margin_db );
+
+/*!
+ * \brief   Get the RAM taken by the upload sessions state
+ *
+ * \retval          uint32_t                - size in bytes
+ */
+uint32_t file_upload_get_ram_size( void );
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,439 @@
+/*!
+ * \file      frag_decoder.c
+ *
+ * \brief     Fragmented data block receiver implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memset
+
+#include "smtc_bsp.h"
+#include "frag_decoder.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define FRAG_ROW_SIZE_MAX ( ( FRAG_DECODER_NB_FRAG_MAX + 7 ) / 8 )
+#define FRAG_ROW_FREE 0xFFFF  // parity row slot not used
+#define FRAG_CHUNK_SIZE 32    // the staging area is XORed by chunks of this size
+
+// Fragmentation package messages, session 0 is the only one supported
+#define FRAG_CMD_PACKAGE_VERSION 0x00
+#define FRAG_CMD_SESSION_STATUS 0x01
+#define FRAG_CMD_SESSION_SETUP 0x02
+#define FRAG_CMD_SESSION_DELETE 0x03
+#define FRAG_CMD_DATA_FRAGMENT 0x08
+#define FRAG_SESSION_SETUP_SIZE 11
+#define FRAG_DATA_FRAGMENT_HEADER_SIZE 3
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+// The file and the parity rows are in the staging area: the file fragments from its start, then a row of row_size
+// bytes per slot. The data of a stored row is kept in the file slot of its first fragment, unknown until solved.
+static struct
+{
+    bool     is_active;
+    bool     is_done;
+    uint16_t nb_frag;
+    uint8_t  frag_size;
+    uint8_t  padding;
+    uint16_t row_size;                           // bytes of a parity row, one bit per uncoded fragment
+    uint32_t rows_offset;                        // offset of the parity rows in the staging area
+    uint16_t received_nb;                        // fragments received
+    uint16_t known_nb;                           // fragments received uncoded or solved
+    uint8_t  row_nb;                             // parity rows stored
+    uint16_t row_pivot[FRAG_DECODER_ROW_NB_MAX];  // first fragment of each stored row, FRAG_ROW_FREE if not used
+    uint8_t  known[FRAG_ROW_SIZE_MAX];           // fragments received uncoded or solved
+    uint8_t  row[FRAG_ROW_SIZE_MAX];             // parity row of the fragment being processed
+    uint8_t  data[FRAG_DECODER_FRAG_SIZE_MAX];   // data of the fragment being processed
+} frag;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool frag_bit_get( const uint8_t* bits, uint16_t i )
+{
+    return ( bits[i >> 3] & ( 1 << ( i & 7 ) ) ) != 0;
+}
+
+static void frag_bit_set( uint8_t* bits, uint16_t i )
+{
+    bits[i >> 3] |= 1 << ( i & 7 );
+}
+
+// Pseudo-random generator of the parity matrix, defined by the fragmentation specification
+static uint32_t frag_prbs23_next( uint32_t x )
+{
+    uint32_t b0 = x & 0x01;
+    uint32_t b1 = ( x & 0x20 ) >> 5;
+    return ( x >> 1 ) + ( ( b0 ^ b1 ) << 22 );
+}
+
+// Parity row of the coded fragment n (1 for the first one) over m uncoded fragments, from the specification
+static void frag_parity_row_get( uint16_t n, uint16_t m, uint8_t* row )
+{
+    uint32_t m_tmp    = ( ( m & ( m - 1 ) ) == 0 ) ? 1 : 0;
+    uint32_t x        = 1 + ( 1001 * ( uint32_t ) n );
+    uint16_t nb_coeff = 0;
+
+    memset( row, 0, ( m + 7 ) / 8 );
+    while( nb_coeff < ( m / 2 ) )
+    {
+        uint32_t r = 1 << 16;
+        while( r >= m )
+        {
+            x = frag_prbs23_next( x );
+            r = x % ( m + m_tmp );
+        }
+        frag_bit_set( row, r );
+        nb_coeff++;
+    }
+}
+
+// XOR size bytes of the staging area from offset into buffer
+static void frag_staging_xor_in( uint32_t offset, uint8_t* buffer, uint16_t size )
+{
+    uint8_t chunk[FRAG_CHUNK_SIZE];
+
+    for( uint16_t done = 0; done < size; done += FRAG_CHUNK_SIZE )
+    {
+        uint16_t length = ( ( size - done ) < FRAG_CHUNK_SIZE ) ? ( size - done ) : FRAG_CHUNK_SIZE;
+        bsp_nvm_staging_read( offset + done, chunk, length );
+        for( uint16_t i = 0; i < length; i++ )
+        {
+            buffer[done + i] ^= chunk[i];
+        }
+    }
+}
+
+// XOR buffer into size bytes of the staging area from offset, return the number of bits set in the result
+static uint16_t frag_staging_xor_out( uint32_t offset, const uint8_t* buffer, uint16_t size )
+{
+    uint8_t  chunk[FRAG_CHUNK_SIZE];
+    uint16_t bit_nb = 0;
+
+    for( uint16_t done = 0; done < size; done += FRAG_CHUNK_SIZE )
+    {
+        uint16_t length = ( ( size - done ) < FRAG_CHUNK_SIZE ) ? ( size - done ) : FRAG_CHUNK_SIZE;
+        bsp_nvm_staging_read( offset + done, chunk, length );
+        for( uint16_t i = 0; i < length; i++ )
+        {
+            chunk[i] ^= buffer[done + i];
+            for( uint8_t byte = chunk[i]; byte != 0; byte &= byte - 1 )
+            {
+                bit_nb++;
+            }
+        }
+        if( bsp_nvm_staging_write( offset + done, chunk, length ) != 0 )
+        {
+            BSP_DBG_TRACE_ERROR( "staging area write failed at %lu\n", offset + done );
+        }
+    }
+    return bit_nb;
+}
+
+static void frag_staging_write( uint32_t offset, const uint8_t* buffer, uint16_t size )
+{
+    if( bsp_nvm_staging_write( offset, buffer, size ) != 0 )
+    {
+        BSP_DBG_TRACE_ERROR( "staging area write failed at %lu\n", offset );
+    }
+}
+
+static uint32_t frag_data_offset( uint16_t fragment )
+{
+    return ( uint32_t ) fragment * frag.frag_size;
+}
+
+static uint32_t frag_row_offset( uint8_t slot )
+{
+    return frag.rows_offset + ( ( uint32_t ) slot * frag.row_size );
+}
+
+static int16_t frag_row_slot_get( uint16_t pivot )
+{
+    for( uint8_t slot = 0; slot < FRAG_DECODER_ROW_NB_MAX; slot++ )
+    {
+        if( frag.row_pivot[slot] == pivot )
+        {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+// Remove the known fragments and the first fragments of the stored rows from the row being processed
+static void frag_row_reduce( void )
+{
+    for( uint16_t c = 0; c < frag.nb_frag; c++ )
+    {
+        if( frag.row[c >> 3] == 0 )
+        {  // nothing to reduce in this byte
+            c |= 7;
+            continue;
+        }
+        if( frag_bit_get( frag.row, c ) == false )
+        {
+            continue;
+        }
+        if( frag_bit_get( frag.known, c ) == true )
+        {
+            frag_staging_xor_in( frag_data_offset( c ), frag.data, frag.frag_size );
+            frag.row[c >> 3] &= ~( 1 << ( c & 7 ) );
+        }
+        else if( frag.row_nb > 0 )
+        {  // a stored row only has fragments after its first one, the scan goes on over them
+            int16_t slot = frag_row_slot_get( c );
+            if( slot >= 0 )
+            {
+                frag_staging_xor_in( frag_row_offset( slot ), frag.row, frag.row_size );
+                frag_staging_xor_in( frag_data_offset( c ), frag.data, frag.frag_size );
+            }
+        }
+    }
+}
+
+// Remove the fragment solved or stored as the first one of the processed row from the other stored rows
+static void frag_row_eliminate( uint16_t pivot, int16_t pivot_slot )
+{
+    for( uint8_t slot = 0; slot < FRAG_DECODER_ROW_NB_MAX; slot++ )
+    {
+        uint8_t row_byte;
+
+        if( ( frag.row_pivot[slot] == FRAG_ROW_FREE ) || ( slot == pivot_slot ) )
+        {
+            continue;
+        }
+        bsp_nvm_staging_read( frag_row_offset( slot ) + ( pivot >> 3 ), &row_byte, 1 );
+        if( ( row_byte & ( 1 << ( pivot & 7 ) ) ) == 0 )
+        {
+            continue;
+        }
+        frag_staging_xor_out( frag_data_offset( frag.row_pivot[slot] ), frag.data, frag.frag_size );
+        if( frag_staging_xor_out( frag_row_offset( slot ), frag.row, frag.row_size ) == 1 )
+        {  // only its first fragment is left: the row data is that fragment
+            frag_bit_set( frag.known, frag.row_pivot[slot] );
+            frag.known_nb++;
+            frag.row_pivot[slot] = FRAG_ROW_FREE;
+            frag.row_nb--;
+        }
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void frag_decoder_init( void )
+{
+    memset( &frag, 0, sizeof( frag ) );
+}
+
+bool frag_decoder_session_setup( uint16_t nb_frag, uint8_t frag_size, uint8_t padding )
+{
+    frag.is_active = false;
+    if( ( nb_frag == 0 ) || ( nb_frag > FRAG_DECODER_NB_FRAG_MAX ) || ( frag_size == 0 ) ||
+        ( frag_size > FRAG_DECODER_FRAG_SIZE_MAX ) || ( padding >= frag_size ) )
+    {
+        return false;
+    }
+
+    frag.nb_frag     = nb_frag;
+    frag.frag_size   = frag_size;
+    frag.padding     = padding;
+    frag.row_size    = ( nb_frag + 7 ) / 8;
+    frag.rows_offset = ( uint32_t ) nb_frag * frag_size;
+    if( ( frag.rows_offset + ( ( uint32_t ) FRAG_DECODER_ROW_NB_MAX * frag.row_size ) ) > BSP_NVM_STAGING_SIZE )
+    {
+        BSP_DBG_TRACE_ERROR( "fragmented file of %lu bytes too large for the staging area\n", frag.rows_offset );
+        return false;
+    }
+    frag.is_done     = false;
+    frag.received_nb = 0;
+    frag.known_nb    = 0;
+    frag.row_nb      = 0;
+    memset( frag.known, 0, sizeof( frag.known ) );
+    for( uint8_t slot = 0; slot < FRAG_DECODER_ROW_NB_MAX; slot++ )
+    {
+        frag.row_pivot[slot] = FRAG_ROW_FREE;
+    }
+    frag.is_active = true;
+    return true;
+}
+
+void frag_decoder_session_delete( void )
+{
+    frag.is_active = false;
+}
+
+frag_decoder_status_t frag_decoder_fragment_process( uint16_t index, const uint8_t* data, uint8_t size )
+{
+    if( ( frag.is_active == false ) || ( frag.is_done == true ) || ( index == 0 ) || ( size != frag.frag_size ) )
+    {
+        return FRAG_DECODER_STATUS_DROPPED;
+    }
+    if( frag.received_nb < UINT16_MAX )
+    {
+        frag.received_nb++;
+    }
+
+    if( index <= frag.nb_frag )
+    {
+        memset( frag.row, 0, frag.row_size );
+        frag_bit_set( frag.row, index - 1 );
+    }
+    else
+    {
+        frag_parity_row_get( index - frag.nb_frag, frag.nb_frag, frag.row );
+    }
+    memcpy( frag.data, data, size );
+
+    // the row is left with unknown fragments only, none of them starting a stored row
+    frag_row_reduce( );
+    int32_t  pivot  = -1;
+    uint16_t bit_nb = 0;
+    for( uint16_t c = 0; c < frag.nb_frag; c++ )
+    {
+        if( frag_bit_get( frag.row, c ) == true )
+        {
+            pivot = ( pivot < 0 ) ? c : pivot;
+            bit_nb++;
+        }
+    }
+    if( pivot < 0 )
+    {  // redundant, nothing new in this fragment
+        return FRAG_DECODER_STATUS_ONGOING;
+    }
+
+    int16_t slot = -1;
+    if( bit_nb > 1 )
+    {
+        slot = frag_row_slot_get( FRAG_ROW_FREE );
+        if( slot < 0 )
+        {
+            return FRAG_DECODER_STATUS_MATRIX_FULL;
+        }
+        frag_staging_write( frag_row_offset( slot ), frag.row, frag.row_size );
+        frag.row_pivot[slot] = pivot;
+        frag.row_nb++;
+    }
+    else
+    {
+        frag_bit_set( frag.known, pivot );
+        frag.known_nb++;
+    }
+    frag_staging_write( frag_data_offset( pivot ), frag.data, frag.frag_size );
+    frag_row_eliminate( pivot, slot );
+
+    if( frag.known_nb == frag.nb_frag )
+    {
+        frag.is_done = true;
+        return FRAG_DECODER_STATUS_DONE;
+    }
+    return FRAG_DECODER_STATUS_ONGOING;
+}
+
+frag_decoder_status_t frag_decoder_downlink( const uint8_t* payload, uint8_t length )
+{
+    frag_decoder_status_t status = FRAG_DECODER_STATUS_DROPPED;
+    uint8_t               i      = 0;
+
+    while( i < length )
+    {
+        const uint8_t* cmd = &payload[i];
+        switch( cmd[0] )
+        {
+        case FRAG_CMD_PACKAGE_VERSION:
+            i += 1;
+            break;
+        case FRAG_CMD_SESSION_STATUS:
+        case FRAG_CMD_SESSION_DELETE:
+            if( ( ( length - i ) >= 2 ) && ( cmd[0] == FRAG_CMD_SESSION_DELETE ) && ( ( cmd[1] & 0x03 ) == 0 ) )
+            {
+                frag_decoder_session_delete( );
+            }
+            i += 2;
+            break;
+        case FRAG_CMD_SESSION_SETUP:
+            if( ( length - i ) < FRAG_SESSION_SETUP_SIZE )
+            {
+                return status;
+            }
+            // session index 0 and fragmentation matrix 0 only, the multicast groups and the descriptor are not used
+            if( ( ( ( cmd[1] >> 4 ) & 0x03 ) != 0 ) || ( ( ( cmd[5] >> 3 ) & 0x07 ) != 0 ) ||
+                ( frag_decoder_session_setup( cmd[2] | ( cmd[3] << 8 ), cmd[4], cmd[6] ) == false ) )
+            {
+                BSP_DBG_TRACE_WARNING( "fragmentation session setup rejected\n" );
+            }
+            i += FRAG_SESSION_SETUP_SIZE;
+            break;
+        case FRAG_CMD_DATA_FRAGMENT: {
+            // the fragment takes the rest of the downlink
+            if( ( length - i ) <= FRAG_DATA_FRAGMENT_HEADER_SIZE )
+            {
+                return status;
+            }
+            uint16_t index_and_n = cmd[1] | ( cmd[2] << 8 );
+            if( ( index_and_n >> 14 ) == 0 )
+            {
+                status = frag_decoder_fragment_process( index_and_n & 0x3FFF, &cmd[FRAG_DATA_FRAGMENT_HEADER_SIZE],
+                                                        length - i - FRAG_DATA_FRAGMENT_HEADER_SIZE );
+            }
+            return status;
+        }
+        default:
+            return status;
+        }
+    }
+    return status;
+}
+
+void frag_decoder_progress_get( frag_decoder_progress_t* progress )
+{
+    progress->nb_frag     = ( frag.is_active == true ) ? frag.nb_frag : 0;
+    progress->frag_size   = frag.frag_size;
+    progress->file_size   = ( frag.is_active == true ) ? ( frag.rows_offset - frag.padding ) : 0;
+    progress->received_nb = frag.received_nb;
+    progress->known_nb    = frag.known_nb;
+    progress->row_nb      = frag.row_nb;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,171 @@
+/*!
+ * \file      frag_decoder.h
+ *
+ * \brief     Fragmented data block receiver: reassembles a file sent as coded fragments, typically over multicast
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __FRAG_DECODER_H__
+#define __FRAG_DECODER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Port of the fragmentation package messages
+ */
+#define FRAG_DECODER_PORT 201
+
+/*!
+ * Maximum number of uncoded fragments of a file
+ */
+#define FRAG_DECODER_NB_FRAG_MAX 1024
+
+/*!
+ * Maximum fragment size, the largest downlink payload less the data fragment header
+ */
+#define FRAG_DECODER_FRAG_SIZE_MAX 232
+
+/*!
+ * Parity rows kept in the staging area, coded fragments still waiting for others to be solved
+ */
+#define FRAG_DECODER_ROW_NB_MAX 64
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Result of a fragment
+ */
+typedef enum frag_decoder_status_e
+{
+    FRAG_DECODER_STATUS_ONGOING     = 0x00,  //!< fragment used or redundant, fragments are still missing
+    FRAG_DECODER_STATUS_DONE        = 0x01,  //!< the last missing fragment was solved, the file is complete
+    FRAG_DECODER_STATUS_DROPPED     = 0x02,  //!< no session, session complete, or index or size not valid
+    FRAG_DECODER_STATUS_MATRIX_FULL = 0x03,  //!< coded fragment not kept, all the parity rows are used
+} frag_decoder_status_t;
+
+/*!
+ * Progress of the session
+ */
+typedef struct frag_decoder_progress_s
+{
+    uint16_t nb_frag;      //!< uncoded fragments of the file, 0 without session
+    uint8_t  frag_size;    //!< fragment size
+    uint32_t file_size;    //!< file size, the padding of the last fragment removed
+    uint16_t received_nb;  //!< fragments received, coded and redundant ones included
+    uint16_t known_nb;     //!< fragments received uncoded or solved, written in the staging area
+    uint8_t  row_nb;       //!< parity rows kept for the fragments not solved yet
+} frag_decoder_progress_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief   Clear the fragmentation session
+ *
+ * \retval          void
+ */
+void frag_decoder_init( void );
+
+/*!
+ * \brief   Start a fragmentation session, the previous one is lost
+ * \remark  The file is written in the staging area from its start (bsp_nvm_staging_write), followed by the
+ *          parity rows, no session can start when the modem is built without staging area (FW_STAGING=1)
+ *
+ * \param  [in]     nb_frag                 - uncoded fragments, 1 to FRAG_DECODER_NB_FRAG_MAX
+ * \param  [in]     frag_size               - fragment size, 1 to FRAG_DECODER_FRAG_SIZE_MAX
+ * \param  [in]     padding                 - bytes added at the end of the last fragment
+ * \retval          bool                    - false if the parameters are not valid or the file and its parity
+ *                                            rows don't fit in the staging area
+ */
+bool frag_decoder_session_setup( uint16_t nb_frag, uint8_t frag_size, uint8_t padding );
+
+/*!
+ * \brief   Stop the fragmentation session
+ *
+ * \retval          void
+ */
+void frag_decoder_session_delete( void );
+
+/*!
+ * \brief   Add a fragment to the file
+ * \remark  The fragment is reduced over the fragments already known and the parity rows kept, its parity row is
+ *          then removed from the other rows: the fragments are solved as soon as they can be, no decoding is left
+ *          for the end of the session
+ *
+ * \param  [in]     index                   - fragment number from 1, above nb_frag for the coded fragments
+ * \param  [in]     data*                   - fragment data
+ * \param  [in]     size                    - fragment size, must be the session one
+ * \retval          frag_decoder_status_t
+ */
+frag_decoder_status_t frag_decoder_fragment_process( uint16_t index, const uint8_t* data, uint8_t size );
+
+/*!
+ * \brief   Handle a downlink of the fragmentation package received on FRAG_DECODER_PORT
+ * \remark  Handles the session setup, session delete and data fragment messages of fragmentation session 0, the
+ *          requests needing an answer are ignored
+ *
+ * \param  [in]     payload*                - downlink payload
+ * \param  [in]     length                  - downlink payload length
+ * \retval          frag_decoder_status_t   - status of the data fragment, FRAG_DECODER_STATUS_DROPPED without one
+ */
+frag_decoder_status_t frag_decoder_downlink( const uint8_t* payload, uint8_t length );
+
+/*!
+ * \brief   Get the progress of the session
+ *
+ * \param  [out]    progress*               - session progress
+ * \retval          void
+ */
+void frag_decoder_progress_get( frag_decoder_progress_t* progress );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __FRAG_DECODER_H__
+
+/* --- EOF ------------------------------------------------------------------ */
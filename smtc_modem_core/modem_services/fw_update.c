@@ -0,0 +1,198 @@
+/*!
+ * \file      fw_update.c
+ *
+ * \brief     Host firmware update implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memcpy
+
+#include "smtc_bsp.h"
+#include "fw_update.h"
+#include "frag_decoder.h"
+#include "modem_utilities.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define FW_UPDATE_START_SIZE 5  // control request and image size
+#define FW_UPDATE_END_SIZE 33   // control request and image hash
+#define FW_UPDATE_HASH_SIZE 32
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+// A block is received from the host while the previous one is programmed: the command buffer holds the block being
+// received, the pending buffer the block waiting for the flash
+static struct
+{
+    bool         is_started;
+    bool         is_pending;                         // block waiting to be programmed
+    bool         is_flash_error;
+    uint32_t     size;                               // image size
+    uint16_t     next_block;                         // next block expected from the host
+    uint16_t     pending_block;
+    uint8_t      pending_size;
+    uint32_t     pending[FW_UPDATE_BLOCK_SIZE / 4];  // word aligned for the half page programming
+    sha256_ctx_t hash_ctx;                           // image read back from the staging area
+} fw_update;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static fw_update_status_t fw_update_start( uint32_t size )
+{
+    if( ( size == 0 ) || ( size > BSP_NVM_STAGING_SIZE ) )
+    {
+        return FW_UPDATE_STATUS_BAD_BLOCK;
+    }
+    frag_decoder_session_delete( );
+    fw_update_init( );
+    fw_update.is_started = true;
+    fw_update.size       = size;
+    sha256_init( &fw_update.hash_ctx );
+    return FW_UPDATE_STATUS_OK;
+}
+
+static fw_update_status_t fw_update_end( const uint8_t* hash )
+{
+    uint32_t computed[FW_UPDATE_HASH_SIZE / 4];
+
+    fw_update_process( );
+    if( fw_update.is_flash_error == true )
+    {
+        return FW_UPDATE_STATUS_FLASH_ERROR;
+    }
+    if( ( ( uint32_t ) fw_update.next_block * FW_UPDATE_BLOCK_SIZE ) < fw_update.size )
+    {
+        return FW_UPDATE_STATUS_BAD_BLOCK;
+    }
+    sha256_final( &fw_update.hash_ctx, computed );
+    fw_update.is_started = false;
+    return ( memcmp( computed, hash, FW_UPDATE_HASH_SIZE ) == 0 ) ? FW_UPDATE_STATUS_OK : FW_UPDATE_STATUS_BAD_HASH;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void fw_update_init( void )
+{
+    memset( &fw_update, 0, sizeof( fw_update ) );
+}
+
+fw_update_status_t fw_update_block( uint16_t index, const uint8_t* data, uint8_t size, uint32_t block_crc )
+{
+    if( crc( ( uint8_t* ) data, size ) != block_crc )
+    {
+        return FW_UPDATE_STATUS_BAD_CRC;
+    }
+    if( index == FW_UPDATE_BLOCK_CONTROL )
+    {
+        if( ( size == FW_UPDATE_START_SIZE ) && ( data[0] == FW_UPDATE_CONTROL_START ) )
+        {
+            return fw_update_start( ( ( uint32_t ) data[1] << 24 ) | ( ( uint32_t ) data[2] << 16 ) |
+                                    ( ( uint32_t ) data[3] << 8 ) | data[4] );
+        }
+        if( ( size == FW_UPDATE_END_SIZE ) && ( data[0] == FW_UPDATE_CONTROL_END ) )
+        {
+            return ( fw_update.is_started == true ) ? fw_update_end( &data[1] ) : FW_UPDATE_STATUS_NOT_STARTED;
+        }
+        return FW_UPDATE_STATUS_BAD_BLOCK;
+    }
+    if( fw_update.is_started == false )
+    {
+        return FW_UPDATE_STATUS_NOT_STARTED;
+    }
+    if( ( ( uint32_t ) index + 1 ) == fw_update.next_block )
+    {
+        // answer lost, the host sends the last block again
+        return FW_UPDATE_STATUS_OK;
+    }
+
+    uint32_t offset = ( uint32_t ) index * FW_UPDATE_BLOCK_SIZE;
+    if( ( index != fw_update.next_block ) || ( offset >= fw_update.size ) ||
+        ( size != ( ( ( fw_update.size - offset ) < FW_UPDATE_BLOCK_SIZE ) ? ( fw_update.size - offset )
+                                                                             : FW_UPDATE_BLOCK_SIZE ) ) )
+    {
+        return FW_UPDATE_STATUS_BAD_BLOCK;
+    }
+
+    // the host was quicker than the engine, the previous block is programmed now
+    fw_update_process( );
+    if( fw_update.is_flash_error == true )
+    {
+        return FW_UPDATE_STATUS_FLASH_ERROR;
+    }
+    memcpy( fw_update.pending, data, size );
+    fw_update.pending_block = index;
+    fw_update.pending_size  = size;
+    fw_update.is_pending    = true;
+    fw_update.next_block++;
+    return FW_UPDATE_STATUS_OK;
+}
+
+uint16_t fw_update_next_block_get( void )
+{
+    return fw_update.next_block;
+}
+
+void fw_update_process( void )
+{
+    if( fw_update.is_pending == false )
+    {
+        return;
+    }
+    fw_update.is_pending = false;
+
+    uint32_t offset = ( uint32_t ) fw_update.pending_block * FW_UPDATE_BLOCK_SIZE;
+    if( bsp_nvm_staging_write( offset, ( const uint8_t* ) fw_update.pending, fw_update.pending_size ) != 0 )
+    {
+        BSP_DBG_TRACE_ERROR( "fw update block %d not programmed\n", fw_update.pending_block );
+        fw_update.is_flash_error = true;
+        fw_update.is_started     = false;
+        return;
+    }
+    // hashed as read back, a programming fault shows in the image hash
+    bsp_nvm_staging_read( offset, ( uint8_t* ) fw_update.pending, fw_update.pending_size );
+    sha256_update( &fw_update.hash_ctx, ( const uint8_t* ) fw_update.pending, fw_update.pending_size );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,134 @@
+/*!
+ * \file      fw_update.h
+ *
+ * \brief     Host firmware update: an image streamed by blocks over the host link is written in the staging area
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __FW_UPDATE_H__
+#define __FW_UPDATE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Image block size, a flash page of the staging area
+ */
+#define FW_UPDATE_BLOCK_SIZE 128
+
+/*!
+ * Index of the control blocks, starting or ending the update
+ */
+#define FW_UPDATE_BLOCK_CONTROL 0xFFFF
+
+/*!
+ * Control block requests, first byte of the block data
+ */
+#define FW_UPDATE_CONTROL_START 0x00  //!< followed by the image size, 4 bytes big endian
+#define FW_UPDATE_CONTROL_END 0x01    //!< followed by the SHA-256 of the image, 32 bytes
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Result of a block
+ */
+typedef enum fw_update_status_e
+{
+    FW_UPDATE_STATUS_OK          = 0x00,  //!< block accepted, update started or image verified
+    FW_UPDATE_STATUS_NOT_STARTED = 0x01,  //!< no update started
+    FW_UPDATE_STATUS_BAD_CRC     = 0x02,  //!< block data corrupted, to be sent again
+    FW_UPDATE_STATUS_BAD_BLOCK   = 0x03,  //!< block out of sequence, of the wrong size, or request not valid
+    FW_UPDATE_STATUS_FLASH_ERROR = 0x04,  //!< the staging area could not be programmed, the update is stopped
+    FW_UPDATE_STATUS_BAD_HASH    = 0x05,  //!< the image read back from the staging area doesn't match its hash
+} fw_update_status_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief   Stop the update
+ *
+ * \retval          void
+ */
+void fw_update_init( void );
+
+/*!
+ * \brief   Handle a block of the update
+ * \remark  The image blocks are sent in order from 0, all of FW_UPDATE_BLOCK_SIZE bytes but the last one. A block
+ *          is only copied here, it is programmed in the staging area by fw_update_process once the host is answered,
+ *          while the next block is received. The last block accepted can be sent again when its answer was lost.
+ *          Starting an update stops the fragmentation session, both use the staging area.
+ *
+ * \param  [in]     index                   - block index, FW_UPDATE_BLOCK_CONTROL for a control block
+ * \param  [in]     data*                   - block data
+ * \param  [in]     size                    - block size
+ * \param  [in]     block_crc               - CRC-32 of the block data
+ * \retval          fw_update_status_t
+ */
+fw_update_status_t fw_update_block( uint16_t index, const uint8_t* data, uint8_t size, uint32_t block_crc );
+
+/*!
+ * \brief   Get the index of the next block expected from the host
+ *
+ * \retval          uint16_t                - block index, 0 without update
+ */
+uint16_t fw_update_next_block_get( void );
+
+/*!
+ * \brief   Program the block received last in the staging area
+ * \remark  Called from the modem engine, the block is read back to be hashed
+ *
+ * \retval          void
+ */
+void fw_update_process( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __FW_UPDATE_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,139 @@
+/*!
+ * \file      modem_pool.c
+ *
+ * \brief     Fixed-block pool of the frame, event and stream buffers
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "smtc_bsp.h"
+#include "modem_pool.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+static uint8_t pool[BSP_MODEM_POOL_BLOCK_NB][MODEM_POOL_BLOCK_SIZE];
+
+static struct
+{
+    uint8_t            free_list[BSP_MODEM_POOL_BLOCK_NB];  // stack of the free block indexes
+    uint8_t            free_nb;                             // number of indexes in free_list
+    bool               is_used[BSP_MODEM_POOL_BLOCK_NB];    // to ignore a block freed twice
+    modem_pool_stats_t stats;
+} state;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void modem_pool_init( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    for( uint8_t i = 0; i < BSP_MODEM_POOL_BLOCK_NB; i++ )
+    {
+        state.free_list[i] = BSP_MODEM_POOL_BLOCK_NB - 1 - i;  // lowest blocks first
+        state.is_used[i]   = false;
+    }
+    state.free_nb             = BSP_MODEM_POOL_BLOCK_NB;
+    state.stats.block_nb      = BSP_MODEM_POOL_BLOCK_NB;
+    state.stats.used          = 0;
+    state.stats.used_max      = 0;
+    state.stats.alloc_fail_nb = 0;
+    CRITICAL_SECTION_END( );
+}
+
+uint8_t* modem_pool_alloc( void )
+{
+    uint8_t* block = NULL;
+
+    CRITICAL_SECTION_BEGIN( );
+    if( state.free_nb > 0 )
+    {
+        uint8_t index = state.free_list[--state.free_nb];
+
+        state.is_used[index] = true;
+        block                = pool[index];
+        state.stats.used++;
+        if( state.stats.used > state.stats.used_max )
+        {
+            state.stats.used_max = state.stats.used;
+        }
+    }
+    else if( state.stats.alloc_fail_nb < UINT16_MAX )
+    {
+        state.stats.alloc_fail_nb++;
+    }
+    CRITICAL_SECTION_END( );
+
+    if( block == NULL )
+    {
+        BSP_DBG_TRACE_WARNING( "%s pool exhausted\n", __func__ );
+    }
+    return block;
+}
+
+void modem_pool_free( uint8_t* block )
+{
+    if( ( block < pool[0] ) || ( block >= pool[BSP_MODEM_POOL_BLOCK_NB] ) ||
+        ( ( ( block - pool[0] ) % MODEM_POOL_BLOCK_SIZE ) != 0 ) )
+    {
+        return;
+    }
+    uint8_t index = ( block - pool[0] ) / MODEM_POOL_BLOCK_SIZE;
+
+    CRITICAL_SECTION_BEGIN( );
+    if( state.is_used[index] == true )
+    {
+        state.is_used[index]             = false;
+        state.free_list[state.free_nb++] = index;
+        state.stats.used--;
+    }
+    CRITICAL_SECTION_END( );
+}
+
+void modem_pool_get_stats( modem_pool_stats_t* stats )
+{
+    CRITICAL_SECTION_BEGIN( );
+    *stats = state.stats;
+    CRITICAL_SECTION_END( );
+}
+
+uint32_t modem_pool_get_ram_size( void )
+{
+    return sizeof( pool ) + sizeof( state );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,127 @@
+/*!
+ * \file      modem_pool.h
+ *
+ * \brief     Fixed-block pool of the frame, event and stream buffers
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __MODEM_POOL_H__
+#define __MODEM_POOL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Pool block size, a LoRa frame of any length fits in a block
+ */
+#define MODEM_POOL_BLOCK_SIZE 255
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Pool usage statistics
+ */
+typedef struct modem_pool_stats_s
+{
+    uint8_t  block_nb;       // number of blocks in the pool
+    uint8_t  used;           // number of blocks allocated
+    uint8_t  used_max;       // highest number of blocks allocated at once
+    uint16_t alloc_fail_nb;  // number of allocations refused, the pool being exhausted
+} modem_pool_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief   Give every block back to the pool and clear the statistics
+ * \remark  The pool holds BSP_MODEM_POOL_BLOCK_NB blocks of MODEM_POOL_BLOCK_SIZE bytes, called once before any
+ *          service allocates a block
+ *
+ * \retval          void
+ */
+void modem_pool_init( void );
+
+/*!
+ * \brief   Take a block from the pool
+ * \remark  Constant time, may be called from an interrupt
+ *
+ * \retval          uint8_t*                - MODEM_POOL_BLOCK_SIZE bytes block, NULL if the pool is exhausted
+ */
+uint8_t* modem_pool_alloc( void );
+
+/*!
+ * \brief   Give a block back to the pool
+ * \remark  Constant time, may be called from an interrupt. NULL, a pointer outside of the pool and a block already
+ *          free are ignored.
+ *
+ * \param  [in]     block*                  - block from modem_pool_alloc
+ * \retval          void
+ */
+void modem_pool_free( uint8_t* block );
+
+/*!
+ * \brief   Get the pool usage statistics
+ *
+ * \param  [out]    stats*                  - pool usage statistics
+ * \retval          void
+ */
+void modem_pool_get_stats( modem_pool_stats_t* stats );
+
+/*!
+ * \brief   Get the RAM used by the pool
+ *
+ * \retval          uint32_t                - size in bytes
+ */
+uint32_t modem_pool_get_ram_size( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __MODEM_POOL_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -30,6 +30,8 @@
  */
 
 #include "modem_utilities.h"
+#include "lr1mac_utilities.h"
+#include "smtc_bsp_mcu.h"
 
 #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
 #define ENDIAN_n2b32( x ) __builtin_bswap32( x )
@@ -114,64 +116,221 @@ static void sha256_do( uint32_t* state, const uint8_t* block )
 #undef SIG0
 #undef SIG1
 
+void sha256_init( sha256_ctx_t* ctx )
+{
+    static const uint32_t init_state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    memcpy( ctx->state, init_state, sizeof( init_state ) );
+    ctx->len = 0;
+}
+
+void sha256_update( sha256_ctx_t* ctx, const uint8_t* msg, uint32_t len )
+{
+    uint32_t used = ctx->len & 63;
+    ctx->len += len;
+
+    // complete the pending partial block first
+    if( used > 0 )
+    {
+        uint32_t n = 64 - used;
+        if( n > len )
+        {
+            n = len;
+        }
+        memcpy( &ctx->block.bytes[used], msg, n );
+        msg += n;
+        len -= n;
+        if( ( used + n ) < 64 )
+        {
+            return;
+        }
+        sha256_do( ctx->state, ctx->block.bytes );
+    }
+    bsp_mcu_clock_boost_request( );
+    while( len >= 64 )
+    {
+        sha256_do( ctx->state, msg );
+        msg += 64;
+        len -= 64;
+    }
+    bsp_mcu_clock_boost_release( );
+    memcpy( ctx->block.bytes, msg, len );
+}
+
+void sha256_final( sha256_ctx_t* ctx, uint32_t* hash )
+{
+    uint32_t used = ctx->len & 63;
+
+    memset( &ctx->block.bytes[used], 0, 64 - used );
+    ctx->block.bytes[used] = 0x80;
+    if( used >= 56 )
+    {
+        sha256_do( ctx->state, ctx->block.bytes );
+        memset( ctx->block.words, 0, sizeof( ctx->block ) );
+    }
+    ctx->block.words[15] = ENDIAN_n2b32( ctx->len << 3 );
+    sha256_do( ctx->state, ctx->block.bytes );
+    for( int i = 0; i < 8; i++ )
+    {
+        hash[i] = ENDIAN_n2b32( ctx->state[i] );
+    }
+}
+
 void sha256( uint32_t* hash, const uint8_t* msg, uint32_t len )
 {
-    uint32_t state[8] = {
-        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
-    };
+    sha256_ctx_t ctx;
+
+    sha256_init( &ctx );
+    sha256_update( &ctx, msg, len );
+    sha256_final( &ctx, hash );
+}
+
+uint32_t crc( uint8_t* buf, int len )
+{
+    return ~lr1mac_utilities_crc32( 0xFFFFFFFF, buf, len );
+}
 
-    uint32_t bitlen = len << 3;
-    while( 1 )
+// ------------------------------------------------
+// LZSS compression
+
+#define LZ_WINDOW_SIZE 256  // distance coded on 8 bits
+#define LZ_MATCH_MIN 2      // shorter matches cost more than their literals
+#define LZ_MATCH_MAX 17     // length coded on 4 bits
+#define LZ_BACKLOG_SIZE 32  // output waiting for the input it replaces to be consumed
+
+typedef struct lz_ctx_s
+{
+    uint8_t* buffer;                    // data compressed in place
+    bool     is_dry_run;                // the output is only counted, the buffer is left untouched
+    bool     is_overflow;               // the output got too far ahead of the input
+    uint32_t in;                        // next input byte to consume
+    uint32_t out;                       // number of output bytes
+    uint32_t flushed;                   // number of output bytes written in the buffer
+    uint32_t bits;                      // pending output bits
+    uint8_t  nb_bits;                   // number of pending output bits
+    uint8_t  window[LZ_WINDOW_SIZE];    // last consumed input bytes, their place in the buffer may be overwritten
+    uint8_t  backlog[LZ_BACKLOG_SIZE];  // output bytes not yet written in the buffer
+} lz_ctx_t;
+
+static uint8_t lz_byte_get( const lz_ctx_t* ctx, uint32_t pos )
+{
+    return ( pos < ctx->in ) ? ctx->window[pos % LZ_WINDOW_SIZE] : ctx->buffer[pos];
+}
+
+static void lz_flush( lz_ctx_t* ctx )
+{
+    // only the input already consumed is overwritten
+    while( ( ctx->flushed < ctx->out ) && ( ctx->flushed < ctx->in ) )
     {
-        if( len < 64 )
+        if( ctx->is_dry_run == false )
         {
-            union
-            {
-                uint8_t  bytes[64];
-                uint32_t words[16];
-            } tmp;
-            memset( tmp.words, 0, sizeof( tmp ) );
-            memcpy( tmp.bytes, msg, len );
-            tmp.bytes[len] = 0x80;
-            if( len < 56 )
+            ctx->buffer[ctx->flushed] = ctx->backlog[ctx->flushed % LZ_BACKLOG_SIZE];
+        }
+        ctx->flushed++;
+    }
+}
+
+static void lz_bits_put( lz_ctx_t* ctx, uint32_t value, uint8_t nb_bits )
+{
+    ctx->bits = ( ctx->bits << nb_bits ) | value;
+    ctx->nb_bits += nb_bits;
+    while( ctx->nb_bits >= 8 )
+    {
+        ctx->nb_bits -= 8;
+        lz_flush( ctx );
+        if( ( ctx->out - ctx->flushed ) >= LZ_BACKLOG_SIZE )
+        {
+            ctx->is_overflow = true;
+        }
+        ctx->backlog[ctx->out % LZ_BACKLOG_SIZE] = ( uint8_t )( ctx->bits >> ctx->nb_bits );
+        ctx->out++;
+    }
+}
+
+static void lz_consume( lz_ctx_t* ctx, uint32_t length )
+{
+    for( ; length > 0; length-- )
+    {
+        ctx->window[ctx->in % LZ_WINDOW_SIZE] = ctx->buffer[ctx->in];
+        ctx->in++;
+    }
+}
+
+static uint32_t lz_run( lz_ctx_t* ctx, uint32_t size )
+{
+    ctx->is_overflow = false;
+    ctx->in          = 0;
+    ctx->out         = 0;
+    ctx->flushed     = 0;
+    ctx->bits        = 0;
+    ctx->nb_bits     = 0;
+
+    lz_bits_put( ctx, size & 0xFF, 8 );
+    lz_bits_put( ctx, ( size >> 8 ) & 0xFF, 8 );
+
+    while( ( ctx->in < size ) && ( ctx->is_overflow == false ) )
+    {
+        uint32_t max_length    = ( ( size - ctx->in ) < LZ_MATCH_MAX ) ? ( size - ctx->in ) : LZ_MATCH_MAX;
+        uint32_t max_distance  = ( ctx->in < LZ_WINDOW_SIZE ) ? ctx->in : LZ_WINDOW_SIZE;
+        uint32_t best_length   = 0;
+        uint32_t best_distance = 0;
+
+        for( uint32_t distance = 1; ( distance <= max_distance ) && ( best_length < max_length ); distance++ )
+        {
+            uint32_t length = 0;
+            // the match may overlap the bytes it encodes, they are still in the buffer
+            while( ( length < max_length ) &&
+                   ( lz_byte_get( ctx, ctx->in - distance + length ) == ctx->buffer[ctx->in + length] ) )
             {
-            last:
-                tmp.words[15] = ENDIAN_n2b32( bitlen );
-                sha256_do( state, tmp.bytes );
-                int i;
-                for( i = 0; i < 8; i++ )
-                {
-                    hash[i] = ENDIAN_n2b32( state[i] );
-                }
-                break;
+                length++;
             }
-            else
+            if( length > best_length )
             {
-                sha256_do( state, tmp.bytes );
-                memset( tmp.words, 0, sizeof( tmp ) );
-                goto last;
+                best_length   = length;
+                best_distance = distance;
             }
         }
+
+        if( best_length >= LZ_MATCH_MIN )
+        {
+            lz_bits_put( ctx, ( ( best_distance - 1 ) << 4 ) | ( best_length - LZ_MATCH_MIN ), 13 );
+            lz_consume( ctx, best_length );
+        }
         else
         {
-            sha256_do( state, msg );
-            msg += 64;
-            len -= 64;
+            lz_bits_put( ctx, 0x100 | ctx->buffer[ctx->in], 9 );
+            lz_consume( ctx, 1 );
         }
     }
+    if( ctx->nb_bits > 0 )
+    {
+        lz_bits_put( ctx, 0, 8 - ctx->nb_bits );
+    }
+    lz_flush( ctx );
+    return ctx->out;
 }
 
-uint32_t crc( uint8_t* buf, int len )
+int32_t lz_compress_in_place( uint8_t* buffer, uint32_t size )
 {
-    uint32_t crc = 0xFFFFFFFF;
-    while( len-- > 0 )
+    lz_ctx_t ctx;
+    int32_t  compressed_size = -1;
+
+    if( ( size == 0 ) || ( size > 0xFFFF ) )
     {
-        crc = crc ^ *buf++;
-        for( int i = 0; i < 8; i++ )
-        {
-            uint32_t mask = -( crc & 1 );
-            crc           = ( crc >> 1 ) ^ ( 0xEDB88320 & mask );
-        }
+        return -1;
     }
-    return ~crc;
+
+    bsp_mcu_clock_boost_request( );
+    ctx.buffer = buffer;
+
+    // the same output is produced twice, it is only written once known to be smaller and to fit the backlog
+    ctx.is_dry_run = true;
+    if( ( lz_run( &ctx, size ) < size ) && ( ctx.is_overflow == false ) )
+    {
+        ctx.is_dry_run  = false;
+        compressed_size = lz_run( &ctx, size );
+    }
+    bsp_mcu_clock_boost_release( );
+
+    return compressed_size;
 }
@@ -45,6 +45,26 @@ extern "C" {
 
 #include "lr1mac_defs.h"
 
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \typedef sha256_ctx_t
+ * \brief   Running state of an incremental SHA256
+ */
+typedef struct sha256_ctx_s
+{
+    uint32_t state[8];  //!< intermediate hash value
+    union
+    {
+        uint8_t  bytes[64];
+        uint32_t words[16];
+    } block;       //!< pending partial block
+    uint32_t len;  //!< number of bytes hashed so far
+} sha256_ctx_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
@@ -61,6 +81,36 @@ extern "C" {
  */
 void sha256( uint32_t* hash, const uint8_t* msg, uint32_t len );
 
+/*!
+ * \brief   Start an incremental SHA256
+ * \remark  sha256_init, sha256_update and sha256_final give the same hash as sha256 over the concatenated data
+ *
+ * \param  [out]    ctx*            - hash context
+ * \retval [out]    None
+ */
+void sha256_init( sha256_ctx_t* ctx );
+
+/*!
+ * \brief   Add data to an incremental SHA256
+ * \remark
+ *
+ * \param  [in]     ctx*            - hash context
+ * \param  [in]     msg*            - input buffer
+ * \param  [in]     len             - input buffer length
+ * \retval [out]    None
+ */
+void sha256_update( sha256_ctx_t* ctx, const uint8_t* msg, uint32_t len );
+
+/*!
+ * \brief   Terminate an incremental SHA256
+ * \remark
+ *
+ * \param  [in]     ctx*            - hash context
+ * \param  [out]    hash*           - Contains the computed hash
+ * \retval [out]    None
+ */
+void sha256_final( sha256_ctx_t* ctx, uint32_t* hash );
+
 /*!
  * \brief   Compute crc
  * \remark
@@ -71,6 +121,19 @@ void sha256( uint32_t* hash, const uint8_t* msg, uint32_t len );
  */
 uint32_t crc( uint8_t* buf, int len );
 
+/*!
+ * \brief   Compress data in place with LZSS
+ * \remark  The output starts with the size of the data on 2 bytes, little endian, followed by MSB first tokens: a
+ *          literal is a 1 bit and the byte, a match is a 0 bit, its distance minus 1 on 8 bits and its length minus 2
+ *          on 4 bits, it copies the bytes seen that far back. The last byte is padded with 0 bits.
+ *          Only a 256 byte window is kept in RAM. The buffer is left untouched when the data doesn't shrink.
+ *
+ * \param  [in]     buffer*         - data, replaced by the compressed data
+ * \param  [in]     size            - data size, up to 65535 bytes
+ * \retval [out]    int32_t         - compressed size, -1 when the data is not compressed
+ */
+int32_t lz_compress_in_place( uint8_t* buffer, uint32_t size );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,218 @@
+/*!
+ * \file      outbox.c
+ *
+ * \brief     Store-and-forward outbox of the application uplinks
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memcpy
+
+#include "smtc_bsp.h"
+#include "outbox.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+enum
+{
+    RINGADDR = BSP_MODEM_OUTBOX_ADDR_OFFSET + 4,  // records ring, behind the ring positions word
+    RINGSZ   = BSP_MODEM_OUTBOX_SIZE - 4,         // records ring size
+};
+
+/*!
+ * Ring positions, written as a single word once the records they cover are written
+ */
+typedef struct outbox_positions_s
+{
+    uint16_t read;   // offset of the oldest record
+    uint16_t write;  // offset of the next record
+} outbox_positions_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+static struct
+{
+    outbox_positions_t positions;  // copy of the positions in nvm
+    uint16_t           count;      // number of records
+} state;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint16_t ring_used( void )
+{
+    return ( state.positions.write + RINGSZ - state.positions.read ) % RINGSZ;
+}
+
+static void ring_read( uint16_t offset, uint8_t* dst, uint16_t len )
+{
+    uint16_t first = ( len < ( RINGSZ - offset ) ) ? len : ( RINGSZ - offset );
+
+    bsp_nvm_context_restore( RINGADDR + offset, dst, first );
+    if( first < len )
+    {
+        bsp_nvm_context_restore( RINGADDR, &dst[first], len - first );
+    }
+}
+
+static void ring_write( uint16_t offset, const uint8_t* src, uint16_t len )
+{
+    uint16_t first = ( len < ( RINGSZ - offset ) ) ? len : ( RINGSZ - offset );
+
+    bsp_nvm_context_store( RINGADDR + offset, src, first );
+    if( first < len )
+    {
+        bsp_nvm_context_store( RINGADDR, &src[first], len - first );
+    }
+}
+
+static void positions_store( void )
+{
+    bsp_nvm_context_store( BSP_MODEM_OUTBOX_ADDR_OFFSET, ( const uint8_t* ) &state.positions,
+                           sizeof( state.positions ) );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void outbox_init( void )
+{
+    uint16_t offset;
+    bool     is_valid;
+
+    bsp_nvm_context_restore( BSP_MODEM_OUTBOX_ADDR_OFFSET, ( uint8_t* ) &state.positions, sizeof( state.positions ) );
+    state.count = 0;
+    is_valid    = ( state.positions.read < RINGSZ ) && ( state.positions.write < RINGSZ );
+
+    // count the records, each one must end before the next record offset
+    offset = state.positions.read;
+    while( ( is_valid == true ) && ( offset != state.positions.write ) )
+    {
+        uint8_t  header[OUTBOX_RECORD_HEADER_SIZE];
+        uint16_t left = ( state.positions.write + RINGSZ - offset ) % RINGSZ;
+
+        ring_read( offset, header, sizeof( header ) );
+        is_valid = ( left >= sizeof( header ) ) && ( header[1] > 0 ) && ( ( sizeof( header ) + header[1] ) <= left );
+        offset   = ( offset + sizeof( header ) + header[1] ) % RINGSZ;
+        state.count++;
+    }
+    if( is_valid == false )
+    {
+        BSP_DBG_TRACE_ERROR( "Outbox invalid, emptied\n" );
+        state.positions.read  = 0;
+        state.positions.write = 0;
+        state.count           = 0;
+        positions_store( );
+    }
+    else if( state.count > 0 )
+    {
+        BSP_DBG_TRACE_PRINTF( "Outbox restored, %u records\n", state.count );
+    }
+}
+
+bool outbox_add_record( uint8_t port, const uint8_t* data, uint8_t len )
+{
+    uint8_t header[OUTBOX_RECORD_HEADER_SIZE] = { port, len };
+
+    if( ( len == 0 ) || ( ( OUTBOX_RECORD_HEADER_SIZE + len ) >= RINGSZ ) )
+    {
+        return false;
+    }
+    // one byte is left free, a full ring would look empty
+    while( ( OUTBOX_RECORD_HEADER_SIZE + len ) >= ( RINGSZ - ring_used( ) ) )
+    {  // the newest data is worth more than the oldest
+        uint8_t oldest[OUTBOX_RECORD_HEADER_SIZE];
+
+        ring_read( state.positions.read, oldest, sizeof( oldest ) );
+        state.positions.read = ( state.positions.read + sizeof( oldest ) + oldest[1] ) % RINGSZ;
+        state.count--;
+        BSP_DBG_TRACE_WARNING( "Outbox full, oldest record dropped\n" );
+    }
+    ring_write( state.positions.write, header, sizeof( header ) );
+    ring_write( ( state.positions.write + sizeof( header ) ) % RINGSZ, data, len );
+    state.positions.write = ( state.positions.write + sizeof( header ) + len ) % RINGSZ;
+    positions_store( );
+    state.count++;
+    return true;
+}
+
+uint16_t outbox_get_record_count( void )
+{
+    return state.count;
+}
+
+uint8_t outbox_gen_uplink( uint8_t* port, uint8_t* buf, uint8_t bufsz, uint16_t* count )
+{
+    uint16_t offset = state.positions.read;
+    uint8_t  length = 0;
+
+    *count = 0;
+    while( *count < state.count )
+    {
+        uint8_t header[OUTBOX_RECORD_HEADER_SIZE];
+
+        ring_read( offset, header, sizeof( header ) );
+        if( ( ( *count > 0 ) && ( header[0] != *port ) ) || ( header[1] > ( bufsz - length ) ) )
+        {
+            break;
+        }
+        *port = header[0];
+        ring_read( ( offset + sizeof( header ) ) % RINGSZ, &buf[length], header[1] );
+        length += header[1];
+        offset = ( offset + sizeof( header ) + header[1] ) % RINGSZ;
+        ( *count )++;
+    }
+    return length;
+}
+
+void outbox_commit_records( uint16_t count )
+{
+    for( ; ( count > 0 ) && ( state.count > 0 ); count-- )
+    {
+        uint8_t header[OUTBOX_RECORD_HEADER_SIZE];
+
+        ring_read( state.positions.read, header, sizeof( header ) );
+        state.positions.read = ( state.positions.read + sizeof( header ) + header[1] ) % RINGSZ;
+        state.count--;
+    }
+    positions_store( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
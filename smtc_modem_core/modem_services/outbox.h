@@ -0,0 +1,116 @@
+/*!
+ * \file      outbox.h
+ *
+ * \brief     Store-and-forward outbox of the application uplinks
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __OUTBOX_H__
+#define __OUTBOX_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Outbox record header: port (1 byte) + payload length (1 byte)
+ */
+#define OUTBOX_RECORD_HEADER_SIZE 2
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief   Restore the outbox kept in nvm
+ * \remark  The records are kept in a ring of BSP_MODEM_OUTBOX_SIZE bytes from BSP_MODEM_OUTBOX_ADDR_OFFSET, they
+ *          survive a reset. An inconsistent ring is emptied.
+ *
+ * \retval          void
+ */
+void outbox_init( void );
+
+/*!
+ * \brief   Append an application uplink to the outbox
+ * \remark  The record is written before the ring positions: a reset in between loses the record, not the ring
+ *
+ * \param  [in]     port                    - uplink port
+ * \param  [in]     data*                   - uplink payload
+ * \param  [in]     len                     - uplink payload length
+ * \retval          bool                    - false if the outbox cannot hold the record
+ */
+bool outbox_add_record( uint8_t port, const uint8_t* data, uint8_t len );
+
+/*!
+ * \brief   Get the number of records in the outbox
+ *
+ * \retval          uint16_t                - number of records
+ */
+uint16_t outbox_get_record_count( void );
+
+/*!
+ * \brief   Build an uplink from the oldest records
+ * \remark  The records are packed in order while they have the port of the oldest one and fit in bufsz, they stay
+ *          in the outbox until outbox_commit_records
+ *
+ * \param  [out]    port*                   - uplink port
+ * \param  [out]    buf*                    - uplink payload
+ * \param  [in]     bufsz                   - max payload length
+ * \param  [out]    count*                  - number of records packed
+ * \retval          uint8_t                 - payload length, 0 if the oldest record doesn't fit
+ */
+uint8_t outbox_gen_uplink( uint8_t* port, uint8_t* buf, uint8_t bufsz, uint16_t* count );
+
+/*!
+ * \brief   Remove the oldest records, once delivered
+ *
+ * \param  [in]     count                   - number of records
+ * \retval          void
+ */
+void outbox_commit_records( uint16_t count );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __OUTBOX_H__
+
+/* --- EOF ------------------------------------------------------------------ */
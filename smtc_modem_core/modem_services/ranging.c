@@ -0,0 +1,411 @@
+/*!
+ * \file      ranging.c
+ *
+ * \brief     Ranging service implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memset
+
+#include "smtc_bsp.h"
+#include "ranging.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define RANGING_PREAMBLE_SYMB 12     // preamble of the request and of the answer
+#define RANGING_ID_SIZE 4            // address carried by the request
+#define RANGING_ANSWER_DELAY_MS 4    // slave processing time between the request and the answer
+#define RANGING_EXCHANGE_GAP_MS 10   // time left to the slave to listen again before the next request
+#define RANGING_LISTEN_WINDOW_MS 60000
+#define RANGING_FILTER_MIN_CM 50     // the filter keeps the samples this close to the median whatever the spread
+#define RANGING_AVERAGE_WINDOW 8     // number of batches covered by the running average of a peer
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+static struct
+{
+    radio_planner_t*     rp;
+    ral_params_ranging_t params;
+    bool                 is_running;
+    bool                 is_done;
+    uint8_t              done_status;
+    uint32_t             timeout_ms;                     // master: time given to each answer
+    uint8_t              exchange_nb;                    // master: exchanges requested
+    uint8_t              attempt_nb;                     // master: exchanges tried, aborted ones included
+    uint8_t              sample_nb;                      // master: exchanges answered
+    int32_t              samples[RANGING_EXCHANGE_MAX];  // master: raw distances of the batch [cm]
+    uint32_t             listen_end_ms;                  // slave: end of the listening, 0 for ever
+    uint32_t             answer_nb;                      // slave: requests answered since the start
+    ranging_result_t     peers[RANGING_PEER_MAX];
+} ranging;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool ranging_params_set( const ral_params_lora_t* lora, ral_ranging_role_t role, uint32_t address )
+{
+    if( ( lora->sf < RAL_LORA_SF5 ) || ( lora->sf > RAL_LORA_SF10 ) ||
+        ( ( lora->bw != RAL_LORA_BW_400_KHZ ) && ( lora->bw != RAL_LORA_BW_800_KHZ ) &&
+          ( lora->bw != RAL_LORA_BW_1600_KHZ ) ) )
+    {
+        return false;
+    }
+
+    ranging.params.lora                  = *lora;
+    ranging.params.lora.pbl_len_in_symb  = RANGING_PREAMBLE_SYMB;
+    ranging.params.lora.pld_is_fix       = true;
+    ranging.params.lora.pld_len_in_bytes = RANGING_ID_SIZE;
+    ranging.params.lora.crc_is_on        = false;
+    ranging.params.lora.invert_iq_is_on  = false;
+    ranging.params.role                  = role;
+    ranging.params.address               = address;
+    return true;
+}
+
+static void ranging_enqueue( uint32_t start_ms, uint32_t timeout_ms )
+{
+    rp_radio_params_t radio_params     = { 0 };
+    radio_params.pkt_type              = RAL_PKT_TYPE_LORA;  // ranging runs on the LoRa modem
+    radio_params.ranging.params        = ranging.params;
+    radio_params.ranging.timeout_in_ms = timeout_ms;
+
+    // a master exchange waits for the radio, a slave window is aborted by any higher priority task
+    rp_task_t rp_task;
+    rp_task.hook_id = RANGING_HOOK_ID;
+    rp_task.type    = RP_TASK_TYPE_RANGING;
+    if( ranging.params.role == RAL_RANGING_ROLE_MASTER )
+    {
+        rp_task.state            = RP_TASK_STATE_SCHEDULE;
+        rp_task.start_time_ms    = start_ms;
+        rp_task.duration_time_ms = timeout_ms + RP_MARGIN_DELAY;
+        rp_task.preempt_policy   = RP_TASK_PREEMPT_DEFER;
+    }
+    else
+    {
+        rp_task.state            = RP_TASK_STATE_ASAP;
+        rp_task.start_time_ms    = start_ms;
+        rp_task.duration_time_ms = 0;
+        rp_task.preempt_policy   = RP_TASK_PREEMPT_ABORT;
+    }
+
+    if( rp_task_enqueue( ranging.rp, &rp_task, NULL, 0, &radio_params ) != RP_HOOK_STATUS_OK )
+    {
+        BSP_DBG_TRACE_ERROR( "ranging task not enqueued\n" );
+    }
+}
+
+static void ranging_end( ranging_status_t status )
+{
+    ranging.is_running  = false;
+    ranging.is_done     = true;
+    ranging.done_status = status;
+    bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_RADIO );
+}
+
+static void ranging_sort( int32_t* values, uint8_t nb )
+{
+    for( uint8_t i = 1; i < nb; i++ )
+    {
+        const int32_t value = values[i];
+        uint8_t       j     = i;
+        while( ( j > 0 ) && ( values[j - 1] > value ) )
+        {
+            values[j] = values[j - 1];
+            j--;
+        }
+        values[j] = value;
+    }
+}
+
+static int32_t ranging_median( const int32_t* sorted, uint8_t nb )
+{
+    return ( ( nb & 1 ) != 0 ) ? sorted[nb / 2] : ( sorted[( nb / 2 ) - 1] + sorted[nb / 2] ) / 2;
+}
+
+/*!
+ * \brief   Filter the distances of the batch and update the result of the peer
+ * \remark  The samples further from the median than three times the median absolute deviation are dropped, the
+ *          multipath answers, then the remaining ones are averaged
+ */
+static void ranging_batch_filter( void )
+{
+    int32_t sorted[RANGING_EXCHANGE_MAX];
+    int32_t deviations[RANGING_EXCHANGE_MAX];
+    uint8_t nb = ranging.sample_nb;
+
+    memcpy( sorted, ranging.samples, nb * sizeof( int32_t ) );
+    ranging_sort( sorted, nb );
+    const int32_t median = ranging_median( sorted, nb );
+
+    for( uint8_t i = 0; i < nb; i++ )
+    {
+        deviations[i] = ( sorted[i] > median ) ? ( sorted[i] - median ) : ( median - sorted[i] );
+    }
+    ranging_sort( deviations, nb );
+    int32_t limit = 3 * ranging_median( deviations, nb );
+    if( limit < RANGING_FILTER_MIN_CM )
+    {
+        limit = RANGING_FILTER_MIN_CM;
+    }
+
+    int32_t sum      = 0;
+    uint8_t valid_nb = 0;
+    for( uint8_t i = 0; i < nb; i++ )
+    {
+        if( ( ( sorted[i] > median ) ? ( sorted[i] - median ) : ( median - sorted[i] ) ) <= limit )
+        {
+            sum += sorted[i];
+            valid_nb++;
+        }
+    }
+
+    // the peer entry is reused, else a free one, else the oldest one is replaced
+    ranging_result_t* peer = &ranging.peers[0];
+    for( uint8_t i = 0; i < RANGING_PEER_MAX; i++ )
+    {
+        ranging_result_t* entry = &ranging.peers[i];
+        if( ( entry->batch_nb != 0 ) && ( entry->address == ranging.params.address ) )
+        {
+            peer = entry;
+            break;
+        }
+        if( ( peer->batch_nb != 0 ) &&
+            ( ( entry->batch_nb == 0 ) || ( ( int32_t )( entry->timestamp_ms - peer->timestamp_ms ) < 0 ) ) )
+        {
+            peer = entry;
+        }
+    }
+    if( peer->address != ranging.params.address )
+    {
+        memset( peer, 0, sizeof( ranging_result_t ) );
+        peer->address = ranging.params.address;
+    }
+
+    peer->last_cm      = sum / valid_nb;
+    peer->valid_nb     = valid_nb;
+    peer->exchange_nb  = nb;
+    peer->timestamp_ms = bsp_rtc_get_time_ms( );
+    if( peer->batch_nb < UINT16_MAX )
+    {
+        peer->batch_nb++;
+    }
+    const int32_t window = ( peer->batch_nb < RANGING_AVERAGE_WINDOW ) ? peer->batch_nb : RANGING_AVERAGE_WINDOW;
+    peer->average_cm += ( peer->last_cm - peer->average_cm ) / window;
+
+    BSP_DBG_TRACE_PRINTF( "ranging 0x%08x: %d cm, %u/%u kept, average %d cm\n", peer->address, peer->last_cm,
+                          valid_nb, nb, peer->average_cm );
+}
+
+static void ranging_master_callback( void )
+{
+    const rp_status_t status       = ranging.rp->status[RANGING_HOOK_ID];
+    const uint32_t    timestamp_ms = ranging.rp->irq_timestamp_ms[RANGING_HOOK_ID];
+
+    if( status == RP_STATUS_RANGING_DONE )
+    {
+        ranging.samples[ranging.sample_nb++] = ranging.rp->radio_params[RANGING_HOOK_ID].ranging.distance_in_cm;
+    }
+    ranging.attempt_nb++;
+
+    // the exchanges not answered or aborted are tried again, up to twice the batch size
+    if( ( ranging.sample_nb < ranging.exchange_nb ) && ( ranging.attempt_nb < ( 2 * ranging.exchange_nb ) ) )
+    {
+        uint32_t start_ms = timestamp_ms + RANGING_EXCHANGE_GAP_MS;
+        if( ( int32_t )( start_ms - ( bsp_rtc_get_time_ms( ) + RP_MARGIN_DELAY ) ) < 0 )
+        {
+            start_ms = bsp_rtc_get_time_ms( ) + RP_MARGIN_DELAY;
+        }
+        ranging_enqueue( start_ms, ranging.timeout_ms );
+        return;
+    }
+
+    if( ranging.sample_nb == 0 )
+    {
+        ranging_end( RANGING_STATUS_NO_ANSWER );
+        return;
+    }
+    ranging_batch_filter( );
+    ranging_end( RANGING_STATUS_OK );
+}
+
+static void ranging_slave_callback( void )
+{
+    if( ranging.rp->status[RANGING_HOOK_ID] == RP_STATUS_RANGING_DONE )
+    {
+        ranging.answer_nb++;
+    }
+
+    uint32_t window_ms = RANGING_LISTEN_WINDOW_MS;
+    if( ranging.listen_end_ms != 0 )
+    {
+        const int32_t remaining_ms = ( int32_t )( ranging.listen_end_ms - bsp_rtc_get_time_ms( ) );
+        if( remaining_ms <= RP_MARGIN_DELAY )
+        {
+            BSP_DBG_TRACE_PRINTF( "ranging slave: %u requests answered\n", ranging.answer_nb );
+            ranging_end( RANGING_STATUS_LISTEN_END );
+            return;
+        }
+        if( ( uint32_t ) remaining_ms < window_ms )
+        {
+            window_ms = remaining_ms;
+        }
+    }
+    ranging_enqueue( bsp_rtc_get_time_ms( ), window_ms );
+}
+
+static void ranging_callback( void* context )
+{
+    if( ranging.is_running == false )
+    {
+        return;
+    }
+    if( ranging.params.role == RAL_RANGING_ROLE_MASTER )
+    {
+        ranging_master_callback( );
+    }
+    else
+    {
+        ranging_slave_callback( );
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void ranging_init( radio_planner_t* rp )
+{
+    memset( &ranging, 0, sizeof( ranging ) );
+    ranging.rp = rp;
+    rp_hook_init( rp, RANGING_HOOK_ID, ranging_callback, &ranging );
+}
+
+bool ranging_start_master( const ral_params_lora_t* lora, uint32_t address, uint8_t exchange_nb )
+{
+    uint32_t toa_ms;
+
+    if( ( ranging.is_running == true ) || ( exchange_nb == 0 ) || ( exchange_nb > RANGING_EXCHANGE_MAX ) ||
+        ( ranging_params_set( lora, RAL_RANGING_ROLE_MASTER, address ) == false ) ||
+        ( ral_get_lora_time_on_air_in_ms( ranging.rp->ral, &ranging.params.lora, &toa_ms ) != RAL_STATUS_OK ) )
+    {
+        return false;
+    }
+
+    ranging.timeout_ms  = ( 2 * toa_ms ) + RANGING_ANSWER_DELAY_MS;
+    ranging.exchange_nb = exchange_nb;
+    ranging.attempt_nb  = 0;
+    ranging.sample_nb   = 0;
+    ranging.is_done     = false;
+    ranging.is_running  = true;
+    ranging_enqueue( bsp_rtc_get_time_ms( ) + RP_MARGIN_DELAY, ranging.timeout_ms );
+    return true;
+}
+
+bool ranging_start_slave( const ral_params_lora_t* lora, uint32_t address, uint16_t listen_s )
+{
+    if( ( ranging.is_running == true ) || ( ranging_params_set( lora, RAL_RANGING_ROLE_SLAVE, address ) == false ) )
+    {
+        return false;
+    }
+
+    const uint32_t now_ms = bsp_rtc_get_time_ms( );
+    ranging.listen_end_ms = 0;
+    if( listen_s != 0 )
+    {
+        // 0 stands for ever, the end date is moved by 1 ms when it falls on it
+        ranging.listen_end_ms = now_ms + ( ( uint32_t ) listen_s * 1000 );
+        if( ranging.listen_end_ms == 0 )
+        {
+            ranging.listen_end_ms = 1;
+        }
+    }
+    ranging.answer_nb  = 0;
+    ranging.is_done    = false;
+    ranging.is_running = true;
+    ranging_enqueue( now_ms, ( ( listen_s != 0 ) && ( listen_s < ( RANGING_LISTEN_WINDOW_MS / 1000 ) ) )
+                                 ? ( ( uint32_t ) listen_s * 1000 )
+                                 : RANGING_LISTEN_WINDOW_MS );
+    return true;
+}
+
+bool ranging_stop( void )
+{
+    if( ranging.is_running == false )
+    {
+        return false;
+    }
+    // cleared first: the abort does not call the hook back, but a radio irq may be pending
+    ranging.is_running = false;
+    rp_task_abort( ranging.rp, RANGING_HOOK_ID );
+    ranging_end( RANGING_STATUS_STOPPED );
+    return true;
+}
+
+bool ranging_is_running( void )
+{
+    return ranging.is_running;
+}
+
+bool ranging_done_get( uint8_t* status )
+{
+    if( ranging.is_done == false )
+    {
+        return false;
+    }
+    ranging.is_done = false;
+    *status         = ranging.done_status;
+    return true;
+}
+
+bool ranging_peer_result_get( uint32_t address, ranging_result_t* result )
+{
+    for( uint8_t i = 0; i < RANGING_PEER_MAX; i++ )
+    {
+        if( ( ranging.peers[i].batch_nb != 0 ) && ( ranging.peers[i].address == address ) )
+        {
+            *result = ranging.peers[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
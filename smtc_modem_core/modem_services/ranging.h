@@ -0,0 +1,172 @@
+/*!
+ * \file      ranging.h
+ *
+ * \brief     Ranging service: batches of SX1280 ranging exchanges scheduled by the radio planner
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __RANGING_H__
+#define __RANGING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "radio_planner.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Radio planner hook of the ranging tasks, below the LoRaWAN hooks so that the LoRaWAN windows take precedence
+ */
+#define RANGING_HOOK_ID 2
+
+/*!
+ * Number of peers whose results are kept, the oldest one is replaced
+ */
+#define RANGING_PEER_MAX 4
+
+/*!
+ * Maximum number of exchanges of a master batch
+ */
+#define RANGING_EXCHANGE_MAX 32
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Status reported with the ranging done event
+ */
+typedef enum ranging_status_e
+{
+    RANGING_STATUS_OK         = 0x00,  //!< master batch done, at least one exchange answered
+    RANGING_STATUS_NO_ANSWER  = 0x01,  //!< master batch done, no exchange answered
+    RANGING_STATUS_STOPPED    = 0x02,  //!< batch or listening stopped by the host
+    RANGING_STATUS_LISTEN_END = 0x03,  //!< slave listening time elapsed
+} ranging_status_t;
+
+/*!
+ * Result of the batches of one peer
+ */
+typedef struct ranging_result_s
+{
+    uint32_t address;       //!< peer address
+    int32_t  last_cm;       //!< filtered distance of the last batch
+    int32_t  average_cm;    //!< running average of the filtered distances of the last batches
+    uint8_t  valid_nb;      //!< exchanges of the last batch kept by the filter
+    uint8_t  exchange_nb;   //!< exchanges answered in the last batch
+    uint16_t batch_nb;      //!< batches done with this peer
+    uint32_t timestamp_ms;  //!< time of the last batch
+} ranging_result_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief   Attach the ranging service to the radio planner and clear the peer results
+ *
+ * \param  [in]     rp*                     - radio planner
+ * \retval          void
+ */
+void ranging_init( radio_planner_t* rp );
+
+/*!
+ * \brief   Start a batch of ranging exchanges with a slave
+ * \remark  The exchanges are run back to back as soon as the radio planner allows it. Once the batch is over the
+ *          distances are filtered, the peer result is updated and ranging_done_get reports the status.
+ *
+ * \param  [in]     lora*                   - LoRa modulation: SF5 to SF10, 400 to 1600 kHz, output power
+ * \param  [in]     address                 - slave address
+ * \param  [in]     exchange_nb             - number of exchanges, 1 to RANGING_EXCHANGE_MAX
+ * \retval          bool                    - false if a batch is running or the parameters are invalid
+ */
+bool ranging_start_master( const ral_params_lora_t* lora, uint32_t address, uint8_t exchange_nb );
+
+/*!
+ * \brief   Start answering the ranging requests sent to an address
+ *
+ * \param  [in]     lora*                   - LoRa modulation: SF5 to SF10, 400 to 1600 kHz, output power
+ * \param  [in]     address                 - own address
+ * \param  [in]     listen_s                - listening time in seconds, 0 until ranging_stop
+ * \retval          bool                    - false if a batch is running or the parameters are invalid
+ */
+bool ranging_start_slave( const ral_params_lora_t* lora, uint32_t address, uint16_t listen_s );
+
+/*!
+ * \brief   Stop the running batch or listening, the done status is RANGING_STATUS_STOPPED
+ *
+ * \retval          bool                    - false if nothing was running
+ */
+bool ranging_stop( void );
+
+/*!
+ * \brief   Check if a batch or a listening is running
+ *
+ * \retval          bool
+ */
+bool ranging_is_running( void );
+
+/*!
+ * \brief   Get and clear the end of the last batch or listening
+ * \remark  Polled by the modem supervisor to raise the ranging done event
+ *
+ * \param  [out]    status*                 - ranging_status_t of the batch
+ * \retval          bool                    - true once per batch end
+ */
+bool ranging_done_get( uint8_t* status );
+
+/*!
+ * \brief   Get the result of a peer
+ *
+ * \param  [in]     address                 - peer address
+ * \param  [out]    result*                 - last result of the peer
+ * \retval          bool                    - false if no batch was done with this peer
+ */
+bool ranging_peer_result_get( uint32_t address, ranging_result_t* result );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __RANGING_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,357 @@
+/*!
+ * \file      raw_radio.c
+ *
+ * \brief     Raw radio tasks implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memcpy
+
+#include "smtc_bsp.h"
+#include "lr1mac_defs.h"
+#include "raw_radio.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define RAW_RADIO_LORA_PREAMBLE_SYMB 12
+#define RAW_RADIO_LORA_SYNC_WORD 0x12  // private network, the LoRaWAN gateways ignore the frames
+#define RAW_RADIO_PREAMBLE_BYTES 4     // GFSK and FLRC
+#define RAW_RADIO_SYNC_WORD_SIZE 4
+#define RAW_RADIO_GFSK_CRC_SEED 0x1D0F
+#define RAW_RADIO_GFSK_CRC_POLYNOMIAL 0x1021
+#define RAW_RADIO_GFSK_WHITENING_SEED 0x01FF
+#define RAW_RADIO_FLRC_CRC_SEED 0xACA5
+
+// the extra LoRaWAN stacks take two hooks each from LR1MAC_EXTRA_STACK_HOOK_ID, class B the next one
+#if( LR1MAC_CLASS_B_HOOK_ID >= RAW_RADIO_HOOK_ID )
+#error "No radio planner hook left for the raw radio tasks, raise RP_NB_HOOKS"
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static const uint8_t raw_radio_sync_word[RAW_RADIO_SYNC_WORD_SIZE] = { 0x2D, 0xD4, 0x96, 0x5A };
+
+static struct
+{
+    radio_planner_t*     rp;
+    bool                 is_running;
+    bool                 is_done;
+    uint8_t              done_status;
+    uint8_t              tx_payload[RAW_RADIO_PAYLOAD_MAX];
+    raw_radio_rx_frame_t rx_frame;
+} raw_radio;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void raw_radio_end( raw_radio_status_t status )
+{
+    raw_radio.is_running  = false;
+    raw_radio.is_done     = true;
+    raw_radio.done_status = status;
+    bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_RADIO );
+}
+
+/*!
+ * \brief   Build the radio planner parameters of a raw task and get its time on air
+ * \remark  The modulation is checked by the time on air computation of the radio
+ *
+ * \param  [in]     params*                 - modulation
+ * \param  [in]     length                  - Tx: frame length, Rx: RAW_RADIO_PAYLOAD_MAX
+ * \param  [out]    ral_params*             - Tx or Rx parameters of the task
+ * \param  [out]    toa_ms*                 - time on air of a frame of length bytes
+ * \retval          bool                    - false if the modulation is not supported
+ */
+static bool raw_radio_params_build( const raw_radio_params_t* params, uint8_t length, rp_radio_params_t* ral_params,
+                                    uint32_t* toa_ms )
+{
+    ral_status_t status = RAL_STATUS_ERROR;
+
+    ral_params->pkt_type = params->pkt_type;
+    switch( params->pkt_type )
+    {
+    case RAL_PKT_TYPE_LORA:
+    {
+        const ral_params_lora_t lora = {
+            .freq_in_hz       = params->freq_in_hz,
+            .sf               = params->lora.sf,
+            .bw               = params->lora.bw,
+            .cr               = params->lora.cr,
+            .pbl_len_in_symb  = RAW_RADIO_LORA_PREAMBLE_SYMB,
+            .sync_word        = RAW_RADIO_LORA_SYNC_WORD,
+            .pld_is_fix       = false,
+            .pld_len_in_bytes = length,
+            .crc_is_on        = true,
+            .invert_iq_is_on  = false,
+            .pwr_in_dbm       = params->pwr_in_dbm,
+        };
+        status             = ral_get_lora_time_on_air_in_ms( raw_radio.rp->ral, &lora, toa_ms );
+        ral_params->tx.lora = lora;
+        ral_params->rx.lora = lora;
+        break;
+    }
+    case RAL_PKT_TYPE_GFSK:
+    {
+        // the narrowest bandwidth of the bit rate is picked by the radio
+        const ral_params_gfsk_t gfsk = {
+            .freq_in_hz             = params->freq_in_hz,
+            .br_in_bps              = params->gfsk.br_in_bps,
+            .pbl_len_in_bytes       = RAW_RADIO_PREAMBLE_BYTES,
+            .sync_word_len_in_bytes = RAW_RADIO_SYNC_WORD_SIZE,
+            .sync_word              = raw_radio_sync_word,
+            .pld_is_fix             = false,
+            .pld_len_in_bytes       = length,
+            .crc_type               = RAL_GFSK_CRC_2_BYTES_INV,
+            .dc_free_is_on          = true,
+            .crc_seed               = RAW_RADIO_GFSK_CRC_SEED,
+            .crc_polynomial         = RAW_RADIO_GFSK_CRC_POLYNOMIAL,
+            .whitening_seed         = RAW_RADIO_GFSK_WHITENING_SEED,
+            .pulse_shape            = RAL_GFSK_MOD_SHAPE_BT_05,
+            .bw_ssb_in_hz           = params->gfsk.br_in_bps / 4,
+            .pwr_in_dbm             = params->pwr_in_dbm,
+            .fdev_in_hz             = params->gfsk.br_in_bps / 4,
+        };
+        status             = ral_get_gfsk_time_on_air_in_ms( raw_radio.rp->ral, &gfsk, toa_ms );
+        ral_params->tx.gfsk = gfsk;
+        ral_params->rx.gfsk = gfsk;
+        break;
+    }
+    case RAL_PKT_TYPE_FLRC:
+    {
+        const ral_params_flrc_t flrc = {
+            .freq_in_hz       = params->freq_in_hz,
+            .br_in_bps        = params->flrc.br_in_bps,
+            .cr               = params->flrc.cr,
+            .pbl_len_in_bytes = RAW_RADIO_PREAMBLE_BYTES,
+            .sync_word_is_on  = true,
+            .sync_word        = raw_radio_sync_word,
+            .pld_is_fix       = false,
+            .pld_len_in_bytes = length,
+            .crc_type         = RAL_FLRC_CRC_2_BYTES,
+            .crc_seed         = RAW_RADIO_FLRC_CRC_SEED,
+            .mod_shape        = RAL_FLRC_MOD_SHAPE_BT_05,
+            .bw_ssb_in_hz     = params->flrc.br_in_bps / 4,
+            .pwr_in_dbm       = params->pwr_in_dbm,
+        };
+        status             = ral_get_flrc_time_on_air_in_ms( raw_radio.rp->ral, &flrc, toa_ms );
+        ral_params->tx.flrc = flrc;
+        ral_params->rx.flrc = flrc;
+        break;
+    }
+    default:
+        break;
+    }
+    return ( status == RAL_STATUS_OK ) && ( *toa_ms > 0 );
+}
+
+/*!
+ * \brief   Enqueue a raw task on its hook
+ * \remark  A task colliding with a higher priority one is moved to the next gap long enough, up to
+ *          RP_TASK_ASAP_TO_SCHEDULE_TRIG_TIME ms late, then aborted
+ */
+static bool raw_radio_enqueue( rp_task_types_t type, uint32_t delay_ms, uint32_t duration_ms, uint8_t* payload,
+                               uint16_t payload_size, const rp_radio_params_t* radio_params )
+{
+    if( ( delay_ms != 0 ) && ( delay_ms < ( RP_MARGIN_DELAY + 2 ) ) )
+    {
+        // a scheduled task needs the planner margin to be launched on time
+        delay_ms = RP_MARGIN_DELAY + 2;
+    }
+
+    rp_task_t rp_task;
+    rp_task.hook_id          = RAW_RADIO_HOOK_ID;
+    rp_task.type             = type;
+    rp_task.state            = ( delay_ms == 0 ) ? RP_TASK_STATE_ASAP : RP_TASK_STATE_SCHEDULE;
+    rp_task.start_time_ms    = bsp_rtc_get_time_ms( ) + delay_ms;
+    if( delay_ms == 0 )
+    {
+        // scheduled in the next gap long enough, rather than started at once and preempted by the next LoRaWAN task
+        uint32_t start_ms;
+        rp_get_next_free_window( raw_radio.rp, duration_ms, &start_ms );
+        if( ( int32_t )( start_ms - rp_task.start_time_ms ) > ( RP_MARGIN_DELAY + 1 ) )
+        {
+            rp_task.state         = RP_TASK_STATE_SCHEDULE;
+            rp_task.start_time_ms = start_ms;
+        }
+    }
+    rp_task.duration_time_ms = duration_ms;
+    rp_task.preempt_policy   = RP_TASK_PREEMPT_RESCHEDULE;
+
+    if( rp_task_enqueue( raw_radio.rp, &rp_task, payload, payload_size, radio_params ) != RP_HOOK_STATUS_OK )
+    {
+        BSP_DBG_TRACE_ERROR( "raw radio task not enqueued\n" );
+        return false;
+    }
+    raw_radio.is_running = true;
+    return true;
+}
+
+static void raw_radio_callback( void* context )
+{
+    if( raw_radio.is_running == false )
+    {
+        return;
+    }
+
+    const rp_radio_params_t* radio_params = &raw_radio.rp->radio_params[RAW_RADIO_HOOK_ID];
+
+    switch( raw_radio.rp->status[RAW_RADIO_HOOK_ID] )
+    {
+    case RP_STATUS_TX_DONE:
+        raw_radio_end( RAW_RADIO_STATUS_TX_DONE );
+        break;
+    case RP_STATUS_RX_PACKET:
+        raw_radio.rx_frame.length       = ( uint8_t ) raw_radio.rp->payload_size[RAW_RADIO_HOOK_ID];
+        raw_radio.rx_frame.timestamp_ms = raw_radio.rp->irq_timestamp_ms[RAW_RADIO_HOOK_ID];
+        raw_radio.rx_frame.snr_in_db    = 0;
+        if( radio_params->pkt_type == RAL_PKT_TYPE_LORA )
+        {
+            raw_radio.rx_frame.rssi_in_dbm = radio_params->rx.lora_pkt_status.rssi_pkt_in_dbm;
+            raw_radio.rx_frame.snr_in_db   = radio_params->rx.lora_pkt_status.snr_pkt_in_db;
+        }
+        else if( radio_params->pkt_type == RAL_PKT_TYPE_GFSK )
+        {
+            raw_radio.rx_frame.rssi_in_dbm = radio_params->rx.gfsk_pkt_status.rssi_sync_in_dbm;
+        }
+        else
+        {
+            raw_radio.rx_frame.rssi_in_dbm = radio_params->rx.flrc_pkt_status.rssi_in_dbm;
+        }
+        raw_radio_end( RAW_RADIO_STATUS_RX_DONE );
+        break;
+    case RP_STATUS_RX_TIMEOUT:
+        raw_radio_end( RAW_RADIO_STATUS_RX_TIMEOUT );
+        break;
+    case RP_STATUS_RX_CRC_ERROR:
+        raw_radio_end( RAW_RADIO_STATUS_RX_ERROR );
+        break;
+    default:
+        raw_radio_end( RAW_RADIO_STATUS_ABORTED );
+        break;
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void raw_radio_init( radio_planner_t* rp )
+{
+    memset( &raw_radio, 0, sizeof( raw_radio ) );
+    raw_radio.rp = rp;
+    rp_hook_init( rp, RAW_RADIO_HOOK_ID, raw_radio_callback, &raw_radio );
+}
+
+bool raw_radio_tx( const raw_radio_params_t* params, uint32_t delay_ms, const uint8_t* payload, uint8_t length )
+{
+    rp_radio_params_t radio_params = { 0 };
+    uint32_t          toa_ms;
+
+    if( ( raw_radio_is_busy( ) == true ) || ( length == 0 ) ||
+        ( raw_radio_params_build( params, length, &radio_params, &toa_ms ) == false ) )
+    {
+        return false;
+    }
+
+    memcpy( raw_radio.tx_payload, payload, length );
+    const rp_task_types_t type = ( params->pkt_type == RAL_PKT_TYPE_LORA )   ? RP_TASK_TYPE_TX_LORA
+                                 : ( params->pkt_type == RAL_PKT_TYPE_GFSK ) ? RP_TASK_TYPE_TX_FSK
+                                                                             : RP_TASK_TYPE_TX_FLRC;
+    return raw_radio_enqueue( type, delay_ms, toa_ms, raw_radio.tx_payload, length, &radio_params );
+}
+
+bool raw_radio_rx( const raw_radio_params_t* params, uint32_t delay_ms, uint32_t timeout_ms )
+{
+    rp_radio_params_t radio_params = { 0 };
+    uint32_t          toa_ms;
+
+    if( ( raw_radio_is_busy( ) == true ) || ( timeout_ms == 0 ) ||
+        ( raw_radio_params_build( params, RAW_RADIO_PAYLOAD_MAX, &radio_params, &toa_ms ) == false ) )
+    {
+        return false;
+    }
+
+    // a frame detected at the end of the listening is received up to its end
+    radio_params.rx.timeout_in_ms = timeout_ms;
+    raw_radio.rx_frame.length     = 0;
+    const rp_task_types_t type    = ( params->pkt_type == RAL_PKT_TYPE_LORA )   ? RP_TASK_TYPE_RX_LORA
+                                    : ( params->pkt_type == RAL_PKT_TYPE_GFSK ) ? RP_TASK_TYPE_RX_FSK
+                                                                                : RP_TASK_TYPE_RX_FLRC;
+    return raw_radio_enqueue( type, delay_ms, timeout_ms + toa_ms, raw_radio.rx_frame.payload, RAW_RADIO_PAYLOAD_MAX,
+                              &radio_params );
+}
+
+bool raw_radio_abort( void )
+{
+    if( raw_radio.is_running == false )
+    {
+        return false;
+    }
+    // cleared first: the abort does not call the hook back, but a radio irq may be pending
+    raw_radio.is_running = false;
+    rp_task_abort( raw_radio.rp, RAW_RADIO_HOOK_ID );
+    raw_radio_end( RAW_RADIO_STATUS_ABORTED );
+    return true;
+}
+
+bool raw_radio_is_busy( void )
+{
+    return ( raw_radio.is_running == true ) || ( raw_radio.is_done == true );
+}
+
+bool raw_radio_done_get( uint8_t* status )
+{
+    if( raw_radio.is_done == false )
+    {
+        return false;
+    }
+    raw_radio.is_done = false;
+    *status           = raw_radio.done_status;
+    return true;
+}
+
+const raw_radio_rx_frame_t* raw_radio_rx_frame_get( void )
+{
+    return &raw_radio.rx_frame;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
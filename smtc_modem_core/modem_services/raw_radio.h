@@ -0,0 +1,196 @@
+/*!
+ * \file      raw_radio.h
+ *
+ * \brief     Raw LoRa, GFSK and FLRC radio tasks run between the LoRaWAN tasks
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __RAW_RADIO_H__
+#define __RAW_RADIO_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "radio_planner.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Radio planner hook of the raw tasks, next to last: the LoRaWAN windows and the other services take precedence, only
+ * the background channel scan gives way to them
+ */
+#define RAW_RADIO_HOOK_ID ( RP_NB_HOOKS - 2 )
+
+/*!
+ * Payload size limit of a raw frame
+ */
+#define RAW_RADIO_PAYLOAD_MAX 255
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Status reported with the raw radio done event
+ */
+typedef enum raw_radio_status_e
+{
+    RAW_RADIO_STATUS_TX_DONE    = 0x00,  //!< frame sent
+    RAW_RADIO_STATUS_RX_DONE    = 0x01,  //!< frame received, see raw_radio_rx_frame_get
+    RAW_RADIO_STATUS_RX_TIMEOUT = 0x02,  //!< no frame before the timeout
+    RAW_RADIO_STATUS_RX_ERROR   = 0x03,  //!< frame received with a wrong CRC
+    RAW_RADIO_STATUS_ABORTED    = 0x04,  //!< aborted by the host or by a higher priority task
+} raw_radio_status_t;
+
+/*!
+ * Modulation of a raw task, the framing is fixed: explicit header or variable length, CRC on, private sync word
+ */
+typedef struct raw_radio_params_s
+{
+    ral_pkt_type_t pkt_type;    //!< RAL_PKT_TYPE_LORA, RAL_PKT_TYPE_GFSK or RAL_PKT_TYPE_FLRC
+    uint32_t       freq_in_hz;  //!< carrier frequency
+    int8_t         pwr_in_dbm;  //!< output power, Tx only
+    union
+    {
+        struct
+        {
+            ral_lora_sf_t sf;
+            ral_lora_bw_t bw;
+            ral_lora_cr_t cr;
+        } lora;
+        struct
+        {
+            uint32_t br_in_bps;  //!< the frequency deviation is a quarter of it, modulation index 0.5
+        } gfsk;
+        struct
+        {
+            uint32_t      br_in_bps;
+            ral_flrc_cr_t cr;
+        } flrc;
+    };
+} raw_radio_params_t;
+
+/*!
+ * Last frame received
+ */
+typedef struct raw_radio_rx_frame_s
+{
+    uint8_t  payload[RAW_RADIO_PAYLOAD_MAX];
+    uint8_t  length;
+    int16_t  rssi_in_dbm;
+    int16_t  snr_in_db;     //!< LoRa only, 0 otherwise
+    uint32_t timestamp_ms;  //!< end of the frame
+} raw_radio_rx_frame_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief   Attach the raw radio tasks to the radio planner
+ *
+ * \param  [in]     rp*                     - radio planner
+ * \retval          void
+ */
+void raw_radio_init( radio_planner_t* rp );
+
+/*!
+ * \brief   Enqueue the transmission of a raw frame
+ * \remark  The task has the lowest priority: it is moved to the next gap long enough between the LoRaWAN tasks
+ *          when it collides with one of them. Its end is reported by raw_radio_done_get.
+ *
+ * \param  [in]     params*                 - modulation
+ * \param  [in]     delay_ms                - delay before the transmission, 0 as soon as possible
+ * \param  [in]     payload*                - frame, copied
+ * \param  [in]     length                  - frame length, 1 to RAW_RADIO_PAYLOAD_MAX
+ * \retval          bool                    - false if a task is running or the parameters are invalid
+ */
+bool raw_radio_tx( const raw_radio_params_t* params, uint32_t delay_ms, const uint8_t* payload, uint8_t length );
+
+/*!
+ * \brief   Enqueue the reception of a raw frame
+ * \remark  Scheduled as raw_radio_tx, the reception ends with the first frame or at the timeout
+ *
+ * \param  [in]     params*                 - modulation
+ * \param  [in]     delay_ms                - delay before the reception, 0 as soon as possible
+ * \param  [in]     timeout_ms              - listening time, not 0
+ * \retval          bool                    - false if a task is running or the parameters are invalid
+ */
+bool raw_radio_rx( const raw_radio_params_t* params, uint32_t delay_ms, uint32_t timeout_ms );
+
+/*!
+ * \brief   Abort the running task, the done status is RAW_RADIO_STATUS_ABORTED
+ *
+ * \retval          bool                    - false if no task was running
+ */
+bool raw_radio_abort( void );
+
+/*!
+ * \brief   Check if a task is running or its end is not reported yet
+ *
+ * \retval          bool
+ */
+bool raw_radio_is_busy( void );
+
+/*!
+ * \brief   Get and clear the end of the last task
+ * \remark  Polled by the modem supervisor to raise the raw radio done event
+ *
+ * \param  [out]    status*                 - raw_radio_status_t of the task
+ * \retval          bool                    - true once per task
+ */
+bool raw_radio_done_get( uint8_t* status );
+
+/*!
+ * \brief   Get the last frame received
+ * \remark  Valid from the RAW_RADIO_STATUS_RX_DONE end until the next reception is enqueued
+ *
+ * \retval          const raw_radio_rx_frame_t*
+ */
+const raw_radio_rx_frame_t* raw_radio_rx_frame_get( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __RAW_RADIO_H__
+
+/* --- EOF ------------------------------------------------------------------ */
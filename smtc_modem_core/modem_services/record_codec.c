@@ -0,0 +1,164 @@
+/*!
+ * \file      record_codec.c
+ *
+ * \brief     Compact codec of the application sensor records
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memcpy
+
+#include "record_codec.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+static struct
+{
+    int32_t  records[RECORD_CODEC_QUEUE_SIZE][RECORD_CODEC_FIELDS_MAX];  // ring of the queued records
+    uint8_t  first;                                                     // index of the oldest record
+    uint16_t count;                                                     // number of queued records
+    uint8_t  nb_fields;                                                 // fields of each record
+    uint8_t  absolute_mask;                                             // fields coded as their value
+} state;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint8_t varint_encode( uint8_t* buf, int32_t value )
+{
+    // zig-zag: the small negative values get small codes too
+    uint32_t zigzag = ( ( uint32_t ) value << 1 ) ^ ( uint32_t )( value >> 31 );
+    uint8_t  length = 0;
+
+    while( zigzag >= 0x80 )
+    {
+        buf[length++] = ( uint8_t )( zigzag | 0x80 );
+        zigzag >>= 7;
+    }
+    buf[length++] = ( uint8_t ) zigzag;
+    return length;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+bool record_codec_init( uint8_t nb_fields, uint8_t absolute_mask )
+{
+    if( ( nb_fields == 0 ) || ( nb_fields > RECORD_CODEC_FIELDS_MAX ) )
+    {
+        return false;
+    }
+    state.first         = 0;
+    state.count         = 0;
+    state.nb_fields     = nb_fields;
+    state.absolute_mask = absolute_mask;
+    return true;
+}
+
+uint8_t record_codec_get_nb_fields( void )
+{
+    return state.nb_fields;
+}
+
+bool record_codec_add_record( const int32_t* values )
+{
+    if( state.count >= RECORD_CODEC_QUEUE_SIZE )
+    {
+        return false;
+    }
+    memcpy( state.records[( state.first + state.count ) % RECORD_CODEC_QUEUE_SIZE], values,
+            state.nb_fields * sizeof( int32_t ) );
+    state.count++;
+    return true;
+}
+
+uint16_t record_codec_get_record_count( void )
+{
+    return state.count;
+}
+
+uint8_t record_codec_gen_uplink( uint8_t* buf, uint8_t bufsz, uint16_t* count )
+{
+    const int32_t* previous = NULL;
+    uint8_t        length   = 1;
+
+    *count = 0;
+    while( ( *count < state.count ) && ( *count < 0xFF ) )
+    {
+        const int32_t* record = state.records[( state.first + *count ) % RECORD_CODEC_QUEUE_SIZE];
+        uint8_t        encoded[RECORD_CODEC_FIELDS_MAX * RECORD_CODEC_VARINT_SIZE_MAX];
+        uint8_t        encoded_length = 0;
+
+        for( uint8_t i = 0; i < state.nb_fields; i++ )
+        {
+            int32_t value = record[i];
+
+            if( ( previous != NULL ) && ( ( state.absolute_mask & ( 1 << i ) ) == 0 ) )
+            {  // wraps as the decoder sum does
+                value = ( int32_t )( ( uint32_t ) value - ( uint32_t ) previous[i] );
+            }
+            encoded_length += varint_encode( &encoded[encoded_length], value );
+        }
+        if( encoded_length > ( bufsz - length ) )
+        {
+            break;
+        }
+        memcpy( &buf[length], encoded, encoded_length );
+        length += encoded_length;
+        previous = record;
+        ( *count )++;
+    }
+    if( *count == 0 )
+    {
+        return 0;
+    }
+    buf[0] = *count;
+    return length;
+}
+
+void record_codec_commit_records( uint16_t count )
+{
+    if( count > state.count )
+    {
+        count = state.count;
+    }
+    state.first = ( state.first + count ) % RECORD_CODEC_QUEUE_SIZE;
+    state.count -= count;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
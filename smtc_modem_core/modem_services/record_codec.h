@@ -0,0 +1,135 @@
+/*!
+ * \file      record_codec.h
+ *
+ * \brief     Compact codec of the application sensor records
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __RECORD_CODEC_H__
+#define __RECORD_CODEC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Max number of fields of a record, each one is a signed 32-bit value
+ */
+#define RECORD_CODEC_FIELDS_MAX 8
+
+/*!
+ * Number of records queued until they are sent
+ */
+#define RECORD_CODEC_QUEUE_SIZE 16
+
+/*!
+ * Largest encoded field: a 32-bit zig-zag value takes 5 varint bytes
+ */
+#define RECORD_CODEC_VARINT_SIZE_MAX 5
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief   Set the record schema and flush the queued records
+ * \remark  The fields are coded as the difference with the same field of the previous record of the frame, the
+ *          fields set in absolute_mask are coded as their value: counters and slowly varying measurements take
+ *          the deltas, status and enumerations the absolute values.
+ *
+ * \param  [in]     nb_fields               - number of fields of each record, 1 to RECORD_CODEC_FIELDS_MAX
+ * \param  [in]     absolute_mask           - bit n set: field n coded as its value
+ * \retval          bool                    - false if the number of fields is invalid
+ */
+bool record_codec_init( uint8_t nb_fields, uint8_t absolute_mask );
+
+/*!
+ * \brief   Get the number of fields of the schema
+ *
+ * \retval          uint8_t                 - 0 before record_codec_init
+ */
+uint8_t record_codec_get_nb_fields( void );
+
+/*!
+ * \brief   Queue a record
+ *
+ * \param  [in]     values*                 - the nb_fields values of the record
+ * \retval          bool                    - false if the queue is full
+ */
+bool record_codec_add_record( const int32_t* values );
+
+/*!
+ * \brief   Get the number of queued records
+ *
+ * \retval          uint16_t
+ */
+uint16_t record_codec_get_record_count( void );
+
+/*!
+ * \brief   Encode the oldest queued records in a frame
+ * \remark  Frame format: number of records (1 byte), then the fields of each record in order, each one a zig-zag
+ *          varint (7 bits per byte, least significant group first, bit 7 set when a byte follows). The first record
+ *          of the frame carries the values, so that each frame is decoded on its own. As many records as fit in
+ *          bufsz are encoded, they stay queued until record_codec_commit_records is called.
+ *
+ * \param  [out]    buf*                    - buffer that contains the frame
+ * \param  [in]     bufsz                   - buffer size, the next uplink max payload
+ * \param  [out]    count*                  - number of records in the frame
+ * \retval          uint8_t                 - frame size, 0 if the oldest record doesn't fit or nothing is queued
+ */
+uint8_t record_codec_gen_uplink( uint8_t* buf, uint8_t bufsz, uint16_t* count );
+
+/*!
+ * \brief   Remove the oldest records from the queue
+ * \remark  To be called once their frame has been accepted by the stack
+ *
+ * \param  [in]     count                   - number of records to remove
+ * \retval          void
+ */
+void record_codec_commit_records( uint16_t count );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __RECORD_CODEC_H__
+
+/* --- EOF ------------------------------------------------------------------ */
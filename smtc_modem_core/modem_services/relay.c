@@ -0,0 +1,417 @@
+/*!
+ * \file      relay.c
+ *
+ * \brief     Relay implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memcpy
+
+#include "smtc_bsp.h"
+#include "lr1mac_defs.h"
+#include "relay.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define RELAY_FORWARD_QUEUE_SIZE 4  // power of 2, the queue positions wrap with their uint8_t counters
+#define RELAY_DOWNLINK_QUEUE_SIZE 2
+#define RELAY_LORA_PREAMBLE_SYMB 8
+#define RELAY_DATA_FRAME_MIN 12  // MHDR, FHDR without FOpts and MIC
+#define RELAY_MTYPE_UNCONF_DATA_UP 2
+#define RELAY_MTYPE_UNCONF_DATA_DOWN 3
+#define RELAY_MTYPE_CONF_DATA_UP 4
+#define RELAY_MTYPE_CONF_DATA_DOWN 5
+
+// the extra LoRaWAN stacks take two hooks each from LR1MAC_EXTRA_STACK_HOOK_ID, class B the next one
+#if( LR1MAC_CLASS_B_HOOK_ID >= RELAY_HOOK_ID )
+#error "No radio planner hook left for the relay, raise RP_NB_HOOKS"
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef struct relay_frame_s
+{
+    uint8_t payload[RELAY_FRAME_MAX];
+    uint8_t length;
+    int8_t  snr_in_db;
+    int16_t rssi_in_dbm;
+} relay_frame_t;
+
+typedef struct relay_downlink_s
+{
+    uint8_t  payload[RELAY_FRAME_MAX];
+    uint8_t  length;
+    uint32_t dev_addr;
+    bool     is_pending;  // set by relay_downlink, cleared by the radio planner callback once sent
+} relay_downlink_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static struct
+{
+    radio_planner_t*  rp;
+    bool              is_running;
+    relay_params_t    params;
+    ral_params_lora_t lora;
+    uint32_t          cad_duration_ms;
+    uint32_t          rx_timeout_ms;
+    uint32_t          sniff_start_ms;  // date of the last sniff enqueued, the next one follows a period later
+    uint8_t           rx_payload[RELAY_FRAME_MAX];
+    // written by the radio planner callback at forward_tail, read by the supervisor at forward_head
+    relay_frame_t     forward[RELAY_FORWARD_QUEUE_SIZE];
+    volatile uint8_t  forward_head;
+    volatile uint8_t  forward_tail;
+    relay_downlink_t  downlink[RELAY_DOWNLINK_QUEUE_SIZE];
+    int8_t            downlink_sent;  // downlink of the Tx task in progress, -1 while sniffing
+    uint32_t          received_nb;
+    uint32_t          dropped_nb;
+    uint32_t          downlink_nb;
+} relay;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static uint32_t relay_dev_addr_get( const uint8_t* frame )
+{
+    return ( uint32_t ) frame[1] | ( ( uint32_t ) frame[2] << 8 ) | ( ( uint32_t ) frame[3] << 16 ) |
+           ( ( uint32_t ) frame[4] << 24 );
+}
+
+/*!
+ * \brief   Radio planner reception filter, only the LoRaWAN data uplinks are received up to their end
+ */
+static bool relay_rx_filter( void* hook, const uint8_t* header, uint8_t header_size )
+{
+    const uint8_t mtype = header[0] >> 5;
+
+    return ( mtype == RELAY_MTYPE_UNCONF_DATA_UP ) || ( mtype == RELAY_MTYPE_CONF_DATA_UP );
+}
+
+/*!
+ * \brief   Build a sniff: a CAD, then the reception of the frame when it detects a preamble
+ */
+static void relay_sniff_build( rp_task_t* rp_task, rp_radio_params_t* radio_params, uint32_t start_ms )
+{
+    memset( radio_params, 0, sizeof( rp_radio_params_t ) );
+    radio_params->pkt_type          = RAL_PKT_TYPE_LORA;
+    radio_params->rx.lora           = relay.lora;
+    radio_params->rx.timeout_in_ms  = relay.rx_timeout_ms;
+    radio_params->rx.cad_gate_is_on = true;
+
+    // the frame received after a positive CAD is not accounted for: a task colliding with it preempts it
+    rp_task->hook_id          = RELAY_HOOK_ID;
+    rp_task->type             = RP_TASK_TYPE_RX_LORA;
+    rp_task->state            = RP_TASK_STATE_SCHEDULE;
+    rp_task->start_time_ms    = start_ms;
+    rp_task->duration_time_ms = relay.cad_duration_ms;
+    rp_task->preempt_policy   = RP_TASK_PREEMPT_ABORT;
+}
+
+static void relay_sniff_enqueue( uint32_t start_ms )
+{
+    rp_task_t         rp_task;
+    rp_radio_params_t radio_params;
+
+    relay_sniff_build( &rp_task, &radio_params, start_ms );
+    relay.sniff_start_ms = start_ms;
+    if( rp_task_enqueue( relay.rp, &rp_task, relay.rx_payload, RELAY_FRAME_MAX, &radio_params ) !=
+        RP_HOOK_STATUS_OK )
+    {
+        BSP_DBG_TRACE_ERROR( "relay sniff not enqueued\n" );
+    }
+}
+
+/*!
+ * \brief   Send the downlink waiting for the end-device of the frame received, the next sniff is chained to it
+ *
+ * \param  [in]     dev_addr                - DevAddr of the frame received
+ * \param  [in]     rx_end_ms               - end of the frame received
+ * \retval          bool                    - false if no downlink waits for the end-device
+ */
+static bool relay_downlink_send( uint32_t dev_addr, uint32_t rx_end_ms )
+{
+    for( uint8_t i = 0; i < RELAY_DOWNLINK_QUEUE_SIZE; i++ )
+    {
+        relay_downlink_t* downlink = &relay.downlink[i];
+        if( ( downlink->is_pending == false ) || ( downlink->dev_addr != dev_addr ) )
+        {
+            continue;
+        }
+
+        // LoRaWAN downlink framing: inverted IQ, no payload CRC
+        rp_radio_params_t radio_params        = { 0 };
+        uint32_t          toa_ms              = 0;
+        radio_params.pkt_type                 = RAL_PKT_TYPE_LORA;
+        radio_params.tx.lora                  = relay.lora;
+        radio_params.tx.lora.pld_len_in_bytes = downlink->length;
+        radio_params.tx.lora.crc_is_on        = false;
+        radio_params.tx.lora.invert_iq_is_on  = true;
+        ral_get_lora_time_on_air_in_ms( relay.rp->ral, &radio_params.tx.lora, &toa_ms );
+
+        rp_task_t rp_task;
+        rp_task.hook_id          = RELAY_HOOK_ID;
+        rp_task.type             = RP_TASK_TYPE_TX_LORA;
+        rp_task.state            = RP_TASK_STATE_SCHEDULE;
+        rp_task.start_time_ms    = rx_end_ms + RELAY_DOWNLINK_DELAY_MS;
+        rp_task.duration_time_ms = toa_ms;
+        rp_task.preempt_policy   = RP_TASK_PREEMPT_ABORT;
+        if( rp_task_enqueue( relay.rp, &rp_task, downlink->payload, downlink->length, &radio_params ) !=
+            RP_HOOK_STATUS_OK )
+        {
+            return false;
+        }
+        relay.downlink_sent  = ( int8_t ) i;
+        relay.sniff_start_ms = rp_task.start_time_ms + toa_ms + relay.params.sniff_period_ms;
+
+        rp_radio_params_t sniff_params;
+        relay_sniff_build( &rp_task, &sniff_params, relay.params.sniff_period_ms );
+        rp_task_chain( relay.rp, &rp_task, relay.rx_payload, RELAY_FRAME_MAX, &sniff_params,
+                       RP_CHAIN_IF( RP_STATUS_TX_DONE ) | RP_CHAIN_IF( RP_STATUS_TASK_ABORTED ) );
+        return true;
+    }
+    return false;
+}
+
+/*!
+ * \brief   Queue the frame received to be forwarded
+ *
+ * \retval          bool                    - false if the frame is not a LoRaWAN data uplink
+ */
+static bool relay_frame_queue( void )
+{
+    const rp_radio_params_t* radio_params = &relay.rp->radio_params[RELAY_HOOK_ID];
+    const uint8_t            length       = ( uint8_t ) relay.rp->payload_size[RELAY_HOOK_ID];
+
+    if( length < RELAY_DATA_FRAME_MIN )
+    {
+        return false;
+    }
+    relay.received_nb++;
+    if( ( uint8_t )( relay.forward_tail - relay.forward_head ) >= RELAY_FORWARD_QUEUE_SIZE )
+    {
+        relay.dropped_nb++;
+        return true;
+    }
+
+    relay_frame_t* frame = &relay.forward[relay.forward_tail % RELAY_FORWARD_QUEUE_SIZE];
+    memcpy( frame->payload, relay.rx_payload, length );
+    frame->length      = length;
+    frame->snr_in_db   = radio_params->rx.lora_pkt_status.snr_pkt_in_db;
+    frame->rssi_in_dbm = radio_params->rx.lora_pkt_status.rssi_pkt_in_dbm;
+    relay.forward_tail++;
+    bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_RADIO );
+    return true;
+}
+
+static void relay_callback( void* context )
+{
+    if( relay.is_running == false )
+    {
+        return;
+    }
+
+    const rp_status_t status = relay.rp->status[RELAY_HOOK_ID];
+    if( relay.downlink_sent >= 0 )
+    {  // end of a downlink, the next sniff is already chained: an aborted downlink waits for the next uplink
+        if( status == RP_STATUS_TX_DONE )
+        {
+            relay.downlink[relay.downlink_sent].is_pending = false;
+            relay.downlink_nb++;
+        }
+        relay.downlink_sent = -1;
+        return;
+    }
+
+    if( ( status == RP_STATUS_RX_PACKET ) && ( relay_frame_queue( ) == true ) &&
+        ( relay_downlink_send( relay_dev_addr_get( relay.rx_payload ),
+                               relay.rp->irq_timestamp_ms[RELAY_HOOK_ID] ) == true ) )
+    {
+        return;
+    }
+
+    uint32_t       start_ms = relay.sniff_start_ms + relay.params.sniff_period_ms;
+    const uint32_t now_ms   = bsp_rtc_get_time_ms( );
+    if( ( int32_t )( start_ms - ( now_ms + RP_MARGIN_DELAY + 2 ) ) < 0 )
+    {
+        start_ms = now_ms + RP_MARGIN_DELAY + 2;
+    }
+    relay_sniff_enqueue( start_ms );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void relay_init( radio_planner_t* rp )
+{
+    memset( &relay, 0, sizeof( relay ) );
+    relay.rp            = rp;
+    relay.downlink_sent = -1;
+    rp_hook_init( rp, RELAY_HOOK_ID, relay_callback, &relay );
+    rp_hook_set_rx_filter( rp, RELAY_HOOK_ID, relay_rx_filter, 1 );
+}
+
+bool relay_start( const relay_params_t* params )
+{
+    const uint32_t bw_in_hz = ral_get_lora_bw_in_hz( params->bw );
+    uint32_t       toa_ms   = 0;
+
+    if( ( relay.is_running == true ) || ( bw_in_hz == 0 ) || ( params->sniff_period_ms < RELAY_SNIFF_PERIOD_MIN_MS ) ||
+        ( params->sniff_period_ms > RELAY_SNIFF_PERIOD_MAX_MS ) )
+    {
+        return false;
+    }
+
+    relay.lora = ( ral_params_lora_t ){
+        .freq_in_hz       = params->freq_in_hz,
+        .sf               = params->sf,
+        .bw               = params->bw,
+        .cr               = params->cr,
+        .pbl_len_in_symb  = RELAY_LORA_PREAMBLE_SYMB,
+        .sync_word        = params->sync_word,
+        .pld_is_fix       = false,
+        .pld_len_in_bytes = RELAY_FRAME_MAX,
+        .crc_is_on        = true,
+        .invert_iq_is_on  = false,
+        .pwr_in_dbm       = params->pwr_in_dbm,
+    };
+    if( ( ral_get_lora_time_on_air_in_ms( relay.rp->ral, &relay.lora, &toa_ms ) != RAL_STATUS_OK ) ||
+        ( toa_ms == 0 ) )
+    {
+        return false;
+    }
+
+    // the CAD spans one symbol, the wake-up preamble of the end-devices a sniff period and two CADs
+    relay.params          = *params;
+    relay.cad_duration_ms = ( uint32_t )( ( ( uint64_t ) 1000 << params->sf ) / bw_in_hz ) + 1;
+    relay.rx_timeout_ms   = params->sniff_period_ms + ( 2 * relay.cad_duration_ms ) + toa_ms;
+    relay.forward_head    = 0;
+    relay.forward_tail    = 0;
+    relay.downlink_sent   = -1;
+    relay.received_nb     = 0;
+    relay.dropped_nb      = 0;
+    relay.downlink_nb     = 0;
+    memset( relay.downlink, 0, sizeof( relay.downlink ) );
+    relay.is_running = true;
+    relay_sniff_enqueue( bsp_rtc_get_time_ms( ) + RP_MARGIN_DELAY + 2 );
+    return true;
+}
+
+bool relay_stop( void )
+{
+    if( relay.is_running == false )
+    {
+        return false;
+    }
+    relay.is_running = false;
+    rp_task_abort( relay.rp, RELAY_HOOK_ID );
+    relay.forward_head = relay.forward_tail;
+    BSP_DBG_TRACE_PRINTF( "relay: %u frames received, %u dropped, %u downlinks sent\n", relay.received_nb,
+                          relay.dropped_nb, relay.downlink_nb );
+    return true;
+}
+
+bool relay_is_running( void )
+{
+    return relay.is_running;
+}
+
+uint8_t relay_get_forward_count( void )
+{
+    return ( uint8_t )( relay.forward_tail - relay.forward_head );
+}
+
+uint8_t relay_gen_uplink( uint8_t* buf, uint8_t bufsz )
+{
+    if( relay_get_forward_count( ) == 0 )
+    {
+        return 0;
+    }
+
+    const relay_frame_t* frame = &relay.forward[relay.forward_head % RELAY_FORWARD_QUEUE_SIZE];
+    if( ( RELAY_UPLINK_HEADER_SIZE + frame->length ) > bufsz )
+    {
+        return 0;
+    }
+    int16_t rssi = ( frame->rssi_in_dbm < -255 ) ? -255 : ( frame->rssi_in_dbm > 0 ) ? 0 : frame->rssi_in_dbm;
+    buf[0]       = ( uint8_t ) frame->snr_in_db;
+    buf[1]       = ( uint8_t ) -rssi;
+    memcpy( &buf[RELAY_UPLINK_HEADER_SIZE], frame->payload, frame->length );
+    return RELAY_UPLINK_HEADER_SIZE + frame->length;
+}
+
+void relay_commit_uplink( void )
+{
+    if( relay_get_forward_count( ) > 0 )
+    {
+        relay.forward_head++;
+    }
+}
+
+bool relay_downlink( const uint8_t* data, uint8_t length )
+{
+    const uint8_t mtype = ( length > 0 ) ? ( data[0] >> 5 ) : 0;
+
+    if( ( relay.is_running == false ) || ( length < RELAY_DATA_FRAME_MIN ) || ( length > RELAY_FRAME_MAX ) ||
+        ( ( mtype != RELAY_MTYPE_UNCONF_DATA_DOWN ) && ( mtype != RELAY_MTYPE_CONF_DATA_DOWN ) ) )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < RELAY_DOWNLINK_QUEUE_SIZE; i++ )
+    {
+        relay_downlink_t* downlink = &relay.downlink[i];
+        if( downlink->is_pending == false )
+        {
+            memcpy( downlink->payload, data, length );
+            downlink->length     = length;
+            downlink->dev_addr   = relay_dev_addr_get( data );
+            downlink->is_pending = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
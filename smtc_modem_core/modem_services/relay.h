@@ -0,0 +1,185 @@
+/*!
+ * \file      relay.h
+ *
+ * \brief     Relay of the uplinks and downlinks of the end-devices out of reach of a gateway
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __RELAY_H__
+#define __RELAY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "radio_planner.h"
+#include "raw_radio.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Radio planner hook of the relay, under the LoRaWAN and above the raw tasks
+ */
+#define RELAY_HOOK_ID ( RAW_RADIO_HOOK_ID - 1 )
+
+/*!
+ * LoRaWAN port of the forwarded frames, both ways
+ */
+#define RELAY_PORT 226
+
+/*!
+ * Size limit of a relayed frame, the PHY payload of a LoRaWAN data frame
+ */
+#define RELAY_FRAME_MAX 64
+
+/*!
+ * Uplink header of a forwarded frame: SNR (int8) then RSSI (uint8, minus dBm)
+ */
+#define RELAY_UPLINK_HEADER_SIZE 2
+
+/*!
+ * Delay of a forwarded downlink from the end of the uplink of its end-device, which listens then
+ */
+#define RELAY_DOWNLINK_DELAY_MS 1000
+
+/*!
+ * Sniff period range, the end-devices lengthen their preamble to span it
+ */
+#define RELAY_SNIFF_PERIOD_MIN_MS 100
+#define RELAY_SNIFF_PERIOD_MAX_MS 10000
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Relay channel, the end-devices send on it with a wake-up preamble, see rp_set_lora_wake_up_preamble
+ */
+typedef struct relay_params_s
+{
+    uint32_t      freq_in_hz;
+    ral_lora_sf_t sf;
+    ral_lora_bw_t bw;
+    ral_lora_cr_t cr;
+    uint8_t       sync_word;        //!< the one of the end-devices network
+    int8_t        pwr_in_dbm;       //!< output power of the downlinks forwarded
+    uint32_t      sniff_period_ms;  //!< time between two CADs, RELAY_SNIFF_PERIOD_MIN_MS to RELAY_SNIFF_PERIOD_MAX_MS
+} relay_params_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief   Attach the relay to the radio planner
+ *
+ * \param  [in]     rp*                     - radio planner
+ * \retval          void
+ */
+void relay_init( radio_planner_t* rp );
+
+/*!
+ * \brief   Start sniffing the relay channel
+ * \remark  A CAD runs every sniff period in the gaps left by the LoRaWAN tasks, a preamble detected opens the
+ *          reception of the frame. The LoRaWAN data uplinks received are queued to be forwarded.
+ *
+ * \param  [in]     params*                 - relay channel
+ * \retval          bool                    - false if the relay runs or the parameters are invalid
+ */
+bool relay_start( const relay_params_t* params );
+
+/*!
+ * \brief   Stop the relay, the frames not forwarded yet are dropped
+ *
+ * \retval          bool                    - false if the relay was not running
+ */
+bool relay_stop( void );
+
+/*!
+ * \brief   Check if the relay runs
+ *
+ * \retval          bool
+ */
+bool relay_is_running( void );
+
+/*!
+ * \brief   Get the number of frames waiting to be forwarded
+ *
+ * \retval          uint8_t                 - number of frames
+ */
+uint8_t relay_get_forward_count( void );
+
+/*!
+ * \brief   Build the uplink of the oldest frame waiting
+ * \remark  The frame stays queued until relay_commit_uplink, the RELAY_UPLINK_HEADER_SIZE bytes header carries
+ *          its reception SNR and RSSI
+ *
+ * \param  [out]    buf*                    - uplink payload
+ * \param  [in]     bufsz                   - max payload length
+ * \retval          uint8_t                 - payload length, 0 if no frame waits or the oldest one doesn't fit
+ */
+uint8_t relay_gen_uplink( uint8_t* buf, uint8_t bufsz );
+
+/*!
+ * \brief   Remove the oldest frame waiting, once forwarded or dropped
+ *
+ * \retval          void
+ */
+void relay_commit_uplink( void );
+
+/*!
+ * \brief   Queue a downlink received on RELAY_PORT for its end-device
+ * \remark  The payload is the LoRaWAN data frame of the end-device. It is sent on the relay channel
+ *          RELAY_DOWNLINK_DELAY_MS after the next uplink received from the same DevAddr.
+ *
+ * \param  [in]     data*                   - frame
+ * \param  [in]     length                  - frame length
+ * \retval          bool                    - false if the relay is not running, the frame is invalid or the
+ *                                            downlink queue is full
+ */
+bool relay_downlink( const uint8_t* data, uint8_t length );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __RELAY_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,388 @@
+/*!
+ * \file      stream.c
+ *
+ * \brief     Data stream implementation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memcpy
+
+#include "smtc_bsp.h"
+#include "stream.h"
+#include "modem_pool.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+enum
+{
+    FIFOSZ   = BSP_STREAM_FIFO_SIZE,                   // record fifo size
+    FRAGMAX  = 255 - STREAM_HEADER_SIZE,               // max number of new bytes per fragment
+    NHIST    = 2,                                      // number of previous fragments covered by the parity
+    NUNIT    = ( FIFOSZ + STREAM_ACK_UNIT - 1 ) / STREAM_ACK_UNIT,  // acknowledgment units held by the fifo
+    FEC_LOSS = 10,  // loss rate reported by the feedback above which the parity is sent again [%]
+    NPROBE   = 3,   // resends of the unacknowledged tail before it is given up
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+static struct
+{
+    uint8_t  fifo[FIFOSZ];             // stream bytes not sent yet, or not acknowledged once a feedback came
+    uint16_t head;                     // fifo read index
+    uint16_t count;                    // fifo fill level
+    uint16_t offset;                   // stream offset of the first fifo byte
+    uint32_t record_count;             // records added since init
+    uint8_t* hist[NHIST];              // new bytes of the previous fragments, most recent first, pool blocks
+    uint8_t  hist_len[NHIST];          // length of the previous fragments
+    uint8_t  next_len;                 // new bytes carried by the last generated fragment
+    bool     is_acked;                 // the receiver sends feedback: the fifo is only consumed by it
+    uint16_t sent;                     // fifo bytes sent at least once, the new bytes follow them
+    uint8_t  lost[( NUNIT + 7 ) / 8];  // units of the fifo reported lost, to be sent again
+    uint16_t rx_end;                   // fifo bytes up to the last unit reported received
+    uint8_t  loss_pct;                 // smoothed loss rate reported by the feedback [%]
+    uint8_t  probe_nb;                 // resends of the tail since the last new bytes
+    uint16_t next_pos;                 // fifo position of the bytes sent again by the last generated fragment
+    uint8_t  next_resend_len;          // bytes sent again by the last generated fragment
+} state;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void hist_release( void )
+{
+    for( uint8_t j = 0; j < NHIST; j++ )
+    {
+        modem_pool_free( state.hist[j] );
+        state.hist[j]     = NULL;
+        state.hist_len[j] = 0;
+    }
+}
+
+static void fifo_peek( uint8_t* dst, uint16_t pos, uint16_t len )
+{
+    uint16_t idx = ( state.head + pos ) % FIFOSZ;
+    while( len-- > 0 )
+    {
+        *dst++ = state.fifo[idx];
+        idx    = ( idx + 1 ) % FIFOSZ;
+    }
+}
+
+static void fifo_push( const uint8_t* src, uint16_t len )
+{
+    uint16_t idx = ( state.head + state.count ) % FIFOSZ;
+    state.count += len;
+    while( len-- > 0 )
+    {
+        state.fifo[idx] = *src++;
+        idx             = ( idx + 1 ) % FIFOSZ;
+    }
+}
+
+static void fifo_drop( uint16_t len )
+{
+    state.head = ( state.head + len ) % FIFOSZ;
+    state.count -= len;
+    state.offset += len;
+}
+
+static bool unit_is_lost( uint16_t unit )
+{
+    return ( ( state.lost[unit / 8] >> ( unit % 8 ) ) & 0x01 ) == 0x01;
+}
+
+/*!
+ * \brief   Fifo bytes to send again: the first run of lost units, or the last unit not reported received once the
+ *          fifo has no new bytes, to get a feedback on the tail. The tail is sent again NPROBE times at most until
+ *          the next feedback.
+ *
+ * \param  [out]    pos*                    - fifo position of the bytes
+ * \retval          uint16_t                - number of bytes, 0 if nothing has to be sent again
+ */
+static uint16_t resend_get( uint16_t* pos )
+{
+    uint16_t unit = 0;
+
+    while( ( unit * STREAM_ACK_UNIT < state.sent ) && ( unit_is_lost( unit ) == false ) )
+    {
+        unit++;
+    }
+    if( unit * STREAM_ACK_UNIT < state.sent )
+    {
+        uint16_t end = unit;
+
+        while( ( end * STREAM_ACK_UNIT < state.sent ) && ( unit_is_lost( end ) == true ) )
+        {
+            end++;
+        }
+        *pos = unit * STREAM_ACK_UNIT;
+        return ( ( end * STREAM_ACK_UNIT < state.sent ) ? ( end * STREAM_ACK_UNIT ) : state.sent ) - *pos;
+    }
+    if( ( state.sent < state.count ) || ( state.rx_end >= state.sent ) || ( state.probe_nb >= NPROBE ) )
+    {
+        return 0;
+    }
+    *pos = ( ( state.sent - 1 ) / STREAM_ACK_UNIT ) * STREAM_ACK_UNIT;
+    return state.sent - *pos;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void stream_init( void )
+{
+    hist_release( );
+    memset( &state, 0, sizeof( state ) );
+}
+
+bool stream_add_record( const uint8_t* data, uint8_t len )
+{
+    if( ( len + 1 ) > ( FIFOSZ - state.count ) )
+    {
+        return false;
+    }
+    fifo_push( &len, 1 );
+    fifo_push( data, len );
+    state.record_count++;
+    return true;
+}
+
+void stream_status( uint16_t* pending, uint16_t* free_space )
+{
+    *pending    = state.count;
+    *free_space = FIFOSZ - state.count;
+}
+
+uint32_t stream_get_record_count( void )
+{
+    return state.record_count;
+}
+
+bool stream_is_pending( void )
+{
+    if( state.is_acked == true )
+    {
+        uint16_t pos;
+        return ( ( state.sent < state.count ) || ( resend_get( &pos ) > 0 ) );
+    }
+    return ( ( state.count > 0 ) || ( state.hist_len[0] > 0 ) );
+}
+
+uint8_t stream_gen_uplink( uint8_t* buf, uint8_t bufsz )
+{
+    state.next_len        = 0;
+    state.next_resend_len = 0;
+    if( bufsz <= STREAM_HEADER_SIZE )
+    {
+        return 0;
+    }
+    uint8_t  avail = bufsz - STREAM_HEADER_SIZE;
+    uint16_t pos   = state.sent;
+    uint16_t n_resend;
+
+    // the lost bytes are sent again before the new ones, alone in their fragment and by whole units
+    if( ( state.is_acked == true ) && ( avail >= STREAM_ACK_UNIT ) && ( ( n_resend = resend_get( &pos ) ) > 0 ) )
+    {
+        state.next_pos        = pos;
+        state.next_resend_len = ( n_resend <= avail ) ? n_resend : ( avail / STREAM_ACK_UNIT ) * STREAM_ACK_UNIT;
+        buf[0]                = 0;
+        buf[1]                = state.offset + pos;
+        buf[2]                = ( state.offset + pos ) >> 8;
+        fifo_peek( &buf[STREAM_HEADER_SIZE], pos, state.next_resend_len );
+        return ( STREAM_HEADER_SIZE + state.next_resend_len );
+    }
+    uint16_t left  = state.count - state.sent;
+    uint8_t  n_new = ( left < avail ) ? left : avail;
+
+    // fill the remaining bytes with the parity of the previous fragments, truncated parity still rebuilds the
+    // beginning of a lost fragment. Once acknowledged, the lost fragments are sent again instead while the loss rate
+    // stays low.
+    uint8_t n_par = ( state.hist_len[0] > state.hist_len[1] ) ? state.hist_len[0] : state.hist_len[1];
+    if( ( state.is_acked == true ) && ( state.loss_pct < FEC_LOSS ) )
+    {
+        n_par = 0;
+    }
+    else if( n_par > ( avail - n_new ) )
+    {
+        n_par = avail - n_new;
+    }
+    if( ( n_new == 0 ) && ( n_par == 0 ) )
+    {
+        return 0;
+    }
+
+    buf[0] = n_par;
+    buf[1] = state.offset + pos;
+    buf[2] = ( state.offset + pos ) >> 8;
+    fifo_peek( &buf[STREAM_HEADER_SIZE], pos, n_new );
+
+    uint8_t* par = &buf[STREAM_HEADER_SIZE + n_new];
+    for( uint8_t i = 0; i < n_par; i++ )
+    {
+        par[i] = 0;
+        for( uint8_t j = 0; j < NHIST; j++ )
+        {
+            if( i < state.hist_len[j] )
+            {
+                par[i] ^= state.hist[j][i];
+            }
+        }
+    }
+    state.next_len = n_new;
+    return ( STREAM_HEADER_SIZE + n_new + n_par );
+}
+
+void stream_commit_uplink( void )
+{
+    if( state.next_resend_len > 0 )
+    {
+        // the units sent again are waited for in the next feedback, the tail counts its resends
+        const uint16_t end = state.next_pos + state.next_resend_len;
+
+        for( uint16_t unit = state.next_pos / STREAM_ACK_UNIT; unit * STREAM_ACK_UNIT < end; unit++ )
+        {
+            state.lost[unit / 8] &= ~( 1 << ( unit % 8 ) );
+        }
+        if( end == state.sent )
+        {
+            state.probe_nb++;
+        }
+        state.next_resend_len = 0;
+        return;
+    }
+    if( state.next_len == 0 )
+    {
+        // redundancy only fragment sent once the fifo drained, the stream is complete
+        hist_release( );
+        return;
+    }
+    // the oldest block takes the new fragment, without a block the next parity covers the older fragments only
+    uint8_t* block = state.hist[NHIST - 1];
+
+    for( uint8_t j = NHIST - 1; j > 0; j-- )
+    {
+        state.hist[j]     = state.hist[j - 1];
+        state.hist_len[j] = state.hist_len[j - 1];
+    }
+    state.hist[0]     = ( block != NULL ) ? block : modem_pool_alloc( );
+    state.hist_len[0] = 0;
+    if( state.hist[0] != NULL )
+    {
+        fifo_peek( state.hist[0], state.sent, state.next_len );
+        state.hist_len[0] = state.next_len;
+    }
+
+    if( state.is_acked == true )
+    {  // kept until acknowledged
+        state.sent += state.next_len;
+        state.probe_nb = 0;
+    }
+    else
+    {
+        fifo_drop( state.next_len );
+    }
+    state.next_len = 0;
+}
+
+bool stream_feedback( const uint8_t* data, uint8_t len )
+{
+    if( len < 2 )
+    {
+        return false;
+    }
+    const uint16_t acked = ( uint16_t )( ( data[0] | ( data[1] << 8 ) ) - state.offset );
+
+    if( state.is_acked == false )
+    {  // the receiver acknowledges: the bytes not sent yet are kept from now on, the ones already dropped from the
+       // fifo cannot be sent again
+        state.is_acked = true;
+        state.sent     = 0;
+        state.loss_pct = 0;
+        hist_release( );
+        return true;
+    }
+    if( acked > state.sent )
+    {  // older than the last feedback or beyond the bytes sent
+        return false;
+    }
+
+    // the units of the bitmap are counted from the acknowledged offset, the fifo is consumed up to it
+    uint16_t lost_nb = 0;
+    uint16_t rx_nb   = acked / STREAM_ACK_UNIT;
+
+    fifo_drop( acked );
+    state.sent -= acked;
+    state.rx_end = 0;
+    memset( state.lost, 0, sizeof( state.lost ) );
+    for( uint16_t unit = 0; ( unit < ( ( len - 2 ) * 8 ) ) && ( unit < NUNIT ) &&
+                            ( unit * STREAM_ACK_UNIT < state.sent );
+         unit++ )
+    {
+        if( ( ( data[2 + ( unit / 8 )] >> ( unit % 8 ) ) & 0x01 ) == 0x01 )
+        {
+            state.rx_end = ( ( unit + 1 ) * STREAM_ACK_UNIT < state.sent ) ? ( unit + 1 ) * STREAM_ACK_UNIT
+                                                                          : state.sent;
+            rx_nb++;
+        }
+    }
+    // only the units before the last one received are known lost, the next ones may be in flight
+    for( uint16_t unit = 0; unit * STREAM_ACK_UNIT < state.rx_end; unit++ )
+    {
+        if( ( ( data[2 + ( unit / 8 )] >> ( unit % 8 ) ) & 0x01 ) == 0x00 )
+        {
+            state.lost[unit / 8] |= 1 << ( unit % 8 );
+            lost_nb++;
+        }
+    }
+    if( ( lost_nb + rx_nb ) > 0 )
+    {
+        state.loss_pct = ( state.loss_pct + ( ( lost_nb * 100 ) / ( lost_nb + rx_nb ) ) ) / 2;
+    }
+    state.probe_nb = 0;
+    return true;
+}
+
+uint32_t stream_get_ram_size( void )
+{
+    return sizeof( state );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
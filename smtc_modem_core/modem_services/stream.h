@@ -0,0 +1,162 @@
+/*!
+ * \file      stream.h
+ *
+ * \brief     Data stream API
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __STREAM_H__
+#define __STREAM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC MACROS -----------------------------------------------------------
+ */
+
+/*!
+ * Stream fragment header: parity length (1 byte) + stream offset of the first data byte (16-bit little endian)
+ */
+#define STREAM_HEADER_SIZE 3
+#define STREAM_DIRECTION 0x80
+
+/*!
+ * Stream feedback: offset up to which all bytes were received (16-bit little endian) + bitmap of the next units of
+ * STREAM_ACK_UNIT bytes fully received (bit 0 of byte 0 first)
+ */
+#define STREAM_ACK_UNIT 16
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * \brief   Reset the stream: flush the record fifo and the redundancy history
+ * \remark
+ *
+ * \retval          void
+ */
+void stream_init( void );
+
+/*!
+ * \brief   Append an application record to the stream fifo
+ * \remark  The record is stored with a one byte length prefix so that the receiver can split the byte stream
+ *
+ * \param  [in]     data*                   - record data
+ * \param  [in]     len                     - record length
+ * \retval          bool                    - false if the fifo cannot hold the record
+ */
+bool stream_add_record( const uint8_t* data, uint8_t len );
+
+/*!
+ * \brief   Get the fifo fill level
+ * \remark
+ *
+ * \param  [out]    pending*                - number of bytes waiting to be sent
+ * \param  [out]    free_space*             - number of bytes that can still be added (length prefix included)
+ * \retval          void
+ */
+void stream_status( uint16_t* pending, uint16_t* free_space );
+
+/*!
+ * \brief   Return the number of records added since the last stream_init
+ * \remark  Used as sequence counter by the record encryption
+ *
+ * \retval          uint32_t
+ */
+uint32_t stream_get_record_count( void );
+
+/*!
+ * \brief   Check if the stream still needs uplinks
+ * \remark  True while the fifo holds data, and once more after it drained to send the redundancy of the last
+ *          fragments. Once a feedback was received: true while bytes are new or reported lost, and for a few
+ *          resends of the tail not acknowledged yet
+ *
+ * \retval          bool
+ */
+bool stream_is_pending( void );
+
+/*!
+ * \brief   Stream fragment generation
+ * \remark  The new stream bytes fill the buffer first, the remaining bytes carry the XOR of the two previous
+ *          fragments so that any isolated lost fragment can be rebuilt by the receiver.
+ *          Once a feedback was received, the bytes reported lost are sent again first, without parity, and the
+ *          parity is only added while the reported loss rate is high.
+ *          The fifo is not consumed until stream_commit_uplink is called.
+ *
+ * \param  [out]    buf*                    - buffer that contains the fragment
+ * \param  [in]     bufsz                   - buffer size
+ * \retval          uint8_t                 - fragment size, 0 if there is nothing to send
+ */
+uint8_t stream_gen_uplink( uint8_t* buf, uint8_t bufsz );
+
+/*!
+ * \brief   Consume the fragment built by the last stream_gen_uplink
+ * \remark  To be called once the fragment has been accepted by the stack. Once a feedback was received, the bytes
+ *          stay in the fifo until acknowledged.
+ *
+ * \retval          void
+ */
+void stream_commit_uplink( void );
+
+/*!
+ * \brief   Process a stream feedback received from the cloud
+ * \remark  The first feedback switches the stream to the acknowledged mode, the fifo is then consumed by the
+ *          feedback only
+ *
+ * \param  [in]     data*                   - acknowledged offset and received units bitmap
+ * \param  [in]     len                     - feedback length
+ * \retval          bool                    - false if the feedback is malformed or out of date
+ */
+bool stream_feedback( const uint8_t* data, uint8_t len );
+
+/*!
+ * \brief   Get the RAM taken by the stream fifo and fragment history
+ *
+ * \retval          uint32_t                - size in bytes
+ */
+uint32_t stream_get_ram_size( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __STREAM_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -36,12 +36,22 @@
 
 #include <stdint.h>   // C99 types
 #include <stdbool.h>  // bool type
+#include <string.h>   // memcpy
 #include "modem_supervisor.h"
 #include "smtc_bsp.h"
 #include "modem_context.h"
 #include "lorawan_api.h"
 #include "dm_downlink.h"
 #include "modem_api.h"
+#include "stream.h"
+#include "ranging.h"
+#include "raw_radio.h"
+#include "relay.h"
+#include "channel_scan.h"
+#include "frag_decoder.h"
+#include "fw_update.h"
+#include "outbox.h"
+#include "record_codec.h"
 
 /*
  *-----------------------------------------------------------------------------------
@@ -57,19 +67,275 @@
  */
 #define MIN( a, b ) ( ( ( a ) < ( b ) ) ? ( a ) : ( b ) )
 
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define AIRTIME_HOUR_MS 3600000
+#define AIRTIME_RESERVE_DIV 4  // part of the hourly budget a bulk uplink leaves to the application and DM uplinks
+#define OUTBOX_RETRY_MIN_S 60   // first probe of the network after an outage
+#define OUTBOX_RETRY_MAX_S 3600
+#define RELAY_RETRY_DELAY_S 10  // delay of a relayed frame the stack could not send
+#define LINK_REJOIN_MISSES 8    // LinkCheckReq unanswered in a row after which the session is assumed lost
+#define BATTERY_LOW_LEVEL 51       // LoRaWAN battery level [1: empty, 254: full] below which the battery is low
+#define BATTERY_LOW_HYSTERESIS 13  // levels above BATTERY_LOW_LEVEL the battery has to recover to be no more low
+#define BATTERY_LOW_HOLD_S 1800    // delay of the file upload and stream uplinks while the battery is low
+#define BATTERY_LOW_DM_FACTOR 4    // stretch of the periodic DM interval while the battery is low
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
-static uint8_t               UploadPayload[255];
 static lr1mac_states_t       LpState = LWPSTATE_IDLE;
 static stask_manager         task_manager;
 static user_rx_packet_type_t AvailableRxPacket                = NO_LORA_RXPACKET_AVAILABLE;
 static bool                  is_pending_dm_status_payload_now = false;
 static bool                  is_first_dm_after_join           = true;
 static bool                  send_task_update_needed          = false;
+static uint8_t               send_task_count                  = 0;
 static void ( *app_callback )( void )                         = NULL;
+static bool                  is_send_task_stored              = false;  // the uplink went to the outbox
+static bool                  is_send_task_in_outbox           = false;  // confirmed uplink kept until acknowledged
+static uint16_t              outbox_uplink_count              = 0;      // records carried by the outbox task uplink
+static uint32_t              outbox_retry_delay_s             = OUTBOX_RETRY_MIN_S;
+static uint16_t              record_uplink_count              = 0;  // sensor records carried by the record task uplink
+static bool                  is_battery_low                   = false;
+static lr1mac_link_state_t   link_state                       = LR1MAC_LINK_STATE_UNKNOWN;
+static bool                  is_radio_suspended               = false;  // radio powered down by a modem suspend
+static uint64_t              suspend_time_ms                  = 0;      // date of the power down
+
+/*!
+ * Airtime budget token bucket, the credit is counted in 1/AIRTIME_HOUR_MS ms so that it accrues by the budget each ms
+ */
+static struct
+{
+    uint32_t budget_ms_per_hour;                  // 0 when the bulk uplinks are not paced
+    int64_t  credit;                              // airtime left, negative once overdrawn by the unpaced uplinks
+    uint64_t credit_time_ms;                      // date of the last accrual, bsp_rtc_get_time_ms64
+    uint32_t bulk_airtime_ms;                     // airtime of the last bulk uplink, expected for the next one
+    uint32_t charged_ms[MODEM_AIRTIME_CLASS_NB];  // airtime charged to each class since the start
+} airtime;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief   Append a stream fragment to a DM uplink
+ * \remark  Only done for a stream on the DM port, the fragment is added as the last info field to use the bytes
+ *          left by the DM report. The fragment must be committed once the uplink is accepted by the stack.
+ *
+ * \param [in]      payload*               - DM uplink payload
+ * \param [in,out]  payload_length*        - DM uplink payload length
+ * \param [in]      max_payload            - max payload length of the next uplink
+ * \retval  bool                           - true if a stream fragment has been appended
+ */
+static bool modem_supervisor_stream_piggyback( uint8_t* payload, uint8_t* payload_length, uint8_t max_payload );
+
+/*!
+ * \brief   Carry an application uplink in the periodic DM report due soon
+ * \remark  Only done when the DM report is due within a quarter of the reporting interval and a full report fits
+ *          with the application payload. The DM fields go first, the application payload is added as the last info
+ *          field behind its port: the frame is sent on the DM port and the DM server forwards the payload. The DM
+ *          report is rescheduled, it is served by this uplink.
+ *
+ * \param [out]     dm_payload*            - DM uplink payload
+ * \param [in]      payload*               - application payload
+ * \param [in]      payload_length         - application payload length
+ * \param [in]      f_port                 - application port
+ * \retval  uint8_t                        - DM uplink payload length, 0 if the application uplink is sent alone
+ */
+static uint8_t modem_supervisor_dm_piggyback( uint8_t* dm_payload, const uint8_t* payload, uint8_t payload_length,
+                                              uint8_t f_port );
+
+/*!
+ * \brief   Update the low battery state from the battery level, with an hysteresis
+ * \remark  The datarate distribution follows the state, see lorawan_api_dr_low_power_set. An external power
+ *          source or a battery that cannot be measured is never low.
+ *
+ * \retval  bool                           - true if the battery is low
+ */
+static bool modem_supervisor_battery_is_low( void );
+
+/*!
+ * \brief   Check if an emergency uplink is queued and due
+ *
+ * \retval  bool                           - true if an emergency uplink can be launched now
+ */
+static bool modem_supervisor_is_emergency_due( void );
+
+/*!
+ * \brief   Check if the uplink of a task is built ahead of its date
+ * \remark  The frame is then handed to the radio planner MODEM_TX_PREPARE_AHEAD_MS before the date of the task and
+ *          its Tx starts right at that date. Not done with the listen before talk, the CAD has to be right before
+ *          the Tx.
+ *
+ * \param  [in]  task                      - task to check
+ * \retval  bool                           - true if the task is launched ahead of its date
+ */
+static bool modem_supervisor_task_is_prepared_ahead( const smodem_task* task );
+
+/*!
+ * \brief   Send the periodic DM uplink of the current task
+ * \remark  Sent at the date of the task when it is launched ahead of it, see modem_supervisor_task_is_prepared_ahead
+ *
+ * \param  [in]  payload                   - DM payload
+ * \param  [in]  payload_length            - DM payload length
+ * \retval  lr1mac_states_t                - LWPSTATE_SEND if the uplink is started
+ */
+static lr1mac_states_t modem_supervisor_dm_send( const uint8_t* payload, uint8_t payload_length );
+
+/*!
+ * \brief   Get the file upload session to serve
+ * \remark  The session id is the priority: the lowest started session id is the most urgent.
+ *
+ * \retval  int8_t                         - session id, -1 if no file upload is started
+ */
+static int8_t modem_supervisor_upload_next_sid( void );
+
+/*!
+ * \brief   Compare the dates of two queued tasks, the first queued goes first for a same date
+ *
+ * \param [in]  a*                     - task
+ * \param [in]  b*                     - task
+ * \retval  bool                       - true if task a is before task b in the queue
+ */
+static bool modem_supervisor_task_is_before( const smodem_task* a, const smodem_task* b );
+
+/*!
+ * \brief   Compare two tasks ready to be launched: by priority, then by task id, then by date
+ *
+ * \param [in]  a*                     - task
+ * \param [in]  b*                     - task
+ * \retval  bool                       - true if task a must be launched before task b
+ */
+static bool modem_supervisor_task_is_preferred( const smodem_task* a, const smodem_task* b );
+
+/*!
+ * \brief   Move a queued task toward the top of the queue until its parent is before it
+ *
+ * \param [in]  index                  - index of the task in the queue
+ * \retval  None
+ */
+static void modem_supervisor_task_sift_up( uint8_t index );
+
+/*!
+ * \brief   Move a queued task toward the bottom of the queue until it is before its children
+ *
+ * \param [in]  index                  - index of the task in the queue
+ * \retval  None
+ */
+static void modem_supervisor_task_sift_down( uint8_t index );
+
+/*!
+ * \brief   Remove a task from the queue
+ *
+ * \param [in]  index                  - index of the task in the queue
+ * \retval  None
+ */
+static void modem_supervisor_task_delete( uint8_t index );
+
+/*!
+ * \brief   Elect the task to launch among the tasks of the queue that are in the past
+ * \remark  The tasks in the past are the top of the queue, the walk stops at the first task in the future of each
+ *          branch. The queue must not be empty and its first task must be in the past.
+ *
+ * \param [in]  now                    - current time in millisecond, bsp_rtc_get_time_ms64
+ * \retval  uint8_t                    - index of the elected task in the queue
+ */
+static uint8_t modem_supervisor_task_elect( uint64_t now );
+
+/*!
+ * \brief   Pack the next queued application uplinks behind the launched one
+ * \remark  The uplinks are taken in queue order while they have the port, type and priority of the launched one and
+ *          the frame fits in max_payload. The packed uplinks are removed from the queue.
+ *
+ * \param [out] payload*               - frame payload
+ * \param [in]  max_payload            - max payload length of the next uplink
+ * \param [out] count*                 - number of uplinks packed in the frame, the launched one included
+ * \retval  uint8_t                    - frame payload length
+ */
+static uint8_t modem_supervisor_send_coalesce( uint8_t* payload, uint8_t max_payload, uint8_t* count );
+
+/*!
+ * \brief   Apply the max queueing delay of the QoS class of the queued application uplinks
+ * \remark  A stale uplink is dropped with a MODEM_TX_DROPPED RSP_TXDONE event when its class allows it, else it takes
+ *          TASK_HIGH_PRIORITY to go before the modem tasks. The emergency uplinks are left untouched.
+ *
+ * \param [in]  now                    - current time in millisecond, bsp_rtc_get_time_ms64
+ * \retval  None
+ */
+static void modem_supervisor_send_expire( uint64_t now );
+
+/*!
+ * \brief   Send the mac answers to the last downlink alone when no uplink carries them soon
+ * \remark  The answers ride in the fopts of an uplink due within MODEM_NWK_ANS_MERGE_WINDOW_MS, else they go at once
+ *          in a port 0 frame so the network does not wait for them until the next application uplink
+ *
+ * \param [in]  now                    - current time in millisecond, bsp_rtc_get_time_ms64
+ * \retval  bool                       - true if the port 0 frame is started
+ */
+static bool modem_supervisor_nwk_ans_send( uint64_t now );
+
+/*!
+ * \brief   Read the oldest downlink of the lorawan stack and report it to the dm or to the application
+ */
+static void modem_supervisor_downlink_deliver( void );
+
+/*!
+ * \brief   Accrue the airtime budget up to now
+ */
+static void modem_supervisor_airtime_accrue( void );
+
+/*!
+ * \brief   Charge the airtime measured since the previous charge to a task
+ * \remark  The transmissions of the radio planner hooks are all counted, the retransmissions and the mac answers
+ *          included: they are charged to the task that ends.
+ *
+ * \param [in]  id                     - task that ends
+ * \retval  None
+ */
+static void modem_supervisor_airtime_charge( task_id_t id );
+
+/*!
+ * \brief   Schedule the outbox task when the outbox holds records
+ * \remark  The outbox task already queued is kept when it is due before
+ *
+ * \param [in]  delay_s                - delay before the outbox task
+ * \retval  None
+ */
+static void modem_supervisor_outbox_schedule( uint32_t delay_s );
+
+/*!
+ * \brief   Schedule the relay task when frames wait to be forwarded
+ * \remark  Nothing is done when a relay task is already queued
+ *
+ * \param [in]  delay_s                - delay before the relay task
+ * \retval  None
+ */
+static void modem_supervisor_relay_schedule( uint32_t delay_s );
+
+/*!
+ * \brief   Follow the link state rated by the link check monitor of the stack
+ * \remark  Each change is notified with RSP_LINKSTATUS, an OTAA device rejoins after LINK_REJOIN_MISSES requests
+ *          unanswered in a row
+ *
+ * \retval  None
+ */
+static void modem_supervisor_link_monitor( void );
+
+/*!
+ * \brief   Power the radio down or up for a modem suspend
+ * \remark  The radio planners stop their timers and put the radio in cold sleep. On resume the queued tasks and the
+ *          radio planner tasks are moved by the suspend duration: the delays left before the suspend are kept.
+ *
+ * \param [in]  suspend                    - true to power the radio down, false to resume
+ * \retval  None
+ */
+static void modem_supervisor_suspend_set( bool suspend );
 
 /*
  * -----------------------------------------------------------------------------
@@ -82,23 +348,36 @@ void modem_supervisor_init( void ( *callback )( void ), radio_planner_t* rp )
     lorawan_api_dr_strategy_set( USER_DR_DISTRIBUTION );
 #if !defined( PERF_TEST_ENABLED )
     // do not clear join status that was set to joined to allow perf testbench to trigger some modem send tx commands
-    lorawan_api_join_status_clear( );
+    if( lorawan_api_isjoined( ) == NOT_JOINED )
+    {  // keep the session restored from nvm by lorawan_api_init
+        lorawan_api_join_status_clear( );
+    }
 #endif
     modem_event_init( );
     increment_asynchronous_msgnumber( RSP_RESET, 0 );
     init_task( );
     modem_load_context( );
+    outbox_init( );
+    set_modem_status_reset_after_brownout( bsp_mcu_is_reset_after_brownout( ) );
+    if( lorawan_api_isjoined( ) == JOINED )
+    {  // restored session: the modem is joined as after a join task
+        set_modem_status_modem_joined( true );
+        increment_asynchronous_msgnumber( RSP_JOINED, 0 );
+        is_first_dm_after_join = true;
+        modem_supervisor_add_task_dm_status( DM_PERIOD_AFTER_JOIN );
+        modem_supervisor_outbox_schedule( 0 );
+    }
+    else if( lorawan_api_join_pending_get( ) == true )
+    {  // join interrupted by a reset: resume it at the retry time restored with it
+        modem_supervisor_add_task_join( );
+    }
     set_modem_start_time_s( bsp_rtc_get_time_s( ) );
     app_callback = callback;
 }
 
 void init_task( void )
 {
-    for( int i = 0; i < NUMBER_OF_TASKS; i++ )
-    {
-        task_manager.modem_task[i].priority = TASK_FINISH;
-        task_manager.modem_task[i].id       = ( task_id_t ) i;
-    }
+    task_manager.task_count   = 0;
     task_manager.next_task_id = IDLE_TASK;
 }
 
@@ -106,7 +385,24 @@ eTask_valid_t modem_supervisor_remove_task( task_id_t id )
 {
     if( id < NUMBER_OF_TASKS )
     {
-        task_manager.modem_task[id].priority = TASK_FINISH;
+        uint8_t count = 0;
+
+        for( uint8_t i = 0; i < task_manager.task_count; i++ )
+        {
+            if( task_manager.modem_task[i].id != id )
+            {
+                task_manager.modem_task[count++] = task_manager.modem_task[i];
+            }
+        }
+        if( count != task_manager.task_count )
+        {
+            // rebuild the queue from the remaining tasks
+            task_manager.task_count = count;
+            for( uint8_t i = count / 2; i-- > 0; )
+            {
+                modem_supervisor_task_sift_down( i );
+            }
+        }
         return TASK_VALID;
     }
     BSP_DBG_TRACE_ERROR( "modem_supervisor_remove_task id = %d unknown\n", id );
@@ -115,23 +411,91 @@ eTask_valid_t modem_supervisor_remove_task( task_id_t id )
 
 eTask_valid_t modem_supervisor_add_task( smodem_task* task )
 {
-    // the modem supervisor always accept a new task.
-    // in case of a previous task is already enqueue , the new task remove the old one.
+    // the application uplinks are queued up to BSP_MODEM_SEND_QUEUE_SIZE, any other task has a single instance:
+    // in case of a previous task is already enqueue, the new task remove the old one.
     // as soon as a task has been elected by the modem supervisor , the task is managed by the stack itself and a new
     // task could be added inside the modem supervisor.
-    if( task->id < NUMBER_OF_TASKS )
+    if( ( task->id >= NUMBER_OF_TASKS ) || ( task->id == IDLE_TASK ) )
+    {
+        BSP_DBG_TRACE_ERROR( "modem_supervisor_add_task id = %d unknown\n", task->id );
+        return TASK_NOT_VALID;
+    }
+    if( task->id != SEND_TASK )
+    {
+        modem_supervisor_remove_task( task->id );
+    }
+    else
+    {
+        uint8_t send_count = 0;
+        for( uint8_t i = 0; i < task_manager.task_count; i++ )
+        {
+            if( task_manager.modem_task[i].id == SEND_TASK )
+            {
+                send_count++;
+            }
+        }
+        if( send_count >= BSP_MODEM_SEND_QUEUE_SIZE )
+        {
+            BSP_DBG_TRACE_ERROR( "modem_supervisor_add_task send queue full\n" );
+            return TASK_NOT_VALID;
+        }
+    }
+
+    uint8_t index = task_manager.task_count++;
+
+    task_manager.modem_task[index]          = *task;
+    task_manager.modem_task[index].sequence = task_manager.sequence++;
+    modem_supervisor_task_sift_up( index );
+    return TASK_VALID;
+}
+
+bool modem_supervisor_is_data_queued( const uint8_t* data )
+{
+    for( uint8_t i = 0; i < task_manager.task_count; i++ )
     {
-        task_manager.modem_task[task->id].time_to_execute_s = task->time_to_execute_s;
-        task_manager.modem_task[task->id].priority          = task->priority;
-        task_manager.modem_task[task->id].fPort             = task->fPort;
-        task_manager.modem_task[task->id].dataIn            = task->dataIn;
-        task_manager.modem_task[task->id].sizeIn            = task->sizeIn;
-        task_manager.modem_task[task->id].PacketType        = task->PacketType;
+        if( task_manager.modem_task[i].dataIn == data )
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-        return TASK_VALID;
+void modem_supervisor_airtime_budget_set( uint32_t budget_ms_per_hour )
+{
+    airtime.budget_ms_per_hour = budget_ms_per_hour;
+    airtime.credit             = ( int64_t ) budget_ms_per_hour * AIRTIME_HOUR_MS;
+    airtime.credit_time_ms     = bsp_rtc_get_time_ms64( );
+}
+
+uint32_t modem_supervisor_airtime_wait_ms( void )
+{
+    if( airtime.budget_ms_per_hour == 0 )
+    {
+        return 0;
     }
-    BSP_DBG_TRACE_ERROR( "modem_supervisor_add_task id = %d unknown\n", task->id );
-    return TASK_NOT_VALID;
+    modem_supervisor_airtime_accrue( );
+
+    // a bulk uplink longer than the hourly budget is sent once the bucket is full
+    int64_t full   = ( int64_t ) airtime.budget_ms_per_hour * AIRTIME_HOUR_MS;
+    int64_t needed = ( full / AIRTIME_RESERVE_DIV ) + ( ( int64_t ) airtime.bulk_airtime_ms * AIRTIME_HOUR_MS );
+    needed         = MIN( needed, full );
+    if( airtime.credit >= needed )
+    {
+        return 0;
+    }
+    int64_t wait_ms = ( needed - airtime.credit + airtime.budget_ms_per_hour - 1 ) / airtime.budget_ms_per_hour;
+    return ( uint32_t ) MIN( wait_ms, MODEM_MAX_TIME_MS );
+}
+
+void modem_supervisor_airtime_get( uint32_t* airtime_ms )
+{
+    memcpy( airtime_ms, airtime.charged_ms, sizeof( airtime.charged_ms ) );
+}
+
+uint32_t modem_supervisor_battery_hold_ms( void )
+{
+    return ( modem_supervisor_battery_is_low( ) == true ) ? ( BATTERY_LOW_HOLD_S * 1000 ) : 0;
 }
 
 void modem_supervisor_launch_task( task_id_t id )
@@ -152,20 +516,87 @@ void modem_supervisor_launch_task( task_id_t id )
         }
         break;
     case SEND_TASK: {
-        send_status = lorawan_api_payload_send(
-            task_manager.modem_task[id].fPort, task_manager.modem_task[id].dataIn, task_manager.modem_task[id].sizeIn,
-            ( task_manager.modem_task[id].PacketType == TX_CONFIRMED ) ? CONF_DATA_UP : UNCONF_DATA_UP,
-            bsp_rtc_get_time_ms( ) + MODEM_TASK_DELAY_MS );
+        const uint8_t* payload        = task_manager.current_task.dataIn;
+        uint8_t        payload_length = task_manager.current_task.sizeIn;
+        uint8_t        f_port         = task_manager.current_task.fPort;
+        modem_qos_t    qos;
+
+        BSP_PERF_EVENT( BSP_PERF_EVENT_SEND_LAUNCH, task_manager.current_task.fPort );
+        send_task_count        = 1;
+        is_send_task_stored    = false;
+        is_send_task_in_outbox = false;
+        get_modem_port_qos( f_port, &qos );
+        const bool is_coalesced = ( get_modem_tx_coalescing( ) == true ) && ( qos.is_coalesced == true );
+        if( is_coalesced == true )
+        {
+            // packed straight in the stack frame buffer, sent without copy
+            uint8_t* tx_payload = lorawan_api_tx_payload_buffer_get( );
+
+            payload_length = modem_supervisor_send_coalesce( tx_payload, lorawan_api_next_max_payload_length_get( ),
+                                                             &send_task_count );
+            payload        = tx_payload;
+        }
+
+        // the emergency uplinks don't wait for the network, the others are kept in the outbox during an outage
+        const uint8_t* record        = payload;
+        uint8_t        record_length = payload_length;
+        bool           is_store_and_forward =
+            ( get_modem_store_and_forward( ) == true ) &&
+            ( task_manager.current_task.priority != TASK_VERY_HIGH_PRIORITY );
+        uint8_t link_miss_cnt;
+        if( ( is_store_and_forward == true ) &&
+            ( ( outbox_get_record_count( ) > 0 ) ||
+              ( lorawan_api_link_state_get( &link_miss_cnt ) == LR1MAC_LINK_STATE_LOST ) ) )
+        {  // the network is not back yet: queued behind the uplinks of the outage, in order, the outbox probes it
+            is_send_task_stored     = outbox_add_record( f_port, record, record_length );
+            send_task_update_needed = false;
+            break;
+        }
+        if( ( is_store_and_forward == true ) && ( task_manager.current_task.PacketType == TX_CONFIRMED ) )
+        {  // kept until acknowledged, not lost by a reset meanwhile
+            is_send_task_in_outbox = outbox_add_record( f_port, record, record_length );
+        }
+
+        if( is_coalesced == false )
+        {
+            uint8_t* tx_payload = lorawan_api_tx_payload_buffer_get( );
+            uint8_t  dm_payload_length =
+                modem_supervisor_dm_piggyback( tx_payload, payload, payload_length, task_manager.current_task.fPort );
+            if( dm_payload_length > 0 )
+            {
+                f_port         = get_modem_dm_port( );
+                payload        = tx_payload;
+                payload_length = dm_payload_length;
+            }
+        }
+        if( task_manager.current_task.priority == TASK_VERY_HIGH_PRIORITY )
+        {  // emergency uplink: it takes the radio from the other radio planner hooks
+            send_status = lorawan_api_payload_send_preempt(
+                f_port, payload, payload_length,
+                ( task_manager.current_task.PacketType == TX_CONFIRMED ) ? CONF_DATA_UP : UNCONF_DATA_UP,
+                bsp_rtc_get_time_ms( ) );
+        }
+        else
+        {
+            send_status = lorawan_api_payload_send(
+                f_port, payload, payload_length,
+                ( task_manager.current_task.PacketType == TX_CONFIRMED ) ? CONF_DATA_UP : UNCONF_DATA_UP,
+                bsp_rtc_get_time_ms( ) + MODEM_TASK_DELAY_MS );
+        }
 
         if( send_status == LWPSTATE_SEND )
         {
             send_task_update_needed = true;
-            BSP_DBG_TRACE_PRINTF( " User Tx LORa on Port %d \n", task_manager.modem_task[id].fPort );
+            BSP_DBG_TRACE_PRINTF( " User Tx LORa on Port %d \n", f_port );
         }
         else
         {
             send_task_update_needed = false;
             BSP_DBG_TRACE_WARNING( "The payload can't be send! internal code: %x\n", send_status );
+            if( ( is_store_and_forward == true ) && ( is_send_task_in_outbox == false ) )
+            {
+                is_send_task_stored = outbox_add_record( task_manager.current_task.fPort, record, record_length );
+            }
         }
         break;
     }
@@ -194,12 +625,16 @@ void modem_supervisor_launch_task( task_id_t id )
                 modem_set_dm_info_bitfield_periodic( info_bitfield_periodic );
                 BSP_DBG_TRACE_PRINTF( " info bit fiel = %lx\n", info_bitfield_periodic );
                 dm_status_payload( payload, &payload_length, max_payload, DM_INFO_PERIODIC );
+                bool is_stream_piggyback = modem_supervisor_stream_piggyback( payload, &payload_length, max_payload );
 
-                send_status = lorawan_api_payload_send( get_modem_dm_port( ), payload, payload_length, UNCONF_DATA_UP,
-                                                        bsp_rtc_get_time_ms( ) + MODEM_TASK_DELAY_MS );
+                send_status = modem_supervisor_dm_send( payload, payload_length );
 
                 if( send_status == LWPSTATE_SEND )
                 {
+                    if( is_stream_piggyback == true )
+                    {
+                        stream_commit_uplink( );
+                    }
                     is_first_dm_after_join = false;
                     BSP_DBG_TRACE_ARRAY( "payload DM ", payload, payload_length );
                     BSP_DBG_TRACE_PRINTF( " on Port %d\n", get_modem_dm_port( ) );
@@ -215,12 +650,21 @@ void modem_supervisor_launch_task( task_id_t id )
                 if( ( get_modem_dm_interval_second( ) > 0 ) && ( modem_get_dm_info_bitfield_periodic( ) > 0 ) )
                 {
                     dm_status_payload( payload, &payload_length, max_payload, DM_INFO_PERIODIC );
-                    send_status =
-                        lorawan_api_payload_send( get_modem_dm_port( ), payload, payload_length, UNCONF_DATA_UP,
-                                                  bsp_rtc_get_time_ms( ) + MODEM_TASK_DELAY_MS );
+                    bool is_stream_piggyback =
+                        modem_supervisor_stream_piggyback( payload, &payload_length, max_payload );
+                    if( payload_length == 0 )
+                    {  // delta report without any change
+                        BSP_DBG_TRACE_PRINTF( "DM unchanged, not sent\n" );
+                        break;
+                    }
+                    send_status = modem_supervisor_dm_send( payload, payload_length );
 
                     if( send_status == LWPSTATE_SEND )
                     {
+                        if( is_stream_piggyback == true )
+                        {
+                            stream_commit_uplink( );
+                        }
                         BSP_DBG_TRACE_ARRAY( "DM ", payload, payload_length );
                         BSP_DBG_TRACE_PRINTF( " on Port %d\n", get_modem_dm_port( ) );
                     }
@@ -254,141 +698,364 @@ void modem_supervisor_launch_task( task_id_t id )
         }
         break;
     case FILE_UPLOAD_TASK: {
-        int32_t size_file_upload = 1;
+        int32_t size_file_upload = 0;
+        int8_t  sid              = modem_supervisor_upload_next_sid( );
         set_modem_status_file_upload( false );
         if( get_join_state( ) != MODEM_JOINED )
         {
             BSP_DBG_TRACE_ERROR( "DEVICE NOT JOIN \n" );
             break;
         }
-        else if( modem_get_upload_state( ) != MODEM_UPLOAD_START )
+        else if( sid < 0 )
         {
             BSP_DBG_TRACE_ERROR( "FileUpload not init \n" );
             break;
         }
-        size_file_upload = file_upload_gen_uplink( UploadPayload, lorawan_api_next_max_payload_length_get( ), MODE_0,
-                                                   lorawan_api_fcnt_up_get( ) );
-        if( size_file_upload > 0 )
+        else if( ( modem_supervisor_airtime_wait_ms( ) > 0 ) || ( modem_supervisor_battery_hold_ms( ) > 0 ) )
         {
+            // the budget was used by other uplinks since the task was scheduled, or the battery is low: it is
+            // scheduled again
             set_modem_status_file_upload( true );
-            lorawan_api_payload_send( get_modem_dm_port( ), UploadPayload, size_file_upload, UNCONF_DATA_UP,
-                                      bsp_rtc_get_time_ms( ) + MODEM_TASK_DELAY_MS );
+            break;
         }
-        else
+        // the redundancy of the sessions follows the link margin
+        int16_t margin_db;
+        if( lorawan_api_link_margin_get( &margin_db ) != OKLORAWAN )
         {
-            BSP_DBG_TRACE_WARNING( "File upload DONE\n" );
-            increment_asynchronous_msgnumber( RSP_FILEDONE, 0x00 );
-            modem_set_upload_state( MODEM_UPLOAD_NOT_INIT );
+            margin_db = FILE_UPLOAD_LINK_MARGIN_UNKNOWN;
         }
-        break;
-    }
-    case MUTE_TASK: {
-        if( get_modem_muted( ) == MODEM_TEMPORARY_MUTE )
+        file_upload_link_margin_set( margin_db );
+        // the most urgent session is served first, a completed session gives its slot to the next one
+        uint8_t* upload_payload = lorawan_api_tx_payload_buffer_get( );
+        while( sid >= 0 )
         {
-            dm_set_number_of_days_mute( dm_get_number_of_days_mute( ) - 1 );
+            size_file_upload = file_upload_gen_uplink( upload_payload, lorawan_api_next_max_payload_length_get( ),
+                                                       sid, lorawan_api_fcnt_up_get( ) );
+            if( size_file_upload > 0 )
+            {
+                set_modem_status_file_upload( true );
+                lorawan_api_payload_send( get_modem_dm_port( ), upload_payload, size_file_upload, UNCONF_DATA_UP,
+                                          bsp_rtc_get_time_ms( ) + MODEM_TASK_DELAY_MS );
+                break;
+            }
+            BSP_DBG_TRACE_WARNING( "File upload DONE, session %d\n", sid );
+            increment_asynchronous_msgnumber( RSP_FILEDONE, 0x00 | ( sid << 4 ) );
+            modem_set_upload_state( sid, MODEM_UPLOAD_NOT_INIT );
+            sid = modem_supervisor_upload_next_sid( );
         }
         break;
     }
-    case RETRIEVE_DL_TASK: {
-        lorawan_api_payload_send( get_modem_dm_port( ), task_manager.modem_task[id].dataIn,
-                                  task_manager.modem_task[id].sizeIn, task_manager.modem_task[id].PacketType,
-                                  task_manager.modem_task[id].time_to_execute_s * 1000 );
-        break;
-    }
-    default:
-        break;
-    }
-    modem_supervisor_remove_task( id );
-}
-
-void modem_supervisor_update_task( task_id_t id )
-{
-    s_modem_dwn_t dwnframe;
-    if( lorawan_api_state_get( ) == LWPSTATE_ERROR )
-    {
-        BSP_DBG_TRACE_ERROR( "LP state error Occur \n" );
-        bsp_mcu_reset( );
-    }
-    if( ( AvailableRxPacket != NO_LORA_RXPACKET_AVAILABLE ) && ( get_join_state( ) == MODEM_JOINED ) )
-    {
-        set_modem_downlink_frame( );
-        get_modem_downlink_frame( &dwnframe );
-        if( dwnframe.port == get_modem_dm_port( ) )
-        {
-            dm_downlink( dwnframe.data, dwnframe.length );
-        }
-        else
-        {
-            increment_asynchronous_msgnumber( RSP_DOWNDATA, 0 );
-        }
-    }
-    switch( id )
-    {
-    case JOIN_TASK:
-        if( ( get_join_state( ) == MODEM_JOIN_ONGOING ) && ( lorawan_api_isjoined( ) == JOINED ) )
+    case STREAM_TASK: {
+        if( get_join_state( ) != MODEM_JOINED )
         {
-            set_modem_status_joining( false );
-            set_modem_downlink_frame( );
-            increment_asynchronous_msgnumber( RSP_JOINED, 0 );
-            set_modem_status_modem_joined( true );
-            // as soon as modem is joined, modem send has to sent a dm report every DM_PERIOD_AFTER_JOIN
-            is_first_dm_after_join = true;
-            modem_supervisor_add_task_dm_status( DM_PERIOD_AFTER_JOIN );
+            BSP_DBG_TRACE_ERROR( "DEVICE NOT JOIN \n" );
+            break;
         }
-        else if( get_join_state( ) == MODEM_JOIN_ONGOING )
+        else if( modem_get_stream_state( ) != MODEM_STREAM_DATA_PENDING )
         {
-            set_modem_status_joining( false );
-            modem_supervisor_add_task_join( );  // relaunch join only if no leave cmd
+            BSP_DBG_TRACE_ERROR( "Stream not init \n" );
+            break;
         }
-        else if( ( lorawan_api_isjoined( ) == JOINED ) )  //
-        {
-            set_modem_status_joining( false );
-            lorawan_api_join_status_clear( );  // => manage case leave cmd between end of join and join suceed
+        else if( ( modem_supervisor_airtime_wait_ms( ) > 0 ) || ( modem_supervisor_battery_hold_ms( ) > 0 ) )
+        {  // the budget was used by other uplinks since the task was scheduled, or the battery is low: it is
+           // scheduled again
+            break;
         }
-        break;
-    case DM_TASK:
-        if( get_modem_dm_interval_second( ) > 0 )
+        uint8_t  max_payload    = lorawan_api_next_max_payload_length_get( );
+        uint8_t  port           = modem_get_stream_port( );
+        uint8_t  header_size    = 0;
+        uint8_t  size_stream    = 0;
+        uint8_t* upload_payload = lorawan_api_tx_payload_buffer_get( );
+
+        // a stream on port 0 goes through the DM port as stream fragments info
+        if( port == 0 )
         {
-            modem_supervisor_add_task_dm_status( get_modem_dm_interval_second( ) );
+            port                          = get_modem_dm_port( );
+            upload_payload[header_size++] = e_inf_stream;
         }
-        break;
-    case DM_TASK_NOW:
-        if( is_pending_dm_status_payload_now )
+        if( max_payload > header_size )
         {
-            modem_supervisor_add_task_dm_status_now( );
+            size_stream = stream_gen_uplink( &upload_payload[header_size], max_payload - header_size );
         }
-        break;
-    case SEND_TASK:
-        if( send_task_update_needed == true )
+        if( size_stream > 0 )
         {
-            if( lorawan_api_rx_ack_bit_get( ) == 1 )
+            send_status = lorawan_api_payload_send( port, upload_payload, header_size + size_stream, UNCONF_DATA_UP,
+                                                    bsp_rtc_get_time_ms( ) + MODEM_TASK_DELAY_MS );
+            if( send_status == LWPSTATE_SEND )
             {
-                increment_asynchronous_msgnumber( RSP_TXDONE, MODEM_TX_SUCCESS_WITH_ACK );
+                stream_commit_uplink( );
+                BSP_DBG_TRACE_ARRAY( "Stream ", upload_payload, header_size + size_stream );
+                BSP_DBG_TRACE_PRINTF( " on Port %d\n", port );
             }
             else
             {
-                increment_asynchronous_msgnumber( RSP_TXDONE, MODEM_TX_SUCCESS );
+                BSP_DBG_TRACE_WARNING( "Stream can't be send! internal code: %x\n", send_status );
             }
         }
-        else
+        break;
+    }
+    case MUTE_TASK: {
+        if( get_modem_muted( ) == MODEM_TEMPORARY_MUTE )
         {
-            increment_asynchronous_msgnumber( RSP_TXDONE, MODEM_TX_FAILED );
+            dm_set_number_of_days_mute( dm_get_number_of_days_mute( ) - 1 );
         }
+        break;
+    }
+    case RECORD_TASK: {
+        record_uplink_count = 0;
+        if( get_join_state( ) != MODEM_JOINED )
+        {
+            BSP_DBG_TRACE_ERROR( "DEVICE NOT JOIN \n" );
+            break;
+        }
+        uint8_t* record_payload = lorawan_api_tx_payload_buffer_get( );
+        uint8_t  record_payload_length =
+            record_codec_gen_uplink( record_payload, lorawan_api_next_max_payload_length_get( ), &record_uplink_count );
+
+        if( record_payload_length == 0 )
+        {
+            if( record_codec_get_record_count( ) > 0 )
+            {
+                BSP_DBG_TRACE_ERROR( "Sensor record longer than the max payload, dropped\n" );
+                record_codec_commit_records( 1 );
+            }
+            break;
+        }
+        send_status = lorawan_api_payload_send(
+            task_manager.current_task.fPort, record_payload, record_payload_length,
+            ( task_manager.current_task.PacketType == TX_CONFIRMED ) ? CONF_DATA_UP : UNCONF_DATA_UP,
+            bsp_rtc_get_time_ms( ) + MODEM_TASK_DELAY_MS );
+        if( send_status == LWPSTATE_SEND )
+        {
+            record_codec_commit_records( record_uplink_count );
+            BSP_DBG_TRACE_PRINTF( "Records %d in %d bytes on Port %d\n", record_uplink_count, record_payload_length,
+                                  task_manager.current_task.fPort );
+        }
+        else
+        {
+            record_uplink_count = 0;
+            BSP_DBG_TRACE_WARNING( "Records can't be send! internal code: %x\n", send_status );
+        }
+        break;
+    }
+    case OUTBOX_TASK: {
+        outbox_uplink_count = 0;
+        if( get_join_state( ) != MODEM_JOINED )
+        {
+            BSP_DBG_TRACE_ERROR( "DEVICE NOT JOIN \n" );
+            break;
+        }
+        else if( outbox_get_record_count( ) == 0 )
+        {
+            break;
+        }
+        uint8_t  port;
+        uint8_t  outbox_payload_length;
+        uint8_t* outbox_payload = lorawan_api_tx_payload_buffer_get( );
+
+        // catching up: the most records in the shortest airtime, acknowledged to be removed from the outbox
+        lorawan_api_next_dr_fastest_set( );
+        outbox_payload_length = outbox_gen_uplink( &port, outbox_payload, lorawan_api_next_max_payload_length_get( ),
+                                                   &outbox_uplink_count );
+        if( outbox_payload_length == 0 )
+        {
+            BSP_DBG_TRACE_ERROR( "Outbox record longer than the max payload, dropped\n" );
+            outbox_commit_records( 1 );
+            break;
+        }
+        send_status = lorawan_api_payload_send( port, outbox_payload, outbox_payload_length, CONF_DATA_UP,
+                                                bsp_rtc_get_time_ms( ) + MODEM_TASK_DELAY_MS );
+        if( send_status == LWPSTATE_SEND )
+        {
+            BSP_DBG_TRACE_PRINTF( "Outbox %d records on Port %d\n", outbox_uplink_count, port );
+        }
+        else
+        {
+            outbox_uplink_count = 0;
+            BSP_DBG_TRACE_WARNING( "Outbox can't be send! internal code: %x\n", send_status );
+        }
+        break;
+    }
+    case RELAY_TASK: {
+        if( get_join_state( ) != MODEM_JOINED )
+        {
+            BSP_DBG_TRACE_ERROR( "DEVICE NOT JOIN \n" );
+            break;
+        }
+        uint8_t* relay_payload = lorawan_api_tx_payload_buffer_get( );
+        uint8_t  relay_payload_length =
+            relay_gen_uplink( relay_payload, ( uint8_t ) lorawan_api_next_max_payload_length_get( ) );
+
+        if( relay_payload_length == 0 )
+        {
+            BSP_DBG_TRACE_ERROR( "Relayed frame longer than the max payload, dropped\n" );
+            relay_commit_uplink( );
+            break;
+        }
+        // unconfirmed: the end-device retransmits on its own when it gets no answer
+        send_status = lorawan_api_payload_send( RELAY_PORT, relay_payload, relay_payload_length, UNCONF_DATA_UP,
+                                                bsp_rtc_get_time_ms( ) + MODEM_TASK_DELAY_MS );
+        if( send_status == LWPSTATE_SEND )
+        {
+            relay_commit_uplink( );
+            BSP_DBG_TRACE_PRINTF( "Relayed frame of %d bytes\n", relay_payload_length );
+        }
+        else
+        {
+            BSP_DBG_TRACE_WARNING( "Relayed frame can't be send! internal code: %x\n", send_status );
+            modem_supervisor_relay_schedule( RELAY_RETRY_DELAY_S );
+        }
+        break;
+    }
+    case RETRIEVE_DL_TASK: {
+        // the empty frame only opens the receive windows, it goes as fast as the datarate strategy allows
+        lorawan_api_next_dr_fastest_set( );
+        lorawan_api_payload_send( get_modem_dm_port( ), task_manager.current_task.dataIn,
+                                  task_manager.current_task.sizeIn, task_manager.current_task.PacketType,
+                                  ( uint32_t ) task_manager.current_task.time_to_execute_ms );
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void modem_supervisor_update_task( task_id_t id )
+{
+    if( lorawan_api_state_get( ) == LWPSTATE_ERROR )
+    {
+        BSP_DBG_TRACE_ERROR( "LP state error Occur \n" );
+        modem_store_context_flush( );
+        bsp_mcu_reset( );
+    }
+    modem_supervisor_airtime_charge( id );
+    modem_supervisor_link_monitor( );
+    if( ( AvailableRxPacket != NO_LORA_RXPACKET_AVAILABLE ) && ( get_join_state( ) == MODEM_JOINED ) )
+    {
+        modem_supervisor_downlink_deliver( );
+    }
+    switch( id )
+    {
+    case JOIN_TASK:
+        if( ( get_join_state( ) == MODEM_JOIN_ONGOING ) && ( lorawan_api_isjoined( ) == JOINED ) )
+        {
+            set_modem_status_joining( false );
+            set_modem_downlink_frame( );
+            increment_asynchronous_msgnumber( RSP_JOINED, 0 );
+            set_modem_status_modem_joined( true );
+            // as soon as modem is joined, modem send has to sent a dm report every DM_PERIOD_AFTER_JOIN
+            is_first_dm_after_join = true;
+            modem_supervisor_add_task_dm_status( DM_PERIOD_AFTER_JOIN );
+            if( modem_get_stream_state( ) == MODEM_STREAM_DATA_PENDING )
+            {
+                modem_supervisor_add_task_stream( );
+            }
+            modem_supervisor_outbox_schedule( 0 );
+        }
+        else if( get_join_state( ) == MODEM_JOIN_ONGOING )
+        {
+            set_modem_status_joining( false );
+            modem_supervisor_add_task_join( );  // relaunch join only if no leave cmd
+        }
+        else if( ( lorawan_api_isjoined( ) == JOINED ) )  //
+        {
+            set_modem_status_joining( false );
+            lorawan_api_join_status_clear( );  // => manage case leave cmd between end of join and join suceed
+        }
+        break;
+    case DM_TASK:
+        if( get_modem_dm_interval_second( ) > 0 )
+        {
+            uint32_t interval_s = get_modem_dm_interval_second( );
+            if( modem_supervisor_battery_is_low( ) == true )
+            {
+                interval_s *= BATTERY_LOW_DM_FACTOR;
+            }
+            modem_supervisor_add_task_dm_status( interval_s );
+        }
+        break;
+    case DM_TASK_NOW:
+        if( is_pending_dm_status_payload_now )
+        {
+            modem_supervisor_add_task_dm_status_now( );
+        }
+        break;
+    case SEND_TASK: {
+        e_tx_done_state_t tx_done_state = MODEM_TX_FAILED;
+        if( send_task_update_needed == true )
+        {
+            tx_done_state = ( lorawan_api_rx_ack_bit_get( ) == 1 ) ? MODEM_TX_SUCCESS_WITH_ACK : MODEM_TX_SUCCESS;
+        }
+        if( is_send_task_in_outbox == true )
+        {
+            if( tx_done_state == MODEM_TX_SUCCESS_WITH_ACK )
+            {  // it was the only record, an outbox with records takes the uplinks before they are sent
+                outbox_commit_records( 1 );
+            }
+            else
+            {
+                is_send_task_stored = true;
+            }
+        }
+        if( is_send_task_stored == true )
+        {
+            tx_done_state = MODEM_TX_STORED;
+            modem_supervisor_outbox_schedule( outbox_retry_delay_s );
+        }
+        else if( tx_done_state == MODEM_TX_SUCCESS_WITH_ACK )
+        {  // the network is back
+            outbox_retry_delay_s = OUTBOX_RETRY_MIN_S;
+            modem_supervisor_outbox_schedule( 0 );
+        }
+        // one event for each uplink packed in the frame
+        for( ; send_task_count > 0; send_task_count-- )
+        {
+            increment_asynchronous_msgnumber( RSP_TXDONE, tx_done_state );
+        }
+        is_send_task_stored    = false;
+        is_send_task_in_outbox = false;
         // Re-enable the duty cycle in case of Emergency Tx was sent
         lorawan_api_duty_cycle_enable_set( true );
         break;
+    }
     case FILE_UPLOAD_TASK: {
-        if( get_modem_status_file_upload( ) == true )
+        int8_t sid = modem_supervisor_upload_next_sid( );
+        if( ( get_modem_status_file_upload( ) == true ) && ( sid >= 0 ) )
         {
-            smodem_task upload_task;  // as soon as you join you send dm report every DM_PERIOD_AFTER_JOIN
-            upload_task.id       = FILE_UPLOAD_TASK;
-            upload_task.priority = TASK_HIGH_PRIORITY;
-            upload_task.time_to_execute_s =
-                bsp_rtc_get_time_s( ) + modem_upload_avgdelay_get( ) + bsp_rng_get_random_in_range( 1, 3 );
+            // the next uplink is paced by the airtime budget when set, else by the most urgent session started
+            uint32_t delay_ms = ( airtime.budget_ms_per_hour > 0 ) ? modem_supervisor_airtime_wait_ms( )
+                                                                   : ( modem_upload_avgdelay_get( sid ) * 1000 );
+            if( is_battery_low == true )
+            {  // state updated by the launch of the task
+                delay_ms = BATTERY_LOW_HOLD_S * 1000;
+            }
+            smodem_task upload_task;
+            upload_task.id                 = FILE_UPLOAD_TASK;
+            upload_task.priority           = TASK_HIGH_PRIORITY;
+            upload_task.time_to_execute_ms =
+                bsp_rtc_get_time_ms64( ) + delay_ms + bsp_rng_get_random_in_range( 1000, 3000 );
             modem_supervisor_add_task( &upload_task );
         }
         break;
     }
+    case STREAM_TASK: {
+        if( modem_get_stream_state( ) != MODEM_STREAM_DATA_PENDING )
+        {
+            break;
+        }
+        if( stream_is_pending( ) == false )
+        {
+            BSP_DBG_TRACE_WARNING( "Stream DONE\n" );
+            set_modem_status_streaming( false );
+            modem_set_stream_state( MODEM_STREAM_INIT );
+            increment_asynchronous_msgnumber( RSP_STREAMDONE, 0x00 );
+        }
+        else if( get_join_state( ) == MODEM_JOINED )
+        {
+            modem_supervisor_add_task_stream( );
+        }
+        break;
+    }
     case MUTE_TASK: {
         if( get_modem_muted( ) == MODEM_TEMPORARY_MUTE )
         {
@@ -396,15 +1063,53 @@ void modem_supervisor_update_task( task_id_t id )
         }
         break;
     }
+    case RECORD_TASK: {
+        e_tx_done_state_t tx_done_state = MODEM_TX_FAILED;
+        if( record_uplink_count > 0 )
+        {
+            tx_done_state = ( lorawan_api_rx_ack_bit_get( ) == 1 ) ? MODEM_TX_SUCCESS_WITH_ACK : MODEM_TX_SUCCESS;
+        }
+        increment_asynchronous_msgnumber( RSP_TXDONE, tx_done_state );
+        if( ( record_uplink_count > 0 ) && ( record_codec_get_record_count( ) > 0 ) )
+        {  // the records left follow in the next frames, on the same port
+            smodem_task record_task = task_manager.current_task;
+
+            record_task.time_to_execute_ms = bsp_rtc_get_time_ms64( );
+            modem_supervisor_add_task( &record_task );
+        }
+        record_uplink_count = 0;
+        break;
+    }
+    case OUTBOX_TASK: {
+        if( ( outbox_uplink_count > 0 ) && ( lorawan_api_rx_ack_bit_get( ) == 1 ) )
+        {  // the network is back: the next records follow as fast as the duty cycle allows
+            outbox_commit_records( outbox_uplink_count );
+            outbox_retry_delay_s = OUTBOX_RETRY_MIN_S;
+            modem_supervisor_outbox_schedule( 0 );
+        }
+        else
+        {  // still no network: the outage is probed less and less often
+            outbox_retry_delay_s = MIN( outbox_retry_delay_s * 2, OUTBOX_RETRY_MAX_S );
+            modem_supervisor_outbox_schedule( outbox_retry_delay_s );
+        }
+        outbox_uplink_count = 0;
+        break;
+    }
     case RETRIEVE_DL_TASK: {
         s_dm_retrieve_pending_dl_t retrieve;
+        int8_t                     fpending = lorawan_api_rx_fpending_bit_get( );
         get_dm_retrieve_pending_dl( &retrieve );
         retrieve.up_count--;
+        if( fpending == 0 )
+        {  // the network has no downlink left for the device
+            retrieve.up_count = 0;
+        }
 
         set_dm_retrieve_pending_dl( retrieve.up_count, retrieve.up_delay );
         if( retrieve.up_count > 0 )
         {
-            modem_supervisor_add_task_retrieve_dl( retrieve.up_delay );
+            // more downlinks are queued on the network side: the next one is fetched right away
+            modem_supervisor_add_task_retrieve_dl( ( fpending == 1 ) ? 0 : retrieve.up_delay );
         }
 
         break;
@@ -429,61 +1134,59 @@ uint32_t modem_supervisor_scheduler( void )
         task_manager.next_task_id = IDLE_TASK;
     }
 
-    eTask_priority next_task_priority = TASK_FINISH;
-    int32_t        next_task_time     = MODEM_MAX_TIME;
+    int64_t  next_task_time  = MODEM_MAX_TIME_MS;
+    uint8_t  next_task_index = 0;
+    uint64_t now             = bsp_rtc_get_time_ms64( );
 
-    // Find the highest priority task in the past
-    for( task_id_t i = 0; i < NUMBER_OF_TASKS; i++ )
+    modem_supervisor_send_expire( now );
+    if( modem_supervisor_nwk_ans_send( now ) == true )
     {
-        if( task_manager.modem_task[i].priority != TASK_FINISH )
-        {
-            int32_t next_task_time_tmp =
-                ( int32_t )( task_manager.modem_task[i].time_to_execute_s - bsp_rtc_get_time_s( ) );
-
-            if( ( next_task_time_tmp <= 0 ) && ( task_manager.modem_task[i].priority < next_task_priority ) )
-            {
-                next_task_priority        = task_manager.modem_task[i].priority;
-                next_task_time            = next_task_time_tmp;
-                task_manager.next_task_id = ( task_id_t ) i;
-            }
-        }
+        return ( CALL_LR1MAC_PERIOD_MS );
     }
 
-    // No task in the past was found, select the least in the future for wake up
-    if( next_task_priority == TASK_FINISH )
+    // the first task of the queue is the least in the future, or one of the tasks in the past
+    if( task_manager.task_count > 0 )
     {
-        for( task_id_t i = 0; i < NUMBER_OF_TASKS; i++ )
+        next_task_time = ( int64_t )( task_manager.modem_task[0].time_to_execute_ms - now );
+        if( next_task_time <= 0 )
         {
-            if( task_manager.modem_task[i].priority != TASK_FINISH )
-            {
-                int32_t next_task_time_tmp =
-                    ( int32_t )( task_manager.modem_task[i].time_to_execute_s - bsp_rtc_get_time_s( ) );
-                if( next_task_time_tmp < next_task_time )
-                {
-                    next_task_time            = next_task_time_tmp;
-                    task_manager.next_task_id = ( task_id_t ) i;
-                }
-            }
+            // Find the highest priority task in the past
+            next_task_index = modem_supervisor_task_elect( now );
         }
+        else if( modem_supervisor_task_is_prepared_ahead( &task_manager.modem_task[0] ) == true )
+        {  // launched early, the uplink waits in the radio planner for the date of the task
+            next_task_time =
+                ( next_task_time > MODEM_TX_PREPARE_AHEAD_MS ) ? ( next_task_time - MODEM_TX_PREPARE_AHEAD_MS ) : 0;
+        }
+        task_manager.next_task_id = task_manager.modem_task[next_task_index].id;
     }
 
     int32_t next_free_dtc = lorawan_api_next_free_duty_cycle_ms_get( );
     if( next_free_dtc > 0 )
     {
-        next_free_dtc = ( next_free_dtc / 1000 ) + 1;
-        BSP_DBG_TRACE_WARNING( "Duty Cycle, remaining time: %ds\n", next_free_dtc );
+        BSP_DBG_TRACE_WARNING( "Duty Cycle, remaining time: %dms\n", next_free_dtc );
     }
 
     next_task_time = ( next_task_time > next_free_dtc ) ? next_task_time : next_free_dtc;
 
     if( next_task_time > 0 )
     {
-        task_manager.sleep_duration = next_task_time;
+        next_task_time              = MIN( next_task_time, MODEM_MAX_TIME_MS );
+        task_manager.sleep_duration = ( uint32_t ) next_task_time;
         task_manager.next_task_id   = IDLE_TASK;
-        return ( next_task_time );
+        return ( ( uint32_t ) next_task_time );
+    }
+    else if( ( ( task_manager.next_task_id == DM_TASK ) || ( task_manager.next_task_id == DM_TASK_NOW ) ) &&
+             ( bsp_mcu_sensors_refresh( ) == false ) )
+    {
+        // the dm payload reads the mcu temperature and voltage, the task is run once they have been measured
+        task_manager.next_task_id = IDLE_TASK;
+        return MODEM_SENSORS_WAIT_MS;
     }
     else
     {
+        task_manager.current_task = task_manager.modem_task[next_task_index];
+        modem_supervisor_task_delete( next_task_index );
         modem_supervisor_launch_task( task_manager.next_task_id );
         return 0;
     }
@@ -494,6 +1197,7 @@ uint32_t modem_supervisor_engine( void )
     // manage reset requested by the host
     if( get_modem_reset_requested( ) == true )
     {
+        modem_store_context_flush( );
         bsp_disable_irq( );
         // workaround to avoid issue when reset too fast after a store context
         bsp_mcu_wait_us( 2000000 );
@@ -501,29 +1205,61 @@ uint32_t modem_supervisor_engine( void )
         bsp_mcu_reset( );
     }
 
-    uint32_t alarm                 = modem_get_user_alarm( );
-    int32_t  user_alarm_in_seconds = MODEM_MAX_ALARM_S;
+    update_modem_charge( );
+
+    uint32_t alarm            = modem_get_user_alarm( );
+    int64_t  user_alarm_in_ms = MODEM_MAX_TIME_MS;
     // manage the user alarm
     if( alarm != 0 )
     {
-        user_alarm_in_seconds = ( int32_t )( alarm - bsp_rtc_get_time_s( ) );
+        user_alarm_in_ms = ( int64_t )( ( ( uint64_t ) alarm * 1000 ) - bsp_rtc_get_time_ms64( ) );
 
-        if( user_alarm_in_seconds <= 0 )
+        if( user_alarm_in_ms <= 0 )
         {
             increment_asynchronous_msgnumber( RSP_ALARM, 0 );
             modem_set_user_alarm( 0 );
-            user_alarm_in_seconds = MODEM_MAX_ALARM_S;
+            user_alarm_in_ms = MODEM_MAX_TIME_MS;
         }
     }
+
+    // the ranging and the raw tasks run from the radio planner callbacks, only their end is reported from here
+    uint8_t ranging_status;
+    if( ranging_done_get( &ranging_status ) == true )
+    {
+        increment_asynchronous_msgnumber( RSP_RANGINGDONE, ranging_status );
+    }
+    uint8_t raw_radio_status;
+    if( raw_radio_done_get( &raw_radio_status ) == true )
+    {
+        increment_asynchronous_msgnumber( RSP_RAWRADIODONE, raw_radio_status );
+    }
+    if( ( relay_get_forward_count( ) > 0 ) && ( get_join_state( ) == MODEM_JOINED ) )
+    {
+        modem_supervisor_relay_schedule( 0 );
+    }
+    // the channel scans feed the LoRaWAN region from here, out of the radio planner callback
+    if( channel_scan_is_done( ) == true )
+    {
+        channel_scan_process( );
+    }
+
+    // the host firmware update block was answered, it is programmed while the host sends the next one
+    fw_update_process( );
+
     uint32_t sleep_time;
     bsp_watchdog_reload( );
 
     // case Lorawan stack already in use
     LpState = lorawan_api_state_get( );
+    if( ( ( LpState == LWPSTATE_TX_WAIT ) || ( LpState == LWPSTATE_SEND ) ) &&
+        ( modem_supervisor_is_emergency_due( ) == true ) )
+    {  // an emergency uplink does not wait behind a retransmission or a mac answer
+        LpState = lorawan_api_tx_wait_abort( );
+    }
     if( ( LpState != LWPSTATE_IDLE ) && ( LpState != LWPSTATE_ERROR ) && ( LpState != LWPSTATE_INVALID ) )
     {
         LpState = lorawan_api_process( &AvailableRxPacket );
-        return ( CALL_LR1MAC_PERIOD_MS );
+        return ( lorawan_api_next_process_delay_ms_get( ) );
     }
 
     // Call modem_supervisor_update_task to update asynchronous messages number
@@ -533,9 +1269,30 @@ uint32_t modem_supervisor_engine( void )
         task_manager.next_task_id = IDLE_TASK;
     }
 
+    // the stack is idle: a suspend is applied once the exchange in progress is over
+    if( ( get_modem_suspend( ) == MODEM_SUSPEND ) != is_radio_suspended )
+    {
+        modem_supervisor_suspend_set( get_modem_suspend( ) == MODEM_SUSPEND );
+    }
+
+    // class B and C: the stack is idle but its beacons and receptions still have to be processed
+    bool is_downlink_pending = false;
+    if( ( get_modem_class( ) != MODEM_CLASS_A ) && ( is_radio_suspended == false ) )
+    {
+        LpState = lorawan_api_process( &AvailableRxPacket );
+        if( ( AvailableRxPacket != NO_LORA_RXPACKET_AVAILABLE ) && ( get_join_state( ) == MODEM_JOINED ) )
+        {  // one downlink per call, each one is read by the application callback before the next one
+            modem_supervisor_downlink_deliver( );
+            lorawan_api_process( &AvailableRxPacket );
+            is_downlink_pending = ( AvailableRxPacket != NO_LORA_RXPACKET_AVAILABLE );
+        }
+    }
+
     uint8_t msgnumber_tmp;
     do
     {
+        // the events with a handler are given to it, the application callback reads the others
+        modem_event_dispatch( ( app_callback == NULL ) ? true : false );
         if( ( get_asynchronous_msgnumber( ) > 0 ) && ( *app_callback != NULL ) )
         {
             app_callback( );
@@ -551,21 +1308,531 @@ uint32_t modem_supervisor_engine( void )
     }
     else
     {
-        // Set Max time (7FFFFFFF>>10 ie /1024 to be compatible with *1000)
-        sleep_time = 0x1FFFFF;
+        sleep_time = MODEM_MAX_TIME_MS;
     }
 
     alarm = modem_get_user_alarm( );
     if( alarm != 0 )
     {
-        user_alarm_in_seconds = ( int32_t )( alarm - bsp_rtc_get_time_s( ) );
-        if( user_alarm_in_seconds <= 0 )
+        user_alarm_in_ms = ( int64_t )( ( ( uint64_t ) alarm * 1000 ) - bsp_rtc_get_time_ms64( ) );
+        if( user_alarm_in_ms <= 0 )
         {
-            user_alarm_in_seconds = 0;
+            user_alarm_in_ms = 0;
         }
     }
 
-    sleep_time = MIN( sleep_time, ( uint32_t ) user_alarm_in_seconds );
-    BSP_DBG_TRACE_INFO( "Next task in %lu\n", sleep_time );
-    return ( 1000 * sleep_time );
+    sleep_time = MIN( sleep_time, ( uint32_t ) MIN( user_alarm_in_ms, MODEM_MAX_TIME_MS ) );
+
+    // the stack is idle: the changed contexts are written before the mcu goes to sleep
+    sleep_time = MIN( sleep_time, modem_store_context_process( ) );
+    if( is_downlink_pending == true )
+    {
+        sleep_time = 0;
+    }
+    BSP_DBG_TRACE_INFO( "Next task in %lums\n", sleep_time );
+    return ( sleep_time );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool modem_supervisor_stream_piggyback( uint8_t* payload, uint8_t* payload_length, uint8_t max_payload )
+{
+    if( ( modem_get_stream_state( ) != MODEM_STREAM_DATA_PENDING ) || ( modem_get_stream_port( ) != 0 ) ||
+        ( ( *payload_length + 1 ) >= max_payload ) )
+    {
+        return false;
+    }
+    uint8_t size_stream = stream_gen_uplink( &payload[*payload_length + 1], max_payload - ( *payload_length + 1 ) );
+    if( size_stream == 0 )
+    {
+        return false;
+    }
+    payload[*payload_length] = e_inf_stream;
+    *payload_length += 1 + size_stream;
+    return true;
+}
+
+static uint8_t modem_supervisor_dm_piggyback( uint8_t* dm_payload, const uint8_t* payload, uint8_t payload_length,
+                                              uint8_t f_port )
+{
+    if( ( get_modem_dm_piggyback( ) == false ) || ( is_first_dm_after_join == true ) ||
+        ( get_modem_dm_interval_second( ) == 0 ) || ( modem_get_dm_info_bitfield_periodic( ) == 0 ) ||
+        ( f_port == get_modem_dm_port( ) ) )
+    {
+        return 0;
+    }
+    uint8_t index = 0;
+    while( ( index < task_manager.task_count ) && ( task_manager.modem_task[index].id != DM_TASK ) )
+    {
+        index++;
+    }
+    if( index == task_manager.task_count )
+    {
+        return 0;
+    }
+    int64_t dm_due_ms = ( int64_t )( task_manager.modem_task[index].time_to_execute_ms - bsp_rtc_get_time_ms64( ) );
+    uint8_t max_payload = lorawan_api_next_max_payload_length_get( );
+    if( ( dm_due_ms > ( ( int64_t ) get_modem_dm_interval_second( ) * 1000 / 4 ) ) ||
+        ( ( dm_status_payload_max_length( ) + 2 + payload_length ) > max_payload ) )
+    {
+        return 0;
+    }
+
+    uint8_t dm_length;
+    dm_status_payload( dm_payload, &dm_length, max_payload - ( 2 + payload_length ), DM_INFO_PERIODIC );
+    modem_supervisor_add_task_dm_status( get_modem_dm_interval_second( ) );
+    if( dm_length == 0 )
+    {  // delta report without any change
+        return 0;
+    }
+    dm_payload[dm_length]     = e_inf_appdata;
+    dm_payload[dm_length + 1] = f_port;
+    memcpy( &dm_payload[dm_length + 2], payload, payload_length );
+    return dm_length + 2 + payload_length;
+}
+
+static void modem_supervisor_airtime_accrue( void )
+{
+    uint64_t now        = bsp_rtc_get_time_ms64( );
+    uint64_t elapsed_ms = MIN( now - airtime.credit_time_ms, AIRTIME_HOUR_MS );
+    int64_t  full       = ( int64_t ) airtime.budget_ms_per_hour * AIRTIME_HOUR_MS;
+
+    airtime.credit_time_ms = now;
+    airtime.credit += ( int64_t ) elapsed_ms * airtime.budget_ms_per_hour;
+    airtime.credit = MIN( airtime.credit, full );
+}
+
+static void modem_supervisor_airtime_charge( task_id_t id )
+{
+    modem_rp_stats_t      stats;
+    modem_airtime_class_t airtime_class;
+    uint32_t              airtime_ms = 0;
+
+    get_modem_rp_stats( MODEM_RP_STATS_READER_SUPERVISOR, &stats );
+    for( uint8_t i = 0; i < RP_NB_HOOKS; i++ )
+    {
+        airtime_ms += stats.tx_ms[i];
+    }
+    switch( id )
+    {
+    case SEND_TASK:
+    case OUTBOX_TASK:
+    case RECORD_TASK:
+    case RELAY_TASK:
+        airtime_class = MODEM_AIRTIME_APP;
+        break;
+    case FILE_UPLOAD_TASK:
+        airtime_class = MODEM_AIRTIME_UPLOAD;
+        break;
+    case STREAM_TASK:
+        airtime_class = MODEM_AIRTIME_STREAM;
+        break;
+    default:
+        airtime_class = MODEM_AIRTIME_DM;
+        break;
+    }
+    airtime.charged_ms[airtime_class] += airtime_ms;
+    if( ( airtime_ms > 0 ) &&
+        ( ( airtime_class == MODEM_AIRTIME_UPLOAD ) || ( airtime_class == MODEM_AIRTIME_STREAM ) ) )
+    {
+        airtime.bulk_airtime_ms = airtime_ms;
+    }
+    modem_supervisor_airtime_accrue( );
+    airtime.credit -= ( int64_t ) airtime_ms * AIRTIME_HOUR_MS;
+}
+
+static void modem_supervisor_outbox_schedule( uint32_t delay_s )
+{
+    smodem_task outbox_task;
+
+    if( outbox_get_record_count( ) == 0 )
+    {
+        return;
+    }
+    outbox_task.id                 = OUTBOX_TASK;
+    outbox_task.priority           = TASK_MEDIUM_HIGH_PRIORITY;
+    outbox_task.time_to_execute_ms = bsp_rtc_get_time_ms64( ) + ( ( uint64_t ) delay_s * 1000 );
+    for( uint8_t i = 0; i < task_manager.task_count; i++ )
+    {
+        if( ( task_manager.modem_task[i].id == OUTBOX_TASK ) &&
+            !modem_supervisor_task_is_before( &outbox_task, &task_manager.modem_task[i] ) )
+        {  // the uplinks sent meanwhile don't delay the probe of the network
+            return;
+        }
+    }
+    modem_supervisor_add_task( &outbox_task );
+}
+
+static void modem_supervisor_relay_schedule( uint32_t delay_s )
+{
+    smodem_task relay_task;
+
+    for( uint8_t i = 0; i < task_manager.task_count; i++ )
+    {
+        if( task_manager.modem_task[i].id == RELAY_TASK )
+        {
+            return;
+        }
+    }
+    relay_task.id                 = RELAY_TASK;
+    relay_task.priority           = TASK_MEDIUM_HIGH_PRIORITY;
+    relay_task.time_to_execute_ms = bsp_rtc_get_time_ms64( ) + ( ( uint64_t ) delay_s * 1000 );
+    modem_supervisor_add_task( &relay_task );
+}
+
+static void modem_supervisor_link_monitor( void )
+{
+    uint8_t             miss_cnt;
+    lr1mac_link_state_t state = lorawan_api_link_state_get( &miss_cnt );
+
+    if( state != link_state )
+    {
+        link_state = state;
+        increment_asynchronous_msgnumber( RSP_LINKSTATUS, state );
+    }
+    if( ( state == LR1MAC_LINK_STATE_LOST ) && ( miss_cnt >= LINK_REJOIN_MISSES ) &&
+        ( lorawan_api_isjoined( ) == JOINED ) && ( lorawan_api_is_ota_device( ) == OTAA_DEVICE ) )
+    {  // the network server may have dropped the session, a new one is negotiated
+        BSP_DBG_TRACE_WARNING( "Link lost, rejoin\n" );
+        set_modem_status_modem_joined( false );
+        lorawan_api_join_status_clear( );
+        modem_supervisor_add_task_join( );
+    }
+}
+
+static void modem_supervisor_suspend_set( bool suspend )
+{
+    if( suspend == true )
+    {
+        rp_suspend( modem_get_radio_planner( ) );
+#if defined( MODEM_DUAL_RADIO )
+        rp_suspend( modem_get_radio_planner_subghz( ) );
+#endif
+        suspend_time_ms    = bsp_rtc_get_time_ms64( );
+        is_radio_suspended = true;
+        BSP_DBG_TRACE_INFO( "Radio powered down\n" );
+        return;
+    }
+
+    const uint64_t suspend_ms = bsp_rtc_get_time_ms64( ) - suspend_time_ms;
+
+    // the same shift for every date keeps the task heap ordered
+    for( uint8_t i = 0; i < task_manager.task_count; i++ )
+    {
+        task_manager.modem_task[i].time_to_execute_ms += suspend_ms;
+    }
+    airtime.credit_time_ms += suspend_ms;
+    is_radio_suspended = false;
+    rp_resume( modem_get_radio_planner( ) );
+#if defined( MODEM_DUAL_RADIO )
+    rp_resume( modem_get_radio_planner_subghz( ) );
+#endif
+    if( get_modem_class( ) == MODEM_CLASS_B )
+    {  // the RTC drift over the suspend is unknown, the beacon is searched again
+        lorawan_api_class_b_enable_set( true );
+    }
+    BSP_DBG_TRACE_INFO( "Radio powered up after %lu s\n", ( uint32_t )( suspend_ms / 1000 ) );
+}
+
+static bool modem_supervisor_battery_is_low( void )
+{
+    uint8_t level = bsp_mcu_get_battery_level( );
+    bool    is_low;
+
+    // 0: external power source, 255: not able to measure
+    if( ( level == 0 ) || ( level == 255 ) || ( level >= ( BATTERY_LOW_LEVEL + BATTERY_LOW_HYSTERESIS ) ) )
+    {
+        is_low = false;
+    }
+    else if( level < BATTERY_LOW_LEVEL )
+    {
+        is_low = true;
+    }
+    else
+    {
+        is_low = is_battery_low;
+    }
+
+    if( is_low != is_battery_low )
+    {
+        BSP_DBG_TRACE_WARNING( "Battery %s, level %u\n", ( is_low == true ) ? "low" : "recovered", level );
+        is_battery_low = is_low;
+        lorawan_api_dr_low_power_set( is_low );
+    }
+    return is_battery_low;
+}
+
+static bool modem_supervisor_is_emergency_due( void )
+{
+    uint64_t now = bsp_rtc_get_time_ms64( );
+    for( uint8_t i = 0; i < task_manager.task_count; i++ )
+    {
+        if( ( task_manager.modem_task[i].id == SEND_TASK ) &&
+            ( task_manager.modem_task[i].priority == TASK_VERY_HIGH_PRIORITY ) &&
+            ( ( int64_t )( task_manager.modem_task[i].time_to_execute_ms - now ) <= 0 ) )
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool modem_supervisor_task_is_prepared_ahead( const smodem_task* task )
+{
+    return ( task->id == DM_TASK ) && ( get_join_state( ) == MODEM_JOINED ) && ( lorawan_api_lbt_enable_get( ) == 0 );
+}
+
+static lr1mac_states_t modem_supervisor_dm_send( const uint8_t* payload, uint8_t payload_length )
+{
+    if( ( int64_t )( task_manager.current_task.time_to_execute_ms - bsp_rtc_get_time_ms64( ) ) > 0 )
+    {  // the frame is built and handed to the radio planner now, with the channel, data rate and fcnt of its Tx
+        return lorawan_api_payload_send_at_time( get_modem_dm_port( ), payload, payload_length, UNCONF_DATA_UP,
+                                                 ( uint32_t ) task_manager.current_task.time_to_execute_ms );
+    }
+    return lorawan_api_payload_send( get_modem_dm_port( ), payload, payload_length, UNCONF_DATA_UP,
+                                     bsp_rtc_get_time_ms( ) + MODEM_TASK_DELAY_MS );
+}
+
+static int8_t modem_supervisor_upload_next_sid( void )
+{
+    for( uint8_t sid = 0; sid < FILE_UPLOAD_MAX_SESSIONS; sid++ )
+    {
+        if( modem_get_upload_state( sid ) == MODEM_UPLOAD_START )
+        {
+            return sid;
+        }
+    }
+    return -1;
+}
+
+static bool modem_supervisor_task_is_before( const smodem_task* a, const smodem_task* b )
+{
+    int64_t delta = ( int64_t )( a->time_to_execute_ms - b->time_to_execute_ms );
+    return ( delta < 0 ) || ( ( delta == 0 ) && ( ( int32_t )( a->sequence - b->sequence ) < 0 ) );
+}
+
+static bool modem_supervisor_task_is_preferred( const smodem_task* a, const smodem_task* b )
+{
+    if( a->priority != b->priority )
+    {
+        return a->priority < b->priority;
+    }
+    if( a->id != b->id )
+    {
+        return a->id < b->id;
+    }
+    return modem_supervisor_task_is_before( a, b );
+}
+
+static void modem_supervisor_task_sift_up( uint8_t index )
+{
+    smodem_task task = task_manager.modem_task[index];
+
+    while( index > 0 )
+    {
+        uint8_t parent = ( index - 1 ) / 2;
+        if( !modem_supervisor_task_is_before( &task, &task_manager.modem_task[parent] ) )
+        {
+            break;
+        }
+        task_manager.modem_task[index] = task_manager.modem_task[parent];
+        index                          = parent;
+    }
+    task_manager.modem_task[index] = task;
+}
+
+static void modem_supervisor_task_sift_down( uint8_t index )
+{
+    smodem_task task = task_manager.modem_task[index];
+
+    while( ( 2 * index + 1 ) < task_manager.task_count )
+    {
+        uint8_t child = 2 * index + 1;
+        if( ( ( child + 1 ) < task_manager.task_count ) &&
+            modem_supervisor_task_is_before( &task_manager.modem_task[child + 1], &task_manager.modem_task[child] ) )
+        {
+            child++;
+        }
+        if( !modem_supervisor_task_is_before( &task_manager.modem_task[child], &task ) )
+        {
+            break;
+        }
+        task_manager.modem_task[index] = task_manager.modem_task[child];
+        index                          = child;
+    }
+    task_manager.modem_task[index] = task;
+}
+
+static void modem_supervisor_task_delete( uint8_t index )
+{
+    task_manager.task_count--;
+    if( index != task_manager.task_count )
+    {
+        task_manager.modem_task[index] = task_manager.modem_task[task_manager.task_count];
+        modem_supervisor_task_sift_down( index );
+        modem_supervisor_task_sift_up( index );
+    }
+}
+
+static uint8_t modem_supervisor_task_elect( uint64_t now )
+{
+    // a task in the future has all its children in the future, the walk only visits the tasks in the past
+    uint8_t pending[MODEM_TASK_QUEUE_SIZE];
+    uint8_t pending_count = 0;
+    uint8_t elected       = 0;
+
+    pending[pending_count++] = 0;
+    while( pending_count > 0 )
+    {
+        uint8_t            index = pending[--pending_count];
+        const smodem_task* task  = &task_manager.modem_task[index];
+
+        if( ( int64_t )( task->time_to_execute_ms - now ) > 0 )
+        {
+            continue;
+        }
+        if( modem_supervisor_task_is_preferred( task, &task_manager.modem_task[elected] ) )
+        {
+            elected = index;
+        }
+        for( uint8_t child = 2 * index + 1; ( child <= ( 2 * index + 2 ) ) && ( child < task_manager.task_count );
+             child++ )
+        {
+            pending[pending_count++] = child;
+        }
+    }
+    return elected;
+}
+
+static uint8_t modem_supervisor_send_coalesce( uint8_t* payload, uint8_t max_payload, uint8_t* count )
+{
+    const smodem_task* first          = &task_manager.current_task;
+    uint8_t            payload_length = first->sizeIn;
+    uint64_t           now            = bsp_rtc_get_time_ms64( );
+
+    memcpy( payload, first->dataIn, first->sizeIn );
+    *count = 1;
+    while( true )
+    {
+        // next uplink in queue order among the uplinks launched with the same priority
+        int16_t next = -1;
+        for( uint8_t i = 0; i < task_manager.task_count; i++ )
+        {
+            const smodem_task* task = &task_manager.modem_task[i];
+            if( ( task->id == SEND_TASK ) && ( task->priority == first->priority ) &&
+                ( ( next < 0 ) || ( ( int32_t )( task->sequence - task_manager.modem_task[next].sequence ) < 0 ) ) )
+            {
+                next = i;
+            }
+        }
+        if( next < 0 )
+        {
+            break;
+        }
+        const smodem_task* task = &task_manager.modem_task[next];
+        if( ( task->fPort != first->fPort ) || ( task->PacketType != first->PacketType ) ||
+            ( ( int64_t )( task->time_to_execute_ms - now ) > 0 ) ||
+            ( ( payload_length + task->sizeIn ) > max_payload ) )
+        {
+            break;
+        }
+        memcpy( &payload[payload_length], task->dataIn, task->sizeIn );
+        payload_length += task->sizeIn;
+        ( *count )++;
+        modem_supervisor_task_delete( next );
+    }
+    return payload_length;
+}
+
+static void modem_supervisor_send_expire( uint64_t now )
+{
+    uint8_t count = 0;
+
+    for( uint8_t i = 0; i < task_manager.task_count; i++ )
+    {
+        smodem_task* task = &task_manager.modem_task[i];
+        modem_qos_t  qos;
+
+        if( ( task->id == SEND_TASK ) && ( task->priority != TASK_VERY_HIGH_PRIORITY ) )
+        {
+            // the date of an application uplink is the date it was queued
+            get_modem_port_qos( task->fPort, &qos );
+            if( ( qos.max_delay_s > 0 ) &&
+                ( ( int64_t )( now - task->time_to_execute_ms ) > ( ( int64_t ) qos.max_delay_s * 1000 ) ) )
+            {
+                if( qos.is_dropped_when_stale == true )
+                {
+                    BSP_DBG_TRACE_WARNING( "Stale uplink on port %d dropped\n", task->fPort );
+                    increment_asynchronous_msgnumber( RSP_TXDONE, MODEM_TX_DROPPED );
+                    continue;
+                }
+                task->priority = TASK_HIGH_PRIORITY;
+            }
+        }
+        task_manager.modem_task[count++] = *task;
+    }
+    if( count != task_manager.task_count )
+    {
+        // rebuild the queue from the remaining tasks
+        task_manager.task_count = count;
+        for( uint8_t i = count / 2; i-- > 0; )
+        {
+            modem_supervisor_task_sift_down( i );
+        }
+    }
+}
+
+static bool modem_supervisor_nwk_ans_send( uint64_t now )
+{
+    if( ( get_join_state( ) != MODEM_JOINED ) || ( lorawan_api_nwk_ans_pending_get( ) == false ) )
+    {
+        return false;
+    }
+    for( uint8_t i = 0; i < task_manager.task_count; i++ )
+    {
+        const smodem_task* task = &task_manager.modem_task[i];
+
+        if( ( task->id != JOIN_TASK ) && ( task->id != MUTE_TASK ) &&
+            ( ( int64_t )( task->time_to_execute_ms - now ) < MODEM_NWK_ANS_MERGE_WINDOW_MS ) )
+        {  // the answers go in its fopts
+            return false;
+        }
+    }
+    BSP_DBG_TRACE_INFO( "Mac answers sent alone\n" );
+    return lorawan_api_nwk_ans_send( ( uint32_t )( now + MODEM_TASK_DELAY_MS ) ) == LWPSTATE_SEND;
+}
+
+static void modem_supervisor_downlink_deliver( void )
+{
+    set_modem_downlink_frame( );
+
+    const s_modem_dwn_t* dwnframe = get_modem_downlink_frame( );
+    if( dwnframe->port == get_modem_dm_port( ) )
+    {
+        dm_downlink( dwnframe->data, dwnframe->length );
+    }
+    else if( ( dwnframe->port == RELAY_PORT ) && ( relay_is_running( ) == true ) )
+    {  // sent to its end-device after its next uplink
+        if( relay_downlink( dwnframe->data, dwnframe->length ) == false )
+        {
+            BSP_DBG_TRACE_WARNING( "Relay downlink dropped\n" );
+        }
+    }
+    else if( dwnframe->port == FRAG_DECODER_PORT )
+    {  // fragments are consumed by the decoder, only the complete file is reported
+        if( frag_decoder_downlink( dwnframe->data, dwnframe->length ) == FRAG_DECODER_STATUS_DONE )
+        {
+            increment_asynchronous_msgnumber( RSP_FRAGDONE, 0 );
+        }
+    }
+    else
+    {
+        increment_asynchronous_msgnumber( RSP_DOWNDATA, 0 );
+    }
+    // a downlink tells the network is back
+    outbox_retry_delay_s = OUTBOX_RETRY_MIN_S;
+    modem_supervisor_outbox_schedule( 0 );
 }
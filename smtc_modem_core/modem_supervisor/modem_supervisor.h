@@ -40,6 +40,7 @@ extern "C" {
  * -----------------------------------------------------------------------------
  * --- DEPENDENCIES ------------------------------------------------------------
  */
+#include "smtc_bsp.h"
 #include "radio_planner.h"
 
 /*
@@ -49,9 +50,12 @@ extern "C" {
 
 #define DM_PERIOD_AFTER_JOIN 10
 #define MODEM_TASK_DELAY_MS 200
-#define MODEM_MAX_TIME 0x1FFFFF
+#define MODEM_MAX_TIME_MS 0x7FFFFFFF
 #define CALL_LR1MAC_PERIOD_MS 400
-#define MODEM_MAX_ALARM_S 0x7FFFFFFF
+#define MODEM_SENSORS_WAIT_MS 10
+#define MODEM_TX_PREPARE_AHEAD_MS 400  // a periodic DM uplink is built this long before its date
+#define MODEM_AIRTIME_BUDGET_MAX_MS 3600000  // airtime budget of a device allowed to transmit all the time, per hour
+#define MODEM_NWK_ANS_MERGE_WINDOW_MS 10000  // the mac answers wait for an uplink due this soon, else go alone
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC TYPES ------------------------------------------------------------
@@ -75,10 +79,32 @@ typedef enum
     STREAM_TASK,  //!< task initiated by the application layer, but managed by the modem itself to transfer long streams
     ALC_SYNC_TIME_REQ_TASK,  //!< task managed by the modem to launch Application Layer Clock Synchronisation
     ALC_SYNC_ANS_TASK,       //!< task managed by the modem to launch Application Layer Clock Synchronisation answer
+    OUTBOX_TASK,             //!< task managed by the modem to send the application uplinks kept during an outage
+    RECORD_TASK,             //!< task initiated by the application layer to send the queued sensor records
+    RELAY_TASK,              //!< task managed by the modem to forward the frames received by the relay
     NUMBER_OF_TASKS          //!< number of tasks
 
 } task_id_t;
 
+/*!
+ * \brief   Number of tasks in the supervisor queue: one for each modem task and BSP_MODEM_SEND_QUEUE_SIZE for the
+ *          application uplinks
+ */
+#define MODEM_TASK_QUEUE_SIZE ( NUMBER_OF_TASKS - 1 + BSP_MODEM_SEND_QUEUE_SIZE )
+
+/*!
+ * \typedef modem_airtime_class_t
+ * \brief   Uplinks the airtime is charged to
+ */
+typedef enum modem_airtime_class_e
+{
+    MODEM_AIRTIME_APP,     //!< application uplinks
+    MODEM_AIRTIME_DM,      //!< DM reports and the other modem uplinks: join, downlink retrieval, clock sync
+    MODEM_AIRTIME_UPLOAD,  //!< file upload
+    MODEM_AIRTIME_STREAM,  //!< streams sent on their own uplinks
+    MODEM_AIRTIME_CLASS_NB
+} modem_airtime_class_t;
+
 /*!
  * \typedef eTask_priority
  * \brief   Descriptor of priorities for task
@@ -108,13 +134,14 @@ typedef enum eTask_valid
  */
 typedef struct smodem_task
 {
-    task_id_t      id;                 //!< Type ID of the task
-    uint32_t       time_to_execute_s;  //!< The date to execute the task in second
-    eTask_priority priority;           //!< The priority
-    uint8_t        fPort;              //!< LoRaWAN frame port
-    const uint8_t* dataIn;             //!< Data in task
-    uint8_t        sizeIn;             //!< Data length in byte(s)
-    uint8_t        PacketType;         //!< LoRaWAN packet type ( Tx confirmed/Unconfirmed )
+    task_id_t      id;                  //!< Type ID of the task
+    uint64_t       time_to_execute_ms;  //!< The date to execute the task in millisecond, bsp_rtc_get_time_ms64
+    eTask_priority priority;            //!< The priority
+    uint8_t        fPort;               //!< LoRaWAN frame port
+    const uint8_t* dataIn;              //!< Data in task
+    uint8_t        sizeIn;              //!< Data length in byte(s)
+    uint8_t        PacketType;          //!< LoRaWAN packet type ( Tx confirmed/Unconfirmed )
+    uint32_t       sequence;            //!< Order of insertion in the queue, set by the supervisor
 } smodem_task;
 
 /*!
@@ -123,10 +150,13 @@ typedef struct smodem_task
  */
 typedef struct stask_manager
 {
-    smodem_task modem_task[NUMBER_OF_TASKS];
+    smodem_task modem_task[MODEM_TASK_QUEUE_SIZE];  //!< binary min-heap of the queued tasks ordered by date
+    uint8_t     task_count;                         //!< number of queued tasks
+    uint32_t    sequence;                           //!< sequence of the next queued task
+    smodem_task current_task;                       //!< task launched and removed from the queue
     task_id_t   current_task_id;
     task_id_t   next_task_id;
-    uint32_t    sleep_duration;
+    uint32_t    sleep_duration;                     //!< time to the next task in ms
 
 } stask_manager;
 
@@ -158,6 +188,7 @@ void init_task( void );
 
 /*!
  * \brief   Remove a task in supervisor
+ * \remark  All the queued instances of the task are removed
  * \param [in]  id   - Task id
  * \retval eTask_valid_t
  */
@@ -165,12 +196,53 @@ eTask_valid_t modem_supervisor_remove_task( task_id_t id );
 
 /*!
  * \brief   Add a task in supervisor
- * \remark
+ * \remark  Up to BSP_MODEM_SEND_QUEUE_SIZE SEND_TASK can be queued, they are sent in order. Any other task has a
+ *          single instance: the new task replaces the queued one.
  * \param task*  smodem_task
  * \retval eTask_valid_t
  */
 eTask_valid_t modem_supervisor_add_task( smodem_task* task );
 
+/*!
+ * \brief   Check if a queued task refers to a data buffer
+ * \param [in]  data*   - data buffer
+ * \retval bool         - true if the buffer is used by a queued task
+ */
+bool modem_supervisor_is_data_queued( const uint8_t* data );
+
+/*!
+ * \brief   Set the airtime budget shared by all the uplinks
+ * \remark  The budget accrues continuously and up to one hour of budget is kept. The measured airtime of each uplink
+ *          is charged to it. The application and DM uplinks are never held, the file upload and stream uplinks are
+ *          sent as soon as a quarter of the hourly budget is left after them: they use the leftover budget without
+ *          starving the application. The bucket is full once set.
+ * \param [in]  budget_ms_per_hour   - airtime allowed per hour in ms, 0 to disable the pacing
+ * \retval None
+ */
+void modem_supervisor_airtime_budget_set( uint32_t budget_ms_per_hour );
+
+/*!
+ * \brief   Get the delay before the budget allows the next file upload or stream uplink
+ * \retval uint32_t     - delay in ms, 0 when the uplink can be sent now or without budget
+ */
+uint32_t modem_supervisor_airtime_wait_ms( void );
+
+/*!
+ * \brief   Get the airtime charged to each class of uplinks since the start
+ * \param [out] airtime_ms*  - MODEM_AIRTIME_CLASS_NB airtimes in ms, indexed by modem_airtime_class_t
+ * \retval None
+ */
+void modem_supervisor_airtime_get( uint32_t* airtime_ms );
+
+/*!
+ * \brief   Get the delay a low battery puts on the next file upload or stream uplink
+ * \remark  Below a battery level, the supervisor holds the file upload and stream uplinks back, stretches the periodic
+ *          DM interval and swaps the long range datarate distribution for the low power one, until the battery
+ *          recovers a few levels above. The application, DM and emergency uplinks are never held.
+ * \retval uint32_t     - delay in ms, 0 when the battery is not low
+ */
+uint32_t modem_supervisor_battery_hold_ms( void );
+
 #ifdef __cplusplus
 }
 #endif
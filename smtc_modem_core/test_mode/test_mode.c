@@ -36,6 +36,7 @@
 
 #include <stdint.h>   // C99 types
 #include <stdbool.h>  // bool type
+#include <string.h>   // memset
 
 #include "test_mode.h"
 #include "modem_api.h"
@@ -44,15 +45,77 @@
 #include "lr1mac_core.h"
 #include "smtc_real.h"
 #include "smtc_bsp.h"
+#include "lr1mac_utilities.h"
+#include "smtc_bsp_rng.h"
+#include "modem_pool.h"
 
 #if defined( REGION_WW2G4 )
+#include "sx1280.h"
 #include "sx1280_hal.h"
+#include "sx1280_regs.h"
+#include "region_ww2g4.h"
 #elif defined( REGION_EU_868 ) || defined( REGION_US_915 )
+#include "sx126x.h"
 #include "sx126x_hal.h"
+#if defined( REGION_EU_868 )
+#include "region_eu_868.h"
+#else
+#include "region_us_915.h"
+#endif
 #else
 #error "Please select region.."
 #endif
 
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+// Packet error rate test packets start with their 16-bit sequence number, big endian
+#define TEST_MODE_PER_SEQ_SIZE 2
+
+// RSSI histogram bins of 10 dB from -130 dBm, SNR histogram bins of 4 dB from -20 dB, the edge bins are open
+#define TEST_MODE_PER_HIST_BINS 8
+#define TEST_MODE_PER_RSSI_MIN -130
+#define TEST_MODE_PER_RSSI_STEP 10
+#define TEST_MODE_PER_SNR_MIN -20
+#define TEST_MODE_PER_SNR_STEP 4
+
+// Radio task duration given to the radio planner, as for the other test mode tasks
+#define TEST_MODE_TASK_DURATION_MS 2000
+
+// Sweep test packets start with their step index and their 16-bit sequence number, big endian
+#define TEST_MODE_SWEEP_HEADER_SIZE 3
+#define TEST_MODE_SWEEP_STEP_MAX 32
+
+// Sweep schedule: each packet is followed by a gap for the radio setup of the next one, each step by a guard time
+// for the clock drift between both modems and the configuration switch. The first packet is sent after a delay.
+#define TEST_MODE_SWEEP_GAP_MS 20
+#define TEST_MODE_SWEEP_GUARD_MS 100
+#define TEST_MODE_SWEEP_START_DELAY_MS 1000
+
+// Frequency hopping: channels of the region channel plan, time kept free at the end of each dwell for the retune
+#if defined( REGION_WW2G4 )
+#define TEST_MODE_HOP_CHANNEL_MAX NUMBER_OF_CHANNEL_WW2G4
+#elif defined( REGION_EU_868 )
+#define TEST_MODE_HOP_CHANNEL_MAX NUMBER_OF_CHANNEL_EU_868
+#else
+#define TEST_MODE_HOP_CHANNEL_MAX NUMBER_OF_CHANNEL_US_915
+#endif
+#define TEST_MODE_HOP_RETUNE_MS ( RP_MARGIN_DELAY + 2 )
+
+// SPI benchmark: operations timed, each one run iteration_nb times, and the register read
+#define TEST_MODE_SPI_BENCH_OP_NB 6
+#define TEST_MODE_SPI_BENCH_ITERATION_MAX 1000
+#if defined( SX1280 )
+#define TEST_MODE_SPI_BENCH_REG_ADDR SX1280_REG_FW_VERSION
+#elif defined( SX126X )
+#define TEST_MODE_SPI_BENCH_REG_ADDR 0x0740  // LoRa sync word MSB
+#endif
+
+// Steps returned by one sweep result command, 5 bytes of header and 13 bytes per step in the 255 bytes response
+#define TEST_MODE_SWEEP_RESULT_STEP_MAX 19
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
@@ -71,6 +134,80 @@ static uint8_t          test_mode_hook_id = 0xFF;
 static radio_planner_t* test_mode_rp;
 static lr1_stack_mac_t* lr1_mac_obj = { 0 };
 
+/*!
+ * Packet error rate test run, the statistics are kept after the end of the run until the next one
+ */
+typedef struct test_mode_per_s
+{
+    bool     is_running;
+    bool     is_rx;
+    uint16_t packet_nb;    // packets to send, or sent by the transmitter
+    uint16_t gap_ms;       // TX only: delay between the end of a packet and the start of the next one
+    uint16_t done_nb;      // packets sent or received
+    uint16_t error_nb;     // RX only: header or CRC errors
+    uint16_t last_seq;     // RX only: highest sequence number received
+    uint32_t first_ms;     // end of the first packet
+    uint32_t last_ms;      // end of the last packet
+    uint32_t gap_min_ms;   // shortest time between the end of two consecutive packets
+    uint32_t gap_max_ms;   // longest time between the end of two consecutive packets
+    int32_t  rssi_sum;     // RX only: sum of the packets RSSI [dBm]
+    int32_t  snr_sum;      // RX only: sum of the packets SNR [dB]
+    uint16_t rssi_hist[TEST_MODE_PER_HIST_BINS];
+    uint16_t snr_hist[TEST_MODE_PER_HIST_BINS];
+} test_mode_per_t;
+
+static test_mode_per_t test_mode_per;
+static uint8_t*        test_mode_per_payload = NULL;  // pool block held from test mode start to exit
+
+/*!
+ * Configuration and statistics of one step of a sweep test
+ */
+typedef struct test_mode_sweep_step_s
+{
+    uint8_t  sf;          // host_cmd_test_sf_t
+    uint8_t  bw;          // host_cmd_test_bw_t
+    int8_t   pwr_in_dbm;  // TX only
+    uint16_t toa_ms;      // time on air of a packet
+    uint32_t offset_ms;   // start of the step from the start of the sweep
+    uint16_t done_nb;     // packets sent or received
+    uint16_t error_nb;    // RX only: header or CRC errors
+    int32_t  rssi_sum;    // RX only: sum of the packets RSSI [dBm]
+    int32_t  snr_sum;     // RX only: sum of the packets SNR [dB]
+} test_mode_sweep_step_t;
+
+/*!
+ * Sweep test run, both modems walk the same steps on the schedule of the transmitter
+ */
+typedef struct test_mode_sweep_s
+{
+    bool                   is_running;
+    bool                   is_rx;
+    bool                   is_synced;  // RX only: time base found from a received packet
+    uint8_t                step_nb;
+    uint8_t                step;       // current step
+    uint16_t               packet_nb;  // packets sent in each step
+    uint16_t               seq;        // TX only: sequence number of the next packet
+    uint32_t               start_ms;   // start of the sweep, in the time base of the local RTC
+    test_mode_sweep_step_t steps[TEST_MODE_SWEEP_STEP_MAX];
+} test_mode_sweep_t;
+
+static test_mode_sweep_t test_mode_sweep;
+
+/*!
+ * Frequency hopping continuous transmission, one packet per dwell
+ */
+typedef struct test_mode_hop_s
+{
+    bool     is_running;
+    uint8_t  channel_nb;
+    uint32_t hop;       // index of the next hop since the start
+    uint16_t dwell_ms;  // time between the start of two hops
+    uint32_t start_ms;  // start of the first hop
+    uint32_t freq_in_hz[TEST_MODE_HOP_CHANNEL_MAX];  // hop sequence, repeated
+} test_mode_hop_t;
+
+static test_mode_hop_t test_mode_hop;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
@@ -95,7 +232,7 @@ void test_mode_tx_callback( context_t* context )
     rp_hook_get_id( context->rp, context, &my_hook_id );
     BSP_DBG_TRACE_PRINTF( "TEST mode TX hook id %u\n", my_hook_id );
 
-    rp_radio_params_t radio_params;
+    rp_radio_params_t radio_params = { 0 };
     radio_params.pkt_type                 = RAL_PKT_TYPE_LORA;
     radio_params.tx.lora.bw               = context->params.bw;
     radio_params.tx.lora.cr               = context->params.cr;
@@ -115,6 +252,7 @@ void test_mode_tx_callback( context_t* context )
     rp_task.state            = RP_TASK_STATE_ASAP;
     rp_task.type             = RP_TASK_TYPE_TX_LORA;
     rp_task.start_time_ms    = bsp_rtc_get_time_ms( ) + 2;
+    rp_task.preempt_policy   = RP_TASK_PREEMPT_ABORT;
     uint8_t tx_payload[255]  = { 0 };
 
     rp_task_enqueue( context->rp, &rp_task, tx_payload, context->params.pld_len_in_bytes, &radio_params );
@@ -127,7 +265,7 @@ void test_mode_rx_callback( context_t* context )
     rp_hook_get_id( context->rp, context, &my_hook_id );
     BSP_DBG_TRACE_PRINTF( "------------------------\nTEST mode RX hook id %u\n", my_hook_id );
 
-    rp_radio_params_t radio_params;
+    rp_radio_params_t radio_params = { 0 };
     radio_params.pkt_type                 = RAL_PKT_TYPE_LORA;
     radio_params.rx.lora.bw               = context->params.bw;
     radio_params.rx.lora.cr               = context->params.cr;
@@ -148,6 +286,7 @@ void test_mode_rx_callback( context_t* context )
     rp_task.state            = RP_TASK_STATE_ASAP;
     rp_task.start_time_ms    = bsp_rtc_get_time_ms( ) + 2;
     rp_task.duration_time_ms = 2000;  // toa;
+    rp_task.preempt_policy   = RP_TASK_PREEMPT_ABORT;
 
     int16_t snr  = context->rp->radio_params[my_hook_id].rx.lora_pkt_status.snr_pkt_in_db;
     int16_t rssi = context->rp->radio_params[my_hook_id].rx.lora_pkt_status.rssi_pkt_in_dbm;
@@ -161,6 +300,552 @@ void test_mode_rx_callback( context_t* context )
     rp_task_enqueue( context->rp, &rp_task, rx_payload, context->params.pld_len_in_bytes, &radio_params );
 }
 
+/*!
+ * \brief   Check the LoRa parameters of a test command
+ *
+ * \retval [out]    return                  - modem_return_code_t
+ */
+static modem_return_code_t test_mode_check_lora_params( uint32_t frequency, host_cmd_test_sf_t sf,
+                                                        host_cmd_test_bw_t bw, host_cmd_test_cr_t cr )
+{
+    if( smtc_real_is_valid_rx_frequency( lr1_mac_obj, frequency ) != OKLORAWAN )
+    {
+        BSP_DBG_TRACE_ERROR( " Invalid Frequency %lu\n", frequency );
+        return RC_INVALID;
+    }
+    if( ( sf >= TST_SF_MAX ) || ( bw >= TST_BW_MAX ) || ( cr >= TST_CR_MAX ) )
+    {
+        BSP_DBG_TRACE_ERROR( " Invalid sf %u, bw %u or cr %u\n", sf, bw, cr );
+        return RC_INVALID;
+    }
+    return RC_OK;
+}
+
+/*!
+ * \brief   Index of a value in a histogram of TEST_MODE_PER_HIST_BINS bins, the edge bins are open
+ */
+static uint8_t test_mode_per_hist_bin( int16_t value, int16_t min, int16_t step )
+{
+    if( value < ( min + step ) )
+    {
+        return 0;
+    }
+    const int16_t bin = ( value - min ) / step;
+    return ( bin >= TEST_MODE_PER_HIST_BINS ) ? ( TEST_MODE_PER_HIST_BINS - 1 ) : bin;
+}
+
+/*!
+ * \brief   Account the end of a packet in the inter-packet gap statistics
+ */
+static void test_mode_per_packet_end( uint32_t timestamp_ms )
+{
+    if( test_mode_per.done_nb == 0 )
+    {
+        test_mode_per.first_ms = timestamp_ms;
+    }
+    else
+    {
+        const uint32_t gap_ms = timestamp_ms - test_mode_per.last_ms;
+        test_mode_per.gap_min_ms = MIN( test_mode_per.gap_min_ms, gap_ms );
+        test_mode_per.gap_max_ms = MAX( test_mode_per.gap_max_ms, gap_ms );
+    }
+    test_mode_per.last_ms = timestamp_ms;
+    test_mode_per.done_nb++;
+}
+
+/*!
+ * \brief   Enqueue the next packet of a packet error rate test, its sequence number is the number of packets sent
+ */
+static void test_mode_per_tx_enqueue( context_t* context, uint32_t start_time_ms )
+{
+    rp_radio_params_t radio_params = { 0 };
+    radio_params.pkt_type          = RAL_PKT_TYPE_LORA;
+    radio_params.tx.lora           = context->params;
+
+    test_mode_per_payload[0] = test_mode_per.done_nb >> 8;
+    test_mode_per_payload[1] = test_mode_per.done_nb & 0xFF;
+
+    rp_task_t rp_task;
+    rp_task.hook_id          = test_mode_hook_id;
+    rp_task.duration_time_ms = TEST_MODE_TASK_DURATION_MS;
+    rp_task.state            = RP_TASK_STATE_ASAP;
+    rp_task.type             = RP_TASK_TYPE_TX_LORA;
+    rp_task.start_time_ms    = start_time_ms;
+    rp_task.preempt_policy   = RP_TASK_PREEMPT_ABORT;
+
+    rp_task_enqueue( context->rp, &rp_task, test_mode_per_payload, context->params.pld_len_in_bytes, &radio_params );
+}
+
+/*!
+ * \brief   Enqueue the continuous reception of a packet error rate test
+ */
+static void test_mode_per_rx_enqueue( context_t* context )
+{
+    rp_radio_params_t radio_params = { 0 };
+    radio_params.pkt_type          = RAL_PKT_TYPE_LORA;
+    radio_params.rx.lora           = context->params;
+    radio_params.rx.timeout_in_ms  = 0xFFFFFFFF;
+
+    rp_task_t rp_task;
+    rp_task.hook_id          = test_mode_hook_id;
+    rp_task.type             = RP_TASK_TYPE_RX_LORA;
+    rp_task.state            = RP_TASK_STATE_ASAP;
+    rp_task.start_time_ms    = bsp_rtc_get_time_ms( ) + 2;
+    rp_task.duration_time_ms = TEST_MODE_TASK_DURATION_MS;
+    rp_task.preempt_policy   = RP_TASK_PREEMPT_ABORT;
+
+    rp_task_enqueue( context->rp, &rp_task, rx_payload, context->params.pld_len_in_bytes, &radio_params );
+}
+
+static void test_mode_per_tx_callback( context_t* context )
+{
+    const uint32_t timestamp_ms = context->rp->irq_timestamp_ms[test_mode_hook_id];
+
+    if( context->rp->status[test_mode_hook_id] != RP_STATUS_TX_DONE )
+    {
+        test_mode_per.is_running = false;
+        return;
+    }
+    test_mode_per_packet_end( timestamp_ms );
+    if( test_mode_per.done_nb >= test_mode_per.packet_nb )
+    {
+        test_mode_per.is_running = false;
+        return;
+    }
+    test_mode_per_tx_enqueue( context, timestamp_ms + test_mode_per.gap_ms );
+}
+
+static void test_mode_per_rx_callback( context_t* context )
+{
+    const rp_status_t rp_status = context->rp->status[test_mode_hook_id];
+
+    if( rp_status == RP_STATUS_TASK_ABORTED )
+    {
+        test_mode_per.is_running = false;
+        return;
+    }
+    if( rp_status == RP_STATUS_RX_TIMEOUT )
+    {
+        // continuous reception: only a header or CRC error ends the task this way
+        test_mode_per.error_nb++;
+    }
+    else if( ( rp_status == RP_STATUS_RX_PACKET ) &&
+             ( context->rp->payload_size[test_mode_hook_id] >= TEST_MODE_PER_SEQ_SIZE ) )
+    {
+        const ral_rx_pkt_status_lora_t* pkt_status = &context->rp->radio_params[test_mode_hook_id].rx.lora_pkt_status;
+        const uint16_t                  seq        = ( rx_payload[0] << 8 ) | rx_payload[1];
+
+        test_mode_per_packet_end( context->rp->irq_timestamp_ms[test_mode_hook_id] );
+        test_mode_per.last_seq = MAX( test_mode_per.last_seq, seq );
+        test_mode_per.rssi_sum += pkt_status->rssi_pkt_in_dbm;
+        test_mode_per.snr_sum += pkt_status->snr_pkt_in_db;
+        test_mode_per.rssi_hist[test_mode_per_hist_bin( pkt_status->rssi_pkt_in_dbm, TEST_MODE_PER_RSSI_MIN,
+                                                        TEST_MODE_PER_RSSI_STEP )]++;
+        test_mode_per.snr_hist[test_mode_per_hist_bin( pkt_status->snr_pkt_in_db, TEST_MODE_PER_SNR_MIN,
+                                                       TEST_MODE_PER_SNR_STEP )]++;
+        if( seq >= ( test_mode_per.packet_nb - 1 ) )
+        {
+            // last packet of the run
+            test_mode_per.is_running = false;
+            return;
+        }
+    }
+    test_mode_per_rx_enqueue( context );
+}
+
+/*!
+ * \brief   Start a packet error rate test run, the previous statistics are dropped
+ *
+ * \retval [out]    return                  - modem_return_code_t
+ */
+static modem_return_code_t test_mode_per_start( uint32_t frequency, int8_t pwr_in_dbm, host_cmd_test_sf_t sf,
+                                                host_cmd_test_bw_t bw, host_cmd_test_cr_t cr, uint8_t payload_length,
+                                                uint16_t packet_nb, uint16_t gap_ms, bool is_rx )
+{
+    modem_return_code_t return_code = test_mode_check_lora_params( frequency, sf, bw, cr );
+    if( return_code != RC_OK )
+    {
+        return return_code;
+    }
+    if( ( payload_length < TEST_MODE_PER_SEQ_SIZE ) || ( packet_nb == 0 ) )
+    {
+        BSP_DBG_TRACE_ERROR( " Invalid length %u or packet number %u\n", payload_length, packet_nb );
+        return RC_INVALID;
+    }
+
+    ral_params_lora_t params;
+    params.freq_in_hz       = frequency;
+    params.pwr_in_dbm       = pwr_in_dbm;
+    params.sf               = ( ral_lora_sf_t ) host_cmd_test_sf_convert[sf];
+    params.bw               = ( ral_lora_bw_t ) host_cmd_test_bw_convert[bw];
+    params.cr               = ( ral_lora_cr_t ) host_cmd_test_cr_convert[cr];
+    params.pld_len_in_bytes = payload_length;
+    params.pbl_len_in_symb  = 8;
+    params.crc_is_on        = true;
+    params.invert_iq_is_on  = false;
+    params.pld_is_fix       = false;
+    params.symb_nb_timeout  = 8;
+    params.sync_word        = smtc_real_sync_word_get( lr1_mac_obj );
+
+    context_test.params = params;
+    context_test.rp     = test_mode_rp;
+
+    rp_task_abort( test_mode_rp, test_mode_hook_id );
+    if( ral_init( test_mode_rp->ral ) != RAL_STATUS_OK )
+    {
+        return RC_FAIL;
+    }
+
+    test_mode_sweep.is_running = false;
+    test_mode_hop.is_running   = false;
+    memset( &test_mode_per, 0, sizeof( test_mode_per ) );
+    test_mode_per.is_running = true;
+    test_mode_per.is_rx      = is_rx;
+    test_mode_per.packet_nb  = packet_nb;
+    test_mode_per.gap_ms     = gap_ms;
+    test_mode_per.gap_min_ms = UINT32_MAX;
+
+    if( is_rx == true )
+    {
+        rp_hook_init( test_mode_rp, test_mode_hook_id, ( void ( * )( void* ) )( test_mode_per_rx_callback ),
+                      &context_test );
+        test_mode_per_rx_enqueue( &context_test );
+    }
+    else
+    {
+        for( uint16_t i = TEST_MODE_PER_SEQ_SIZE; i < payload_length; i++ )
+        {
+            test_mode_per_payload[i] = i;
+        }
+        rp_hook_init( test_mode_rp, test_mode_hook_id, ( void ( * )( void* ) )( test_mode_per_tx_callback ),
+                      &context_test );
+        test_mode_per_tx_enqueue( &context_test, bsp_rtc_get_time_ms( ) + 2 );
+    }
+    return RC_OK;
+}
+
+/*!
+ * \brief   Time between the start of two consecutive packets of a sweep step
+ */
+static uint32_t test_mode_sweep_period_ms( const test_mode_sweep_step_t* step )
+{
+    return step->toa_ms + TEST_MODE_SWEEP_GAP_MS;
+}
+
+/*!
+ * \brief   Set the radio parameters of the current sweep step in the test context
+ */
+static void test_mode_sweep_set_params( context_t* context )
+{
+    const test_mode_sweep_step_t* step = &test_mode_sweep.steps[test_mode_sweep.step];
+
+    context->params.sf         = ( ral_lora_sf_t ) host_cmd_test_sf_convert[step->sf];
+    context->params.bw         = ( ral_lora_bw_t ) host_cmd_test_bw_convert[step->bw];
+    context->params.pwr_in_dbm = step->pwr_in_dbm;
+}
+
+/*!
+ * \brief   Enqueue the next packet of a sweep test at its time in the schedule, the packets already missed are
+ *          skipped
+ *
+ * \retval [out]    return                  - false when the sweep is over
+ */
+static bool test_mode_sweep_tx_enqueue( context_t* context )
+{
+    const uint32_t earliest_ms = bsp_rtc_get_time_ms( ) + RP_MARGIN_DELAY + 2;
+    uint32_t       start_ms;
+
+    do
+    {
+        if( test_mode_sweep.seq >= test_mode_sweep.packet_nb )
+        {
+            test_mode_sweep.seq = 0;
+            test_mode_sweep.step++;
+        }
+        if( test_mode_sweep.step >= test_mode_sweep.step_nb )
+        {
+            return false;
+        }
+        const test_mode_sweep_step_t* step = &test_mode_sweep.steps[test_mode_sweep.step];
+
+        start_ms =
+            test_mode_sweep.start_ms + step->offset_ms + ( test_mode_sweep.seq * test_mode_sweep_period_ms( step ) );
+        if( ( int32_t )( start_ms - earliest_ms ) < 0 )
+        {
+            test_mode_sweep.seq++;
+        }
+    } while( ( int32_t )( start_ms - earliest_ms ) < 0 );
+
+    test_mode_sweep_set_params( context );
+
+    rp_radio_params_t radio_params = { 0 };
+    radio_params.pkt_type          = RAL_PKT_TYPE_LORA;
+    radio_params.tx.lora           = context->params;
+
+    test_mode_per_payload[0] = test_mode_sweep.step;
+    test_mode_per_payload[1] = test_mode_sweep.seq >> 8;
+    test_mode_per_payload[2] = test_mode_sweep.seq & 0xFF;
+
+    rp_task_t rp_task;
+    rp_task.hook_id          = test_mode_hook_id;
+    rp_task.duration_time_ms = test_mode_sweep.steps[test_mode_sweep.step].toa_ms + RP_MARGIN_DELAY;
+    rp_task.state            = RP_TASK_STATE_SCHEDULE;
+    rp_task.type             = RP_TASK_TYPE_TX_LORA;
+    rp_task.start_time_ms    = start_ms;
+    rp_task.preempt_policy   = RP_TASK_PREEMPT_ABORT;
+
+    rp_task_enqueue( context->rp, &rp_task, test_mode_per_payload, context->params.pld_len_in_bytes, &radio_params );
+    return true;
+}
+
+/*!
+ * \brief   Enqueue the reception of the current sweep step
+ * \remark  Continuous until the time base is found, then until the end of the step window. The window of a step
+ *          spans the schedule of its packets and half of the guard time on each side.
+ *
+ * \retval [out]    return                  - false when the sweep is over
+ */
+static bool test_mode_sweep_rx_enqueue( context_t* context, uint32_t now_ms )
+{
+    uint32_t window_start_ms = now_ms;
+    uint32_t window_end_ms   = 0;
+
+    if( test_mode_sweep.is_synced == true )
+    {
+        // move to the step whose window has not ended yet
+        do
+        {
+            const test_mode_sweep_step_t* step = &test_mode_sweep.steps[test_mode_sweep.step];
+
+            window_start_ms = test_mode_sweep.start_ms + step->offset_ms - ( TEST_MODE_SWEEP_GUARD_MS / 2 );
+            window_end_ms   = window_start_ms + ( test_mode_sweep.packet_nb * test_mode_sweep_period_ms( step ) ) +
+                            TEST_MODE_SWEEP_GUARD_MS;
+            if( ( int32_t )( window_end_ms - now_ms ) <= RP_MARGIN_DELAY )
+            {
+                test_mode_sweep.step++;
+            }
+        } while( ( ( int32_t )( window_end_ms - now_ms ) <= RP_MARGIN_DELAY ) &&
+                 ( test_mode_sweep.step < test_mode_sweep.step_nb ) );
+
+        if( test_mode_sweep.step >= test_mode_sweep.step_nb )
+        {
+            return false;
+        }
+    }
+    test_mode_sweep_set_params( context );
+
+    rp_radio_params_t radio_params = { 0 };
+    radio_params.pkt_type          = RAL_PKT_TYPE_LORA;
+    radio_params.rx.lora           = context->params;
+
+    rp_task_t rp_task;
+    rp_task.hook_id          = test_mode_hook_id;
+    rp_task.type             = RP_TASK_TYPE_RX_LORA;
+    rp_task.duration_time_ms = TEST_MODE_TASK_DURATION_MS;
+    rp_task.preempt_policy   = RP_TASK_PREEMPT_ABORT;
+
+    if( test_mode_sweep.is_synced == false )
+    {
+        radio_params.rx.timeout_in_ms = 0xFFFFFFFF;
+        rp_task.state                 = RP_TASK_STATE_ASAP;
+        rp_task.start_time_ms         = now_ms + 2;
+    }
+    else if( ( int32_t )( window_start_ms - now_ms ) > RP_MARGIN_DELAY )
+    {
+        radio_params.rx.timeout_in_ms = window_end_ms - window_start_ms;
+        rp_task.state                 = RP_TASK_STATE_SCHEDULE;
+        rp_task.start_time_ms         = window_start_ms;
+    }
+    else
+    {
+        radio_params.rx.timeout_in_ms = window_end_ms - now_ms - 2;
+        rp_task.state                 = RP_TASK_STATE_ASAP;
+        rp_task.start_time_ms         = now_ms + 2;
+    }
+
+    rp_task_enqueue( context->rp, &rp_task, rx_payload, context->params.pld_len_in_bytes, &radio_params );
+    return true;
+}
+
+static void test_mode_sweep_tx_callback( context_t* context )
+{
+    if( test_mode_sweep.is_running == false )
+    {
+        return;
+    }
+    if( context->rp->status[test_mode_hook_id] != RP_STATUS_TX_DONE )
+    {
+        // preempted: the schedule of the receiver cannot be followed anymore
+        test_mode_sweep.is_running = false;
+        return;
+    }
+    test_mode_sweep.steps[test_mode_sweep.step].done_nb++;
+    test_mode_sweep.seq++;
+    test_mode_sweep.is_running = test_mode_sweep_tx_enqueue( context );
+}
+
+static void test_mode_sweep_rx_callback( context_t* context )
+{
+    const rp_status_t rp_status    = context->rp->status[test_mode_hook_id];
+    const uint32_t    timestamp_ms = context->rp->irq_timestamp_ms[test_mode_hook_id];
+
+    if( test_mode_sweep.is_running == false )
+    {
+        return;
+    }
+    if( rp_status == RP_STATUS_TASK_ABORTED )
+    {
+        test_mode_sweep.is_running = false;
+        return;
+    }
+
+    test_mode_sweep_step_t* step = &test_mode_sweep.steps[test_mode_sweep.step];
+
+    if( ( rp_status == RP_STATUS_RX_PACKET ) &&
+        ( context->rp->payload_size[test_mode_hook_id] >= TEST_MODE_SWEEP_HEADER_SIZE ) &&
+        ( rx_payload[0] == test_mode_sweep.step ) )
+    {
+        const ral_rx_pkt_status_lora_t* pkt_status = &context->rp->radio_params[test_mode_hook_id].rx.lora_pkt_status;
+        const uint16_t                  seq        = ( rx_payload[1] << 8 ) | rx_payload[2];
+
+        if( test_mode_sweep.is_synced == false )
+        {
+            // the packet ends one time on air after its scheduled start
+            test_mode_sweep.start_ms =
+                timestamp_ms - step->toa_ms - step->offset_ms - ( seq * test_mode_sweep_period_ms( step ) );
+            test_mode_sweep.is_synced = true;
+        }
+        step->done_nb++;
+        step->rssi_sum += pkt_status->rssi_pkt_in_dbm;
+        step->snr_sum += pkt_status->snr_pkt_in_db;
+    }
+    else if( rp_status == RP_STATUS_RX_TIMEOUT )
+    {
+        // header or CRC error, unless the step window is over
+        const uint32_t window_end_ms = test_mode_sweep.start_ms + step->offset_ms +
+                                       ( test_mode_sweep.packet_nb * test_mode_sweep_period_ms( step ) ) +
+                                       ( TEST_MODE_SWEEP_GUARD_MS / 2 );
+        if( ( test_mode_sweep.is_synced == false ) ||
+            ( ( int32_t )( window_end_ms - timestamp_ms ) > RP_MARGIN_DELAY ) )
+        {
+            step->error_nb++;
+        }
+    }
+    test_mode_sweep.is_running = test_mode_sweep_rx_enqueue( context, bsp_rtc_get_time_ms( ) );
+}
+
+/*!
+ * \brief   Enqueue the packet of the next hop at the start of its dwell, the hops already missed are skipped
+ * \remark  Only the frequency differs from the previous packet: the RAL setup of the radio planner sends the
+ *          frequency alone, the other registers are known to be programmed already.
+ */
+static void test_mode_hop_enqueue( context_t* context )
+{
+    const uint32_t now_ms   = bsp_rtc_get_time_ms( );
+    uint32_t       start_ms = test_mode_hop.start_ms + ( test_mode_hop.hop * test_mode_hop.dwell_ms );
+
+    if( ( int32_t )( start_ms - now_ms ) <= RP_MARGIN_DELAY )
+    {
+        test_mode_hop.hop += ( ( now_ms - start_ms ) / test_mode_hop.dwell_ms ) + 1;
+        start_ms = test_mode_hop.start_ms + ( test_mode_hop.hop * test_mode_hop.dwell_ms );
+    }
+    context->params.freq_in_hz = test_mode_hop.freq_in_hz[test_mode_hop.hop % test_mode_hop.channel_nb];
+
+    rp_radio_params_t radio_params = { 0 };
+    radio_params.pkt_type          = RAL_PKT_TYPE_LORA;
+    radio_params.tx.lora           = context->params;
+
+    rp_task_t rp_task;
+    rp_task.hook_id          = test_mode_hook_id;
+    rp_task.duration_time_ms = test_mode_hop.dwell_ms - TEST_MODE_HOP_RETUNE_MS;
+    rp_task.state            = RP_TASK_STATE_SCHEDULE;
+    rp_task.type             = RP_TASK_TYPE_TX_LORA;
+    rp_task.start_time_ms    = start_ms;
+    rp_task.preempt_policy   = RP_TASK_PREEMPT_ABORT;
+
+    rp_task_enqueue( context->rp, &rp_task, test_mode_per_payload, context->params.pld_len_in_bytes, &radio_params );
+}
+
+static void test_mode_hop_callback( context_t* context )
+{
+    if( test_mode_hop.is_running == false )
+    {
+        return;
+    }
+    if( context->rp->status[test_mode_hook_id] != RP_STATUS_TX_DONE )
+    {
+        test_mode_hop.is_running = false;
+        return;
+    }
+    test_mode_hop.hop++;
+    test_mode_hop_enqueue( context );
+}
+
+/*!
+ * \brief   Run one operation of the SPI benchmark on the radio
+ *
+ * \retval [out]    return                  - false on a radio driver error
+ */
+static bool test_mode_spi_bench_run( uint8_t op, const void* radio_context )
+{
+    uint8_t reg = 0;
+
+#if defined( SX1280 )
+    sx1280_irq_mask_t irq = 0;
+    switch( op )
+    {
+    case 0:
+        return sx1280_read_register( radio_context, TEST_MODE_SPI_BENCH_REG_ADDR, &reg, 1 ) == SX1280_STATUS_OK;
+    case 1:
+        return sx1280_write_buffer( radio_context, 0, test_mode_per_payload, 16 ) == SX1280_STATUS_OK;
+    case 2:
+        return sx1280_write_buffer( radio_context, 0, test_mode_per_payload, 64 ) == SX1280_STATUS_OK;
+    case 3:
+        return sx1280_write_buffer( radio_context, 0, test_mode_per_payload, 255 ) == SX1280_STATUS_OK;
+    case 4:
+        return sx1280_wakeup( radio_context ) == SX1280_STATUS_OK;
+    default:
+        return sx1280_get_and_clear_irq_status( radio_context, &irq ) == SX1280_STATUS_OK;
+    }
+#elif defined( SX126X )
+    sx126x_irq_mask_t irq = 0;
+    switch( op )
+    {
+    case 0:
+        return sx126x_read_register( radio_context, TEST_MODE_SPI_BENCH_REG_ADDR, &reg, 1 ) == SX126X_STATUS_OK;
+    case 1:
+        return sx126x_write_buffer( radio_context, 0, test_mode_per_payload, 16 ) == SX126X_STATUS_OK;
+    case 2:
+        return sx126x_write_buffer( radio_context, 0, test_mode_per_payload, 64 ) == SX126X_STATUS_OK;
+    case 3:
+        return sx126x_write_buffer( radio_context, 0, test_mode_per_payload, 255 ) == SX126X_STATUS_OK;
+    case 4:
+        return sx126x_wakeup( radio_context ) == SX126X_STATUS_OK;
+    default:
+        return sx126x_get_and_clear_irq_status( radio_context, &irq ) == SX126X_STATUS_OK;
+    }
+#else
+#error "Please select radio board.."
+#endif
+}
+
+/*!
+ * \brief   Put the radio to sleep ahead of a timed wake-up, the data are retained
+ *
+ * \retval [out]    return                  - false on a radio driver error
+ */
+static bool test_mode_spi_bench_sleep( const void* radio_context )
+{
+#if defined( SX1280 )
+    const bool is_ok = sx1280_set_sleep( radio_context, SX1280_SLEEP_CFG_DATA_RETENTION ) == SX1280_STATUS_OK;
+#elif defined( SX126X )
+    const bool is_ok = sx126x_set_sleep( radio_context, SX126X_SLEEP_CFG_WARM_START ) == SX126X_STATUS_OK;
+#endif
+    // the radio only accepts the wake-up once it is fully asleep
+    bsp_mcu_wait_us( 500 );
+    return is_ok;
+}
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -173,6 +858,15 @@ uint8_t test_mode_enabled_is( void )
 
 modem_return_code_t test_mode_start( void )
 {
+    if( test_mode_per_payload == NULL )
+    {
+        test_mode_per_payload = modem_pool_alloc( );
+        if( test_mode_per_payload == NULL )
+        {
+            BSP_DBG_TRACE_ERROR( "TST MODE: no free buffer in the modem pool\n" );
+            return RC_BUSY;
+        }
+    }
     test_mode_enable( );
     BSP_DBG_TRACE_INFO( "TST MODE: START\n" );
 
@@ -186,6 +880,9 @@ modem_return_code_t test_mode_start( void )
 
 modem_return_code_t test_mode_nop( void )
 {
+    test_mode_per.is_running   = false;
+    test_mode_sweep.is_running = false;
+    test_mode_hop.is_running   = false;
     rp_task_abort( test_mode_rp, test_mode_hook_id );
     if( ral_init( test_mode_rp->ral ) != RAL_STATUS_OK )
     {
@@ -262,6 +959,105 @@ modem_return_code_t test_mode_tx( uint32_t frequency, int8_t pwr_in_dbm, host_cm
     return RC_OK;
 }
 
+modem_return_code_t test_mode_tx_hop( int8_t pwr_in_dbm, host_cmd_test_sf_t sf, host_cmd_test_bw_t bw,
+                                      host_cmd_test_cr_t cr, uint16_t dwell_ms )
+{
+    BSP_DBG_TRACE_PRINTF( "Tx hop - Power:%d, sf:%u, bw:%u, cr:%u, dwell:%u\n", pwr_in_dbm, sf, bw, cr, dwell_ms );
+
+    if( ( sf == TST_FSK ) || ( sf >= TST_SF_MAX ) || ( bw >= TST_BW_MAX ) || ( cr >= TST_CR_MAX ) ||
+        ( dwell_ms <= TEST_MODE_HOP_RETUNE_MS ) )
+    {
+        BSP_DBG_TRACE_ERROR( " Invalid hop parameters\n" );
+        return RC_INVALID;
+    }
+
+    ral_params_lora_t params;
+    params.freq_in_hz      = 0;
+    params.pwr_in_dbm      = pwr_in_dbm;
+    params.sf              = ( ral_lora_sf_t ) host_cmd_test_sf_convert[sf];
+    params.bw              = ( ral_lora_bw_t ) host_cmd_test_bw_convert[bw];
+    params.cr              = ( ral_lora_cr_t ) host_cmd_test_cr_convert[cr];
+    params.pbl_len_in_symb = 8;
+    params.crc_is_on       = true;
+    params.invert_iq_is_on = false;
+    params.pld_is_fix      = false;
+    params.symb_nb_timeout = 0;
+    params.sync_word       = smtc_real_sync_word_get( lr1_mac_obj );
+
+    // longest packet which leaves the time to retune before the end of the dwell
+    uint16_t length_min = 0;
+    uint16_t length_max = 255;
+    while( length_min < length_max )
+    {
+        uint32_t toa_ms         = 0;
+        params.pld_len_in_bytes = ( length_min + length_max + 1 ) / 2;
+        if( ral_get_lora_time_on_air_in_ms( test_mode_rp->ral, &params, &toa_ms ) != RAL_STATUS_OK )
+        {
+            return RC_INVALID;
+        }
+        if( toa_ms <= ( uint32_t )( dwell_ms - TEST_MODE_HOP_RETUNE_MS ) )
+        {
+            length_min = params.pld_len_in_bytes;
+        }
+        else
+        {
+            length_max = params.pld_len_in_bytes - 1;
+        }
+    }
+    if( length_min == 0 )
+    {
+        BSP_DBG_TRACE_ERROR( " Dwell of %u ms too short for a packet\n", dwell_ms );
+        return RC_INVALID;
+    }
+    params.pld_len_in_bytes = length_min;
+
+    // hop sequence: the enabled channels in a random order, each one used once per cycle
+    memset( &test_mode_hop, 0, sizeof( test_mode_hop ) );
+    for( uint8_t i = 0; i < TEST_MODE_HOP_CHANNEL_MAX; i++ )
+    {
+        if( smtc_real_channel_enabled_get( lr1_mac_obj, i ) == CHANNEL_ENABLED )
+        {
+            test_mode_hop.freq_in_hz[test_mode_hop.channel_nb++] = smtc_real_tx_frequency_channel_get( lr1_mac_obj, i );
+        }
+    }
+    if( test_mode_hop.channel_nb == 0 )
+    {
+        BSP_DBG_TRACE_ERROR( " No channel enabled\n" );
+        return RC_FAIL;
+    }
+    for( uint8_t i = test_mode_hop.channel_nb - 1; i > 0; i-- )
+    {
+        const uint8_t  j   = bsp_rng_get_random_in_range( 0, i );
+        const uint32_t tmp = test_mode_hop.freq_in_hz[i];
+
+        test_mode_hop.freq_in_hz[i] = test_mode_hop.freq_in_hz[j];
+        test_mode_hop.freq_in_hz[j] = tmp;
+    }
+    for( uint16_t i = 0; i < params.pld_len_in_bytes; i++ )
+    {
+        test_mode_per_payload[i] = i;
+    }
+
+    context_test.params = params;
+    context_test.rp     = test_mode_rp;
+
+    test_mode_per.is_running   = false;
+    test_mode_sweep.is_running = false;
+    rp_task_abort( test_mode_rp, test_mode_hook_id );
+    if( ral_init( test_mode_rp->ral ) != RAL_STATUS_OK )
+    {
+        return RC_FAIL;
+    }
+
+    test_mode_hop.is_running = true;
+    test_mode_hop.dwell_ms   = dwell_ms;
+    test_mode_hop.start_ms   = bsp_rtc_get_time_ms( ) + RP_MARGIN_DELAY + 2;
+
+    rp_hook_init( test_mode_rp, test_mode_hook_id, ( void ( * )( void* ) )( test_mode_hop_callback ), &context_test );
+    test_mode_hop_enqueue( &context_test );
+    return RC_OK;
+}
+
 modem_return_code_t test_mode_cw( uint32_t frequency, int8_t pwr_in_dbm )
 {
     if( smtc_real_is_valid_rx_frequency( lr1_mac_obj, frequency ) != OKLORAWAN )
@@ -345,6 +1141,344 @@ modem_return_code_t test_mode_rx_cont( uint32_t frequency, host_cmd_test_sf_t sf
     return RC_OK;
 }
 
+modem_return_code_t test_mode_per_tx( uint32_t frequency, int8_t pwr_in_dbm, host_cmd_test_sf_t sf,
+                                      host_cmd_test_bw_t bw, host_cmd_test_cr_t cr, uint8_t payload_length,
+                                      uint16_t packet_nb, uint16_t gap_ms )
+{
+    BSP_DBG_TRACE_PRINTF( "PER Tx - Freq:%lu, Power:%d, length:%u, packets:%u, gap:%u\n", frequency, pwr_in_dbm,
+                          payload_length, packet_nb, gap_ms );
+    return test_mode_per_start( frequency, pwr_in_dbm, sf, bw, cr, payload_length, packet_nb, gap_ms, false );
+}
+
+modem_return_code_t test_mode_per_rx( uint32_t frequency, host_cmd_test_sf_t sf, host_cmd_test_bw_t bw,
+                                      host_cmd_test_cr_t cr, uint8_t payload_length, uint16_t packet_nb )
+{
+    BSP_DBG_TRACE_PRINTF( "PER Rx - Freq:%lu, length:%u, packets:%u\n", frequency, payload_length, packet_nb );
+    return test_mode_per_start( frequency, 0, sf, bw, cr, payload_length, packet_nb, 0, true );
+}
+
+modem_return_code_t test_mode_per_result( uint8_t* buffer, uint8_t* length )
+{
+    test_mode_per_t per;
+    uint8_t*        p = buffer;
+
+    // the radio planner callbacks update the statistics from the radio interrupt bottom half
+    CRITICAL_SECTION_BEGIN( );
+    per = test_mode_per;
+    CRITICAL_SECTION_END( );
+
+    // packets expected by the receiver: up to the highest sequence number received
+    uint16_t expected_nb  = per.done_nb;
+    uint16_t per_permil   = 0;
+    int8_t   rssi_avg_dbm = 0;
+    int8_t   snr_avg_db   = 0;
+    if( ( per.is_rx == true ) && ( per.done_nb > 0 ) )
+    {
+        expected_nb  = MAX( per.last_seq + 1, per.done_nb );
+        per_permil   = ( ( uint32_t )( expected_nb - per.done_nb ) * 1000 ) / expected_nb;
+        rssi_avg_dbm = per.rssi_sum / per.done_nb;
+        snr_avg_db   = per.snr_sum / per.done_nb;
+    }
+
+    // rate and gaps from the end of the first packet to the end of the last one
+    uint16_t pps_centi  = 0;
+    uint16_t gap_min_ms = 0;
+    uint16_t gap_avg_ms = 0;
+    uint16_t gap_max_ms = 0;
+    if( per.done_nb > 1 )
+    {
+        const uint32_t elapsed_ms = per.last_ms - per.first_ms;
+        pps_centi  = ( elapsed_ms > 0 ) ? MIN( ( ( uint32_t )( per.done_nb - 1 ) * 100000 ) / elapsed_ms, 0xFFFF ) : 0;
+        gap_min_ms = MIN( per.gap_min_ms, 0xFFFF );
+        gap_avg_ms = MIN( elapsed_ms / ( per.done_nb - 1 ), 0xFFFF );
+        gap_max_ms = MIN( per.gap_max_ms, 0xFFFF );
+    }
+
+    *p++ = ( per.is_running ? 0x01 : 0x00 ) | ( per.is_rx ? 0x02 : 0x00 );
+    *p++ = per.packet_nb >> 8;
+    *p++ = per.packet_nb & 0xFF;
+    *p++ = per.done_nb >> 8;
+    *p++ = per.done_nb & 0xFF;
+    *p++ = expected_nb >> 8;
+    *p++ = expected_nb & 0xFF;
+    *p++ = per.error_nb >> 8;
+    *p++ = per.error_nb & 0xFF;
+    *p++ = per_permil >> 8;
+    *p++ = per_permil & 0xFF;
+    *p++ = pps_centi >> 8;
+    *p++ = pps_centi & 0xFF;
+    *p++ = gap_min_ms >> 8;
+    *p++ = gap_min_ms & 0xFF;
+    *p++ = gap_avg_ms >> 8;
+    *p++ = gap_avg_ms & 0xFF;
+    *p++ = gap_max_ms >> 8;
+    *p++ = gap_max_ms & 0xFF;
+    *p++ = ( uint8_t ) rssi_avg_dbm;
+    *p++ = ( uint8_t ) snr_avg_db;
+    for( uint8_t i = 0; i < TEST_MODE_PER_HIST_BINS; i++ )
+    {
+        *p++ = per.rssi_hist[i] >> 8;
+        *p++ = per.rssi_hist[i] & 0xFF;
+    }
+    for( uint8_t i = 0; i < TEST_MODE_PER_HIST_BINS; i++ )
+    {
+        *p++ = per.snr_hist[i] >> 8;
+        *p++ = per.snr_hist[i] & 0xFF;
+    }
+
+    *length = p - buffer;
+    return RC_OK;
+}
+
+modem_return_code_t test_mode_sweep_start( bool is_rx, uint32_t frequency, uint16_t sf_mask, uint8_t bw_mask,
+                                           host_cmd_test_cr_t cr, int8_t pwr_min_in_dbm, int8_t pwr_max_in_dbm,
+                                           uint8_t pwr_step_in_db, uint8_t payload_length, uint16_t packet_nb )
+{
+    BSP_DBG_TRACE_PRINTF( "Sweep %s - Freq:%lu, sf:0x%x, bw:0x%x, power:%d..%d, length:%u, packets:%u\n",
+                          ( is_rx == true ) ? "Rx" : "Tx", frequency, sf_mask, bw_mask, pwr_min_in_dbm,
+                          pwr_max_in_dbm, payload_length, packet_nb );
+
+    modem_return_code_t return_code = test_mode_check_lora_params( frequency, TST_SF_7, TST_BW_125, cr );
+    if( return_code != RC_OK )
+    {
+        return return_code;
+    }
+    if( ( payload_length < TEST_MODE_SWEEP_HEADER_SIZE ) || ( packet_nb == 0 ) ||
+        ( ( sf_mask & ( 1 << TST_FSK ) ) != 0 ) || ( ( sf_mask >> TST_SF_MAX ) != 0 ) ||
+        ( ( bw_mask >> TST_BW_MAX ) != 0 ) || ( pwr_max_in_dbm < pwr_min_in_dbm ) )
+    {
+        BSP_DBG_TRACE_ERROR( " Invalid sweep parameters\n" );
+        return RC_INVALID;
+    }
+
+    ral_params_lora_t params;
+    params.freq_in_hz       = frequency;
+    params.cr               = ( ral_lora_cr_t ) host_cmd_test_cr_convert[cr];
+    params.pld_len_in_bytes = payload_length;
+    params.pbl_len_in_symb  = 8;
+    params.crc_is_on        = true;
+    params.invert_iq_is_on  = false;
+    params.pld_is_fix       = false;
+    params.symb_nb_timeout  = 8;
+    params.sync_word        = smtc_real_sync_word_get( lr1_mac_obj );
+
+    // steps by spreading factor, then bandwidth, then power
+    memset( &test_mode_sweep, 0, sizeof( test_mode_sweep ) );
+    uint32_t offset_ms = 0;
+    for( uint8_t sf = 0; sf < TST_SF_MAX; sf++ )
+    {
+        for( uint8_t bw = 0; ( ( sf_mask & ( 1 << sf ) ) != 0 ) && ( bw < TST_BW_MAX ); bw++ )
+        {
+            if( ( bw_mask & ( 1 << bw ) ) == 0 )
+            {
+                continue;
+            }
+            params.sf = ( ral_lora_sf_t ) host_cmd_test_sf_convert[sf];
+            params.bw = ( ral_lora_bw_t ) host_cmd_test_bw_convert[bw];
+
+            uint32_t toa_ms = 0;
+            if( ral_get_lora_time_on_air_in_ms( test_mode_rp->ral, &params, &toa_ms ) != RAL_STATUS_OK )
+            {
+                BSP_DBG_TRACE_ERROR( " Unsupported sf %u with bw %u\n", sf, bw );
+                return RC_INVALID;
+            }
+
+            int16_t pwr = pwr_min_in_dbm;
+            do
+            {
+                if( test_mode_sweep.step_nb >= TEST_MODE_SWEEP_STEP_MAX )
+                {
+                    BSP_DBG_TRACE_ERROR( " More than %u sweep steps\n", TEST_MODE_SWEEP_STEP_MAX );
+                    return RC_INVALID;
+                }
+                test_mode_sweep_step_t* step = &test_mode_sweep.steps[test_mode_sweep.step_nb++];
+                step->sf                     = sf;
+                step->bw                     = bw;
+                step->pwr_in_dbm             = pwr;
+                step->toa_ms                 = MIN( toa_ms, 0xFFFF );
+                step->offset_ms              = offset_ms;
+                offset_ms += ( packet_nb * test_mode_sweep_period_ms( step ) ) + TEST_MODE_SWEEP_GUARD_MS;
+                pwr += pwr_step_in_db;
+            } while( ( pwr_step_in_db > 0 ) && ( pwr <= pwr_max_in_dbm ) );
+        }
+    }
+    if( test_mode_sweep.step_nb == 0 )
+    {
+        BSP_DBG_TRACE_ERROR( " Empty sweep\n" );
+        return RC_INVALID;
+    }
+
+    context_test.params = params;
+    context_test.rp     = test_mode_rp;
+
+    test_mode_per.is_running = false;
+    test_mode_hop.is_running = false;
+    rp_task_abort( test_mode_rp, test_mode_hook_id );
+    if( ral_init( test_mode_rp->ral ) != RAL_STATUS_OK )
+    {
+        return RC_FAIL;
+    }
+
+    test_mode_sweep.is_running = true;
+    test_mode_sweep.is_rx      = is_rx;
+    test_mode_sweep.packet_nb  = packet_nb;
+
+    if( is_rx == true )
+    {
+        rp_hook_init( test_mode_rp, test_mode_hook_id, ( void ( * )( void* ) )( test_mode_sweep_rx_callback ),
+                      &context_test );
+        test_mode_sweep_rx_enqueue( &context_test, bsp_rtc_get_time_ms( ) );
+    }
+    else
+    {
+        for( uint16_t i = TEST_MODE_SWEEP_HEADER_SIZE; i < payload_length; i++ )
+        {
+            test_mode_per_payload[i] = i;
+        }
+        test_mode_sweep.start_ms = bsp_rtc_get_time_ms( ) + TEST_MODE_SWEEP_START_DELAY_MS;
+        rp_hook_init( test_mode_rp, test_mode_hook_id, ( void ( * )( void* ) )( test_mode_sweep_tx_callback ),
+                      &context_test );
+        test_mode_sweep_tx_enqueue( &context_test );
+    }
+    return RC_OK;
+}
+
+modem_return_code_t test_mode_sweep_result( uint8_t first_step, uint8_t* buffer, uint8_t* length )
+{
+    uint8_t* p = buffer;
+
+    CRITICAL_SECTION_BEGIN( );
+    const bool    is_running = test_mode_sweep.is_running;
+    const uint8_t step_nb    = test_mode_sweep.step_nb;
+    const uint8_t current    = test_mode_sweep.step;
+    CRITICAL_SECTION_END( );
+
+    *p++ = ( is_running ? 0x01 : 0x00 ) | ( test_mode_sweep.is_rx ? 0x02 : 0x00 ) |
+           ( test_mode_sweep.is_synced ? 0x04 : 0x00 );
+    *p++ = step_nb;
+    *p++ = current;
+    *p++ = test_mode_sweep.packet_nb >> 8;
+    *p++ = test_mode_sweep.packet_nb & 0xFF;
+
+    for( uint8_t i = first_step; ( i < step_nb ) && ( i < ( first_step + TEST_MODE_SWEEP_RESULT_STEP_MAX ) ); i++ )
+    {
+        test_mode_sweep_step_t step;
+
+        CRITICAL_SECTION_BEGIN( );
+        step = test_mode_sweep.steps[i];
+        CRITICAL_SECTION_END( );
+
+        // the packet error rate is only known once the step is over
+        uint16_t per_permil   = 0xFFFF;
+        int8_t   rssi_avg_dbm = 0;
+        int8_t   snr_avg_db   = 0;
+        if( ( i < current ) || ( is_running == false ) )
+        {
+            per_permil = ( ( uint32_t )( test_mode_sweep.packet_nb - MIN( step.done_nb, test_mode_sweep.packet_nb ) ) *
+                           1000 ) /
+                         test_mode_sweep.packet_nb;
+        }
+        if( step.done_nb > 0 )
+        {
+            rssi_avg_dbm = step.rssi_sum / step.done_nb;
+            snr_avg_db   = step.snr_sum / step.done_nb;
+        }
+
+        *p++ = step.sf;
+        *p++ = step.bw;
+        *p++ = ( uint8_t ) step.pwr_in_dbm;
+        *p++ = step.toa_ms >> 8;
+        *p++ = step.toa_ms & 0xFF;
+        *p++ = step.done_nb >> 8;
+        *p++ = step.done_nb & 0xFF;
+        *p++ = step.error_nb >> 8;
+        *p++ = step.error_nb & 0xFF;
+        *p++ = per_permil >> 8;
+        *p++ = per_permil & 0xFF;
+        *p++ = ( uint8_t ) rssi_avg_dbm;
+        *p++ = ( uint8_t ) snr_avg_db;
+    }
+
+    *length = p - buffer;
+    return RC_OK;
+}
+
+modem_return_code_t test_mode_spi_bench( uint16_t iteration_nb, uint8_t* buffer, uint8_t* length )
+{
+    const void* radio_context = test_mode_rp->ral->context;
+    uint32_t    min[TEST_MODE_SPI_BENCH_OP_NB];
+    uint32_t    max[TEST_MODE_SPI_BENCH_OP_NB] = { 0 };
+    uint32_t    sum[TEST_MODE_SPI_BENCH_OP_NB] = { 0 };
+    uint8_t*    p                              = buffer;
+
+    if( ( iteration_nb == 0 ) || ( iteration_nb > TEST_MODE_SPI_BENCH_ITERATION_MAX ) )
+    {
+        BSP_DBG_TRACE_ERROR( " Invalid iteration number %u\n", iteration_nb );
+        return RC_INVALID;
+    }
+
+    // nothing else may use the radio, and the clock must not change during a measurement
+    test_mode_per.is_running   = false;
+    test_mode_sweep.is_running = false;
+    test_mode_hop.is_running   = false;
+    rp_task_abort( test_mode_rp, test_mode_hook_id );
+    bsp_mcu_clock_boost_request( );
+
+    for( uint16_t i = 0; i < 255; i++ )
+    {
+        test_mode_per_payload[i] = i;
+    }
+    for( uint8_t op = 0; op < TEST_MODE_SPI_BENCH_OP_NB; op++ )
+    {
+        min[op] = UINT32_MAX;
+        for( uint16_t n = 0; n < iteration_nb; n++ )
+        {
+            if( ( op == 4 ) && ( test_mode_spi_bench_sleep( radio_context ) == false ) )
+            {
+                bsp_mcu_clock_boost_release( );
+                return RC_FAIL;
+            }
+
+            const uint32_t start  = bsp_mcu_get_cycle_count( );
+            const bool     is_ok  = test_mode_spi_bench_run( op, radio_context );
+            const uint32_t cycles = bsp_mcu_get_cycle_count( ) - start;
+
+            if( is_ok == false )
+            {
+                bsp_mcu_clock_boost_release( );
+                return RC_FAIL;
+            }
+            min[op] = MIN( min[op], cycles );
+            max[op] = MAX( max[op], cycles );
+            sum[op] += cycles;
+        }
+    }
+
+    const uint32_t clock_hz = bsp_mcu_get_core_clock_hz( );
+    bsp_mcu_clock_boost_release( );
+
+    *p++ = clock_hz >> 24;
+    *p++ = clock_hz >> 16;
+    *p++ = clock_hz >> 8;
+    *p++ = clock_hz & 0xFF;
+    for( uint8_t op = 0; op < TEST_MODE_SPI_BENCH_OP_NB; op++ )
+    {
+        const uint32_t values[3] = { min[op], sum[op] / iteration_nb, max[op] };
+        for( uint8_t i = 0; i < 3; i++ )
+        {
+            *p++ = values[i] >> 24;
+            *p++ = values[i] >> 16;
+            *p++ = values[i] >> 8;
+            *p++ = values[i] & 0xFF;
+        }
+    }
+    *length = p - buffer;
+
+    BSP_DBG_TRACE_PRINTF( "SPI bench - %u iterations, read register min %lu cycles at %lu Hz\n", iteration_nb, min[0],
+                          clock_hz );
+    return RC_OK;
+}
+
 modem_return_code_t test_mode_radio_reset( void )
 {
     if( ral_init( test_mode_rp->ral ) != RAL_STATUS_OK )
@@ -363,6 +1497,8 @@ modem_return_code_t test_mode_exit( void )
     rp_task_abort( test_mode_rp, test_mode_hook_id );
     lorawan_api_init( test_mode_rp );
     test_mode_disable( );
+    modem_pool_free( test_mode_per_payload );
+    test_mode_per_payload = NULL;
     return RC_OK;
 }
 
@@ -62,6 +62,15 @@ typedef enum test_mode_tx_mode_e
     TEST_MODE_TX_CONTINUE     //!< Continuously transmit packets
 } test_mode_tx_mode_t;
 
+/*!
+ * \typedef test_mode_spi_sub_cmd_t
+ * \brief   Test mode SPI command, first byte of the parameters
+ */
+typedef enum test_mode_spi_sub_cmd_e
+{
+    TEST_MODE_SPI_BENCH = 0x00,  //!< Time the radio accesses, followed by the 16-bit number of iterations
+} test_mode_spi_sub_cmd_t;
+
 /* clang-format off */
 /*!
  * \typedef host_cmd_test_sf_t
@@ -164,6 +173,7 @@ uint8_t test_mode_enabled_is( void );
  * \remark  Test mode can only be activated if the modem has not yet received a command that results
  *          in a radio operation.
  *          Once test mode is active, all other modem commands are disabled.
+ *          The test payload holds a modem pool block until test_mode_exit, RC_BUSY if the pool is exhausted.
  *
  * \retval [out]    return                  - modem_return_code_t
  */
@@ -194,6 +204,22 @@ modem_return_code_t test_mode_nop( void );
 modem_return_code_t test_mode_tx( uint32_t frequency, int8_t pwr_in_dbm, host_cmd_test_sf_t sf, host_cmd_test_bw_t bw,
                                   host_cmd_test_cr_t cr, uint8_t payload_length, test_mode_tx_mode_t tx_mode );
 
+/*!
+ * \brief   Test mode continuous transmission hopping across the channel plan
+ * \remark  The enabled channels of the region channel plan are shuffled once into a hop sequence, which is then
+ *          repeated until a NOP. Each hop sends the longest packet that ends a few milliseconds before the next hop.
+ *
+ * \param  [in]     pwr_in_dbm              - Power in dbm
+ * \param  [in]     sf                      - spreading factor following host_cmd_test_sf_t definition
+ * \param  [in]     bw                      - bandwidth following host_cmd_test_bw_t definition
+ * \param  [in]     cr                      - coding rate following host_cmd_test_cr_t definition
+ * \param  [in]     dwell_ms                - Time between the start of two hops
+ *
+ * \retval [out]    return                  - modem_return_code_t
+ */
+modem_return_code_t test_mode_tx_hop( int8_t pwr_in_dbm, host_cmd_test_sf_t sf, host_cmd_test_bw_t bw,
+                                      host_cmd_test_cr_t cr, uint16_t dwell_ms );
+
 /*!
  * \brief   Test mode transmit a continuous wave.
  * \remark
@@ -219,6 +245,114 @@ modem_return_code_t test_mode_cw( uint32_t frequency, int8_t pwr_in_dbm );
 modem_return_code_t test_mode_rx_cont( uint32_t frequency, host_cmd_test_sf_t sf, host_cmd_test_bw_t bw,
                                        host_cmd_test_cr_t cr );
 
+/*!
+ * \brief   Test mode packet error rate transmitter
+ * \remark  Transmit packet_nb packets numbered from 0 by a 16-bit big endian sequence number at the start of their
+ *          payload, with CRC and without IQ inversion. Each packet starts gap_ms after the end of the previous one.
+ *
+ * \param  [in]     frequency               - Frequency in Hz
+ * \param  [in]     pwr_in_dbm              - Power in dbm
+ * \param  [in]     sf                      - spreading factor following host_cmd_test_sf_t definition
+ * \param  [in]     bw                      - bandwidth following host_cmd_test_bw_t definition
+ * \param  [in]     cr                      - coding rate following host_cmd_test_cr_t definition
+ * \param  [in]     payload_length          - Number of byte sent per packet, at least 2
+ * \param  [in]     packet_nb               - Number of packets to send
+ * \param  [in]     gap_ms                  - Delay between two packets
+ *
+ * \retval [out]    return                  - modem_return_code_t
+ */
+modem_return_code_t test_mode_per_tx( uint32_t frequency, int8_t pwr_in_dbm, host_cmd_test_sf_t sf,
+                                      host_cmd_test_bw_t bw, host_cmd_test_cr_t cr, uint8_t payload_length,
+                                      uint16_t packet_nb, uint16_t gap_ms );
+
+/*!
+ * \brief   Test mode packet error rate receiver
+ * \remark  Receive the packets of a test_mode_per_tx run until the last sequence number or a NOP, and accumulate the
+ *          statistics returned by test_mode_per_result.
+ *
+ * \param  [in]     frequency               - Frequency in Hz
+ * \param  [in]     sf                      - spreading factor following host_cmd_test_sf_t definition
+ * \param  [in]     bw                      - bandwidth following host_cmd_test_bw_t definition
+ * \param  [in]     cr                      - coding rate following host_cmd_test_cr_t definition
+ * \param  [in]     payload_length          - Largest packet expected, at least 2
+ * \param  [in]     packet_nb               - Number of packets sent by the transmitter
+ *
+ * \retval [out]    return                  - modem_return_code_t
+ */
+modem_return_code_t test_mode_per_rx( uint32_t frequency, host_cmd_test_sf_t sf, host_cmd_test_bw_t bw,
+                                      host_cmd_test_cr_t cr, uint8_t payload_length, uint16_t packet_nb );
+
+/*!
+ * \brief   Test mode packet error rate statistics of the current or last run
+ * \remark  53 bytes, big endian: state (bit 0 running, bit 1 receiver), packets configured, packets sent or
+ *          received, packets expected (highest sequence number + 1), header or CRC errors, PER [1/1000],
+ *          packets per second [1/100], minimum, average and maximum inter-packet gap [ms] (16-bit each), average
+ *          RSSI [dBm] and SNR [dB] (8-bit signed each), RSSI histogram of 10 dB bins from -130 dBm and SNR
+ *          histogram of 4 dB bins from -20 dB (8 bins of 16-bit each, the edge bins are open).
+ *
+ * \param  [out]    buffer*                 - Statistics
+ * \param  [out]    length*                 - Statistics length
+ *
+ * \retval [out]    return                  - modem_return_code_t
+ */
+modem_return_code_t test_mode_per_result( uint8_t* buffer, uint8_t* length );
+
+/*!
+ * \brief   Test mode sweep of the LoRa configurations, for the link characterization
+ * \remark  Two modems, one transmitter and one receiver started with the same parameters, walk the same steps: each
+ *          spreading factor of sf_mask, then each bandwidth of bw_mask, then each power from pwr_min_in_dbm to
+ *          pwr_max_in_dbm by pwr_step_in_db (a single power when 0). The transmitter sends packet_nb packets per
+ *          step on a fixed schedule, starting one second after the command. The receiver must be started first: it
+ *          listens on the first step until a packet gives it the time base of the transmitter, then switches steps
+ *          in lockstep with it.
+ *
+ * \param  [in]     is_rx                   - Receiver when true, transmitter otherwise
+ * \param  [in]     frequency               - Frequency in Hz
+ * \param  [in]     sf_mask                 - One bit per host_cmd_test_sf_t value, TST_FSK excluded
+ * \param  [in]     bw_mask                 - One bit per host_cmd_test_bw_t value
+ * \param  [in]     cr                      - coding rate following host_cmd_test_cr_t definition
+ * \param  [in]     pwr_min_in_dbm          - Lowest power in dbm, ignored by the receiver but counted in the steps
+ * \param  [in]     pwr_max_in_dbm          - Highest power in dbm
+ * \param  [in]     pwr_step_in_db          - Power increment
+ * \param  [in]     payload_length          - Number of byte sent per packet, at least 3
+ * \param  [in]     packet_nb               - Number of packets sent per step
+ *
+ * \retval [out]    return                  - modem_return_code_t
+ */
+modem_return_code_t test_mode_sweep_start( bool is_rx, uint32_t frequency, uint16_t sf_mask, uint8_t bw_mask,
+                                           host_cmd_test_cr_t cr, int8_t pwr_min_in_dbm, int8_t pwr_max_in_dbm,
+                                           uint8_t pwr_step_in_db, uint8_t payload_length, uint16_t packet_nb );
+
+/*!
+ * \brief   Test mode sweep statistics of the current or last run
+ * \remark  Big endian: state (bit 0 running, bit 1 receiver, bit 2 time base found), number of steps, current
+ *          step, packets per step (16-bit), then up to 19 steps from first_step of 13 bytes each: sf, bw, power
+ *          [dBm], time on air [ms] (16-bit), packets sent or received (16-bit), header or CRC errors (16-bit), PER
+ *          [1/1000] (16-bit, 0xFFFF until the step is over), average RSSI [dBm] and SNR [dB] (8-bit signed each).
+ *
+ * \param  [in]     first_step              - Index of the first step returned
+ * \param  [out]    buffer*                 - Statistics
+ * \param  [out]    length*                 - Statistics length
+ *
+ * \retval [out]    return                  - modem_return_code_t
+ */
+modem_return_code_t test_mode_sweep_result( uint8_t first_step, uint8_t* buffer, uint8_t* length );
+
+/*!
+ * \brief   Test mode benchmark of the radio accesses
+ * \remark  Times, in core clock cycles, iteration_nb runs of: a register read, buffer writes of 16, 64 and 255 bytes,
+ *          a wake-up from sleep and a get and clear of the IRQ status. Each access includes the wait on BUSY. The
+ *          result is big endian: core clock [Hz] then min, average and max of each access (32-bit each), 76 bytes.
+ *          The test mode tasks are stopped and the radio is left in standby.
+ *
+ * \param  [in]     iteration_nb            - Number of runs of each access, 1 to 1000
+ * \param  [out]    buffer*                 - Timings
+ * \param  [out]    length*                 - Timings length
+ *
+ * \retval [out]    return                  - modem_return_code_t
+ */
+modem_return_code_t test_mode_spi_bench( uint16_t iteration_nb, uint8_t* buffer, uint8_t* length );
+
 /*!
  * \brief   Test mode radio reset
  * \remark  Reset the radio.
@@ -58,6 +58,22 @@
  * --- PRIVATE MACROS-----------------------------------------------------------
  */
 
+/*!
+ * Radio type a RAL object is dispatched on. When a single radio is built it is a constant, the switch of each
+ * function then folds into a direct call of the radio implementation.
+ */
+#if( defined( SX126X ) + defined( SX1272 ) + defined( SX1276 ) + defined( SX1280 ) ) > 1
+#define RAL_RADIO_TYPE( ral ) ( ( ral )->radio_type )
+#elif defined( SX126X )
+#define RAL_RADIO_TYPE( ral ) ( ( void ) ( ral ), RAL_RADIO_SX126X )
+#elif defined( SX1272 )
+#define RAL_RADIO_TYPE( ral ) ( ( void ) ( ral ), RAL_RADIO_SX1272 )
+#elif defined( SX1276 )
+#define RAL_RADIO_TYPE( ral ) ( ( void ) ( ral ), RAL_RADIO_SX1276 )
+#else
+#define RAL_RADIO_TYPE( ral ) ( ( void ) ( ral ), RAL_RADIO_SX1280 )
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE CONSTANTS -------------------------------------------------------
@@ -85,7 +101,7 @@
 
 ral_status_t ral_init( const ral_t* ral )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -118,7 +134,7 @@ ral_status_t ral_init( const ral_t* ral )
 
 ral_status_t ral_setup_gfsk( const ral_t* ral, const ral_params_gfsk_t* params )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -151,7 +167,7 @@ ral_status_t ral_setup_gfsk( const ral_t* ral, const ral_params_gfsk_t* params )
 
 ral_status_t ral_setup_rx_gfsk( const ral_t* ral, const ral_params_gfsk_t* params )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -184,7 +200,7 @@ ral_status_t ral_setup_rx_gfsk( const ral_t* ral, const ral_params_gfsk_t* param
 
 ral_status_t ral_setup_tx_gfsk( const ral_t* ral, const ral_params_gfsk_t* params )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -217,7 +233,7 @@ ral_status_t ral_setup_tx_gfsk( const ral_t* ral, const ral_params_gfsk_t* param
 
 ral_status_t ral_setup_lora( const ral_t* ral, const ral_params_lora_t* params )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -250,7 +266,7 @@ ral_status_t ral_setup_lora( const ral_t* ral, const ral_params_lora_t* params )
 
 ral_status_t ral_setup_rx_lora( const ral_t* ral, const ral_params_lora_t* params )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -283,7 +299,7 @@ ral_status_t ral_setup_rx_lora( const ral_t* ral, const ral_params_lora_t* param
 
 ral_status_t ral_setup_tx_lora( const ral_t* ral, const ral_params_lora_t* params )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -316,7 +332,7 @@ ral_status_t ral_setup_tx_lora( const ral_t* ral, const ral_params_lora_t* param
 
 ral_status_t ral_setup_flrc( const ral_t* ral, const ral_params_flrc_t* params )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -349,7 +365,7 @@ ral_status_t ral_setup_flrc( const ral_t* ral, const ral_params_flrc_t* params )
 
 ral_status_t ral_setup_rx_flrc( const ral_t* ral, const ral_params_flrc_t* params )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -382,7 +398,7 @@ ral_status_t ral_setup_rx_flrc( const ral_t* ral, const ral_params_flrc_t* param
 
 ral_status_t ral_setup_tx_flrc( const ral_t* ral, const ral_params_flrc_t* params )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -413,9 +429,42 @@ ral_status_t ral_setup_tx_flrc( const ral_t* ral, const ral_params_flrc_t* param
     };
 }
 
+ral_status_t ral_setup_tx_ble( const ral_t* ral, const ral_params_ble_t* params )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX126X )
+    case RAL_RADIO_SX126X:
+    {
+        return ral_sx126x_setup_tx_ble( ral, params );
+    }
+#endif
+#if defined( SX1272 )
+    case RAL_RADIO_SX1272:
+    {
+        return ral_sx1272_setup_tx_ble( ral, params );
+    }
+#endif
+#if defined( SX1276 )
+    case RAL_RADIO_SX1276:
+    {
+        return ral_sx1276_setup_tx_ble( ral, params );
+    }
+#endif
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_setup_tx_ble( ral, params );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
 ral_status_t ral_setup_tx_lora_e( const ral_t* ral, const ral_params_lora_e_t* params )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -448,7 +497,7 @@ ral_status_t ral_setup_tx_lora_e( const ral_t* ral, const ral_params_lora_e_t* p
 
 ral_status_t ral_tx_bpsk( const ral_t* ral, const ral_params_bpsk_t* params )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -481,7 +530,7 @@ ral_status_t ral_tx_bpsk( const ral_t* ral, const ral_params_bpsk_t* params )
 
 ral_status_t ral_setup_cad( const ral_t* ral, const ral_lora_cad_params_t* params )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -512,9 +561,42 @@ ral_status_t ral_setup_cad( const ral_t* ral, const ral_lora_cad_params_t* param
     };
 }
 
+ral_status_t ral_setup_ranging( const ral_t* ral, const ral_params_ranging_t* params )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX126X )
+    case RAL_RADIO_SX126X:
+    {
+        return ral_sx126x_setup_ranging( ral, params );
+    }
+#endif
+#if defined( SX1272 )
+    case RAL_RADIO_SX1272:
+    {
+        return ral_sx1272_setup_ranging( ral, params );
+    }
+#endif
+#if defined( SX1276 )
+    case RAL_RADIO_SX1276:
+    {
+        return ral_sx1276_setup_ranging( ral, params );
+    }
+#endif
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_setup_ranging( ral, params );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
 ral_status_t ral_set_pkt_payload( const ral_t* ral, const uint8_t* buffer, const uint16_t size )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -547,7 +629,7 @@ ral_status_t ral_set_pkt_payload( const ral_t* ral, const uint8_t* buffer, const
 
 ral_status_t ral_get_pkt_payload( const ral_t* ral, uint8_t* buffer, uint16_t max_size, uint16_t* size )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -578,9 +660,41 @@ ral_status_t ral_get_pkt_payload( const ral_t* ral, uint8_t* buffer, uint16_t ma
     };
 }
 
+ral_status_t ral_read_pkt_payload( const ral_t* ral, const ral_rx_buffer_status_t* rx_buffer_status, uint8_t* buffer,
+                                   uint16_t max_size, uint16_t* size )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_read_pkt_payload( ral, rx_buffer_status, buffer, max_size, size );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
+ral_status_t ral_read_pkt_payload_part( const ral_t* ral, const ral_rx_buffer_status_t* rx_buffer_status,
+                                        const uint8_t offset, uint8_t* buffer, const uint16_t size )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_read_pkt_payload_part( ral, rx_buffer_status, offset, buffer, size );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
 ral_status_t ral_get_gfsk_pkt_status( const ral_t* ral, ral_rx_pkt_status_gfsk_t* pkt_status )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -613,7 +727,7 @@ ral_status_t ral_get_gfsk_pkt_status( const ral_t* ral, ral_rx_pkt_status_gfsk_t
 
 ral_status_t ral_get_lora_pkt_status( const ral_t* ral, ral_rx_pkt_status_lora_t* pkt_status )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -646,7 +760,7 @@ ral_status_t ral_get_lora_pkt_status( const ral_t* ral, ral_rx_pkt_status_lora_t
 
 ral_status_t ral_get_lora_incoming_pkt_config( const ral_t* ral, ral_lora_cr_t* rx_cr, bool* rx_is_crc_en )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -679,7 +793,7 @@ ral_status_t ral_get_lora_incoming_pkt_config( const ral_t* ral, ral_lora_cr_t*
 
 ral_status_t ral_get_flrc_pkt_status( const ral_t* ral, ral_rx_pkt_status_flrc_t* pkt_status )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -712,7 +826,7 @@ ral_status_t ral_get_flrc_pkt_status( const ral_t* ral, ral_rx_pkt_status_flrc_t
 
 ral_status_t ral_set_sleep( const ral_t* ral )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -743,9 +857,72 @@ ral_status_t ral_set_sleep( const ral_t* ral )
     };
 }
 
+ral_status_t ral_set_sleep_with_cfg( const ral_t* ral, const ral_sleep_cfg_t cfg )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX126X )
+    case RAL_RADIO_SX126X:
+    {
+        return ral_sx126x_set_sleep( ral );
+    }
+#endif
+#if defined( SX1272 )
+    case RAL_RADIO_SX1272:
+    {
+        return ral_sx1272_set_sleep( ral );
+    }
+#endif
+#if defined( SX1276 )
+    case RAL_RADIO_SX1276:
+    {
+        return ral_sx1276_set_sleep( ral );
+    }
+#endif
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_set_sleep_with_cfg( ral, cfg );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
+ral_status_t ral_set_reg_mode( const ral_t* ral, const ral_reg_mode_t reg_mode )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_set_reg_mode( ral, reg_mode );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
+ral_status_t ral_set_lna_mode( const ral_t* ral, const ral_lna_mode_t lna_mode )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_set_lna_mode( ral, lna_mode );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
 ral_status_t ral_set_standby( const ral_t* ral )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -778,7 +955,7 @@ ral_status_t ral_set_standby( const ral_t* ral )
 
 ral_status_t ral_set_tx( const ral_t* ral )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -811,7 +988,7 @@ ral_status_t ral_set_tx( const ral_t* ral )
 
 ral_status_t ral_set_tx_cw( const ral_t* ral )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -844,7 +1021,7 @@ ral_status_t ral_set_tx_cw( const ral_t* ral )
 
 ral_status_t ral_set_rx( const ral_t* ral, const uint32_t timeout_ms )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -875,9 +1052,108 @@ ral_status_t ral_set_rx( const ral_t* ral, const uint32_t timeout_ms )
     };
 }
 
+ral_status_t ral_set_rx_duty_cycle( const ral_t* ral, const uint32_t rx_time_in_ms, const uint32_t sleep_time_in_ms )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX126X )
+    case RAL_RADIO_SX126X:
+    {
+        return ral_sx126x_set_rx_duty_cycle( ral, rx_time_in_ms, sleep_time_in_ms );
+    }
+#endif
+#if defined( SX1272 )
+    case RAL_RADIO_SX1272:
+    {
+        return ral_sx1272_set_rx_duty_cycle( ral, rx_time_in_ms, sleep_time_in_ms );
+    }
+#endif
+#if defined( SX1276 )
+    case RAL_RADIO_SX1276:
+    {
+        return ral_sx1276_set_rx_duty_cycle( ral, rx_time_in_ms, sleep_time_in_ms );
+    }
+#endif
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_set_rx_duty_cycle( ral, rx_time_in_ms, sleep_time_in_ms );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
+ral_status_t ral_set_ranging( const ral_t* ral, const ral_ranging_role_t role, const uint32_t timeout_ms )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX126X )
+    case RAL_RADIO_SX126X:
+    {
+        return ral_sx126x_set_ranging( ral, role, timeout_ms );
+    }
+#endif
+#if defined( SX1272 )
+    case RAL_RADIO_SX1272:
+    {
+        return ral_sx1272_set_ranging( ral, role, timeout_ms );
+    }
+#endif
+#if defined( SX1276 )
+    case RAL_RADIO_SX1276:
+    {
+        return ral_sx1276_set_ranging( ral, role, timeout_ms );
+    }
+#endif
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_set_ranging( ral, role, timeout_ms );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
+ral_status_t ral_get_ranging_result( const ral_t* ral, const ral_params_ranging_t* params, int32_t* distance_in_cm )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX126X )
+    case RAL_RADIO_SX126X:
+    {
+        return ral_sx126x_get_ranging_result( ral, params, distance_in_cm );
+    }
+#endif
+#if defined( SX1272 )
+    case RAL_RADIO_SX1272:
+    {
+        return ral_sx1272_get_ranging_result( ral, params, distance_in_cm );
+    }
+#endif
+#if defined( SX1276 )
+    case RAL_RADIO_SX1276:
+    {
+        return ral_sx1276_get_ranging_result( ral, params, distance_in_cm );
+    }
+#endif
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_get_ranging_result( ral, params, distance_in_cm );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
 ral_status_t ral_set_cad( const ral_t* ral )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -910,7 +1186,7 @@ ral_status_t ral_set_cad( const ral_t* ral )
 
 ral_status_t ral_get_irq_status( const ral_t* ral, ral_irq_t* irq_status )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -943,7 +1219,7 @@ ral_status_t ral_get_irq_status( const ral_t* ral, ral_irq_t* irq_status )
 
 ral_status_t ral_clear_irq_status( const ral_t* ral, const ral_irq_t irq_status )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -976,7 +1252,7 @@ ral_status_t ral_clear_irq_status( const ral_t* ral, const ral_irq_t irq_status
 
 ral_status_t ral_get_and_clear_irq_status( const ral_t* ral, ral_irq_t* irq_status )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -997,7 +1273,7 @@ ral_status_t ral_get_and_clear_irq_status( const ral_t* ral, ral_irq_t* irq_stat
 
 ral_status_t ral_set_dio_irq_params( const ral_t* ral, const ral_irq_t ral_irq )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -1018,7 +1294,7 @@ ral_status_t ral_set_dio_irq_params( const ral_t* ral, const ral_irq_t ral_irq )
 
 ral_status_t ral_process_irq( const ral_t* ral, ral_irq_t* ral_irq )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -1049,9 +1325,25 @@ ral_status_t ral_process_irq( const ral_t* ral, ral_irq_t* ral_irq )
     };
 }
 
+ral_status_t ral_process_and_clear_irq( const ral_t* ral, ral_irq_t* ral_irq,
+                                        ral_rx_buffer_status_t* rx_buffer_status )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_process_and_clear_irq( ral, ral_irq, rx_buffer_status );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
 ral_status_t ral_get_rssi( const ral_t* ral, int16_t* rssi )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -1082,9 +1374,24 @@ ral_status_t ral_get_rssi( const ral_t* ral, int16_t* rssi )
     };
 }
 
+ral_status_t ral_set_rf_freq( const ral_t* ral, const uint32_t freq_in_hz )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_set_rf_freq( ral, freq_in_hz );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
 ral_status_t ral_get_lora_time_on_air_in_ms( const ral_t* ral, const ral_params_lora_t* params, uint32_t* toa )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -1117,7 +1424,7 @@ ral_status_t ral_get_lora_time_on_air_in_ms( const ral_t* ral, const ral_params_
 
 ral_status_t ral_get_gfsk_time_on_air_in_ms( const ral_t* ral, const ral_params_gfsk_t* params, uint32_t* toa )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -1150,7 +1457,7 @@ ral_status_t ral_get_gfsk_time_on_air_in_ms( const ral_t* ral, const ral_params_
 
 ral_status_t ral_get_flrc_time_on_air_in_ms( const ral_t* ral, const ral_params_flrc_t* params, uint32_t* toa )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX1280 )
     case RAL_RADIO_SX1280:
@@ -1166,7 +1473,7 @@ ral_status_t ral_get_flrc_time_on_air_in_ms( const ral_t* ral, const ral_params_
 ral_status_t ral_get_lora_tx_consumption_in_ua( const ral_t* ral, const ral_params_lora_t* params,
                                                 uint32_t* micro_ampere )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -1200,7 +1507,7 @@ ral_status_t ral_get_lora_tx_consumption_in_ua( const ral_t* ral, const ral_para
 ral_status_t ral_get_lora_rx_consumption_in_ua( const ral_t* ral, const ral_params_lora_t* params,
                                                 uint32_t* micro_ampere )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -1231,6 +1538,70 @@ ral_status_t ral_get_lora_rx_consumption_in_ua( const ral_t* ral, const ral_para
     };
 }
 
+ral_status_t ral_get_gfsk_tx_consumption_in_ua( const ral_t* ral, const ral_params_gfsk_t* params,
+                                                uint32_t* micro_ampere )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_convert_gfsk_tx_dbm_to_ua( params, micro_ampere );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
+ral_status_t ral_get_gfsk_rx_consumption_in_ua( const ral_t* ral, const ral_params_gfsk_t* params,
+                                                uint32_t* micro_ampere )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_convert_gfsk_rx_br_to_ua( params, micro_ampere );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
+ral_status_t ral_get_flrc_tx_consumption_in_ua( const ral_t* ral, const ral_params_flrc_t* params,
+                                                uint32_t* micro_ampere )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_convert_flrc_tx_dbm_to_ua( params, micro_ampere );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
+ral_status_t ral_get_flrc_rx_consumption_in_ua( const ral_t* ral, const ral_params_flrc_t* params,
+                                                uint32_t* micro_ampere )
+{
+    switch( RAL_RADIO_TYPE( ral ) )
+    {
+#if defined( SX1280 )
+    case RAL_RADIO_SX1280:
+    {
+        return ral_sx1280_convert_flrc_rx_br_to_ua( params, micro_ampere );
+    }
+#endif
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    };
+}
+
 ral_status_t ral_set_tcxo_on( const ral_t* ral )
 {
     ral_status_t status = RAL_STATUS_UNSUPPORTED_FEATURE;
@@ -1257,7 +1628,7 @@ ral_status_t ral_set_tcxo_off( const ral_t* ral )
 
 ral_status_t ral_read_register( const ral_t* ral, uint16_t address, uint8_t* buffer, uint16_t size )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
@@ -1290,7 +1661,7 @@ ral_status_t ral_read_register( const ral_t* ral, uint16_t address, uint8_t* buf
 
 ral_status_t ral_write_register( const ral_t* ral, uint16_t address, uint8_t* buffer, uint16_t size )
 {
-    switch( ral->radio_type )
+    switch( RAL_RADIO_TYPE( ral ) )
     {
 #if defined( SX126X )
     case RAL_RADIO_SX126X:
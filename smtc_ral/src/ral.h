@@ -177,6 +177,21 @@ ral_status_t ral_setup_rx_flrc( const ral_t* ral, const ral_params_flrc_t* param
  */
 ral_status_t ral_setup_tx_flrc( const ral_t* ral, const ral_params_flrc_t* params );
 
+/**
+ * Setup radio to transmit data using BLE packets
+ *
+ * @remark Not all radios have this modem available
+ *
+ * @remark The payload is the PDU header followed by the PDU payload, the radio adds the access address, the CRC
+ *         and the whitening
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] params BLE transmission parameters
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_setup_tx_ble( const ral_t* ral, const ral_params_ble_t* params );
+
 /**
  * Setup radio to transmit data using LoRaE modem
  *
@@ -217,6 +232,18 @@ ral_status_t ral_tx_bpsk( const ral_t* ral, const ral_params_bpsk_t* params );
  */
 ral_status_t ral_setup_cad( const ral_t* ral, const ral_lora_cad_params_t* params );
 
+/**
+ * Setup radio in ranging mode
+ *
+ * @remark Not all radios have this feature available
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] params Ranging parameters
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_setup_ranging( const ral_t* ral, const ral_params_ranging_t* params );
+
 /**
  * Fills radio transmission buffer
  *
@@ -241,6 +268,36 @@ ral_status_t ral_set_pkt_payload( const ral_t* ral, const uint8_t* buffer, const
  */
 ral_status_t ral_get_pkt_payload( const ral_t* ral, uint8_t* buffer, uint16_t max_size, uint16_t* size );
 
+/**
+ * Fetches radio reception buffer located by \ref ral_process_and_clear_irq
+ *
+ * @param [in]  radio            Pointer to radio data
+ * @param [in]  rx_buffer_status Length and offset of the received packet
+ * @param [out] buffer           Pointer to the buffer to be filled with received data
+ * @param [in]  max_size         Size of user-provided buffer
+ * @param [out] size             Size of the received buffer
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_read_pkt_payload( const ral_t* ral, const ral_rx_buffer_status_t* rx_buffer_status, uint8_t* buffer,
+                                   uint16_t max_size, uint16_t* size );
+
+/**
+ * Fetches part of the radio reception buffer located by \ref ral_process_and_clear_irq
+ *
+ * @remark The bytes are read as they are in the radio buffer, the caller bounds offset and size with the packet length
+ *
+ * @param [in]  radio            Pointer to radio data
+ * @param [in]  rx_buffer_status Length and offset of the received packet
+ * @param [in]  offset           Offset of the first byte to read in the received packet
+ * @param [out] buffer           Pointer to the buffer to be filled with received data
+ * @param [in]  size             Number of bytes to read
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_read_pkt_payload_part( const ral_t* ral, const ral_rx_buffer_status_t* rx_buffer_status,
+                                        const uint8_t offset, uint8_t* buffer, const uint16_t size );
+
 /**
  * Fetches packet status
  *
@@ -294,6 +351,38 @@ ral_status_t ral_get_flrc_pkt_status( const ral_t* ral, ral_rx_pkt_status_flrc_t
  */
 ral_status_t ral_set_sleep( const ral_t* ral );
 
+/**
+ * Radio is set in Sleep mode, with or without its configuration retained
+ *
+ * @remark The radios without a warm start mode use their \ref ral_set_sleep configuration
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] cfg   Sleep configuration
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_set_sleep_with_cfg( const ral_t* ral, const ral_sleep_cfg_t cfg );
+
+/**
+ * Select the power regulator of the radio
+ *
+ * @param [in] radio    Pointer to radio data
+ * @param [in] reg_mode Regulator mode
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_set_reg_mode( const ral_t* ral, const ral_reg_mode_t reg_mode );
+
+/**
+ * Select the LNA regime of the radio receiver
+ *
+ * @param [in] radio    Pointer to radio data
+ * @param [in] lna_mode LNA mode
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_set_lna_mode( const ral_t* ral, const ral_lna_mode_t lna_mode );
+
 /**
  * Radio is set in Standby mode
  *
@@ -330,6 +419,43 @@ ral_status_t ral_set_tx_cw( const ral_t* ral );
  */
 ral_status_t ral_set_rx( const ral_t* ral, const uint32_t timeout_ms );
 
+/**
+ * Radio is set in Rx duty cycle mode: it alternates Rx and sleep on its own timer until a packet is received
+ *
+ * @remark The transmitter preamble must last at least sleep_time_in_ms + 2 * rx_time_in_ms to be detected
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] rx_time_in_ms Rx window duration
+ * @param [in] sleep_time_in_ms Sleep duration between two Rx windows
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_set_rx_duty_cycle( const ral_t* ral, const uint32_t rx_time_in_ms, const uint32_t sleep_time_in_ms );
+
+/**
+ * Radio starts a ranging exchange: the master sends its request, the slave waits for one and answers it
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] role Role given to the ranging setup
+ * @param [in] timeout_ms Time given to the exchange, 0 for a slave listening until the next standby
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_set_ranging( const ral_t* ral, const ral_ranging_role_t role, const uint32_t timeout_ms );
+
+/**
+ * Gets the distance measured by the last ranging exchange, on the master side
+ *
+ * @remark The raw result is scaled by the bandwidth, the Rx/Tx delay calibration is applied by the radio
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] params Ranging parameters of the exchange
+ * @param [out] distance_in_cm Distance to the slave, can be slightly negative at short range
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_get_ranging_result( const ral_t* ral, const ral_params_ranging_t* params, int32_t* distance_in_cm );
+
 /**
  * Radio is set in CAD mode
  *
@@ -388,6 +514,21 @@ ral_status_t ral_set_dio_irq_params( const ral_t* ral, const ral_irq_t ral_irq )
  */
 ral_status_t ral_process_irq( const ral_t* ral, ral_irq_t* ral_irq );
 
+/**
+ * Retrives and clears the current radio irq status, and locates the received packet
+ *
+ * @remark Replaces \ref ral_process_irq followed by \ref ral_clear_irq_status of all the flags, with a single
+ *         radio wake-up. Must be the first function to be called by the radio IRQ handler
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [out] ral_irq Radio irq status before the clear
+ * @param [out] rx_buffer_status Length and offset of the last received packet
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_process_and_clear_irq( const ral_t* ral, ral_irq_t* ral_irq,
+                                        ral_rx_buffer_status_t* rx_buffer_status );
+
 /**
  * Gets current RSSI value
  *
@@ -397,6 +538,16 @@ ral_status_t ral_process_irq( const ral_t* ral, ral_irq_t* ral_irq );
  */
 ral_status_t ral_get_rssi( const ral_t* ral, int16_t* rssi );
 
+/**
+ * Reprograms the RF frequency only, leaving the radio in its current mode
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] freq_in_hz RF frequency in Hertz
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_set_rf_freq( const ral_t* ral, const uint32_t freq_in_hz );
+
 /**
  * Gets time on air, in milliseconds
  *
@@ -449,6 +600,50 @@ ral_status_t ral_get_lora_tx_consumption_in_ua( const ral_t* ral, const ral_para
 ral_status_t ral_get_lora_rx_consumption_in_ua( const ral_t* ral, const ral_params_lora_t* params,
                                                 uint32_t* micro_ampere );
 
+/**
+ * Gets TX power consumption, in micro_ampere
+ *
+ * @param [in] params Modem parameters
+ * @param [out] micro_ampere
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_get_gfsk_tx_consumption_in_ua( const ral_t* ral, const ral_params_gfsk_t* params,
+                                                uint32_t* micro_ampere );
+
+/**
+ * Gets RX power consumption, in micro_ampere
+ *
+ * @param [in] params Modem parameters
+ * @param [out] micro_ampere
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_get_gfsk_rx_consumption_in_ua( const ral_t* ral, const ral_params_gfsk_t* params,
+                                                uint32_t* micro_ampere );
+
+/**
+ * Gets TX power consumption, in micro_ampere
+ *
+ * @param [in] params Modem parameters
+ * @param [out] micro_ampere
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_get_flrc_tx_consumption_in_ua( const ral_t* ral, const ral_params_flrc_t* params,
+                                                uint32_t* micro_ampere );
+
+/**
+ * Gets RX power consumption, in micro_ampere
+ *
+ * @param [in] params Modem parameters
+ * @param [out] micro_ampere
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_get_flrc_rx_consumption_in_ua( const ral_t* ral, const ral_params_flrc_t* params,
+                                                uint32_t* micro_ampere );
+
 /**
  * Turns TCXO on.
  *
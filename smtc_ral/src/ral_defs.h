@@ -257,6 +257,31 @@ typedef struct ral_params_bpsk_s
     void* todo;
 } ral_params_bpsk_t;
 
+/*!
+ * Role of the radio in a ranging exchange: the master sends the request, the slave answers it
+ */
+typedef enum ral_ranging_role_e
+{
+    RAL_RANGING_ROLE_SLAVE = 0,
+    RAL_RANGING_ROLE_MASTER,
+} ral_ranging_role_t;
+
+typedef struct ral_params_ranging_s
+{
+    ral_params_lora_t  lora;     //! SF5 to SF10, 400 to 1600 kHz, the payload is not sent
+    ral_ranging_role_t role;
+    uint32_t           address;  //! Slave address, requested by the master, answered by the slave
+} ral_params_ranging_t;
+
+typedef struct ral_params_ble_s
+{
+    uint32_t freq_in_hz;
+    int8_t   pwr_in_dbm;
+    uint8_t  channel_index;   //! BLE channel index 0 to 39, starts the whitening sequence
+    uint32_t access_address;  //! 0x8E89BED6 on the advertising channels
+    uint32_t crc_init;        //! 24 bits, 0x555555 on the advertising channels
+} ral_params_ble_t;
+
 typedef enum ral_pkt_types_e
 {
     RAL_PKT_TYPE_GFSK   = 0x00,
@@ -264,9 +289,37 @@ typedef enum ral_pkt_types_e
     RAL_PKT_TYPE_FLRC   = 0x02,
     RAL_PKT_TYPE_LORA_E = 0x03,
     RAL_PKT_TYPE_BPSK   = 0x04,
+    RAL_PKT_TYPE_BLE    = 0x05,
     RAL_PKT_TYPE_NONE   = 0x0F,
 } ral_pkt_type_t;
 
+/*!
+ * Radio sleep configuration
+ */
+typedef enum ral_sleep_cfg_e
+{
+    RAL_SLEEP_CFG_COLD_START = 0x00,  // Nothing retained, lowest sleep current
+    RAL_SLEEP_CFG_WARM_START = 0x01,  // Configuration retained, shortest wake-up
+} ral_sleep_cfg_t;
+
+/*!
+ * Radio power regulator
+ */
+typedef enum ral_reg_mode_e
+{
+    RAL_REG_MODE_DCDC = 0x00,  // Lowest current on long radio activities
+    RAL_REG_MODE_LDO  = 0x01,  // No start-up cost, for short radio activities
+} ral_reg_mode_t;
+
+/*!
+ * Radio receiver LNA regime
+ */
+typedef enum ral_lna_mode_e
+{
+    RAL_LNA_MODE_LOW_POWER        = 0x00,  // Lowest Rx current
+    RAL_LNA_MODE_HIGH_SENSITIVITY = 0x01,  // Highest LNA gain steps, higher Rx current
+} ral_lna_mode_t;
+
 typedef struct ral_rx_pkt_status_gfsk_s
 {
     uint8_t rx_status;
@@ -288,6 +341,12 @@ typedef struct ral_rx_pkt_status_flrc_s
     int16_t rssi_in_dbm;
 } ral_rx_pkt_status_flrc_t;
 
+typedef struct ral_rx_buffer_status_s
+{
+    uint8_t pld_len_in_bytes;      // Length of the last received packet
+    uint8_t buffer_start_pointer;  // Offset of the last received packet in the radio buffer
+} ral_rx_buffer_status_t;
+
 /*!
  *  Represents the number of symbs to be used for channel activity
  * detection operation
@@ -338,8 +397,13 @@ enum ral_irq_e
     RAL_IRQ_RX_CRC_ERROR = ( 1 << 6 ),
     RAL_IRQ_CAD_DONE     = ( 1 << 7 ),
     RAL_IRQ_CAD_OK       = ( 1 << 8 ),
+    // Ranging exchange answered by the slave or sent by the slave, and its failure: no answer on the master side,
+    // request for another address on the slave side
+    RAL_IRQ_RANGING_DONE    = ( 1 << 9 ),
+    RAL_IRQ_RANGING_TIMEOUT = ( 1 << 10 ),
     RAL_IRQ_ALL = RAL_IRQ_TX_DONE | RAL_IRQ_RX_DONE | RAL_IRQ_RX_TIMEOUT | RAL_IRQ_RX_HDR_OK | RAL_IRQ_RX_HDR_ERROR |
-                  RAL_IRQ_RX_CRC_ERROR | RAL_IRQ_CAD_DONE | RAL_IRQ_CAD_OK,
+                  RAL_IRQ_RX_CRC_ERROR | RAL_IRQ_CAD_DONE | RAL_IRQ_CAD_OK | RAL_IRQ_RANGING_DONE |
+                  RAL_IRQ_RANGING_TIMEOUT,
 };
 
 typedef uint16_t ral_irq_t;
@@ -406,6 +470,43 @@ static inline uint8_t ral_compute_lora_ldro( const ral_lora_sf_t sf, const ral_l
     }
 }
 
+static inline uint32_t ral_get_lora_bw_in_hz( const ral_lora_bw_t bw )
+{
+    switch( bw )
+    {
+    case RAL_LORA_BW_007_KHZ:
+        return 7812;
+    case RAL_LORA_BW_010_KHZ:
+        return 10417;
+    case RAL_LORA_BW_015_KHZ:
+        return 15625;
+    case RAL_LORA_BW_020_KHZ:
+        return 20833;
+    case RAL_LORA_BW_031_KHZ:
+        return 31250;
+    case RAL_LORA_BW_041_KHZ:
+        return 41667;
+    case RAL_LORA_BW_062_KHZ:
+        return 62500;
+    case RAL_LORA_BW_125_KHZ:
+        return 125000;
+    case RAL_LORA_BW_200_KHZ:
+        return 203125;
+    case RAL_LORA_BW_250_KHZ:
+        return 250000;
+    case RAL_LORA_BW_400_KHZ:
+        return 406250;
+    case RAL_LORA_BW_500_KHZ:
+        return 500000;
+    case RAL_LORA_BW_800_KHZ:
+        return 812500;
+    case RAL_LORA_BW_1600_KHZ:
+        return 1625000;
+    default:
+        return 0;
+    }
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -72,7 +72,8 @@ typedef enum ral_hal_status_e
 /**
  * Turn on the TCXO
  *
- * \remark Useful only if the TCXO is controlled by the host
+ * \remark Useful only if the TCXO is controlled by the host. The radio planner calls it tcxo_startup_time_ms ahead
+ *         of the radio start and configures the radio meanwhile, there is no need to wait for the TCXO to be stable
  *
  * @param [in] context               Radio implementation parameters
  * @param [in] tcxo_startup_time_ms  Time in millisecond needed by the TCXO to be stable
@@ -362,6 +362,11 @@ ral_status_t ral_sx126x_setup_tx_flrc( const ral_t* ral, const ral_params_flrc_t
     return RAL_STATUS_UNSUPPORTED_FEATURE;
 }
 
+ral_status_t ral_sx126x_setup_tx_ble( const ral_t* ral, const ral_params_ble_t* params )
+{
+    return RAL_STATUS_UNSUPPORTED_FEATURE;
+}
+
 ral_status_t ral_sx126x_setup_tx_lora_e( const ral_t* ral, const ral_params_lora_e_t* params )
 {
     return RAL_STATUS_UNSUPPORTED_FEATURE;
@@ -377,6 +382,11 @@ ral_status_t ral_sx126x_setup_cad( const ral_t* ral, const ral_lora_cad_params_t
     return RAL_STATUS_UNSUPPORTED_FEATURE;
 }
 
+ral_status_t ral_sx126x_setup_ranging( const ral_t* ral, const ral_params_ranging_t* params )
+{
+    return RAL_STATUS_UNSUPPORTED_FEATURE;
+}
+
 ral_status_t ral_sx126x_set_pkt_payload( const ral_t* ral, const uint8_t* buffer, const uint16_t size )
 {
     return ( ral_status_t ) sx126x_write_buffer( ral->context, 0x00, buffer, size );
@@ -475,6 +485,23 @@ ral_status_t ral_sx126x_set_rx( const ral_t* ral, const uint32_t timeout_ms )
     }
 }
 
+ral_status_t ral_sx126x_set_rx_duty_cycle( const ral_t* ral, const uint32_t rx_time_in_ms,
+                                           const uint32_t sleep_time_in_ms )
+{
+    return RAL_STATUS_UNSUPPORTED_FEATURE;
+}
+
+ral_status_t ral_sx126x_set_ranging( const ral_t* ral, const ral_ranging_role_t role, const uint32_t timeout_ms )
+{
+    return RAL_STATUS_UNSUPPORTED_FEATURE;
+}
+
+ral_status_t ral_sx126x_get_ranging_result( const ral_t* ral, const ral_params_ranging_t* params,
+                                            int32_t* distance_in_cm )
+{
+    return RAL_STATUS_UNSUPPORTED_FEATURE;
+}
+
 ral_status_t ral_sx126x_set_cad( const ral_t* ral )
 {
     return ( ral_status_t ) sx126x_set_cad( ral->context );
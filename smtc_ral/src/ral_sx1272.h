@@ -177,6 +177,21 @@ ral_status_t ral_sx1272_setup_rx_flrc( const ral_t* ral, const ral_params_flrc_t
  */
 ral_status_t ral_sx1272_setup_tx_flrc( const ral_t* ral, const ral_params_flrc_t* params );
 
+/**
+ * Setup radio to transmit data using BLE packets
+ *
+ * @remark Not all radios have this modem available
+ *
+ * @remark The payload is the PDU header followed by the PDU payload, the radio adds the access address, the CRC
+ *         and the whitening
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] params BLE transmission parameters
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1272_setup_tx_ble( const ral_t* ral, const ral_params_ble_t* params );
+
 /**
  * Setup radio to transmit data using LoRaE modem
  *
@@ -217,6 +232,18 @@ ral_status_t ral_sx1272_tx_bpsk( const ral_t* ral, const ral_params_bpsk_t* para
  */
 ral_status_t ral_sx1272_setup_cad( const ral_t* ral, const ral_lora_cad_params_t* params );
 
+/**
+ * Setup radio in ranging mode
+ *
+ * @remark Not all radios have this feature available
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] params Ranging parameters
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1272_setup_ranging( const ral_t* ral, const ral_params_ranging_t* params );
+
 /**
  * Fills radio transmission buffer
  *
@@ -320,6 +347,45 @@ ral_status_t ral_sx1272_set_tx_cw( const ral_t* ral );
  */
 ral_status_t ral_sx1272_set_rx( const ral_t* ral, const uint32_t timeout_ms );
 
+/**
+ * Radio is set in Rx duty cycle mode: it alternates Rx and sleep on its own timer until a packet is received
+ *
+ * @remark The transmitter preamble must last at least sleep_time_in_ms + 2 * rx_time_in_ms to be detected
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] rx_time_in_ms Rx window duration
+ * @param [in] sleep_time_in_ms Sleep duration between two Rx windows
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1272_set_rx_duty_cycle( const ral_t* ral, const uint32_t rx_time_in_ms,
+                                           const uint32_t sleep_time_in_ms );
+
+/**
+ * Radio starts a ranging exchange: the master sends its request, the slave waits for one and answers it
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] role Role given to the ranging setup
+ * @param [in] timeout_ms Time given to the exchange, 0 for a slave listening until the next standby
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1272_set_ranging( const ral_t* ral, const ral_ranging_role_t role, const uint32_t timeout_ms );
+
+/**
+ * Gets the distance measured by the last ranging exchange, on the master side
+ *
+ * @remark The raw result is scaled by the bandwidth, the Rx/Tx delay calibration is applied by the radio
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] params Ranging parameters of the exchange
+ * @param [out] distance_in_cm Distance to the slave, can be slightly negative at short range
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1272_get_ranging_result( const ral_t* ral, const ral_params_ranging_t* params,
+                                            int32_t* distance_in_cm );
+
 /**
  * Radio is set in CAD mode
  *
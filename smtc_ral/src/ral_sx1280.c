@@ -54,6 +54,44 @@
  * --- PRIVATE TYPES -----------------------------------------------------------
  */
 
+/*!
+ * Shadow register fields known to be programmed in the radio
+ */
+enum ral_sx1280_shadow_field_e
+{
+    RAL_SX1280_SHADOW_PKT_TYPE    = ( 1 << 0 ),
+    RAL_SX1280_SHADOW_RF_FREQ     = ( 1 << 1 ),
+    RAL_SX1280_SHADOW_TX_PARAMS   = ( 1 << 2 ),
+    RAL_SX1280_SHADOW_BUFFER_BASE = ( 1 << 3 ),
+    RAL_SX1280_SHADOW_MOD_PARAMS  = ( 1 << 4 ),
+    RAL_SX1280_SHADOW_PKT_PARAMS  = ( 1 << 5 ),
+    RAL_SX1280_SHADOW_SYNC_WORD   = ( 1 << 6 ),
+    RAL_SX1280_SHADOW_DIO_IRQ     = ( 1 << 7 ),
+    RAL_SX1280_SHADOW_LNA_MODE    = ( 1 << 8 ),
+    RAL_SX1280_SHADOW_LONG_PBL    = ( 1 << 9 ),
+};
+
+/*!
+ * Copy of the last configuration sent to the radio, kept across warm start sleep
+ */
+typedef struct ral_sx1280_shadow_s
+{
+    uint16_t                 valid_fields;
+    sx1280_pkt_type_t        pkt_type;
+    uint32_t                 freq_in_hz;
+    int8_t                   pwr_in_dbm;
+    sx1280_mod_params_lora_t lora_mod_params;
+    sx1280_pkt_params_lora_t lora_pkt_params;
+    uint8_t                  lora_sync_word;
+    sx1280_mod_params_gfsk_t gfsk_mod_params;
+    sx1280_pkt_params_gfsk_t gfsk_pkt_params;
+    uint32_t                 ble_access_address;  // with ble_crc_init, valid with the sync word for the BLE type
+    uint32_t                 ble_crc_init;
+    sx1280_irq_mask_t        irq_mask;
+    sx1280_lna_settings_t    lna_settings;
+    bool                     long_pbl_is_on;
+} ral_sx1280_shadow_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
@@ -94,6 +132,32 @@ static const uint32_t ral_to_sx1280_lora_tx_dbm_to_ua[] = {
     24000,  //  13 dBm
 };
 
+/*!
+ * Ranging Rx/Tx delay calibration per bandwidth, 400, 800 and 1600 kHz, and spreading factor, SF5 to SF10
+ */
+static const uint16_t ral_sx1280_ranging_calib[3][6] = {
+    { 10299, 10271, 10244, 10242, 10230, 10246 },
+    { 11486, 11474, 11453, 11426, 11417, 11401 },
+    { 13308, 13493, 13528, 13515, 13430, 13376 },
+};
+
+static ral_sx1280_shadow_t ral_sx1280_shadow = { 0 };
+
+/*!
+ * Set by a sleep without retention, the regulator mode is then programmed again before the next setup
+ */
+static bool ral_sx1280_cold_start = false;
+
+/*!
+ * Regulator mode selected by the upper layer, the radio falls back to LDO on wake-up from a cold start sleep
+ */
+static sx1280_reg_mod_t ral_sx1280_reg_mode = SX1280_REG_MODE_DCDC;
+
+/*!
+ * Symbol timeout of the last LoRa reception setup, 0 when the reception is only bounded by its timeout in ms
+ */
+static uint8_t ral_sx1280_rx_symb_nb_timeout = 0;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
@@ -119,6 +183,75 @@ static sx1280_irq_mask_t ral_sx1280_convert_irq_flags_from_radio( ral_irq_t ral_
 
 static uint8_t shift_and_count_trailing_zeros( uint16_t* x );
 
+/*!
+ * Get the ranging Rx/Tx delay calibration and the exact bandwidth of a ranging configuration
+ *
+ * \param [in]  sf    LoRa spreading factor, SF5 to SF10
+ * \param [in]  bw    LoRa bandwidth, 400 to 1600 kHz
+ * \param [out] calib Rx/Tx delay calibration, can be NULL
+ * \param [out] bw_in_hz Exact bandwidth, can be NULL
+ *
+ * \retval status RAL_STATUS_UNKNOWN_VALUE for a configuration without calibration
+ */
+static ral_status_t ral_sx1280_get_ranging_calib( const ral_lora_sf_t sf, const ral_lora_bw_t bw, uint32_t* calib,
+                                                  uint32_t* bw_in_hz );
+
+static void ral_sx1280_shadow_invalidate( void );
+
+/*!
+ * Supply current of a radio state, from its DC-DC current and the selected regulator
+ */
+static uint32_t ral_sx1280_regulator_current_in_ua( const uint32_t dcdc_micro_ampere );
+
+/*!
+ * PA supply current, the same whatever the modulation
+ */
+static ral_status_t ral_sx1280_convert_tx_dbm_to_ua( const int8_t pwr_in_dbm, uint32_t* micro_ampere );
+
+/*!
+ * Program again what \ref ral_sx1280_init sets up, after a sleep without retention
+ */
+static ral_status_t ral_sx1280_cold_start_restore( const ral_t* ral );
+
+/*!
+ * Close the command batch opened by a setup function
+ *
+ * \param [in] ral    Pointer to radio abstraction layer data
+ * \param [in] status Status of the setup
+ *
+ * \retval status Setup status, or the batch error if the setup succeeded
+ */
+static ral_status_t ral_sx1280_batch_end( const ral_t* ral, ral_status_t status );
+
+static ral_status_t ral_sx1280_set_pkt_type_cached( const ral_t* ral, const sx1280_pkt_type_t pkt_type );
+
+static ral_status_t ral_sx1280_set_rf_freq_cached( const ral_t* ral, const uint32_t freq_in_hz );
+
+static ral_status_t ral_sx1280_set_tx_params_cached( const ral_t* ral, const int8_t pwr_in_dbm );
+
+static ral_status_t ral_sx1280_set_buffer_base_addr_cached( const ral_t* ral );
+
+static ral_status_t ral_sx1280_set_lora_mod_params_cached( const ral_t*                    ral,
+                                                           const sx1280_mod_params_lora_t* mod_params );
+
+static ral_status_t ral_sx1280_set_lora_pkt_params_cached( const ral_t*                    ral,
+                                                           const sx1280_pkt_params_lora_t* pkt_params );
+
+static ral_status_t ral_sx1280_set_lora_sync_word_cached( const ral_t* ral, const uint8_t sync_word );
+
+static ral_status_t ral_sx1280_set_gfsk_mod_params_cached( const ral_t*                    ral,
+                                                           const sx1280_mod_params_gfsk_t* mod_params );
+
+static ral_status_t ral_sx1280_set_gfsk_pkt_params_cached( const ral_t*                    ral,
+                                                           const sx1280_pkt_params_gfsk_t* pkt_params );
+
+static ral_status_t ral_sx1280_set_dio_irq_params_cached( const ral_t* ral, const sx1280_irq_mask_t irq_mask );
+
+/*!
+ * Select when the Rx timer stops: at the preamble detection in long preamble mode, at the header otherwise
+ */
+static ral_status_t ral_sx1280_set_long_pbl_cached( const ral_t* ral, const bool is_on );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -129,8 +262,11 @@ ral_status_t ral_sx1280_init( const ral_t* ral )
     ral_status_t status = RAL_STATUS_ERROR;
 
     sx1280_reset( ral->context );
+    ral_sx1280_shadow_invalidate( );
+    ral_sx1280_cold_start = false;
+    ral_sx1280_reg_mode   = SX1280_REG_MODE_DCDC;
 
-    status = ( ral_status_t ) sx1280_set_reg_mode( ral->context, SX1280_REG_MODE_DCDC );
+    status = ( ral_status_t ) sx1280_set_reg_mode( ral->context, ral_sx1280_reg_mode );
     return status;
 }
 
@@ -152,37 +288,43 @@ ral_status_t ral_sx1280_setup_gfsk( const ral_t* ral, const ral_params_gfsk_t* p
         return status;
     }
 
-    status = ( ral_status_t ) sx1280_set_pkt_type( ral->context, SX1280_PKT_TYPE_GFSK );
+    status = ral_sx1280_cold_start_restore( ral );
     if( status != RAL_STATUS_OK )
     {
         return status;
     }
 
-    status = ( ral_status_t ) sx1280_set_rf_freq( ral->context, params->freq_in_hz );
+    status = ral_sx1280_set_pkt_type_cached( ral, SX1280_PKT_TYPE_GFSK );
     if( status != RAL_STATUS_OK )
     {
         return status;
     }
 
-    status = ( ral_status_t ) sx1280_set_tx_params( ral->context, params->pwr_in_dbm, SX1280_RAMP_20_US );
+    status = ral_sx1280_set_rf_freq_cached( ral, params->freq_in_hz );
     if( status != RAL_STATUS_OK )
     {
         return status;
     }
 
-    status = ( ral_status_t ) sx1280_set_buffer_base_addr( ral->context, 0x00, 0x00 );
+    status = ral_sx1280_set_tx_params_cached( ral, params->pwr_in_dbm );
     if( status != RAL_STATUS_OK )
     {
         return status;
     }
 
-    status = ( ral_status_t ) sx1280_set_gfsk_mod_params( ral->context, &mod_params );
+    status = ral_sx1280_set_buffer_base_addr_cached( ral );
     if( status != RAL_STATUS_OK )
     {
         return status;
     }
 
-    status = ( ral_status_t ) sx1280_set_gfsk_pkt_params( ral->context, &pkt_params );
+    status = ral_sx1280_set_gfsk_mod_params_cached( ral, &mod_params );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+
+    status = ral_sx1280_set_gfsk_pkt_params_cached( ral, &pkt_params );
     if( status != RAL_STATUS_OK )
     {
         return status;
@@ -227,19 +369,23 @@ ral_status_t ral_sx1280_setup_rx_gfsk( const ral_t* ral, const ral_params_gfsk_t
     local_params.pwr_in_dbm        = 0;
     local_params.fdev_in_hz        = 0;
 
+    status = ( ral_status_t ) sx1280_batch_begin( ral->context );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+
     status = ral_sx1280_setup_gfsk( ral, &local_params );
     if( status == RAL_STATUS_OK )
     {
-        status = ( ral_status_t ) sx1280_set_dio_irq_params(
-            ral->context, SX1280_IRQ_RX_DONE | SX1280_IRQ_SYNC_WORD_ERROR | SX1280_IRQ_CRC_ERROR | SX1280_IRQ_TIMEOUT,
-            SX1280_IRQ_RX_DONE | SX1280_IRQ_SYNC_WORD_ERROR | SX1280_IRQ_CRC_ERROR | SX1280_IRQ_TIMEOUT,
-            SX1280_IRQ_NONE, SX1280_IRQ_NONE );
-        if( status != RAL_STATUS_OK )
-        {
-            return status;
-        }
+        status = ral_sx1280_set_dio_irq_params_cached(
+            ral, SX1280_IRQ_RX_DONE | SX1280_IRQ_SYNC_WORD_ERROR | SX1280_IRQ_CRC_ERROR | SX1280_IRQ_TIMEOUT );
     }
-    return status;
+    if( status == RAL_STATUS_OK )
+    {
+        status = ral_sx1280_set_long_pbl_cached( ral, false );
+    }
+    return ral_sx1280_batch_end( ral, status );
 }
 
 ral_status_t ral_sx1280_setup_tx_gfsk( const ral_t* ral, const ral_params_gfsk_t* params )
@@ -250,13 +396,18 @@ ral_status_t ral_sx1280_setup_tx_gfsk( const ral_t* ral, const ral_params_gfsk_t
     ral_params_gfsk_t local_params = *params;
     local_params.bw_ssb_in_hz      = 0;
 
+    status = ( ral_status_t ) sx1280_batch_begin( ral->context );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+
     status = ral_sx1280_setup_gfsk( ral, &local_params );
     if( status == RAL_STATUS_OK )
     {
-        status = ( ral_status_t ) sx1280_set_dio_irq_params( ral->context, SX1280_IRQ_TX_DONE, SX1280_IRQ_TX_DONE,
-                                                             SX1280_IRQ_NONE, SX1280_IRQ_NONE );
+        status = ral_sx1280_set_dio_irq_params_cached( ral, SX1280_IRQ_TX_DONE );
     }
-    return status;
+    return ral_sx1280_batch_end( ral, status );
 }
 
 ral_status_t ral_sx1280_setup_lora( const ral_t* ral, const ral_params_lora_t* params )
@@ -277,13 +428,19 @@ ral_status_t ral_sx1280_setup_lora( const ral_t* ral, const ral_params_lora_t* p
         return status;
     }
 
-    status = ( ral_status_t ) sx1280_set_pkt_type( ral->context, SX1280_PKT_TYPE_LORA );
+    status = ral_sx1280_cold_start_restore( ral );
     if( status != RAL_STATUS_OK )
     {
         return status;
     }
 
-    status = ( ral_status_t ) sx1280_set_rf_freq( ral->context, params->freq_in_hz );
+    status = ral_sx1280_set_pkt_type_cached( ral, SX1280_PKT_TYPE_LORA );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+
+    status = ral_sx1280_set_rf_freq_cached( ral, params->freq_in_hz );
     if( status != RAL_STATUS_OK )
     {
         return status;
@@ -298,31 +455,31 @@ ral_status_t ral_sx1280_setup_lora( const ral_t* ral, const ral_params_lora_t* p
     {
         pwr_in_dbm_clipped = SX1280_PWR_MIN;
     }
-    status = ( ral_status_t ) sx1280_set_tx_params( ral->context, pwr_in_dbm_clipped, SX1280_RAMP_20_US );
+    status = ral_sx1280_set_tx_params_cached( ral, pwr_in_dbm_clipped );
     if( status != RAL_STATUS_OK )
     {
         return status;
     }
 
-    status = ( ral_status_t ) sx1280_set_buffer_base_addr( ral->context, 0x00, 0x00 );
+    status = ral_sx1280_set_buffer_base_addr_cached( ral );
     if( status != RAL_STATUS_OK )
     {
         return status;
     }
 
-    status = ( ral_status_t ) sx1280_set_lora_mod_params( ral->context, &mod_params );
+    status = ral_sx1280_set_lora_mod_params_cached( ral, &mod_params );
     if( status != RAL_STATUS_OK )
     {
         return status;
     }
 
-    status = ( ral_status_t ) sx1280_set_lora_pkt_params( ral->context, &pkt_params );
+    status = ral_sx1280_set_lora_pkt_params_cached( ral, &pkt_params );
     if( status != RAL_STATUS_OK )
     {
         return status;
     }
 
-    status = ( ral_status_t ) sx1280_set_lora_sync_word( ral->context, params->sync_word );
+    status = ral_sx1280_set_lora_sync_word_cached( ral, params->sync_word );
 
     return status;
 }
@@ -335,19 +492,24 @@ ral_status_t ral_sx1280_setup_rx_lora( const ral_t* ral, const ral_params_lora_t
     ral_params_lora_t local_params = *params;
     local_params.pwr_in_dbm        = 0;
 
+    status = ( ral_status_t ) sx1280_batch_begin( ral->context );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+
     status = ral_sx1280_setup_lora( ral, &local_params );
     if( status == RAL_STATUS_OK )
     {
-        status = ( ral_status_t ) sx1280_set_dio_irq_params(
-            ral->context, SX1280_IRQ_RX_DONE | SX1280_IRQ_HEADER_ERROR | SX1280_IRQ_CRC_ERROR | SX1280_IRQ_TIMEOUT,
-            SX1280_IRQ_RX_DONE | SX1280_IRQ_HEADER_ERROR | SX1280_IRQ_CRC_ERROR | SX1280_IRQ_TIMEOUT, SX1280_IRQ_NONE,
-            SX1280_IRQ_NONE );
-        if( status != RAL_STATUS_OK )
-        {
-            return status;
-        }
+        status = ral_sx1280_set_dio_irq_params_cached(
+            ral, SX1280_IRQ_RX_DONE | SX1280_IRQ_HEADER_ERROR | SX1280_IRQ_CRC_ERROR | SX1280_IRQ_TIMEOUT );
     }
-    return status;
+    if( status == RAL_STATUS_OK )
+    {  // with a symbol timeout, an empty window closes after its symbols instead of waiting for a header
+        status = ral_sx1280_set_long_pbl_cached( ral, params->symb_nb_timeout > 0 );
+    }
+    ral_sx1280_rx_symb_nb_timeout = ( status == RAL_STATUS_OK ) ? params->symb_nb_timeout : 0;
+    return ral_sx1280_batch_end( ral, status );
 }
 
 ral_status_t ral_sx1280_setup_tx_lora( const ral_t* ral, const ral_params_lora_t* params )
@@ -358,13 +520,18 @@ ral_status_t ral_sx1280_setup_tx_lora( const ral_t* ral, const ral_params_lora_t
     ral_params_lora_t local_params = *params;
     local_params.symb_nb_timeout   = 0;
 
+    status = ( ral_status_t ) sx1280_batch_begin( ral->context );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+
     status = ral_sx1280_setup_lora( ral, &local_params );
     if( status == RAL_STATUS_OK )
     {
-        status = ( ral_status_t ) sx1280_set_dio_irq_params( ral->context, SX1280_IRQ_TX_DONE, SX1280_IRQ_TX_DONE,
-                                                             SX1280_IRQ_NONE, SX1280_IRQ_NONE );
+        status = ral_sx1280_set_dio_irq_params_cached( ral, SX1280_IRQ_TX_DONE );
     }
-    return status;
+    return ral_sx1280_batch_end( ral, status );
 }
 
 ral_status_t ral_sx1280_setup_flrc( const ral_t* ral, const ral_params_flrc_t* params )
@@ -379,12 +546,21 @@ ral_status_t ral_sx1280_setup_flrc( const ral_t* ral, const ral_params_flrc_t* p
         return status;
     }
 
+    // FLRC parameters are not tracked by the shadow registers
+    ral_sx1280_shadow_invalidate( );
+
     status = ( ral_status_t ) sx1280_set_standby( ral->context, SX1280_STANDBY_CFG_RC );
     if( status != RAL_STATUS_OK )
     {
         return status;
     }
 
+    status = ral_sx1280_cold_start_restore( ral );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+
     status = ( ral_status_t ) sx1280_set_pkt_type( ral->context, SX1280_PKT_TYPE_FLRC );
     if( status != RAL_STATUS_OK )
     {
@@ -442,6 +618,10 @@ ral_status_t ral_sx1280_setup_rx_flrc( const ral_t* ral, const ral_params_flrc_t
 
     status = ral_sx1280_setup_flrc( ral, &local_params );
     if( status == RAL_STATUS_OK )
+    {
+        status = ral_sx1280_set_long_pbl_cached( ral, false );
+    }
+    if( status == RAL_STATUS_OK )
     {
         status = ( ral_status_t ) sx1280_set_dio_irq_params(
             ral->context, SX1280_IRQ_RX_DONE | SX1280_IRQ_SYNC_WORD_ERROR | SX1280_IRQ_CRC_ERROR | SX1280_IRQ_TIMEOUT,
@@ -472,6 +652,111 @@ ral_status_t ral_sx1280_setup_tx_flrc( const ral_t* ral, const ral_params_flrc_t
     return status;
 }
 
+ral_status_t ral_sx1280_setup_tx_ble( const ral_t* ral, const ral_params_ble_t* params )
+{
+    ral_status_t status = RAL_STATUS_ERROR;
+
+    // 1 Mb/s PHY, up to 37 bytes of PDU payload
+    const sx1280_mod_params_ble_t mod_params = {
+        .br_bw     = SX1280_GFSK_BLE_BR_1_000_BW_1_2,
+        .mod_ind   = SX1280_GFSK_BLE_MOD_IND_0_50,
+        .mod_shape = SX1280_GFSK_FLRC_BLE_MOD_SHAPE_BT_05,
+    };
+    const sx1280_pkt_params_ble_t pkt_params = {
+        .con_state = SX1280_BLE_PLD_LEN_MAX_37_BYTES,
+        .crc_type  = SX1280_BLE_CRC_3B,
+        .pkt_type  = SX1280_BLE_PKT_TYPE_PRBS_9,  // test mode only
+        .dc_free   = SX1280_GFSK_FLRC_BLE_DC_FREE_ON,
+    };
+
+    if( params->channel_index > 39 )
+    {
+        return RAL_STATUS_UNKNOWN_VALUE;
+    }
+
+    status = ( ral_status_t ) sx1280_batch_begin( ral->context );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+
+    // Between two advertisements of a beacon only the frequency and the whitening seed are sent
+    status = ( ral_status_t ) sx1280_set_standby( ral->context, SX1280_STANDBY_CFG_RC );
+    if( status == RAL_STATUS_OK )
+    {
+        status = ral_sx1280_cold_start_restore( ral );
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        status = ral_sx1280_set_pkt_type_cached( ral, SX1280_PKT_TYPE_BLE );
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        status = ral_sx1280_set_rf_freq_cached( ral, params->freq_in_hz );
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        int8_t pwr_in_dbm_clipped = params->pwr_in_dbm;
+        if( params->pwr_in_dbm > SX1280_PWR_MAX )
+        {
+            pwr_in_dbm_clipped = SX1280_PWR_MAX;
+        }
+        else if( params->pwr_in_dbm < SX1280_PWR_MIN )
+        {
+            pwr_in_dbm_clipped = SX1280_PWR_MIN;
+        }
+        status = ral_sx1280_set_tx_params_cached( ral, pwr_in_dbm_clipped );
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        status = ral_sx1280_set_buffer_base_addr_cached( ral );
+    }
+    if( ( status == RAL_STATUS_OK ) && ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_MOD_PARAMS ) == 0 ) )
+    {
+        status = ( ral_status_t ) sx1280_set_ble_mod_params( ral->context, &mod_params );
+        if( status == RAL_STATUS_OK )
+        {
+            ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_MOD_PARAMS;
+        }
+    }
+    if( ( status == RAL_STATUS_OK ) && ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_PKT_PARAMS ) == 0 ) )
+    {
+        status = ( ral_status_t ) sx1280_set_ble_pkt_params( ral->context, &pkt_params );
+        if( status == RAL_STATUS_OK )
+        {
+            ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_PKT_PARAMS;
+        }
+    }
+    if( ( status == RAL_STATUS_OK ) &&
+        ( ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_SYNC_WORD ) == 0 ) ||
+          ( ral_sx1280_shadow.ble_access_address != params->access_address ) ||
+          ( ral_sx1280_shadow.ble_crc_init != params->crc_init ) ) )
+    {
+        ral_sx1280_shadow.valid_fields &= ~RAL_SX1280_SHADOW_SYNC_WORD;
+        status = ( ral_status_t ) sx1280_set_ble_access_address( ral->context, params->access_address );
+        if( status == RAL_STATUS_OK )
+        {
+            status = ( ral_status_t ) sx1280_set_ble_crc_init( ral->context, params->crc_init );
+        }
+        if( status == RAL_STATUS_OK )
+        {
+            ral_sx1280_shadow.ble_access_address = params->access_address;
+            ral_sx1280_shadow.ble_crc_init       = params->crc_init;
+            ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_SYNC_WORD;
+        }
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        status = ( ral_status_t ) sx1280_set_ble_whitening_seed( ral->context, 0x40 | params->channel_index );
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        status = ral_sx1280_set_dio_irq_params_cached( ral, SX1280_IRQ_TX_DONE );
+    }
+
+    return ral_sx1280_batch_end( ral, status );
+}
+
 ral_status_t ral_sx1280_setup_tx_lora_e( const ral_t* ral, const ral_params_lora_e_t* params )
 {
     return RAL_STATUS_UNSUPPORTED_FEATURE;
@@ -512,14 +797,129 @@ ral_status_t ral_sx1280_setup_cad( const ral_t* ral, const ral_lora_cad_params_t
 
     if( status == RAL_STATUS_OK )
     {
-        status = ( ral_status_t ) sx1280_set_dio_irq_params( ral->context, SX1280_IRQ_CAD_DONE | SX1280_IRQ_CAD_DET,
-                                                             SX1280_IRQ_CAD_DONE | SX1280_IRQ_CAD_DET, SX1280_IRQ_NONE,
-                                                             SX1280_IRQ_NONE );
+        status = ral_sx1280_set_dio_irq_params_cached( ral, SX1280_IRQ_CAD_DONE | SX1280_IRQ_CAD_DET );
     }
 
     return status;
 }
 
+ral_status_t ral_sx1280_setup_ranging( const ral_t* ral, const ral_params_ranging_t* params )
+{
+    ral_status_t             status     = RAL_STATUS_ERROR;
+    sx1280_mod_params_lora_t mod_params = { 0 };
+    sx1280_pkt_params_lora_t pkt_params = { 0 };
+    uint32_t                 calib      = 0;
+
+    status = ral_sx1280_convert_lora_params_from_radio( &params->lora, &mod_params, &pkt_params );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+    status = ral_sx1280_get_ranging_calib( params->lora.sf, params->lora.bw, &calib, NULL );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+
+    // The ranging packet type shares the LoRa modulation and packet parameters commands, they are not cached
+    const sx1280_mod_params_range_t range_mod_params = {
+        .sf = mod_params.sf,
+        .bw = mod_params.bw,
+        .cr = mod_params.cr,
+    };
+    const sx1280_pkt_params_range_t range_pkt_params = {
+        .pbl_len_in_symb  = pkt_params.pbl_len_in_symb,
+        .hdr_type         = pkt_params.hdr_type,
+        .pld_len_in_bytes = pkt_params.pld_len_in_bytes,
+        .crc_is_on        = pkt_params.crc_is_on,
+        .invert_iq_is_on  = pkt_params.invert_iq_is_on,
+    };
+
+    status = ( ral_status_t ) sx1280_batch_begin( ral->context );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+
+    status = ( ral_status_t ) sx1280_set_standby( ral->context, SX1280_STANDBY_CFG_RC );
+    if( status == RAL_STATUS_OK )
+    {
+        status = ral_sx1280_cold_start_restore( ral );
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        status = ral_sx1280_set_pkt_type_cached( ral, SX1280_PKT_TYPE_RANGING );
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        status = ral_sx1280_set_rf_freq_cached( ral, params->lora.freq_in_hz );
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        int8_t pwr_in_dbm_clipped = params->lora.pwr_in_dbm;
+        if( params->lora.pwr_in_dbm > SX1280_PWR_MAX )
+        {
+            pwr_in_dbm_clipped = SX1280_PWR_MAX;
+        }
+        else if( params->lora.pwr_in_dbm < SX1280_PWR_MIN )
+        {
+            pwr_in_dbm_clipped = SX1280_PWR_MIN;
+        }
+        status = ral_sx1280_set_tx_params_cached( ral, pwr_in_dbm_clipped );
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        status = ( ral_status_t ) sx1280_set_range_mod_params( ral->context, &range_mod_params );
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        status = ( ral_status_t ) sx1280_set_range_pkt_params( ral->context, &range_pkt_params );
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        status = ( ral_status_t ) sx1280_set_ranging_role(
+            ral->context, ( params->role == RAL_RANGING_ROLE_MASTER ) ? SX1280_RANGE_ROLE_MST : SX1280_RANGE_ROLE_SLV );
+    }
+    if( status == RAL_STATUS_OK )
+    {
+        status = ( ral_status_t ) sx1280_set_ranging_calib( ral->context, calib );
+    }
+    if( status == RAL_STATUS_OK )
+    {  // the ranging exchanges are bounded by their timeout
+        status = ral_sx1280_set_long_pbl_cached( ral, false );
+    }
+    if( params->role == RAL_RANGING_ROLE_MASTER )
+    {
+        if( status == RAL_STATUS_OK )
+        {
+            status = ( ral_status_t ) sx1280_set_ranging_req_addr( ral->context, params->address );
+        }
+        if( status == RAL_STATUS_OK )
+        {
+            status = ral_sx1280_set_dio_irq_params_cached(
+                ral, SX1280_IRQ_RANGING_MST_RES_VALID | SX1280_IRQ_RANGING_MST_TIMEOUT );
+        }
+    }
+    else
+    {
+        if( status == RAL_STATUS_OK )
+        {
+            status = ( ral_status_t ) sx1280_set_ranging_dev_addr( ral->context, params->address );
+        }
+        if( status == RAL_STATUS_OK )
+        {
+            status = ( ral_status_t ) sx1280_set_ranging_id_check_length( ral->context, 4 );
+        }
+        if( status == RAL_STATUS_OK )
+        {
+            status = ral_sx1280_set_dio_irq_params_cached(
+                ral, SX1280_IRQ_RANGING_SLV_RES_DONE | SX1280_IRQ_RANGING_SLV_REQ_DISCARDED | SX1280_IRQ_TIMEOUT );
+        }
+    }
+
+    return ral_sx1280_batch_end( ral, status );
+}
+
 ral_status_t ral_sx1280_set_pkt_payload( const ral_t* ral, const uint8_t* buffer, const uint16_t size )
 {
     return ( ral_status_t ) sx1280_write_buffer( ral->context, 0x00, buffer, size );
@@ -533,43 +933,56 @@ ral_status_t ral_sx1280_get_pkt_payload( const ral_t* ral, uint8_t* buffer, uint
     status = ( ral_status_t ) sx1280_get_rx_buffer_status( ral->context, &sx_buf_status );
     if( status == RAL_STATUS_OK )
     {
-        if( size != NULL )
+        status = ral_sx1280_read_pkt_payload(
+            ral,
+            &( ral_rx_buffer_status_t ){ .pld_len_in_bytes     = sx_buf_status.pld_len_in_bytes,
+                                         .buffer_start_pointer = sx_buf_status.buffer_start_pointer },
+            buffer, max_size, size );
+    }
+    return status;
+}
+
+ral_status_t ral_sx1280_read_pkt_payload( const ral_t* ral, const ral_rx_buffer_status_t* rx_buffer_status,
+                                          uint8_t* buffer, uint16_t max_size, uint16_t* size )
+{
+    ral_status_t status = RAL_STATUS_OK;
+
+    if( size != NULL )
+    {
+        sx1280_pkt_type_t           pkt_type     = SX1280_PKT_TYPE_GFSK;
+        sx1280_lora_pkt_len_modes_t pkt_len_mode = SX1280_LORA_RANGE_PKT_EXPLICIT;
+
+        status = ( ral_status_t ) sx1280_get_pkt_type( ral->context, &pkt_type );
+
+        if( ( status == RAL_STATUS_OK ) && ( pkt_type == SX1280_PKT_TYPE_LORA ) )
         {
-            sx1280_pkt_type_t           pkt_type     = SX1280_PKT_TYPE_GFSK;
-            sx1280_lora_pkt_len_modes_t pkt_len_mode = SX1280_LORA_RANGE_PKT_EXPLICIT;
+            status = ( ral_status_t ) sx1280_get_lora_pkt_len_mode( ral->context, &pkt_len_mode );
+        }
 
-            status = ( ral_status_t ) sx1280_get_pkt_type( ral->context, &pkt_type );
+        if( status == RAL_STATUS_OK )
+        {
+            if( ( pkt_type == SX1280_PKT_TYPE_LORA ) && ( pkt_len_mode == SX1280_LORA_RANGE_PKT_IMPLICIT ) )
+            {
+                uint8_t pkt_len = 0;
 
-            if( ( status == RAL_STATUS_OK ) && ( pkt_type == SX1280_PKT_TYPE_LORA ) )
+                status = ( ral_status_t ) sx1280_get_lora_pkt_len( ral->context, &pkt_len );
+                *size  = ( uint16_t ) pkt_len;
+            }
+            else
             {
-                status = ( ral_status_t ) sx1280_get_lora_pkt_len_mode( ral->context, &pkt_len_mode );
+                *size = rx_buffer_status->pld_len_in_bytes;
             }
 
             if( status == RAL_STATUS_OK )
             {
-                if( ( pkt_type == SX1280_PKT_TYPE_LORA ) && ( pkt_len_mode == SX1280_LORA_RANGE_PKT_IMPLICIT ) )
+                if( *size <= max_size )
                 {
-                    uint8_t pkt_len = 0;
-
-                    status = ( ral_status_t ) sx1280_get_lora_pkt_len( ral->context, &pkt_len );
-                    *size  = ( uint16_t ) pkt_len;
+                    status = ( ral_status_t ) sx1280_read_buffer( ral->context, rx_buffer_status->buffer_start_pointer,
+                                                                  buffer, *size );
                 }
                 else
                 {
-                    *size = sx_buf_status.pld_len_in_bytes;
-                }
-
-                if( status == RAL_STATUS_OK )
-                {
-                    if( *size <= max_size )
-                    {
-                        status = ( ral_status_t ) sx1280_read_buffer( ral->context, sx_buf_status.buffer_start_pointer,
-                                                                      buffer, *size );
-                    }
-                    else
-                    {
-                        status = RAL_STATUS_ERROR;
-                    }
+                    status = RAL_STATUS_ERROR;
                 }
             }
         }
@@ -577,6 +990,19 @@ ral_status_t ral_sx1280_get_pkt_payload( const ral_t* ral, uint8_t* buffer, uint
     return status;
 }
 
+ral_status_t ral_sx1280_read_pkt_payload_part( const ral_t* ral, const ral_rx_buffer_status_t* rx_buffer_status,
+                                               const uint8_t offset, uint8_t* buffer, const uint16_t size )
+{
+    if( size > 255 )
+    {
+        return RAL_STATUS_ERROR;
+    }
+    // the radio buffer is 256 bytes long and wraps around, so does the offset
+    return ( ral_status_t ) sx1280_read_buffer( ral->context,
+                                                ( uint8_t )( rx_buffer_status->buffer_start_pointer + offset ), buffer,
+                                                ( uint8_t ) size );
+}
+
 ral_status_t ral_sx1280_get_gfsk_pkt_status( const ral_t* ral, ral_rx_pkt_status_gfsk_t* pkt_status )
 {
     ral_status_t             status        = RAL_STATUS_ERROR;
@@ -666,8 +1092,70 @@ ral_status_t ral_sx1280_get_flrc_pkt_status( const ral_t* ral, ral_rx_pkt_status
 
 ral_status_t ral_sx1280_set_sleep( const ral_t* ral )
 {
-    return ( ral_status_t ) sx1280_set_sleep(
-        ral->context, SX1280_SLEEP_CFG_DATA_RETENTION | SX1280_SLEEP_CFG_DATA_BUFFER_RETENTION );
+    return ral_sx1280_set_sleep_with_cfg( ral, RAL_SLEEP_CFG_WARM_START );
+}
+
+ral_status_t ral_sx1280_set_sleep_with_cfg( const ral_t* ral, const ral_sleep_cfg_t cfg )
+{
+    ral_status_t status = RAL_STATUS_ERROR;
+
+    if( cfg == RAL_SLEEP_CFG_WARM_START )
+    {
+        // The registers written outside of the configuration commands (i.e. sync word) are only restored on
+        // wake-up once saved in the retention memory
+        status = ( ral_status_t ) sx1280_save_context( ral->context );
+        if( status == RAL_STATUS_OK )
+        {
+            status = ( ral_status_t ) sx1280_set_sleep(
+                ral->context, SX1280_SLEEP_CFG_DATA_RETENTION | SX1280_SLEEP_CFG_DATA_BUFFER_RETENTION );
+        }
+        return status;
+    }
+
+    // Nothing is retained: the shadow registers are out of date and the regulator mode is back to its default
+    ral_sx1280_shadow_invalidate( );
+    ral_sx1280_cold_start = true;
+
+    return ( ral_status_t ) sx1280_set_sleep( ral->context, 0 );
+}
+
+ral_status_t ral_sx1280_set_reg_mode( const ral_t* ral, const ral_reg_mode_t reg_mode )
+{
+    const sx1280_reg_mod_t mode = ( reg_mode == RAL_REG_MODE_LDO ) ? SX1280_REG_MODE_LDO : SX1280_REG_MODE_DCDC;
+
+    if( ( ral_sx1280_cold_start == false ) && ( ral_sx1280_reg_mode == mode ) )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    ral_status_t status = ( ral_status_t ) sx1280_set_reg_mode( ral->context, mode );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_reg_mode   = mode;
+        ral_sx1280_cold_start = false;
+    }
+    return status;
+}
+
+ral_status_t ral_sx1280_set_lna_mode( const ral_t* ral, const ral_lna_mode_t lna_mode )
+{
+    const sx1280_lna_settings_t settings =
+        ( lna_mode == RAL_LNA_MODE_HIGH_SENSITIVITY ) ? SX1280_LNA_HIGH_SENSITIVITY_MODE : SX1280_LNA_LOW_POWER_MODE;
+
+    if( ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_LNA_MODE ) != 0 ) &&
+        ( ral_sx1280_shadow.lna_settings == settings ) )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    ral_sx1280_shadow.valid_fields &= ~RAL_SX1280_SHADOW_LNA_MODE;
+    ral_status_t status = ( ral_status_t ) sx1280_set_lna_settings( ral->context, settings );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_shadow.lna_settings = settings;
+        ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_LNA_MODE;
+    }
+    return status;
 }
 
 ral_status_t ral_sx1280_set_standby( const ral_t* ral )
@@ -738,6 +1226,36 @@ static uint16_t sx1280_get_lora_hdr_time_in_ms( uint8_t sf_reg, uint8_t bw_reg )
     return hdr_times_in_ms[( sf_reg >> 4 ) - 5][bw_index];
 }
 
+/*!
+ * Get LoRa symbol time in us for given spreading factor and bandwidth
+ *
+ * \param [in] sf_reg LoRa spreading factor register bits value [7:4]
+ * \param [in] bw_reg LoRa bandwidth register bits value [3:1]
+ *
+ * \retval Symbol time rounded up
+ */
+static uint32_t sx1280_get_lora_symb_time_in_us( uint8_t sf_reg, uint8_t bw_reg )
+{
+    // the bandwidths are 203.125 kHz times 1, 2, 4 or 8: ts_in_us = ( 1 << sf ) * 64 / ( 13 * bw_factor )
+    uint32_t bw_factor = 8;
+    switch( bw_reg )
+    {
+    case( SX1280_LORA_RANGE_BW_200 & 0x0E ):
+        bw_factor = 1;
+        break;
+    case( SX1280_LORA_RANGE_BW_400 & 0x0E ):
+        bw_factor = 2;
+        break;
+    case( SX1280_LORA_RANGE_BW_800 & 0x0E ):
+        bw_factor = 4;
+        break;
+    default:
+        break;
+    }
+
+    return ( ( ( uint32_t ) 1 << ( sf_reg >> 4 ) ) * 64 + ( 13 * bw_factor ) - 1 ) / ( 13 * bw_factor );
+}
+
 // WORKAROUND #1 - END (helper functions)
 
 ral_status_t ral_sx1280_set_rx( const ral_t* ral, const uint32_t timeout_ms )
@@ -758,6 +1276,20 @@ ral_status_t ral_sx1280_set_rx( const ral_t* ral, const uint32_t timeout_ms )
         // Address 0x902: sf[7:4] - bw[3:1]
         sx1280_read_register( ral->context, 0x902, &reg, 1 );
 
+        if( ( pkt_type == SX1280_PKT_TYPE_LORA ) && ( ral_sx1280_rx_symb_nb_timeout > 0 ) &&
+            ( timeout_ms != 0xFFFFFFFF ) )
+        {  // the timer stops at the preamble detection, it only covers the window symbols: 15.625 us steps
+            uint32_t window_in_us =
+                ral_sx1280_rx_symb_nb_timeout * sx1280_get_lora_symb_time_in_us( ( reg & 0xF0 ), ( reg & 0x0E ) );
+            uint32_t window_in_ticks = ( ( window_in_us * 64 ) + 999 ) / 1000;
+
+            if( window_in_ticks <= UINT16_MAX )
+            {
+                return ( ral_status_t ) sx1280_set_rx( ral->context, SX1280_TICK_SIZE_0015_US, window_in_ticks );
+            }
+            local_timeout_ms = ( window_in_us + 999 ) / 1000;
+            break;
+        }
         local_timeout_ms = timeout_ms + sx1280_get_lora_hdr_time_in_ms( ( reg & 0xF0 ), ( reg & 0x0E ) );
         break;
     }
@@ -790,6 +1322,73 @@ ral_status_t ral_sx1280_set_rx( const ral_t* ral, const uint32_t timeout_ms )
     }
 }
 
+ral_status_t ral_sx1280_set_rx_duty_cycle( const ral_t* ral, const uint32_t rx_time_in_ms,
+                                           const uint32_t sleep_time_in_ms )
+{
+    if( ( rx_time_in_ms <= UINT16_MAX ) && ( sleep_time_in_ms <= UINT16_MAX ) )
+    {
+        return ( ral_status_t ) sx1280_set_rx_duty_cycle( ral->context, SX1280_TICK_SIZE_1000_US, rx_time_in_ms,
+                                                          sleep_time_in_ms );
+    }
+    else if( ( ( rx_time_in_ms >> 2 ) <= UINT16_MAX ) && ( ( sleep_time_in_ms >> 2 ) <= UINT16_MAX ) )
+    {
+        return ( ral_status_t ) sx1280_set_rx_duty_cycle( ral->context, SX1280_TICK_SIZE_4000_US, rx_time_in_ms >> 2,
+                                                          sleep_time_in_ms >> 2 );
+    }
+    return RAL_STATUS_UNKNOWN_VALUE;
+}
+
+ral_status_t ral_sx1280_set_ranging( const ral_t* ral, const ral_ranging_role_t role, const uint32_t timeout_ms )
+{
+    if( role == RAL_RANGING_ROLE_MASTER )
+    {
+        // The master timeout IRQ rises when no answer is received before the end of the Tx timeout
+        if( ( timeout_ms == 0 ) || ( timeout_ms > UINT16_MAX ) )
+        {
+            return RAL_STATUS_UNKNOWN_VALUE;
+        }
+        return ( ral_status_t ) sx1280_set_tx( ral->context, SX1280_TICK_SIZE_1000_US, timeout_ms );
+    }
+
+    if( timeout_ms == 0 )
+    {  // Continuous mode
+        return ( ral_status_t ) sx1280_set_rx( ral->context, SX1280_TICK_SIZE_1000_US, 0xFFFF );
+    }
+    else if( timeout_ms < UINT16_MAX )
+    {
+        return ( ral_status_t ) sx1280_set_rx( ral->context, SX1280_TICK_SIZE_1000_US, timeout_ms );
+    }
+    else if( ( timeout_ms >> 2 ) < UINT16_MAX )
+    {
+        return ( ral_status_t ) sx1280_set_rx( ral->context, SX1280_TICK_SIZE_4000_US, timeout_ms >> 2 );
+    }
+    return RAL_STATUS_UNKNOWN_VALUE;
+}
+
+ral_status_t ral_sx1280_get_ranging_result( const ral_t* ral, const ral_params_ranging_t* params,
+                                            int32_t* distance_in_cm )
+{
+    ral_status_t status   = RAL_STATUS_ERROR;
+    uint32_t     bw_in_hz = 0;
+    int32_t      raw      = 0;
+
+    status = ral_sx1280_get_ranging_calib( params->lora.sf, params->lora.bw, NULL, &bw_in_hz );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+    status = ( ral_status_t ) sx1280_get_ranging_result( ral->context, SX1280_RANGE_RESULT_RAW, &raw );
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+
+    // distance [m] = raw * 150 / ( 2^12 * bandwidth [MHz] ), 150e8 / 2^12 = 29296875 / 8 for a result in cm
+    *distance_in_cm = ( int32_t )( ( ( int64_t ) raw * 29296875 ) / ( ( int64_t ) bw_in_hz * 8 ) );
+
+    return RAL_STATUS_OK;
+}
+
 ral_status_t ral_sx1280_set_cad( const ral_t* ral )
 {
     return ( ral_status_t ) sx1280_set_cad( ral->context );
@@ -845,8 +1444,7 @@ ral_status_t ral_sx1280_set_dio_irq_params( const ral_t* ral, const ral_irq_t ra
 {
     uint16_t sx1280_irq = ral_sx1280_convert_irq_flags_from_radio( ral_irq );
 
-    return ( ral_status_t ) sx1280_set_dio_irq_params( ral->context, sx1280_irq, sx1280_irq, SX1280_IRQ_NONE,
-                                                       SX1280_IRQ_NONE );
+    return ral_sx1280_set_dio_irq_params_cached( ral, sx1280_irq );
 }
 
 ral_status_t ral_sx1280_process_irq( const ral_t* ral, ral_irq_t* ral_irq )
@@ -862,11 +1460,33 @@ ral_status_t ral_sx1280_process_irq( const ral_t* ral, ral_irq_t* ral_irq )
     return status;
 }
 
+ral_status_t ral_sx1280_process_and_clear_irq( const ral_t* ral, ral_irq_t* ral_irq,
+                                               ral_rx_buffer_status_t* rx_buffer_status )
+{
+    ral_status_t              status          = RAL_STATUS_ERROR;
+    sx1280_irq_mask_t         sx1280_irq_mask = SX1280_IRQ_NONE;
+    sx1280_rx_buffer_status_t sx_buf_status   = { 0 };
+
+    status = ( ral_status_t ) sx1280_process_and_clear_irq( ral->context, &sx1280_irq_mask, &sx_buf_status );
+    if( status == RAL_STATUS_OK )
+    {
+        *ral_irq                               = ral_sx1280_convert_irq_flags_to_radio( sx1280_irq_mask );
+        rx_buffer_status->pld_len_in_bytes     = sx_buf_status.pld_len_in_bytes;
+        rx_buffer_status->buffer_start_pointer = sx_buf_status.buffer_start_pointer;
+    }
+    return status;
+}
+
 ral_status_t ral_sx1280_get_rssi( const ral_t* ral, int16_t* rssi )
 {
     return ( ral_status_t ) sx1280_get_rssi_inst( ral->context, rssi );
 }
 
+ral_status_t ral_sx1280_set_rf_freq( const ral_t* ral, const uint32_t freq_in_hz )
+{
+    return ral_sx1280_set_rf_freq_cached( ral, freq_in_hz );
+}
+
 ral_status_t ral_sx1280_get_lora_time_on_air_in_ms( const ral_params_lora_t* params, uint32_t* toa )
 {
     ral_status_t             status     = RAL_STATUS_ERROR;
@@ -920,45 +1540,58 @@ ral_status_t ral_sx1280_get_flrc_time_on_air_in_ms( const ral_params_flrc_t* par
 
 ral_status_t ral_sx1280_convert_lora_rx_bw_to_ua( const ral_params_lora_t* params, uint32_t* micro_ampere )
 {
+    uint32_t dcdc_micro_ampere;
+
     switch( params->bw )
     {
     case RAL_LORA_BW_200_KHZ:
-    {
-        *micro_ampere = 6200;
-        return RAL_STATUS_OK;
-    }
+        dcdc_micro_ampere = 6200;
+        break;
     case RAL_LORA_BW_400_KHZ:
-    {
-        *micro_ampere = 6700;
-        return RAL_STATUS_OK;
-    }
+        dcdc_micro_ampere = 6700;
+        break;
     case RAL_LORA_BW_800_KHZ:
-    {
-        *micro_ampere = 7700;
-        return RAL_STATUS_OK;
-    }
+        dcdc_micro_ampere = 7700;
+        break;
     case RAL_LORA_BW_1600_KHZ:
-    {
-        *micro_ampere = 8200;
-        return RAL_STATUS_OK;
-    }
+        dcdc_micro_ampere = 8200;
+        break;
     default:
         return RAL_STATUS_UNKNOWN_VALUE;
     }
+
+    *micro_ampere = ral_sx1280_regulator_current_in_ua( dcdc_micro_ampere );
+    return RAL_STATUS_OK;
 }
 
 ral_status_t ral_sx1280_convert_lora_tx_dbm_to_ua( const ral_params_lora_t* params, uint32_t* micro_ampere )
 {
-    if( ( params->pwr_in_dbm < -18 ) || ( params->pwr_in_dbm > 13 ) )
-    {
-        return RAL_STATUS_UNKNOWN_VALUE;
-    }
+    return ral_sx1280_convert_tx_dbm_to_ua( params->pwr_in_dbm, micro_ampere );
+}
 
-    *micro_ampere = ral_to_sx1280_lora_tx_dbm_to_ua[params->pwr_in_dbm + 18];
+ral_status_t ral_sx1280_convert_gfsk_rx_br_to_ua( const ral_params_gfsk_t* params, uint32_t* micro_ampere )
+{
+    // same receiver chain as LoRa: current of the LoRa bandwidth closest to the signal one
+    *micro_ampere = ral_sx1280_regulator_current_in_ua( ( params->br_in_bps <= 500000 ) ? 6200 : 6700 );
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_sx1280_convert_gfsk_tx_dbm_to_ua( const ral_params_gfsk_t* params, uint32_t* micro_ampere )
+{
+    return ral_sx1280_convert_tx_dbm_to_ua( params->pwr_in_dbm, micro_ampere );
+}
 
+ral_status_t ral_sx1280_convert_flrc_rx_br_to_ua( const ral_params_flrc_t* params, uint32_t* micro_ampere )
+{
+    *micro_ampere = ral_sx1280_regulator_current_in_ua( ( params->br_in_bps <= 650000 ) ? 6200 : 6700 );
     return RAL_STATUS_OK;
 }
 
+ral_status_t ral_sx1280_convert_flrc_tx_dbm_to_ua( const ral_params_flrc_t* params, uint32_t* micro_ampere )
+{
+    return ral_sx1280_convert_tx_dbm_to_ua( params->pwr_in_dbm, micro_ampere );
+}
+
 ral_status_t ral_sx1280_read_register( const ral_t* ral, uint16_t address, uint8_t* buffer, uint16_t size )
 {
     return ( ral_status_t ) sx1280_read_register( ral->context, address, buffer, size );
@@ -966,6 +1599,8 @@ ral_status_t ral_sx1280_read_register( const ral_t* ral, uint16_t address, uint8
 
 ral_status_t ral_sx1280_write_register( const ral_t* ral, uint16_t address, uint8_t* buffer, uint16_t size )
 {
+    // the written register can belong to any of the cached settings
+    ral_sx1280_shadow_invalidate( );
     return ( ral_status_t ) sx1280_write_register( ral->context, address, buffer, size );
 }
 
@@ -1237,6 +1872,14 @@ static ral_irq_t ral_sx1280_convert_irq_flags_to_radio( sx1280_irq_mask_t sx1280
     {
         ral_irq |= RAL_IRQ_CAD_OK;
     }
+    if( ( sx1280_irq & ( SX1280_IRQ_RANGING_MST_RES_VALID | SX1280_IRQ_RANGING_SLV_RES_DONE ) ) != 0 )
+    {
+        ral_irq |= RAL_IRQ_RANGING_DONE;
+    }
+    if( ( sx1280_irq & ( SX1280_IRQ_RANGING_MST_TIMEOUT | SX1280_IRQ_RANGING_SLV_REQ_DISCARDED ) ) != 0 )
+    {
+        ral_irq |= RAL_IRQ_RANGING_TIMEOUT;
+    }
     return ral_irq;
 }
 
@@ -1278,6 +1921,16 @@ static sx1280_irq_mask_t ral_sx1280_convert_irq_flags_from_radio( ral_irq_t ral_
     {
         sx1280_irq_mask |= SX1280_IRQ_CAD_DET;
     }
+    if( ( ral_irq & RAL_IRQ_RANGING_DONE ) == RAL_IRQ_RANGING_DONE )
+    {
+        sx1280_irq_mask |= SX1280_IRQ_RANGING_MST_RES_VALID;
+        sx1280_irq_mask |= SX1280_IRQ_RANGING_SLV_RES_DONE;
+    }
+    if( ( ral_irq & RAL_IRQ_RANGING_TIMEOUT ) == RAL_IRQ_RANGING_TIMEOUT )
+    {
+        sx1280_irq_mask |= SX1280_IRQ_RANGING_MST_TIMEOUT;
+        sx1280_irq_mask |= SX1280_IRQ_RANGING_SLV_REQ_DISCARDED;
+    }
     if( ( ral_irq & RAL_IRQ_ALL ) == RAL_IRQ_ALL )
     {
         sx1280_irq_mask |= SX1280_IRQ_ALL;
@@ -1314,4 +1967,327 @@ static uint8_t shift_and_count_trailing_zeros( uint16_t* x )
     return exponent;
 }
 
+static ral_status_t ral_sx1280_get_ranging_calib( const ral_lora_sf_t sf, const ral_lora_bw_t bw, uint32_t* calib,
+                                                  uint32_t* bw_in_hz )
+{
+    uint8_t  bw_index = 0;
+    uint32_t bw_hz    = 0;
+
+    switch( bw )
+    {
+    case RAL_LORA_BW_400_KHZ:
+        bw_index = 0;
+        bw_hz    = 406250;
+        break;
+    case RAL_LORA_BW_800_KHZ:
+        bw_index = 1;
+        bw_hz    = 812500;
+        break;
+    case RAL_LORA_BW_1600_KHZ:
+        bw_index = 2;
+        bw_hz    = 1625000;
+        break;
+    default:
+        return RAL_STATUS_UNKNOWN_VALUE;
+    }
+    if( ( sf < RAL_LORA_SF5 ) || ( sf > RAL_LORA_SF10 ) )
+    {
+        return RAL_STATUS_UNKNOWN_VALUE;
+    }
+
+    if( calib != NULL )
+    {
+        *calib = ral_sx1280_ranging_calib[bw_index][sf - RAL_LORA_SF5];
+    }
+    if( bw_in_hz != NULL )
+    {
+        *bw_in_hz = bw_hz;
+    }
+    return RAL_STATUS_OK;
+}
+
+static void ral_sx1280_shadow_invalidate( void )
+{
+    ral_sx1280_shadow.valid_fields = 0;
+}
+
+static uint32_t ral_sx1280_regulator_current_in_ua( const uint32_t dcdc_micro_ampere )
+{
+    // the LDO draws about 1.8 times the DC-DC current from the battery
+    return ( ral_sx1280_reg_mode == SX1280_REG_MODE_LDO ) ? ( ( dcdc_micro_ampere * 9 ) / 5 ) : dcdc_micro_ampere;
+}
+
+static ral_status_t ral_sx1280_convert_tx_dbm_to_ua( const int8_t pwr_in_dbm, uint32_t* micro_ampere )
+{
+    if( ( pwr_in_dbm < -18 ) || ( pwr_in_dbm > 13 ) )
+    {
+        return RAL_STATUS_UNKNOWN_VALUE;
+    }
+
+    *micro_ampere = ral_sx1280_regulator_current_in_ua( ral_to_sx1280_lora_tx_dbm_to_ua[pwr_in_dbm + 18] );
+
+    return RAL_STATUS_OK;
+}
+
+static ral_status_t ral_sx1280_cold_start_restore( const ral_t* ral )
+{
+    ral_status_t status = RAL_STATUS_OK;
+
+    if( ral_sx1280_cold_start == true )
+    {
+        status = ( ral_status_t ) sx1280_set_reg_mode( ral->context, ral_sx1280_reg_mode );
+        if( status == RAL_STATUS_OK )
+        {
+            ral_sx1280_cold_start = false;
+        }
+    }
+
+    return status;
+}
+
+static ral_status_t ral_sx1280_batch_end( const ral_t* ral, ral_status_t status )
+{
+    const ral_status_t batch_status = ( ral_status_t ) sx1280_batch_end( ral->context );
+
+    if( status == RAL_STATUS_OK )
+    {
+        status = batch_status;
+    }
+    if( status != RAL_STATUS_OK )
+    {
+        // The shadow registers were updated when the commands were queued, not when they were sent
+        ral_sx1280_shadow_invalidate( );
+    }
+
+    return status;
+}
+
+static ral_status_t ral_sx1280_set_pkt_type_cached( const ral_t* ral, const sx1280_pkt_type_t pkt_type )
+{
+    if( ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_PKT_TYPE ) != 0 ) &&
+        ( ral_sx1280_shadow.pkt_type == pkt_type ) )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    // A new packet type resets the modulation and packet parameters
+    ral_sx1280_shadow.valid_fields &=
+        ~( RAL_SX1280_SHADOW_PKT_TYPE | RAL_SX1280_SHADOW_MOD_PARAMS | RAL_SX1280_SHADOW_PKT_PARAMS |
+           RAL_SX1280_SHADOW_SYNC_WORD );
+
+    ral_status_t status = ( ral_status_t ) sx1280_set_pkt_type( ral->context, pkt_type );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_shadow.pkt_type = pkt_type;
+        ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_PKT_TYPE;
+    }
+    return status;
+}
+
+static ral_status_t ral_sx1280_set_rf_freq_cached( const ral_t* ral, const uint32_t freq_in_hz )
+{
+    if( ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_RF_FREQ ) != 0 ) &&
+        ( ral_sx1280_shadow.freq_in_hz == freq_in_hz ) )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    ral_sx1280_shadow.valid_fields &= ~RAL_SX1280_SHADOW_RF_FREQ;
+
+    ral_status_t status = ( ral_status_t ) sx1280_set_rf_freq( ral->context, freq_in_hz );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_shadow.freq_in_hz = freq_in_hz;
+        ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_RF_FREQ;
+    }
+    return status;
+}
+
+static ral_status_t ral_sx1280_set_tx_params_cached( const ral_t* ral, const int8_t pwr_in_dbm )
+{
+    if( ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_TX_PARAMS ) != 0 ) &&
+        ( ral_sx1280_shadow.pwr_in_dbm == pwr_in_dbm ) )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    ral_sx1280_shadow.valid_fields &= ~RAL_SX1280_SHADOW_TX_PARAMS;
+
+    ral_status_t status = ( ral_status_t ) sx1280_set_tx_params( ral->context, pwr_in_dbm, SX1280_RAMP_20_US );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_shadow.pwr_in_dbm = pwr_in_dbm;
+        ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_TX_PARAMS;
+    }
+    return status;
+}
+
+static ral_status_t ral_sx1280_set_buffer_base_addr_cached( const ral_t* ral )
+{
+    if( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_BUFFER_BASE ) != 0 )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    ral_status_t status = ( ral_status_t ) sx1280_set_buffer_base_addr( ral->context, 0x00, 0x00 );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_BUFFER_BASE;
+    }
+    return status;
+}
+
+static ral_status_t ral_sx1280_set_lora_mod_params_cached( const ral_t*                    ral,
+                                                           const sx1280_mod_params_lora_t* mod_params )
+{
+    const sx1280_mod_params_lora_t* shadow = &ral_sx1280_shadow.lora_mod_params;
+
+    if( ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_MOD_PARAMS ) != 0 ) &&
+        ( shadow->sf == mod_params->sf ) && ( shadow->bw == mod_params->bw ) && ( shadow->cr == mod_params->cr ) )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    ral_sx1280_shadow.valid_fields &= ~RAL_SX1280_SHADOW_MOD_PARAMS;
+
+    ral_status_t status = ( ral_status_t ) sx1280_set_lora_mod_params( ral->context, mod_params );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_shadow.lora_mod_params = *mod_params;
+        ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_MOD_PARAMS;
+    }
+    return status;
+}
+
+static ral_status_t ral_sx1280_set_lora_pkt_params_cached( const ral_t*                    ral,
+                                                           const sx1280_pkt_params_lora_t* pkt_params )
+{
+    const sx1280_pkt_params_lora_t* shadow = &ral_sx1280_shadow.lora_pkt_params;
+
+    if( ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_PKT_PARAMS ) != 0 ) &&
+        ( shadow->pbl_len_in_symb.mant == pkt_params->pbl_len_in_symb.mant ) &&
+        ( shadow->pbl_len_in_symb.exp == pkt_params->pbl_len_in_symb.exp ) &&
+        ( shadow->hdr_type == pkt_params->hdr_type ) && ( shadow->pld_len_in_bytes == pkt_params->pld_len_in_bytes ) &&
+        ( shadow->crc_is_on == pkt_params->crc_is_on ) && ( shadow->invert_iq_is_on == pkt_params->invert_iq_is_on ) )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    ral_sx1280_shadow.valid_fields &= ~RAL_SX1280_SHADOW_PKT_PARAMS;
+
+    ral_status_t status = ( ral_status_t ) sx1280_set_lora_pkt_params( ral->context, pkt_params );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_shadow.lora_pkt_params = *pkt_params;
+        ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_PKT_PARAMS;
+    }
+    return status;
+}
+
+static ral_status_t ral_sx1280_set_lora_sync_word_cached( const ral_t* ral, const uint8_t sync_word )
+{
+    if( ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_SYNC_WORD ) != 0 ) &&
+        ( ral_sx1280_shadow.lora_sync_word == sync_word ) )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    ral_sx1280_shadow.valid_fields &= ~RAL_SX1280_SHADOW_SYNC_WORD;
+
+    ral_status_t status = ( ral_status_t ) sx1280_set_lora_sync_word( ral->context, sync_word );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_shadow.lora_sync_word = sync_word;
+        ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_SYNC_WORD;
+    }
+    return status;
+}
+
+static ral_status_t ral_sx1280_set_gfsk_mod_params_cached( const ral_t*                    ral,
+                                                           const sx1280_mod_params_gfsk_t* mod_params )
+{
+    const sx1280_mod_params_gfsk_t* shadow = &ral_sx1280_shadow.gfsk_mod_params;
+
+    if( ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_MOD_PARAMS ) != 0 ) &&
+        ( shadow->br_bw == mod_params->br_bw ) && ( shadow->mod_ind == mod_params->mod_ind ) &&
+        ( shadow->mod_shape == mod_params->mod_shape ) )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    ral_sx1280_shadow.valid_fields &= ~RAL_SX1280_SHADOW_MOD_PARAMS;
+
+    ral_status_t status = ( ral_status_t ) sx1280_set_gfsk_mod_params( ral->context, mod_params );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_shadow.gfsk_mod_params = *mod_params;
+        ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_MOD_PARAMS;
+    }
+    return status;
+}
+
+static ral_status_t ral_sx1280_set_gfsk_pkt_params_cached( const ral_t*                    ral,
+                                                           const sx1280_pkt_params_gfsk_t* pkt_params )
+{
+    const sx1280_pkt_params_gfsk_t* shadow = &ral_sx1280_shadow.gfsk_pkt_params;
+
+    if( ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_PKT_PARAMS ) != 0 ) &&
+        ( shadow->pbl_len == pkt_params->pbl_len ) && ( shadow->sync_word_len == pkt_params->sync_word_len ) &&
+        ( shadow->match_sync_word == pkt_params->match_sync_word ) && ( shadow->hdr_type == pkt_params->hdr_type ) &&
+        ( shadow->pld_len_in_bytes == pkt_params->pld_len_in_bytes ) && ( shadow->crc_type == pkt_params->crc_type ) &&
+        ( shadow->dc_free == pkt_params->dc_free ) )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    ral_sx1280_shadow.valid_fields &= ~RAL_SX1280_SHADOW_PKT_PARAMS;
+
+    ral_status_t status = ( ral_status_t ) sx1280_set_gfsk_pkt_params( ral->context, pkt_params );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_shadow.gfsk_pkt_params = *pkt_params;
+        ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_PKT_PARAMS;
+    }
+    return status;
+}
+
+static ral_status_t ral_sx1280_set_dio_irq_params_cached( const ral_t* ral, const sx1280_irq_mask_t irq_mask )
+{
+    if( ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_DIO_IRQ ) != 0 ) &&
+        ( ral_sx1280_shadow.irq_mask == irq_mask ) )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    ral_sx1280_shadow.valid_fields &= ~RAL_SX1280_SHADOW_DIO_IRQ;
+
+    ral_status_t status = ( ral_status_t ) sx1280_set_dio_irq_params( ral->context, irq_mask, irq_mask,
+                                                                      SX1280_IRQ_NONE, SX1280_IRQ_NONE );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_shadow.irq_mask = irq_mask;
+        ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_DIO_IRQ;
+    }
+    return status;
+}
+
+static ral_status_t ral_sx1280_set_long_pbl_cached( const ral_t* ral, const bool is_on )
+{
+    if( ( ( ral_sx1280_shadow.valid_fields & RAL_SX1280_SHADOW_LONG_PBL ) != 0 ) &&
+        ( ral_sx1280_shadow.long_pbl_is_on == is_on ) )
+    {
+        return RAL_STATUS_OK;
+    }
+
+    ral_sx1280_shadow.valid_fields &= ~RAL_SX1280_SHADOW_LONG_PBL;
+
+    ral_status_t status = ( ral_status_t ) sx1280_set_long_pbl( ral->context, is_on );
+    if( status == RAL_STATUS_OK )
+    {
+        ral_sx1280_shadow.long_pbl_is_on = is_on;
+        ral_sx1280_shadow.valid_fields |= RAL_SX1280_SHADOW_LONG_PBL;
+    }
+    return status;
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -177,6 +177,21 @@ ral_status_t ral_sx1280_setup_rx_flrc( const ral_t* ral, const ral_params_flrc_t
  */
 ral_status_t ral_sx1280_setup_tx_flrc( const ral_t* ral, const ral_params_flrc_t* params );
 
+/**
+ * Setup radio to transmit data using BLE packets
+ *
+ * @remark Not all radios have this modem available
+ *
+ * @remark The payload is the PDU header followed by the PDU payload, the radio adds the access address, the CRC
+ *         and the whitening
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] params BLE transmission parameters
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_setup_tx_ble( const ral_t* ral, const ral_params_ble_t* params );
+
 /**
  * Setup radio to transmit data using LoRaE modem
  *
@@ -217,6 +232,18 @@ ral_status_t ral_sx1280_tx_bpsk( const ral_t* ral, const ral_params_bpsk_t* para
  */
 ral_status_t ral_sx1280_setup_cad( const ral_t* ral, const ral_lora_cad_params_t* params );
 
+/**
+ * Setup radio in ranging mode
+ *
+ * @remark Not all radios have this feature available
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] params Ranging parameters
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_setup_ranging( const ral_t* ral, const ral_params_ranging_t* params );
+
 /**
  * Fills radio transmission buffer
  *
@@ -242,6 +269,34 @@ ral_status_t ral_sx1280_set_pkt_payload( const ral_t* ral, const uint8_t* buffer
  */
 ral_status_t ral_sx1280_get_pkt_payload( const ral_t* ral, uint8_t* buffer, uint16_t max_size, uint16_t* size );
 
+/**
+ * Fetches radio reception buffer located by \ref ral_sx1280_process_and_clear_irq
+ *
+ * @param [in]  radio            Pointer to radio data
+ * @param [in]  rx_buffer_status Length and offset of the received packet
+ * @param [out] buffer           Pointer to the buffer to be filled with received data
+ * @param [in]  max_size         Size of user-provided buffer
+ * @param [out] size             If non-zero, received packet size will be put here
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_read_pkt_payload( const ral_t* ral, const ral_rx_buffer_status_t* rx_buffer_status,
+                                          uint8_t* buffer, uint16_t max_size, uint16_t* size );
+
+/**
+ * Fetches part of the radio reception buffer located by \ref ral_sx1280_process_and_clear_irq
+ *
+ * @param [in]  radio            Pointer to radio data
+ * @param [in]  rx_buffer_status Length and offset of the received packet
+ * @param [in]  offset           Offset of the first byte to read in the received packet
+ * @param [out] buffer           Pointer to the buffer to be filled with received data
+ * @param [in]  size             Number of bytes to read
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_read_pkt_payload_part( const ral_t* ral, const ral_rx_buffer_status_t* rx_buffer_status,
+                                               const uint8_t offset, uint8_t* buffer, const uint16_t size );
+
 /**
  * Fetches packet status
  *
@@ -295,6 +350,43 @@ ral_status_t ral_sx1280_get_flrc_pkt_status( const ral_t* ral, ral_rx_pkt_status
  */
 ral_status_t ral_sx1280_set_sleep( const ral_t* ral );
 
+/**
+ * Radio is set in Sleep mode, with or without its configuration retained
+ *
+ * @remark A warm start sleep saves the register context first, the next setup then only sends the changed
+ *         settings. A cold start sleep draws less current but the next setup programs the radio again.
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] cfg   Sleep configuration
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_set_sleep_with_cfg( const ral_t* ral, const ral_sleep_cfg_t cfg );
+
+/**
+ * Select the power regulator of the radio
+ *
+ * @remark The selected regulator is programmed again on wake-up from a cold start sleep
+ *
+ * @param [in] radio    Pointer to radio data
+ * @param [in] reg_mode Regulator mode
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_set_reg_mode( const ral_t* ral, const ral_reg_mode_t reg_mode );
+
+/**
+ * Select the LNA regime of the radio receiver
+ *
+ * @remark Only sent to the radio when it differs from the last selected regime
+ *
+ * @param [in] radio    Pointer to radio data
+ * @param [in] lna_mode LNA mode
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_set_lna_mode( const ral_t* ral, const ral_lna_mode_t lna_mode );
+
 /**
  * Radio is set in Standby mode
  *
@@ -331,6 +423,45 @@ ral_status_t ral_sx1280_set_tx_cw( const ral_t* ral );
  */
 ral_status_t ral_sx1280_set_rx( const ral_t* ral, const uint32_t timeout_ms );
 
+/**
+ * Radio is set in Rx duty cycle mode: it alternates Rx and sleep on its own timer until a packet is received
+ *
+ * @remark The transmitter preamble must last at least sleep_time_in_ms + 2 * rx_time_in_ms to be detected
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] rx_time_in_ms Rx window duration
+ * @param [in] sleep_time_in_ms Sleep duration between two Rx windows
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_set_rx_duty_cycle( const ral_t* ral, const uint32_t rx_time_in_ms,
+                                           const uint32_t sleep_time_in_ms );
+
+/**
+ * Radio starts a ranging exchange: the master sends its request, the slave waits for one and answers it
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] role Role given to the ranging setup
+ * @param [in] timeout_ms Time given to the exchange, 0 for a slave listening until the next standby
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_set_ranging( const ral_t* ral, const ral_ranging_role_t role, const uint32_t timeout_ms );
+
+/**
+ * Gets the distance measured by the last ranging exchange, on the master side
+ *
+ * @remark The raw result is scaled by the bandwidth, the Rx/Tx delay calibration is applied by the radio
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] params Ranging parameters of the exchange
+ * @param [out] distance_in_cm Distance to the slave, can be slightly negative at short range
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_get_ranging_result( const ral_t* ral, const ral_params_ranging_t* params,
+                                            int32_t* distance_in_cm );
+
 /**
  * Radio is set in CAD mode
  *
@@ -389,6 +520,20 @@ ral_status_t ral_sx1280_set_dio_irq_params( const ral_t* ral, const ral_irq_t ra
  */
 ral_status_t ral_sx1280_process_irq( const ral_t* ral, ral_irq_t* ral_irq );
 
+/**
+ * Retrives and clears the current radio irq status, and locates the received packet
+ *
+ * @remark Must be the first function to be called by the radio IRQ handler
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [out] ral_irq Radio irq status before the clear
+ * @param [out] rx_buffer_status Length and offset of the last received packet
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_process_and_clear_irq( const ral_t* ral, ral_irq_t* ral_irq,
+                                               ral_rx_buffer_status_t* rx_buffer_status );
+
 /**
  * Gets current RSSI value
  *
@@ -398,6 +543,16 @@ ral_status_t ral_sx1280_process_irq( const ral_t* ral, ral_irq_t* ral_irq );
  */
 ral_status_t ral_sx1280_get_rssi( const ral_t* ral, int16_t* rssi );
 
+/**
+ * Reprograms the RF frequency only, leaving the radio in its current mode
+ *
+ * @param [in] radio Pointer to radio data
+ * @param [in] freq_in_hz RF frequency in Hertz
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_set_rf_freq( const ral_t* ral, const uint32_t freq_in_hz );
+
 /**
  * Gets time on air, in milliseconds
  *
@@ -448,6 +603,46 @@ ral_status_t ral_sx1280_convert_lora_rx_bw_to_ua( const ral_params_lora_t* param
  */
 ral_status_t ral_sx1280_convert_lora_tx_dbm_to_ua( const ral_params_lora_t* params, uint32_t* micro_ampere );
 
+/**
+ * Gets RX power consumption, in micro_ampere from bitrate
+ *
+ * @param [in] params
+ * @param [out] micro_ampere
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_convert_gfsk_rx_br_to_ua( const ral_params_gfsk_t* params, uint32_t* micro_ampere );
+
+/**
+ * Gets TX power consumption, in micro_ampere from TX dbm
+ *
+ * @param [in] params
+ * @param [out] micro_ampere
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_convert_gfsk_tx_dbm_to_ua( const ral_params_gfsk_t* params, uint32_t* micro_ampere );
+
+/**
+ * Gets RX power consumption, in micro_ampere from bitrate
+ *
+ * @param [in] params
+ * @param [out] micro_ampere
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_convert_flrc_rx_br_to_ua( const ral_params_flrc_t* params, uint32_t* micro_ampere );
+
+/**
+ * Gets TX power consumption, in micro_ampere from TX dbm
+ *
+ * @param [in] params
+ * @param [out] micro_ampere
+ *
+ * @retval status Operation status
+ */
+ral_status_t ral_sx1280_convert_flrc_tx_dbm_to_ua( const ral_params_flrc_t* params, uint32_t* micro_ampere );
+
 /**
  * Gets register values
  *
@@ -59,6 +59,18 @@
 
 #define INV_FREQ_STEP ( 1.0F * ( 1U << XTAL_FREQ_STEP_DIV_POWER ) / XTAL_FREQ )
 
+/*!
+ * Size of the command batch buffer, each queued command takes its length plus one byte
+ */
+#define SX1280_BATCH_BUFFER_SIZE 64
+
+/*!
+ * Layout of the GetIrqStatus, ClearIrqStatus and GetRxBufferStatus sequence of sx1280_process_and_clear_irq
+ */
+#define SX1280_IRQ_BATCH_SIZE 14
+#define SX1280_IRQ_BATCH_IRQ_STATUS_INDEX 3
+#define SX1280_IRQ_BATCH_RX_BUFFER_STATUS_INDEX 12
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -205,16 +217,53 @@ static const sx1280_gfsk_mod_ind_frac_t sx1280_gfsk_mod_ind[] = {
 
 };
 
+/*!
+ * Commands queued between sx1280_batch_begin and sx1280_batch_end
+ */
+typedef struct sx1280_batch_s
+{
+    bool     is_open;
+    uint16_t length;
+    uint8_t  buffer[SX1280_BATCH_BUFFER_SIZE];
+} sx1280_batch_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
+static sx1280_batch_t sx1280_batch = { .is_open = false, .length = 0 };
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+/*!
+ * Send a command, or queue it while a batch is open
+ *
+ * \remark SetSleep is never queued: it flushes the batch and is sent right away
+ */
+static sx1280_status_t sx1280_write_cmd( const void* context, const uint8_t* command, const uint16_t command_length,
+                                         const uint8_t* data, const uint16_t data_length );
+
+/*!
+ * Flush the queued commands, then read from the radio
+ */
+static sx1280_status_t sx1280_read_cmd( const void* context, const uint8_t* command, const uint16_t command_length,
+                                        uint8_t* data, const uint16_t data_length );
+
+/*!
+ * Send the queued commands and empty the batch buffer
+ */
+static sx1280_status_t sx1280_batch_flush( const void* context );
+
+/*!
+ * Update the HAL operating mode once an IRQ has ended the radio operation
+ */
+static void sx1280_update_operating_mode_on_irq( const void* context, const sx1280_operating_mode_t op_mode,
+                                                 const sx1280_irq_mask_t irq_status );
+
 static uint32_t sx1280_get_pbl_len_in_bits_gfsk_flrc( sx1280_gfsk_pbl_len_t pbl_len );
 
 static uint32_t sx1280_get_sync_word_len_in_bytes_gfsk( sx1280_gfsk_sync_word_len_t sync_word_len );
@@ -257,7 +306,7 @@ sx1280_status_t sx1280_set_sleep( const void* context, const sx1280_sleep_cfg_t
 
     buf[1] = ( uint8_t ) cfg;
 
-    status = ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_SLEEP, 0, 0 );
+    status = sx1280_write_cmd( context, buf, SX1280_SIZE_SET_SLEEP, 0, 0 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -276,7 +325,7 @@ sx1280_status_t sx1280_set_standby( const void* context, const sx1280_standby_cf
 
     buf[1] = ( uint8_t ) cfg;
 
-    status = ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_STANDBY, 0, 0 );
+    status = sx1280_write_cmd( context, buf, SX1280_SIZE_SET_STANDBY, 0, 0 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -292,6 +341,29 @@ sx1280_status_t sx1280_wakeup( const void* context )
     return ( sx1280_status_t ) sx1280_hal_wakeup( context );
 }
 
+sx1280_status_t sx1280_batch_begin( const void* context )
+{
+    // Wake the radio up now: a queued SetStandby updates the operating mode before it is actually sent
+    sx1280_status_t status = ( sx1280_status_t ) sx1280_hal_wakeup( context );
+
+    if( status == SX1280_STATUS_OK )
+    {
+        sx1280_batch.is_open = true;
+        sx1280_batch.length  = 0;
+    }
+
+    return status;
+}
+
+sx1280_status_t sx1280_batch_end( const void* context )
+{
+    sx1280_status_t status = sx1280_batch_flush( context );
+
+    sx1280_batch.is_open = false;
+
+    return status;
+}
+
 sx1280_status_t sx1280_set_fs( const void* context )
 {
     sx1280_status_t status                  = SX1280_STATUS_ERROR;
@@ -299,7 +371,7 @@ sx1280_status_t sx1280_set_fs( const void* context )
 
     buf[0] = SX1280_SET_FS;
 
-    status = ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_FS, 0, 0 );
+    status = sx1280_write_cmd( context, buf, SX1280_SIZE_SET_FS, 0, 0 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -320,7 +392,7 @@ sx1280_status_t sx1280_set_tx( const void* context, sx1280_tick_size_t period_ba
     buf[2] = ( uint8_t )( timeout_in_ticks >> 8 );
     buf[3] = ( uint8_t )( timeout_in_ticks >> 0 );
 
-    status = ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_TX, 0, 0 );
+    status = sx1280_write_cmd( context, buf, SX1280_SIZE_SET_TX, 0, 0 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -341,7 +413,7 @@ sx1280_status_t sx1280_set_rx( const void* context, sx1280_tick_size_t period_ba
     buf[2] = ( uint8_t )( timeout_in_ticks >> 8 );
     buf[3] = ( uint8_t )( timeout_in_ticks >> 0 );
 
-    status = ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_RX, 0, 0 );
+    status = sx1280_write_cmd( context, buf, SX1280_SIZE_SET_RX, 0, 0 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -374,7 +446,7 @@ sx1280_status_t sx1280_set_rx_duty_cycle( const void* context, sx1280_tick_size_
     buf[4] = ( uint8_t )( sleep_time >> 8 );
     buf[5] = ( uint8_t )( sleep_time >> 0 );
 
-    status = ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_RXDUTYCYCLE, 0, 0 );
+    status = sx1280_write_cmd( context, buf, SX1280_SIZE_SET_RXDUTYCYCLE, 0, 0 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -391,7 +463,7 @@ sx1280_status_t sx1280_set_cad( const void* context )
 
     buf[0] = SX1280_SET_CAD;
 
-    status = ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_CAD, 0, 0 );
+    status = sx1280_write_cmd( context, buf, SX1280_SIZE_SET_CAD, 0, 0 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -408,7 +480,7 @@ sx1280_status_t sx1280_set_tx_cw( const void* context )
 
     buf[0] = SX1280_SET_TXCONTINUOUSWAVE;
 
-    status = ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_TXCONTINUOUSWAVE, 0, 0 );
+    status = sx1280_write_cmd( context, buf, SX1280_SIZE_SET_TXCONTINUOUSWAVE, 0, 0 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -425,7 +497,7 @@ sx1280_status_t sx1280_set_tx_cpbl( const void* context )
 
     buf[0] = SX1280_SET_TXCONTINUOUSPREAMBLE;
 
-    status = ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_TXCONTINUOUSPREAMBLE, 0, 0 );
+    status = sx1280_write_cmd( context, buf, SX1280_SIZE_SET_TXCONTINUOUSPREAMBLE, 0, 0 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -449,7 +521,7 @@ sx1280_status_t sx1280_write_register( const void* context, const uint16_t addr,
     buf[1] = ( uint8_t )( addr >> 8 );
     buf[2] = ( uint8_t )( addr >> 0 );
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_WRITE_REGISTER, buffer, size );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_WRITE_REGISTER, buffer, size );
 }
 
 sx1280_status_t sx1280_read_register( const void* context, const uint16_t addr, uint8_t* buffer, const uint8_t size )
@@ -462,7 +534,7 @@ sx1280_status_t sx1280_read_register( const void* context, const uint16_t addr,
     buf[1] = ( uint8_t )( addr >> 8 );
     buf[2] = ( uint8_t )( addr >> 0 );
 
-    status = ( sx1280_status_t ) sx1280_hal_read( context, buf, SX1280_SIZE_READ_REGISTER, buffer, size );
+    status = sx1280_read_cmd( context, buf, SX1280_SIZE_READ_REGISTER, buffer, size );
 
     return status;
 }
@@ -476,7 +548,7 @@ sx1280_status_t sx1280_write_buffer( const void* context, const uint8_t offset,
 
     buf[1] = offset;
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_WRITE_BUFFER, buffer, size );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_WRITE_BUFFER, buffer, size );
 }
 
 sx1280_status_t sx1280_read_buffer( const void* context, const uint8_t offset, uint8_t* buffer, const uint8_t size )
@@ -488,7 +560,7 @@ sx1280_status_t sx1280_read_buffer( const void* context, const uint8_t offset, u
 
     buf[1] = offset;
 
-    status = ( sx1280_status_t ) sx1280_hal_read( context, buf, SX1280_SIZE_READ_BUFFER, buffer, size );
+    status = sx1280_read_cmd( context, buf, SX1280_SIZE_READ_BUFFER, buffer, size );
 
     return status;
 }
@@ -515,7 +587,7 @@ sx1280_status_t sx1280_set_dio_irq_params( const void* context, const uint16_t i
     buf[7] = ( uint8_t )( dio3_mask >> 8 );
     buf[8] = ( uint8_t )( dio3_mask >> 0 );
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_DIOIRQPARAMS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_DIOIRQPARAMS, 0, 0 );
 }
 
 sx1280_status_t sx1280_get_irq_status( const void* context, sx1280_irq_mask_t* irq )
@@ -526,8 +598,7 @@ sx1280_status_t sx1280_get_irq_status( const void* context, sx1280_irq_mask_t* i
 
     buf[0] = SX1280_GET_IRQSTATUS;
 
-    status = ( sx1280_status_t ) sx1280_hal_read( context, buf, SX1280_SIZE_GET_IRQSTATUS, irq_local,
-                                                  sizeof( sx1280_irq_mask_t ) );
+    status = sx1280_read_cmd( context, buf, SX1280_SIZE_GET_IRQSTATUS, irq_local, sizeof( sx1280_irq_mask_t ) );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -546,7 +617,7 @@ sx1280_status_t sx1280_clear_irq_status( const void* context, const sx1280_irq_m
     buf[1] = ( uint8_t )( irq_mask >> 8 );
     buf[2] = ( uint8_t )( irq_mask >> 0 );
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_CLR_IRQSTATUS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_CLR_IRQSTATUS, 0, 0 );
 }
 
 sx1280_status_t sx1280_get_and_clear_irq_status( const void* context, sx1280_irq_mask_t* irq )
@@ -585,7 +656,7 @@ sx1280_status_t sx1280_set_rf_freq( const void* context, const uint32_t freq_in_
     buf[2] = ( uint8_t )( freq >> 8 );
     buf[3] = ( uint8_t )( freq >> 0 );
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_RFFREQUENCY, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_RFFREQUENCY, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_pkt_type( const void* context, const sx1280_pkt_type_t pkt_type )
@@ -596,7 +667,7 @@ sx1280_status_t sx1280_set_pkt_type( const void* context, const sx1280_pkt_type_
 
     buf[1] = ( uint8_t ) pkt_type;
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_PACKETTYPE, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_PACKETTYPE, 0, 0 );
 }
 
 sx1280_status_t sx1280_get_pkt_type( const void* context, sx1280_pkt_type_t* pkt_type )
@@ -606,7 +677,7 @@ sx1280_status_t sx1280_get_pkt_type( const void* context, sx1280_pkt_type_t* pkt
 
     buf[0] = SX1280_GET_PACKETTYPE;
 
-    status = ( sx1280_status_t ) sx1280_hal_read( context, buf, SX1280_SIZE_GET_PACKETTYPE, ( uint8_t* ) pkt_type, 1 );
+    status = sx1280_read_cmd( context, buf, SX1280_SIZE_GET_PACKETTYPE, ( uint8_t* ) pkt_type, 1 );
 
     return status;
 }
@@ -625,7 +696,7 @@ sx1280_status_t sx1280_set_tx_params( const void* context, const int8_t power, c
     buf[1] = ( uint8_t )( power + 18 );
     buf[2] = ( uint8_t ) ramp_time;
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_TXPARAMS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_TXPARAMS, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_gfsk_mod_params( const void* context, const sx1280_mod_params_gfsk_t* params )
@@ -638,7 +709,7 @@ sx1280_status_t sx1280_set_gfsk_mod_params( const void* context, const sx1280_mo
     buf[2] = params->mod_ind;
     buf[3] = params->mod_shape;
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_MODULATIONPARAMS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_MODULATIONPARAMS, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_lora_mod_params( const void* context, const sx1280_mod_params_lora_t* params )
@@ -652,7 +723,7 @@ sx1280_status_t sx1280_set_lora_mod_params( const void* context, const sx1280_mo
     buf[2] = ( uint8_t )( params->bw );
     buf[3] = ( uint8_t )( params->cr );
 
-    status = ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_MODULATIONPARAMS, 0, 0 );
+    status = sx1280_write_cmd( context, buf, SX1280_SIZE_SET_MODULATIONPARAMS, 0, 0 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -706,7 +777,7 @@ sx1280_status_t sx1280_set_range_mod_params( const void* context, const sx1280_m
     buf[2] = ( uint8_t )( params->bw );
     buf[3] = ( uint8_t )( params->cr );
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_MODULATIONPARAMS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_MODULATIONPARAMS, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_flrc_mod_params( const void* context, const sx1280_mod_params_flrc_t* params )
@@ -719,7 +790,7 @@ sx1280_status_t sx1280_set_flrc_mod_params( const void* context, const sx1280_mo
     buf[2] = ( uint8_t )( params->cr );
     buf[3] = ( uint8_t )( params->mod_shape );
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_MODULATIONPARAMS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_MODULATIONPARAMS, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_ble_mod_params( const void* context, const sx1280_mod_params_ble_t* params )
@@ -732,7 +803,7 @@ sx1280_status_t sx1280_set_ble_mod_params( const void* context, const sx1280_mod
     buf[2] = ( uint8_t )( params->mod_ind );
     buf[3] = ( uint8_t )( params->mod_shape );
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_MODULATIONPARAMS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_MODULATIONPARAMS, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_gfsk_pkt_params( const void* context, const sx1280_pkt_params_gfsk_t* params )
@@ -749,7 +820,7 @@ sx1280_status_t sx1280_set_gfsk_pkt_params( const void* context, const sx1280_pk
     buf[6] = ( uint8_t )( params->crc_type );
     buf[7] = ( uint8_t )( params->dc_free );
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_PACKETPARAMS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_PACKETPARAMS, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_lora_pkt_params( const void* context, const sx1280_pkt_params_lora_t* params )
@@ -765,7 +836,7 @@ sx1280_status_t sx1280_set_lora_pkt_params( const void* context, const sx1280_pk
     buf[4] = ( uint8_t )( ( params->crc_is_on == true ) ? 0x20 : 0x00 );
     buf[5] = ( uint8_t )( ( params->invert_iq_is_on == true ) ? 0x00 : 0x40 );
 
-    status = ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_PACKETPARAMS, 0, 0 );
+    status = sx1280_write_cmd( context, buf, SX1280_SIZE_SET_PACKETPARAMS, 0, 0 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -788,7 +859,7 @@ sx1280_status_t sx1280_set_range_pkt_params( const void* context, const sx1280_p
     buf[4] = ( uint8_t )( ( params->crc_is_on == true ) ? 0x20 : 0x00 );
     buf[5] = ( uint8_t )( ( params->invert_iq_is_on == true ) ? 0x00 : 0x40 );
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_PACKETPARAMS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_PACKETPARAMS, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_flrc_pkt_params( const void* context, const sx1280_pkt_params_flrc_t* params )
@@ -805,7 +876,7 @@ sx1280_status_t sx1280_set_flrc_pkt_params( const void* context, const sx1280_pk
     buf[6] = ( uint8_t )( params->crc_type );
     buf[7] = SX1280_GFSK_FLRC_BLE_DC_FREE_OFF;
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_PACKETPARAMS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_PACKETPARAMS, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_ble_pkt_params( const void* context, const sx1280_pkt_params_ble_t* params )
@@ -819,7 +890,7 @@ sx1280_status_t sx1280_set_ble_pkt_params( const void* context, const sx1280_pkt
     buf[3] = ( uint8_t )( params->pkt_type );
     buf[4] = ( uint8_t )( params->dc_free );
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_PACKETPARAMS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_PACKETPARAMS, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_cad_params( const void* context, const sx1280_lora_cad_params_t* params )
@@ -830,7 +901,7 @@ sx1280_status_t sx1280_set_cad_params( const void* context, const sx1280_lora_ca
 
     buf[1] = ( uint8_t ) params->cad_symb_nb;
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_CADPARAMS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_CADPARAMS, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_buffer_base_addr( const void* context, const uint8_t tx_base_addr,
@@ -843,7 +914,7 @@ sx1280_status_t sx1280_set_buffer_base_addr( const void* context, const uint8_t
     buf[1] = tx_base_addr;
     buf[2] = rx_base_addr;
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_BUFFERBASEADDRESS, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_BUFFERBASEADDRESS, 0, 0 );
 }
 
 //
@@ -858,7 +929,7 @@ sx1280_status_t sx1280_get_status( const void* context, sx1280_chip_status_t* ra
 
     buf[0] = SX1280_GET_STATUS;
 
-    status = ( sx1280_status_t ) sx1280_hal_read( context, buf, SX1280_SIZE_GET_STATUS, &radio_status_raw, 1 );
+    status = sx1280_read_cmd( context, buf, SX1280_SIZE_GET_STATUS, &radio_status_raw, 1 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -879,8 +950,8 @@ sx1280_status_t sx1280_get_rx_buffer_status( const void* context, sx1280_rx_buff
 
     buf[0] = SX1280_GET_RXBUFFERSTATUS;
 
-    status = ( sx1280_status_t ) sx1280_hal_read( context, buf, SX1280_SIZE_GET_RXBUFFERSTATUS, rx_buffer_status_raw,
-                                                  sizeof( sx1280_rx_buffer_status_t ) );
+    status = sx1280_read_cmd( context, buf, SX1280_SIZE_GET_RXBUFFERSTATUS, rx_buffer_status_raw,
+                              sizeof( sx1280_rx_buffer_status_t ) );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -899,7 +970,7 @@ sx1280_status_t sx1280_get_gfsk_pkt_status( const void* context, sx1280_pkt_stat
 
     buf[0] = SX1280_GET_PACKETSTATUS;
 
-    status = ( sx1280_status_t ) sx1280_hal_read( context, buf, SX1280_SIZE_GET_PACKETSTATUS, pkt_status_raw, 5 );
+    status = sx1280_read_cmd( context, buf, SX1280_SIZE_GET_PACKETSTATUS, pkt_status_raw, 5 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -921,7 +992,7 @@ sx1280_status_t sx1280_get_lora_pkt_status( const void* context, sx1280_pkt_stat
 
     buf[0] = SX1280_GET_PACKETSTATUS;
 
-    status = ( sx1280_status_t ) sx1280_hal_read( context, buf, SX1280_SIZE_GET_PACKETSTATUS, pkt_status_raw, 5 );
+    status = sx1280_read_cmd( context, buf, SX1280_SIZE_GET_PACKETSTATUS, pkt_status_raw, 5 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -940,7 +1011,7 @@ sx1280_status_t sx1280_get_range_pkt_status( const void* context, sx1280_pkt_sta
 
     buf[0] = SX1280_GET_PACKETSTATUS;
 
-    status = ( sx1280_status_t ) sx1280_hal_read( context, buf, SX1280_SIZE_GET_PACKETSTATUS, pkt_status_raw, 5 );
+    status = sx1280_read_cmd( context, buf, SX1280_SIZE_GET_PACKETSTATUS, pkt_status_raw, 5 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -959,7 +1030,7 @@ sx1280_status_t sx1280_get_flrc_pkt_status( const void* context, sx1280_pkt_stat
 
     buf[0] = SX1280_GET_PACKETSTATUS;
 
-    status = ( sx1280_status_t ) sx1280_hal_read( context, buf, SX1280_SIZE_GET_PACKETSTATUS, pkt_status_raw, 5 );
+    status = sx1280_read_cmd( context, buf, SX1280_SIZE_GET_PACKETSTATUS, pkt_status_raw, 5 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -981,7 +1052,7 @@ sx1280_status_t sx1280_get_ble_pkt_status( const void* context, sx1280_pkt_statu
 
     buf[0] = SX1280_GET_PACKETSTATUS;
 
-    status = ( sx1280_status_t ) sx1280_hal_read( context, buf, SX1280_SIZE_GET_PACKETSTATUS, pkt_status_raw, 5 );
+    status = sx1280_read_cmd( context, buf, SX1280_SIZE_GET_PACKETSTATUS, pkt_status_raw, 5 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -1003,7 +1074,7 @@ sx1280_status_t sx1280_get_rssi_inst( const void* context, int16_t* rssi )
 
     buf[0] = SX1280_GET_RSSIINST;
 
-    status = ( sx1280_status_t ) sx1280_hal_read( context, buf, SX1280_SIZE_GET_RSSIINST, &rssi_raw, 1 );
+    status = sx1280_read_cmd( context, buf, SX1280_SIZE_GET_RSSIINST, &rssi_raw, 1 );
 
     if( status == SX1280_STATUS_OK )
     {
@@ -1035,25 +1106,54 @@ sx1280_status_t sx1280_process_irq( const void* context, sx1280_irq_mask_t* irq_
 
     sx1280_get_irq_status( context, irq_status );
 
-    if( ( ( *irq_status & SX1280_IRQ_TX_DONE ) == SX1280_IRQ_TX_DONE ) ||
-        ( ( *irq_status & SX1280_IRQ_CAD_DONE ) == SX1280_IRQ_CAD_DONE ) ||
-        ( ( *irq_status & SX1280_IRQ_TIMEOUT ) == SX1280_IRQ_TIMEOUT ) )
+    sx1280_update_operating_mode_on_irq( context, op_mode, *irq_status );
+
+    return SX1280_STATUS_OK;
+}
+
+sx1280_status_t sx1280_process_and_clear_irq( const void* context, sx1280_irq_mask_t* irq_status,
+                                              sx1280_rx_buffer_status_t* rx_buffer_status )
+{
+    // Each command is prefixed by its length, the bytes clocked in are stored at the same index
+    const uint8_t batch[SX1280_IRQ_BATCH_SIZE] = {
+        SX1280_SIZE_GET_IRQSTATUS + sizeof( sx1280_irq_mask_t ),
+        SX1280_GET_IRQSTATUS,
+        0x00,
+        0x00,
+        0x00,
+        SX1280_SIZE_CLR_IRQSTATUS,
+        SX1280_CLR_IRQSTATUS,
+        ( uint8_t )( SX1280_IRQ_ALL >> 8 ),
+        ( uint8_t )( SX1280_IRQ_ALL >> 0 ),
+        SX1280_SIZE_GET_RXBUFFERSTATUS + sizeof( sx1280_rx_buffer_status_t ),
+        SX1280_GET_RXBUFFERSTATUS,
+        0x00,
+        0x00,
+        0x00,
+    };
+    uint8_t                 response[SX1280_IRQ_BATCH_SIZE] = { 0 };
+    sx1280_operating_mode_t op_mode                         = sx1280_get_operating_mode( context );
+    sx1280_status_t         status                          = SX1280_STATUS_ERROR;
+
+    if( sx1280_batch_flush( context ) != SX1280_STATUS_OK )
     {
-        sx1280_hal_set_operating_mode( context, SX1280_HAL_OP_MODE_STDBY_RC );
+        return SX1280_STATUS_ERROR;
     }
 
-    if( ( ( *irq_status & SX1280_IRQ_HEADER_ERROR ) == SX1280_IRQ_HEADER_ERROR ) ||
-        ( ( *irq_status & SX1280_IRQ_SYNC_WORD_ERROR ) == SX1280_IRQ_SYNC_WORD_ERROR ) ||
-        ( ( *irq_status & SX1280_IRQ_RX_DONE ) == SX1280_IRQ_RX_DONE ) ||
-        ( ( *irq_status & SX1280_IRQ_CRC_ERROR ) == SX1280_IRQ_CRC_ERROR ) )
+    status = ( sx1280_status_t ) sx1280_hal_transfer_batch( context, batch, response, SX1280_IRQ_BATCH_SIZE );
+
+    if( status == SX1280_STATUS_OK )
     {
-        if( op_mode != SX1280_OP_MODE_RX_C )
-        {
-            sx1280_hal_set_operating_mode( context, SX1280_HAL_OP_MODE_STDBY_RC );
-        }
+        *irq_status = ( ( sx1280_irq_mask_t ) response[SX1280_IRQ_BATCH_IRQ_STATUS_INDEX] << 8 ) +
+                      ( ( sx1280_irq_mask_t ) response[SX1280_IRQ_BATCH_IRQ_STATUS_INDEX + 1] << 0 );
+
+        rx_buffer_status->pld_len_in_bytes     = response[SX1280_IRQ_BATCH_RX_BUFFER_STATUS_INDEX];
+        rx_buffer_status->buffer_start_pointer = response[SX1280_IRQ_BATCH_RX_BUFFER_STATUS_INDEX + 1];
+
+        sx1280_update_operating_mode_on_irq( context, op_mode, *irq_status );
     }
 
-    return SX1280_STATUS_OK;
+    return status;
 }
 
 sx1280_status_t sx1280_set_long_pbl( const void* context, const bool state )
@@ -1064,7 +1164,7 @@ sx1280_status_t sx1280_set_long_pbl( const void* context, const bool state )
 
     buf[1] = ( uint8_t )( ( state == true ) ? 0x01 : 0x00 );
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_LONGPREAMBLE, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_LONGPREAMBLE, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_reg_mode( const void* context, const sx1280_reg_mod_t mode )
@@ -1075,7 +1175,7 @@ sx1280_status_t sx1280_set_reg_mode( const void* context, const sx1280_reg_mod_t
 
     buf[1] = ( uint8_t ) mode;
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_REGULATORMODE, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_REGULATORMODE, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_lna_settings( const void* context, sx1280_lna_settings_t settings )
@@ -1108,7 +1208,7 @@ sx1280_status_t sx1280_save_context( const void* context )
 
     buf[0] = SX1280_SET_SAVECONTEXT;
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_SAVECONTEXT, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_SAVECONTEXT, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_ranging_role( const void* context, const sx1280_range_role_t role )
@@ -1119,7 +1219,7 @@ sx1280_status_t sx1280_set_ranging_role( const void* context, const sx1280_range
 
     buf[1] = ( uint8_t ) role;
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_RANGING_ROLE, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_RANGING_ROLE, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_adv_ranging( const void* context, const bool state )
@@ -1130,7 +1230,7 @@ sx1280_status_t sx1280_set_adv_ranging( const void* context, const bool state )
 
     buf[1] = ( uint8_t )( ( state == true ) ? 0x01 : 0x00 );
 
-    return ( sx1280_status_t ) sx1280_hal_write( context, buf, SX1280_SIZE_SET_ADV_RANGING, 0, 0 );
+    return sx1280_write_cmd( context, buf, SX1280_SIZE_SET_ADV_RANGING, 0, 0 );
 }
 
 sx1280_status_t sx1280_set_gfsk_flrc_sync_word_tolerance( const void* context, uint8_t tolerance )
@@ -1487,11 +1587,231 @@ sx1280_status_t sx1280_get_lora_rx_packet_crc_config( const void* context, bool*
     return status;
 }
 
+sx1280_status_t sx1280_set_ranging_dev_addr( const void* context, const uint32_t address )
+{
+    uint8_t addr[] = {
+        ( uint8_t )( address >> 24 ),
+        ( uint8_t )( address >> 16 ),
+        ( uint8_t )( address >> 8 ),
+        ( uint8_t ) address,
+    };
+
+    return sx1280_write_register( context, SX1280_REG_RANGE_SLV_REQ_ADDR, addr, sizeof( addr ) );
+}
+
+sx1280_status_t sx1280_set_ranging_req_addr( const void* context, const uint32_t address )
+{
+    uint8_t addr[] = {
+        ( uint8_t )( address >> 24 ),
+        ( uint8_t )( address >> 16 ),
+        ( uint8_t )( address >> 8 ),
+        ( uint8_t ) address,
+    };
+
+    return sx1280_write_register( context, SX1280_REG_RANGE_MST_REQ_ADDR, addr, sizeof( addr ) );
+}
+
+sx1280_status_t sx1280_set_ranging_id_check_length( const void* context, const uint8_t length )
+{
+    sx1280_status_t status    = SX1280_STATUS_ERROR;
+    uint8_t         reg_value = 0;
+
+    if( ( length == 0 ) || ( length > 4 ) )
+    {
+        return SX1280_STATUS_UNKNOWN_VALUE;
+    }
+
+    // The 2 MSBits hold the number of bytes minus one, the 6 LSBits must not be modified
+    status = sx1280_read_register( context, SX1280_REG_RANGE_ID_LEN_CHECK, &reg_value, 1 );
+    if( status == SX1280_STATUS_OK )
+    {
+        reg_value = ( reg_value & 0x3F ) | ( ( ( length - 1 ) & 0x03 ) << 6 );
+        status    = sx1280_write_register( context, SX1280_REG_RANGE_ID_LEN_CHECK, &reg_value, 1 );
+    }
+
+    return status;
+}
+
+sx1280_status_t sx1280_set_ranging_calib( const void* context, const uint32_t calib )
+{
+    uint8_t cal[] = {
+        ( uint8_t )( calib >> 16 ),
+        ( uint8_t )( calib >> 8 ),
+        ( uint8_t ) calib,
+    };
+
+    return sx1280_write_register( context, SX1280_REG_RANGE_RX_TX_DELAY_CAL, cal, sizeof( cal ) );
+}
+
+sx1280_status_t sx1280_get_ranging_result( const void* context, const sx1280_range_result_types_t type,
+                                           int32_t* result )
+{
+    sx1280_status_t status    = SX1280_STATUS_ERROR;
+    uint8_t         reg_value = 0;
+    uint8_t         buffer[3] = { 0 };
+
+    status = sx1280_read_register( context, SX1280_REG_RANGE_RESULTS_CFG, &reg_value, 1 );
+    if( status != SX1280_STATUS_OK )
+    {
+        return status;
+    }
+    reg_value = ( reg_value & 0xCF ) | ( ( ( uint8_t ) type & 0x03 ) << 4 );
+    status    = sx1280_write_register( context, SX1280_REG_RANGE_RESULTS_CFG, &reg_value, 1 );
+    if( status != SX1280_STATUS_OK )
+    {
+        return status;
+    }
+
+    // Freeze the results while the 3 bytes are read
+    status = sx1280_read_register( context, SX1280_REG_RANGE_RESULTS_FREEZE, &reg_value, 1 );
+    if( status != SX1280_STATUS_OK )
+    {
+        return status;
+    }
+    reg_value |= ( 1 << 1 );
+    status = sx1280_write_register( context, SX1280_REG_RANGE_RESULTS_FREEZE, &reg_value, 1 );
+    if( status == SX1280_STATUS_OK )
+    {
+        status = sx1280_read_register( context, SX1280_REG_RANGE_RESULTS, buffer, sizeof( buffer ) );
+    }
+    reg_value &= ~( 1 << 1 );
+    if( sx1280_write_register( context, SX1280_REG_RANGE_RESULTS_FREEZE, &reg_value, 1 ) != SX1280_STATUS_OK )
+    {
+        status = SX1280_STATUS_ERROR;
+    }
+
+    if( status == SX1280_STATUS_OK )
+    {
+        uint32_t raw = ( ( uint32_t ) buffer[0] << 16 ) | ( ( uint32_t ) buffer[1] << 8 ) | buffer[2];
+
+        // Sign extension of the 24-bit two's complement value
+        if( ( raw & 0x00800000 ) != 0 )
+        {
+            raw |= 0xFF000000;
+        }
+        *result = ( int32_t ) raw;
+    }
+
+    return status;
+}
+
+sx1280_status_t sx1280_set_ble_access_address( const void* context, const uint32_t access_address )
+{
+    uint8_t addr[] = {
+        ( uint8_t )( access_address >> 24 ),
+        ( uint8_t )( access_address >> 16 ),
+        ( uint8_t )( access_address >> 8 ),
+        ( uint8_t ) access_address,
+    };
+
+    return sx1280_write_register( context, SX1280_REG_BLE_ACCESS_ADDRESS, addr, sizeof( addr ) );
+}
+
+sx1280_status_t sx1280_set_ble_crc_init( const void* context, const uint32_t crc_init )
+{
+    uint8_t crc[] = {
+        ( uint8_t )( crc_init >> 16 ),
+        ( uint8_t )( crc_init >> 8 ),
+        ( uint8_t ) crc_init,
+    };
+
+    return sx1280_write_register( context, SX1280_REG_BLE_CRC_INIT, crc, sizeof( crc ) );
+}
+
+sx1280_status_t sx1280_set_ble_whitening_seed( const void* context, const uint8_t seed )
+{
+    // Write only, so that it can be queued in a command batch
+    uint8_t reg_value = seed & 0x7F;
+
+    return sx1280_write_register( context, SX1280_REG_BLE_WHITENING_SEED, &reg_value, 1 );
+}
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static sx1280_status_t sx1280_write_cmd( const void* context, const uint8_t* command, const uint16_t command_length,
+                                         const uint8_t* data, const uint16_t data_length )
+{
+    const uint16_t length = command_length + data_length;
+
+    if( ( sx1280_batch.is_open == false ) || ( command[0] == SX1280_SET_SLEEP ) ||
+        ( length >= SX1280_BATCH_BUFFER_SIZE ) )
+    {
+        if( sx1280_batch_flush( context ) != SX1280_STATUS_OK )
+        {
+            return SX1280_STATUS_ERROR;
+        }
+        return ( sx1280_status_t ) sx1280_hal_write( context, command, command_length, data, data_length );
+    }
+
+    if( ( sx1280_batch.length + 1 + length ) > SX1280_BATCH_BUFFER_SIZE )
+    {
+        if( sx1280_batch_flush( context ) != SX1280_STATUS_OK )
+        {
+            return SX1280_STATUS_ERROR;
+        }
+    }
+
+    sx1280_batch.buffer[sx1280_batch.length++] = ( uint8_t ) length;
+    memcpy( &sx1280_batch.buffer[sx1280_batch.length], command, command_length );
+    sx1280_batch.length += command_length;
+    if( data_length > 0 )
+    {
+        memcpy( &sx1280_batch.buffer[sx1280_batch.length], data, data_length );
+        sx1280_batch.length += data_length;
+    }
+
+    return SX1280_STATUS_OK;
+}
+
+static sx1280_status_t sx1280_read_cmd( const void* context, const uint8_t* command, const uint16_t command_length,
+                                        uint8_t* data, const uint16_t data_length )
+{
+    if( sx1280_batch_flush( context ) != SX1280_STATUS_OK )
+    {
+        return SX1280_STATUS_ERROR;
+    }
+
+    return ( sx1280_status_t ) sx1280_hal_read( context, command, command_length, data, data_length );
+}
+
+static sx1280_status_t sx1280_batch_flush( const void* context )
+{
+    sx1280_status_t status = SX1280_STATUS_OK;
+
+    if( sx1280_batch.length > 0 )
+    {
+        status = ( sx1280_status_t ) sx1280_hal_write_batch( context, sx1280_batch.buffer, sx1280_batch.length );
+        sx1280_batch.length = 0;
+    }
+
+    return status;
+}
+
+static void sx1280_update_operating_mode_on_irq( const void* context, const sx1280_operating_mode_t op_mode,
+                                                 const sx1280_irq_mask_t irq_status )
+{
+    if( ( ( irq_status & SX1280_IRQ_TX_DONE ) == SX1280_IRQ_TX_DONE ) ||
+        ( ( irq_status & SX1280_IRQ_CAD_DONE ) == SX1280_IRQ_CAD_DONE ) ||
+        ( ( irq_status & SX1280_IRQ_TIMEOUT ) == SX1280_IRQ_TIMEOUT ) )
+    {
+        sx1280_hal_set_operating_mode( context, SX1280_HAL_OP_MODE_STDBY_RC );
+    }
+
+    if( ( ( irq_status & SX1280_IRQ_HEADER_ERROR ) == SX1280_IRQ_HEADER_ERROR ) ||
+        ( ( irq_status & SX1280_IRQ_SYNC_WORD_ERROR ) == SX1280_IRQ_SYNC_WORD_ERROR ) ||
+        ( ( irq_status & SX1280_IRQ_RX_DONE ) == SX1280_IRQ_RX_DONE ) ||
+        ( ( irq_status & SX1280_IRQ_CRC_ERROR ) == SX1280_IRQ_CRC_ERROR ) )
+    {
+        if( op_mode != SX1280_OP_MODE_RX_C )
+        {
+            sx1280_hal_set_operating_mode( context, SX1280_HAL_OP_MODE_STDBY_RC );
+        }
+    }
+}
+
 static inline uint32_t sx1280_get_pbl_len_in_bits_gfsk_flrc( sx1280_gfsk_pbl_len_t pbl_len )
 {
     return ( pbl_len >> 2 ) + 4;
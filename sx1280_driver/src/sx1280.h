@@ -885,6 +885,17 @@ typedef enum sx1280_range_role_e
     SX1280_RANGE_ROLE_MST = 1,
 } sx1280_range_role_t;
 
+/*!
+ * Ranging result types, selected in the results register mux
+ */
+typedef enum sx1280_range_result_types_e
+{
+    SX1280_RANGE_RESULT_RAW      = 0x00,
+    SX1280_RANGE_RESULT_AVERAGED = 0x01,
+    SX1280_RANGE_RESULT_DEBIASED = 0x02,
+    SX1280_RANGE_RESULT_FILTERED = 0x03,
+} sx1280_range_result_types_t;
+
 /*!
  * Selector values to configure LNA regime
  */
@@ -920,6 +931,28 @@ sx1280_status_t sx1280_set_standby( const void* context, const sx1280_standby_cf
 
 sx1280_status_t sx1280_wakeup( const void* context );
 
+/*!
+ * Start queuing the commands sent to the radio
+ *
+ * \remark Until \ref sx1280_batch_end is called, write-only commands are queued and sent back to back by
+ *         \ref sx1280_hal_write_batch, with a single wake-up. Any read flushes the queue first, so commands keep
+ *         their order. An error on a queued command is reported by the call which flushes it.
+ *
+ * \param [in] context Radio implementation parameters
+ *
+ * \retval status Operation status
+ */
+sx1280_status_t sx1280_batch_begin( const void* context );
+
+/*!
+ * Send the queued commands and stop queuing
+ *
+ * \param [in] context Radio implementation parameters
+ *
+ * \retval status Operation status
+ */
+sx1280_status_t sx1280_batch_end( const void* context );
+
 sx1280_status_t sx1280_set_fs( const void* context );
 
 sx1280_status_t sx1280_set_tx( const void* context, sx1280_tick_size_t period_base, const uint16_t timeout_in_ticks );
@@ -1039,6 +1072,22 @@ sx1280_status_t sx1280_reset( const void* context );
 
 sx1280_status_t sx1280_process_irq( const void* context, sx1280_irq_mask_t* irq_status );
 
+/*!
+ * \brief Reads and clears the irq status and reads the rx buffer status in a single wake-up
+ *
+ * \remark GetIrqStatus, ClearIrqStatus and GetRxBufferStatus are sent back to back by
+ *         \ref sx1280_hal_transfer_batch. All the irq flags are cleared, as the clear mask cannot depend on the
+ *         status read in the same sequence.
+ *
+ * \param [in] context Chip implementation context.
+ * \param [out] irq_status Irq status read before the clear
+ * \param [out] rx_buffer_status Length and offset of the last received packet
+ *
+ * \returns Operation status
+ */
+sx1280_status_t sx1280_process_and_clear_irq( const void* context, sx1280_irq_mask_t* irq_status,
+                                              sx1280_rx_buffer_status_t* rx_buffer_status );
+
 sx1280_status_t sx1280_set_long_pbl( const void* context, const bool state );
 
 sx1280_status_t sx1280_set_reg_mode( const void* context, const sx1280_reg_mod_t mode );
@@ -1099,6 +1148,92 @@ sx1280_status_t sx1280_get_lora_rx_packet_cr( const void* context, sx1280_lora_r
 
 sx1280_status_t sx1280_get_lora_rx_packet_crc_config( const void* context, bool* is_lora_crc_enabled );
 
+/*!
+ * Set the address a ranging slave answers to
+ *
+ * \param [in] context Chip implementation context
+ * \param [in] address Device address, compared on the ID check length
+ *
+ * \returns Operation status
+ */
+sx1280_status_t sx1280_set_ranging_dev_addr( const void* context, const uint32_t address );
+
+/*!
+ * Set the address a ranging master sends its requests to
+ *
+ * \param [in] context Chip implementation context
+ * \param [in] address Slave address
+ *
+ * \returns Operation status
+ */
+sx1280_status_t sx1280_set_ranging_req_addr( const void* context, const uint32_t address );
+
+/*!
+ * Set the number of address bytes checked by a ranging slave
+ *
+ * \param [in] context Chip implementation context
+ * \param [in] length  Number of bytes, from 1 to 4
+ *
+ * \returns Operation status
+ */
+sx1280_status_t sx1280_set_ranging_id_check_length( const void* context, const uint8_t length );
+
+/*!
+ * Set the ranging Rx/Tx delay calibration
+ *
+ * \param [in] context Chip implementation context
+ * \param [in] calib   Calibration value matching the spreading factor and the bandwidth (24 bits)
+ *
+ * \returns Operation status
+ */
+sx1280_status_t sx1280_set_ranging_calib( const void* context, const uint32_t calib );
+
+/*!
+ * Get the result of the last ranging exchange
+ *
+ * \remark The results register is frozen during the read
+ *
+ * \param [in]  context Chip implementation context
+ * \param [in]  type    Result type to read
+ * \param [out] result  Signed 24-bit raw result, to be scaled by the bandwidth
+ *
+ * \returns Operation status
+ */
+sx1280_status_t sx1280_get_ranging_result( const void* context, const sx1280_range_result_types_t type,
+                                           int32_t* result );
+
+/*!
+ * Set the BLE access address, sent after the preamble
+ *
+ * \param [in] context        Chip implementation context
+ * \param [in] access_address Access address, 0x8E89BED6 on the advertising channels
+ *
+ * \returns Operation status
+ */
+sx1280_status_t sx1280_set_ble_access_address( const void* context, const uint32_t access_address );
+
+/*!
+ * Set the BLE CRC initial value
+ *
+ * \param [in] context  Chip implementation context
+ * \param [in] crc_init 24-bit initial value, 0x555555 on the advertising channels
+ *
+ * \returns Operation status
+ */
+sx1280_status_t sx1280_set_ble_crc_init( const void* context, const uint32_t crc_init );
+
+/*!
+ * Set the BLE whitening initial value
+ *
+ * \remark The BLE whitening starts from the channel index: 0x40 | index
+ *
+ * \param [in] context Chip implementation context
+ * \param [in] seed    7-bit initial value
+ *
+ * \returns Operation status
+ */
+sx1280_status_t sx1280_set_ble_whitening_seed( const void* context, const uint8_t seed );
+
 #ifdef __cplusplus
 }
 #endif
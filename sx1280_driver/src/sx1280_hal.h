@@ -121,6 +121,41 @@ sx1280_hal_status_t sx1280_hal_write( const void* context, const uint8_t* comman
 sx1280_hal_status_t sx1280_hal_read( const void* context, const uint8_t* command, const uint16_t command_length,
                                      uint8_t* data, const uint16_t data_length );
 
+/*!
+ * Radio data transfer - write a sequence of commands
+ *
+ * \remark Must be implemented by the upper layer
+ * \remark Each command has its own NSS low period and is followed by a BUSY
+ * wait, as in \ref sx1280_hal_write
+ *
+ * \param [in] context          Radio implementation parameters
+ * \param [in] batch            Commands to be transmitted, each one prefixed
+ *                              by its length in bytes
+ * \param [in] batch_length     Total size of the sequence
+ *
+ * \retval status     Operation status
+ */
+sx1280_hal_status_t sx1280_hal_write_batch( const void* context, const uint8_t* batch, const uint16_t batch_length );
+
+/*!
+ * Radio data transfer - full duplex sequence of commands
+ *
+ * \remark Must be implemented by the upper layer
+ * \remark Same framing as \ref sx1280_hal_write_batch, without BUSY wait after
+ * the last command
+ *
+ * \param [in] context          Radio implementation parameters
+ * \param [in] batch            Commands to be transmitted, each one prefixed
+ *                              by its length in bytes
+ * \param [out] response        Bytes received, at the index of the byte sent
+ *                              at the same time
+ * \param [in] batch_length     Total size of the sequence
+ *
+ * \retval status     Operation status
+ */
+sx1280_hal_status_t sx1280_hal_transfer_batch( const void* context, const uint8_t* batch, uint8_t* response,
+                                               const uint16_t batch_length );
+
 /*!
  * Reset the radio
  *
@@ -199,6 +199,16 @@
  */
 #define SX1280_REG_BLE_ACCESS_ADDRESS 0x09CF
 
+/*!
+ * BLE CRC initial value register. (24 bits)
+ */
+#define SX1280_REG_BLE_CRC_INIT 0x09C7
+
+/*!
+ * BLE whitening initial value register. (7 bits)
+ */
+#define SX1280_REG_BLE_WHITENING_SEED 0x09C5
+
 /*!
  * Register address and mask for LNA regime selection
  */
@@ -76,12 +76,32 @@ extern "C" {
 // start flash address to store lorawan context
 #define BSP_LORAWAN_CONTEXT_ADDR_OFFSET 0
 
+// start flash address to store the lorawan session, restored at boot instead of joining again
+#define BSP_LORAWAN_SESSION_ADDR_OFFSET 256
+
+// Each lr1mac stack has its own nvm slot, the offsets above are the ones of the first stack
+#define BSP_LORAWAN_STACK_NVM_SIZE 512
+#define BSP_LORAWAN_CONTEXT_ADDR( stack_id ) \
+    ( BSP_LORAWAN_CONTEXT_ADDR_OFFSET + ( ( uint32_t )( stack_id ) * BSP_LORAWAN_STACK_NVM_SIZE ) )
+#define BSP_LORAWAN_SESSION_ADDR( stack_id ) \
+    ( BSP_LORAWAN_SESSION_ADDR_OFFSET + ( ( uint32_t )( stack_id ) * BSP_LORAWAN_STACK_NVM_SIZE ) )
+
+// Store the active session and resume it after a reset: OTAA without a join, ABP with its counters (set 0 to disable)
+#ifndef BSP_LR1MAC_SESSION_RESTORE
+#define BSP_LR1MAC_SESSION_RESTORE 1
+#endif
+
 // The Lorawan context is stored in memory with a period equal to FLASH_UPDATE_PERIOD packets transmitted
 #define BSP_USER_NUMBER_OF_RETRANSMISSION 1
 
 // Only used in case of user defined darate distribution strategy refereed to doc that explain this value
 #define BSP_USER_DR_DISTRIBUTION_PARAMETERS 0x10000000
 
+// Check the downlink MIC under radio interrupt and start RX2 at once when RX1 brings no valid frame (set 0 to disable)
+#ifndef BSP_LR1MAC_EARLY_DOWNLINK_CHECK
+#define BSP_LR1MAC_EARLY_DOWNLINK_CHECK 1
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC TYPES ------------------------------------------------------------
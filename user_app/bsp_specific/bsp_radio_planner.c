@@ -50,21 +50,58 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+/*!
+ * Number of radio planners sharing the software interrupt, one per radio
+ */
+#if defined( MODEM_DUAL_RADIO )
+#define RP_BSP_NB_PLANNERS 2
+#else
+#define RP_BSP_NB_PLANNERS 1
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
  */
 
+/*!
+ * Timer and deferred interrupt of one radio planner
+ */
+typedef struct rp_bsp_instance_s
+{
+    void* rp;  // planner owning the instance, NULL while free
+    void ( *irq_callback )( void* context );
+    bsp_soft_tmr_t timer;
+    volatile bool  irq_pending;
+} rp_bsp_instance_t;
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
+static rp_bsp_instance_t rp_bsp_instances[RP_BSP_NB_PLANNERS];
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 
+/*!
+ * \brief Gets the instance of a planner, the first call of a planner takes a free one
+ *
+ * \param [in] rp Radio planner
+ * \retval Instance of the planner
+ */
+static rp_bsp_instance_t* rp_bsp_instance_get( void* rp );
+
+/*!
+ * \brief Software interrupt, runs the bottom halves requested by the planners
+ *
+ * \param [in] context Unused
+ */
+static void rp_bsp_deferred_irq( void* context );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -80,14 +117,17 @@ void rp_bsp_critical_section_end( void )
     bsp_mcu_enable_periph_irq( );
 }
 
-void rp_bsp_timer_stop( void )
+void rp_bsp_timer_stop( void* rp )
 {
-    bsp_tmr_stop( );
+    bsp_soft_tmr_stop( &rp_bsp_instance_get( rp )->timer );
 }
 
 void rp_bsp_timer_start( void* rp, uint32_t alarm_in_ms, void ( *callback )( void* context ) )
 {
-    bsp_tmr_start( alarm_in_ms, &( bsp_tmr_irq_t ){ .context = rp, .callback = callback } );
+    rp_bsp_instance_t* instance = rp_bsp_instance_get( rp );
+
+    instance->timer.callback = callback;
+    bsp_soft_tmr_start( &instance->timer, alarm_in_ms );
 }
 
 uint32_t rp_bsp_timestamp_get( void )
@@ -95,14 +135,64 @@ uint32_t rp_bsp_timestamp_get( void )
     return bsp_rtc_get_time_ms( );
 }
 
+uint32_t rp_bsp_timestamp_us_get( void )
+{
+    return ( uint32_t ) bsp_rtc_get_time_us( );
+}
+
 uint8_t rp_bsp_irq_get_pending( void )
 {
     return bsp_gpio_is_pending_irq( ) ? 1 : 0;
 }
 
+void rp_bsp_deferred_irq_trigger( void* rp, void ( *callback )( void* context ) )
+{
+    rp_bsp_instance_t* instance = rp_bsp_instance_get( rp );
+
+    // the software interrupt holds a single callback, the pending flags keep the requests of every planner
+    instance->irq_callback = callback;
+    instance->irq_pending  = true;
+    bsp_mcu_soft_irq_set( rp_bsp_deferred_irq, NULL );
+}
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
+static rp_bsp_instance_t* rp_bsp_instance_get( void* rp )
+{
+    for( uint8_t i = 0; i < RP_BSP_NB_PLANNERS; i++ )
+    {
+        if( rp_bsp_instances[i].rp == rp )
+        {
+            return &rp_bsp_instances[i];
+        }
+    }
+    for( uint8_t i = 0; i < RP_BSP_NB_PLANNERS; i++ )
+    {
+        if( rp_bsp_instances[i].rp == NULL )
+        {
+            rp_bsp_instances[i].rp            = rp;
+            rp_bsp_instances[i].timer.context = rp;
+            return &rp_bsp_instances[i];
+        }
+    }
+    // more planners than radios in the build
+    bsp_mcu_panic( );
+    return &rp_bsp_instances[0];
+}
+
+static void rp_bsp_deferred_irq( void* context )
+{
+    for( uint8_t i = 0; i < RP_BSP_NB_PLANNERS; i++ )
+    {
+        if( rp_bsp_instances[i].irq_pending == true )
+        {
+            rp_bsp_instances[i].irq_pending = false;
+            rp_bsp_instances[i].irq_callback( rp_bsp_instances[i].rp );
+        }
+    }
+}
+
 /* --- EOF ------------------------------------------------------------------ */
@@ -33,6 +33,17 @@
 #include "sx126x_hal.h"
 #include "sx126x.h"
 
+// the SX126x takes the sub-GHz pins when it runs next to the SX1280
+#if defined( MODEM_DUAL_RADIO )
+#define SX126X_NSS      RADIO_SUBGHZ_NSS
+#define SX126X_NRST     RADIO_SUBGHZ_NRST
+#define SX126X_BUSY_PIN RADIO_SUBGHZ_BUSY_PIN
+#else
+#define SX126X_NSS      RADIO_NSS
+#define SX126X_NRST     RADIO_NRST
+#define SX126X_BUSY_PIN RADIO_BUSY_PIN
+#endif
+
 typedef enum
 {
     RADIO_SLEEP,
@@ -43,7 +54,7 @@ static radio_mode_t radio_mode = RADIO_AWAKE;
 
 void usr_radio_waitOnBusy( void )
 {
-    while( bsp_gpio_get_value( RADIO_BUSY_PIN ) == 1 )
+    while( bsp_gpio_get_value( SX126X_BUSY_PIN ) == 1 )
     {
     };
 }
@@ -58,9 +69,9 @@ void sx126x_bsp_check_device_ready( void )
     else
     {
         // Busy is HIGH in sleep mode, wake-up the device
-        bsp_gpio_set_value( RADIO_NSS, 0 );
+        bsp_gpio_set_value( SX126X_NSS, 0 );
         usr_radio_waitOnBusy( );
-        bsp_gpio_set_value( RADIO_NSS, 1 );
+        bsp_gpio_set_value( SX126X_NSS, 1 );
         radio_mode = RADIO_AWAKE;
     }
 }
@@ -71,17 +82,11 @@ sx126x_hal_status_t sx126x_hal_write( const void* context, const uint8_t* comman
     sx126x_bsp_check_device_ready( );
 
     // Put NSS low to start spi transaction
-    bsp_gpio_set_value( RADIO_NSS, 0 );
-    for( uint16_t i = 0; i < command_length; i++ )
-    {
-        bsp_spi_in_out( BSP_RADIO_SPI_ID, command[i] );
-    }
-    for( uint16_t i = 0; i < data_length; i++ )
-    {
-        bsp_spi_in_out( BSP_RADIO_SPI_ID, data[i] );
-    }
+    bsp_gpio_set_value( SX126X_NSS, 0 );
+    bsp_spi_transfer( BSP_RADIO_SPI_ID, command, NULL, command_length );
+    bsp_spi_transfer( BSP_RADIO_SPI_ID, data, NULL, data_length );
     // Put NSS high as the spi transaction is finished
-    bsp_gpio_set_value( RADIO_NSS, 1 );
+    bsp_gpio_set_value( SX126X_NSS, 1 );
 
     // 0x84 - SX1280_SET_SLEEP opcode. In sleep mode the radio dio is struck to 1 => do not test it
     if( command[0] != 0x84 )
@@ -102,17 +107,11 @@ sx126x_hal_status_t sx126x_hal_read( const void* context, const uint8_t* command
     sx126x_bsp_check_device_ready( );
 
     // Put NSS low to start spi transaction
-    bsp_gpio_set_value( RADIO_NSS, 0 );
-    for( uint16_t i = 0; i < command_length; i++ )
-    {
-        bsp_spi_in_out( BSP_RADIO_SPI_ID, command[i] );
-    }
-    for( uint16_t i = 0; i < data_length; i++ )
-    {
-        data[i] = bsp_spi_in_out( BSP_RADIO_SPI_ID, 0 );
-    }
+    bsp_gpio_set_value( SX126X_NSS, 0 );
+    bsp_spi_transfer( BSP_RADIO_SPI_ID, command, NULL, command_length );
+    bsp_spi_transfer( BSP_RADIO_SPI_ID, NULL, data, data_length );
     // Put NSS high as the spi transaction is finished
-    bsp_gpio_set_value( RADIO_NSS, 1 );
+    bsp_gpio_set_value( SX126X_NSS, 1 );
 
     return SX126X_HAL_STATUS_OK;
 }
@@ -126,10 +125,18 @@ sx126x_hal_status_t sx126x_hal_read( const void* context, const uint8_t* command
  */
 void sx126x_hal_reset( const void* context )
 {
-    bsp_gpio_set_value( RADIO_NRST, 0 );
+    bsp_gpio_set_value( SX126X_NRST, 0 );
+#if( BSP_FAST_BOOT == BSP_FEATURE_ON )
+    // short pulse, then the radio is ready as soon as its startup releases BUSY
+    bsp_mcu_wait_us( 200 );
+    bsp_gpio_set_value( SX126X_NRST, 1 );
+    bsp_mcu_wait_us( 100 );
+    usr_radio_waitOnBusy( );
+#else
     bsp_mcu_wait_us( 5000 );
-    bsp_gpio_set_value( RADIO_NRST, 1 );
+    bsp_gpio_set_value( SX126X_NRST, 1 );
     bsp_mcu_wait_us( 5000 );
+#endif
 
     sx126x_set_dio2_as_rf_sw_ctrl( NULL, true );
 }
\ No newline at end of file
@@ -0,0 +1,240 @@
+/*!
+ * \file      bsp_soft_tmr.c
+ *
+ * \brief     Implements the software timers sharing the BSP hardware timer
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stddef.h>   // NULL
+
+#include "smtc_bsp.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE MACROS-----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+// armed timers sorted by deadline, the first one is programmed on the hardware timer
+static bsp_soft_tmr_t* bsp_soft_tmr_head = NULL;
+
+// timer whose deadline is programmed on the hardware timer, NULL when stopped
+static bsp_soft_tmr_t* bsp_soft_tmr_programmed = NULL;
+
+// the callbacks are running, the hardware timer is programmed once they have all returned
+static bool bsp_soft_tmr_dispatching = false;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * \brief Removes a timer from the armed list
+ *
+ * \remark To be called inside a critical section
+ *
+ * \param [in] tmr Software timer
+ */
+static void bsp_soft_tmr_unlink( bsp_soft_tmr_t* tmr );
+
+/*!
+ * \brief Programs the hardware timer on the first deadline of the armed list
+ *
+ * \remark To be called inside a critical section
+ *
+ * \param [in] now Current time [ms]
+ */
+static void bsp_soft_tmr_rearm( uint32_t now );
+
+/*!
+ * \brief Hardware timer interrupt, runs the callbacks of the timers which are due
+ *
+ * \param [in] context Unused
+ */
+static void bsp_soft_tmr_irq( void* context );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void bsp_soft_tmr_start( bsp_soft_tmr_t* tmr, const uint32_t milliseconds )
+{
+    CRITICAL_SECTION_BEGIN( );
+    uint32_t         now  = bsp_rtc_get_time_ms( );
+    bsp_soft_tmr_t** link = &bsp_soft_tmr_head;
+
+    bsp_soft_tmr_unlink( tmr );
+    tmr->deadline_ms = now + milliseconds;
+    tmr->is_armed    = true;
+
+    // after the timers of the same deadline, the callbacks keep the order of the starts
+    while( ( *link != NULL ) && ( ( int32_t ) ( ( *link )->deadline_ms - now ) <= ( int32_t ) milliseconds ) )
+    {
+        link = &( *link )->next;
+    }
+    tmr->next = *link;
+    *link     = tmr;
+
+    bsp_soft_tmr_rearm( now );
+    CRITICAL_SECTION_END( );
+}
+
+void bsp_soft_tmr_stop( bsp_soft_tmr_t* tmr )
+{
+    CRITICAL_SECTION_BEGIN( );
+    if( tmr->is_armed == true )
+    {
+        bsp_soft_tmr_unlink( tmr );
+        bsp_soft_tmr_rearm( bsp_rtc_get_time_ms( ) );
+    }
+    CRITICAL_SECTION_END( );
+}
+
+bool bsp_soft_tmr_is_armed( const bsp_soft_tmr_t* tmr )
+{
+    return tmr->is_armed;
+}
+
+uint32_t bsp_soft_tmr_get_next_ms( void )
+{
+    uint32_t delay_ms = UINT32_MAX;
+
+    CRITICAL_SECTION_BEGIN( );
+    if( bsp_soft_tmr_head != NULL )
+    {
+        int32_t delay = ( int32_t ) ( bsp_soft_tmr_head->deadline_ms - bsp_rtc_get_time_ms( ) );
+        delay_ms      = ( delay > 0 ) ? ( uint32_t ) delay : 0;
+    }
+    CRITICAL_SECTION_END( );
+    return delay_ms;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void bsp_soft_tmr_unlink( bsp_soft_tmr_t* tmr )
+{
+    for( bsp_soft_tmr_t** link = &bsp_soft_tmr_head; *link != NULL; link = &( *link )->next )
+    {
+        if( *link == tmr )
+        {
+            *link = tmr->next;
+            break;
+        }
+    }
+    tmr->next     = NULL;
+    tmr->is_armed = false;
+}
+
+static void bsp_soft_tmr_rearm( uint32_t now )
+{
+    if( bsp_soft_tmr_dispatching == true )
+    {
+        return;
+    }
+
+    if( bsp_soft_tmr_head == NULL )
+    {
+        if( bsp_soft_tmr_programmed != NULL )
+        {
+            bsp_soft_tmr_programmed = NULL;
+            bsp_tmr_stop( );
+        }
+    }
+    else
+    {
+        int32_t delay = ( int32_t ) ( bsp_soft_tmr_head->deadline_ms - now );
+
+        bsp_soft_tmr_programmed = bsp_soft_tmr_head;
+        bsp_tmr_start( ( delay > 0 ) ? ( uint32_t ) delay : 0,
+                       &( bsp_tmr_irq_t ){ .context = NULL, .callback = bsp_soft_tmr_irq } );
+    }
+}
+
+static void bsp_soft_tmr_irq( void* context )
+{
+    bsp_soft_tmr_t* programmed = bsp_soft_tmr_programmed;
+    bsp_soft_tmr_t* due;
+    uint32_t        now = bsp_rtc_get_time_ms( );
+
+    // the hardware timer has expired, it is programmed again once the callbacks have restarted their timers
+    bsp_soft_tmr_programmed  = NULL;
+    bsp_soft_tmr_dispatching = true;
+    do
+    {
+        CRITICAL_SECTION_BEGIN( );
+        due = bsp_soft_tmr_head;
+        // the programmed timer is due even if the hardware timer and the RTC disagree by a tick
+        if( ( due != NULL ) && ( ( due == programmed ) || ( ( int32_t ) ( due->deadline_ms - now ) <= 0 ) ) )
+        {
+            bsp_soft_tmr_unlink( due );
+            programmed = ( due == programmed ) ? NULL : programmed;
+        }
+        else
+        {
+            due = NULL;
+        }
+        CRITICAL_SECTION_END( );
+
+        if( due != NULL )
+        {
+            due->callback( due->context );
+        }
+    } while( due != NULL );
+
+    CRITICAL_SECTION_BEGIN( );
+    bsp_soft_tmr_dispatching = false;
+    bsp_soft_tmr_rearm( bsp_rtc_get_time_ms( ) );
+    CRITICAL_SECTION_END( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
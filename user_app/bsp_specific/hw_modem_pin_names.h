@@ -58,6 +58,12 @@ extern "C" {
 
 #define RADIO_ANTENNA_SWITCH    PB_0  // For board with 2 antennas
 
+// Sub-GHz SX126x shield on the same SPI when MODEM_DUAL_RADIO is on
+#define RADIO_SUBGHZ_NSS        PB_6
+#define RADIO_SUBGHZ_NRST       PA_4
+#define RADIO_SUBGHZ_DIOX       PB_8
+#define RADIO_SUBGHZ_BUSY_PIN   PB_9
+
 //Hw modem specific pinout
 #define HW_MODEM_COMMAND_PIN    PB_5
 #define HW_MODEM_EVENT_PIN      PB_10
@@ -65,6 +71,15 @@ extern "C" {
 #define HW_MODEM_TX_LINE        PA_9
 #define HW_MODEM_RX_LINE        PA_10
 
+// Host lines when BSP_USER_UART_LPUART is on, they take the place of DEBUG_PIN_4 and DEBUG_PIN_5
+#define HW_MODEM_LPUART_TX_LINE PC_10
+#define HW_MODEM_LPUART_RX_LINE PC_11
+
+// Host lines when BSP_USE_HOST_SPI is on, the transfers are framed by HW_MODEM_COMMAND_PIN
+#define HW_MODEM_SPI_MOSI       PB_15
+#define HW_MODEM_SPI_MISO       PB_14
+#define HW_MODEM_SPI_SCLK       PB_13
+
 //Optional available debug pins
 #define DEBUG_PIN_1             PC_8
 #define DEBUG_PIN_2             PC_6
@@ -46,20 +46,38 @@
 #include <string.h>
 #include <stdio.h>
 #endif
+
+#if( BSP_MCU_CLOCK_SCALING == BSP_FEATURE_ON ) && ( BSP_LOW_POWER_MODE == BSP_FEATURE_OFF )
+#error "BSP_MCU_CLOCK_SCALING needs BSP_LOW_POWER_MODE, the clock is lowered when entering stop mode"
+#endif
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE MACROS-----------------------------------------------------------
  */
-// STM32L073 temperature calibration information
+// STM32L073 temperature and internal reference calibration information
 #define TEMP130_CAL_ADDR ( ( uint16_t* ) ( ( uint32_t ) 0x1FF8007E ) )
 #define TEMP30_CAL_ADDR ( ( uint16_t* ) ( ( uint32_t ) 0x1FF8007A ) )
+#define VREFINT_CAL_ADDR ( ( uint16_t* ) ( ( uint32_t ) 0x1FF80078 ) )
 #define VDD_CALIB ( ( uint16_t )( 3000 ) )
-#define VDD_APPLI ( ( uint16_t )( 3000 ) )
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+// bsp_mcu_wait_us counts on TIM21 at about 1 MHz, in chunks shorter than the 16 bits counter wrap
+#define BSP_WAIT_TIM_FREQ_HZ 1000000
+#define BSP_WAIT_TIM_MAX_CHUNK_TICKS 50000
+
+// Shorter waits are polled, longer ones sleep until the TIM21 compare interrupt
+#define BSP_WAIT_SLEEP_MIN_TICKS 100
+
+// Age above which the MCU temperature and voltage are measured again
+#define BSP_MCU_SENSORS_VALIDITY_MS 60000
+
+// Free stack fill pattern, the frames of bsp_mcu_init and its callers are kept clear of the painting
+#define BSP_STACK_PAINT_PATTERN 0xC5C5C5C5
+#define BSP_STACK_PAINT_MARGIN 64
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -78,8 +96,83 @@ typedef enum low_power_mode_e
  * --- PRIVATE VARIABLES -------------------------------------------------------
  */
 
-static volatile bool             bsp_exit_wait       = false;
-static volatile low_power_mode_t bsp_lp_current_mode = LOW_POWER_ENABLE;
+static volatile bool             bsp_exit_wait           = false;
+static volatile low_power_mode_t bsp_lp_current_mode     = LOW_POWER_ENABLE;
+static volatile uint8_t          bsp_wakeup_sources      = 0;
+static bool                      is_reset_after_brownout = false;
+
+#if( BSP_LOW_POWER_MODE == BSP_FEATURE_ON )
+// Pin states in STOP mode
+static const bsp_gpio_sleep_pin_t bsp_gpio_sleep_table[] = { BSP_GPIO_SLEEP_TABLE };
+#endif
+
+/*!
+ * Software interrupt (PendSV) callback, locked by the peripheral IRQ sections
+ */
+static void ( *bsp_soft_irq_callback )( void* context ) = NULL;
+static void*         bsp_soft_irq_context               = NULL;
+static volatile bool bsp_soft_irq_locked                = false;
+static volatile bool bsp_soft_irq_postponed             = false;
+
+/*!
+ * Time spent in STOP mode since the start
+ */
+static uint32_t bsp_stop_time_ms = 0;
+
+/*!
+ * Exits from STOP mode since the start, the watchdog reloads in STOP mode excluded
+ */
+static uint32_t bsp_wakeup_nb = 0;
+
+/*!
+ * MCU temperature and voltage, cached from the last ADC scan
+ */
+static uint16_t          bsp_sensors_raw[BSP_ADC_SCAN_LENGTH];
+static bsp_adc_irq_t     bsp_sensors_irq         = { .context = NULL, .callback = NULL };
+static bool              bsp_sensors_adc_ready   = false;
+static volatile bool     bsp_sensors_measuring   = false;
+static volatile bool     bsp_sensors_valid       = false;
+static volatile uint32_t bsp_sensors_date_ms     = 0;
+static int32_t           bsp_sensors_temperature = 0;
+static uint8_t           bsp_sensors_voltage     = 0;
+static uint16_t          bsp_sensors_vdda_mv     = 0;
+
+/*!
+ * Linker script symbols: the stack grows down from _estack to the heap reservation starting at _end
+ */
+extern uint32_t _end;
+extern uint32_t _estack;
+extern uint32_t _Min_Heap_Size;
+
+#if( BSP_MCU_CLOCK_SCALING == BSP_FEATURE_ON )
+/*!
+ * Number of ongoing \ref bsp_mcu_clock_boost_request sections
+ */
+static volatile uint8_t bsp_clock_boost_count = 0;
+
+/*!
+ * The system clock is the PLL, it is set back to MSI when entering stop mode with no boost requested
+ */
+static volatile bool bsp_clock_is_high = true;
+#endif
+
+#if( BSP_DBG_TRACE_DEFERRED == BSP_FEATURE_ON )
+/*!
+ * Deferred trace records: sync byte, number of arguments, format offset and timestamp, then the arguments
+ */
+#define BSP_TRACE_RECORD_SYNC 0xA5
+#define BSP_TRACE_RECORD_HEADER_SIZE 10
+#define BSP_TRACE_RECORD_LOST_FMT 0xFFFFFFFF
+
+static uint8_t  bsp_trace_buffer[BSP_DBG_TRACE_DEFERRED_BUFFER_SIZE];
+static uint16_t bsp_trace_write_index = 0;
+static uint16_t bsp_trace_read_index  = 0;
+// bytes waiting in the buffer, including the ones of the ongoing DMA transfer
+static uint16_t bsp_trace_fill = 0;
+// bytes of the ongoing DMA transfer, 0 when the UART is idle
+static uint16_t bsp_trace_dma_length = 0;
+static uint32_t bsp_trace_lost        = 0;
+#endif
 
 /*
  * -----------------------------------------------------------------------------
@@ -89,12 +182,24 @@ static void bsp_system_clock_config( void );
 static void bsp_mcu_start_systick( void );
 static void bsp_mcu_stop_systick( void );
 static void bsp_mcu_gpio_init( void );
+static uint32_t bsp_mcu_get_tim21_clock_hz( void );
+static void bsp_mcu_sensors_scan_done( void* context );
+static void bsp_mcu_sensors_wait( void );
+static uint32_t* bsp_mcu_get_stack_bottom( void );
+static void bsp_mcu_stack_paint( void );
 
 #if( BSP_LOW_POWER_MODE == BSP_FEATURE_ON )
 static void bsp_mcu_deinit( void );
 static void bsp_mcu_reinit( void );
 static void bsp_system_clock_re_config_after_stop( void );
-static void bsp_low_power_handler( void );
+static void bsp_system_clock_set_high( void );
+#if( BSP_MCU_CLOCK_SCALING == BSP_FEATURE_ON )
+static void bsp_system_clock_set_low( void );
+#endif
+static int32_t bsp_low_power_handler( const int32_t milliseconds );
+#if( BSP_WATCHDOG_RELOAD_IN_STOP == BSP_FEATURE_ON )
+static bool bsp_lpm_is_woken_by_wakeup_timer_only( void );
+#endif
 #else
 static bool bsp_mcu_no_low_power_wait( const int32_t milliseconds );
 #endif
@@ -103,6 +208,18 @@ static bool bsp_mcu_no_low_power_wait( const int32_t milliseconds );
 static void vprint( const char* fmt, va_list argp );
 #endif
 
+#if( BSP_DBG_TRACE_DEFERRED == BSP_FEATURE_ON )
+/*!
+ * Appends a record to the deferred trace buffer, the caller checks that it fits
+ */
+static void bsp_trace_put_record( uint32_t fmt, uint8_t nb_args, const uint32_t* args );
+
+/*!
+ * End of a deferred trace DMA transfer, chains the next one
+ */
+static void bsp_trace_tx_done( void* context );
+#endif
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -112,15 +229,25 @@ void bsp_mcu_critical_section_begin( uint32_t* mask )
 {
     *mask = __get_PRIMASK( );
     __disable_irq( );
+    // only the outermost section is timed, the nested ones are part of it
+    if( *mask == 0 )
+    {
+        BSP_PERF_CRITICAL_BEGIN( ( uint32_t ) ( uintptr_t ) __builtin_return_address( 0 ) );
+    }
 }
 
 void bsp_mcu_critical_section_end( uint32_t* mask )
 {
+    if( *mask == 0 )
+    {
+        BSP_PERF_CRITICAL_END( );
+    }
     __set_PRIMASK( *mask );
 }
 
 void bsp_mcu_disable_periph_irq( void )
 {
+    bsp_soft_irq_locked = true;
     bsp_gpio_irq_disable( );
     bsp_tmr_irq_disable( );
 }
@@ -129,20 +256,45 @@ void bsp_mcu_enable_periph_irq( void )
 {
     bsp_gpio_irq_enable( );
     bsp_tmr_irq_enable( );
+    bsp_soft_irq_locked = false;
+
+    // A software interrupt raised inside the section has been postponed
+    if( bsp_soft_irq_postponed == true )
+    {
+        bsp_soft_irq_postponed = false;
+        SCB->ICSR              = SCB_ICSR_PENDSVSET_Msk;
+    }
 }
 
 void bsp_mcu_init( void )
 {
+    // The reset flags are kept until cleared: read the cause of this reset only
+    is_reset_after_brownout = ( __HAL_RCC_GET_FLAG( RCC_FLAG_PORRST ) != RESET ) ? true : false;
+    __HAL_RCC_CLEAR_RESET_FLAGS( );
+
     // Initialize MCU HAL library
     HAL_Init( );
     // Initialize clocks
     bsp_system_clock_config( );
+    // Fill the free stack once the clock is up, it takes a few thousand word writes
+    bsp_mcu_stack_paint( );
     // Initialize GPIOs
     bsp_mcu_gpio_init( );
 
     // Initialize low power timer
     bsp_tmr_init( );
 
+    // TIM21 compare interrupt only wakes up the core during bsp_mcu_wait_us
+    HAL_NVIC_SetPriority( TIM21_IRQn, 3, 0 );
+    HAL_NVIC_EnableIRQ( TIM21_IRQn );
+
+    // The ADC powers itself off between the temperature and voltage scans
+    bsp_sensors_irq.callback = bsp_mcu_sensors_scan_done;
+#if( BSP_FAST_BOOT == BSP_FEATURE_OFF )
+    bsp_adc_init( 1 );
+    bsp_sensors_adc_ready = true;
+#endif
+
     // Initialize UART
 #if( BSP_USE_USER_UART == BSP_FEATURE_ON )
     bsp_uart1_init( );
@@ -159,6 +311,10 @@ void bsp_mcu_init( void )
     // Initialize SPI
 
     bsp_spi_init( BSP_RADIO_SPI_ID, RADIO_SPI_MOSI, RADIO_SPI_MISO, RADIO_SPI_SCLK );
+    bsp_spi_set_clock( BSP_RADIO_SPI_ID, BSP_RADIO_SPI_MAX_CLOCK_HZ );
+#if( BSP_USE_HOST_SPI == BSP_FEATURE_ON )
+    bsp_spi_slave_init( BSP_HOST_SPI_ID, HW_MODEM_SPI_MOSI, HW_MODEM_SPI_MISO, HW_MODEM_SPI_SCLK );
+#endif
 
     // Initialize RTC
     bsp_rtc_init( );
@@ -187,6 +343,11 @@ void bsp_mcu_reset( void )
     NVIC_SystemReset( );
 }
 
+bool bsp_mcu_is_reset_after_brownout( void )
+{
+    return is_reset_after_brownout;
+}
+
 void bsp_mcu_panic( void )
 {
     CRITICAL_SECTION_BEGIN( );
@@ -225,6 +386,21 @@ void bsp_mcu_set_sleep_for_ms( const int32_t milliseconds )
         return;
     }
 
+    if( bsp_trace_flush( ) == true )
+    {
+        // stop mode would freeze the trace UART: sleep until the end of the transfer or any other interrupt, the
+        // caller comes back with the remaining time
+        bsp_mcu_wait_for_event( );
+        return;
+    }
+
+    if( bsp_sensors_measuring == true )
+    {
+        // stop mode would halt the ADC scan, it lasts about 1ms
+        bsp_mcu_wait_for_event( );
+        return;
+    }
+
     if( bsp_lp_current_mode == LOW_POWER_DISABLE_ONCE )
     {
         bsp_lp_current_mode = LOW_POWER_ENABLE;
@@ -235,18 +411,10 @@ void bsp_mcu_set_sleep_for_ms( const int32_t milliseconds )
     bsp_watchdog_reload( );
 
 #if( BSP_LOW_POWER_MODE == BSP_FEATURE_ON )
-    while( ( time_counter > ( BSP_WATCHDOG_RELOAD_PERIOD_SECONDS * 1000 ) ) &&
-           ( bsp_lp_current_mode == LOW_POWER_ENABLE ) )
+    // have to wake up on modem cmd
+    while( ( time_counter > 0 ) && ( bsp_lp_current_mode == LOW_POWER_ENABLE ) )
     {
-        time_counter -= BSP_WATCHDOG_RELOAD_PERIOD_SECONDS * 1000;
-        bsp_rtc_wakeup_timer_set_ms( BSP_WATCHDOG_RELOAD_PERIOD_SECONDS * 1000 );
-        bsp_low_power_handler( );
-        bsp_watchdog_reload( );
-    }
-    if( bsp_lp_current_mode == LOW_POWER_ENABLE )
-    {  // have to wake up on modem cmd
-        bsp_rtc_wakeup_timer_set_ms( time_counter );
-        bsp_low_power_handler( );
+        time_counter -= bsp_low_power_handler( time_counter );
         bsp_watchdog_reload( );
     }
 #else
@@ -271,18 +439,79 @@ void bsp_mcu_set_sleep_for_ms( const int32_t milliseconds )
 #endif
 }
 
-void __attribute__( ( optimize( "O0" ) ) ) bsp_mcu_wait_us( const int32_t microseconds )
+void bsp_mcu_wait_us( const int32_t microseconds )
 {
-    const uint32_t nb_nop = microseconds * 1000 / 561;
-    for( uint32_t i = 0; i < nb_nop; i++ )
+    if( microseconds <= 0 )
+    {
+        return;
+    }
+
+    // The prescaler and the tick count are computed from the current clock tree, the wait stays accurate whatever
+    // the system clock, also when it is not a multiple of 1 MHz
+    const uint32_t clock_hz  = bsp_mcu_get_tim21_clock_hz( );
+    const uint32_t prescaler = ( clock_hz > BSP_WAIT_TIM_FREQ_HZ ) ? ( clock_hz / BSP_WAIT_TIM_FREQ_HZ ) : 1;
+    uint32_t       remaining_ticks =
+        ( uint32_t )( ( ( uint64_t ) microseconds * ( clock_hz / prescaler ) ) / BSP_WAIT_TIM_FREQ_HZ );
+
+    __HAL_RCC_TIM21_CLK_ENABLE( );
+    TIM21->PSC = prescaler - 1;
+    TIM21->ARR = 0xFFFF;
+    TIM21->EGR = TIM_EGR_UG;
+    TIM21->SR  = 0;
+    TIM21->CR1 = TIM_CR1_CEN;
+
+    while( remaining_ticks > 0 )
     {
-        __NOP( );
+        const uint16_t chunk = ( remaining_ticks > BSP_WAIT_TIM_MAX_CHUNK_TICKS ) ? BSP_WAIT_TIM_MAX_CHUNK_TICKS
+                                                                                 : ( uint16_t ) remaining_ticks;
+        const uint16_t start = ( uint16_t ) TIM21->CNT;
+
+        if( chunk >= BSP_WAIT_SLEEP_MIN_TICKS )
+        {
+            // Sleep mode: the core clock is stopped, TIM21 keeps counting. WFI also returns on a pending interrupt
+            // when they are masked, so the wait can be called from critical sections
+            TIM21->CCR1 = ( uint16_t )( start + chunk );
+            TIM21->SR   = 0;
+            TIM21->DIER = TIM_DIER_CC1IE;
+            while( ( uint16_t )( TIM21->CNT - start ) < chunk )
+            {
+                __WFI( );
+            }
+            TIM21->DIER = 0;
+            TIM21->SR   = 0;
+            HAL_NVIC_ClearPendingIRQ( TIM21_IRQn );
+        }
+        else
+        {
+            while( ( uint16_t )( TIM21->CNT - start ) < chunk )
+            {
+            }
+        }
+        remaining_ticks -= chunk;
     }
+
+    TIM21->CR1 = 0;
+    __HAL_RCC_TIM21_CLK_DISABLE( );
 }
 
 uint8_t bsp_mcu_get_battery_level( void )
 {
-    return 254;
+    // called when the stack builds an uplink: the last scan is used, a new one is started when it gets old
+    bsp_mcu_sensors_refresh( );
+    if( bsp_sensors_valid == false )
+    {
+        return 255;  // not able to measure
+    }
+    if( bsp_sensors_vdda_mv <= BSP_BATTERY_EMPTY_MV )
+    {
+        return 1;
+    }
+    if( bsp_sensors_vdda_mv >= BSP_BATTERY_FULL_MV )
+    {
+        return 254;
+    }
+    return 1 + ( ( uint32_t )( bsp_sensors_vdda_mv - BSP_BATTERY_EMPTY_MV ) * 253 ) /
+                   ( BSP_BATTERY_FULL_MV - BSP_BATTERY_EMPTY_MV );
 }
 
 void bsp_mcu_disable_low_power_wait( void )
@@ -303,28 +532,182 @@ void bsp_mcu_disable_once_low_power_wait( void )
     bsp_lp_current_mode = LOW_POWER_DISABLE_ONCE;
 }
 
-int32_t bsp_mcu_get_mcu_temperature( void )
+void bsp_mcu_wakeup_request( const uint8_t sources )
 {
-    // Configure ADC1 to read MCU internal temperature
-    bsp_adc_init( 1 );
-    uint32_t measure = bsp_adc_get_value( 1, 1000 );
-    bsp_adc_deinit( 1 );
+    CRITICAL_SECTION_BEGIN( );
+    bsp_wakeup_sources |= sources;
+    CRITICAL_SECTION_END( );
+    bsp_mcu_disable_once_low_power_wait( );
+}
 
-    int32_t temperature = 0;
+uint8_t bsp_mcu_wakeup_sources_get( void )
+{
+    CRITICAL_SECTION_BEGIN( );
+    uint8_t sources    = bsp_wakeup_sources;
+    bsp_wakeup_sources = 0;
+    CRITICAL_SECTION_END( );
+    return sources;
+}
 
-    // Convert ADC value to celsius using STM32 calibration
-    temperature = ( ( measure * VDD_APPLI / VDD_CALIB ) - ( int32_t ) *TEMP30_CAL_ADDR );
-    temperature = temperature * ( int32_t )( 130 - 30 );
-    temperature = temperature / ( int32_t )( *TEMP130_CAL_ADDR - *TEMP30_CAL_ADDR );
-    temperature = temperature + 30;
+void bsp_mcu_wait_for_event( void )
+{
+    // SEVONPEND: any interrupt turning pending is an event, whatever its priority and enable state
+    SCB->SCR |= SCB_SCR_SEVONPEND_Msk;
+    __WFE( );
+}
+
+void bsp_mcu_soft_irq_set( void ( *callback )( void* context ), void* context )
+{
+    bsp_soft_irq_callback = callback;
+    bsp_soft_irq_context  = context;
+    SCB->ICSR             = SCB_ICSR_PENDSVSET_Msk;
+}
+
+void bsp_mcu_clock_boost_request( void )
+{
+#if( BSP_MCU_CLOCK_SCALING == BSP_FEATURE_ON )
+    CRITICAL_SECTION_BEGIN( );
+    bsp_clock_boost_count++;
+    if( bsp_clock_is_high == false )
+    {
+        bsp_system_clock_set_high( );
+    }
+    CRITICAL_SECTION_END( );
+#endif
+}
+
+void bsp_mcu_clock_boost_release( void )
+{
+#if( BSP_MCU_CLOCK_SCALING == BSP_FEATURE_ON )
+    CRITICAL_SECTION_BEGIN( );
+    if( bsp_clock_boost_count > 0 )
+    {
+        bsp_clock_boost_count--;
+    }
+    CRITICAL_SECTION_END( );
+#endif
+}
+
+void bsp_mcu_get_power_stats( bsp_mcu_power_stats_t* stats )
+{
+    CRITICAL_SECTION_BEGIN( );
+    stats->stop_time_ms = bsp_stop_time_ms;
+    stats->run_time_ms  = bsp_rtc_get_time_ms( ) - bsp_stop_time_ms;
+    stats->wakeup_nb    = bsp_wakeup_nb;
+    CRITICAL_SECTION_END( );
+}
+
+void bsp_mcu_get_stack_stats( bsp_mcu_stack_stats_t* stats )
+{
+    uint32_t* bottom = bsp_mcu_get_stack_bottom( );
+    uint32_t* word   = bottom;
+
+    while( ( word < &_estack ) && ( *word == BSP_STACK_PAINT_PATTERN ) )
+    {
+        word++;
+    }
+    stats->size     = ( uint32_t ) &_estack - ( uint32_t ) bottom;
+    stats->used_max = ( uint32_t ) &_estack - ( uint32_t ) word;
+}
+
+uint32_t bsp_mcu_get_cycle_count( void )
+{
+    uint32_t reload = SysTick->LOAD;
+    uint32_t ms;
+    uint32_t ticks;
+    uint32_t value;
+
+    // retry when the SysTick interrupt runs between the reads
+    do
+    {
+        ms    = HAL_GetTick( );
+        ticks = ms;
+        value = SysTick->VAL;
+        if( ( SCB->ICSR & SCB_ICSR_PENDSTSET_Msk ) != 0 )
+        {
+            // the counter reloaded but the interrupt did not count it yet
+            ticks += 1;
+            value = SysTick->VAL;
+        }
+    } while( ms != HAL_GetTick( ) );
+
+    return ( ticks * ( reload + 1 ) ) + ( reload - value );
+}
 
-    return temperature;
+uint32_t bsp_mcu_get_core_clock_hz( void )
+{
+    return HAL_RCC_GetHCLKFreq( );
+}
+
+uint32_t bsp_perf_irq_get_pending( void )
+{
+    const uint32_t  radio_line = RADIO_DIOX & 0x0F;
+    const IRQn_Type radio_irqn =
+        ( radio_line < 2 ) ? EXTI0_1_IRQn : ( ( radio_line < 4 ) ? EXTI2_3_IRQn : EXTI4_15_IRQn );
+    uint32_t pending = 0;
+
+    if( NVIC_GetPendingIRQ( radio_irqn ) != 0 )
+    {
+        pending |= 1UL << BSP_PERF_IRQ_RADIO_DIO;
+    }
+    if( NVIC_GetPendingIRQ( LPTIM1_IRQn ) != 0 )
+    {
+        pending |= 1UL << BSP_PERF_IRQ_LPTIM;
+    }
+    if( NVIC_GetPendingIRQ( DMA1_Channel4_5_6_7_IRQn ) != 0 )
+    {
+        pending |= 1UL << BSP_PERF_IRQ_UART_DMA;
+    }
+    return pending;
+}
+
+bool bsp_mcu_sensors_refresh( void )
+{
+    bool is_fresh;
+
+    // with BSP_FAST_BOOT the ADC calibration is left to the first reading
+    if( bsp_sensors_adc_ready == false )
+    {
+        bsp_adc_init( 1 );
+        bsp_sensors_adc_ready = true;
+    }
+
+    CRITICAL_SECTION_BEGIN( );
+    if( bsp_sensors_measuring == true )
+    {
+        is_fresh = false;
+    }
+    else if( ( bsp_sensors_valid == true ) &&
+             ( ( uint32_t )( bsp_rtc_get_time_ms( ) - bsp_sensors_date_ms ) < BSP_MCU_SENSORS_VALIDITY_MS ) )
+    {
+        is_fresh = true;
+    }
+    else
+    {
+        bsp_sensors_measuring = bsp_adc_start_scan( 1, bsp_sensors_raw, &bsp_sensors_irq );
+        is_fresh              = !bsp_sensors_measuring;
+    }
+    CRITICAL_SECTION_END( );
+
+    return is_fresh;
+}
+
+int32_t bsp_mcu_get_mcu_temperature( void )
+{
+    bsp_mcu_sensors_wait( );
+    return bsp_sensors_temperature;
 }
 
 uint8_t bsp_mcu_get_mcu_voltage( void )
 {
-    // to be implemented by user
-    return 0x98; //0x98 means 3v ()
+    bsp_mcu_sensors_wait( );
+    return bsp_sensors_voltage;
+}
+
+void TIM21_IRQHandler( void )
+{
+    // Only there to wake up the core in bsp_mcu_wait_us
+    TIM21->SR = 0;
 }
 
 void SysTick_Handler( void )
@@ -333,6 +716,21 @@ void SysTick_Handler( void )
     HAL_SYSTICK_IRQHandler( );
 }
 
+void PendSV_Handler( void )
+{
+    if( bsp_soft_irq_locked == true )
+    {
+        bsp_soft_irq_postponed = true;
+    }
+    else if( bsp_soft_irq_callback != NULL )
+    {
+        // The radio planner bottom half runs there, the radio has to be served on time
+        bsp_mcu_clock_boost_request( );
+        bsp_soft_irq_callback( bsp_soft_irq_context );
+        bsp_mcu_clock_boost_release( );
+    }
+}
+
 void bsp_trace_print( const char* fmt, ... )
 {
 #if BSP_DBG_TRACE == BSP_FEATURE_ON
@@ -343,6 +741,58 @@ void bsp_trace_print( const char* fmt, ... )
 #endif
 }
 
+void bsp_trace_log( const char* fmt, uint8_t nb_args, const uint32_t* args )
+{
+#if( BSP_DBG_TRACE_DEFERRED == BSP_FEATURE_ON )
+    const uint16_t record_size = BSP_TRACE_RECORD_HEADER_SIZE + ( 4 * nb_args );
+
+    CRITICAL_SECTION_BEGIN( );
+    if( ( bsp_trace_lost != 0 ) &&
+        ( ( BSP_DBG_TRACE_DEFERRED_BUFFER_SIZE - bsp_trace_fill ) >=
+          ( BSP_TRACE_RECORD_HEADER_SIZE + 4 + record_size ) ) )
+    {
+        bsp_trace_put_record( BSP_TRACE_RECORD_LOST_FMT, 1, &bsp_trace_lost );
+        bsp_trace_lost = 0;
+    }
+    if( ( bsp_trace_lost == 0 ) && ( ( BSP_DBG_TRACE_DEFERRED_BUFFER_SIZE - bsp_trace_fill ) >= record_size ) )
+    {
+        // the .trace_fmt section is not loaded and starts at 0: the address is the offset in the ELF section
+        bsp_trace_put_record( ( uint32_t ) ( uintptr_t ) fmt, nb_args, args );
+    }
+    else
+    {
+        bsp_trace_lost++;
+    }
+    CRITICAL_SECTION_END( );
+#endif
+}
+
+bool bsp_trace_flush( void )
+{
+#if( BSP_DBG_TRACE_DEFERRED == BSP_FEATURE_ON )
+    static const bsp_uart_irq_t trace_tx_irq = { .context = NULL, .callback = bsp_trace_tx_done };
+    bool                        pending;
+
+    CRITICAL_SECTION_BEGIN( );
+    if( ( bsp_trace_dma_length == 0 ) && ( bsp_trace_fill != 0 ) )
+    {
+        // up to the end of the buffer, the wrapped part is sent by the next transfer
+        bsp_trace_dma_length = BSP_DBG_TRACE_DEFERRED_BUFFER_SIZE - bsp_trace_read_index;
+        if( bsp_trace_dma_length > bsp_trace_fill )
+        {
+            bsp_trace_dma_length = bsp_trace_fill;
+        }
+        bsp_uart2_dma_tx( &bsp_trace_buffer[bsp_trace_read_index], bsp_trace_dma_length, &trace_tx_irq );
+    }
+    pending = ( bsp_trace_fill != 0 );
+    CRITICAL_SECTION_END( );
+
+    return pending;
+#else
+    return false;
+#endif
+}
+
 #ifdef USE_FULL_ASSERT
 /*
  * Function Name  : assert_failed
@@ -409,11 +859,19 @@ static void bsp_system_clock_config( void )
     }
 
     periph_clk_init.PeriphClockSelection =
-        RCC_PERIPHCLK_RTC | RCC_PERIPHCLK_USART2 | RCC_PERIPHCLK_LPTIM1 | RCC_PERIPHCLK_USART1;
+        RCC_PERIPHCLK_RTC | RCC_PERIPHCLK_USART2 | RCC_PERIPHCLK_LPTIM1 | RCC_PERIPHCLK_USART1 | RCC_PERIPHCLK_LPUART1;
     periph_clk_init.LptimClockSelection  = RCC_LPTIM1CLKSOURCE_LSE;
     periph_clk_init.RTCClockSelection    = RCC_RTCCLKSOURCE_LSE;
+#if( BSP_MCU_CLOCK_SCALING == BSP_FEATURE_ON )
+    // The baud rates have to stay right whatever the system clock
+    periph_clk_init.Usart1ClockSelection = RCC_USART1CLKSOURCE_HSI;
+    periph_clk_init.Usart2ClockSelection = RCC_USART2CLKSOURCE_HSI;
+#else
     periph_clk_init.Usart1ClockSelection = RCC_USART1CLKSOURCE_PCLK2;
     periph_clk_init.Usart2ClockSelection = RCC_USART2CLKSOURCE_PCLK1;
+#endif
+    // HSI16 is the only LPUART1 clock able to receive at the host baud rates in stop mode
+    periph_clk_init.Lpuart1ClockSelection = RCC_LPUART1CLKSOURCE_HSI;
     if( HAL_RCCEx_PeriphCLKConfig( &periph_clk_init ) != HAL_OK )
     {
     }
@@ -460,7 +918,74 @@ static void bsp_mcu_gpio_init( void )
     bsp_gpio_init_in( RADIO_DIOX, BSP_GPIO_PULL_MODE_NONE, BSP_GPIO_IRQ_MODE_RISING, NULL );
     bsp_gpio_init_out( RADIO_NRST, 1 );
 
+#if defined( MODEM_DUAL_RADIO )
+    bsp_gpio_init_out( RADIO_SUBGHZ_NSS, 1 );
+    bsp_gpio_init_in( RADIO_SUBGHZ_BUSY_PIN, BSP_GPIO_PULL_MODE_NONE, BSP_GPIO_IRQ_MODE_OFF, NULL );
+    bsp_gpio_init_in( RADIO_SUBGHZ_DIOX, BSP_GPIO_PULL_MODE_NONE, BSP_GPIO_IRQ_MODE_RISING, NULL );
+    bsp_gpio_init_out( RADIO_SUBGHZ_NRST, 1 );
+#endif  // MODEM_DUAL_RADIO
+
     bsp_gpio_init_out( RADIO_ANTENNA_SWITCH, 1 );
+
+#if( BSP_LOW_POWER_MODE == BSP_FEATURE_ON )
+    bsp_gpio_sleep_init( bsp_gpio_sleep_table, sizeof( bsp_gpio_sleep_table ) / sizeof( bsp_gpio_sleep_table[0] ) );
+#endif
+}
+
+static uint32_t bsp_mcu_get_tim21_clock_hz( void )
+{
+    // The timers on APB2 run at twice PCLK2 when the APB2 prescaler is not 1
+    if( READ_BIT( RCC->CFGR, RCC_CFGR_PPRE2 ) == RCC_CFGR_PPRE2_DIV1 )
+    {
+        return HAL_RCC_GetPCLK2Freq( );
+    }
+    return HAL_RCC_GetPCLK2Freq( ) * 2;
+}
+
+static uint32_t* bsp_mcu_get_stack_bottom( void )
+{
+    // malloc going beyond the heap reservation eats the painted words and shows as stack use
+    return ( uint32_t* ) ( ( uint32_t ) &_end + ( uint32_t ) &_Min_Heap_Size );
+}
+
+static void bsp_mcu_stack_paint( void )
+{
+    uint32_t* top = ( uint32_t* ) ( __get_MSP( ) - BSP_STACK_PAINT_MARGIN );
+
+    for( uint32_t* word = bsp_mcu_get_stack_bottom( ); word < top; word++ )
+    {
+        *word = BSP_STACK_PAINT_PATTERN;
+    }
+}
+
+static void bsp_mcu_sensors_scan_done( void* context )
+{
+    // VDDA from the internal reference, calibrated at 3 V: the temperature sensor calibration is at 3 V too
+    uint32_t vdda_mv = ( ( uint32_t ) VDD_CALIB * *VREFINT_CAL_ADDR ) / bsp_sensors_raw[BSP_ADC_SCAN_VREFINT];
+    int32_t  measure = ( int32_t )( ( bsp_sensors_raw[BSP_ADC_SCAN_TEMPERATURE] * vdda_mv ) / VDD_CALIB );
+
+    // Convert ADC value to celsius using STM32 calibration
+    int32_t temperature = measure - ( int32_t ) *TEMP30_CAL_ADDR;
+    temperature         = temperature * ( int32_t )( 130 - 30 );
+    temperature         = temperature / ( int32_t )( *TEMP130_CAL_ADDR - *TEMP30_CAL_ADDR );
+    temperature         = temperature + 30;
+
+    // The voltage is in 1/50 V, as reported by the device management: 0x98 is about 3 V
+    bsp_sensors_temperature = temperature;
+    bsp_sensors_voltage     = ( vdda_mv / 20 > 0xFF ) ? 0xFF : ( uint8_t )( vdda_mv / 20 );
+    bsp_sensors_vdda_mv     = ( uint16_t ) vdda_mv;
+    bsp_sensors_date_ms     = bsp_rtc_get_time_ms( );
+    bsp_sensors_valid       = true;
+    bsp_sensors_measuring   = false;
+}
+
+static void bsp_mcu_sensors_wait( void )
+{
+    // The first reading, or one long after the last scan, waits for a new scan
+    while( bsp_mcu_sensors_refresh( ) == false )
+    {
+        bsp_mcu_wait_for_event( );
+    }
 }
 
 void HAL_MspInit( void )
@@ -471,8 +996,8 @@ void HAL_MspInit( void )
     // System interrupt init
     // SVC_IRQn interrupt configuration
     HAL_NVIC_SetPriority( SVC_IRQn, 0, 0 );
-    // PendSV_IRQn interrupt configuration
-    HAL_NVIC_SetPriority( PendSV_IRQn, 0, 0 );
+    // PendSV_IRQn interrupt configuration: lowest priority, it runs the deferred interrupt work
+    HAL_NVIC_SetPriority( PendSV_IRQn, 3, 0 );
     // SysTick_IRQn interrupt configuration
     HAL_NVIC_SetPriority( SysTick_IRQn, 0, 0 );
 }
@@ -502,6 +1027,19 @@ static void bsp_lpm_enter_stop_mode( void )
     // Enable the fast wake up from Ultra low power mode
     HAL_PWREx_EnableFastWakeUp( );
 
+#if( BSP_MCU_CLOCK_SCALING == BSP_FEATURE_ON )
+    // Wake up on MSI, already the low clock, unless a boost is still requested
+    if( bsp_clock_boost_count == 0 )
+    {
+        CLEAR_BIT( RCC->CFGR, RCC_CFGR_STOPWUCK );
+    }
+    else
+#endif
+    {
+        // Wake up on HSI16 rather than MSI, only the PLL has to be restarted then
+        SET_BIT( RCC->CFGR, RCC_CFGR_STOPWUCK );
+    }
+
     CRITICAL_SECTION_END( );
 
     // Enter Stop Mode
@@ -524,9 +1062,20 @@ static void bsp_lpm_exit_stop_mode( void )
 
 /*!
  * \brief handler low power (TODO: put in a new smtc_bsp_lpm with option)
+ *
+ * \remark The sleep is cut in watchdog reload periods. Without BSP_WATCHDOG_RELOAD_IN_STOP only the first one is
+ *         slept, the caller reloads the watchdog and comes back for the next one
+ *
+ * \param [in] milliseconds Requested sleep duration
+ * \retval consumed Part of the requested duration covered, the last period may have been cut short by an interrupt
  */
-static void bsp_low_power_handler( void )
+static int32_t bsp_low_power_handler( const int32_t milliseconds )
 {
+    const int32_t period_ms = BSP_WATCHDOG_RELOAD_PERIOD_SECONDS * 1000;
+    int32_t       consumed  = ( milliseconds > period_ms ) ? period_ms : milliseconds;
+
+    bsp_rtc_wakeup_timer_set_ms( consumed );
+
     // first stop systick to avoid getting pending irq while going in stop mode
     bsp_mcu_stop_systick( );
 
@@ -536,20 +1085,60 @@ static void bsp_low_power_handler( void )
      * and cortex will not enter low power anyway
      */
 
+    const uint32_t stop_start_ms = bsp_rtc_get_time_ms( );
     bsp_lpm_enter_stop_mode( );
+#if( BSP_WATCHDOG_RELOAD_IN_STOP == BSP_FEATURE_ON )
+    // Woken up by the end of a period only: still running on HSI16 with the peripherals suspended, reload the
+    // watchdog and go back to stop mode right away
+    while( ( consumed < milliseconds ) && ( bsp_lpm_is_woken_by_wakeup_timer_only( ) == true ) )
+    {
+        const int32_t chunk_ms = ( ( milliseconds - consumed ) > period_ms ) ? period_ms : ( milliseconds - consumed );
+
+        bsp_watchdog_reload( );
+        bsp_rtc_wakeup_timer_set_ms( chunk_ms );
+        consumed += chunk_ms;
+        HAL_PWR_EnterSTOPMode( PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI );
+    }
+#endif
     bsp_lpm_exit_stop_mode( );
+    bsp_stop_time_ms += bsp_rtc_get_time_ms( ) - stop_start_ms;
+    bsp_wakeup_nb++;
 
     __enable_irq( );
 
     // re start systick
     bsp_mcu_start_systick( );
+
+    return consumed;
+}
+
+#if( BSP_WATCHDOG_RELOAD_IN_STOP == BSP_FEATURE_ON )
+static bool bsp_lpm_is_woken_by_wakeup_timer_only( void )
+{
+    // Any other pending interrupt has to be serviced, with the clocks and the peripherals back
+    if( ( NVIC->ISPR[0] & ~( 1UL << RTC_IRQn ) ) != 0 )
+    {
+        return false;
+    }
+    return bsp_rtc_wakeup_timer_clear_event( );
 }
+#endif
 
 static void bsp_mcu_deinit( void )
 {
-    bsp_spi_deinit( BSP_RADIO_SPI_ID );
-    bsp_uart2_deinit( );
-    bsp_uart1_deinit( );
+    // The peripherals keep their registers in stop mode, only their clocks and pins are released
+    bsp_spi_suspend( BSP_RADIO_SPI_ID );
+#if( BSP_USE_PRINTF_UART == BSP_FEATURE_ON )
+    bsp_uart2_suspend( );
+#endif
+#if( BSP_USE_USER_UART == BSP_FEATURE_ON )
+    bsp_uart1_suspend( );
+#endif
+#if( BSP_USE_HOST_SPI == BSP_FEATURE_ON )
+    // No transfer is armed in stop mode, the host wakes the modem up with the COMMAND line first
+    bsp_spi_suspend( BSP_HOST_SPI_ID );
+#endif
+    bsp_gpio_sleep_enter( );
 }
 
 static void bsp_mcu_reinit( void )
@@ -557,45 +1146,104 @@ static void bsp_mcu_reinit( void )
     // Reconfig needed OSC and PLL
     bsp_system_clock_re_config_after_stop( );
 
-    // Initialize UART
-#if( BSP_USE_PRINTF_UART == BSP_FEATURE_ON )
-    bsp_uart1_init( );
-    bsp_uart2_init( );
+    // The pins before the peripherals driving them
+    bsp_gpio_sleep_exit( );
+    // UART2 is resumed by the next trace output
+#if( BSP_USE_USER_UART == BSP_FEATURE_ON )
+    bsp_uart1_resume( );
 #endif
-
-    // Initialize SPI
-    bsp_spi_init( BSP_RADIO_SPI_ID, RADIO_SPI_MOSI, RADIO_SPI_MISO, RADIO_SPI_SCLK );
+#if( BSP_USE_HOST_SPI == BSP_FEATURE_ON )
+    bsp_spi_resume( BSP_HOST_SPI_ID );
+#endif
+    bsp_spi_resume( BSP_RADIO_SPI_ID );
 }
 
 static void bsp_system_clock_re_config_after_stop( void )
 {
-    __HAL_RCC_PWR_CLK_ENABLE( );
+#if( BSP_MCU_CLOCK_SCALING == BSP_FEATURE_ON )
+    if( bsp_clock_boost_count == 0 )
+    {
+        bsp_system_clock_set_low( );
+        return;
+    }
+#endif
+    bsp_system_clock_set_high( );
+}
+
+static void bsp_system_clock_set_high( void )
+{
+#if( BSP_MCU_CLOCK_SCALING == BSP_FEATURE_ON )
+    // The regulator goes up before the frequency
     __HAL_PWR_VOLTAGESCALING_CONFIG( PWR_REGULATOR_VOLTAGE_SCALE1 );
+    while( __HAL_PWR_GET_FLAG( PWR_FLAG_VOS ) != RESET )
+    {
+    }
+    __HAL_FLASH_SET_LATENCY( FLASH_LATENCY_1 );
+#endif
+
+    // The voltage scaling, the flash latency and the PLL settings are kept in stop mode, HSI16 is already running
+    // when woken up with STOPWUCK set
+    SET_BIT( RCC->CR, RCC_CR_HSION );
+    while( READ_BIT( RCC->CR, RCC_CR_HSIRDY ) == 0 )
+    {
+    }
+
+    SET_BIT( RCC->CR, RCC_CR_PLLON );
+    while( READ_BIT( RCC->CR, RCC_CR_PLLRDY ) == 0 )
+    {
+    }
 
-    // Enable HSI
-    __HAL_RCC_HSI_CONFIG( RCC_HSI_ON );
+    MODIFY_REG( RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_PLL );
+    while( READ_BIT( RCC->CFGR, RCC_CFGR_SWS ) != RCC_CFGR_SWS_PLL )
+    {
+    }
 
-    // Wait till HSI is ready
-    while( __HAL_RCC_GET_FLAG( RCC_FLAG_HSIRDY ) == RESET )
+#if( BSP_MCU_CLOCK_SCALING == BSP_FEATURE_ON )
+    bsp_clock_is_high = true;
+    SystemCoreClockUpdate( );
+    if( SysTick->CTRL != 0 )
     {
+        bsp_mcu_start_systick( );
     }
+#endif
+}
 
-    // Enable PLL
-    __HAL_RCC_PLL_ENABLE( );
+#if( BSP_MCU_CLOCK_SCALING == BSP_FEATURE_ON )
+static void bsp_system_clock_set_low( void )
+{
+    // MSI range 6 (4.2 MHz), the range is kept in stop mode. HSI16 stays on as the UARTs kernel clock.
+    SET_BIT( RCC->CR, RCC_CR_HSION );
+    MODIFY_REG( RCC->ICSCR, RCC_ICSCR_MSIRANGE, RCC_ICSCR_MSIRANGE_6 );
+    SET_BIT( RCC->CR, RCC_CR_MSION );
+    while( READ_BIT( RCC->CR, RCC_CR_MSIRDY ) == 0 )
+    {
+    }
 
-    // Wait till PLL is ready
-    while( __HAL_RCC_GET_FLAG( RCC_FLAG_PLLRDY ) == RESET )
+    MODIFY_REG( RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_MSI );
+    while( READ_BIT( RCC->CFGR, RCC_CFGR_SWS ) != RCC_CFGR_SWS_MSI )
     {
     }
+    CLEAR_BIT( RCC->CR, RCC_CR_PLLON );
 
-    // Select PLL as system clock source
-    __HAL_RCC_SYSCLK_CONFIG( RCC_SYSCLKSOURCE_PLLCLK );
+    // The frequency goes down before the regulator
+    __HAL_FLASH_SET_LATENCY( FLASH_LATENCY_0 );
+    __HAL_PWR_VOLTAGESCALING_CONFIG( PWR_REGULATOR_VOLTAGE_SCALE2 );
+    while( __HAL_PWR_GET_FLAG( PWR_FLAG_VOS ) != RESET )
+    {
+    }
 
-    // Wait till PLL is used as system clock source
-    while( __HAL_RCC_GET_SYSCLK_SOURCE( ) != RCC_SYSCLKSOURCE_STATUS_PLLCLK )
+    while( READ_BIT( RCC->CR, RCC_CR_HSIRDY ) == 0 )
     {
     }
+
+    bsp_clock_is_high = false;
+    SystemCoreClockUpdate( );
+    if( SysTick->CTRL != 0 )
+    {
+        bsp_mcu_start_systick( );
+    }
 }
+#endif
 
 #else  // ie BSP_LOW_POWER_MODE == BSP_FEATURE_OFF
 
@@ -618,6 +1266,44 @@ static bool bsp_mcu_no_low_power_wait( const int32_t milliseconds )
 }
 #endif
 
+#if( BSP_DBG_TRACE_DEFERRED == BSP_FEATURE_ON )
+static void bsp_trace_put_record( uint32_t fmt, uint8_t nb_args, const uint32_t* args )
+{
+    const uint32_t ticks = ( uint32_t ) bsp_rtc_get_ticks( );
+    uint8_t        header[BSP_TRACE_RECORD_HEADER_SIZE];
+    uint16_t       size = 0;
+
+    header[0] = BSP_TRACE_RECORD_SYNC;
+    header[1] = nb_args;
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        header[2 + i] = ( fmt >> ( 8 * i ) ) & 0xFF;
+        header[6 + i] = ( ticks >> ( 8 * i ) ) & 0xFF;
+    }
+
+    // the arguments are read byte by byte from memory: little endian like the header
+    while( size < ( BSP_TRACE_RECORD_HEADER_SIZE + ( 4 * nb_args ) ) )
+    {
+        const uint8_t* args_bytes = ( const uint8_t* ) args;
+
+        bsp_trace_buffer[bsp_trace_write_index] =
+            ( size < BSP_TRACE_RECORD_HEADER_SIZE ) ? header[size] : args_bytes[size - BSP_TRACE_RECORD_HEADER_SIZE];
+        bsp_trace_write_index = ( bsp_trace_write_index + 1 ) % BSP_DBG_TRACE_DEFERRED_BUFFER_SIZE;
+        size++;
+    }
+    bsp_trace_fill += size;
+}
+
+static void bsp_trace_tx_done( void* context )
+{
+    bsp_trace_read_index = ( bsp_trace_read_index + bsp_trace_dma_length ) % BSP_DBG_TRACE_DEFERRED_BUFFER_SIZE;
+    bsp_trace_fill -= bsp_trace_dma_length;
+    bsp_trace_dma_length = 0;
+
+    bsp_trace_flush( );
+}
+#endif
+
 #if( BSP_DBG_TRACE == BSP_FEATURE_ON )
 static void vprint( const char* fmt, va_list argp )
 {
@@ -64,21 +64,80 @@ extern "C" {
 #define BSP_DBG_TRACE_COLOR                         BSP_FEATURE_ON
 #define BSP_DBG_TRACE_RP                            BSP_FEATURE_OFF
 
+// BSP_FEATURE_ON to log the format string address and the raw arguments, drained by DMA when the MCU is idle and
+// decoded on the host with the ELF file (see bsp_trace_log)
+#define BSP_DBG_TRACE_DEFERRED                      BSP_FEATURE_OFF
+#define BSP_DBG_TRACE_DEFERRED_BUFFER_SIZE          1024
+
 // BSP_FEATURE_ON to activate sleep mode
 // BSP_FEATURE_OFF to replace by wait functions (easier in debug mode)
 #define BSP_LOW_POWER_MODE                          BSP_FEATURE_ON
 
+// MCU supply current in run (STM32L073 at 32 MHz) and in STOP mode with the RTC, for the modem charge
+#define BSP_MCU_RUN_CURRENT_UA                      4500
+#define BSP_MCU_STOP_CURRENT_UA                     1
+
+// Supply voltage of an empty and of a full battery, mapped to the LoRaWAN battery level [1: empty, 254: full]. The
+// MCU is supplied straight from the battery: the level follows VDD, measured by the ADC sensors scan
+#define BSP_BATTERY_EMPTY_MV                        2200
+#define BSP_BATTERY_FULL_MV                         3000
+
+// BSP_FEATURE_ON to run on MSI at 4.2 MHz in voltage range 2 when awake, the PLL at 32 MHz in range 1 being only
+// started for the sections requesting it (see bsp_mcu_clock_boost_request)
+#define BSP_MCU_CLOCK_SCALING                       BSP_FEATURE_ON
+
 // BSP_FEATURE_ON to enable debug probe
 #define BSP_HW_DEBUG_PROBE                          BSP_FEATURE_OFF
 
+/*!
+ * Pin states in STOP mode, as { pin, gpio_sleep_state_t } entries
+ *
+ * \remark The listed pins are switched with a few register writes per port when entering STOP mode and given their
+ *         run configuration back on wake up. The SPI and UART pins are already set to analog by their suspend. Do
+ *         not list a wake-up line (radio DIO and BUSY, HW_MODEM_COMMAND_PIN), the radio NSS that keeps the radio
+ *         asleep, nor a line the radio needs while it receives with the MCU in STOP mode (antenna switch). The SWD
+ *         pins leak through their pulls when no probe is attached, they are kept when BSP_HW_DEBUG_PROBE is on. A NC
+ *         entry is ignored, for an empty table.
+ */
+#ifndef BSP_GPIO_SLEEP_TABLE
+#if( BSP_HW_DEBUG_PROBE == BSP_FEATURE_ON )
+#define BSP_GPIO_SLEEP_TABLE                        { NC, BSP_GPIO_SLEEP_ANALOG }
+#else
+#define BSP_GPIO_SLEEP_TABLE                        { PA_13, BSP_GPIO_SLEEP_ANALOG }, { PA_14, BSP_GPIO_SLEEP_ANALOG }
+#endif
+#endif
+
+// BSP_FEATURE_ON for the host to talk to the modem as a SPI master on SPI2 (HW_MODEM_SPI_MOSI/MISO/SCLK), set by
+// make hard_modem HOST_SPI=1. SPI2 takes the DMA channels of USART1: the user UART is not used then
+#if defined( HW_MODEM_SPI_ENABLED )
+#define BSP_USE_HOST_SPI                            BSP_FEATURE_ON
+#define BSP_USE_USER_UART                           BSP_FEATURE_OFF
+#else
+#define BSP_USE_HOST_SPI                            BSP_FEATURE_OFF
 #define BSP_USE_USER_UART                           BSP_FEATURE_ON
+#endif
+#define BSP_HOST_SPI_ID                             2
 #define BSP_USER_UART_ID                            1
 
+// BSP_FEATURE_ON to talk to the host on LPUART1 (HW_MODEM_LPUART_TX_LINE/RX_LINE), which wakes the MCU up from stop
+// mode on a start bit: the host does not have to assert HW_MODEM_COMMAND_PIN before sending its commands
+#define BSP_USER_UART_LPUART                        BSP_FEATURE_OFF
+
 #define BSP_USE_PRINTF_UART                         BSP_FEATURE_ON
 #define BSP_PRINTF_UART_ID                          2
 #define BSP_PRINT_BUFFER_SIZE                       255
 
 #define BSP_RADIO_SPI_ID                            1
+// Highest radio SPI clock, the prescaler is chosen for the fastest system clock (SX1280: 18 MHz)
+#define BSP_RADIO_SPI_MAX_CLOCK_HZ                  18000000
+
+// NVIC priorities [0: highest, 3: lowest] of the interrupt sources. The radio DIO, BUSY and timer handlers wait for
+// the SPI DMA completion interrupt running at priority 0, they must not be above 1. EXTI lines 4 to 15 share one
+// interrupt: its lines are served in ascending order, the radio DIO (line 4) before the host COMMAND pin (line 5)
+#define BSP_EXTI0_1_IRQ_PRIORITY                    3
+#define BSP_EXTI2_3_IRQ_PRIORITY                    1
+#define BSP_EXTI4_15_IRQ_PRIORITY                   1
+#define BSP_LPTIM_IRQ_PRIORITY                      2
 
 // BSP_FEATURE_OFF to not use watchdog
 #define BSP_USE_WATCHDOG                            BSP_FEATURE_ON
@@ -90,18 +149,103 @@ extern "C" {
  */
 #define BSP_WATCHDOG_RELOAD_PERIOD_SECONDS          20
 
+// BSP_FEATURE_ON to reload the watchdog and go back to stop mode straight from the RTC wakeup during long sleeps,
+// without restarting the clocks and the peripherals at every reload period
+#define BSP_WATCHDOG_RELOAD_IN_STOP                 BSP_FEATURE_ON
+
+// BSP_FEATURE_ON to shorten the time to the first uplink after a reset: no version banner, the ADC is started on
+// the first sensor reading and the radio reset ends as soon as the radio is ready
+#define BSP_FAST_BOOT                               BSP_FEATURE_OFF
+
 /*!
  * File upload max size
  *
- * \remark This value define the max size (in byte) for a file upload
+ * \remark This value define the max size (in byte) for a file upload, can be set at build time
  */
+#ifndef BSP_FILE_UPLOAD_MAX_SIZE
 #define BSP_FILE_UPLOAD_MAX_SIZE                    2048
+#endif
+
+/*!
+ * Stream fifo size
+ *
+ * \remark This value define the size (in byte) of the RAM fifo holding the stream records not sent yet, can be set at
+ *         build time
+ */
+#ifndef BSP_STREAM_FIFO_SIZE
+#define BSP_STREAM_FIFO_SIZE                        512
+#endif
+
+/*!
+ * Application uplink queue size
+ *
+ * \remark This value define the number of application uplinks waiting in the modem supervisor to be sent, can be
+ *         set at build time
+ */
+#ifndef BSP_MODEM_SEND_QUEUE_SIZE
+#define BSP_MODEM_SEND_QUEUE_SIZE                   4
+#endif
+
+/*!
+ * Modem pool size
+ *
+ * \remark This value define the number of 255 bytes blocks shared by the application uplink queue, the stream
+ *         retransmission history and the test mode payload, a block is held only while it is in use. Can be set at
+ *         build time.
+ */
+#ifndef BSP_MODEM_POOL_BLOCK_NB
+#define BSP_MODEM_POOL_BLOCK_NB                     ( BSP_MODEM_SEND_QUEUE_SIZE + 2 )
+#endif
 
 //Board specific definition for soft modem context saving (base address is 0x08080000 )
 #define BSP_MODEM_CONTEXT_ADDR_OFFSET               1024
 
-#define BSP_MODEM_CONTEXT_SIZE                      16
+#define BSP_MODEM_CONTEXT_SIZE                      20
+
+/*!
+ * NVM journal, the frequently updated contexts are appended there as small records
+ *
+ * \remark Two banks of BSP_NVM_JOURNAL_BANK_SIZE bytes are used alternately, each record update programs its own
+ *         words only and the compaction spreads the wear over both banks
+ */
+#define BSP_NVM_JOURNAL_ADDR_OFFSET                 2048
+#define BSP_NVM_JOURNAL_BANK_SIZE                   512
+#define BSP_NVM_JOURNAL_KEY_MAX                     10
+
+#define BSP_NVM_JOURNAL_KEY_MODEM_CONFIG            1
+#define BSP_NVM_JOURNAL_KEY_MODEM_CHARGE            2
+#define BSP_NVM_JOURNAL_KEY_LORAWAN_FCNT            3
+#define BSP_NVM_JOURNAL_KEY_LORAWAN_JOIN            4
+#define BSP_NVM_JOURNAL_KEY_LORAWAN_DUTY_CYCLE      5
+// The lr1mac stack n uses the LORAWAN_FCNT and LORAWAN_JOIN keys plus n * BSP_NVM_JOURNAL_KEY_LORAWAN_STRIDE, below
+// the MODEM_FILE_UPLOAD key
+#define BSP_NVM_JOURNAL_KEY_LORAWAN_STRIDE          3
+#define BSP_NVM_JOURNAL_KEY_MODEM_FILE_UPLOAD       8
+// The lr1mac stack n uses the LORAWAN_MULTICAST key plus n, up to BSP_NVM_JOURNAL_KEY_MAX
+#define BSP_NVM_JOURNAL_KEY_LORAWAN_MULTICAST       9
 
+/*!
+ * Store-and-forward outbox, the application uplinks kept during the network outages
+ *
+ * \remark The second bank of the data EEPROM, a ring of records: each record is programmed once and the ring positions
+ *         word once per record stored or delivered
+ */
+#define BSP_MODEM_OUTBOX_ADDR_OFFSET                3072
+#define BSP_MODEM_OUTBOX_SIZE                       3072
+
+/*!
+ * Staging area receiving a firmware image, the top 64 kB of the program flash, built with make FW_STAGING=1
+ *
+ * \remark The area is in the second flash bank, from 0x08018000. The linker script then keeps the firmware in the first
+ *         bank, 96 kB: the code keeps running from it while a page of the second bank is erased or programmed. Without
+ *         the area the firmware has the whole 192 kB and the fragmented downloads and firmware updates are refused
+ */
+#if defined( BSP_NVM_STAGING_ENABLED )
+#define BSP_NVM_STAGING_ADDR                        0x08020000
+#define BSP_NVM_STAGING_SIZE                        ( 64 * 1024 )
+#else
+#define BSP_NVM_STAGING_SIZE                        0
+#endif
 
 /*!
  * Application Layer Clock Synchronization
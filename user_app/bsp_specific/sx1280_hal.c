@@ -50,6 +50,15 @@
  * --- PRIVATE CONSTANTS -------------------------------------------------------
  */
 
+// Below this length the DMA setup costs more than the polled transfer
+#define SX1280_HAL_DMA_MIN_LENGTH 16
+
+// Busy polls before sleeping on the pin IRQ, most commands release BUSY within a few microseconds
+#define SX1280_HAL_BUSY_SPIN_COUNT 64
+
+// Longest BUSY period is the wake-up from sleep followed by calibration, a few milliseconds
+#define SX1280_HAL_BUSY_TIMEOUT_MS 100
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE TYPES -----------------------------------------------------------
@@ -63,6 +72,12 @@
 // This variable will hold the current operating mode of the radio
 static volatile sx1280_hal_operating_mode_t radio_opmode;
 
+// Set by the SPI DMA completion callback
+static volatile bool spi_dma_done;
+
+// BUSY falling edge IRQ, only attached while waiting
+static bsp_gpio_irq_t busy_irq = { .context = NULL, .callback = NULL };
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
@@ -70,8 +85,25 @@ static volatile sx1280_hal_operating_mode_t radio_opmode;
 
 /**
  * @brief Wait until radio busy pin is reset to 0
+ *
+ * @returns Operation status, SX1280_HAL_STATUS_ERROR when BUSY stays high past SX1280_HAL_BUSY_TIMEOUT_MS
  */
-static void sx1280_hal_wait_on_busy( void );
+static sx1280_hal_status_t sx1280_hal_wait_on_busy( void );
+
+/**
+ * @brief BUSY falling edge callback, its only purpose is to wake the core up
+ */
+static void sx1280_hal_busy_irq( void* context );
+
+/**
+ * @brief Transfer the data part of a command, through DMA for long buffers
+ */
+static void sx1280_hal_spi_data_transfer( const uint8_t* out_data, uint8_t* in_data, const uint16_t data_length );
+
+/**
+ * @brief SPI DMA completion callback
+ */
+static void sx1280_hal_spi_dma_cplt( void* context );
 
 /*
  * -----------------------------------------------------------------------------
@@ -81,45 +113,97 @@ static void sx1280_hal_wait_on_busy( void );
 sx1280_hal_status_t sx1280_hal_write( const void* context, const uint8_t* command, const uint16_t command_length,
                                       const uint8_t* data, const uint16_t data_length )
 {
-    sx1280_hal_wakeup( context );
+    if( sx1280_hal_wakeup( context ) != SX1280_HAL_STATUS_OK )
+    {
+        return SX1280_HAL_STATUS_ERROR;
+    }
 
     // Put NSS low to start spi transaction
     bsp_gpio_set_value( RADIO_NSS, 0 );
-    for( uint16_t i = 0; i < command_length; i++ )
-    {
-        bsp_spi_in_out( BSP_RADIO_SPI_ID, command[i] );
-    }
-    for( uint16_t i = 0; i < data_length; i++ )
-    {
-        bsp_spi_in_out( BSP_RADIO_SPI_ID, data[i] );
-    }
+    bsp_spi_transfer( BSP_RADIO_SPI_ID, command, NULL, command_length );
+    sx1280_hal_spi_data_transfer( data, NULL, data_length );
     // Put NSS high as the spi transaction is finished
     bsp_gpio_set_value( RADIO_NSS, 1 );
 
     // 0x84 - SX1280_SET_SLEEP opcode. In sleep mode the radio dio is struck to 1 => do not test it
     if( command[0] != 0x84 )
     {
-        sx1280_hal_wait_on_busy( );
+        return sx1280_hal_wait_on_busy( );
     }
 
     return SX1280_HAL_STATUS_OK;
 }
 
-sx1280_hal_status_t sx1280_hal_read( const void* context, const uint8_t* command, const uint16_t command_length,
-                                     uint8_t* data, const uint16_t data_length )
+sx1280_hal_status_t sx1280_hal_write_batch( const void* context, const uint8_t* batch, const uint16_t batch_length )
 {
-    sx1280_hal_wakeup( context );
+    uint16_t index = 0;
 
-    // Put NSS low to start spi transaction
-    bsp_gpio_set_value( RADIO_NSS, 0 );
-    for( uint16_t i = 0; i < command_length; i++ )
+    if( sx1280_hal_wakeup( context ) != SX1280_HAL_STATUS_OK )
+    {
+        return SX1280_HAL_STATUS_ERROR;
+    }
+
+    while( index < batch_length )
+    {
+        const uint8_t length = batch[index++];
+
+        // NSS rising edge ends a command, each one needs its own frame
+        bsp_gpio_set_value( RADIO_NSS, 0 );
+        sx1280_hal_spi_data_transfer( &batch[index], NULL, length );
+        bsp_gpio_set_value( RADIO_NSS, 1 );
+        index += length;
+
+        // The radio accepts the next command only once BUSY is low
+        if( sx1280_hal_wait_on_busy( ) != SX1280_HAL_STATUS_OK )
+        {
+            return SX1280_HAL_STATUS_ERROR;
+        }
+    }
+
+    return SX1280_HAL_STATUS_OK;
+}
+
+sx1280_hal_status_t sx1280_hal_transfer_batch( const void* context, const uint8_t* batch, uint8_t* response,
+                                               const uint16_t batch_length )
+{
+    uint16_t index = 0;
+
+    if( sx1280_hal_wakeup( context ) != SX1280_HAL_STATUS_OK )
+    {
+        return SX1280_HAL_STATUS_ERROR;
+    }
+
+    while( index < batch_length )
     {
-        bsp_spi_in_out( BSP_RADIO_SPI_ID, command[i] );
+        const uint8_t length = batch[index++];
+
+        bsp_gpio_set_value( RADIO_NSS, 0 );
+        sx1280_hal_spi_data_transfer( &batch[index], &response[index], length );
+        bsp_gpio_set_value( RADIO_NSS, 1 );
+        index += length;
+
+        // The next sx1280_hal_wakeup waits for BUSY after the last command
+        if( ( index < batch_length ) && ( sx1280_hal_wait_on_busy( ) != SX1280_HAL_STATUS_OK ) )
+        {
+            return SX1280_HAL_STATUS_ERROR;
+        }
     }
-    for( uint16_t i = 0; i < data_length; i++ )
+
+    return SX1280_HAL_STATUS_OK;
+}
+
+sx1280_hal_status_t sx1280_hal_read( const void* context, const uint8_t* command, const uint16_t command_length,
+                                     uint8_t* data, const uint16_t data_length )
+{
+    if( sx1280_hal_wakeup( context ) != SX1280_HAL_STATUS_OK )
     {
-        data[i] = bsp_spi_in_out( BSP_RADIO_SPI_ID, 0 );
+        return SX1280_HAL_STATUS_ERROR;
     }
+
+    // Put NSS low to start spi transaction
+    bsp_gpio_set_value( RADIO_NSS, 0 );
+    bsp_spi_transfer( BSP_RADIO_SPI_ID, command, NULL, command_length );
+    sx1280_hal_spi_data_transfer( NULL, data, data_length );
     // Put NSS high as the spi transaction is finished
     bsp_gpio_set_value( RADIO_NSS, 1 );
 
@@ -129,30 +213,43 @@ sx1280_hal_status_t sx1280_hal_read( const void* context, const uint8_t* command
 void sx1280_hal_reset( const void* context )
 {
     bsp_gpio_set_value( RADIO_NRST, 0 );
+#if( BSP_FAST_BOOT == BSP_FEATURE_ON )
+    // short pulse, then the radio is ready as soon as its startup releases BUSY
+    bsp_mcu_wait_us( 200 );
+    bsp_gpio_set_value( RADIO_NRST, 1 );
+    bsp_mcu_wait_us( 100 );
+    sx1280_hal_wait_on_busy( );
+#else
     bsp_mcu_wait_us( 5000 );
     bsp_gpio_set_value( RADIO_NRST, 1 );
     bsp_mcu_wait_us( 5000 );
+#endif
 }
 
 sx1280_hal_status_t sx1280_hal_wakeup( const void* context )
 {
+    sx1280_hal_status_t status;
+
     if( radio_opmode == SX1280_HAL_OP_MODE_SLEEP )
     {
         // Busy is HIGH in sleep mode, wake-up the device
         bsp_gpio_set_value( RADIO_NSS, 0 );
-        sx1280_hal_wait_on_busy( );
+        status = sx1280_hal_wait_on_busy( );
         bsp_gpio_set_value( RADIO_NSS, 1 );
 
-        // Radio is awake in STDBY_RC mode
-        radio_opmode = SX1280_HAL_OP_MODE_STDBY_RC;
+        if( status == SX1280_HAL_STATUS_OK )
+        {
+            // Radio is awake in STDBY_RC mode
+            radio_opmode = SX1280_HAL_OP_MODE_STDBY_RC;
+        }
     }
     else
     {
         // if the radio is awake, just wait until busy pin get low
-        sx1280_hal_wait_on_busy( );
+        status = sx1280_hal_wait_on_busy( );
     }
 
-    return SX1280_HAL_STATUS_OK;
+    return status;
 }
 
 sx1280_hal_operating_mode_t sx1280_hal_get_operating_mode( const void* context )
@@ -170,11 +267,70 @@ void sx1280_hal_set_operating_mode( const void* context, const sx1280_hal_operat
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
-static void sx1280_hal_wait_on_busy( void )
+static sx1280_hal_status_t sx1280_hal_wait_on_busy( void )
 {
+    for( uint16_t i = 0; i < SX1280_HAL_BUSY_SPIN_COUNT; i++ )
+    {
+        if( bsp_gpio_get_value( RADIO_BUSY_PIN ) == 0 )
+        {
+            return SX1280_HAL_STATUS_OK;
+        }
+    }
+
+    // Long busy period: sleep until the falling edge, SysTick wakes the core up to check the timeout
+    sx1280_hal_status_t status     = SX1280_HAL_STATUS_OK;
+    uint32_t            start_time = bsp_rtc_get_time_ms( );
+
+    busy_irq.callback = sx1280_hal_busy_irq;
+    bsp_gpio_init_in( RADIO_BUSY_PIN, BSP_GPIO_PULL_MODE_NONE, BSP_GPIO_IRQ_MODE_FALLING, &busy_irq );
+
+    // BUSY is checked again after arming the IRQ, a falling edge in between would be missed otherwise
     while( bsp_gpio_get_value( RADIO_BUSY_PIN ) == 1 )
     {
+        if( ( int32_t )( bsp_rtc_get_time_ms( ) - start_time ) > SX1280_HAL_BUSY_TIMEOUT_MS )
+        {
+            status = SX1280_HAL_STATUS_ERROR;
+            break;
+        }
+        bsp_mcu_wait_for_event( );
+    }
+
+    bsp_gpio_init_in( RADIO_BUSY_PIN, BSP_GPIO_PULL_MODE_NONE, BSP_GPIO_IRQ_MODE_OFF, NULL );
+
+    if( status != SX1280_HAL_STATUS_OK )
+    {
+        BSP_DBG_TRACE_ERROR( "SX1280 BUSY still high after %d ms\n", SX1280_HAL_BUSY_TIMEOUT_MS );
     }
+
+    return status;
+}
+
+static void sx1280_hal_busy_irq( void* context )
+{
+}
+
+BSP_RAMFUNC static void sx1280_hal_spi_data_transfer( const uint8_t* out_data, uint8_t* in_data,
+                                                     const uint16_t data_length )
+{
+    if( data_length < SX1280_HAL_DMA_MIN_LENGTH )
+    {
+        bsp_spi_transfer( BSP_RADIO_SPI_ID, out_data, in_data, data_length );
+        return;
+    }
+
+    // armed first: the transfer is polled and the callback synchronous when the SPI has no DMA channel
+    spi_dma_done = false;
+    bsp_spi_transfer_dma( BSP_RADIO_SPI_ID, out_data, in_data, data_length,
+                          &( bsp_spi_irq_t ){ .context = NULL, .callback = sx1280_hal_spi_dma_cplt } );
+    // NSS has to stay low until the last byte is shifted out
+    while( spi_dma_done == false )
+    {
+    }
+}
+
+static void sx1280_hal_spi_dma_cplt( void* context )
+{
+    spi_dma_done = true;
 }
 
 /* --- EOF ------------------------------------------------------------------ */
@@ -43,6 +43,40 @@
 #include "lorawan_api.h"
 #include "ral.h"
 #include "modem_utilities.h"
+#include "hw_modem.h"
+#include "radio_planner_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * Handler of a host command, see host_cmd_table
+ */
+typedef void ( *cmd_handler_t )( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+
+/*!
+ * Handler of a test mode command, see host_cmd_test_table
+ */
+typedef void ( *cmd_tst_handler_t )( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+
+/*!
+ * Dispatch entry of a command: the payload length bounds checked before the handler is called
+ */
+typedef struct cmd_entry_s
+{
+    uint8_t       length_min;
+    uint8_t       length_max;
+    cmd_handler_t handler;
+} cmd_entry_t;
+
+typedef struct cmd_tst_entry_s
+{
+    uint8_t           length_min;
+    uint8_t           length_max;
+    cmd_tst_handler_t handler;
+} cmd_tst_entry_t;
 
 /*
  * -----------------------------------------------------------------------------
@@ -53,6 +87,11 @@ static uint8_t  file_store[2048]    = { 0 };
 static uint16_t file_size           = 0;
 static uint16_t upload_current_size = 0;
 
+/*!
+ * Response of the sub-command of a batch being run, only its return code is sent to the host
+ */
+static uint8_t batch_response[UINT8_MAX];
+
 static modem_return_code_t upload_data( uint8_t* payload, uint8_t payload_length, uint8_t* file_strore );
 #if BSP_DBG_TRACE == BSP_FEATURE_ON
 static const char* HostCmdStr[CMD_MAX] = {
@@ -105,6 +144,35 @@ static const char* HostCmdStr[CMD_MAX] = {
     [CMD_STREAMINIT]          = "STREAMINIT",
     [CMD_SENDSTREAMDATA]      = "SENDSTREAMDATA",
     [CMD_STREAMSTATUS]        = "STREAMSTATUS",
+    [CMD_GETBAUDRATE]         = "GETBAUDRATE",
+    [CMD_SETBAUDRATE]         = "SETBAUDRATE",
+    [CMD_GETRPSTATS]          = "GETRPSTATS",
+    [CMD_GETPERFTRACE]        = "GETPERFTRACE",
+    [CMD_GETPERFLATENCY]      = "GETPERFLATENCY",
+    [CMD_GETRPTRACE]          = "GETRPTRACE",
+    [CMD_GETEVENTS]           = "GETEVENTS",
+    [CMD_BATCH]               = "BATCH",
+    [CMD_SETDMDELTA]          = "SETDMDELTA",
+    [CMD_GETRAMUSAGE]         = "GETRAMUSAGE",
+    [CMD_RANGINGSTART]        = "RANGINGSTART",
+    [CMD_RANGINGSTOP]         = "RANGINGSTOP",
+    [CMD_GETRANGINGRESULT]    = "GETRANGINGRESULT",
+    [CMD_BLEBEACONSTART]      = "BLEBEACONSTART",
+    [CMD_BLEBEACONSTOP]       = "BLEBEACONSTOP",
+    [CMD_REQUESTTIMESYNC]     = "REQUESTTIMESYNC",
+    [CMD_SETTXSLOT]           = "SETTXSLOT",
+    [CMD_SETEVENTPUSH]        = "SETEVENTPUSH",
+    [CMD_RAWRADIOTX]          = "RAWRADIOTX",
+    [CMD_RAWRADIORX]          = "RAWRADIORX",
+    [CMD_RAWRADIOABORT]       = "RAWRADIOABORT",
+    [CMD_GETRADIOFREEWINDOW]  = "GETRADIOFREEWINDOW",
+    [CMD_RELAYSTART]          = "RELAYSTART",
+    [CMD_RELAYSTOP]           = "RELAYSTOP",
+    [CMD_CHANNELSCANSTART]    = "CHANNELSCANSTART",
+    [CMD_CHANNELSCANSTOP]     = "CHANNELSCANSTOP",
+    [CMD_GETENERGY]           = "GETENERGY",
+    [CMD_SETPORTQOS]          = "SETPORTQOS",
+    [CMD_GETIRQSTATS]         = "GETIRQSTATS",
 };
 #endif
 
@@ -132,6 +200,12 @@ static const char* host_cmd_test_str[CMD_TST_MAX] = {
     [CMD_TST_STREAM_GET]      = "STREAM_GET",       //
     [CMD_TST_STREAM_DOWNLINK] = "STREAM_DOWNLINK",  //
 #endif                                              // LORAWAN_BYPASS_ENABLED
+    [CMD_TST_PER_TX]       = "PER_TX",        //
+    [CMD_TST_PER_RX]       = "PER_RX",        //
+    [CMD_TST_PER_RESULT]   = "PER_RESULT",    //
+    [CMD_TST_SWEEP_TX]     = "SWEEP_TX",      //
+    [CMD_TST_SWEEP_RX]     = "SWEEP_RX",      //
+    [CMD_TST_SWEEP_RESULT] = "SWEEP_RESULT",  //
 };
 #endif
 
@@ -141,21 +215,13 @@ static const char* host_cmd_test_str[CMD_TST_MAX] = {
  */
 
 /*!
- * \brief   check cmd Size
- * \remark
- * \param [IN]  a pointer containing the command input
- * \param [OUT] a pointer containing the command output
+ * \brief   check the length of a command against its bounds
+ * \param [IN]  length      : command length
+ * \param [IN]  length_min  : smallest length accepted
+ * \param [IN]  length_max  : largest length accepted
  * @return CMD_LENGTH_VALID is length is valid, CMD_LENGTH_NOT_VALID otherwise
  */
-cmd_length_valid_t CheckCmdSize( s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
-
-/**
- * @brief check test cmd size
- * \param [IN]  a pointer containing the command input
- * \param [OUT] a pointer containing the command output
- * @return CMD_LENGTH_VALID is length is valid, CMD_LENGTH_NOT_VALID otherwise
- */
-cmd_length_valid_t cmd_test_parser_check_cmd_size( host_cmd_test_t tst_id, uint8_t length );
+static cmd_length_valid_t cmd_check_length( uint8_t length, uint8_t length_min, uint8_t length_max );
 
 /*!
  * \brief parse commands for test mode
@@ -166,6 +232,267 @@ cmd_length_valid_t cmd_test_parser_check_cmd_size( host_cmd_test_t tst_id, uint8
  */
 static e_parse_error_t cmd_test_parser( s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
 
+/*!
+ * \brief read a big endian 16-bit value of a command payload
+ */
+static inline uint16_t cmd_get_u16( const uint8_t* buffer );
+
+/*!
+ * \brief read a big endian 32-bit value of a command payload
+ */
+static inline uint32_t cmd_get_u32( const uint8_t* buffer );
+
+/*!
+ * Handlers of the host commands, see host_cmd_table. The input buffer points into the received frame and the
+ * response is written in place in the frame sent back: the return code is RC_OK and the length 0 on entry.
+ */
+static void cmd_get_event( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_events( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_version( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_reset( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_factory_reset( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_reset_charge( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_charge( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_tx_power_offset( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_tx_power_offset( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_test( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_firmware( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_time( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_status( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_alarm_timer( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_not_implemented( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_joineui( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_joineui( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_deveui( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_deveui( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_nwkkey( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_class( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_class( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_multicast( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_region( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_region( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_list_region( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_adr_profile( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_adr_profile( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_dm_port( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_dm_port( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_dm_info_interval( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_dm_info_interval( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_dm_info_fields( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_dm_info_fields( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_send_dm_status( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_app_status( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_join( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_leave_network( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_suspend_modem_comm( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_next_tx_max_payload( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_request_tx( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_emergency_tx( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_upload_init( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_upload_data( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_upload_start( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_stream_init( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_send_stream_data( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_stream_status( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_baudrate( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_baudrate( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_rp_stats( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+#if defined( PERF_TEST_ENABLED )
+static void cmd_get_perf_trace( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_perf_latency( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_rp_trace( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_energy( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_irq_stats( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+#endif
+static void cmd_batch( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_dm_delta( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_ram_usage( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_ranging_start( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_ranging_stop( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_ranging_result( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_ble_beacon_start( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_ble_beacon_stop( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_request_time_sync( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_tx_slot( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_event_push( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static bool cmd_raw_radio_params_get( const uint8_t* in, raw_radio_params_t* params );
+static void cmd_raw_radio_tx( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_raw_radio_rx( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_raw_radio_abort( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_get_radio_free_window( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_relay_start( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_relay_stop( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_channel_scan_start( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_channel_scan_stop( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+static void cmd_set_port_qos( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output );
+
+/*!
+ * Handlers of the test mode commands, see host_cmd_test_table
+ */
+static void cmd_tst_start( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_nop( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_tx_single( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_tx_cont( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_tx_hop( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_tx_cw( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_rx_cont( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_not_implemented( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_radio_reset( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_spi( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_exit( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_radio_read( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_radio_write( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+#ifdef LORAWAN_BYPASS_ENABLED
+static void cmd_tst_stream_bypass( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_stream_get( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_stream_downlink( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+#endif  // LORAWAN_BYPASS_ENABLED
+static void cmd_tst_per_tx( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_per_rx( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_per_result( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_sweep( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+static void cmd_tst_sweep_result( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/* clang-format off */
+static const cmd_entry_t host_cmd_table[CMD_MAX] = {
+    // [CMD_xxx]              = { len_min, len_max, handler }
+    [CMD_GETEVENT]            = { 0, 0, cmd_get_event },
+    [CMD_GETVERSION]          = { 0, 0, cmd_get_version },
+    [CMD_RESET]               = { 0, 0, cmd_reset },
+    [CMD_FACTORYRESET]        = { 0, 0, cmd_factory_reset },
+    [CMD_RESETCHARGE]         = { 0, 0, cmd_reset_charge },
+    [CMD_GETCHARGE]           = { 0, 0, cmd_get_charge },
+    [CMD_GETTXPOWOFF]         = { 0, 0, cmd_get_tx_power_offset },
+    [CMD_SETTXPOWOFF]         = { 1, 1, cmd_set_tx_power_offset },
+    [CMD_TEST]                = { 1, 255, cmd_test },
+    [CMD_FIRMWARE]            = { 7, 134, cmd_firmware },
+    [CMD_GETTIME]             = { 0, 0, cmd_get_time },
+    [CMD_GETSTATUS]           = { 0, 0, cmd_get_status },
+    [CMD_SETALARMTIMER]       = { 4, 4, cmd_set_alarm_timer },
+    [CMD_GETTRACE]            = { 0, 0, cmd_not_implemented },  // TODO size must be not 0
+    [CMD_GETPIN]              = { 0, 0, cmd_not_implemented },
+    [CMD_GETCHIPEUI]          = { 0, 0, cmd_not_implemented },
+    [CMD_GETJOINEUI]          = { 0, 0, cmd_get_joineui },
+    [CMD_SETJOINEUI]          = { 8, 8, cmd_set_joineui },
+    [CMD_GETDEVEUI]           = { 0, 0, cmd_get_deveui },
+    [CMD_SETDEVEUI]           = { 8, 8, cmd_set_deveui },
+    [CMD_SETNWKKEY]           = { 16, 16, cmd_set_nwkkey },
+    [CMD_GETCLASS]            = { 0, 0, cmd_get_class },
+    [CMD_SETCLASS]            = { 1, 1, cmd_set_class },
+    [CMD_SETMULTICAST]        = { 1, 37, cmd_set_multicast },
+    [CMD_GETREGION]           = { 0, 0, cmd_get_region },
+    [CMD_SETREGION]           = { 1, 1, cmd_set_region },
+    [CMD_LISTREGION]          = { 0, 0, cmd_list_region },
+    [CMD_GETADRPROFILE]       = { 0, 0, cmd_get_adr_profile },
+    [CMD_SETADRPROFILE]       = { 1, 17, cmd_set_adr_profile },
+    [CMD_GETDMPORT]           = { 0, 0, cmd_get_dm_port },
+    [CMD_SETDMPORT]           = { 1, 1, cmd_set_dm_port },
+    [CMD_GETDMINFOINTERVAL]   = { 0, 0, cmd_get_dm_info_interval },
+    [CMD_SETDMINFOINTERVAL]   = { 1, 1, cmd_set_dm_info_interval },
+    [CMD_GETDMINFOFIELDS]     = { 0, 0, cmd_get_dm_info_fields },
+    [CMD_SETDMINFOFIELDS]     = { 0, e_inf_max, cmd_set_dm_info_fields },
+    [CMD_SENDDMSTATUS]        = { 0, e_inf_max, cmd_send_dm_status },
+    [CMD_SETAPPSTATUS]        = { 8, 8, cmd_set_app_status },
+    [CMD_JOIN]                = { 0, 0, cmd_join },
+    [CMD_LEAVENETWORK]        = { 0, 0, cmd_leave_network },
+    [CMD_SUSPENDMODEMCOMM]    = { 1, 1, cmd_suspend_modem_comm },
+    [CMD_GETNEXTTXMAXPAYLOAD] = { 0, 0, cmd_get_next_tx_max_payload },
+    [CMD_REQUESTTX]           = { 2, 244, cmd_request_tx },
+    [CMD_EMERGENCYTX]         = { 1, 244, cmd_emergency_tx },
+    [CMD_UPLOADINIT]          = { 6, 6, cmd_upload_init },
+    [CMD_UPLOADDATA]          = { 0, 255, cmd_upload_data },
+    [CMD_UPLOADSTART]         = { 4, 4, cmd_upload_start },
+    [CMD_STREAMINIT]          = { 1, 2, cmd_stream_init },
+    [CMD_SENDSTREAMDATA]      = { 1, 255, cmd_send_stream_data },
+    [CMD_STREAMSTATUS]        = { 1, 1, cmd_stream_status },
+    [CMD_GETBAUDRATE]         = { 0, 0, cmd_get_baudrate },
+    [CMD_SETBAUDRATE]         = { 1, 1, cmd_set_baudrate },
+    [CMD_GETRPSTATS]          = { 0, 0, cmd_get_rp_stats },
+#if defined( PERF_TEST_ENABLED )
+    [CMD_GETPERFTRACE]        = { 0, 0, cmd_get_perf_trace },
+    [CMD_GETPERFLATENCY]      = { 0, 0, cmd_get_perf_latency },
+    [CMD_GETRPTRACE]          = { 0, 0, cmd_get_rp_trace },
+#else
+    [CMD_GETPERFTRACE]        = { 0, 0, cmd_not_implemented },
+    [CMD_GETPERFLATENCY]      = { 0, 0, cmd_not_implemented },
+    [CMD_GETRPTRACE]          = { 0, 0, cmd_not_implemented },
+#endif
+    [CMD_GETEVENTS]           = { 0, 0, cmd_get_events },
+    [CMD_BATCH]               = { 2, 255, cmd_batch },
+    [CMD_SETDMDELTA]          = { 1, 1 + ( 3 * e_inf_max ), cmd_set_dm_delta },
+    [CMD_GETRAMUSAGE]         = { 0, 0, cmd_get_ram_usage },
+    [CMD_RANGINGSTART]        = { 14, 14, cmd_ranging_start },
+    [CMD_RANGINGSTOP]         = { 0, 0, cmd_ranging_stop },
+    [CMD_GETRANGINGRESULT]    = { 4, 4, cmd_get_ranging_result },
+    [CMD_BLEBEACONSTART]      = { 9, 9 + BLE_BEACON_ADV_DATA_MAX, cmd_ble_beacon_start },
+    [CMD_BLEBEACONSTOP]       = { 0, 0, cmd_ble_beacon_stop },
+    [CMD_REQUESTTIMESYNC]     = { 0, 0, cmd_request_time_sync },
+    [CMD_SETTXSLOT]           = { 4, 4, cmd_set_tx_slot },
+    [CMD_SETEVENTPUSH]        = { 1, 1, cmd_set_event_push },
+    [CMD_RAWRADIOTX]          = { 16, 255, cmd_raw_radio_tx },
+    [CMD_RAWRADIORX]          = { 19, 19, cmd_raw_radio_rx },
+    [CMD_RAWRADIOABORT]       = { 0, 0, cmd_raw_radio_abort },
+    [CMD_GETRADIOFREEWINDOW]  = { 4, 4, cmd_get_radio_free_window },
+    [CMD_RELAYSTART]          = { 13, 13, cmd_relay_start },
+    [CMD_RELAYSTOP]           = { 0, 0, cmd_relay_stop },
+    [CMD_CHANNELSCANSTART]    = { 6, 6, cmd_channel_scan_start },
+    [CMD_CHANNELSCANSTOP]     = { 0, 0, cmd_channel_scan_stop },
+#if defined( PERF_TEST_ENABLED )
+    [CMD_GETENERGY]           = { 0, 0, cmd_get_energy },
+#else
+    [CMD_GETENERGY]           = { 0, 0, cmd_not_implemented },
+#endif
+    [CMD_SETPORTQOS]          = { 1, 6, cmd_set_port_qos },
+#if defined( PERF_TEST_ENABLED )
+    [CMD_GETIRQSTATS]         = { 0, 0, cmd_get_irq_stats },
+#else
+    [CMD_GETIRQSTATS]         = { 0, 0, cmd_not_implemented },
+#endif
+};
+
+static const cmd_tst_entry_t host_cmd_test_table[CMD_TST_MAX] = {
+    // [CMD_TST_xxx]          = { len_min, len_max, handler }
+    [CMD_TST_START]           = { 8, 8, cmd_tst_start },
+    [CMD_TST_NOP]             = { 0, 0, cmd_tst_nop },
+    [CMD_TST_TX_SINGLE]       = { 9, 9, cmd_tst_tx_single },
+    [CMD_TST_TX_CONT]         = { 9, 9, cmd_tst_tx_cont },
+    [CMD_TST_TX_HOP]          = { 6, 6, cmd_tst_tx_hop },                // power, sf, bw, cr, dwell [ms]
+    [CMD_TST_NA_1]            = { 0, 0, NULL },
+    [CMD_TST_TX_CW]           = { 5, 5, cmd_tst_tx_cw },
+    [CMD_TST_RX_CONT]         = { 7, 7, cmd_tst_rx_cont },
+    [CMD_TST_RSSI]            = { 7, 7, cmd_tst_not_implemented },
+    [CMD_TST_RADIO_RST]       = { 0, 0, cmd_tst_radio_reset },
+    [CMD_TST_SPI]             = { 1, 255, cmd_tst_spi },                 // test_mode_spi_sub_cmd_t, parameters
+    [CMD_TST_EXIT]            = { 0, 0, cmd_tst_exit },
+    [CMD_TST_BUSYLOOP]        = { 0, 0, cmd_tst_not_implemented },
+    [CMD_TST_PANIC]           = { 0, 0, cmd_tst_not_implemented },
+    [CMD_TST_WATCHDOG]        = { 0, 0, cmd_tst_not_implemented },
+    [CMD_TST_RADIO_READ]      = { 0, 255, cmd_tst_radio_read },
+    [CMD_TST_RADIO_WRITE]     = { 0, 255, cmd_tst_radio_write },
+#ifdef LORAWAN_BYPASS_ENABLED
+    [CMD_TST_STREAM_BYPASS]   = { 1, 1, cmd_tst_stream_bypass },         // Enable or disable LORAWAN BYPASS
+    [CMD_TST_STREAM_GET]      = { 5, 5, cmd_tst_stream_get },            // Get next frame when LORAWAN BYPASS is
+                                                                         // enabled. Param: uint8_t length,
+                                                                         // uint32_t frag_cnt
+    [CMD_TST_STREAM_DOWNLINK] = { 1, 255, cmd_tst_stream_downlink },     // Give downlink when LORAWAN BYPASS is
+                                                                         // enabled
+#endif  // LORAWAN_BYPASS_ENABLED
+    [CMD_TST_PER_TX]          = { 13, 13, cmd_tst_per_tx },              // frequency, power, sf, bw, cr, length,
+                                                                         // packet number, gap [ms]
+    [CMD_TST_PER_RX]          = { 10, 10, cmd_tst_per_rx },              // frequency, sf, bw, cr, length, packet nb
+    [CMD_TST_PER_RESULT]      = { 0, 0, cmd_tst_per_result },
+    [CMD_TST_SWEEP_TX]        = { 14, 14, cmd_tst_sweep },               // frequency, sf mask, bw mask, cr, power
+                                                                         // min, max and step, length, packets
+    [CMD_TST_SWEEP_RX]        = { 14, 14, cmd_tst_sweep },               // same parameters as the transmitter
+    [CMD_TST_SWEEP_RESULT]    = { 1, 1, cmd_tst_sweep_result },          // first step
+};
+/* clang-format on */
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -173,8 +500,6 @@ static e_parse_error_t cmd_test_parser( s_cmd_tst_input_t* cmd_tst_input, s_cmd_
 
 e_parse_error_t parse_cmd( s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
 {
-    e_parse_error_t ret = PARSE_OK;
-
     if( cmd_input->cmd_code >= CMD_MAX )
     {
         BSP_DBG_TRACE_ERROR( "Unknown command (0x%x)\n", cmd_input->cmd_code );
@@ -194,7 +519,9 @@ e_parse_error_t parse_cmd( s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_outpu
         return PARSE_ERROR;
     }
 
-    if( CheckCmdSize( cmd_input, cmd_output ) == CMD_LENGTH_NOT_VALID )
+    const cmd_entry_t* entry = &host_cmd_table[cmd_input->cmd_code];
+
+    if( cmd_check_length( cmd_input->length, entry->length_min, entry->length_max ) == CMD_LENGTH_NOT_VALID )
     {
         cmd_output->return_code = RC_BAD_SIZE;
         cmd_output->length      = 0;
@@ -204,302 +531,20 @@ e_parse_error_t parse_cmd( s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_outpu
     cmd_output->length      = 0;
 
     BSP_DBG_TRACE_WARNING( "CMD_%s (0x%02x)\n", HostCmdStr[cmd_input->cmd_code], cmd_input->cmd_code );
-    switch( cmd_input->cmd_code )
+    if( entry->handler != NULL )
     {
-    case CMD_GETEVENT: {
-        uint8_t event_data_length      = 0;
-        uint8_t asynchronous_msgnumber = 0;
-
-        cmd_output->return_code =
-            modem_get_event( &cmd_output->buffer[0], &cmd_output->buffer[1], &cmd_output->buffer[2], &event_data_length,
-                             &asynchronous_msgnumber );
-        if( asynchronous_msgnumber > 0 )
-        {
-            cmd_output->length = event_data_length + 2;
-        }
-        else
-        {
-            // ie asynchronous_msgnumber == 0
-            // de-assert hw_modem irq line to indicate host that all events have been retrieved
-            bsp_gpio_set_value( HW_MODEM_EVENT_PIN, 0 );
-        }
-
-        break;
-    }
-    case CMD_GETVERSION: {
-        uint32_t bootloader;
-        uint32_t firmware;
-        uint16_t lorawan;
-
-        cmd_output->return_code = modem_get_version( &bootloader, &firmware, &lorawan );
-
-        // Bootloader version
-        cmd_output->buffer[0] = ( bootloader >> 24 ) & 0xff;
-        cmd_output->buffer[1] = ( bootloader >> 16 ) & 0xff;
-        cmd_output->buffer[2] = ( bootloader >> 8 ) & 0xff;
-        cmd_output->buffer[3] = ( bootloader & 0xff );
-        // Firmware version
-        cmd_output->buffer[4] = ( firmware >> 24 ) & 0xff;
-        cmd_output->buffer[5] = ( firmware >> 16 ) & 0xff;
-        cmd_output->buffer[6] = ( firmware >> 8 ) & 0xff;
-        cmd_output->buffer[7] = ( firmware & 0xff );
-        // LoRaWAN version 1.0.3 (BCD)
-        cmd_output->buffer[8] = lorawan >> 8;
-        cmd_output->buffer[9] = lorawan;
-
-        cmd_output->length = 10;
-        break;
-    }
-    case CMD_RESET:  //@todo save the reset counter inside the eeprom
-                     //  lorawan_api_context_load( );  // may be should be manage by a mcu interface not inside the
-                     //  stack?
-        cmd_output->return_code = modem_reset( );
-
-        break;
-    case CMD_FACTORYRESET:  //@todo save the reset counter inside the eeprom
-        cmd_output->return_code = modem_factory_reset( );
-        break;
-    case CMD_RESETCHARGE:
-        cmd_output->return_code = modem_reset_charge( );
-        break;
-    case CMD_GETCHARGE: {
-        uint32_t charge         = 0;
-        cmd_output->return_code = modem_get_charge( &charge );
-        cmd_output->buffer[0]   = ( charge >> 24 ) & 0xFF;
-        cmd_output->buffer[1]   = ( charge >> 16 ) & 0xFF;
-        cmd_output->buffer[2]   = ( charge >> 8 ) & 0xFF;
-        cmd_output->buffer[3]   = ( charge & 0xFF );
-
-        cmd_output->length = 4;
-        break;
-    }
-    case CMD_GETTXPOWOFF: {
-        int8_t tmp              = 0;
-        cmd_output->return_code = modem_get_tx_power_offset( &tmp );
-        cmd_output->buffer[0]   = tmp;
-        cmd_output->length      = 1;
-        break;
-    }
-    case CMD_SETTXPOWOFF:
-        cmd_output->return_code = modem_set_tx_power_offset( cmd_input->buffer[0] );
-        break;
-    case CMD_FIRMWARE:  // Write FW update
-        cmd_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_output->length      = 0;
-        break;
-    case CMD_GETTIME:
-        cmd_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_output->length      = 0;
-        break;
-    case CMD_GETSTATUS:
-        cmd_output->return_code = modem_get_status( &cmd_output->buffer[0] );
-        cmd_output->length      = 1;
-        break;
-    case CMD_SETALARMTIMER: {
-        uint32_t alarm = 0;
-        alarm |= cmd_input->buffer[0] << 24;
-        alarm |= cmd_input->buffer[1] << 16;
-        alarm |= cmd_input->buffer[2] << 8;
-        alarm |= cmd_input->buffer[3];
-
-        cmd_output->return_code = modem_set_alarm_timer_s( alarm );
-        break;
-    }
-    case CMD_GETTRACE:
-        cmd_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_output->length      = 0;
-        break;
-    case CMD_GETPIN:
-        cmd_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_output->length      = 0;
-        break;
-    case CMD_GETCHIPEUI:
-        cmd_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_output->length      = 0;
-        break;
-    case CMD_GETJOINEUI:
-        cmd_output->return_code = modem_get_joineui( &cmd_output->buffer[0] );
-        cmd_output->length      = 8;
-        break;
-    case CMD_SETJOINEUI:
-        cmd_output->return_code = modem_set_joineui( &cmd_input->buffer[0] );
-        break;
-    case CMD_GETDEVEUI:
-        cmd_output->return_code = modem_get_deveui( &cmd_output->buffer[0] );
-        cmd_output->length      = 8;
-        break;
-    case CMD_SETDEVEUI:
-        cmd_output->return_code = modem_set_deveui( &cmd_input->buffer[0] );
-        break;
-    case CMD_SETNWKKEY:  // same as CMD_SETAPPKEY,  @todo nwk key and app key !!!!
-        cmd_output->return_code = modem_set_nwkkey( &cmd_input->buffer[0] );
-        break;
-    case CMD_GETCLASS:
-        cmd_output->return_code = modem_get_class( &cmd_output->buffer[0] );
-        cmd_output->length      = 1;
-        break;
-    case CMD_SETCLASS:
-        cmd_output->return_code = modem_set_class( cmd_input->buffer[0] );
-        break;
-    case CMD_SETMULTICAST:
-        cmd_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_output->length      = 0;
-        break;
-    case CMD_GETREGION:
-        cmd_output->return_code = modem_get_region( &cmd_output->buffer[0] );
-        cmd_output->length      = 1;
-        break;
-    case CMD_SETREGION:
-        cmd_output->return_code = modem_set_region( cmd_input->buffer[0] );
-        break;
-    case CMD_LISTREGION:  // 2.4GHZ modem support only one region
-        cmd_output->return_code = modem_list_region( &cmd_output->buffer[0], &cmd_output->length );
-        break;
-    case CMD_GETADRPROFILE:
-        cmd_output->return_code = modem_get_adr_profile( &cmd_output->buffer[0] );
-        cmd_output->length      = 1;
-        break;
-    case CMD_SETADRPROFILE:
-        cmd_output->return_code = modem_set_adr_profile( cmd_input->buffer[0], &cmd_input->buffer[1] );
-        break;
-    case CMD_GETDMPORT:
-        cmd_output->return_code = modem_get_dm_port( &cmd_output->buffer[0] );
-        cmd_output->length      = 1;
-        break;
-    case CMD_SETDMPORT:
-        cmd_output->return_code = modem_set_dm_port( cmd_input->buffer[0] );
-        break;
-    case CMD_GETDMINFOINTERVAL:
-        cmd_output->return_code = modem_get_dm_info_interval( &cmd_output->buffer[0] );
-        cmd_output->length      = 1;
-        break;
-    case CMD_SETDMINFOINTERVAL:
-        cmd_output->return_code = modem_set_dm_info_interval( cmd_input->buffer[0] );
-        break;
-    case CMD_GETDMINFOFIELDS:
-        cmd_output->return_code = modem_get_dm_info_fields( &cmd_output->buffer[0], &cmd_output->length );
-        break;
-    case CMD_SETDMINFOFIELDS:
-        cmd_output->return_code = modem_set_dm_info_fields( &cmd_input->buffer[0], cmd_input->length );
-        break;
-    case CMD_SENDDMSTATUS:
-        cmd_output->return_code = modem_send_dm_status( &cmd_input->buffer[0], cmd_input->length );
-        break;
-    case CMD_SETAPPSTATUS:
-        cmd_output->return_code = modem_set_app_status( &cmd_input->buffer[0], cmd_input->length );
-        break;
-    case CMD_JOIN:
-        cmd_output->return_code = modem_join( );
-        break;
-    case CMD_LEAVENETWORK:
-        cmd_output->return_code = modem_leave_network( );
-        break;
-    case CMD_SUSPENDMODEMCOMM:
-        cmd_output->return_code = modem_suspend_modem_comm( cmd_input->buffer[0] );
-        break;
-    case CMD_GETNEXTTXMAXPAYLOAD:
-        cmd_output->return_code = modem_get_next_tx_max_payload( &cmd_output->buffer[0] );
-        if( cmd_output->return_code == RC_OK )
-        {
-            cmd_output->length = 1;
-        }
-        break;
-    case CMD_REQUESTTX:
-        cmd_output->return_code = modem_request_tx( cmd_input->buffer[0], cmd_input->buffer[1], &cmd_input->buffer[2],
-                                                    cmd_input->length - 2 );
-        break;
-    case CMD_EMERGENCYTX:
-        cmd_output->return_code = modem_emergency_tx( cmd_input->buffer[0], cmd_input->buffer[1], &cmd_input->buffer[2],
-                                                      cmd_input->length - 2 );
-        break;
-    case CMD_UPLOADINIT: {
-        uint16_t size          = 0;
-        uint16_t average_delay = 0;
-
-        size = cmd_input->buffer[2] << 8;
-        size |= cmd_input->buffer[3];
-
-        average_delay = cmd_input->buffer[4] << 8;
-        average_delay |= cmd_input->buffer[5];
-
-        file_size = size;
-
-        upload_current_size = 0;
-        if( file_size > BSP_FILE_UPLOAD_MAX_SIZE )
-        {
-            cmd_output->return_code = RC_FAIL;
-        }
-        else
-        {
-            cmd_output->return_code =
-                modem_upload_init( cmd_input->buffer[0], cmd_input->buffer[1], size, average_delay );
-        }
-        break;
-    }
-    case CMD_UPLOADDATA:
-        cmd_output->return_code = upload_data( &cmd_input->buffer[0], cmd_input->length, file_store );
-        break;
-    case CMD_UPLOADSTART: {
-        uint32_t input_crc = 0;
-        input_crc |= cmd_input->buffer[0] << 24;
-        input_crc |= cmd_input->buffer[1] << 16;
-        input_crc |= cmd_input->buffer[2] << 8;
-        input_crc |= cmd_input->buffer[3];
-
-        if( file_size != upload_current_size )
-        {
-            cmd_output->return_code = RC_BAD_SIZE;
-            BSP_DBG_TRACE_ERROR( "RC_BAD_SIZE in FileUpload\n" );
-        }
-        else if( input_crc != crc( file_store, file_size ) )
-        {
-            cmd_output->return_code = RC_BAD_CRC;
-            BSP_DBG_TRACE_ERROR( "RC_BAD_CRC in FileUpload\n" );
-        }
-        else
-        {
-            cmd_output->return_code = modem_upload_start( file_store, file_size );
-        }
-        break;
-    }
-    case CMD_STREAMINIT:
-        cmd_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_output->length      = 0;
-        break;
-    case CMD_SENDSTREAMDATA:
-        cmd_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_output->length      = 0;
-        break;
-    case CMD_STREAMSTATUS:
-        cmd_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_output->length      = 0;
-        break;
-    case CMD_TEST: {
-        s_cmd_tst_input_t    cmd_tst_input;
-        s_cmd_tst_response_t cmd_tst_output;
-
-        cmd_tst_input.cmd_code = ( host_cmd_test_t ) cmd_input->buffer[0];
-        cmd_tst_input.length   = cmd_input->length - 1;
-        cmd_tst_input.buffer   = &cmd_input->buffer[1];
-        cmd_tst_output.buffer  = &cmd_output->buffer[0];
-
-        ret = cmd_test_parser( &cmd_tst_input, &cmd_tst_output );
-
-        cmd_output->return_code = cmd_tst_output.return_code;
-        cmd_output->length      = cmd_tst_output.length;
-        break;
+        entry->handler( cmd_input, cmd_output );
     }
-    default:
+    else
+    {
         cmd_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_output->length      = 0;
-        ret                     = PARSE_ERROR;
-        break;
     }
+
     // BSP_DBG_TRACE_ARRAY ("cmd output", cmd_output->buffer, cmd_output->length);
     cmd_input->cmd_code = CMD_MAX;
     cmd_input->length   = 0;
 
-    return ret;
+    return PARSE_OK;
 }
 
 /*
@@ -507,16 +552,16 @@ e_parse_error_t parse_cmd( s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_outpu
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
-cmd_length_valid_t CheckCmdSize( s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+static cmd_length_valid_t cmd_check_length( uint8_t length, uint8_t length_min, uint8_t length_max )
 {
     // cmd len too small
-    if( cmd_input->length < host_cmd_len[cmd_input->cmd_code][0] )
+    if( length < length_min )
     {
         BSP_DBG_TRACE_ERROR( "Invalid command size (too small)\n" );
         return CMD_LENGTH_NOT_VALID;
     }
     // cmd len too long
-    if( cmd_input->length > host_cmd_len[cmd_input->cmd_code][1] )
+    if( length > length_max )
     {
         BSP_DBG_TRACE_ERROR( "Invalid command size (too long)\n" );
         return CMD_LENGTH_NOT_VALID;
@@ -524,258 +569,1059 @@ cmd_length_valid_t CheckCmdSize( s_cmd_input_t* cmd_input, s_cmd_response_t* cmd
     return CMD_LENGTH_VALID;
 }
 
-cmd_length_valid_t cmd_test_parser_check_cmd_size( host_cmd_test_t tst_id, uint8_t length )
+static inline uint16_t cmd_get_u16( const uint8_t* buffer )
 {
-    // cmd len too small
-    if( length < host_cmd_test_len[tst_id][0] )
+    return ( ( uint16_t ) buffer[0] << 8 ) | buffer[1];
+}
+
+static inline uint32_t cmd_get_u32( const uint8_t* buffer )
+{
+    return ( ( uint32_t ) buffer[0] << 24 ) | ( ( uint32_t ) buffer[1] << 16 ) | ( ( uint32_t ) buffer[2] << 8 ) |
+           buffer[3];
+}
+
+static void cmd_get_event( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    modem_rsp_event_t type                   = RSP_NUMBER;
+    uint8_t           event_data_length      = 0;
+    uint8_t           asynchronous_msgnumber = 0;
+
+    // the event type is an enum, it is narrowed to its byte once the event data are copied behind it
+    cmd_output->return_code = modem_get_event( &type, &cmd_output->buffer[1], &cmd_output->buffer[2],
+                                               &event_data_length, &asynchronous_msgnumber );
+    cmd_output->buffer[0] = type;
+    if( asynchronous_msgnumber > 0 )
     {
-        BSP_DBG_TRACE_ERROR( "Invalid command test size (too small)\n" );
-        return CMD_LENGTH_NOT_VALID;
+        cmd_output->length = event_data_length + 2;
     }
-    // cmd len too long
-    if( length > host_cmd_test_len[tst_id][1] )
+    else
     {
-        BSP_DBG_TRACE_ERROR( "Invalid command test size (too long)\n" );
-        return CMD_LENGTH_NOT_VALID;
+        // ie asynchronous_msgnumber == 0
+        // de-assert hw_modem irq line to indicate host that all events have been retrieved
+        bsp_gpio_set_value( HW_MODEM_EVENT_PIN, 0 );
     }
-    return CMD_LENGTH_VALID;
 }
 
-static e_parse_error_t cmd_test_parser( s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+static void cmd_get_events( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
 {
-    if( test_mode_enabled_is( ) == false && cmd_tst_input->cmd_code != CMD_TST_START )
-    {
-        BSP_DBG_TRACE_ERROR( "Command not valid, test mode not started\n" );
-        cmd_tst_output->return_code = RC_INVALID;
-        cmd_tst_output->length      = 0;
-        return PARSE_ERROR;
-    }
+    uint8_t asynchronous_msgnumber = 0;
 
-    if( cmd_tst_input->cmd_code >= CMD_TST_MAX )
+    // the response length is on one byte, the events left over are read by the next command
+    cmd_output->return_code =
+        modem_get_events( &cmd_output->buffer[0], UINT8_MAX, &cmd_output->length, &asynchronous_msgnumber );
+    if( asynchronous_msgnumber == 0 )
     {
-        BSP_DBG_TRACE_ERROR( "Unknown command test (0x%x)\n", cmd_tst_input->cmd_code );
-        cmd_tst_output->return_code = RC_INVALID;
-        cmd_tst_output->length      = 0;
-        return PARSE_ERROR;
+        // de-assert hw_modem irq line to indicate host that all events have been retrieved
+        bsp_gpio_set_value( HW_MODEM_EVENT_PIN, 0 );
     }
+}
 
-    if( cmd_test_parser_check_cmd_size( cmd_tst_input->cmd_code, cmd_tst_input->length ) == CMD_LENGTH_NOT_VALID )
-    {
-        BSP_DBG_TRACE_ERROR( "Invalid size command test (0x%x)\n", cmd_tst_input->cmd_code );
-        cmd_tst_output->return_code = RC_BAD_SIZE;
-        cmd_tst_output->length      = 0;
-        return PARSE_ERROR;
-    }
+static void cmd_get_version( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    uint32_t bootloader;
+    uint32_t firmware;
+    uint16_t lorawan;
 
-    cmd_tst_output->return_code = RC_OK;  // by default the return code is ok and length is 0
-    cmd_tst_output->length      = 0;
+    cmd_output->return_code = modem_get_version( &bootloader, &firmware, &lorawan );
 
-#if BSP_DBG_TRACE == BSP_FEATURE_ON
-    BSP_DBG_TRACE_WARNING( "\tCMD_TST_%s (0x%02x)\n", host_cmd_test_str[cmd_tst_input->cmd_code],
-                           cmd_tst_input->cmd_code );
-#endif
-    switch( cmd_tst_input->cmd_code )
-    {
-    case CMD_TST_START:
+    // Bootloader version
+    cmd_output->buffer[0] = ( bootloader >> 24 ) & 0xff;
+    cmd_output->buffer[1] = ( bootloader >> 16 ) & 0xff;
+    cmd_output->buffer[2] = ( bootloader >> 8 ) & 0xff;
+    cmd_output->buffer[3] = ( bootloader & 0xff );
+    // Firmware version
+    cmd_output->buffer[4] = ( firmware >> 24 ) & 0xff;
+    cmd_output->buffer[5] = ( firmware >> 16 ) & 0xff;
+    cmd_output->buffer[6] = ( firmware >> 8 ) & 0xff;
+    cmd_output->buffer[7] = ( firmware & 0xff );
+    // LoRaWAN version 1.0.3 (BCD)
+    cmd_output->buffer[8] = lorawan >> 8;
+    cmd_output->buffer[9] = lorawan;
 
-        if( get_join_state( ) != MODEM_NOT_JOINED )
-        {
-            BSP_DBG_TRACE_ERROR( "TST MODE: not available if joined\n" );
-            cmd_tst_output->return_code = RC_FAIL;
-        }
-        else if( strncmp( ( char* ) cmd_tst_input->buffer, "TESTTEST", 8 ) == 0 )
-        {
-            cmd_tst_output->return_code = test_mode_start( );
-        }
-        else
-        {
-            BSP_DBG_TRACE_ERROR( "TST MODE: invalid enablement payload\n" );
-            cmd_tst_output->return_code = RC_INVALID;
-        }
+    cmd_output->length = 10;
+}
 
-        break;
-    case CMD_TST_NOP:
-        cmd_tst_output->return_code = test_mode_nop( );
-        break;
-    case CMD_TST_TX_SINGLE: {
-        uint32_t frequency = 0;
-        frequency |= cmd_tst_input->buffer[0] << 24;
-        frequency |= cmd_tst_input->buffer[1] << 16;
-        frequency |= cmd_tst_input->buffer[2] << 8;
-        frequency |= cmd_tst_input->buffer[3];
-
-        cmd_tst_output->return_code =
-            test_mode_tx( frequency, cmd_tst_input->buffer[4], cmd_tst_input->buffer[5], cmd_tst_input->buffer[6],
-                          cmd_tst_input->buffer[7], cmd_tst_input->buffer[8], TEST_MODE_TX_SINGLE );
-        break;
-    }
-    case CMD_TST_TX_CONT: {
-        uint32_t frequency = 0;
-        frequency |= cmd_tst_input->buffer[0] << 24;
-        frequency |= cmd_tst_input->buffer[1] << 16;
-        frequency |= cmd_tst_input->buffer[2] << 8;
-        frequency |= cmd_tst_input->buffer[3];
-
-        cmd_tst_output->return_code =
-            test_mode_tx( frequency, cmd_tst_input->buffer[4], cmd_tst_input->buffer[5], cmd_tst_input->buffer[6],
-                          cmd_tst_input->buffer[7], cmd_tst_input->buffer[8], TEST_MODE_TX_CONTINUE );
-        break;
-    }
-    case CMD_TST_TX_HOP:
-        cmd_tst_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_tst_output->length      = 0;
-        break;
-    case CMD_TST_TX_CW: {
-        uint32_t frequency = 0;
-        frequency |= cmd_tst_input->buffer[0] << 24;
-        frequency |= cmd_tst_input->buffer[1] << 16;
-        frequency |= cmd_tst_input->buffer[2] << 8;
-        frequency |= cmd_tst_input->buffer[3];
-
-        cmd_tst_output->return_code = test_mode_cw( frequency, cmd_tst_input->buffer[4] );
-        break;
-    }
-    case CMD_TST_RX_CONT: {
-        uint32_t frequency = 0;
-        frequency |= cmd_tst_input->buffer[0] << 24;
-        frequency |= cmd_tst_input->buffer[1] << 16;
-        frequency |= cmd_tst_input->buffer[2] << 8;
-        frequency |= cmd_tst_input->buffer[3];
-
-        cmd_tst_output->return_code = test_mode_rx_cont( frequency, cmd_tst_input->buffer[4], cmd_tst_input->buffer[5],
-                                                         cmd_tst_input->buffer[6] );
-        break;
-    }
-    case CMD_TST_RSSI:
-        cmd_tst_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_tst_output->length      = 0;
-        break;
-    case CMD_TST_RADIO_RST:
-        cmd_tst_output->return_code = test_mode_radio_reset( );
-        break;
-    case CMD_TST_SPI:
-        cmd_tst_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_tst_output->length      = 0;
-        break;
-    case CMD_TST_EXIT:
-        cmd_tst_output->return_code = test_mode_exit( );
-        break;
-    case CMD_TST_BUSYLOOP:
-        cmd_tst_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_tst_output->length      = 0;
-        break;
-    case CMD_TST_PANIC:
-        cmd_tst_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_tst_output->length      = 0;
-        break;
-    case CMD_TST_WATCHDOG:
-        cmd_tst_output->return_code = RC_NOT_IMPLEMENTED;
-        cmd_tst_output->length      = 0;
-        break;
-    case CMD_TST_RADIO_READ: {
-        uint8_t command_length = cmd_tst_input->buffer[0];
-        uint8_t command[255]   = { 0 };
-        memcpy( command, &cmd_tst_input->buffer[1], command_length );
+static void cmd_reset( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    //@todo save the reset counter inside the eeprom
+    //  lorawan_api_context_load( );  // may be should be manage by a mcu interface not inside the stack?
+    cmd_output->return_code = modem_reset( );
+}
 
-        uint8_t data_length = cmd_tst_input->buffer[command_length + 1];
-        uint8_t data[255]   = { 0 };
+static void cmd_factory_reset( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    //@todo save the reset counter inside the eeprom
+    cmd_output->return_code = modem_factory_reset( );
+}
 
-        cmd_tst_output->return_code = test_mode_radio_read( command, command_length, data, data_length );
-        memcpy( cmd_tst_output->buffer, data, data_length );
-        cmd_tst_output->length = data_length;
-        break;
-    }
-    case CMD_TST_RADIO_WRITE: {
-        uint8_t command_length = cmd_tst_input->buffer[0];
-        uint8_t command[255]   = { 0 };
-        memcpy( command, &cmd_tst_input->buffer[1], command_length );
+static void cmd_reset_charge( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_reset_charge( );
+}
 
-        uint8_t data_length = cmd_tst_input->buffer[command_length + 1];
-        uint8_t data[255]   = { 0 };
-        memcpy( data, &cmd_tst_input->buffer[command_length + 1], data_length );
+static void cmd_get_charge( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    uint32_t charge         = 0;
+    cmd_output->return_code = modem_get_charge( &charge );
+    cmd_output->buffer[0]   = ( charge >> 24 ) & 0xFF;
+    cmd_output->buffer[1]   = ( charge >> 16 ) & 0xFF;
+    cmd_output->buffer[2]   = ( charge >> 8 ) & 0xFF;
+    cmd_output->buffer[3]   = ( charge & 0xFF );
 
-        cmd_tst_output->return_code = test_mode_radio_write( command, command_length, data, data_length );
-        cmd_tst_output->length      = data_length;
-        break;
-    }
-#ifdef LORAWAN_BYPASS_ENABLED
-    case CMD_TST_STREAM_BYPASS: {
-        uint8_t enabled = cmd_tst_input->buffer[0];
-        if( enabled )
-        {
-            BSP_DBG_TRACE_INFO( "TST MODE: ENABLE STREAM BYPASS\n" );
-        }
-        else
-        {
-            BSP_DBG_TRACE_INFO( "TST MODE: DISABLE STREAM BYPASS\n" );
-        }
-        modem_stream_bypass_enable( enabled != 0 );
-        cmd_tst_output->return_code = RC_OK;
-        cmd_tst_output->length      = 0;
-    }
-    break;
-    case CMD_TST_STREAM_GET: {
-        uint8_t  len      = cmd_tst_input->buffer[0];
-        uint32_t frag_cnt = 0;
-        frag_cnt |= cmd_tst_input->buffer[1];
-        frag_cnt |= cmd_tst_input->buffer[2] << 8;
-        frag_cnt |= cmd_tst_input->buffer[3] << 16;
-        frag_cnt |= cmd_tst_input->buffer[4] << 24;
-        BSP_DBG_TRACE_PRINTF( "TST MODE: GET STREAM FRAGMENT %u %u\n", len, frag_cnt );
-        cmd_tst_output->return_code = modem_stream_bypass_get_fragment( cmd_tst_output->buffer, frag_cnt, &len );
-        cmd_tst_output->length      = len;
-    }
-    break;
-    case CMD_TST_STREAM_DOWNLINK: {
-        uint8_t* data = &( cmd_tst_input->buffer[0] );
-        BSP_DBG_TRACE_INFO( "TST MODE: STREAM DOWNLINK\n" );
-        cmd_tst_output->return_code = modem_stream_bypass_send_downlink( data, cmd_tst_input->length );
-        cmd_tst_output->length      = 0;
-    }
-    break;
-#endif  // LORAWAN_BYPASS_ENABLED
-    default:
-        cmd_tst_output->return_code = RC_UNKNOWN;
-        cmd_tst_output->length      = 0;
-        break;
-    }
+    cmd_output->length = 4;
+}
 
-    // Erase test command content to avoid twice calls
-    cmd_tst_input->cmd_code = CMD_TST_MAX;
-    cmd_tst_input->length   = 0;
+static void cmd_get_tx_power_offset( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    int8_t tmp              = 0;
+    cmd_output->return_code = modem_get_tx_power_offset( &tmp );
+    cmd_output->buffer[0]   = tmp;
+    cmd_output->length      = 1;
+}
 
-    return PARSE_OK;
+static void cmd_set_tx_power_offset( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_set_tx_power_offset( cmd_input->buffer[0] );
 }
 
-static modem_return_code_t upload_data( uint8_t* payload, uint8_t payload_length, uint8_t* file_strore )
+static void cmd_test( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
 {
-    modem_return_code_t return_code = RC_OK;
+    s_cmd_tst_input_t    cmd_tst_input;
+    s_cmd_tst_response_t cmd_tst_output;
+
+    cmd_tst_input.cmd_code = ( host_cmd_test_t ) cmd_input->buffer[0];
+    cmd_tst_input.length   = cmd_input->length - 1;
+    cmd_tst_input.buffer   = &cmd_input->buffer[1];
+    cmd_tst_output.buffer  = &cmd_output->buffer[0];
+
+    cmd_test_parser( &cmd_tst_input, &cmd_tst_output );
+
+    cmd_output->return_code = cmd_tst_output.return_code;
+    cmd_output->length      = cmd_tst_output.length;
+}
+
+static void cmd_firmware( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // block index and CRC-32 of the data, big endian, then the block data
+    const uint8_t* in         = cmd_input->buffer;
+    uint16_t       next_block = 0;
+
+    cmd_output->return_code = modem_fw_update_block( cmd_get_u16( &in[0] ), &in[6], cmd_input->length - 6,
+                                                     cmd_get_u32( &in[2] ), &next_block );
+    cmd_output->buffer[0] = next_block >> 8;
+    cmd_output->buffer[1] = next_block & 0xFF;
+    cmd_output->length    = 2;
+}
+
+static void cmd_get_time( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // GPS time in seconds then its milliseconds, big endian
+    uint32_t gps_time_s      = 0;
+    uint16_t gps_fraction_ms = 0;
+
+    cmd_output->return_code = modem_get_time( &gps_time_s, &gps_fraction_ms );
+    cmd_output->buffer[0]   = ( gps_time_s >> 24 ) & 0xFF;
+    cmd_output->buffer[1]   = ( gps_time_s >> 16 ) & 0xFF;
+    cmd_output->buffer[2]   = ( gps_time_s >> 8 ) & 0xFF;
+    cmd_output->buffer[3]   = gps_time_s & 0xFF;
+    cmd_output->buffer[4]   = gps_fraction_ms >> 8;
+    cmd_output->buffer[5]   = gps_fraction_ms & 0xFF;
+    cmd_output->length      = 6;
+}
+
+static void cmd_get_status( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_get_status( &cmd_output->buffer[0] );
+    cmd_output->length      = 1;
+}
+
+static void cmd_set_alarm_timer( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_set_alarm_timer_s( cmd_get_u32( cmd_input->buffer ) );
+}
+
+static void cmd_not_implemented( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = RC_NOT_IMPLEMENTED;
+}
+
+static void cmd_get_joineui( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_get_joineui( &cmd_output->buffer[0] );
+    cmd_output->length      = 8;
+}
+
+static void cmd_set_joineui( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_set_joineui( &cmd_input->buffer[0] );
+}
+
+static void cmd_get_deveui( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_get_deveui( &cmd_output->buffer[0] );
+    cmd_output->length      = 8;
+}
+
+static void cmd_set_deveui( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_set_deveui( &cmd_input->buffer[0] );
+}
+
+static void cmd_set_nwkkey( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // same as CMD_SETAPPKEY,  @todo nwk key and app key !!!!
+    cmd_output->return_code = modem_set_nwkkey( &cmd_input->buffer[0] );
+}
+
+static void cmd_get_class( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_get_class( &cmd_output->buffer[0] );
+    cmd_output->length      = 1;
+}
 
-    if( ( modem_get_upload_state( ) != MODEM_UPLOAD_INIT ) && ( modem_get_upload_state( ) != MODEM_UPLOAD_DATA ) )
+static void cmd_set_class( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_set_class( cmd_input->buffer[0] );
+}
+
+static void cmd_set_multicast( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // group id, McAddr, McNwkSKey and McAppSKey, the group id alone clears the group
+    const uint8_t* in = cmd_input->buffer;
+    if( cmd_input->length == 1 )
     {
-        return_code = RC_NOT_INIT;
-        BSP_DBG_TRACE_ERROR( "Upload file data, not init\n" );
+        cmd_output->return_code = modem_set_multicast( in[0], 0, NULL, NULL );
     }
-    else if( payload == NULL )
+    else if( cmd_input->length == 37 )
     {
-        return_code = RC_NOT_INIT;
-        BSP_DBG_TRACE_ERROR( "Upload file data, null\n" );
+        cmd_output->return_code = modem_set_multicast( in[0], cmd_get_u32( &in[1] ), &in[5], &in[21] );
     }
-    else if( ( upload_current_size + payload_length ) > file_size )
+    else
     {
-        return_code = RC_INVALID;
-        BSP_DBG_TRACE_ERROR( "Upload file data, size invalid\n" );
+        cmd_output->return_code = RC_INVALID;
     }
-    else if( get_modem_status_file_upload( ) == true )
-    {
-        return_code = RC_INVALID;
-        BSP_DBG_TRACE_ERROR( "Upload file still on going\n" );
+}
+
+static void cmd_get_region( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_get_region( &cmd_output->buffer[0] );
+    cmd_output->length      = 1;
+}
+
+static void cmd_set_region( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_set_region( cmd_input->buffer[0] );
+}
+
+static void cmd_list_region( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // 2.4GHZ modem support only one region
+    cmd_output->return_code = modem_list_region( &cmd_output->buffer[0], &cmd_output->length );
+}
+
+static void cmd_get_adr_profile( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_get_adr_profile( &cmd_output->buffer[0] );
+    cmd_output->length      = 1;
+}
+
+static void cmd_set_adr_profile( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_set_adr_profile( cmd_input->buffer[0], &cmd_input->buffer[1] );
+}
+
+static void cmd_get_dm_port( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_get_dm_port( &cmd_output->buffer[0] );
+    cmd_output->length      = 1;
+}
+
+static void cmd_set_dm_port( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_set_dm_port( cmd_input->buffer[0] );
+}
+
+static void cmd_get_dm_info_interval( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_get_dm_info_interval( &cmd_output->buffer[0] );
+    cmd_output->length      = 1;
+}
+
+static void cmd_set_dm_info_interval( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_set_dm_info_interval( cmd_input->buffer[0] );
+}
+
+static void cmd_get_dm_info_fields( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_get_dm_info_fields( &cmd_output->buffer[0], &cmd_output->length );
+}
+
+static void cmd_set_dm_info_fields( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_set_dm_info_fields( &cmd_input->buffer[0], cmd_input->length );
+}
+
+static void cmd_send_dm_status( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_send_dm_status( &cmd_input->buffer[0], cmd_input->length );
+}
+
+static void cmd_set_app_status( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_set_app_status( &cmd_input->buffer[0], cmd_input->length );
+}
+
+static void cmd_join( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_join( );
+}
+
+static void cmd_leave_network( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_leave_network( );
+}
+
+static void cmd_suspend_modem_comm( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_suspend_modem_comm( cmd_input->buffer[0] );
+}
+
+static void cmd_get_next_tx_max_payload( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_get_next_tx_max_payload( &cmd_output->buffer[0] );
+    if( cmd_output->return_code == RC_OK )
+    {
+        cmd_output->length = 1;
+    }
+}
+
+static void cmd_request_tx( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_request_tx( cmd_input->buffer[0], cmd_input->buffer[1], &cmd_input->buffer[2],
+                                                cmd_input->length - 2 );
+}
+
+static void cmd_emergency_tx( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_emergency_tx( cmd_input->buffer[0], cmd_input->buffer[1], &cmd_input->buffer[2],
+                                                  cmd_input->length - 2 );
+}
+
+static void cmd_upload_init( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    const uint16_t size          = cmd_get_u16( &cmd_input->buffer[2] );
+    const uint16_t average_delay = cmd_get_u16( &cmd_input->buffer[4] );
+
+    file_size           = size;
+    upload_current_size = 0;
+    if( file_size > BSP_FILE_UPLOAD_MAX_SIZE )
+    {
+        cmd_output->return_code = RC_FAIL;
+    }
+    else
+    {
+        cmd_output->return_code =
+            modem_upload_init( UPLOAD_SID, cmd_input->buffer[0], cmd_input->buffer[1], size, average_delay );
+    }
+}
+
+static void cmd_upload_data( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = upload_data( &cmd_input->buffer[0], cmd_input->length, file_store );
+}
+
+static void cmd_upload_start( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    const uint32_t input_crc = cmd_get_u32( cmd_input->buffer );
+
+    if( file_size != upload_current_size )
+    {
+        cmd_output->return_code = RC_BAD_SIZE;
+        BSP_DBG_TRACE_ERROR( "RC_BAD_SIZE in FileUpload\n" );
+    }
+    else if( input_crc != crc( file_store, file_size ) )
+    {
+        cmd_output->return_code = RC_BAD_CRC;
+        BSP_DBG_TRACE_ERROR( "RC_BAD_CRC in FileUpload\n" );
+    }
+    else
+    {
+        cmd_output->return_code = modem_upload_start( UPLOAD_SID, file_store, file_size );
+    }
+}
+
+static void cmd_stream_init( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    uint8_t encryption = ( cmd_input->length > 1 ) ? cmd_input->buffer[1] : 0;
+    if( encryption > 1 )
+    {
+        cmd_output->return_code = RC_INVALID;
+    }
+    else
+    {
+        cmd_output->return_code = modem_stream_init( cmd_input->buffer[0], encryption == 1 );
+    }
+}
+
+static void cmd_send_stream_data( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code =
+        modem_stream_add_data( cmd_input->buffer[0], &cmd_input->buffer[1], cmd_input->length - 1 );
+}
+
+static void cmd_stream_status( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    uint16_t pending    = 0;
+    uint16_t free_space = 0;
+    cmd_output->return_code = modem_stream_status( cmd_input->buffer[0], &pending, &free_space );
+    if( cmd_output->return_code == RC_OK )
+    {
+        cmd_output->buffer[0] = ( pending >> 8 ) & 0xFF;
+        cmd_output->buffer[1] = pending & 0xFF;
+        cmd_output->buffer[2] = ( free_space >> 8 ) & 0xFF;
+        cmd_output->buffer[3] = free_space & 0xFF;
+        cmd_output->length    = 4;
+    }
+}
+
+static void cmd_get_baudrate( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->buffer[0] = hw_modem_get_baudrate( );
+    cmd_output->length    = 1;
+}
+
+static void cmd_set_baudrate( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = ( hw_modem_set_baudrate( cmd_input->buffer[0] ) == true ) ? RC_OK : RC_INVALID;
+}
+
+static void cmd_get_rp_stats( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_get_rp_stats( &cmd_output->buffer[0], &cmd_output->length );
+}
+
+#if defined( PERF_TEST_ENABLED )
+static void cmd_get_perf_trace( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // the response length is on one byte, the records left over are sent by the next command
+    cmd_output->length = bsp_perf_dump( &cmd_output->buffer[0], UINT8_MAX );
+}
+
+static void cmd_get_perf_latency( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->length = bsp_perf_latency_dump( &cmd_output->buffer[0], UINT8_MAX );
+}
+
+static void cmd_get_rp_trace( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // dumps are concatenated by the host into the input file of the rp_replay tool
+    cmd_output->length = rp_trace_dump( &cmd_output->buffer[0], UINT8_MAX );
+}
+
+static void cmd_get_energy( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // the scenario benchmark resets the charge before each scenario and reads this report at its end
+    cmd_output->return_code = modem_get_energy_report( &cmd_output->buffer[0], &cmd_output->length );
+}
+
+static void cmd_get_irq_stats( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // cleared by the dump, the host reads it at the end of each measured run
+    cmd_output->length = bsp_perf_irq_dump( &cmd_output->buffer[0], UINT8_MAX );
+}
+#endif
+
+static void cmd_batch( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    s_cmd_input_t    sub_input;
+    s_cmd_response_t sub_output;
+    uint8_t          sub_length;
+    uint8_t          nb_cmd = 0;
+    uint16_t         index;
+
+    // nothing is run if one of the sub-commands is not valid
+    for( index = 0; ( index + 2 ) <= cmd_input->length; index += 2 + cmd_input->buffer[index + 1] )
+    {
+        const host_cmd_type_t sub_code = ( host_cmd_type_t ) cmd_input->buffer[index];
+        if( ( sub_code >= CMD_MAX ) || ( sub_code == CMD_BATCH ) || ( sub_code == CMD_TEST ) )
+        {
+            BSP_DBG_TRACE_ERROR( "Command 0x%x not valid in a batch\n", sub_code );
+            cmd_output->return_code = RC_INVALID;
+            return;
+        }
+        if( cmd_check_length( cmd_input->buffer[index + 1], host_cmd_table[sub_code].length_min,
+                              host_cmd_table[sub_code].length_max ) == CMD_LENGTH_NOT_VALID )
+        {
+            cmd_output->return_code = RC_BAD_SIZE;
+            return;
+        }
+        nb_cmd++;
+    }
+    if( index != cmd_input->length )
+    {
+        BSP_DBG_TRACE_ERROR( "Batch truncated\n" );
+        cmd_output->return_code = RC_BAD_SIZE;
+        return;
+    }
+
+    modem_set_context_store_hold( true );
+    for( index = 0; cmd_output->length < nb_cmd; index += 2 + sub_length )
+    {
+        // parse_cmd clears the input once run, the length is kept aside
+        sub_input.cmd_code = ( host_cmd_type_t ) cmd_input->buffer[index];
+        sub_length         = cmd_input->buffer[index + 1];
+        sub_input.length   = sub_length;
+        sub_input.buffer   = &cmd_input->buffer[index + 2];
+        sub_output.buffer  = batch_response;
+        parse_cmd( &sub_input, &sub_output );
+
+        cmd_output->buffer[cmd_output->length++] = sub_output.return_code;
+        if( sub_output.return_code != RC_OK )
+        {
+            break;
+        }
+    }
+    modem_set_context_store_hold( false );
+}
+
+static void cmd_set_dm_delta( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // keyframe period, then the thresholds to change as code and big endian threshold
+    if( ( ( cmd_input->length - 1 ) % 3 ) != 0 )
+    {
+        cmd_output->return_code = RC_BAD_SIZE;
+        return;
+    }
+    for( uint8_t i = 1; ( i < cmd_input->length ) && ( cmd_output->return_code == RC_OK ); i += 3 )
+    {
+        cmd_output->return_code = modem_set_dm_delta_threshold( ( e_dm_info_t ) cmd_input->buffer[i],
+                                                                cmd_get_u16( &cmd_input->buffer[i + 1] ) );
+    }
+    if( cmd_output->return_code == RC_OK )
+    {
+        cmd_output->return_code = modem_set_dm_delta( cmd_input->buffer[0] );
+    }
+}
+
+static void cmd_get_ram_usage( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_get_ram_usage_report( &cmd_output->buffer[0], &cmd_output->length );
+    // the host link buffers belong to the application, they follow the modem subsystems
+    const uint32_t host_link_size = hw_modem_get_ram_size( ) + sizeof( file_store ) + sizeof( batch_response );
+    const uint16_t value          = ( host_link_size > 0xFFFF ) ? 0xFFFF : host_link_size;
+    cmd_output->buffer[cmd_output->length++] = value >> 8;
+    cmd_output->buffer[cmd_output->length++] = value & 0xFF;
+}
+
+static void cmd_ranging_start( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // role, address, frequency, test mode sf and bw codes, power, then exchanges (master) or seconds (slave)
+    const uint8_t*    in   = cmd_input->buffer;
+    ral_params_lora_t lora = { 0 };
+    if( ( in[0] > RAL_RANGING_ROLE_MASTER ) || ( in[9] >= TST_SF_MAX ) || ( in[10] >= TST_BW_MAX ) )
+    {
+        cmd_output->return_code = RC_INVALID;
+        return;
+    }
+    lora.freq_in_hz = cmd_get_u32( &in[5] );
+    lora.sf         = ( ral_lora_sf_t ) host_cmd_test_sf_convert[in[9]];
+    lora.bw         = ( ral_lora_bw_t ) host_cmd_test_bw_convert[in[10]];
+    lora.cr         = RAL_LORA_CR_4_5;
+    lora.sync_word  = 0x12;
+    lora.pwr_in_dbm = ( int8_t ) in[11];
+    cmd_output->return_code =
+        modem_ranging_start( ( ral_ranging_role_t ) in[0], &lora, cmd_get_u32( &in[1] ), cmd_get_u16( &in[12] ) );
+}
+
+static void cmd_ranging_stop( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_ranging_stop( );
+}
+
+static void cmd_get_ranging_result( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    ranging_result_t result;
+
+    cmd_output->return_code = modem_ranging_get_result( cmd_get_u32( cmd_input->buffer ), &result );
+    if( cmd_output->return_code == RC_OK )
+    {
+        // last and average distances in cm (signed), age of the last batch in s, then the batch counters
+        const uint32_t age_s     = ( bsp_rtc_get_time_ms( ) - result.timestamp_ms ) / 1000;
+        const uint32_t values[3] = { ( uint32_t ) result.last_cm, ( uint32_t ) result.average_cm, age_s };
+        uint8_t        length    = 0;
+        for( uint8_t i = 0; i < 3; i++ )
+        {
+            cmd_output->buffer[length++] = values[i] >> 24;
+            cmd_output->buffer[length++] = ( values[i] >> 16 ) & 0xFF;
+            cmd_output->buffer[length++] = ( values[i] >> 8 ) & 0xFF;
+            cmd_output->buffer[length++] = values[i] & 0xFF;
+        }
+        cmd_output->buffer[length++] = result.valid_nb;
+        cmd_output->buffer[length++] = result.exchange_nb;
+        cmd_output->buffer[length++] = result.batch_nb >> 8;
+        cmd_output->buffer[length++] = result.batch_nb & 0xFF;
+        cmd_output->length           = length;
+    }
+}
+
+static void cmd_ble_beacon_start( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // interval (2 bytes), power, address (6 bytes), then the advertising data
+    cmd_output->return_code =
+        modem_ble_beacon_start( &cmd_input->buffer[3], &cmd_input->buffer[9], cmd_input->length - 9,
+                                cmd_get_u16( &cmd_input->buffer[0] ), ( int8_t ) cmd_input->buffer[2] );
+}
+
+static void cmd_ble_beacon_stop( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_ble_beacon_stop( );
+}
+
+static void cmd_request_time_sync( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_request_time_sync( );
+}
+
+static void cmd_set_tx_slot( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // frame period [s] then slot length [ms], big endian
+    cmd_output->return_code =
+        modem_set_tx_slot( cmd_get_u16( &cmd_input->buffer[0] ), cmd_get_u16( &cmd_input->buffer[2] ) );
+}
+
+static void cmd_set_event_push( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // 0: the host reads the events, 1: the modem pushes them
+    if( cmd_input->buffer[0] > 1 )
+    {
+        cmd_output->return_code = RC_INVALID;
+        return;
+    }
+    hw_modem_set_event_push( cmd_input->buffer[0] == 1 );
+}
+
+/*!
+ * \brief   Decode the modulation of the raw radio commands, 11 bytes: packet type (ral_pkt_type_t), frequency,
+ *          power, then LoRa: test mode sf and bw codes, 2 bytes unused, code rate (ral_lora_cr_t), GFSK: bit rate,
+ *          1 byte unused, FLRC: bit rate, code rate (ral_flrc_cr_t)
+ */
+static bool cmd_raw_radio_params_get( const uint8_t* in, raw_radio_params_t* params )
+{
+    params->pkt_type   = ( ral_pkt_type_t ) in[0];
+    params->freq_in_hz = cmd_get_u32( &in[1] );
+    params->pwr_in_dbm = ( int8_t ) in[5];
+    switch( params->pkt_type )
+    {
+    case RAL_PKT_TYPE_LORA:
+        if( ( in[6] >= TST_SF_MAX ) || ( in[7] >= TST_BW_MAX ) )
+        {
+            return false;
+        }
+        params->lora.sf = ( ral_lora_sf_t ) host_cmd_test_sf_convert[in[6]];
+        params->lora.bw = ( ral_lora_bw_t ) host_cmd_test_bw_convert[in[7]];
+        params->lora.cr = ( ral_lora_cr_t ) in[10];
+        return true;
+    case RAL_PKT_TYPE_GFSK:
+        params->gfsk.br_in_bps = cmd_get_u32( &in[6] );
+        return true;
+    case RAL_PKT_TYPE_FLRC:
+        params->flrc.br_in_bps = cmd_get_u32( &in[6] );
+        params->flrc.cr        = ( ral_flrc_cr_t ) in[10];
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void cmd_raw_radio_tx( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // modulation, delay (0 as soon as possible), then the frame
+    raw_radio_params_t params;
+    if( cmd_raw_radio_params_get( cmd_input->buffer, &params ) == false )
+    {
+        cmd_output->return_code = RC_INVALID;
+        return;
+    }
+    cmd_output->return_code = modem_raw_radio_tx( &params, cmd_get_u32( &cmd_input->buffer[11] ),
+                                                  &cmd_input->buffer[15], cmd_input->length - 15 );
+}
+
+static void cmd_raw_radio_rx( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // modulation, delay (0 as soon as possible), then the listening time in ms
+    raw_radio_params_t params;
+    if( cmd_raw_radio_params_get( cmd_input->buffer, &params ) == false )
+    {
+        cmd_output->return_code = RC_INVALID;
+        return;
+    }
+    cmd_output->return_code = modem_raw_radio_rx( &params, cmd_get_u32( &cmd_input->buffer[11] ),
+                                                  cmd_get_u32( &cmd_input->buffer[15] ) );
+}
+
+static void cmd_raw_radio_abort( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_raw_radio_abort( );
+}
+
+static void cmd_get_radio_free_window( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // radio time needed in ms, the delay to the window then its length in ms, big endian
+    uint32_t delay_ms = 0;
+    uint32_t free_ms  = 0;
+
+    cmd_output->return_code = modem_get_radio_free_window( cmd_get_u32( cmd_input->buffer ), &delay_ms, &free_ms );
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        cmd_output->buffer[i]     = ( delay_ms >> ( 24 - ( 8 * i ) ) ) & 0xFF;
+        cmd_output->buffer[4 + i] = ( free_ms >> ( 24 - ( 8 * i ) ) ) & 0xFF;
+    }
+    cmd_output->length = 8;
+}
+
+static void cmd_relay_start( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // frequency, test mode sf and bw codes, code rate (ral_lora_cr_t), sync word, power, sniff period in ms
+    const uint8_t* in = cmd_input->buffer;
+    relay_params_t params;
+
+    if( ( in[4] >= TST_SF_MAX ) || ( in[5] >= TST_BW_MAX ) )
+    {
+        cmd_output->return_code = RC_INVALID;
+        return;
+    }
+    params.freq_in_hz       = cmd_get_u32( &in[0] );
+    params.sf               = ( ral_lora_sf_t ) host_cmd_test_sf_convert[in[4]];
+    params.bw               = ( ral_lora_bw_t ) host_cmd_test_bw_convert[in[5]];
+    params.cr               = ( ral_lora_cr_t ) in[6];
+    params.sync_word        = in[7];
+    params.pwr_in_dbm       = ( int8_t ) in[8];
+    params.sniff_period_ms  = cmd_get_u32( &in[9] );
+    cmd_output->return_code = modem_relay_start( &params );
+}
+
+static void cmd_relay_stop( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_relay_stop( );
+}
+
+static void cmd_channel_scan_start( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // scan period in s, RSSI samples per channel, busy threshold in dBm (int8)
+    const uint8_t*        in = cmd_input->buffer;
+    channel_scan_params_t params;
+
+    params.period_s              = cmd_get_u32( &in[0] );
+    params.sample_nb             = in[4];
+    params.busy_threshold_in_dbm = ( int8_t ) in[5];
+    cmd_output->return_code      = modem_channel_scan_start( &params );
+}
+
+static void cmd_channel_scan_stop( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    cmd_output->return_code = modem_channel_scan_stop( );
+}
+
+static void cmd_set_port_qos( const s_cmd_input_t* cmd_input, s_cmd_response_t* cmd_output )
+{
+    // port alone to give it the default class back, else port, priority (eTask_priority), packet type
+    // (modem_qos_tx_mode_t), max delay [s] big endian, flags: bit 0 coalesced, bit 1 dropped when stale
+    if( cmd_input->length == 1 )
+    {
+        cmd_output->return_code = modem_set_port_qos( cmd_input->buffer[0], NULL );
+        return;
+    }
+    if( cmd_input->length != 6 )
+    {
+        cmd_output->return_code = RC_INVALID;
+        return;
+    }
+    modem_qos_t qos = { .priority              = ( eTask_priority ) cmd_input->buffer[1],
+                        .tx_mode               = ( modem_qos_tx_mode_t ) cmd_input->buffer[2],
+                        .max_delay_s           = cmd_get_u16( &cmd_input->buffer[3] ),
+                        .is_coalesced          = ( cmd_input->buffer[5] & 0x01 ) != 0,
+                        .is_dropped_when_stale = ( cmd_input->buffer[5] & 0x02 ) != 0 };
+
+    cmd_output->return_code = modem_set_port_qos( cmd_input->buffer[0], &qos );
+}
+
+static e_parse_error_t cmd_test_parser( s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    if( test_mode_enabled_is( ) == false && cmd_tst_input->cmd_code != CMD_TST_START )
+    {
+        BSP_DBG_TRACE_ERROR( "Command not valid, test mode not started\n" );
+        cmd_tst_output->return_code = RC_INVALID;
+        cmd_tst_output->length      = 0;
+        return PARSE_ERROR;
+    }
+
+    if( cmd_tst_input->cmd_code >= CMD_TST_MAX )
+    {
+        BSP_DBG_TRACE_ERROR( "Unknown command test (0x%x)\n", cmd_tst_input->cmd_code );
+        cmd_tst_output->return_code = RC_INVALID;
+        cmd_tst_output->length      = 0;
+        return PARSE_ERROR;
+    }
+
+    const cmd_tst_entry_t* entry = &host_cmd_test_table[cmd_tst_input->cmd_code];
+
+    if( cmd_check_length( cmd_tst_input->length, entry->length_min, entry->length_max ) == CMD_LENGTH_NOT_VALID )
+    {
+        BSP_DBG_TRACE_ERROR( "Invalid size command test (0x%x)\n", cmd_tst_input->cmd_code );
+        cmd_tst_output->return_code = RC_BAD_SIZE;
+        cmd_tst_output->length      = 0;
+        return PARSE_ERROR;
+    }
+
+    cmd_tst_output->return_code = RC_OK;  // by default the return code is ok and length is 0
+    cmd_tst_output->length      = 0;
+
+#if BSP_DBG_TRACE == BSP_FEATURE_ON
+    // the stream bypass commands leave a hole in the table when they are not built
+    BSP_DBG_TRACE_WARNING( "\tCMD_TST_%s (0x%02x)\n",
+                           ( host_cmd_test_str[cmd_tst_input->cmd_code] != NULL )
+                               ? host_cmd_test_str[cmd_tst_input->cmd_code]
+                               : "UNKNOWN",
+                           cmd_tst_input->cmd_code );
+#endif
+    if( entry->handler != NULL )
+    {
+        entry->handler( cmd_tst_input, cmd_tst_output );
+    }
+    else
+    {
+        cmd_tst_output->return_code = RC_UNKNOWN;
+    }
+
+    // Erase test command content to avoid twice calls
+    cmd_tst_input->cmd_code = CMD_TST_MAX;
+    cmd_tst_input->length   = 0;
+
+    return PARSE_OK;
+}
+
+static void cmd_tst_start( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    if( get_join_state( ) != MODEM_NOT_JOINED )
+    {
+        BSP_DBG_TRACE_ERROR( "TST MODE: not available if joined\n" );
+        cmd_tst_output->return_code = RC_FAIL;
+    }
+    else if( strncmp( ( char* ) cmd_tst_input->buffer, "TESTTEST", 8 ) == 0 )
+    {
+        cmd_tst_output->return_code = test_mode_start( );
+    }
+    else
+    {
+        BSP_DBG_TRACE_ERROR( "TST MODE: invalid enablement payload\n" );
+        cmd_tst_output->return_code = RC_INVALID;
+    }
+}
+
+static void cmd_tst_nop( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    cmd_tst_output->return_code = test_mode_nop( );
+}
+
+static void cmd_tst_tx_single( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    const uint8_t* in = cmd_tst_input->buffer;
+
+    cmd_tst_output->return_code =
+        test_mode_tx( cmd_get_u32( &in[0] ), in[4], in[5], in[6], in[7], in[8], TEST_MODE_TX_SINGLE );
+}
+
+static void cmd_tst_tx_cont( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    const uint8_t* in = cmd_tst_input->buffer;
+
+    cmd_tst_output->return_code =
+        test_mode_tx( cmd_get_u32( &in[0] ), in[4], in[5], in[6], in[7], in[8], TEST_MODE_TX_CONTINUE );
+}
+
+static void cmd_tst_tx_hop( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    const uint8_t* in = cmd_tst_input->buffer;
+
+    cmd_tst_output->return_code = test_mode_tx_hop( in[0], in[1], in[2], in[3], cmd_get_u16( &in[4] ) );
+}
+
+static void cmd_tst_tx_cw( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    cmd_tst_output->return_code = test_mode_cw( cmd_get_u32( &cmd_tst_input->buffer[0] ), cmd_tst_input->buffer[4] );
+}
+
+static void cmd_tst_rx_cont( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    const uint8_t* in = cmd_tst_input->buffer;
+
+    cmd_tst_output->return_code = test_mode_rx_cont( cmd_get_u32( &in[0] ), in[4], in[5], in[6] );
+}
+
+static void cmd_tst_not_implemented( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    cmd_tst_output->return_code = RC_NOT_IMPLEMENTED;
+}
+
+static void cmd_tst_radio_reset( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    cmd_tst_output->return_code = test_mode_radio_reset( );
+}
+
+static void cmd_tst_spi( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    if( ( cmd_tst_input->buffer[0] == TEST_MODE_SPI_BENCH ) && ( cmd_tst_input->length == 3 ) )
+    {
+        cmd_tst_output->return_code = test_mode_spi_bench( cmd_get_u16( &cmd_tst_input->buffer[1] ),
+                                                           cmd_tst_output->buffer, &cmd_tst_output->length );
+    }
+    else
+    {
+        cmd_tst_output->return_code = RC_NOT_IMPLEMENTED;
+    }
+}
+
+static void cmd_tst_exit( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    cmd_tst_output->return_code = test_mode_exit( );
+}
+
+static void cmd_tst_radio_read( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    // radio command length, radio command, then the number of bytes to read
+    uint8_t* in             = cmd_tst_input->buffer;
+    uint8_t  command_length = in[0];
+
+    if( ( cmd_tst_input->length == 0 ) || ( ( command_length + 2 ) > cmd_tst_input->length ) )
+    {
+        cmd_tst_output->return_code = RC_BAD_SIZE;
+        return;
+    }
+
+    // the radio answer goes straight into the response
+    uint8_t data_length         = in[command_length + 1];
+    cmd_tst_output->return_code = test_mode_radio_read( &in[1], command_length, cmd_tst_output->buffer, data_length );
+    cmd_tst_output->length      = data_length;
+}
+
+static void cmd_tst_radio_write( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    // radio command length, radio command, then the number of data bytes: the data are taken from that length byte
+    uint8_t* in             = cmd_tst_input->buffer;
+    uint8_t  command_length = in[0];
+
+    if( ( cmd_tst_input->length == 0 ) || ( ( command_length + 2 ) > cmd_tst_input->length ) ||
+        ( ( command_length + 1 + in[command_length + 1] ) > cmd_tst_input->length ) )
+    {
+        cmd_tst_output->return_code = RC_BAD_SIZE;
+        return;
+    }
+
+    uint8_t data_length = in[command_length + 1];
+    cmd_tst_output->return_code =
+        test_mode_radio_write( &in[1], command_length, &in[command_length + 1], data_length );
+    cmd_tst_output->length = data_length;
+}
+
+#ifdef LORAWAN_BYPASS_ENABLED
+static void cmd_tst_stream_bypass( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    uint8_t enabled = cmd_tst_input->buffer[0];
+    if( enabled )
+    {
+        BSP_DBG_TRACE_INFO( "TST MODE: ENABLE STREAM BYPASS\n" );
+    }
+    else
+    {
+        BSP_DBG_TRACE_INFO( "TST MODE: DISABLE STREAM BYPASS\n" );
+    }
+    modem_stream_bypass_enable( enabled != 0 );
+}
+
+static void cmd_tst_stream_get( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    uint8_t  len      = cmd_tst_input->buffer[0];
+    uint32_t frag_cnt = 0;
+    frag_cnt |= cmd_tst_input->buffer[1];
+    frag_cnt |= cmd_tst_input->buffer[2] << 8;
+    frag_cnt |= cmd_tst_input->buffer[3] << 16;
+    frag_cnt |= cmd_tst_input->buffer[4] << 24;
+    BSP_DBG_TRACE_PRINTF( "TST MODE: GET STREAM FRAGMENT %u %u\n", len, frag_cnt );
+    cmd_tst_output->return_code = modem_stream_bypass_get_fragment( cmd_tst_output->buffer, frag_cnt, &len );
+    cmd_tst_output->length      = len;
+}
+
+static void cmd_tst_stream_downlink( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    BSP_DBG_TRACE_INFO( "TST MODE: STREAM DOWNLINK\n" );
+    cmd_tst_output->return_code = modem_stream_bypass_send_downlink( cmd_tst_input->buffer, cmd_tst_input->length );
+}
+#endif  // LORAWAN_BYPASS_ENABLED
+
+static void cmd_tst_per_tx( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    const uint8_t* in = cmd_tst_input->buffer;
+
+    cmd_tst_output->return_code = test_mode_per_tx( cmd_get_u32( &in[0] ), in[4], in[5], in[6], in[7], in[8],
+                                                    cmd_get_u16( &in[9] ), cmd_get_u16( &in[11] ) );
+}
+
+static void cmd_tst_per_rx( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    const uint8_t* in = cmd_tst_input->buffer;
+
+    cmd_tst_output->return_code =
+        test_mode_per_rx( cmd_get_u32( &in[0] ), in[4], in[5], in[6], in[7], cmd_get_u16( &in[8] ) );
+}
+
+static void cmd_tst_per_result( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    cmd_tst_output->return_code = test_mode_per_result( cmd_tst_output->buffer, &cmd_tst_output->length );
+}
+
+static void cmd_tst_sweep( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    const uint8_t* in = cmd_tst_input->buffer;
+
+    cmd_tst_output->return_code =
+        test_mode_sweep_start( cmd_tst_input->cmd_code == CMD_TST_SWEEP_RX, cmd_get_u32( &in[0] ),
+                               cmd_get_u16( &in[4] ), in[6], in[7], in[8], in[9], in[10], in[11],
+                               cmd_get_u16( &in[12] ) );
+}
+
+static void cmd_tst_sweep_result( const s_cmd_tst_input_t* cmd_tst_input, s_cmd_tst_response_t* cmd_tst_output )
+{
+    cmd_tst_output->return_code =
+        test_mode_sweep_result( cmd_tst_input->buffer[0], cmd_tst_output->buffer, &cmd_tst_output->length );
+}
+
+static modem_return_code_t upload_data( uint8_t* payload, uint8_t payload_length, uint8_t* file_strore )
+{
+    modem_return_code_t return_code = RC_OK;
+
+    if( ( modem_get_upload_state( UPLOAD_SID ) != MODEM_UPLOAD_INIT ) &&
+        ( modem_get_upload_state( UPLOAD_SID ) != MODEM_UPLOAD_DATA ) )
+    {
+        return_code = RC_NOT_INIT;
+        BSP_DBG_TRACE_ERROR( "Upload file data, not init\n" );
+    }
+    else if( payload == NULL )
+    {
+        return_code = RC_NOT_INIT;
+        BSP_DBG_TRACE_ERROR( "Upload file data, null\n" );
+    }
+    else if( ( upload_current_size + payload_length ) > file_size )
+    {
+        return_code = RC_INVALID;
+        BSP_DBG_TRACE_ERROR( "Upload file data, size invalid\n" );
     }
     else
     {
         memcpy( ( uint8_t* ) file_strore + upload_current_size, payload, payload_length );
+        modem_upload_hash_data( UPLOAD_SID, payload, payload_length );
         upload_current_size += payload_length;
-        modem_set_upload_state( MODEM_UPLOAD_DATA );
+        modem_set_upload_state( UPLOAD_SID, MODEM_UPLOAD_DATA );
     }
 
     return return_code;
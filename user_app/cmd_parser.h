@@ -64,8 +64,8 @@ typedef enum host_cmd_type
     CMD_GETTXPOWOFF         = 0x06,           // Unused 2.4GHZ
     CMD_SETTXPOWOFF         = 0x07,           // may be
     CMD_TEST                = 0x08,           //
-    CMD_FIRMWARE            = 0x09,           // Unused 2.4GHZ
-    CMD_GETTIME             = 0x0A,           // Not Yet Implemented
+    CMD_FIRMWARE            = 0x09,           // Done
+    CMD_GETTIME             = 0x0A,           // Done
     CMD_GETSTATUS           = 0x0B,           // Done
     CMD_SETALARMTIMER       = 0x0C,           // Not Yet Implemented
     CMD_GETTRACE            = 0x0D,           // Unused 2.4GHZ
@@ -79,7 +79,7 @@ typedef enum host_cmd_type
     CMD_SETAPPKEY           = CMD_SETNWKKEY,  //  SAME AS SETNWKKEY
     CMD_GETCLASS            = 0x15,           // Done
     CMD_SETCLASS            = 0x16,           // Done
-    CMD_SETMULTICAST        = 0x17,           // Unused 2.4GHZ
+    CMD_SETMULTICAST        = 0x17,           // Done
     CMD_GETREGION           = 0x18,           // Done
     CMD_SETREGION           = 0x19,           // Done
     CMD_LISTREGION          = 0x1A,           // Done
@@ -105,62 +105,38 @@ typedef enum host_cmd_type
     CMD_STREAMINIT          = 0x2E,           // Done
     CMD_SENDSTREAMDATA      = 0x2F,           // Done
     CMD_STREAMSTATUS        = 0x30,           // Done
+    CMD_GETBAUDRATE         = 0x31,           // Done
+    CMD_SETBAUDRATE         = 0x32,           // Done
+    CMD_GETRPSTATS          = 0x33,           // Done
+    CMD_GETPERFTRACE        = 0x34,           // perf_test builds only
+    CMD_GETPERFLATENCY      = 0x35,           // perf_test builds only
+    CMD_GETRPTRACE          = 0x36,           // perf_test builds only
+    CMD_GETEVENTS           = 0x37,           // Done
+    CMD_BATCH               = 0x38,           // Done
+    CMD_SETDMDELTA          = 0x39,           // Done
+    CMD_GETRAMUSAGE         = 0x3A,           // Done
+    CMD_RANGINGSTART        = 0x3B,           // Done
+    CMD_RANGINGSTOP         = 0x3C,           // Done
+    CMD_GETRANGINGRESULT    = 0x3D,           // Done
+    CMD_BLEBEACONSTART      = 0x3E,           // Done
+    CMD_BLEBEACONSTOP       = 0x3F,           // Done
+    CMD_REQUESTTIMESYNC     = 0x40,           // Done
+    CMD_SETTXSLOT           = 0x41,           // Done
+    CMD_SETEVENTPUSH        = 0x42,           // Done
+    CMD_RAWRADIOTX          = 0x43,           // Done
+    CMD_RAWRADIORX          = 0x44,           // Done
+    CMD_RAWRADIOABORT       = 0x45,           // Done
+    CMD_GETRADIOFREEWINDOW  = 0x46,           // Done
+    CMD_RELAYSTART          = 0x47,           // Done
+    CMD_RELAYSTOP           = 0x48,           // Done
+    CMD_CHANNELSCANSTART    = 0x49,           // Done
+    CMD_CHANNELSCANSTOP     = 0x4A,           // Done
+    CMD_GETENERGY           = 0x4B,           // perf_test builds only
+    CMD_SETPORTQOS          = 0x4C,           // Done
+    CMD_GETIRQSTATS         = 0x4D,           // perf_test builds only
     CMD_MAX
 } host_cmd_type_t;
 
-static const uint8_t host_cmd_len[CMD_MAX][2] = {
-    // [CMD_xxx] = {len_min, len_max}
-    [CMD_GETEVENT]            = { 0, 0 },
-    [CMD_GETVERSION]          = { 0, 0 },
-    [CMD_RESET]               = { 0, 0 },
-    [CMD_FACTORYRESET]        = { 0, 0 },
-    [CMD_RESETCHARGE]         = { 0, 0 },
-    [CMD_GETCHARGE]           = { 0, 0 },
-    [CMD_GETTXPOWOFF]         = { 0, 0 },
-    [CMD_SETTXPOWOFF]         = { 1, 1 },
-    [CMD_TEST]                = { 1, 255 },
-    [CMD_FIRMWARE]            = { 5, 132 },
-    [CMD_GETTIME]             = { 0, 0 },
-    [CMD_GETSTATUS]           = { 0, 0 },
-    [CMD_SETALARMTIMER]       = { 4, 4 },
-    [CMD_GETTRACE]            = { 0, 0 },  // TODO size must be not 0
-    [CMD_GETPIN]              = { 0, 0 },
-    [CMD_GETCHIPEUI]          = { 0, 0 },
-    [CMD_GETJOINEUI]          = { 0, 0 },
-    [CMD_SETJOINEUI]          = { 8, 8 },
-    [CMD_GETDEVEUI]           = { 0, 0 },
-    [CMD_SETDEVEUI]           = { 8, 8 },
-    [CMD_SETNWKKEY]           = { 16, 16 },
-    [CMD_GETCLASS]            = { 0, 0 },
-    [CMD_SETCLASS]            = { 1, 1 },
-    [CMD_SETMULTICAST]        = { 40, 40 },
-    [CMD_GETREGION]           = { 0, 0 },
-    [CMD_SETREGION]           = { 1, 1 },
-    [CMD_LISTREGION]          = { 0, 0 },
-    [CMD_GETADRPROFILE]       = { 0, 0 },
-    [CMD_SETADRPROFILE]       = { 1, 17 },
-    [CMD_GETDMPORT]           = { 0, 0 },
-    [CMD_SETDMPORT]           = { 1, 1 },
-    [CMD_GETDMINFOINTERVAL]   = { 0, 0 },
-    [CMD_SETDMINFOINTERVAL]   = { 1, 1 },
-    [CMD_GETDMINFOFIELDS]     = { 0, 0 },
-    [CMD_SETDMINFOFIELDS]     = { 0, e_inf_max },
-    [CMD_SENDDMSTATUS]        = { 0, e_inf_max },
-    [CMD_SETAPPSTATUS]        = { 8, 8 },
-    [CMD_JOIN]                = { 0, 0 },
-    [CMD_LEAVENETWORK]        = { 0, 0 },
-    [CMD_SUSPENDMODEMCOMM]    = { 1, 1 },
-    [CMD_GETNEXTTXMAXPAYLOAD] = { 0, 0 },
-    [CMD_REQUESTTX]           = { 2, 244 },
-    [CMD_EMERGENCYTX]         = { 1, 244 },
-    [CMD_UPLOADINIT]          = { 6, 6 },
-    [CMD_UPLOADDATA]          = { 0, 255 },
-    [CMD_UPLOADSTART]         = { 4, 4 },
-    [CMD_STREAMINIT]          = { 1, 2 },
-    [CMD_SENDSTREAMDATA]      = { 1, 255 },
-    [CMD_STREAMSTATUS]        = { 1, 1 },
-};
-
 typedef enum host_cmd_test_e
 {
     CMD_TST_START     = 0x00,
@@ -185,38 +161,15 @@ typedef enum host_cmd_test_e
     CMD_TST_STREAM_GET      = 0x12,
     CMD_TST_STREAM_DOWNLINK = 0x13,
 #endif  // LORAWAN_BYPASS_ENABLED
+    CMD_TST_PER_TX          = 0x14,
+    CMD_TST_PER_RX          = 0x15,
+    CMD_TST_PER_RESULT      = 0x16,
+    CMD_TST_SWEEP_TX        = 0x17,
+    CMD_TST_SWEEP_RX        = 0x18,
+    CMD_TST_SWEEP_RESULT    = 0x19,
     CMD_TST_MAX
 } host_cmd_test_t;
 
-static const uint8_t host_cmd_test_len[CMD_TST_MAX][2] = {
-    // [CMD_xxx] = {len_min, len_max}
-    [CMD_TST_START]     = { 8, 8 },    //
-    [CMD_TST_NOP]       = { 0, 0 },    //
-    [CMD_TST_TX_SINGLE] = { 9, 9 },    //
-    [CMD_TST_TX_CONT]   = { 9, 9 },    //
-    [CMD_TST_TX_HOP]    = { 4, 4 },    //
-    [CMD_TST_NA_1]      = { 0, 0 },    //
-    [CMD_TST_TX_CW]     = { 5, 5 },    //
-    [CMD_TST_RX_CONT]   = { 7, 7 },    //
-    [CMD_TST_RSSI]      = { 7, 7 },    //
-    [CMD_TST_RADIO_RST] = { 0, 0 },    //
-    [CMD_TST_SPI]       = { 1, 255 },  //
-    [CMD_TST_EXIT]      = { 0, 0 },    //
-    [CMD_TST_BUSYLOOP]  = { 0, 0 },    //
-    [CMD_TST_PANIC]     = { 0, 0 },    //
-    [CMD_TST_WATCHDOG]  = { 0, 0 },    //
-    [CMD_TST_RADIO_READ]  = { 0, 255 },
-    [CMD_TST_RADIO_WRITE] = { 0, 255 },
-#ifdef LORAWAN_BYPASS_ENABLED
-    [CMD_TST_STREAM_BYPASS] = { 1, 1 },      // Enable or disable LORAWAN BYPASS
-    [CMD_TST_STREAM_GET]    = { 5, 5 },      // Get next frame when LORAWAN BYPASS is enabled.
-                                             // Param: uint8_t length
-                                             //        uint32_t frag_cnt
-    [CMD_TST_STREAM_DOWNLINK] = { 1, 255 },  // Give downlink when LORAWAN BYPASS is enabled
-#endif                                       // LORAWAN_BYPASS_ENABLED
-};
-
-
 typedef enum cmd_length_valid
 {
     CMD_LENGTH_VALID,
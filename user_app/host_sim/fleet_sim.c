@@ -0,0 +1,718 @@
+/*!
+ * \file      fleet_sim.c
+ *
+ * \brief     Fleet capacity simulation: the transmissions of many host simulations over a shared channel
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>    // C99 types
+#include <stdbool.h>   // bool type
+#include <stdio.h>     // printf
+#include <stdlib.h>    // malloc
+#include <string.h>    // strcmp
+#include <math.h>      // log10
+#include <unistd.h>    // fork
+#include <fcntl.h>     // open
+#include <sys/wait.h>  // waitpid
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * Port of the periodic uplinks of host_sim, their latency is measured from the request
+ */
+#define FLEET_APP_PORT 2
+
+/*!
+ * Log-distance path loss from the free space loss at 1 m, for the 2.4GHz band in an urban area
+ */
+#define FLEET_PATH_LOSS_EXPONENT 2.7
+#define FLEET_SHADOWING_DB 6.0
+#define FLEET_REF_FREQ_HZ 2440000000.0
+
+/*!
+ * Noise figure of the gateway receiver
+ */
+#define FLEET_NOISE_FIGURE_DB 6.0
+
+/*!
+ * Wi-Fi channels 1, 6 and 11: 22 MHz wide, the bursts are a Poisson process of fixed length
+ */
+#define FLEET_WIFI_CHANNEL_NB 3
+#define FLEET_WIFI_HALF_WIDTH_HZ 11000000
+#define FLEET_WIFI_BURST_US 1500.0
+
+/*!
+ * Most devices of a fleet, the DevAddr of host_sim holds 24 bits of the seed
+ */
+#define FLEET_MAX_DEVICES 65535
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * Transmission of a device, as logged by host_sim
+ */
+typedef struct fleet_frame_s
+{
+    uint64_t start_us;
+    uint32_t toa_us;
+    uint32_t freq_in_hz;
+    uint32_t bw_in_hz;
+    uint8_t  sf;
+    int8_t   pwr_in_dbm;
+    uint8_t  mtype;
+    uint16_t fcnt;
+    int16_t  fport;
+    uint16_t device;
+    bool     is_received;  // by at least one gateway
+} fleet_frame_t;
+
+/*!
+ * Simulated device, its requests are contiguous in the request table
+ */
+typedef struct fleet_device_s
+{
+    double   x;
+    double   y;
+    uint32_t request_first;
+    uint32_t request_nb;
+} fleet_device_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static const uint32_t fleet_wifi_freq_hz[FLEET_WIFI_CHANNEL_NB] = { 2412000000, 2437000000, 2462000000 };
+
+static const char* fleet_host_sim      = NULL;
+static char**      fleet_host_sim_args = NULL;  // given after --, the fleet adds the seed, the join and the log
+static int         fleet_host_sim_argc = 0;
+static uint32_t    fleet_device_counts[32];
+static uint8_t     fleet_device_count_nb = 0;
+static uint16_t    fleet_gateway_nb      = 1;
+static double      fleet_radius_m        = 1000;
+static double      fleet_wifi_percent    = 0;
+static double      fleet_capture_db      = 6;
+static uint32_t    fleet_rng_state       = 1;
+
+static fleet_device_t* fleet_devices   = NULL;
+static uint16_t        fleet_device_nb = 0;
+static double*         fleet_gateways  = NULL;  // x and y of each gateway
+static double*         fleet_link_db   = NULL;  // gain from each device to each gateway
+
+static fleet_frame_t* fleet_frames      = NULL;  // in the order of the devices, then of the time
+static uint32_t       fleet_frame_nb    = 0;
+static uint32_t*      fleet_by_start    = NULL;  // frame indexes sorted by start time
+static uint32_t       fleet_max_toa_us  = 0;
+static uint64_t*      fleet_requests    = NULL;
+static uint32_t       fleet_request_nb  = 0;
+static double*        fleet_latencies   = NULL;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * Reads the options, the device counts are a comma separated list
+ */
+static bool fleet_parse_args( int argc, char** argv );
+
+/*!
+ * Runs one host simulation per device, as many at once as there are processors
+ *
+ * \retval false when a device could not be simulated
+ */
+static bool fleet_run_devices( const char* log_dir );
+
+/*!
+ * Reads the transmissions and the requests of a device
+ */
+static bool fleet_load( const char* file_name, uint16_t device );
+
+/*!
+ * Places the devices and the gateways in the disc and draws the shadowing of each link
+ */
+static void fleet_place( void );
+
+/*!
+ * Tells whether a frame is received by a gateway, the frames of the devices above the count do not exist
+ */
+static bool fleet_is_received( uint32_t frame, uint16_t gateway, uint16_t device_nb );
+
+/*!
+ * Simulates the channel and the network server for the first devices, prints the report line
+ */
+static void fleet_report( uint16_t device_nb );
+
+/*!
+ * Draws in ]0, 1], xorshift32 as the host simulation
+ */
+static double fleet_rng_uniform( void );
+
+/*!
+ * Orders the frame indexes by start time, then by device
+ */
+static int fleet_compare_start( const void* a, const void* b );
+
+/*!
+ * Orders the latencies
+ */
+static int fleet_compare_double( const void* a, const void* b );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+/**
+ * @brief Sizes a network: runs the real stack of each device in its own host simulation, then replays their
+ *        transmissions over a shared channel received by the gateways
+ *
+ *        The devices are placed at random in a disc with the gateways. A frame is received by a gateway when it is
+ *        above the sensitivity of its datarate and, against the frames overlapping it on the same channel and
+ *        spreading factor, above the capture threshold; Wi-Fi bursts on the channels 1, 6 and 11 destroy the frames
+ *        they overlap. The network server stub keeps the first copy of each frame counter. One line per device
+ *        count: fleet,<devices>,<gateways>,<frames>,<delivered>,<delivery %>,<mean latency ms>,<p95 latency ms>,
+ *        <airtime s>,<channel load %>
+ *
+ * @remark The channel does not feed back into the devices: their join accepts and DeviceTimeAns are always
+ *         received, the retransmissions and the ADR do not see the collisions. The delivery of the unconfirmed
+ *         uplinks is exact, the confirmed ones are an upper bound. The smaller counts are the first devices of the
+ *         largest one.
+ */
+int main( int argc, char** argv )
+{
+    char     log_dir[] = "/tmp/fleet_simXXXXXX";
+    char     file_name[sizeof( log_dir ) + 16];
+    uint16_t device_nb = 0;
+
+    if( fleet_parse_args( argc, argv ) == false )
+    {
+        printf( "usage: %s [--devices n[,n...]] [--gateways n] [--radius m] [--wifi percent] [--capture db]"
+                " [--seed n] [--host-sim path] [-- host_sim options]\n",
+                argv[0] );
+        return EXIT_FAILURE;
+    }
+    for( uint8_t i = 0; i < fleet_device_count_nb; i++ )
+    {
+        device_nb = ( fleet_device_counts[i] > device_nb ) ? fleet_device_counts[i] : device_nb;
+    }
+    fleet_device_nb = device_nb;
+    fleet_devices   = calloc( device_nb, sizeof( fleet_device_t ) );
+    fleet_gateways  = calloc( fleet_gateway_nb * 2, sizeof( double ) );
+    fleet_link_db   = calloc( ( size_t ) device_nb * fleet_gateway_nb, sizeof( double ) );
+    if( ( fleet_devices == NULL ) || ( fleet_gateways == NULL ) || ( fleet_link_db == NULL ) ||
+        ( mkdtemp( log_dir ) == NULL ) )
+    {
+        return EXIT_FAILURE;
+    }
+
+    if( fleet_run_devices( log_dir ) == false )
+    {
+        printf( "fleet_sim: a device simulation failed, see %s\n", log_dir );
+        return EXIT_FAILURE;
+    }
+    for( uint16_t device = 0; device < device_nb; device++ )
+    {
+        snprintf( file_name, sizeof( file_name ), "%s/%u.csv", log_dir, device + 1 );
+        if( fleet_load( file_name, device ) == false )
+        {
+            printf( "fleet_sim: cannot read %s\n", file_name );
+            return EXIT_FAILURE;
+        }
+        remove( file_name );
+    }
+    remove( log_dir );
+
+    fleet_by_start  = malloc( ( fleet_frame_nb + 1 ) * sizeof( uint32_t ) );
+    fleet_latencies = malloc( ( fleet_request_nb + 1 ) * sizeof( double ) );
+    if( ( fleet_by_start == NULL ) || ( fleet_latencies == NULL ) )
+    {
+        return EXIT_FAILURE;
+    }
+    for( uint32_t i = 0; i < fleet_frame_nb; i++ )
+    {
+        fleet_by_start[i] = i;
+    }
+    qsort( fleet_by_start, fleet_frame_nb, sizeof( uint32_t ), fleet_compare_start );
+
+    fleet_place( );
+    for( uint8_t i = 0; i < fleet_device_count_nb; i++ )
+    {
+        fleet_report( fleet_device_counts[i] );
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool fleet_parse_args( int argc, char** argv )
+{
+    static char host_sim[4096];
+    const char* slash = strrchr( argv[0], '/' );
+
+    // by default the host simulation is built next to the fleet simulation
+    snprintf( host_sim, sizeof( host_sim ), "%.*shost_sim", ( slash != NULL ) ? ( int ) ( slash - argv[0] + 1 ) : 0,
+              argv[0] );
+    fleet_host_sim = host_sim;
+
+    for( int i = 1; i < argc; i++ )
+    {
+        bool has_value = ( i + 1 ) < argc;
+
+        if( strcmp( argv[i], "--" ) == 0 )
+        {
+            fleet_host_sim_args = &argv[i + 1];
+            fleet_host_sim_argc = argc - i - 1;
+            break;
+        }
+        else if( has_value == false )
+        {
+            return false;
+        }
+        else if( strcmp( argv[i], "--devices" ) == 0 )
+        {
+            char* count = argv[++i];
+
+            do
+            {
+                if( fleet_device_count_nb >= ( sizeof( fleet_device_counts ) / sizeof( fleet_device_counts[0] ) ) )
+                {
+                    return false;
+                }
+                fleet_device_counts[fleet_device_count_nb] = ( uint32_t ) strtoul( count, &count, 0 );
+                if( ( fleet_device_counts[fleet_device_count_nb] == 0 ) ||
+                    ( fleet_device_counts[fleet_device_count_nb] > FLEET_MAX_DEVICES ) )
+                {
+                    return false;
+                }
+                fleet_device_count_nb++;
+            } while( *count++ == ',' );
+        }
+        else if( strcmp( argv[i], "--gateways" ) == 0 )
+        {
+            fleet_gateway_nb = ( uint16_t ) strtoul( argv[++i], NULL, 0 );
+        }
+        else if( strcmp( argv[i], "--radius" ) == 0 )
+        {
+            fleet_radius_m = strtod( argv[++i], NULL );
+        }
+        else if( strcmp( argv[i], "--wifi" ) == 0 )
+        {
+            // airtime of each Wi-Fi channel seen by each gateway
+            fleet_wifi_percent = strtod( argv[++i], NULL );
+        }
+        else if( strcmp( argv[i], "--capture" ) == 0 )
+        {
+            fleet_capture_db = strtod( argv[++i], NULL );
+        }
+        else if( strcmp( argv[i], "--seed" ) == 0 )
+        {
+            // placement of the devices and gateways, the devices keep their own seeds
+            fleet_rng_state = ( uint32_t ) strtoul( argv[++i], NULL, 0 );
+        }
+        else if( strcmp( argv[i], "--host-sim" ) == 0 )
+        {
+            fleet_host_sim = argv[++i];
+        }
+        else
+        {
+            return false;
+        }
+    }
+    if( fleet_device_count_nb == 0 )
+    {
+        fleet_device_counts[fleet_device_count_nb++] = 100;
+    }
+    return ( fleet_gateway_nb > 0 ) && ( fleet_radius_m > 0 ) && ( fleet_wifi_percent >= 0 ) &&
+           ( fleet_wifi_percent < 100 ) && ( fleet_rng_state != 0 );
+}
+
+static bool fleet_run_devices( const char* log_dir )
+{
+    const long max_running = sysconf( _SC_NPROCESSORS_ONLN );
+    long       running     = 0;
+    bool       is_ok       = true;
+    char       seed[16];
+    char       file_name[4096];
+    char**     args = calloc( fleet_host_sim_argc + 7, sizeof( char* ) );
+
+    if( args == NULL )
+    {
+        return false;
+    }
+    args[0] = ( char* ) fleet_host_sim;
+    args[1] = "--seed";
+    args[2] = seed;
+    args[3] = "--join";
+    args[4] = "--tx-log";
+    args[5] = file_name;
+    for( int i = 0; i < fleet_host_sim_argc; i++ )
+    {
+        args[6 + i] = fleet_host_sim_args[i];
+    }
+
+    for( uint32_t device = 0; ( device < fleet_device_nb ) || ( running > 0 ); )
+    {
+        int status;
+
+        if( ( device < fleet_device_nb ) && ( running < max_running ) )
+        {
+            snprintf( seed, sizeof( seed ), "%u", device + 1 );
+            snprintf( file_name, sizeof( file_name ), "%s/%u.csv", log_dir, device + 1 );
+            if( fork( ) == 0 )
+            {
+                // the summary line of each device is not needed
+                const int null_fd = open( "/dev/null", O_WRONLY );
+
+                dup2( null_fd, STDOUT_FILENO );
+                execv( fleet_host_sim, args );
+                _exit( EXIT_FAILURE );
+            }
+            running++;
+            device++;
+            continue;
+        }
+        if( wait( &status ) > 0 )
+        {
+            running--;
+            if( ( WIFEXITED( status ) == 0 ) || ( WEXITSTATUS( status ) != EXIT_SUCCESS ) )
+            {
+                is_ok = false;
+            }
+        }
+        else
+        {
+            running = 0;
+        }
+    }
+    free( args );
+    return is_ok;
+}
+
+static bool fleet_load( const char* file_name, uint16_t device )
+{
+    static uint32_t frame_size   = 0;
+    static uint32_t request_size = 0;
+    FILE*           file         = fopen( file_name, "r" );
+    char            line[256];
+
+    if( file == NULL )
+    {
+        return false;
+    }
+    fleet_devices[device].request_first = fleet_request_nb;
+    while( fgets( line, sizeof( line ), file ) != NULL )
+    {
+        unsigned long long time_us;
+        unsigned int       toa_us, freq_in_hz, sf, bw_in_hz, size, mtype, dev_addr, fcnt;
+        int                pwr_in_dbm, fport;
+
+        if( fleet_frame_nb == frame_size )
+        {
+            frame_size   = ( frame_size == 0 ) ? 4096 : frame_size * 2;
+            fleet_frames = realloc( fleet_frames, frame_size * sizeof( fleet_frame_t ) );
+        }
+        if( fleet_request_nb == request_size )
+        {
+            request_size   = ( request_size == 0 ) ? 4096 : request_size * 2;
+            fleet_requests = realloc( fleet_requests, request_size * sizeof( uint64_t ) );
+        }
+        if( ( fleet_frames == NULL ) || ( fleet_requests == NULL ) )
+        {
+            fclose( file );
+            return false;
+        }
+        if( sscanf( line, "req,%llu", &time_us ) == 1 )
+        {
+            fleet_requests[fleet_request_nb++] = time_us;
+            fleet_devices[device].request_nb++;
+        }
+        else if( sscanf( line, "tx,%llu,%u,%u,%u,%u,%d,%u,%u,%u,%u,%d", &time_us, &toa_us, &freq_in_hz, &sf,
+                         &bw_in_hz, &pwr_in_dbm, &size, &mtype, &dev_addr, &fcnt, &fport ) == 11 )
+        {
+            fleet_frame_t* frame = &fleet_frames[fleet_frame_nb++];
+
+            frame->start_us    = time_us;
+            frame->toa_us      = toa_us;
+            frame->freq_in_hz  = freq_in_hz;
+            frame->bw_in_hz    = bw_in_hz;
+            frame->sf          = ( uint8_t ) sf;
+            frame->pwr_in_dbm  = ( int8_t ) pwr_in_dbm;
+            frame->mtype       = ( uint8_t ) mtype;
+            frame->fcnt        = ( uint16_t ) fcnt;
+            frame->fport       = ( int16_t ) fport;
+            frame->device      = device;
+            frame->is_received = false;
+            fleet_max_toa_us   = ( toa_us > fleet_max_toa_us ) ? toa_us : fleet_max_toa_us;
+        }
+    }
+    fclose( file );
+    return true;
+}
+
+static void fleet_place( void )
+{
+    // free space loss at 1 m of the band center
+    const double ref_loss_db = 20 * log10( 4 * M_PI * FLEET_REF_FREQ_HZ / 299792458.0 );
+
+    // a single gateway is at the center, the others are spread as the devices
+    for( uint16_t gateway = 0; gateway < fleet_gateway_nb; gateway++ )
+    {
+        const double r     = ( fleet_gateway_nb == 1 ) ? 0 : fleet_radius_m * sqrt( fleet_rng_uniform( ) );
+        const double angle = 2 * M_PI * fleet_rng_uniform( );
+
+        fleet_gateways[gateway * 2]     = r * cos( angle );
+        fleet_gateways[gateway * 2 + 1] = r * sin( angle );
+    }
+    for( uint16_t device = 0; device < fleet_device_nb; device++ )
+    {
+        const double r     = fleet_radius_m * sqrt( fleet_rng_uniform( ) );
+        const double angle = 2 * M_PI * fleet_rng_uniform( );
+
+        fleet_devices[device].x = r * cos( angle );
+        fleet_devices[device].y = r * sin( angle );
+        for( uint16_t gateway = 0; gateway < fleet_gateway_nb; gateway++ )
+        {
+            const double dx       = fleet_devices[device].x - fleet_gateways[gateway * 2];
+            const double dy       = fleet_devices[device].y - fleet_gateways[gateway * 2 + 1];
+            const double distance = fmax( sqrt( dx * dx + dy * dy ), 1 );
+            // lognormal shadowing, Box-Muller
+            const double shadowing_db =
+                FLEET_SHADOWING_DB * sqrt( -2 * log( fleet_rng_uniform( ) ) ) * cos( 2 * M_PI * fleet_rng_uniform( ) );
+
+            fleet_link_db[device * fleet_gateway_nb + gateway] =
+                -( ref_loss_db + 10 * FLEET_PATH_LOSS_EXPONENT * log10( distance ) ) + shadowing_db;
+        }
+    }
+}
+
+static bool fleet_is_received( uint32_t frame, uint16_t gateway, uint16_t device_nb )
+{
+    const fleet_frame_t* rx     = &fleet_frames[fleet_by_start[frame]];
+    const uint64_t       end_us = rx->start_us + rx->toa_us;
+    const double power_dbm = rx->pwr_in_dbm + fleet_link_db[rx->device * fleet_gateway_nb + gateway];
+    // thermal noise in the bandwidth and the demodulation floor of the spreading factor
+    const double sensitivity_dbm =
+        -174 + 10 * log10( rx->bw_in_hz ) + FLEET_NOISE_FIGURE_DB - 2.5 * ( ( double ) rx->sf - 4 );
+    double interference_mw = 0;
+
+    if( power_dbm < sensitivity_dbm )
+    {
+        return false;
+    }
+    // the frames of the same channel and spreading factor overlapping it, the others are orthogonal
+    for( int64_t i = ( int64_t ) frame - 1; i >= 0; i-- )
+    {
+        const fleet_frame_t* other = &fleet_frames[fleet_by_start[i]];
+
+        if( ( other->start_us + fleet_max_toa_us ) <= rx->start_us )
+        {
+            break;
+        }
+        if( ( other->device < device_nb ) && ( other->freq_in_hz == rx->freq_in_hz ) && ( other->sf == rx->sf ) &&
+            ( ( other->start_us + other->toa_us ) > rx->start_us ) )
+        {
+            interference_mw +=
+                pow( 10, ( other->pwr_in_dbm + fleet_link_db[other->device * fleet_gateway_nb + gateway] ) / 10 );
+        }
+    }
+    for( uint32_t i = frame + 1; ( i < fleet_frame_nb ) && ( fleet_frames[fleet_by_start[i]].start_us < end_us ); i++ )
+    {
+        const fleet_frame_t* other = &fleet_frames[fleet_by_start[i]];
+
+        if( ( other->device < device_nb ) && ( other->freq_in_hz == rx->freq_in_hz ) && ( other->sf == rx->sf ) )
+        {
+            interference_mw +=
+                pow( 10, ( other->pwr_in_dbm + fleet_link_db[other->device * fleet_gateway_nb + gateway] ) / 10 );
+        }
+    }
+    if( ( interference_mw > 0 ) && ( ( power_dbm - 10 * log10( interference_mw ) ) < fleet_capture_db ) )
+    {
+        return false;
+    }
+    // a burst on a Wi-Fi channel covering the frame: the Poisson bursts start in the frame or in the burst before it
+    for( uint8_t channel = 0; channel < FLEET_WIFI_CHANNEL_NB; channel++ )
+    {
+        const double rate_per_us = ( fleet_wifi_percent / 100 ) / FLEET_WIFI_BURST_US;
+        const double distance_hz = fabs( ( double ) rx->freq_in_hz - fleet_wifi_freq_hz[channel] );
+
+        if( ( fleet_wifi_percent > 0 ) && ( distance_hz < ( FLEET_WIFI_HALF_WIDTH_HZ + rx->bw_in_hz / 2 ) ) &&
+            ( fleet_rng_uniform( ) > exp( -rate_per_us * ( rx->toa_us + FLEET_WIFI_BURST_US ) ) ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void fleet_report( uint16_t device_nb )
+{
+    uint32_t frame_nb     = 0;
+    uint32_t delivered_nb = 0;
+    uint32_t latency_nb   = 0;
+    double   latency_sum  = 0;
+    double   airtime_s    = 0;
+    uint64_t last_end_us  = 0;
+    uint32_t channels[8]  = { 0 };
+    uint8_t  channel_nb   = 0;
+
+    // the channel at the gateways
+    for( uint32_t i = 0; i < fleet_frame_nb; i++ )
+    {
+        fleet_frame_t* frame = &fleet_frames[fleet_by_start[i]];
+        uint8_t        channel;
+
+        if( frame->device >= device_nb )
+        {
+            continue;
+        }
+        frame->is_received = false;
+        for( uint16_t gateway = 0; ( gateway < fleet_gateway_nb ) && ( frame->is_received == false ); gateway++ )
+        {
+            frame->is_received = fleet_is_received( i, gateway, device_nb );
+        }
+        airtime_s += frame->toa_us / 1e6;
+        last_end_us = ( ( frame->start_us + frame->toa_us ) > last_end_us ) ? frame->start_us + frame->toa_us
+                                                                             : last_end_us;
+        for( channel = 0; ( channel < channel_nb ) && ( channels[channel] != frame->freq_in_hz ); channel++ )
+        {
+        }
+        if( ( channel == channel_nb ) && ( channel_nb < ( sizeof( channels ) / sizeof( channels[0] ) ) ) )
+        {
+            channels[channel_nb++] = frame->freq_in_hz;
+        }
+    }
+
+    // the network server stub: the data frames of a device in order, the retransmissions of a counter are grouped
+    // and an application frame carries the last request before it, the requests superseded while waiting are lost
+    for( uint32_t i = 0, request = 0; i < fleet_frame_nb; )
+    {
+        const fleet_frame_t* first      = &fleet_frames[i];
+        const uint16_t       device     = first->device;
+        const bool           is_data    = ( first->mtype == 2 ) || ( first->mtype == 4 );
+        uint64_t             deliver_us = UINT64_MAX;
+
+        if( ( i == 0 ) || ( fleet_frames[i - 1].device != device ) )
+        {
+            request = 0;
+        }
+        if( ( device >= device_nb ) || ( is_data == false ) )
+        {
+            i++;
+            continue;
+        }
+        for( ; ( i < fleet_frame_nb ) && ( fleet_frames[i].device == device ) &&
+               ( fleet_frames[i].fcnt == first->fcnt ) && ( fleet_frames[i].mtype == first->mtype );
+             i++ )
+        {
+            const uint64_t end_us = fleet_frames[i].start_us + fleet_frames[i].toa_us;
+
+            if( ( fleet_frames[i].is_received == true ) && ( end_us < deliver_us ) )
+            {
+                deliver_us = end_us;
+            }
+        }
+        frame_nb++;
+        if( deliver_us != UINT64_MAX )
+        {
+            delivered_nb++;
+        }
+        if( first->fport != FLEET_APP_PORT )
+        {
+            continue;
+        }
+        const uint64_t* requests = &fleet_requests[fleet_devices[device].request_first];
+
+        while( ( ( request + 1 ) < fleet_devices[device].request_nb ) && ( requests[request + 1] <= first->start_us ) )
+        {
+            request++;
+        }
+        if( ( request < fleet_devices[device].request_nb ) && ( requests[request] <= first->start_us ) )
+        {
+            if( deliver_us != UINT64_MAX )
+            {
+                fleet_latencies[latency_nb] = ( deliver_us - requests[request] ) / 1e3;
+                latency_sum += fleet_latencies[latency_nb++];
+            }
+            request++;
+        }
+    }
+    qsort( fleet_latencies, latency_nb, sizeof( double ), fleet_compare_double );
+
+    printf( "fleet,%u,%u,%u,%u,%.1f,%.0f,%.0f,%.1f,%.2f\n", device_nb, fleet_gateway_nb, frame_nb, delivered_nb,
+            ( frame_nb > 0 ) ? ( 100.0 * delivered_nb ) / frame_nb : 0,
+            ( latency_nb > 0 ) ? latency_sum / latency_nb : 0,
+            ( latency_nb > 0 ) ? fleet_latencies[( latency_nb * 95 ) / 100] : 0, airtime_s,
+            ( ( last_end_us > 0 ) && ( channel_nb > 0 ) ) ? ( 100.0 * airtime_s * 1e6 ) / ( last_end_us * channel_nb )
+                                                          : 0 );
+}
+
+static double fleet_rng_uniform( void )
+{
+    fleet_rng_state ^= fleet_rng_state << 13;
+    fleet_rng_state ^= fleet_rng_state >> 17;
+    fleet_rng_state ^= fleet_rng_state << 5;
+    return ( fleet_rng_state + 1.0 ) / 4294967296.0;
+}
+
+static int fleet_compare_start( const void* a, const void* b )
+{
+    const fleet_frame_t* frame_a = &fleet_frames[*( const uint32_t* ) a];
+    const fleet_frame_t* frame_b = &fleet_frames[*( const uint32_t* ) b];
+
+    if( frame_a->start_us != frame_b->start_us )
+    {
+        return ( frame_a->start_us < frame_b->start_us ) ? -1 : 1;
+    }
+    return ( int ) frame_a->device - ( int ) frame_b->device;
+}
+
+static int fleet_compare_double( const void* a, const void* b )
+{
+    const double value_a = *( const double* ) a;
+    const double value_b = *( const double* ) b;
+
+    return ( value_a > value_b ) - ( value_a < value_b );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,861 @@
+/*!
+ * \file      main_sim.c
+ *
+ * \brief     main program of the host simulation, one simulated device per process
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdio.h>    // printf
+#include <stdlib.h>   // strtoul
+#include <string.h>   // strcmp
+
+#include "smtc_bsp.h"
+#include "smtc_bsp_sim.h"
+#include "ral_sim.h"
+#include "modem_api.h"
+#include "lorawan_api.h"
+#include "device_management_defs.h"
+#include "radio_planner_trace.h"
+#include "file_upload.h"
+#include "crypto.h"
+#include "aes.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * Port of the periodic uplinks
+ */
+#define SIM_UPLINK_PORT 2
+
+/*!
+ * Size of the file sent by the file upload scenario
+ */
+#define SIM_FILE_UPLOAD_SIZE 4096
+
+/*!
+ * Longest join of the scenarios, the join accept comes in the first window
+ */
+#define SIM_JOIN_WINDOW_S 60
+
+/*!
+ * LoRaWAN MAC commands answered by the simulated network
+ */
+#define SIM_DEVICE_TIME_REQ 0x0D
+#define SIM_DEVICE_TIME_ANS 0x0D
+
+/*!
+ * Environment variable keeping the DevNonce of the session across the resets of the device, the network is not reset
+ */
+#define SIM_NETWORK_DEV_NONCE_ENV "SIM_NETWORK_DEV_NONCE"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * Frame sent by the simulated network in the next reception window
+ */
+typedef enum sim_downlink_e
+{
+    SIM_DOWNLINK_NONE,
+    SIM_DOWNLINK_JOIN_ACCEPT,
+    SIM_DOWNLINK_ACK,
+    SIM_DOWNLINK_DEVICE_TIME,
+} sim_downlink_t;
+
+/*!
+ * Standard transaction of the energy benchmark, measured from its start to its end event
+ */
+typedef struct sim_scenario_s
+{
+    const char*       name;
+    void              ( *start )( void );
+    modem_rsp_event_t end_event;  // RSP_NUMBER to measure the whole window
+    uint32_t          window_s;   // longest measurement, the scenario is reported as not done past it
+} sim_scenario_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static bsp_sim_config_t sim_config       = { .seed = 1, .nvm_file = NULL, .trace_on = false, .argv = NULL };
+static ral_sim_config_t sim_radio_config = {
+    .toa_percent = 100, .toa_offset_us = 0, .dl_loss_percent = 0, .is_irq_injected = false, .downlink = NULL,
+    .uplink = NULL
+};
+static uint32_t sim_duration_s   = 3600;
+static uint32_t sim_period_s     = 60;
+static uint8_t  sim_payload_size = 12;
+static FILE*    sim_tx_log       = NULL;
+#if defined( PERF_TEST_ENABLED )
+static FILE* sim_rp_trace = NULL;
+#endif
+
+// policies of the fleet, left to the modem defaults when not given
+static bool     sim_is_otaa        = false;
+static int16_t  sim_dm_interval    = -1;  // encoded as modem_set_dm_info_interval
+static uint8_t  sim_jitter_percent = 0;
+static int16_t  sim_adr_profile    = -1;  // dr_strategy_t
+static uint16_t sim_slot_period_s  = 0;
+static uint16_t sim_slot_ms        = 0;
+
+static uint32_t sim_request_nb = 0;
+static uint32_t sim_txdone_nb  = 0;
+
+static const sim_scenario_t* sim_scenario         = NULL;
+static bool                  sim_scenario_started = false;
+static bool                  sim_scenario_done    = false;
+static bool                  sim_is_joined        = false;
+static bool                  sim_join_requested   = false;
+static sim_downlink_t        sim_downlink         = SIM_DOWNLINK_NONE;
+static uint16_t              sim_fcnt_down        = 0;
+static uint16_t              sim_dev_nonce        = 0;  // DevNonce of the join request accepted
+static bool                  sim_is_restored      = false;  // the session was restored after a reset
+static bool                  sim_is_replay_acked  = false;  // the replayed acknowledgement was accepted
+static uint32_t              sim_mic_error_nb     = 0;  // uplinks the network could not authenticate
+static uint64_t              sim_uplink_end_us    = 0;  // time given by the DeviceTimeAns
+static uint8_t               sim_file[SIM_FILE_UPLOAD_SIZE];
+
+static uint8_t sim_nwk_s_key[16] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+                                     0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+static uint8_t sim_app_s_key[16] = { 0x3C, 0x4F, 0xCF, 0x09, 0x88, 0x15, 0xF7, 0xAB,
+                                     0xA6, 0xD2, 0xAE, 0x28, 0x16, 0x15, 0x7E, 0x2B };
+static uint8_t sim_app_key[16]   = { 0 };
+static uint8_t sim_join_eui[8]   = { 0 };
+static uint8_t sim_dev_eui[8]    = { 0 };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+static bool sim_parse_args( int argc, char** argv );
+static void sim_get_event( void );
+static void sim_rp_trace_dump( void );
+static void sim_scenario_join( void );
+static void sim_scenario_uplink( void );
+static void sim_scenario_confirmed( void );
+static void sim_scenario_dm_status( void );
+static void sim_scenario_file_upload( void );
+static void sim_scenario_idle( void );
+static void sim_scenario_replay( void );
+static void sim_scenario_report( uint64_t start_us );
+static void sim_file_read( void* context, uint32_t offset, uint8_t* buffer, uint32_t length );
+static bool sim_network_downlink( const ral_sim_rx_window_t* window, uint8_t* payload, uint8_t* size,
+                                  uint32_t* delay_ms );
+static void sim_network_uplink( const ral_sim_tx_t* tx );
+static bool sim_device_time_is_requested( const uint8_t* cmds, uint8_t length );
+static uint32_t sim_lora_bw_in_hz( ral_lora_bw_t bw );
+
+// scenarios of the energy benchmark, every performance change is measured against them
+static const sim_scenario_t sim_scenarios[] = {
+    { "join", sim_scenario_join, RSP_JOINED, SIM_JOIN_WINDOW_S },
+    { "uplink", sim_scenario_uplink, RSP_TXDONE, 60 },
+    { "confirmed", sim_scenario_confirmed, RSP_TXDONE, 60 },
+    { "dm_status", sim_scenario_dm_status, RSP_NUMBER, 60 },
+    { "file_upload", sim_scenario_file_upload, RSP_FILEDONE, 3600 },
+    { "idle", sim_scenario_idle, RSP_NUMBER, 3600 },
+    // not a benchmark: a reset then the replay of the last downlink, done when the device rejects it
+    { "replay", sim_scenario_replay, RSP_TXDONE, 60 },
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+/**
+ * @brief Runs one ABP device sending periodic unconfirmed uplinks for the requested virtual duration, then prints
+ *        a summary line: sim,<seed>,<resets>,<uplink requests>,<tx done events>,<transmissions>,<airtime ms>,
+ *        <rx windows>,<charge>,<mcu run ms>,<mcu stop ms>
+ *
+ * @remark The counters start again after each MCU reset, as the RAM of the device. With --scenario, the device
+ *         joins a simulated network and runs one transaction of the energy benchmark instead, then prints:
+ *         scenario,<name>,<done>,<duration ms>,<mcu run ms>,<mcu stop ms>,<wakeups>,<radio tx ms>,<radio rx ms>,
+ *         <charge uAh>
+ *
+ *         With --join, the device joins the simulated network at a random time of the first period before its
+ *         uplinks. With --tx-log, each accepted uplink request and each LoRa transmission is appended to the given
+ *         file, the input of fleet_sim:
+ *         req,<time us>
+ *         tx,<start us>,<time on air us>,<freq hz>,<sf>,<bw hz>,<power dbm>,<size>,<mtype>,<devaddr>,<fcnt>,<fport>
+ *         with a fport of -1 for the frames without port, and a devaddr and fcnt of 0 for the join requests.
+ */
+int main( int argc, char** argv )
+{
+    uint8_t               payload[255] = { 0 };
+    uint64_t              next_uplink_us;
+    uint64_t              duration_us;
+    ral_sim_stats_t       radio_stats;
+    bsp_mcu_power_stats_t mcu_stats;
+    uint32_t              charge = 0;
+    uint32_t              engine_deadline_ms;
+    uint64_t              scenario_start_us = 0;
+
+    if( sim_parse_args( argc, argv ) == false )
+    {
+        printf( "usage: %s [--seed n] [--nvm file] [--duration s] [--period s] [--size bytes] [--toa percent]"
+                " [--loss percent] [--battery level] [--trace] [--rp-trace file] [--scenario name] [--join]"
+                " [--tx-log file] [--dm-interval code] [--jitter percent] [--adr profile] [--slot period_s,slot_ms]\n",
+                argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    // a MCU reset runs the simulator again, the NVM and the virtual time are kept
+    sim_config.argv = argv;
+    if( getenv( SIM_NETWORK_DEV_NONCE_ENV ) != NULL )
+    {
+        sim_dev_nonce = ( uint16_t ) strtoul( getenv( SIM_NETWORK_DEV_NONCE_ENV ), NULL, 0 );
+    }
+    bsp_sim_init( &sim_config );
+    ral_sim_set_config( &sim_radio_config );
+
+    bsp_disable_irq( );
+    bsp_mcu_init( );
+    modem_init( &sim_get_event );
+    bsp_enable_irq( );
+
+    // each seed is a distinct device, with its own address and random draws
+    sim_dev_eui[7]      = ( uint8_t ) sim_config.seed;
+    sim_dev_eui[6]      = ( uint8_t )( sim_config.seed >> 8 );
+    lorawan_keys_t keys = { .LoRaMacNwkSKey = sim_nwk_s_key,
+                            .LoRaMacAppSKey = sim_app_s_key,
+                            .LoRaMacAppKey  = sim_app_key,
+                            .AppEui         = sim_join_eui,
+                            .DevEui         = sim_dev_eui,
+                            .LoRaDevAddr    = 0x26000000 | ( sim_config.seed & 0x00FFFFFF ),
+                            .otaaDevice     = ABP_DEVICE };
+    if( ( sim_scenario != NULL ) || ( sim_is_otaa == true ) )
+    {
+        // the simulated network answers the transaction, the rest of the device activity is measured with it
+        keys.otaaDevice           = OTAA_DEVICE;
+        sim_radio_config.downlink = sim_network_downlink;
+        sim_radio_config.uplink   = sim_network_uplink;
+    }
+    if( sim_tx_log != NULL )
+    {
+        sim_radio_config.uplink = sim_network_uplink;
+    }
+    ral_sim_set_config( &sim_radio_config );
+    if( ( keys.otaaDevice == OTAA_DEVICE ) && ( lorawan_api_is_ota_device( ) == OTAA_DEVICE ) &&
+        ( lorawan_api_isjoined( ) == JOINED ) )
+    {  // the session restored after a reset, setting the keys again would erase it
+        sim_is_restored = true;
+    }
+    else
+    {
+        lorawan_api_keys_set( keys );
+    }
+
+    if( sim_dm_interval >= 0 )
+    {
+        modem_set_dm_info_interval( ( uint8_t ) sim_dm_interval );
+    }
+    if( sim_jitter_percent > 0 )
+    {
+        modem_set_task_jitter( sim_jitter_percent );
+    }
+    if( sim_adr_profile >= 0 )
+    {
+        uint8_t adr_custom_data[16] = { 0 };
+
+        modem_set_adr_profile( ( dr_strategy_t ) sim_adr_profile, adr_custom_data );
+    }
+    if( sim_slot_period_s > 0 )
+    {
+        modem_set_tx_slot( sim_slot_period_s, sim_slot_ms );
+    }
+
+    // the devices of a fleet start at random times within the first period
+    duration_us    = ( uint64_t ) sim_duration_s * 1000000;
+    next_uplink_us = ( uint64_t ) bsp_rng_get_random_in_range( 0, sim_period_s * 1000 ) * 1000;
+    engine_deadline_ms = bsp_rtc_get_time_ms( );
+    if( sim_scenario != NULL )
+    {
+        // the device joins first, the join scenario measures it. The window end takes the place of the next uplink,
+        // so that the device does not sleep past it.
+        scenario_start_us    = bsp_sim_get_time_us( );
+        duration_us          = scenario_start_us + ( uint64_t ) SIM_JOIN_WINDOW_S * 1000000;
+        next_uplink_us       = duration_us;
+        sim_scenario_started = ( sim_scenario->start == sim_scenario_join );
+        modem_reset_charge( );
+        if( sim_is_restored == true )
+        {
+            sim_is_joined = true;
+        }
+        else
+        {
+            sim_scenario_join( );
+        }
+    }
+    while( ( bsp_sim_get_time_us( ) < duration_us ) && ( sim_scenario_done == false ) )
+    {
+        uint32_t sleep_time_ms;
+        uint8_t  wakeup_sources = bsp_mcu_wakeup_sources_get( );
+
+        if( ( sim_scenario == NULL ) && ( bsp_sim_get_time_us( ) >= next_uplink_us ) )
+        {
+            if( ( sim_is_otaa == true ) && ( sim_is_joined == false ) )
+            {
+                // the join takes the place of the first uplink, the fleet does not power up at once
+                if( sim_join_requested == false )
+                {
+                    sim_join_requested = true;
+                    sim_scenario_join( );
+                }
+            }
+            else
+            {
+                payload[0] = ( uint8_t ) sim_request_nb;
+                if( modem_request_tx( SIM_UPLINK_PORT, TX_UNCONFIRMED, payload, sim_payload_size ) == RC_OK )
+                {
+                    sim_request_nb++;
+                    if( sim_tx_log != NULL )
+                    {
+                        fprintf( sim_tx_log, "req,%llu\n", ( unsigned long long ) bsp_sim_get_time_us( ) );
+                        fflush( sim_tx_log );
+                    }
+                }
+            }
+            next_uplink_us += ( uint64_t ) sim_period_s * 1000000;
+            wakeup_sources |= BSP_MCU_WAKEUP_APP;
+        }
+        else if( ( sim_scenario != NULL ) && ( sim_scenario_started == false ) && ( sim_is_joined == true ) )
+        {
+            scenario_start_us    = bsp_sim_get_time_us( );
+            duration_us          = scenario_start_us + ( uint64_t ) sim_scenario->window_s * 1000000;
+            next_uplink_us       = duration_us;
+            sim_scenario_started = true;
+            modem_reset_charge( );
+            sim_scenario->start( );
+            wakeup_sources |= BSP_MCU_WAKEUP_APP;
+        }
+
+        // as the target main loop, the engine only runs for its own deadline and the wake-up requests
+        int32_t remaining_ms = ( int32_t ) ( engine_deadline_ms - bsp_rtc_get_time_ms( ) );
+        if( ( wakeup_sources != 0 ) || ( remaining_ms <= 0 ) )
+        {
+            sleep_time_ms      = modem_run_engine( );
+            engine_deadline_ms = bsp_rtc_get_time_ms( ) + sleep_time_ms;
+            if( sim_scenario != NULL )
+            {
+                // as a host on the event line, the events pushed by the tasks of this run are read right away
+                sim_get_event( );
+            }
+        }
+        else
+        {
+            sleep_time_ms = ( uint32_t ) remaining_ms;
+        }
+        if( ( ( uint64_t ) sleep_time_ms * 1000 + bsp_sim_get_time_us( ) ) > next_uplink_us )
+        {
+            sleep_time_ms = ( uint32_t )( ( next_uplink_us - bsp_sim_get_time_us( ) + 999 ) / 1000 );
+        }
+        sim_rp_trace_dump( );
+        bsp_mcu_set_sleep_for_ms( ( int32_t ) sleep_time_ms );
+    }
+    sim_rp_trace_dump( );
+    if( sim_scenario != NULL )
+    {
+        sim_scenario_report( scenario_start_us );
+        return EXIT_SUCCESS;
+    }
+
+    ral_sim_get_stats( &radio_stats );
+    bsp_mcu_get_power_stats( &mcu_stats );
+    modem_get_charge( &charge );
+    printf( "sim,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", sim_config.seed, bsp_sim_get_reset_nb( ), sim_request_nb,
+            sim_txdone_nb, radio_stats.tx_nb, radio_stats.tx_airtime_ms, radio_stats.rx_nb, charge,
+            mcu_stats.run_time_ms, mcu_stats.stop_time_ms );
+    return EXIT_SUCCESS;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool sim_parse_args( int argc, char** argv )
+{
+    for( int i = 1; i < argc; i++ )
+    {
+        bool has_value = ( i + 1 ) < argc;
+
+        if( strcmp( argv[i], "--trace" ) == 0 )
+        {
+            sim_config.trace_on = true;
+        }
+        else if( strcmp( argv[i], "--join" ) == 0 )
+        {
+            sim_is_otaa = true;
+        }
+        else if( has_value == false )
+        {
+            return false;
+        }
+        else if( strcmp( argv[i], "--seed" ) == 0 )
+        {
+            // xorshift32 generator seed, any value gives a valid device
+            sim_config.seed = ( uint32_t ) strtoul( argv[++i], NULL, 0 );
+        }
+        else if( strcmp( argv[i], "--nvm" ) == 0 )
+        {
+            sim_config.nvm_file = argv[++i];
+        }
+        else if( strcmp( argv[i], "--duration" ) == 0 )
+        {
+            sim_duration_s = ( uint32_t ) strtoul( argv[++i], NULL, 0 );
+        }
+        else if( strcmp( argv[i], "--period" ) == 0 )
+        {
+            sim_period_s = ( uint32_t ) strtoul( argv[++i], NULL, 0 );
+        }
+        else if( strcmp( argv[i], "--size" ) == 0 )
+        {
+            sim_payload_size = ( uint8_t ) strtoul( argv[++i], NULL, 0 );
+        }
+        else if( strcmp( argv[i], "--toa" ) == 0 )
+        {
+            sim_radio_config.toa_percent = ( uint16_t ) strtoul( argv[++i], NULL, 0 );
+        }
+        else if( strcmp( argv[i], "--loss" ) == 0 )
+        {
+            sim_radio_config.dl_loss_percent = ( uint8_t ) strtoul( argv[++i], NULL, 0 );
+        }
+        else if( strcmp( argv[i], "--battery" ) == 0 )
+        {
+            // LoRaWAN battery level [1: empty, 254: full]
+            sim_config.battery_level = ( uint8_t ) strtoul( argv[++i], NULL, 0 );
+        }
+        else if( strcmp( argv[i], "--scenario" ) == 0 )
+        {
+            const char* name = argv[++i];
+
+            for( uint8_t n = 0; n < ( sizeof( sim_scenarios ) / sizeof( sim_scenarios[0] ) ); n++ )
+            {
+                if( strcmp( name, sim_scenarios[n].name ) == 0 )
+                {
+                    sim_scenario = &sim_scenarios[n];
+                }
+            }
+            if( sim_scenario == NULL )
+            {
+                return false;
+            }
+        }
+        else if( strcmp( argv[i], "--tx-log" ) == 0 )
+        {
+            // appended to on each run as it spans the MCU resets
+            sim_tx_log = fopen( argv[++i], "a" );
+            if( sim_tx_log == NULL )
+            {
+                return false;
+            }
+        }
+        else if( strcmp( argv[i], "--dm-interval" ) == 0 )
+        {
+            sim_dm_interval = ( int16_t ) strtoul( argv[++i], NULL, 0 );
+        }
+        else if( strcmp( argv[i], "--jitter" ) == 0 )
+        {
+            sim_jitter_percent = ( uint8_t ) strtoul( argv[++i], NULL, 0 );
+        }
+        else if( strcmp( argv[i], "--adr" ) == 0 )
+        {
+            sim_adr_profile = ( int16_t ) strtoul( argv[++i], NULL, 0 );
+        }
+        else if( strcmp( argv[i], "--slot" ) == 0 )
+        {
+            char* slot;
+
+            sim_slot_period_s = ( uint16_t ) strtoul( argv[++i], &slot, 0 );
+            if( *slot != ',' )
+            {
+                return false;
+            }
+            sim_slot_ms = ( uint16_t ) strtoul( slot + 1, NULL, 0 );
+        }
+#if defined( PERF_TEST_ENABLED )
+        else if( strcmp( argv[i], "--rp-trace" ) == 0 )
+        {
+            // input file of rp_replay, appended to on each run as it spans the MCU resets
+            sim_rp_trace = fopen( argv[++i], "ab" );
+            if( sim_rp_trace == NULL )
+            {
+                return false;
+            }
+        }
+#endif
+        else
+        {
+            return false;
+        }
+    }
+    return ( sim_period_s > 0 ) ? true : false;
+}
+
+static void sim_get_event( void )
+{
+    modem_rsp_event_t type                   = RSP_NUMBER;
+    uint8_t           count                  = 0;
+    uint8_t           event_data[255]        = { 0 };
+    uint8_t           event_data_length      = 0;
+    uint8_t           asynchronous_msgnumber = 0;
+
+    do
+    {
+        modem_get_event( &type, &count, event_data, &event_data_length, &asynchronous_msgnumber );
+        if( type == RSP_TXDONE )
+        {
+            sim_txdone_nb++;
+            if( ( sim_scenario_started == true ) && ( sim_scenario->start == sim_scenario_replay ) )
+            {
+                if( sim_is_restored == false )
+                {  // the acknowledgement is received once, the device resets and gets it again
+                    bsp_mcu_reset( );
+                }
+                sim_is_replay_acked = ( event_data[0] == MODEM_TX_SUCCESS_WITH_ACK );
+            }
+        }
+        else if( type == RSP_JOINED )
+        {
+            sim_is_joined = true;
+        }
+        if( ( sim_scenario_started == true ) && ( sim_scenario->end_event != RSP_NUMBER ) &&
+            ( type == sim_scenario->end_event ) )
+        {
+            sim_scenario_done = true;
+        }
+    } while( asynchronous_msgnumber > 0 );
+}
+
+static void sim_rp_trace_dump( void )
+{
+#if defined( PERF_TEST_ENABLED )
+    uint8_t buffer[UINT8_MAX];
+    uint8_t length;
+
+    if( sim_rp_trace == NULL )
+    {
+        return;
+    }
+    // same dumps as the GETRPTRACE host command
+    do
+    {
+        length = rp_trace_dump( buffer, sizeof( buffer ) );
+        fwrite( buffer, 1, length, sim_rp_trace );
+    } while( buffer[2] > 0 );
+    fflush( sim_rp_trace );
+#endif
+}
+
+static void sim_scenario_join( void )
+{
+    sim_downlink  = SIM_DOWNLINK_JOIN_ACCEPT;
+    sim_fcnt_down = 0;
+    modem_join( );
+}
+
+static void sim_scenario_uplink( void )
+{
+    uint8_t payload[255] = { 0 };
+
+    modem_request_tx( SIM_UPLINK_PORT, TX_UNCONFIRMED, payload, sim_payload_size );
+}
+
+static void sim_scenario_confirmed( void )
+{
+    uint8_t payload[255] = { 0 };
+
+    sim_downlink = SIM_DOWNLINK_ACK;
+    modem_request_tx( SIM_UPLINK_PORT, TX_CONFIRMED, payload, sim_payload_size );
+}
+
+static void sim_scenario_dm_status( void )
+{
+    uint8_t fields[e_inf_max];
+    uint8_t length = 0;
+
+    // the fields of the periodic status
+    modem_get_dm_info_fields( fields, &length );
+    modem_send_dm_status( fields, length );
+}
+
+static void sim_scenario_file_upload( void )
+{
+    for( uint16_t i = 0; i < SIM_FILE_UPLOAD_SIZE; i++ )
+    {
+        sim_file[i] = ( uint8_t )( i * 7 + 1 );
+    }
+    modem_upload_init( 0, SIM_UPLINK_PORT, FILE_UPLOAD_NOT_ENCRYPTED, SIM_FILE_UPLOAD_SIZE, 0 );
+    modem_upload_start_from_reader( 0, sim_file_read, NULL, SIM_FILE_UPLOAD_SIZE );
+}
+
+static void sim_scenario_idle( void )
+{
+}
+
+static void sim_scenario_replay( void )
+{
+    uint8_t payload[255] = { 0 };
+
+    // the same acknowledgement, with the same counter, before and after the reset: sim_fcnt_down is in the RAM
+    sim_downlink = SIM_DOWNLINK_ACK;
+    modem_request_tx( SIM_UPLINK_PORT, TX_CONFIRMED, payload, sim_payload_size );
+}
+
+static void sim_scenario_report( uint64_t start_us )
+{
+    modem_energy_t energy;
+
+    // a scenario without end event is done once its whole window is measured
+    const bool is_done = ( sim_scenario_started == true ) && ( sim_is_replay_acked == false ) &&
+                         ( sim_mic_error_nb == 0 ) &&
+                         ( ( sim_scenario_done == true ) || ( sim_scenario->end_event == RSP_NUMBER ) );
+
+    modem_get_energy( &energy );
+    printf( "scenario,%s,%u,%u,%u,%u,%u,%u,%u,%u\n", sim_scenario->name, ( is_done == true ) ? 1 : 0,
+            ( uint32_t )( ( bsp_sim_get_time_us( ) - start_us ) / 1000 ), energy.mcu_run_ms, energy.mcu_stop_ms,
+            energy.wakeup_nb, energy.radio_tx_ms, energy.radio_rx_ms, energy.charge_uah );
+}
+
+static void sim_file_read( void* context, uint32_t offset, uint8_t* buffer, uint32_t length )
+{
+    memcpy( buffer, &sim_file[offset], length );
+}
+
+static bool sim_network_downlink( const ral_sim_rx_window_t* window, uint8_t* payload, uint8_t* size,
+                                  uint32_t* delay_ms )
+{
+    static const uint8_t app_nonce[6] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00 };  // app nonce and net id
+    lora_crypto_ctx_t    ctx;
+    uint32_t             mic;
+    const uint32_t       dev_addr = 0x26000000 | ( sim_config.seed & 0x00FFFFFF );
+
+    // a gateway in range answers in the first window after the uplink, the frame ends in the middle of the window
+    if( ( sim_downlink == SIM_DOWNLINK_NONE ) || ( window->pkt_type != RAL_PKT_TYPE_LORA ) )
+    {
+        return false;
+    }
+    *delay_ms = window->timeout_ms / 2;
+    if( sim_downlink == SIM_DOWNLINK_JOIN_ACCEPT )
+    {
+        aes_context aes;
+        uint8_t     block[16];
+        char        dev_nonce[8];
+
+        // app nonce, net id, the device address, DL settings (RX2 at DR0, no RX1 offset) and RX delay of 1 s
+        payload[0] = 0x20;
+        memcpy( &payload[1], app_nonce, 6 );
+        payload[7]  = dev_addr;
+        payload[8]  = dev_addr >> 8;
+        payload[9]  = dev_addr >> 16;
+        payload[10] = dev_addr >> 24;
+        payload[11] = 0x00;
+        payload[12] = 0x01;
+        join_compute_mic( &ctx, payload, 13, sim_app_key, &mic );
+        memcpy( block, &payload[1], 12 );
+        memcpy( &block[12], &mic, 4 );
+        // the network encrypts with the AES decryption so that the device decrypts with the encryption
+        aes_set_key( sim_app_key, 16, &aes );
+        aes_decrypt( block, &payload[1], &aes );
+        *size = 17;
+        // the session keys come from this DevNonce, the device moves its DevNonce on after a reset
+        sim_dev_nonce = lorawan_api_devnonce_get( );
+        snprintf( dev_nonce, sizeof( dev_nonce ), "%u", sim_dev_nonce );
+        setenv( SIM_NETWORK_DEV_NONCE_ENV, dev_nonce, 1 );
+    }
+    else
+    {
+        uint8_t nwk_s_key[16];
+        uint8_t app_s_key[16];
+        uint8_t length = 8;
+
+        // unconfirmed data down without payload: the ACK bit, or the DeviceTimeAns in the frame options. The
+        // virtual time is the GPS time of the network.
+        join_compute_skeys( &ctx, sim_app_key, app_nonce, sim_dev_nonce, nwk_s_key, app_s_key );
+        payload[0] = 0x60;
+        payload[1] = dev_addr;
+        payload[2] = dev_addr >> 8;
+        payload[3] = dev_addr >> 16;
+        payload[4] = dev_addr >> 24;
+        payload[5] = ( sim_downlink == SIM_DOWNLINK_ACK ) ? 0x20 : 0x00;
+        payload[6] = sim_fcnt_down;
+        payload[7] = sim_fcnt_down >> 8;
+        if( sim_downlink == SIM_DOWNLINK_DEVICE_TIME )
+        {
+            const uint32_t gps_time_s = ( uint32_t )( sim_uplink_end_us / 1000000 );
+
+            payload[5] |= 6;
+            payload[8]  = SIM_DEVICE_TIME_ANS;
+            payload[9]  = gps_time_s;
+            payload[10] = gps_time_s >> 8;
+            payload[11] = gps_time_s >> 16;
+            payload[12] = gps_time_s >> 24;
+            payload[13] = ( uint8_t )( ( ( sim_uplink_end_us % 1000000 ) * 256 ) / 1000000 );
+            length      = 14;
+        }
+        compute_mic( &ctx, payload, length, nwk_s_key, dev_addr, 1, sim_fcnt_down, &mic );
+        memcpy( &payload[length], &mic, 4 );
+        *size = length + 4;
+        sim_fcnt_down++;
+    }
+    sim_downlink = SIM_DOWNLINK_NONE;
+    return true;
+}
+
+static void sim_network_uplink( const ral_sim_tx_t* tx )
+{
+    uint8_t  mtype    = tx->payload[0] >> 5;
+    uint32_t dev_addr = 0;
+    uint16_t fcnt     = 0;
+    int16_t  fport    = -1;
+
+    // the join requests of the stack do not carry the standard header, they are told apart by the join state
+    if( ( lorawan_api_is_ota_device( ) == OTAA_DEVICE ) && ( lorawan_api_isjoined( ) != JOINED ) )
+    {
+        mtype = 0;
+    }
+    // data up frames: MHDR, DevAddr, FCtrl, FCnt, FOpts, then the port when there is a payload, and the MIC
+    if( ( ( mtype == 2 ) || ( mtype == 4 ) ) && ( tx->size >= 12 ) &&
+        ( tx->size >= ( 12 + ( tx->payload[5] & 0x0F ) ) ) )
+    {
+        const uint8_t     fopts_length = tx->payload[5] & 0x0F;
+        lora_crypto_ctx_t ctx;
+        uint8_t           nwk_s_key[16];
+        uint8_t           app_s_key[16];
+        uint8_t           cmds[255];
+        uint8_t           cmds_length = fopts_length;
+        uint32_t          mic;
+
+        dev_addr = tx->payload[1] | ( tx->payload[2] << 8 ) | ( tx->payload[3] << 16 ) |
+                   ( ( uint32_t ) tx->payload[4] << 24 );
+        fcnt     = tx->payload[6] | ( tx->payload[7] << 8 );
+        // the network authenticates the frame with the keys of the session, computed on its side
+        if( lorawan_api_is_ota_device( ) == OTAA_DEVICE )
+        {
+            static const uint8_t app_nonce[6] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00 };
+
+            join_compute_skeys( &ctx, sim_app_key, app_nonce, sim_dev_nonce, nwk_s_key, app_s_key );
+        }
+        else
+        {
+            memcpy( nwk_s_key, sim_nwk_s_key, 16 );
+            memcpy( app_s_key, sim_app_s_key, 16 );
+        }
+        compute_mic( &ctx, tx->payload, tx->size - 4, nwk_s_key, dev_addr, 0, fcnt, &mic );
+        if( memcmp( &mic, &tx->payload[tx->size - 4], 4 ) != 0 )
+        {
+            sim_mic_error_nb++;
+            fprintf( stderr, "uplink %u of %08x: wrong MIC\n", fcnt, dev_addr );
+        }
+        // the MAC commands are in the fopts, or in the payload on port 0 decrypted with the network key
+        memcpy( cmds, &tx->payload[8], fopts_length );
+        if( tx->size > ( 12 + fopts_length ) )
+        {
+            fport = tx->payload[8 + fopts_length];
+            if( fport == 0 )
+            {
+                cmds_length = tx->size - 13 - fopts_length;
+                lora_crypto_payload_encrypt( &ctx, &tx->payload[9 + fopts_length], cmds_length, nwk_s_key, dev_addr,
+                                             0, fcnt, cmds );
+            }
+        }
+        // a gateway in range answers the time request in the first window, the frames sent without waiting for
+        // the windows do not get it
+        if( ( sim_radio_config.downlink != NULL ) && ( sim_downlink == SIM_DOWNLINK_NONE ) &&
+            ( sim_device_time_is_requested( cmds, cmds_length ) == true ) )
+        {
+            sim_downlink      = SIM_DOWNLINK_DEVICE_TIME;
+            sim_uplink_end_us = tx->start_us + tx->toa_us;
+        }
+    }
+    if( sim_tx_log != NULL )
+    {
+        fprintf( sim_tx_log, "tx,%llu,%u,%u,%u,%u,%d,%u,%u,%u,%u,%d\n", ( unsigned long long ) tx->start_us,
+                 tx->toa_us, tx->freq_in_hz, tx->sf, sim_lora_bw_in_hz( tx->bw ), tx->pwr_in_dbm, tx->size, mtype,
+                 dev_addr, fcnt, fport );
+        fflush( sim_tx_log );
+    }
+}
+
+static bool sim_device_time_is_requested( const uint8_t* cmds, uint8_t length )
+{
+    // sizes of the uplink MAC commands of LoRaWAN 1.0.4 and class B, indexed by their CID
+    static const uint8_t cmd_size[] = { 0, 0, 1, 2, 1, 2, 3, 2, 1, 1, 2, 0, 0, 1, 0, 0, 2, 2, 0, 2 };
+
+    for( uint8_t i = 0; i < length; )
+    {
+        if( cmds[i] == SIM_DEVICE_TIME_REQ )
+        {
+            return true;
+        }
+        if( ( cmds[i] >= sizeof( cmd_size ) ) || ( cmd_size[cmds[i]] == 0 ) )
+        {
+            // unknown command, the rest of the commands cannot be parsed
+            return false;
+        }
+        i += cmd_size[cmds[i]];
+    }
+    return false;
+}
+
+static uint32_t sim_lora_bw_in_hz( ral_lora_bw_t bw )
+{
+    switch( bw )
+    {
+    case RAL_LORA_BW_200_KHZ:
+        return 203125;
+    case RAL_LORA_BW_400_KHZ:
+        return 406250;
+    case RAL_LORA_BW_800_KHZ:
+        return 812500;
+    case RAL_LORA_BW_1600_KHZ:
+        return 1625000;
+    case RAL_LORA_BW_125_KHZ:
+        return 125000;
+    case RAL_LORA_BW_250_KHZ:
+        return 250000;
+    case RAL_LORA_BW_500_KHZ:
+        return 500000;
+    default:
+        return 0;
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,697 @@
+/*!
+ * \file      ral_sim.c
+ *
+ * \brief     Simulated radio of the host build, replaces the RAL dispatch of ral.c
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <string.h>  // memcpy
+
+#include "ral.h"
+#include "ral_sx1280.h"
+#include "ral_sim.h"
+#include "smtc_bsp.h"
+#include "smtc_bsp_sim.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * Largest frame of the radio buffer
+ */
+#define RAL_SIM_BUFFER_SIZE 255
+
+/*!
+ * Packet status reported for each received frame
+ */
+#define RAL_SIM_RX_RSSI_DBM -80
+#define RAL_SIM_RX_SNR_DB 10
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * Radio operation in progress, its interrupt flags are set at its end
+ */
+typedef enum ral_sim_op_e
+{
+    RAL_SIM_OP_NONE,
+    RAL_SIM_OP_TX,
+    RAL_SIM_OP_RX,
+    RAL_SIM_OP_CAD,
+} ral_sim_op_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static ral_sim_config_t ral_sim_config = {
+    .toa_percent = 100, .toa_offset_us = 0, .dl_loss_percent = 0, .is_irq_injected = false, .downlink = NULL,
+    .uplink = NULL
+};
+static ral_sim_stats_t ral_sim_stats;
+
+static ral_pkt_type_t    ral_sim_pkt_type = RAL_PKT_TYPE_NONE;
+static ral_params_lora_t ral_sim_lora;
+static ral_params_gfsk_t ral_sim_gfsk;
+static ral_params_flrc_t ral_sim_flrc;
+
+static ral_sim_op_t ral_sim_op          = RAL_SIM_OP_NONE;
+static uint64_t     ral_sim_op_start_us = 0;
+static uint64_t     ral_sim_op_end_us   = 0;
+static ral_irq_t    ral_sim_op_irq      = RAL_IRQ_NONE;  // flags raised at the end of the operation
+static ral_irq_t    ral_sim_irq         = RAL_IRQ_NONE;  // flags raised and not cleared
+
+static uint8_t ral_sim_tx_buffer[RAL_SIM_BUFFER_SIZE];
+static uint8_t ral_sim_tx_size = 0;
+static uint8_t ral_sim_rx_buffer[RAL_SIM_BUFFER_SIZE];
+static uint8_t ral_sim_rx_size = 0;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * Starts a radio operation, its interrupt rises after the given duration
+ */
+static void ral_sim_op_start( ral_sim_op_t op, uint64_t duration_us, ral_irq_t irq );
+
+/*!
+ * Ends the operation in progress, sets its flags when completed and accounts its activity
+ */
+static void ral_sim_op_close( void );
+
+/*!
+ * Scales a time on air with the configured factor and offset
+ */
+static uint64_t ral_sim_scale_toa( uint32_t toa_ms );
+
+/*!
+ * Gets the LoRa symbol time in microseconds
+ */
+static uint32_t ral_sim_get_lora_symb_time_us( ral_lora_sf_t sf, ral_lora_bw_t bw );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void ral_sim_set_config( const ral_sim_config_t* config )
+{
+    ral_sim_config = *config;
+}
+
+void ral_sim_get_stats( ral_sim_stats_t* stats )
+{
+    ral_sim_op_close( );
+    *stats = ral_sim_stats;
+}
+
+void ral_sim_irq_inject( ral_irq_t irq )
+{
+    // the operation ends now, with the injected flags instead of its own
+    ral_sim_op_end_us = bsp_sim_get_time_us( );
+    ral_sim_op_irq    = irq;
+    ral_sim_op_close( );
+    ral_sim_op = RAL_SIM_OP_NONE;
+    bsp_sim_radio_irq_set( 0 );
+}
+
+ral_status_t ral_init( const ral_t* ral )
+{
+    ral_sim_op_close( );
+    ral_sim_op       = RAL_SIM_OP_NONE;
+    ral_sim_pkt_type = RAL_PKT_TYPE_NONE;
+    bsp_sim_radio_irq_clear( );
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_setup_gfsk( const ral_t* ral, const ral_params_gfsk_t* params )
+{
+    ral_sim_pkt_type = RAL_PKT_TYPE_GFSK;
+    ral_sim_gfsk     = *params;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_setup_rx_gfsk( const ral_t* ral, const ral_params_gfsk_t* params )
+{
+    return ral_setup_gfsk( ral, params );
+}
+
+ral_status_t ral_setup_tx_gfsk( const ral_t* ral, const ral_params_gfsk_t* params )
+{
+    return ral_setup_gfsk( ral, params );
+}
+
+ral_status_t ral_setup_lora( const ral_t* ral, const ral_params_lora_t* params )
+{
+    ral_sim_pkt_type = RAL_PKT_TYPE_LORA;
+    ral_sim_lora     = *params;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_setup_rx_lora( const ral_t* ral, const ral_params_lora_t* params )
+{
+    return ral_setup_lora( ral, params );
+}
+
+ral_status_t ral_setup_tx_lora( const ral_t* ral, const ral_params_lora_t* params )
+{
+    return ral_setup_lora( ral, params );
+}
+
+ral_status_t ral_setup_flrc( const ral_t* ral, const ral_params_flrc_t* params )
+{
+    ral_sim_pkt_type = RAL_PKT_TYPE_FLRC;
+    ral_sim_flrc     = *params;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_setup_rx_flrc( const ral_t* ral, const ral_params_flrc_t* params )
+{
+    return ral_setup_flrc( ral, params );
+}
+
+ral_status_t ral_setup_tx_flrc( const ral_t* ral, const ral_params_flrc_t* params )
+{
+    return ral_setup_flrc( ral, params );
+}
+
+ral_status_t ral_setup_tx_ble( const ral_t* ral, const ral_params_ble_t* params )
+{
+    ral_sim_pkt_type = RAL_PKT_TYPE_BLE;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_setup_tx_lora_e( const ral_t* ral, const ral_params_lora_e_t* params )
+{
+    return RAL_STATUS_UNSUPPORTED_FEATURE;
+}
+
+ral_status_t ral_tx_bpsk( const ral_t* ral, const ral_params_bpsk_t* params )
+{
+    return RAL_STATUS_UNSUPPORTED_FEATURE;
+}
+
+ral_status_t ral_setup_cad( const ral_t* ral, const ral_lora_cad_params_t* params )
+{
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_setup_ranging( const ral_t* ral, const ral_params_ranging_t* params )
+{
+    ral_sim_pkt_type = RAL_PKT_TYPE_NONE;
+    ral_sim_lora     = params->lora;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_set_pkt_payload( const ral_t* ral, const uint8_t* buffer, const uint16_t size )
+{
+    if( size > RAL_SIM_BUFFER_SIZE )
+    {
+        return RAL_STATUS_ERROR;
+    }
+    memcpy( ral_sim_tx_buffer, buffer, size );
+    ral_sim_tx_size = ( uint8_t ) size;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_get_pkt_payload( const ral_t* ral, uint8_t* buffer, uint16_t max_size, uint16_t* size )
+{
+    if( ral_sim_rx_size > max_size )
+    {
+        return RAL_STATUS_ERROR;
+    }
+    memcpy( buffer, ral_sim_rx_buffer, ral_sim_rx_size );
+    *size = ral_sim_rx_size;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_read_pkt_payload( const ral_t* ral, const ral_rx_buffer_status_t* rx_buffer_status, uint8_t* buffer,
+                                   uint16_t max_size, uint16_t* size )
+{
+    return ral_get_pkt_payload( ral, buffer, max_size, size );
+}
+
+ral_status_t ral_read_pkt_payload_part( const ral_t* ral, const ral_rx_buffer_status_t* rx_buffer_status,
+                                        const uint8_t offset, uint8_t* buffer, const uint16_t size )
+{
+    if( ( offset + size ) > RAL_SIM_BUFFER_SIZE )
+    {
+        return RAL_STATUS_ERROR;
+    }
+    memcpy( buffer, &ral_sim_rx_buffer[offset], size );
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_get_gfsk_pkt_status( const ral_t* ral, ral_rx_pkt_status_gfsk_t* pkt_status )
+{
+    pkt_status->rx_status        = 0;
+    pkt_status->rssi_sync_in_dbm = RAL_SIM_RX_RSSI_DBM;
+    pkt_status->rssi_avg_in_dbm  = RAL_SIM_RX_RSSI_DBM;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_get_lora_pkt_status( const ral_t* ral, ral_rx_pkt_status_lora_t* pkt_status )
+{
+    pkt_status->rssi_pkt_in_dbm       = RAL_SIM_RX_RSSI_DBM;
+    pkt_status->snr_pkt_in_db         = RAL_SIM_RX_SNR_DB;
+    pkt_status->signal_rssi_pkt_in_db = RAL_SIM_RX_RSSI_DBM;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_get_lora_incoming_pkt_config( const ral_t* ral, ral_lora_cr_t* rx_cr, bool* rx_is_crc_en )
+{
+    *rx_cr        = ral_sim_lora.cr;
+    *rx_is_crc_en = ral_sim_lora.crc_is_on;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_get_flrc_pkt_status( const ral_t* ral, ral_rx_pkt_status_flrc_t* pkt_status )
+{
+    pkt_status->rssi_in_dbm = RAL_SIM_RX_RSSI_DBM;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_set_sleep( const ral_t* ral )
+{
+    return ral_set_standby( ral );
+}
+
+ral_status_t ral_set_sleep_with_cfg( const ral_t* ral, const ral_sleep_cfg_t cfg )
+{
+    return ral_set_standby( ral );
+}
+
+ral_status_t ral_set_reg_mode( const ral_t* ral, const ral_reg_mode_t reg_mode )
+{
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_set_lna_mode( const ral_t* ral, const ral_lna_mode_t lna_mode )
+{
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_set_standby( const ral_t* ral )
+{
+    // an operation stopped before its end raises no interrupt
+    ral_sim_op_close( );
+    ral_sim_op = RAL_SIM_OP_NONE;
+    if( ral_sim_irq == RAL_IRQ_NONE )
+    {
+        bsp_sim_radio_irq_clear( );
+    }
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_set_tx( const ral_t* ral )
+{
+    uint32_t     toa_ms = 0;
+    ral_status_t status = RAL_STATUS_UNSUPPORTED_FEATURE;
+
+    switch( ral_sim_pkt_type )
+    {
+    case RAL_PKT_TYPE_LORA:
+        ral_sim_lora.pld_len_in_bytes = ral_sim_tx_size;
+        status                        = ral_sx1280_get_lora_time_on_air_in_ms( &ral_sim_lora, &toa_ms );
+        break;
+    case RAL_PKT_TYPE_GFSK:
+        ral_sim_gfsk.pld_len_in_bytes = ral_sim_tx_size;
+        status                        = ral_sx1280_get_gfsk_time_on_air_in_ms( &ral_sim_gfsk, &toa_ms );
+        break;
+    case RAL_PKT_TYPE_FLRC:
+        ral_sim_flrc.pld_len_in_bytes = ral_sim_tx_size;
+        status                        = ral_sx1280_get_flrc_time_on_air_in_ms( &ral_sim_flrc, &toa_ms );
+        break;
+    case RAL_PKT_TYPE_BLE:
+        // 1 Mb/s: preamble, access address, header, payload and CRC last less than 0.4 ms
+        toa_ms = 1;
+        status = RAL_STATUS_OK;
+        break;
+    default:
+        break;
+    }
+    if( status != RAL_STATUS_OK )
+    {
+        return status;
+    }
+    ral_sim_op_start( RAL_SIM_OP_TX, ral_sim_scale_toa( toa_ms ), RAL_IRQ_TX_DONE );
+    if( ( ral_sim_pkt_type == RAL_PKT_TYPE_LORA ) && ( ral_sim_config.uplink != NULL ) )
+    {
+        const ral_sim_tx_t tx = { .start_us   = ral_sim_op_start_us,
+                                  .toa_us     = ( uint32_t )( ral_sim_op_end_us - ral_sim_op_start_us ),
+                                  .freq_in_hz = ral_sim_lora.freq_in_hz,
+                                  .sf         = ral_sim_lora.sf,
+                                  .bw         = ral_sim_lora.bw,
+                                  .pwr_in_dbm = ral_sim_lora.pwr_in_dbm,
+                                  .payload    = ral_sim_tx_buffer,
+                                  .size       = ral_sim_tx_size };
+
+        ral_sim_config.uplink( &tx );
+    }
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_set_tx_cw( const ral_t* ral )
+{
+    // continuous wave until the next standby, no interrupt
+    ral_sim_op_start( RAL_SIM_OP_TX, 0, RAL_IRQ_NONE );
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_set_rx( const ral_t* ral, const uint32_t timeout_ms )
+{
+    ral_sim_rx_window_t window   = { .pkt_type = ral_sim_pkt_type, .timeout_ms = timeout_ms };
+    uint32_t            delay_ms = 0;
+    uint8_t             size     = 0;
+
+    switch( ral_sim_pkt_type )
+    {
+    case RAL_PKT_TYPE_LORA:
+        window.freq_in_hz = ral_sim_lora.freq_in_hz;
+        window.sf         = ral_sim_lora.sf;
+        window.bw         = ral_sim_lora.bw;
+        break;
+    case RAL_PKT_TYPE_GFSK:
+        window.freq_in_hz = ral_sim_gfsk.freq_in_hz;
+        break;
+    case RAL_PKT_TYPE_FLRC:
+        window.freq_in_hz = ral_sim_flrc.freq_in_hz;
+        break;
+    default:
+        return RAL_STATUS_UNSUPPORTED_FEATURE;
+    }
+
+    ral_sim_stats.rx_nb++;
+    if( ( ral_sim_config.downlink != NULL ) &&
+        ( ral_sim_config.downlink( &window, ral_sim_rx_buffer, &size, &delay_ms ) == true ) &&
+        ( bsp_rng_get_random_in_range( 1, 100 ) > ral_sim_config.dl_loss_percent ) &&
+        ( ( delay_ms < timeout_ms ) || ( timeout_ms == 0 ) ) )
+    {
+        ral_sim_rx_size = size;
+        ral_sim_stats.rx_ok_nb++;
+        ral_sim_op_start( RAL_SIM_OP_RX, ( uint64_t ) delay_ms * 1000, RAL_IRQ_RX_DONE );
+    }
+    else if( timeout_ms != 0 )
+    {
+        ral_sim_op_start( RAL_SIM_OP_RX, ( uint64_t ) timeout_ms * 1000, RAL_IRQ_RX_TIMEOUT );
+    }
+    else
+    {
+        // continuous reception with nothing on air, ends with the next standby
+        ral_sim_op_start( RAL_SIM_OP_RX, 0, RAL_IRQ_NONE );
+    }
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_set_rx_duty_cycle( const ral_t* ral, const uint32_t rx_time_in_ms, const uint32_t sleep_time_in_ms )
+{
+    // the sniff windows are not modelled, the radio listens until the next standby
+    return ral_set_rx( ral, 0 );
+}
+
+ral_status_t ral_set_ranging( const ral_t* ral, const ral_ranging_role_t role, const uint32_t timeout_ms )
+{
+    // no other ranging device on air: the master request is never answered, the slave listens until its timeout
+    if( timeout_ms != 0 )
+    {
+        ral_sim_op_start( RAL_SIM_OP_RX, ( uint64_t ) timeout_ms * 1000,
+                          ( role == RAL_RANGING_ROLE_MASTER ) ? RAL_IRQ_RANGING_TIMEOUT : RAL_IRQ_RX_TIMEOUT );
+    }
+    else
+    {
+        ral_sim_op_start( RAL_SIM_OP_RX, 0, RAL_IRQ_NONE );
+    }
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_get_ranging_result( const ral_t* ral, const ral_params_ranging_t* params, int32_t* distance_in_cm )
+{
+    *distance_in_cm = 0;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_set_cad( const ral_t* ral )
+{
+    // no other transmitter on air, the channel is always free
+    uint64_t duration_us = ral_sim_get_lora_symb_time_us( ral_sim_lora.sf, ral_sim_lora.bw );
+
+    ral_sim_op_start( RAL_SIM_OP_CAD, duration_us + ral_sim_config.toa_offset_us, RAL_IRQ_CAD_DONE );
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_get_irq_status( const ral_t* ral, ral_irq_t* irq_status )
+{
+    if( ( ral_sim_op != RAL_SIM_OP_NONE ) && ( ral_sim_op_irq != RAL_IRQ_NONE ) &&
+        ( bsp_sim_get_time_us( ) >= ral_sim_op_end_us ) )
+    {
+        ral_sim_op_close( );
+        ral_sim_op = RAL_SIM_OP_NONE;
+    }
+    *irq_status = ral_sim_irq;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_clear_irq_status( const ral_t* ral, const ral_irq_t irq_status )
+{
+    ral_irq_t irq = RAL_IRQ_NONE;
+
+    ral_get_irq_status( ral, &irq );
+    ral_sim_irq &= ~irq_status;
+    if( ( ral_sim_irq == RAL_IRQ_NONE ) && ( ral_sim_op == RAL_SIM_OP_NONE ) )
+    {
+        bsp_sim_radio_irq_clear( );
+    }
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_get_and_clear_irq_status( const ral_t* ral, ral_irq_t* irq_status )
+{
+    ral_get_irq_status( ral, irq_status );
+    return ral_clear_irq_status( ral, *irq_status );
+}
+
+ral_status_t ral_set_dio_irq_params( const ral_t* ral, const ral_irq_t ral_irq )
+{
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_process_irq( const ral_t* ral, ral_irq_t* ral_irq )
+{
+    return ral_get_irq_status( ral, ral_irq );
+}
+
+ral_status_t ral_process_and_clear_irq( const ral_t* ral, ral_irq_t* ral_irq,
+                                        ral_rx_buffer_status_t* rx_buffer_status )
+{
+    rx_buffer_status->pld_len_in_bytes     = ral_sim_rx_size;
+    rx_buffer_status->buffer_start_pointer = 0;
+    return ral_get_and_clear_irq_status( ral, ral_irq );
+}
+
+ral_status_t ral_get_rssi( const ral_t* ral, int16_t* rssi )
+{
+    // nothing else on air
+    *rssi = -120;
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_set_rf_freq( const ral_t* ral, const uint32_t freq_in_hz )
+{
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_get_lora_time_on_air_in_ms( const ral_t* ral, const ral_params_lora_t* params, uint32_t* toa )
+{
+    return ral_sx1280_get_lora_time_on_air_in_ms( params, toa );
+}
+
+ral_status_t ral_get_gfsk_time_on_air_in_ms( const ral_t* ral, const ral_params_gfsk_t* params, uint32_t* toa )
+{
+    return ral_sx1280_get_gfsk_time_on_air_in_ms( params, toa );
+}
+
+ral_status_t ral_get_flrc_time_on_air_in_ms( const ral_t* ral, const ral_params_flrc_t* params, uint32_t* toa )
+{
+    return ral_sx1280_get_flrc_time_on_air_in_ms( params, toa );
+}
+
+ral_status_t ral_get_lora_tx_consumption_in_ua( const ral_t* ral, const ral_params_lora_t* params,
+                                                uint32_t* micro_ampere )
+{
+    return ral_sx1280_convert_lora_tx_dbm_to_ua( params, micro_ampere );
+}
+
+ral_status_t ral_get_lora_rx_consumption_in_ua( const ral_t* ral, const ral_params_lora_t* params,
+                                                uint32_t* micro_ampere )
+{
+    return ral_sx1280_convert_lora_rx_bw_to_ua( params, micro_ampere );
+}
+
+ral_status_t ral_get_gfsk_tx_consumption_in_ua( const ral_t* ral, const ral_params_gfsk_t* params,
+                                                uint32_t* micro_ampere )
+{
+    return ral_sx1280_convert_gfsk_tx_dbm_to_ua( params, micro_ampere );
+}
+
+ral_status_t ral_get_gfsk_rx_consumption_in_ua( const ral_t* ral, const ral_params_gfsk_t* params,
+                                                uint32_t* micro_ampere )
+{
+    return ral_sx1280_convert_gfsk_rx_br_to_ua( params, micro_ampere );
+}
+
+ral_status_t ral_get_flrc_tx_consumption_in_ua( const ral_t* ral, const ral_params_flrc_t* params,
+                                                uint32_t* micro_ampere )
+{
+    return ral_sx1280_convert_flrc_tx_dbm_to_ua( params, micro_ampere );
+}
+
+ral_status_t ral_get_flrc_rx_consumption_in_ua( const ral_t* ral, const ral_params_flrc_t* params,
+                                                uint32_t* micro_ampere )
+{
+    return ral_sx1280_convert_flrc_rx_br_to_ua( params, micro_ampere );
+}
+
+ral_status_t ral_set_tcxo_on( const ral_t* ral )
+{
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_set_tcxo_off( const ral_t* ral )
+{
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_read_register( const ral_t* ral, uint16_t address, uint8_t* buffer, uint16_t size )
+{
+    memset( buffer, 0, size );
+    return RAL_STATUS_OK;
+}
+
+ral_status_t ral_write_register( const ral_t* ral, uint16_t address, uint8_t* buffer, uint16_t size )
+{
+    return RAL_STATUS_OK;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void ral_sim_op_start( ral_sim_op_t op, uint64_t duration_us, ral_irq_t irq )
+{
+    ral_sim_op_close( );
+    ral_sim_op          = op;
+    ral_sim_op_start_us = bsp_sim_get_time_us( );
+    ral_sim_op_end_us   = ral_sim_op_start_us + duration_us;
+    ral_sim_op_irq      = ( ral_sim_config.is_irq_injected == true ) ? RAL_IRQ_NONE : irq;
+    if( ral_sim_op_irq != RAL_IRQ_NONE )
+    {
+        bsp_sim_radio_irq_set( ( uint32_t ) duration_us );
+    }
+}
+
+static void ral_sim_op_close( void )
+{
+    uint64_t now_us = bsp_sim_get_time_us( );
+    uint64_t end_us = now_us;
+    bool     is_end = false;
+
+    if( ral_sim_op == RAL_SIM_OP_NONE )
+    {
+        return;
+    }
+    if( ( ral_sim_op_irq != RAL_IRQ_NONE ) && ( now_us >= ral_sim_op_end_us ) )
+    {
+        end_us = ral_sim_op_end_us;
+        is_end = true;
+        ral_sim_irq |= ral_sim_op_irq;
+    }
+
+    if( ral_sim_op == RAL_SIM_OP_TX )
+    {
+        if( is_end == true )
+        {
+            ral_sim_stats.tx_nb++;
+        }
+        ral_sim_stats.tx_airtime_ms += ( uint32_t )( ( end_us - ral_sim_op_start_us ) / 1000 );
+    }
+    else if( ral_sim_op == RAL_SIM_OP_RX )
+    {
+        ral_sim_stats.rx_ms += ( uint32_t )( ( end_us - ral_sim_op_start_us ) / 1000 );
+    }
+    // the rest of an operation still running is accounted from now on
+    ral_sim_op_start_us = now_us;
+    if( is_end == true )
+    {
+        ral_sim_op = RAL_SIM_OP_NONE;
+    }
+}
+
+static uint64_t ral_sim_scale_toa( uint32_t toa_ms )
+{
+    return ( ( uint64_t ) toa_ms * 1000 * ral_sim_config.toa_percent ) / 100 + ral_sim_config.toa_offset_us;
+}
+
+static uint32_t ral_sim_get_lora_symb_time_us( ral_lora_sf_t sf, ral_lora_bw_t bw )
+{
+    uint32_t bw_in_hz;
+
+    switch( bw )
+    {
+    case RAL_LORA_BW_200_KHZ:
+        bw_in_hz = 203125;
+        break;
+    case RAL_LORA_BW_400_KHZ:
+        bw_in_hz = 406250;
+        break;
+    case RAL_LORA_BW_800_KHZ:
+        bw_in_hz = 812500;
+        break;
+    case RAL_LORA_BW_1600_KHZ:
+        bw_in_hz = 1625000;
+        break;
+    default:
+        bw_in_hz = 125000;
+        break;
+    }
+    return ( uint32_t )( ( ( uint64_t ) 1000000 << sf ) / bw_in_hz );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
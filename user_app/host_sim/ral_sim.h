@@ -0,0 +1,155 @@
+/*!
+ * \file      ral_sim.h
+ *
+ * \brief     Simulated radio of the host build, replaces the RAL dispatch of ral.c
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __RAL_SIM_H__
+#define __RAL_SIM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "ral_defs.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * Reception window opened by the modem, given to the downlink callback
+ */
+typedef struct ral_sim_rx_window_s
+{
+    ral_pkt_type_t pkt_type;    // modulation of the window
+    uint32_t       freq_in_hz;  // center frequency
+    ral_lora_sf_t  sf;          // LoRa spreading factor, LoRa windows only
+    ral_lora_bw_t  bw;          // LoRa bandwidth, LoRa windows only
+    uint32_t       timeout_ms;  // window length
+} ral_sim_rx_window_t;
+
+/*!
+ * LoRa transmission started by the modem, given to the uplink callback
+ */
+typedef struct ral_sim_tx_s
+{
+    uint64_t       start_us;    // virtual time of the transmission start
+    uint32_t       toa_us;      // time on air
+    uint32_t       freq_in_hz;  // center frequency
+    ral_lora_sf_t  sf;          // LoRa spreading factor
+    ral_lora_bw_t  bw;          // LoRa bandwidth
+    int8_t         pwr_in_dbm;  // output power
+    const uint8_t* payload;     // frame sent
+    uint8_t        size;        // frame size in bytes
+} ral_sim_tx_t;
+
+/*!
+ * Behavior of the simulated radio
+ */
+typedef struct ral_sim_config_s
+{
+    uint16_t toa_percent;      // scale of the time on air computed from the SX1280 formulas, 100 for nominal
+    uint32_t toa_offset_us;    // fixed time added to each transmission and CAD, as the radio ramp-up
+    uint8_t  dl_loss_percent;  // probability to lose a downlink given by the callback
+    bool     is_irq_injected;  // the operations never end by themselves, see \ref ral_sim_irq_inject
+
+    /*!
+     * Downlink source, NULL when no network is simulated and every window times out
+     *
+     * \param [IN]  window  Reception window opened by the modem
+     * \param [OUT] payload Received frame
+     * \param [OUT] size    Received frame size in bytes, at most 255
+     * \param [OUT] delay_ms Time of the frame end from the window start, below the window length
+     *
+     * \retval true a frame is received in the window
+     */
+    bool ( *downlink )( const ral_sim_rx_window_t* window, uint8_t* payload, uint8_t* size, uint32_t* delay_ms );
+
+    /*!
+     * Observer of the LoRa transmissions, NULL when not needed. The other modulations are not reported.
+     *
+     * \param [IN] tx Transmission started by the modem
+     */
+    void ( *uplink )( const ral_sim_tx_t* tx );
+} ral_sim_config_t;
+
+/*!
+ * Activity of the simulated radio since the start
+ */
+typedef struct ral_sim_stats_s
+{
+    uint32_t tx_nb;          // transmissions completed
+    uint32_t tx_airtime_ms;  // time on air of the transmissions
+    uint32_t rx_nb;          // reception windows opened
+    uint32_t rx_ok_nb;       // frames received
+    uint32_t rx_ms;          // time spent in reception
+} ral_sim_stats_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS PROTOTYPES ---------------------------------------------
+ */
+
+/*!
+ * Sets the behavior of the simulated radio, to be called before the modem init
+ *
+ * \param [IN] config Simulated radio behavior
+ */
+void ral_sim_set_config( const ral_sim_config_t* config );
+
+/*!
+ * Gets the activity of the simulated radio
+ *
+ * \param [OUT] stats Radio activity since the start
+ */
+void ral_sim_get_stats( ral_sim_stats_t* stats );
+
+/*!
+ * Ends the current operation with the given flags and raises the radio interrupt line now
+ *
+ * \remark Used to replay recorded radio interrupts, with is_irq_injected set in the configuration
+ *
+ * \param [IN] irq Flags of the interrupt, RAL_IRQ_NONE for an interrupt without flags
+ */
+void ral_sim_irq_inject( ral_irq_t irq );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // __RAL_SIM_H__
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,448 @@
+/*!
+ * \file      rp_replay.c
+ *
+ * \brief     Radio planner replay: feeds a recorded trace back into the planner on the host simulation
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <stdio.h>    // printf
+#include <stdlib.h>   // malloc
+
+#include "smtc_bsp.h"
+#include "smtc_bsp_sim.h"
+#include "ral_sim.h"
+#include "radio_planner.h"
+#include "radio_planner_trace.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * Longest virtual time step, the wait takes a signed number of microseconds
+ */
+#define REPLAY_MAX_STEP_MS 1000000
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * Radio launch, the jitter is the time from the scheduled start to the trigger
+ */
+typedef struct replay_launch_s
+{
+    uint8_t  hook_id;
+    uint8_t  type;
+    uint32_t start_time_ms;
+    uint32_t launch_time_ms;
+} replay_launch_t;
+
+/*!
+ * Planner decisions of one run, recorded on the target or replayed on the host
+ */
+typedef struct replay_run_s
+{
+    const char*      name;
+    replay_launch_t* launches;
+    uint32_t         launch_nb;
+    uint32_t         aborted_nb;
+    uint32_t         timer_irq_nb;
+    uint32_t         lost_nb;
+} replay_run_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static bsp_sim_config_t replay_sim_config   = { .seed = 1, .nvm_file = NULL, .trace_on = false, .argv = NULL };
+static ral_sim_config_t replay_radio_config = {
+    .toa_percent = 100, .toa_offset_us = 0, .dl_loss_percent = 0, .is_irq_injected = true, .downlink = NULL,
+    .uplink = NULL
+};
+
+static ral_t           replay_ral;
+static radio_planner_t replay_rp;
+static uint8_t         replay_payload[255];
+
+static bsp_gpio_irq_t replay_radio_dio = {
+    .pin      = RADIO_DIOX,
+    .context  = &replay_rp,
+    .callback = rp_radio_irq_callback,
+};
+
+// recorded records, the cursor is the next one to feed
+static rp_trace_record_t* replay_records  = NULL;
+static uint32_t           replay_record_nb = 0;
+static uint32_t           replay_cursor    = 0;
+static uint32_t           replay_orphan_nb = 0;
+
+static replay_run_t replay_recorded = { .name = "recorded" };
+static replay_run_t replay_replayed = { .name = "replayed" };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/*!
+ * Reads the concatenated host dumps of a trace file
+ *
+ * \retval false when the file cannot be read or is truncated
+ */
+static bool replay_load( const char* file_name );
+
+/*!
+ * Moves the virtual time forward to a planner timestamp
+ */
+static void replay_advance_to( uint32_t timestamp_ms );
+
+/*!
+ * Gives a recorded input to the planner: enqueue, abort or radio IRQ
+ */
+static void replay_feed( const rp_trace_record_t* record );
+
+/*!
+ * Accounts a planner output in a run, returns false for an input
+ */
+static bool replay_collect( replay_run_t* run, const rp_trace_record_t* record );
+
+/*!
+ * Moves the trace of the replayed planner to the replayed run
+ */
+static void replay_drain( void );
+
+/*!
+ * Hook callback of every owner: runs the recorded reaction of the owner, i.e. the inputs recorded in its callback
+ */
+static void replay_hook_callback( void* context );
+
+/*!
+ * Prints the launches, the aborts and the summary of a run
+ */
+static void replay_report( const replay_run_t* run );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+/**
+ * @brief Replays a radio planner trace dumped with the GETRPTRACE host command
+ *
+ *        The enqueues, the aborts and the radio IRQ are fed at their recorded time, the planner computes its own
+ *        timers and launches. Output: one line per launch and abort, then per run
+ *        summary,<run>,<launches>,<jitter min ms>,<jitter max ms>,<jitter mean ms>,<aborts>,<timer irqs>,<lost>
+ *        and divergence,<launches differing from the recording>,<orphan records>,<rp errors>
+ */
+int main( int argc, char** argv )
+{
+    uint32_t divergence_nb = 0;
+
+    if( argc != 2 )
+    {
+        printf( "usage: %s <trace file>\n", argv[0] );
+        return EXIT_FAILURE;
+    }
+    if( ( replay_load( argv[1] ) == false ) || ( replay_record_nb == 0 ) )
+    {
+        printf( "rp_replay: no trace in %s\n", argv[1] );
+        return EXIT_FAILURE;
+    }
+    replay_recorded.launches = malloc( replay_record_nb * sizeof( replay_launch_t ) );
+    replay_replayed.launches = malloc( replay_record_nb * sizeof( replay_launch_t ) );
+    if( ( replay_recorded.launches == NULL ) || ( replay_replayed.launches == NULL ) )
+    {
+        return EXIT_FAILURE;
+    }
+
+    bsp_sim_init( &replay_sim_config );
+    ral_sim_set_config( &replay_radio_config );
+    bsp_mcu_init( );
+    // the planner time starts at the first record, as on the target
+    replay_advance_to( replay_records[0].timestamp_ms );
+
+    rp_init( &replay_rp, &replay_ral );
+    for( uint8_t i = 0; i < RP_NB_HOOKS; i++ )
+    {
+        rp_hook_init( &replay_rp, i, replay_hook_callback, &replay_rp );
+    }
+    bsp_gpio_irq_attach( &replay_radio_dio );
+    bsp_enable_irq( );
+
+    while( replay_cursor < replay_record_nb )
+    {
+        const rp_trace_record_t* record = &replay_records[replay_cursor++];
+
+        if( replay_collect( &replay_recorded, record ) == true )
+        {
+            continue;
+        }
+        if( ( record->flags & RP_TRACE_FLAG_IN_CALLBACK ) != 0 )
+        {
+            // reaction to a callback the replayed planner did not make
+            replay_orphan_nb++;
+        }
+        else
+        {
+            replay_advance_to( record->timestamp_ms );
+        }
+        replay_feed( record );
+        bsp_mcu_wait_us( 0 );
+        replay_drain( );
+    }
+    // the last tasks run to their end
+    bsp_mcu_wait_us( REPLAY_MAX_STEP_MS * 1000 );
+    replay_drain( );
+
+    for( uint32_t i = 0; i < replay_recorded.launch_nb; i++ )
+    {
+        const replay_launch_t* recorded = &replay_recorded.launches[i];
+        const replay_launch_t* replayed = &replay_replayed.launches[i];
+
+        if( ( i >= replay_replayed.launch_nb ) || ( recorded->hook_id != replayed->hook_id ) ||
+            ( recorded->start_time_ms != replayed->start_time_ms ) )
+        {
+            divergence_nb++;
+        }
+    }
+    if( replay_replayed.launch_nb > replay_recorded.launch_nb )
+    {
+        divergence_nb += replay_replayed.launch_nb - replay_recorded.launch_nb;
+    }
+
+    replay_report( &replay_recorded );
+    replay_report( &replay_replayed );
+    printf( "divergence,%u,%u,%u\n", divergence_nb, replay_orphan_nb, rp_get_stats( &replay_rp ).rp_error );
+    if( replay_recorded.lost_nb > 0 )
+    {
+        printf( "rp_replay: %u records lost on the target, the trace was not dumped often enough\n",
+                replay_recorded.lost_nb );
+    }
+    return ( divergence_nb == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static bool replay_load( const char* file_name )
+{
+    FILE*   file = fopen( file_name, "rb" );
+    uint8_t buffer[UINT8_MAX];
+    bool    is_ok = true;
+
+    if( file == NULL )
+    {
+        return false;
+    }
+    while( fread( buffer, 1, RP_TRACE_DUMP_HEADER_SIZE, file ) == RP_TRACE_DUMP_HEADER_SIZE )
+    {
+        uint8_t nb = buffer[2];
+
+        replay_recorded.lost_nb += ( buffer[0] << 8 ) | buffer[1];
+        if( nb == 0 )
+        {
+            continue;
+        }
+        replay_records = realloc( replay_records, ( replay_record_nb + nb ) * sizeof( rp_trace_record_t ) );
+        if( ( replay_records == NULL ) || ( fread( buffer, RP_TRACE_RECORD_SIZE, nb, file ) != nb ) )
+        {
+            is_ok = false;
+            break;
+        }
+        for( uint8_t i = 0; i < nb; i++ )
+        {
+            rp_trace_record_parse( &buffer[i * RP_TRACE_RECORD_SIZE], &replay_records[replay_record_nb++] );
+        }
+    }
+    fclose( file );
+    return is_ok;
+}
+
+static void replay_advance_to( uint32_t timestamp_ms )
+{
+    int32_t delta_ms;
+
+    while( ( delta_ms = ( int32_t )( timestamp_ms - bsp_rtc_get_time_ms( ) ) ) > 0 )
+    {
+        delta_ms = ( delta_ms < REPLAY_MAX_STEP_MS ) ? delta_ms : REPLAY_MAX_STEP_MS;
+        bsp_mcu_wait_us( delta_ms * 1000 );
+        replay_drain( );
+    }
+}
+
+static void replay_feed( const rp_trace_record_t* record )
+{
+    switch( record->event )
+    {
+    case RP_TRACE_EVENT_ENQUEUE: {
+        rp_task_t         task         = { 0 };
+        rp_radio_params_t radio_params = { 0 };
+
+        task.hook_id          = record->hook_id;
+        task.type             = ( rp_task_types_t ) RP_TRACE_TASK_TYPE( record->arg_3 );
+        task.state            = ( rp_task_states_t ) RP_TRACE_TASK_STATE( record->arg_3 );
+        task.preempt_policy   = ( rp_task_preempt_policies_t ) RP_TRACE_TASK_POLICY( record->arg_3 );
+        task.start_time_ms    = record->arg_1;
+        task.duration_time_ms = record->arg_2;
+        switch( task.type )
+        {
+        case RP_TASK_TYPE_RX_FSK:
+        case RP_TASK_TYPE_TX_FSK:
+        case RP_TASK_TYPE_RSSI_SCAN:
+            radio_params.pkt_type = RAL_PKT_TYPE_GFSK;
+            break;
+        case RP_TASK_TYPE_RX_FLRC:
+        case RP_TASK_TYPE_TX_FLRC:
+            radio_params.pkt_type = RAL_PKT_TYPE_FLRC;
+            break;
+        case RP_TASK_TYPE_TX_BLE:
+            radio_params.pkt_type = RAL_PKT_TYPE_BLE;
+            break;
+        default:
+            radio_params.pkt_type = RAL_PKT_TYPE_LORA;
+            break;
+        }
+        // the radio result is injected from the trace, the payload and the modulation do not matter
+        rp_task_enqueue( &replay_rp, &task, replay_payload, 0, &radio_params );
+        break;
+    }
+    case RP_TRACE_EVENT_ABORT:
+        rp_task_abort( &replay_rp, record->hook_id );
+        break;
+    case RP_TRACE_EVENT_RADIO_IRQ:
+        ral_sim_irq_inject( record->arg_3 );
+        break;
+    default:
+        break;
+    }
+}
+
+static bool replay_collect( replay_run_t* run, const rp_trace_record_t* record )
+{
+    switch( record->event )
+    {
+    case RP_TRACE_EVENT_TIMER_IRQ:
+        run->timer_irq_nb++;
+        return true;
+    case RP_TRACE_EVENT_LAUNCH:
+        run->launches[run->launch_nb++] = ( replay_launch_t ){ .hook_id        = record->hook_id,
+                                                               .type           = ( uint8_t ) record->arg_3,
+                                                               .start_time_ms  = record->arg_1,
+                                                               .launch_time_ms = record->timestamp_ms };
+        return true;
+    case RP_TRACE_EVENT_ABORTED:
+        run->aborted_nb++;
+        printf( "%s,aborted,%u,%u\n", run->name, record->hook_id, record->timestamp_ms );
+        return true;
+    default:
+        return false;
+    }
+}
+
+static void replay_drain( void )
+{
+    uint8_t           buffer[UINT8_MAX];
+    rp_trace_record_t record;
+    uint8_t           nb;
+
+    do
+    {
+        rp_trace_dump( buffer, sizeof( buffer ) );
+        replay_replayed.lost_nb += ( buffer[0] << 8 ) | buffer[1];
+        nb = buffer[2];
+        for( uint8_t i = 0; i < nb; i++ )
+        {
+            rp_trace_record_parse( &buffer[RP_TRACE_DUMP_HEADER_SIZE + i * RP_TRACE_RECORD_SIZE], &record );
+            // the inputs are the recorded ones, only the decisions are kept
+            if( ( record.event == RP_TRACE_EVENT_LAUNCH ) &&
+                ( replay_replayed.launch_nb >= replay_record_nb ) )
+            {
+                continue;
+            }
+            replay_collect( &replay_replayed, &record );
+        }
+    } while( nb > 0 );
+}
+
+static void replay_hook_callback( void* context )
+{
+    while( replay_cursor < replay_record_nb )
+    {
+        const rp_trace_record_t* record = &replay_records[replay_cursor];
+
+        if( replay_collect( &replay_recorded, record ) == false )
+        {
+            if( ( record->flags & RP_TRACE_FLAG_IN_CALLBACK ) == 0 )
+            {
+                break;
+            }
+            replay_feed( record );
+        }
+        replay_cursor++;
+    }
+}
+
+static void replay_report( const replay_run_t* run )
+{
+    int32_t jitter_min = INT32_MAX;
+    int32_t jitter_max = INT32_MIN;
+    int64_t jitter_sum = 0;
+
+    for( uint32_t i = 0; i < run->launch_nb; i++ )
+    {
+        const replay_launch_t* launch = &run->launches[i];
+        int32_t                jitter = ( int32_t )( launch->launch_time_ms - launch->start_time_ms );
+
+        printf( "%s,launch,%u,%u,%u,%d\n", run->name, launch->hook_id, launch->type, launch->start_time_ms, jitter );
+        jitter_min = ( jitter < jitter_min ) ? jitter : jitter_min;
+        jitter_max = ( jitter > jitter_max ) ? jitter : jitter_max;
+        jitter_sum += jitter;
+    }
+    if( run->launch_nb == 0 )
+    {
+        jitter_min = 0;
+        jitter_max = 0;
+    }
+    printf( "summary,%s,%u,%d,%d,%.2f,%u,%u,%u\n", run->name, run->launch_nb, jitter_min, jitter_max,
+            ( run->launch_nb > 0 ) ? ( double ) jitter_sum / run->launch_nb : 0.0, run->aborted_nb, run->timer_irq_nb,
+            run->lost_nb );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,103 @@
+/*!
+ * \file      sx1280_hal.c
+ *
+ * \brief     SX1280 HAL of the host build, no radio is connected
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memset
+
+#include "sx1280_hal.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static sx1280_hal_operating_mode_t radio_opmode = SX1280_HAL_OP_MODE_SLEEP;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+// The simulated RAL only uses the SX1280 driver computations, the commands fail
+
+sx1280_hal_status_t sx1280_hal_write( const void* context, const uint8_t* command, const uint16_t command_length,
+                                      const uint8_t* data, const uint16_t data_length )
+{
+    return SX1280_HAL_STATUS_ERROR;
+}
+
+sx1280_hal_status_t sx1280_hal_read( const void* context, const uint8_t* command, const uint16_t command_length,
+                                     uint8_t* data, const uint16_t data_length )
+{
+    memset( data, 0, data_length );
+    return SX1280_HAL_STATUS_ERROR;
+}
+
+sx1280_hal_status_t sx1280_hal_write_batch( const void* context, const uint8_t* batch, const uint16_t batch_length )
+{
+    return SX1280_HAL_STATUS_ERROR;
+}
+
+sx1280_hal_status_t sx1280_hal_transfer_batch( const void* context, const uint8_t* batch, uint8_t* response,
+                                               const uint16_t batch_length )
+{
+    memset( response, 0, batch_length );
+    return SX1280_HAL_STATUS_ERROR;
+}
+
+void sx1280_hal_reset( const void* context )
+{
+    radio_opmode = SX1280_HAL_OP_MODE_STDBY_RC;
+}
+
+sx1280_hal_status_t sx1280_hal_wakeup( const void* context )
+{
+    radio_opmode = SX1280_HAL_OP_MODE_STDBY_RC;
+    return SX1280_HAL_STATUS_OK;
+}
+
+sx1280_hal_operating_mode_t sx1280_hal_get_operating_mode( const void* context )
+{
+    return radio_opmode;
+}
+
+void sx1280_hal_set_operating_mode( const void* context, const sx1280_hal_operating_mode_t op_mode )
+{
+    radio_opmode = op_mode;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -47,6 +47,17 @@
 
 #define HW_MODEM_RX_BUFF_MAX_LENGTH 259
 
+// Reception ring, the host may pipeline several commands as long as they fit
+#define HW_MODEM_RX_RING_SIZE 512
+
+// No baud rate change requested
+#define HW_MODEM_BAUDRATE_NONE 0xFF
+
+// Host link baud rates, index 0 is the default one used after a failed negotiation
+static const uint32_t hw_modem_baudrates[] = { 115200, 230400, 460800, 921600, 2000000 };
+
+#define HW_MODEM_BAUDRATE_NB ( sizeof( hw_modem_baudrates ) / sizeof( hw_modem_baudrates[0] ) )
+
 /*
  * -----------------------------------------------------------------------------
  * --- PRIVATE VARIABLES -------------------------------------------------------
@@ -54,10 +65,21 @@
 
 static uint8_t        ModemResponsePacket[HW_MODEM_RX_BUFF_MAX_LENGTH];
 static uint8_t        ModemRxBuffer[HW_MODEM_RX_BUFF_MAX_LENGTH];
+static uint8_t        ModemRxRing[HW_MODEM_RX_RING_SIZE];
+static uint16_t       ModemRxRingReadIndex;
 static uint8_t        ResponseLength;
-static volatile bool  hw_cmd_available             = false;
-static volatile bool  is_hw_modem_ready_to_receive = true;
-static bsp_gpio_irq_t wakeup_line_irq              = { 0 };
+static volatile bool  hw_cmd_available       = false;
+static volatile bool  is_response_tx_ongoing = false;
+static bsp_uart_irq_t response_tx_irq        = { 0 };
+static bsp_uart_irq_t rx_event_irq           = { 0 };
+static uint8_t        baudrate_index         = DEFAULT_HOST_BAUDRATE_INDEX;
+static uint8_t        pending_baudrate_index = HW_MODEM_BAUDRATE_NONE;
+static bool           is_baudrate_confirmed  = true;
+static bool           is_event_push_enabled  = false;
+static volatile bool  is_event_push_pending  = false;
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_OFF )
+static bsp_gpio_irq_t wakeup_line_irq = { 0 };
+#endif
 
 /*
  * -----------------------------------------------------------------------------
@@ -65,12 +87,34 @@ static bsp_gpio_irq_t wakeup_line_irq              = { 0 };
  */
 
 /**
- * @brief prepare and start the reception of the command on a uart using a dma
+ * @brief start the never ending reception of the commands on a uart using a circular dma
  * @param [none]
  * @return [none]
  */
 void hw_modem_start_reception( void );
 
+/**
+ * @brief give the number of received bytes not yet processed
+ * @param [none]
+ * @return number of bytes waiting in the reception ring
+ */
+static uint16_t hw_modem_rx_ring_get_length( void );
+
+/**
+ * @brief switch the host link to a new baud rate and restart the reception
+ * @param [in] index         index in the baud rates table
+ * @param [in] is_confirmed  false until a valid command has been received at this baud rate
+ * @return none
+ */
+static void hw_modem_apply_baudrate( uint8_t index, bool is_confirmed );
+
+/**
+ * @brief send the pending events to the host in a pushed frame, the host link must be idle
+ * @param [none]
+ * @return none
+ */
+static void hw_modem_push_events( void );
+
 /**
  * @brief function that will be called every time the COMMAND line in asserted or de-asserted by the host
  * @param *context  unused context
@@ -85,6 +129,20 @@ void wakeup_line_irq_handler( void* constext );
  */
 void hw_modem_event_handler( void );
 
+/**
+ * @brief function that will be called once the response has been sent on uart
+ * @param *context  unused context
+ * @return none
+ */
+void hw_modem_response_tx_done_handler( void* context );
+
+/**
+ * @brief function that will be called when the uart rx line gets idle or the reception ring is half filled
+ * @param *context  unused context
+ * @return none
+ */
+void hw_modem_rx_event_handler( void* context );
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
@@ -96,20 +154,42 @@ void hw_modem_init( void )
     bsp_gpio_init_out( HW_MODEM_EVENT_PIN, 0 );
     bsp_gpio_init_out( HW_MODEM_BUSY_PIN, 1 );
 
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_OFF )
     // init irq on COMMAND pin
     wakeup_line_irq.pin      = HW_MODEM_COMMAND_PIN;
     wakeup_line_irq.context  = NULL;
     wakeup_line_irq.callback = wakeup_line_irq_handler;
     bsp_gpio_init_in( HW_MODEM_COMMAND_PIN, BSP_GPIO_PULL_MODE_UP, BSP_GPIO_IRQ_MODE_RISING_FALLING, &wakeup_line_irq );
+#endif
+
+    response_tx_irq.context  = NULL;
+    response_tx_irq.callback = hw_modem_response_tx_done_handler;
+    rx_event_irq.context     = NULL;
+    rx_event_irq.callback    = hw_modem_rx_event_handler;
 
     // todo remove below
     memset( ModemResponsePacket, 0, HW_MODEM_RX_BUFF_MAX_LENGTH );
-    hw_cmd_available             = false;
-    is_hw_modem_ready_to_receive = true;
+    hw_cmd_available       = false;
+    is_response_tx_ongoing = false;
+
+    hw_modem_start_reception( );
+
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+    // the low power uart receives in stop mode, the host can send its commands at any time
+    bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 0 );
+#endif
 
     // init the soft modem
     modem_init( &hw_modem_event_handler );
 
+    // restore the negotiated baud rate, the host still has to prove it can use it
+    uint8_t saved_baudrate_index;
+    modem_get_host_baudrate( &saved_baudrate_index );
+    if( ( saved_baudrate_index != DEFAULT_HOST_BAUDRATE_INDEX ) && ( saved_baudrate_index < HW_MODEM_BAUDRATE_NB ) )
+    {
+        hw_modem_apply_baudrate( saved_baudrate_index, false );
+    }
+
 #if defined( PERF_TEST_ENABLED )
     BSP_PERF_TEST_TRACE_PRINTF( "HARDWARE MODEM RUNNING PERF TEST MODE\n" );
 #endif
@@ -117,101 +197,202 @@ void hw_modem_init( void )
 
 void hw_modem_start_reception( void )
 {
-    memset( ModemRxBuffer, 0xFF, HW_MODEM_RX_BUFF_MAX_LENGTH );
-
-    // during the receive process the hw modem cannot accept an other cmd, prevent it
-    is_hw_modem_ready_to_receive = false;
-
-    // receive on dma
-    bsp_uart1_dma_start_rx( ModemRxBuffer, HW_MODEM_RX_BUFF_MAX_LENGTH );
+    ModemRxRingReadIndex = 0;
 
-    // indicate to bridge or host that the modem is ready to receive on uart
-    bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 0 );
+    // receive on dma, the ring is filled behind the cpu back and read by hw_modem_process_cmd
+    bsp_uart1_dma_start_rx_circular( ModemRxRing, HW_MODEM_RX_RING_SIZE, &rx_event_irq );
 }
 
 void hw_modem_process_cmd( void )
 {
-    uint8_t             CmdLength = 0xFF;
+    uint8_t             CmdLength    = 0xFF;
+    uint16_t            RxLength     = hw_modem_rx_ring_get_length( );
+    uint16_t            FrameLength  = RxLength;
+    bool                IsFrameValid = false;
     s_cmd_response_t    output;
     s_cmd_input_t       input;
     modem_return_code_t ResponseReturnCode;
 
-    // todo: is this check below realy needed?
-    if( ModemRxBuffer[0] < 0xFF )
+    if( RxLength == 0 )
     {
-        CmdLength   = ModemRxBuffer[1];
-        uint8_t Lrc = 0;
-        for( int i = 0; i < CmdLength + 2; i++ )
+        return;
+    }
+
+    // a frame is made of cmd type, length, payload and lrc
+    if( RxLength >= 2 )
+    {
+        CmdLength = ModemRxRing[( ModemRxRingReadIndex + 1 ) % HW_MODEM_RX_RING_SIZE];
+        if( RxLength >= ( CmdLength + 3 ) )
         {
-            Lrc = Lrc ^ ModemRxBuffer[i];
+            FrameLength  = CmdLength + 3;
+            IsFrameValid = true;
         }
-        uint8_t         CalculatedLrc = Lrc;
-        uint8_t         CmdLrc        = ModemRxBuffer[CmdLength + 2];
-        host_cmd_type_t CmdType       = ( host_cmd_type_t ) ModemRxBuffer[0];
+    }
+
+    // copy the frame out of the ring, an incomplete one left by the host at the end of its burst is dropped
+    for( uint16_t i = 0; i < FrameLength; i++ )
+    {
+        ModemRxBuffer[i]     = ModemRxRing[ModemRxRingReadIndex];
+        ModemRxRingReadIndex = ( ModemRxRingReadIndex + 1 ) % HW_MODEM_RX_RING_SIZE;
+    }
 
-        if( CalculatedLrc != CmdLrc )
+    uint8_t Lrc = 0;
+    if( IsFrameValid == true )
+    {
+        for( int i = 0; i < CmdLength + 2; i++ )
         {
-            ResponseReturnCode = RC_FRAME_ERROR;
-            ResponseLength     = 0;
-            BSP_DBG_TRACE_PRINTF( "Cmd with bad crc %x / %x", CalculatedLrc, CmdLrc );
+            Lrc = Lrc ^ ModemRxBuffer[i];
         }
-        else if( ( ModemRxBuffer[CmdLength + 3] != 0xFF ) && ( CmdLength != 0xFF ) )
+    }
+    uint8_t         CalculatedLrc = Lrc;
+    uint8_t         CmdLrc        = ModemRxBuffer[CmdLength + 2];
+    host_cmd_type_t CmdType       = ( host_cmd_type_t ) ModemRxBuffer[0];
+
+    if( is_baudrate_confirmed == false )
+    {
+        if( ( IsFrameValid == true ) && ( CalculatedLrc == CmdLrc ) )
         {
-            // Too Many cmd enqueued
-            ResponseReturnCode = RC_FRAME_ERROR;
-            ResponseLength     = 0;
-            BSP_DBG_TRACE_WARNING( " Extra data after the command\n" );
+            // the host talks at the new baud rate, keep it
+            is_baudrate_confirmed = true;
+            modem_set_host_baudrate( baudrate_index );
         }
-        else  // go into soft modem
+        else
         {
-            BSP_DBG_TRACE_ARRAY( "Cmd input uart", ModemRxBuffer, CmdLength + 2 );
-            input.cmd_code = CmdType;
-            input.length   = CmdLength;
-            input.buffer   = &ModemRxBuffer[2];
-            output.buffer  = &ModemResponsePacket[2];
-            parse_cmd( &input, &output );
-            ResponseReturnCode = output.return_code;
-            ResponseLength     = output.length;
+            // negotiation failed, fall back to the default baud rate before answering
+            BSP_DBG_TRACE_WARNING( " Baud rate %u not confirmed by the host\n", hw_modem_baudrates[baudrate_index] );
+            hw_modem_apply_baudrate( DEFAULT_HOST_BAUDRATE_INDEX, true );
+            modem_set_host_baudrate( DEFAULT_HOST_BAUDRATE_INDEX );
         }
+    }
 
-        ModemResponsePacket[0] = ResponseReturnCode;
-        ModemResponsePacket[1] = ResponseLength;
+    if( IsFrameValid == false )
+    {
+        ResponseReturnCode = RC_FRAME_ERROR;
+        ResponseLength     = 0;
+        BSP_DBG_TRACE_WARNING( " Incomplete command of %d bytes\n", FrameLength );
+    }
+    else if( CalculatedLrc != CmdLrc )
+    {
+        ResponseReturnCode = RC_FRAME_ERROR;
+        ResponseLength     = 0;
+        BSP_DBG_TRACE_PRINTF( "Cmd with bad crc %x / %x", CalculatedLrc, CmdLrc );
+    }
+    else  // go into soft modem
+    {
+        BSP_DBG_TRACE_ARRAY( "Cmd input uart", ModemRxBuffer, CmdLength + 2 );
+        BSP_PERF_EVENT( BSP_PERF_EVENT_HOST_CMD, CmdType );
+        input.cmd_code = CmdType;
+        input.length   = CmdLength;
+        input.buffer   = &ModemRxBuffer[2];
+        output.buffer  = &ModemResponsePacket[2];
+        parse_cmd( &input, &output );
+        ResponseReturnCode = output.return_code;
+        ResponseLength     = output.length;
+    }
 
-        BSP_DBG_TRACE_ARRAY( "Cmd output on uart", ModemResponsePacket, ResponseLength + 2 );
+    ModemResponsePacket[0] = ResponseReturnCode;
+    ModemResponsePacket[1] = ResponseLength;
 
-        // now the hw modem can accept new commands
-        is_hw_modem_ready_to_receive = true;
-        hw_cmd_available             = false;
+    BSP_DBG_TRACE_ARRAY( "Cmd output on uart", ModemResponsePacket, ResponseLength + 2 );
 
-        // set busy pin to indicate to bridge or host that the hw_modem answer will be soon sent
-        bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 1 );
+    // the next queued command is processed once the response has been sent, see hw_modem_response_tx_done_handler
+    is_response_tx_ongoing = true;
 
-        // wait to to bridge delay
-        bsp_mcu_wait_us( 1000 );
+    // set busy pin to indicate to bridge or host that the hw_modem answer will be soon sent
+    bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 1 );
 
-        for( int i = 0; i < ResponseLength + 2; i++ )
-        {
-            Lrc = Lrc ^ ModemResponsePacket[i];
-        }
-        ModemResponsePacket[ResponseLength + 2] = Lrc;
+    // wait to to bridge delay
+    bsp_mcu_wait_us( 1000 );
 
-        // bsp_uart_put_buffer( 1, ModemResponsePacket, ResponseLength + 3 );
-        bsp_uart1_tx( ModemResponsePacket, ResponseLength + 3 );
-    }
-    else
+    Lrc = 0;
+    for( int i = 0; i < ResponseLength + 2; i++ )
     {
-        // now the hw modem can accept new commands
-        is_hw_modem_ready_to_receive = true;
-        hw_cmd_available             = false;
+        Lrc = Lrc ^ ModemResponsePacket[i];
+    }
+    ModemResponsePacket[ResponseLength + 2] = Lrc;
+
+    // keep the uart clocked until the end of the transmission, stop mode would freeze it
+    bsp_mcu_disable_low_power_wait( );
+    bsp_uart1_dma_tx( ModemResponsePacket, ResponseLength + 3, &response_tx_irq );
+}
 
-        // set busy pin to indicate to bridge or host that the hw_modem answer will be soon sent
-        bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 1 );
+bool hw_modem_set_baudrate( uint8_t index )
+{
+    if( index >= HW_MODEM_BAUDRATE_NB )
+    {
+        return false;
     }
+
+    // the response to the current command is still sent at the current baud rate
+    pending_baudrate_index = index;
+    return true;
+}
+
+uint8_t hw_modem_get_baudrate( void )
+{
+    return baudrate_index;
+}
+
+void hw_modem_set_event_push( bool is_enabled )
+{
+    is_event_push_enabled = is_enabled;
+    // the events already pending are pushed as soon as the response to this command has been sent
+    is_event_push_pending = ( is_enabled == true ) && ( get_asynchronous_msgnumber( ) > 0 );
+}
+
+uint32_t hw_modem_get_ram_size( void )
+{
+    return sizeof( ModemResponsePacket ) + sizeof( ModemRxBuffer ) + sizeof( ModemRxRing );
 }
 
 bool hw_modem_is_a_cmd_available( void )
 {
-    return hw_cmd_available;
+    if( is_response_tx_ongoing == true )
+    {
+        return false;
+    }
+
+    // the events are only pushed between two commands, the host reads one frame at a time
+    if( ( is_event_push_pending == true ) && ( hw_modem_rx_ring_get_length( ) == 0 )
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_OFF )
+        && ( bsp_gpio_get_value( HW_MODEM_COMMAND_PIN ) == 1 )
+#endif
+    )
+    {
+        hw_modem_push_events( );
+        return false;
+    }
+
+    if( hw_cmd_available == false )
+    {
+        return false;
+    }
+
+    // cleared before looking at the ring, the rx irq sets it again if more bytes come in meanwhile
+    hw_cmd_available = false;
+
+    uint16_t RxLength = hw_modem_rx_ring_get_length( );
+
+    if( RxLength >= 2 )
+    {
+        uint8_t CmdLength = ModemRxRing[( ModemRxRingReadIndex + 1 ) % HW_MODEM_RX_RING_SIZE];
+        if( RxLength >= ( CmdLength + 3 ) )
+        {
+            hw_cmd_available = true;
+            return true;
+        }
+    }
+
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_OFF )
+    // while the host holds the COMMAND line the rest of the frame is still to come
+    if( ( RxLength > 0 ) && ( bsp_gpio_get_value( HW_MODEM_COMMAND_PIN ) == 1 ) )
+    {
+        hw_cmd_available = true;
+        return true;
+    }
+#endif
+
+    return false;
 }
 
 /*
@@ -219,36 +400,146 @@ bool hw_modem_is_a_cmd_available( void )
  * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
  */
 
-void wakeup_line_irq_handler( void* constext )
+static uint16_t hw_modem_rx_ring_get_length( void )
 {
-    if( ( bsp_gpio_get_value( HW_MODEM_COMMAND_PIN ) == 0 ) && ( is_hw_modem_ready_to_receive == true ) )
+    return ( bsp_uart1_dma_get_rx_index( ) + HW_MODEM_RX_RING_SIZE - ModemRxRingReadIndex ) % HW_MODEM_RX_RING_SIZE;
+}
+
+static void hw_modem_push_events( void )
+{
+    uint8_t length;
+    uint8_t asynchronous_msgnumber;
+    uint8_t Lrc = 0;
+
+    // same packing as the GETEVENTS response, the events left over go in the next frame
+    modem_get_events( &ModemResponsePacket[2], UINT8_MAX, &length, &asynchronous_msgnumber );
+    is_event_push_pending = ( asynchronous_msgnumber > 0 );
+    if( asynchronous_msgnumber == 0 )
     {
-        // start receiving uart with dma
-        hw_modem_start_reception( );
+        bsp_gpio_set_value( HW_MODEM_EVENT_PIN, 0 );
+    }
+
+    ModemResponsePacket[0] = HW_MODEM_EVENT_PUSH_FRAME;
+    ModemResponsePacket[1] = length;
+    for( int i = 0; i < length + 2; i++ )
+    {
+        Lrc = Lrc ^ ModemResponsePacket[i];
+    }
+    ModemResponsePacket[length + 2] = Lrc;
+
+    BSP_DBG_TRACE_ARRAY( "Event push on uart", ModemResponsePacket, length + 3 );
+
+    // handled as a response: the host waits for its end before sending a command
+    is_response_tx_ongoing = true;
+    bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 1 );
+    bsp_mcu_wait_us( 1000 );
+
+    bsp_mcu_disable_low_power_wait( );
+    bsp_uart1_dma_tx( ModemResponsePacket, length + 3, &response_tx_irq );
+}
+
+static void hw_modem_apply_baudrate( uint8_t index, bool is_confirmed )
+{
+    baudrate_index        = index;
+    is_baudrate_confirmed = is_confirmed;
 
-        // force exit of stop mode
+    // bytes received at the previous baud rate are dropped
+    bsp_uart1_set_baudrate( hw_modem_baudrates[index] );
+    hw_modem_start_reception( );
+}
+
+void wakeup_line_irq_handler( void* constext )
+{
+    if( bsp_gpio_get_value( HW_MODEM_COMMAND_PIN ) == 0 )
+    {
+        // force exit of stop mode, the uart has to stay clocked while the host sends its commands
         bsp_mcu_disable_low_power_wait( );
 
+        // the uart is shut down in stop mode, the ring was empty then
+        if( bsp_uart1_dma_is_rx_circular_running( ) == false )
+        {
+            hw_modem_start_reception( );
+        }
+
+        // indicate to bridge or host that the modem is ready to receive on uart
+        if( is_response_tx_ongoing == false )
+        {
+            bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 0 );
+        }
+
         // TEMPORARY WORKAROUND to avoid issue for print in hw_modem_process_cmd function
         bsp_mcu_wait_us( 2000 );
     }
-    if( ( bsp_gpio_get_value( HW_MODEM_COMMAND_PIN ) == 1 ) && ( is_hw_modem_ready_to_receive == false ) )
+    else
     {
-        // stop uart on dma reception
-        bsp_uart1_dma_stop_rx( );
-
-        // inform that a command has arrived
+        // inform that commands may have arrived
         hw_cmd_available = true;
 
+        if( is_response_tx_ongoing == false )
+        {
+            // force one more loop in main loop and then re-enable low power feature
+            bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_HOST );
+        }
+    }
+}
+
+void hw_modem_response_tx_done_handler( void* context )
+{
+    is_response_tx_ongoing = false;
+
+    if( pending_baudrate_index != HW_MODEM_BAUDRATE_NONE )
+    {
+        hw_modem_apply_baudrate( pending_baudrate_index, pending_baudrate_index == DEFAULT_HOST_BAUDRATE_INDEX );
+        pending_baudrate_index = HW_MODEM_BAUDRATE_NONE;
+    }
+
+    // look for the next queued command
+    hw_cmd_available = true;
+
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+    // the host may send its next command, the start bit wakes the modem up if it is in stop mode meanwhile
+    bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 0 );
+    bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_HOST );
+#else
+    if( bsp_gpio_get_value( HW_MODEM_COMMAND_PIN ) == 0 )
+    {
+        // the host is still pipelining commands
+        bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 0 );
+    }
+    else
+    {
         // force one more loop in main loop and then re-enable low power feature
-        bsp_mcu_disable_once_low_power_wait( );
+        bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_HOST );
     }
+#endif
+}
+
+void hw_modem_rx_event_handler( void* context )
+{
+#if( BSP_USER_UART_LPUART == BSP_FEATURE_ON )
+    // a start bit woke the modem up or bytes have been received: look at the ring before going back to stop mode,
+    // the dma only moves the bytes while the mcu is awake and the next start bit wakes it up again
+    hw_cmd_available = true;
+    if( is_response_tx_ongoing == false )
+    {
+        bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_HOST );
+    }
+#else
+    // inform that a command may have arrived, low power is already disabled while the COMMAND line is held
+    hw_cmd_available = true;
+#endif
 }
 
 void hw_modem_event_handler( void )
 {
     // raise the event line to indicate to host that events are available
     bsp_gpio_set_value( HW_MODEM_EVENT_PIN, 1 );
+    if( is_event_push_enabled == true )
+    {
+        // pushed by the main loop once the host link is idle
+        is_event_push_pending = true;
+        bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_HOST );
+    }
     BSP_DBG_TRACE_MSG_COLOR( "CB\n", BSP_DBG_TRACE_COLOR_BLUE );
 }
 
@@ -49,6 +49,9 @@ extern "C" {
  * --- PUBLIC CONSTANTS --------------------------------------------------------
  */
 
+// First byte of an event frame pushed by the modem, in place of the return code of a response
+#define HW_MODEM_EVENT_PUSH_FRAME 0xFE
+
 /*
  * -----------------------------------------------------------------------------
  * --- PUBLIC TYPES ------------------------------------------------------------
@@ -83,6 +86,45 @@ void hw_modem_process_cmd( void );
  */
 bool hw_modem_is_a_cmd_available( void );
 
+/**
+ * @brief fonction that requests a new host link baud rate
+ *
+ * The switch happens once the response to the current command has been sent. The first command received at the
+ * new baud rate confirms and saves it, a corrupted one makes the modem fall back to the default baud rate.
+ *
+ * @param [in] index  index of the baud rate [0: 115200, 1: 230400, 2: 460800, 3: 921600, 4: 2000000]
+ * @return true if the baud rate is supported
+ */
+bool hw_modem_set_baudrate( uint8_t index );
+
+/**
+ * @brief fonction that gives the current host link baud rate
+ *
+ * @param [none]
+ * @return index of the baud rate, see hw_modem_set_baudrate
+ */
+uint8_t hw_modem_get_baudrate( void );
+
+/**
+ * @brief fonction that enables the push of the events to the host
+ *
+ * Once enabled, the modem sends the pending events by itself when the host link is idle, in a frame made of
+ * HW_MODEM_EVENT_PUSH_FRAME, the length, the events packed as in the GETEVENTS response and the lrc. The EVENT line
+ * is still raised until all the events have been sent, to wake the host up.
+ *
+ * @param [in] is_enabled  true to push the events, false to let the host read them with GETEVENT(S)
+ * @return [none]
+ */
+void hw_modem_set_event_push( bool is_enabled );
+
+/**
+ * @brief fonction that gives the RAM taken by the host link buffers
+ *
+ * @param [none]
+ * @return size in bytes of the command, response and reception ring buffers
+ */
+uint32_t hw_modem_get_ram_size( void );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,353 @@
+/*!
+ * \file      hw_modem_spi.c
+ *
+ * \brief     handle hw part of the modem on a SPI host link
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * The host is the SPI master, the frames are the ones of the uart link: cmd type, length, payload and lrc for a
+ * command, return code, length, payload and lrc for a response. Each transfer is framed by the COMMAND line:
+ *  - command: the host asserts COMMAND, waits for BUSY low, clocks the command frame and releases COMMAND. BUSY
+ *    goes high until the response is ready.
+ *  - response: once BUSY is low again the host asserts COMMAND, clocks the 2 header bytes then the payload and the
+ *    lrc, and releases COMMAND. BUSY goes high.
+ * When the events are pushed, a pushed frame is armed like a response while the link is idle: the host finding BUSY
+ * low without having sent a command reads it the same way. A command clocked meanwhile is dropped, the host sees
+ * HW_MODEM_EVENT_PUSH_FRAME in place of the return code and sends its command again.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "hw_modem.h"
+#include "cmd_parser.h"
+
+#if( BSP_USE_HOST_SPI == BSP_FEATURE_OFF )
+#error "The SPI host link needs BSP_USE_HOST_SPI, build with make hard_modem HOST_SPI=1"
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+#define HW_MODEM_RX_BUFF_MAX_LENGTH 259
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+typedef enum hw_modem_spi_state_e
+{
+    HW_MODEM_SPI_IDLE,       // nothing armed, BUSY high
+    HW_MODEM_SPI_CMD_RX,     // command reception armed, BUSY low
+    HW_MODEM_SPI_CMD_READY,  // command received, BUSY high until its response is armed
+    HW_MODEM_SPI_RSP_TX,     // response or pushed events armed, BUSY low
+} hw_modem_spi_state_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+
+static uint8_t                       ModemResponsePacket[HW_MODEM_RX_BUFF_MAX_LENGTH];
+static uint8_t                       ModemRxBuffer[HW_MODEM_RX_BUFF_MAX_LENGTH];
+static volatile uint16_t             ModemRxLength;
+static volatile hw_modem_spi_state_t spi_state             = HW_MODEM_SPI_IDLE;
+static volatile bool                 is_cmd_rx_requested   = false;
+static bool                          is_event_push_enabled = false;
+static volatile bool                 is_event_push_pending = false;
+static bsp_gpio_irq_t                wakeup_line_irq       = { 0 };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief arm a frame to be clocked out by the host and tell it with the BUSY line
+ * @param [in] length  frame length, lrc included
+ * @return none
+ */
+static void hw_modem_arm_response( uint8_t length );
+
+/**
+ * @brief send the pending events to the host in a pushed frame, the host link must be idle
+ * @param [none]
+ * @return none
+ */
+static void hw_modem_push_events( void );
+
+/**
+ * @brief function that will be called every time the COMMAND line in asserted or de-asserted by the host
+ * @param *context  unused context
+ * @return none
+ */
+void wakeup_line_irq_handler( void* context );
+
+/**
+ * @brief function that will be called by the soft modem engine each time an async event is available
+ * @param *context  unused context
+ * @return none
+ */
+void hw_modem_event_handler( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void hw_modem_init( void )
+{
+    // init hw modem pins
+    bsp_gpio_init_out( HW_MODEM_EVENT_PIN, 0 );
+    bsp_gpio_init_out( HW_MODEM_BUSY_PIN, 1 );
+
+    // the COMMAND line frames the transfers, the SPI peripheral has been set up by the bsp
+    wakeup_line_irq.pin      = HW_MODEM_COMMAND_PIN;
+    wakeup_line_irq.context  = NULL;
+    wakeup_line_irq.callback = wakeup_line_irq_handler;
+    bsp_gpio_init_in( HW_MODEM_COMMAND_PIN, BSP_GPIO_PULL_MODE_UP, BSP_GPIO_IRQ_MODE_RISING_FALLING, &wakeup_line_irq );
+
+    spi_state           = HW_MODEM_SPI_IDLE;
+    is_cmd_rx_requested = false;
+
+    // init the soft modem
+    modem_init( &hw_modem_event_handler );
+
+#if defined( PERF_TEST_ENABLED )
+    BSP_PERF_TEST_TRACE_PRINTF( "HARDWARE MODEM RUNNING PERF TEST MODE\n" );
+#endif
+}
+
+void hw_modem_process_cmd( void )
+{
+    uint8_t             CmdLength    = 0xFF;
+    bool                IsFrameValid = false;
+    s_cmd_response_t    output;
+    s_cmd_input_t       input;
+    modem_return_code_t ResponseReturnCode;
+    uint8_t             ResponseLength = 0;
+    uint8_t             Lrc            = 0;
+
+    // a frame is made of cmd type, length, payload and lrc, the bytes clocked beyond are dropped
+    if( ModemRxLength >= 2 )
+    {
+        CmdLength    = ModemRxBuffer[1];
+        IsFrameValid = ( ModemRxLength >= ( CmdLength + 3 ) );
+    }
+
+    if( IsFrameValid == false )
+    {
+        ResponseReturnCode = RC_FRAME_ERROR;
+        BSP_DBG_TRACE_WARNING( " Incomplete command of %d bytes\n", ModemRxLength );
+    }
+    else
+    {
+        for( int i = 0; i < CmdLength + 2; i++ )
+        {
+            Lrc = Lrc ^ ModemRxBuffer[i];
+        }
+
+        if( Lrc != ModemRxBuffer[CmdLength + 2] )
+        {
+            ResponseReturnCode = RC_FRAME_ERROR;
+            BSP_DBG_TRACE_PRINTF( "Cmd with bad crc %x / %x", Lrc, ModemRxBuffer[CmdLength + 2] );
+        }
+        else  // go into soft modem
+        {
+            BSP_DBG_TRACE_ARRAY( "Cmd input spi", ModemRxBuffer, CmdLength + 2 );
+            BSP_PERF_EVENT( BSP_PERF_EVENT_HOST_CMD, ModemRxBuffer[0] );
+            input.cmd_code = ( host_cmd_type_t ) ModemRxBuffer[0];
+            input.length   = CmdLength;
+            input.buffer   = &ModemRxBuffer[2];
+            output.buffer  = &ModemResponsePacket[2];
+            parse_cmd( &input, &output );
+            ResponseReturnCode = output.return_code;
+            ResponseLength     = output.length;
+        }
+    }
+
+    ModemResponsePacket[0] = ResponseReturnCode;
+    ModemResponsePacket[1] = ResponseLength;
+
+    Lrc = 0;
+    for( int i = 0; i < ResponseLength + 2; i++ )
+    {
+        Lrc = Lrc ^ ModemResponsePacket[i];
+    }
+    ModemResponsePacket[ResponseLength + 2] = Lrc;
+
+    BSP_DBG_TRACE_ARRAY( "Cmd output on spi", ModemResponsePacket, ResponseLength + 2 );
+
+    hw_modem_arm_response( ResponseLength + 3 );
+}
+
+bool hw_modem_set_baudrate( uint8_t index )
+{
+    // the host clocks the link, it picks the speed by itself
+    return false;
+}
+
+uint8_t hw_modem_get_baudrate( void )
+{
+    return DEFAULT_HOST_BAUDRATE_INDEX;
+}
+
+void hw_modem_set_event_push( bool is_enabled )
+{
+    is_event_push_enabled = is_enabled;
+    // the events already pending are pushed as soon as the response to this command has been read
+    is_event_push_pending = ( is_enabled == true ) && ( get_asynchronous_msgnumber( ) > 0 );
+}
+
+uint32_t hw_modem_get_ram_size( void )
+{
+    return sizeof( ModemResponsePacket ) + sizeof( ModemRxBuffer );
+}
+
+bool hw_modem_is_a_cmd_available( void )
+{
+    if( spi_state == HW_MODEM_SPI_CMD_READY )
+    {
+        return true;
+    }
+
+    if( spi_state != HW_MODEM_SPI_IDLE )
+    {
+        return false;
+    }
+
+    if( is_cmd_rx_requested == true )
+    {
+        // armed from the main loop, the SPI is clocked again once out of stop mode
+        is_cmd_rx_requested = false;
+        spi_state           = HW_MODEM_SPI_CMD_RX;
+        bsp_spi_slave_dma_start( BSP_HOST_SPI_ID, NULL, ModemRxBuffer, HW_MODEM_RX_BUFF_MAX_LENGTH );
+        bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 0 );
+    }
+    else if( is_event_push_pending == true )
+    {
+        hw_modem_push_events( );
+    }
+
+    return false;
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void hw_modem_arm_response( uint8_t length )
+{
+    // the SPI must stay clocked until the host has read the frame, stop mode would freeze it
+    bsp_mcu_disable_low_power_wait( );
+    spi_state = HW_MODEM_SPI_RSP_TX;
+    bsp_spi_slave_dma_start( BSP_HOST_SPI_ID, ModemResponsePacket, NULL, length );
+    bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 0 );
+}
+
+static void hw_modem_push_events( void )
+{
+    uint8_t length;
+    uint8_t asynchronous_msgnumber;
+    uint8_t Lrc = 0;
+
+    // same packing as the GETEVENTS response, the events left over go in the next frame
+    modem_get_events( &ModemResponsePacket[2], UINT8_MAX, &length, &asynchronous_msgnumber );
+    is_event_push_pending = ( asynchronous_msgnumber > 0 );
+    if( asynchronous_msgnumber == 0 )
+    {
+        bsp_gpio_set_value( HW_MODEM_EVENT_PIN, 0 );
+    }
+
+    ModemResponsePacket[0] = HW_MODEM_EVENT_PUSH_FRAME;
+    ModemResponsePacket[1] = length;
+    for( int i = 0; i < length + 2; i++ )
+    {
+        Lrc = Lrc ^ ModemResponsePacket[i];
+    }
+    ModemResponsePacket[length + 2] = Lrc;
+
+    BSP_DBG_TRACE_ARRAY( "Event push on spi", ModemResponsePacket, length + 3 );
+
+    hw_modem_arm_response( length + 3 );
+}
+
+void wakeup_line_irq_handler( void* context )
+{
+    if( bsp_gpio_get_value( HW_MODEM_COMMAND_PIN ) == 0 )
+    {
+        if( spi_state == HW_MODEM_SPI_IDLE )
+        {
+            // the reception is armed by the main loop, stop mode is left for good until the command is read
+            is_cmd_rx_requested = true;
+            bsp_mcu_disable_low_power_wait( );
+        }
+        // otherwise the host reads the armed response
+    }
+    else if( spi_state == HW_MODEM_SPI_CMD_RX )
+    {
+        bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 1 );
+        ModemRxLength = bsp_spi_slave_dma_stop( BSP_HOST_SPI_ID );
+        spi_state     = HW_MODEM_SPI_CMD_READY;
+        bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_HOST );
+    }
+    else if( spi_state == HW_MODEM_SPI_RSP_TX )
+    {
+        bsp_gpio_set_value( HW_MODEM_BUSY_PIN, 1 );
+        bsp_spi_slave_dma_stop( BSP_HOST_SPI_ID );
+        spi_state = HW_MODEM_SPI_IDLE;
+
+        // force one more loop in main loop, for the events to push, and then re-enable low power feature
+        bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_HOST );
+    }
+}
+
+void hw_modem_event_handler( void )
+{
+    // raise the event line to indicate to host that events are available
+    bsp_gpio_set_value( HW_MODEM_EVENT_PIN, 1 );
+    if( is_event_push_enabled == true )
+    {
+        // pushed by the main loop once the host link is idle
+        is_event_push_pending = true;
+        bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_HOST );
+    }
+    BSP_DBG_TRACE_MSG_COLOR( "CB\n", BSP_DBG_TRACE_COLOR_BLUE );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -0,0 +1,134 @@
+/*!
+ * \file      ipc_modem.c
+ *
+ * \brief     serve the modem commands to the application core of a dual-core MCU
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2021. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "ipc_modem.h"
+#include "cmd_parser.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC VARIABLES --------------------------------------------------------
+ */
+
+ipc_modem_mailbox_t ipc_modem_mailbox __attribute__( ( section( IPC_MODEM_MAILBOX_SECTION ) ) );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+
+/**
+ * @brief function that will be called by the soft modem engine each time an async event is available
+ * @param [none]
+ * @return none
+ */
+static void ipc_modem_event_handler( void );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+void ipc_modem_init( void )
+{
+    // the shared RAM is not initialized by the startup code of either core
+    ipc_modem_mailbox.state         = IPC_MODEM_STATE_IDLE;
+    ipc_modem_mailbox.event_pending = 0;
+
+    // init the soft modem
+    modem_init( &ipc_modem_event_handler );
+
+#if defined( PERF_TEST_ENABLED )
+    BSP_PERF_TEST_TRACE_PRINTF( "IPC MODEM RUNNING PERF TEST MODE\n" );
+#endif
+}
+
+bool ipc_modem_is_a_cmd_available( void )
+{
+    return ( ipc_modem_mailbox.state == IPC_MODEM_STATE_CMD ) ? true : false;
+}
+
+void ipc_modem_process_cmd( void )
+{
+    s_cmd_input_t    input;
+    s_cmd_response_t output;
+
+    if( ipc_modem_mailbox.state != IPC_MODEM_STATE_CMD )
+    {
+        return;
+    }
+    // the payload must not be read before the state written last by the application core
+    __sync_synchronize( );
+
+    BSP_PERF_EVENT( BSP_PERF_EVENT_HOST_CMD, ipc_modem_mailbox.cmd_code );
+
+    // parse in place, the response is written straight into the mailbox
+    input.cmd_code = ( host_cmd_type_t ) ipc_modem_mailbox.cmd_code;
+    input.length   = ipc_modem_mailbox.cmd_length;
+    input.buffer   = ipc_modem_mailbox.cmd_payload;
+    output.buffer  = ipc_modem_mailbox.rsp_payload;
+    parse_cmd( &input, &output );
+
+    ipc_modem_mailbox.rsp_code   = output.return_code;
+    ipc_modem_mailbox.rsp_length = output.length;
+
+    __sync_synchronize( );
+    ipc_modem_mailbox.state = IPC_MODEM_STATE_RSP;
+    ipc_modem_port_notify( );
+}
+
+void ipc_modem_cmd_irq_handler( void )
+{
+    // the command is read by the main loop
+    bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_HOST );
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void ipc_modem_event_handler( void )
+{
+    // cleared by the application core before it reads the events with GETEVENT
+    ipc_modem_mailbox.event_pending = 1;
+    __sync_synchronize( );
+    ipc_modem_port_notify( );
+}
+
+/* --- EOF ------------------------------------------------------------------ */
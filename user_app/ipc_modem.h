@@ -0,0 +1,189 @@
+/*!
+ * \file      ipc_modem.h
+ *
+ * \brief     serve the modem commands to the application core of a dual-core MCU
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2021. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __IPC_MODEM__H
+#define __IPC_MODEM__H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC CONSTANTS --------------------------------------------------------
+ */
+
+// Largest command and response payloads, same as the uart frames of hw_modem
+#define IPC_MODEM_PAYLOAD_MAX_LENGTH 255
+
+// Section of the mailbox, placed at the same shared RAM address (NOLOAD) by the linker scripts of both cores
+#ifndef IPC_MODEM_MAILBOX_SECTION
+#define IPC_MODEM_MAILBOX_SECTION ".ipc_modem_mailbox"
+#endif
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC TYPES ------------------------------------------------------------
+ */
+
+/*!
+ * \brief Owner of the mailbox
+ */
+typedef enum ipc_modem_state_e
+{
+    IPC_MODEM_STATE_IDLE = 0,  //!< The application core may write a command
+    IPC_MODEM_STATE_CMD  = 1,  //!< A command is posted, owned by the modem core
+    IPC_MODEM_STATE_RSP  = 2,  //!< The response is ready, owned by the application core
+} ipc_modem_state_t;
+
+/*!
+ * \brief Mailbox shared by both cores
+ *
+ * \remark The payloads are read and written in place by both sides, a command costs no copy on either core
+ */
+typedef struct ipc_modem_mailbox_s
+{
+    volatile uint8_t state;          //!< See ipc_modem_state_t
+    volatile uint8_t event_pending;  //!< Set by the modem core, cleared by the application core
+    uint8_t          cmd_code;       //!< host_cmd_type_t of the command
+    uint8_t          cmd_length;
+    uint8_t          rsp_code;  //!< modem_return_code_t of the response
+    uint8_t          rsp_length;
+    uint8_t          cmd_payload[IPC_MODEM_PAYLOAD_MAX_LENGTH];
+    uint8_t          rsp_payload[IPC_MODEM_PAYLOAD_MAX_LENGTH];
+} ipc_modem_mailbox_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC VARIABLES --------------------------------------------------------
+ */
+
+/*!
+ * \brief The mailbox, defined by ipc_modem.c in the modem image and by ipc_modem_client.c in the
+ *        application image
+ */
+extern ipc_modem_mailbox_t ipc_modem_mailbox;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+/**
+ * @brief init the mailbox and the soft modem, replaces hw_modem_init on the radio core
+ *
+ * @param [none]
+ * @return [none]
+ */
+void ipc_modem_init( void );
+
+/**
+ * @brief fonction that indicate if a command has been posted by the application core
+ *
+ * @param [none]
+ * @return true if a command waits in the mailbox
+ */
+bool ipc_modem_is_a_cmd_available( void );
+
+/**
+ * @brief fonction that runs the posted command in place and hands the response back to the application core
+ *
+ * @param [none]
+ * @return [none]
+ */
+void ipc_modem_process_cmd( void );
+
+/**
+ * @brief to be called by the inter-processor interrupt of the board when the application core posts a command
+ *
+ * @param [none]
+ * @return [none]
+ */
+void ipc_modem_cmd_irq_handler( void );
+
+/**
+ * @brief post the command written in ipc_modem_mailbox.cmd_payload and wait for its response
+ *
+ * To be used on the application core: the response payload is read in place from ipc_modem_mailbox.rsp_payload,
+ * then the mailbox is given back with ipc_modem_client_release.
+ *
+ * @param [in]  cmd_code    host_cmd_type_t of the command
+ * @param [in]  cmd_length  length of the command payload
+ * @param [out] rsp_length  length of the response payload
+ * @return modem_return_code_t of the response
+ */
+uint8_t ipc_modem_client_call( uint8_t cmd_code, uint8_t cmd_length, uint8_t* rsp_length );
+
+/**
+ * @brief give the mailbox back once the response payload has been read
+ *
+ * @param [none]
+ * @return [none]
+ */
+void ipc_modem_client_release( void );
+
+/**
+ * @brief tell whether the modem has events to be read with the GETEVENT command, clears the indication
+ *
+ * @param [none]
+ * @return true if events are pending
+ */
+bool ipc_modem_client_is_event_pending( void );
+
+/**
+ * @brief ring the doorbell of the other core, implemented by the board (IPCC channel, SEV, ...)
+ *
+ * @param [none]
+ * @return [none]
+ */
+void ipc_modem_port_notify( void );
+
+/**
+ * @brief wait for the doorbell of the modem core on the application core, implemented by the board
+ *
+ * @param [none]
+ * @return [none]
+ */
+void ipc_modem_port_wait( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //__IPC_MODEM__H
@@ -0,0 +1,89 @@
+/*!
+ * \file      ipc_modem_client.c
+ *
+ * \brief     send the modem commands from the application core of a dual-core MCU
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2021. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+
+#include "ipc_modem.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC VARIABLES --------------------------------------------------------
+ */
+
+ipc_modem_mailbox_t ipc_modem_mailbox __attribute__( ( section( IPC_MODEM_MAILBOX_SECTION ) ) );
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+uint8_t ipc_modem_client_call( uint8_t cmd_code, uint8_t cmd_length, uint8_t* rsp_length )
+{
+    // the payload has already been written in place by the caller
+    ipc_modem_mailbox.cmd_code   = cmd_code;
+    ipc_modem_mailbox.cmd_length = cmd_length;
+
+    __sync_synchronize( );
+    ipc_modem_mailbox.state = IPC_MODEM_STATE_CMD;
+    ipc_modem_port_notify( );
+
+    while( ipc_modem_mailbox.state != IPC_MODEM_STATE_RSP )
+    {
+        ipc_modem_port_wait( );
+    }
+    __sync_synchronize( );
+
+    *rsp_length = ipc_modem_mailbox.rsp_length;
+    return ipc_modem_mailbox.rsp_code;
+}
+
+void ipc_modem_client_release( void )
+{
+    ipc_modem_mailbox.state = IPC_MODEM_STATE_IDLE;
+}
+
+bool ipc_modem_client_is_event_pending( void )
+{
+    if( ipc_modem_mailbox.event_pending == 0 )
+    {
+        return false;
+    }
+    ipc_modem_mailbox.event_pending = 0;
+    return true;
+}
+
+/* --- EOF ------------------------------------------------------------------ */
@@ -44,13 +44,16 @@
 #include "smtc_bsp.h"
 #include "modem_api.h"
 
-#if defined( HW_MODEM_ENABLED )
+#if defined( IPC_MODEM_ENABLED )
+#include "ipc_modem.h"
+#elif defined( HW_MODEM_ENABLED )
 #include "hw_modem.h"
 #endif
 
 // Prototype of main example used in this example
 extern void main_exti( uint8_t* user_dev_eui, uint8_t* user_join_eui, uint8_t* user_app_key );
 extern void main_alarm_file_upload( uint8_t* user_dev_eui, uint8_t* user_join_eui, uint8_t* user_app_key );
+extern void main_bench( void );
 
 /*
  * -----------------------------------------------------------------------------
@@ -93,6 +96,11 @@ int main( void )
     // Re-enable IRQ
     bsp_enable_irq( );
 
+#if defined( BENCH_ENABLED )
+    // Measure the compute kernels of the uplink path instead of running an example, built with "make bench"
+    main_bench( );
+#endif
+
     // Define your own LoRaWAN credential
     uint8_t user_dev_eui[8]  = { 0 };
     uint8_t user_join_eui[8] = { 0 };
@@ -121,30 +129,68 @@ int main( void )
 int main( )
 {
     uint32_t sleep_time;
+    uint32_t engine_deadline_ms;
+    bool     is_boot_done = false;
 
     bsp_disable_irq( );
 
     bsp_mcu_init( );
+    BSP_PERF_EVENT( BSP_PERF_EVENT_BOOT, BSP_PERF_BOOT_MCU_INIT );
 
+#if defined( IPC_MODEM_ENABLED )
+    // radio core of a dual-core MCU, the commands come from the application core
+    ipc_modem_init( );
+#else
     hw_modem_init( );
+#endif
+    BSP_PERF_EVENT( BSP_PERF_EVENT_BOOT, BSP_PERF_BOOT_MODEM_INIT );
 
     bsp_enable_irq( );
 
+#if( BSP_FAST_BOOT == BSP_FEATURE_OFF )
+    // the host reads the version with its GETVERSION command, the blocking prints delay the first uplink
     BSP_DBG_TRACE_INFO( "Modem is starting\n" );
     BSP_DBG_TRACE_PRINTF( "Version: %s\n", get_software_git_version( ) );
     BSP_DBG_TRACE_PRINTF( "Commit SHA1: %s\n", get_software_git_commit( ) );
     BSP_DBG_TRACE_PRINTF( "Commit date: %s\n", get_software_git_date( ) );
     BSP_DBG_TRACE_PRINTF( "Build date: %s\n", get_software_build_date( ) );
+#endif
 
+    engine_deadline_ms = bsp_rtc_get_time_ms( );
     while( 1 )
     {
-        //
+        // read first, the requests made while processing are kept for the next loop
+        uint8_t wakeup_sources = bsp_mcu_wakeup_sources_get( );
+
+#if defined( IPC_MODEM_ENABLED )
+        if( ipc_modem_is_a_cmd_available( ) == true )
+        {
+            ipc_modem_process_cmd( );
+#else
         if( hw_modem_is_a_cmd_available( ) == true )
         {
             hw_modem_process_cmd( );
+#endif
+            // a command may have changed anything in the modem
+            wakeup_sources |= BSP_MCU_WAKEUP_APP;
         }
 
-        sleep_time = modem_run_engine( );
+        int32_t remaining_ms = ( int32_t ) ( engine_deadline_ms - bsp_rtc_get_time_ms( ) );
+        if( ( ( wakeup_sources & ~BSP_MCU_WAKEUP_HOST ) != 0 ) || ( remaining_ms <= 0 ) )
+        {
+            sleep_time         = modem_run_engine( );
+            engine_deadline_ms = bsp_rtc_get_time_ms( ) + sleep_time;
+            if( is_boot_done == false )
+            {
+                is_boot_done = true;
+                BSP_PERF_EVENT( BSP_PERF_EVENT_BOOT, BSP_PERF_BOOT_FIRST_ENGINE );
+            }
+        }
+        else
+        {
+            // woken up by the host interface only, nothing has changed for the engine since its last run
+            sleep_time = ( uint32_t ) remaining_ms;
+        }
 
         bsp_mcu_set_sleep_for_ms( sleep_time );
     }
@@ -341,6 +341,6 @@ static void send_upload_file( uint8_t* file, uint16_t file_size, uint8_t port )
     BSP_DBG_TRACE_WARNING( "START A FILE UPLOAD (size:%d)\n", file_size );
 
     // Initialise the file upload with no encryption and a 2s average delay between each chunks
-    modem_upload_init( port, FILE_UPLOAD_NOT_ENCRYPTED, file_size, 2 );
-    modem_upload_start( file, file_size );
+    modem_upload_init( UPLOAD_SID, port, FILE_UPLOAD_NOT_ENCRYPTED, file_size, 2 );
+    modem_upload_start( UPLOAD_SID, file, file_size );
 }
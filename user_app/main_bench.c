@@ -0,0 +1,267 @@
+/*!
+ * \file      main_bench.c
+ *
+ * \brief     main program for the compute kernels benchmark
+ *
+ * Revised BSD License
+ * Copyright Semtech Corporation 2020. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of the Semtech corporation nor the
+ *       names of its contributors may be used to endorse or promote products
+ *       derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL SEMTECH CORPORATION BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- DEPENDENCIES ------------------------------------------------------------
+ */
+#include <stdint.h>   // C99 types
+#include <stdbool.h>  // bool type
+#include <string.h>   // memcpy
+
+#include "smtc_bsp.h"
+#include "crypto_backend.h"
+#include "cmac.h"
+#include "crypto.h"
+#include "modem_utilities.h"
+#include "file_upload.h"
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE CONSTANTS -------------------------------------------------------
+ */
+
+/*!
+ * Number of runs of each kernel and size, the minimum filters out the interrupts
+ */
+#define BENCH_REPEAT_NB 8
+
+/*!
+ * Size of the input and output buffers, the largest file upload accepted from the host
+ */
+#define BENCH_BUFFER_SIZE BSP_FILE_UPLOAD_MAX_SIZE
+
+/*!
+ * Payload size of the file upload frames, the largest LoRaWAN payload at the fastest data rate
+ */
+#define BENCH_FILE_UPLOAD_FRAME_SIZE 242
+
+/*!
+ * Largest file handled by the file upload, through a data reader as it does not fit in RAM
+ */
+#define BENCH_FILE_UPLOAD_MAX_SIZE ( 2 * 4096 )
+
+/*!
+ * Sizes in bytes of the data processed by each run
+ */
+static const uint16_t bench_sizes[] = { 16, 64, 256, 1024, 2048, 4096, 8192 };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE TYPES -----------------------------------------------------------
+ */
+
+/*!
+ * \typedef bench_kernel_t
+ * \brief   Benchmarked kernel: the setup is not measured, the run processes size bytes
+ */
+typedef struct bench_kernel_s
+{
+    const char* name;
+    uint16_t    max_size;
+    void ( *setup )( uint16_t size );
+    void ( *run )( uint16_t size );
+} bench_kernel_t;
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE VARIABLES -------------------------------------------------------
+ */
+static uint8_t              bench_input[BENCH_BUFFER_SIZE];
+static uint8_t              bench_output[BENCH_BUFFER_SIZE];
+static crypto_backend_key_t bench_key;
+static lora_crypto_ctx_t    bench_crypto_ctx;
+static AES_CMAC_CTX         bench_cmac_ctx;
+static uint32_t             bench_digest[8];
+
+static const uint8_t bench_raw_key[16] = { 0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+                                           0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C };
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
+ */
+static void bench_aes_block_run( uint16_t size );
+static void bench_cmac_run( uint16_t size );
+static void bench_payload_encrypt_run( uint16_t size );
+static void bench_sha256_run( uint16_t size );
+static void bench_crc_run( uint16_t size );
+static void bench_file_upload_buffer_setup( uint16_t size );
+static void bench_file_upload_reader_setup( uint16_t size );
+static void bench_file_upload_run( uint16_t size );
+static void bench_file_upload_read( void* context, uint32_t offset, uint8_t* buffer, uint32_t length );
+static void bench_kernel( const bench_kernel_t* kernel );
+
+// kernels in the report order
+static const bench_kernel_t bench_kernels[] = {
+    { "aes_encrypt", BENCH_BUFFER_SIZE, NULL, bench_aes_block_run },
+    { "aes_cmac", BENCH_BUFFER_SIZE, NULL, bench_cmac_run },
+    { "lora_crypto_payload_encrypt", BENCH_BUFFER_SIZE, NULL, bench_payload_encrypt_run },
+    { "sha256", BENCH_BUFFER_SIZE, NULL, bench_sha256_run },
+    { "crc", BENCH_BUFFER_SIZE, NULL, bench_crc_run },
+    { "file_upload_gen_uplink", BENCH_BUFFER_SIZE, bench_file_upload_buffer_setup, bench_file_upload_run },
+    { "file_upload_gen_uplink_reader", BENCH_FILE_UPLOAD_MAX_SIZE, bench_file_upload_reader_setup,
+      bench_file_upload_run },
+};
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PUBLIC FUNCTIONS DEFINITION ---------------------------------------------
+ */
+
+/**
+ * @brief Runs each compute kernel of the uplink path over the benchmark sizes and prints the cycles on the trace
+ *        UART, one line per kernel and size: bench,<kernel>,<size in bytes>,<min cycles>,<mean cycles>
+ */
+void main_bench( void )
+{
+    // deterministic input, the kernels timing does not depend on the data
+    for( uint16_t i = 0; i < BENCH_BUFFER_SIZE; i++ )
+    {
+        bench_input[i] = ( uint8_t )( i * 7 + 1 );
+    }
+    crypto_backend_key_set( &bench_key, bench_raw_key );
+
+    bsp_trace_print( "bench,core_clock_hz,%lu\n", bsp_mcu_get_core_clock_hz( ) );
+    for( uint8_t i = 0; i < ( sizeof( bench_kernels ) / sizeof( bench_kernels[0] ) ); i++ )
+    {
+        bench_kernel( &bench_kernels[i] );
+    }
+    bsp_trace_print( "bench,done\n" );
+
+    while( 1 )
+    {
+        bsp_mcu_set_sleep_for_ms( 60000 );
+    }
+}
+
+/*
+ * -----------------------------------------------------------------------------
+ * --- PRIVATE FUNCTIONS DEFINITION --------------------------------------------
+ */
+
+static void bench_kernel( const bench_kernel_t* kernel )
+{
+    for( uint8_t i = 0; i < ( sizeof( bench_sizes ) / sizeof( bench_sizes[0] ) ); i++ )
+    {
+        uint16_t size = bench_sizes[i];
+        uint32_t min  = UINT32_MAX;
+        uint32_t sum  = 0;
+
+        if( size > kernel->max_size )
+        {
+            break;
+        }
+        if( kernel->setup != NULL )
+        {
+            kernel->setup( size );
+        }
+        for( uint8_t n = 0; n < BENCH_REPEAT_NB; n++ )
+        {
+            uint32_t start = bsp_mcu_get_cycle_count( );
+            kernel->run( size );
+            uint32_t cycles = bsp_mcu_get_cycle_count( ) - start;
+
+            min = ( cycles < min ) ? cycles : min;
+            sum += cycles;
+        }
+        bsp_trace_print( "bench,%s,%u,%lu,%lu\n", kernel->name, size, min, sum / BENCH_REPEAT_NB );
+    }
+}
+
+static void bench_aes_block_run( uint16_t size )
+{
+    for( uint16_t i = 0; i < size; i += 16 )
+    {
+        crypto_backend_block_encrypt( &bench_key, &bench_input[i], &bench_output[i] );
+    }
+}
+
+static void bench_cmac_run( uint16_t size )
+{
+    AES_CMAC_Init( &bench_cmac_ctx );
+    AES_CMAC_SetKeySchedule( &bench_cmac_ctx, &bench_key );
+    AES_CMAC_Update( &bench_cmac_ctx, bench_input, size );
+    AES_CMAC_Final( bench_output, &bench_cmac_ctx );
+}
+
+static void bench_payload_encrypt_run( uint16_t size )
+{
+    lora_crypto_payload_encrypt( &bench_crypto_ctx, bench_input, size, bench_raw_key, 0x26011234, 0, 1, bench_output );
+}
+
+static void bench_sha256_run( uint16_t size )
+{
+    sha256( bench_digest, bench_input, size );
+}
+
+static void bench_crc_run( uint16_t size )
+{
+    bench_digest[0] = crc( bench_input, size );
+}
+
+static void bench_file_upload_buffer_setup( uint16_t size )
+{
+    file_upload_create( 0, NULL, size, 0, 0, FILE_UPLOAD_NOT_ENCRYPTED );
+    file_upload_set_hash( 0, 0x01234567, 0x89ABCDEF );
+    file_upload_attach_payload_buffer( 0, bench_input );
+}
+
+static void bench_file_upload_reader_setup( uint16_t size )
+{
+    file_upload_create( 0, NULL, size, 0, 0, FILE_UPLOAD_NOT_ENCRYPTED );
+    file_upload_set_hash( 0, 0x01234567, 0x89ABCDEF );
+    file_upload_attach_payload_reader( 0, bench_file_upload_read, NULL );
+}
+
+static void bench_file_upload_run( uint16_t size )
+{
+    // one frame, its cost grows with the number of chunks of the file
+    file_upload_gen_uplink( bench_output, BENCH_FILE_UPLOAD_FRAME_SIZE, 0, 1 );
+}
+
+static void bench_file_upload_read( void* context, uint32_t offset, uint8_t* buffer, uint32_t length )
+{
+    // the file repeats the input buffer
+    while( length > 0 )
+    {
+        uint32_t index = offset % BENCH_BUFFER_SIZE;
+        uint32_t n     = BENCH_BUFFER_SIZE - index;
+
+        n = ( n < length ) ? n : length;
+        memcpy( buffer, &bench_input[index], n );
+        buffer += n;
+        offset += n;
+        length -= n;
+    }
+}
+
+/* --- EOF ------------------------------------------------------------------ */
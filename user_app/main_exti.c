@@ -63,7 +63,9 @@ static uint8_t       rx_payload_size      = 0;      // Size of the payload in th
  * --- PRIVATE FUNCTIONS DECLARATION -------------------------------------------
  */
 static uint8_t is_joined( void );
-static void    get_event( void );
+static void    on_joined( const modem_event_t* event );
+static void    on_tx_done( const modem_event_t* event );
+static void    on_downlink( const modem_event_t* event );
 static void    user_button_callback( void* context );
 
 /*
@@ -83,9 +85,11 @@ void main_exti( uint8_t* user_dev_eui, uint8_t* user_join_eui, uint8_t* user_app
     // Disable IRQ to avoid unwanted behaviour during init
     bsp_disable_irq( );
 
-    // Init the modem and use get_event as event callback, please note that the callback will be
-    // called immediatly after the first call to modem_run_engine because of the reset detection
-    modem_init( &get_event );
+    // Init the modem without callback, the events of interest have their own handler and the other ones are dropped
+    modem_init( NULL );
+    modem_set_event_handler( RSP_JOINED, &on_joined );
+    modem_set_event_handler( RSP_TXDONE, &on_tx_done );
+    modem_set_event_handler( RSP_DOWNDATA, &on_downlink );
 
     // Configure Nucleo blue button as EXTI
     bsp_gpio_irq_t nucleo_blue_button = {
@@ -157,70 +161,31 @@ static uint8_t is_joined( void )
 }
 
 /**
- * @brief User callback for modem event
- *
- *  This callback is called every time an event ( see modem_rsp_event_t ) appears in the modem.
- *  Several events may have to be read from the modem when this callback is called.
+ * @brief Handler of the RSP_JOINED modem event
  */
-static void get_event( void )
+static void on_joined( const modem_event_t* event )
 {
-    BSP_DBG_TRACE_MSG_COLOR( "get_event () callback\n", BSP_DBG_TRACE_COLOR_BLUE );
-
-    modem_rsp_event_t type                   = RSP_NUMBER;
-    uint8_t           count                  = 0;
-    uint8_t           event_data[255]        = { 0 };
-    uint8_t           event_data_length      = 0;
-    uint8_t           asynchronous_msgnumber = 0;
-
-    // Read modem event type and number
-    modem_get_event( &type, &count, event_data, &event_data_length, &asynchronous_msgnumber );
-
-    // Continue to read modem event until all event has been processed
-    while( asynchronous_msgnumber > 0 )
-    {
-        BSP_DBG_TRACE_WARNING( "Event %u \n", type );
-        switch( type )
-        {
-        case RSP_RESET:
-            break;
-
-        case RSP_ALARM:
-            break;
-
-        case RSP_JOINED:
-            BSP_DBG_TRACE_INFO( "Modem is join \n" );
-            break;
-
-        case RSP_TXDONE:
-            BSP_DBG_TRACE_INFO( "TX done \n" );
-            break;
-
-        case RSP_DOWNDATA:
-            rx_payload_size = event_data_length - 4;
-            memcpy( rx_payload, &event_data[4], rx_payload_size );
-            BSP_DBG_TRACE_PRINTF( "Data received on port %u\n", event_data[3] );
-            BSP_DBG_TRACE_ARRAY( "DOWNDATA", rx_payload, rx_payload_size );
-            break;
-
-        case RSP_FILEDONE:
-            break;
-
-        case RSP_SETCONF:
-            break;
-
-        case RSP_MUTE:
-            break;
-
-        case RSP_LINKSTATUS:
-            break;
+    ( void ) event;
+    BSP_DBG_TRACE_INFO( "Modem is join \n" );
+}
 
-        default:
-            BSP_DBG_TRACE_ERROR( "Unknown event %u\n", type );
-            break;
-        }
+/**
+ * @brief Handler of the RSP_TXDONE modem event
+ */
+static void on_tx_done( const modem_event_t* event )
+{
+    BSP_DBG_TRACE_INFO( "TX done, status %u\n", event->status );
+}
 
-        modem_get_event( &type, &count, event_data, &event_data_length, &asynchronous_msgnumber );
-    }
+/**
+ * @brief Handler of the RSP_DOWNDATA modem event, called once per downlink
+ */
+static void on_downlink( const modem_event_t* event )
+{
+    rx_payload_size = event->downdata.length;
+    memcpy( rx_payload, event->downdata.data, rx_payload_size );
+    BSP_DBG_TRACE_PRINTF( "Data received on port %u\n", event->downdata.port );
+    BSP_DBG_TRACE_ARRAY( "DOWNDATA", rx_payload, rx_payload_size );
 }
 
 /**
@@ -243,6 +208,6 @@ static void user_button_callback( void* context )
         // When the button is pressed, the device is likely to be in low power mode. In this low power mode
         // implementation, low power needs to be disabled once to leave the low power loop and process the button
         // action.
-        bsp_mcu_disable_once_low_power_wait( );
+        bsp_mcu_wakeup_request( BSP_MCU_WAKEUP_APP );
     }
 }
@@ -53,7 +53,9 @@
 #define HAL_ADC_MODULE_ENABLED   
 //#define HAL_COMP_MODULE_ENABLED   
 //#define HAL_CRC_MODULE_ENABLED   
-//#define HAL_CRYP_MODULE_ENABLED   
+#if defined( SMTC_CRYPTO_HW_AES )
+#define HAL_CRYP_MODULE_ENABLED
+#endif
 //#define HAL_DAC_MODULE_ENABLED   
 //#define HAL_FIREWALL_MODULE_ENABLED   
 //#define HAL_I2S_MODULE_ENABLED   